@@ -256,6 +256,29 @@ def envoy_cc_test_library(name,
         linkstatic = 1,
     )
 
+# Envoy C++ microbenchmarks, built on Google Benchmark, should be specified with this function.
+# They are binaries rather than tests, since their output is only meaningful in an optimized build
+# on an otherwise idle machine.
+def envoy_cc_benchmark_binary(name,
+                              srcs = [],
+                              data = [],
+                              external_deps = [],
+                              deps = [],
+                              repository = ""):
+    native.cc_binary(
+        name = name,
+        srcs = srcs,
+        data = data,
+        copts = envoy_copts(repository, test = True),
+        linkopts = envoy_test_linkopts(),
+        linkstatic = 1,
+        testonly = 1,
+        malloc = tcmalloc_external_dep(repository),
+        deps = deps + [envoy_external_dep_path(dep) for dep in external_deps] + [
+            envoy_external_dep_path("benchmark"),
+        ],
+    )
+
 # Envoy Python test binaries should be specified with this function.
 def envoy_py_test_binary(name,
                          external_deps = [],
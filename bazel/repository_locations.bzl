@@ -61,6 +61,10 @@ REPOSITORY_LOCATIONS = dict(
         commit = "f54b0e47a08782a6131cc3d60f94d038fa6e0a51",  # v1.1.0
         remote = "https://github.com/tencent/rapidjson",
     ),
+    com_github_google_benchmark = dict(
+        commit = "505be96ab23056580a3a2315abba048f4428b04e",
+        remote = "https://github.com/google/benchmark",
+    ),
     com_google_googletest = dict(
         commit = "43863938377a9ea1399c0596269e0890b5c5515a",
         remote = "https://github.com/google/googletest",
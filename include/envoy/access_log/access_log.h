@@ -43,6 +43,13 @@ public:
    */
   virtual bool evaluate(const RequestInfo::RequestInfo& info,
                         const Http::HeaderMap& request_headers) PURE;
+
+  /**
+   * Decide from the request headers alone whether the log may be written, before the request is
+   * processed. Filters that need response data to decide return true.
+   * @return FALSE if evaluate() is known to return false for the request.
+   */
+  virtual bool mayPass(const Http::HeaderMap& request_headers) PURE;
 };
 
 typedef std::unique_ptr<Filter> FilterPtr;
@@ -63,6 +70,14 @@ public:
    */
   virtual void log(const Http::HeaderMap* request_headers, const Http::HeaderMap* response_headers,
                    const RequestInfo::RequestInfo& request_info) PURE;
+
+  /**
+   * Decide, once the request headers are final, whether the request may be logged. The caller
+   * does not call log() for a request this returns false for.
+   * @param request_headers supplies the incoming request headers after filtering.
+   * @return FALSE if log() is known not to write an entry for the request.
+   */
+  virtual bool mayLog(const Http::HeaderMap& request_headers) PURE;
 };
 
 typedef std::shared_ptr<Instance> InstanceSharedPtr;
@@ -74,9 +89,23 @@ class Formatter {
 public:
   virtual ~Formatter() {}
 
+  /**
+   * @return std::string the formatted log line.
+   */
   virtual std::string format(const Http::HeaderMap& request_headers,
                              const Http::HeaderMap& response_headers,
                              const RequestInfo::RequestInfo& request_info) const PURE;
+
+  /**
+   * Append the formatted log line to output. A caller that formats many lines can clear and
+   * reuse the same output, so that formatting stops allocating once the output has grown to the
+   * size of a line.
+   * @param output supplies the string the line is appended to.
+   */
+  virtual void formatTo(const Http::HeaderMap& request_headers,
+                        const Http::HeaderMap& response_headers,
+                        const RequestInfo::RequestInfo& request_info,
+                        std::string& output) const PURE;
 };
 
 typedef std::unique_ptr<Formatter> FormatterPtr;
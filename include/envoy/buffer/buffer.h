@@ -43,6 +43,29 @@ protected:
   virtual ~BufferFragment() {}
 };
 
+/**
+ * A BufferFragment whose data is a region of an open file. data() must still return the contents
+ * of the region (typically through a read-only memory mapping), but a buffer writing the fragment
+ * to a socket may instead have the kernel copy it straight from the file, e.g. with sendfile(),
+ * so the contents never pass through user space.
+ */
+class FileFragment : public BufferFragment {
+public:
+  /**
+   * @return int the descriptor of the file holding the data. It must stay open until done() is
+   *         called.
+   */
+  virtual int fd() const PURE;
+
+  /**
+   * @return uint64_t the offset in the file of the first byte of data().
+   */
+  virtual uint64_t offset() const PURE;
+
+protected:
+  virtual ~FileFragment() {}
+};
+
 /**
  * A basic buffer abstraction.
  */
@@ -59,7 +82,8 @@ public:
 
   /**
    * Add externally owned data into the buffer. No copying is done. fragment is not owned. When
-   * the fragment->data() is no longer needed, fragment->done() is called.
+   * the fragment->data() is no longer needed, fragment->done() is called. If the fragment is a
+   * FileFragment, write() may send it to the descriptor directly from the file.
    * @param fragment the externally owned data to add to the buffer.
    */
   virtual void addBufferFragment(BufferFragment& fragment) PURE;
@@ -104,14 +128,7 @@ public:
    * @param out_size supplies the size of out.
    * @return the actual number of slices needed, which may be greater than out_size. Passing
    *         nullptr for out and 0 for out_size will just return the size of the array needed
-   *         to capture all of the slice data.
-   * TODO(mattklein123): WARNING: The underlying implementation of this function currently uses
-   * libevent's evbuffer. It has the infuriating property where calling getRawSlices(nullptr, 0)
-   * will return the slices that include all of the buffer data, but not any empty slices at the
-   * end. However, calling getRawSlices(iovec, SOME_CONST), WILL return potentially empty slices
-   * beyond the end of the buffer. Code that is trying to avoid stack overflow by limiting the
-   * number of returned slices needs to deal with this. When we get rid of evbuffer we can rework
-   * all of this.
+   *         to capture all of the slice data. Slices that contain no data are never returned.
    */
   virtual uint64_t getRawSlices(RawSlice* out, uint64_t out_size) const PURE;
 
@@ -165,11 +182,18 @@ public:
   virtual ssize_t search(const void* data, uint64_t size, size_t start) const PURE;
 
   /**
-   * Write the buffer out to a file descriptor.
+   * Write the buffer out to a file descriptor. The first MaxWriteSlices slices of the buffer are
+   * gathered into a single system call, so if the buffer has no more slices than that, a return
+   * value smaller than length() means the descriptor cannot currently accept more data.
    * @param fd supplies the descriptor to write to.
    * @return the number of bytes written or -1 if there was an error.
    */
   virtual int write(int fd) PURE;
+
+  /**
+   * The maximum number of slices write() hands to a single system call.
+   */
+  static constexpr uint64_t MaxWriteSlices = 64;
 };
 
 typedef std::unique_ptr<Instance> InstancePtr;
@@ -195,5 +219,34 @@ public:
 
 typedef std::unique_ptr<WatermarkFactory> WatermarkFactoryPtr;
 
+/**
+ * Tracks the number of bytes held by a set of buffers. Accounts form a tree (e.g. stream,
+ * connection, listener, process): charging or crediting an account also charges or credits all of
+ * its ancestors, so each account's balance covers its whole subtree. Accounts may be shared by
+ * buffers on different threads.
+ */
+class MemoryAccount {
+public:
+  virtual ~MemoryAccount() {}
+
+  /**
+   * Record that buffers charged to this account now hold `bytes` more bytes.
+   */
+  virtual void charge(uint64_t bytes) PURE;
+
+  /**
+   * Record that buffers charged to this account now hold `bytes` fewer bytes.
+   */
+  virtual void credit(uint64_t bytes) PURE;
+
+  /**
+   * @return uint64_t the number of bytes currently held by buffers charged to this account or to
+   *         any of its descendants.
+   */
+  virtual uint64_t balance() const PURE;
+};
+
+typedef std::shared_ptr<MemoryAccount> MemoryAccountSharedPtr;
+
 } // namespace Buffer
 } // namespace Envoy
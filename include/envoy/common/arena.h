@@ -0,0 +1,118 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+#include "envoy/common/pure.h"
+
+namespace Envoy {
+
+/**
+ * Deleter for a unique_ptr that owns an object constructed in an Arena. It only runs the
+ * destructor; the memory is given back when the arena is destroyed.
+ */
+struct ArenaDeleter {
+  template <class T> void operator()(T* object) const { object->~T(); }
+};
+
+template <class T> using ArenaPtr = std::unique_ptr<T, ArenaDeleter>;
+
+/**
+ * A bump allocator whose memory is all released at once when the arena is destroyed. Allocation is
+ * a pointer increment in the common case and memory is never reused before destruction, so an
+ * arena suits the many small allocations that share a single lifetime, such as those made for one
+ * request.
+ */
+class Arena {
+public:
+  virtual ~Arena() {}
+
+  /**
+   * Allocate uninitialized memory.
+   * @param size supplies the number of bytes to allocate.
+   * @param alignment supplies the alignment of the memory. It must be a power of two no larger
+   *        than alignof(std::max_align_t).
+   * @return void* the memory, which is valid until the arena is destroyed. Never nullptr.
+   */
+  virtual void* allocate(size_t size, size_t alignment) PURE;
+
+  /**
+   * Register a function to be called when the arena is destroyed, before its memory is released.
+   * Cleanups are called in the reverse order that they were added.
+   * @param cleanup supplies the function to call.
+   * @param context supplies the argument to pass to the function.
+   */
+  virtual void addCleanup(void (*cleanup)(void*), void* context) PURE;
+
+  /**
+   * @return uint64_t the number of bytes that have been allocated from the arena.
+   */
+  virtual uint64_t bytesAllocated() const PURE;
+
+  /**
+   * Construct an object that is owned by the arena. Its destructor is run when the arena is
+   * destroyed.
+   * @return T* the object.
+   */
+  template <class T, class... Args> T* create(Args&&... args) {
+    T* object = new (allocate(sizeof(T), alignof(T))) T(std::forward<Args>(args)...);
+    if (!std::is_trivially_destructible<T>::value) {
+      addCleanup([](void* context) { static_cast<T*>(context)->~T(); }, object);
+    }
+    return object;
+  }
+
+  /**
+   * Construct an object in the arena's memory that is owned by the returned pointer. This allows
+   * the object to be destroyed before the arena is.
+   * @return ArenaPtr<T> the object.
+   */
+  template <class T, class... Args> ArenaPtr<T> makeUnique(Args&&... args) {
+    return ArenaPtr<T>(new (allocate(sizeof(T), alignof(T))) T(std::forward<Args>(args)...));
+  }
+
+  /**
+   * Construct a reference counted object, and its reference count, in the arena's memory. The
+   * object is destroyed when the last reference goes away, which must happen before the arena is
+   * destroyed.
+   * @return std::shared_ptr<T> the object.
+   */
+  template <class T, class... Args> std::shared_ptr<T> makeShared(Args&&... args);
+};
+
+/**
+ * Standard allocator that allocates from an Arena. Deallocation is a no-op; the memory is given
+ * back when the arena is destroyed.
+ */
+template <class T> class ArenaAllocator {
+public:
+  typedef T value_type;
+
+  ArenaAllocator(Arena& arena) : arena_(&arena) {}
+  template <class U> ArenaAllocator(const ArenaAllocator<U>& other) : arena_(&other.arena()) {}
+
+  T* allocate(size_t n) { return static_cast<T*>(arena_->allocate(n * sizeof(T), alignof(T))); }
+  void deallocate(T*, size_t) {}
+
+  Arena& arena() const { return *arena_; }
+
+  template <class U> bool operator==(const ArenaAllocator<U>& rhs) const {
+    return arena_ == &rhs.arena();
+  }
+  template <class U> bool operator!=(const ArenaAllocator<U>& rhs) const {
+    return !(*this == rhs);
+  }
+
+private:
+  Arena* arena_;
+};
+
+template <class T, class... Args> std::shared_ptr<T> Arena::makeShared(Args&&... args) {
+  return std::allocate_shared<T>(ArenaAllocator<T>(*this), std::forward<Args>(args)...);
+}
+
+} // namespace Envoy
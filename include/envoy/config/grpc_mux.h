@@ -23,6 +23,21 @@ public:
   virtual void onConfigUpdate(const Protobuf::RepeatedPtrField<ProtobufWkt::Any>& resources,
                               const std::string& version_info) PURE;
 
+  /**
+   * Called when an incremental configuration update is received from a management server speaking
+   * incremental xDS. Unlike onConfigUpdate(), it is only called for watches whose resources
+   * changed, and for each watch once after it subscribes.
+   * @param added_resources resources added or changed since the last accepted update.
+   * @param removed_resources names of the resources removed since the last accepted update.
+   * @param version_info system version of the update.
+   * @throw EnvoyException with reason if the configuration is rejected. The versions of rejected
+   *        resources are not reflected in subsequent requests.
+   */
+  virtual void
+  onIncrementalConfigUpdate(const Protobuf::RepeatedPtrField<ProtobufWkt::Any>& added_resources,
+                            const std::vector<std::string>& removed_resources,
+                            const std::string& version_info) PURE;
+
   /**
    * Called when either the subscription is unable to fetch a config update or when onConfigUpdate
    * invokes an exception.
@@ -7,6 +7,7 @@
 #include "envoy/common/pure.h"
 #include "envoy/stats/stats_macros.h"
 
+#include "common/common/macros.h"
 #include "common/protobuf/protobuf.h"
 
 namespace Envoy {
@@ -27,6 +28,26 @@ public:
    */
   virtual void onConfigUpdate(const ResourceVector& resources) PURE;
 
+  /**
+   * @return bool whether the callbacks take incremental updates through
+   *         onIncrementalConfigUpdate(). Otherwise subscriptions that receive incremental updates
+   *         merge them and call onConfigUpdate() with the complete set of resources.
+   */
+  virtual bool supportsIncrementalUpdates() const { return false; }
+
+  /**
+   * Called when an incremental configuration update is received, if supportsIncrementalUpdates().
+   * @param added_resources resources added or changed since the last accepted update.
+   * @param removed_resources names of the resources removed since the last accepted update.
+   * @throw EnvoyException with reason if the configuration is rejected, as for onConfigUpdate().
+   */
+  virtual void onIncrementalConfigUpdate(const ResourceVector& added_resources,
+                                         const std::vector<std::string>& removed_resources) {
+    UNREFERENCED_PARAMETER(added_resources);
+    UNREFERENCED_PARAMETER(removed_resources);
+    throw EnvoyException("incremental config updates are not supported");
+  }
+
   /**
    * Called when either the Subscription is unable to fetch a config update or when onConfigUpdate
    * invokes an exception.
@@ -1,5 +1,6 @@
 #pragma once
 
+#include <chrono>
 #include <cstdint>
 #include <functional>
 #include <memory>
@@ -111,6 +112,15 @@ public:
    */
   virtual TimerPtr createTimer(TimerCb cb) PURE;
 
+  /**
+   * Allocate a coarse timer. Coarse timers are cheaper to enable and disable than the timers of
+   * createTimer(), and fire in batches up to a fraction of a second after their timeouts. They are
+   * meant for numerous timers that do not need to be precise, such as health check intervals and
+   * idle timeouts. @see Event::Timer for docs on how to use the timer.
+   * @param cb supplies the callback to invoke when the timer fires.
+   */
+  virtual TimerPtr createCoarseTimer(TimerCb cb) PURE;
+
   /**
    * Submit an item for deferred delete. @see DeferredDeletable.
    */
@@ -147,6 +157,36 @@ public:
   enum class RunType { Block, NonBlock };
   virtual void run(RunType type) PURE;
 
+  /**
+   * Record how long each iteration of the event loop runs callbacks for, how long it polls for
+   * events before that, and how long posted functors wait to run, in histograms of a scope. Must
+   * be called before run().
+   * @param scope supplies the scope of the histograms.
+   * @param prefix supplies the prefix of the names of the histograms, i.e. "worker_0.".
+   */
+  virtual void initializeStats(Stats::Scope& scope, const std::string& prefix) PURE;
+
+  /**
+   * Limit how long a batch of posted functors or deferred deletions runs for. Once the budget is
+   * exhausted, the rest run after the event loop polled for events again, so that a burst of them
+   * cannot starve the connections of the dispatcher.
+   * @param budget supplies the budget, or 0 for no limit.
+   */
+  virtual void setCallbackBudget(std::chrono::microseconds budget) PURE;
+
+  /**
+   * Poll the files of the file events created from now on with an io_uring instead of libevent,
+   * which batches the system calls that arming and disarming them takes. Must be called before
+   * run().
+   * @return bool whether the kernel supports it. If not, libevent keeps polling the files.
+   */
+  virtual bool enableIoUring() PURE;
+
+  /**
+   * @return uint64_t the number of posted functors that have not run yet. Thread safe.
+   */
+  virtual uint64_t pendingPosts() const PURE;
+
   /**
    * Returns a factory which connections may use for watermark buffer creation.
    * @return the watermark buffer factory for this dispatcher.
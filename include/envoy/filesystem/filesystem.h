@@ -10,6 +10,18 @@
 namespace Envoy {
 namespace Filesystem {
 
+/**
+ * What a write to a file does when the buffer that the writing thread has for the file is full.
+ */
+enum class OverflowPolicy {
+  // Wait until the flush thread took enough of the buffer.
+  Block,
+  // Drop the write. Dropped writes are counted.
+  Drop,
+  // Add the write to a buffer that all threads share under a lock.
+  Spill,
+};
+
 /**
  * Abstraction for a file on disk.
  */
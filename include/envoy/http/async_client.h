@@ -126,6 +126,13 @@ public:
      * Reset the stream.
      */
     virtual void reset() PURE;
+
+    /**
+     * @return whether the upstream connection of the stream is above its write buffer high
+     *         watermark. The stream does not push back on its caller, which can use this to stop
+     *         sending data that would only be buffered.
+     */
+    virtual bool isAboveWriteBufferHighWatermark() const PURE;
   };
 
   virtual ~AsyncClient() {}
@@ -1,5 +1,6 @@
 #pragma once
 
+#include <chrono>
 #include <cstdint>
 #include <limits>
 #include <memory>
@@ -181,6 +182,14 @@ struct Http1Settings {
   // Enable codec to parse absolute uris. This enables forward/explicit proxy support for non TLS
   // traffic
   bool allow_absolute_url_{false};
+  // Parse common request heads (no body, no upgrade) with the vectorized request head parser
+  // instead of http_parser. Everything else still goes through http_parser.
+  bool fast_request_parser_{false};
+  // Coalesce the chunks of chunk encoded bodies that are smaller than this many bytes, which wait
+  // for up to chunk_coalesce_delay_ for more data to share a chunk header with. A delay of 0 waits
+  // for the rest of the event loop iteration. 0 bytes disables coalescing.
+  uint32_t chunk_coalesce_bytes_{0};
+  std::chrono::milliseconds chunk_coalesce_delay_{0};
 };
 
 /**
@@ -192,6 +201,7 @@ struct Http2Settings {
   uint32_t max_concurrent_streams_{DEFAULT_MAX_CONCURRENT_STREAMS};
   uint32_t initial_stream_window_size_{DEFAULT_INITIAL_STREAM_WINDOW_SIZE};
   uint32_t initial_connection_window_size_{DEFAULT_INITIAL_CONNECTION_WINDOW_SIZE};
+  uint32_t max_frame_size_{DEFAULT_MAX_FRAME_SIZE};
 
   // disable HPACK compression
   static const uint32_t MIN_HPACK_TABLE_SIZE = 0;
@@ -225,6 +235,12 @@ struct Http2Settings {
   // our default connection-level window also equals to our stream-level
   static const uint32_t DEFAULT_INITIAL_CONNECTION_WINDOW_SIZE = 256 * 1024 * 1024;
   static const uint32_t MAX_INITIAL_CONNECTION_WINDOW_SIZE = (1U << 31) - 1;
+
+  // initial value from HTTP/2 spec, which is also the minimum
+  static const uint32_t MIN_MAX_FRAME_SIZE = (1 << 14);
+  static const uint32_t DEFAULT_MAX_FRAME_SIZE = (1 << 14);
+  // maximum from HTTP/2 spec
+  static const uint32_t MAX_MAX_FRAME_SIZE = (1 << 24) - 1;
 };
 
 /**
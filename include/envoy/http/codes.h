@@ -1,5 +1,11 @@
 #pragma once
 
+#include <chrono>
+#include <cstdint>
+#include <memory>
+
+#include "envoy/common/pure.h"
+
 namespace Envoy {
 namespace Http {
 
@@ -72,5 +78,44 @@ enum class Code {
   // clang-format on
 };
 
+/**
+ * The stats of the responses of an upstream cluster that are charged under the fixed prefixes of
+ * the cluster scope, bound to their counters and histograms so that charging a response neither
+ * builds nor looks up stat names.
+ */
+class CodeStats {
+public:
+  virtual ~CodeStats() {}
+
+  /**
+   * Charge a response to the counters of its code class and of its code, e.g. upstream_rq_5xx and
+   * upstream_rq_503, and to those under the canary. prefix if it is from a canary, and under the
+   * internal. or external. prefix.
+   * @param response_status_code supplies the code of the response.
+   * @param upstream_canary supplies whether the response is from a canary.
+   * @param internal_request supplies whether the request is internal.
+   */
+  virtual void chargeResponseStat(uint64_t response_status_code, bool upstream_canary,
+                                  bool internal_request) PURE;
+
+  /**
+   * Charge a response that is retried to the counters under the retry. prefix.
+   * @param response_status_code supplies the code of the response.
+   */
+  virtual void chargeRetryResponseStat(uint64_t response_status_code) PURE;
+
+  /**
+   * Charge a response time to upstream_rq_time and to the histograms under the same prefixes as
+   * chargeResponseStat().
+   * @param response_time supplies the response time.
+   * @param upstream_canary supplies whether the response is from a canary.
+   * @param internal_request supplies whether the request is internal.
+   */
+  virtual void chargeResponseTiming(std::chrono::milliseconds response_time, bool upstream_canary,
+                                    bool internal_request) PURE;
+};
+
+typedef std::unique_ptr<CodeStats> CodeStatsPtr;
+
 } // namespace Http
 } // namespace Envoy
@@ -95,6 +95,13 @@ public:
    */
   virtual void drainConnections() PURE;
 
+  /**
+   * Create connections ahead of any streams when the cluster prefetches connections (see
+   * Upstream::ClusterInfo::prefetchRatio()), so that the first streams do not have to wait for
+   * connections to be established. Does nothing otherwise, or while the pool is being drained.
+   */
+  virtual void prefetch() PURE;
+
   /**
    * Create a new stream on the pool.
    * @param response_decoder supplies the decoder events to fire when the response is
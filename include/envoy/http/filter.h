@@ -6,11 +6,13 @@
 #include <string>
 
 #include "envoy/access_log/access_log.h"
+#include "envoy/common/arena.h"
 #include "envoy/event/dispatcher.h"
 #include "envoy/http/codec.h"
 #include "envoy/http/header_map.h"
 #include "envoy/router/router.h"
 #include "envoy/ssl/connection.h"
+#include "envoy/stats/stats_macros.h"
 #include "envoy/tracing/http_tracer.h"
 
 namespace Envoy {
@@ -138,6 +140,20 @@ public:
    * @return tracing configuration.
    */
   virtual const Tracing::Config& tracingConfig() PURE;
+
+  /**
+   * @return Arena& an arena for allocations that live as long as the stream. Its memory is released
+   *         in one go when the stream is destroyed, after all of the stream's filters have been.
+   */
+  virtual Arena& arena() PURE;
+
+  /**
+   * Time the filters that are added after this call, until the next call, into the given stats.
+   * This is called by the config that builds the filter chain, not by filter factories.
+   * @param stats supplies the stats of the filter the next filters are created for, or nullptr
+   *        to not time them.
+   */
+  virtual void setFilterLatencyStats(const FilterLatencyStats* stats) PURE;
 };
 
 /**
@@ -439,6 +455,31 @@ class StreamFilter : public StreamDecoderFilter, public StreamEncoderFilter {};
 
 typedef std::shared_ptr<StreamFilter> StreamFilterSharedPtr;
 
+/**
+ * Per filter latency stats. The *_us histograms are the time spent in each filter callback,
+ * including the filters the callback runs inline, e.g. by sending a local reply. The *_stopped_ms
+ * histograms are the time from a filter stopping iteration until it continues, e.g. while it
+ * waits for an asynchronous call. @see stats_macros.h
+ */
+// clang-format off
+#define ALL_FILTER_LATENCY_STATS(HISTOGRAM)                                                        \
+  HISTOGRAM(decode_headers_us)                                                                     \
+  HISTOGRAM(decode_data_us)                                                                        \
+  HISTOGRAM(decode_trailers_us)                                                                    \
+  HISTOGRAM(decode_stopped_ms)                                                                     \
+  HISTOGRAM(encode_headers_us)                                                                     \
+  HISTOGRAM(encode_data_us)                                                                        \
+  HISTOGRAM(encode_trailers_us)                                                                    \
+  HISTOGRAM(encode_stopped_ms)
+// clang-format on
+
+/**
+ * Struct definition for per filter latency stats. @see stats_macros.h
+ */
+struct FilterLatencyStats {
+  ALL_FILTER_LATENCY_STATS(GENERATE_HISTOGRAM_STRUCT)
+};
+
 /**
  * These callbacks are provided by the connection manager to the factory so that the factory can
  * build the filter chain in an application specific way.
@@ -470,6 +511,14 @@ public:
    * @param handler supplies the handler to add.
    */
   virtual void addAccessLogHandler(AccessLog::InstanceSharedPtr handler) PURE;
+
+  /**
+   * @return Arena& the arena of the stream the filter chain is created for. Factories should
+   *         construct filters with arena().makeShared(), which makes the per stream cost of a
+   *         filter an arena allocation instead of a heap allocation. Filters made this way must
+   *         not be referenced after the stream is destroyed.
+   */
+  virtual Arena& arena() PURE;
 };
 
 /**
@@ -490,5 +539,27 @@ public:
   virtual void createFilterChain(FilterChainFactoryCallbacks& callbacks) PURE;
 };
 
+/**
+ * Answers header only requests that the first filter of a chain would answer locally, so that the
+ * connection manager can respond to them without creating the filter chain. Used by all threads.
+ */
+class HeaderOnlyResponder {
+public:
+  virtual ~HeaderOnlyResponder() {}
+
+  /**
+   * Called for a request that has no body or trailers, before the route is looked up.
+   * @param request_headers supplies the request headers.
+   * @param response_headers supplies the empty headers to fill in with the response.
+   * @param request_info supplies the request info to record the outcome in.
+   * @return bool whether the request was answered. If false, nothing must have been modified and
+   *         the request goes through the filter chain.
+   */
+  virtual bool respond(const HeaderMap& request_headers, HeaderMap& response_headers,
+                       RequestInfo::RequestInfo& request_info) PURE;
+};
+
+typedef std::shared_ptr<HeaderOnlyResponder> HeaderOnlyResponderSharedPtr;
+
 } // namespace Http
 } // namespace Envoy
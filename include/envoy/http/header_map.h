@@ -39,14 +39,15 @@ private:
 
 /**
  * This is a string implementation for use in header processing. It is heavily optimized for
- * performance. It supports 3 different types of storage and can switch between them:
+ * performance. It supports 4 different types of storage and can switch between them:
  * 1) A reference.
  * 2) Interned string.
  * 3) Heap allocated storage.
+ * 4) A reference to pinned storage, such as a codec's read buffer, which is copied on write.
  */
 class HeaderString {
 public:
-  enum class Type { Inline, Reference, Dynamic };
+  enum class Type { Inline, Reference, Dynamic, Pinned };
 
   /**
    * Default constructor. Sets up for inline storage.
@@ -77,9 +78,15 @@ public:
   void append(const char* data, uint32_t size);
 
   /**
-   * @return the modifiable backing buffer (either inline or heap allocated).
+   * @return the modifiable backing buffer (either inline or heap allocated). Pinned strings are
+   *         copied first.
    */
-  char* buffer() { return buffer_.dynamic_; }
+  char* buffer() {
+    if (type_ == Type::Pinned) {
+      unpin();
+    }
+    return buffer_.dynamic_;
+  }
 
   /**
    * @return a null terminated C string.
@@ -87,8 +94,8 @@ public:
   const char* c_str() const { return buffer_.ref_; }
 
   /**
-   * Return the string to a default state. Reference strings are not touched. Both inline/dynamic
-   * strings are reset to zero size.
+   * Return the string to a default state. Reference strings are not touched. Inline, dynamic and
+   * pinned strings are reset to zero size.
    */
   void clear();
 
@@ -144,6 +151,17 @@ public:
    */
   void setReference(const std::string& ref_value);
 
+  /**
+   * Set the value of the string to reference pinned data, without copying it. Unlike a plain
+   * reference, any later modification copies the data into the string first.
+   * @param data supplies the data, which MUST be null terminated and MUST stay valid and unchanged
+   *        for as long as the string references it. Codecs use this for header values in their
+   *        read buffer, whose storage the header map keeps alive (see
+   *        HeaderMapImpl::addPinnedStorage()).
+   * @param size supplies the size of the data, not including the null terminator.
+   */
+  void setPinned(const char* data, uint32_t size);
+
   /**
    * @return the size of the string, not including the null terminator.
    */
@@ -169,6 +187,8 @@ private:
   };
 
   void freeDynamic();
+  // Switch a pinned string to owned storage containing a copy of its data.
+  void unpin();
 
   uint32_t string_length_;
   Type type_;
@@ -258,6 +278,7 @@ private:
   HEADER_FUNC(EnvoyUpstreamCanary)                                                                 \
   HEADER_FUNC(EnvoyUpstreamHealthCheckedCluster)                                                   \
   HEADER_FUNC(EnvoyUpstreamRequestPerTryTimeoutMs)                                                 \
+  HEADER_FUNC(EnvoyUpstreamRequestPriority)                                                        \
   HEADER_FUNC(EnvoyUpstreamRequestTimeoutAltResponse)                                              \
   HEADER_FUNC(EnvoyUpstreamRequestTimeoutMs)                                                       \
   HEADER_FUNC(EnvoyUpstreamServiceTime)                                                            \
@@ -111,6 +111,13 @@ public:
   virtual void numberToReturn(int32_t to_return) PURE;
   virtual const Bson::Document* query() const PURE;
   virtual void query(Bson::DocumentSharedPtr&& query) PURE;
+
+  /**
+   * @return the BSON encoding of the query, or "" if there is no query. Reading a few fields of
+   *         the encoding is much cheaper than decoding the query with query().
+   */
+  virtual const std::string& encodedQuery() const PURE;
+
   virtual const Bson::Document* returnFieldsSelector() const PURE;
   virtual void returnFieldsSelector(Bson::DocumentSharedPtr&& fields) PURE;
 };
@@ -141,6 +148,12 @@ public:
   virtual void numberReturned(int32_t number_returned) PURE;
   virtual const std::list<Bson::DocumentSharedPtr>& documents() const PURE;
   virtual std::list<Bson::DocumentSharedPtr>& documents() PURE;
+
+  /**
+   * @return the encoded size of the returned documents, including any that were skipped rather
+   *         than decoded into documents().
+   */
+  virtual uint64_t documentsByteSize() const PURE;
 };
 
 typedef std::unique_ptr<ReplyMessage> ReplyMessagePtr;
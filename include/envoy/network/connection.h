@@ -94,6 +94,12 @@ public:
    */
   virtual void addConnectionCallbacks(ConnectionCallbacks& cb) PURE;
 
+  /**
+   * Unregister callbacks registered with addConnectionCallbacks(). This must not be called while
+   * the connection is raising an event.
+   */
+  virtual void removeConnectionCallbacks(ConnectionCallbacks& cb) PURE;
+
   /**
    * Register for callback everytime bytes are written to the underlying TransportSocket.
    */
@@ -206,6 +212,18 @@ public:
    */
   virtual uint32_t bufferLimit() const PURE;
 
+  /**
+   * Charge the bytes held in the connection's read and write buffers to an account.
+   * @param account supplies the account, or nullptr to stop accounting.
+   */
+  virtual void setMemoryAccount(const Buffer::MemoryAccountSharedPtr& account) PURE;
+
+  /**
+   * @return the account the connection's buffers are charged to, or nullptr if there is none.
+   *         Buffers belonging to streams on the connection can be charged to child accounts of it.
+   */
+  virtual const Buffer::MemoryAccountSharedPtr& memoryAccount() const PURE;
+
   /**
    * @return boolean telling if the connection's local address is an original destination address,
    * rather than the listener's address.
@@ -216,6 +234,26 @@ public:
    * @return boolean telling if the connection is currently above the high watermark.
    */
   virtual bool aboveHighWatermark() const PURE;
+
+  /**
+   * Callback function for when bytes have been forwarded between spliced connections.
+   * @param from supplies the connection the bytes were read from.
+   * @param bytes supplies the number of bytes forwarded to the other connection.
+   */
+  typedef std::function<void(Connection& from, uint64_t bytes)> SpliceCb;
+
+  /**
+   * Forward all further data between this connection and a peer inside the kernel, without
+   * copying it through user space. Data read from either connection is written straight to the
+   * other and is not seen by the read or write filters of either. This is only possible for
+   * plaintext connections with no buffered data, no write filters and at most one read filter
+   * (the one asking for the splice), on platforms that support it.
+   * @param peer supplies the connection to forward to and from.
+   * @param cb supplies the callback invoked each time bytes are forwarded in either direction.
+   * @return bool true if the connections are now spliced, false if data must keep flowing through
+   *         the filters.
+   */
+  virtual bool startSplice(Connection& peer, SpliceCb cb) PURE;
 };
 
 typedef std::unique_ptr<Connection> ConnectionPtr;
@@ -230,6 +268,13 @@ public:
    * registered via addConnectionCallbacks().
    */
   virtual void connect() PURE;
+
+  /**
+   * Enable TCP Fast Open on the connection, so that the first data written to it is sent in the
+   * SYN if the kernel has a TFO cookie for the remote host. This must be called before connect(),
+   * and does nothing if the kernel does not support it.
+   */
+  virtual void enableFastOpen() PURE;
 };
 
 typedef std::unique_ptr<ClientConnection> ClientConnectionPtr;
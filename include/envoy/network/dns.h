@@ -7,6 +7,7 @@
 
 #include "envoy/common/pure.h"
 #include "envoy/network/address.h"
+#include "envoy/stats/stats.h"
 
 namespace Envoy {
 namespace Network {
@@ -50,6 +51,13 @@ public:
    */
   virtual ActiveDnsQuery* resolve(const std::string& dns_name, DnsLookupFamily dns_lookup_family,
                                   ResolveCb callback) PURE;
+
+  /**
+   * Record the stats of the resolutions and of the cache of the resolver in a scope.
+   * @param scope supplies the scope of the stats.
+   * @param prefix supplies the prefix of the names of the stats, i.e. "dns.".
+   */
+  virtual void initializeStats(Stats::Scope& scope, const std::string& prefix) PURE;
 };
 
 typedef std::shared_ptr<DnsResolver> DnsResolverSharedPtr;
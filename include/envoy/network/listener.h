@@ -10,6 +10,65 @@
 namespace Envoy {
 namespace Network {
 
+/**
+ * A listener of a worker that a connection balancer can hand connections to.
+ */
+class BalancedConnectionHandler {
+public:
+  virtual ~BalancedConnectionHandler() {}
+
+  /**
+   * @return uint64_t the number of connections of the worker, including those handed over to it
+   *         that it did not accept yet. Can be called from any thread.
+   */
+  virtual uint64_t numConnections() PURE;
+
+  /**
+   * Hand an accepted connection over to the worker, which accepts it on its own thread. Can be
+   * called from any thread.
+   * @param fd supplies the fd of the connection, which is owned by the callee.
+   * @param remote_address supplies the remote address of the connection.
+   * @param local_address supplies the local address of the connection.
+   * @param using_original_dst supplies whether the local address is the original destination.
+   */
+  virtual void post(int fd, Address::InstanceConstSharedPtr remote_address,
+                    Address::InstanceConstSharedPtr local_address, bool using_original_dst) PURE;
+};
+
+/**
+ * Balances the connections of a listener across the listeners of the workers, so that the
+ * workers with few connections accept those that the kernel hands to busier workers.
+ */
+class ConnectionBalancer {
+public:
+  virtual ~ConnectionBalancer() {}
+
+  /**
+   * Add the listener of a worker to the listeners that get balanced connections.
+   */
+  virtual void registerHandler(BalancedConnectionHandler& handler) PURE;
+
+  /**
+   * Remove a listener added by registerHandler(). No connections are handed to it once this
+   * returns.
+   */
+  virtual void unregisterHandler(BalancedConnectionHandler& handler) PURE;
+
+  /**
+   * Hand a connection that a listener accepted over to the listener with the fewest connections,
+   * if it has fewer connections than the listener that accepted it.
+   * @param current supplies the listener that accepted the connection.
+   * @return bool whether the connection was handed over, in which case the fd is no longer owned
+   *         by the caller.
+   */
+  virtual bool balanceConnection(BalancedConnectionHandler& current, int fd,
+                                 Address::InstanceConstSharedPtr remote_address,
+                                 Address::InstanceConstSharedPtr local_address,
+                                 bool using_original_dst) PURE;
+};
+
+typedef std::unique_ptr<ConnectionBalancer> ConnectionBalancerPtr;
+
 /**
  * Listener configurations options.
  */
@@ -25,6 +84,12 @@ struct ListenerOptions {
   bool use_original_dst_;
   // Soft limit on size of the listener's new connection read and write buffers.
   uint32_t per_connection_buffer_limit_bytes_;
+  // The balancer of the connections across the workers that the listener takes part in, if any.
+  ConnectionBalancer* connection_balancer_;
+  // The maximum number of connections the listener accepts each time its socket is ready, so that
+  // a backlog of connections does not hold up the other events of the worker. The listener uses a
+  // default budget if it is 0.
+  uint32_t accept_batch_size_;
 
   /**
    * Factory for ListenerOptions with bind_to_port_ set.
@@ -34,7 +99,9 @@ struct ListenerOptions {
     return {.bind_to_port_ = true,
             .use_proxy_proto_ = false,
             .use_original_dst_ = false,
-            .per_connection_buffer_limit_bytes_ = 0};
+            .per_connection_buffer_limit_bytes_ = 0,
+            .connection_balancer_ = nullptr,
+            .accept_batch_size_ = 0};
   }
 };
 
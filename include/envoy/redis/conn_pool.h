@@ -129,6 +129,14 @@ public:
    */
   virtual PoolRequest* makeRequest(const std::string& hash_key, const RespValue& request,
                                    PoolCallbacks& callbacks) PURE;
+
+  /**
+   * Keys in the same group may be sent together in one multi key command, made with any of them
+   * as the hash key.
+   * @param hash_key supplies a key.
+   * @return uint64_t the group of the key.
+   */
+  virtual uint64_t keyGroup(const std::string& hash_key) PURE;
 };
 
 typedef std::unique_ptr<Instance> InstancePtr;
@@ -92,6 +92,70 @@ public:
    */
   virtual void responseReceivedDuration(MonotonicTime time) PURE;
 
+  /**
+   * @return the duration from request start to when the router started getting a connection to
+   * the upstream host from the connection pool, in microseconds.
+   */
+  virtual const Optional<std::chrono::microseconds>& upstreamConnectStartDuration() const PURE;
+
+  /**
+   * Set the duration from request start to when the router started getting a connection to the
+   * upstream host.
+   * @param time monotonic clock time when the connection was requested from the pool.
+   */
+  virtual void upstreamConnectStartDuration(MonotonicTime time) PURE;
+
+  /**
+   * @return the duration from request start to when the connection to the upstream host was
+   * ready, in microseconds.
+   */
+  virtual const Optional<std::chrono::microseconds>& upstreamConnectEndDuration() const PURE;
+
+  /**
+   * Set the duration from request start to when the connection to the upstream host was ready.
+   * @param time monotonic clock time when the connection pool provided the connection.
+   */
+  virtual void upstreamConnectEndDuration(MonotonicTime time) PURE;
+
+  /**
+   * @return the duration from request start to when the last byte of the response was received
+   * from the upstream host, in microseconds.
+   */
+  virtual const Optional<std::chrono::microseconds>& upstreamLastByteReceivedDuration() const PURE;
+
+  /**
+   * Set the duration from request start to when the last byte of the response was received from
+   * the upstream host.
+   * @param time monotonic clock time when the last byte of the response was received.
+   */
+  virtual void upstreamLastByteReceivedDuration(MonotonicTime time) PURE;
+
+  /**
+   * @return the duration from request start to when the first byte of the response was sent to
+   * the downstream client, in microseconds.
+   */
+  virtual const Optional<std::chrono::microseconds>& downstreamFirstByteSentDuration() const PURE;
+
+  /**
+   * Set the duration from request start to when the first byte of the response was sent to the
+   * downstream client.
+   * @param time monotonic clock time when the response headers were handed to the codec.
+   */
+  virtual void downstreamFirstByteSentDuration(MonotonicTime time) PURE;
+
+  /**
+   * @return the duration from request start to when the last byte of the response was sent to
+   * the downstream client, in microseconds.
+   */
+  virtual const Optional<std::chrono::microseconds>& downstreamLastByteSentDuration() const PURE;
+
+  /**
+   * Set the duration from request start to when the last byte of the response was sent to the
+   * downstream client.
+   * @param time monotonic clock time when the end of the response was handed to the codec.
+   */
+  virtual void downstreamLastByteSentDuration(MonotonicTime time) PURE;
+
   /**
    * @return the # of body bytes received in the request.
    */
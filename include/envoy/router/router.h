@@ -20,6 +20,10 @@
 #include "common/protobuf/utility.h"
 
 namespace Envoy {
+namespace Upstream {
+class ClusterHandle;
+}
+
 namespace Router {
 
 /**
@@ -55,6 +59,13 @@ public:
    */
   virtual const std::list<std::string>& allowOrigins() const PURE;
 
+  /**
+   * @param origin supplies the origin header value of a request.
+   * @return bool whether allowOrigins() allows the origin. An entry of "*" allows any origin, and
+   *         an entry of the form "*.example.com" allows any origin ending in ".example.com".
+   */
+  virtual bool allowsOrigin(const Http::HeaderString& origin) const PURE;
+
   /**
    * @return std::string access-control-allow-methods value.
    */
@@ -86,6 +97,34 @@ public:
   virtual bool enabled() const PURE;
 };
 
+/**
+ * Route level hedging policy. A hedged request that has not received response headers after
+ * hedgeDelay() gets a second attempt, and takes the first of the two responses. Thread safe, as
+ * it is shared by the requests of all workers.
+ */
+class HedgePolicy {
+public:
+  virtual ~HedgePolicy() {}
+
+  /**
+   * @return std::chrono::milliseconds the delay after which to send a second attempt, or 0 if
+   *         there are not enough response times recorded yet.
+   */
+  virtual std::chrono::milliseconds hedgeDelay() const PURE;
+
+  /**
+   * Record the time an attempt took to receive response headers.
+   * @param time supplies the time since the attempt was sent.
+   */
+  virtual void recordResponseTime(std::chrono::milliseconds time) const PURE;
+
+  /**
+   * Take a second attempt out of the hedging budget.
+   * @return bool whether the budget allows the second attempt.
+   */
+  virtual bool tryHedge() const PURE;
+};
+
 /**
  * Route level retry policy.
  */
@@ -117,6 +156,20 @@ public:
    * @return uint32_t a local OR of RETRY_ON values above.
    */
   virtual uint32_t retryOn() const PURE;
+
+  /**
+   * @return const HedgePolicy* the hedging policy of the route, or nullptr if requests are not
+   *         hedged.
+   */
+  virtual const HedgePolicy* hedgePolicy() const PURE;
+
+  /**
+   * @return uint64_t the largest request body, in bytes, that is kept to replay the request on a
+   *         retry or a hedged attempt. The body is streamed upstream either way, but a request
+   *         whose body goes over this size is no longer retried or hedged. The connection buffer
+   *         limit applies if it is lower.
+   */
+  virtual uint64_t maxReplayBytes() const PURE;
 };
 
 /**
@@ -176,6 +229,12 @@ public:
    *         increments.
    */
   virtual const std::string& runtimeKey() const PURE;
+
+  /**
+   * @return the size in bytes of the largest request body that will be shadowed. The shadow of a
+   *         larger request is dropped once its body goes over this size.
+   */
+  virtual uint64_t maxBodyBytes() const PURE;
 };
 
 /**
@@ -290,6 +349,12 @@ public:
    */
   virtual const std::string& clusterName() const PURE;
 
+  /**
+   * @return const Upstream::ClusterHandle* the resolved cluster named by clusterName(), or nullptr
+   *         if the cluster has to be looked up by name.
+   */
+  virtual const Upstream::ClusterHandle* clusterHandle() const PURE;
+
   /**
    * Returns the HTTP status code to use when configured cluster is not found.
    * @return Http::Code to use when configured cluster is not found.
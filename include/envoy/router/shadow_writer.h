@@ -1,31 +1,66 @@
 #pragma once
 
 #include <chrono>
+#include <cstdint>
 #include <memory>
 #include <string>
 
-#include "envoy/http/message.h"
+#include "envoy/buffer/buffer.h"
+#include "envoy/http/header_map.h"
 
 namespace Envoy {
 namespace Router {
 
 /**
- * Interface used to shadow complete requests to an alternate upstream cluster in a "fire and
- * forget" fashion. Right now this interface takes a fully buffered request and cannot be used for
- * streaming. This is sufficient for current use cases.
+ * Handle to a shadow request that is being streamed along with the request it shadows. Destroying
+ * the handle before the end of the request was sent resets the shadow.
+ */
+class ShadowStream {
+public:
+  virtual ~ShadowStream() {}
+
+  /**
+   * Send request data to the shadow. The slices of the data are shared with the shadow rather than
+   * copied, which makes them read-only, but the caller keeps the data and can still move it.
+   * @param data supplies the data to send.
+   * @param end_stream supplies whether this is the end of the request.
+   * @return false if the shadow is over, because it was dropped or the shadow upstream reset or
+   *         answered it early. Nothing else should be sent to it and the handle can be destroyed.
+   */
+  virtual bool sendData(Buffer::Instance& data, bool end_stream) PURE;
+
+  /**
+   * Send the request trailers to the shadow, which ends the request.
+   * @param trailers supplies the trailers to send. They are copied.
+   */
+  virtual void sendTrailers(const Http::HeaderMap& trailers) PURE;
+};
+
+typedef std::unique_ptr<ShadowStream> ShadowStreamPtr;
+
+/**
+ * Interface used to shadow requests to an alternate upstream cluster in a "fire and forget"
+ * fashion. The shadow is streamed as the request is received, so that the request body does not
+ * need to be buffered, and is dropped rather than slowing down the request it shadows.
  */
 class ShadowWriter {
 public:
   virtual ~ShadowWriter() {}
 
   /**
-   * Shadow a request.
+   * Start shadowing a request.
    * @param cluster supplies the cluster name to shadow to.
-   * @param message supplies the complete request to shadow.
+   * @param headers supplies the request headers. They are copied.
+   * @param end_stream supplies whether the request has no body.
    * @param timeout supplies the shadowed request timeout.
+   * @param max_body_bytes supplies the size of the largest body to shadow. The shadow is dropped
+   *        once the body goes over it.
+   * @return a handle used to stream the rest of the request, or nullptr if the request was
+   *         complete or the shadow could not be started.
    */
-  virtual void shadow(const std::string& cluster, Http::MessagePtr&& request,
-                      std::chrono::milliseconds timeout) PURE;
+  virtual ShadowStreamPtr start(const std::string& cluster, const Http::HeaderMap& headers,
+                                bool end_stream, std::chrono::milliseconds timeout,
+                                uint64_t max_body_bytes) PURE;
 };
 
 typedef std::unique_ptr<ShadowWriter> ShadowWriterPtr;
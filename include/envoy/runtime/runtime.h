@@ -1,9 +1,13 @@
 #pragma once
 
+#include <atomic>
 #include <cstdint>
+#include <deque>
 #include <memory>
+#include <mutex>
 #include <string>
 #include <unordered_map>
+#include <vector>
 
 #include "envoy/common/optional.h"
 #include "envoy/common/pure.h"
@@ -32,6 +36,82 @@ public:
 
 typedef std::unique_ptr<RandomGenerator> RandomGeneratorPtr;
 
+/**
+ * A runtime key that is registered for the life of the process, e.g. as a static of the code that
+ * looks it up on a hot path. Snapshots resolve the keys that are registered when they are loaded to
+ * their entries, so that looking up a Key takes an index into an array rather than hashing its
+ * name. Keys that are registered later are looked up by name until the next snapshot is loaded.
+ * Keys with the same name share their index. The lookups of each key are counted, so that the hot
+ * keys can be found, see Key::lookups().
+ */
+class Key {
+public:
+  explicit Key(const std::string& name) : name_(name) {
+    Registry& registry = Key::registry();
+    std::unique_lock<std::mutex> lock(registry.mutex_);
+    auto it = registry.indexes_.find(name);
+    if (it == registry.indexes_.end()) {
+      it = registry.indexes_.emplace(name, registry.names_.size()).first;
+      registry.names_.push_back(name);
+      registry.lookups_.emplace_back(0);
+    }
+    index_ = it->second;
+    lookups_ = &registry.lookups_[index_];
+  }
+
+  const std::string& name() const { return name_; }
+  size_t index() const { return index_; }
+
+  /**
+   * Count a lookup of the key. This is called by the snapshots.
+   */
+  void countLookup() const { lookups_->fetch_add(1, std::memory_order_relaxed); }
+
+  /**
+   * @return std::vector<std::string> the names of the registered keys, by index.
+   */
+  static std::vector<std::string> registeredNames() {
+    Registry& registry = Key::registry();
+    std::unique_lock<std::mutex> lock(registry.mutex_);
+    return registry.names_;
+  }
+
+  /**
+   * @return std::vector<std::pair<std::string, uint64_t>> the names of the registered keys and the
+   *         number of times they have been looked up, by index.
+   */
+  static std::vector<std::pair<std::string, uint64_t>> lookups() {
+    Registry& registry = Key::registry();
+    std::unique_lock<std::mutex> lock(registry.mutex_);
+    std::vector<std::pair<std::string, uint64_t>> lookups;
+    lookups.reserve(registry.names_.size());
+    for (size_t i = 0; i < registry.names_.size(); i++) {
+      lookups.emplace_back(registry.names_[i],
+                           registry.lookups_[i].load(std::memory_order_relaxed));
+    }
+    return lookups;
+  }
+
+private:
+  struct Registry {
+    std::mutex mutex_;
+    std::unordered_map<std::string, size_t> indexes_;
+    std::vector<std::string> names_;
+    // A deque so that the counters of the keys do not move as keys are registered.
+    std::deque<std::atomic<uint64_t>> lookups_;
+  };
+
+  static Registry& registry() {
+    // Never destroyed, as keys may be statics of other translation units.
+    static Registry* registry = new Registry();
+    return *registry;
+  }
+
+  const std::string name_;
+  size_t index_;
+  std::atomic<uint64_t>* lookups_;
+};
+
 /**
  * A snapshot of runtime data.
  */
@@ -98,6 +178,35 @@ public:
   virtual bool featureEnabled(const std::string& key, uint64_t default_value, uint64_t random_value,
                               uint16_t num_buckets) const PURE;
 
+  /**
+   * Test if a feature is enabled using the built in random generator, see
+   * featureEnabled(const std::string&, uint64_t).
+   * @param key supplies the registered feature key to lookup.
+   * @param default_value supplies the default value that will be used if either the feature key
+   *        does not exist or it is not an integer.
+   * @return true if the feature is enabled.
+   */
+  virtual bool featureEnabled(const Key& key, uint64_t default_value) const {
+    key.countLookup();
+    return featureEnabled(key.name(), default_value);
+  }
+
+  /**
+   * Test if a feature is enabled using a supplied stable random value, see
+   * featureEnabled(const std::string&, uint64_t, uint64_t).
+   * @param key supplies the registered feature key to lookup.
+   * @param default_value supplies the default value that will be used if either the feature key
+   *        does not exist or it is not an integer.
+   * @param random_value supplies the stable random value to use for determining whether the feature
+   *        is enabled.
+   * @return true if the feature is enabled.
+   */
+  virtual bool featureEnabled(const Key& key, uint64_t default_value,
+                              uint64_t random_value) const {
+    key.countLookup();
+    return featureEnabled(key.name(), default_value, random_value);
+  }
+
   /**
    * Fetch raw runtime data based on key.
    * @param key supplies the key to fetch.
@@ -114,11 +223,30 @@ public:
    */
   virtual uint64_t getInteger(const std::string& key, uint64_t default_value) const PURE;
 
+  /**
+   * Fetch an integer registered runtime key.
+   * @param key supplies the registered key to fetch.
+   * @param default_value supplies the value to return if the key does not exist or it does not
+   *        contain an integer.
+   * @return uint64_t the runtime value or the default value.
+   */
+  virtual uint64_t getInteger(const Key& key, uint64_t default_value) const {
+    key.countLookup();
+    return getInteger(key.name(), default_value);
+  }
+
   /**
    * Fetch the raw runtime entries map. The map data is safe only for the lifetime of the Snapshot.
    * @return const std::unordered_map<std::string, const Entry>& the raw map of loaded values.
    */
   virtual const std::unordered_map<std::string, const Entry>& getAll() const PURE;
+
+  /**
+   * @return uint64_t an identifier of the snapshot that changes every time a new snapshot is
+   *         loaded. It can be used to cache values computed from a snapshot and only compute them
+   *         again once the runtime data has changed.
+   */
+  virtual uint64_t version() const PURE;
 };
 
 /**
@@ -11,6 +11,7 @@
 #include "envoy/ratelimit/ratelimit.h"
 #include "envoy/runtime/runtime.h"
 #include "envoy/server/admin.h"
+#include "envoy/server/overload_manager.h"
 #include "envoy/singleton/manager.h"
 #include "envoy/thread_local/thread_local.h"
 #include "envoy/tracing/http_tracer.h"
@@ -80,6 +81,12 @@ public:
    */
   virtual const LocalInfo::LocalInfo& localInfo() PURE;
 
+  /**
+   * @return the server's overload manager. Filters may use it to shed load when the server is
+   *         short of memory.
+   */
+  virtual OverloadManager& overloadManager() PURE;
+
   /**
    * @return RandomGenerator& the random generator for the server.
    */
@@ -234,6 +241,32 @@ public:
    */
   virtual ProtobufTypes::MessagePtr createEmptyConfigProto() { return nullptr; }
 
+  /**
+   * Variant of createFilterFactory(..) used for the first filter of a chain. Besides the factory,
+   * it may create a responder that answers header only requests the filter would answer locally,
+   * which the connection manager then does before creating the filter chain.
+   * @param responder supplies the responder to set. It is left unset by default.
+   */
+  virtual HttpFilterFactoryCb
+  createFilterFactoryWithResponder(const Json::Object& config, const std::string& stat_prefix,
+                                   FactoryContext& context,
+                                   Http::HeaderOnlyResponderSharedPtr& responder) {
+    UNREFERENCED_PARAMETER(responder);
+    return createFilterFactory(config, stat_prefix, context);
+  }
+
+  /**
+   * v2 API variant of createFilterFactoryWithResponder(..).
+   */
+  virtual HttpFilterFactoryCb
+  createFilterFactoryFromProtoWithResponder(const Protobuf::Message& config,
+                                            const std::string& stat_prefix,
+                                            FactoryContext& context,
+                                            Http::HeaderOnlyResponderSharedPtr& responder) {
+    UNREFERENCED_PARAMETER(responder);
+    return createFilterFactoryFromProto(config, stat_prefix, context);
+  }
+
   /**
    * @return std::string the identifying name for a particular implementation of an http filter
    * produced by the factory.
@@ -1,10 +1,12 @@
 #pragma once
 
 #include <cstdint>
+#include <functional>
 #include <string>
 
 #include "envoy/common/pure.h"
 #include "envoy/event/dispatcher.h"
+#include "envoy/ssl/session_cache.h"
 
 namespace Envoy {
 namespace Server {
@@ -27,6 +29,12 @@ public:
     time_t original_start_time_;
   };
 
+  /**
+   * Produces a named section of the state that a process hands over to the process that hot
+   * restarts it. Invoked on the main thread of the parent process.
+   */
+  typedef std::function<std::string()> StateExporter;
+
   virtual ~HotRestart() {}
 
   /**
@@ -39,9 +47,12 @@ public:
    * Retrieve a listening socket on the specified address from the parent process. The socket will
    * be duplicated across process boundaries.
    * @param address supplies the address of the socket to duplicate, e.g. tcp://127.0.0.1:5000.
+   * @param worker_index supplies the index of the worker the socket is for. The parent returns
+   *        the socket of that worker if the listener gives each worker a socket of its own, and
+   *        the socket that all its workers share otherwise.
    * @return int the fd or -1 if there is no bound listen port in the parent.
    */
-  virtual int duplicateParentListenSocket(const std::string& address) PURE;
+  virtual int duplicateParentListenSocket(const std::string& address, uint32_t worker_index) PURE;
 
   /**
    * Retrieve stats from our parent process.
@@ -78,6 +89,29 @@ public:
    * perform a full or hot restart.
    */
   virtual std::string version() PURE;
+
+  /**
+   * @return Ssl::SessionCacheMemory* memory for the TLS session cache that is kept across hot
+   *         restarts, or nullptr if there is none.
+   */
+  virtual Ssl::SessionCacheMemory* sessionCacheMemory() PURE;
+
+  /**
+   * Register a section of state to hand over to a child process. A section registered again
+   * under the same name replaces the previous one.
+   * @param name supplies the name of the section, e.g. "upstream.unhealthy_hosts".
+   * @param exporter supplies the callback that serializes the section when the child asks for it.
+   */
+  virtual void addStateExporter(const std::string& name, StateExporter exporter) PURE;
+
+  /**
+   * Retrieve a section of state from the parent process. The section is transferred over the
+   * hot restart domain socket in as many messages as its size requires.
+   * @param name supplies the name of the section.
+   * @return std::string the section, or an empty string if there is no parent or the parent has
+   *         no section of that name.
+   */
+  virtual std::string getParentState(const std::string& name) PURE;
 };
 
 } // namespace Server
@@ -2,9 +2,11 @@
 
 #include "envoy/network/filter.h"
 #include "envoy/network/listen_socket.h"
+#include "envoy/network/listener.h"
 #include "envoy/server/drain_manager.h"
 #include "envoy/server/filter_config.h"
 #include "envoy/server/guarddog.h"
+#include "envoy/server/worker.h"
 #include "envoy/ssl/context.h"
 
 #include "common/protobuf/protobuf.h"
@@ -30,6 +32,18 @@ public:
   virtual Network::ListenSocketSharedPtr
   createListenSocket(Network::Address::InstanceConstSharedPtr address, bool bind_to_port) PURE;
 
+  /**
+   * Creates one of the sockets of a listener that gives each worker a socket of its own. The
+   * sockets have SO_REUSEPORT set, so that they all bind to the address and the kernel balances
+   * the connections across them.
+   * @param address supplies the socket's address.
+   * @param worker_index supplies the index of the worker that listens on the socket.
+   * @return Network::ListenSocketSharedPtr an initialized and bound socket.
+   */
+  virtual Network::ListenSocketSharedPtr
+  createReusePortListenSocket(Network::Address::InstanceConstSharedPtr address,
+                              uint32_t worker_index) PURE;
+
   /**
    * Creates a list of filter factories.
    * @param filters supplies the proto configuration.
@@ -71,6 +85,21 @@ public:
    */
   virtual Network::ListenSocket& socket() PURE;
 
+  /**
+   * @param worker_index supplies the index of a worker.
+   * @return Network::ListenSocket* the socket the worker accepts connections on. This is socket()
+   *         unless the listener gives each worker a socket of its own, in which case it is nullptr
+   *         for workers the listener has no socket for.
+   */
+  virtual Network::ListenSocket* workerSocket(uint32_t worker_index) PURE;
+
+  /**
+   * @return Network::ConnectionBalancer* the balancer that hands the connections accepted by a
+   *         worker over to the worker with the fewest connections, or nullptr if the connections
+   *         stay on the worker that accepted them.
+   */
+  virtual Network::ConnectionBalancer* connectionBalancer() PURE;
+
   /**
    * @return Ssl::ServerContext* the default SSL context.
    */
@@ -101,6 +130,12 @@ public:
    */
   virtual uint32_t perConnectionBufferLimitBytes() PURE;
 
+  /**
+   * @return uint32_t the maximum number of connections a worker accepts each time the listen socket
+   *         is ready, or 0 for the default.
+   */
+  virtual uint32_t acceptBatchSize() PURE;
+
   /**
    * @return Stats::Scope& the stats scope to use for all listener specific stats.
    */
@@ -153,6 +188,12 @@ public:
    */
   virtual uint64_t numConnections() PURE;
 
+  /**
+   * @return std::vector<WorkerLoad> a snapshot of the load of each worker, in the order of their
+   *         indexes.
+   */
+  virtual std::vector<WorkerLoad> workerLoads() PURE;
+
   /**
    * Remove a listener by name.
    * @param name supplies the listener name to remove.
@@ -3,8 +3,10 @@
 #include <chrono>
 #include <cstdint>
 #include <string>
+#include <vector>
 
 #include "envoy/common/pure.h"
+#include "envoy/filesystem/filesystem.h"
 #include "envoy/network/address.h"
 
 #include "spdlog/spdlog.h"
@@ -112,6 +114,12 @@ public:
    */
   virtual std::chrono::milliseconds fileFlushIntervalMsec() PURE;
 
+  /**
+   * @return Filesystem::OverflowPolicy what a write to a log file does when the buffer that the
+   *         writing thread has for the file is full.
+   */
+  virtual Filesystem::OverflowPolicy fileWriteOverflowPolicy() PURE;
+
   /**
    * @return const std::string& the server's cluster.
    */
@@ -137,6 +145,103 @@ public:
    * router/cluster/listener.
    */
   virtual uint64_t maxObjNameLength() PURE;
+
+  /**
+   * @return uint64_t the maximum number of bytes of free buffer memory each thread's slice pool
+   *         retains for reuse.
+   */
+  virtual uint64_t bufferPoolMaxRetainedBytes() PURE;
+
+  /**
+   * @return const std::vector<std::string>& the names of the counters that are sharded across the
+   *         threads that increment them. @see Stats::StoreRoot::setShardedCounters().
+   */
+  virtual const std::vector<std::string>& shardedCounters() PURE;
+
+  /**
+   * @return uint64_t the number of TLS sessions that the session cache shared by the workers and
+   *         the processes of a hot restart holds, or 0 if each server context caches its sessions
+   *         itself.
+   */
+  virtual uint64_t sslSessionCacheSize() PURE;
+
+  /**
+   * @return std::chrono::seconds how long the shared session cache keeps TLS sessions for.
+   */
+  virtual std::chrono::seconds sslSessionCacheTimeout() PURE;
+
+  /**
+   * @return uint32_t the number of threads that run the private key operations of the TLS
+   *         handshakes of the listeners, or 0 if the workers run them.
+   */
+  virtual uint32_t sslPrivateKeyThreads() PURE;
+
+  /**
+   * @return bool whether the TLS contexts of the listener filter chains load their certificates
+   *         and private keys on their first handshake rather than when the listener is created.
+   */
+  virtual bool sslLazyCertificates() PURE;
+
+  /**
+   * @return bool whether the workers record histograms of the iterations of their event loops.
+   */
+  virtual bool workerLoopStats() PURE;
+
+  /**
+   * @return std::chrono::microseconds how long a batch of the posted callbacks or deferred
+   *         deletions of a worker runs for before the rest wait for the next iteration of its
+   *         event loop, or 0 for no limit. @see Event::Dispatcher::setCallbackBudget().
+   */
+  virtual std::chrono::microseconds workerCallbackBudget() PURE;
+
+  /**
+   * @return bool whether the workers poll their connections with io_uring where the kernel
+   *         supports it. @see Event::Dispatcher::enableIoUring().
+   */
+  virtual bool workerIoUring() PURE;
+
+  /**
+   * @return const std::vector<uint32_t>& the CPUs that the workers are pinned to, worker i to
+   *         CPU i modulo their number, or empty to leave the workers unpinned.
+   */
+  virtual const std::vector<uint32_t>& workerCpuSet() PURE;
+
+  /**
+   * @return bool whether the workers allocate their memory from the NUMA node of the CPU they
+   *         run on.
+   */
+  virtual bool workerNumaLocalMemory() PURE;
+
+  /**
+   * @return bool whether the names of clusters are resolved on a dedicated thread.
+   */
+  virtual bool dnsThread() PURE;
+
+  /**
+   * @return uint32_t the number of DNS queries that the DNS thread resolves at once before
+   *         further queries wait, or 0 for no limit. Only applies with dnsThread().
+   */
+  virtual uint32_t dnsMaxConcurrentQueries() PURE;
+
+  /**
+   * @return const std::string& the path of the JSON file with the local rate limits that are
+   *         checked before the rate limit service, or empty for none.
+   *         @see RateLimit::LocalRateLimiter.
+   */
+  virtual const std::string& rateLimitLocalConfigPath() PURE;
+
+  /**
+   * @return std::chrono::seconds the length of the windows of the continuous CPU profile, or 0 if
+   *         the CPU is not profiled continuously.
+   */
+  virtual std::chrono::seconds cpuProfileWindow() PURE;
+
+  /**
+   * @return const std::string& the path of the file with the content hashes of the configs that
+   *         passed --mode validate, or empty for none. Validate mode records the hash of a valid
+   *         config there, and serve mode skips JSON schema validation for a config it finds there.
+   */
+  virtual const std::string& validatedConfigCachePath() PURE;
 };
 
 } // namespace Server
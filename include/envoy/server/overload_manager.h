@@ -0,0 +1,43 @@
+#pragma once
+
+#include "envoy/common/pure.h"
+
+namespace Envoy {
+namespace Server {
+
+/**
+ * Actions the server takes, in increasing order of severity, as memory usage approaches its
+ * configured limit.
+ */
+enum class OverloadAction {
+  // Close HTTP connections after the response in flight, rather than keeping them alive.
+  DisableHttpKeepAlive,
+  // Stop accepting new downstream connections. Connections that are accepted are closed at once.
+  StopAcceptingConnections,
+  // Reject new HTTP requests with a 503 response.
+  StopAcceptingRequests,
+};
+
+/**
+ * The OverloadManager periodically samples memory usage on the main thread and activates or
+ * deactivates OverloadActions as the usage crosses their thresholds. The other components of the
+ * server query it in order to shed load.
+ */
+class OverloadManager {
+public:
+  virtual ~OverloadManager() {}
+
+  /**
+   * Start sampling memory usage. Called once the server's runtime and dispatcher are ready.
+   */
+  virtual void start() PURE;
+
+  /**
+   * @param action supplies the action to look up.
+   * @return bool whether the action is currently active. This may be called from any thread.
+   */
+  virtual bool isActive(OverloadAction action) const PURE;
+};
+
+} // namespace Server
+} // namespace Envoy
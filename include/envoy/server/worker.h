@@ -1,12 +1,39 @@
 #pragma once
 
+#include <chrono>
+#include <cstdint>
 #include <functional>
 
+#include "envoy/common/time.h"
 #include "envoy/server/guarddog.h"
 
 namespace Envoy {
 namespace Server {
 
+class Listener;
+
+/**
+ * Snapshot of the load of a worker, @see Worker::load().
+ */
+struct WorkerLoad {
+  // The connections across all listeners that the worker owns.
+  uint64_t connections_{};
+  // The HTTP requests that are in flight on the worker, and that it received since it started.
+  uint64_t active_requests_{};
+  uint64_t requests_total_{};
+  // The bytes that the connections of the worker read and wrote since it started.
+  uint64_t rx_bytes_{};
+  uint64_t tx_bytes_{};
+  // Whether the worker tracks how long its event loop runs callbacks for, which it only does when
+  // it records the histograms of its event loop, and for how long it did since it started.
+  bool busy_tracked_{};
+  std::chrono::microseconds busy_time_{};
+  // The functors posted to the worker that have not run yet.
+  uint64_t pending_posts_{};
+  // When the worker started, or the epoch if it did not yet.
+  MonotonicTime started_;
+};
+
 /**
  * Interface for a threaded connection handling worker. All routines are thread safe.
  */
@@ -35,6 +62,12 @@ public:
    */
   virtual uint64_t numConnections() PURE;
 
+  /**
+   * @return WorkerLoad a snapshot of the load of the worker. The counters are updated by the worker
+   *         thread without synchronization, so they are only consistent with each other roughly.
+   */
+  virtual WorkerLoad load() PURE;
+
   /**
    * Start the worker thread.
    * @param guard_dog supplies the guard dog to use for thread watching.
@@ -80,9 +113,11 @@ public:
   virtual ~WorkerFactory() {}
 
   /**
+   * @param index supplies the index of the worker among the workers of the server, which selects
+   *        its socket of the listeners that give each worker a socket of its own.
    * @return WorkerPtr a new worker.
    */
-  virtual WorkerPtr createWorker() PURE;
+  virtual WorkerPtr createWorker(uint32_t index) PURE;
 };
 
 } // namespace Server
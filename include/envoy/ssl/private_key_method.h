@@ -0,0 +1,64 @@
+#pragma once
+
+#include <memory>
+
+#include "envoy/common/pure.h"
+#include "envoy/event/dispatcher.h"
+
+#include "openssl/ssl.h"
+
+namespace Envoy {
+namespace Ssl {
+
+/**
+ * Callbacks of the connections whose private key operations are asynchronous.
+ */
+class PrivateKeyConnectionCallbacks {
+public:
+  virtual ~PrivateKeyConnectionCallbacks() {}
+
+  /**
+   * Called on the thread of the connection when its pending private key operation completed, so
+   * that the handshake is resumed.
+   */
+  virtual void onPrivateKeyMethodComplete() PURE;
+};
+
+/**
+ * Provider of a BoringSSL private key method that signs and decrypts off the thread of the
+ * connections, such as on a thread pool or a hardware accelerator. The server contexts use the
+ * method instead of the private key they load, which is still available to the method through
+ * SSL_get_privatekey().
+ */
+class PrivateKeyMethodProvider {
+public:
+  virtual ~PrivateKeyMethodProvider() {}
+
+  /**
+   * Register a connection, before its handshake starts. The operations of the connection are
+   * completed on its dispatcher.
+   * @param ssl supplies the connection.
+   * @param callbacks supplies the callbacks of the connection, which must stay valid until the
+   *        connection is unregistered.
+   * @param dispatcher supplies the dispatcher of the thread of the connection.
+   */
+  virtual void registerPrivateKeyMethod(SSL* ssl, PrivateKeyConnectionCallbacks& callbacks,
+                                        Event::Dispatcher& dispatcher) PURE;
+
+  /**
+   * Unregister a connection, cancelling its pending operation if any. Must be called on the
+   * thread of the connection.
+   * @param ssl supplies the connection.
+   */
+  virtual void unregisterPrivateKeyMethod(SSL* ssl) PURE;
+
+  /**
+   * @return const SSL_PRIVATE_KEY_METHOD* the method that the server contexts use.
+   */
+  virtual const SSL_PRIVATE_KEY_METHOD* getBoringSslPrivateKeyMethod() PURE;
+};
+
+typedef std::unique_ptr<PrivateKeyMethodProvider> PrivateKeyMethodProviderPtr;
+
+} // namespace Ssl
+} // namespace Envoy
@@ -0,0 +1,79 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <string>
+
+#include "envoy/common/pure.h"
+#include "envoy/thread/thread.h"
+
+namespace Envoy {
+namespace Ssl {
+
+/**
+ * Cache of the TLS sessions of the server contexts, which clients resume by session ID. It is
+ * shared by all the server contexts, and used from all the workers.
+ */
+class SessionCache {
+public:
+  virtual ~SessionCache() {}
+
+  /**
+   * Store a session, replacing any session with the same ID.
+   * @param id supplies the session ID.
+   * @param session supplies the serialized session.
+   */
+  virtual void insert(const std::string& id, const std::string& session) PURE;
+
+  /**
+   * Find a session that was not removed and did not expire.
+   * @param id supplies the session ID.
+   * @param session receives the serialized session if it is found.
+   * @return bool whether the session was found.
+   */
+  virtual bool lookup(const std::string& id, std::string& session) PURE;
+
+  /**
+   * Remove a session, if it is in the cache.
+   * @param id supplies the session ID.
+   */
+  virtual void remove(const std::string& id) PURE;
+};
+
+typedef std::unique_ptr<SessionCache> SessionCachePtr;
+
+/**
+ * Memory that a session cache stores its sessions in, which may be shared by the processes of a
+ * hot restart. It is split into shards of fixed size slots, each shard with a lock of its own.
+ */
+class SessionCacheMemory {
+public:
+  virtual ~SessionCacheMemory() {}
+
+  /**
+   * @return uint32_t the number of shards.
+   */
+  virtual uint32_t numShards() PURE;
+
+  /**
+   * @return uint32_t the number of slots of each shard.
+   */
+  virtual uint32_t slotsPerShard() PURE;
+
+  /**
+   * @param index supplies the index of a shard.
+   * @return uint8_t* the slots of the shard, which are zeroed when the memory is created.
+   */
+  virtual uint8_t* shard(uint32_t index) PURE;
+
+  /**
+   * @param index supplies the index of a shard.
+   * @return Thread::BasicLockable& the lock that guards the slots of the shard.
+   */
+  virtual Thread::BasicLockable& lock(uint32_t index) PURE;
+};
+
+typedef std::unique_ptr<SessionCacheMemory> SessionCacheMemoryPtr;
+
+} // namespace Ssl
+} // namespace Envoy
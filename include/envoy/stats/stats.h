@@ -28,6 +28,20 @@ struct Tag {
   std::string value_;
 };
 
+/**
+ * The stats held by a scope of a store.
+ */
+struct ScopeStatsInfo {
+  std::string prefix_;
+  // The number of counters, gauges and histograms of the scope.
+  uint64_t num_stats_;
+  // The number of counters and gauges of the scope that were allocated on the heap because the
+  // allocator of the store was out of space.
+  uint64_t num_overflow_stats_;
+  // The total length of the names of the stats of the scope.
+  uint64_t name_bytes_;
+};
+
 /**
  * Class to extract tags from the stat names.
  */
@@ -135,6 +149,73 @@ public:
 
 typedef std::shared_ptr<Histogram> HistogramSharedPtr;
 
+/**
+ * The statistics of the values recorded by a histogram over a period of time.
+ */
+class HistogramStatistics {
+public:
+  virtual ~HistogramStatistics() {}
+
+  /**
+   * @return the quantiles the statistics are computed for, as fractions between 0 and 1.
+   */
+  virtual const std::vector<double>& supportedQuantiles() const PURE;
+
+  /**
+   * @return the value at each of the supported quantiles, in the same order. The values are NaN if
+   *         no values were recorded.
+   */
+  virtual const std::vector<double>& computedQuantiles() const PURE;
+
+  /**
+   * @return uint64_t the number of values recorded.
+   */
+  virtual uint64_t sampleCount() const PURE;
+
+  /**
+   * @return uint64_t the sum of the values recorded.
+   */
+  virtual uint64_t sampleSum() const PURE;
+};
+
+/**
+ * A histogram that aggregates the values recorded by all threads. The values recorded since the
+ * last merge() are not reflected in the statistics.
+ */
+class ParentHistogram : public Histogram {
+public:
+  virtual ~ParentHistogram() {}
+
+  /**
+   * Merge the values recorded by all threads since the previous merge. This is called on the main
+   * thread when stats are flushed.
+   */
+  virtual void merge() PURE;
+
+  /**
+   * @return the statistics of the values recorded between the last two merges.
+   */
+  virtual const HistogramStatistics& intervalStatistics() const PURE;
+
+  /**
+   * @return the statistics of all the values recorded up to the last merge.
+   */
+  virtual const HistogramStatistics& cumulativeStatistics() const PURE;
+
+  /**
+   * @return bool whether any values were recorded up to the last merge.
+   */
+  virtual bool used() const PURE;
+
+  /**
+   * @return std::string the interval and cumulative values of each supported quantile, e.g.
+   *         "P0(1,1) P25(2.5,3) ...".
+   */
+  virtual std::string summary() const PURE;
+};
+
+typedef std::shared_ptr<ParentHistogram> ParentHistogramSharedPtr;
+
 /**
  * A sink for stats. Each sink is responsible for writing stats to a backing store.
  */
@@ -143,8 +224,8 @@ public:
   virtual ~Sink() {}
 
   /**
-   * This will be called before a sequence of flushCounter() and flushGauge() calls. Sinks can
-   * choose to optimize writing if desired with a paired endFlush() call.
+   * This will be called before a sequence of flushCounter(), flushGauge() and flushHistogram()
+   * calls. Sinks can choose to optimize writing if desired with a paired endFlush() call.
    */
   virtual void beginFlush() PURE;
 
@@ -164,6 +245,12 @@ public:
    */
   virtual void endFlush() PURE;
 
+  /**
+   * Flush the statistics of a histogram that had values recorded. Called between beginFlush() and
+   * endFlush(), after the histogram is merged.
+   */
+  virtual void flushHistogram(const ParentHistogram& histogram) PURE;
+
   /**
    * Flush a histogram value.
    */
@@ -226,6 +313,23 @@ public:
    * @return a list of all known gauges.
    */
   virtual std::list<GaugeSharedPtr> gauges() const PURE;
+
+  /**
+   * @return a list of all known histograms that aggregate their values.
+   */
+  virtual std::list<ParentHistogramSharedPtr> histograms() const PURE;
+
+  /**
+   * @return the stats held by each scope of the store that keeps stats of its own. Overlapping
+   *         scopes are listed separately, with the stats each of them has created.
+   */
+  virtual std::list<ScopeStatsInfo> scopes() const PURE;
+
+  /**
+   * @return the number of stats created by the store since it was created, including those of the
+   *         scopes that were destroyed since.
+   */
+  virtual uint64_t numStatsCreated() const PURE;
 };
 
 typedef std::unique_ptr<Store> StorePtr;
@@ -245,6 +349,13 @@ public:
    */
   virtual void setTagExtractors(const std::vector<TagExtractorPtr>& tag_extractor) PURE;
 
+  /**
+   * Set the names of the counters that are sharded across the threads that increment them. A
+   * counter is sharded if its name is one of the names, or ends with '.' followed by one of them.
+   * This only applies to the counters created afterwards.
+   */
+  virtual void setShardedCounters(const std::vector<std::string>& names) PURE;
+
   /**
    * Initialize the store for threading. This will be called once after all worker threads have
    * been initialized. At this point the store can initialize itself for multi-threaded operation.
@@ -257,6 +368,12 @@ public:
    * down.
    */
   virtual void shutdownThreading() PURE;
+
+  /**
+   * Called after the stats of the store were flushed to the sinks, so that the store can release
+   * the stats it kept around for the flush.
+   */
+  virtual void onStatsFlushed() PURE;
 };
 
 typedef std::unique_ptr<StoreRoot> StoreRootPtr;
@@ -29,7 +29,8 @@ public:
   virtual ~Slot() {}
 
   /**
-   * @return ThreadLocalObjectSharedPtr a thread local object stored in the slot.
+   * @return ThreadLocalObjectSharedPtr a thread local object stored in the slot, or nullptr if the
+   *         calling thread is not registered.
    */
   virtual ThreadLocalObjectSharedPtr get() PURE;
 
@@ -104,6 +105,27 @@ public:
    * @return Event::Dispatcher& the thread local dispatcher.
    */
   virtual Event::Dispatcher& dispatcher() PURE;
+
+  /**
+   * Hold back the updates that Slot::runOnAllThreads() and Slot::set() post to the registered
+   * threads until the batch ends, and then post each thread a single callback that applies all of
+   * them in order. A config update that touches many slots thus wakes each thread once, and no
+   * thread sees only part of it. The main thread still applies each update immediately. Batches
+   * may nest, the updates being posted when the outermost one ends. Must be called on the main
+   * thread, and be paired with endBatch().
+   */
+  virtual void beginBatch() PURE;
+
+  /**
+   * Post the updates held back by the open batch so far, which stays open. Used before posting
+   * work to the registered threads outside of the slots that depends on the updates.
+   */
+  virtual void flushBatch() PURE;
+
+  /**
+   * End a batch started with beginBatch().
+   */
+  virtual void endBatch() PURE;
 };
 
 } // namespace ThreadLocal
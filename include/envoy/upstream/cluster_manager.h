@@ -5,6 +5,7 @@
 #include <memory>
 #include <string>
 #include <unordered_map>
+#include <vector>
 
 #include "envoy/access_log/access_log.h"
 #include "envoy/config/grpc_mux.h"
@@ -40,6 +41,15 @@ public:
    */
   virtual bool addOrUpdatePrimaryCluster(const envoy::api::v2::Cluster& cluster) PURE;
 
+  /**
+   * Prepare a batch of clusters about to be passed to addOrUpdatePrimaryCluster(). The part of
+   * their construction that does not need the main thread (config parsing, stats scopes, TLS
+   * contexts) runs in parallel, rather than one cluster at a time in addOrUpdatePrimaryCluster().
+   * Calling it is optional and does not change the outcome of the updates that follow.
+   * @param clusters supplies the configs of the clusters.
+   */
+  virtual void prepareClusters(const std::vector<const envoy::api::v2::Cluster*>& clusters) PURE;
+
   /**
    * Set a callback that will be invoked when all owned clusters have been initialized.
    */
@@ -65,6 +75,13 @@ public:
    */
   virtual ThreadLocalCluster* get(const std::string& cluster) PURE;
 
+  /**
+   * Resolve a cluster name to a handle that finds the thread local cluster faster than get().
+   * The cluster does not need to exist yet. This must be called on the main thread, and the
+   * handle must not outlive the cluster manager.
+   */
+  virtual ClusterHandlePtr clusterHandle(const std::string& cluster) PURE;
+
   /**
    * Allocate a load balanced HTTP connection pool for a cluster. This is *per-thread* so that
    * callers do not need to worry about per thread synchronization. The load balancing policy that
@@ -84,7 +101,9 @@ public:
    * load balancing policy that is used is the one defined on the cluster when it was created.
    *
    * Returns both a connection and the host that backs the connection. Both can be nullptr if there
-   * is no host available in the cluster.
+   * is no host available in the cluster. The connection may have been established ahead of time
+   * (see ClusterInfo::tcpPreconnectPerHost()), in which case preconnected_ is set and it must not
+   * be connected again.
    */
   virtual Host::CreateConnectionData tcpConnForCluster(const std::string& cluster,
                                                        LoadBalancerContext* context) PURE;
@@ -105,6 +124,16 @@ public:
    */
   virtual bool removePrimaryCluster(const std::string& cluster) PURE;
 
+  /**
+   * Hand the hosts that a previous process found unhealthy over to the health checker of a primary
+   * cluster, see HealthChecker::inheritUnhealthyHosts(). Does nothing if the cluster does not exist
+   * or is not health checked.
+   * @param cluster supplies the cluster name.
+   * @param addresses supplies the addresses of the hosts.
+   */
+  virtual void inheritUnhealthyHosts(const std::string& cluster,
+                                     const std::vector<std::string>& addresses) PURE;
+
   /**
    * Shutdown the cluster manager prior to destroying connection pools and other thread local data.
    */
@@ -210,6 +239,18 @@ public:
                                             Outlier::EventLoggerSharedPtr outlier_event_logger,
                                             bool added_via_api) PURE;
 
+  /**
+   * Build ahead of time, in parallel, the parts of a batch of clusters that clusterFromProto()
+   * would otherwise build one at a time on the main thread. A cluster that is not prepared, or
+   * whose preparation failed, is built entirely by clusterFromProto(). A new batch replaces the
+   * clusters of the previous one that clusterFromProto() did not use.
+   * @param clusters supplies the configs of the clusters.
+   * @param cm supplies the cluster manager the clusters are for.
+   * @param added_via_api supplies whether the clusters are added via API.
+   */
+  virtual void prepareClusters(const std::vector<const envoy::api::v2::Cluster*>& clusters,
+                               ClusterManager& cm, bool added_via_api) PURE;
+
   /**
    * Create a CDS API provider from configuration proto.
    */
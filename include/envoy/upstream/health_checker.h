@@ -2,6 +2,8 @@
 
 #include <functional>
 #include <memory>
+#include <string>
+#include <vector>
 
 #include "envoy/upstream/upstream.h"
 
@@ -34,6 +36,14 @@ public:
    * Start cyclic health checking based on the provided settings and the type of health checker.
    */
   virtual void start() PURE;
+
+  /**
+   * Inherit the hosts that a previous process found unhealthy, e.g. the parent of a hot restart.
+   * Until its first check completes, a listed host needs the healthy threshold of successful
+   * checks to become healthy, like a host that has failed a check, rather than a single one.
+   * @param addresses supplies the addresses of the hosts, as Address::Instance::asString().
+   */
+  virtual void inheritUnhealthyHosts(const std::vector<std::string>& addresses) PURE;
 };
 
 typedef std::shared_ptr<HealthChecker> HealthCheckerSharedPtr;
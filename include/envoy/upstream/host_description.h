@@ -1,5 +1,6 @@
 #pragma once
 
+#include <chrono>
 #include <memory>
 #include <string>
 
@@ -94,6 +95,19 @@ public:
    *         unknown.
    */
   virtual const envoy::api::v2::Locality& locality() const PURE;
+
+  /**
+   * Record the response time of a request to the host. Thread safe.
+   * @param time supplies the time from the end of the downstream request to the end of the
+   *        upstream response.
+   */
+  virtual void putResponseTime(std::chrono::milliseconds time) const PURE;
+
+  /**
+   * @return double the estimate of the response time of the host in milliseconds, derived from
+   *         the recorded response times, or 0 if none have been recorded. Thread safe.
+   */
+  virtual double responseTimeEstimate() const PURE;
 };
 
 typedef std::shared_ptr<const HostDescription> HostDescriptionConstSharedPtr;
@@ -81,6 +81,13 @@ public:
    *         or the cluster did not have enough hosts to run through success rate outlier ejection.
    */
   virtual double successRate() const PURE;
+
+  /**
+   * @return the response time of the host at the latency percentile of the outlier detection in
+   *         the last calculated interval, in milliseconds. -1 means that the host did not have
+   *         enough request volume to calculate it or latency outlier ejection is not enabled.
+   */
+  virtual double latency() const PURE;
 };
 
 typedef std::unique_ptr<DetectorHostMonitor> DetectorHostMonitorPtr;
@@ -119,11 +126,19 @@ public:
    *         proceed with success rate based outlier ejection.
    */
   virtual double successRateEjectionThreshold() const PURE;
+
+  /**
+   * Returns the latency threshold used in the last interval. The threshold is used to eject hosts
+   * based on their latency.
+   * @return the threshold in milliseconds, or -1 if there were not enough hosts with enough
+   *         request volume to proceed with latency based outlier ejection.
+   */
+  virtual double latencyEjectionThreshold() const PURE;
 };
 
 typedef std::shared_ptr<Detector> DetectorSharedPtr;
 
-enum class EjectionType { Consecutive5xx, SuccessRate, ConsecutiveGatewayFailure };
+enum class EjectionType { Consecutive5xx, SuccessRate, ConsecutiveGatewayFailure, Latency };
 
 /**
  * Sink for outlier detection event logs.
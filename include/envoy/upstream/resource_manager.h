@@ -70,9 +70,15 @@ public:
   virtual Resource& requests() PURE;
 
   /**
-   * @return Resource& active retries.
+   * @return Resource& active retries. When a retry budget is enabled its maximum follows the number
+   *         of active requests.
    */
   virtual Resource& retries() PURE;
+
+  /**
+   * @return whether active retries are bounded by a retry budget rather than a fixed maximum.
+   */
+  virtual bool retryBudgetEnabled() PURE;
 };
 
 } // namespace Upstream
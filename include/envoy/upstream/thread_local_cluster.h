@@ -1,5 +1,11 @@
 #pragma once
 
+#include <memory>
+
+#include "envoy/http/conn_pool.h"
+#include "envoy/upstream/load_balancer.h"
+#include "envoy/upstream/upstream.h"
+
 namespace Envoy {
 namespace Upstream {
 
@@ -29,7 +35,35 @@ public:
    * @return LoadBalancer& the backing load balancer.
    */
   virtual LoadBalancer& loadBalancer() PURE;
+
+  /**
+   * Allocate a load balanced HTTP connection pool for the cluster. This is the same as
+   * ClusterManager::httpConnPoolForCluster() without looking the cluster up by name.
+   *
+   * Can return nullptr if there is no host available in the cluster.
+   */
+  virtual Http::ConnectionPool::Instance* httpConnPool(ResourcePriority priority,
+                                                       Http::Protocol protocol,
+                                                       LoadBalancerContext* context) PURE;
+};
+
+/**
+ * A cluster name resolved ahead of time by ClusterManager::clusterHandle(). It finds the thread
+ * local cluster of the calling thread by index rather than by name, and stays valid across
+ * updates and removals of the cluster.
+ */
+class ClusterHandle {
+public:
+  virtual ~ClusterHandle() {}
+
+  /**
+   * @return ThreadLocalCluster* the thread local cluster or nullptr if it does not currently
+   *         exist. The pointer is subject to the same restrictions as ClusterManager::get().
+   */
+  virtual ThreadLocalCluster* get() const PURE;
 };
 
+typedef std::unique_ptr<ClusterHandle> ClusterHandlePtr;
+
 } // namespace Upstream
 } // namespace Envoy
@@ -11,6 +11,7 @@
 #include "envoy/common/callback.h"
 #include "envoy/common/optional.h"
 #include "envoy/http/codec.h"
+#include "envoy/http/codes.h"
 #include "envoy/network/connection.h"
 #include "envoy/network/transport_socket.h"
 #include "envoy/ssl/context.h"
@@ -32,6 +33,9 @@ public:
   struct CreateConnectionData {
     Network::ClientConnectionPtr connection_;
     HostDescriptionConstSharedPtr host_description_;
+    // Whether the connection was established ahead of time, in which case it is already connected
+    // and connect() must not be called on it.
+    bool preconnected_{};
   };
 
   enum class HealthFlag {
@@ -160,7 +164,29 @@ public:
   virtual const std::vector<std::vector<HostSharedPtr>>& healthyHostsPerLocality() const PURE;
 
   /**
-   * Updates the hosts in a given host set.
+   * The lists below are immutable: an update replaces them rather than modifying them in place, so
+   * they can be shared with other threads without a copy.
+   * @return HostVectorConstSharedPtr the list returned by hosts().
+   */
+  virtual HostVectorConstSharedPtr hostsPtr() const PURE;
+
+  /**
+   * @return HostVectorConstSharedPtr the list returned by healthyHosts().
+   */
+  virtual HostVectorConstSharedPtr healthyHostsPtr() const PURE;
+
+  /**
+   * @return HostListsConstSharedPtr the lists returned by hostsPerLocality().
+   */
+  virtual HostListsConstSharedPtr hostsPerLocalityPtr() const PURE;
+
+  /**
+   * @return HostListsConstSharedPtr the lists returned by healthyHostsPerLocality().
+   */
+  virtual HostListsConstSharedPtr healthyHostsPerLocalityPtr() const PURE;
+
+  /**
+   * Updates the hosts in a given host set. The lists must not be modified after the call.
    *
    * @param hosts supplies the (usually new) list of hosts in the host set.
    * @param healthy hosts supplies the subset of hosts which are healthy.
@@ -226,6 +252,7 @@ public:
   COUNTER  (lb_healthy_panic)                                                                      \
   COUNTER  (lb_local_cluster_not_ok)                                                               \
   COUNTER  (lb_recalculate_zone_structures)                                                        \
+  HISTOGRAM(lb_rebuild_ms)                                                                         \
   COUNTER  (lb_zone_cluster_too_small)                                                             \
   COUNTER  (lb_zone_no_capacity_left)                                                              \
   COUNTER  (lb_zone_number_differs)                                                                \
@@ -241,6 +268,9 @@ public:
   GAUGE    (upstream_cx_active)                                                                    \
   COUNTER  (upstream_cx_http1_total)                                                               \
   COUNTER  (upstream_cx_http2_total)                                                               \
+  COUNTER  (upstream_cx_prefetch)                                                                  \
+  COUNTER  (upstream_cx_preconnect_claimed)                                                        \
+  COUNTER  (upstream_cx_preconnect_expired)                                                        \
   COUNTER  (upstream_cx_connect_fail)                                                              \
   COUNTER  (upstream_cx_connect_timeout)                                                           \
   COUNTER  (upstream_cx_connect_attempts_exceeded)                                                 \
@@ -260,6 +290,7 @@ public:
   GAUGE    (upstream_cx_tx_bytes_buffered)                                                         \
   COUNTER  (upstream_cx_protocol_error)                                                            \
   COUNTER  (upstream_cx_max_requests)                                                              \
+  COUNTER  (upstream_cx_idle_timeout)                                                              \
   COUNTER  (upstream_cx_none_healthy)                                                              \
   COUNTER  (upstream_rq_total)                                                                     \
   GAUGE    (upstream_rq_active)                                                                    \
@@ -267,6 +298,8 @@ public:
   COUNTER  (upstream_rq_pending_overflow)                                                          \
   COUNTER  (upstream_rq_pending_failure_eject)                                                     \
   GAUGE    (upstream_rq_pending_active)                                                            \
+  HISTOGRAM(upstream_rq_pending_default_ms)                                                        \
+  HISTOGRAM(upstream_rq_pending_high_ms)                                                           \
   COUNTER  (upstream_rq_cancelled)                                                                 \
   COUNTER  (upstream_rq_maintenance_mode)                                                          \
   COUNTER  (upstream_rq_timeout)                                                                   \
@@ -276,6 +309,8 @@ public:
   COUNTER  (upstream_rq_retry)                                                                     \
   COUNTER  (upstream_rq_retry_success)                                                             \
   COUNTER  (upstream_rq_retry_overflow)                                                            \
+  COUNTER  (upstream_rq_retry_budget_exhausted)                                                    \
+  COUNTER  (upstream_rq_shadow_dropped)                                                            \
   COUNTER  (upstream_flow_control_paused_reading_total)                                            \
   COUNTER  (upstream_flow_control_resumed_reading_total)                                           \
   COUNTER  (upstream_flow_control_backed_up_total)                                                 \
@@ -290,6 +325,7 @@ public:
   COUNTER  (update_success)                                                                        \
   COUNTER  (update_failure)                                                                        \
   COUNTER  (update_empty)                                                                          \
+  COUNTER  (update_merged)                                                                         \
   GAUGE    (version)
 // clang-format on
 
@@ -348,6 +384,11 @@ public:
    */
   virtual uint32_t perConnectionBufferLimitBytes() const PURE;
 
+  /**
+   * @return bool whether the connections to the hosts of the cluster use TCP Fast Open.
+   */
+  virtual bool tcpFastOpen() const PURE;
+
   /**
    * @return uint64_t features supported by the cluster. @see Features.
    */
@@ -359,6 +400,12 @@ public:
    */
   virtual const Http::Http2Settings& http2Settings() const PURE;
 
+  /**
+   * @return Http::Http1Settings for HTTP/1.1 connections created on behalf of this cluster, which
+   *         may change with the runtime. @see Http::Http1Settings.
+   */
+  virtual Http::Http1Settings http1Settings() const PURE;
+
   /**
    * @return the type of load balancing that the cluster should use.
    */
@@ -389,6 +436,61 @@ public:
    */
   virtual uint64_t maxRequestsPerConnection() const PURE;
 
+  /**
+   * @return the idle timeout of the connections of the cluster, after which a connection pool
+   *         closes a connection that has not been used. If not set, connections are kept open
+   *         until the pool is drained or the connections are closed.
+   */
+  virtual const Optional<std::chrono::milliseconds>& idleTimeout() const PURE;
+
+  /**
+   * @return the window after applying an update of the hosts of a dynamic cluster during which
+   *         further updates are held back, so that only the latest of them is applied when the
+   *         window closes. If not set, every update is applied as it arrives.
+   */
+  virtual const Optional<std::chrono::milliseconds>& updateMergeWindow() const PURE;
+
+  /**
+   * @return double the number of connections the connection pools of the cluster keep per active
+   *         or pending request, counting the next request, so that requests do not have to wait
+   *         for connections to be established. 0 if connections are only created on demand.
+   */
+  virtual double prefetchRatio() const PURE;
+
+  /**
+   * @return uint32_t the number of connections the HTTP/2 connection pools of the cluster spread
+   *         the streams to each host over. Each stream is assigned to the connection with the
+   *         fewest active streams.
+   */
+  virtual uint32_t http2ConnectionsPerHost() const PURE;
+
+  /**
+   * @return uint32_t the number of subsets the hosts of the cluster are split into for the workers.
+   *         Each worker load balances over the hosts of one subset, so that each host only gets
+   *         connections from some of the workers. 1 if every worker uses all the hosts.
+   */
+  virtual uint32_t workerSubsets() const PURE;
+
+  /**
+   * @return uint32_t the number of partitions the hosts of the cluster are split into for active
+   *         health checking. Each Envoy only probes the hosts of one partition and assumes the
+   *         other hosts to be healthy. 1 if every host is probed.
+   */
+  virtual uint32_t healthCheckPartitions() const PURE;
+
+  /**
+   * @return uint32_t the number of established idle TCP connections each worker keeps to each host
+   *         of the cluster, which tcpConnForCluster() hands out instead of connecting. 0 if TCP
+   *         connections are only created on demand.
+   */
+  virtual uint32_t tcpPreconnectPerHost() const PURE;
+
+  /**
+   * @return the age after which an idle preconnected TCP connection is closed and replaced, so
+   *         that connections the host or a middlebox may have dropped are not handed out.
+   */
+  virtual std::chrono::milliseconds tcpPreconnectMaxAge() const PURE;
+
   /**
    * @return the human readable name of the cluster.
    */
@@ -417,6 +519,12 @@ public:
    */
   virtual Stats::Scope& statsScope() const PURE;
 
+  /**
+   * @return Http::CodeStats& the response code stats of this cluster under the fixed prefixes of
+   *         its stats scope.
+   */
+  virtual Http::CodeStats& codeStats() const PURE;
+
   /**
    * @return ClusterLoadReportStats& strongly named load report stats for this cluster.
    */
@@ -1,5 +1,7 @@
 #include "common/access_log/access_log_formatter.h"
 
+#include <algorithm>
+#include <chrono>
 #include <cstdint>
 #include <string>
 #include <vector>
@@ -48,21 +50,48 @@ AccessLogFormatUtils::protocolToString(const Optional<Http::Protocol>& protocol)
   NOT_REACHED;
 }
 
-FormatterImpl::FormatterImpl(const std::string& format) {
-  formatters_ = AccessLogFormatParser::parse(format);
+namespace {
+
+void appendInteger(std::string& output, uint64_t value) {
+  char buffer[StringUtil::MIN_ITOA_OUT_LEN];
+  output.append(buffer, StringUtil::itoa(buffer, sizeof(buffer), value));
+}
+
+void appendMilliseconds(std::string& output, std::chrono::microseconds duration) {
+  appendInteger(output, std::chrono::duration_cast<std::chrono::milliseconds>(duration).count());
+}
+
+void appendMilliseconds(std::string& output, const Optional<std::chrono::microseconds>& duration) {
+  if (duration.valid()) {
+    appendMilliseconds(output, duration.value());
+  } else {
+    output += UnspecifiedValueString;
+  }
 }
 
-std::string FormatterImpl::format(const Http::HeaderMap& request_headers,
+} // namespace
+
+std::string FormatterBase::format(const Http::HeaderMap& request_headers,
                                   const Http::HeaderMap& response_headers,
                                   const RequestInfo::RequestInfo& request_info) const {
-  std::string log_line;
-  log_line.reserve(256);
+  std::string output;
+  formatTo(request_headers, response_headers, request_info, output);
+  return output;
+}
+
+FormatterImpl::FormatterImpl(const std::string& format) {
+  formatters_ = AccessLogFormatParser::parse(format);
+}
+
+void FormatterImpl::formatTo(const Http::HeaderMap& request_headers,
+                             const Http::HeaderMap& response_headers,
+                             const RequestInfo::RequestInfo& request_info,
+                             std::string& output) const {
+  output.reserve(output.size() + 256);
 
   for (const FormatterPtr& formatter : formatters_) {
-    log_line += formatter->format(request_headers, response_headers, request_info);
+    formatter->formatTo(request_headers, response_headers, request_info, output);
   }
-
-  return log_line;
 }
 
 void AccessLogFormatParser::parseCommand(const std::string& token, const size_t start,
@@ -140,6 +169,12 @@ std::vector<FormatterPtr> AccessLogFormatParser::parse(const std::string& format
 
         formatters.emplace_back(
             FormatterPtr(new ResponseHeaderFormatter(main_header, alternative_header, max_length)));
+      } else if (token == "REQUEST_HEADERS_BYTES") {
+        formatters.emplace_back(FormatterPtr(
+            new HeadersByteSizeFormatter(HeadersByteSizeFormatter::HeaderType::Request)));
+      } else if (token == "RESPONSE_HEADERS_BYTES") {
+        formatters.emplace_back(FormatterPtr(
+            new HeadersByteSizeFormatter(HeadersByteSizeFormatter::HeaderType::Response)));
       } else {
         formatters.emplace_back(FormatterPtr(new RequestInfoFormatter(token)));
       }
@@ -159,92 +194,99 @@ std::vector<FormatterPtr> AccessLogFormatParser::parse(const std::string& format
 
 RequestInfoFormatter::RequestInfoFormatter(const std::string& field_name) {
   if (field_name == "START_TIME") {
-    field_extractor_ = [](const RequestInfo::RequestInfo& request_info) {
-      return AccessLogDateTimeFormatter::fromTime(request_info.startTime());
+    field_extractor_ = [](const RequestInfo::RequestInfo& request_info, std::string& output) {
+      output += AccessLogDateTimeFormatter::fromTime(request_info.startTime());
     };
   } else if (field_name == "REQUEST_DURATION") {
-    field_extractor_ = [](const RequestInfo::RequestInfo& request_info) {
-      Optional<std::chrono::microseconds> duration = request_info.requestReceivedDuration();
-      if (duration.valid()) {
-        return std::to_string(
-            std::chrono::duration_cast<std::chrono::milliseconds>(duration.value()).count());
-      } else {
-        return UnspecifiedValueString;
-      }
+    field_extractor_ = [](const RequestInfo::RequestInfo& request_info, std::string& output) {
+      appendMilliseconds(output, request_info.requestReceivedDuration());
     };
   } else if (field_name == "RESPONSE_DURATION") {
-    field_extractor_ = [](const RequestInfo::RequestInfo& request_info) {
-      Optional<std::chrono::microseconds> duration = request_info.responseReceivedDuration();
-      if (duration.valid()) {
-        return std::to_string(
-            std::chrono::duration_cast<std::chrono::milliseconds>(duration.value()).count());
-      } else {
-        return UnspecifiedValueString;
-      }
+    field_extractor_ = [](const RequestInfo::RequestInfo& request_info, std::string& output) {
+      appendMilliseconds(output, request_info.responseReceivedDuration());
+    };
+  } else if (field_name == "UPSTREAM_CONNECT_START_DURATION") {
+    field_extractor_ = [](const RequestInfo::RequestInfo& request_info, std::string& output) {
+      appendMilliseconds(output, request_info.upstreamConnectStartDuration());
+    };
+  } else if (field_name == "UPSTREAM_CONNECT_END_DURATION") {
+    field_extractor_ = [](const RequestInfo::RequestInfo& request_info, std::string& output) {
+      appendMilliseconds(output, request_info.upstreamConnectEndDuration());
+    };
+  } else if (field_name == "UPSTREAM_LAST_BYTE_RECEIVED_DURATION") {
+    field_extractor_ = [](const RequestInfo::RequestInfo& request_info, std::string& output) {
+      appendMilliseconds(output, request_info.upstreamLastByteReceivedDuration());
+    };
+  } else if (field_name == "DOWNSTREAM_FIRST_BYTE_SENT_DURATION") {
+    field_extractor_ = [](const RequestInfo::RequestInfo& request_info, std::string& output) {
+      appendMilliseconds(output, request_info.downstreamFirstByteSentDuration());
+    };
+  } else if (field_name == "DOWNSTREAM_LAST_BYTE_SENT_DURATION") {
+    field_extractor_ = [](const RequestInfo::RequestInfo& request_info, std::string& output) {
+      appendMilliseconds(output, request_info.downstreamLastByteSentDuration());
     };
   } else if (field_name == "BYTES_RECEIVED") {
-    field_extractor_ = [](const RequestInfo::RequestInfo& request_info) {
-      return std::to_string(request_info.bytesReceived());
+    field_extractor_ = [](const RequestInfo::RequestInfo& request_info, std::string& output) {
+      appendInteger(output, request_info.bytesReceived());
     };
   } else if (field_name == "PROTOCOL") {
-    field_extractor_ = [](const RequestInfo::RequestInfo& request_info) {
-      return AccessLogFormatUtils::protocolToString(request_info.protocol());
+    field_extractor_ = [](const RequestInfo::RequestInfo& request_info, std::string& output) {
+      output += AccessLogFormatUtils::protocolToString(request_info.protocol());
     };
   } else if (field_name == "RESPONSE_CODE") {
-    field_extractor_ = [](const RequestInfo::RequestInfo& request_info) {
-      return request_info.responseCode().valid()
-                 ? std::to_string(request_info.responseCode().value())
-                 : "0";
+    field_extractor_ = [](const RequestInfo::RequestInfo& request_info, std::string& output) {
+      appendInteger(output, request_info.responseCode().valid()
+                                ? request_info.responseCode().value()
+                                : 0);
     };
   } else if (field_name == "BYTES_SENT") {
-    field_extractor_ = [](const RequestInfo::RequestInfo& request_info) {
-      return std::to_string(request_info.bytesSent());
+    field_extractor_ = [](const RequestInfo::RequestInfo& request_info, std::string& output) {
+      appendInteger(output, request_info.bytesSent());
     };
   } else if (field_name == "DURATION") {
-    field_extractor_ = [](const RequestInfo::RequestInfo& request_info) {
-      return std::to_string(
-          std::chrono::duration_cast<std::chrono::milliseconds>(request_info.duration()).count());
+    field_extractor_ = [](const RequestInfo::RequestInfo& request_info, std::string& output) {
+      appendMilliseconds(output, request_info.duration());
     };
   } else if (field_name == "RESPONSE_FLAGS") {
-    field_extractor_ = [](const RequestInfo::RequestInfo& request_info) {
-      return RequestInfo::ResponseFlagUtils::toShortString(request_info);
+    field_extractor_ = [](const RequestInfo::RequestInfo& request_info, std::string& output) {
+      output += RequestInfo::ResponseFlagUtils::toShortString(request_info);
     };
   } else if (field_name == "UPSTREAM_HOST") {
-    field_extractor_ = [](const RequestInfo::RequestInfo& request_info) {
+    field_extractor_ = [](const RequestInfo::RequestInfo& request_info, std::string& output) {
       if (request_info.upstreamHost()) {
-        return request_info.upstreamHost()->address()->asString();
+        output += request_info.upstreamHost()->address()->asString();
       } else {
-        return UnspecifiedValueString;
+        output += UnspecifiedValueString;
       }
     };
   } else if (field_name == "UPSTREAM_CLUSTER") {
-    field_extractor_ = [](const RequestInfo::RequestInfo& request_info) {
-      std::string upstream_cluster_name;
-      if (nullptr != request_info.upstreamHost()) {
-        upstream_cluster_name = request_info.upstreamHost()->cluster().name();
+    field_extractor_ = [](const RequestInfo::RequestInfo& request_info, std::string& output) {
+      if (nullptr != request_info.upstreamHost() &&
+          !request_info.upstreamHost()->cluster().name().empty()) {
+        output += request_info.upstreamHost()->cluster().name();
+      } else {
+        output += UnspecifiedValueString;
       }
-
-      return upstream_cluster_name.empty() ? UnspecifiedValueString : upstream_cluster_name;
     };
   } else if (field_name == "UPSTREAM_LOCAL_ADDRESS") {
-    field_extractor_ = [](const RequestInfo::RequestInfo& request_info) {
-      return request_info.upstreamLocalAddress() != nullptr
-                 ? request_info.upstreamLocalAddress()->asString()
-                 : UnspecifiedValueString;
+    field_extractor_ = [](const RequestInfo::RequestInfo& request_info, std::string& output) {
+      output += request_info.upstreamLocalAddress() != nullptr
+                    ? request_info.upstreamLocalAddress()->asString()
+                    : UnspecifiedValueString;
     };
   } else if (field_name == "DOWNSTREAM_LOCAL_ADDRESS") {
-    field_extractor_ = [](const RequestInfo::RequestInfo& request_info) {
-      return request_info.downstreamLocalAddress()->asString();
+    field_extractor_ = [](const RequestInfo::RequestInfo& request_info, std::string& output) {
+      output += request_info.downstreamLocalAddress()->asString();
     };
   } else if (field_name == "DOWNSTREAM_REMOTE_ADDRESS") {
-    field_extractor_ = [](const RequestInfo::RequestInfo& request_info) {
-      return request_info.downstreamRemoteAddress()->asString();
+    field_extractor_ = [](const RequestInfo::RequestInfo& request_info, std::string& output) {
+      output += request_info.downstreamRemoteAddress()->asString();
     };
   } else if (field_name == "DOWNSTREAM_ADDRESS" ||
              field_name == "DOWNSTREAM_REMOTE_ADDRESS_WITHOUT_PORT") {
     // DEPRECATED: "DOWNSTREAM_ADDRESS" will be removed post 1.6.0.
-    field_extractor_ = [](const RequestInfo::RequestInfo& request_info) {
-      return RequestInfo::Utility::formatDownstreamAddressNoPort(
+    field_extractor_ = [](const RequestInfo::RequestInfo& request_info, std::string& output) {
+      output += RequestInfo::Utility::formatDownstreamAddressNoPort(
           *request_info.downstreamRemoteAddress());
     };
   } else {
@@ -252,16 +294,17 @@ RequestInfoFormatter::RequestInfoFormatter(const std::string& field_name) {
   }
 }
 
-std::string RequestInfoFormatter::format(const Http::HeaderMap&, const Http::HeaderMap&,
-                                         const RequestInfo::RequestInfo& request_info) const {
-  return field_extractor_(request_info);
+void RequestInfoFormatter::formatTo(const Http::HeaderMap&, const Http::HeaderMap&,
+                                    const RequestInfo::RequestInfo& request_info,
+                                    std::string& output) const {
+  field_extractor_(request_info, output);
 }
 
 PlainStringFormatter::PlainStringFormatter(const std::string& str) : str_(str) {}
 
-std::string PlainStringFormatter::format(const Http::HeaderMap&, const Http::HeaderMap&,
-                                         const RequestInfo::RequestInfo&) const {
-  return str_;
+void PlainStringFormatter::formatTo(const Http::HeaderMap&, const Http::HeaderMap&,
+                                    const RequestInfo::RequestInfo&, std::string& output) const {
+  output += str_;
 }
 
 HeaderFormatter::HeaderFormatter(const std::string& main_header,
@@ -269,25 +312,28 @@ HeaderFormatter::HeaderFormatter(const std::string& main_header,
                                  const Optional<size_t>& max_length)
     : main_header_(main_header), alternative_header_(alternative_header), max_length_(max_length) {}
 
-std::string HeaderFormatter::format(const Http::HeaderMap& headers) const {
+void HeaderFormatter::formatTo(const Http::HeaderMap& headers, std::string& output) const {
   const Http::HeaderEntry* header = headers.get(main_header_);
 
   if (!header && !alternative_header_.get().empty()) {
     header = headers.get(alternative_header_);
   }
 
-  std::string header_value_string;
+  const char* value;
+  size_t length;
   if (!header) {
-    header_value_string = UnspecifiedValueString;
+    value = UnspecifiedValueString.c_str();
+    length = UnspecifiedValueString.size();
   } else {
-    header_value_string = header->value().c_str();
+    value = header->value().c_str();
+    length = header->value().size();
   }
 
-  if (max_length_.valid() && header_value_string.length() > max_length_.value()) {
-    return header_value_string.substr(0, max_length_.value());
+  if (max_length_.valid()) {
+    length = std::min(length, max_length_.value());
   }
 
-  return header_value_string;
+  output.append(value, length);
 }
 
 ResponseHeaderFormatter::ResponseHeaderFormatter(const std::string& main_header,
@@ -295,10 +341,10 @@ ResponseHeaderFormatter::ResponseHeaderFormatter(const std::string& main_header,
                                                  const Optional<size_t>& max_length)
     : HeaderFormatter(main_header, alternative_header, max_length) {}
 
-std::string ResponseHeaderFormatter::format(const Http::HeaderMap&,
-                                            const Http::HeaderMap& response_headers,
-                                            const RequestInfo::RequestInfo&) const {
-  return HeaderFormatter::format(response_headers);
+void ResponseHeaderFormatter::formatTo(const Http::HeaderMap&,
+                                       const Http::HeaderMap& response_headers,
+                                       const RequestInfo::RequestInfo&, std::string& output) const {
+  HeaderFormatter::formatTo(response_headers, output);
 }
 
 RequestHeaderFormatter::RequestHeaderFormatter(const std::string& main_header,
@@ -306,10 +352,22 @@ RequestHeaderFormatter::RequestHeaderFormatter(const std::string& main_header,
                                                const Optional<size_t>& max_length)
     : HeaderFormatter(main_header, alternative_header, max_length) {}
 
-std::string RequestHeaderFormatter::format(const Http::HeaderMap& request_headers,
-                                           const Http::HeaderMap&,
-                                           const RequestInfo::RequestInfo&) const {
-  return HeaderFormatter::format(request_headers);
+void RequestHeaderFormatter::formatTo(const Http::HeaderMap& request_headers,
+                                      const Http::HeaderMap&, const RequestInfo::RequestInfo&,
+                                      std::string& output) const {
+  HeaderFormatter::formatTo(request_headers, output);
+}
+
+HeadersByteSizeFormatter::HeadersByteSizeFormatter(HeaderType header_type)
+    : header_type_(header_type) {}
+
+void HeadersByteSizeFormatter::formatTo(const Http::HeaderMap& request_headers,
+                                        const Http::HeaderMap& response_headers,
+                                        const RequestInfo::RequestInfo&,
+                                        std::string& output) const {
+  const Http::HeaderMap& headers =
+      header_type_ == HeaderType::Request ? request_headers : response_headers;
+  appendInteger(output, headers.byteSize());
 }
 
 } // namespace AccessLog
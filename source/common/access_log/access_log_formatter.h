@@ -37,16 +37,26 @@ private:
 };
 
 /**
- * Composite formatter implementation.
+ * Base of the formatters below, which only implement formatTo().
  */
-class FormatterImpl : public Formatter {
+class FormatterBase : public Formatter {
 public:
-  FormatterImpl(const std::string& format);
-
   // Formatter::format
   std::string format(const Http::HeaderMap& request_headers,
                      const Http::HeaderMap& response_headers,
                      const RequestInfo::RequestInfo& request_info) const override;
+};
+
+/**
+ * Composite formatter implementation.
+ */
+class FormatterImpl : public FormatterBase {
+public:
+  FormatterImpl(const std::string& format);
+
+  // Formatter::formatTo
+  void formatTo(const Http::HeaderMap& request_headers, const Http::HeaderMap& response_headers,
+                const RequestInfo::RequestInfo& request_info, std::string& output) const override;
 
 private:
   std::vector<FormatterPtr> formatters_;
@@ -56,13 +66,13 @@ private:
  * Formatter for string literal. It ignores headers and request info and returns string by which it
  * was initialized.
  */
-class PlainStringFormatter : public Formatter {
+class PlainStringFormatter : public FormatterBase {
 public:
   PlainStringFormatter(const std::string& str);
 
-  // Formatter::format
-  std::string format(const Http::HeaderMap&, const Http::HeaderMap&,
-                     const RequestInfo::RequestInfo&) const override;
+  // Formatter::formatTo
+  void formatTo(const Http::HeaderMap&, const Http::HeaderMap&, const RequestInfo::RequestInfo&,
+                std::string& output) const override;
 
 private:
   std::string str_;
@@ -73,7 +83,7 @@ public:
   HeaderFormatter(const std::string& main_header, const std::string& alternative_header,
                   const Optional<size_t>& max_length);
 
-  std::string format(const Http::HeaderMap& headers) const;
+  void formatTo(const Http::HeaderMap& headers, std::string& output) const;
 
 private:
   Http::LowerCaseString main_header_;
@@ -84,42 +94,61 @@ private:
 /**
  * Formatter based on request header.
  */
-class RequestHeaderFormatter : public Formatter, HeaderFormatter {
+class RequestHeaderFormatter : public FormatterBase, HeaderFormatter {
 public:
   RequestHeaderFormatter(const std::string& main_header, const std::string& alternative_header,
                          const Optional<size_t>& max_length);
 
-  // Formatter::format
-  std::string format(const Http::HeaderMap& request_headers, const Http::HeaderMap&,
-                     const RequestInfo::RequestInfo&) const override;
+  // Formatter::formatTo
+  void formatTo(const Http::HeaderMap& request_headers, const Http::HeaderMap&,
+                const RequestInfo::RequestInfo&, std::string& output) const override;
 };
 
 /**
  * Formatter based on the response header.
  */
-class ResponseHeaderFormatter : public Formatter, HeaderFormatter {
+class ResponseHeaderFormatter : public FormatterBase, HeaderFormatter {
 public:
   ResponseHeaderFormatter(const std::string& main_header, const std::string& alternative_header,
                           const Optional<size_t>& max_length);
 
-  // Formatter::format
-  std::string format(const Http::HeaderMap&, const Http::HeaderMap& response_headers,
-                     const RequestInfo::RequestInfo&) const override;
+  // Formatter::formatTo
+  void formatTo(const Http::HeaderMap&, const Http::HeaderMap& response_headers,
+                const RequestInfo::RequestInfo&, std::string& output) const override;
+};
+
+/**
+ * Formatter for the byte size of the request or response headers, as reported by
+ * HeaderMap::byteSize().
+ */
+class HeadersByteSizeFormatter : public FormatterBase {
+public:
+  enum class HeaderType { Request, Response };
+
+  HeadersByteSizeFormatter(HeaderType header_type);
+
+  // Formatter::formatTo
+  void formatTo(const Http::HeaderMap& request_headers, const Http::HeaderMap& response_headers,
+                const RequestInfo::RequestInfo&, std::string& output) const override;
+
+private:
+  const HeaderType header_type_;
 };
 
 /**
  * Formatter based on the RequestInfo field.
  */
-class RequestInfoFormatter : public Formatter {
+class RequestInfoFormatter : public FormatterBase {
 public:
   RequestInfoFormatter(const std::string& field_name);
 
-  // Formatter::format
-  std::string format(const Http::HeaderMap&, const Http::HeaderMap&,
-                     const RequestInfo::RequestInfo& request_info) const override;
+  // Formatter::formatTo
+  void formatTo(const Http::HeaderMap&, const Http::HeaderMap&,
+                const RequestInfo::RequestInfo& request_info, std::string& output) const override;
 
 private:
-  std::function<std::string(const RequestInfo::RequestInfo&)> field_extractor_;
+  // Appends the field to the output.
+  std::function<void(const RequestInfo::RequestInfo&, std::string&)> field_extractor_;
 };
 
 } // namespace AccessLog
@@ -90,18 +90,35 @@ RuntimeFilter::RuntimeFilter(const envoy::api::v2::filter::accesslog::RuntimeFil
 
 bool RuntimeFilter::evaluate(const RequestInfo::RequestInfo&,
                              const Http::HeaderMap& request_header) {
-  const Http::HeaderEntry* uuid = request_header.RequestId();
-  uint16_t sampled_value;
-  if (uuid && UuidUtils::uuidModBy(uuid->value().c_str(), sampled_value, 100)) {
-    uint64_t runtime_value =
-        std::min<uint64_t>(runtime_.snapshot().getInteger(runtime_key_, 0), 100);
-
-    return sampled_value < static_cast<uint16_t>(runtime_value);
+  bool sampled;
+  if (sampleByRequestId(request_header, sampled)) {
+    return sampled;
   } else {
     return runtime_.snapshot().featureEnabled(runtime_key_, 0);
   }
 }
 
+bool RuntimeFilter::mayPass(const Http::HeaderMap& request_header) {
+  // Requests with a request ID are sampled by it, so they are decided as soon as it is set.
+  bool sampled;
+  return !sampleByRequestId(request_header, sampled) || sampled;
+}
+
+bool RuntimeFilter::sampleByRequestId(const Http::HeaderMap& request_header, bool& sampled) {
+  const Http::HeaderEntry* uuid = request_header.RequestId();
+  uint16_t sampled_value;
+  if (!uuid || !UuidUtils::uuidModBy(
+                   absl::string_view(uuid->value().c_str(), uuid->value().size()), sampled_value,
+                   100)) {
+    return false;
+  }
+
+  uint64_t runtime_value =
+      std::min<uint64_t>(runtime_.snapshot().getInteger(runtime_key_, 0), 100);
+  sampled = sampled_value < static_cast<uint16_t>(runtime_value);
+  return true;
+}
+
 OperatorFilter::OperatorFilter(
     const Protobuf::RepeatedPtrField<envoy::api::v2::filter::accesslog::AccessLogFilter>& configs,
     Runtime::Loader& runtime) {
@@ -146,6 +163,26 @@ bool AndFilter::evaluate(const RequestInfo::RequestInfo& info,
   return result;
 }
 
+bool OrFilter::mayPass(const Http::HeaderMap& request_headers) {
+  for (auto& filter : filters_) {
+    if (filter->mayPass(request_headers)) {
+      return true;
+    }
+  }
+
+  return false;
+}
+
+bool AndFilter::mayPass(const Http::HeaderMap& request_headers) {
+  for (auto& filter : filters_) {
+    if (!filter->mayPass(request_headers)) {
+      return false;
+    }
+  }
+
+  return true;
+}
+
 bool NotHealthCheckFilter::evaluate(const RequestInfo::RequestInfo& info, const Http::HeaderMap&) {
   return !info.healthCheck();
 }
@@ -173,6 +210,10 @@ FileAccessLog::FileAccessLog(const std::string& access_log_path, FilterPtr&& fil
   log_file_ = log_manager.createAccessLog(access_log_path);
 }
 
+bool FileAccessLog::mayLog(const Http::HeaderMap& request_headers) {
+  return !filter_ || filter_->mayPass(request_headers);
+}
+
 void FileAccessLog::log(const Http::HeaderMap* request_headers,
                         const Http::HeaderMap* response_headers,
                         const RequestInfo::RequestInfo& request_info) {
@@ -190,7 +231,15 @@ void FileAccessLog::log(const Http::HeaderMap* request_headers,
     }
   }
 
-  log_file_->write(formatter_->format(*request_headers, *response_headers, request_info));
+  // Each thread formats its lines into the same string, so that logging does not allocate once
+  // the string has grown to the size of a line. Unusually long lines do not pin their memory.
+  static thread_local std::string log_line;
+  log_line.clear();
+  formatter_->formatTo(*request_headers, *response_headers, request_info, log_line);
+  log_file_->write(log_line);
+  if (log_line.capacity() > MAX_RETAINED_LINE_SIZE) {
+    std::string().swap(log_line);
+  }
 }
 
 } // namespace AccessLog
@@ -54,6 +54,7 @@ public:
   // AccessLog::Filter
   bool evaluate(const RequestInfo::RequestInfo& info,
                 const Http::HeaderMap& request_headers) override;
+  bool mayPass(const Http::HeaderMap&) override { return true; }
 };
 
 /**
@@ -68,6 +69,7 @@ public:
   // AccessLog::Filter
   bool evaluate(const RequestInfo::RequestInfo& info,
                 const Http::HeaderMap& request_headers) override;
+  bool mayPass(const Http::HeaderMap&) override { return true; }
 };
 
 /**
@@ -93,6 +95,7 @@ public:
   // AccessLog::Filter
   bool evaluate(const RequestInfo::RequestInfo& info,
                 const Http::HeaderMap& request_headers) override;
+  bool mayPass(const Http::HeaderMap& request_headers) override;
 };
 
 /**
@@ -105,6 +108,7 @@ public:
   // AccessLog::Filter
   bool evaluate(const RequestInfo::RequestInfo& info,
                 const Http::HeaderMap& request_headers) override;
+  bool mayPass(const Http::HeaderMap& request_headers) override;
 };
 
 /**
@@ -117,6 +121,7 @@ public:
   // AccessLog::Filter
   bool evaluate(const RequestInfo::RequestInfo& info,
                 const Http::HeaderMap& request_headers) override;
+  bool mayPass(const Http::HeaderMap&) override { return true; }
 };
 
 /**
@@ -127,6 +132,7 @@ public:
   // AccessLog::Filter
   bool evaluate(const RequestInfo::RequestInfo& info,
                 const Http::HeaderMap& request_headers) override;
+  bool mayPass(const Http::HeaderMap&) override { return true; }
 };
 
 /**
@@ -140,8 +146,12 @@ public:
   // AccessLog::Filter
   bool evaluate(const RequestInfo::RequestInfo& info,
                 const Http::HeaderMap& request_headers) override;
+  bool mayPass(const Http::HeaderMap& request_headers) override;
 
 private:
+  // @return true if the request is sampled by its request ID, setting sampled to the decision.
+  bool sampleByRequestId(const Http::HeaderMap& request_headers, bool& sampled);
+
   Runtime::Loader& runtime_;
   const std::string runtime_key_;
 };
@@ -169,8 +179,12 @@ public:
   // AccessLog::Instance
   void log(const Http::HeaderMap* request_headers, const Http::HeaderMap* response_headers,
            const RequestInfo::RequestInfo& request_info) override;
+  bool mayLog(const Http::HeaderMap& request_headers) override;
 
 private:
+  // Largest capacity of the formatting buffer of a thread that is kept between lines.
+  static const size_t MAX_RETAINED_LINE_SIZE = 16 * 1024;
+
   Filesystem::FileSharedPtr log_file_;
   FilterPtr filter_;
   FormatterPtr formatter_;
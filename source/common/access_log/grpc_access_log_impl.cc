@@ -1,5 +1,7 @@
 #include "common/access_log/grpc_access_log_impl.h"
 
+#include <tuple>
+
 #include "common/common/assert.h"
 #include "common/http/header_map_impl.h"
 
@@ -8,56 +10,115 @@ namespace AccessLog {
 
 GrpcAccessLogStreamerImpl::GrpcAccessLogStreamerImpl(GrpcAccessLogClientFactoryPtr&& factory,
                                                      ThreadLocal::SlotAllocator& tls,
-                                                     const LocalInfo::LocalInfo& local_info)
+                                                     const LocalInfo::LocalInfo& local_info,
+                                                     Stats::Scope& scope,
+                                                     const BatchConfig& batch_config)
     : tls_slot_(tls.allocateSlot()) {
 
-  SharedStateSharedPtr shared_state = std::make_shared<SharedState>(std::move(factory), local_info);
-  tls_slot_->set([shared_state](Event::Dispatcher&) {
-    return ThreadLocal::ThreadLocalObjectSharedPtr{new ThreadLocalStreamer(shared_state)};
+  SharedStateSharedPtr shared_state =
+      std::make_shared<SharedState>(std::move(factory), local_info, scope, batch_config);
+  tls_slot_->set([shared_state](Event::Dispatcher& dispatcher) {
+    return ThreadLocal::ThreadLocalObjectSharedPtr{
+        new ThreadLocalStreamer(shared_state, dispatcher)};
   });
 }
 
 void GrpcAccessLogStreamerImpl::ThreadLocalStream::onRemoteClose(Grpc::Status::GrpcStatus,
                                                                  const std::string&) {
-  auto it = parent_.stream_map_.find(log_name_);
-  ASSERT(it != parent_.stream_map_.end());
-  if (it->second.stream_ != nullptr) {
-    // Only erase if we have a stream. Otherwise we had an inline failure and we will clear the
-    // stream data in send().
-    parent_.stream_map_.erase(it);
+  // The stream is not erased so that the entries of its batch are sent on the next stream.
+  stream_ = nullptr;
+}
+
+void GrpcAccessLogStreamerImpl::ThreadLocalStream::add(
+    envoy::api::v2::filter::accesslog::StreamAccessLogsMessage& message) {
+  const BatchConfig& config = parent_.shared_state_->batch_config_;
+  GrpcAccessLogStats& stats = parent_.shared_state_->stats_;
+  const bool was_empty = batch_.http_logs().log_entry_size() == 0;
+  bool added = false;
+  auto* entries = message.mutable_http_logs()->mutable_log_entry();
+  for (auto& entry : *entries) {
+    const uint64_t entry_bytes = entry.ByteSize();
+    if (batch_.http_logs().log_entry_size() > 0 &&
+        batch_bytes_ + entry_bytes > config.max_buffered_bytes_) {
+      stats.logs_dropped_.inc();
+      continue;
+    }
+    // Swapping hands the storage of an entry of an earlier batch to the message of the caller.
+    batch_.mutable_http_logs()->add_log_entry()->Swap(&entry);
+    batch_bytes_ += entry_bytes;
+    added = true;
+  }
+
+  if (added &&
+      (static_cast<uint64_t>(batch_.http_logs().log_entry_size()) >= config.max_batch_entries_ ||
+       batch_bytes_ >= config.max_batch_bytes_)) {
+    flush();
+  }
+  // The timer is armed whenever the batch holds entries. It may fire after the batch was sent
+  // because it filled up, which does no harm.
+  if (was_empty && batch_.http_logs().log_entry_size() > 0 && config.flush_interval_.count() > 0) {
+    if (!flush_timer_) {
+      flush_timer_ = parent_.dispatcher_.createTimer([this, &config]() -> void {
+        flush();
+        if (batch_.http_logs().log_entry_size() > 0) {
+          flush_timer_->enableTimer(config.flush_interval_);
+        }
+      });
+    }
+    flush_timer_->enableTimer(config.flush_interval_);
+  }
+}
+
+void GrpcAccessLogStreamerImpl::ThreadLocalStream::flush() {
+  if (batch_.http_logs().log_entry_size() == 0) {
+    return;
   }
+
+  if (stream_ == nullptr) {
+    stream_ = parent_.client_->start(
+        *Protobuf::DescriptorPool::generated_pool()->FindMethodByName(
+            "envoy.api.v2.filter.accesslog.AccessLogService.StreamAccessLogs"),
+        *this);
+
+    auto* identifier = batch_.mutable_identifier();
+    *identifier->mutable_node() = parent_.shared_state_->local_info_.node();
+    identifier->set_log_name(log_name_);
+  }
+
+  GrpcAccessLogStats& stats = parent_.shared_state_->stats_;
+  if (stream_ != nullptr) {
+    stream_->sendMessage(batch_, false);
+    stats.batches_sent_.inc();
+    stats.logs_sent_.add(batch_.http_logs().log_entry_size());
+  } else if (parent_.shared_state_->batch_config_.flush_interval_.count() > 0) {
+    // Keep the batch for the next flush, which starts a new stream.
+    batch_.clear_identifier();
+    return;
+  } else {
+    // Without a flush interval there is no later flush to retry on.
+    stats.logs_dropped_.add(batch_.http_logs().log_entry_size());
+  }
+
+  batch_.Clear();
+  batch_bytes_ = 0;
 }
 
 GrpcAccessLogStreamerImpl::ThreadLocalStreamer::ThreadLocalStreamer(
-    const SharedStateSharedPtr& shared_state)
-    : client_(shared_state->factory_->create()), shared_state_(shared_state) {}
+    const SharedStateSharedPtr& shared_state, Event::Dispatcher& dispatcher)
+    : dispatcher_(dispatcher), client_(shared_state->factory_->create()),
+      shared_state_(shared_state) {}
 
 void GrpcAccessLogStreamerImpl::ThreadLocalStreamer::send(
     envoy::api::v2::filter::accesslog::StreamAccessLogsMessage& message,
     const std::string& log_name) {
   auto stream_it = stream_map_.find(log_name);
   if (stream_it == stream_map_.end()) {
-    stream_it = stream_map_.emplace(log_name, ThreadLocalStream(*this, log_name)).first;
-  }
-
-  auto& stream_entry = stream_it->second;
-  if (stream_entry.stream_ == nullptr) {
-    stream_entry.stream_ =
-        client_->start(*Protobuf::DescriptorPool::generated_pool()->FindMethodByName(
-                           "envoy.api.v2.filter.accesslog.AccessLogService.StreamAccessLogs"),
-                       stream_entry);
-
-    auto* identifier = message.mutable_identifier();
-    *identifier->mutable_node() = shared_state_->local_info_.node();
-    identifier->set_log_name(log_name);
-  }
-
-  if (stream_entry.stream_ != nullptr) {
-    stream_entry.stream_->sendMessage(message, false);
-  } else {
-    // Clear out the stream data due to stream creation failure.
-    stream_map_.erase(stream_it);
+    stream_it = stream_map_
+                    .emplace(std::piecewise_construct, std::forward_as_tuple(log_name),
+                             std::forward_as_tuple(*this, log_name))
+                    .first;
   }
+  stream_it->second.add(message);
 }
 
 HttpGrpcAccessLog::HttpGrpcAccessLog(
@@ -151,18 +212,27 @@ void HttpGrpcAccessLog::log(const Http::HeaderMap* request_headers,
     }
   }
 
-  envoy::api::v2::filter::accesslog::StreamAccessLogsMessage message;
-  auto* log_entry = message.mutable_http_logs()->add_log_entry();
+  // The streamer swaps the entry out for one it has sent before, so the message keeps storage to
+  // populate the next entry with.
+  static thread_local envoy::api::v2::filter::accesslog::StreamAccessLogsMessage message;
+  message.Clear();
+  populateLogEntry(*message.mutable_http_logs()->add_log_entry(), *request_headers,
+                   *response_headers, request_info);
+
+  grpc_access_log_streamer_->send(message, config_.common_config().log_name());
+}
 
+void HttpGrpcAccessLog::populateLogEntry(
+    envoy::api::v2::filter::accesslog::HTTPAccessLogEntry& log_entry,
+    const Http::HeaderMap& request_headers, const Http::HeaderMap& response_headers,
+    const RequestInfo::RequestInfo& request_info) {
   // Common log properties.
   // TODO(mattklein123): Populate sample_rate field.
   // TODO(mattklein123): Populate tls_properties field.
   // TODO(mattklein123): Populate time_to_first_upstream_tx_byte field.
   // TODO(mattklein123): Populate time_to_last_upstream_tx_byte field.
-  // TODO(mattklein123): Populate time_to_last_upstream_rx_byte field.
-  // TODO(mattklein123): Populate time_to_first_downstream_tx_byte field.
   // TODO(mattklein123): Populate metadata field and wire up to filters.
-  auto* common_properties = log_entry->mutable_common_properties();
+  auto* common_properties = log_entry.mutable_common_properties();
   addressToAccessLogAddress(*common_properties->mutable_downstream_remote_address(),
                             *request_info.downstreamRemoteAddress());
   addressToAccessLogAddress(*common_properties->mutable_downstream_local_address(),
@@ -182,8 +252,21 @@ void HttpGrpcAccessLog::log(const Http::HeaderMap* request_headers,
         Protobuf::util::TimeUtil::MicrosecondsToDuration(
             request_info.responseReceivedDuration().value().count()));
   }
+  if (request_info.upstreamLastByteReceivedDuration().valid()) {
+    common_properties->mutable_time_to_last_upstream_rx_byte()->MergeFrom(
+        Protobuf::util::TimeUtil::MicrosecondsToDuration(
+            request_info.upstreamLastByteReceivedDuration().value().count()));
+  }
+  if (request_info.downstreamFirstByteSentDuration().valid()) {
+    common_properties->mutable_time_to_first_downstream_tx_byte()->MergeFrom(
+        Protobuf::util::TimeUtil::MicrosecondsToDuration(
+            request_info.downstreamFirstByteSentDuration().value().count()));
+  }
   common_properties->mutable_time_to_last_downstream_tx_byte()->MergeFrom(
-      Protobuf::util::TimeUtil::MicrosecondsToDuration(request_info.duration().count()));
+      Protobuf::util::TimeUtil::MicrosecondsToDuration(
+          request_info.downstreamLastByteSentDuration().valid()
+              ? request_info.downstreamLastByteSentDuration().value().count()
+              : request_info.duration().count()));
   if (request_info.upstreamHost() != nullptr) {
     addressToAccessLogAddress(*common_properties->mutable_upstream_remote_address(),
                               *request_info.upstreamHost()->address());
@@ -198,15 +281,13 @@ void HttpGrpcAccessLog::log(const Http::HeaderMap* request_headers,
   if (request_info.protocol().valid()) {
     switch (request_info.protocol().value()) {
     case Http::Protocol::Http10:
-      log_entry->set_protocol_version(
-          envoy::api::v2::filter::accesslog::HTTPAccessLogEntry::HTTP10);
+      log_entry.set_protocol_version(envoy::api::v2::filter::accesslog::HTTPAccessLogEntry::HTTP10);
       break;
     case Http::Protocol::Http11:
-      log_entry->set_protocol_version(
-          envoy::api::v2::filter::accesslog::HTTPAccessLogEntry::HTTP11);
+      log_entry.set_protocol_version(envoy::api::v2::filter::accesslog::HTTPAccessLogEntry::HTTP11);
       break;
     case Http::Protocol::Http2:
-      log_entry->set_protocol_version(envoy::api::v2::filter::accesslog::HTTPAccessLogEntry::HTTP2);
+      log_entry.set_protocol_version(envoy::api::v2::filter::accesslog::HTTPAccessLogEntry::HTTP2);
       break;
     }
   }
@@ -214,45 +295,42 @@ void HttpGrpcAccessLog::log(const Http::HeaderMap* request_headers,
   // HTTP request properities.
   // TODO(mattklein123): Populate port field.
   // TODO(mattklein123): Populate custom request headers.
-  auto* request_properties = log_entry->mutable_request();
-  if (request_headers->Scheme() != nullptr) {
-    request_properties->set_scheme(request_headers->Scheme()->value().c_str());
+  auto* request_properties = log_entry.mutable_request();
+  if (request_headers.Scheme() != nullptr) {
+    request_properties->set_scheme(request_headers.Scheme()->value().c_str());
   }
-  if (request_headers->Host() != nullptr) {
-    request_properties->set_authority(request_headers->Host()->value().c_str());
+  if (request_headers.Host() != nullptr) {
+    request_properties->set_authority(request_headers.Host()->value().c_str());
   }
-  if (request_headers->Path() != nullptr) {
-    request_properties->set_path(request_headers->Path()->value().c_str());
+  if (request_headers.Path() != nullptr) {
+    request_properties->set_path(request_headers.Path()->value().c_str());
   }
-  if (request_headers->UserAgent() != nullptr) {
-    request_properties->set_user_agent(request_headers->UserAgent()->value().c_str());
+  if (request_headers.UserAgent() != nullptr) {
+    request_properties->set_user_agent(request_headers.UserAgent()->value().c_str());
   }
-  if (request_headers->Referer() != nullptr) {
-    request_properties->set_referer(request_headers->Referer()->value().c_str());
+  if (request_headers.Referer() != nullptr) {
+    request_properties->set_referer(request_headers.Referer()->value().c_str());
   }
-  if (request_headers->ForwardedFor() != nullptr) {
-    request_properties->set_forwarded_for(request_headers->ForwardedFor()->value().c_str());
+  if (request_headers.ForwardedFor() != nullptr) {
+    request_properties->set_forwarded_for(request_headers.ForwardedFor()->value().c_str());
   }
-  if (request_headers->RequestId() != nullptr) {
-    request_properties->set_request_id(request_headers->RequestId()->value().c_str());
+  if (request_headers.RequestId() != nullptr) {
+    request_properties->set_request_id(request_headers.RequestId()->value().c_str());
   }
-  if (request_headers->EnvoyOriginalPath() != nullptr) {
-    request_properties->set_original_path(request_headers->EnvoyOriginalPath()->value().c_str());
+  if (request_headers.EnvoyOriginalPath() != nullptr) {
+    request_properties->set_original_path(request_headers.EnvoyOriginalPath()->value().c_str());
   }
-  request_properties->set_request_headers_bytes(request_headers->byteSize());
+  request_properties->set_request_headers_bytes(request_headers.byteSize());
   request_properties->set_request_body_bytes(request_info.bytesReceived());
 
   // HTTP response properties.
   // TODO(mattklein123): Populate custom response headers.
-  auto* response_properties = log_entry->mutable_response();
+  auto* response_properties = log_entry.mutable_response();
   if (request_info.responseCode().valid()) {
     response_properties->mutable_response_code()->set_value(request_info.responseCode().value());
   }
-  response_properties->set_response_headers_bytes(response_headers->byteSize());
+  response_properties->set_response_headers_bytes(response_headers.byteSize());
   response_properties->set_response_body_bytes(request_info.bytesSent());
-
-  // TODO(mattklein123): Consider batching multiple logs and flushing.
-  grpc_access_log_streamer_->send(message, config_.common_config().log_name());
 }
 
 } // namespace AccessLog
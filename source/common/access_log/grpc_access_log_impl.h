@@ -1,11 +1,15 @@
 #pragma once
 
+#include <chrono>
+#include <cstdint>
 #include <unordered_map>
 
 #include "envoy/access_log/access_log.h"
+#include "envoy/event/timer.h"
 #include "envoy/grpc/async_client.h"
 #include "envoy/local_info/local_info.h"
 #include "envoy/singleton/instance.h"
+#include "envoy/stats/stats_macros.h"
 #include "envoy/thread_local/thread_local.h"
 
 #include "api/filter/accesslog/accesslog.pb.h"
@@ -13,7 +17,19 @@
 namespace Envoy {
 namespace AccessLog {
 
-// TODO(mattklein123): Stats
+// clang-format off
+#define ALL_GRPC_ACCESS_LOG_STATS(COUNTER)                                                         \
+  COUNTER(batches_sent)                                                                            \
+  COUNTER(logs_dropped)                                                                            \
+  COUNTER(logs_sent)
+// clang-format on
+
+/**
+ * Struct definition for all gRPC access log stats. @see stats_macros.h
+ */
+struct GrpcAccessLogStats {
+  ALL_GRPC_ACCESS_LOG_STATS(GENERATE_COUNTER_STRUCT)
+};
 
 typedef std::unique_ptr<
     Grpc::AsyncClient<envoy::api::v2::filter::accesslog::StreamAccessLogsMessage,
@@ -44,7 +60,7 @@ public:
   virtual ~GrpcAccessLogStreamer() {}
 
   /**
-   * Send an access log.
+   * Send an access log. The streamer may take the log entries out of the message.
    * @param message supplies the access log to send.
    * @param log_name supplies the name of the log stream to send on.
    */
@@ -56,13 +72,23 @@ typedef std::shared_ptr<GrpcAccessLogStreamer> GrpcAccessLogStreamerSharedPtr;
 
 /**
  * Production implementation of GrpcAccessLogStreamer that supports per-thread and per-log
- * streams.
+ * streams. Each stream collects log entries into a batch that is sent as one message once it holds
+ * max_batch_entries_ entries or max_batch_bytes_ bytes, or flush_interval_ after its first entry.
+ * Entries that would grow a batch beyond max_buffered_bytes_, which can only happen while the
+ * stream cannot be started, are dropped.
  */
 class GrpcAccessLogStreamerImpl : public Singleton::Instance, public GrpcAccessLogStreamer {
 public:
+  struct BatchConfig {
+    uint64_t max_batch_entries_{100};
+    uint64_t max_batch_bytes_{16 * 1024};
+    std::chrono::milliseconds flush_interval_{1000};
+    uint64_t max_buffered_bytes_{1024 * 1024};
+  };
+
   GrpcAccessLogStreamerImpl(GrpcAccessLogClientFactoryPtr&& factory,
-                            ThreadLocal::SlotAllocator& tls,
-                            const LocalInfo::LocalInfo& local_info);
+                            ThreadLocal::SlotAllocator& tls, const LocalInfo::LocalInfo& local_info,
+                            Stats::Scope& scope, const BatchConfig& batch_config);
 
   // GrpcAccessLogStreamer
   void send(envoy::api::v2::filter::accesslog::StreamAccessLogsMessage& message,
@@ -76,11 +102,16 @@ private:
    * slot to be destroyed while the streamers hold onto the shared state.
    */
   struct SharedState {
-    SharedState(GrpcAccessLogClientFactoryPtr&& factory, const LocalInfo::LocalInfo& local_info)
-        : factory_(std::move(factory)), local_info_(local_info) {}
+    SharedState(GrpcAccessLogClientFactoryPtr&& factory, const LocalInfo::LocalInfo& local_info,
+                Stats::Scope& scope, const BatchConfig& batch_config)
+        : factory_(std::move(factory)), local_info_(local_info),
+          stats_{ALL_GRPC_ACCESS_LOG_STATS(POOL_COUNTER_PREFIX(scope, "access_log.grpc."))},
+          batch_config_(batch_config) {}
 
     GrpcAccessLogClientFactoryPtr factory_;
     const LocalInfo::LocalInfo& local_info_;
+    GrpcAccessLogStats stats_;
+    const BatchConfig batch_config_;
   };
 
   typedef std::shared_ptr<SharedState> SharedStateSharedPtr;
@@ -103,19 +134,28 @@ private:
     void onReceiveTrailingMetadata(Http::HeaderMapPtr&&) override {}
     void onRemoteClose(Grpc::Status::GrpcStatus status, const std::string& message) override;
 
+    void add(envoy::api::v2::filter::accesslog::StreamAccessLogsMessage& message);
+    void flush();
+
     ThreadLocalStreamer& parent_;
     const std::string log_name_;
     Grpc::AsyncStream<envoy::api::v2::filter::accesslog::StreamAccessLogsMessage>* stream_{};
+    // The entries waiting to be sent. The message is cleared rather than destroyed after each
+    // send so that the next batch reuses its storage.
+    envoy::api::v2::filter::accesslog::StreamAccessLogsMessage batch_;
+    uint64_t batch_bytes_{};
+    Event::TimerPtr flush_timer_;
   };
 
   /**
    * Per-thread multi-stream state.
    */
   struct ThreadLocalStreamer : public ThreadLocal::ThreadLocalObject {
-    ThreadLocalStreamer(const SharedStateSharedPtr& shared_state);
+    ThreadLocalStreamer(const SharedStateSharedPtr& shared_state, Event::Dispatcher& dispatcher);
     void send(envoy::api::v2::filter::accesslog::StreamAccessLogsMessage& message,
               const std::string& log_name);
 
+    Event::Dispatcher& dispatcher_;
     GrpcAccessLogClientPtr client_;
     std::unordered_map<std::string, ThreadLocalStream> stream_map_;
     SharedStateSharedPtr shared_state_;
@@ -138,10 +178,20 @@ public:
   static void responseFlagsToAccessLogResponseFlags(
       envoy::api::v2::filter::accesslog::AccessLogCommon& common_access_log,
       const RequestInfo::RequestInfo& request_info);
+  /**
+   * Fill in a log entry with the properties of a request.
+   */
+  static void populateLogEntry(envoy::api::v2::filter::accesslog::HTTPAccessLogEntry& log_entry,
+                               const Http::HeaderMap& request_headers,
+                               const Http::HeaderMap& response_headers,
+                               const RequestInfo::RequestInfo& request_info);
 
   // AccessLog::Instance
   void log(const Http::HeaderMap* request_headers, const Http::HeaderMap* response_headers,
            const RequestInfo::RequestInfo& request_info) override;
+  bool mayLog(const Http::HeaderMap& request_headers) override {
+    return !filter_ || filter_->mayPass(request_headers);
+  }
 
 private:
   FilterPtr filter_;
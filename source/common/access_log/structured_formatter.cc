@@ -0,0 +1,164 @@
+#include "common/access_log/structured_formatter.h"
+
+#include <cstdint>
+#include <string>
+
+#include "common/access_log/grpc_access_log_impl.h"
+
+#include "api/filter/accesslog/accesslog.pb.h"
+
+namespace Envoy {
+namespace AccessLog {
+
+namespace {
+
+// @return the length of the JSON string escape of a character.
+size_t escapedLength(char c) {
+  switch (c) {
+  case '"':
+  case '\\':
+  case '\b':
+  case '\f':
+  case '\n':
+  case '\r':
+  case '\t':
+    return 2;
+  default:
+    return static_cast<unsigned char>(c) < 0x20 ? 6 : 1;
+  }
+}
+
+} // namespace
+
+JsonFormatterImpl::JsonFormatterImpl(const std::map<std::string, std::string>& fields) {
+  std::string prefix = "{\"";
+  for (const auto& field : fields) {
+    prefix += field.first;
+    escapeTail(prefix, prefix.size() - field.first.size());
+    prefix += "\":\"";
+    fields_.emplace_back(prefix, AccessLogFormatParser::parse(field.second));
+    prefix = "\",\"";
+  }
+}
+
+const std::map<std::string, std::string>& JsonFormatterImpl::defaultFields() {
+  static const std::map<std::string, std::string>* fields =
+      new std::map<std::string, std::string>{
+          {"authority", "%REQ(:AUTHORITY)%"},
+          {"bytes_received", "%BYTES_RECEIVED%"},
+          {"bytes_sent", "%BYTES_SENT%"},
+          {"duration", "%DURATION%"},
+          {"forwarded_for", "%REQ(X-FORWARDED-FOR)%"},
+          {"method", "%REQ(:METHOD)%"},
+          {"path", "%REQ(X-ENVOY-ORIGINAL-PATH?:PATH)%"},
+          {"protocol", "%PROTOCOL%"},
+          {"request_id", "%REQ(X-REQUEST-ID)%"},
+          {"response_code", "%RESPONSE_CODE%"},
+          {"response_flags", "%RESPONSE_FLAGS%"},
+          {"start_time", "%START_TIME%"},
+          {"upstream_host", "%UPSTREAM_HOST%"},
+          {"upstream_service_time", "%RESP(X-ENVOY-UPSTREAM-SERVICE-TIME)%"},
+          {"user_agent", "%REQ(USER-AGENT)%"},
+      };
+  return *fields;
+}
+
+void JsonFormatterImpl::escapeTail(std::string& output, size_t start) {
+  size_t escaped_size = output.size();
+  for (size_t i = start; i < output.size(); i++) {
+    escaped_size += escapedLength(output[i]) - 1;
+  }
+  if (escaped_size == output.size()) {
+    return;
+  }
+
+  // Move the characters to their escaped position back to front, so that each character is read
+  // before its position is overwritten.
+  static const char hex[] = "0123456789abcdef";
+  size_t read = output.size();
+  size_t write = escaped_size;
+  output.resize(escaped_size);
+  while (read > start) {
+    const char c = output[--read];
+    const size_t length = escapedLength(c);
+    write -= length;
+    if (length == 1) {
+      output[write] = c;
+      continue;
+    }
+
+    output[write] = '\\';
+    switch (c) {
+    case '\b':
+      output[write + 1] = 'b';
+      break;
+    case '\f':
+      output[write + 1] = 'f';
+      break;
+    case '\n':
+      output[write + 1] = 'n';
+      break;
+    case '\r':
+      output[write + 1] = 'r';
+      break;
+    case '\t':
+      output[write + 1] = 't';
+      break;
+    case '"':
+    case '\\':
+      output[write + 1] = c;
+      break;
+    default:
+      output[write + 1] = 'u';
+      output[write + 2] = '0';
+      output[write + 3] = '0';
+      output[write + 4] = hex[(c >> 4) & 0xf];
+      output[write + 5] = hex[c & 0xf];
+      break;
+    }
+  }
+}
+
+void JsonFormatterImpl::formatTo(const Http::HeaderMap& request_headers,
+                                 const Http::HeaderMap& response_headers,
+                                 const RequestInfo::RequestInfo& request_info,
+                                 std::string& output) const {
+  if (fields_.empty()) {
+    output += "{}\n";
+    return;
+  }
+
+  for (const auto& field : fields_) {
+    output += field.first;
+    const size_t start = output.size();
+    for (const FormatterPtr& formatter : field.second) {
+      formatter->formatTo(request_headers, response_headers, request_info, output);
+    }
+    escapeTail(output, start);
+  }
+  output += "\"}\n";
+}
+
+void ProtobufFormatterImpl::appendVarint(std::string& output, uint64_t value) {
+  while (value >= 0x80) {
+    output += static_cast<char>(value | 0x80);
+    value >>= 7;
+  }
+  output += static_cast<char>(value);
+}
+
+void ProtobufFormatterImpl::formatTo(const Http::HeaderMap& request_headers,
+                                     const Http::HeaderMap& response_headers,
+                                     const RequestInfo::RequestInfo& request_info,
+                                     std::string& output) const {
+  // Clear() keeps the storage of the fields, so each thread stops allocating for the entry once
+  // it has logged a few requests.
+  static thread_local envoy::api::v2::filter::accesslog::HTTPAccessLogEntry log_entry;
+  log_entry.Clear();
+  HttpGrpcAccessLog::populateLogEntry(log_entry, request_headers, response_headers, request_info);
+  appendVarint(output, log_entry.ByteSize());
+  log_entry.AppendToString(&output);
+}
+
+} // namespace AccessLog
+} // namespace Envoy
@@ -0,0 +1,67 @@
+#pragma once
+
+#include <map>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "envoy/access_log/access_log.h"
+
+#include "common/access_log/access_log_formatter.h"
+
+namespace Envoy {
+namespace AccessLog {
+
+/**
+ * Formatter that writes each log entry as a JSON object on a line of its own. The value of each
+ * key is a format string in the syntax of AccessLogFormatParser, written as a JSON string.
+ */
+class JsonFormatterImpl : public FormatterBase {
+public:
+  /**
+   * @param fields supplies the format string of each key. Keys are written in their sort order.
+   */
+  JsonFormatterImpl(const std::map<std::string, std::string>& fields);
+
+  /**
+   * @return the fields of the default format, which log the same as the default text format.
+   */
+  static const std::map<std::string, std::string>& defaultFields();
+
+  /**
+   * Escape output from start to its end as the contents of a JSON string, growing it in place.
+   * @param output supplies the string to escape the tail of.
+   * @param start supplies the offset of the first character to escape.
+   */
+  static void escapeTail(std::string& output, size_t start);
+
+  // Formatter::formatTo
+  void formatTo(const Http::HeaderMap& request_headers, const Http::HeaderMap& response_headers,
+                const RequestInfo::RequestInfo& request_info, std::string& output) const override;
+
+private:
+  // The literal that precedes each value, starting with the opening brace or the comma and
+  // ending with the quote that opens the value, and the formatters of the value.
+  std::vector<std::pair<std::string, std::vector<FormatterPtr>>> fields_;
+};
+
+/**
+ * Formatter that writes each log entry as an HTTPAccessLogEntry protobuf, with the same contents
+ * as the entries of the HTTP gRPC access log, preceded by its length as a varint. This is the
+ * framing of protobuf's SerializeDelimitedToOstream(), so the log can be read back with
+ * ParseDelimitedFromZeroCopyStream().
+ */
+class ProtobufFormatterImpl : public FormatterBase {
+public:
+  /**
+   * Append the varint encoding of a value.
+   */
+  static void appendVarint(std::string& output, uint64_t value);
+
+  // Formatter::formatTo
+  void formatTo(const Http::HeaderMap& request_headers, const Http::HeaderMap& response_headers,
+                const RequestInfo::RequestInfo& request_info, std::string& output) const override;
+};
+
+} // namespace AccessLog
+} // namespace Envoy
@@ -14,7 +14,8 @@ namespace Api {
  */
 class Impl : public Api::Api {
 public:
-  Impl(std::chrono::milliseconds file_flush_interval_msec);
+  Impl(std::chrono::milliseconds file_flush_interval_msec,
+       Filesystem::OverflowPolicy file_write_overflow_policy = Filesystem::OverflowPolicy::Spill);
 
   // Api::Api
   Event::DispatcherPtr allocateDispatcher() override;
@@ -26,6 +27,7 @@ public:
 
 private:
   std::chrono::milliseconds file_flush_interval_msec_;
+  Filesystem::OverflowPolicy file_write_overflow_policy_;
 };
 
 } // namespace Api
@@ -1,38 +1,190 @@
 #include "common/buffer/buffer_impl.h"
 
+#include <sys/mman.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+#if defined(__linux__)
+#include <sys/sendfile.h>
+#endif
+
+#if defined(__x86_64__)
+#include <immintrin.h>
+#endif
+
+#include <cerrno>
 #include <cstdint>
+#include <cstring>
 #include <string>
 
-#include "common/common/assert.h"
+#include "envoy/common/exception.h"
 
-#include "event2/buffer.h"
+#include "common/common/assert.h"
+#include "common/common/macros.h"
 
 namespace Envoy {
 namespace Buffer {
 
-// RawSlice is the same structure as evbuffer_iovec. This was put into place to avoid leaking
-// libevent into most code since we will likely replace evbuffer with our own implementation at
-// some point. However, we can avoid a bunch of copies since the structure is the same.
-static_assert(sizeof(RawSlice) == sizeof(evbuffer_iovec), "RawSlice != evbuffer_iovec");
-static_assert(offsetof(RawSlice, mem_) == offsetof(evbuffer_iovec, iov_base),
-              "RawSlice != evbuffer_iovec");
-static_assert(offsetof(RawSlice, len_) == offsetof(evbuffer_iovec, iov_len),
-              "RawSlice != evbuffer_iovec");
+namespace {
 
-void OwnedImpl::add(const void* data, uint64_t size) { evbuffer_add(buffer_.get(), data, size); }
+// Ranges shorter than this are searched with the memchr() anchored scan alone, since the vector
+// scan's setup and scalar tail dominate on them.
+constexpr uint64_t MinVectorSearchLength = 256;
 
-void OwnedImpl::addBufferFragment(BufferFragment& fragment) {
-  evbuffer_add_reference(
-      buffer_.get(), fragment.data(), fragment.size(),
-      [](const void*, size_t, void* arg) { static_cast<BufferFragment*>(arg)->done(); }, &fragment);
+// The functions below find the first occurrence of a needle of `size` >= 2 bytes that lies wholly
+// within [begin, end), returning nullptr if there is none.
+
+const uint8_t* findScalar(const uint8_t* begin, const uint8_t* end, const uint8_t* needle,
+                          size_t size) {
+  if (static_cast<size_t>(end - begin) < size) {
+    return nullptr;
+  }
+  const uint8_t* last = end - size;
+  while (begin <= last) {
+    const uint8_t* match = static_cast<const uint8_t*>(memchr(begin, needle[0], last - begin + 1));
+    if (match == nullptr) {
+      return nullptr;
+    }
+    if (memcmp(match + 1, needle + 1, size - 1) == 0) {
+      return match;
+    }
+    begin = match + 1;
+  }
+  return nullptr;
+}
+
+#if defined(__x86_64__)
+// The vector versions test a block of candidate positions per step by comparing the first byte of
+// the needle against the block and the last byte of the needle against the block offset by
+// size - 1. Only positions where both match are compared in full. Anchoring on two bytes rather
+// than one keeps false candidates rare even when the first byte of the needle is common, e.g.
+// '\r' in "\r\n".
+
+const uint8_t* findSse2(const uint8_t* begin, const uint8_t* end, const uint8_t* needle,
+                        size_t size) {
+  const __m128i first = _mm_set1_epi8(needle[0]);
+  const __m128i last = _mm_set1_epi8(needle[size - 1]);
+  const uint8_t* block = begin;
+  while (static_cast<size_t>(end - block) >= size - 1 + sizeof(__m128i)) {
+    const __m128i block_first = _mm_loadu_si128(reinterpret_cast<const __m128i*>(block));
+    const __m128i block_last =
+        _mm_loadu_si128(reinterpret_cast<const __m128i*>(block + size - 1));
+    uint32_t candidates = _mm_movemask_epi8(
+        _mm_and_si128(_mm_cmpeq_epi8(first, block_first), _mm_cmpeq_epi8(last, block_last)));
+    while (candidates != 0) {
+      const uint8_t* candidate = block + __builtin_ctz(candidates);
+      if (memcmp(candidate + 1, needle + 1, size - 2) == 0) {
+        return candidate;
+      }
+      candidates &= candidates - 1;
+    }
+    block += sizeof(__m128i);
+  }
+  return findScalar(block, end, needle, size);
+}
+
+__attribute__((target("avx2"))) const uint8_t* findAvx2(const uint8_t* begin, const uint8_t* end,
+                                                       const uint8_t* needle, size_t size) {
+  const __m256i first = _mm256_set1_epi8(needle[0]);
+  const __m256i last = _mm256_set1_epi8(needle[size - 1]);
+  const uint8_t* block = begin;
+  while (static_cast<size_t>(end - block) >= size - 1 + sizeof(__m256i)) {
+    const __m256i block_first = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(block));
+    const __m256i block_last =
+        _mm256_loadu_si256(reinterpret_cast<const __m256i*>(block + size - 1));
+    uint32_t candidates = _mm256_movemask_epi8(_mm256_and_si256(
+        _mm256_cmpeq_epi8(first, block_first), _mm256_cmpeq_epi8(last, block_last)));
+    while (candidates != 0) {
+      const uint8_t* candidate = block + __builtin_ctz(candidates);
+      if (memcmp(candidate + 1, needle + 1, size - 2) == 0) {
+        return candidate;
+      }
+      candidates &= candidates - 1;
+    }
+    block += sizeof(__m256i);
+  }
+  return findSse2(block, end, needle, size);
+}
+
+bool cpuHasAvx2() {
+  __builtin_cpu_init();
+  return __builtin_cpu_supports("avx2");
+}
+#endif
+
+// Find the first occurrence of a needle of `size` >= 1 bytes that lies wholly within
+// [begin, end), using the widest vector instructions the CPU supports.
+const uint8_t* findInRange(const uint8_t* begin, const uint8_t* end, const uint8_t* needle,
+                           size_t size) {
+  if (size == 1) {
+    return static_cast<const uint8_t*>(memchr(begin, needle[0], end - begin));
+  }
+#if defined(__x86_64__)
+  static const bool has_avx2 = cpuHasAvx2();
+  return has_avx2 ? findAvx2(begin, end, needle, size) : findSse2(begin, end, needle, size);
+#else
+  return findScalar(begin, end, needle, size);
+#endif
+}
+
+} // namespace
+
+constexpr uint64_t Instance::MaxWriteSlices;
+
+// RawSlice is the same structure as iovec. This allows slices to be handed directly to
+// readv()/writev() without conversion.
+static_assert(sizeof(RawSlice) == sizeof(iovec), "RawSlice != iovec");
+static_assert(offsetof(RawSlice, mem_) == offsetof(iovec, iov_base), "RawSlice != iovec");
+static_assert(offsetof(RawSlice, len_) == offsetof(iovec, iov_len), "RawSlice != iovec");
+
+constexpr uint64_t OwnedSlice::AllocationHeaderSize;
+
+void* OwnedSlice::operator new(size_t object_size, size_t data_size) {
+  const uint64_t allocation_size = AllocationHeaderSize + object_size + data_size;
+  uint8_t* memory = static_cast<uint8_t*>(SlicePool::allocate(allocation_size));
+  *reinterpret_cast<uint64_t*>(memory) = allocation_size;
+  return memory + AllocationHeaderSize;
+}
+
+void OwnedSlice::operator delete(void* address, size_t) { operator delete(address); }
+
+void OwnedSlice::operator delete(void* address) {
+  uint8_t* memory = static_cast<uint8_t*>(address) - AllocationHeaderSize;
+  SlicePool::release(memory, *reinterpret_cast<uint64_t*>(memory));
 }
 
-void OwnedImpl::add(const std::string& data) {
-  evbuffer_add(buffer_.get(), data.c_str(), data.size());
+void OwnedImpl::add(const void* data, uint64_t size) {
+  const char* src = static_cast<const char*>(data);
+  bool new_slice_needed = slices_.empty();
+  while (size != 0) {
+    if (new_slice_needed) {
+      slices_.emplace_back(OwnedSlice::create(size));
+    }
+    uint64_t copy_size = slices_.back()->append(src, size);
+    src += copy_size;
+    size -= copy_size;
+    length_ += copy_size;
+    new_slice_needed = true;
+  }
+}
+
+void OwnedImpl::addBufferFragment(BufferFragment& fragment) {
+  length_ += fragment.size();
+  FileFragment* file_fragment = dynamic_cast<FileFragment*>(&fragment);
+  if (file_fragment != nullptr) {
+    slices_.emplace_back(std::make_unique<FileSlice>(*file_fragment));
+  } else {
+    slices_.emplace_back(std::make_unique<UnownedSlice>(fragment));
+  }
 }
 
+void OwnedImpl::add(const std::string& data) { add(data.data(), data.size()); }
+
 void OwnedImpl::add(const Instance& data) {
   uint64_t num_slices = data.getRawSlices(nullptr, 0);
+  if (num_slices == 0) {
+    return;
+  }
   RawSlice slices[num_slices];
   data.getRawSlices(slices, num_slices);
   for (RawSlice& slice : slices) {
@@ -40,90 +192,488 @@ void OwnedImpl::add(const Instance& data) {
   }
 }
 
+void OwnedImpl::addShared(Instance& data) {
+  // See move() below for why we do the static cast.
+  OwnedImpl& other = static_cast<OwnedImpl&>(data);
+  dropEmptyTailSlices();
+  for (size_t i = 0; i < other.slices_.size(); i++) {
+    if (other.slices_[i]->dataSize() == 0) {
+      continue;
+    }
+    length_ += other.slices_[i]->dataSize();
+    slices_.emplace_back(SharedSlice::share(other.slices_[i]));
+  }
+}
+
+std::shared_ptr<const void> OwnedImpl::pinFront() {
+  // The first slice with content is the first one that getRawSlices() returns.
+  for (size_t i = 0; i < slices_.size(); i++) {
+    if (slices_[i]->dataSize() > 0) {
+      return SharedSlice::pin(slices_[i]);
+    }
+  }
+  return nullptr;
+}
+
 void OwnedImpl::commit(RawSlice* iovecs, uint64_t num_iovecs) {
-  int rc =
-      evbuffer_commit_space(buffer_.get(), reinterpret_cast<evbuffer_iovec*>(iovecs), num_iovecs);
-  ASSERT(rc == 0);
-  UNREFERENCED_PARAMETER(rc);
+  if (num_iovecs == 0 || slices_.empty()) {
+    return;
+  }
+
+  // Find the slices in the buffer that correspond to the iovecs. Reservations are made from the
+  // end of the buffer and out-of-order commits aren't supported, so scan backward from the end of
+  // the buffer to the last slice containing any content; no slice before it can match.
+  ssize_t slice_index = static_cast<ssize_t>(slices_.size()) - 1;
+  while (slice_index >= 0 && slices_[slice_index]->dataSize() == 0) {
+    slice_index--;
+  }
+  if (slice_index < 0) {
+    // There was no slice containing any data, so rewind the iterator to the first slice.
+    slice_index = 0;
+  }
+
+  // Next, scan forward and attempt to match the slices against the iovecs.
+  uint64_t num_slices_committed = 0;
+  while (num_slices_committed < num_iovecs &&
+         slice_index < static_cast<ssize_t>(slices_.size())) {
+    if (iovecs[num_slices_committed].len_ == 0) {
+      // Nothing to commit for this iovec.
+      num_slices_committed++;
+      continue;
+    }
+    if (slices_[slice_index]->commit(iovecs[num_slices_committed])) {
+      length_ += iovecs[num_slices_committed].len_;
+      num_slices_committed++;
+    }
+    slice_index++;
+  }
+
+  ASSERT(num_slices_committed == num_iovecs);
 }
 
 void OwnedImpl::copyOut(size_t start, uint64_t size, void* data) const {
   ASSERT(start + size <= length());
 
-  evbuffer_ptr start_ptr;
-  int rc = evbuffer_ptr_set(buffer_.get(), &start_ptr, start, EVBUFFER_PTR_SET);
-  ASSERT(rc != -1);
-  UNREFERENCED_PARAMETER(rc);
-
-  ev_ssize_t copied = evbuffer_copyout_from(buffer_.get(), &start_ptr, data, size);
-  ASSERT(static_cast<uint64_t>(copied) == size);
-  UNREFERENCED_PARAMETER(copied);
+  uint64_t bytes_to_skip = start;
+  uint8_t* dest = static_cast<uint8_t*>(data);
+  for (size_t i = 0; i < slices_.size() && size != 0; i++) {
+    const auto& slice = slices_[i];
+    uint64_t data_size = slice->dataSize();
+    if (data_size <= bytes_to_skip) {
+      // The offset where the caller wants to start copying is after the end of this slice,
+      // so just skip over this slice completely.
+      bytes_to_skip -= data_size;
+      continue;
+    }
+    uint64_t copy_size = std::min(size, data_size - bytes_to_skip);
+    memcpy(dest, slice->data() + bytes_to_skip, copy_size);
+    size -= copy_size;
+    dest += copy_size;
+    // Now that we've started copying, there are no bytes left to skip over. If there
+    // is any more data to be copied, the next iteration can start copying from the very
+    // beginning of the next slice.
+    bytes_to_skip = 0;
+  }
+  ASSERT(size == 0);
 }
 
-void OwnedImpl::drain(uint64_t size) {
-  ASSERT(size <= length());
-  int rc = evbuffer_drain(buffer_.get(), size);
-  ASSERT(rc == 0);
-  UNREFERENCED_PARAMETER(rc);
+void OwnedImpl::drain(uint64_t size) { drainImpl(size); }
+
+void OwnedImpl::drainImpl(uint64_t size) {
+  ASSERT(size <= length_);
+  while (size != 0 && !slices_.empty()) {
+    uint64_t slice_size = slices_.front()->dataSize();
+    if (slice_size <= size) {
+      slices_.pop_front();
+      length_ -= slice_size;
+      size -= slice_size;
+    } else {
+      slices_.front()->drain(size);
+      length_ -= size;
+      size = 0;
+    }
+  }
+  // Release any leading empty slices (e.g. abandoned reservations) so the front of the queue
+  // always holds data when the buffer is not empty.
+  while (!slices_.empty() && slices_.front()->dataSize() == 0 && slices_.size() > 1) {
+    slices_.pop_front();
+  }
 }
 
 uint64_t OwnedImpl::getRawSlices(RawSlice* out, uint64_t out_size) const {
-  return evbuffer_peek(buffer_.get(), -1, nullptr, reinterpret_cast<evbuffer_iovec*>(out),
-                       out_size);
+  uint64_t num_slices = 0;
+  for (size_t i = 0; i < slices_.size(); i++) {
+    const auto& slice = slices_[i];
+    if (slice->dataSize() == 0) {
+      continue;
+    }
+    if (num_slices < out_size) {
+      out[num_slices].mem_ = const_cast<uint8_t*>(slice->data());
+      out[num_slices].len_ = slice->dataSize();
+    }
+    // Per the definition of getRawSlices in include/envoy/buffer/buffer.h, we need to return
+    // the total number of slices needed to access all the data in the buffer, which can be
+    // larger than out_size. So we keep iterating and counting non-empty slices here, even if
+    // all the caller-supplied slices have been filled.
+    num_slices++;
+  }
+  return num_slices;
 }
 
-uint64_t OwnedImpl::length() const { return evbuffer_get_length(buffer_.get()); }
+uint64_t OwnedImpl::length() const { return length_; }
 
 void* OwnedImpl::linearize(uint32_t size) {
   ASSERT(size <= length());
-  return evbuffer_pullup(buffer_.get(), size);
+  if (slices_.empty() || length_ == 0) {
+    return nullptr;
+  }
+  if (slices_.front()->dataSize() < size) {
+    SlicePtr new_slice = OwnedSlice::create(size);
+    RawSlice reservation = new_slice->reserve(size);
+    ASSERT(reservation.mem_ != nullptr);
+    ASSERT(reservation.len_ == size);
+    copyOut(0, size, reservation.mem_);
+    new_slice->commit(reservation);
+
+    // Replace the first 'size' bytes in the buffer with the new slice. Since new_slice re-adds the
+    // drained bytes, avoid use of the overridable 'drain' method to avoid incorrectly checking if
+    // we dipped below low-watermark.
+    drainImpl(size);
+    slices_.emplace_front(std::move(new_slice));
+    length_ += size;
+  }
+  return slices_.front()->data();
 }
 
 void OwnedImpl::move(Instance& rhs) {
   // We do the static cast here because in practice we only have one buffer implementation right
-  // now and this is safe. Using the evbuffer move routines require having access to both evbuffers.
-  // This is a reasonable compromise in a high performance path where we want to maintain an
-  // abstraction in case we get rid of evbuffer later.
-  int rc = evbuffer_add_buffer(buffer_.get(), static_cast<LibEventInstance&>(rhs).buffer().get());
-  ASSERT(rc == 0);
-  UNREFERENCED_PARAMETER(rc);
-  static_cast<LibEventInstance&>(rhs).postProcess();
+  // now and this is safe. Moving slices requires having access to the slice queues of both
+  // buffers. This is a reasonable compromise in a high performance path where we want to maintain
+  // an abstraction.
+  OwnedImpl& other = static_cast<OwnedImpl&>(rhs);
+  dropEmptyTailSlices();
+  while (!other.slices_.empty()) {
+    const uint64_t slice_size = other.slices_.front()->dataSize();
+    if (slice_size != 0) {
+      length_ += slice_size;
+      slices_.emplace_back(std::move(other.slices_.front()));
+      other.length_ -= slice_size;
+    }
+    other.slices_.pop_front();
+  }
+  ASSERT(other.length_ == 0);
+  other.postProcess();
 }
 
 void OwnedImpl::move(Instance& rhs, uint64_t length) {
   // See move() above for why we do the static cast.
-  int rc = evbuffer_remove_buffer(static_cast<LibEventInstance&>(rhs).buffer().get(), buffer_.get(),
-                                  length);
-  ASSERT(static_cast<uint64_t>(rc) == length);
-  UNREFERENCED_PARAMETER(rc);
-  static_cast<LibEventInstance&>(rhs).postProcess();
+  OwnedImpl& other = static_cast<OwnedImpl&>(rhs);
+  ASSERT(length <= other.length_);
+  dropEmptyTailSlices();
+  while (length != 0 && !other.slices_.empty()) {
+    SlicePtr& other_slice = other.slices_.front();
+    const uint64_t slice_size = other_slice->dataSize();
+    const uint64_t copy_size = std::min(slice_size, length);
+    if (copy_size == 0) {
+      other.slices_.pop_front();
+    } else if (copy_size < slice_size) {
+      // Only part of this slice is moving. Small partial moves are cheaper to copy; large ones
+      // are done by sharing the underlying storage between both buffers.
+      if (copy_size < PartialMoveShareThreshold) {
+        add(other_slice->data(), copy_size);
+      } else {
+        SlicePtr shared = SharedSlice::share(other_slice);
+        slices_.emplace_back(static_cast<SharedSlice&>(*shared).prefix(copy_size));
+        length_ += copy_size;
+      }
+      other_slice->drain(copy_size);
+      other.length_ -= copy_size;
+    } else {
+      slices_.emplace_back(std::move(other_slice));
+      other.slices_.pop_front();
+      length_ += slice_size;
+      other.length_ -= slice_size;
+    }
+    length -= copy_size;
+  }
+  other.postProcess();
 }
 
 int OwnedImpl::read(int fd, uint64_t max_length) {
-  return evbuffer_read(buffer_.get(), fd, max_length);
+  if (max_length == 0) {
+    return 0;
+  }
+  constexpr uint64_t MaxSlices = 2;
+  RawSlice slices[MaxSlices];
+  uint64_t num_slices = reserve(max_length, slices, MaxSlices);
+  // The reservation can be larger than requested. Only offer max_length bytes of it to readv().
+  uint64_t bytes_to_offer = max_length;
+  for (uint64_t i = 0; i < num_slices; i++) {
+    if (bytes_to_offer == 0) {
+      num_slices = i;
+      break;
+    }
+    slices[i].len_ = std::min(slices[i].len_, static_cast<size_t>(bytes_to_offer));
+    bytes_to_offer -= slices[i].len_;
+  }
+  const ssize_t rc = ::readv(fd, reinterpret_cast<iovec*>(slices), num_slices);
+  if (rc < 0) {
+    return rc;
+  }
+  uint64_t num_slices_to_commit = 0;
+  uint64_t bytes_to_commit = rc;
+  while (bytes_to_commit != 0) {
+    slices[num_slices_to_commit].len_ =
+        std::min(slices[num_slices_to_commit].len_, static_cast<size_t>(bytes_to_commit));
+    bytes_to_commit -= slices[num_slices_to_commit].len_;
+    num_slices_to_commit++;
+  }
+  ASSERT(num_slices_to_commit <= num_slices);
+  commit(slices, num_slices_to_commit);
+  return rc;
 }
 
 uint64_t OwnedImpl::reserve(uint64_t length, RawSlice* iovecs, uint64_t num_iovecs) {
-  uint64_t ret = evbuffer_reserve_space(buffer_.get(), length,
-                                        reinterpret_cast<evbuffer_iovec*>(iovecs), num_iovecs);
-  ASSERT(ret >= 1);
-  return ret;
+  if (num_iovecs == 0 || length == 0) {
+    return 0;
+  }
+
+  // Find the sequence of reservable slices at the back of the buffer: the last slice containing
+  // content (if it has reservable space) followed by any empty slices left over from earlier
+  // reservations.
+  size_t first_reservable_slice = slices_.size();
+  while (first_reservable_slice > 0) {
+    if (slices_[first_reservable_slice - 1]->reservableSize() == 0) {
+      break;
+    }
+    first_reservable_slice--;
+    if (slices_[first_reservable_slice]->dataSize() != 0) {
+      // There is some content in this slice, so anything in front of it is non-reservable.
+      break;
+    }
+  }
+
+  // Having found the sequence of reservable slices at the back of the buffer, reserve as much
+  // space as possible from each one.
+  uint64_t num_slices_used = 0;
+  uint64_t bytes_remaining = length;
+  size_t slice_index = first_reservable_slice;
+  while (slice_index < slices_.size() && bytes_remaining != 0 && num_slices_used < num_iovecs) {
+    auto& slice = slices_[slice_index];
+    const uint64_t reservation_size = std::min(slice->reservableSize(), bytes_remaining);
+    if (num_slices_used + 1 == num_iovecs && reservation_size < bytes_remaining) {
+      // There is only one iovec left, and this next slice does not have enough space to complete
+      // the reservation. Stop iterating, with the last iovec still unpopulated, so the code
+      // following this loop can allocate a new slice to hold the rest of the reservation.
+      break;
+    }
+    iovecs[num_slices_used] = slice->reserve(reservation_size);
+    bytes_remaining -= iovecs[num_slices_used].len_;
+    num_slices_used++;
+    slice_index++;
+  }
+
+  // If needed, allocate one more slice at the end to provide the remainder of the reservation.
+  if (bytes_remaining != 0) {
+    slices_.emplace_back(OwnedSlice::create(bytes_remaining));
+    iovecs[num_slices_used] = slices_.back()->reserve(bytes_remaining);
+    bytes_remaining -= iovecs[num_slices_used].len_;
+    num_slices_used++;
+  }
+
+  ASSERT(num_slices_used <= num_iovecs);
+  ASSERT(bytes_remaining == 0);
+  return num_slices_used;
 }
 
 ssize_t OwnedImpl::search(const void* data, uint64_t size, size_t start) const {
-  evbuffer_ptr start_ptr;
-  if (-1 == evbuffer_ptr_set(buffer_.get(), &start_ptr, start, EVBUFFER_PTR_SET)) {
+  // Each long slice is scanned in two steps. Matches that lie wholly within the slice are found
+  // with a vectorized scan. Only if there are none are the last size - 1 positions of the slice
+  // checked for a match that continues into the following slices. Since those positions come after
+  // all of the in-slice ones, the first match found is the first match in the buffer. Short slices
+  // are scanned in one step by looking for the first byte of the needle with memchr().
+  if (start > length_) {
     return -1;
   }
+  if (size == 0) {
+    return start;
+  }
+  ssize_t offset = 0;
+  const uint8_t* needle = static_cast<const uint8_t*>(data);
+  for (size_t slice_index = 0; slice_index < slices_.size(); slice_index++) {
+    const auto& slice = slices_[slice_index];
+    uint64_t slice_size = slice->dataSize();
+    if (slice_size <= start) {
+      start -= slice_size;
+      offset += slice_size;
+      continue;
+    }
+    const uint8_t* slice_start = slice->data();
+    const uint8_t* haystack_end = slice_start + slice_size;
+    const uint8_t* haystack = slice_start + start;
+    if (static_cast<uint64_t>(haystack_end - haystack) >= std::max(size, MinVectorSearchLength)) {
+      const uint8_t* match = findInRange(haystack, haystack_end, needle, size);
+      if (match != nullptr) {
+        return offset + (match - slice_start);
+      }
+      // Only the positions from which the needle would run past the end of the slice are left.
+      haystack = haystack_end - size + 1;
+    }
+    while (haystack < haystack_end) {
+      const uint8_t* first_byte_match =
+          static_cast<const uint8_t*>(memchr(haystack, needle[0], haystack_end - haystack));
+      if (first_byte_match == nullptr) {
+        break;
+      }
+      // After finding a match for the first byte of the needle, check whether the following
+      // bytes in the buffer match the remainder of the needle. Note that the match can span
+      // two or more slices.
+      size_t i = 1;
+      size_t match_index = slice_index;
+      const uint8_t* match_next = first_byte_match + 1;
+      const uint8_t* match_end = haystack_end;
+      while (i < size) {
+        if (match_next >= match_end) {
+          // We've hit the end of this slice, so continue checking against the next slice.
+          match_index++;
+          if (match_index == slices_.size()) {
+            // We've hit the end of the entire buffer.
+            break;
+          }
+          const auto& match_slice = slices_[match_index];
+          match_next = match_slice->data();
+          match_end = match_next + match_slice->dataSize();
+          continue;
+        }
+        if (*match_next++ != needle[i]) {
+          break;
+        }
+        i++;
+      }
+      if (i == size) {
+        // Successful match of the entire needle.
+        return offset + (first_byte_match - slice_start);
+      }
+      // If this wasn't a successful match, start scanning again at the next byte.
+      haystack = first_byte_match + 1;
+    }
+    start = 0;
+    offset += slice_size;
+  }
+  return -1;
+}
+
+int OwnedImpl::write(int fd) {
+  // Runs of in-memory slices go out in one writev() each. File-backed slices are sent straight
+  // from the file, which takes a syscall per slice, so the loop only continues while each call
+  // is accepted in full.
+  uint64_t bytes_written = 0;
+  uint64_t slices_offered = 0;
+  size_t index = 0;
+  while (index < slices_.size() && slices_offered < MaxWriteSlices) {
+    ssize_t rc;
+    uint64_t bytes_offered = 0;
+    const FileSlice* file_slice = sendableFileSlice(*slices_[index]);
+    if (file_slice != nullptr) {
+      bytes_offered = file_slice->dataSize();
+      rc = sendFile(fd, *file_slice);
+      index++;
+      slices_offered++;
+    } else {
+      RawSlice slices[MaxWriteSlices];
+      uint64_t num_slices = 0;
+      for (; index < slices_.size() && slices_offered < MaxWriteSlices; index++) {
+        Slice& slice = *slices_[index];
+        if (slice.dataSize() == 0) {
+          continue;
+        }
+        if (sendableFileSlice(slice) != nullptr) {
+          break;
+        }
+        slices[num_slices++] = {slice.data(), static_cast<size_t>(slice.dataSize())};
+        bytes_offered += slice.dataSize();
+        slices_offered++;
+      }
+      if (num_slices == 0) {
+        break;
+      }
+      rc = ::writev(fd, reinterpret_cast<iovec*>(slices), num_slices);
+    }
+
+    if (rc < 0) {
+      if (bytes_written == 0) {
+        return -1;
+      }
+      // Some data already made it out, so it is drained and the error is reported on the next
+      // call.
+      break;
+    }
+    bytes_written += rc;
+    if (static_cast<uint64_t>(rc) < bytes_offered) {
+      break;
+    }
+  }
+
+  drainImpl(bytes_written);
+  return static_cast<int>(bytes_written);
+}
 
-  evbuffer_ptr result_ptr =
-      evbuffer_search(buffer_.get(), static_cast<const char*>(data), size, &start_ptr);
-  return result_ptr.pos;
+const FileSlice* OwnedImpl::sendableFileSlice(const Slice& slice) {
+#if defined(__linux__)
+  return slice.dataSize() > 0 ? dynamic_cast<const FileSlice*>(&slice) : nullptr;
+#else
+  // Without sendfile() file-backed slices are written from their memory mapping.
+  UNREFERENCED_PARAMETER(slice);
+  return nullptr;
+#endif
 }
 
-int OwnedImpl::write(int fd) { return evbuffer_write(buffer_.get(), fd); }
+ssize_t OwnedImpl::sendFile(int fd, const FileSlice& slice) {
+#if defined(__linux__)
+  off_t offset = slice.fileOffset();
+  const ssize_t rc = ::sendfile(fd, slice.fd(), &offset, slice.dataSize());
+  if (rc == 0) {
+    // The file is shorter than the fragment claimed. There is no way to make progress.
+    errno = EIO;
+    return -1;
+  }
+  return rc;
+#else
+  UNREFERENCED_PARAMETER(fd);
+  UNREFERENCED_PARAMETER(slice);
+  NOT_REACHED;
+#endif
+}
+
+void OwnedImpl::dropEmptyTailSlices() {
+  while (!slices_.empty() && slices_.back()->dataSize() == 0) {
+    slices_.pop_back();
+  }
+}
+
+FileFragmentImpl::FileFragmentImpl(int fd, uint64_t offset, uint64_t size,
+                                   const std::function<void(const FileFragmentImpl*)>& releasor)
+    : fd_(fd), offset_(offset), size_(size), releasor_(releasor) {
+  if (size_ == 0) {
+    return;
+  }
+  static const uint64_t page_size = ::sysconf(_SC_PAGESIZE);
+  mapping_offset_ = offset_ - offset_ % page_size;
+  void* mapping = ::mmap(nullptr, size_ + (offset_ - mapping_offset_), PROT_READ, MAP_SHARED, fd_,
+                         mapping_offset_);
+  if (mapping == MAP_FAILED) {
+    throw EnvoyException(std::string("unable to map file region: ") + strerror(errno));
+  }
+  mapping_ = static_cast<uint8_t*>(mapping);
+}
+
+FileFragmentImpl::~FileFragmentImpl() {
+  if (mapping_ != nullptr) {
+    ::munmap(mapping_, size_ + (offset_ - mapping_offset_));
+  }
+}
 
-OwnedImpl::OwnedImpl() : buffer_(evbuffer_new()) {}
+OwnedImpl::OwnedImpl() {}
 
 OwnedImpl::OwnedImpl(const std::string& data) : OwnedImpl() { add(data); }
 
@@ -1,16 +1,432 @@
 #pragma once
 
+#include <sys/types.h>
+
+#include <algorithm>
 #include <cstdint>
+#include <cstring>
+#include <functional>
+#include <memory>
 #include <string>
 
 #include "envoy/buffer/buffer.h"
 
+#include "common/buffer/slice_pool.h"
+#include "common/common/assert.h"
 #include "common/common/non_copyable.h"
-#include "common/event/libevent.h"
 
 namespace Envoy {
 namespace Buffer {
 
+/**
+ * A Slice manages a contiguous block of bytes.
+ * The block is arranged like this:
+ *                   |<- data_size() -->|<- reservable_size() ->|
+ * +-----------------+------------------+-----------------------+
+ * | Drained         | Data             | Reservable            |
+ * | Unused space    | Usable content   | New content can be    |
+ * | that formerly   |                  | added here with       |
+ * | was in the Data |                  | reserve()/commit()    |
+ * | section         |                  |                       |
+ * +-----------------+------------------+-----------------------+
+ *                   ^                  ^                       ^
+ *                   |                  |                       |
+ *                   base_ + data_      base_ + reservable_     base_ + capacity_
+ */
+class Slice {
+public:
+  virtual ~Slice() {}
+
+  /**
+   * @return a pointer to the start of the usable content.
+   */
+  const uint8_t* data() const { return base_ + data_; }
+
+  /**
+   * @return a pointer to the start of the usable content.
+   */
+  uint8_t* data() { return base_ + data_; }
+
+  /**
+   * @return the size in bytes of the usable content.
+   */
+  uint64_t dataSize() const { return reservable_ - data_; }
+
+  /**
+   * Remove the first `size` bytes of usable content. Runs in O(1) time.
+   * @param size number of bytes to remove. If greater than data_size(), the result is undefined.
+   */
+  void drain(uint64_t size) {
+    ASSERT(data_ + size <= reservable_);
+    data_ += size;
+    if (data_ == reservable_ && reservable_ != capacity_) {
+      // All the data in the slice has been drained. Reset the offsets so all the data can be
+      // reused, unless the slice is full in which case there is nothing left to reuse.
+      data_ = reservable_ = 0;
+    }
+  }
+
+  /**
+   * @return the number of bytes available to be reserved.
+   * @note Read-only implementations of Slice should return zero from this method.
+   */
+  uint64_t reservableSize() const { return capacity_ - reservable_; }
+
+  /**
+   * Reserve `size` bytes that the caller can populate with content. The caller SHOULD then
+   * call commit() to add the newly populated content from the Reserved section to the Data
+   * section.
+   * @note If there is already an outstanding reservation (i.e., a reservation obtained
+   *       from reserve() that has not been released by calling commit()), this method will
+   *       return the same reservation, truncated to `size`.
+   * @param size the number of bytes to reserve. The Slice implementation MAY reserve
+   *        fewer bytes than requested (for example, if it doesn't have enough room in the
+   *        Reservable section to fulfill the whole request).
+   * @return a tuple containing the address of the start of resulting reservation and the
+   *         reservation size in bytes. If the address is null, the reservation failed.
+   */
+  RawSlice reserve(uint64_t size) {
+    if (size == 0) {
+      return {nullptr, 0};
+    }
+    const uint64_t available_size = capacity_ - reservable_;
+    if (available_size == 0) {
+      return {nullptr, 0};
+    }
+    const uint64_t reservation_size = std::min(size, available_size);
+    void* reservation = &(base_[reservable_]);
+    return {reservation, static_cast<size_t>(reservation_size)};
+  }
+
+  /**
+   * Commit a Reservation that was previously obtained from a call to reserve().
+   * The Reservation's size is added to the Data section.
+   * @param reservation a reservation obtained from a previous call to reserve().
+   *        If the reservation is not from this Slice, commit() will return false.
+   *        If the caller is committing fewer bytes than provided by reserve(), it
+   *        should change the mem_ field of the reservation before calling commit().
+   *        For example, if a caller reserve()s 4KB to do a nonblocking socket read,
+   *        and the read only returns two bytes, the caller should set
+   *        reservation.mem_ = 2 and then call `commit(reservation)`.
+   * @return whether the Reservation was successfully committed to the Slice.
+   */
+  bool commit(const RawSlice& reservation) {
+    if (static_cast<const uint8_t*>(reservation.mem_) != base_ + reservable_ ||
+        reservable_ + reservation.len_ > capacity_ || reservable_ >= capacity_) {
+      // The reservation is not from this OwnedSlice.
+      return false;
+    }
+    reservable_ += reservation.len_;
+    return true;
+  }
+
+  /**
+   * Copy as much of the supplied data as possible to the end of the slice.
+   * @param data start of the data to copy.
+   * @param size number of bytes to copy.
+   * @return number of bytes copied (may be a smaller than size, may even be zero).
+   */
+  uint64_t append(const void* data, uint64_t size) {
+    uint64_t copy_size = std::min(size, reservableSize());
+    uint8_t* dest = base_ + reservable_;
+    reservable_ += copy_size;
+    memcpy(dest, data, copy_size);
+    return copy_size;
+  }
+
+protected:
+  Slice(uint64_t data, uint64_t reservable, uint64_t capacity)
+      : data_(data), reservable_(reservable), capacity_(capacity) {}
+
+  /** Start of the slice - subclasses must set this */
+  uint8_t* base_{nullptr};
+
+  /** Offset in bytes from the start of the slice to the start of the Data section */
+  uint64_t data_;
+
+  /** Offset in bytes from the start of the slice to the start of the Reservable section */
+  uint64_t reservable_;
+
+  /** Total number of bytes in the slice */
+  uint64_t capacity_;
+};
+
+typedef std::unique_ptr<Slice> SlicePtr;
+typedef std::shared_ptr<Slice> SliceSharedPtr;
+
+/**
+ * A Slice that owns its storage. The storage is allocated inline, directly after the slice
+ * header, so that creating a slice costs exactly one heap allocation.
+ */
+class OwnedSlice : public Slice {
+public:
+  /**
+   * Create an empty OwnedSlice.
+   * @param capacity number of bytes of space the slice should have.
+   * @return an OwnedSlice with at least the specified capacity.
+   */
+  static SlicePtr create(uint64_t capacity) {
+    uint64_t slice_capacity = sliceSize(capacity);
+    return SlicePtr(new (slice_capacity) OwnedSlice(slice_capacity));
+  }
+
+  /**
+   * Create an OwnedSlice and initialize it with a copy of the supplied copy.
+   * @param data the content to copy into the slice.
+   * @param size length of the content.
+   * @return an OwnedSlice containing a copy of the content, which may (dependent on
+   *         the internal implementation) have a nonzero amount of reservable space at the end.
+   */
+  static SlicePtr create(const void* data, uint64_t size) {
+    uint64_t slice_capacity = sliceSize(size);
+    OwnedSlice* slice = new (slice_capacity) OwnedSlice(slice_capacity);
+    memcpy(slice->base_, data, size);
+    slice->reservable_ = size;
+    return SlicePtr(slice);
+  }
+
+  // Allocate the slice header and its storage in a single block drawn from the per-thread
+  // SlicePool. The matching placement delete is required so that the compiler can pair it with
+  // the placement form if the constructor throws.
+  static void* operator new(size_t object_size, size_t data_size);
+  static void operator delete(void* address, size_t data_size);
+  static void operator delete(void* address);
+
+private:
+  // The allocation size is stored in front of the slice so that operator delete can return the
+  // memory to the right pool size class. 16 bytes keeps the slice maximally aligned.
+  static constexpr uint64_t AllocationHeaderSize = 16;
+
+  OwnedSlice(uint64_t size) : Slice(0, 0, size) { base_ = storage_; }
+
+  /**
+   * Compute a slice size big enough to hold a specified amount of data.
+   * @param data_size the minimum amount of data the slice must be able to store, in bytes.
+   * @return a recommended slice size, in bytes. The slice, its header and the allocation header
+   *         together fill a SlicePool size class (or, for large slices, a multiple of the page
+   *         size), so no part of the allocation is wasted.
+   */
+  static uint64_t sliceSize(uint64_t data_size) {
+    const uint64_t overhead = AllocationHeaderSize + sizeof(OwnedSlice);
+    return SlicePool::allocationSize(overhead + data_size) - overhead;
+  }
+
+  uint8_t storage_[];
+};
+
+/**
+ * A Slice that wraps an externally owned BufferFragment. The fragment's done() is called when the
+ * slice is destroyed. The slice is read-only: it has no reservable space.
+ */
+class UnownedSlice : public Slice {
+public:
+  UnownedSlice(BufferFragment& fragment)
+      : Slice(0, fragment.size(), fragment.size()), fragment_(fragment) {
+    base_ = static_cast<uint8_t*>(const_cast<void*>(fragment.data()));
+  }
+
+  ~UnownedSlice() override { fragment_.done(); }
+
+private:
+  BufferFragment& fragment_;
+};
+
+/**
+ * An UnownedSlice over a FileFragment. It tracks where its remaining content lives in the file so
+ * that it can be written to a socket without reading it into memory.
+ */
+class FileSlice : public UnownedSlice {
+public:
+  FileSlice(FileFragment& fragment) : UnownedSlice(fragment), file_fragment_(fragment) {}
+
+  /**
+   * @return int the descriptor of the file holding the slice content.
+   */
+  int fd() const { return file_fragment_.fd(); }
+
+  /**
+   * @return uint64_t the offset in the file of the first byte of the slice content.
+   */
+  uint64_t fileOffset() const { return file_fragment_.offset() + data_; }
+
+private:
+  const FileFragment& file_fragment_;
+};
+
+/**
+ * A read-only Slice that references a window of another, reference-counted slice. Any number of
+ * buffers can hold SharedSlices over the same storage; the storage is released when the last
+ * reference is destroyed. Draining a SharedSlice only moves its own window.
+ */
+class SharedSlice : public Slice {
+public:
+  SharedSlice(const SliceSharedPtr& storage, const uint8_t* data, uint64_t size)
+      : Slice(0, size, size), storage_(storage) {
+    base_ = const_cast<uint8_t*>(data);
+  }
+
+  /**
+   * Convert a slice into a reference-counted one, in place, and return a new reference to it.
+   * The content of `slice` is unchanged, but it becomes read-only.
+   * @param slice supplies the slice to share. It is replaced by a SharedSlice if it is not one.
+   * @return SlicePtr a new SharedSlice covering the same content as `slice`.
+   */
+  static SlicePtr share(SlicePtr& slice) {
+    SharedSlice* shared = dynamic_cast<SharedSlice*>(slice.get());
+    if (shared == nullptr) {
+      const uint8_t* data = slice->data();
+      const uint64_t size = slice->dataSize();
+      SliceSharedPtr storage(std::move(slice));
+      shared = new SharedSlice(storage, data, size);
+      slice.reset(shared);
+    }
+    return SlicePtr{new SharedSlice(shared->storage_, shared->data(), shared->dataSize())};
+  }
+
+  /**
+   * Convert a slice into a reference-counted one, in place, and return a reference to its storage
+   * that keeps it allocated. Since the slice becomes read-only, nothing is written to the storage
+   * through the slice again.
+   * @param slice supplies the slice to pin. It is replaced by a SharedSlice if it is not one.
+   * @return SliceSharedPtr the storage, or nullptr if it is already referenced from elsewhere.
+   */
+  static SliceSharedPtr pin(SlicePtr& slice) {
+    SharedSlice* shared = dynamic_cast<SharedSlice*>(slice.get());
+    if (shared == nullptr) {
+      const uint8_t* data = slice->data();
+      const uint64_t size = slice->dataSize();
+      SliceSharedPtr storage(std::move(slice));
+      slice.reset(new SharedSlice(storage, data, size));
+      return storage;
+    }
+    return shared->storage_.use_count() == 1 ? shared->storage_ : nullptr;
+  }
+
+  /**
+   * @return SlicePtr a new SharedSlice over the first `size` bytes of this slice's content.
+   */
+  SlicePtr prefix(uint64_t size) const {
+    ASSERT(size <= dataSize());
+    return SlicePtr{new SharedSlice(storage_, data(), size)};
+  }
+
+private:
+  SliceSharedPtr storage_;
+};
+
+/**
+ * Queue of SlicePtr that supports efficient read and write access to both
+ * the front and the back of the queue. The first few entries are stored inline in the deque
+ * itself, so that the common case of a buffer with a handful of slices needs no extra allocation
+ * for the slice index.
+ * @note This class has similar properties to std::deque<T>. The reason for using
+ *       a custom deque implementation is that benchmark testing during development
+ *       revealed that std::deque was too slow to reach performance parity with the
+ *       prior evbuffer-based buffer implementation.
+ */
+class SliceDeque : NonCopyable {
+public:
+  SliceDeque() : ring_(inline_ring_), start_(0), size_(0), capacity_(InlineRingCapacity) {}
+
+  void emplace_back(SlicePtr&& slice) {
+    growRing();
+    size_t index = internalIndex(size_);
+    ring_[index] = std::move(slice);
+    size_++;
+  }
+
+  void emplace_front(SlicePtr&& slice) {
+    growRing();
+    start_ = (start_ == 0) ? capacity_ - 1 : start_ - 1;
+    ring_[start_] = std::move(slice);
+    size_++;
+  }
+
+  bool empty() const { return size() == 0; }
+  size_t size() const { return size_; }
+
+  SlicePtr& front() { return ring_[start_]; }
+  const SlicePtr& front() const { return ring_[start_]; }
+  SlicePtr& back() { return ring_[internalIndex(size_ - 1)]; }
+  const SlicePtr& back() const { return ring_[internalIndex(size_ - 1)]; }
+
+  SlicePtr& operator[](size_t i) { return ring_[internalIndex(i)]; }
+  const SlicePtr& operator[](size_t i) const { return ring_[internalIndex(i)]; }
+
+  void pop_front() {
+    if (size() == 0) {
+      return;
+    }
+    front().reset();
+    size_--;
+    start_++;
+    if (start_ == capacity_) {
+      start_ = 0;
+    }
+    releaseRing();
+  }
+
+  void pop_back() {
+    if (size() == 0) {
+      return;
+    }
+    back().reset();
+    size_--;
+    releaseRing();
+  }
+
+  /**
+   * @return the number of slices the deque can hold before it has to grow its ring.
+   */
+  size_t capacity() const { return capacity_; }
+
+private:
+  constexpr static size_t InlineRingCapacity = 8;
+
+  size_t internalIndex(size_t index) const {
+    size_t internal_index = start_ + index;
+    if (internal_index >= capacity_) {
+      internal_index -= capacity_;
+      ASSERT(internal_index < capacity_);
+    }
+    return internal_index;
+  }
+
+  void growRing() {
+    if (size_ < capacity_) {
+      return;
+    }
+    const size_t new_capacity = capacity_ * 2;
+    auto new_ring = std::make_unique<SlicePtr[]>(new_capacity);
+    for (size_t i = 0; i < size_; i++) {
+      new_ring[i] = std::move(ring_[internalIndex(i)]);
+    }
+    external_ring_.swap(new_ring);
+    ring_ = external_ring_.get();
+    start_ = 0;
+    capacity_ = new_capacity;
+  }
+
+  // Once the deque is empty, go back to the inline ring, so that the buffers of idle connections
+  // hold no memory even if they once queued many slices.
+  void releaseRing() {
+    if (size_ != 0 || external_ring_ == nullptr) {
+      return;
+    }
+    external_ring_.reset();
+    ring_ = inline_ring_;
+    start_ = 0;
+    capacity_ = InlineRingCapacity;
+  }
+
+  SlicePtr inline_ring_[InlineRingCapacity];
+  std::unique_ptr<SlicePtr[]> external_ring_;
+  SlicePtr* ring_; // points to start of either inline or external ring.
+  size_t start_;
+  size_t size_;
+  size_t capacity_;
+};
+
 /**
  * An implementation of BufferFragment where a releasor callback is called when the data is
  * no longer needed.
@@ -46,28 +462,65 @@ private:
   const std::function<void(const void*, size_t, const BufferFragmentImpl*)> releasor_;
 };
 
-class LibEventInstance : public Instance {
+/**
+ * An implementation of FileFragment that maps the file region read-only for callers that need the
+ * data in memory. Mapping does not read the file; pages are only faulted in if data() is actually
+ * accessed, so data that is written with sendfile() is never copied into user space.
+ */
+class FileFragmentImpl : NonCopyable, public FileFragment {
 public:
-  // Allows access into the underlying buffer for move() optimizations.
-  virtual Event::Libevent::BufferPtr& buffer() PURE;
-  // Called after accessing the memory in buffer() directly to allow any post-processing.
-  virtual void postProcess() PURE;
+  /**
+   * Creates a fragment covering <size> bytes of the file open on <fd> starting at <offset>. The
+   * caller retains ownership of <fd>, which must stay open until releasor() is called, and must
+   * not truncate the file while the fragment is in use. releasor() is called with <this> to allow
+   * the caller to close the file and delete the fragment object.
+   * @param fd descriptor of the file to reference.
+   * @param offset offset in the file of the first byte to reference.
+   * @param size number of bytes to reference.
+   * @param releasor a callback function to be called when the data is no longer needed.
+   * @throw EnvoyException if the region cannot be mapped.
+   */
+  FileFragmentImpl(int fd, uint64_t offset, uint64_t size,
+                   const std::function<void(const FileFragmentImpl*)>& releasor);
+  ~FileFragmentImpl();
+
+  // Buffer::BufferFragment
+  const void* data() const override { return mapping_ + (offset_ - mapping_offset_); }
+  size_t size() const override { return size_; }
+  void done() override {
+    if (releasor_) {
+      releasor_(this);
+    }
+  }
+
+  // Buffer::FileFragment
+  int fd() const override { return fd_; }
+  uint64_t offset() const override { return offset_; }
+
+private:
+  const int fd_;
+  const uint64_t offset_;
+  const size_t size_;
+  const std::function<void(const FileFragmentImpl*)> releasor_;
+  // The mapping starts at the page boundary at or below offset_.
+  uint64_t mapping_offset_{};
+  uint8_t* mapping_{};
 };
 
 /**
- * Wraps an allocated and owned evbuffer.
+ * A buffer built from a queue of owned, unowned (fragment) and shared slices.
  *
- * Note that due to the internals of move() accessing buffer(), OwnedImpl is not
- * compatible with non-LibEventInstance buffers.
+ * Note that due to the internals of move() accessing the slice queue of the source buffer,
+ * OwnedImpl is not compatible with non-OwnedImpl buffers.
  */
-class OwnedImpl : public LibEventInstance {
+class OwnedImpl : public Instance {
 public:
   OwnedImpl();
   OwnedImpl(const std::string& data);
   OwnedImpl(const Instance& data);
   OwnedImpl(const void* data, uint64_t size);
 
-  // LibEventInstance
+  // Buffer::Instance
   void add(const void* data, uint64_t size) override;
   void addBufferFragment(BufferFragment& fragment) override;
   void add(const std::string& data) override;
@@ -84,12 +537,55 @@ public:
   uint64_t reserve(uint64_t length, RawSlice* iovecs, uint64_t num_iovecs) override;
   ssize_t search(const void* data, uint64_t size, size_t start) const override;
   int write(int fd) override;
-  void postProcess() override {}
 
-  Event::Libevent::BufferPtr& buffer() override { return buffer_; }
+  /**
+   * Append all the content of another buffer to this one without copying it. The slices of
+   * `data` are converted into reference-counted, read-only slices which are then shared by both
+   * buffers. The content of `data` is unchanged.
+   * @param data supplies the buffer to share. Like move(), it must be an OwnedImpl.
+   */
+  void addShared(Instance& data);
+
+  /**
+   * Keep the storage of the first slice with content allocated after the buffer has drained it,
+   * so that the content can still be referenced. The caller may also modify the content that it
+   * is about to drain, which is why storage that is referenced from elsewhere (another buffer, or
+   * an earlier pin) is never pinned. Nothing else is written to pinned storage.
+   * @return std::shared_ptr<const void> a reference that keeps the storage allocated, or nullptr
+   *         if the buffer is empty or the storage is already referenced.
+   */
+  std::shared_ptr<const void> pinFront();
+
+  /**
+   * Called on the source buffer after move() has taken data out of it, to allow any
+   * post-processing (e.g. watermark checks) by subclasses.
+   */
+  virtual void postProcess() {}
 
 private:
-  Event::Libevent::BufferPtr buffer_;
+  // Partial-slice moves smaller than this are copied; larger ones share the slice storage.
+  static constexpr uint64_t PartialMoveShareThreshold = 4096;
+
+  /**
+   * Implementation of drain() that subclasses can't override. Used internally where the drained
+   * bytes are re-added (linearize()) or already accounted for (write()).
+   */
+  void drainImpl(uint64_t size);
+  // @return the slice as a FileSlice if it has content and can be sent with sendFile().
+  static const FileSlice* sendableFileSlice(const Slice& slice);
+  static ssize_t sendFile(int fd, const FileSlice& slice);
+
+  /**
+   * Drain empty slices from the end of the queue. Used after a reservation has been abandoned or
+   * only partially committed.
+   */
+  void dropEmptyTailSlices();
+
+  /** Ring buffer of slices. */
+  SliceDeque slices_;
+
+  /** Sum of the dataSize of all slices. */
+  uint64_t length_{0};
 };
 
 } // namespace Buffer
@@ -0,0 +1,80 @@
+#include "common/buffer/cursor.h"
+
+#include <algorithm>
+#include <cstring>
+
+#include "envoy/common/exception.h"
+
+namespace Envoy {
+namespace Buffer {
+
+constexpr uint64_t Cursor::InlineSlices;
+
+Cursor::Cursor(const Instance& buffer) : length_(buffer.length()) {
+  num_slices_ = buffer.getRawSlices(inline_slices_, InlineSlices);
+  slices_ = inline_slices_;
+  if (num_slices_ > InlineSlices) {
+    heap_slices_.resize(num_slices_);
+    buffer.getRawSlices(heap_slices_.data(), num_slices_);
+    slices_ = heap_slices_.data();
+  }
+}
+
+void Cursor::peek(void* out, uint64_t size) const {
+  uint64_t slice_index = slice_index_;
+  uint64_t slice_offset = slice_offset_;
+  copy(out, size, slice_index, slice_offset);
+}
+
+void Cursor::read(void* out, uint64_t size) {
+  copy(out, size, slice_index_, slice_offset_);
+  position_ += size;
+}
+
+std::string Cursor::readString(uint64_t size) {
+  std::string ret(size, '\0');
+  read(&ret[0], size);
+  return ret;
+}
+
+void Cursor::skip(uint64_t size) { read(nullptr, size); }
+
+ssize_t Cursor::find(uint8_t byte) const {
+  uint64_t offset = slice_offset_;
+  ssize_t distance = 0;
+  for (uint64_t i = slice_index_; i < num_slices_; i++) {
+    const uint8_t* data = static_cast<const uint8_t*>(slices_[i].mem_);
+    const uint64_t size = slices_[i].len_ - offset;
+    const void* match = memchr(data + offset, byte, size);
+    if (match != nullptr) {
+      return distance + (static_cast<const uint8_t*>(match) - (data + offset));
+    }
+    distance += size;
+    offset = 0;
+  }
+  return -1;
+}
+
+void Cursor::copy(void* out, uint64_t size, uint64_t& slice_index, uint64_t& slice_offset) const {
+  if (size > remaining()) {
+    throw EnvoyException("buffer cursor out of range");
+  }
+  uint8_t* dest = static_cast<uint8_t*>(out);
+  while (size > 0) {
+    const RawSlice& slice = slices_[slice_index];
+    const uint64_t copy_size = std::min<uint64_t>(size, slice.len_ - slice_offset);
+    if (dest != nullptr) {
+      memcpy(dest, static_cast<const uint8_t*>(slice.mem_) + slice_offset, copy_size);
+      dest += copy_size;
+    }
+    size -= copy_size;
+    slice_offset += copy_size;
+    if (slice_offset == slice.len_) {
+      slice_index++;
+      slice_offset = 0;
+    }
+  }
+}
+
+} // namespace Buffer
+} // namespace Envoy
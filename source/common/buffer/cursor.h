@@ -0,0 +1,94 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "envoy/buffer/buffer.h"
+
+#include "common/common/non_copyable.h"
+
+namespace Envoy {
+namespace Buffer {
+
+/**
+ * A read position within a buffer. The cursor walks the buffer's slices in place, so that a
+ * decoder can parse data that spans slice boundaries without linearizing the buffer. Fixed-size
+ * fields are copied straight into the caller's variables, e.g. a stack integer, which is cheaper
+ * than pulling the field up into a contiguous block of the buffer.
+ *
+ * The cursor takes a snapshot of the buffer's slices when it is created. The buffer must not be
+ * modified while the cursor is in use, apart from draining bytes the cursor has already passed.
+ */
+class Cursor : NonCopyable {
+public:
+  explicit Cursor(const Instance& buffer);
+
+  /**
+   * @return uint64_t the number of bytes the cursor has moved past.
+   */
+  uint64_t position() const { return position_; }
+
+  /**
+   * @return uint64_t the number of bytes left after the cursor.
+   */
+  uint64_t remaining() const { return length_ - position_; }
+
+  /**
+   * Copy bytes from the cursor without moving it.
+   * @param out supplies the destination for `size` bytes.
+   * @param size supplies the number of bytes to copy.
+   * @throw EnvoyException if fewer than `size` bytes remain.
+   */
+  void peek(void* out, uint64_t size) const;
+
+  /**
+   * Copy bytes from the cursor and move past them.
+   * @param out supplies the destination for `size` bytes.
+   * @param size supplies the number of bytes to copy.
+   * @throw EnvoyException if fewer than `size` bytes remain.
+   */
+  void read(void* out, uint64_t size);
+
+  /**
+   * Copy bytes from the cursor into a string and move past them.
+   * @param size supplies the number of bytes to copy.
+   * @throw EnvoyException if fewer than `size` bytes remain.
+   */
+  std::string readString(uint64_t size);
+
+  /**
+   * Move past bytes without copying them.
+   * @param size supplies the number of bytes to skip.
+   * @throw EnvoyException if fewer than `size` bytes remain.
+   */
+  void skip(uint64_t size);
+
+  /**
+   * Find a byte after the cursor.
+   * @param byte supplies the byte to look for.
+   * @return ssize_t the distance from the cursor to the first occurrence of `byte`, or -1 if it
+   *         does not occur in the rest of the buffer.
+   */
+  ssize_t find(uint8_t byte) const;
+
+private:
+  static constexpr uint64_t InlineSlices = 16;
+
+  // Copy `size` bytes from the cursor to `out`, which may be nullptr, and return the new position
+  // as a slice index and offset without moving the cursor.
+  void copy(void* out, uint64_t size, uint64_t& slice_index, uint64_t& slice_offset) const;
+
+  // Most buffers have few slices, so the snapshot only goes to the heap for large ones.
+  RawSlice inline_slices_[InlineSlices];
+  std::vector<RawSlice> heap_slices_;
+  const RawSlice* slices_;
+  uint64_t num_slices_;
+  const uint64_t length_;
+  uint64_t slice_index_{};
+  uint64_t slice_offset_{};
+  uint64_t position_{};
+};
+
+} // namespace Buffer
+} // namespace Envoy
@@ -0,0 +1,35 @@
+#include "common/buffer/memory_account_impl.h"
+
+#include "common/common/assert.h"
+
+namespace Envoy {
+namespace Buffer {
+
+MemoryAccountImpl::~MemoryAccountImpl() {
+  // Every buffer holds a reference to its account and credits it in full when it is destroyed.
+  ASSERT(balance_ == 0);
+}
+
+const MemoryAccountSharedPtr& MemoryAccountImpl::processAccount() {
+  static MemoryAccountSharedPtr* account =
+      new MemoryAccountSharedPtr{std::make_shared<MemoryAccountImpl>(nullptr)};
+  return *account;
+}
+
+void MemoryAccountImpl::charge(uint64_t bytes) {
+  balance_.fetch_add(bytes, std::memory_order_relaxed);
+  if (parent_ != nullptr) {
+    parent_->charge(bytes);
+  }
+}
+
+void MemoryAccountImpl::credit(uint64_t bytes) {
+  ASSERT(balance_ >= bytes);
+  balance_.fetch_sub(bytes, std::memory_order_relaxed);
+  if (parent_ != nullptr) {
+    parent_->credit(bytes);
+  }
+}
+
+} // namespace Buffer
+} // namespace Envoy
@@ -0,0 +1,50 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+
+#include "envoy/buffer/buffer.h"
+
+#include "common/common/non_copyable.h"
+
+namespace Envoy {
+namespace Buffer {
+
+/**
+ * A MemoryAccount whose balance is kept in an atomic, so that it can be shared by buffers on
+ * different threads.
+ */
+class MemoryAccountImpl : public MemoryAccount, NonCopyable {
+public:
+  /**
+   * @param parent supplies the parent account, or nullptr for a root account. The account keeps
+   *        its parent alive.
+   */
+  MemoryAccountImpl(const MemoryAccountSharedPtr& parent) : parent_(parent) {}
+  ~MemoryAccountImpl();
+
+  /**
+   * @return MemoryAccountSharedPtr a new child account of `parent`, or nullptr if `parent` is
+   *         nullptr, so that accounting can be switched off by not setting up the parent.
+   */
+  static MemoryAccountSharedPtr createChild(const MemoryAccountSharedPtr& parent) {
+    return parent != nullptr ? std::make_shared<MemoryAccountImpl>(parent) : nullptr;
+  }
+
+  /**
+   * @return const MemoryAccountSharedPtr& the root account for the whole process.
+   */
+  static const MemoryAccountSharedPtr& processAccount();
+
+  // Buffer::MemoryAccount
+  void charge(uint64_t bytes) override;
+  void credit(uint64_t bytes) override;
+  uint64_t balance() const override { return balance_.load(std::memory_order_relaxed); }
+
+private:
+  const MemoryAccountSharedPtr parent_;
+  std::atomic<uint64_t> balance_{};
+};
+
+} // namespace Buffer
+} // namespace Envoy
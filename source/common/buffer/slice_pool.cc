@@ -0,0 +1,147 @@
+#include "common/buffer/slice_pool.h"
+
+#include <cstdlib>
+
+#include "common/common/assert.h"
+
+namespace Envoy {
+namespace Buffer {
+
+namespace {
+
+// Set when the calling thread's pool has been destroyed at thread exit. It is trivially
+// destructible, so it stays valid for any thread_local destructors that run afterwards and still
+// free slices; those frees go straight to the heap.
+thread_local bool thread_pool_destroyed = false;
+
+} // namespace
+
+constexpr uint64_t SlicePool::MinClassSize;
+constexpr uint64_t SlicePool::MaxClassSize;
+constexpr uint64_t SlicePool::DefaultMaxRetainedBytes;
+constexpr size_t SlicePool::NumClasses;
+
+std::atomic<uint64_t> SlicePool::max_retained_bytes_{SlicePool::DefaultMaxRetainedBytes};
+std::mutex SlicePool::registry_lock_;
+SlicePoolStats SlicePool::retired_stats_;
+
+std::list<SlicePool*>& SlicePool::registry() {
+  static std::list<SlicePool*>* registry = new std::list<SlicePool*>();
+  return *registry;
+}
+
+SlicePool::SlicePool() {
+  std::unique_lock<std::mutex> lock(registry_lock_);
+  registry().push_back(this);
+}
+
+SlicePool::~SlicePool() {
+  thread_pool_destroyed = true;
+  trim(0);
+  std::unique_lock<std::mutex> lock(registry_lock_);
+  registry().remove(this);
+  retired_stats_.hits_ += hits_;
+  retired_stats_.misses_ += misses_;
+}
+
+SlicePool* SlicePool::threadLocalPool() {
+  if (thread_pool_destroyed) {
+    return nullptr;
+  }
+  static thread_local SlicePool pool;
+  return &pool;
+}
+
+uint64_t SlicePool::allocationSize(uint64_t size) {
+  if (size <= MaxClassSize) {
+    uint64_t allocation_size = MinClassSize;
+    while (allocation_size < size) {
+      allocation_size <<= 1;
+    }
+    return allocation_size;
+  }
+  static constexpr uint64_t PageSize = 4096;
+  return ((size + PageSize - 1) / PageSize) * PageSize;
+}
+
+size_t SlicePool::sizeClass(uint64_t size) {
+  // Callers only pass sizes returned by allocationSize(), so any size up to MaxClassSize is an
+  // exact power of two.
+  ASSERT(size >= MinClassSize && size <= MaxClassSize && (size & (size - 1)) == 0);
+  return __builtin_ctzll(size) - __builtin_ctzll(MinClassSize);
+}
+
+void* SlicePool::allocate(uint64_t size) {
+  SlicePool* pool = size <= MaxClassSize ? threadLocalPool() : nullptr;
+  if (pool == nullptr) {
+    return ::operator new(size);
+  }
+
+  std::vector<void*>& free_list = pool->free_lists_[sizeClass(size)];
+  if (free_list.empty()) {
+    pool->misses_.store(pool->misses_.load(std::memory_order_relaxed) + 1,
+                        std::memory_order_relaxed);
+    return ::operator new(size);
+  }
+
+  void* memory = free_list.back();
+  free_list.pop_back();
+  pool->hits_.store(pool->hits_.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+  pool->retained_bytes_.store(pool->retained_bytes_.load(std::memory_order_relaxed) - size,
+                              std::memory_order_relaxed);
+  return memory;
+}
+
+void SlicePool::release(void* memory, uint64_t size) {
+  SlicePool* pool = size <= MaxClassSize ? threadLocalPool() : nullptr;
+  if (pool == nullptr) {
+    ::operator delete(memory);
+    return;
+  }
+
+  const uint64_t retained_bytes = pool->retained_bytes_.load(std::memory_order_relaxed);
+  const uint64_t max_retained_bytes = max_retained_bytes_.load(std::memory_order_relaxed);
+  if (retained_bytes + size > max_retained_bytes) {
+    ::operator delete(memory);
+    // The limit may have been lowered since this pool last trimmed itself.
+    pool->trim(max_retained_bytes);
+    return;
+  }
+
+  pool->free_lists_[sizeClass(size)].push_back(memory);
+  pool->retained_bytes_.store(retained_bytes + size, std::memory_order_relaxed);
+}
+
+void SlicePool::trim(uint64_t max_retained_bytes) {
+  // Free the largest classes first since they give back the most memory per free.
+  for (size_t i = NumClasses; i > 0 && retained_bytes_ > max_retained_bytes; i--) {
+    std::vector<void*>& free_list = free_lists_[i - 1];
+    const uint64_t class_size = MinClassSize << (i - 1);
+    while (!free_list.empty() && retained_bytes_ > max_retained_bytes) {
+      ::operator delete(free_list.back());
+      free_list.pop_back();
+      retained_bytes_.store(retained_bytes_.load(std::memory_order_relaxed) - class_size,
+                            std::memory_order_relaxed);
+    }
+  }
+}
+
+void SlicePool::setMaxRetainedBytes(uint64_t max_retained_bytes) {
+  max_retained_bytes_ = max_retained_bytes;
+}
+
+uint64_t SlicePool::maxRetainedBytes() { return max_retained_bytes_; }
+
+SlicePoolStats SlicePool::stats() {
+  std::unique_lock<std::mutex> lock(registry_lock_);
+  SlicePoolStats stats = retired_stats_;
+  for (const SlicePool* pool : registry()) {
+    stats.retained_bytes_ += pool->retained_bytes_.load(std::memory_order_relaxed);
+    stats.hits_ += pool->hits_.load(std::memory_order_relaxed);
+    stats.misses_ += pool->misses_.load(std::memory_order_relaxed);
+  }
+  return stats;
+}
+
+} // namespace Buffer
+} // namespace Envoy
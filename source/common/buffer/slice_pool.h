@@ -0,0 +1,105 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <list>
+#include <mutex>
+#include <vector>
+
+#include "common/common/non_copyable.h"
+
+namespace Envoy {
+namespace Buffer {
+
+/**
+ * Occupancy of all slice pools in the process.
+ */
+struct SlicePoolStats {
+  // Bytes of free slice storage held by the pools, ready for reuse.
+  uint64_t retained_bytes_{};
+  // Number of allocations satisfied from a pool.
+  uint64_t hits_{};
+  // Number of pool-sized allocations that had to go to the heap.
+  uint64_t misses_{};
+};
+
+/**
+ * A freelist cache of slice storage. Each thread (and therefore each dispatcher, since a
+ * dispatcher is only ever run from a single thread) has its own pool, so allocation and free do not
+ * need any synchronization and never touch the allocator's central freelists. Storage is cached by
+ * power of two size class, from MinClassSize to MaxClassSize bytes; other sizes go straight to the
+ * heap. Each pool retains at most maxRetainedBytes() of free storage; frees beyond that are
+ * returned to the heap.
+ *
+ * Memory allocated on one thread may be freed on another, in which case it simply ends up in the
+ * freeing thread's pool.
+ */
+class SlicePool : NonCopyable {
+public:
+  static constexpr uint64_t MinClassSize = 512;
+  static constexpr uint64_t MaxClassSize = 32768;
+  static constexpr uint64_t DefaultMaxRetainedBytes = 1024 * 1024;
+
+  ~SlicePool();
+
+  /**
+   * Rounds a requested allocation size up to the size that allocate() will actually provide.
+   * @param size supplies the minimum number of bytes needed.
+   * @return uint64_t the allocation size: the size class when `size` fits one, otherwise `size`
+   *         rounded up to a multiple of the page size.
+   */
+  static uint64_t allocationSize(uint64_t size);
+
+  /**
+   * Allocate memory from the calling thread's pool.
+   * @param size supplies the allocation size, which must be a value returned by allocationSize().
+   * @return void* the memory. Never nullptr.
+   */
+  static void* allocate(uint64_t size);
+
+  /**
+   * Return memory obtained from allocate() to the calling thread's pool.
+   * @param memory supplies the memory to free.
+   * @param size supplies the size passed to allocate().
+   */
+  static void release(void* memory, uint64_t size);
+
+  /**
+   * Set the maximum number of bytes of free storage each thread's pool will retain. Applies to
+   * all pools, including those that already exist. Zero disables caching.
+   */
+  static void setMaxRetainedBytes(uint64_t max_retained_bytes);
+  static uint64_t maxRetainedBytes();
+
+  /**
+   * @return SlicePoolStats the occupancy of all pools in the process.
+   */
+  static SlicePoolStats stats();
+
+private:
+  static constexpr size_t NumClasses = 7; // 512 to 32768 bytes.
+
+  SlicePool();
+
+  // @return the calling thread's pool, or nullptr if the thread is exiting.
+  static SlicePool* threadLocalPool();
+  static size_t sizeClass(uint64_t size);
+  void trim(uint64_t max_retained_bytes);
+
+  std::vector<void*> free_lists_[NumClasses];
+  // The counters are only written by the owning thread and are read (racily, but atomically)
+  // by stats().
+  std::atomic<uint64_t> retained_bytes_{};
+  std::atomic<uint64_t> hits_{};
+  std::atomic<uint64_t> misses_{};
+
+  static std::atomic<uint64_t> max_retained_bytes_;
+  // All live pools, so that stats() can aggregate them. Guarded by registry_lock_.
+  static std::mutex registry_lock_;
+  static std::list<SlicePool*>& registry();
+  // Counts of pools that have been destroyed, so that totals stay monotonic across thread exit.
+  static SlicePoolStats retired_stats_;
+};
+
+} // namespace Buffer
+} // namespace Envoy
@@ -5,11 +5,22 @@
 namespace Envoy {
 namespace Buffer {
 
+WatermarkBuffer::~WatermarkBuffer() {
+  if (account_ != nullptr) {
+    account_->credit(accounted_length_);
+  }
+}
+
 void WatermarkBuffer::add(const void* data, uint64_t size) {
   OwnedImpl::add(data, size);
   checkHighWatermark();
 }
 
+void WatermarkBuffer::addBufferFragment(BufferFragment& fragment) {
+  OwnedImpl::addBufferFragment(fragment);
+  checkHighWatermark();
+}
+
 void WatermarkBuffer::add(const std::string& data) {
   OwnedImpl::add(data);
   checkHighWatermark();
@@ -66,7 +77,30 @@ void WatermarkBuffer::setWatermarks(uint32_t low_watermark, uint32_t high_waterm
   checkLowWatermark();
 }
 
+void WatermarkBuffer::setMemoryAccount(const MemoryAccountSharedPtr& account) {
+  if (account_ != nullptr) {
+    account_->credit(accounted_length_);
+    accounted_length_ = 0;
+  }
+  account_ = account;
+  updateAccount();
+}
+
+void WatermarkBuffer::updateAccount() {
+  if (account_ == nullptr) {
+    return;
+  }
+  const uint64_t length = OwnedImpl::length();
+  if (length > accounted_length_) {
+    account_->charge(length - accounted_length_);
+  } else if (length < accounted_length_) {
+    account_->credit(accounted_length_ - length);
+  }
+  accounted_length_ = length;
+}
+
 void WatermarkBuffer::checkLowWatermark() {
+  updateAccount();
   if (!above_high_watermark_called_ ||
       (high_watermark_ != 0 && OwnedImpl::length() >= low_watermark_)) {
     return;
@@ -77,6 +111,7 @@ void WatermarkBuffer::checkLowWatermark() {
 }
 
 void WatermarkBuffer::checkHighWatermark() {
+  updateAccount();
   if (above_high_watermark_called_ || high_watermark_ == 0 ||
       OwnedImpl::length() <= high_watermark_) {
     return;
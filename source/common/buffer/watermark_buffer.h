@@ -13,15 +13,19 @@ namespace Buffer {
 // buffer size transitions from under the low watermark to above the high watermark, the
 // above_high_watermark function is called one time. It will not be called again until the buffer
 // is drained below the low watermark, at which point the below_low_watermark function is called.
+// If a MemoryAccount is set, each resize also charges or credits the account with the change in
+// size.
 class WatermarkBuffer : public OwnedImpl {
 public:
   WatermarkBuffer(std::function<void()> below_low_watermark,
                   std::function<void()> above_high_watermark)
       : below_low_watermark_(below_low_watermark), above_high_watermark_(above_high_watermark) {}
+  ~WatermarkBuffer();
 
   // Override all functions from Instance which can result in changing the size
   // of the underlying buffer.
   void add(const void* data, uint64_t size) override;
+  void addBufferFragment(BufferFragment& fragment) override;
   void add(const std::string& data) override;
   void add(const Instance& data) override;
   void commit(RawSlice* iovecs, uint64_t num_iovecs) override;
@@ -37,9 +41,18 @@ public:
   void setWatermarks(uint32_t low_watermark, uint32_t high_watermark);
   uint32_t highWatermark() const { return high_watermark_; }
 
+  /**
+   * Charge the bytes held by the buffer to an account. Bytes already held move from the previous
+   * account, if any, to the new one.
+   * @param account supplies the account, or nullptr to stop accounting.
+   */
+  void setMemoryAccount(const MemoryAccountSharedPtr& account);
+  const MemoryAccountSharedPtr& memoryAccount() const { return account_; }
+
 private:
   void checkHighWatermark();
   void checkLowWatermark();
+  void updateAccount();
 
   std::function<void()> below_low_watermark_;
   std::function<void()> above_high_watermark_;
@@ -52,6 +65,9 @@ private:
   // True between the time above_high_watermark_ has been called until above_high_watermark_ has
   // been called.
   bool above_high_watermark_called_{false};
+  MemoryAccountSharedPtr account_;
+  // The number of bytes currently charged to account_.
+  uint64_t accounted_length_{};
 };
 
 typedef std::unique_ptr<WatermarkBuffer> WatermarkBufferPtr;
@@ -1,5 +1,7 @@
 #include "common/buffer/zero_copy_input_stream_impl.h"
 
+#include <algorithm>
+
 #include "common/buffer/buffer_impl.h"
 #include "common/common/assert.h"
 
@@ -44,7 +46,16 @@ bool ZeroCopyInputStreamImpl::Next(const void** data, int* size) {
   return false;
 }
 
-bool ZeroCopyInputStreamImpl::Skip(int) { NOT_IMPLEMENTED; }
+bool ZeroCopyInputStreamImpl::Skip(int count) {
+  ASSERT(count >= 0);
+
+  // Skipped bytes are drained right away, like the bytes of the last Next() call.
+  const uint64_t skipped = std::min(uint64_t(count), buffer_->length() - position_);
+  buffer_->drain(position_ + skipped);
+  position_ = 0;
+  byte_count_ += skipped;
+  return skipped == uint64_t(count);
+}
 
 void ZeroCopyInputStreamImpl::BackUp(int count) {
   ASSERT(count >= 0);
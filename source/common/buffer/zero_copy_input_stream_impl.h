@@ -36,7 +36,9 @@ public:
   // LimitingInputStream before passing to protobuf code to avoid a spin loop.
   virtual bool Next(const void** data, int* size) override;
   virtual void BackUp(int count) override;
-  virtual bool Skip(int count) override; // Not implemented
+  // Note Skip() returns false if fewer than count bytes are available, after skipping the
+  // available ones, even if the stream is not finished.
+  virtual bool Skip(int count) override;
   virtual ProtobufTypes::Int64 ByteCount() const override { return byte_count_; }
 
 protected:
@@ -0,0 +1,61 @@
+#include "common/common/arena_impl.h"
+
+#include "common/common/assert.h"
+
+namespace Envoy {
+
+constexpr size_t ArenaImpl::DefaultBlockSize;
+
+ArenaImpl::ArenaImpl(size_t block_size) : block_size_(block_size) {}
+
+ArenaImpl::~ArenaImpl() {
+  for (Cleanup* cleanup = cleanups_; cleanup != nullptr; cleanup = cleanup->next_) {
+    cleanup->cleanup_(cleanup->context_);
+  }
+
+  while (blocks_ != nullptr) {
+    Block* block = blocks_;
+    blocks_ = block->next_;
+    ::operator delete(block);
+  }
+}
+
+char* ArenaImpl::newBlock(size_t size) {
+  Block* block = static_cast<Block*>(::operator new(sizeof(Block) + size));
+  block->next_ = blocks_;
+  blocks_ = block;
+  return reinterpret_cast<char*>(block + 1);
+}
+
+void* ArenaImpl::allocate(size_t size, size_t alignment) {
+  ASSERT(alignment != 0 && (alignment & (alignment - 1)) == 0);
+  ASSERT(alignment <= alignof(std::max_align_t));
+  bytes_allocated_ += size;
+
+  const uintptr_t next = reinterpret_cast<uintptr_t>(next_);
+  const uintptr_t aligned = (next + alignment - 1) & ~(alignment - 1);
+  if (next_ != nullptr && aligned + size <= reinterpret_cast<uintptr_t>(end_)) {
+    next_ = reinterpret_cast<char*>(aligned + size);
+    return reinterpret_cast<char*>(aligned);
+  }
+
+  if (size > block_size_ / 4) {
+    // Block memory is maximally aligned already. The current block stays current.
+    return newBlock(size);
+  }
+
+  char* memory = newBlock(block_size_);
+  next_ = memory + size;
+  end_ = memory + block_size_;
+  return memory;
+}
+
+void ArenaImpl::addCleanup(void (*cleanup)(void*), void* context) {
+  Cleanup* entry = static_cast<Cleanup*>(allocate(sizeof(Cleanup), alignof(Cleanup)));
+  entry->cleanup_ = cleanup;
+  entry->context_ = context;
+  entry->next_ = cleanups_;
+  cleanups_ = entry;
+}
+
+} // namespace Envoy
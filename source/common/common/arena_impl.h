@@ -0,0 +1,55 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#include "envoy/common/arena.h"
+
+#include "common/common/non_copyable.h"
+
+namespace Envoy {
+
+/**
+ * Arena that hands out memory from blocks of a fixed size, which are only allocated once the arena
+ * is first used. Allocations larger than a quarter of the block size get a block of their own so
+ * that they do not waste the rest of the current block.
+ */
+class ArenaImpl : public Arena, NonCopyable {
+public:
+  static constexpr size_t DefaultBlockSize = 4096;
+
+  ArenaImpl(size_t block_size = DefaultBlockSize);
+  ~ArenaImpl();
+
+  // Arena
+  void* allocate(size_t size, size_t alignment) override;
+  void addCleanup(void (*cleanup)(void*), void* context) override;
+  uint64_t bytesAllocated() const override { return bytes_allocated_; }
+
+private:
+  // Header of a block. The block's memory follows it.
+  struct alignas(std::max_align_t) Block {
+    Block* next_;
+  };
+
+  struct Cleanup {
+    void (*cleanup_)(void*);
+    void* context_;
+    Cleanup* next_;
+  };
+
+  // @return the memory of a new block of the given size, linked into blocks_.
+  char* newBlock(size_t size);
+
+  const size_t block_size_;
+  // The unused part of the current block.
+  char* next_{};
+  char* end_{};
+  // All blocks, most recently allocated first.
+  Block* blocks_{};
+  // Most recently added first.
+  Cleanup* cleanups_{};
+  uint64_t bytes_allocated_{};
+};
+
+} // namespace Envoy
@@ -1,17 +1,25 @@
 #include "common/common/base64.h"
 
+#if defined(__x86_64__)
+#include <immintrin.h>
+#endif
+
+#include <algorithm>
 #include <cstdint>
+#include <cstring>
 #include <string>
 
 #include "common/common/empty_string.h"
 
 namespace Envoy {
-static constexpr char CHAR_TABLE[] =
-    "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+namespace {
+
+constexpr char CHAR_TABLE[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
 
 // Conversion table is taken from
 // https://opensource.apple.com/source/QuickTimeStreamingServer/QuickTimeStreamingServer-452/CommonUtilitiesLib/base64.c
-static const unsigned char REVERSE_LOOKUP_TABLE[256] = {
+// Characters outside of the alphabet, padding included, map to 64.
+constexpr unsigned char REVERSE_LOOKUP_TABLE[256] = {
     64, 64, 64, 64, 64, 64, 64, 64, 64, 64, 64, 64, 64, 64, 64, 64, 64, 64, 64, 64, 64, 64, 64, 64,
     64, 64, 64, 64, 64, 64, 64, 64, 64, 64, 64, 64, 64, 64, 64, 64, 64, 64, 64, 62, 64, 64, 64, 63,
     52, 53, 54, 55, 56, 57, 58, 59, 60, 61, 64, 64, 64, 64, 64, 64, 64, 0,  1,  2,  3,  4,  5,  6,
@@ -24,160 +32,312 @@ static const unsigned char REVERSE_LOOKUP_TABLE[256] = {
     64, 64, 64, 64, 64, 64, 64, 64, 64, 64, 64, 64, 64, 64, 64, 64, 64, 64, 64, 64, 64, 64, 64, 64,
     64, 64, 64, 64, 64, 64, 64, 64, 64, 64, 64, 64, 64, 64, 64, 64};
 
-std::string Base64::decode(const std::string& input) {
-  if (input.length() % 4 || input.empty()) {
-    return EMPTY_STRING;
+// The functions below work on whole blocks: encodeBlocks() on a multiple of 3 input bytes, and
+// decodeBlocks() on a multiple of 4 input characters without padding. They return the end of the
+// output they wrote, or nullptr if the input is not valid base64.
+
+char* encodeBlocksScalar(const uint8_t* in, uint64_t size, char* out) {
+  for (const uint8_t* end = in + size; in != end; in += 3) {
+    const uint32_t block = in[0] << 16 | in[1] << 8 | in[2];
+    *out++ = CHAR_TABLE[block >> 18];
+    *out++ = CHAR_TABLE[(block >> 12) & 0x3f];
+    *out++ = CHAR_TABLE[(block >> 6) & 0x3f];
+    *out++ = CHAR_TABLE[block & 0x3f];
   }
+  return out;
+}
 
-  // First position of "valid" padding character.
-  uint64_t first_padding_index = input.length();
-  int max_length = input.length() / 4 * 3;
-  // At most last two chars can be '='.
-  if (input[input.length() - 1] == '=') {
-    max_length--;
-    first_padding_index = input.length() - 1;
-    if (input[input.length() - 2] == '=') {
-      max_length--;
-      first_padding_index = input.length() - 2;
+uint8_t* decodeBlocksScalar(const char* in, uint64_t size, uint8_t* out) {
+  for (const char* end = in + size; in != end; in += 4) {
+    const uint32_t a = REVERSE_LOOKUP_TABLE[static_cast<uint8_t>(in[0])];
+    const uint32_t b = REVERSE_LOOKUP_TABLE[static_cast<uint8_t>(in[1])];
+    const uint32_t c = REVERSE_LOOKUP_TABLE[static_cast<uint8_t>(in[2])];
+    const uint32_t d = REVERSE_LOOKUP_TABLE[static_cast<uint8_t>(in[3])];
+    if ((a | b | c | d) & 64) {
+      return nullptr;
     }
+    const uint32_t block = a << 18 | b << 12 | c << 6 | d;
+    *out++ = block >> 16;
+    *out++ = block >> 8;
+    *out++ = block;
   }
-  std::string result;
-  result.reserve(max_length);
-
-  uint64_t bytes_left = input.length();
-  uint64_t cur_read = 0;
-
-  // Read input string by group of 4 chars, length of input string must be divided evenly by 4.
-  // Decode 4 chars 6 bits each into 3 chars 8 bits each.
-  while (bytes_left > 0) {
-    // Take first 6 bits from 1st converted char and first 2 bits from 2nd converted char,
-    // make 8 bits char from it.
-    // Use conversion table to map char to decoded value (value is between 0 and 63 inclusive for a
-    // valid character).
-    const unsigned char a = REVERSE_LOOKUP_TABLE[static_cast<uint32_t>(input[cur_read])];
-    const unsigned char b = REVERSE_LOOKUP_TABLE[static_cast<uint32_t>(input[cur_read + 1])];
-    if (a == 64 || b == 64) {
-      // Input contains an invalid character.
-      return EMPTY_STRING;
-    }
-    result.push_back(a << 2 | b >> 4);
-    const unsigned char c = REVERSE_LOOKUP_TABLE[static_cast<uint32_t>(input[cur_read + 2])];
-
-    // Decoded value 64 means invalid character unless we already know it is a valid padding.
-    // If so, following characters are all padding.
-    // Also we should check there are no unused bits.
-    if (c == 64) {
-      if (first_padding_index != cur_read + 2) {
-        // Input contains an invalid character.
-        return EMPTY_STRING;
-      } else if (b & 0b1111) {
-        // There are unused bits at tail.
-        return EMPTY_STRING;
-      } else {
-        return result;
-      }
-    }
-    // Take last 4 bits from 2nd converted char and 4 first bits from 3rd converted char.
-    result.push_back(b << 4 | c >> 2);
+  return out;
+}
 
-    const unsigned char d = REVERSE_LOOKUP_TABLE[static_cast<uint32_t>(input[cur_read + 3])];
-    if (d == 64) {
-      if (first_padding_index != cur_read + 3) {
-        // Input contains an invalid character.
-        return EMPTY_STRING;
-      } else if (c & 0b11) {
-        // There are unused bits at tail.
-        return EMPTY_STRING;
-      } else {
-        return result;
-      }
+#if defined(__x86_64__)
+// The SSSE3 versions convert 12 bytes to 16 characters and back per step, after W. Muła and
+// D. Lemire, "Faster Base64 Encoding and Decoding Using AVX2 Instructions", ACM Transactions on
+// the Web 12(3), 2018. Each step loads or stores 16 bytes, so they stop while a whole vector
+// still fits and leave the rest to the scalar versions.
+
+__attribute__((target("ssse3"))) char* encodeBlocksSsse3(const uint8_t* in, uint64_t size,
+                                                         char* out) {
+  while (size >= 16) {
+    // Spread each 3 byte block over a 32 bit lane and move the four 6 bit indices into bytes.
+    __m128i input = _mm_loadu_si128(reinterpret_cast<const __m128i*>(in));
+    input = _mm_shuffle_epi8(
+        input, _mm_setr_epi8(1, 0, 2, 1, 4, 3, 5, 4, 7, 6, 8, 7, 10, 9, 11, 10));
+    const __m128i high = _mm_mulhi_epu16(_mm_and_si128(input, _mm_set1_epi32(0x0fc0fc00)),
+                                         _mm_set1_epi32(0x04000040));
+    const __m128i low = _mm_mullo_epi16(_mm_and_si128(input, _mm_set1_epi32(0x003f03f0)),
+                                        _mm_set1_epi32(0x01000010));
+    const __m128i indices = _mm_or_si128(high, low);
+
+    // Map each index range of the alphabet to the offset from the index to its character.
+    __m128i range = _mm_subs_epu8(indices, _mm_set1_epi8(51));
+    const __m128i upper = _mm_cmpgt_epi8(_mm_set1_epi8(26), indices);
+    range = _mm_or_si128(range, _mm_and_si128(upper, _mm_set1_epi8(13)));
+    const __m128i offsets =
+        _mm_setr_epi8('a' - 26, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52,
+                      '0' - 52, '0' - 52, '0' - 52, '0' - 52, '+' - 62, '/' - 63, 'A', 0, 0);
+    const __m128i chars = _mm_add_epi8(_mm_shuffle_epi8(offsets, range), indices);
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(out), chars);
+
+    in += 12;
+    size -= 12;
+    out += 16;
+  }
+  return encodeBlocksScalar(in, size, out);
+}
+
+__attribute__((target("ssse3"))) uint8_t* decodeBlocksSsse3(const char* in, uint64_t size,
+                                                            uint8_t* out) {
+  // The stores write 4 bytes past the 12 decoded ones, which the following input still covers.
+  while (size >= 24) {
+    const __m128i input = _mm_loadu_si128(reinterpret_cast<const __m128i*>(in));
+    const __m128i high_nibbles = _mm_and_si128(_mm_srli_epi32(input, 4), _mm_set1_epi8(0x0f));
+    const __m128i low_nibbles = _mm_and_si128(input, _mm_set1_epi8(0x0f));
+
+    // A character is valid if the bit for its high nibble is set in the mask of its low nibble.
+    const __m128i masks = _mm_shuffle_epi8(
+        _mm_setr_epi8(0xa8, 0xf8, 0xf8, 0xf8, 0xf8, 0xf8, 0xf8, 0xf8, 0xf8, 0xf8, 0xf0, 0x54, 0x50,
+                      0x50, 0x50, 0x54),
+        low_nibbles);
+    const __m128i bits = _mm_shuffle_epi8(
+        _mm_setr_epi8(0x01, 0x02, 0x04, 0x08, 0x10, 0x20, 0x40, 0x80, 0, 0, 0, 0, 0, 0, 0, 0),
+        high_nibbles);
+    if (_mm_movemask_epi8(_mm_cmpeq_epi8(_mm_and_si128(masks, bits), _mm_setzero_si128())) !=
+        0) {
+      return nullptr;
     }
-    // Take last 2 bits from 3rd converted char and all(6) bits from 4th converted char.
-    result.push_back(c << 6 | d);
 
-    cur_read += 4;
-    bytes_left -= 4;
+    // Characters with the same high nibble are the same offset from their values, except for '/'.
+    const __m128i slash = _mm_cmpeq_epi8(input, _mm_set1_epi8('/'));
+    const __m128i offsets = _mm_or_si128(
+        _mm_andnot_si128(slash, _mm_shuffle_epi8(_mm_setr_epi8(0, 0, 19, 4, -65, -65, -71, -71, 0,
+                                                               0, 0, 0, 0, 0, 0, 0),
+                                                 high_nibbles)),
+        _mm_and_si128(slash, _mm_set1_epi8(16)));
+    const __m128i values = _mm_add_epi8(input, offsets);
+
+    // Pack the four 6 bit values of each lane into 3 bytes, and the lanes into 12 bytes.
+    const __m128i pairs = _mm_maddubs_epi16(values, _mm_set1_epi32(0x01400140));
+    const __m128i blocks = _mm_madd_epi16(pairs, _mm_set1_epi32(0x00011000));
+    const __m128i bytes = _mm_shuffle_epi8(
+        blocks, _mm_setr_epi8(2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, -1, -1, -1, -1));
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(out), bytes);
+
+    in += 16;
+    size -= 16;
+    out += 12;
   }
+  return decodeBlocksScalar(in, size, out);
+}
 
-  return result;
+bool cpuHasSsse3() {
+  __builtin_cpu_init();
+  return __builtin_cpu_supports("ssse3");
 }
+#endif
 
-void Base64::encodeBase(const uint8_t cur_char, uint64_t pos, uint8_t& next_c, std::string& ret) {
-  switch (pos % 3) {
-  case 0:
-    ret.push_back(CHAR_TABLE[cur_char >> 2]);
-    next_c = (cur_char & 0x03) << 4;
-    break;
-  case 1:
-    ret.push_back(CHAR_TABLE[next_c | (cur_char >> 4)]);
-    next_c = (cur_char & 0x0f) << 2;
-    break;
-  case 2:
-    ret.push_back(CHAR_TABLE[next_c | (cur_char >> 6)]);
-    ret.push_back(CHAR_TABLE[cur_char & 0x3f]);
-    next_c = 0;
-    break;
+char* encodeBlocks(const uint8_t* in, uint64_t size, char* out) {
+#if defined(__x86_64__)
+  static const bool has_ssse3 = cpuHasSsse3();
+  if (has_ssse3) {
+    return encodeBlocksSsse3(in, size, out);
   }
+#endif
+  return encodeBlocksScalar(in, size, out);
 }
 
-void Base64::encodeLast(uint64_t pos, uint8_t last_char, std::string& ret) {
-  switch (pos % 3) {
-  case 1:
-    ret.push_back(CHAR_TABLE[last_char]);
-    ret.push_back('=');
-    ret.push_back('=');
-    break;
-  case 2:
-    ret.push_back(CHAR_TABLE[last_char]);
-    ret.push_back('=');
-    break;
-  default:
-    break;
+uint8_t* decodeBlocks(const char* in, uint64_t size, uint8_t* out) {
+#if defined(__x86_64__)
+  static const bool has_ssse3 = cpuHasSsse3();
+  if (has_ssse3) {
+    return decodeBlocksSsse3(in, size, out);
   }
+#endif
+  return decodeBlocksScalar(in, size, out);
 }
 
-std::string Base64::encode(const Buffer::Instance& buffer, uint64_t length) {
-  uint64_t output_length = (std::min(length, buffer.length()) + 2) / 3 * 4;
-  std::string ret;
-  ret.reserve(output_length);
+/**
+ * Encode the last 1 or 2 bytes of the input, padded with '='.
+ */
+char* encodeLast(const uint8_t* in, uint64_t size, char* out) {
+  if (size == 0) {
+    return out;
+  }
+  const uint32_t block = in[0] << 16 | (size == 2 ? in[1] << 8 : 0);
+  *out++ = CHAR_TABLE[block >> 18];
+  *out++ = CHAR_TABLE[(block >> 12) & 0x3f];
+  *out++ = size == 2 ? CHAR_TABLE[(block >> 6) & 0x3f] : '=';
+  *out++ = '=';
+  return out;
+}
+
+/**
+ * Decode the last 4 characters of the input, which may end in padding.
+ * @return the number of bytes decoded into out, or -1 if the characters are not valid base64.
+ */
+int decodeLast(const char* in, uint8_t* out) {
+  const uint32_t a = REVERSE_LOOKUP_TABLE[static_cast<uint8_t>(in[0])];
+  const uint32_t b = REVERSE_LOOKUP_TABLE[static_cast<uint8_t>(in[1])];
+  if ((a | b) & 64) {
+    return -1;
+  }
+  out[0] = a << 2 | b >> 4;
+  if (in[2] == '=') {
+    // Padding must run to the end, and the unused bits must be zero.
+    return in[3] == '=' && (b & 0b1111) == 0 ? 1 : -1;
+  }
+
+  const uint32_t c = REVERSE_LOOKUP_TABLE[static_cast<uint8_t>(in[2])];
+  if (c & 64) {
+    return -1;
+  }
+  out[1] = b << 4 | c >> 2;
+  if (in[3] == '=') {
+    return (c & 0b11) == 0 ? 2 : -1;
+  }
+
+  const uint32_t d = REVERSE_LOOKUP_TABLE[static_cast<uint8_t>(in[3])];
+  if (d & 64) {
+    return -1;
+  }
+  out[2] = c << 6 | d;
+  return 3;
+}
+
+} // namespace
+
+std::string Base64::decode(const std::string& input) {
+  if (input.length() % 4 || input.empty()) {
+    return EMPTY_STRING;
+  }
+
+  const uint64_t blocks_length = input.length() - 4;
+  uint8_t last[3];
+  const int last_length = decodeLast(input.data() + blocks_length, last);
+  if (last_length < 0) {
+    return EMPTY_STRING;
+  }
+
+  std::string result(blocks_length / 4 * 3 + last_length, '\0');
+  uint8_t* out = reinterpret_cast<uint8_t*>(&result[0]);
+  out = decodeBlocks(input.data(), blocks_length, out);
+  if (out == nullptr) {
+    return EMPTY_STRING;
+  }
+  memcpy(out, last, last_length);
+  return result;
+}
+
+std::string Base64::decode(const Buffer::Instance& buffer, uint64_t length) {
+  length = std::min(length, buffer.length());
+  if (length % 4 || length == 0) {
+    return EMPTY_STRING;
+  }
+
+  uint64_t blocks_length = length - 4;
+  char last_chars[4];
+  buffer.copyOut(blocks_length, 4, last_chars);
+  uint8_t last[3];
+  const int last_length = decodeLast(last_chars, last);
+  if (last_length < 0) {
+    return EMPTY_STRING;
+  }
+
+  std::string result(blocks_length / 4 * 3 + last_length, '\0');
+  uint8_t* out = reinterpret_cast<uint8_t*>(&result[0]);
 
   uint64_t num_slices = buffer.getRawSlices(nullptr, 0);
   Buffer::RawSlice slices[num_slices];
   buffer.getRawSlices(slices, num_slices);
 
-  uint64_t j = 0;
-  uint8_t next_c = 0;
-  for (Buffer::RawSlice& slice : slices) {
-    const uint8_t* slice_mem = static_cast<const uint8_t*>(slice.mem_);
-
-    for (uint64_t i = 0; i < slice.len_ && j < length; ++i, ++j) {
-      encodeBase(slice_mem[i], j, next_c, ret);
+  // Characters at the end of a slice that need more from the next slice to make a block.
+  char carry[4];
+  uint64_t carry_length = 0;
+  for (const Buffer::RawSlice& slice : slices) {
+    const char* in = static_cast<const char*>(slice.mem_);
+    uint64_t size = std::min<uint64_t>(slice.len_, blocks_length);
+    blocks_length -= size;
+    while (carry_length > 0 && carry_length < 4 && size > 0) {
+      carry[carry_length++] = *in++;
+      size--;
+    }
+    if (carry_length == 4) {
+      out = decodeBlocksScalar(carry, 4, out);
+      if (out == nullptr) {
+        return EMPTY_STRING;
+      }
+      carry_length = 0;
     }
 
-    if (j == length) {
-      break;
+    const uint64_t whole_blocks = size / 4 * 4;
+    out = decodeBlocks(in, whole_blocks, out);
+    if (out == nullptr) {
+      return EMPTY_STRING;
     }
+    memcpy(carry + carry_length, in + whole_blocks, size - whole_blocks);
+    carry_length += size - whole_blocks;
   }
 
-  encodeLast(j, next_c, ret);
-
-  return ret;
+  memcpy(out, last, last_length);
+  return result;
 }
 
-std::string Base64::encode(const char* input, uint64_t length) {
-  uint64_t output_length = (length + 2) / 3 * 4;
-  std::string ret;
-  ret.reserve(output_length);
+std::string Base64::encode(const Buffer::Instance& buffer, uint64_t length) {
+  length = std::min(length, buffer.length());
+  std::string ret((length + 2) / 3 * 4, '\0');
+  char* out = &ret[0];
 
-  uint64_t pos = 0;
-  uint8_t next_c = 0;
+  uint64_t num_slices = buffer.getRawSlices(nullptr, 0);
+  Buffer::RawSlice slices[num_slices];
+  buffer.getRawSlices(slices, num_slices);
+
+  // Bytes at the end of a slice that need more from the next slice to make a block.
+  uint8_t carry[3];
+  uint64_t carry_length = 0;
+  for (const Buffer::RawSlice& slice : slices) {
+    const uint8_t* in = static_cast<const uint8_t*>(slice.mem_);
+    uint64_t size = std::min<uint64_t>(slice.len_, length);
+    length -= size;
+    while (carry_length > 0 && carry_length < 3 && size > 0) {
+      carry[carry_length++] = *in++;
+      size--;
+    }
+    if (carry_length == 3) {
+      out = encodeBlocksScalar(carry, 3, out);
+      carry_length = 0;
+    }
 
-  for (uint64_t i = 0; i < length; ++i) {
-    encodeBase(input[i], pos++, next_c, ret);
+    const uint64_t whole_blocks = size / 3 * 3;
+    out = encodeBlocks(in, whole_blocks, out);
+    memcpy(carry + carry_length, in + whole_blocks, size - whole_blocks);
+    carry_length += size - whole_blocks;
   }
 
-  encodeLast(pos, next_c, ret);
+  encodeLast(carry, carry_length, out);
+  return ret;
+}
 
+std::string Base64::encode(const char* input, uint64_t length) {
+  std::string ret((length + 2) / 3 * 4, '\0');
+  const uint8_t* in = reinterpret_cast<const uint8_t*>(input);
+  const uint64_t whole_blocks = length / 3 * 3;
+  char* out = encodeBlocks(in, whole_blocks, &ret[0]);
+  encodeLast(in + whole_blocks, length - whole_blocks, out);
   return ret;
 }
+
 } // namespace Envoy
@@ -31,16 +31,12 @@ public:
    */
   static std::string decode(const std::string& input);
 
-private:
   /**
-   * Helper method for encoding. This is used to encode all of the characters from the input string.
+   * Base64 decode the start of an input buffer without linearizing it.
+   * @param buffer supplies the buffer to decode.
+   * @param length supplies the length to decode which may be <= the buffer length.
+   * @return std::string the decoded bytes, or an empty string if the input is not valid base64.
    */
-  static void encodeBase(const uint8_t cur_char, uint64_t pos, uint8_t& next_c, std::string& ret);
-
-  /**
-   * Encode last characters. It appends '=' chars to the ret if input
-   * string length is not divisible by 3.
-   */
-  static void encodeLast(uint64_t pos, uint8_t last_char, std::string& ret);
+  static std::string decode(const Buffer::Instance& buffer, uint64_t length);
 };
 } // namespace Envoy
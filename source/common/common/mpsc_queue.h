@@ -0,0 +1,89 @@
+#pragma once
+
+#include <atomic>
+
+#include "common/common/non_copyable.h"
+
+namespace Envoy {
+
+/**
+ * Base class of the elements of an MpscQueue, which holds the link to the next element.
+ */
+class MpscQueueNode {
+private:
+  std::atomic<MpscQueueNode*> next_{};
+
+  template <class T> friend class MpscQueue;
+};
+
+/**
+ * Intrusive, lock-free queue with any number of producers and a single consumer (Vyukov's
+ * algorithm). push() is wait-free. pop() may only be called from the consumer, and may find the
+ * queue blocked by an element that a producer is still linking in, in which case it returns
+ * nullptr although empty() does not hold. The queue does not own its elements, which must be
+ * popped before it is destroyed.
+ */
+template <class T> class MpscQueue : NonCopyable {
+public:
+  MpscQueue() : head_(&stub_), tail_(&stub_) {}
+
+  /**
+   * Append an element. Thread safe.
+   * @param node supplies the element, which must not be in a queue.
+   */
+  void push(T* node) { push(static_cast<MpscQueueNode*>(node)); }
+
+  /**
+   * Remove the first element. Consumer only.
+   * @return T* the element, or nullptr if the queue is empty or an element is being pushed.
+   */
+  T* pop() {
+    MpscQueueNode* tail = tail_;
+    MpscQueueNode* next = tail->next_.load(std::memory_order_acquire);
+    if (tail == &stub_) {
+      if (next == nullptr) {
+        return nullptr;
+      }
+      tail_ = next;
+      tail = next;
+      next = next->next_.load(std::memory_order_acquire);
+    }
+    if (next != nullptr) {
+      tail_ = next;
+      return static_cast<T*>(tail);
+    }
+    if (tail != head_.load(std::memory_order_acquire)) {
+      // A producer swapped in a newer element but did not link it to this one yet.
+      return nullptr;
+    }
+    // The last element can only be removed once another one follows it.
+    push(&stub_);
+    next = tail->next_.load(std::memory_order_acquire);
+    if (next != nullptr) {
+      tail_ = next;
+      return static_cast<T*>(tail);
+    }
+    return nullptr;
+  }
+
+  /**
+   * @return bool whether no element was pushed that has not been popped. Consumer only.
+   */
+  bool empty() const {
+    return tail_ == &stub_ && head_.load(std::memory_order_acquire) == &stub_;
+  }
+
+private:
+  void push(MpscQueueNode* node) {
+    node->next_.store(nullptr, std::memory_order_relaxed);
+    MpscQueueNode* prev = head_.exchange(node, std::memory_order_acq_rel);
+    prev->next_.store(node, std::memory_order_release);
+  }
+
+  MpscQueueNode stub_;
+  // The last element, which producers swap. Kept apart from the consumer's end of the queue.
+  alignas(64) std::atomic<MpscQueueNode*> head_;
+  alignas(64) MpscQueueNode* tail_;
+};
+
+} // namespace Envoy
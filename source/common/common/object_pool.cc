@@ -0,0 +1,134 @@
+#include "common/common/object_pool.h"
+
+#include "common/common/assert.h"
+
+namespace Envoy {
+
+namespace {
+
+// Set when the calling thread's pool has been destroyed at thread exit, so that objects freed by
+// thread_local destructors that run afterwards go straight to the heap.
+thread_local bool thread_pool_destroyed = false;
+
+} // namespace
+
+constexpr size_t ObjectPool::ClassSizeStep;
+constexpr size_t ObjectPool::MaxObjectSize;
+constexpr uint64_t ObjectPool::DefaultMaxRetainedBytes;
+constexpr size_t ObjectPool::NumClasses;
+
+std::atomic<uint64_t> ObjectPool::max_retained_bytes_{ObjectPool::DefaultMaxRetainedBytes};
+std::mutex ObjectPool::registry_lock_;
+ObjectPoolStats ObjectPool::retired_stats_;
+
+std::list<ObjectPool*>& ObjectPool::registry() {
+  static std::list<ObjectPool*>* registry = new std::list<ObjectPool*>();
+  return *registry;
+}
+
+ObjectPool::ObjectPool() {
+  std::unique_lock<std::mutex> lock(registry_lock_);
+  registry().push_back(this);
+}
+
+ObjectPool::~ObjectPool() {
+  thread_pool_destroyed = true;
+  trim(0);
+  std::unique_lock<std::mutex> lock(registry_lock_);
+  registry().remove(this);
+  retired_stats_.reused_ += reused_;
+  retired_stats_.allocated_ += allocated_;
+}
+
+ObjectPool* ObjectPool::threadLocalPool() {
+  if (thread_pool_destroyed) {
+    return nullptr;
+  }
+  static thread_local ObjectPool pool;
+  return &pool;
+}
+
+void* ObjectPool::allocate(size_t size) {
+  ASSERT(size > 0);
+  ObjectPool* pool = size <= MaxObjectSize ? threadLocalPool() : nullptr;
+  if (pool == nullptr) {
+    return ::operator new(size);
+  }
+
+  const size_t size_class = sizeClass(size);
+  std::vector<void*>& free_list = pool->free_lists_[size_class];
+  if (free_list.empty()) {
+    pool->allocated_.store(pool->allocated_.load(std::memory_order_relaxed) + 1,
+                           std::memory_order_relaxed);
+    return ::operator new(classSize(size_class));
+  }
+
+  void* memory = free_list.back();
+  free_list.pop_back();
+  pool->reused_.store(pool->reused_.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+  pool->addRetained(-1, -static_cast<int64_t>(classSize(size_class)));
+  return memory;
+}
+
+void ObjectPool::release(void* memory, size_t size) {
+  if (memory == nullptr) {
+    return;
+  }
+  ObjectPool* pool = size <= MaxObjectSize ? threadLocalPool() : nullptr;
+  if (pool == nullptr) {
+    ::operator delete(memory);
+    return;
+  }
+
+  const size_t size_class = sizeClass(size);
+  const uint64_t max_retained_bytes = max_retained_bytes_.load(std::memory_order_relaxed);
+  if (pool->retained_bytes_.load(std::memory_order_relaxed) + classSize(size_class) >
+      max_retained_bytes) {
+    ::operator delete(memory);
+    // The limit may have been lowered since this pool last trimmed itself.
+    pool->trim(max_retained_bytes);
+    return;
+  }
+
+  pool->free_lists_[size_class].push_back(memory);
+  pool->addRetained(1, classSize(size_class));
+}
+
+void ObjectPool::trim(uint64_t max_retained_bytes) {
+  // Free the largest classes first since they give back the most memory per free.
+  for (size_t i = NumClasses; i > 0 && retained_bytes_ > max_retained_bytes; i--) {
+    std::vector<void*>& free_list = free_lists_[i - 1];
+    while (!free_list.empty() && retained_bytes_ > max_retained_bytes) {
+      ::operator delete(free_list.back());
+      free_list.pop_back();
+      addRetained(-1, -static_cast<int64_t>(classSize(i - 1)));
+    }
+  }
+}
+
+void ObjectPool::addRetained(int64_t objects, int64_t bytes) {
+  retained_objects_.store(retained_objects_.load(std::memory_order_relaxed) + objects,
+                          std::memory_order_relaxed);
+  retained_bytes_.store(retained_bytes_.load(std::memory_order_relaxed) + bytes,
+                        std::memory_order_relaxed);
+}
+
+void ObjectPool::setMaxRetainedBytes(uint64_t max_retained_bytes) {
+  max_retained_bytes_ = max_retained_bytes;
+}
+
+uint64_t ObjectPool::maxRetainedBytes() { return max_retained_bytes_; }
+
+ObjectPoolStats ObjectPool::stats() {
+  std::unique_lock<std::mutex> lock(registry_lock_);
+  ObjectPoolStats stats = retired_stats_;
+  for (const ObjectPool* pool : registry()) {
+    stats.retained_objects_ += pool->retained_objects_.load(std::memory_order_relaxed);
+    stats.retained_bytes_ += pool->retained_bytes_.load(std::memory_order_relaxed);
+    stats.reused_ += pool->reused_.load(std::memory_order_relaxed);
+    stats.allocated_ += pool->allocated_.load(std::memory_order_relaxed);
+  }
+  return stats;
+}
+
+} // namespace Envoy
@@ -0,0 +1,110 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <list>
+#include <mutex>
+#include <vector>
+
+#include "common/common/non_copyable.h"
+
+namespace Envoy {
+
+/**
+ * Occupancy of all object pools in the process.
+ */
+struct ObjectPoolStats {
+  // Number of free objects held by the pools, ready for reuse.
+  uint64_t retained_objects_{};
+  // Bytes of storage of those objects.
+  uint64_t retained_bytes_{};
+  // Number of allocations satisfied with the storage of an object that was freed before.
+  uint64_t reused_{};
+  // Number of pooled allocations that had to go to the heap.
+  uint64_t allocated_{};
+};
+
+/**
+ * A freelist cache of the storage of objects that are allocated and freed at a high rate, such as
+ * the objects that make up an accepted connection. Like the slice pool, each thread has its own
+ * pool, so objects allocated and freed by a worker never need synchronization. Storage is cached
+ * by size class, in steps of ClassSizeStep bytes up to MaxObjectSize bytes; larger objects go
+ * straight to the heap. Each pool retains at most maxRetainedBytes() of free storage.
+ *
+ * Classes opt in by deriving from PooledObject.
+ */
+class ObjectPool : NonCopyable {
+public:
+  static constexpr size_t ClassSizeStep = 64;
+  static constexpr size_t MaxObjectSize = 4096;
+  static constexpr uint64_t DefaultMaxRetainedBytes = 256 * 1024;
+
+  ~ObjectPool();
+
+  /**
+   * Allocate the storage of an object from the calling thread's pool.
+   * @param size supplies the size of the object.
+   * @return void* the storage. Never nullptr.
+   */
+  static void* allocate(size_t size);
+
+  /**
+   * Return storage obtained from allocate() to the calling thread's pool.
+   * @param memory supplies the storage to free.
+   * @param size supplies the size passed to allocate().
+   */
+  static void release(void* memory, size_t size);
+
+  /**
+   * Set the maximum number of bytes of free storage each thread's pool will retain. Applies to
+   * all pools, including those that already exist. Zero disables caching.
+   */
+  static void setMaxRetainedBytes(uint64_t max_retained_bytes);
+  static uint64_t maxRetainedBytes();
+
+  /**
+   * @return ObjectPoolStats the occupancy of all pools in the process.
+   */
+  static ObjectPoolStats stats();
+
+private:
+  static constexpr size_t NumClasses = MaxObjectSize / ClassSizeStep;
+
+  ObjectPool();
+
+  // @return the calling thread's pool, or nullptr if the thread is exiting.
+  static ObjectPool* threadLocalPool();
+  static size_t sizeClass(size_t size) { return (size + ClassSizeStep - 1) / ClassSizeStep - 1; }
+  static size_t classSize(size_t size_class) { return (size_class + 1) * ClassSizeStep; }
+  void trim(uint64_t max_retained_bytes);
+  void addRetained(int64_t objects, int64_t bytes);
+
+  std::vector<void*> free_lists_[NumClasses];
+  // The counters are only written by the owning thread and are read (racily, but atomically)
+  // by stats().
+  std::atomic<uint64_t> retained_objects_{};
+  std::atomic<uint64_t> retained_bytes_{};
+  std::atomic<uint64_t> reused_{};
+  std::atomic<uint64_t> allocated_{};
+
+  static std::atomic<uint64_t> max_retained_bytes_;
+  // All live pools, so that stats() can aggregate them. Guarded by registry_lock_.
+  static std::mutex registry_lock_;
+  static std::list<ObjectPool*>& registry();
+  // Counts of pools that have been destroyed, so that totals stay monotonic across thread exit.
+  static ObjectPoolStats retired_stats_;
+};
+
+/**
+ * Mixin that allocates the objects of a class, and of the classes derived from it, from the
+ * ObjectPool. The sized delete is given the size of the most derived class as long as the
+ * destructor is virtual, so derived classes of a different size each get their own size class.
+ */
+class PooledObject {
+public:
+  static void* operator new(size_t size) { return ObjectPool::allocate(size); }
+  static void operator delete(void* memory, size_t size) { ObjectPool::release(memory, size); }
+};
+
+} // namespace Envoy
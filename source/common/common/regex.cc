@@ -0,0 +1,663 @@
+#include "common/common/regex.h"
+
+#include <algorithm>
+#include <bitset>
+#include <regex>
+
+#include "common/common/assert.h"
+
+namespace Envoy {
+namespace Regex {
+
+namespace {
+
+// Bounds on the size of compiled programs, mostly reached through counted repetitions such as
+// a{1000}. Patterns beyond them are left to std::regex.
+const uint32_t MaxRepeat = 1000;
+const size_t MaxInstructions = 100000;
+
+typedef std::bitset<256> CharSet;
+
+/**
+ * A node of the syntax tree of a parsed pattern.
+ */
+struct Node {
+  enum class Type { Set, Begin, End, Concat, Alternate, Repeat };
+
+  Node(Type type) : type_(type) {}
+
+  Type type_;
+  // Type::Set: the characters matched.
+  CharSet set_;
+  // Type::Concat and Type::Alternate: the operands. Type::Repeat: the repeated node.
+  std::vector<std::unique_ptr<Node>> children_;
+  // Type::Repeat: the bounds, max_ being -1 when unbounded.
+  uint32_t min_{};
+  int64_t max_{};
+};
+
+typedef std::unique_ptr<Node> NodePtr;
+
+/**
+ * Recursive descent parser for the ECMAScript subset supported by the linear engine. Returns
+ * nullptr for anything outside of it; the full grammar is validated by std::regex beforehand, so
+ * the parser does not need to report errors precisely.
+ */
+class Parser {
+public:
+  Parser(const std::string& pattern) : pattern_(pattern) {}
+
+  NodePtr parse() {
+    NodePtr node = parseAlternate();
+    if (node == nullptr || position_ != pattern_.size()) {
+      return nullptr;
+    }
+    return node;
+  }
+
+private:
+  bool done() const { return position_ == pattern_.size(); }
+  char peek() const { return pattern_[position_]; }
+
+  NodePtr parseAlternate() {
+    NodePtr first = parseConcat();
+    if (first == nullptr || done() || peek() != '|') {
+      return first;
+    }
+    NodePtr alternate(new Node(Node::Type::Alternate));
+    alternate->children_.push_back(std::move(first));
+    while (!done() && peek() == '|') {
+      position_++;
+      NodePtr next = parseConcat();
+      if (next == nullptr) {
+        return nullptr;
+      }
+      alternate->children_.push_back(std::move(next));
+    }
+    return alternate;
+  }
+
+  NodePtr parseConcat() {
+    NodePtr concat(new Node(Node::Type::Concat));
+    while (!done() && peek() != '|' && peek() != ')') {
+      NodePtr term = parseRepeat();
+      if (term == nullptr) {
+        return nullptr;
+      }
+      concat->children_.push_back(std::move(term));
+    }
+    return concat;
+  }
+
+  NodePtr parseRepeat() {
+    NodePtr atom = parseAtom();
+    if (atom == nullptr || done()) {
+      return atom;
+    }
+
+    uint32_t min = 0;
+    int64_t max = 0;
+    switch (peek()) {
+    case '*':
+      min = 0;
+      max = -1;
+      position_++;
+      break;
+    case '+':
+      min = 1;
+      max = -1;
+      position_++;
+      break;
+    case '?':
+      min = 0;
+      max = 1;
+      position_++;
+      break;
+    case '{':
+      if (!parseBounds(min, max)) {
+        return nullptr;
+      }
+      break;
+    default:
+      return atom;
+    }
+
+    if (atom->type_ == Node::Type::Begin || atom->type_ == Node::Type::End) {
+      return nullptr;
+    }
+    // Whether a quantifier is lazy only matters for what is captured, not for whether the input
+    // matches.
+    if (!done() && peek() == '?') {
+      position_++;
+    }
+    if (!done() && (peek() == '*' || peek() == '+' || peek() == '?' || peek() == '{')) {
+      return nullptr;
+    }
+
+    NodePtr repeat(new Node(Node::Type::Repeat));
+    repeat->children_.push_back(std::move(atom));
+    repeat->min_ = min;
+    repeat->max_ = max;
+    return repeat;
+  }
+
+  // Parse {n}, {n,} or {n,m}.
+  bool parseBounds(uint32_t& min, int64_t& max) {
+    position_++;
+    if (!parseNumber(min)) {
+      return false;
+    }
+    max = min;
+    if (!done() && peek() == ',') {
+      position_++;
+      max = -1;
+      if (!done() && peek() != '}') {
+        uint32_t value;
+        if (!parseNumber(value) || value < min) {
+          return false;
+        }
+        max = value;
+      }
+    }
+    if (done() || peek() != '}') {
+      return false;
+    }
+    position_++;
+    return true;
+  }
+
+  bool parseNumber(uint32_t& value) {
+    const size_t start = position_;
+    value = 0;
+    while (!done() && peek() >= '0' && peek() <= '9') {
+      value = value * 10 + (peek() - '0');
+      if (value > MaxRepeat) {
+        return false;
+      }
+      position_++;
+    }
+    return position_ > start;
+  }
+
+  NodePtr parseAtom() {
+    const char c = peek();
+    position_++;
+    switch (c) {
+    case '(': {
+      if (!done() && peek() == '?') {
+        // Only non capturing groups are supported, not lookahead.
+        if (position_ + 1 >= pattern_.size() || pattern_[position_ + 1] != ':') {
+          return nullptr;
+        }
+        position_ += 2;
+      }
+      NodePtr group = parseAlternate();
+      if (group == nullptr || done() || peek() != ')') {
+        return nullptr;
+      }
+      position_++;
+      return group;
+    }
+    case '.': {
+      NodePtr any(new Node(Node::Type::Set));
+      any->set_.set();
+      any->set_.reset('\n');
+      any->set_.reset('\r');
+      return any;
+    }
+    case '[':
+      return parseBracket();
+    case '\\': {
+      NodePtr set(new Node(Node::Type::Set));
+      if (!parseEscape(set->set_, false)) {
+        return nullptr;
+      }
+      return set;
+    }
+    case '^':
+      return NodePtr(new Node(Node::Type::Begin));
+    case '$':
+      return NodePtr(new Node(Node::Type::End));
+    case ')':
+    case ']':
+    case '{':
+    case '}':
+    case '*':
+    case '+':
+    case '?':
+      return nullptr;
+    default:
+      return literal(c);
+    }
+  }
+
+  NodePtr literal(char c) {
+    NodePtr set(new Node(Node::Type::Set));
+    set->set_.set(static_cast<uint8_t>(c));
+    return set;
+  }
+
+  NodePtr parseBracket() {
+    NodePtr set(new Node(Node::Type::Set));
+    bool negate = false;
+    if (!done() && peek() == '^') {
+      negate = true;
+      position_++;
+    }
+    // ECMAScript gives a leading ']' a meaning of its own ([] and [^] match nothing and anything).
+    if (!done() && peek() == ']') {
+      return nullptr;
+    }
+
+    while (!done() && peek() != ']') {
+      CharSet item;
+      int first = parseBracketItem(item);
+      if (first == Invalid) {
+        return nullptr;
+      }
+      if (position_ + 1 < pattern_.size() && peek() == '-' && pattern_[position_ + 1] != ']') {
+        position_++;
+        CharSet unused;
+        const int last = parseBracketItem(unused);
+        if (first == Class || last == Class || last == Invalid || last < first) {
+          return nullptr;
+        }
+        for (int c = first; c <= last; c++) {
+          item.set(c);
+        }
+      }
+      set->set_ |= item;
+    }
+    if (done()) {
+      return nullptr;
+    }
+    position_++;
+
+    if (negate) {
+      set->set_.flip();
+    }
+    return set;
+  }
+
+  static const int Invalid = -1;
+  static const int Class = -2;
+
+  // Parse a single character or class escape of a bracket expression into `set`.
+  // @return the character, Class for a class escape or Invalid.
+  int parseBracketItem(CharSet& set) {
+    const char c = peek();
+    position_++;
+    if (c == '[') {
+      // Character classes such as [:alpha:] and collating elements.
+      if (!done() && (peek() == ':' || peek() == '.' || peek() == '=')) {
+        return Invalid;
+      }
+    } else if (c == '\\') {
+      if (done() || !parseEscape(set, true)) {
+        return Invalid;
+      }
+      return set.count() == 1 ? static_cast<int>(firstOf(set)) : Class;
+    }
+    set.set(static_cast<uint8_t>(c));
+    return static_cast<uint8_t>(c);
+  }
+
+  static size_t firstOf(const CharSet& set) {
+    for (size_t c = 0; c < set.size(); c++) {
+      if (set.test(c)) {
+        return c;
+      }
+    }
+    NOT_REACHED;
+  }
+
+  // Parse the escape following a backslash into `set`.
+  bool parseEscape(CharSet& set, bool in_bracket) {
+    if (done()) {
+      return false;
+    }
+    const char c = peek();
+    position_++;
+    switch (c) {
+    case 'd':
+    case 'D':
+      addRange(set, '0', '9');
+      break;
+    case 'w':
+    case 'W':
+      addRange(set, 'a', 'z');
+      addRange(set, 'A', 'Z');
+      addRange(set, '0', '9');
+      set.set('_');
+      break;
+    case 's':
+    case 'S':
+      for (const char space : {' ', '\t', '\n', '\v', '\f', '\r'}) {
+        set.set(static_cast<uint8_t>(space));
+      }
+      break;
+    case 'n':
+      set.set('\n');
+      return true;
+    case 'r':
+      set.set('\r');
+      return true;
+    case 't':
+      set.set('\t');
+      return true;
+    case 'v':
+      set.set('\v');
+      return true;
+    case 'f':
+      set.set('\f');
+      return true;
+    default:
+      // Backreferences, \b, \B, \0, \c, \x and \u are not supported. Any other character escapes
+      // itself.
+      if ((c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9')) {
+        return false;
+      }
+      set.set(static_cast<uint8_t>(c));
+      return true;
+    }
+
+    if (c == 'D' || c == 'W' || c == 'S') {
+      if (in_bracket) {
+        // The negation of a class within a bracket expression is left to std::regex.
+        return false;
+      }
+      set.flip();
+    }
+    return true;
+  }
+
+  static void addRange(CharSet& set, char first, char last) {
+    for (char c = first; c <= last; c++) {
+      set.set(static_cast<uint8_t>(c));
+    }
+  }
+
+  const std::string& pattern_;
+  size_t position_{};
+};
+
+} // namespace
+
+/**
+ * A compiled NFA, run as a Pike VM without captures. Instructions that do not jump continue with
+ * the next one.
+ */
+class Program {
+public:
+  bool empty() const { return starts_.empty(); }
+
+  // Compile a parsed pattern whose match reports `id`.
+  // @return false if the program would grow too large, in which case it is left unchanged.
+  bool add(const Node& node, uint32_t id) {
+    const size_t instructions = instructions_.size();
+    const size_t sets = sets_.size();
+    const uint32_t start = instructions_.size();
+    if (!compile(node)) {
+      instructions_.resize(instructions);
+      sets_.resize(sets);
+      return false;
+    }
+    emit(Op::Match, id);
+    starts_.push_back(start);
+    return true;
+  }
+
+  void match(const char* begin, const char* end, std::vector<uint32_t>& ids) const {
+    ids.clear();
+    const size_t length = end - begin;
+    std::vector<uint32_t> current;
+    std::vector<uint32_t> next;
+    std::vector<uint32_t> stack;
+    // The step during which each instruction was last added to a thread list, offset by one.
+    std::vector<size_t> added(instructions_.size(), 0);
+
+    for (const uint32_t start : starts_) {
+      addThread(current, start, 0, length, added, stack);
+    }
+    for (size_t position = 0; position < length && !current.empty(); position++) {
+      const uint8_t c = static_cast<uint8_t>(begin[position]);
+      for (const uint32_t pc : current) {
+        const Instruction& instruction = instructions_[pc];
+        if (instruction.op_ == Op::Set && sets_[instruction.argument_].test(c)) {
+          addThread(next, pc + 1, position + 1, length, added, stack);
+        }
+      }
+      current.swap(next);
+      next.clear();
+    }
+
+    for (const uint32_t pc : current) {
+      if (instructions_[pc].op_ == Op::Match) {
+        ids.push_back(instructions_[pc].argument_);
+      }
+    }
+    std::sort(ids.begin(), ids.end());
+  }
+
+private:
+  enum class Op {
+    // Consume a character of sets_[argument_].
+    Set,
+    // Continue with argument_ and with second_.
+    Split,
+    // Continue with argument_.
+    Jump,
+    // Continue only at the start of the input.
+    Begin,
+    // Continue only at the end of the input.
+    End,
+    // The pattern identified by argument_ matches if the input ends here.
+    Match,
+  };
+
+  struct Instruction {
+    Op op_;
+    uint32_t argument_;
+    uint32_t second_;
+  };
+
+  uint32_t emit(Op op, uint32_t argument = 0, uint32_t second = 0) {
+    instructions_.push_back({op, argument, second});
+    return instructions_.size() - 1;
+  }
+
+  bool compile(const Node& node) {
+    if (instructions_.size() > MaxInstructions) {
+      return false;
+    }
+
+    switch (node.type_) {
+    case Node::Type::Set:
+      sets_.push_back(node.set_);
+      emit(Op::Set, sets_.size() - 1);
+      return true;
+    case Node::Type::Begin:
+      emit(Op::Begin);
+      return true;
+    case Node::Type::End:
+      emit(Op::End);
+      return true;
+    case Node::Type::Concat:
+      for (const NodePtr& child : node.children_) {
+        if (!compile(*child)) {
+          return false;
+        }
+      }
+      return true;
+    case Node::Type::Alternate: {
+      // split L1, next; L1: a; jump end; next: split L2, next'; ...; last: z; end:
+      std::vector<uint32_t> jumps;
+      for (size_t i = 0; i < node.children_.size(); i++) {
+        uint32_t split = 0;
+        const bool last = i + 1 == node.children_.size();
+        if (!last) {
+          split = emit(Op::Split, instructions_.size() + 1);
+        }
+        if (!compile(*node.children_[i])) {
+          return false;
+        }
+        if (!last) {
+          jumps.push_back(emit(Op::Jump));
+          instructions_[split].second_ = instructions_.size();
+        }
+      }
+      for (const uint32_t jump : jumps) {
+        instructions_[jump].argument_ = instructions_.size();
+      }
+      return true;
+    }
+    case Node::Type::Repeat: {
+      const Node& child = *node.children_[0];
+      for (uint32_t i = 0; i < node.min_; i++) {
+        if (!compile(child)) {
+          return false;
+        }
+      }
+      if (node.max_ < 0) {
+        // L1: split L2, end; L2: child; jump L1; end:
+        const uint32_t split = emit(Op::Split, instructions_.size() + 1);
+        if (!compile(child)) {
+          return false;
+        }
+        emit(Op::Jump, split);
+        instructions_[split].second_ = instructions_.size();
+        return true;
+      }
+      // Each optional occurrence: split L, end; L: child; ... with all splits exiting to the end.
+      std::vector<uint32_t> splits;
+      for (int64_t i = node.min_; i < node.max_; i++) {
+        splits.push_back(emit(Op::Split, instructions_.size() + 1));
+        if (!compile(child)) {
+          return false;
+        }
+      }
+      for (const uint32_t split : splits) {
+        instructions_[split].second_ = instructions_.size();
+      }
+      return true;
+    }
+    }
+    NOT_REACHED;
+  }
+
+  // Add the thread at `pc` and every thread reachable from it without consuming input to `list`.
+  void addThread(std::vector<uint32_t>& list, uint32_t pc, size_t position, size_t length,
+                 std::vector<size_t>& added, std::vector<uint32_t>& stack) const {
+    stack.push_back(pc);
+    while (!stack.empty()) {
+      pc = stack.back();
+      stack.pop_back();
+      if (added[pc] == position + 1) {
+        continue;
+      }
+      added[pc] = position + 1;
+
+      const Instruction& instruction = instructions_[pc];
+      switch (instruction.op_) {
+      case Op::Set:
+      case Op::Match:
+        list.push_back(pc);
+        break;
+      case Op::Split:
+        stack.push_back(instruction.second_);
+        stack.push_back(instruction.argument_);
+        break;
+      case Op::Jump:
+        stack.push_back(instruction.argument_);
+        break;
+      case Op::Begin:
+        if (position == 0) {
+          stack.push_back(pc + 1);
+        }
+        break;
+      case Op::End:
+        if (position == length) {
+          stack.push_back(pc + 1);
+        }
+        break;
+      }
+    }
+  }
+
+  std::vector<Instruction> instructions_;
+  std::vector<CharSet> sets_;
+  std::vector<uint32_t> starts_;
+};
+
+namespace {
+
+class StdMatcher : public Matcher {
+public:
+  StdMatcher(std::regex&& regex) : regex_(std::move(regex)) {}
+
+  // Regex::Matcher
+  bool match(const char* begin, const char* end) const override {
+    return std::regex_match(begin, end, regex_);
+  }
+
+private:
+  const std::regex regex_;
+};
+
+class LinearMatcher : public Matcher {
+public:
+  LinearMatcher(std::unique_ptr<Program>&& program) : program_(std::move(program)) {}
+
+  // Regex::Matcher
+  bool match(const char* begin, const char* end) const override {
+    std::vector<uint32_t> ids;
+    program_->match(begin, end, ids);
+    return !ids.empty();
+  }
+
+private:
+  const std::unique_ptr<Program> program_;
+};
+
+// @return the pattern parsed for the linear engine, or nullptr if it is not supported.
+NodePtr parseLinear(const std::string& pattern) {
+  for (const char c : pattern) {
+    // Leave the handling of non ASCII bytes to std::regex.
+    if (static_cast<uint8_t>(c) >= 0x80) {
+      return nullptr;
+    }
+  }
+  return Parser(pattern).parse();
+}
+
+} // namespace
+
+PatternSet::PatternSet() : program_(new Program()) {}
+
+PatternSet::~PatternSet() {}
+
+bool PatternSet::add(const std::string& pattern, uint32_t id) {
+  NodePtr node = parseLinear(pattern);
+  return node != nullptr && program_->add(*node, id);
+}
+
+void PatternSet::match(const char* begin, const char* end, std::vector<uint32_t>& ids) const {
+  program_->match(begin, end, ids);
+}
+
+bool PatternSet::empty() const { return program_->empty(); }
+
+MatcherPtr Utility::parseRegex(const std::string& pattern, Engine engine) {
+  std::regex regex(pattern, std::regex::optimize);
+  if (engine == Engine::Linear) {
+    NodePtr node = parseLinear(pattern);
+    std::unique_ptr<Program> program(new Program());
+    if (node != nullptr && program->add(*node, 0)) {
+      return MatcherPtr{new LinearMatcher(std::move(program))};
+    }
+  }
+  return MatcherPtr{new StdMatcher(std::move(regex))};
+}
+
+} // namespace Regex
+} // namespace Envoy
@@ -0,0 +1,99 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "envoy/common/pure.h"
+
+namespace Envoy {
+namespace Regex {
+
+/**
+ * The engines a pattern can be compiled with.
+ */
+enum class Engine {
+  // std::regex. Supports the whole ECMAScript grammar, but backtracks: matching time can be
+  // exponential in the input size and deep recursion can overflow the stack on long inputs.
+  Std,
+  // A Thompson NFA simulation whose matching time is linear in the input size. Supports
+  // literals, '.', bracket expressions, the \d \w \s classes and their negations, '^' and '$',
+  // groups, alternation and the greedy and lazy quantifiers. Patterns using anything else (e.g.
+  // backreferences, lookahead or word boundaries) are compiled with std::regex instead.
+  Linear,
+};
+
+/**
+ * A compiled regular expression.
+ */
+class Matcher {
+public:
+  virtual ~Matcher() {}
+
+  /**
+   * @param begin supplies the start of the input.
+   * @param end supplies the end of the input.
+   * @return whether the whole input matches the pattern, like std::regex_match().
+   */
+  virtual bool match(const char* begin, const char* end) const PURE;
+
+  bool match(const std::string& value) const {
+    return match(value.data(), value.data() + value.size());
+  }
+};
+
+typedef std::unique_ptr<const Matcher> MatcherPtr;
+
+class Program;
+
+/**
+ * A set of patterns matched against an input in a single pass with the linear engine.
+ */
+class PatternSet {
+public:
+  PatternSet();
+  ~PatternSet();
+
+  /**
+   * Add a pattern to the set.
+   * @param pattern supplies the pattern, which must be valid ECMAScript.
+   * @param id supplies the identifier reported by match() when the pattern matches.
+   * @return false if the linear engine does not support the pattern, in which case the set is left
+   *         unchanged.
+   */
+  bool add(const std::string& pattern, uint32_t id);
+
+  /**
+   * Find the patterns matching the whole of an input.
+   * @param begin supplies the start of the input.
+   * @param end supplies the end of the input.
+   * @param ids is cleared and filled with the identifiers of the matching patterns, in ascending
+   *        order.
+   */
+  void match(const char* begin, const char* end, std::vector<uint32_t>& ids) const;
+
+  bool empty() const;
+
+private:
+  std::unique_ptr<Program> program_;
+};
+
+/**
+ * Utilities for compiling regular expressions.
+ */
+class Utility {
+public:
+  /**
+   * Compile a pattern. The pattern is always validated with std::regex, so that the same patterns
+   * are rejected whatever the engine.
+   * @param pattern supplies the ECMAScript pattern.
+   * @param engine supplies the preferred engine.
+   * @return MatcherPtr the compiled pattern.
+   * @throw std::regex_error if the pattern is invalid.
+   */
+  static MatcherPtr parseRegex(const std::string& pattern, Engine engine = Engine::Linear);
+};
+
+} // namespace Regex
+} // namespace Envoy
@@ -0,0 +1,94 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+
+#include "common/common/assert.h"
+#include "common/common/non_copyable.h"
+
+namespace Envoy {
+
+/**
+ * Lock-free ring of bytes with a single producer and a single consumer. The producer and the
+ * consumer may run on different threads; each side only writes its own position, so neither ever
+ * waits for the other. The capacity must be a power of two.
+ */
+class SpscRingBuffer : NonCopyable {
+public:
+  SpscRingBuffer(uint64_t capacity) : capacity_(capacity), data_(new char[capacity]) {
+    ASSERT(capacity > 0 && (capacity & (capacity - 1)) == 0);
+  }
+
+  /**
+   * @return uint64_t the capacity.
+   */
+  uint64_t capacity() const { return capacity_; }
+
+  /**
+   * @return uint64_t the number of bytes write() can add. Producer only.
+   */
+  uint64_t writable() const {
+    return capacity_ - (tail_.load(std::memory_order_relaxed) -
+                        head_.load(std::memory_order_acquire));
+  }
+
+  /**
+   * @return uint64_t the number of bytes waiting to be read. Either side may call this.
+   */
+  uint64_t readable() const {
+    // The consumer never passes the producer, so loading the head first keeps the result from
+    // underflowing when the consumer reads in between.
+    const uint64_t head = head_.load(std::memory_order_acquire);
+    return tail_.load(std::memory_order_acquire) - head;
+  }
+
+  /**
+   * Append data. Producer only.
+   * @param data supplies the data.
+   * @param size supplies the size of the data, which must not exceed writable().
+   */
+  void write(const void* data, uint64_t size) {
+    ASSERT(size <= writable());
+    const uint64_t tail = tail_.load(std::memory_order_relaxed);
+    const uint64_t offset = tail & (capacity_ - 1);
+    const uint64_t first = std::min(size, capacity_ - offset);
+    memcpy(data_.get() + offset, data, first);
+    memcpy(data_.get(), static_cast<const char*>(data) + first, size - first);
+    tail_.store(tail + size, std::memory_order_release);
+  }
+
+  /**
+   * Take all readable data. Consumer only.
+   * @param cb supplies the callback that is called with each contiguous piece of the data, at
+   *        most twice, before the space is handed back to the producer.
+   * @return uint64_t the number of bytes taken.
+   */
+  template <class ReadCb> uint64_t read(ReadCb cb) {
+    const uint64_t head = head_.load(std::memory_order_relaxed);
+    const uint64_t size = tail_.load(std::memory_order_acquire) - head;
+    if (size == 0) {
+      return 0;
+    }
+    const uint64_t offset = head & (capacity_ - 1);
+    const uint64_t first = std::min(size, capacity_ - offset);
+    cb(data_.get() + offset, first);
+    if (size > first) {
+      cb(data_.get(), size - first);
+    }
+    head_.store(head + size, std::memory_order_release);
+    return size;
+  }
+
+private:
+  const uint64_t capacity_;
+  const std::unique_ptr<char[]> data_;
+  // Total bytes ever taken by the consumer and added by the producer. On separate cache lines so
+  // that the two sides do not invalidate each other's position on every operation.
+  alignas(64) std::atomic<uint64_t> head_{};
+  alignas(64) std::atomic<uint64_t> tail_{};
+};
+
+} // namespace Envoy
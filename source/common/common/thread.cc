@@ -1,11 +1,15 @@
 #include "common/common/thread.h"
 
 #ifdef __linux__
+#include <linux/mempolicy.h>
+#include <pthread.h>
+#include <sched.h>
 #include <sys/syscall.h>
 #elif defined(__APPLE__)
 #include <pthread.h>
 #endif
 
+#include <cerrno>
 #include <functional>
 
 #include "common/common/assert.h"
@@ -37,6 +41,36 @@ int32_t Thread::currentThreadId() {
 #endif
 }
 
+bool Thread::pinCurrentThread(uint32_t cpu) {
+#ifdef __linux__
+  if (cpu >= CPU_SETSIZE) {
+    errno = EINVAL;
+    return false;
+  }
+  cpu_set_t cpus;
+  CPU_ZERO(&cpus);
+  CPU_SET(cpu, &cpus);
+  const int rc = pthread_setaffinity_np(pthread_self(), sizeof(cpus), &cpus);
+  if (rc != 0) {
+    errno = rc;
+    return false;
+  }
+  return true;
+#else
+  UNREFERENCED_PARAMETER(cpu);
+  return false;
+#endif
+}
+
+bool Thread::useLocalNumaMemory() {
+#ifdef __linux__
+  // There is no glibc wrapper for set_mempolicy() without libnuma.
+  return syscall(SYS_set_mempolicy, MPOL_LOCAL, nullptr, 0) == 0;
+#else
+  return false;
+#endif
+}
+
 void Thread::join() {
   int rc = pthread_join(thread_id_, nullptr);
   RELEASE_ASSERT(rc == 0);
@@ -24,6 +24,19 @@ public:
    */
   static ThreadId currentThreadId();
 
+  /**
+   * Pin the calling thread to a CPU.
+   * @return bool whether the thread was pinned, false on error or where threads have no affinity.
+   */
+  static bool pinCurrentThread(uint32_t cpu);
+
+  /**
+   * Make the calling thread allocate memory from the NUMA node of the CPU it runs on rather than
+   * with the policy of the process.
+   * @return bool whether the policy was set, false on error or on platforms without NUMA policies.
+   */
+  static bool useLocalNumaMemory();
+
   /**
    * Join on thread exit.
    */
@@ -0,0 +1,7 @@
+#include "common/common/thread_load.h"
+
+namespace Envoy {
+
+thread_local ThreadLoad* ThreadLoad::current_{};
+
+} // namespace Envoy
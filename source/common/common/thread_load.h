@@ -0,0 +1,84 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+
+namespace Envoy {
+
+/**
+ * Load counters of a thread, i.e. of a worker. The thread that owns them makes them current, after
+ * which the code running on it updates them through the static functions below without knowing
+ * whose they are, which are no-ops on the threads that have none. The counters are only written by
+ * the owning thread and may be read from any thread.
+ */
+class ThreadLoad {
+public:
+  /**
+   * @return ThreadLoad* the counters of the calling thread, or nullptr if it has none.
+   */
+  static ThreadLoad* current() { return current_; }
+
+  /**
+   * Make counters the ones of the calling thread.
+   * @param load supplies the counters, or nullptr to clear them. They must outlive their use.
+   */
+  static void setCurrent(ThreadLoad* load) { current_ = load; }
+
+  static void addRxBytes(uint64_t bytes) {
+    if (current_ != nullptr && bytes > 0) {
+      current_->rx_bytes_.fetch_add(bytes, std::memory_order_relaxed);
+    }
+  }
+
+  static void addTxBytes(uint64_t bytes) {
+    if (current_ != nullptr && bytes > 0) {
+      current_->tx_bytes_.fetch_add(bytes, std::memory_order_relaxed);
+    }
+  }
+
+  static void onRequestStart() {
+    if (current_ != nullptr) {
+      current_->requests_total_.fetch_add(1, std::memory_order_relaxed);
+      current_->active_requests_.fetch_add(1, std::memory_order_relaxed);
+    }
+  }
+
+  static void onRequestEnd() {
+    if (current_ != nullptr) {
+      current_->active_requests_.fetch_sub(1, std::memory_order_relaxed);
+    }
+  }
+
+  /**
+   * Account for time the event loop of the thread spent running callbacks rather than polling.
+   * Once called, busyTracked() is true.
+   */
+  static void addBusyTime(std::chrono::microseconds busy) {
+    if (current_ != nullptr) {
+      current_->busy_us_.fetch_add(busy.count(), std::memory_order_relaxed);
+      current_->busy_tracked_.store(true, std::memory_order_relaxed);
+    }
+  }
+
+  uint64_t requestsTotal() const { return requests_total_.load(std::memory_order_relaxed); }
+  uint64_t activeRequests() const { return active_requests_.load(std::memory_order_relaxed); }
+  uint64_t rxBytes() const { return rx_bytes_.load(std::memory_order_relaxed); }
+  uint64_t txBytes() const { return tx_bytes_.load(std::memory_order_relaxed); }
+  std::chrono::microseconds busyTime() const {
+    return std::chrono::microseconds(busy_us_.load(std::memory_order_relaxed));
+  }
+  bool busyTracked() const { return busy_tracked_.load(std::memory_order_relaxed); }
+
+private:
+  static thread_local ThreadLoad* current_;
+
+  std::atomic<uint64_t> requests_total_{};
+  std::atomic<uint64_t> active_requests_{};
+  std::atomic<uint64_t> rx_bytes_{};
+  std::atomic<uint64_t> tx_bytes_{};
+  std::atomic<uint64_t> busy_us_{};
+  std::atomic<bool> busy_tracked_{};
+};
+
+} // namespace Envoy
@@ -72,6 +72,23 @@ public:
    */
   void flush(Buffer::Instance& output_buffer);
 
+  /**
+   * Finish should be called once all data of the stream has been passed to compress(). It
+   * compresses any remaining input and writes the end of the stream (for gzip, the trailer holding
+   * the checksum and length) to the output buffer. No more data can be compressed afterwards until
+   * reset() is called.
+   * @param output_buffer supplies the buffer to output compressed data.
+   */
+  void finish(Buffer::Instance& output_buffer);
+
+  /**
+   * Reset discards any pending state and makes the compressor ready to compress a new stream with
+   * the parameters it was initialized with. This is much cheaper than creating and initializing a
+   * new compressor, so it allows compressors to be reused across streams. Init must already have
+   * been called.
+   */
+  void reset();
+
   /**
    * It returns the checksum of all output produced so far. Compressor's checksum at the end of the
    * stream has to match decompressor's checksum produced at the end of the decompression.
@@ -3,9 +3,11 @@
 #include "common/common/assert.h"
 #include "common/config/address_json.h"
 #include "common/config/json_utility.h"
+#include "common/config/metadata.h"
 #include "common/config/protocol_json.h"
 #include "common/config/tls_context_json.h"
 #include "common/config/utility.h"
+#include "common/config/well_known_names.h"
 #include "common/json/config_schemas.h"
 
 namespace Envoy {
@@ -155,6 +157,16 @@ void CdsJson::translateCluster(const Json::Object& json_cluster,
     cluster.set_lb_policy(envoy::api::v2::Cluster::RANDOM);
   } else if (lb_type == "original_dst_lb") {
     cluster.set_lb_policy(envoy::api::v2::Cluster::ORIGINAL_DST_LB);
+  } else if (lb_type == "peak_ewma") {
+    cluster.set_lb_policy(envoy::api::v2::Cluster::LEAST_REQUEST);
+    Metadata::mutableMetadataValue(*cluster.mutable_metadata(), MetadataFilters::get().ENVOY_LB,
+                                   MetadataEnvoyLbKeys::get().PEAK_EWMA)
+        .set_bool_value(true);
+  } else if (lb_type == "maglev") {
+    cluster.set_lb_policy(envoy::api::v2::Cluster::RING_HASH);
+    Metadata::mutableMetadataValue(*cluster.mutable_metadata(), MetadataFilters::get().ENVOY_LB,
+                                   MetadataEnvoyLbKeys::get().MAGLEV)
+        .set_bool_value(true);
   } else {
     ASSERT(lb_type == "ring_hash");
     cluster.set_lb_policy(envoy::api::v2::Cluster::RING_HASH);
@@ -165,25 +165,28 @@ void GrpcMuxImpl::onReceiveMessage(std::unique_ptr<envoy::api::v2::DiscoveryResp
     // build a map here from resource name to resource and then walk watches_.
     // We have to walk all watches (and need an efficient map as a result) to
     // ensure we deliver empty config updates when a resource is dropped.
-    std::unordered_map<std::string, ProtobufWkt::Any> resources;
+    // The map points into the response rather than copying it, and the resources of each watch
+    // are copied onto an arena of the update, so a large response takes a few large allocations
+    // that are released at once.
+    Protobuf::Arena arena;
+    std::unordered_map<std::string, const ProtobufWkt::Any*> resources;
     for (const auto& resource : message->resources()) {
       if (type_url != resource.type_url()) {
         throw EnvoyException(fmt::format("{} does not match {} type URL is DiscoveryResponse {}",
                                          resource.type_url(), type_url, message->DebugString()));
       }
-      const std::string resource_name = Utility::resourceName(resource);
-      resources.emplace(resource_name, resource);
+      resources.emplace(Utility::resourceName(resource), &resource);
     }
     for (auto watch : api_state_[type_url].watches_) {
       if (watch->resources_.empty()) {
         watch->callbacks_.onConfigUpdate(message->resources(), message->version_info());
         continue;
       }
-      Protobuf::RepeatedPtrField<ProtobufWkt::Any> found_resources;
-      for (auto watched_resource_name : watch->resources_) {
+      Protobuf::RepeatedPtrField<ProtobufWkt::Any> found_resources(&arena);
+      for (const auto& watched_resource_name : watch->resources_) {
         auto it = resources.find(watched_resource_name);
         if (it != resources.end()) {
-          found_resources.Add()->MergeFrom(it->second);
+          found_resources.Add()->MergeFrom(*it->second);
         }
       }
       watch->callbacks_.onConfigUpdate(found_resources, message->version_info());
@@ -1,10 +1,16 @@
 #pragma once
 
+#include <map>
+#include <string>
+#include <unordered_set>
+#include <vector>
+
 #include "envoy/config/grpc_mux.h"
 #include "envoy/config/subscription.h"
 
 #include "common/common/assert.h"
 #include "common/common/logger.h"
+#include "common/config/utility.h"
 #include "common/grpc/common.h"
 #include "common/protobuf/protobuf.h"
 #include "common/protobuf/utility.h"
@@ -47,10 +53,11 @@ public:
   // Config::GrpcMuxCallbacks
   void onConfigUpdate(const Protobuf::RepeatedPtrField<ProtobufWkt::Any>& resources,
                       const std::string& version_info) override {
-    Protobuf::RepeatedPtrField<ResourceType> typed_resources;
-    std::transform(resources.cbegin(), resources.cend(),
-                   Protobuf::RepeatedPtrFieldBackInserter(&typed_resources),
-                   MessageUtil::anyConvert<ResourceType>);
+    // The resources are parsed in place onto an arena of the update, rather than one heap
+    // allocation per message, and the arena releases them at once.
+    Protobuf::Arena arena;
+    Protobuf::RepeatedPtrField<ResourceType> typed_resources(&arena);
+    Utility::unpackResources(resources, typed_resources);
     callbacks_->onConfigUpdate(typed_resources);
     stats_.update_success_.inc();
     stats_.update_attempt_.inc();
@@ -60,6 +67,49 @@ public:
               resources.size(), RepeatedPtrUtil::debugString(typed_resources));
   }
 
+  void
+  onIncrementalConfigUpdate(const Protobuf::RepeatedPtrField<ProtobufWkt::Any>& added_resources,
+                            const std::vector<std::string>& removed_resources,
+                            const std::string& version_info) override {
+    Protobuf::Arena arena;
+    Protobuf::RepeatedPtrField<ResourceType> typed_added_resources(&arena);
+    Utility::unpackResources(added_resources, typed_added_resources);
+    if (callbacks_->supportsIncrementalUpdates()) {
+      callbacks_->onIncrementalConfigUpdate(typed_added_resources, removed_resources);
+    } else {
+      // Merge the update into the resources received so far and hand over the complete set.
+      // Nothing is merged until the callbacks accept it.
+      std::unordered_set<std::string> replaced(removed_resources.begin(), removed_resources.end());
+      std::vector<std::string> added_names;
+      for (const auto& resource : added_resources) {
+        added_names.push_back(Utility::resourceName(resource));
+        replaced.insert(added_names.back());
+      }
+      Protobuf::RepeatedPtrField<ResourceType> typed_resources(&arena);
+      for (const auto& resource : resources_) {
+        if (replaced.count(resource.first) == 0) {
+          typed_resources.Add()->CopyFrom(resource.second);
+        }
+      }
+      for (const auto& resource : typed_added_resources) {
+        typed_resources.Add()->CopyFrom(resource);
+      }
+      callbacks_->onConfigUpdate(typed_resources);
+      for (const std::string& name : removed_resources) {
+        resources_.erase(name);
+      }
+      for (int i = 0; i < typed_added_resources.size(); i++) {
+        resources_[added_names[i]].Swap(typed_added_resources.Mutable(i));
+      }
+    }
+    stats_.update_success_.inc();
+    stats_.update_attempt_.inc();
+    version_info_ = version_info;
+    stats_.version_.set(HashUtil::xxHash64(version_info_));
+    ENVOY_LOG(debug, "gRPC config for {} accepted with {} resources added and {} removed",
+              type_url_, added_resources.size(), removed_resources.size());
+  }
+
   void onConfigUpdateFailed(const EnvoyException* e) override {
     // TODO(htuch): Less fragile signal that this is failure vs. reject.
     if (e == nullptr) {
@@ -80,6 +130,9 @@ private:
   SubscriptionCallbacks<ResourceType>* callbacks_{};
   GrpcMuxWatchPtr watch_{};
   std::string version_info_;
+  // The resources received through incremental updates, by name, when the callbacks do not take
+  // incremental updates.
+  std::map<std::string, ResourceType> resources_;
 };
 
 } // namespace Config
@@ -0,0 +1,282 @@
+#include "common/config/incremental_grpc_mux_impl.h"
+
+#include <algorithm>
+#include <iterator>
+#include <unordered_set>
+
+#include "common/protobuf/protobuf.h"
+
+#include "fmt/format.h"
+
+namespace Envoy {
+namespace Config {
+
+const std::string IncrementalGrpcMuxImpl::SERVICE_METHOD =
+    "envoy.config.IncrementalAggregatedDiscoveryService.IncrementalAggregatedResources";
+
+IncrementalGrpcMuxImpl::IncrementalGrpcMuxImpl(
+    const envoy::api::v2::Node& node,
+    std::unique_ptr<Grpc::AsyncClient<envoy::config::IncrementalDiscoveryRequest,
+                                      envoy::config::IncrementalDiscoveryResponse>>
+        async_client,
+    Event::Dispatcher& dispatcher, const Protobuf::MethodDescriptor& service_method)
+    : node_(node), async_client_(std::move(async_client)), service_method_(service_method) {
+  retry_timer_ = dispatcher.createTimer([this]() -> void { establishNewStream(); });
+}
+
+IncrementalGrpcMuxImpl::IncrementalGrpcMuxImpl(const envoy::api::v2::Node& node,
+                                               Upstream::ClusterManager& cluster_manager,
+                                               const std::string& remote_cluster_name,
+                                               Event::Dispatcher& dispatcher,
+                                               const Protobuf::MethodDescriptor& service_method)
+    : IncrementalGrpcMuxImpl(
+          node,
+          std::unique_ptr<Grpc::AsyncClientImpl<envoy::config::IncrementalDiscoveryRequest,
+                                                envoy::config::IncrementalDiscoveryResponse>>(
+              new Grpc::AsyncClientImpl<envoy::config::IncrementalDiscoveryRequest,
+                                        envoy::config::IncrementalDiscoveryResponse>(
+                  cluster_manager, remote_cluster_name)),
+          dispatcher, service_method) {}
+
+IncrementalGrpcMuxImpl::~IncrementalGrpcMuxImpl() {
+  for (const auto& api_state : api_state_) {
+    for (auto watch : api_state.second.watches_) {
+      watch->inserted_ = false;
+    }
+  }
+}
+
+void IncrementalGrpcMuxImpl::start() { establishNewStream(); }
+
+void IncrementalGrpcMuxImpl::setRetryTimer() {
+  retry_timer_->enableTimer(std::chrono::milliseconds(RETRY_DELAY_MS));
+}
+
+void IncrementalGrpcMuxImpl::establishNewStream() {
+  ENVOY_LOG(debug, "Establishing new gRPC bidi stream for {}", service_method_.DebugString());
+  stream_ = async_client_->start(service_method_, *this);
+  if (stream_ == nullptr) {
+    ENVOY_LOG(warn, "Unable to establish new stream");
+    handleFailure();
+    return;
+  }
+
+  // The server has no state for the new stream, so every API starts over with the names it
+  // watches and the versions it has.
+  for (auto& api_state : api_state_) {
+    api_state.second.subscribed_names_.clear();
+    api_state.second.response_nonce_.clear();
+    api_state.second.error_detail_.clear();
+    api_state.second.first_request_ = true;
+  }
+  for (const auto type_url : subscriptions_) {
+    sendDiscoveryRequest(type_url);
+  }
+}
+
+void IncrementalGrpcMuxImpl::sendDiscoveryRequest(const std::string& type_url) {
+  if (stream_ == nullptr) {
+    ENVOY_LOG(debug, "No stream available to sendDiscoveryRequest for {}", type_url);
+    return;
+  }
+
+  ApiState& api_state = api_state_[type_url];
+  if (api_state.paused_) {
+    ENVOY_LOG(trace, "API {} paused during sendDiscoveryRequest(), setting pending.", type_url);
+    api_state.pending_ = true;
+    return;
+  }
+
+  std::set<std::string> names;
+  for (const auto* watch : api_state.watches_) {
+    names.insert(watch->resources_.begin(), watch->resources_.end());
+  }
+
+  envoy::config::IncrementalDiscoveryRequest request;
+  request.set_type_url(type_url);
+  if (api_state.first_request_) {
+    request.mutable_node()->MergeFrom(node_);
+    for (const std::string& name : names) {
+      request.add_resource_names_subscribe(name);
+    }
+    for (const auto& version : api_state.versions_) {
+      if (names.empty() || names.count(version.first) > 0) {
+        (*request.mutable_initial_resource_versions())[version.first] = version.second;
+      }
+    }
+    api_state.first_request_ = false;
+  } else {
+    std::vector<std::string> subscribe;
+    std::set_difference(names.begin(), names.end(), api_state.subscribed_names_.begin(),
+                        api_state.subscribed_names_.end(), std::back_inserter(subscribe));
+    std::vector<std::string> unsubscribe;
+    std::set_difference(api_state.subscribed_names_.begin(), api_state.subscribed_names_.end(),
+                        names.begin(), names.end(), std::back_inserter(unsubscribe));
+    if (subscribe.empty() && unsubscribe.empty() && api_state.response_nonce_.empty()) {
+      return;
+    }
+    for (const std::string& name : subscribe) {
+      request.add_resource_names_subscribe(name);
+    }
+    for (const std::string& name : unsubscribe) {
+      request.add_resource_names_unsubscribe(name);
+      api_state.versions_.erase(name);
+    }
+  }
+  request.set_response_nonce(api_state.response_nonce_);
+  request.set_error_detail(api_state.error_detail_);
+  api_state.response_nonce_.clear();
+  api_state.error_detail_.clear();
+  api_state.subscribed_names_ = std::move(names);
+
+  ENVOY_LOG(trace, "Sending IncrementalDiscoveryRequest for {}: {}", type_url,
+            request.DebugString());
+  stream_->sendMessage(request, false);
+}
+
+void IncrementalGrpcMuxImpl::handleFailure() {
+  for (const auto& api_state : api_state_) {
+    for (auto watch : api_state.second.watches_) {
+      watch->callbacks_.onConfigUpdateFailed(nullptr);
+    }
+  }
+  setRetryTimer();
+}
+
+GrpcMuxWatchPtr IncrementalGrpcMuxImpl::subscribe(const std::string& type_url,
+                                                  const std::vector<std::string>& resources,
+                                                  GrpcMuxCallbacks& callbacks) {
+  auto watch = std::unique_ptr<GrpcMuxWatch>(
+      new IncrementalGrpcMuxWatchImpl(resources, callbacks, type_url, *this));
+  ENVOY_LOG(debug, "Incremental gRPC mux subscribe for " + type_url);
+
+  // As in GrpcMuxImpl, the first subscription of each type orders the requests on the stream.
+  if (!api_state_[type_url].subscribed_) {
+    api_state_[type_url].subscribed_ = true;
+    subscriptions_.emplace_back(type_url);
+  }
+
+  // Only the names that are new to the API are sent.
+  sendDiscoveryRequest(type_url);
+
+  return watch;
+}
+
+void IncrementalGrpcMuxImpl::pause(const std::string& type_url) {
+  ENVOY_LOG(debug, "Pausing discovery requests for {}", type_url);
+  ApiState& api_state = api_state_[type_url];
+  ASSERT(!api_state.paused_);
+  ASSERT(!api_state.pending_);
+  api_state.paused_ = true;
+}
+
+void IncrementalGrpcMuxImpl::resume(const std::string& type_url) {
+  ENVOY_LOG(debug, "Resuming discovery requests for {}", type_url);
+  ApiState& api_state = api_state_[type_url];
+  ASSERT(api_state.paused_);
+  api_state.paused_ = false;
+
+  if (api_state.pending_) {
+    ASSERT(api_state.subscribed_);
+    sendDiscoveryRequest(type_url);
+    api_state.pending_ = false;
+  }
+}
+
+void IncrementalGrpcMuxImpl::onCreateInitialMetadata(Http::HeaderMap& metadata) {
+  UNREFERENCED_PARAMETER(metadata);
+}
+
+void IncrementalGrpcMuxImpl::onReceiveInitialMetadata(Http::HeaderMapPtr&& metadata) {
+  UNREFERENCED_PARAMETER(metadata);
+}
+
+void IncrementalGrpcMuxImpl::onReceiveMessage(
+    std::unique_ptr<envoy::config::IncrementalDiscoveryResponse>&& message) {
+  const std::string& type_url = message->type_url();
+  ENVOY_LOG(debug, "Received incremental gRPC message for {} at version {}: {} added, {} removed",
+            type_url, message->system_version_info(), message->resources_size(),
+            message->removed_resources_size());
+  auto api_state_it = api_state_.find(type_url);
+  if (api_state_it == api_state_.end()) {
+    ENVOY_LOG(warn, "Ignoring unknown type URL {}", type_url);
+    return;
+  }
+  ApiState& api_state = api_state_it->second;
+
+  try {
+    // Resources come with their names, so watches are matched without decoding them. Each watch
+    // is only handed the part of the update that concerns it.
+    std::unordered_map<std::string, const ProtobufWkt::Any*> added;
+    for (const auto& resource : message->resources()) {
+      if (type_url != resource.resource().type_url()) {
+        throw EnvoyException(
+            fmt::format("{} does not match {} type URL is IncrementalDiscoveryResponse {}",
+                        resource.resource().type_url(), type_url, message->DebugString()));
+      }
+      added.emplace(resource.name(), &resource.resource());
+    }
+    const std::unordered_set<std::string> removed(message->removed_resources().begin(),
+                                                  message->removed_resources().end());
+
+    // As in GrpcMuxImpl, the resources of each watch are copied onto an arena of the update.
+    Protobuf::Arena arena;
+    for (auto watch : api_state.watches_) {
+      Protobuf::RepeatedPtrField<ProtobufWkt::Any> watch_added(&arena);
+      std::vector<std::string> watch_removed;
+      if (watch->resources_.empty()) {
+        for (const auto& resource : message->resources()) {
+          watch_added.Add()->MergeFrom(resource.resource());
+        }
+        watch_removed.assign(message->removed_resources().begin(),
+                             message->removed_resources().end());
+      } else {
+        for (const std::string& name : watch->resources_) {
+          auto it = added.find(name);
+          if (it != added.end()) {
+            watch_added.Add()->MergeFrom(*it->second);
+          } else if (removed.count(name) > 0) {
+            watch_removed.push_back(name);
+          }
+        }
+      }
+      // A new watch hears back at least once, so that it can finish initializing even if none
+      // of its resources exist.
+      if (watch_added.empty() && watch_removed.empty() && watch->updated_) {
+        continue;
+      }
+      watch->updated_ = true;
+      watch->callbacks_.onIncrementalConfigUpdate(watch_added, watch_removed,
+                                                  message->system_version_info());
+    }
+
+    for (const auto& resource : message->resources()) {
+      api_state.versions_[resource.name()] = resource.version();
+    }
+    for (const std::string& name : message->removed_resources()) {
+      api_state.versions_.erase(name);
+    }
+  } catch (const EnvoyException& e) {
+    ENVOY_LOG(warn, "Incremental gRPC config for {} update rejected: {}", type_url, e.what());
+    api_state.error_detail_ = e.what();
+    for (auto watch : api_state.watches_) {
+      watch->callbacks_.onConfigUpdateFailed(&e);
+    }
+  }
+  api_state.response_nonce_ = message->nonce();
+  sendDiscoveryRequest(type_url);
+}
+
+void IncrementalGrpcMuxImpl::onReceiveTrailingMetadata(Http::HeaderMapPtr&& metadata) {
+  UNREFERENCED_PARAMETER(metadata);
+}
+
+void IncrementalGrpcMuxImpl::onRemoteClose(Grpc::Status::GrpcStatus status,
+                                           const std::string& message) {
+  ENVOY_LOG(warn, "Incremental gRPC config stream closed: {}, {}", status, message);
+  stream_ = nullptr;
+  handleFailure();
+}
+
+} // namespace Config
+} // namespace Envoy
@@ -0,0 +1,134 @@
+#pragma once
+
+#include <list>
+#include <set>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "envoy/config/grpc_mux.h"
+#include "envoy/config/subscription.h"
+#include "envoy/event/dispatcher.h"
+#include "envoy/upstream/cluster_manager.h"
+
+#include "common/common/logger.h"
+#include "common/grpc/async_client_impl.h"
+
+#include "api/base.pb.h"
+#include "source/common/config/incremental_discovery.pb.h"
+
+namespace Envoy {
+namespace Config {
+
+/**
+ * ADS API implementation that fetches via gRPC with the incremental protocol of
+ * incremental_discovery.proto. The server sends only the resources that changed and the names of
+ * those removed, so the cost of an update scales with the size of the change rather than with the
+ * number of resources. Watches are only called back when one of their resources changed, through
+ * GrpcMuxCallbacks::onIncrementalConfigUpdate(). The versions of the resources received are kept
+ * so that a new stream resumes where the last one left off.
+ */
+class IncrementalGrpcMuxImpl
+    : public GrpcMux,
+      Grpc::AsyncStreamCallbacks<envoy::config::IncrementalDiscoveryResponse>,
+      Logger::Loggable<Logger::Id::upstream> {
+public:
+  IncrementalGrpcMuxImpl(const envoy::api::v2::Node& node,
+                         Upstream::ClusterManager& cluster_manager,
+                         const std::string& remote_cluster_name, Event::Dispatcher& dispatcher,
+                         const Protobuf::MethodDescriptor& service_method);
+  IncrementalGrpcMuxImpl(
+      const envoy::api::v2::Node& node,
+      std::unique_ptr<Grpc::AsyncClient<envoy::config::IncrementalDiscoveryRequest,
+                                        envoy::config::IncrementalDiscoveryResponse>>
+          async_client,
+      Event::Dispatcher& dispatcher, const Protobuf::MethodDescriptor& service_method);
+  ~IncrementalGrpcMuxImpl();
+
+  void start() override;
+  GrpcMuxWatchPtr subscribe(const std::string& type_url, const std::vector<std::string>& resources,
+                            GrpcMuxCallbacks& callbacks) override;
+  void pause(const std::string& type_url) override;
+  void resume(const std::string& type_url) override;
+
+  // Grpc::AsyncStreamCallbacks
+  void onCreateInitialMetadata(Http::HeaderMap& metadata) override;
+  void onReceiveInitialMetadata(Http::HeaderMapPtr&& metadata) override;
+  void onReceiveMessage(
+      std::unique_ptr<envoy::config::IncrementalDiscoveryResponse>&& message) override;
+  void onReceiveTrailingMetadata(Http::HeaderMapPtr&& metadata) override;
+  void onRemoteClose(Grpc::Status::GrpcStatus status, const std::string& message) override;
+
+  // The gRPC method of the incremental protocol.
+  static const std::string SERVICE_METHOD;
+
+  // The same delay as GrpcMuxImpl before a failed stream is established again.
+  const uint32_t RETRY_DELAY_MS = 5000;
+
+private:
+  void setRetryTimer();
+  void establishNewStream();
+  void sendDiscoveryRequest(const std::string& type_url);
+  void handleFailure();
+
+  struct IncrementalGrpcMuxWatchImpl : public GrpcMuxWatch {
+    IncrementalGrpcMuxWatchImpl(const std::vector<std::string>& resources,
+                                GrpcMuxCallbacks& callbacks, const std::string& type_url,
+                                IncrementalGrpcMuxImpl& parent)
+        : resources_(resources), callbacks_(callbacks), type_url_(type_url), parent_(parent),
+          inserted_(true) {
+      entry_ = parent.api_state_[type_url].watches_.emplace(
+          parent.api_state_[type_url].watches_.begin(), this);
+    }
+    ~IncrementalGrpcMuxWatchImpl() override {
+      if (inserted_) {
+        parent_.api_state_[type_url_].watches_.erase(entry_);
+        parent_.sendDiscoveryRequest(type_url_);
+      }
+    }
+    std::vector<std::string> resources_;
+    GrpcMuxCallbacks& callbacks_;
+    const std::string type_url_;
+    IncrementalGrpcMuxImpl& parent_;
+    std::list<IncrementalGrpcMuxWatchImpl*>::iterator entry_;
+    bool inserted_;
+    // Has the watch been called back since it subscribed?
+    bool updated_{};
+  };
+
+  // Per muxed API state.
+  struct ApiState {
+    // Watches on the returned resources for the API.
+    std::list<IncrementalGrpcMuxWatchImpl*> watches_;
+    // Resource names subscribed to on the current stream.
+    std::set<std::string> subscribed_names_;
+    // Versions of the resources accepted, by name.
+    std::unordered_map<std::string, std::string> versions_;
+    // Nonce of the last response, until a request acknowledges or rejects it.
+    std::string response_nonce_;
+    // Reason the last response was rejected, if it was.
+    std::string error_detail_;
+    // Is the next request the first for the API on the current stream?
+    bool first_request_{true};
+    // Paused via pause()?
+    bool paused_{};
+    // Was a DiscoveryRequest elided during a pause?
+    bool pending_{};
+    // Has this API been tracked in subscriptions_?
+    bool subscribed_{};
+  };
+
+  envoy::api::v2::Node node_;
+  std::unique_ptr<Grpc::AsyncClient<envoy::config::IncrementalDiscoveryRequest,
+                                    envoy::config::IncrementalDiscoveryResponse>>
+      async_client_;
+  Grpc::AsyncStream<envoy::config::IncrementalDiscoveryRequest>* stream_{};
+  const Protobuf::MethodDescriptor& service_method_;
+  std::unordered_map<std::string, ApiState> api_state_;
+  // Envoy's dependency ordering.
+  std::list<std::string> subscriptions_;
+  Event::TimerPtr retry_timer_;
+};
+
+} // namespace Config
+} // namespace Envoy
@@ -0,0 +1,48 @@
+#pragma once
+
+#include "envoy/config/subscription.h"
+#include "envoy/event/dispatcher.h"
+
+#include "common/config/grpc_mux_subscription_impl.h"
+#include "common/config/incremental_grpc_mux_impl.h"
+
+#include "api/base.pb.h"
+
+namespace Envoy {
+namespace Config {
+
+/**
+ * gRPC subscription to a management server that speaks incremental xDS, on a stream of its own.
+ */
+template <class ResourceType>
+class IncrementalGrpcSubscriptionImpl : public Config::Subscription<ResourceType> {
+public:
+  IncrementalGrpcSubscriptionImpl(const envoy::api::v2::Node& node, Upstream::ClusterManager& cm,
+                                  const std::string& remote_cluster_name,
+                                  Event::Dispatcher& dispatcher, SubscriptionStats stats)
+      : grpc_mux_(node, cm, remote_cluster_name, dispatcher,
+                  *Protobuf::DescriptorPool::generated_pool()->FindMethodByName(
+                      IncrementalGrpcMuxImpl::SERVICE_METHOD)),
+        grpc_mux_subscription_(grpc_mux_, stats) {}
+
+  // Config::Subscription
+  void start(const std::vector<std::string>& resources,
+             Config::SubscriptionCallbacks<ResourceType>& callbacks) override {
+    // Subscribe first, so we get failure callbacks if grpc_mux_.start() fails.
+    grpc_mux_subscription_.start(resources, callbacks);
+    grpc_mux_.start();
+  }
+
+  void updateResources(const std::vector<std::string>& resources) override {
+    grpc_mux_subscription_.updateResources(resources);
+  }
+
+  const std::string versionInfo() const override { return grpc_mux_subscription_.versionInfo(); }
+
+private:
+  IncrementalGrpcMuxImpl grpc_mux_;
+  GrpcMuxSubscriptionImpl<ResourceType> grpc_mux_subscription_;
+};
+
+} // namespace Config
+} // namespace Envoy
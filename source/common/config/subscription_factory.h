@@ -9,6 +9,7 @@
 #include "common/config/grpc_mux_subscription_impl.h"
 #include "common/config/grpc_subscription_impl.h"
 #include "common/config/http_subscription_impl.h"
+#include "common/config/incremental_grpc_subscription_impl.h"
 #include "common/config/utility.h"
 #include "common/filesystem/filesystem_impl.h"
 #include "common/protobuf/protobuf.h"
@@ -52,7 +53,8 @@ public:
     }
     case envoy::api::v2::ConfigSource::kApiConfigSource: {
       const envoy::api::v2::ApiConfigSource& api_config_source = config.api_config_source();
-      Utility::checkApiConfigSourceSubscriptionBackingCluster(cm.clusters(), api_config_source);
+      const Upstream::ClusterManager::ClusterInfoMap clusters = cm.clusters();
+      Utility::checkApiConfigSourceSubscriptionBackingCluster(clusters, api_config_source);
       const std::string& cluster_name = api_config_source.cluster_names()[0];
       switch (api_config_source.api_type()) {
       case envoy::api::v2::ApiConfigSource::REST_LEGACY:
@@ -65,6 +67,11 @@ public:
             *Protobuf::DescriptorPool::generated_pool()->FindMethodByName(rest_method), stats));
         break;
       case envoy::api::v2::ApiConfigSource::GRPC:
+        if (Utility::incrementalXds(clusters.at(cluster_name).get().info()->metadata())) {
+          result.reset(new IncrementalGrpcSubscriptionImpl<ResourceType>(node, cm, cluster_name,
+                                                                         dispatcher, stats));
+          break;
+        }
         result.reset(new GrpcSubscriptionImpl<ResourceType>(
             node, cm, cluster_name, dispatcher,
             *Protobuf::DescriptorPool::generated_pool()->FindMethodByName(grpc_method), stats));
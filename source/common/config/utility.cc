@@ -6,6 +6,7 @@
 #include "common/common/hex.h"
 #include "common/common/utility.h"
 #include "common/config/json_utility.h"
+#include "common/config/metadata.h"
 #include "common/config/resources.h"
 #include "common/config/well_known_names.h"
 #include "common/filesystem/filesystem_impl.h"
@@ -19,6 +20,75 @@
 namespace Envoy {
 namespace Config {
 
+namespace {
+
+/**
+ * Read a string field from a serialized message without parsing the rest of the message.
+ * @param serialized supplies the serialized message.
+ * @param field_number supplies the number of the field.
+ * @param value supplies the string the field is read into. If the field occurs more than once,
+ *        the last occurrence wins, as when parsing. It is left empty if the field is absent.
+ * @return bool whether the message could be read, i.e. it is well formed and has no groups.
+ */
+bool readStringField(const std::string& serialized, uint32_t field_number, std::string& value) {
+  Protobuf::io::CodedInputStream input(reinterpret_cast<const uint8_t*>(serialized.data()),
+                                       serialized.size());
+  while (true) {
+    const uint32_t tag = input.ReadTag();
+    if (tag == 0) {
+      // Either the end of the message or a malformed tag.
+      return input.CurrentPosition() == static_cast<int>(serialized.size());
+    }
+    uint32_t length;
+    uint64_t varint;
+    switch (tag & 7) {
+    case 0: // Varint.
+      if (!input.ReadVarint64(&varint)) {
+        return false;
+      }
+      break;
+    case 1: // Fixed 64 bits.
+      if (!input.Skip(8)) {
+        return false;
+      }
+      break;
+    case 2: // Length delimited.
+      if (!input.ReadVarint32(&length)) {
+        return false;
+      }
+      if ((tag >> 3) == field_number) {
+        if (!input.ReadString(&value, length)) {
+          return false;
+        }
+      } else if (!input.Skip(length)) {
+        return false;
+      }
+      break;
+    case 5: // Fixed 32 bits.
+      if (!input.Skip(4)) {
+        return false;
+      }
+      break;
+    default:
+      // Groups are not used by the v2 API.
+      return false;
+    }
+  }
+}
+
+template <class ResourceType>
+std::string resourceNameField(const ProtobufWkt::Any& resource, uint32_t field_number,
+                              const std::string& (ResourceType::*name)() const) {
+  std::string value;
+  if (readStringField(resource.value(), field_number, value)) {
+    return value;
+  }
+  // The full parse reports why the resource is malformed.
+  return (MessageUtil::anyConvert<ResourceType>(resource).*name)();
+}
+
+} // namespace
+
 void Utility::translateApiConfigSource(const std::string& cluster, uint32_t refresh_delay_ms,
                                        const std::string& api_type,
                                        envoy::api::v2::ApiConfigSource& api_config_source) {
@@ -97,6 +167,12 @@ void Utility::checkApiConfigSourceSubscriptionBackingCluster(
   }
 }
 
+bool Utility::incrementalXds(const envoy::api::v2::Metadata& metadata) {
+  return Metadata::metadataValue(metadata, MetadataFilters::get().ENVOY_LB,
+                                 MetadataEnvoyLbKeys::get().INCREMENTAL_XDS)
+      .bool_value();
+}
+
 std::chrono::milliseconds
 Utility::apiConfigSourceRefreshDelay(const envoy::api::v2::ApiConfigSource& api_config_source) {
   return std::chrono::milliseconds(
@@ -144,16 +220,21 @@ void Utility::translateLdsConfig(const Json::Object& json_lds,
 
 std::string Utility::resourceName(const ProtobufWkt::Any& resource) {
   if (resource.type_url() == Config::TypeUrl::get().Listener) {
-    return MessageUtil::anyConvert<envoy::api::v2::Listener>(resource).name();
+    return resourceNameField(resource, envoy::api::v2::Listener::kNameFieldNumber,
+                             &envoy::api::v2::Listener::name);
   }
   if (resource.type_url() == Config::TypeUrl::get().RouteConfiguration) {
-    return MessageUtil::anyConvert<envoy::api::v2::RouteConfiguration>(resource).name();
+    return resourceNameField(resource, envoy::api::v2::RouteConfiguration::kNameFieldNumber,
+                             &envoy::api::v2::RouteConfiguration::name);
   }
   if (resource.type_url() == Config::TypeUrl::get().Cluster) {
-    return MessageUtil::anyConvert<envoy::api::v2::Cluster>(resource).name();
+    return resourceNameField(resource, envoy::api::v2::Cluster::kNameFieldNumber,
+                             &envoy::api::v2::Cluster::name);
   }
   if (resource.type_url() == Config::TypeUrl::get().ClusterLoadAssignment) {
-    return MessageUtil::anyConvert<envoy::api::v2::ClusterLoadAssignment>(resource).cluster_name();
+    return resourceNameField(resource,
+                             envoy::api::v2::ClusterLoadAssignment::kClusterNameFieldNumber,
+                             &envoy::api::v2::ClusterLoadAssignment::cluster_name);
   }
   throw EnvoyException(
       fmt::format("Unknown type URL {} in DiscoveryResponse", resource.type_url()));
@@ -59,6 +59,24 @@ public:
     return typed_resources;
   }
 
+  /**
+   * Unpack google.protobuf.Any resources into typed resources. Each resource is parsed in place in
+   * typed_resources, so if typed_resources was constructed on a Protobuf::Arena, the whole update
+   * is allocated on the arena and released with it.
+   * @param resources supplies the resources.
+   * @param typed_resources supplies the vector the typed resources are appended to.
+   */
+  template <class ResourceType>
+  static void unpackResources(const Protobuf::RepeatedPtrField<ProtobufWkt::Any>& resources,
+                              Protobuf::RepeatedPtrField<ResourceType>& typed_resources) {
+    typed_resources.Reserve(typed_resources.size() + resources.size());
+    for (const auto& resource : resources) {
+      if (!resource.UnpackTo(typed_resources.Add())) {
+        throw EnvoyException("Unable to unpack " + resource.DebugString());
+      }
+    }
+  }
+
   /**
    * Legacy APIs uses JSON and do not have an explicit version.
    * @param input the input to hash.
@@ -132,6 +150,13 @@ public:
       const Upstream::ClusterManager::ClusterInfoMap& clusters,
       const envoy::api::v2::ApiConfigSource& api_config_source);
 
+  /**
+   * @param metadata supplies the metadata of the cluster of a management server.
+   * @return bool whether gRPC subscriptions to the management server use the incremental protocol
+   *         of incremental_discovery.proto, per the incremental_xds key of the envoy.lb metadata.
+   */
+  static bool incrementalXds(const envoy::api::v2::Metadata& metadata);
+
   /**
    * Convert a v1 SDS JSON config to v2 EDS envoy::api::v2::ConfigSource.
    * @param json_config source v1 SDS JSON config.
@@ -224,6 +249,8 @@ public:
    * a Routeconfiguration, based on the underlying resource type.
    * TODO(htuch): This is kind of a hack. If we had a better support for resource names as first
    * class in the API, this would not be necessary.
+   * Only the name field is decoded, so naming the resources of a large response does not parse
+   * each of them in full.
    * @param resource google.protobuf.Any v2 API resource.
    * @return std::string resource name.
    */
@@ -93,8 +93,12 @@ typedef ConstSingleton<AddressResolverNameValues> AddressResolverNames;
  */
 class HttpFilterNameValues {
 public:
+  // Adaptive concurrency filter
+  const std::string ADAPTIVE_CONCURRENCY = "envoy.adaptive_concurrency";
   // Buffer filter
   const std::string BUFFER = "envoy.buffer";
+  // Cache filter
+  const std::string CACHE = "envoy.cache";
   // CORS filter
   const std::string CORS = "envoy.cors";
   // Dynamo filter
@@ -107,6 +111,8 @@ public:
   const std::string GRPC_JSON_TRANSCODER = "envoy.grpc_json_transcoder";
   // GRPC web filter
   const std::string GRPC_WEB = "envoy.grpc_web";
+  // Gzip filter
+  const std::string GZIP = "envoy.gzip";
   // IP tagging filter
   const std::string IP_TAGGING = "envoy.ip_tagging";
   // Rate limit filter
@@ -122,8 +128,9 @@ public:
   const V1Converter v1_converter_;
 
   HttpFilterNameValues()
-      : v1_converter_({BUFFER, CORS, DYNAMO, FAULT, GRPC_HTTP1_BRIDGE, GRPC_JSON_TRANSCODER,
-                       GRPC_WEB, HEALTH_CHECK, IP_TAGGING, RATE_LIMIT, ROUTER, LUA}) {}
+      : v1_converter_({ADAPTIVE_CONCURRENCY, BUFFER, CACHE, CORS, DYNAMO, FAULT,
+                       GRPC_HTTP1_BRIDGE, GRPC_JSON_TRANSCODER, GRPC_WEB, GZIP, HEALTH_CHECK,
+                       IP_TAGGING, RATE_LIMIT, ROUTER, LUA}) {}
 };
 
 typedef ConstSingleton<HttpFilterNameValues> HttpFilterNames;
@@ -150,6 +157,8 @@ public:
   const std::string STATSD = "envoy.statsd";
   // DogStatsD compatible stastsd sink
   const std::string DOG_STATSD = "envoy.dog_statsd";
+  // gRPC metrics service sink
+  const std::string METRICS_SERVICE = "envoy.metrics_service";
 };
 
 typedef ConstSingleton<StatsSinkNameValues> StatsSinkNames;
@@ -163,6 +172,8 @@ public:
   const std::string FILE = "envoy.file_access_log";
   // HTTP gRPC access log
   const std::string HTTP_GRPC = "envoy.http_grpc_access_log";
+  // Structured (JSON lines or binary protobuf) file access log
+  const std::string STRUCTURED_FILE = "envoy.structured_file_access_log";
 };
 
 typedef ConstSingleton<AccessLogNameValues> AccessLogNames;
@@ -174,6 +185,8 @@ class MetadataFilterValues {
 public:
   // Filter namespace for built-in load balancer.
   const std::string ENVOY_LB = "envoy.lb";
+  // Filter namespace for built-in listener options.
+  const std::string ENVOY_LISTENER = "envoy.listener";
 };
 
 typedef ConstSingleton<MetadataFilterValues> MetadataFilters;
@@ -185,10 +198,86 @@ class MetadataEnvoyLbKeyValues {
 public:
   // Key in envoy.lb filter namespace for endpoint canary bool value.
   const std::string CANARY = "canary";
+  // Key in envoy.lb filter namespace for the cluster bool value that selects the Maglev load
+  // balancer for a ring hash cluster.
+  const std::string MAGLEV = "maglev";
+  // Key in envoy.lb filter namespace for the cluster bool value that selects the peak EWMA load
+  // balancer for a least request cluster.
+  const std::string PEAK_EWMA = "peak_ewma";
+  // Key in envoy.lb filter namespace for the cluster number value of the connections the
+  // connection pools of the cluster prefetch per request, see ClusterInfo::prefetchRatio().
+  const std::string PREFETCH_RATIO = "prefetch_ratio";
+  // Key in envoy.lb filter namespace for the cluster number value of the HTTP/2 connections per
+  // host, see ClusterInfo::http2ConnectionsPerHost().
+  const std::string HTTP2_CONNECTIONS_PER_HOST = "http2_connections_per_host";
+  // Key in envoy.lb filter namespace for the cluster number value of the subsets the hosts are
+  // split into for the workers, see ClusterInfo::workerSubsets().
+  const std::string WORKER_SUBSETS = "worker_subsets";
+  // Key in envoy.lb filter namespace for the cluster number value of the partitions the hosts are
+  // split into for active health checking, see ClusterInfo::healthCheckPartitions().
+  const std::string HEALTH_CHECK_PARTITIONS = "health_check_partitions";
+  // Key in envoy.lb filter namespace for the cluster number value of the idle timeout of the
+  // connections in milliseconds, see ClusterInfo::idleTimeout().
+  const std::string IDLE_TIMEOUT_MS = "idle_timeout_ms";
+  // Key in envoy.lb filter namespace for the cluster number value of the window in milliseconds
+  // over which host updates are merged, see ClusterInfo::updateMergeWindow().
+  const std::string UPDATE_MERGE_WINDOW_MS = "update_merge_window_ms";
+  // Key in envoy.lb filter namespace for the cluster number value of the maximum number of hosts of
+  // an original destination cluster, see OriginalDstCluster::maxHosts().
+  const std::string ORIGINAL_DST_MAX_HOSTS = "original_dst_max_hosts";
+  // Key in envoy.lb filter namespace for the cluster bool value that enables TCP Fast Open on the
+  // connections to its hosts, see ClusterInfo::tcpFastOpen().
+  const std::string TCP_FAST_OPEN = "tcp_fast_open";
+  // Key in envoy.lb filter namespace for the cluster number value of the established idle TCP
+  // connections each worker keeps to each host, see ClusterInfo::tcpPreconnectPerHost().
+  const std::string TCP_PRECONNECT_PER_HOST = "tcp_preconnect_per_host";
+  // Key in envoy.lb filter namespace for the cluster number value of the age in milliseconds after
+  // which idle preconnected TCP connections are replaced, see ClusterInfo::tcpPreconnectMaxAge().
+  const std::string TCP_PRECONNECT_MAX_AGE_MS = "tcp_preconnect_max_age_ms";
+  // Key in envoy.lb filter namespace for the cluster bool value that marks its hosts as the nodes
+  // of a Redis Cluster, which Redis proxies then route to by slot.
+  const std::string REDIS_CLUSTER = "redis_cluster";
+  // Key in envoy.lb filter namespace for the cluster string value that selects where Redis proxies
+  // send read only commands for a Redis Cluster: "master" (the default), "prefer_replica" or
+  // "any".
+  const std::string REDIS_READ_POLICY = "redis_read_policy";
+  // Key in envoy.lb filter namespace for the bool value of the cluster of a management server that
+  // makes gRPC subscriptions to it use incremental xDS, see Config::Utility::incrementalXds().
+  const std::string INCREMENTAL_XDS = "incremental_xds";
 };
 
 typedef ConstSingleton<MetadataEnvoyLbKeyValues> MetadataEnvoyLbKeys;
 
+/**
+ * Keys for MetadataFilterConstants::ENVOY_LISTENER metadata.
+ */
+class MetadataEnvoyListenerKeyValues {
+public:
+  // Key in envoy.listener filter namespace for the listener bool value that gives each worker a
+  // SO_REUSEPORT socket of its own, see ListenerImpl::reusePort().
+  const std::string REUSE_PORT = "reuse_port";
+  // Key in envoy.listener filter namespace for the listener bool value that hands each accepted
+  // connection over to the worker with the fewest connections, see
+  // Server::Listener::connectionBalancer().
+  const std::string BALANCE_CONNECTIONS = "balance_connections";
+  // Key in envoy.listener filter namespace for the listener number value that caps the connections
+  // a worker accepts each time the listen socket is ready, see
+  // Network::ListenerOptions::accept_batch_size_.
+  const std::string ACCEPT_BATCH_SIZE = "accept_batch_size";
+  // Key in envoy.listener filter namespace for the listener number value of the TCP Fast Open queue
+  // length of its sockets, which enables TFO if it is not 0.
+  const std::string TCP_FAST_OPEN_QUEUE_LENGTH = "tcp_fast_open_queue_length";
+  // Key in envoy.listener filter namespace for the listener number value of the seconds that the
+  // kernel holds its new connections back until their first data arrives, if it is not 0.
+  const std::string TCP_DEFER_ACCEPT_SECONDS = "tcp_defer_accept_seconds";
+  // Key in envoy.listener filter namespace for the listener string value of the group of listeners
+  // whose identical filter chains share their filter factories and TLS contexts, see
+  // Server::SharedFilterChain.
+  const std::string FILTER_CHAIN_GROUP = "filter_chain_group";
+};
+
+typedef ConstSingleton<MetadataEnvoyListenerKeyValues> MetadataEnvoyListenerKeys;
+
 /**
  * Well known tags values and a mapping from these names to the regexes they
  * represent. Note: when names are added to the list, they also must be added to
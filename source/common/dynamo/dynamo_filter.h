@@ -2,13 +2,13 @@
 
 #include <cstdint>
 #include <string>
+#include <vector>
 
 #include "envoy/http/filter.h"
 #include "envoy/runtime/runtime.h"
 #include "envoy/stats/stats.h"
 
 #include "common/dynamo/dynamo_request_parser.h"
-#include "common/json/json_loader.h"
 
 namespace Envoy {
 namespace Dynamo {
@@ -48,13 +48,15 @@ public:
 private:
   void onDecodeComplete(const Buffer::Instance& data);
   void onEncodeComplete(const Buffer::Instance& data);
-  std::string buildBody(const Buffer::Instance* buffered, const Buffer::Instance& last);
+  // @return the slices of the buffered body followed by those of the last data, without copying.
+  std::vector<Buffer::RawSlice> bodySlices(const Buffer::Instance* buffered,
+                                           const Buffer::Instance& last);
   void chargeBasicStats(uint64_t status);
   void chargeStatsPerEntity(const std::string& entity, const std::string& entity_type,
                             uint64_t status);
-  void chargeFailureSpecificStats(const Json::Object& json_body);
-  void chargeUnProcessedKeysStats(const Json::Object& json_body);
-  void chargeTablePartitionIdStats(const Json::Object& json_body);
+  void chargeFailureSpecificStats(const RequestParser::ResponseDescriptor& response);
+  void chargeUnProcessedKeysStats(const RequestParser::ResponseDescriptor& response);
+  void chargeTablePartitionIdStats(const RequestParser::ResponseDescriptor& response);
 
   Runtime::Loader& runtime_;
   std::string stat_prefix_;
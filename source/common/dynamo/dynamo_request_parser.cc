@@ -1,12 +1,21 @@
 #include "common/dynamo/dynamo_request_parser.h"
 
+#include <array>
 #include <cmath>
 #include <cstdint>
+#include <initializer_list>
 #include <string>
 #include <vector>
 
+#include "envoy/json/json_object.h"
+
+#include "common/common/assert.h"
 #include "common/common/utility.h"
 
+#include "fmt/format.h"
+#include "rapidjson/error/en.h"
+#include "rapidjson/reader.h"
+
 namespace Envoy {
 namespace Dynamo {
 
@@ -65,51 +74,240 @@ std::string RequestParser::parseOperation(const Http::HeaderMap& headerMap) {
   return operation;
 }
 
-RequestParser::TableDescriptor RequestParser::parseTable(const std::string& operation,
-                                                         const Json::Object& json_data) {
+namespace {
+
+/**
+ * rapidjson input stream over the slices of a body, so that the body does not have to be copied
+ * into one string to be parsed.
+ */
+class SliceStream {
+public:
+  typedef char Ch;
+
+  SliceStream(const std::vector<Buffer::RawSlice>& slices) : slices_(slices) { skipEmpty(); }
+
+  Ch Peek() const {
+    return next_slice_ < slices_.size() ? static_cast<const Ch*>(slices_[next_slice_].mem_)[offset_]
+                                        : '\0';
+  }
+  Ch Take() {
+    if (next_slice_ == slices_.size()) {
+      return '\0';
+    }
+    const Ch c = static_cast<const Ch*>(slices_[next_slice_].mem_)[offset_++];
+    position_++;
+    if (offset_ == slices_[next_slice_].len_) {
+      next_slice_++;
+      offset_ = 0;
+      skipEmpty();
+    }
+    return c;
+  }
+  size_t Tell() const { return position_; }
+
+  // Only used for in situ parsing, which the slices are not for.
+  Ch* PutBegin() { NOT_IMPLEMENTED; }
+  void Put(Ch) { NOT_IMPLEMENTED; }
+  void Flush() { NOT_IMPLEMENTED; }
+  size_t PutEnd(Ch*) { NOT_IMPLEMENTED; }
+
+private:
+  void skipEmpty() {
+    while (next_slice_ < slices_.size() && slices_[next_slice_].len_ == 0) {
+      next_slice_++;
+    }
+  }
+
+  const std::vector<Buffer::RawSlice>& slices_;
+  size_t next_slice_{};
+  size_t offset_{};
+  size_t position_{};
+};
+
+/**
+ * Base of the SAX handlers below. It keeps the keys that lead to the current value for the first
+ * few levels of the document, which is as deep as the fields the filter looks for.
+ */
+template <class Derived>
+class PathHandler : public rapidjson::BaseReaderHandler<rapidjson::UTF8<>, Derived> {
+public:
+  bool StartObject() { return start(); }
+  bool EndObject(rapidjson::SizeType) { return end(); }
+  bool StartArray() { return start(); }
+  bool EndArray(rapidjson::SizeType) { return end(); }
+  bool Key(const char* value, rapidjson::SizeType size, bool) {
+    if (depth_ > MaxDepth) {
+      return true;
+    }
+    keys_[depth_ - 1].assign(value, size);
+    return static_cast<Derived*>(this)->onKey();
+  }
+
+protected:
+  static const size_t MaxDepth = 3;
+
+  // Whether the current value is the one the given keys lead to from the root object.
+  bool at(std::initializer_list<const char*> path) const {
+    return depth_ == path.size() && startsWith(path);
+  }
+  // Whether the current value or key is a member of the object the given keys lead to.
+  bool inObject(std::initializer_list<const char*> path) const {
+    return depth_ == path.size() + 1 && startsWith(path);
+  }
+  const std::string& key() const { return keys_[depth_ - 1]; }
+
+private:
+  bool startsWith(std::initializer_list<const char*> path) const {
+    size_t i = 0;
+    for (const char* key : path) {
+      if (keys_[i++] != key) {
+        return false;
+      }
+    }
+    return true;
+  }
+  bool start() {
+    if (++depth_ <= MaxDepth) {
+      // Array elements have no key, and this never matches a key that is looked for.
+      keys_[depth_ - 1].clear();
+    }
+    return true;
+  }
+  bool end() {
+    depth_--;
+    return true;
+  }
+
+  size_t depth_{};
+  std::array<std::string, MaxDepth> keys_;
+};
+
+template <class Handler> void parse(const std::vector<Buffer::RawSlice>& body, Handler& handler) {
+  SliceStream stream(body);
+  rapidjson::Reader reader;
+  reader.Parse(stream, handler);
+  // The handlers stop the parse by returning false once they have what they need.
+  if (reader.HasParseError() && reader.GetParseErrorCode() != rapidjson::kParseErrorTermination) {
+    throw Json::Exception(fmt::format("JSON supplied is not valid. Error(offset {}): {}",
+                                      reader.GetErrorOffset(),
+                                      GetParseError_En(reader.GetParseErrorCode())));
+  }
+}
+
+class SingleTableHandler : public PathHandler<SingleTableHandler> {
+public:
+  SingleTableHandler(RequestParser::TableDescriptor& table) : table_(table) {}
+
+  bool onKey() { return true; }
+  bool String(const char* value, rapidjson::SizeType size, bool) {
+    if (at({"TableName"})) {
+      table_.table_name.assign(value, size);
+      return false;
+    }
+    return true;
+  }
+
+private:
+  RequestParser::TableDescriptor& table_;
+};
+
+class BatchTableHandler : public PathHandler<BatchTableHandler> {
+public:
+  BatchTableHandler(RequestParser::TableDescriptor& table) : table_(table) {}
+
+  bool onKey() {
+    if (!inObject({"RequestItems"})) {
+      return true;
+    }
+    if (table_.table_name.empty()) {
+      table_.table_name = key();
+    } else if (table_.table_name != key()) {
+      table_.table_name = "";
+      table_.is_single_table = false;
+      return false;
+    }
+    return true;
+  }
+
+private:
+  RequestParser::TableDescriptor& table_;
+};
+
+class ResponseHandler : public PathHandler<ResponseHandler> {
+public:
+  ResponseHandler(std::string& type, RequestParser::ResponseDescriptor& response)
+      : type_(type), response_(response) {}
+
+  bool onKey() {
+    if (inObject({"UnprocessedKeys"})) {
+      response_.unprocessed_tables.push_back(key());
+    }
+    return true;
+  }
+  bool String(const char* value, rapidjson::SizeType size, bool) {
+    if (at({"__type"})) {
+      type_.assign(value, size);
+    }
+    return true;
+  }
+  bool Double(double value) {
+    // For a given partition id, the amount of capacity used is returned in the body as a double.
+    // A stat will be created to track the capacity consumed for the operation, table and
+    // partition. Stats counter only increments by whole numbers, capacity is round up to the
+    // nearest integer to account for this.
+    if (inObject({"ConsumedCapacity", "Partitions"})) {
+      response_.partitions.emplace_back(key(), static_cast<uint64_t>(std::ceil(value)));
+    }
+    return true;
+  }
+  bool Int(int value) { return Double(value); }
+  bool Uint(unsigned value) { return Double(value); }
+  bool Int64(int64_t value) { return Double(value); }
+  bool Uint64(uint64_t value) { return Double(value); }
+
+private:
+  std::string& type_;
+  RequestParser::ResponseDescriptor& response_;
+};
+
+} // namespace
+
+RequestParser::TableDescriptor
+RequestParser::parseTable(const std::string& operation,
+                          const std::vector<Buffer::RawSlice>& body) {
   TableDescriptor table{"", true};
 
   // Simple operations on a single table, have "TableName" explicitly specified.
   if (find(SINGLE_TABLE_OPERATIONS.begin(), SINGLE_TABLE_OPERATIONS.end(), operation) !=
       SINGLE_TABLE_OPERATIONS.end()) {
-    table.table_name = json_data.getString("TableName", "");
+    SingleTableHandler handler(table);
+    parse(body, handler);
   } else if (find(BATCH_OPERATIONS.begin(), BATCH_OPERATIONS.end(), operation) !=
              BATCH_OPERATIONS.end()) {
-    Json::ObjectSharedPtr tables = json_data.getObject("RequestItems", true);
-    tables->iterate([&table](const std::string& key, const Json::Object&) {
-      if (table.table_name.empty()) {
-        table.table_name = key;
-      } else {
-        if (table.table_name != key) {
-          table.table_name = "";
-          table.is_single_table = false;
-          return false;
-        }
-      }
-      return true;
-    });
+    BatchTableHandler handler(table);
+    parse(body, handler);
   }
 
   return table;
 }
-std::vector<std::string> RequestParser::parseBatchUnProcessedKeys(const Json::Object& json_data) {
-  std::vector<std::string> unprocessed_tables;
-  Json::ObjectSharedPtr tables = json_data.getObject("UnprocessedKeys", true);
-  tables->iterate([&unprocessed_tables](const std::string& key, const Json::Object&) {
-    unprocessed_tables.emplace_back(key);
-    return true;
-  });
 
-  return unprocessed_tables;
+RequestParser::ResponseDescriptor
+RequestParser::parseResponse(const std::vector<Buffer::RawSlice>& body) {
+  ResponseDescriptor response;
+  std::string type;
+  ResponseHandler handler(type, response);
+  parse(body, handler);
+  response.error_type = parseErrorType(type);
+  return response;
 }
-std::string RequestParser::parseErrorType(const Json::Object& json_data) {
-  std::string error_type = json_data.getString("__type", "");
-  if (error_type.empty()) {
+
+std::string RequestParser::parseErrorType(const std::string& type) {
+  if (type.empty()) {
     return "";
   }
 
   for (const std::string& supported_error_type : SUPPORTED_ERROR_TYPES) {
-    if (StringUtil::endsWith(error_type, supported_error_type)) {
+    if (StringUtil::endsWith(type, supported_error_type)) {
       return supported_error_type;
     }
   }
@@ -122,25 +320,5 @@ bool RequestParser::isBatchOperation(const std::string& operation) {
          BATCH_OPERATIONS.end();
 }
 
-std::vector<RequestParser::PartitionDescriptor>
-RequestParser::parsePartitions(const Json::Object& json_data) {
-  std::vector<RequestParser::PartitionDescriptor> partition_descriptors;
-
-  Json::ObjectSharedPtr partitions =
-      json_data.getObject("ConsumedCapacity", true)->getObject("Partitions", true);
-  partitions->iterate([&partition_descriptors, &partitions](const std::string& key,
-                                                            const Json::Object&) {
-    // For a given partition id, the amount of capacity used is returned in the body as a double.
-    // A stat will be created to track the capacity consumed for the operation, table and partition.
-    // Stats counter only increments by whole numbers, capacity is round up to the nearest integer
-    // to account for this.
-    uint64_t capacity_integer = static_cast<uint64_t>(std::ceil(partitions->getDouble(key, 0.0)));
-    partition_descriptors.emplace_back(key, capacity_integer);
-    return true;
-  });
-
-  return partition_descriptors;
-}
-
 } // namespace Dynamo
 } // namespace Envoy
@@ -4,10 +4,9 @@
 #include <string>
 #include <vector>
 
+#include "envoy/buffer/buffer.h"
 #include "envoy/http/header_map.h"
 
-#include "common/json/json_loader.h"
-
 namespace Envoy {
 namespace Dynamo {
 
@@ -39,56 +38,62 @@ public:
   static std::string parseOperation(const Http::HeaderMap& headerMap);
 
   /**
-   * Parse table name out of data, based on the operation.
+   * Results of parsing a response body. @see parseResponse().
+   */
+  struct ResponseDescriptor {
+    // The error details, see parseResponse().
+    std::string error_type;
+    // The tables with unprocessed keys in a batch operation result.
+    std::vector<std::string> unprocessed_tables;
+    // The partition ids and the capacity each one consumed.
+    std::vector<PartitionDescriptor> partitions;
+  };
+
+  /**
+   * Parse table name out of a request body, based on the operation. The body is parsed as it is
+   * read, without building a document, and parsing stops as soon as the table is known. The rest
+   * of the body is then not validated.
+   * @param body supplies the slices of the body, in order.
    * @return empty string as TableDescriptor.table_name if table name cannot be parsed out of valid
-   *json data
-   * or if operation is not in the list of operations that we support.
+   * json data or if operation is not in the list of operations that we support.
    *
    * For simple operations on single table, e.g., GetItem, PutItem, Query etc @return table
    * name in TableDescriptor.table_name.
    *
    * For batch operations, e.g. BatchGetItem/BatchWriteItem, @return table name in
-   *TableDescriptor.table_name if it's only one
-   * table used in all operations, @return empty string in TableDescriptor.table_name and
-   *TableDescriptor.is_single_table=false in case of multiple.
+   * TableDescriptor.table_name if it's only one table used in all operations, @return empty string
+   * in TableDescriptor.table_name and TableDescriptor.is_single_table=false in case of multiple.
    *
    * @throw Json::Exception if data is not in valid Json format.
    */
-  static TableDescriptor parseTable(const std::string& operation, const Json::Object& json_data);
+  static TableDescriptor parseTable(const std::string& operation,
+                                    const std::vector<Buffer::RawSlice>& body);
 
   /**
-   * Parse error details which might be provided for a given response code.
-   * @return empty string if cannot get error details.
-   * For the full list of errors, see
+   * Parse a response body in a single pass, without building a document.
+   * @param body supplies the slices of the body, in order.
+   * @return ResponseDescriptor with:
+   *
+   * The error details which might be provided for a given response code, or an empty string if
+   * there are none. For the full list of errors, see
    * http://docs.aws.amazon.com/amazondynamodb/latest/APIReference/CommonErrors.html
    * Operation specific errors, for example, error section of
    * http://docs.aws.amazon.com/amazondynamodb/latest/APIReference/API_UpdateItem.html
    *
+   * The table names that did not get processed in a batch operation, if any.
+   *
+   * The partition ids and the capacity consumed in each, if the body has partition data. The
+   * capacity is rounded up to an integer.
+   *
    * @throw Json::Exception if data is not in valid Json format.
    */
-  static std::string parseErrorType(const Json::Object& json_data);
-
-  /**
-   * Parse unprocessed keys for batch operation results.
-   * @return empty set if there are no unprocessed keys or a set of table names that did not get
-   * processed in the batch operation.
-   */
-  static std::vector<std::string> parseBatchUnProcessedKeys(const Json::Object& json_data);
+  static ResponseDescriptor parseResponse(const std::vector<Buffer::RawSlice>& body);
 
   /**
    * @return true if the operation is in the set of supported BATCH_OPERATIONS
    */
   static bool isBatchOperation(const std::string& operation);
 
-  /**
-   * Parse the Partition ids and the consumed capacity from the body.
-   * @return empty set if there is no partition data or a set of partition data containing
-   * the partition id as a string and the capacity consumed as an integer.
-   *
-   * @throw Json::Exception if data is not in valid Json format.
-   */
-  static std::vector<PartitionDescriptor> parsePartitions(const Json::Object& json_data);
-
 private:
   static const Http::LowerCaseString X_AMZ_TARGET;
   static const std::vector<std::string> SINGLE_TABLE_OPERATIONS;
@@ -97,6 +102,8 @@ private:
   // http://docs.aws.amazon.com/amazondynamodb/latest/developerguide/Programming.Errors.html
   static const std::vector<std::string> SUPPORTED_ERROR_TYPES;
 
+  static std::string parseErrorType(const std::string& type);
+
   RequestParser() {}
 };
 
@@ -19,8 +19,10 @@ void DispatchedThreadImpl::start(Server::GuardDog& guard_dog) {
 
 void DispatchedThreadImpl::exit() {
   if (thread_) {
-    dispatcher_->exit();
+    // Posted, so that callbacks that were posted before still run.
+    dispatcher_->post([this]() -> void { dispatcher_->exit(); });
     thread_->join();
+    thread_.reset();
   }
 }
 
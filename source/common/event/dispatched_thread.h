@@ -50,7 +50,8 @@ public:
   Dispatcher& dispatcher() { return *dispatcher_; }
 
   /**
-   * Exit the dispatched thread. Will block until the thread joins.
+   * Exit the dispatched thread once it ran the callbacks that were posted before. Will block until
+   * the thread joins.
    */
   void exit();
 
@@ -3,7 +3,7 @@
 #include <chrono>
 #include <cstdint>
 #include <functional>
-#include <mutex>
+#include <iterator>
 #include <string>
 #include <vector>
 
@@ -11,9 +11,12 @@
 #include "envoy/network/listener.h"
 
 #include "common/buffer/buffer_impl.h"
+#include "common/common/thread_load.h"
 #include "common/event/file_event_impl.h"
+#include "common/event/io_uring_impl.h"
 #include "common/event/signal_impl.h"
 #include "common/event/timer_impl.h"
+#include "common/event/timer_wheel_impl.h"
 #include "common/filesystem/watcher_impl.h"
 #include "common/network/connection_impl.h"
 #include "common/network/dns_impl.h"
@@ -25,6 +28,8 @@
 namespace Envoy {
 namespace Event {
 
+const std::chrono::milliseconds DispatcherImpl::COARSE_TIMER_TICK{100};
+
 DispatcherImpl::DispatcherImpl()
     : DispatcherImpl(Buffer::WatermarkFactoryPtr{new Buffer::WatermarkBufferFactory}) {
   // The dispatcher won't work as expected if libevent hasn't been configured to use threads.
@@ -33,15 +38,23 @@ DispatcherImpl::DispatcherImpl()
 
 DispatcherImpl::DispatcherImpl(Buffer::WatermarkFactoryPtr&& factory)
     : buffer_factory_(std::move(factory)), base_(event_base_new()),
-      deferred_delete_timer_(createTimer([this]() -> void { clearDeferredDeleteList(); })),
-      post_timer_(createTimer([this]() -> void { runPostCallbacks(); })),
+      timer_wheel_(new TimerWheel(*this, COARSE_TIMER_TICK, COARSE_TIMER_SLOTS)),
+      deferred_delete_timer_(createTimer([this]() -> void { clearDeferredDeleteList(true); })),
+      post_timer_(createTimer([this]() -> void { runPostCallbacks(true); })),
       current_to_delete_(&to_delete_1_) {
   RELEASE_ASSERT(Libevent::Global::initialized());
 }
 
-DispatcherImpl::~DispatcherImpl() {}
+DispatcherImpl::~DispatcherImpl() {
+  // Callbacks posted after the last iteration of the event loop are never run.
+  while (PostedCallback* callback = post_callbacks_.pop()) {
+    delete callback;
+  }
+}
+
+void DispatcherImpl::clearDeferredDeleteList() { clearDeferredDeleteList(false); }
 
-void DispatcherImpl::clearDeferredDeleteList() {
+void DispatcherImpl::clearDeferredDeleteList(bool budgeted) {
   ASSERT(isThreadSafe());
   std::vector<DeferredDeletablePtr>* to_delete = current_to_delete_;
 
@@ -65,8 +78,19 @@ void DispatcherImpl::clearDeferredDeleteList() {
   // Calling clear() on the vector does not specify which order destructors run in. We want to
   // destroy in FIFO order so just do it manually. This required 2 passes over the vector which is
   // not optimal but can be cleaned up later if needed.
-  for (size_t i = 0; i < num_to_delete; i++) {
-    (*to_delete)[i].reset();
+  const MonotonicTime start = std::chrono::steady_clock::now();
+  size_t num_deleted = 0;
+  while (num_deleted < num_to_delete && !(budgeted && num_deleted > 0 && overBudget(start))) {
+    (*to_delete)[num_deleted++].reset();
+  }
+
+  if (num_deleted < num_to_delete) {
+    // The rest were deferred before any deletions that were deferred while deleting, so they are
+    // deleted first, after the event loop polled again.
+    current_to_delete_->insert(current_to_delete_->begin(),
+                               std::make_move_iterator(to_delete->begin() + num_deleted),
+                               std::make_move_iterator(to_delete->end()));
+    deferred_delete_timer_->enableTimer(std::chrono::milliseconds(1));
   }
 
   to_delete->clear();
@@ -91,6 +115,9 @@ Network::DnsResolverSharedPtr DispatcherImpl::createDnsResolver(
 FileEventPtr DispatcherImpl::createFileEvent(int fd, FileReadyCb cb, FileTriggerType trigger,
                                              uint32_t events) {
   ASSERT(isThreadSafe());
+  if (io_uring_ != nullptr) {
+    return io_uring_->createFileEvent(fd, cb, trigger, events);
+  }
   return FileEventPtr{new FileEventImpl(*this, fd, cb, trigger, events)};
 }
 
@@ -124,6 +151,11 @@ TimerPtr DispatcherImpl::createTimer(TimerCb cb) {
   return TimerPtr{new TimerImpl(*this, cb)};
 }
 
+TimerPtr DispatcherImpl::createCoarseTimer(TimerCb cb) {
+  ASSERT(isThreadSafe());
+  return timer_wheel_->createTimer(cb);
+}
+
 void DispatcherImpl::deferredDelete(DeferredDeletablePtr&& to_delete) {
   ASSERT(isThreadSafe());
   current_to_delete_->emplace_back(std::move(to_delete));
@@ -141,14 +173,11 @@ SignalEventPtr DispatcherImpl::listenForSignal(int signal_num, SignalCb cb) {
 }
 
 void DispatcherImpl::post(std::function<void()> callback) {
-  bool do_post;
-  {
-    std::unique_lock<std::mutex> lock(post_lock_);
-    do_post = post_callbacks_.empty();
-    post_callbacks_.push_back(callback);
-  }
+  pending_posts_++;
+  post_callbacks_.push(new PostedCallback(callback, std::chrono::steady_clock::now()));
 
-  if (do_post) {
+  // Only the first post since the callbacks last ran wakes the event loop.
+  if (!post_wakeup_pending_.exchange(true)) {
     post_timer_->enableTimer(std::chrono::milliseconds(0));
   }
 }
@@ -160,20 +189,89 @@ void DispatcherImpl::run(RunType type) {
   // callbacks that have to get run before the initial event loop starts running. libevent does
   // not gaurantee that events are run in any particular order. So even if we post() and call
   // event_base_once() before some other event, the other event might get called first.
-  runPostCallbacks();
+  runPostCallbacks(false);
 
-  event_base_loop(base_.get(), type == RunType::NonBlock ? EVLOOP_NONBLOCK : 0);
+  if (stats_ == nullptr || type == RunType::NonBlock) {
+    event_base_loop(base_.get(), type == RunType::NonBlock ? EVLOOP_NONBLOCK : 0);
+    return;
+  }
+
+  // Run the loop one iteration at a time, so that the time an iteration polls for can be told
+  // apart from the time it runs callbacks for, which starts with the first event callback.
+  while (true) {
+    const MonotonicTime poll_start = std::chrono::steady_clock::now();
+    polling_ = true;
+    const int rc = event_base_loop(base_.get(), EVLOOP_ONCE);
+    if (!polling_) {
+      stats_->poll_delay_us_.recordValue(
+          std::chrono::duration_cast<std::chrono::microseconds>(callbacks_start_ - poll_start)
+              .count());
+      const std::chrono::microseconds busy = std::chrono::duration_cast<std::chrono::microseconds>(
+          std::chrono::steady_clock::now() - callbacks_start_);
+      stats_->loop_duration_us_.recordValue(busy.count());
+      ThreadLoad::addBusyTime(busy);
+    }
+    polling_ = false;
+
+    // Like a blocking loop, stop once there are no events left or exit() was called.
+    if (rc != 0 || event_base_got_exit(base_.get()) || event_base_got_break(base_.get())) {
+      break;
+    }
+  }
 }
 
-void DispatcherImpl::runPostCallbacks() {
-  std::unique_lock<std::mutex> lock(post_lock_);
-  while (!post_callbacks_.empty()) {
-    std::function<void()> callback = post_callbacks_.front();
-    post_callbacks_.pop_front();
+void DispatcherImpl::initializeStats(Stats::Scope& scope, const std::string& prefix) {
+  ASSERT(run_tid_ == 0);
+  const std::string stats_prefix = prefix + "dispatcher.";
+  stats_.reset(new DispatcherStats{ALL_DISPATCHER_STATS(
+      POOL_COUNTER_PREFIX(scope, stats_prefix), POOL_HISTOGRAM_PREFIX(scope, stats_prefix))});
+}
 
-    lock.unlock();
-    callback();
-    lock.lock();
+bool DispatcherImpl::enableIoUring() {
+  ASSERT(run_tid_ == 0);
+  if (!IoUringPoller::isSupported()) {
+    return false;
+  }
+  io_uring_.reset(new IoUringPoller(*this, IoUringPoller::DEFAULT_ENTRIES));
+  return true;
+}
+
+void DispatcherImpl::runPostCallbacks(bool budgeted) {
+  // Cleared before the queue is drained, so that callbacks posted from now on wake the event loop
+  // again even if they are run below.
+  post_wakeup_pending_.store(false);
+
+  const MonotonicTime start = std::chrono::steady_clock::now();
+  bool ran = false;
+  while (true) {
+    if (budgeted && ran && overBudget(start) && !post_callbacks_.empty()) {
+      // The rest run once the event loop polled again.
+      post_wakeup_pending_.store(true);
+      post_timer_->enableTimer(std::chrono::milliseconds(1));
+      return;
+    }
+    std::unique_ptr<PostedCallback> callback(post_callbacks_.pop());
+    if (callback == nullptr) {
+      break;
+    }
+    pending_posts_--;
+
+    if (stats_ != nullptr) {
+      if (!ran) {
+        stats_->post_wakeups_.inc();
+      }
+      stats_->post_delay_us_.recordValue(std::chrono::duration_cast<std::chrono::microseconds>(
+                                             std::chrono::steady_clock::now() - callback->posted_)
+                                             .count());
+    }
+    callback->cb_();
+    ran = true;
+  }
+
+  if (!post_callbacks_.empty()) {
+    // A producer is still linking in a callback, whose post may have found the wakeup pending.
+    post_wakeup_pending_.store(true);
+    post_timer_->enableTimer(std::chrono::milliseconds(0));
   }
 }
 
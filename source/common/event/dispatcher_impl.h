@@ -1,22 +1,45 @@
 #pragma once
 
+#include <atomic>
+#include <chrono>
 #include <cstdint>
 #include <functional>
-#include <list>
-#include <mutex>
+#include <memory>
 #include <vector>
 
+#include "envoy/common/time.h"
 #include "envoy/event/deferred_deletable.h"
 #include "envoy/event/dispatcher.h"
 #include "envoy/network/connection_handler.h"
+#include "envoy/stats/stats.h"
+#include "envoy/stats/stats_macros.h"
 
 #include "common/common/logger.h"
+#include "common/common/mpsc_queue.h"
 #include "common/common/thread.h"
 #include "common/event/libevent.h"
 
 namespace Envoy {
 namespace Event {
 
+class IoUringPoller;
+class TimerWheel;
+
+// clang-format off
+#define ALL_DISPATCHER_STATS(COUNTER, HISTOGRAM)                                                   \
+  COUNTER(post_wakeups)                                                                            \
+  HISTOGRAM(loop_duration_us)                                                                      \
+  HISTOGRAM(poll_delay_us)                                                                         \
+  HISTOGRAM(post_delay_us)
+// clang-format on
+
+/**
+ * Struct definition for all dispatcher stats. @see stats_macros.h
+ */
+struct DispatcherStats {
+  ALL_DISPATCHER_STATS(GENERATE_COUNTER_STRUCT, GENERATE_HISTOGRAM_STRUCT)
+};
+
 /**
  * libevent implementation of Event::Dispatcher.
  */
@@ -31,6 +54,17 @@ public:
    */
   event_base& base() { return *base_; }
 
+  /**
+   * Called by the events of the dispatcher before they run their callbacks, which tells when an
+   * iteration of the event loop stopped polling.
+   */
+  void onEventCallback() {
+    if (polling_) {
+      polling_ = false;
+      callbacks_start_ = std::chrono::steady_clock::now();
+    }
+  }
+
   // Event::Dispatcher
   void clearDeferredDeleteList() override;
   Network::ClientConnectionPtr
@@ -51,15 +85,37 @@ public:
                                          Network::ListenerCallbacks& cb, Stats::Scope& scope,
                                          const Network::ListenerOptions& listener_options) override;
   TimerPtr createTimer(TimerCb cb) override;
+  TimerPtr createCoarseTimer(TimerCb cb) override;
   void deferredDelete(DeferredDeletablePtr&& to_delete) override;
   void exit() override;
   SignalEventPtr listenForSignal(int signal_num, SignalCb cb) override;
   void post(std::function<void()> callback) override;
   void run(RunType type) override;
+  void initializeStats(Stats::Scope& scope, const std::string& prefix) override;
+  void setCallbackBudget(std::chrono::microseconds budget) override { callback_budget_ = budget; }
+  bool enableIoUring() override;
+  uint64_t pendingPosts() const override { return pending_posts_.load(); }
   Buffer::WatermarkFactory& getWatermarkFactory() override { return *buffer_factory_; }
 
 private:
-  void runPostCallbacks();
+  // The tick and the number of slots of the timer wheel of the coarse timers, which rotates once a
+  // minute.
+  static const std::chrono::milliseconds COARSE_TIMER_TICK;
+  static const uint32_t COARSE_TIMER_SLOTS = 600;
+
+  struct PostedCallback : public MpscQueueNode {
+    PostedCallback(PostCb cb, MonotonicTime posted) : cb_(cb), posted_(posted) {}
+
+    PostCb cb_;
+    MonotonicTime posted_;
+  };
+
+  void runPostCallbacks(bool budgeted);
+  void clearDeferredDeleteList(bool budgeted);
+  bool overBudget(MonotonicTime start) const {
+    return callback_budget_.count() > 0 &&
+           std::chrono::steady_clock::now() - start >= callback_budget_;
+  }
 #ifndef NDEBUG
   // Validate that an operation is thread safe, i.e. it's invoked on the same thread that the
   // dispatcher run loop is executing on. We allow run_tid_ == 0 for tests where we don't invoke
@@ -72,14 +128,26 @@ private:
   Thread::ThreadId run_tid_{};
   Buffer::WatermarkFactoryPtr buffer_factory_;
   Libevent::BasePtr base_;
+  std::unique_ptr<TimerWheel> timer_wheel_;
+  // Declared before the deferred deletions, which may own file events it polls.
+  std::unique_ptr<IoUringPoller> io_uring_;
   TimerPtr deferred_delete_timer_;
   TimerPtr post_timer_;
   std::vector<DeferredDeletablePtr> to_delete_1_;
   std::vector<DeferredDeletablePtr> to_delete_2_;
   std::vector<DeferredDeletablePtr>* current_to_delete_;
-  std::mutex post_lock_;
-  std::list<std::function<void()>> post_callbacks_;
+  MpscQueue<PostedCallback> post_callbacks_;
+  // Whether the post timer is enabled for the callbacks in the queue, so that a burst of posts
+  // wakes the event loop once.
+  std::atomic<bool> post_wakeup_pending_{};
+  std::atomic<uint64_t> pending_posts_{};
   bool deferred_deleting_{};
+  std::unique_ptr<DispatcherStats> stats_;
+  std::chrono::microseconds callback_budget_{};
+  // Whether the current iteration of the event loop is still polling, and when it started running
+  // callbacks otherwise. Only tracked once stats are initialized.
+  bool polling_{};
+  MonotonicTime callbacks_start_;
 };
 
 } // namespace Event
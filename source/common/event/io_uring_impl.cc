@@ -0,0 +1,378 @@
+#include "common/event/io_uring_impl.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+#include <string>
+
+#include "envoy/common/exception.h"
+
+#include "common/common/assert.h"
+#include "common/event/dispatcher_impl.h"
+
+#include "event2/event.h"
+#include "fmt/format.h"
+
+#ifdef ENVOY_IO_URING
+#include <poll.h>
+#include <sys/epoll.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+namespace Envoy {
+namespace Event {
+
+#ifdef ENVOY_IO_URING
+
+namespace {
+
+// The features the poller relies on: both rings in one mapping, no dropped completions, and
+// multishot polls, which came with the same kernel as resource tags.
+const uint32_t RequiredFeatures =
+    IORING_FEAT_SINGLE_MMAP | IORING_FEAT_NODROP | IORING_FEAT_RSRC_TAGS;
+
+int ringSetup(uint32_t entries, io_uring_params& params) {
+  return syscall(__NR_io_uring_setup, entries, &params);
+}
+
+} // namespace
+
+class IoUringPoller::FileEventImpl : public FileEvent {
+public:
+  FileEventImpl(IoUringPoller& poller, int fd, FileReadyCb cb, FileTriggerType trigger,
+                uint32_t events)
+      : poller_(poller), fd_(fd), cb_(cb), trigger_(trigger), events_(events) {
+    poller_.addPoll(*this);
+  }
+  ~FileEventImpl() { poller_.removePoll(id_); }
+
+  // Event::FileEvent
+  void activate(uint32_t events) override {
+    ASSERT(events);
+    poller_.activate(id_, events);
+  }
+  void setEnabled(uint32_t events) override {
+    poller_.removePoll(id_);
+    events_ = events;
+    poller_.addPoll(*this);
+  }
+
+  IoUringPoller& poller_;
+  const int fd_;
+  FileReadyCb cb_;
+  const FileTriggerType trigger_;
+  uint32_t events_;
+  uint64_t id_{};
+};
+
+IoUringPoller::IoUringPoller(DispatcherImpl& dispatcher, uint32_t entries)
+    : dispatcher_(dispatcher) {
+  io_uring_params params;
+  memset(&params, 0, sizeof(params));
+  // Multishot polls can complete many times per submission, so the completion queue is larger.
+  params.flags = IORING_SETUP_CQSIZE;
+  params.cq_entries = entries * 2;
+  ring_fd_ = ringSetup(entries, params);
+  if (ring_fd_ < 0) {
+    throw EnvoyException(fmt::format("unable to set up io_uring: {}", strerror(errno)));
+  }
+  if ((params.features & RequiredFeatures) != RequiredFeatures) {
+    close(ring_fd_);
+    throw EnvoyException("io_uring does not support multishot polls");
+  }
+
+  rings_size_ = std::max(params.sq_off.array + params.sq_entries * sizeof(uint32_t),
+                         params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe));
+  rings_ = mmap(nullptr, rings_size_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring_fd_,
+                IORING_OFF_SQ_RING);
+  sqes_size_ = params.sq_entries * sizeof(io_uring_sqe);
+  sqes_ = mmap(nullptr, sqes_size_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring_fd_,
+               IORING_OFF_SQES);
+  RELEASE_ASSERT(rings_ != MAP_FAILED && sqes_ != MAP_FAILED);
+
+  uint8_t* rings = static_cast<uint8_t*>(rings_);
+  sq_entries_ = params.sq_entries;
+  sq_head_ = reinterpret_cast<uint32_t*>(rings + params.sq_off.head);
+  sq_tail_ = reinterpret_cast<uint32_t*>(rings + params.sq_off.tail);
+  sq_mask_ = reinterpret_cast<uint32_t*>(rings + params.sq_off.ring_mask);
+  sq_array_ = reinterpret_cast<uint32_t*>(rings + params.sq_off.array);
+  sq_flags_ = reinterpret_cast<uint32_t*>(rings + params.sq_off.flags);
+  cq_head_ = reinterpret_cast<uint32_t*>(rings + params.cq_off.head);
+  cq_tail_ = reinterpret_cast<uint32_t*>(rings + params.cq_off.tail);
+  cq_mask_ = reinterpret_cast<uint32_t*>(rings + params.cq_off.ring_mask);
+  cqes_ = rings + params.cq_off.cqes;
+  sqe_tail_ = *sq_tail_;
+
+  event_assign(&raw_event_, &dispatcher.base(), ring_fd_, EV_READ | EV_PERSIST,
+               [](evutil_socket_t, short, void* arg) -> void {
+                 static_cast<IoUringPoller*>(arg)->onRingEvent();
+               },
+               this);
+  event_add(&raw_event_, nullptr);
+}
+
+IoUringPoller::~IoUringPoller() {
+  event_del(&raw_event_);
+  munmap(sqes_, sqes_size_);
+  munmap(rings_, rings_size_);
+  close(ring_fd_);
+}
+
+bool IoUringPoller::isSupported() {
+  io_uring_params params;
+  memset(&params, 0, sizeof(params));
+  const int fd = ringSetup(1, params);
+  if (fd < 0) {
+    return false;
+  }
+  close(fd);
+  return (params.features & RequiredFeatures) == RequiredFeatures;
+}
+
+FileEventPtr IoUringPoller::createFileEvent(int fd, FileReadyCb cb, FileTriggerType trigger,
+                                            uint32_t events) {
+  return FileEventPtr{new FileEventImpl(*this, fd, cb, trigger, events)};
+}
+
+void IoUringPoller::addPoll(FileEventImpl& event) {
+  event.id_ = next_id_++;
+  events_[event.id_] = &event;
+  armPoll(event);
+}
+
+void IoUringPoller::armPoll(FileEventImpl& event) {
+  uint32_t poll_events = 0;
+  if (event.events_ & FileReadyType::Read) {
+    poll_events |= POLLIN;
+  }
+  if (event.events_ & FileReadyType::Write) {
+    poll_events |= POLLOUT;
+  }
+  if (event.events_ & FileReadyType::Closed) {
+    poll_events |= POLLRDHUP;
+  }
+  if (poll_events == 0) {
+    return;
+  }
+
+  io_uring_sqe& sqe = getSqe();
+  sqe.opcode = IORING_OP_POLL_ADD;
+  sqe.fd = event.fd_;
+  sqe.user_data = event.id_;
+  if (event.trigger_ == FileTriggerType::Edge) {
+    poll_events |= EPOLLET;
+    sqe.len = IORING_POLL_ADD_MULTI;
+  }
+  sqe.poll32_events = poll_events;
+}
+
+void IoUringPoller::removePoll(uint64_t id) {
+  events_.erase(id);
+  // The completion of the removal carries ID 0, which is never assigned to a poll. The poll may
+  // have completed already, in which case the removal fails harmlessly.
+  io_uring_sqe& sqe = getSqe();
+  sqe.opcode = IORING_OP_POLL_REMOVE;
+  sqe.fd = -1;
+  sqe.addr = id;
+}
+
+io_uring_sqe& IoUringPoller::getSqe() {
+  while (sqe_tail_ - __atomic_load_n(sq_head_, __ATOMIC_ACQUIRE) == sq_entries_) {
+    submit();
+    if (sqe_tail_ - __atomic_load_n(sq_head_, __ATOMIC_ACQUIRE) == sq_entries_) {
+      // The kernel did not take the entries because the completion queue is full. The callbacks of
+      // the completions cannot run from here, where a callback may be running, so the completions
+      // are set aside before retrying.
+      stashCompletions();
+    }
+  }
+  const uint32_t index = sqe_tail_++ & *sq_mask_;
+  io_uring_sqe& sqe = static_cast<io_uring_sqe*>(sqes_)[index];
+  memset(&sqe, 0, sizeof(sqe));
+  sq_array_[index] = index;
+  unsubmitted_++;
+  scheduleFlush();
+  return sqe;
+}
+
+void IoUringPoller::submit() {
+  if (unsubmitted_ == 0) {
+    return;
+  }
+  __atomic_store_n(sq_tail_, sqe_tail_, __ATOMIC_RELEASE);
+  const int rc = enter(unsubmitted_, 0);
+  if (rc < 0) {
+    // The completion queue is full (EBUSY) or the kernel is out of memory (EAGAIN). The entries
+    // are submitted once the event loop ran the completions.
+    RELEASE_ASSERT(errno == EBUSY || errno == EAGAIN);
+    return;
+  }
+  unsubmitted_ -= rc;
+}
+
+int IoUringPoller::enter(uint32_t to_submit, uint32_t flags) {
+  int rc;
+  do {
+    rc = syscall(__NR_io_uring_enter, ring_fd_, to_submit, 0, flags, nullptr, 0);
+  } while (rc < 0 && errno == EINTR);
+  return rc;
+}
+
+void IoUringPoller::stashCompletions() {
+  const io_uring_cqe* cqes = static_cast<const io_uring_cqe*>(cqes_);
+  uint32_t head = *cq_head_;
+  while (head != __atomic_load_n(cq_tail_, __ATOMIC_ACQUIRE)) {
+    const io_uring_cqe& cqe = cqes[head & *cq_mask_];
+    stashed_completions_.push_back({cqe.user_data, cqe.res, (cqe.flags & IORING_CQE_F_MORE) != 0});
+    head++;
+  }
+  __atomic_store_n(cq_head_, head, __ATOMIC_RELEASE);
+  if (__atomic_load_n(sq_flags_, __ATOMIC_ACQUIRE) & IORING_SQ_CQ_OVERFLOW) {
+    enter(0, IORING_ENTER_GETEVENTS);
+  }
+}
+
+void IoUringPoller::runCompletions() {
+  const io_uring_cqe* cqes = static_cast<const io_uring_cqe*>(cqes_);
+  // The polls that completed are re-armed once all the completions ran, so that polls that keep
+  // completing, i.e. when the completion queue overflows, cannot keep the event loop here.
+  std::vector<uint64_t> completed_polls;
+  while (true) {
+    // The stashed completions precede those still in the completion queue. Callbacks may stash
+    // more, both while these run and while those of the queue run.
+    while (!stashed_completions_.empty()) {
+      std::vector<Completion> completions;
+      completions.swap(stashed_completions_);
+      for (const Completion& completion : completions) {
+        onCompletion(completion, completed_polls);
+      }
+    }
+
+    // The head is read anew for each entry since stashing completions moves it.
+    uint32_t head;
+    while ((head = *cq_head_) != __atomic_load_n(cq_tail_, __ATOMIC_ACQUIRE)) {
+      // The entry is released before its callback runs, which may cause more completions.
+      const io_uring_cqe& cqe = cqes[head & *cq_mask_];
+      const Completion completion{cqe.user_data, cqe.res, (cqe.flags & IORING_CQE_F_MORE) != 0};
+      __atomic_store_n(cq_head_, head + 1, __ATOMIC_RELEASE);
+      onCompletion(completion, completed_polls);
+    }
+
+    // The kernel keeps the completions that did not fit in the completion queue aside until the
+    // ring is entered.
+    if (__atomic_load_n(sq_flags_, __ATOMIC_ACQUIRE) & IORING_SQ_CQ_OVERFLOW) {
+      enter(0, IORING_ENTER_GETEVENTS);
+    } else if (stashed_completions_.empty()) {
+      break;
+    }
+  }
+
+  for (uint64_t id : completed_polls) {
+    auto it = events_.find(id);
+    if (it != events_.end()) {
+      armPoll(*it->second);
+    }
+  }
+}
+
+void IoUringPoller::onCompletion(const Completion& completion,
+                                 std::vector<uint64_t>& completed_polls) {
+  auto it = events_.find(completion.id_);
+  if (it == events_.end()) {
+    return;
+  }
+  FileEventImpl& event = *it->second;
+  const int32_t res = completion.res_;
+
+  uint32_t events = 0;
+  if (res < 0) {
+    // The file cannot be polled, which its owner learns by reading or writing it.
+    events = event.events_ & (FileReadyType::Read | FileReadyType::Write);
+  } else {
+    // Like libevent, errors and hang ups make the file both readable and writable.
+    if (res & (POLLERR | POLLHUP)) {
+      events |= FileReadyType::Read | FileReadyType::Write;
+    }
+    if (res & POLLIN) {
+      events |= FileReadyType::Read;
+    }
+    if (res & POLLOUT) {
+      events |= FileReadyType::Write;
+    }
+    if (res & POLLRDHUP) {
+      events |= FileReadyType::Closed;
+    }
+    events &= event.events_;
+  }
+  if (!completion.more_) {
+    // A level triggered poll completed, or the kernel ended a multishot poll, including when it
+    // failed. The poll is re-armed so that the file keeps being polled until its owner closes it.
+    completed_polls.push_back(completion.id_);
+  }
+
+  if (events != 0) {
+    event.cb_(events);
+  }
+}
+
+void IoUringPoller::activate(uint64_t id, uint32_t events) {
+  activations_.emplace_back(id, events);
+  scheduleFlush();
+}
+
+void IoUringPoller::scheduleFlush() {
+  // The ring event submits what the callbacks it runs queue before it returns.
+  if (!flush_scheduled_ && !in_ring_event_) {
+    flush_scheduled_ = true;
+    event_active(&raw_event_, EV_READ, 0);
+  }
+}
+
+void IoUringPoller::onRingEvent() {
+  dispatcher_.onEventCallback();
+  flush_scheduled_ = false;
+  in_ring_event_ = true;
+  submit();
+  runCompletions();
+
+  std::vector<std::pair<uint64_t, uint32_t>> activations;
+  activations.swap(activations_);
+  for (const auto& activation : activations) {
+    auto it = events_.find(activation.first);
+    if (it != events_.end()) {
+      it->second->cb_(activation.second);
+    }
+  }
+
+  // The completions of what is submitted now wake the event loop through the ring's file
+  // descriptor, so that ready files cannot keep the loop from polling. Activations run in the next
+  // batch of callbacks, as libevent runs them.
+  submit();
+  in_ring_event_ = false;
+  if (!activations_.empty() || unsubmitted_ > 0 || !stashed_completions_.empty()) {
+    scheduleFlush();
+  }
+}
+
+#else
+
+IoUringPoller::IoUringPoller(DispatcherImpl& dispatcher, uint32_t)
+    : dispatcher_(dispatcher) {
+  throw EnvoyException("io_uring is not supported by this build");
+}
+
+IoUringPoller::~IoUringPoller() {}
+
+bool IoUringPoller::isSupported() { return false; }
+
+FileEventPtr IoUringPoller::createFileEvent(int, FileReadyCb, FileTriggerType, uint32_t) {
+  NOT_REACHED;
+}
+
+#endif
+
+} // namespace Event
+} // namespace Envoy
@@ -0,0 +1,122 @@
+#pragma once
+
+#include <cstdint>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "envoy/event/file_event.h"
+
+#include "event2/event_struct.h"
+
+#if defined(__linux__) && defined(__has_include)
+#if __has_include(<linux/io_uring.h>)
+#include <linux/io_uring.h>
+// Multishot polls need Linux 5.13.
+#ifdef IORING_POLL_ADD_MULTI
+#define ENVOY_IO_URING 1
+#endif
+#endif
+#endif
+
+namespace Envoy {
+namespace Event {
+
+class DispatcherImpl;
+
+/**
+ * File event backend of a dispatcher that polls the readiness of files with an io_uring instead of
+ * libevent. The polls of edge triggered events are multishot polls with EPOLLET, which complete
+ * once per readiness change like epoll does, and those of level triggered events are re-armed after
+ * each callback. The submissions that arming and disarming file events take are batched, and
+ * submitted with one io_uring_enter() per batch of callbacks of the event loop. The ring's file
+ * descriptor is polled by libevent along with the timers, signals and listeners of the dispatcher.
+ */
+class IoUringPoller {
+public:
+  /**
+   * @param entries supplies the number of submission queue entries of the ring.
+   * @throw EnvoyException if the kernel does not support io_uring.
+   */
+  IoUringPoller(DispatcherImpl& dispatcher, uint32_t entries);
+  ~IoUringPoller();
+
+  /**
+   * @return bool whether the kernel and the build support the poller.
+   */
+  static bool isSupported();
+
+  /**
+   * Allocate a file event polled by the ring. @see Dispatcher::createFileEvent().
+   */
+  FileEventPtr createFileEvent(int fd, FileReadyCb cb, FileTriggerType trigger, uint32_t events);
+
+  // The number of submission queue entries of the rings of the dispatchers.
+  static const uint32_t DEFAULT_ENTRIES = 4096;
+
+private:
+  class FileEventImpl;
+
+  struct Completion {
+    uint64_t id_;
+    int32_t res_;
+    bool more_;
+  };
+
+  /**
+   * Arm a new poll of a file event for its enabled events, which becomes the ID of the event.
+   */
+  void addPoll(FileEventImpl& event);
+  void removePoll(uint64_t id);
+  void activate(uint64_t id, uint32_t events);
+  void scheduleFlush();
+  void onRingEvent();
+  void submit();
+  int enter(uint32_t to_submit, uint32_t flags);
+  void runCompletions();
+  void onCompletion(const Completion& completion, std::vector<uint64_t>& completed_polls);
+  /**
+   * Move the completions out of the completion queue, for runCompletions() to run later, so that
+   * the kernel can post those it holds back and take more submissions.
+   */
+  void stashCompletions();
+#ifdef ENVOY_IO_URING
+  void armPoll(FileEventImpl& event);
+  io_uring_sqe& getSqe();
+#endif
+
+  DispatcherImpl& dispatcher_;
+  event raw_event_;
+  int ring_fd_{-1};
+  // The mapping of both the submission and the completion queue rings, and of the submission queue
+  // entries.
+  void* rings_{};
+  size_t rings_size_{};
+  void* sqes_{};
+  size_t sqes_size_{};
+  uint32_t sq_entries_{};
+  uint32_t* sq_head_{};
+  uint32_t* sq_tail_{};
+  uint32_t* sq_mask_{};
+  uint32_t* sq_array_{};
+  uint32_t* sq_flags_{};
+  uint32_t* cq_head_{};
+  uint32_t* cq_tail_{};
+  uint32_t* cq_mask_{};
+  void* cqes_{};
+  // The tail of the submission queue including the entries that were not submitted yet.
+  uint32_t sqe_tail_{};
+  uint32_t unsubmitted_{};
+  bool flush_scheduled_{};
+  bool in_ring_event_{};
+  // The file events by the ID of their current poll. IDs are not reused, so the completions of
+  // disarmed polls and destroyed events are told apart and dropped.
+  std::unordered_map<uint64_t, FileEventImpl*> events_;
+  uint64_t next_id_{1};
+  std::vector<std::pair<uint64_t, uint32_t>> activations_;
+  // Completions moved out of the completion queue by stashCompletions() that did not run yet.
+  std::vector<Completion> stashed_completions_;
+};
+
+} // namespace Event
+} // namespace Envoy
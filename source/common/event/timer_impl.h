@@ -22,6 +22,7 @@ public:
   void enableTimer(const std::chrono::milliseconds& d) override;
 
 private:
+  DispatcherImpl& dispatcher_;
   TimerCb cb_;
 };
 
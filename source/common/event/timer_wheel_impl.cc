@@ -0,0 +1,100 @@
+#include "common/event/timer_wheel_impl.h"
+
+#include <chrono>
+#include <cstdint>
+
+#include "common/common/assert.h"
+
+namespace Envoy {
+namespace Event {
+
+class TimerWheel::TimerImpl : public Timer {
+public:
+  TimerImpl(TimerWheel& wheel, TimerCb cb) : wheel_(wheel), cb_(cb) { ASSERT(cb_); }
+  ~TimerImpl() { disableTimer(); }
+
+  // Event::Timer
+  void disableTimer() override {
+    if (list_ != nullptr) {
+      wheel_.remove(*this);
+    }
+  }
+  void enableTimer(const std::chrono::milliseconds& d) override { wheel_.add(*this, d); }
+
+  TimerWheel& wheel_;
+  TimerCb cb_;
+  // The list the timer is in while it is enabled, nullptr otherwise.
+  TimerList* list_{};
+  TimerList::iterator entry_;
+  uint64_t rotations_{};
+};
+
+TimerWheel::TimerWheel(Dispatcher& dispatcher, std::chrono::milliseconds tick, uint32_t slots)
+    : tick_(tick), slots_(slots),
+      tick_timer_(dispatcher.createTimer([this]() -> void { onTick(); })) {
+  ASSERT(tick_.count() > 0);
+  ASSERT(slots > 0);
+}
+
+TimerPtr TimerWheel::createTimer(TimerCb cb) { return TimerPtr{new TimerImpl(*this, cb)}; }
+
+void TimerWheel::add(TimerImpl& timer, const std::chrono::milliseconds& d) {
+  // The current tick may be partially over, so the timer is put one tick further than its timeout
+  // to never fire early.
+  const uint64_t ticks = (d.count() + tick_.count() - 1) / tick_.count() + 1;
+  TimerList& slot = slots_[(current_slot_ + ticks) % slots_.size()];
+  timer.rotations_ = (ticks - 1) / slots_.size();
+  if (timer.list_ != nullptr) {
+    // Timers such as idle timeouts are re-enabled on every read and write, so an enabled timer's
+    // entry is moved to the new slot rather than freed and allocated again.
+    slot.splice(slot.end(), *timer.list_, timer.entry_);
+    timer.list_ = &slot;
+    return;
+  }
+
+  timer.list_ = &slot;
+  timer.entry_ = slot.insert(slot.end(), &timer);
+
+  if (enabled_timers_++ == 0) {
+    tick_timer_->enableTimer(tick_);
+  }
+}
+
+void TimerWheel::remove(TimerImpl& timer) {
+  timer.list_->erase(timer.entry_);
+  timer.list_ = nullptr;
+
+  ASSERT(enabled_timers_ > 0);
+  if (--enabled_timers_ == 0) {
+    tick_timer_->disableTimer();
+  }
+}
+
+void TimerWheel::onTick() {
+  current_slot_ = (current_slot_ + 1) % slots_.size();
+  TimerList& slot = slots_[current_slot_];
+  for (auto it = slot.begin(); it != slot.end();) {
+    TimerImpl& timer = **it++;
+    if (timer.rotations_ > 0) {
+      timer.rotations_--;
+    } else {
+      expired_.splice(expired_.end(), slot, timer.entry_);
+      timer.list_ = &expired_;
+    }
+  }
+
+  // Callbacks may enable, disable or destroy any timer, including the expired ones that have not
+  // fired yet, so each timer is removed before its callback runs.
+  while (!expired_.empty()) {
+    TimerImpl& timer = *expired_.front();
+    remove(timer);
+    timer.cb_();
+  }
+
+  if (enabled_timers_ > 0) {
+    tick_timer_->enableTimer(tick_);
+  }
+}
+
+} // namespace Event
+} // namespace Envoy
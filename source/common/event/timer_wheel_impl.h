@@ -0,0 +1,51 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <list>
+#include <vector>
+
+#include "envoy/event/dispatcher.h"
+#include "envoy/event/timer.h"
+
+namespace Envoy {
+namespace Event {
+
+/**
+ * Hashed timer wheel (http://www.cs.columbia.edu/~nahum/w6998/papers/sosp87-timing-wheels.pdf)
+ * that implements the coarse timers of a dispatcher. Each timer is kept in the slot of the wheel
+ * its deadline falls into, along with the number of rotations of the wheel left until then, so
+ * enabling and disabling a timer is O(1) regardless of the number of timers. The wheel advances one
+ * slot per tick and fires all the timers of the slot that are due, so timers due close together
+ * fire in the same batch. A timer fires less than two ticks after its timeout, never before. The
+ * wheel only ticks while timers are enabled.
+ */
+class TimerWheel {
+public:
+  TimerWheel(Dispatcher& dispatcher, std::chrono::milliseconds tick, uint32_t slots);
+
+  /**
+   * Allocate a timer in the wheel.
+   * @param cb supplies the callback to invoke when the timer fires.
+   */
+  TimerPtr createTimer(TimerCb cb);
+
+private:
+  class TimerImpl;
+  typedef std::list<TimerImpl*> TimerList;
+
+  void add(TimerImpl& timer, const std::chrono::milliseconds& d);
+  void remove(TimerImpl& timer);
+  void onTick();
+
+  const std::chrono::milliseconds tick_;
+  std::vector<TimerList> slots_;
+  // Timers that are due in the current tick and have not fired yet.
+  TimerList expired_;
+  TimerPtr tick_timer_;
+  uint32_t current_slot_{};
+  uint64_t enabled_timers_{};
+};
+
+} // namespace Event
+} // namespace Envoy
@@ -1,14 +1,19 @@
 #include "common/filesystem/filesystem_impl.h"
 
 #include <dirent.h>
+#include <sys/uio.h>
 
+#include <algorithm>
 #include <chrono>
+#include <climits>
 #include <cstdint>
 #include <fstream>
 #include <iostream>
 #include <mutex>
 #include <sstream>
 #include <string>
+#include <thread>
+#include <unordered_map>
 
 #include "envoy/common/exception.h"
 #include "envoy/event/dispatcher.h"
@@ -24,6 +29,12 @@
 namespace Envoy {
 namespace Filesystem {
 
+namespace {
+
+std::atomic<uint64_t> next_file_id{};
+
+} // namespace
+
 bool fileExists(const std::string& path) {
   std::ifstream input_file(path);
   return input_file.is_open();
@@ -54,9 +65,10 @@ std::string fileReadToEnd(const std::string& path) {
 }
 
 FileImpl::FileImpl(const std::string& path, Event::Dispatcher& dispatcher,
-                   Thread::BasicLockable& lock, Stats::Store& stats_store,
-                   std::chrono::milliseconds flush_interval_msec)
-    : path_(path), file_lock_(lock), flush_timer_(dispatcher.createTimer([this]() -> void {
+                   Thread::BasicLockable&, Stats::Store& stats_store,
+                   std::chrono::milliseconds flush_interval_msec, OverflowPolicy overflow_policy)
+    : path_(path), id_(next_file_id++), overflow_policy_(overflow_policy),
+      flush_timer_(dispatcher.createTimer([this]() -> void {
         stats_.flushed_by_timer_.inc();
         flush_event_.notify_one();
         flush_timer_->enableTimer(flush_interval_msec_);
@@ -91,8 +103,9 @@ FileImpl::~FileImpl() {
 
   // Flush any remaining data. If file was not opened for some reason, skip flushing part.
   if (fd_ != -1) {
-    if (flush_buffer_.length() > 0) {
-      doWrite(flush_buffer_);
+    takeBuffers();
+    if (about_to_write_buffer_.length() > 0) {
+      doWrite(about_to_write_buffer_);
     }
 
     os_sys_calls_.close(fd_);
@@ -100,32 +113,51 @@ FileImpl::~FileImpl() {
 }
 
 void FileImpl::doWrite(Buffer::Instance& buffer) {
-  uint64_t num_slices = buffer.getRawSlices(nullptr, 0);
+  const uint64_t num_slices = buffer.getRawSlices(nullptr, 0);
+  if (num_slices == 0) {
+    return;
+  }
   Buffer::RawSlice slices[num_slices];
   buffer.getRawSlices(slices, num_slices);
+  const uint64_t num_iov = std::min<uint64_t>(num_slices, IOV_MAX);
+  iovec iov[num_iov];
+  for (uint64_t i = 0; i < num_iov; i++) {
+    iov[i].iov_base = slices[i].mem_;
+    iov[i].iov_len = slices[i].len_;
+  }
 
-  // We must do the actual writes to disk under lock, so that we don't intermix chunks from
-  // different FileImpl pointing to the same underlying file. This can happen either via hot
-  // restart or if calling code opens the same underlying file into a different FileImpl in the
-  // same process.
-  // TODO PERF: Currently, we use a single cross process lock to serialize all disk writes. This
-  //            will never block network workers, but does mean that only a single flush thread can
-  //            actually flush to disk. In the future it would be nice if we did away with the cross
-  //            process lock or had multiple locks.
-  {
-    std::lock_guard<Thread::BasicLockable> lock(file_lock_);
-    for (Buffer::RawSlice& slice : slices) {
-      ssize_t rc = os_sys_calls_.write(fd_, slice.mem_, slice.len_);
-      ASSERT(rc == static_cast<ssize_t>(slice.len_));
-      UNREFERENCED_PARAMETER(rc);
-      stats_.write_completed_.inc();
+  // Chunks from different FileImpl pointing to the same underlying file must not be intermixed.
+  // This can happen either via hot restart or if calling code opens the same underlying file into
+  // a different FileImpl in the same process. The file is opened with O_APPEND, so every flush is
+  // a single writev() that lands in the file in one piece without any locking, and flushes from
+  // different files never wait for each other. The slices past IOV_MAX are copied into the last
+  // iovec to keep it a single call.
+  std::string tail;
+  if (num_slices > num_iov) {
+    for (uint64_t i = num_iov - 1; i < num_slices; i++) {
+      tail.append(static_cast<const char*>(slices[i].mem_), slices[i].len_);
     }
+    iov[num_iov - 1].iov_base = &tail[0];
+    iov[num_iov - 1].iov_len = tail.size();
   }
+  doWritev(iov, num_iov);
 
   stats_.write_total_buffered_.sub(buffer.length());
   buffer.drain(buffer.length());
 }
 
+void FileImpl::doWritev(const iovec* iov, int iovcnt) {
+  size_t num_bytes = 0;
+  for (int i = 0; i < iovcnt; i++) {
+    num_bytes += iov[i].iov_len;
+  }
+  ssize_t rc = os_sys_calls_.writev(fd_, iov, iovcnt);
+  ASSERT(rc == static_cast<ssize_t>(num_bytes));
+  UNREFERENCED_PARAMETER(rc);
+  UNREFERENCED_PARAMETER(num_bytes);
+  stats_.write_completed_.inc();
+}
+
 void FileImpl::flushThreadFunc() {
 
   while (true) {
@@ -134,9 +166,9 @@ void FileImpl::flushThreadFunc() {
     {
       std::unique_lock<std::mutex> write_lock(write_lock_);
 
-      // flush_event_ can be woken up either by large enough flush_buffer or by timer.
-      // In case it was timer, flush_buffer_ can be empty.
-      while (flush_buffer_.length() == 0 && !flush_thread_exit_) {
+      // flush_event_ can be woken up either by large enough buffers or by timer.
+      // In case it was timer, all buffers can be empty.
+      while (flush_buffer_.length() == 0 && !threadBuffersPending() && !flush_thread_exit_) {
         flush_event_.wait(write_lock);
       }
 
@@ -145,9 +177,12 @@ void FileImpl::flushThreadFunc() {
       }
 
       flush_lock = std::unique_lock<std::mutex>(flush_lock_);
-      ASSERT(flush_buffer_.length() > 0);
-      about_to_write_buffer_.move(flush_buffer_);
-      ASSERT(flush_buffer_.length() == 0);
+      takeBuffers();
+    }
+
+    // A synchronous flush may have taken the data in the meantime.
+    if (about_to_write_buffer_.length() == 0) {
+      continue;
     }
 
     // if we failed to open file before (-1 == fd_), then simply ignore
@@ -180,32 +215,138 @@ void FileImpl::flush() {
     // return before the pending data has actually been written to disk.
     flush_buffer_lock = std::unique_lock<std::mutex>(flush_lock_);
 
-    if (flush_buffer_.length() == 0) {
+    takeBuffers();
+    if (about_to_write_buffer_.length() == 0) {
       return;
     }
-
-    about_to_write_buffer_.move(flush_buffer_);
-    ASSERT(flush_buffer_.length() == 0);
   }
 
   doWrite(about_to_write_buffer_);
 }
 
 void FileImpl::write(const std::string& data) {
-  std::lock_guard<std::mutex> lock(write_lock_);
+  ThreadBuffer& buffer = threadBuffer();
+  stats_.write_buffered_.inc();
 
+  // Once a write of the thread spilled, the following ones spill as well until the shared buffer
+  // was taken, so that they are not written before it.
+  if (buffer.spilled_generation_ == take_generation_.load(std::memory_order_acquire) ||
+      data.length() > buffer.ring_.writable()) {
+    switch (overflow_policy_) {
+    case OverflowPolicy::Block:
+      stats_.write_blocked_.inc();
+      stats_.write_total_buffered_.add(data.length());
+      blockingWrite(buffer, data);
+      return;
+    case OverflowPolicy::Drop:
+      stats_.write_dropped_.inc();
+      return;
+    case OverflowPolicy::Spill: {
+      stats_.write_spilled_.inc();
+      stats_.write_total_buffered_.add(data.length());
+      std::lock_guard<std::mutex> lock(write_lock_);
+      buffer.spilled_generation_ = take_generation_;
+      flush_buffer_.add(data);
+      if (flush_buffer_.length() > MIN_FLUSH_SIZE) {
+        flush_event_.notify_one();
+      }
+      return;
+    }
+    }
+  }
+
+  stats_.write_total_buffered_.add(data.length());
+  buffer.ring_.write(data.data(), data.length());
+  // The first write of a thread wakes the flush thread right away. Otherwise the flush thread that
+  // the write may have started could miss it until the timer fires.
+  if (buffer.first_write_ ||
+      (buffer.ring_.readable() > MIN_FLUSH_SIZE && !buffer.flush_requested_.exchange(true))) {
+    buffer.first_write_ = false;
+    requestFlush();
+  }
+}
+
+FileImpl::ThreadBuffer& FileImpl::threadBuffer() {
+  // The buffers of the files the thread wrote to. Entries of destroyed files are never looked up
+  // again since file ids are not reused, and are erased whenever the thread first writes to
+  // another file, such as the one that replaces a rotated access log, so they do not accumulate.
+  static thread_local std::unordered_map<uint64_t, CachedThreadBuffer> thread_buffers;
+  auto it = thread_buffers.find(id_);
+  if (it != thread_buffers.end()) {
+    return *it->second.buffer_;
+  }
+
+  for (auto cached = thread_buffers.begin(); cached != thread_buffers.end();) {
+    if (cached->second.alive_.expired()) {
+      cached = thread_buffers.erase(cached);
+    } else {
+      ++cached;
+    }
+  }
+
+  std::lock_guard<std::mutex> lock(thread_buffers_lock_);
   if (flush_thread_ == nullptr) {
     createFlushStructures();
   }
+  thread_buffers_.emplace_back(new ThreadBuffer());
+  const std::shared_ptr<ThreadBuffer>& buffer = thread_buffers_.back();
+  thread_buffers.emplace(id_, CachedThreadBuffer{buffer.get(), buffer});
+  return *buffer;
+}
 
-  stats_.write_buffered_.inc();
-  stats_.write_total_buffered_.add(data.length());
-  flush_buffer_.add(data);
-  if (flush_buffer_.length() > MIN_FLUSH_SIZE) {
-    flush_event_.notify_one();
+void FileImpl::blockingWrite(ThreadBuffer& buffer, const std::string& data) {
+  // A write that fits the buffer goes in whole once there is room for it. Larger ones go in
+  // pieces of the size of the buffer, which the writes of other threads may separate.
+  uint64_t written = 0;
+  while (written < data.length()) {
+    const uint64_t size = std::min<uint64_t>(data.length() - written, buffer.ring_.capacity());
+    if (buffer.ring_.writable() >= size) {
+      buffer.ring_.write(data.data() + written, size);
+      written += size;
+    } else {
+      if (!buffer.flush_requested_.exchange(true)) {
+        requestFlush();
+      }
+      std::this_thread::yield();
+    }
   }
 }
 
+void FileImpl::requestFlush() {
+  // Taking the lock makes sure that the flush thread either sees the data before it waits or is
+  // already waiting for the notification.
+  std::lock_guard<std::mutex> lock(write_lock_);
+  flush_event_.notify_one();
+}
+
+bool FileImpl::threadBuffersPending() {
+  std::lock_guard<std::mutex> lock(thread_buffers_lock_);
+  for (const std::shared_ptr<ThreadBuffer>& buffer : thread_buffers_) {
+    if (buffer->ring_.readable() > 0) {
+      return true;
+    }
+  }
+  return false;
+}
+
+void FileImpl::takeBuffers() {
+  {
+    std::lock_guard<std::mutex> lock(thread_buffers_lock_);
+    for (const std::shared_ptr<ThreadBuffer>& buffer : thread_buffers_) {
+      // Cleared first, so that a writer that fills the buffer again while it is drained asks for
+      // another flush.
+      buffer->flush_requested_ = false;
+      buffer->ring_.read([this](const char* data, uint64_t size) -> void {
+        about_to_write_buffer_.add(data, size);
+      });
+    }
+  }
+
+  about_to_write_buffer_.move(flush_buffer_);
+  ASSERT(flush_buffer_.length() == 0);
+  take_generation_++;
+}
+
 void FileImpl::createFlushStructures() {
   flush_thread_.reset(new Thread::Thread([this]() -> void { flushThreadFunc(); }));
   flush_timer_->enableTimer(flush_interval_msec_);
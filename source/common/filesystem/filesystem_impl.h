@@ -4,6 +4,9 @@
 #include <chrono>
 #include <condition_variable>
 #include <cstdint>
+#include <limits>
+#include <list>
+#include <memory>
 #include <mutex>
 #include <string>
 
@@ -13,13 +16,17 @@
 #include "envoy/stats/stats_macros.h"
 
 #include "common/buffer/buffer_impl.h"
+#include "common/common/spsc_ring_buffer.h"
 #include "common/common/thread.h"
 
 namespace Envoy {
 // clang-format off
 #define FILESYSTEM_STATS(COUNTER, GAUGE)                                                           \
   COUNTER(write_buffered)                                                                          \
+  COUNTER(write_blocked)                                                                           \
   COUNTER(write_completed)                                                                         \
+  COUNTER(write_dropped)                                                                           \
+  COUNTER(write_spilled)                                                                           \
   COUNTER(flushed_by_timer)                                                                        \
   COUNTER(reopen_failed)                                                                           \
   GAUGE  (write_total_buffered)
@@ -53,11 +60,24 @@ std::string fileReadToEnd(const std::string& path);
  * This implementation uses a flush thread per file, with the idea there there aren't that many
  * files. If this turns out to be a good implementation we can potentially have a single flush
  * thread that flushes all files, but we will start with this.
+ *
+ * Each thread that writes to the file gets a ring buffer of its own that the flush thread drains,
+ * so that workers logging at a high rate do not contend on a lock. Writes are only ordered with
+ * respect to the other writes of the same thread. What a write does when the buffer of its thread
+ * is full is up to the overflow policy.
  */
 class FileImpl : public File {
 public:
+  // Size of the buffer of each thread that writes to a file.
+  static const uint64_t THREAD_BUFFER_SIZE = 256 * 1024;
+
+  /**
+   * @param lock supplies the lock of the process shared by the files, which the file does not need
+   *        since each of its flushes is a single append.
+   */
   FileImpl(const std::string& path, Event::Dispatcher& dispatcher, Thread::BasicLockable& lock,
-           Stats::Store& stats_store, std::chrono::milliseconds flush_interval_msec);
+           Stats::Store& stats_store, std::chrono::milliseconds flush_interval_msec,
+           OverflowPolicy overflow_policy = OverflowPolicy::Spill);
   ~FileImpl();
 
   // Filesystem::File
@@ -75,7 +95,38 @@ public:
   void flush() override;
 
 private:
+  struct ThreadBuffer {
+    ThreadBuffer() : ring_(THREAD_BUFFER_SIZE) {}
+
+    SpscRingBuffer ring_;
+    // Whether the thread asked the flush thread to flush since the buffer was last drained.
+    std::atomic<bool> flush_requested_{};
+    // The take_generation_ of the last write of the thread that spilled, and whether the thread
+    // did not write to the buffer yet. Only accessed by the thread.
+    uint64_t spilled_generation_{std::numeric_limits<uint64_t>::max()};
+    bool first_write_{true};
+  };
+
+  // The entry of a thread buffer in the cache of its thread. Writes to the file that owns the
+  // buffer use the raw pointer, and the weak pointer expires once the file is destroyed so that
+  // the entry can be erased.
+  struct CachedThreadBuffer {
+    ThreadBuffer* buffer_;
+    std::weak_ptr<ThreadBuffer> alive_;
+  };
+
+  // @return the buffer of the calling thread, which is created on the first write of the thread.
+  ThreadBuffer& threadBuffer();
+  void blockingWrite(ThreadBuffer& buffer, const std::string& data);
+  void requestFlush();
+  // Whether any thread buffer holds data. Called with write_lock_ held.
+  bool threadBuffersPending();
+  // Move the data of the thread buffers and then of flush_buffer_ to about_to_write_buffer_, so
+  // that a write that spilled when its thread buffer was full is written after the data of that
+  // buffer. Called with write_lock_ and flush_lock_ held.
+  void takeBuffers();
   void doWrite(Buffer::Instance& buffer);
+  void doWritev(const iovec* iov, int iovcnt);
   void flushThreadFunc();
   void open();
   void createFlushStructures();
@@ -89,28 +140,35 @@ private:
   // These locks are always acquired in the following order if multiple locks are held:
   //    1) write_lock_
   //    2) flush_lock_
-  //    3) file_lock_
-  Thread::BasicLockable& file_lock_; // This lock is used only by the flush thread when writing
-                                     // to disk. This is used to make sure that file blocks do
-                                     // not get interleaved by multiple processes writing to
-                                     // the same file during hot-restart.
+  //    3) thread_buffers_lock_
+  // No cross process lock is needed to keep the blocks of different processes writing to the same
+  // file during hot restart from being interleaved, since every flush is a single writev() to a
+  // file opened with O_APPEND. The lock passed to the constructor is not used.
   std::mutex flush_lock_;            // This lock is used to prevent simulataneous flushes from
                                      // the flush thread and a syncronous flush. This protects
                                      // concurrent access to the about_to_write_buffer_, fd_,
                                      // and all other data used during flushing and file
                                      // re-opening.
-  std::mutex write_lock_;            // The lock is used when filling the flush buffer. It allows
-                                     // multiple threads to write to the same file at relatively
-                                     // high performance. It is always local to the process.
+  std::mutex write_lock_;            // The lock is used when filling the flush buffer, which
+                                     // only happens when a thread buffer overflows, and when
+                                     // waking the flush thread. It is always local to the process.
+  std::mutex thread_buffers_lock_;   // Guards thread_buffers_ and the creation of the flush
+                                     // thread. Writers only take it on their first write.
+  std::list<std::shared_ptr<ThreadBuffer>> thread_buffers_;
+  const uint64_t id_; // Identifies the file in the buffer caches of the threads, since the
+                      // address of a destroyed file may be reused.
+  const OverflowPolicy overflow_policy_;
+  std::atomic<uint64_t> take_generation_{}; // Incremented whenever flush_buffer_ is taken, under
+                                            // write_lock_.
   Thread::ThreadPtr flush_thread_;
-  std::condition_variable_any flush_event_;
+  std::condition_variable flush_event_;
   std::atomic<bool> flush_thread_exit_{};
   std::atomic<bool> reopen_file_{};
-  Buffer::OwnedImpl flush_buffer_; // This buffer is used by multiple threads. It gets filled and
-                                   // then flushed either when max size is reached or when a timer
-                                   // fires.
+  Buffer::OwnedImpl flush_buffer_; // This buffer is used by multiple threads when their thread
+                                   // buffers overflow. It gets flushed along with those.
   Buffer::OwnedImpl about_to_write_buffer_; // This buffer is used only by the flush thread. Data
-                                            // is moved from flush_buffer_ under lock, and then
+                                            // is moved from flush_buffer_ and the thread
+                                            // buffers under lock, and then
                                             // the lock is released so that flush_buffer_ can
                                             // continue to fill. This buffer is then used for the
                                             // final write to disk.
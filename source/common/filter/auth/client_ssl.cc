@@ -1,7 +1,9 @@
 #include "common/filter/auth/client_ssl.h"
 
+#include <algorithm>
 #include <chrono>
 #include <cstdint>
+#include <cstring>
 #include <string>
 
 #include "envoy/network/connection.h"
@@ -20,6 +22,128 @@ namespace Filter {
 namespace Auth {
 namespace ClientSsl {
 
+namespace {
+
+int hexValue(char c) {
+  if (c >= '0' && c <= '9') {
+    return c - '0';
+  } else if (c >= 'a' && c <= 'f') {
+    return c - 'a' + 10;
+  } else if (c >= 'A' && c <= 'F') {
+    return c - 'A' + 10;
+  }
+  return -1;
+}
+
+bool decodeDigest(const std::string& hex, AllowedPrincipals::Digest& digest) {
+  if (hex.size() != 2 * digest.size()) {
+    return false;
+  }
+  for (size_t i = 0; i < digest.size(); i++) {
+    const int high = hexValue(hex[2 * i]);
+    const int low = hexValue(hex[2 * i + 1]);
+    if (high < 0 || low < 0) {
+      return false;
+    }
+    digest[i] = static_cast<uint8_t>((high << 4) | low);
+  }
+  return true;
+}
+
+bool isZero(const AllowedPrincipals::Digest& digest) {
+  return std::all_of(digest.begin(), digest.end(), [](uint8_t byte) { return byte == 0; });
+}
+
+} // namespace
+
+void AllowedPrincipals::add(const std::string& sha256_digest) {
+  Digest digest;
+  if (!decodeDigest(sha256_digest, digest)) {
+    return;
+  }
+  if (isZero(digest)) {
+    if (!has_zero_digest_) {
+      has_zero_digest_ = true;
+      size_++;
+    }
+    return;
+  }
+
+  // Keep the table at most half full so that probe sequences stay short.
+  if (2 * (size_ + 1) > slots_.size()) {
+    rehash(std::max<size_t>(16, 2 * slots_.size()));
+  }
+  Digest& slot = slots_[find(digest)];
+  if (isZero(slot)) {
+    slot = digest;
+    size_++;
+  }
+}
+
+void AllowedPrincipals::reserve(size_t count) {
+  size_t capacity = 16;
+  while (capacity < 2 * count) {
+    capacity *= 2;
+  }
+  if (capacity > slots_.size()) {
+    rehash(capacity);
+  }
+}
+
+bool AllowedPrincipals::allowed(const std::string& sha256_digest) const {
+  Digest digest;
+  return decodeDigest(sha256_digest, digest) && contains(digest);
+}
+
+bool AllowedPrincipals::operator==(const AllowedPrincipals& rhs) const {
+  if (size_ != rhs.size_ || has_zero_digest_ != rhs.has_zero_digest_) {
+    return false;
+  }
+  for (const Digest& digest : rhs.slots_) {
+    if (!isZero(digest) && !contains(digest)) {
+      return false;
+    }
+  }
+  return true;
+}
+
+bool AllowedPrincipals::contains(const Digest& digest) const {
+  if (isZero(digest)) {
+    return has_zero_digest_;
+  }
+  return !slots_.empty() && !isZero(slots_[find(digest)]);
+}
+
+size_t AllowedPrincipals::find(const Digest& digest) const {
+  // Fold the digest in to one word and mix it with the splitmix64 finalizer, rather than trust
+  // the digests from the auth API to be well distributed.
+  uint64_t hash = 0;
+  for (size_t i = 0; i < digest.size(); i += sizeof(uint64_t)) {
+    uint64_t word;
+    memcpy(&word, digest.data() + i, sizeof(word));
+    hash ^= word;
+  }
+  hash = (hash ^ (hash >> 30)) * 0xbf58476d1ce4e5b9;
+  hash = (hash ^ (hash >> 27)) * 0x94d049bb133111eb;
+  hash ^= hash >> 31;
+  const size_t mask = slots_.size() - 1;
+  for (size_t i = hash & mask;; i = (i + 1) & mask) {
+    if (slots_[i] == digest || isZero(slots_[i])) {
+      return i;
+    }
+  }
+}
+
+void AllowedPrincipals::rehash(size_t capacity) {
+  std::vector<Digest> old_slots(capacity);
+  slots_.swap(old_slots);
+  for (const Digest& digest : old_slots) {
+    if (!isZero(digest)) {
+      slots_[find(digest)] = digest;
+    }
+  }
+}
+
 Config::Config(const envoy::api::v2::filter::network::ClientSSLAuth& config,
                ThreadLocal::SlotAllocator& tls, Upstream::ClusterManager& cm,
                Event::Dispatcher& dispatcher, Stats::Scope& scope, Runtime::RandomGenerator& random)
@@ -34,7 +158,8 @@ Config::Config(const envoy::api::v2::filter::network::ClientSSLAuth& config,
         fmt::format("unknown cluster '{}' in client ssl auth config", remote_cluster_name_));
   }
 
-  AllowedPrincipalsSharedPtr empty(new AllowedPrincipals());
+  principals_.reset(new AllowedPrincipals());
+  AllowedPrincipalsSharedPtr empty = principals_;
   tls_->set(
       [empty](Event::Dispatcher&) -> ThreadLocal::ThreadLocalObjectSharedPtr { return empty; });
 }
@@ -60,13 +185,19 @@ GlobalStats Config::generateStats(Stats::Scope& scope, const std::string& prefix
 void Config::parseResponse(const Http::Message& message) {
   AllowedPrincipalsSharedPtr new_principals(new AllowedPrincipals());
   Json::ObjectSharedPtr loader = Json::Factory::loadFromString(message.bodyAsString());
-  for (const Json::ObjectSharedPtr& certificate : loader->getObjectArray("certificates")) {
+  const std::vector<Json::ObjectSharedPtr> certificates = loader->getObjectArray("certificates");
+  new_principals->reserve(certificates.size());
+  for (const Json::ObjectSharedPtr& certificate : certificates) {
     new_principals->add(certificate->getString("fingerprint_sha256"));
   }
 
-  tls_->set([new_principals](Event::Dispatcher&) -> ThreadLocal::ThreadLocalObjectSharedPtr {
-    return new_principals;
-  });
+  // Most refreshes return the same principals. Only post a new set to the workers when it changed.
+  if (*new_principals != *principals_) {
+    principals_ = new_principals;
+    tls_->set([new_principals](Event::Dispatcher&) -> ThreadLocal::ThreadLocalObjectSharedPtr {
+      return new_principals;
+    });
+  }
 
   stats_.update_success_.inc();
   stats_.total_principals_.set(new_principals->size());
@@ -1,9 +1,10 @@
 #pragma once
 
+#include <array>
 #include <cstdint>
 #include <memory>
 #include <string>
-#include <unordered_set>
+#include <vector>
 
 #include "envoy/network/filter.h"
 #include "envoy/runtime/runtime.h"
@@ -45,22 +46,43 @@ struct GlobalStats {
 };
 
 /**
- * Wraps the principals currently allowed to authenticate.
+ * Wraps the principals currently allowed to authenticate. Digests are kept as raw bytes in an open
+ * addressing hash table, so that neither adding nor looking one up hashes a hex string.
  */
 class AllowedPrincipals : public ThreadLocal::ThreadLocalObject {
 public:
-  void add(const std::string& sha256_digest) {
-    if (!sha256_digest.empty()) {
-      allowed_sha256_digests_.emplace(sha256_digest);
-    }
-  }
-  bool allowed(const std::string& sha256_digest) const {
-    return allowed_sha256_digests_.count(sha256_digest) != 0;
-  }
-  size_t size() const { return allowed_sha256_digests_.size(); }
+  typedef std::array<uint8_t, 32> Digest;
+
+  /**
+   * Adds a hex encoded SHA-256 digest. Anything that is not a valid digest is ignored.
+   */
+  void add(const std::string& sha256_digest);
+
+  /**
+   * Sizes the table for the given number of digests, so that adding them does not rehash.
+   */
+  void reserve(size_t count);
+
+  /**
+   * @return whether the given hex encoded SHA-256 digest has been added.
+   */
+  bool allowed(const std::string& sha256_digest) const;
+
+  size_t size() const { return size_; }
+
+  bool operator==(const AllowedPrincipals& rhs) const;
+  bool operator!=(const AllowedPrincipals& rhs) const { return !(*this == rhs); }
 
 private:
-  std::unordered_set<std::string> allowed_sha256_digests_;
+  bool contains(const Digest& digest) const;
+  // @return the index of the slot holding the digest, or of the empty slot it would go in.
+  size_t find(const Digest& digest) const;
+  void rehash(size_t capacity);
+
+  // An all zero digest marks an empty slot, so that digest is tracked on its own.
+  std::vector<Digest> slots_;
+  bool has_zero_digest_{};
+  size_t size_{};
 };
 
 typedef std::shared_ptr<AllowedPrincipals> AllowedPrincipalsSharedPtr;
@@ -98,6 +120,8 @@ private:
   void onFetchFailure(const EnvoyException* e) override;
 
   ThreadLocal::SlotPtr tls_;
+  // The principals last posted to the workers. Only used on the main thread.
+  AllowedPrincipalsSharedPtr principals_;
   Network::Address::IpList ip_white_list_;
   GlobalStats stats_;
 };
@@ -46,9 +46,12 @@ TcpProxyConfig::SharedConfig::SharedConfig(const envoy::api::v2::filter::network
   }
 }
 
+const std::string TcpProxyConfig::SpliceEnabledKey = "tcp_proxy.splice_enabled";
+
 TcpProxyConfig::TcpProxyConfig(const envoy::api::v2::filter::network::TcpProxy& config,
                                Server::Configuration::FactoryContext& context)
     : max_connect_attempts_(PROTOBUF_GET_WRAPPED_OR_DEFAULT(config, max_connect_attempts, 1)),
+      runtime_(context.runtime()),
       upstream_drain_manager_slot_(context.threadLocal().allocateSlot()),
       shared_config_(std::make_shared<SharedConfig>(config, context)) {
 
@@ -338,15 +341,19 @@ Network::FilterStatus TcpProxy::initializeUpstreamConnection() {
        read_callbacks_->upstreamHost()->cluster().stats().upstream_cx_tx_bytes_total_,
        read_callbacks_->upstreamHost()->cluster().stats().upstream_cx_tx_bytes_buffered_,
        &read_callbacks_->upstreamHost()->cluster().stats().bind_errors_});
-  upstream_connection_->connect();
+  if (!conn_info.preconnected_) {
+    upstream_connection_->connect();
+  }
   upstream_connection_->noDelay(true);
   request_info_.onUpstreamHostSelected(conn_info.host_description_);
   request_info_.upstream_local_address_ = upstream_connection_->localAddress();
 
-  ASSERT(connect_timeout_timer_ == nullptr);
-  connect_timeout_timer_ = read_callbacks_->connection().dispatcher().createTimer(
-      [this]() -> void { onConnectTimeout(); });
-  connect_timeout_timer_->enableTimer(cluster->connectTimeout());
+  if (!conn_info.preconnected_) {
+    ASSERT(connect_timeout_timer_ == nullptr);
+    connect_timeout_timer_ = read_callbacks_->connection().dispatcher().createTimer(
+        [this]() -> void { onConnectTimeout(); });
+    connect_timeout_timer_->enableTimer(cluster->connectTimeout());
+  }
 
   read_callbacks_->upstreamHost()->cluster().stats().upstream_cx_total_.inc();
   read_callbacks_->upstreamHost()->cluster().stats().upstream_cx_active_.inc();
@@ -357,6 +364,12 @@ Network::FilterStatus TcpProxy::initializeUpstreamConnection() {
   connected_timespan_.reset(new Stats::Timespan(
       read_callbacks_->upstreamHost()->cluster().stats().upstream_cx_length_ms_));
 
+  // A preconnected connection was established before it was handed out, so there is no connected
+  // event to wait for.
+  if (conn_info.preconnected_) {
+    onUpstreamEvent(Network::ConnectionEvent::Connected);
+  }
+
   return Network::FilterStatus::Continue;
 }
 
@@ -456,17 +469,35 @@ void TcpProxy::onUpstreamEvent(Network::ConnectionEvent event) {
       // The idle_timer_ can be moved to a TcpProxyDrainer, so related callbacks call into
       // the UpstreamCallbacks, which has the same lifetime as the timer, and can dispatch
       // the call to either TcpProxy or to TcpProxyDrainer, depending on the current state.
-      idle_timer_ =
-          read_callbacks_->connection().dispatcher().createTimer([upstream_callbacks =
-                                                                      upstream_callbacks_]() {
-            upstream_callbacks->onIdleTimeout();
-          });
+      // The timer is reset on every read and write, which is cheap for a coarse timer.
+      idle_timer_ = read_callbacks_->connection().dispatcher().createCoarseTimer(
+          [upstream_callbacks = upstream_callbacks_]() { upstream_callbacks->onIdleTimeout(); });
       resetIdleTimer();
       read_callbacks_->connection().addBytesSentCallback([this](uint64_t) { resetIdleTimer(); });
       upstream_connection_->addBytesSentCallback([upstream_callbacks = upstream_callbacks_](
           uint64_t) { upstream_callbacks->onBytesSent(); });
     }
+
+    // With nothing else to see the bytes, the kernel can move them between the sockets without
+    // them ever being copied into buffers. Connections that can't be spliced, because of TLS or
+    // other filters, keep proxying through onData() and onUpstreamData().
+    if (config_ != nullptr && config_->spliceEnabled() &&
+        read_callbacks_->connection().startSplice(
+            *upstream_connection_, [this](Network::Connection& from, uint64_t bytes) {
+              onSplicedData(from, bytes);
+            })) {
+      config_->stats().downstream_cx_splice_total_.inc();
+    }
+  }
+}
+
+void TcpProxy::onSplicedData(Network::Connection& from, uint64_t bytes) {
+  if (&from == &read_callbacks_->connection()) {
+    request_info_.bytes_received_ += bytes;
+  } else {
+    request_info_.bytes_sent_ += bytes;
   }
+  resetIdleTimer();
 }
 
 void TcpProxy::onIdleTimeout() {
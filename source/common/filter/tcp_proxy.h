@@ -10,6 +10,7 @@
 #include "envoy/event/timer.h"
 #include "envoy/network/connection.h"
 #include "envoy/network/filter.h"
+#include "envoy/runtime/runtime.h"
 #include "envoy/server/filter_config.h"
 #include "envoy/stats/stats_macros.h"
 #include "envoy/stats/timespan.h"
@@ -38,6 +39,7 @@ namespace Filter {
   GAUGE  (downstream_cx_tx_bytes_buffered)                                                         \
   COUNTER(downstream_cx_total)                                                                     \
   COUNTER(downstream_cx_no_route)                                                                  \
+  COUNTER(downstream_cx_splice_total)                                                              \
   COUNTER(downstream_flow_control_paused_reading_total)                                            \
   COUNTER(downstream_flow_control_resumed_reading_total)                                           \
   COUNTER(idle_timeout)                                                                            \
@@ -106,6 +108,12 @@ public:
   TcpProxyUpstreamDrainManager& drainManager();
   SharedConfigSharedPtr sharedConfig() { return shared_config_; }
 
+  /**
+   * @return whether data should be forwarded between plaintext connections with splice(2) rather
+   *         than through the filters. Opted into with the tcp_proxy.splice_enabled runtime key.
+   */
+  bool spliceEnabled() const { return runtime_.snapshot().featureEnabled(SpliceEnabledKey, 0); }
+
 private:
   struct Route {
     Route(const envoy::api::v2::filter::network::TcpProxy::DeprecatedV1::TCPRoute& config);
@@ -117,9 +125,12 @@ private:
     std::string cluster_name_;
   };
 
+  static const std::string SpliceEnabledKey;
+
   std::vector<Route> routes_;
   std::vector<AccessLog::InstanceSharedPtr> access_logs_;
   const uint32_t max_connect_attempts_;
+  Runtime::Loader& runtime_;
   ThreadLocal::SlotPtr upstream_drain_manager_slot_;
   SharedConfigSharedPtr shared_config_;
 };
@@ -220,6 +231,7 @@ protected:
   void onDownstreamEvent(Network::ConnectionEvent event);
   void onUpstreamData(Buffer::Instance& data);
   void onUpstreamEvent(Network::ConnectionEvent event);
+  void onSplicedData(Network::Connection& from, uint64_t bytes);
   void finalizeUpstreamConnectionStats();
   void closeUpstreamConnection();
   void onIdleTimeout();
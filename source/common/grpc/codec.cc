@@ -1,5 +1,6 @@
 #include "common/grpc/codec.h"
 
+#include <algorithm>
 #include <array>
 #include <cstdint>
 #include <vector>
@@ -19,80 +20,49 @@ void Encoder::newFrame(uint8_t flags, uint64_t length, std::array<uint8_t, 5>& o
   output[4] = static_cast<uint8_t>(length);
 }
 
-Decoder::Decoder() : state_(State::FH_FLAG) {}
+Decoder::Decoder() : state_(State::FH), header_length_(0) {}
 
 bool Decoder::decode(Buffer::Instance& input, std::vector<Frame>& output) {
-  uint64_t count = input.getRawSlices(nullptr, 0);
-  Buffer::RawSlice slices[count];
-  input.getRawSlices(slices, count);
-  for (Buffer::RawSlice& slice : slices) {
-    uint8_t* mem = reinterpret_cast<uint8_t*>(slice.mem_);
-    for (uint64_t j = 0; j < slice.len_;) {
-      uint8_t c = *mem;
-      switch (state_) {
-      case State::FH_FLAG:
-        if (c & ~GRPC_FH_COMPRESSED) {
-          // Unsupported flags.
-          return false;
-        }
-        frame_.flags_ = c;
-        state_ = State::FH_LEN_0;
-        mem++;
-        j++;
-        break;
-      case State::FH_LEN_0:
-        frame_.length_ = static_cast<uint32_t>(c) << 24;
-        state_ = State::FH_LEN_1;
-        mem++;
-        j++;
-        break;
-      case State::FH_LEN_1:
-        frame_.length_ |= static_cast<uint32_t>(c) << 16;
-        state_ = State::FH_LEN_2;
-        mem++;
-        j++;
-        break;
-      case State::FH_LEN_2:
-        frame_.length_ |= static_cast<uint32_t>(c) << 8;
-        state_ = State::FH_LEN_3;
-        mem++;
-        j++;
-        break;
-      case State::FH_LEN_3:
-        frame_.length_ |= static_cast<uint32_t>(c);
-        if (frame_.length_ == 0) {
-          output.push_back(std::move(frame_));
-          state_ = State::FH_FLAG;
-        } else {
-          frame_.data_.reset(new Buffer::OwnedImpl());
-          state_ = State::DATA;
-        }
-        mem++;
-        j++;
-        break;
-      case State::DATA:
-        uint64_t remain_in_buffer = slice.len_ - j;
-        uint64_t remain_in_frame = frame_.length_ - frame_.data_->length();
-        if (remain_in_buffer <= remain_in_frame) {
-          frame_.data_->add(mem, remain_in_buffer);
-          mem += remain_in_buffer;
-          j += remain_in_buffer;
-        } else {
-          frame_.data_->add(mem, remain_in_frame);
-          mem += remain_in_frame;
-          j += remain_in_frame;
-        }
-        if (frame_.length_ == frame_.data_->length()) {
-          output.push_back(std::move(frame_));
-          frame_.flags_ = 0;
-          frame_.length_ = 0;
-          state_ = State::FH_FLAG;
-        }
+  while (input.length() > 0) {
+    if (state_ == State::FH) {
+      // Peek at as much of the header as is available, and only consume it once the flags are
+      // known to be valid, so that the input is left unchanged on error.
+      const uint32_t size = std::min<uint64_t>(header_.size() - header_length_, input.length());
+      input.copyOut(0, size, header_.data() + header_length_);
+      if (header_length_ == 0 && (header_[0] & ~GRPC_FH_COMPRESSED)) {
+        // Unsupported flags.
+        return false;
+      }
+      input.drain(size);
+      header_length_ += size;
+      if (header_length_ < header_.size()) {
         break;
       }
+
+      frame_.flags_ = header_[0];
+      frame_.length_ = static_cast<uint32_t>(header_[1]) << 24 |
+                       static_cast<uint32_t>(header_[2]) << 16 |
+                       static_cast<uint32_t>(header_[3]) << 8 | static_cast<uint32_t>(header_[4]);
+      header_length_ = 0;
+      if (frame_.length_ == 0) {
+        output.push_back(std::move(frame_));
+        frame_.flags_ = 0;
+        continue;
+      }
+      frame_.data_.reset(new Buffer::OwnedImpl());
+      state_ = State::DATA;
+    }
+
+    // Move as much of the data as belongs to the frame, without copying whole slices.
+    const uint64_t remain_in_frame = frame_.length_ - frame_.data_->length();
+    frame_.data_->move(input, std::min(remain_in_frame, input.length()));
+    if (frame_.length_ == frame_.data_->length()) {
+      output.push_back(std::move(frame_));
+      frame_.flags_ = 0;
+      frame_.length_ = 0;
+      state_ = State::FH;
     }
   }
-  input.drain(input.length());
   return true;
 }
 
@@ -39,7 +39,7 @@ public:
   // Decodes the given buffer with GRPC data frame. Drains the input buffer when
   // decoding succeeded (returns true). If the input is not sufficient to make a
   // complete GRPC data frame, it will be buffered in the decoder. If a decoding
-  // error happened, the input buffer remains unchanged.
+  // error happened, the input buffer remains unchanged from the invalid frame on.
   // @param input supplies the binary octets wrapped in a GRPC data frame.
   // @param output supplies the buffer to store the decoded data.
   // @return bool whether the decoding succeeded or not.
@@ -65,26 +65,17 @@ private:
   // "R" bits are reserved for future use.
   // The next four "L" bytes represent the message length in BigEndian format.
   enum class State {
-    // Waiting for decoding the flags (1 byte) of the GRPC data frame.
-    FH_FLAG,
-    // Waiting for decoding the 1st byte of the length (4 bytes in total) of the
-    // GRPC data frame.
-    FH_LEN_0,
-    // Waiting for decoding the 2nd byte of the length (4 bytes in total) of the
-    // GRPC data frame.
-    FH_LEN_1,
-    // Waiting for decoding the 3rd byte of the length (4 bytes in total) of the
-    // GRPC data frame.
-    FH_LEN_2,
-    // Waiting for decoding the 4th byte of the length (4 bytes in total) of the
-    // GRPC data frame.
-    FH_LEN_3,
-    // Waiting for decoding the data.
+    // Waiting for the rest of the fixed header, which may arrive over several calls to decode().
+    FH,
+    // Waiting for the rest of the data.
     DATA,
   };
 
   State state_;
   Frame frame_;
+  // The bytes of the fixed header received so far.
+  std::array<uint8_t, 5> header_;
+  uint32_t header_length_;
 };
 } // namespace Grpc
 } // namespace Envoy
@@ -99,6 +99,7 @@ JsonTranscoderConfig::JsonTranscoderConfig(
   }
 
   PathMatcherBuilder<const Protobuf::MethodDescriptor*> pmb;
+  std::vector<const Protobuf::MethodDescriptor*> methods;
 
   for (const auto& service_name : proto_config.services()) {
     auto service = descriptor_pool_.FindServiceByName(service_name);
@@ -113,6 +114,7 @@ JsonTranscoderConfig::JsonTranscoderConfig(
         throw EnvoyException("transcoding_filter: Cannot register '" + method->full_name() +
                              "' to path matcher");
       }
+      methods.push_back(method);
     }
   }
 
@@ -122,6 +124,13 @@ JsonTranscoderConfig::JsonTranscoderConfig(
       new google::grpc::transcoding::TypeHelper(Protobuf::util::NewTypeResolverForDescriptorPool(
           Common::typeUrlPrefix(), &descriptor_pool_)));
 
+  for (const Protobuf::MethodDescriptor* method : methods) {
+    MethodInfo& info = method_info_[method];
+    info.request_type_ = type_helper_->Info()->GetTypeByTypeUrl(
+        Common::typeUrl(method->input_type()->full_name()));
+    info.response_type_url_ = Common::typeUrl(method->output_type()->full_name());
+  }
+
   const auto print_config = proto_config.print_options();
   print_options_.add_whitespace = print_config.add_whitespace();
   print_options_.always_print_primitive_fields = print_config.always_print_primitive_fields();
@@ -173,10 +182,9 @@ ProtobufUtil::Status JsonTranscoderConfig::createTranscoder(
       new JsonRequestTranslator(type_helper_->Resolver(), &request_input, request_info,
                                 method_descriptor->client_streaming(), true)};
 
-  const auto response_type_url = Common::typeUrl(method_descriptor->output_type()->full_name());
   std::unique_ptr<ResponseToJsonTranslator> response_translator{new ResponseToJsonTranslator(
-      type_helper_->Resolver(), response_type_url, method_descriptor->server_streaming(),
-      &response_input, print_options_)};
+      type_helper_->Resolver(), method_info_.at(method_descriptor).response_type_url_,
+      method_descriptor->server_streaming(), &response_input, print_options_)};
 
   transcoder.reset(
       new TranscoderImpl(std::move(request_translator), std::move(response_translator)));
@@ -186,8 +194,7 @@ ProtobufUtil::Status JsonTranscoderConfig::createTranscoder(
 ProtobufUtil::Status
 JsonTranscoderConfig::methodToRequestInfo(const Protobuf::MethodDescriptor* method,
                                           google::grpc::transcoding::RequestInfo* info) {
-  auto request_type_url = Common::typeUrl(method->input_type()->full_name());
-  info->message_type = type_helper_->Info()->GetTypeByTypeUrl(request_type_url);
+  info->message_type = method_info_.at(method).request_type_;
   if (info->message_type == nullptr) {
     ENVOY_LOG(debug, "Cannot resolve input-type: {}", method->input_type()->full_name());
     return ProtobufUtil::Status(Code::NOT_FOUND,
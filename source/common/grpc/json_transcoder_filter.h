@@ -1,5 +1,7 @@
 #pragma once
 
+#include <unordered_map>
+
 #include "envoy/buffer/buffer.h"
 #include "envoy/http/filter.h"
 #include "envoy/http/header_map.h"
@@ -62,6 +64,15 @@ public:
                    const Protobuf::MethodDescriptor*& method_descriptor);
 
 private:
+  /**
+   * The types of a method, resolved when the config loads rather than for each request.
+   */
+  struct MethodInfo {
+    // nullptr if the request type could not be resolved.
+    const ProtobufWkt::Type* request_type_{};
+    ProtobufTypes::String response_type_url_;
+  };
+
   /**
    * Convert method descriptor to RequestInfo that needed for transcoding library
    */
@@ -70,6 +81,7 @@ private:
 
 private:
   Protobuf::DescriptorPool descriptor_pool_;
+  std::unordered_map<const Protobuf::MethodDescriptor*, MethodInfo> method_info_;
   google::grpc::transcoding::PathMatcherPtr<const Protobuf::MethodDescriptor*> path_matcher_;
   std::unique_ptr<google::grpc::transcoding::TypeHelper> type_helper_;
   Protobuf::util::JsonPrintOptions print_options_;
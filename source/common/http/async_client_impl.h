@@ -20,6 +20,8 @@
 #include "envoy/ssl/connection.h"
 #include "envoy/tracing/http_tracer.h"
 
+#include "common/common/arena_impl.h"
+#include "common/common/assert.h"
 #include "common/common/empty_string.h"
 #include "common/common/linked_object.h"
 #include "common/http/message_impl.h"
@@ -78,6 +80,7 @@ public:
   void sendData(Buffer::Instance& data, bool end_stream) override;
   void sendTrailers(HeaderMap& trailers) override;
   void reset() override;
+  bool isAboveWriteBufferHighWatermark() const override { return high_watermark_count_ > 0; }
 
 protected:
   bool remoteClosed() { return remote_closed_; }
@@ -88,6 +91,7 @@ private:
   struct NullCorsPolicy : public Router::CorsPolicy {
     // Router::CorsPolicy
     const std::list<std::string>& allowOrigins() const override { return allow_origin_; };
+    bool allowsOrigin(const HeaderString&) const override { return false; }
     const std::string& allowMethods() const override { return EMPTY_STRING; };
     const std::string& allowHeaders() const override { return EMPTY_STRING; };
     const std::string& exposeHeaders() const override { return EMPTY_STRING; };
@@ -118,12 +122,15 @@ private:
     }
     uint32_t numRetries() const override { return 0; }
     uint32_t retryOn() const override { return 0; }
+    const Router::HedgePolicy* hedgePolicy() const override { return nullptr; }
+    uint64_t maxReplayBytes() const override { return UINT64_MAX; }
   };
 
   struct NullShadowPolicy : public Router::ShadowPolicy {
     // Router::ShadowPolicy
     const std::string& cluster() const override { return EMPTY_STRING; }
     const std::string& runtimeKey() const override { return EMPTY_STRING; }
+    uint64_t maxBodyBytes() const override { return 0; }
   };
 
   struct NullVirtualHost : public Router::VirtualHost {
@@ -142,6 +149,7 @@ private:
 
     // Router::RouteEntry
     const std::string& clusterName() const override { return cluster_name_; }
+    const Upstream::ClusterHandle* clusterHandle() const override { return nullptr; }
     Http::Code clusterNotFoundResponseCode() const override {
       return Http::Code::InternalServerError;
     }
@@ -212,14 +220,18 @@ private:
   RequestInfo::RequestInfo& requestInfo() override { return request_info_; }
   Tracing::Span& activeSpan() override { return active_span_; }
   const Tracing::Config& tracingConfig() override { return tracing_config_; }
+  Arena& arena() override { return arena_; }
   void continueDecoding() override { NOT_IMPLEMENTED; }
   void addDecodedData(Buffer::Instance&, bool) override { NOT_IMPLEMENTED; }
   const Buffer::Instance* decodingBuffer() override { return buffered_body_.get(); }
   void encodeHeaders(HeaderMapPtr&& headers, bool end_stream) override;
   void encodeData(Buffer::Instance& data, bool end_stream) override;
   void encodeTrailers(HeaderMapPtr&& trailers) override;
-  void onDecoderFilterAboveWriteBufferHighWatermark() override {}
-  void onDecoderFilterBelowWriteBufferLowWatermark() override {}
+  void onDecoderFilterAboveWriteBufferHighWatermark() override { high_watermark_count_++; }
+  void onDecoderFilterBelowWriteBufferLowWatermark() override {
+    ASSERT(high_watermark_count_ > 0);
+    high_watermark_count_--;
+  }
   void addDownstreamWatermarkCallbacks(DownstreamWatermarkCallbacks&) override {}
   void removeDownstreamWatermarkCallbacks(DownstreamWatermarkCallbacks&) override {}
   void setDecoderBufferLimit(uint32_t) override {}
@@ -227,6 +239,8 @@ private:
 
   AsyncClient::StreamCallbacks& stream_callbacks_;
   const uint64_t stream_id_;
+  // Declared before the router so that it outlives it.
+  ArenaImpl arena_;
   Router::ProdFilter router_;
   RequestInfo::RequestInfoImpl request_info_;
   Tracing::NullSpan active_span_;
@@ -234,6 +248,8 @@ private:
   std::shared_ptr<RouteImpl> route_;
   bool local_closed_{};
   bool remote_closed_{};
+  // The router signals each upstream buffer that goes above its high watermark separately.
+  uint32_t high_watermark_count_{};
   Buffer::InstancePtr buffered_body_;
   friend class AsyncClientImpl;
 };
@@ -125,7 +125,8 @@ CodecClientProd::CodecClientProd(Type type, Network::ClientConnectionPtr&& conne
     : CodecClient(type, std::move(connection), host) {
   switch (type) {
   case Type::HTTP1: {
-    codec_.reset(new Http1::ClientConnectionImpl(*connection_, *this));
+    codec_.reset(
+        new Http1::ClientConnectionImpl(*connection_, *this, host->cluster().http1Settings()));
     break;
   }
   case Type::HTTP2: {
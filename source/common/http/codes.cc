@@ -1,11 +1,15 @@
 #include "common/http/codes.h"
 
+#include <array>
+#include <atomic>
+#include <chrono>
 #include <cstdint>
 #include <string>
 
 #include "envoy/http/header_map.h"
 #include "envoy/stats/stats.h"
 
+#include "common/common/assert.h"
 #include "common/common/enum_to_int.h"
 #include "common/common/utility.h"
 #include "common/http/headers.h"
@@ -26,33 +30,41 @@ void CodeUtility::chargeBasicResponseStat(Stats::Scope& scope, const std::string
 
 void CodeUtility::chargeResponseStat(const ResponseStatInfo& info) {
   const uint64_t response_code = info.response_status_code_;
-  chargeBasicResponseStat(info.cluster_scope_, info.prefix_, static_cast<Code>(response_code));
-
   std::string group_string = groupStringForResponseCode(static_cast<Code>(response_code));
 
-  // If the response is from a canary, also create canary stats.
-  if (info.upstream_canary_) {
-    info.cluster_scope_.counter(fmt::format("{}canary.upstream_rq_{}", info.prefix_, group_string))
-        .inc();
-    info.cluster_scope_.counter(fmt::format("{}canary.upstream_rq_{}", info.prefix_, response_code))
-        .inc();
-  }
-
-  // Split stats into external vs. internal.
-  if (info.internal_request_) {
-    info.cluster_scope_
-        .counter(fmt::format("{}internal.upstream_rq_{}", info.prefix_, group_string))
-        .inc();
-    info.cluster_scope_
-        .counter(fmt::format("{}internal.upstream_rq_{}", info.prefix_, response_code))
-        .inc();
+  if (info.cluster_code_stats_ != nullptr) {
+    ASSERT(info.prefix_.empty());
+    info.cluster_code_stats_->chargeResponseStat(response_code, info.upstream_canary_,
+                                                 info.internal_request_);
   } else {
-    info.cluster_scope_
-        .counter(fmt::format("{}external.upstream_rq_{}", info.prefix_, group_string))
-        .inc();
-    info.cluster_scope_
-        .counter(fmt::format("{}external.upstream_rq_{}", info.prefix_, response_code))
-        .inc();
+    chargeBasicResponseStat(info.cluster_scope_, info.prefix_, static_cast<Code>(response_code));
+
+    // If the response is from a canary, also create canary stats.
+    if (info.upstream_canary_) {
+      info.cluster_scope_
+          .counter(fmt::format("{}canary.upstream_rq_{}", info.prefix_, group_string))
+          .inc();
+      info.cluster_scope_
+          .counter(fmt::format("{}canary.upstream_rq_{}", info.prefix_, response_code))
+          .inc();
+    }
+
+    // Split stats into external vs. internal.
+    if (info.internal_request_) {
+      info.cluster_scope_
+          .counter(fmt::format("{}internal.upstream_rq_{}", info.prefix_, group_string))
+          .inc();
+      info.cluster_scope_
+          .counter(fmt::format("{}internal.upstream_rq_{}", info.prefix_, response_code))
+          .inc();
+    } else {
+      info.cluster_scope_
+          .counter(fmt::format("{}external.upstream_rq_{}", info.prefix_, group_string))
+          .inc();
+      info.cluster_scope_
+          .counter(fmt::format("{}external.upstream_rq_{}", info.prefix_, response_code))
+          .inc();
+    }
   }
 
   // Handle request virtual cluster.
@@ -81,19 +93,25 @@ void CodeUtility::chargeResponseStat(const ResponseStatInfo& info) {
 }
 
 void CodeUtility::chargeResponseTiming(const ResponseTimingInfo& info) {
-  info.cluster_scope_.histogram(info.prefix_ + "upstream_rq_time")
-      .recordValue(info.response_time_.count());
-  if (info.upstream_canary_) {
-    info.cluster_scope_.histogram(info.prefix_ + "canary.upstream_rq_time")
-        .recordValue(info.response_time_.count());
-  }
-
-  if (info.internal_request_) {
-    info.cluster_scope_.histogram(info.prefix_ + "internal.upstream_rq_time")
-        .recordValue(info.response_time_.count());
+  if (info.cluster_code_stats_ != nullptr) {
+    ASSERT(info.prefix_.empty());
+    info.cluster_code_stats_->chargeResponseTiming(info.response_time_, info.upstream_canary_,
+                                                   info.internal_request_);
   } else {
-    info.cluster_scope_.histogram(info.prefix_ + "external.upstream_rq_time")
+    info.cluster_scope_.histogram(info.prefix_ + "upstream_rq_time")
         .recordValue(info.response_time_.count());
+    if (info.upstream_canary_) {
+      info.cluster_scope_.histogram(info.prefix_ + "canary.upstream_rq_time")
+          .recordValue(info.response_time_.count());
+    }
+
+    if (info.internal_request_) {
+      info.cluster_scope_.histogram(info.prefix_ + "internal.upstream_rq_time")
+          .recordValue(info.response_time_.count());
+    } else {
+      info.cluster_scope_.histogram(info.prefix_ + "external.upstream_rq_time")
+          .recordValue(info.response_time_.count());
+    }
   }
 
   if (!info.request_vcluster_name_.empty()) {
@@ -112,6 +130,164 @@ void CodeUtility::chargeResponseTiming(const ResponseTimingInfo& info) {
   }
 }
 
+namespace {
+
+const Code KNOWN_CODES[] = {
+    Code::Continue,
+    Code::OK,
+    Code::Created,
+    Code::Accepted,
+    Code::NonAuthoritativeInformation,
+    Code::NoContent,
+    Code::ResetContent,
+    Code::PartialContent,
+    Code::MultiStatus,
+    Code::AlreadyReported,
+    Code::IMUsed,
+    Code::MultipleChoices,
+    Code::MovedPermanently,
+    Code::Found,
+    Code::SeeOther,
+    Code::NotModified,
+    Code::UseProxy,
+    Code::TemporaryRedirect,
+    Code::PermanentRedirect,
+    Code::BadRequest,
+    Code::Unauthorized,
+    Code::PaymentRequired,
+    Code::Forbidden,
+    Code::NotFound,
+    Code::MethodNotAllowed,
+    Code::NotAcceptable,
+    Code::ProxyAuthenticationRequired,
+    Code::RequestTimeout,
+    Code::Conflict,
+    Code::Gone,
+    Code::LengthRequired,
+    Code::PreconditionFailed,
+    Code::PayloadTooLarge,
+    Code::URITooLong,
+    Code::UnsupportedMediaType,
+    Code::RangeNotSatisfiable,
+    Code::ExpectationFailed,
+    Code::MisdirectedRequest,
+    Code::UnprocessableEntity,
+    Code::Locked,
+    Code::FailedDependency,
+    Code::UpgradeRequired,
+    Code::PreconditionRequired,
+    Code::TooManyRequests,
+    Code::RequestHeaderFieldsTooLarge,
+    Code::InternalServerError,
+    Code::NotImplemented,
+    Code::BadGateway,
+    Code::ServiceUnavailable,
+    Code::GatewayTimeout,
+    Code::HTTPVersionNotSupported,
+    Code::VariantAlsoNegotiates,
+    Code::InsufficientStorage,
+    Code::LoopDetected,
+    Code::NotExtended,
+    Code::NetworkAuthenticationRequired,
+};
+
+static_assert(sizeof(KNOWN_CODES) / sizeof(KNOWN_CODES[0]) == CodeStatsImpl::NUM_CODES,
+              "KNOWN_CODES must list every code of Http::Code");
+
+const uint64_t MAX_CODE = 600;
+const uint8_t UNKNOWN_CODE_INDEX = UINT8_MAX;
+
+/**
+ * @return the index of each code below MAX_CODE in KNOWN_CODES, UNKNOWN_CODE_INDEX if it is not
+ *         there.
+ */
+const std::array<uint8_t, MAX_CODE>& codeIndexes() {
+  static const std::array<uint8_t, MAX_CODE>* indexes = [] {
+    auto* indexes = new std::array<uint8_t, MAX_CODE>();
+    indexes->fill(UNKNOWN_CODE_INDEX);
+    for (size_t i = 0; i < CodeStatsImpl::NUM_CODES; i++) {
+      (*indexes)[enumToInt(KNOWN_CODES[i])] = i;
+    }
+    return indexes;
+  }();
+  return *indexes;
+}
+
+/**
+ * @return the stat of a slot, which is made and stored in the slot if it is still empty.
+ */
+template <class Stat, class MakeStat> Stat& boundStat(std::atomic<Stat*>& slot, MakeStat make) {
+  Stat* stat = slot.load(std::memory_order_acquire);
+  if (stat == nullptr) {
+    stat = &make();
+    slot.store(stat, std::memory_order_release);
+  }
+  return *stat;
+}
+
+} // namespace
+
+CodeStatsImpl::CodeStatsImpl(Stats::Scope& scope)
+    : upstream_rq_(scope, ""), canary_(scope, "canary."), internal_(scope, "internal."),
+      external_(scope, "external."), retry_(scope, "retry.") {}
+
+void CodeStatsImpl::chargeResponseStat(uint64_t response_status_code, bool upstream_canary,
+                                       bool internal_request) {
+  upstream_rq_.chargeResponseStat(response_status_code);
+  if (upstream_canary) {
+    canary_.chargeResponseStat(response_status_code);
+  }
+  if (internal_request) {
+    internal_.chargeResponseStat(response_status_code);
+  } else {
+    external_.chargeResponseStat(response_status_code);
+  }
+}
+
+void CodeStatsImpl::chargeRetryResponseStat(uint64_t response_status_code) {
+  retry_.chargeResponseStat(response_status_code);
+}
+
+void CodeStatsImpl::chargeResponseTiming(std::chrono::milliseconds response_time,
+                                         bool upstream_canary, bool internal_request) {
+  upstream_rq_.chargeResponseTiming(response_time);
+  if (upstream_canary) {
+    canary_.chargeResponseTiming(response_time);
+  }
+  if (internal_request) {
+    internal_.chargeResponseTiming(response_time);
+  } else {
+    external_.chargeResponseTiming(response_time);
+  }
+}
+
+void CodeStatsImpl::PrefixStats::chargeResponseStat(uint64_t response_status_code) {
+  const Code code = static_cast<Code>(response_status_code);
+  // 2xx to 5xx have slots 0 to 3, the other codes share the last one.
+  const size_t group = response_status_code >= 200 && response_status_code < 600
+                           ? response_status_code / 100 - 2
+                           : groups_.size() - 1;
+  boundStat(groups_[group], [this, code]() -> Stats::Counter& {
+    return scope_.counter(prefix_ + "upstream_rq_" + CodeUtility::groupStringForResponseCode(code));
+  }).inc();
+
+  const uint8_t index =
+      response_status_code < MAX_CODE ? codeIndexes()[response_status_code] : UNKNOWN_CODE_INDEX;
+  if (index == UNKNOWN_CODE_INDEX) {
+    scope_.counter(fmt::format("{}upstream_rq_{}", prefix_, response_status_code)).inc();
+  } else {
+    boundStat(codes_[index], [this, response_status_code]() -> Stats::Counter& {
+      return scope_.counter(fmt::format("{}upstream_rq_{}", prefix_, response_status_code));
+    }).inc();
+  }
+}
+
+void CodeStatsImpl::PrefixStats::chargeResponseTiming(std::chrono::milliseconds response_time) {
+  boundStat(upstream_rq_time_, [this]() -> Stats::Histogram& {
+    return scope_.histogram(prefix_ + "upstream_rq_time");
+  }).recordValue(response_time.count());
+}
+
 std::string CodeUtility::groupStringForResponseCode(Code response_code) {
   if (CodeUtility::is2xx(enumToInt(response_code))) {
     return "2xx";
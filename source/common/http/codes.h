@@ -1,5 +1,7 @@
 #pragma once
 
+#include <array>
+#include <atomic>
 #include <chrono>
 #include <cstdint>
 #include <string>
@@ -33,6 +35,9 @@ public:
     const std::string& from_zone_;
     const std::string& to_zone_;
     bool upstream_canary_;
+    // If set, charges the stats under the fixed prefixes of the cluster scope. Requires an empty
+    // prefix_.
+    CodeStats* cluster_code_stats_{};
   };
 
   /**
@@ -53,6 +58,8 @@ public:
     const std::string& request_vcluster_name_;
     const std::string& from_zone_;
     const std::string& to_zone_;
+    // See ResponseStatInfo.
+    CodeStats* cluster_code_stats_{};
   };
 
   /**
@@ -78,5 +85,55 @@ public:
   static std::string groupStringForResponseCode(Code response_code);
 };
 
+/**
+ * Implementation of CodeStats over a cluster scope. Like the stats charged by CodeUtility, each
+ * stat only exists once it is charged: it is looked up in the scope the first time, and kept for
+ * the following responses. The codes of Http::Code have counters of their own, other codes are
+ * looked up every time.
+ */
+class CodeStatsImpl : public CodeStats {
+public:
+  CodeStatsImpl(Stats::Scope& scope);
+
+  // Http::CodeStats
+  void chargeResponseStat(uint64_t response_status_code, bool upstream_canary,
+                          bool internal_request) override;
+  void chargeRetryResponseStat(uint64_t response_status_code) override;
+  void chargeResponseTiming(std::chrono::milliseconds response_time, bool upstream_canary,
+                            bool internal_request) override;
+
+  /**
+   * The number of codes of Http::Code.
+   */
+  static const size_t NUM_CODES = 56;
+
+private:
+  /**
+   * The stats under one prefix. Slots are filled by whichever thread charges the stat first,
+   * concurrent threads get the same stat from the scope.
+   */
+  class PrefixStats {
+  public:
+    PrefixStats(Stats::Scope& scope, const std::string& prefix) : scope_(scope), prefix_(prefix) {}
+
+    void chargeResponseStat(uint64_t response_status_code);
+    void chargeResponseTiming(std::chrono::milliseconds response_time);
+
+  private:
+    Stats::Scope& scope_;
+    const std::string prefix_;
+    // The counters of 2xx to 5xx, and of the other codes, which have no group string.
+    std::array<std::atomic<Stats::Counter*>, 5> groups_{};
+    std::array<std::atomic<Stats::Counter*>, NUM_CODES> codes_{};
+    std::atomic<Stats::Histogram*> upstream_rq_time_{};
+  };
+
+  PrefixStats upstream_rq_;
+  PrefixStats canary_;
+  PrefixStats internal_;
+  PrefixStats external_;
+  PrefixStats retry_;
+};
+
 } // namespace Http
 } // namespace Envoy
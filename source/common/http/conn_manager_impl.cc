@@ -16,8 +16,11 @@
 #include "envoy/tracing/http_tracer.h"
 
 #include "common/buffer/buffer_impl.h"
+#include "common/buffer/memory_account_impl.h"
 #include "common/common/assert.h"
+#include "common/common/empty_string.h"
 #include "common/common/enum_to_int.h"
+#include "common/common/thread_load.h"
 #include "common/common/utility.h"
 #include "common/http/codes.h"
 #include "common/http/conn_manager_utility.h"
@@ -34,6 +37,19 @@
 namespace Envoy {
 namespace Http {
 
+namespace {
+
+const Runtime::Key MAX_SAMPLED_PER_SECOND_KEY("tracing.max_sampled_per_second");
+
+// Charge the time since start, in microseconds, to the histogram of a timed filter callback.
+void chargeCallbackTime(MonotonicTime start, Stats::Histogram& histogram) {
+  histogram.recordValue(std::chrono::duration_cast<std::chrono::microseconds>(
+                            ProdMonotonicTimeSource::instance_.currentTime() - start)
+                            .count());
+}
+
+} // namespace
+
 ConnectionManagerStats ConnectionManagerImpl::generateStats(const std::string& prefix,
                                                             Stats::Scope& scope) {
   return {
@@ -58,12 +74,13 @@ ConnectionManagerImpl::ConnectionManagerImpl(ConnectionManagerConfig& config,
                                              Runtime::RandomGenerator& random_generator,
                                              Tracing::HttpTracer& tracer, Runtime::Loader& runtime,
                                              const LocalInfo::LocalInfo& local_info,
-                                             Upstream::ClusterManager& cluster_manager)
+                                             Upstream::ClusterManager& cluster_manager,
+                                             Server::OverloadManager* overload_manager)
     : config_(config), stats_(config_.stats()),
       conn_length_(new Stats::Timespan(stats_.named_.downstream_cx_length_ms_)),
       drain_close_(drain_close), random_generator_(random_generator), tracer_(tracer),
       runtime_(runtime), local_info_(local_info), cluster_manager_(cluster_manager),
-      listener_stats_(config_.listenerStats()) {}
+      overload_manager_(overload_manager), listener_stats_(config_.listenerStats()) {}
 
 void ConnectionManagerImpl::initializeReadFilterCallbacks(Network::ReadFilterCallbacks& callbacks) {
   read_callbacks_ = &callbacks;
@@ -77,7 +94,7 @@ void ConnectionManagerImpl::initializeReadFilterCallbacks(Network::ReadFilterCal
   read_callbacks_->connection().addConnectionCallbacks(*this);
 
   if (config_.idleTimeout().valid()) {
-    idle_timer_ = read_callbacks_->connection().dispatcher().createTimer(
+    idle_timer_ = read_callbacks_->connection().dispatcher().createCoarseTimer(
         [this]() -> void { onIdleTimeout(); });
     idle_timer_->enableTimer(config_.idleTimeout().value());
   }
@@ -143,11 +160,18 @@ void ConnectionManagerImpl::doEndStream(ActiveStream& stream) {
 
   checkForDeferredClose();
 
-  // Reading may have been disabled for the non-multiplexing case, so enable it again.
-  // Also be sure to unwind any read-disable done by the prior downstream
-  // connection.
+  // Reading may have been disabled for the non-multiplexing case, so enable it again. Once no
+  // stream is left, also be sure to unwind any read-disable done by the prior downstream
+  // connection. Pipelined streams that are still active may have disabled reading for flow
+  // control, so only the read-disable waiting for a response is undone while they are.
   if (drain_state_ != DrainState::Closing && codec_->protocol() != Protocol::Http2) {
-    while (!read_callbacks_->connection().readEnabled()) {
+    if (streams_.empty()) {
+      read_disabled_awaiting_response_ = false;
+      while (!read_callbacks_->connection().readEnabled()) {
+        read_callbacks_->connection().readDisable(false);
+      }
+    } else if (read_disabled_awaiting_response_) {
+      read_disabled_awaiting_response_ = false;
       read_callbacks_->connection().readDisable(false);
     }
   }
@@ -183,7 +207,11 @@ StreamDecoder& ConnectionManagerImpl::newStream(StreamEncoder& response_encoder)
   new_stream->response_encoder_ = &response_encoder;
   new_stream->response_encoder_->getStream().addCallbacks(*new_stream);
   new_stream->buffer_limit_ = new_stream->response_encoder_->getStream().bufferLimit();
-  config_.filterFactory().createFilterChain(*new_stream);
+  // With a header only responder the chain is created once the request headers show that the
+  // responder does not answer the request.
+  if (config_.headerOnlyResponder() == nullptr) {
+    new_stream->createFilterChain();
+  }
   // Make sure new streams are apprised that the underlying connection is blocked.
   if (read_callbacks_->connection().aboveHighWatermark()) {
     new_stream->callHighWatermarkCallbacks();
@@ -204,6 +232,7 @@ Network::FilterStatus ConnectionManagerImpl::onData(Buffer::Instance& data) {
 
   if (!codec_) {
     codec_ = config_.createCodec(read_callbacks_->connection(), data, *this);
+    max_pipelined_requests_ = config_.maxPipelinedRequests();
     if (codec_->protocol() == Protocol::Http2) {
       stats_.named_.downstream_cx_http2_total_.inc();
       stats_.named_.downstream_cx_http2_active_.inc();
@@ -238,17 +267,19 @@ Network::FilterStatus ConnectionManagerImpl::onData(Buffer::Instance& data) {
     checkForDeferredClose();
 
     // The HTTP/1 codec will pause dispatch after a single message is complete. We want to
-    // either redispatch if there are no streams and we have more data. If we have a single
-    // complete non-WebSocket stream but have not responded yet we will pause socket reads
-    // to apply back pressure.
+    // either redispatch if there are no streams and we have more data, or if pipelining is enabled
+    // and the newest stream is complete. Otherwise, if we have a complete non-WebSocket stream but
+    // have not responded yet we will pause socket reads to apply back pressure.
     if (codec_->protocol() != Protocol::Http2) {
+      const bool pipeline = canPipeline();
       if (read_callbacks_->connection().state() == Network::Connection::State::Open &&
-          data.length() > 0 && streams_.empty()) {
+          data.length() > 0 && (streams_.empty() || pipeline)) {
         redispatch = true;
       }
 
-      if (!streams_.empty() && streams_.front()->state_.remote_complete_ &&
-          !isWebSocketConnection()) {
+      if (!streams_.empty() && streams_.front()->state_.remote_complete_ && !pipeline &&
+          !isWebSocketConnection() && !read_disabled_awaiting_response_) {
+        read_disabled_awaiting_response_ = true;
         read_callbacks_->connection().readDisable(true);
       }
     }
@@ -257,6 +288,15 @@ Network::FilterStatus ConnectionManagerImpl::onData(Buffer::Instance& data) {
   return Network::FilterStatus::StopIteration;
 }
 
+bool ConnectionManagerImpl::canPipeline() {
+  // streams_ is newest first. Only a complete keep-alive HTTP/1.1 request may be followed by
+  // another one before it has been responded to.
+  return codec_->protocol() == Protocol::Http11 && !streams_.empty() &&
+         streams_.size() <= max_pipelined_requests_ && streams_.front()->state_.remote_complete_ &&
+         !streams_.front()->state_.saw_connection_close_ &&
+         drain_state_ == DrainState::NotDraining && !isWebSocketConnection();
+}
+
 void ConnectionManagerImpl::resetAllStreams() {
   while (!streams_.empty()) {
     // Mimic a downstream reset in this case.
@@ -348,9 +388,12 @@ ConnectionManagerImpl::ActiveStream::ActiveStream(ConnectionManagerImpl& connect
       snapped_route_config_(connection_manager.config_.routeConfigProvider().config()),
       stream_id_(connection_manager.random_generator_.random()),
       request_timer_(new Stats::Timespan(connection_manager_.stats_.named_.downstream_rq_time_)),
-      request_info_(connection_manager_.codec_->protocol()) {
+      request_info_(connection_manager_.codec_->protocol()),
+      memory_account_(Buffer::MemoryAccountImpl::createChild(
+          connection_manager_.read_callbacks_->connection().memoryAccount())) {
   connection_manager_.stats_.named_.downstream_rq_total_.inc();
   connection_manager_.stats_.named_.downstream_rq_active_.inc();
+  ThreadLoad::onRequestStart();
   if (connection_manager_.codec_->protocol() == Protocol::Http2) {
     connection_manager_.stats_.named_.downstream_rq_http2_total_.inc();
   } else {
@@ -360,8 +403,13 @@ ConnectionManagerImpl::ActiveStream::ActiveStream(ConnectionManagerImpl& connect
 
 ConnectionManagerImpl::ActiveStream::~ActiveStream() {
   connection_manager_.stats_.named_.downstream_rq_active_.dec();
+  ThreadLoad::onRequestEnd();
+  uint64_t access_log_bit = 1;
   for (const AccessLog::InstanceSharedPtr& access_log : connection_manager_.config_.accessLogs()) {
-    access_log->log(request_headers_.get(), response_headers_.get(), request_info_);
+    if (!(skipped_access_logs_ & access_log_bit)) {
+      access_log->log(request_headers_.get(), response_headers_.get(), request_info_);
+    }
+    access_log_bit <<= 1;
   }
   for (const auto& log_handler : access_log_handlers_) {
     log_handler->log(request_headers_.get(), response_headers_.get(), request_info_);
@@ -377,16 +425,25 @@ ConnectionManagerImpl::ActiveStream::~ActiveStream() {
   ASSERT(state_.filter_call_state_ == 0);
 }
 
+void ConnectionManagerImpl::ActiveStream::createFilterChain() {
+  if (!state_.created_filter_chain_) {
+    state_.created_filter_chain_ = true;
+    connection_manager_.config_.filterFactory().createFilterChain(*this);
+  }
+}
+
 void ConnectionManagerImpl::ActiveStream::addStreamDecoderFilterWorker(
     StreamDecoderFilterSharedPtr filter, bool dual_filter) {
-  ActiveStreamDecoderFilterPtr wrapper(new ActiveStreamDecoderFilter(*this, filter, dual_filter));
+  ActiveStreamDecoderFilterPtr wrapper(
+      arena_.makeUnique<ActiveStreamDecoderFilter>(*this, filter, dual_filter));
   filter->setDecoderFilterCallbacks(*wrapper);
   wrapper->moveIntoListBack(std::move(wrapper), decoder_filters_);
 }
 
 void ConnectionManagerImpl::ActiveStream::addStreamEncoderFilterWorker(
     StreamEncoderFilterSharedPtr filter, bool dual_filter) {
-  ActiveStreamEncoderFilterPtr wrapper(new ActiveStreamEncoderFilter(*this, filter, dual_filter));
+  ActiveStreamEncoderFilterPtr wrapper(
+      arena_.makeUnique<ActiveStreamEncoderFilter>(*this, filter, dual_filter));
   filter->setEncoderFilterCallbacks(*wrapper);
   wrapper->moveIntoListBack(std::move(wrapper), encoder_filters_);
 }
@@ -434,6 +491,17 @@ Ssl::Connection* ConnectionManagerImpl::ActiveStream::ssl() {
 void ConnectionManagerImpl::ActiveStream::decodeHeaders(HeaderMapPtr&& headers, bool end_stream) {
   ASSERT(!state_.remote_complete_);
   state_.remote_complete_ = end_stream;
+  if (state_.remote_complete_) {
+    request_info_.requestReceivedDuration(ProdMonotonicTimeSource::instance_.currentTime());
+  }
+
+  // Only a request without a body can be answered before the filter chain is created. Until then,
+  // the local replies below are not seen by encoder filters.
+  HeaderOnlyResponder* responder =
+      end_stream ? connection_manager_.config_.headerOnlyResponder() : nullptr;
+  if (responder == nullptr) {
+    createFilterChain();
+  }
 
   request_headers_ = std::move(headers);
   ENVOY_STREAM_LOG(debug, "request headers complete (end_stream={}):", *this, end_stream);
@@ -461,6 +529,17 @@ void ConnectionManagerImpl::ActiveStream::decodeHeaders(HeaderMapPtr&& headers,
     return;
   }
 
+  // Shed new requests while the server is short of memory.
+  if (connection_manager_.overload_manager_ != nullptr &&
+      connection_manager_.overload_manager_->isActive(
+          Server::OverloadAction::StopAcceptingRequests)) {
+    connection_manager_.stats_.named_.downstream_rq_overload_reject_.inc();
+    HeaderMapImpl headers{
+        {Headers::get().Status, std::to_string(enumToInt(Code::ServiceUnavailable))}};
+    encodeHeaders(nullptr, headers, true);
+    return;
+  }
+
   // Require host header. For HTTP/1.1 Host has already been translated to :authority.
   if (!request_headers_->Host()) {
     HeaderMapImpl headers{{Headers::get().Status, std::to_string(enumToInt(Code::BadRequest))}};
@@ -501,6 +580,14 @@ void ConnectionManagerImpl::ActiveStream::decodeHeaders(HeaderMapPtr&& headers,
     state_.saw_connection_close_ = true;
   }
 
+  // Requests that arrive sampled belong to a trace started downstream, which is never cut short.
+  const uint64_t max_sampled_per_second =
+      connection_manager_.config_.tracingConfig()
+          ? connection_manager_.runtime_.snapshot().getInteger(MAX_SAMPLED_PER_SECOND_KEY, 0)
+          : 0;
+  const bool arrived_sampled = max_sampled_per_second > 0 &&
+                               Tracing::HttpTracerUtility::isRandomlySampled(*request_headers_);
+
   request_info_.downstream_local_address_ =
       connection_manager_.read_callbacks_->connection().localAddress();
   request_info_.downstream_remote_address_ = ConnectionManagerUtility::mutateRequestHeaders(
@@ -509,6 +596,31 @@ void ConnectionManagerImpl::ActiveStream::decodeHeaders(HeaderMapPtr&& headers,
       connection_manager_.runtime_, connection_manager_.local_info_);
   ASSERT(request_info_.downstream_remote_address_ != nullptr);
 
+  // The request ID is final now, so logs that sample by it can be ruled out before the request is
+  // processed rather than when it is destroyed.
+  uint64_t access_log_bit = 1;
+  for (const AccessLog::InstanceSharedPtr& access_log : connection_manager_.config_.accessLogs()) {
+    if (access_log_bit == 0) {
+      break;
+    }
+    if (!access_log->mayLog(*request_headers_)) {
+      skipped_access_logs_ |= access_log_bit;
+    }
+    access_log_bit <<= 1;
+  }
+
+  // Header only requests the first filter would answer by itself, such as cached health checks,
+  // are answered here without looking up the route or creating the filter chain.
+  if (responder != nullptr) {
+    HeaderMapImpl response_headers;
+    if (responder->respond(*request_headers_, response_headers, request_info_)) {
+      connection_manager_.stats_.named_.downstream_rq_header_only_response_.inc();
+      encodeHeaders(nullptr, response_headers, true);
+      return;
+    }
+    createFilterChain();
+  }
+
   ASSERT(!cached_route_.valid());
   cached_route_.value(snapped_route_config_->route(*request_headers_, stream_id_));
 
@@ -543,6 +655,18 @@ void ConnectionManagerImpl::ActiveStream::decodeHeaders(HeaderMapPtr&& headers,
 
   // Check if tracing is enabled at all.
   if (connection_manager_.config_.tracingConfig()) {
+    // The sampling rate is bounded per upstream cluster, which is only known once the request is
+    // routed.
+    if (max_sampled_per_second > 0 && !arrived_sampled) {
+      const Router::RouteEntry* route_entry =
+          cached_route_.value() ? cached_route_.value()->routeEntry() : nullptr;
+      if (Tracing::HttpTracerUtility::limitSampling(
+              *request_headers_, Tracing::SampleRateLimiter::threadLocal(),
+              route_entry ? route_entry->clusterName() : EMPTY_STRING, max_sampled_per_second,
+              ProdMonotonicTimeSource::instance_.currentTime())) {
+        connection_manager_.config_.tracingStats().rate_limited_.inc();
+      }
+    }
     traceRequest();
   }
 
@@ -616,8 +740,12 @@ void ConnectionManagerImpl::ActiveStream::decodeHeaders(ActiveStreamDecoderFilte
   for (; entry != decoder_filters_.end(); entry++) {
     ASSERT(!(state_.filter_call_state_ & FilterCallState::DecodeHeaders));
     state_.filter_call_state_ |= FilterCallState::DecodeHeaders;
+    const MonotonicTime start = (*entry)->callbackStart();
     FilterHeadersStatus status = (*entry)->handle_->decodeHeaders(
         headers, end_stream && continue_data_entry == decoder_filters_.end());
+    if ((*entry)->latency_stats_) {
+      chargeCallbackTime(start, (*entry)->latency_stats_->decode_headers_us_);
+    }
     state_.filter_call_state_ &= ~FilterCallState::DecodeHeaders;
     ENVOY_STREAM_LOG(trace, "decode headers called: filter={} status={}", *this,
                      static_cast<const void*>((*entry).get()), static_cast<uint64_t>(status));
@@ -651,6 +779,7 @@ void ConnectionManagerImpl::ActiveStream::decodeData(Buffer::Instance& data, boo
   state_.remote_complete_ = end_stream;
   if (state_.remote_complete_) {
     ENVOY_STREAM_LOG(debug, "request end stream", *this);
+    request_info_.requestReceivedDuration(ProdMonotonicTimeSource::instance_.currentTime());
   }
 
   decodeData(nullptr, data, end_stream);
@@ -674,7 +803,11 @@ void ConnectionManagerImpl::ActiveStream::decodeData(ActiveStreamDecoderFilter*
   for (; entry != decoder_filters_.end(); entry++) {
     ASSERT(!(state_.filter_call_state_ & FilterCallState::DecodeData));
     state_.filter_call_state_ |= FilterCallState::DecodeData;
+    const MonotonicTime start = (*entry)->callbackStart();
     FilterDataStatus status = (*entry)->handle_->decodeData(data, end_stream);
+    if ((*entry)->latency_stats_) {
+      chargeCallbackTime(start, (*entry)->latency_stats_->decode_data_us_);
+    }
     state_.filter_call_state_ &= ~FilterCallState::DecodeData;
     ENVOY_STREAM_LOG(trace, "decode data called: filter={} status={}", *this,
                      static_cast<const void*>((*entry).get()), static_cast<uint64_t>(status));
@@ -709,6 +842,7 @@ void ConnectionManagerImpl::ActiveStream::decodeTrailers(HeaderMapPtr&& trailers
   request_trailers_ = std::move(trailers);
   ASSERT(!state_.remote_complete_);
   state_.remote_complete_ = true;
+  request_info_.requestReceivedDuration(ProdMonotonicTimeSource::instance_.currentTime());
   decodeTrailers(nullptr, *request_trailers_);
 }
 
@@ -729,7 +863,11 @@ void ConnectionManagerImpl::ActiveStream::decodeTrailers(ActiveStreamDecoderFilt
   for (; entry != decoder_filters_.end(); entry++) {
     ASSERT(!(state_.filter_call_state_ & FilterCallState::DecodeTrailers));
     state_.filter_call_state_ |= FilterCallState::DecodeTrailers;
+    const MonotonicTime start = (*entry)->callbackStart();
     FilterTrailersStatus status = (*entry)->handle_->decodeTrailers(trailers);
+    if ((*entry)->latency_stats_) {
+      chargeCallbackTime(start, (*entry)->latency_stats_->decode_trailers_us_);
+    }
     state_.filter_call_state_ &= ~FilterCallState::DecodeTrailers;
     ENVOY_STREAM_LOG(trace, "decode trailers called: filter={} status={}", *this,
                      static_cast<const void*>((*entry).get()), static_cast<uint64_t>(status));
@@ -773,8 +911,12 @@ void ConnectionManagerImpl::ActiveStream::encodeHeaders(ActiveStreamEncoderFilte
   for (; entry != encoder_filters_.end(); entry++) {
     ASSERT(!(state_.filter_call_state_ & FilterCallState::EncodeHeaders));
     state_.filter_call_state_ |= FilterCallState::EncodeHeaders;
+    const MonotonicTime start = (*entry)->callbackStart();
     FilterHeadersStatus status = (*entry)->handle_->encodeHeaders(
         headers, end_stream && continue_data_entry == encoder_filters_.end());
+    if ((*entry)->latency_stats_) {
+      chargeCallbackTime(start, (*entry)->latency_stats_->encode_headers_us_);
+    }
     state_.filter_call_state_ &= ~FilterCallState::EncodeHeaders;
     ENVOY_STREAM_LOG(trace, "encode headers called: filter={} status={}", *this,
                      static_cast<const void*>((*entry).get()), static_cast<uint64_t>(status));
@@ -869,6 +1011,7 @@ void ConnectionManagerImpl::ActiveStream::encodeHeaders(ActiveStreamEncoderFilte
 #endif
 
   // Now actually encode via the codec.
+  request_info_.downstreamFirstByteSentDuration(ProdMonotonicTimeSource::instance_.currentTime());
   response_encoder_->encodeHeaders(headers,
                                    end_stream && continue_data_entry == encoder_filters_.end());
 
@@ -910,7 +1053,11 @@ void ConnectionManagerImpl::ActiveStream::encodeData(ActiveStreamEncoderFilter*
   for (; entry != encoder_filters_.end(); entry++) {
     ASSERT(!(state_.filter_call_state_ & FilterCallState::EncodeData));
     state_.filter_call_state_ |= FilterCallState::EncodeData;
+    const MonotonicTime start = (*entry)->callbackStart();
     FilterDataStatus status = (*entry)->handle_->encodeData(data, end_stream);
+    if ((*entry)->latency_stats_) {
+      chargeCallbackTime(start, (*entry)->latency_stats_->encode_data_us_);
+    }
     state_.filter_call_state_ &= ~FilterCallState::EncodeData;
     ENVOY_STREAM_LOG(trace, "encode data called: filter={} status={}", *this,
                      static_cast<const void*>((*entry).get()), static_cast<uint64_t>(status));
@@ -933,7 +1080,11 @@ void ConnectionManagerImpl::ActiveStream::encodeTrailers(ActiveStreamEncoderFilt
   for (; entry != encoder_filters_.end(); entry++) {
     ASSERT(!(state_.filter_call_state_ & FilterCallState::EncodeTrailers));
     state_.filter_call_state_ |= FilterCallState::EncodeTrailers;
+    const MonotonicTime start = (*entry)->callbackStart();
     FilterTrailersStatus status = (*entry)->handle_->encodeTrailers(trailers);
+    if ((*entry)->latency_stats_) {
+      chargeCallbackTime(start, (*entry)->latency_stats_->encode_trailers_us_);
+    }
     state_.filter_call_state_ &= ~FilterCallState::EncodeTrailers;
     ENVOY_STREAM_LOG(trace, "encode trailers called: filter={} status={}", *this,
                      static_cast<const void*>((*entry).get()), static_cast<uint64_t>(status));
@@ -959,6 +1110,7 @@ void ConnectionManagerImpl::ActiveStream::encodeTrailers(ActiveStreamEncoderFilt
 
 void ConnectionManagerImpl::ActiveStream::maybeEndEncode(bool end_stream) {
   if (end_stream) {
+    request_info_.downstreamLastByteSentDuration(ProdMonotonicTimeSource::instance_.currentTime());
     request_timer_->complete();
     connection_manager_.doEndStream(*this);
   }
@@ -1030,6 +1182,13 @@ void ConnectionManagerImpl::ActiveStreamFilterBase::commonContinue() {
                    static_cast<const void*>(this));
   ASSERT(stopped_);
   stopped_ = false;
+  if (latency_stats_ && stopped_time_ != MonotonicTime()) {
+    stoppedTime(*latency_stats_)
+        .recordValue(std::chrono::duration_cast<std::chrono::milliseconds>(
+                         ProdMonotonicTimeSource::instance_.currentTime() - stopped_time_)
+                         .count());
+    stopped_time_ = MonotonicTime();
+  }
 
   // Make sure that we handle the zero byte data frame case. We make no effort to optimize this
   // case in terms of merging it into a header only request/response. This could be done in the
@@ -1057,7 +1216,7 @@ bool ConnectionManagerImpl::ActiveStreamFilterBase::commonHandleAfterHeadersCall
   ASSERT(!stopped_);
 
   if (status == FilterHeadersStatus::StopIteration) {
-    stopped_ = true;
+    commonStop();
     return false;
   } else {
     ASSERT(status == FilterHeadersStatus::Continue);
@@ -1066,6 +1225,15 @@ bool ConnectionManagerImpl::ActiveStreamFilterBase::commonHandleAfterHeadersCall
   }
 }
 
+void ConnectionManagerImpl::ActiveStreamFilterBase::commonStop() {
+  // A filter may stop again on further data while it is stopped, which does not restart the
+  // time it has been stopped for.
+  if (!stopped_ && latency_stats_) {
+    stopped_time_ = ProdMonotonicTimeSource::instance_.currentTime();
+  }
+  stopped_ = true;
+}
+
 void ConnectionManagerImpl::ActiveStreamFilterBase::commonHandleBufferData(
     Buffer::Instance& provided_data) {
 
@@ -1095,7 +1263,7 @@ bool ConnectionManagerImpl::ActiveStreamFilterBase::commonHandleAfterDataCallbac
       ASSERT(headers_continued_);
     }
   } else {
-    stopped_ = true;
+    commonStop();
     if (status == FilterDataStatus::StopIterationAndBuffer ||
         status == FilterDataStatus::StopIterationAndWatermark) {
       buffer_was_streaming = status == FilterDataStatus::StopIterationAndWatermark;
@@ -1147,6 +1315,8 @@ Tracing::Span& ConnectionManagerImpl::ActiveStreamFilterBase::activeSpan() {
 
 Tracing::Config& ConnectionManagerImpl::ActiveStreamFilterBase::tracingConfig() { return parent_; }
 
+Arena& ConnectionManagerImpl::ActiveStreamFilterBase::arena() { return parent_.arena_; }
+
 Router::RouteConstSharedPtr ConnectionManagerImpl::ActiveStreamFilterBase::route() {
   if (!parent_.cached_route_.valid()) {
     parent_.cached_route_.value(
@@ -1165,6 +1335,7 @@ Buffer::WatermarkBufferPtr ConnectionManagerImpl::ActiveStreamDecoderFilter::cre
       new Buffer::WatermarkBuffer([this]() -> void { this->requestDataDrained(); },
                                   [this]() -> void { this->requestDataTooLarge(); })};
   buffer->setWatermarks(parent_.buffer_limit_);
+  buffer->setMemoryAccount(parent_.memory_account_);
   return buffer;
 }
 
@@ -1244,6 +1415,7 @@ Buffer::WatermarkBufferPtr ConnectionManagerImpl::ActiveStreamEncoderFilter::cre
   auto buffer = new Buffer::WatermarkBuffer([this]() -> void { this->responseDataDrained(); },
                                             [this]() -> void { this->responseDataTooLarge(); });
   buffer->setWatermarks(parent_.buffer_limit_);
+  buffer->setMemoryAccount(parent_.memory_account_);
   return Buffer::WatermarkBufferPtr{buffer};
 }
 
@@ -1281,6 +1453,8 @@ void ConnectionManagerImpl::ActiveStreamEncoderFilter::responseDataTooLarge() {
       Http::Utility::sendLocalReply(
           [&](HeaderMapPtr&& response_headers, bool end_stream) -> void {
             parent_.response_headers_ = std::move(response_headers);
+            parent_.request_info_.downstreamFirstByteSentDuration(
+                ProdMonotonicTimeSource::instance_.currentTime());
             parent_.response_encoder_->encodeHeaders(*parent_.response_headers_, end_stream);
           },
           [&](Buffer::Instance& data, bool end_stream) -> void {
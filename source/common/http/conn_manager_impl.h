@@ -18,13 +18,16 @@
 #include "envoy/network/filter.h"
 #include "envoy/router/rds.h"
 #include "envoy/runtime/runtime.h"
+#include "envoy/server/overload_manager.h"
 #include "envoy/ssl/connection.h"
 #include "envoy/stats/stats_macros.h"
 #include "envoy/tracing/http_tracer.h"
 #include "envoy/upstream/upstream.h"
 
 #include "common/buffer/watermark_buffer.h"
+#include "common/common/arena_impl.h"
 #include "common/common/linked_object.h"
+#include "common/common/utility.h"
 #include "common/http/date_provider.h"
 #include "common/http/user_agent.h"
 #include "common/http/websocket/ws_handler_impl.h"
@@ -73,6 +76,8 @@ namespace Http {
   COUNTER  (downstream_rq_rx_reset)                                                                \
   COUNTER  (downstream_rq_tx_reset)                                                                \
   COUNTER  (downstream_rq_non_relative_path)                                                       \
+  COUNTER  (downstream_rq_overload_reject)                                                         \
+  COUNTER  (downstream_rq_header_only_response)                                                    \
   COUNTER  (downstream_rq_ws_on_non_ws_route)                                                      \
   COUNTER  (downstream_rq_too_large)                                                               \
   COUNTER  (downstream_rq_2xx)                                                                     \
@@ -105,7 +110,8 @@ struct ConnectionManagerStats {
   COUNTER(service_forced)                                                                          \
   COUNTER(client_enabled)                                                                          \
   COUNTER(not_traceable)                                                                           \
-  COUNTER(health_check)
+  COUNTER(health_check)                                                                            \
+  COUNTER(rate_limited)
 // clang-format on
 
 /**
@@ -215,6 +221,14 @@ public:
    */
   virtual const Optional<std::chrono::milliseconds>& idleTimeout() PURE;
 
+  /**
+   * @return uint32_t the maximum number of HTTP/1.1 requests that will be decoded and routed ahead
+   *         of the response to an earlier request on the same connection. Responses are still
+   *         written in request order. 0 disables pipelining, so that each request is only decoded
+   *         once the response to the previous one is complete.
+   */
+  virtual uint32_t maxPipelinedRequests() PURE;
+
   /**
    * @return Router::RouteConfigProvider& the configuration provider used to acquire a route
    *         config for each request flow.
@@ -275,6 +289,12 @@ public:
    * @return ConnectionManagerListenerStats& the stats to write to.
    */
   virtual ConnectionManagerListenerStats& listenerStats() PURE;
+
+  /**
+   * @return HeaderOnlyResponder* the responder for header only requests that the filter chain
+   *         would answer without looking further, or nullptr if there is none.
+   */
+  virtual HeaderOnlyResponder* headerOnlyResponder() PURE;
 };
 
 /**
@@ -290,7 +310,8 @@ public:
   ConnectionManagerImpl(ConnectionManagerConfig& config, const Network::DrainDecision& drain_close,
                         Runtime::RandomGenerator& random_generator, Tracing::HttpTracer& tracer,
                         Runtime::Loader& runtime, const LocalInfo::LocalInfo& local_info,
-                        Upstream::ClusterManager& cluster_manager);
+                        Upstream::ClusterManager& cluster_manager,
+                        Server::OverloadManager* overload_manager);
   ~ConnectionManagerImpl();
 
   static ConnectionManagerStats generateStats(const std::string& prefix, Stats::Scope& scope);
@@ -330,13 +351,15 @@ private:
    */
   struct ActiveStreamFilterBase : public virtual StreamFilterCallbacks {
     ActiveStreamFilterBase(ActiveStream& parent, bool dual_filter)
-        : parent_(parent), headers_continued_(false), stopped_(false), dual_filter_(dual_filter) {}
+        : parent_(parent), latency_stats_(parent.filter_latency_stats_), headers_continued_(false),
+          stopped_(false), dual_filter_(dual_filter) {}
 
     bool commonHandleAfterHeadersCallback(FilterHeadersStatus status);
     void commonHandleBufferData(Buffer::Instance& provided_data);
     bool commonHandleAfterDataCallback(FilterDataStatus status, Buffer::Instance& provided_data,
                                        bool& buffer_was_streaming);
     bool commonHandleAfterTrailersCallback(FilterTrailersStatus status);
+    void commonStop();
 
     void commonContinue();
     virtual bool canContinue() PURE;
@@ -347,6 +370,12 @@ private:
     virtual void doData(bool end_stream) PURE;
     virtual void doTrailers() PURE;
     virtual const HeaderMapPtr& trailers() PURE;
+    virtual Stats::Histogram& stoppedTime(const FilterLatencyStats& stats) PURE;
+
+    // @return MonotonicTime the start time of a callback of the filter, if the filter is timed.
+    MonotonicTime callbackStart() const {
+      return latency_stats_ ? ProdMonotonicTimeSource::instance_.currentTime() : MonotonicTime();
+    }
 
     // Http::StreamFilterCallbacks
     const Network::Connection* connection() override;
@@ -358,8 +387,13 @@ private:
     RequestInfo::RequestInfo& requestInfo() override;
     Tracing::Span& activeSpan() override;
     Tracing::Config& tracingConfig() override;
+    Arena& arena() override;
 
     ActiveStream& parent_;
+    // The stats the filter is timed into, or nullptr if it is not timed.
+    const FilterLatencyStats* const latency_stats_;
+    // When the filter last stopped iteration. Only set if the filter is timed.
+    MonotonicTime stopped_time_;
     bool headers_continued_ : 1;
     bool stopped_ : 1;
     const bool dual_filter_ : 1;
@@ -370,7 +404,7 @@ private:
    */
   struct ActiveStreamDecoderFilter : public ActiveStreamFilterBase,
                                      public StreamDecoderFilterCallbacks,
-                                     LinkedObject<ActiveStreamDecoderFilter> {
+                                     LinkedObject<ActiveStreamDecoderFilter, ArenaDeleter> {
     ActiveStreamDecoderFilter(ActiveStream& parent, StreamDecoderFilterSharedPtr filter,
                               bool dual_filter)
         : ActiveStreamFilterBase(parent, dual_filter), handle_(filter) {}
@@ -395,6 +429,9 @@ private:
     }
     void doTrailers() override { parent_.decodeTrailers(this, *parent_.request_trailers_); }
     const HeaderMapPtr& trailers() override { return parent_.request_trailers_; }
+    Stats::Histogram& stoppedTime(const FilterLatencyStats& stats) override {
+      return stats.decode_stopped_ms_;
+    }
 
     // Http::StreamDecoderFilterCallbacks
     void addDecodedData(Buffer::Instance& data, bool streaming) override;
@@ -420,14 +457,14 @@ private:
     StreamDecoderFilterSharedPtr handle_;
   };
 
-  typedef std::unique_ptr<ActiveStreamDecoderFilter> ActiveStreamDecoderFilterPtr;
+  typedef ArenaPtr<ActiveStreamDecoderFilter> ActiveStreamDecoderFilterPtr;
 
   /**
    * Wrapper for a stream encoder filter.
    */
   struct ActiveStreamEncoderFilter : public ActiveStreamFilterBase,
                                      public StreamEncoderFilterCallbacks,
-                                     LinkedObject<ActiveStreamEncoderFilter> {
+                                     LinkedObject<ActiveStreamEncoderFilter, ArenaDeleter> {
     ActiveStreamEncoderFilter(ActiveStream& parent, StreamEncoderFilterSharedPtr filter,
                               bool dual_filter)
         : ActiveStreamFilterBase(parent, dual_filter), handle_(filter) {}
@@ -445,6 +482,9 @@ private:
     }
     void doTrailers() override { parent_.encodeTrailers(this, *parent_.response_trailers_); }
     const HeaderMapPtr& trailers() override { return parent_.response_trailers_; }
+    Stats::Histogram& stoppedTime(const FilterLatencyStats& stats) override {
+      return stats.encode_stopped_ms_;
+    }
 
     // Http::StreamEncoderFilterCallbacks
     void addEncodedData(Buffer::Instance& data, bool streaming) override;
@@ -463,7 +503,7 @@ private:
     StreamEncoderFilterSharedPtr handle_;
   };
 
-  typedef std::unique_ptr<ActiveStreamEncoderFilter> ActiveStreamEncoderFilterPtr;
+  typedef ArenaPtr<ActiveStreamEncoderFilter> ActiveStreamEncoderFilterPtr;
 
   /**
    * Wraps a single active stream on the connection. These are either full request/response pairs
@@ -520,6 +560,10 @@ private:
       addStreamEncoderFilterWorker(filter, true);
     }
     void addAccessLogHandler(AccessLog::InstanceSharedPtr handler) override;
+    Arena& arena() override { return arena_; }
+    void setFilterLatencyStats(const FilterLatencyStats* stats) override {
+      filter_latency_stats_ = stats;
+    }
 
     // Http::WsHandlerCallbacks
     void sendHeadersOnlyResponse(HeaderMap& headers) override {
@@ -553,7 +597,9 @@ private:
 
     // All state for the stream. Put here for readability.
     struct State {
-      State() : remote_complete_(false), local_complete_(false), saw_connection_close_(false) {}
+      State()
+          : remote_complete_(false), local_complete_(false), saw_connection_close_(false),
+            created_filter_chain_(false) {}
 
       uint32_t filter_call_state_{0};
       // The following 3 members are booleans rather than part of the space-saving bitfield as they
@@ -565,11 +611,17 @@ private:
       bool remote_complete_ : 1;
       bool local_complete_ : 1;
       bool saw_connection_close_ : 1;
+      bool created_filter_chain_ : 1;
     };
 
     // Possibly increases buffer_limit_ to the value of limit.
     void setBufferLimit(uint32_t limit);
+    // Creates the filter chain unless it has been created already.
+    void createFilterChain();
 
+    // Holds the filter wrappers and anything filters allocate through arena(). It is declared
+    // first so that it is destroyed last.
+    ArenaImpl arena_;
     ConnectionManagerImpl& connection_manager_;
     Router::ConfigConstSharedPtr snapped_route_config_;
     Tracing::SpanPtr active_span_;
@@ -584,14 +636,21 @@ private:
     std::list<ActiveStreamDecoderFilterPtr> decoder_filters_;
     std::list<ActiveStreamEncoderFilterPtr> encoder_filters_;
     std::list<AccessLog::InstanceSharedPtr> access_log_handlers_;
+    // Bit i is set if the i-th of the first 64 configured access logs will not log the request.
+    uint64_t skipped_access_logs_{};
     Stats::TimespanPtr request_timer_;
     State state_;
     RequestInfo::RequestInfoImpl request_info_;
     Optional<Router::RouteConstSharedPtr> cached_route_;
     DownstreamWatermarkCallbacks* watermark_callbacks_{nullptr};
     uint32_t buffer_limit_{0};
+    // Charged with the request and response data buffered by the stream's filters. A child of the
+    // connection's account, or nullptr if the connection is not accounted.
+    const Buffer::MemoryAccountSharedPtr memory_account_;
     uint32_t high_watermark_count_{0};
     const std::string* decorated_operation_{nullptr};
+    // The stats the filters being added to the chain are timed into.
+    const FilterLatencyStats* filter_latency_stats_{nullptr};
   };
 
   typedef std::unique_ptr<ActiveStream> ActiveStreamPtr;
@@ -613,6 +672,11 @@ private:
    */
   void doEndStream(ActiveStream& stream);
 
+  /**
+   * @return whether the next HTTP/1.1 request on the connection may be decoded before the
+   *         response to the newest stream is complete.
+   */
+  bool canPipeline();
   void resetAllStreams();
   void onIdleTimeout();
   void onDrainTimeout();
@@ -626,10 +690,14 @@ private:
   ConnectionManagerStats& stats_; // We store a reference here to avoid an extra stats() call on the
                                   // config in the hot path.
   ServerConnectionPtr codec_;
+  // Read from the config when the codec is created, so that it is fixed for the connection.
+  uint32_t max_pipelined_requests_{};
   std::list<ActiveStreamPtr> streams_;
   Stats::TimespanPtr conn_length_;
   const Network::DrainDecision& drain_close_;
   DrainState drain_state_{DrainState::NotDraining};
+  // Whether reading was disabled until a complete HTTP/1 request is responded to.
+  bool read_disabled_awaiting_response_{};
   UserAgent user_agent_;
   Event::TimerPtr idle_timer_;
   Event::TimerPtr drain_timer_;
@@ -638,6 +706,8 @@ private:
   Runtime::Loader& runtime_;
   const LocalInfo::LocalInfo& local_info_;
   Upstream::ClusterManager& cluster_manager_;
+  // Optional. When set, new requests are rejected while the server is overloaded.
+  Server::OverloadManager* overload_manager_;
   WebSocket::WsHandlerImplPtr ws_connection_{};
   Network::ReadFilterCallbacks* read_callbacks_{};
   ConnectionManagerListenerStats& listener_stats_;
@@ -0,0 +1,246 @@
+#include "common/http/filter/adaptive_concurrency_filter.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <memory>
+#include <string>
+
+#include "envoy/common/exception.h"
+#include "envoy/router/router.h"
+
+#include "common/common/assert.h"
+#include "common/http/headers.h"
+#include "common/http/utility.h"
+#include "common/json/config_schemas.h"
+
+#include "fmt/format.h"
+
+namespace Envoy {
+namespace Http {
+
+namespace {
+
+// The number of windows the long term latency is averaged over.
+const double LongRttWindows = 600;
+const std::string EnabledKey = "adaptive_concurrency.enabled";
+
+} // namespace
+
+ConcurrencyLimit::ConcurrencyLimit(const ConcurrencyLimitSettings& settings,
+                                   AdaptiveConcurrencyStats stats, MonotonicTime now)
+    : settings_(settings), stats_(stats), limit_(settings.initial_limit_),
+      window_end_((now + settings.window_).time_since_epoch().count()),
+      estimated_limit_(settings.initial_limit_) {
+  stats_.concurrency_limit_.set(limit_);
+}
+
+bool ConcurrencyLimit::tryAcquire() {
+  uint32_t in_flight = in_flight_;
+  do {
+    if (in_flight >= limit_) {
+      stats_.rq_rejected_.inc();
+      return false;
+    }
+  } while (!in_flight_.compare_exchange_weak(in_flight, in_flight + 1));
+
+  uint32_t peak = peak_in_flight_;
+  while (peak <= in_flight && !peak_in_flight_.compare_exchange_weak(peak, in_flight + 1)) {
+  }
+  return true;
+}
+
+void ConcurrencyLimit::release(const std::chrono::microseconds* latency, MonotonicTime now) {
+  ASSERT(in_flight_ > 0);
+  in_flight_--;
+  if (latency == nullptr) {
+    return;
+  }
+
+  window_latency_us_ += latency->count();
+  const uint64_t samples = ++window_samples_;
+  if (samples >= settings_.min_window_samples_ && now.time_since_epoch().count() >= window_end_) {
+    // Another worker may already be updating the limit, in which case it covers this sample.
+    std::unique_lock<std::mutex> lock(update_lock_, std::try_to_lock);
+    if (lock.owns_lock()) {
+      updateLimit(now);
+    }
+  }
+}
+
+void ConcurrencyLimit::updateLimit(MonotonicTime now) {
+  if (now.time_since_epoch().count() < window_end_) {
+    // The limit was just updated by another worker.
+    return;
+  }
+
+  const uint64_t samples = window_samples_.exchange(0);
+  const uint64_t latency_us = window_latency_us_.exchange(0);
+  const uint32_t peak_in_flight = peak_in_flight_.exchange(in_flight_);
+  window_end_ = (now + settings_.window_).time_since_epoch().count();
+  if (samples == 0) {
+    return;
+  }
+
+  const double sample_rtt_us = static_cast<double>(latency_us) / samples;
+  if (long_rtt_us_ == 0) {
+    long_rtt_us_ = sample_rtt_us;
+  } else {
+    long_rtt_us_ += (sample_rtt_us - long_rtt_us_) / LongRttWindows;
+  }
+  // Once the latency drops, e.g. after a burst of load, the long term latency recovers faster so
+  // that the limit does not keep growing against an outdated baseline.
+  if (long_rtt_us_ > 2 * sample_rtt_us) {
+    long_rtt_us_ *= 0.95;
+  }
+  stats_.sample_rtt_us_.set(static_cast<uint64_t>(sample_rtt_us));
+  stats_.long_rtt_us_.set(static_cast<uint64_t>(long_rtt_us_));
+
+  // Without enough requests to fill the limit, the latency says nothing about it.
+  if (peak_in_flight < estimated_limit_ / 2) {
+    return;
+  }
+
+  const double gradient =
+      std::max(0.5, std::min(1.0, settings_.tolerance_ * long_rtt_us_ / sample_rtt_us));
+  const double new_limit = estimated_limit_ * gradient + std::sqrt(estimated_limit_);
+  estimated_limit_ =
+      estimated_limit_ * (1 - settings_.smoothing_) + new_limit * settings_.smoothing_;
+  estimated_limit_ = std::max<double>(settings_.min_limit_,
+                                      std::min<double>(settings_.max_limit_, estimated_limit_));
+  limit_ = static_cast<uint32_t>(estimated_limit_);
+  stats_.concurrency_limit_.set(limit_);
+}
+
+AdaptiveConcurrencyFilterConfig::AdaptiveConcurrencyFilterConfig(
+    const Json::Object& json_config, const std::string& stats_prefix, Stats::Scope& scope,
+    Runtime::Loader& runtime, ThreadLocal::SlotAllocator& tls, MonotonicTimeSource& time_source)
+    : stats_prefix_(stats_prefix), scope_(scope), runtime_(runtime), time_source_(time_source),
+      tls_(tls.allocateSlot()) {
+  json_config.validateSchema(Json::Schema::ADAPTIVE_CONCURRENCY_HTTP_FILTER_SCHEMA);
+
+  settings_.min_limit_ = json_config.getInteger("min_limit", DefaultMinLimit);
+  settings_.max_limit_ = json_config.getInteger("max_limit", DefaultMaxLimit);
+  settings_.initial_limit_ = json_config.getInteger("initial_limit", DefaultInitialLimit);
+  if (settings_.min_limit_ > settings_.max_limit_) {
+    throw EnvoyException(
+        fmt::format("adaptive concurrency: min_limit {} is greater than max_limit {}",
+                    settings_.min_limit_, settings_.max_limit_));
+  }
+  settings_.initial_limit_ =
+      std::max(settings_.min_limit_, std::min(settings_.max_limit_, settings_.initial_limit_));
+  settings_.window_ =
+      std::chrono::milliseconds(json_config.getInteger("window_ms", DefaultWindowMs));
+  settings_.min_window_samples_ =
+      json_config.getInteger("min_window_samples", DefaultMinWindowSamples);
+  settings_.smoothing_ = json_config.getDouble("smoothing", 0.2);
+  settings_.tolerance_ = json_config.getDouble("tolerance", 1.5);
+
+  tls_->set([](Event::Dispatcher&) -> ThreadLocal::ThreadLocalObjectSharedPtr {
+    return std::make_shared<WorkerLimits>();
+  });
+}
+
+ConcurrencyLimit& AdaptiveConcurrencyFilterConfig::limit(const std::string& cluster) {
+  WorkerLimits& worker_limits = tls_->getTyped<WorkerLimits>();
+  const auto worker_limit = worker_limits.limits_.find(cluster);
+  if (worker_limit != worker_limits.limits_.end()) {
+    return *worker_limit->second;
+  }
+
+  ConcurrencyLimitSharedPtr limit;
+  {
+    std::lock_guard<std::mutex> lock(limits_lock_);
+    ConcurrencyLimitSharedPtr& shared_limit = limits_[cluster];
+    if (!shared_limit) {
+      const std::string prefix = fmt::format("{}adaptive_concurrency.{}.", stats_prefix_, cluster);
+      shared_limit = std::make_shared<ConcurrencyLimit>(
+          settings_,
+          AdaptiveConcurrencyStats{ALL_ADAPTIVE_CONCURRENCY_STATS(
+              POOL_COUNTER_PREFIX(scope_, prefix), POOL_GAUGE_PREFIX(scope_, prefix))},
+          time_source_.currentTime());
+    }
+    limit = shared_limit;
+  }
+  worker_limits.limits_.emplace(cluster, limit);
+  return *limit;
+}
+
+bool AdaptiveConcurrencyFilterConfig::enabled() const {
+  return runtime_.snapshot().featureEnabled(EnabledKey, 100);
+}
+
+AdaptiveConcurrencyFilter::AdaptiveConcurrencyFilter(
+    AdaptiveConcurrencyFilterConfigSharedPtr config)
+    : config_(config) {}
+
+void AdaptiveConcurrencyFilter::onDestroy() {
+  stream_destroyed_ = true;
+  release(false);
+}
+
+FilterHeadersStatus AdaptiveConcurrencyFilter::decodeHeaders(HeaderMap&, bool) {
+  Router::RouteConstSharedPtr route = decoder_callbacks_->route();
+  if (!config_->enabled() || route == nullptr || route->routeEntry() == nullptr) {
+    return FilterHeadersStatus::Continue;
+  }
+
+  ConcurrencyLimit& limit = config_->limit(route->routeEntry()->clusterName());
+  if (!limit.tryAcquire()) {
+    decoder_callbacks_->requestInfo().setResponseFlag(
+        RequestInfo::ResponseFlag::UpstreamOverflow);
+    Utility::sendLocalReply(
+        [this](HeaderMapPtr&& headers, bool end_stream) -> void {
+          headers->insertEnvoyOverloaded().value(Headers::get().EnvoyOverloadedValues.True);
+          decoder_callbacks_->encodeHeaders(std::move(headers), end_stream);
+        },
+        [this](Buffer::Instance& data, bool end_stream) -> void {
+          decoder_callbacks_->encodeData(data, end_stream);
+        },
+        stream_destroyed_, Code::ServiceUnavailable, "concurrency limit exceeded");
+    return FilterHeadersStatus::StopIteration;
+  }
+
+  limit_ = &limit;
+  start_time_ = config_->timeSource().currentTime();
+  return FilterHeadersStatus::Continue;
+}
+
+FilterHeadersStatus AdaptiveConcurrencyFilter::encodeHeaders(HeaderMap&, bool end_stream) {
+  if (end_stream) {
+    release(true);
+  }
+  return FilterHeadersStatus::Continue;
+}
+
+FilterDataStatus AdaptiveConcurrencyFilter::encodeData(Buffer::Instance&, bool end_stream) {
+  if (end_stream) {
+    release(true);
+  }
+  return FilterDataStatus::Continue;
+}
+
+FilterTrailersStatus AdaptiveConcurrencyFilter::encodeTrailers(HeaderMap&) {
+  release(true);
+  return FilterTrailersStatus::Continue;
+}
+
+void AdaptiveConcurrencyFilter::release(bool complete) {
+  if (limit_ == nullptr) {
+    return;
+  }
+
+  const MonotonicTime now = config_->timeSource().currentTime();
+  if (complete) {
+    const std::chrono::microseconds latency =
+        std::chrono::duration_cast<std::chrono::microseconds>(now - start_time_);
+    limit_->release(&latency, now);
+  } else {
+    limit_->release(nullptr, now);
+  }
+  limit_ = nullptr;
+}
+
+} // namespace Http
+} // namespace Envoy
@@ -0,0 +1,197 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+#include "envoy/common/time.h"
+#include "envoy/http/filter.h"
+#include "envoy/json/json_object.h"
+#include "envoy/runtime/runtime.h"
+#include "envoy/stats/stats.h"
+#include "envoy/stats/stats_macros.h"
+#include "envoy/thread_local/thread_local.h"
+
+namespace Envoy {
+namespace Http {
+
+/**
+ * All the stats of the limit of a cluster. @see stats_macros.h
+ */
+// clang-format off
+#define ALL_ADAPTIVE_CONCURRENCY_STATS(COUNTER, GAUGE)                                             \
+  COUNTER(rq_rejected)                                                                             \
+  GAUGE  (concurrency_limit)                                                                       \
+  GAUGE  (sample_rtt_us)                                                                           \
+  GAUGE  (long_rtt_us)
+// clang-format on
+
+/**
+ * Wrapper struct for adaptive concurrency stats. @see stats_macros.h
+ */
+struct AdaptiveConcurrencyStats {
+  ALL_ADAPTIVE_CONCURRENCY_STATS(GENERATE_COUNTER_STRUCT, GENERATE_GAUGE_STRUCT)
+};
+
+/**
+ * The settings of the concurrency limits.
+ */
+struct ConcurrencyLimitSettings {
+  uint32_t initial_limit_;
+  uint32_t min_limit_;
+  uint32_t max_limit_;
+  // How long latency samples are collected before the limit is updated, provided there are at
+  // least min_window_samples_ of them.
+  std::chrono::milliseconds window_;
+  uint64_t min_window_samples_;
+  // The weight of a new estimate in the limit, in (0, 1].
+  double smoothing_;
+  // How much higher than the long term latency the latency of a window may be before the limit
+  // is reduced.
+  double tolerance_;
+};
+
+/**
+ * The adaptive concurrency limit of a cluster, shared by all workers. The limit follows the
+ * gradient of the upstream latency, as in the Gradient2 limit of Netflix's concurrency-limits:
+ * each window, the average latency of the window is compared with a long term average of the
+ * latency. While they are within the tolerance the limit grows by about its square root, and
+ * the limit shrinks in proportion as the latency of the window rises above it. The limit does not
+ * grow while fewer than half of it is used.
+ *
+ * Admission and latency samples are lock free. The limit is updated by whichever worker completes
+ * a request once the window is over.
+ */
+class ConcurrencyLimit {
+public:
+  ConcurrencyLimit(const ConcurrencyLimitSettings& settings, AdaptiveConcurrencyStats stats,
+                   MonotonicTime now);
+
+  /**
+   * Admit a request if fewer requests than the limit are in flight.
+   * @return whether the request was admitted, in which case it must be released.
+   */
+  bool tryAcquire();
+
+  /**
+   * Release an admitted request.
+   * @param latency supplies the latency of the upstream response, or nullptr if the request did
+   *        not complete and does not make a sample.
+   * @param now supplies the current time.
+   */
+  void release(const std::chrono::microseconds* latency, MonotonicTime now);
+
+  uint32_t limit() const { return limit_; }
+  uint32_t inFlight() const { return in_flight_; }
+
+private:
+  void updateLimit(MonotonicTime now);
+
+  const ConcurrencyLimitSettings settings_;
+  AdaptiveConcurrencyStats stats_;
+  std::atomic<uint32_t> limit_;
+  std::atomic<uint32_t> in_flight_{};
+  // The most requests in flight during the window.
+  std::atomic<uint32_t> peak_in_flight_{};
+  std::atomic<uint64_t> window_samples_{};
+  std::atomic<uint64_t> window_latency_us_{};
+  std::atomic<MonotonicTime::rep> window_end_;
+  std::mutex update_lock_;
+  // Only accessed with update_lock_ held.
+  double estimated_limit_;
+  double long_rtt_us_{};
+};
+
+typedef std::shared_ptr<ConcurrencyLimit> ConcurrencyLimitSharedPtr;
+
+/**
+ * Configuration for the adaptive concurrency filter. It owns the limits of the clusters, created
+ * when a cluster is first routed to. Each worker caches the limits it has used.
+ */
+class AdaptiveConcurrencyFilterConfig {
+public:
+  AdaptiveConcurrencyFilterConfig(const Json::Object& json_config, const std::string& stats_prefix,
+                                  Stats::Scope& scope, Runtime::Loader& runtime,
+                                  ThreadLocal::SlotAllocator& tls,
+                                  MonotonicTimeSource& time_source);
+
+  /**
+   * @return the limit of a cluster.
+   */
+  ConcurrencyLimit& limit(const std::string& cluster);
+
+  bool enabled() const;
+  MonotonicTimeSource& timeSource() { return time_source_; }
+  const ConcurrencyLimitSettings& settings() const { return settings_; }
+
+private:
+  struct WorkerLimits : public ThreadLocal::ThreadLocalObject {
+    std::unordered_map<std::string, ConcurrencyLimitSharedPtr> limits_;
+  };
+
+  static const uint32_t DefaultInitialLimit = 100;
+  static const uint32_t DefaultMinLimit = 10;
+  static const uint32_t DefaultMaxLimit = 1000;
+  static const uint64_t DefaultWindowMs = 100;
+  static const uint64_t DefaultMinWindowSamples = 10;
+
+  ConcurrencyLimitSettings settings_;
+  const std::string stats_prefix_;
+  Stats::Scope& scope_;
+  Runtime::Loader& runtime_;
+  MonotonicTimeSource& time_source_;
+  std::mutex limits_lock_;
+  std::unordered_map<std::string, ConcurrencyLimitSharedPtr> limits_;
+  ThreadLocal::SlotPtr tls_;
+};
+
+typedef std::shared_ptr<AdaptiveConcurrencyFilterConfig> AdaptiveConcurrencyFilterConfigSharedPtr;
+
+/**
+ * A filter that limits the requests in flight to each upstream cluster to an adaptive concurrency
+ * limit. Requests over the limit of their cluster are rejected with a 503 from decodeHeaders(),
+ * before their body is read. The latency of an admitted request runs from decodeHeaders() to the
+ * end of the response, and requests that do not complete are not sampled.
+ */
+class AdaptiveConcurrencyFilter : public StreamFilter {
+public:
+  AdaptiveConcurrencyFilter(AdaptiveConcurrencyFilterConfigSharedPtr config);
+
+  // Http::StreamFilterBase
+  void onDestroy() override;
+
+  // Http::StreamDecoderFilter
+  FilterHeadersStatus decodeHeaders(HeaderMap& headers, bool end_stream) override;
+  FilterDataStatus decodeData(Buffer::Instance&, bool) override {
+    return FilterDataStatus::Continue;
+  }
+  FilterTrailersStatus decodeTrailers(HeaderMap&) override {
+    return FilterTrailersStatus::Continue;
+  }
+  void setDecoderFilterCallbacks(StreamDecoderFilterCallbacks& callbacks) override {
+    decoder_callbacks_ = &callbacks;
+  }
+
+  // Http::StreamEncoderFilter
+  FilterHeadersStatus encodeHeaders(HeaderMap& headers, bool end_stream) override;
+  FilterDataStatus encodeData(Buffer::Instance& data, bool end_stream) override;
+  FilterTrailersStatus encodeTrailers(HeaderMap& trailers) override;
+  void setEncoderFilterCallbacks(StreamEncoderFilterCallbacks&) override {}
+
+private:
+  void release(bool complete);
+
+  AdaptiveConcurrencyFilterConfigSharedPtr config_;
+  StreamDecoderFilterCallbacks* decoder_callbacks_{};
+  // Set while the request holds a slot of the limit of its cluster.
+  ConcurrencyLimit* limit_{};
+  MonotonicTime start_time_;
+  bool stream_destroyed_{};
+};
+
+} // namespace Http
+} // namespace Envoy
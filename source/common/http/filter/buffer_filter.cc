@@ -1,12 +1,18 @@
 #include "common/http/filter/buffer_filter.h"
 
+#include <unistd.h>
+
+#include <cerrno>
+#include <cstdlib>
 #include <string>
 
+#include "envoy/common/exception.h"
 #include "envoy/event/dispatcher.h"
 #include "envoy/event/timer.h"
 #include "envoy/http/codes.h"
 #include "envoy/stats/stats.h"
 
+#include "common/buffer/buffer_impl.h"
 #include "common/common/assert.h"
 #include "common/common/enum_to_int.h"
 #include "common/http/codes.h"
@@ -34,7 +40,11 @@ FilterHeadersStatus BufferFilter::decodeHeaders(HeaderMap&, bool end_stream) {
   }
 }
 
-FilterDataStatus BufferFilter::decodeData(Buffer::Instance&, bool end_stream) {
+FilterDataStatus BufferFilter::decodeData(Buffer::Instance& data, bool end_stream) {
+  if (config_->spill_threshold_bytes_ > 0) {
+    return spillingDecodeData(data, end_stream);
+  }
+
   if (end_stream) {
     resetInternalState();
     return FilterDataStatus::Continue;
@@ -45,6 +55,14 @@ FilterDataStatus BufferFilter::decodeData(Buffer::Instance&, bool end_stream) {
 }
 
 FilterTrailersStatus BufferFilter::decodeTrailers(HeaderMap&) {
+  if (config_->spill_threshold_bytes_ > 0 && (spill_fd_ != -1 || buffered_.length() > 0)) {
+    // Data added during decodeTrailers() is passed on right away, ahead of the headers this filter
+    // is still holding, so add the body back from a timer and continue from there.
+    replay_timer_ = callbacks_->dispatcher().createTimer([this]() -> void { onReplayBody(); });
+    replay_timer_->enableTimer(std::chrono::milliseconds(0));
+    return FilterTrailersStatus::StopIteration;
+  }
+
   resetInternalState();
   return FilterTrailersStatus::Continue;
 }
@@ -56,6 +74,7 @@ BufferFilterStats BufferFilter::generateStats(const std::string& prefix, Stats::
 
 void BufferFilter::onDestroy() {
   resetInternalState();
+  replay_timer_.reset();
   stream_destroyed_ = true;
 }
 
@@ -65,7 +84,124 @@ void BufferFilter::onRequestTimeout() {
   config_->stats_.rq_timeout_.inc();
 }
 
-void BufferFilter::resetInternalState() { request_timeout_.reset(); }
+void BufferFilter::resetInternalState() {
+  request_timeout_.reset();
+  closeSpillFile();
+  buffered_.drain(buffered_.length());
+}
+
+FilterDataStatus BufferFilter::spillingDecodeData(Buffer::Instance& data, bool end_stream) {
+  // The connection manager does not see the body, so the filter enforces the limit itself.
+  received_bytes_ += data.length();
+  if (received_bytes_ > config_->max_request_bytes_) {
+    resetInternalState();
+    Http::Utility::sendLocalReply(*callbacks_, stream_destroyed_, Http::Code::PayloadTooLarge,
+                                  CodeUtility::toString(Http::Code::PayloadTooLarge));
+    return FilterDataStatus::StopIterationNoBuffer;
+  }
+
+  if (spill_fd_ != -1 || buffered_.length() + data.length() > config_->spill_threshold_bytes_) {
+    spill(buffered_);
+    spill(data);
+  }
+  buffered_.move(data);
+  if (!end_stream) {
+    return FilterDataStatus::StopIterationNoBuffer;
+  }
+
+  if (!takeBody(data)) {
+    return FilterDataStatus::StopIterationNoBuffer;
+  }
+  resetInternalState();
+  return FilterDataStatus::Continue;
+}
+
+void BufferFilter::spill(Buffer::Instance& data) {
+  if (spill_failed_ || data.length() == 0) {
+    return;
+  }
+
+  if (spill_fd_ == -1) {
+    std::string path = config_->spill_directory_ + "/envoy_buffer_XXXXXX";
+    spill_fd_ = ::mkstemp(&path[0]);
+    if (spill_fd_ == -1) {
+      spill_failed_ = true;
+      config_->stats_.rq_spill_failed_.inc();
+      return;
+    }
+    // Nothing else needs the name, and the space is freed as soon as the file is closed.
+    ::unlink(path.c_str());
+    config_->stats_.rq_spilled_.inc();
+  }
+
+  // Whatever could not be written stays in data, after the bytes that made it to the file.
+  uint64_t num_slices = data.getRawSlices(nullptr, 0);
+  Buffer::RawSlice slices[num_slices];
+  data.getRawSlices(slices, num_slices);
+  uint64_t written = 0;
+  for (const Buffer::RawSlice& slice : slices) {
+    for (size_t offset = 0; offset < slice.len_;) {
+      const ssize_t rc =
+          ::write(spill_fd_, static_cast<const uint8_t*>(slice.mem_) + offset, slice.len_ - offset);
+      if (rc == -1 && errno == EINTR) {
+        continue;
+      }
+      if (rc <= 0) {
+        spill_failed_ = true;
+        config_->stats_.rq_spill_failed_.inc();
+        data.drain(written);
+        spilled_bytes_ += written;
+        return;
+      }
+      offset += rc;
+      written += rc;
+    }
+  }
+  data.drain(written);
+  spilled_bytes_ += written;
+}
+
+bool BufferFilter::takeBody(Buffer::Instance& body) {
+  if (spill_fd_ != -1) {
+    Buffer::FileFragmentImpl* fragment;
+    try {
+      // The fragment owns the file from here on, and closes it once the body has been sent.
+      fragment = new Buffer::FileFragmentImpl(spill_fd_, 0, spilled_bytes_,
+                                              [](const Buffer::FileFragmentImpl* released) {
+                                                ::close(released->fd());
+                                                delete released;
+                                              });
+    } catch (const EnvoyException&) {
+      config_->stats_.rq_spill_failed_.inc();
+      resetInternalState();
+      Http::Utility::sendLocalReply(*callbacks_, stream_destroyed_,
+                                    Http::Code::InternalServerError,
+                                    CodeUtility::toString(Http::Code::InternalServerError));
+      return false;
+    }
+    spill_fd_ = -1;
+    body.addBufferFragment(*fragment);
+  }
+  body.move(buffered_);
+  return true;
+}
+
+void BufferFilter::onReplayBody() {
+  Buffer::OwnedImpl body;
+  if (!takeBody(body)) {
+    return;
+  }
+  resetInternalState();
+  callbacks_->addDecodedData(body, false);
+  callbacks_->continueDecoding();
+}
+
+void BufferFilter::closeSpillFile() {
+  if (spill_fd_ != -1) {
+    ::close(spill_fd_);
+    spill_fd_ = -1;
+  }
+}
 
 void BufferFilter::setDecoderFilterCallbacks(StreamDecoderFilterCallbacks& callbacks) {
   callbacks_ = &callbacks;
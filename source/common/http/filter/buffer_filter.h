@@ -18,7 +18,9 @@ namespace Http {
  */
 // clang-format off
 #define ALL_BUFFER_FILTER_STATS(COUNTER)                                                           \
-  COUNTER(rq_timeout)
+  COUNTER(rq_timeout)                                                                              \
+  COUNTER(rq_spilled)                                                                              \
+  COUNTER(rq_spill_failed)
 // clang-format on
 
 /**
@@ -35,12 +37,22 @@ struct BufferFilterConfig {
   BufferFilterStats stats_;
   uint64_t max_request_bytes_;
   std::chrono::seconds max_request_time_;
+  // When non-zero, the filter buffers the body itself, and writes it to a temporary file in
+  // spill_directory_ once it grows past this many bytes.
+  uint64_t spill_threshold_bytes_;
+  std::string spill_directory_;
 };
 
 typedef std::shared_ptr<const BufferFilterConfig> BufferFilterConfigConstSharedPtr;
 
 /**
  * A filter that is capable of buffering an entire request before dispatching it upstream.
+ *
+ * By default the connection manager buffers the body. With a spill threshold, the filter keeps the
+ * body itself and moves it to an unlinked temporary file once it is larger than the threshold. The
+ * file is mapped back into the request as a single fragment when the request is complete, so
+ * memory use stays bounded while a slow client uploads, and the body can be sent upstream
+ * straight from the file.
  */
 class BufferFilter : public StreamDecoderFilter {
 public:
@@ -62,10 +74,26 @@ private:
   void onRequestTimeout();
   void resetInternalState();
 
+  // Spilling, used when the config has a spill threshold.
+  FilterDataStatus spillingDecodeData(Buffer::Instance& data, bool end_stream);
+  void spill(Buffer::Instance& data);
+  bool takeBody(Buffer::Instance& body);
+  void onReplayBody();
+  void closeSpillFile();
+
   BufferFilterConfigConstSharedPtr config_;
   StreamDecoderFilterCallbacks* callbacks_{};
   Event::TimerPtr request_timeout_;
   bool stream_destroyed_{};
+  // The body received so far is the first spilled_bytes_ bytes of the spill file, if there is
+  // one, followed by buffered_.
+  Buffer::OwnedImpl buffered_;
+  uint64_t received_bytes_{};
+  int spill_fd_{-1};
+  uint64_t spilled_bytes_{};
+  bool spill_failed_{};
+  // Adds the body back outside of the decodeTrailers() callback.
+  Event::TimerPtr replay_timer_;
 };
 
 } // Http
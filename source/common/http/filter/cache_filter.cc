@@ -0,0 +1,537 @@
+#include "common/http/filter/cache_filter.h"
+
+#include <algorithm>
+#include <cctype>
+#include <cstdlib>
+#include <limits>
+#include <string>
+#include <vector>
+
+#include "envoy/router/router.h"
+
+#include "common/buffer/buffer_impl.h"
+#include "common/common/assert.h"
+#include "common/common/utility.h"
+#include "common/http/headers.h"
+#include "common/http/utility.h"
+#include "common/json/config_schemas.h"
+
+namespace Envoy {
+namespace Http {
+
+namespace {
+
+// Runtime keys.
+const std::string EnabledKey = "cache.enabled";
+
+// Route opaque config keys.
+const std::string RouteCacheKey = "cache";
+const std::string RouteTtlKey = "cache_ttl_ms";
+
+std::string trim(const std::string& source) {
+  const size_t start = source.find_first_not_of(" \t");
+  if (start == std::string::npos) {
+    return "";
+  }
+  const size_t end = source.find_last_not_of(" \t");
+  return source.substr(start, end - start + 1);
+}
+
+std::string toLower(std::string source) {
+  std::transform(source.begin(), source.end(), source.begin(),
+                 [](unsigned char c) -> char { return std::tolower(c); });
+  return source;
+}
+
+// The statuses whose responses are cacheable by default, per RFC 7231 section 6.1. 206 is left
+// out as range requests are not handled.
+bool cacheableStatus(uint64_t status) {
+  switch (status) {
+  case 200:
+  case 203:
+  case 204:
+  case 300:
+  case 301:
+  case 404:
+  case 405:
+  case 410:
+  case 414:
+  case 501:
+    return true;
+  default:
+    return false;
+  }
+}
+
+int64_t deltaSeconds(const std::string& value) {
+  uint64_t seconds;
+  if (!StringUtil::atoul(value.c_str(), seconds)) {
+    return -1;
+  }
+  return std::min<uint64_t>(seconds, std::numeric_limits<int32_t>::max());
+}
+
+} // namespace
+
+CacheControl CacheControl::parse(const std::string& value) {
+  CacheControl cache_control;
+  for (const std::string& directive : StringUtil::split(value, ',')) {
+    const size_t equals = directive.find('=');
+    const std::string name = toLower(trim(directive.substr(0, equals)));
+    std::string argument;
+    if (equals != std::string::npos) {
+      argument = trim(directive.substr(equals + 1));
+      if (argument.size() >= 2 && argument.front() == '"' && argument.back() == '"') {
+        argument = argument.substr(1, argument.size() - 2);
+      }
+    }
+
+    if (name == "no-store") {
+      cache_control.no_store_ = true;
+    } else if (name == "no-cache") {
+      cache_control.no_cache_ = true;
+    } else if (name == "private") {
+      cache_control.private_ = true;
+    } else if (name == "max-age") {
+      cache_control.max_age_ = deltaSeconds(argument);
+    } else if (name == "s-maxage") {
+      cache_control.s_maxage_ = deltaSeconds(argument);
+    }
+  }
+  return cache_control;
+}
+
+CachedResponse::CachedResponse(const HeaderMap& request_headers, const HeaderMap& response_headers,
+                               const std::vector<LowerCaseString>& vary, MonotonicTime received_at,
+                               MonotonicTime expires_at, std::chrono::seconds age)
+    : headers_(response_headers), received_at_(received_at), expires_at_(expires_at), age_(age) {
+  headers_.remove(Headers::get().Age);
+  for (const LowerCaseString& header : vary) {
+    const HeaderEntry* entry = request_headers.get(header);
+    vary_.emplace_back(header, entry != nullptr ? entry->value().c_str() : "");
+  }
+}
+
+bool CachedResponse::matches(const HeaderMap& request_headers) const {
+  for (const auto& header : vary_) {
+    const HeaderEntry* entry = request_headers.get(header.first);
+    if (header.second != (entry != nullptr ? entry->value().c_str() : "")) {
+      return false;
+    }
+  }
+  return true;
+}
+
+HeaderMapPtr CachedResponse::headers(MonotonicTime now) const {
+  HeaderMapPtr headers(new HeaderMapImpl(static_cast<const HeaderMap&>(headers_)));
+  const auto age = age_ + std::chrono::duration_cast<std::chrono::seconds>(now - received_at_);
+  headers->addCopy(Headers::get().Age, static_cast<uint64_t>(age.count()));
+  return headers;
+}
+
+void CachedResponse::appendBody(const Buffer::Instance& data) {
+  const uint64_t num_slices = data.getRawSlices(nullptr, 0);
+  Buffer::RawSlice slices[num_slices];
+  data.getRawSlices(slices, num_slices);
+  for (uint64_t i = 0; i < num_slices; i++) {
+    body_.append(static_cast<const char*>(slices[i].mem_), slices[i].len_);
+  }
+}
+
+const size_t ResponseStore::MaxVariants;
+
+ResponseStore::ResponseStore(uint64_t max_responses, uint64_t max_bytes,
+                             Stats::Counter& evictions, Stats::Gauge& responses,
+                             Stats::Gauge& bytes)
+    : max_responses_(max_responses), max_bytes_(max_bytes), evictions_(evictions),
+      responses_gauge_(responses), bytes_gauge_(bytes) {}
+
+CachedResponseConstSharedPtr ResponseStore::lookup(const std::string& key,
+                                                   const HeaderMap& request_headers,
+                                                   MonotonicTime now) {
+  const auto found = entries_.find(key);
+  if (found == entries_.end()) {
+    return nullptr;
+  }
+
+  Entry& entry = *found->second;
+  CachedResponseConstSharedPtr response;
+  for (size_t i = entry.variants_.size(); i > 0; i--) {
+    if (!entry.variants_[i - 1]->fresh(now)) {
+      removeVariant(entry, i - 1);
+    } else if (!response && entry.variants_[i - 1]->matches(request_headers)) {
+      response = entry.variants_[i - 1];
+    }
+  }
+
+  if (entry.variants_.empty()) {
+    removeEntry(found->second);
+  } else if (response) {
+    lru_.splice(lru_.begin(), lru_, found->second);
+  }
+  return response;
+}
+
+void ResponseStore::insert(const std::string& key, CachedResponseConstSharedPtr response) {
+  const uint64_t size = response->byteSize();
+  if (size > max_bytes_) {
+    return;
+  }
+
+  auto found = entries_.find(key);
+  if (found == entries_.end()) {
+    lru_.emplace_front(key);
+    found = entries_.emplace(key, lru_.begin()).first;
+  } else {
+    lru_.splice(lru_.begin(), lru_, found->second);
+  }
+
+  // Variants are ordered from the least to the most recently stored.
+  Entry& entry = *found->second;
+  for (size_t i = 0; i < entry.variants_.size(); i++) {
+    if (entry.variants_[i]->sameVariant(*response)) {
+      removeVariant(entry, i);
+      break;
+    }
+  }
+  if (entry.variants_.size() == MaxVariants) {
+    removeVariant(entry, 0);
+    evictions_.inc();
+  }
+  entry.variants_.push_back(response);
+  responses_++;
+  bytes_ += size;
+  responses_gauge_.inc();
+  bytes_gauge_.add(size);
+
+  while (responses_ > max_responses_ || bytes_ > max_bytes_) {
+    ASSERT(!lru_.empty());
+    evictions_.add(lru_.back().variants_.size());
+    removeEntry(std::prev(lru_.end()));
+  }
+}
+
+void ResponseStore::removeVariant(Entry& entry, size_t index) {
+  const uint64_t size = entry.variants_[index]->byteSize();
+  entry.variants_.erase(entry.variants_.begin() + index);
+  responses_--;
+  bytes_ -= size;
+  responses_gauge_.dec();
+  bytes_gauge_.sub(size);
+}
+
+void ResponseStore::removeEntry(EntryIterator entry) {
+  while (!entry->variants_.empty()) {
+    removeVariant(*entry, entry->variants_.size() - 1);
+  }
+  entries_.erase(entry->key_);
+  lru_.erase(entry);
+}
+
+SharedResponseStore::SharedResponseStore(uint64_t max_bytes, CacheFilterStats& stats)
+    : store_(std::numeric_limits<uint64_t>::max(), max_bytes, stats.eviction_,
+             stats.shared_cached_responses_, stats.shared_cached_bytes_) {}
+
+CachedResponseConstSharedPtr SharedResponseStore::lookup(const std::string& key,
+                                                         const HeaderMap& request_headers,
+                                                         MonotonicTime now) {
+  std::unique_lock<std::mutex> lock(lock_);
+  return store_.lookup(key, request_headers, now);
+}
+
+void SharedResponseStore::insert(const std::string& key, CachedResponseConstSharedPtr response) {
+  std::unique_lock<std::mutex> lock(lock_);
+  store_.insert(key, response);
+}
+
+const uint64_t CacheFilterConfig::DefaultMaxResponses;
+const uint64_t CacheFilterConfig::DefaultMaxBytes;
+const uint64_t CacheFilterConfig::DefaultMaxBodyBytes;
+
+CacheFilterConfig::CacheFilterConfig(const Json::Object& json_config,
+                                     const std::string& stats_prefix, Stats::Scope& scope,
+                                     Runtime::Loader& runtime, ThreadLocal::SlotAllocator& tls,
+                                     MonotonicTimeSource& time_source)
+    : runtime_(runtime), time_source_(time_source),
+      stats_(generateStats(stats_prefix, scope)), tls_(tls.allocateSlot()) {
+  json_config.validateSchema(Json::Schema::CACHE_HTTP_FILTER_SCHEMA);
+
+  const uint64_t max_responses = json_config.getInteger("max_responses", DefaultMaxResponses);
+  const uint64_t max_bytes = json_config.getInteger("max_bytes", DefaultMaxBytes);
+  const uint64_t shared_max_bytes = json_config.getInteger("shared_max_bytes", 0);
+  max_body_bytes_ = json_config.getInteger("max_body_bytes", DefaultMaxBodyBytes);
+  default_ttl_ = std::chrono::milliseconds(json_config.getInteger("default_ttl_ms", 0));
+
+  if (shared_max_bytes > 0) {
+    shared_store_.reset(new SharedResponseStore(shared_max_bytes, stats_));
+  }
+
+  CacheFilterStats& stats = stats_;
+  tls_->set([max_responses, max_bytes,
+             &stats](Event::Dispatcher&) -> ThreadLocal::ThreadLocalObjectSharedPtr {
+    return std::make_shared<WorkerCache>(max_responses, max_bytes, stats);
+  });
+}
+
+CacheFilterStats CacheFilterConfig::generateStats(const std::string& prefix,
+                                                  Stats::Scope& scope) {
+  const std::string final_prefix = prefix + "cache.";
+  return {ALL_CACHE_FILTER_STATS(POOL_COUNTER_PREFIX(scope, final_prefix),
+                                 POOL_GAUGE_PREFIX(scope, final_prefix))};
+}
+
+CacheFilter::CacheFilter(CacheFilterConfigSharedPtr config) : config_(config) {}
+
+std::string CacheFilter::key(const HeaderMap& request_headers) {
+  std::string key;
+  if (request_headers.Host() != nullptr) {
+    key = request_headers.Host()->value().c_str();
+  }
+  if (request_headers.Path() != nullptr) {
+    key += request_headers.Path()->value().c_str();
+  }
+  return key;
+}
+
+void CacheFilter::onDestroy() {
+  if (fetch_) {
+    abandonFetch();
+  }
+  if (waiting_on_ != nullptr) {
+    waiting_on_->waiters_.erase(waiter_entry_);
+    waiting_on_ = nullptr;
+  }
+}
+
+FilterHeadersStatus CacheFilter::decodeHeaders(HeaderMap& headers, bool end_stream) {
+  if (!config_->runtime().snapshot().featureEnabled(EnabledKey, 100) || !end_stream ||
+      headers.Method() == nullptr || !routeAllowsCaching(default_ttl_)) {
+    return FilterHeadersStatus::Continue;
+  }
+
+  const std::string method = headers.Method()->value().c_str();
+  head_request_ = method == Headers::get().MethodValues.Head;
+  if (!head_request_ && method != Headers::get().MethodValues.Get) {
+    return FilterHeadersStatus::Continue;
+  }
+
+  // Requests asking for a response from the origin, and authorized requests whose responses
+  // cannot be shared with other clients, bypass the cache.
+  bool bypass = headers.Authorization() != nullptr;
+  if (headers.CacheControl() != nullptr) {
+    const CacheControl cache_control = CacheControl::parse(headers.CacheControl()->value().c_str());
+    bypass |= cache_control.no_store_ || cache_control.no_cache_ || cache_control.max_age_ == 0;
+  }
+  const HeaderEntry* pragma = headers.get(Headers::get().Pragma);
+  bypass |= pragma != nullptr &&
+            toLower(pragma->value().c_str()).find(Headers::get().PragmaValues.NoCache) !=
+                std::string::npos;
+  if (bypass) {
+    config_->stats().bypass_.inc();
+    return FilterHeadersStatus::Continue;
+  }
+
+  request_headers_ = &headers;
+  key_ = key(headers);
+  const MonotonicTime now = config_->timeSource().currentTime();
+  CachedResponseConstSharedPtr response = lookup(headers, now);
+  if (response) {
+    config_->stats().hit_.inc();
+    serve(*response, now);
+    return FilterHeadersStatus::StopIteration;
+  }
+
+  config_->stats().miss_.inc();
+  if (head_request_) {
+    // The response to a HEAD request has no body to cache.
+    return FilterHeadersStatus::Continue;
+  }
+
+  auto& in_flight = config_->workerCache().inFlight();
+  const auto fetch = in_flight.find(key_);
+  if (fetch != in_flight.end()) {
+    config_->stats().coalesced_.inc();
+    waiting_on_ = fetch->second;
+    waiter_entry_ = waiting_on_->waiters_.insert(waiting_on_->waiters_.end(), this);
+    return FilterHeadersStatus::StopIteration;
+  }
+
+  fetch_.reset(new InFlightFetch());
+  in_flight.emplace(key_, fetch_.get());
+  return FilterHeadersStatus::Continue;
+}
+
+FilterHeadersStatus CacheFilter::encodeHeaders(HeaderMap& headers, bool end_stream) {
+  if (!fetch_) {
+    return FilterHeadersStatus::Continue;
+  }
+
+  response_ = newResponse(headers);
+  if (!response_) {
+    config_->stats().uncacheable_.inc();
+    abandonFetch();
+  } else if (end_stream) {
+    completeFetch();
+  }
+  return FilterHeadersStatus::Continue;
+}
+
+FilterDataStatus CacheFilter::encodeData(Buffer::Instance& data, bool end_stream) {
+  if (!response_) {
+    return FilterDataStatus::Continue;
+  }
+
+  if (response_->body().size() + data.length() > config_->maxBodyBytes()) {
+    config_->stats().uncacheable_.inc();
+    abandonFetch();
+    return FilterDataStatus::Continue;
+  }
+  response_->appendBody(data);
+  if (end_stream) {
+    completeFetch();
+  }
+  return FilterDataStatus::Continue;
+}
+
+FilterTrailersStatus CacheFilter::encodeTrailers(HeaderMap&) {
+  // Trailers are not stored, so responses that have them are not cached.
+  if (fetch_) {
+    config_->stats().uncacheable_.inc();
+    abandonFetch();
+  }
+  return FilterTrailersStatus::Continue;
+}
+
+bool CacheFilter::routeAllowsCaching(std::chrono::milliseconds& default_ttl) {
+  default_ttl = config_->defaultTtl();
+  const Router::RouteConstSharedPtr route = decoder_callbacks_->route();
+  if (route == nullptr || route->routeEntry() == nullptr) {
+    return true;
+  }
+
+  const std::multimap<std::string, std::string>& opaque_config =
+      route->routeEntry()->opaqueConfig();
+  const auto enabled = opaque_config.find(RouteCacheKey);
+  if (enabled != opaque_config.end() && enabled->second == "false") {
+    return false;
+  }
+  const auto ttl = opaque_config.find(RouteTtlKey);
+  uint64_t ttl_ms;
+  if (ttl != opaque_config.end() && StringUtil::atoul(ttl->second.c_str(), ttl_ms)) {
+    default_ttl = std::chrono::milliseconds(ttl_ms);
+  }
+  return true;
+}
+
+CachedResponseConstSharedPtr CacheFilter::lookup(const HeaderMap& request_headers,
+                                                 MonotonicTime now) {
+  WorkerCache& worker_cache = config_->workerCache();
+  CachedResponseConstSharedPtr response = worker_cache.store().lookup(key_, request_headers, now);
+  SharedResponseStore* shared_store = config_->sharedStore();
+  if (!response && shared_store != nullptr) {
+    response = shared_store->lookup(key_, request_headers, now);
+    if (response) {
+      config_->stats().shared_hit_.inc();
+      worker_cache.store().insert(key_, response);
+    }
+  }
+  return response;
+}
+
+CachedResponseSharedPtr CacheFilter::newResponse(const HeaderMap& response_headers) {
+  if (!cacheableStatus(Utility::getResponseStatus(response_headers)) ||
+      response_headers.get(Headers::get().SetCookie) != nullptr) {
+    return nullptr;
+  }
+
+  std::chrono::milliseconds ttl = default_ttl_;
+  if (response_headers.CacheControl() != nullptr) {
+    const CacheControl cache_control =
+        CacheControl::parse(response_headers.CacheControl()->value().c_str());
+    if (cache_control.no_store_ || cache_control.no_cache_ || cache_control.private_) {
+      return nullptr;
+    }
+    if (cache_control.s_maxage_ >= 0) {
+      ttl = std::chrono::seconds(cache_control.s_maxage_);
+    } else if (cache_control.max_age_ >= 0) {
+      ttl = std::chrono::seconds(cache_control.max_age_);
+    }
+  }
+
+  std::chrono::seconds age(0);
+  const HeaderEntry* age_header = response_headers.get(Headers::get().Age);
+  if (age_header != nullptr) {
+    age = std::chrono::seconds(std::max<int64_t>(0, deltaSeconds(age_header->value().c_str())));
+  }
+  if (ttl <= age) {
+    return nullptr;
+  }
+
+  std::vector<LowerCaseString> vary;
+  const HeaderEntry* vary_header = response_headers.get(Headers::get().Vary);
+  if (vary_header != nullptr) {
+    for (const std::string& header : StringUtil::split(vary_header->value().c_str(), ',')) {
+      const std::string name = toLower(trim(header));
+      if (name == "*") {
+        return nullptr;
+      }
+      if (!name.empty()) {
+        vary.emplace_back(name);
+      }
+    }
+  }
+
+  const MonotonicTime now = config_->timeSource().currentTime();
+  return std::make_shared<CachedResponse>(*request_headers_, response_headers, vary, now,
+                                          now + ttl - age, age);
+}
+
+void CacheFilter::serve(const CachedResponse& response, MonotonicTime now) {
+  const bool end_stream = head_request_ || response.body().empty();
+  decoder_callbacks_->encodeHeaders(response.headers(now), end_stream);
+  if (!end_stream) {
+    Buffer::OwnedImpl body(response.body());
+    decoder_callbacks_->encodeData(body, true);
+  }
+}
+
+void CacheFilter::onFetchComplete(const CachedResponseConstSharedPtr& response) {
+  if (response && response->matches(*request_headers_)) {
+    config_->stats().hit_.inc();
+    serve(*response, config_->timeSource().currentTime());
+  } else {
+    // The response cannot be shared with this request, which fetches its own.
+    decoder_callbacks_->continueDecoding();
+  }
+}
+
+void CacheFilter::completeFetch() {
+  CachedResponseConstSharedPtr response = std::move(response_);
+  config_->workerCache().store().insert(key_, response);
+  if (config_->sharedStore() != nullptr) {
+    config_->sharedStore()->insert(key_, response);
+  }
+  config_->stats().insert_.inc();
+  finishFetch(response);
+}
+
+void CacheFilter::abandonFetch() {
+  response_.reset();
+  finishFetch(nullptr);
+}
+
+void CacheFilter::finishFetch(const CachedResponseConstSharedPtr& response) {
+  config_->workerCache().inFlight().erase(key_);
+  // The fetch stays alive while the waiters are notified, so that those destroyed meanwhile can
+  // still remove themselves from it.
+  std::unique_ptr<InFlightFetch> fetch = std::move(fetch_);
+  while (!fetch->waiters_.empty()) {
+    CacheFilter* waiter = fetch->waiters_.front();
+    fetch->waiters_.pop_front();
+    waiter->waiting_on_ = nullptr;
+    waiter->onFetchComplete(response);
+  }
+}
+
+} // namespace Http
+} // namespace Envoy
@@ -0,0 +1,320 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "envoy/common/time.h"
+#include "envoy/http/filter.h"
+#include "envoy/json/json_object.h"
+#include "envoy/runtime/runtime.h"
+#include "envoy/stats/stats_macros.h"
+#include "envoy/thread_local/thread_local.h"
+
+#include "common/http/header_map_impl.h"
+
+namespace Envoy {
+namespace Http {
+
+/**
+ * All stats for the cache filter. The hit ratio is hit / (hit + miss). @see stats_macros.h
+ */
+// clang-format off
+#define ALL_CACHE_FILTER_STATS(COUNTER, GAUGE)                                                     \
+  COUNTER(hit)                                                                                     \
+  COUNTER(shared_hit)                                                                              \
+  COUNTER(miss)                                                                                    \
+  COUNTER(coalesced)                                                                               \
+  COUNTER(bypass)                                                                                  \
+  COUNTER(uncacheable)                                                                             \
+  COUNTER(insert)                                                                                  \
+  COUNTER(eviction)                                                                                \
+  GAUGE  (cached_responses)                                                                        \
+  GAUGE  (cached_bytes)                                                                            \
+  GAUGE  (shared_cached_responses)                                                                 \
+  GAUGE  (shared_cached_bytes)
+// clang-format on
+
+/**
+ * Wrapper struct for cache filter stats. @see stats_macros.h
+ */
+struct CacheFilterStats {
+  ALL_CACHE_FILTER_STATS(GENERATE_COUNTER_STRUCT, GENERATE_GAUGE_STRUCT)
+};
+
+/**
+ * The directives of a Cache-Control header that the cache acts on.
+ */
+struct CacheControl {
+  /**
+   * Parse a Cache-Control header value. Unknown directives are ignored.
+   */
+  static CacheControl parse(const std::string& value);
+
+  bool no_store_{};
+  bool no_cache_{};
+  bool private_{};
+  // The max-age and s-maxage directives if present, else -1.
+  int64_t max_age_{-1};
+  int64_t s_maxage_{-1};
+};
+
+/**
+ * A response stored in the cache. It is immutable once stored, so that the worker caches and the
+ * shared store can hold the same response.
+ */
+class CachedResponse {
+public:
+  /**
+   * @param request_headers supplies the headers of the request the response was fetched for.
+   * @param response_headers supplies the headers of the response.
+   * @param vary supplies the request headers the response varies on.
+   * @param expires_at supplies the time at which the response becomes stale.
+   * @param age supplies the age of the response when it was received.
+   */
+  CachedResponse(const HeaderMap& request_headers, const HeaderMap& response_headers,
+                 const std::vector<LowerCaseString>& vary, MonotonicTime received_at,
+                 MonotonicTime expires_at, std::chrono::seconds age);
+
+  /**
+   * @return whether the response can be served for a request.
+   */
+  bool matches(const HeaderMap& request_headers) const;
+
+  /**
+   * @return whether the response was fetched with the same values of the headers it varies on
+   *         as another response, in which case it replaces it.
+   */
+  bool sameVariant(const CachedResponse& other) const { return vary_ == other.vary_; }
+
+  /**
+   * @return a copy of the response headers with an Age header for the given time.
+   */
+  HeaderMapPtr headers(MonotonicTime now) const;
+
+  bool fresh(MonotonicTime now) const { return now < expires_at_; }
+  void appendBody(const Buffer::Instance& data);
+  const std::string& body() const { return body_; }
+  uint64_t byteSize() const { return headers_.byteSize() + body_.size(); }
+
+private:
+  HeaderMapImpl headers_;
+  std::string body_;
+  // The request headers the response varies on and their values in the original request. A
+  // header missing from the request is recorded as empty.
+  std::vector<std::pair<LowerCaseString, std::string>> vary_;
+  const MonotonicTime received_at_;
+  const MonotonicTime expires_at_;
+  const std::chrono::seconds age_;
+};
+
+typedef std::shared_ptr<const CachedResponse> CachedResponseConstSharedPtr;
+typedef std::shared_ptr<CachedResponse> CachedResponseSharedPtr;
+
+/**
+ * A least recently used set of responses bounded by count and by size. Each key holds up to
+ * MaxVariants responses that differ in the request headers they vary on. Not thread safe.
+ */
+class ResponseStore {
+public:
+  ResponseStore(uint64_t max_responses, uint64_t max_bytes, Stats::Counter& evictions,
+                Stats::Gauge& responses, Stats::Gauge& bytes);
+
+  /**
+   * @return the fresh response stored under a key that matches a request, or nullptr. Stale
+   *         responses found along the way are dropped.
+   */
+  CachedResponseConstSharedPtr lookup(const std::string& key, const HeaderMap& request_headers,
+                                      MonotonicTime now);
+
+  /**
+   * Store a response, replacing the one of the same variant if any, and evict the least recently
+   * used responses beyond the bounds. Responses larger than the size bound are not stored.
+   */
+  void insert(const std::string& key, CachedResponseConstSharedPtr response);
+
+  uint64_t responses() const { return responses_; }
+  uint64_t bytes() const { return bytes_; }
+
+  static const size_t MaxVariants = 8;
+
+private:
+  struct Entry {
+    Entry(const std::string& key) : key_(key) {}
+
+    const std::string key_;
+    std::vector<CachedResponseConstSharedPtr> variants_;
+  };
+
+  typedef std::list<Entry>::iterator EntryIterator;
+
+  void removeVariant(Entry& entry, size_t index);
+  void removeEntry(EntryIterator entry);
+
+  const uint64_t max_responses_;
+  const uint64_t max_bytes_;
+  Stats::Counter& evictions_;
+  Stats::Gauge& responses_gauge_;
+  Stats::Gauge& bytes_gauge_;
+  uint64_t responses_{};
+  uint64_t bytes_{};
+  // Ordered from most to least recently used.
+  std::list<Entry> lru_;
+  std::unordered_map<std::string, EntryIterator> entries_;
+};
+
+/**
+ * A ResponseStore shared by all workers and guarded by a mutex.
+ */
+class SharedResponseStore {
+public:
+  SharedResponseStore(uint64_t max_bytes, CacheFilterStats& stats);
+
+  CachedResponseConstSharedPtr lookup(const std::string& key, const HeaderMap& request_headers,
+                                      MonotonicTime now);
+  void insert(const std::string& key, CachedResponseConstSharedPtr response);
+
+private:
+  std::mutex lock_;
+  ResponseStore store_;
+};
+
+class CacheFilter;
+
+/**
+ * A request whose response is being fetched from upstream, and the requests for the same key that
+ * wait for it rather than going upstream themselves.
+ */
+struct InFlightFetch {
+  std::list<CacheFilter*> waiters_;
+};
+
+/**
+ * The cache of a worker: its responses and the fetches in flight on the worker.
+ */
+class WorkerCache : public ThreadLocal::ThreadLocalObject {
+public:
+  WorkerCache(uint64_t max_responses, uint64_t max_bytes, CacheFilterStats& stats)
+      : store_(max_responses, max_bytes, stats.eviction_, stats.cached_responses_,
+               stats.cached_bytes_) {}
+
+  ResponseStore& store() { return store_; }
+  std::unordered_map<std::string, InFlightFetch*>& inFlight() { return in_flight_; }
+
+private:
+  ResponseStore store_;
+  std::unordered_map<std::string, InFlightFetch*> in_flight_;
+};
+
+/**
+ * Configuration for the cache filter.
+ */
+class CacheFilterConfig {
+public:
+  CacheFilterConfig(const Json::Object& json_config, const std::string& stats_prefix,
+                    Stats::Scope& scope, Runtime::Loader& runtime, ThreadLocal::SlotAllocator& tls,
+                    MonotonicTimeSource& time_source);
+
+  WorkerCache& workerCache() { return tls_->getTyped<WorkerCache>(); }
+  // nullptr if the configuration has no shared store.
+  SharedResponseStore* sharedStore() { return shared_store_.get(); }
+  uint64_t maxBodyBytes() const { return max_body_bytes_; }
+  std::chrono::milliseconds defaultTtl() const { return default_ttl_; }
+  Runtime::Loader& runtime() { return runtime_; }
+  MonotonicTimeSource& timeSource() { return time_source_; }
+  CacheFilterStats& stats() { return stats_; }
+
+  static const uint64_t DefaultMaxResponses = 1000;
+  static const uint64_t DefaultMaxBytes = 64 * 1024 * 1024;
+  static const uint64_t DefaultMaxBodyBytes = 1024 * 1024;
+
+private:
+  static CacheFilterStats generateStats(const std::string& prefix, Stats::Scope& scope);
+
+  uint64_t max_body_bytes_;
+  std::chrono::milliseconds default_ttl_;
+  Runtime::Loader& runtime_;
+  MonotonicTimeSource& time_source_;
+  CacheFilterStats stats_;
+  std::unique_ptr<SharedResponseStore> shared_store_;
+  ThreadLocal::SlotPtr tls_;
+};
+
+typedef std::shared_ptr<CacheFilterConfig> CacheFilterConfigSharedPtr;
+
+/**
+ * A filter that serves GET and HEAD requests from a cache of upstream responses, honoring the
+ * Cache-Control and Vary headers. Responses are looked up in the cache of the worker, then in the
+ * shared store if configured. A hit is served from decodeHeaders(). On a miss, the request fetches
+ * the response upstream and the requests for the same key arriving meanwhile on the worker wait
+ * for it instead of fetching it again.
+ *
+ * Routes can turn the cache off with the "cache" opaque config key set to "false", and set the
+ * lifetime of the responses that do not specify one with the "cache_ttl_ms" key.
+ */
+class CacheFilter : public StreamFilter {
+public:
+  CacheFilter(CacheFilterConfigSharedPtr config);
+
+  /**
+   * @return the key responses to a request are stored under.
+   */
+  static std::string key(const HeaderMap& request_headers);
+
+  // Http::StreamFilterBase
+  void onDestroy() override;
+
+  // Http::StreamDecoderFilter
+  FilterHeadersStatus decodeHeaders(HeaderMap& headers, bool end_stream) override;
+  FilterDataStatus decodeData(Buffer::Instance&, bool) override {
+    return FilterDataStatus::Continue;
+  }
+  FilterTrailersStatus decodeTrailers(HeaderMap&) override {
+    return FilterTrailersStatus::Continue;
+  }
+  void setDecoderFilterCallbacks(StreamDecoderFilterCallbacks& callbacks) override {
+    decoder_callbacks_ = &callbacks;
+  }
+
+  // Http::StreamEncoderFilter
+  FilterHeadersStatus encodeHeaders(HeaderMap& headers, bool end_stream) override;
+  FilterDataStatus encodeData(Buffer::Instance& data, bool end_stream) override;
+  FilterTrailersStatus encodeTrailers(HeaderMap& trailers) override;
+  void setEncoderFilterCallbacks(StreamEncoderFilterCallbacks&) override {}
+
+private:
+  // Whether the route allows caching, and the lifetime of the responses from the route that do
+  // not specify one.
+  bool routeAllowsCaching(std::chrono::milliseconds& default_ttl);
+  CachedResponseConstSharedPtr lookup(const HeaderMap& request_headers, MonotonicTime now);
+  // The response to store, or nullptr if the response is not cacheable.
+  CachedResponseSharedPtr newResponse(const HeaderMap& response_headers);
+  void serve(const CachedResponse& response, MonotonicTime now);
+  // Called on a waiting request when the fetch it waits for completes.
+  void onFetchComplete(const CachedResponseConstSharedPtr& response);
+  void completeFetch();
+  void abandonFetch();
+  void finishFetch(const CachedResponseConstSharedPtr& response);
+
+  CacheFilterConfigSharedPtr config_;
+  StreamDecoderFilterCallbacks* decoder_callbacks_{};
+  const HeaderMap* request_headers_{};
+  std::string key_;
+  std::chrono::milliseconds default_ttl_{};
+  bool head_request_{};
+  // Set while the request fetches the response others may be waiting for.
+  std::unique_ptr<InFlightFetch> fetch_;
+  CachedResponseSharedPtr response_;
+  // Set while the request waits for the fetch of another request.
+  InFlightFetch* waiting_on_{};
+  std::list<CacheFilter*>::iterator waiter_entry_;
+};
+
+} // namespace Http
+} // namespace Envoy
@@ -61,6 +61,42 @@ FaultFilterConfig::FaultFilterConfig(const envoy::api::v2::filter::http::HTTPFau
   }
 }
 
+bool FaultFilterConfig::faultsDisabled(const Runtime::Snapshot& snapshot) {
+  if (abort_percent_ > 0 || fixed_delay_percent_ > 0) {
+    return false;
+  }
+
+  const uint64_t version = snapshot.version();
+  uint64_t state = faults_disabled_state_.load(std::memory_order_relaxed);
+  if (state == UNKNOWN_FAULTS_DISABLED_STATE || state >> 1 != version) {
+    state = version << 1 | (runtimeEnablesFaults(snapshot) ? 0 : 1);
+    faults_disabled_state_.store(state, std::memory_order_relaxed);
+  }
+  return state & 1;
+}
+
+bool FaultFilterConfig::runtimeEnablesFaults(const Runtime::Snapshot& snapshot) {
+  // Both the global percentage keys and the per downstream cluster ones, e.g.
+  // fault.http.<cluster>.abort.abort_percent, count. A percentage of 0, or one that is not an
+  // integer and falls back to the config's 0, never enables a fault.
+  static const std::string prefix = "fault.http.";
+  static const std::string suffixes[] = {"delay.fixed_delay_percent", "abort.abort_percent"};
+  for (const auto& entry : snapshot.getAll()) {
+    const std::string& key = entry.first;
+    if (key.compare(0, prefix.size(), prefix) != 0 || !entry.second.uint_value_.valid() ||
+        entry.second.uint_value_.value() == 0) {
+      continue;
+    }
+    for (const std::string& suffix : suffixes) {
+      if (key.size() >= prefix.size() + suffix.size() &&
+          key.compare(key.size() - suffix.size(), suffix.size(), suffix) == 0) {
+        return true;
+      }
+    }
+  }
+  return false;
+}
+
 FaultFilter::FaultFilter(FaultFilterConfigSharedPtr config) : config_(config) {}
 
 FaultFilter::~FaultFilter() { ASSERT(!delay_timer_); }
@@ -70,6 +106,10 @@ FaultFilter::~FaultFilter() { ASSERT(!delay_timer_); }
 // if we inject a delay, then we will inject the abort in the delay timer
 // callback.
 FilterHeadersStatus FaultFilter::decodeHeaders(HeaderMap& headers, bool) {
+  if (config_->faultsDisabled(config_->runtime().snapshot())) {
+    return FilterHeadersStatus::Continue;
+  }
+
   if (!matchesTargetUpstreamCluster()) {
     return FilterHeadersStatus::Continue;
   }
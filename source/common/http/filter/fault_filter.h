@@ -1,5 +1,6 @@
 #pragma once
 
+#include <atomic>
 #include <cstdint>
 #include <memory>
 #include <string>
@@ -56,8 +57,16 @@ public:
   const std::string& statsPrefix() { return stats_prefix_; }
   Stats::Scope& scope() { return scope_; }
 
+  /**
+   * @return bool whether no request can be faulted with the given runtime snapshot, because
+   *         neither the config nor the runtime has a non-zero abort or delay percentage. It is
+   *         computed once per snapshot, so an idle filter only costs a version comparison.
+   */
+  bool faultsDisabled(const Runtime::Snapshot& snapshot);
+
 private:
   static FaultFilterStats generateStats(const std::string& prefix, Stats::Scope& scope);
+  static bool runtimeEnablesFaults(const Runtime::Snapshot& snapshot);
 
   uint64_t abort_percent_{};       // 0-100
   uint64_t http_status_{};         // HTTP or gRPC return codes
@@ -71,6 +80,11 @@ private:
   FaultFilterStats stats_;
   const std::string stats_prefix_;
   Stats::Scope& scope_;
+
+  static const uint64_t UNKNOWN_FAULTS_DISABLED_STATE = UINT64_MAX;
+  // The snapshot version faultsDisabled() was last computed for, shifted left by one, with the
+  // result in the low bit. Keeping both in one word lets all workers share it without a lock.
+  std::atomic<uint64_t> faults_disabled_state_{UNKNOWN_FAULTS_DISABLED_STATE};
 };
 
 typedef std::shared_ptr<FaultFilterConfig> FaultFilterConfigSharedPtr;
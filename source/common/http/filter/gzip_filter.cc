@@ -0,0 +1,342 @@
+#include "common/http/filter/gzip_filter.h"
+
+#include <algorithm>
+#include <cctype>
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+#include "common/common/assert.h"
+#include "common/common/utility.h"
+#include "common/http/header_map_impl.h"
+#include "common/http/headers.h"
+#include "common/json/config_schemas.h"
+
+namespace Envoy {
+namespace Http {
+
+namespace {
+
+// Runtime keys.
+const std::string EnabledKey = "gzip.enabled";
+const std::string CompressionLevelKey = "gzip.compression_level";
+
+// The gzip format is selected by adding 16 to the window bits passed to deflateInit2().
+const int64_t GzipHeaderWindowBits = 16;
+
+std::string trim(const std::string& source) {
+  const size_t start = source.find_first_not_of(" \t");
+  if (start == std::string::npos) {
+    return "";
+  }
+  const size_t end = source.find_last_not_of(" \t");
+  return source.substr(start, end - start + 1);
+}
+
+std::string toLower(std::string source) {
+  std::transform(source.begin(), source.end(), source.begin(),
+                 [](unsigned char c) -> char { return std::tolower(c); });
+  return source;
+}
+
+Compressor::ZlibCompressorImpl::CompressionLevel compressionLevelEnum(const std::string& level) {
+  if (level == "best") {
+    return Compressor::ZlibCompressorImpl::CompressionLevel::Best;
+  } else if (level == "speed") {
+    return Compressor::ZlibCompressorImpl::CompressionLevel::Speed;
+  } else {
+    ASSERT(level == "default");
+    return Compressor::ZlibCompressorImpl::CompressionLevel::Standard;
+  }
+}
+
+Compressor::ZlibCompressorImpl::CompressionStrategy
+compressionStrategyEnum(const std::string& strategy) {
+  if (strategy == "filtered") {
+    return Compressor::ZlibCompressorImpl::CompressionStrategy::Filtered;
+  } else if (strategy == "huffman") {
+    return Compressor::ZlibCompressorImpl::CompressionStrategy::Huffman;
+  } else if (strategy == "rle") {
+    return Compressor::ZlibCompressorImpl::CompressionStrategy::Rle;
+  } else {
+    ASSERT(strategy == "default");
+    return Compressor::ZlibCompressorImpl::CompressionStrategy::Standard;
+  }
+}
+
+std::vector<std::string> defaultContentTypes() {
+  return {"application/javascript", "application/json", "application/xml", "image/svg+xml",
+          "text/css",               "text/html",        "text/plain",      "text/xml"};
+}
+
+} // namespace
+
+PooledCompressor::PooledCompressor(Compressor::ZlibCompressorImpl::CompressionLevel level,
+                                   int64_t window_bits,
+                                   Compressor::ZlibCompressorImpl::CompressionStrategy strategy,
+                                   uint64_t memory_level)
+    : level_(level), window_bits_(window_bits) {
+  compressor_.init(level, strategy, window_bits, memory_level);
+}
+
+PooledCompressorPtr CompressorPool::acquire(Compressor::ZlibCompressorImpl::CompressionLevel level,
+                                            int64_t window_bits) {
+  // Prefer the most recently released compressor, whose state is the most likely to be cached.
+  for (auto it = idle_.rbegin(); it != idle_.rend(); ++it) {
+    if ((*it)->level_ == level && (*it)->window_bits_ == window_bits) {
+      PooledCompressorPtr compressor = std::move(*it);
+      idle_.erase(std::next(it).base());
+      return compressor;
+    }
+  }
+
+  return PooledCompressorPtr{new PooledCompressor(level, window_bits, strategy_, memory_level_)};
+}
+
+void CompressorPool::release(PooledCompressorPtr&& compressor) {
+  if (max_retained_ == 0) {
+    compressor.reset();
+    return;
+  }
+
+  compressor->compressor_.reset();
+  if (idle_.size() == max_retained_) {
+    idle_.erase(idle_.begin());
+  }
+  idle_.push_back(std::move(compressor));
+}
+
+const uint64_t GzipFilterConfig::DefaultMinimumLength;
+const size_t GzipFilterConfig::MaxPooledCompressors;
+
+GzipFilterConfig::GzipFilterConfig(const Json::Object& json_config, const std::string& stats_prefix,
+                                   Stats::Scope& scope, Runtime::Loader& runtime,
+                                   ThreadLocal::SlotAllocator& tls)
+    : runtime_(runtime), stats_(generateStats(stats_prefix, scope)), tls_(tls.allocateSlot()) {
+  json_config.validateSchema(Json::Schema::GZIP_HTTP_FILTER_SCHEMA);
+
+  compression_level_ = compressionLevelEnum(json_config.getString("compression_level", "default"));
+  compression_strategy_ =
+      compressionStrategyEnum(json_config.getString("compression_strategy", "default"));
+  window_bits_ = json_config.getInteger("window_bits", 12);
+  memory_level_ = json_config.getInteger("memory_level", 5);
+  minimum_length_ = json_config.getInteger("content_length", DefaultMinimumLength);
+  content_types_ = json_config.getStringArray("content_type", true);
+  if (content_types_.empty()) {
+    content_types_ = defaultContentTypes();
+  }
+  sync_flush_ = json_config.getBoolean("sync_flush", false);
+
+  const Compressor::ZlibCompressorImpl::CompressionStrategy strategy = compression_strategy_;
+  const uint64_t memory_level = memory_level_;
+  tls_->set(
+      [strategy, memory_level](Event::Dispatcher&) -> ThreadLocal::ThreadLocalObjectSharedPtr {
+        return std::make_shared<CompressorPool>(strategy, memory_level, MaxPooledCompressors);
+      });
+}
+
+GzipFilterStats GzipFilterConfig::generateStats(const std::string& prefix, Stats::Scope& scope) {
+  const std::string final_prefix = prefix + "gzip.";
+  return {ALL_GZIP_FILTER_STATS(POOL_COUNTER_PREFIX(scope, final_prefix))};
+}
+
+Compressor::ZlibCompressorImpl::CompressionLevel GzipFilterConfig::compressionLevel() const {
+  const uint64_t level = runtime_.snapshot().getInteger(CompressionLevelKey, 0);
+  if (level >= 1 && level <= 9) {
+    return static_cast<Compressor::ZlibCompressorImpl::CompressionLevel>(level);
+  }
+  return compression_level_;
+}
+
+int64_t GzipFilterConfig::windowBits(ContentEncoding encoding) const {
+  ASSERT(encoding != ContentEncoding::Identity);
+  return encoding == ContentEncoding::Gzip ? window_bits_ + GzipHeaderWindowBits : window_bits_;
+}
+
+bool GzipFilterConfig::isContentTypeAllowed(const std::string& content_type) const {
+  const std::string media_type = toLower(trim(content_type.substr(0, content_type.find(';'))));
+  return std::find(content_types_.begin(), content_types_.end(), media_type) !=
+         content_types_.end();
+}
+
+GzipFilter::GzipFilter(GzipFilterConfigSharedPtr config) : config_(config) {}
+
+ContentEncoding GzipFilter::selectEncoding(const std::string& accept_encoding) {
+  // The q value of each coding, or -1 for codings the header does not mention. Codings that are
+  // not mentioned get the q value of the wildcard.
+  double gzip_q = -1;
+  double deflate_q = -1;
+  double wildcard_q = -1;
+
+  for (const std::string& coding : StringUtil::split(accept_encoding, ',')) {
+    const std::vector<std::string> params = StringUtil::split(coding, ';');
+    if (params.empty()) {
+      continue;
+    }
+
+    double q = 1;
+    for (size_t i = 1; i < params.size(); i++) {
+      const std::string param = trim(params[i]);
+      if (param.size() > 2 && std::tolower(param[0]) == 'q' && param[1] == '=') {
+        q = std::strtod(param.c_str() + 2, nullptr);
+      }
+    }
+
+    const std::string name = toLower(trim(params[0]));
+    if (name == Headers::get().ContentEncodingValues.Gzip) {
+      gzip_q = q;
+    } else if (name == Headers::get().ContentEncodingValues.Deflate) {
+      deflate_q = q;
+    } else if (name == "*") {
+      wildcard_q = q;
+    }
+  }
+
+  if (gzip_q < 0) {
+    gzip_q = wildcard_q;
+  }
+  if (deflate_q < 0) {
+    deflate_q = wildcard_q;
+  }
+
+  if (gzip_q > 0 && gzip_q >= deflate_q) {
+    return ContentEncoding::Gzip;
+  } else if (deflate_q > 0) {
+    return ContentEncoding::Deflate;
+  }
+  return ContentEncoding::Identity;
+}
+
+void GzipFilter::onDestroy() { releaseCompressor(); }
+
+FilterHeadersStatus GzipFilter::decodeHeaders(HeaderMap& headers, bool) {
+  const HeaderEntry* accept_encoding = headers.get(Headers::get().AcceptEncoding);
+  if (accept_encoding != nullptr) {
+    accept_encoding_present_ = true;
+    encoding_ = selectEncoding(accept_encoding->value().c_str());
+  }
+  return FilterHeadersStatus::Continue;
+}
+
+FilterHeadersStatus GzipFilter::encodeHeaders(HeaderMap& headers, bool end_stream) {
+  if (end_stream || !config_->runtime().snapshot().featureEnabled(EnabledKey, 100)) {
+    return FilterHeadersStatus::Continue;
+  }
+
+  if (!accept_encoding_present_) {
+    config_->stats().no_accept_header_.inc();
+    return FilterHeadersStatus::Continue;
+  }
+
+  if (encoding_ == ContentEncoding::Identity || !isResponseCompressible(headers)) {
+    config_->stats().not_compressed_.inc();
+    return FilterHeadersStatus::Continue;
+  }
+
+  config_->stats().compressed_.inc();
+  compressor_ = config_->compressorPool().acquire(config_->compressionLevel(),
+                                                  config_->windowBits(encoding_));
+  updateHeaders(headers);
+  return FilterHeadersStatus::Continue;
+}
+
+FilterDataStatus GzipFilter::encodeData(Buffer::Instance& data, bool end_stream) {
+  if (!compressor_) {
+    return FilterDataStatus::Continue;
+  }
+
+  config_->stats().total_uncompressed_bytes_.add(data.length());
+  Buffer::OwnedImpl output;
+  compressor_->compressor_.compress(data, output);
+  data.drain(data.length());
+
+  if (end_stream) {
+    finishCompression(output);
+  } else if (config_->syncFlush()) {
+    // Hand everything compressed so far downstream so that streamed responses are not held back
+    // waiting for zlib to fill a block.
+    compressor_->compressor_.flush(output);
+  }
+
+  config_->stats().total_compressed_bytes_.add(output.length());
+  data.move(output);
+  return FilterDataStatus::Continue;
+}
+
+FilterTrailersStatus GzipFilter::encodeTrailers(HeaderMap&) {
+  if (compressor_) {
+    Buffer::OwnedImpl output;
+    finishCompression(output);
+    config_->stats().total_compressed_bytes_.add(output.length());
+    encoder_callbacks_->addEncodedData(output, true);
+  }
+  return FilterTrailersStatus::Continue;
+}
+
+bool GzipFilter::isResponseCompressible(const HeaderMap& headers) {
+  if (headers.get(Headers::get().ContentEncoding) != nullptr) {
+    return false;
+  }
+
+  if (headers.ContentLength() != nullptr) {
+    uint64_t length;
+    if (!StringUtil::atoul(headers.ContentLength()->value().c_str(), length) ||
+        length < config_->minimumLength()) {
+      return false;
+    }
+  }
+
+  if (headers.ContentType() == nullptr ||
+      !config_->isContentTypeAllowed(headers.ContentType()->value().c_str())) {
+    return false;
+  }
+
+  if (headers.CacheControl() != nullptr &&
+      toLower(headers.CacheControl()->value().c_str())
+              .find(Headers::get().CacheControlValues.NoTransform) != std::string::npos) {
+    return false;
+  }
+
+  return true;
+}
+
+void GzipFilter::updateHeaders(HeaderMap& headers) {
+  headers.removeContentLength();
+  headers.addReference(Headers::get().ContentEncoding,
+                       encoding_ == ContentEncoding::Gzip
+                           ? Headers::get().ContentEncodingValues.Gzip
+                           : Headers::get().ContentEncodingValues.Deflate);
+
+  // Caches have to key the response on Accept-Encoding, since other clients get it unencoded.
+  const HeaderEntry* vary = headers.get(Headers::get().Vary);
+  if (vary == nullptr) {
+    headers.addReference(Headers::get().Vary, Headers::get().VaryValues.AcceptEncoding);
+  } else {
+    const std::string value = vary->value().c_str();
+    if (value != "*" &&
+        toLower(value).find(Headers::get().AcceptEncoding.get()) == std::string::npos) {
+      headers.setReferenceKey(Headers::get().Vary,
+                              value + ", " + Headers::get().VaryValues.AcceptEncoding);
+    }
+  }
+
+  // The encoded body is no longer byte for byte identical to the one a strong ETag identifies.
+  const HeaderEntry* etag = headers.get(Headers::get().Etag);
+  if (etag != nullptr && !StringUtil::startsWith(etag->value().c_str(), "W/")) {
+    headers.setReferenceKey(Headers::get().Etag, "W/" + std::string(etag->value().c_str()));
+  }
+}
+
+void GzipFilter::finishCompression(Buffer::Instance& output) {
+  compressor_->compressor_.finish(output);
+  releaseCompressor();
+}
+
+void GzipFilter::releaseCompressor() {
+  if (compressor_) {
+    config_->compressorPool().release(std::move(compressor_));
+  }
+}
+
+} // namespace Http
+} // namespace Envoy
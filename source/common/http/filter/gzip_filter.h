@@ -0,0 +1,199 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "envoy/http/filter.h"
+#include "envoy/json/json_object.h"
+#include "envoy/runtime/runtime.h"
+#include "envoy/stats/stats_macros.h"
+#include "envoy/thread_local/thread_local.h"
+
+#include "common/buffer/buffer_impl.h"
+#include "common/compressor/zlib_compressor_impl.h"
+
+namespace Envoy {
+namespace Http {
+
+/**
+ * All stats for the gzip filter. @see stats_macros.h
+ */
+// clang-format off
+#define ALL_GZIP_FILTER_STATS(COUNTER)                                                             \
+  COUNTER(compressed)                                                                              \
+  COUNTER(not_compressed)                                                                          \
+  COUNTER(no_accept_header)                                                                        \
+  COUNTER(total_uncompressed_bytes)                                                                \
+  COUNTER(total_compressed_bytes)
+// clang-format on
+
+/**
+ * Wrapper struct for gzip filter stats. @see stats_macros.h
+ */
+struct GzipFilterStats {
+  ALL_GZIP_FILTER_STATS(GENERATE_COUNTER_STRUCT)
+};
+
+/**
+ * Content codings the filter can produce.
+ */
+enum class ContentEncoding { Identity, Gzip, Deflate };
+
+/**
+ * An initialized compressor along with the parameters it was initialized with, so that it can be
+ * handed back to a pool and reused by a later stream asking for the same parameters.
+ */
+struct PooledCompressor {
+  PooledCompressor(Compressor::ZlibCompressorImpl::CompressionLevel level, int64_t window_bits,
+                   Compressor::ZlibCompressorImpl::CompressionStrategy strategy,
+                   uint64_t memory_level);
+
+  const Compressor::ZlibCompressorImpl::CompressionLevel level_;
+  const int64_t window_bits_;
+  Compressor::ZlibCompressorImpl compressor_;
+};
+
+typedef std::unique_ptr<PooledCompressor> PooledCompressorPtr;
+
+/**
+ * A cache of idle compressors for one worker. Setting up a zlib stream allocates and clears a few
+ * tens of kilobytes of state, which is a large part of the cost of compressing a small response, so
+ * streams take their compressor from the pool of the worker they run on and give it back once the
+ * response is done. Only the worker owning the pool touches it, so no locking is needed. At most
+ * maxRetained() idle compressors are kept; the oldest ones are freed beyond that.
+ */
+class CompressorPool : public ThreadLocal::ThreadLocalObject {
+public:
+  CompressorPool(Compressor::ZlibCompressorImpl::CompressionStrategy strategy,
+                 uint64_t memory_level, size_t max_retained)
+      : strategy_(strategy), memory_level_(memory_level), max_retained_(max_retained) {}
+
+  /**
+   * @return a compressor ready to start a new stream with the given parameters, reusing an idle
+   *         one when possible.
+   */
+  PooledCompressorPtr acquire(Compressor::ZlibCompressorImpl::CompressionLevel level,
+                              int64_t window_bits);
+
+  /**
+   * Return a compressor obtained from acquire(). It may be in any state; it is reset here.
+   */
+  void release(PooledCompressorPtr&& compressor);
+
+  size_t idle() const { return idle_.size(); }
+  size_t maxRetained() const { return max_retained_; }
+
+private:
+  const Compressor::ZlibCompressorImpl::CompressionStrategy strategy_;
+  const uint64_t memory_level_;
+  const size_t max_retained_;
+  // Ordered from least to most recently released.
+  std::vector<PooledCompressorPtr> idle_;
+};
+
+/**
+ * Configuration for the gzip filter.
+ */
+class GzipFilterConfig {
+public:
+  GzipFilterConfig(const Json::Object& json_config, const std::string& stats_prefix,
+                   Stats::Scope& scope, Runtime::Loader& runtime, ThreadLocal::SlotAllocator& tls);
+
+  /**
+   * @return the compression level for a new stream: the "gzip.compression_level" runtime key if
+   *         it holds a valid zlib level (1-9), otherwise the configured level.
+   */
+  Compressor::ZlibCompressorImpl::CompressionLevel compressionLevel() const;
+
+  /**
+   * @return the zlib window bits producing the given content coding.
+   */
+  int64_t windowBits(ContentEncoding encoding) const;
+
+  /**
+   * @return whether a response of the given content type may be compressed. Parameters such as
+   *         the charset are ignored.
+   */
+  bool isContentTypeAllowed(const std::string& content_type) const;
+
+  CompressorPool& compressorPool() { return tls_->getTyped<CompressorPool>(); }
+  uint64_t minimumLength() const { return minimum_length_; }
+  bool syncFlush() const { return sync_flush_; }
+  Runtime::Loader& runtime() { return runtime_; }
+  GzipFilterStats& stats() { return stats_; }
+
+  static const uint64_t DefaultMinimumLength = 30;
+  static const size_t MaxPooledCompressors = 16;
+
+private:
+  static GzipFilterStats generateStats(const std::string& prefix, Stats::Scope& scope);
+
+  Compressor::ZlibCompressorImpl::CompressionLevel compression_level_;
+  Compressor::ZlibCompressorImpl::CompressionStrategy compression_strategy_;
+  int64_t window_bits_;
+  uint64_t memory_level_;
+  uint64_t minimum_length_;
+  std::vector<std::string> content_types_;
+  bool sync_flush_;
+  Runtime::Loader& runtime_;
+  GzipFilterStats stats_;
+  ThreadLocal::SlotPtr tls_;
+};
+
+typedef std::shared_ptr<GzipFilterConfig> GzipFilterConfigSharedPtr;
+
+/**
+ * A filter that compresses response bodies with gzip or deflate, as negotiated with the request's
+ * Accept-Encoding header. The body is compressed as it streams through encodeData(); it is never
+ * buffered in full.
+ */
+class GzipFilter : public StreamFilter {
+public:
+  GzipFilter(GzipFilterConfigSharedPtr config);
+
+  /**
+   * Pick the content coding to respond with from an Accept-Encoding header value, preferring gzip
+   * over deflate when both are equally acceptable.
+   * @param accept_encoding supplies the header value.
+   * @return ContentEncoding Identity if neither coding is acceptable.
+   */
+  static ContentEncoding selectEncoding(const std::string& accept_encoding);
+
+  // Http::StreamFilterBase
+  void onDestroy() override;
+
+  // Http::StreamDecoderFilter
+  FilterHeadersStatus decodeHeaders(HeaderMap& headers, bool end_stream) override;
+  FilterDataStatus decodeData(Buffer::Instance&, bool) override {
+    return FilterDataStatus::Continue;
+  }
+  FilterTrailersStatus decodeTrailers(HeaderMap&) override {
+    return FilterTrailersStatus::Continue;
+  }
+  void setDecoderFilterCallbacks(StreamDecoderFilterCallbacks&) override {}
+
+  // Http::StreamEncoderFilter
+  FilterHeadersStatus encodeHeaders(HeaderMap& headers, bool end_stream) override;
+  FilterDataStatus encodeData(Buffer::Instance& data, bool end_stream) override;
+  FilterTrailersStatus encodeTrailers(HeaderMap& trailers) override;
+  void setEncoderFilterCallbacks(StreamEncoderFilterCallbacks& callbacks) override {
+    encoder_callbacks_ = &callbacks;
+  }
+
+private:
+  bool isResponseCompressible(const HeaderMap& headers);
+  void updateHeaders(HeaderMap& headers);
+  void finishCompression(Buffer::Instance& output);
+  void releaseCompressor();
+
+  GzipFilterConfigSharedPtr config_;
+  StreamEncoderFilterCallbacks* encoder_callbacks_{};
+  ContentEncoding encoding_{ContentEncoding::Identity};
+  bool accept_encoding_present_{};
+  PooledCompressorPtr compressor_;
+};
+
+} // namespace Http
+} // namespace Envoy
@@ -1,15 +1,90 @@
 #include "common/http/filter/ip_tagging_filter.h"
 
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "common/common/utility.h"
+#include "common/http/headers.h"
+#include "common/network/cidr_range.h"
+
+#include "fmt/format.h"
+
 namespace Envoy {
 namespace Http {
 
+IpTaggingFilterConfig::IpTaggingFilterConfig(const Json::Object& json_config,
+                                             const std::string& stat_prefix, Stats::Scope& scope)
+    : Json::Validator(json_config, Json::Schema::IP_TAGGING_HTTP_FILTER_SCHEMA),
+      request_type_(stringToType(json_config.getString("request_type", "both"))),
+      total_(scope.counter(stat_prefix + "ip_tagging.total")),
+      no_hit_(scope.counter(stat_prefix + "ip_tagging.no_hit")) {
+  std::vector<std::pair<std::string, std::vector<Network::Address::CidrRange>>> tag_data;
+  for (const Json::ObjectSharedPtr& ip_tag : json_config.getObjectArray("ip_tags", true)) {
+    const std::string tag_name = ip_tag->getString("ip_tag_name");
+    std::vector<Network::Address::CidrRange> ranges;
+    for (const std::string& entry : ip_tag->getStringArray("ip_list")) {
+      // A bare address is a range of just that address.
+      const Network::Address::CidrRange range =
+          entry.find('/') == std::string::npos ? Network::Address::CidrRange::create(entry, 128)
+                                               : Network::Address::CidrRange::create(entry);
+      if (!range.isValid()) {
+        throw EnvoyException(
+            fmt::format("invalid ip/mask combo '{}' (format is <ip>/<# mask bits>)", entry));
+      }
+      ranges.push_back(range);
+    }
+
+    tag_hits_.emplace(tag_name, &scope.counter(fmt::format("{}ip_tagging.{}.hit", stat_prefix,
+                                                           tag_name)));
+    tag_data.emplace_back(tag_name, std::move(ranges));
+  }
+
+  trie_.reset(new Network::LcTrie::LcTrie(tag_data));
+}
+
+void IpTaggingFilterConfig::incCounters(const std::vector<std::string>& tags) {
+  total_.inc();
+  if (tags.empty()) {
+    no_hit_.inc();
+  }
+  for (const std::string& tag : tags) {
+    tag_hits_.at(tag)->inc();
+  }
+}
+
 IpTaggingFilter::IpTaggingFilter(IpTaggingFilterConfigSharedPtr config) : config_(config) {}
 
 IpTaggingFilter::~IpTaggingFilter() {}
 
 void IpTaggingFilter::onDestroy() {}
 
-FilterHeadersStatus IpTaggingFilter::decodeHeaders(HeaderMap&, bool) {
+FilterHeadersStatus IpTaggingFilter::decodeHeaders(HeaderMap& headers, bool) {
+  const bool is_internal_request =
+      headers.EnvoyInternalRequest() &&
+      (headers.EnvoyInternalRequest()->value() ==
+       Headers::get().EnvoyInternalRequestValues.True.c_str());
+
+  if ((is_internal_request && config_->requestType() == FilterRequestType::External) ||
+      (!is_internal_request && config_->requestType() == FilterRequestType::Internal)) {
+    return FilterHeadersStatus::Continue;
+  }
+
+  const std::vector<std::string>& tags =
+      config_->trie().getTags(*callbacks_->requestInfo().downstreamRemoteAddress());
+  config_->incCounters(tags);
+  if (!tags.empty()) {
+    const std::string tags_join = StringUtil::join(tags, ",");
+    const HeaderEntry* existing = headers.get(Headers::get().EnvoyIpTags);
+    if (existing == nullptr) {
+      headers.addReferenceKey(Headers::get().EnvoyIpTags, tags_join);
+    } else {
+      // Tags of an earlier hop come first.
+      const std::string existing_tags = existing->value().c_str();
+      headers.setReferenceKey(Headers::get().EnvoyIpTags, existing_tags + "," + tags_join);
+    }
+  }
+
   return FilterHeadersStatus::Continue;
 }
 
@@ -3,14 +3,17 @@
 #include <cstdint>
 #include <memory>
 #include <string>
+#include <unordered_map>
 #include <vector>
 
 #include "envoy/http/filter.h"
 #include "envoy/json/json_object.h"
+#include "envoy/stats/stats.h"
 
 #include "common/common/assert.h"
 #include "common/json/config_schemas.h"
 #include "common/json/json_validator.h"
+#include "common/network/lc_trie.h"
 
 namespace Envoy {
 namespace Http {
@@ -21,15 +24,22 @@ namespace Http {
 enum class FilterRequestType { Internal, External, Both };
 
 /**
- * Configuration for the ip tagging filter.
+ * Configuration for the ip tagging filter. The ranges of all the tags are compiled into an LC-trie
+ * when the configuration is loaded.
  */
 class IpTaggingFilterConfig : Json::Validator {
 public:
-  IpTaggingFilterConfig(const Json::Object& json_config)
-      : Json::Validator(json_config, Json::Schema::IP_TAGGING_HTTP_FILTER_SCHEMA),
-        request_type_(stringToType(json_config.getString("request_type", "both"))) {}
+  IpTaggingFilterConfig(const Json::Object& json_config, const std::string& stat_prefix,
+                        Stats::Scope& scope);
 
   FilterRequestType requestType() const { return request_type_; }
+  const Network::LcTrie::LcTrie& trie() const { return *trie_; }
+
+  /**
+   * Count a request that the filter looked up.
+   * @param tags supplies the tags of the request, if any.
+   */
+  void incCounters(const std::vector<std::string>& tags);
 
 private:
   static FilterRequestType stringToType(const std::string& request_type) {
@@ -44,6 +54,10 @@ private:
   }
 
   const FilterRequestType request_type_;
+  Stats::Counter& total_;
+  Stats::Counter& no_hit_;
+  std::unordered_map<std::string, Stats::Counter*> tag_hits_;
+  std::unique_ptr<Network::LcTrie::LcTrie> trie_;
 };
 
 typedef std::shared_ptr<IpTaggingFilterConfig> IpTaggingFilterConfigSharedPtr;
@@ -259,6 +259,7 @@ int StreamHandleWrapper::luaHeaders(lua_State* state) {
   ASSERT(state_ == State::Running);
 
   if (headers_wrapper_.get() != nullptr) {
+    headers_wrapper_.markLive();
     headers_wrapper_.pushStack();
   } else {
     headers_wrapper_.reset(HeaderMapWrapper::create(state, headers_,
@@ -342,6 +343,7 @@ int StreamHandleWrapper::luaTrailers(lua_State* state) {
     return 0;
   } else if (trailers_ != nullptr) {
     if (trailers_wrapper_.get() != nullptr) {
+      trailers_wrapper_.markLive();
       trailers_wrapper_.pushStack();
     } else {
       trailers_wrapper_.reset(HeaderMapWrapper::create(state, *trailers_, []() { return true; }),
@@ -392,8 +394,10 @@ int StreamHandleWrapper::luaLogCritical(lua_State* state) {
 }
 
 FilterConfig::FilterConfig(const std::string& lua_code, ThreadLocal::SlotAllocator& tls,
-                           Upstream::ClusterManager& cluster_manager)
-    : cluster_manager_(cluster_manager), lua_state_(lua_code, tls) {
+                           Upstream::ClusterManager& cluster_manager, Runtime::Loader& runtime,
+                           Stats::Scope& scope, const std::string& stat_prefix)
+    : cluster_manager_(cluster_manager), runtime_(runtime),
+      stats_(generateStats(stat_prefix, scope)), lua_state_(lua_code, tls) {
   lua_state_.registerType<Envoy::Lua::BufferWrapper>();
   lua_state_.registerType<HeaderMapWrapper>();
   lua_state_.registerType<HeaderMapIterator>();
@@ -403,13 +407,23 @@ FilterConfig::FilterConfig(const std::string& lua_code, ThreadLocal::SlotAllocat
   response_function_slot_ = lua_state_.registerGlobal("envoy_on_response");
 }
 
+FilterStats FilterConfig::generateStats(const std::string& prefix, Stats::Scope& scope) {
+  std::string final_prefix = prefix + "lua.";
+  return {ALL_LUA_FILTER_STATS(POOL_COUNTER_PREFIX(scope, final_prefix),
+                               POOL_HISTOGRAM_PREFIX(scope, final_prefix))};
+}
+
 void Filter::onDestroy() {
   destroyed_ = true;
   if (request_stream_wrapper_.get()) {
     request_stream_wrapper_.get()->onReset();
+    chargeScriptStats(request_stream_wrapper_);
+    config_->releaseCoroutine(request_stream_wrapper_.get()->releaseCoroutine());
   }
   if (response_stream_wrapper_.get()) {
     response_stream_wrapper_.get()->onReset();
+    chargeScriptStats(response_stream_wrapper_);
+    config_->releaseCoroutine(response_stream_wrapper_.get()->releaseCoroutine());
   }
 }
 
@@ -465,8 +479,27 @@ FilterTrailersStatus Filter::doTrailers(StreamHandleRef& handle, HeaderMap& trai
   return status;
 }
 
+void Filter::chargeScriptStats(StreamHandleRef& handle) {
+  const Envoy::Lua::Coroutine* coroutine = handle.get()->coroutine();
+  if (coroutine == nullptr) {
+    return;
+  }
+
+  config_->stats().script_time_us_.recordValue(coroutine->runTime().count());
+  if (coroutine->instructionBudgetExceeded()) {
+    config_->stats().instruction_budget_exceeded_.inc();
+  }
+}
+
 void Filter::scriptError(const Envoy::Lua::LuaException& e) {
   scriptLog(spdlog::level::err, e.what());
+  config_->stats().errors_.inc();
+  if (request_stream_wrapper_.get()) {
+    chargeScriptStats(request_stream_wrapper_);
+  }
+  if (response_stream_wrapper_.get()) {
+    chargeScriptStats(response_stream_wrapper_);
+  }
   request_stream_wrapper_.reset();
   response_stream_wrapper_.reset();
 }
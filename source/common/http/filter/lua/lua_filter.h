@@ -1,6 +1,8 @@
 #pragma once
 
 #include "envoy/http/filter.h"
+#include "envoy/runtime/runtime.h"
+#include "envoy/stats/stats_macros.h"
 #include "envoy/upstream/cluster_manager.h"
 
 #include "common/http/filter/lua/wrappers.h"
@@ -94,6 +96,17 @@ public:
     }
   }
 
+  /**
+   * @return the coroutine the script ran in, so that it can be reused by a later stream. The
+   *         script cannot be resumed afterwards.
+   */
+  Envoy::Lua::CoroutinePtr releaseCoroutine() { return std::move(coroutine_); }
+
+  /**
+   * @return the coroutine the script runs in, or nullptr once it has been released.
+   */
+  const Envoy::Lua::Coroutine* coroutine() const { return coroutine_.get(); }
+
   static ExportedFunctions exportedFunctions() {
     return {{"headers", static_luaHeaders},       {"body", static_luaBody},
             {"bodyChunks", static_luaBodyChunks}, {"trailers", static_luaTrailers},
@@ -170,10 +183,11 @@ private:
   // Envoy::Lua::BaseLuaObject
   void onMarkDead() override {
     // Headers/body/trailers wrappers do not survive any yields. The user can request them
-    // again across yields if needed.
-    headers_wrapper_.reset();
+    // again across yields if needed. The header maps outlive the script, so their wrappers are
+    // only marked dead, and are made live again rather than recreated when requested again.
+    headers_wrapper_.markDead();
     body_wrapper_.reset();
-    trailers_wrapper_.reset();
+    trailers_wrapper_.markDead();
   }
 
   // Http::AsyncClient::Callbacks
@@ -197,20 +211,52 @@ private:
   AsyncClient::Request* http_request_{};
 };
 
+/**
+ * All Lua filter stats. @see stats_macros.h
+ */
+// clang-format off
+#define ALL_LUA_FILTER_STATS(COUNTER, HISTOGRAM)                                                   \
+  COUNTER(errors)                                                                                  \
+  COUNTER(instruction_budget_exceeded)                                                             \
+  HISTOGRAM(script_time_us)
+// clang-format on
+
+/**
+ * Struct definition for all Lua filter stats. @see stats_macros.h
+ */
+struct FilterStats {
+  ALL_LUA_FILTER_STATS(GENERATE_COUNTER_STRUCT, GENERATE_HISTOGRAM_STRUCT)
+};
+
 /**
  * Global configuration for the filter.
  */
 class FilterConfig : Logger::Loggable<Logger::Id::lua> {
 public:
   FilterConfig(const std::string& lua_code, ThreadLocal::SlotAllocator& tls,
-               Upstream::ClusterManager& cluster_manager);
-  Envoy::Lua::CoroutinePtr createCoroutine() { return lua_state_.createCoroutine(); }
+               Upstream::ClusterManager& cluster_manager, Runtime::Loader& runtime,
+               Stats::Scope& scope, const std::string& stat_prefix);
+  /**
+   * @return a coroutine limited to the instruction budget in the lua.instruction_budget runtime
+   *         key, if any.
+   */
+  Envoy::Lua::CoroutinePtr createCoroutine() {
+    return lua_state_.createCoroutine(runtime_.snapshot().getInteger("lua.instruction_budget", 0));
+  }
+  void releaseCoroutine(Envoy::Lua::CoroutinePtr&& coroutine) {
+    lua_state_.releaseCoroutine(std::move(coroutine));
+  }
   int requestFunctionRef() { return lua_state_.getGlobalRef(request_function_slot_); }
   int responseFunctionRef() { return lua_state_.getGlobalRef(response_function_slot_); }
+  FilterStats& stats() { return stats_; }
 
   Upstream::ClusterManager& cluster_manager_;
 
 private:
+  static FilterStats generateStats(const std::string& prefix, Stats::Scope& scope);
+
+  Runtime::Loader& runtime_;
+  FilterStats stats_;
   Envoy::Lua::ThreadLocalState lua_state_;
   uint64_t request_function_slot_;
   uint64_t response_function_slot_;
@@ -218,8 +264,6 @@ private:
 
 typedef std::shared_ptr<FilterConfig> FilterConfigConstSharedPtr;
 
-// TODO(mattklein123): Filter stats.
-
 /**
  * The HTTP Lua filter. Allows scripts to run in both the request an response flow.
  */
@@ -303,6 +347,8 @@ private:
                                 int function_ref, HeaderMap& headers, bool end_stream);
   FilterDataStatus doData(StreamHandleRef& handle, Buffer::Instance& data, bool end_stream);
   FilterTrailersStatus doTrailers(StreamHandleRef& handle, HeaderMap& trailers);
+  // Charges the stats for a script that will not run again.
+  void chargeScriptStats(StreamHandleRef& handle);
 
   FilterConfigConstSharedPtr config_;
   DecoderCallbacks decoder_callbacks_{*this};
@@ -41,7 +41,7 @@ int HeaderMapWrapper::luaGet(lua_State* state) {
   const char* key = luaL_checkstring(state, 2);
   const HeaderEntry* entry = headers_.get(LowerCaseString(key));
   if (entry != nullptr) {
-    lua_pushstring(state, entry->value().c_str());
+    lua_pushlstring(state, entry->value().c_str(), entry->value().size());
     return 1;
   } else {
     return 0;
@@ -73,6 +73,17 @@ int HeaderMapWrapper::luaRemove(lua_State* state) {
   return 0;
 }
 
+int HeaderMapWrapper::luaReplace(lua_State* state) {
+  checkModifiable(state);
+
+  const LowerCaseString key(luaL_checkstring(state, 2));
+  size_t value_size;
+  const char* value = luaL_checklstring(state, 3, &value_size);
+  headers_.remove(key);
+  headers_.addCopy(key, std::string(value, value_size));
+  return 0;
+}
+
 void HeaderMapWrapper::checkModifiable(lua_State* state) {
   if (iterator_.get() != nullptr) {
     luaL_error(state, "header map cannot be modified while iterating");
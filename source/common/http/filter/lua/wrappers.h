@@ -42,6 +42,7 @@ public:
     return {{"add", static_luaAdd},
             {"get", static_luaGet},
             {"remove", static_luaRemove},
+            {"replace", static_luaReplace},
             {"__pairs", static_luaPairs}};
   }
 
@@ -74,6 +75,14 @@ private:
    */
   DECLARE_LUA_FUNCTION(HeaderMapWrapper, luaRemove);
 
+  /**
+   * Set a header in the map, replacing any existing values.
+   * @param 1 (string): header name.
+   * @param 2 (string): header value.
+   * @return nothing.
+   */
+  DECLARE_LUA_FUNCTION(HeaderMapWrapper, luaReplace);
+
   void checkModifiable(lua_State* state);
 
   // Envoy::Lua::BaseLuaObject
@@ -18,6 +18,9 @@ namespace RateLimit {
 
 namespace {
 
+const Runtime::Key HTTP_FILTER_ENABLED_KEY("ratelimit.http_filter_enabled");
+const Runtime::Key HTTP_FILTER_ENFORCING_KEY("ratelimit.http_filter_enforcing");
+
 static const Http::HeaderMap* getTooManyRequestsHeader() {
   static const Http::HeaderMap* header_map = new Http::HeaderMapImpl{
       {Http::Headers::get().Status, std::to_string(enumToInt(Code::TooManyRequests))}};
@@ -68,7 +71,7 @@ void Filter::initiateCall(const HeaderMap& headers) {
 }
 
 FilterHeadersStatus Filter::decodeHeaders(HeaderMap& headers, bool) {
-  if (!config_->runtime().snapshot().featureEnabled("ratelimit.http_filter_enabled", 100)) {
+  if (!config_->runtime().snapshot().featureEnabled(HTTP_FILTER_ENABLED_KEY, 100)) {
     return FilterHeadersStatus::Continue;
   }
 
@@ -125,13 +128,14 @@ void Filter::complete(Envoy::RateLimit::LimitStatus status) {
                                              EMPTY_STRING,
                                              EMPTY_STRING,
                                              EMPTY_STRING,
-                                             false};
+                                             false,
+                                             &cluster_->codeStats()};
     Http::CodeUtility::chargeResponseStat(info);
     break;
   }
 
   if (status == Envoy::RateLimit::LimitStatus::OverLimit &&
-      config_->runtime().snapshot().featureEnabled("ratelimit.http_filter_enforcing", 100)) {
+      config_->runtime().snapshot().featureEnabled(HTTP_FILTER_ENFORCING_KEY, 100)) {
     state_ = State::Responded;
     Http::HeaderMapPtr response_headers{new HeaderMapImpl(*getTooManyRequestsHeader())};
     callbacks_->encodeHeaders(std::move(response_headers), true);
@@ -1,7 +1,8 @@
 #include "common/http/header_map_impl.h"
 
+#include <algorithm>
 #include <cstdint>
-#include <list>
+#include <cstring>
 #include <string>
 
 #include "common/common/assert.h"
@@ -31,7 +32,8 @@ HeaderString::HeaderString(HeaderString&& move_value) {
   type_ = move_value.type_;
   string_length_ = move_value.string_length_;
   switch (move_value.type_) {
-  case Type::Reference: {
+  case Type::Reference:
+  case Type::Pinned: {
     buffer_.ref_ = move_value.buffer_.ref_;
     break;
   }
@@ -62,7 +64,20 @@ void HeaderString::freeDynamic() {
   }
 }
 
+void HeaderString::unpin() {
+  ASSERT(type_ == Type::Pinned);
+  const char* data = buffer_.ref_;
+  type_ = Type::Inline;
+  buffer_.dynamic_ = inline_buffer_;
+  setCopy(data, string_length_);
+}
+
 void HeaderString::append(const char* data, uint32_t size) {
+  // Unlike a reference, a pinned string keeps its data, so it is copied before appending.
+  if (type_ == Type::Pinned) {
+    unpin();
+  }
+
   switch (type_) {
   case Type::Reference: {
     // Switch back to inline and fall through. We do not actually append to the static string
@@ -74,6 +89,7 @@ void HeaderString::append(const char* data, uint32_t size) {
     FALLTHRU;
   }
 
+  case Type::Pinned: // Not reachable, see above.
   case Type::Inline: {
     if (size + 1 + string_length_ <= sizeof(inline_buffer_)) {
       // Already inline and the new value fits in inline storage.
@@ -114,6 +130,11 @@ void HeaderString::clear() {
   case Type::Reference: {
     break;
   }
+  case Type::Pinned: {
+    type_ = Type::Inline;
+    buffer_.dynamic_ = inline_buffer_;
+    FALLTHRU;
+  }
   case Type::Inline: {
     inline_buffer_[0] = 0;
     FALLTHRU;
@@ -126,7 +147,8 @@ void HeaderString::clear() {
 
 void HeaderString::setCopy(const char* data, uint32_t size) {
   switch (type_) {
-  case Type::Reference: {
+  case Type::Reference:
+  case Type::Pinned: {
     // Switch back to inline and fall through.
     type_ = Type::Inline;
     buffer_.dynamic_ = inline_buffer_;
@@ -167,7 +189,8 @@ void HeaderString::setCopy(const char* data, uint32_t size) {
 
 void HeaderString::setInteger(uint64_t value) {
   switch (type_) {
-  case Type::Reference: {
+  case Type::Reference:
+  case Type::Pinned: {
     // Switch back to inline and fall through.
     type_ = Type::Inline;
     buffer_.dynamic_ = inline_buffer_;
@@ -190,6 +213,14 @@ void HeaderString::setReference(const std::string& ref_value) {
   string_length_ = ref_value.size();
 }
 
+void HeaderString::setPinned(const char* data, uint32_t size) {
+  ASSERT(data[size] == 0);
+  freeDynamic();
+  type_ = Type::Pinned;
+  buffer_.ref_ = data;
+  string_length_ = size;
+}
+
 HeaderMapImpl::HeaderEntryImpl::HeaderEntryImpl(const LowerCaseString& key) : key_(key) {}
 
 HeaderMapImpl::HeaderEntryImpl::HeaderEntryImpl(const LowerCaseString& key, HeaderString&& value)
@@ -224,39 +255,132 @@ HeaderMapImpl::StaticLookupTable::StaticLookupTable() {
   add(Headers::get().HostLegacy.get().c_str(), [](HeaderMapImpl& h) -> StaticLookupResponse {
     return {&h.inline_headers_.Host_, &Headers::get().Host};
   });
+
+  std::stable_sort(entries_.begin(), entries_.end(),
+                   [](const StaticLookupEntry& lhs, const StaticLookupEntry& rhs) -> bool {
+                     return lhs.size_ < rhs.size_;
+                   });
+  offsets_.resize(entries_.back().size_ + 2);
+  uint32_t entry = 0;
+  for (uint32_t size = 0; size < offsets_.size(); size++) {
+    offsets_[size] = entry;
+    while (entry < entries_.size() && entries_[entry].size_ == size) {
+      entry++;
+    }
+  }
 }
 
 void HeaderMapImpl::StaticLookupTable::add(const char* key, StaticLookupEntry::EntryCb cb) {
-  StaticLookupEntry* current = &root_;
-  while (uint8_t c = *key) {
-    if (!current->entries_[c]) {
-      current->entries_[c].reset(new StaticLookupEntry());
-    }
+  entries_.push_back({key, static_cast<uint32_t>(strlen(key)), cb});
+}
+
+HeaderMapImpl::StaticLookupEntry::EntryCb
+HeaderMapImpl::StaticLookupTable::find(const char* key, size_t size) const {
+  if (size == 0 || size + 1 >= offsets_.size()) {
+    return nullptr;
+  }
 
-    current = current->entries_[c].get();
-    key++;
+  for (uint32_t i = offsets_[size]; i < offsets_[size + 1]; i++) {
+    const StaticLookupEntry& entry = entries_[i];
+    if (entry.key_[size - 1] == key[size - 1] && memcmp(entry.key_, key, size - 1) == 0) {
+      return entry.cb_;
+    }
   }
 
-  current->cb_ = cb;
+  return nullptr;
 }
 
-HeaderMapImpl::StaticLookupEntry::EntryCb
-HeaderMapImpl::StaticLookupTable::find(const char* key) const {
-  const StaticLookupEntry* current = &root_;
-  while (uint8_t c = *key) {
-    current = current->entries_[c].get();
-    if (current) {
-      key++;
-    } else {
-      return nullptr;
+constexpr size_t HeaderMapImpl::HeaderList::InlineCapacity;
+
+HeaderMapImpl::HeaderList::HeaderList()
+    : next_slot_(inline_slots_.begin()), last_slot_(inline_slots_.end()) {}
+
+void* HeaderMapImpl::HeaderList::allocate() {
+  Slot* slot;
+  if (free_) {
+    slot = free_;
+    free_ = slot->next_free_;
+  } else {
+    if (next_slot_ == last_slot_) {
+      const size_t block_size = InlineCapacity << (blocks_.size() + 1);
+      blocks_.emplace_back(new Slot[block_size]);
+      next_slot_ = blocks_.back().get();
+      last_slot_ = next_slot_ + block_size;
     }
+    slot = next_slot_++;
+  }
+
+  return &slot->entry_;
+}
+
+HeaderMapImpl::HeaderEntryImpl* HeaderMapImpl::HeaderList::erase(HeaderEntryImpl& entry) {
+  HeaderEntryImpl* next = entry.next_;
+  if (entry.prev_) {
+    entry.prev_->next_ = next;
+  } else {
+    head_ = next;
   }
+  if (next) {
+    next->prev_ = entry.prev_;
+  } else {
+    tail_ = entry.prev_;
+  }
+  size_--;
 
-  return current->cb_;
+  entry.~HeaderEntryImpl();
+  // The entry is the first member of its slot, so the slot shares its address.
+  Slot* slot = reinterpret_cast<Slot*>(&entry);
+  slot->next_free_ = free_;
+  free_ = slot;
+  return next;
+}
+
+void HeaderMapImpl::HeaderList::clear() {
+  for (HeaderEntryImpl* entry = head_; entry != nullptr;) {
+    HeaderEntryImpl* next = entry->next_;
+    entry->~HeaderEntryImpl();
+    entry = next;
+  }
+
+  head_ = tail_ = nullptr;
+  size_ = 0;
+  free_ = nullptr;
+  next_slot_ = inline_slots_.begin();
+  last_slot_ = inline_slots_.end();
+  blocks_.clear();
 }
 
 HeaderMapImpl::HeaderMapImpl() { memset(&inline_headers_, 0, sizeof(inline_headers_)); }
 
+HeaderMapImpl::HeaderMapImpl(HeaderMapImpl&& rhs) : HeaderMapImpl() { moveFrom(rhs); }
+
+HeaderMapImpl& HeaderMapImpl::operator=(HeaderMapImpl&& rhs) {
+  if (this != &rhs) {
+    headers_.clear();
+    memset(&inline_headers_, 0, sizeof(inline_headers_));
+    cached_byte_size_ = 0;
+    cached_byte_size_valid_ = true;
+    moveFrom(rhs);
+  }
+
+  return *this;
+}
+
+void HeaderMapImpl::moveFrom(HeaderMapImpl& rhs) {
+  // Entries never move between slots, so they are moved into this map one by one, which also
+  // rebuilds the inline header pointers.
+  for (HeaderEntryImpl* header = rhs.headers_.front(); header != nullptr; header = header->next_) {
+    insertByKey(std::move(header->key_), std::move(header->value_));
+  }
+
+  rhs.headers_.clear();
+  memset(&rhs.inline_headers_, 0, sizeof(rhs.inline_headers_));
+  rhs.cached_byte_size_ = 0;
+  rhs.cached_byte_size_valid_ = true;
+  pinned_storage_ = std::move(rhs.pinned_storage_);
+  rhs.pinned_storage_.clear();
+}
+
 HeaderMapImpl::HeaderMapImpl(const HeaderMap& rhs) : HeaderMapImpl() {
   rhs.iterate(
       [](const HeaderEntry& header, void* context) -> HeaderMap::Iterate {
@@ -290,7 +414,8 @@ bool HeaderMapImpl::operator==(const HeaderMapImpl& rhs) const {
     return false;
   }
 
-  for (auto i = headers_.begin(), j = rhs.headers_.begin(); i != headers_.end(); ++i, ++j) {
+  for (const HeaderEntryImpl *i = headers_.front(), *j = rhs.headers_.front(); i != nullptr;
+       i = i->next_, j = j->next_) {
     if (i->key() != j->key().c_str() || i->value() != j->value().c_str()) {
       return false;
     }
@@ -300,7 +425,8 @@ bool HeaderMapImpl::operator==(const HeaderMapImpl& rhs) const {
 }
 
 void HeaderMapImpl::insertByKey(HeaderString&& key, HeaderString&& value) {
-  StaticLookupEntry::EntryCb cb = ConstSingleton<StaticLookupTable>::get().find(key.c_str());
+  StaticLookupEntry::EntryCb cb =
+      ConstSingleton<StaticLookupTable>::get().find(key.c_str(), key.size());
   if (cb) {
     // TODO(mattklein123): Currently, for all of the inline headers, we don't support appending. The
     // only inline header where we should be converting multiple headers into a comma delimited
@@ -311,9 +437,7 @@ void HeaderMapImpl::insertByKey(HeaderString&& key, HeaderString&& value) {
     StaticLookupResponse ref_lookup_response = cb(*this);
     maybeCreateInline(ref_lookup_response.entry_, *ref_lookup_response.key_, std::move(value));
   } else {
-    std::list<HeaderEntryImpl>::iterator i =
-        headers_.emplace(headers_.end(), std::move(key), std::move(value));
-    i->entry_ = i;
+    addToByteSize(headers_.emplaceBack(std::move(key), std::move(value)));
   }
 }
 
@@ -380,19 +504,34 @@ void HeaderMapImpl::setReferenceKey(const LowerCaseString& key, const std::strin
 }
 
 uint64_t HeaderMapImpl::byteSize() const {
-  uint64_t byte_size = 0;
-  for (const HeaderEntryImpl& header : headers_) {
-    byte_size += header.key().size();
-    byte_size += header.value().size();
+  if (!cached_byte_size_valid_) {
+    cached_byte_size_ = 0;
+    for (const HeaderEntryImpl* header = headers_.front(); header; header = header->next_) {
+      cached_byte_size_ += header->key().size();
+      cached_byte_size_ += header->value().size();
+    }
+    cached_byte_size_valid_ = true;
   }
 
-  return byte_size;
+  return cached_byte_size_;
+}
+
+void HeaderMapImpl::addToByteSize(const HeaderEntryImpl& entry) {
+  cached_byte_size_ += entry.key().size() + entry.value().size();
+}
+
+void HeaderMapImpl::subtractFromByteSize(const HeaderEntryImpl& entry) {
+  // While the size is invalid the entry may have changed since it was counted, so there is
+  // nothing to subtract from.
+  if (cached_byte_size_valid_) {
+    cached_byte_size_ -= entry.key().size() + entry.value().size();
+  }
 }
 
 const HeaderEntry* HeaderMapImpl::get(const LowerCaseString& key) const {
-  for (const HeaderEntryImpl& header : headers_) {
-    if (header.key() == key.get().c_str()) {
-      return &header;
+  for (const HeaderEntryImpl* header = headers_.front(); header; header = header->next_) {
+    if (header->key() == key.get().c_str()) {
+      return header;
     }
   }
 
@@ -400,16 +539,16 @@ const HeaderEntry* HeaderMapImpl::get(const LowerCaseString& key) const {
 }
 
 void HeaderMapImpl::iterate(ConstIterateCb cb, void* context) const {
-  for (const HeaderEntryImpl& header : headers_) {
-    if (cb(header, context) == HeaderMap::Iterate::Break) {
+  for (const HeaderEntryImpl* header = headers_.front(); header; header = header->next_) {
+    if (cb(*header, context) == HeaderMap::Iterate::Break) {
       break;
     }
   }
 }
 
 void HeaderMapImpl::iterateReverse(ConstIterateCb cb, void* context) const {
-  for (auto it = headers_.rbegin(); it != headers_.rend(); it++) {
-    if (cb(*it, context) == HeaderMap::Iterate::Break) {
+  for (const HeaderEntryImpl* header = headers_.back(); header; header = header->prev_) {
+    if (cb(*header, context) == HeaderMap::Iterate::Break) {
       break;
     }
   }
@@ -417,7 +556,8 @@ void HeaderMapImpl::iterateReverse(ConstIterateCb cb, void* context) const {
 
 HeaderMap::Lookup HeaderMapImpl::lookup(const LowerCaseString& key,
                                         const HeaderEntry** entry) const {
-  StaticLookupEntry::EntryCb cb = ConstSingleton<StaticLookupTable>::get().find(key.get().c_str());
+  StaticLookupEntry::EntryCb cb =
+      ConstSingleton<StaticLookupTable>::get().find(key.get().c_str(), key.get().size());
   if (cb) {
     // The accessor callbacks for predefined inline headers take a HeaderMapImpl& as an argument;
     // even though we don't make any modifications, we need to cast_cast in order to use the
@@ -439,16 +579,18 @@ HeaderMap::Lookup HeaderMapImpl::lookup(const LowerCaseString& key,
 }
 
 void HeaderMapImpl::remove(const LowerCaseString& key) {
-  StaticLookupEntry::EntryCb cb = ConstSingleton<StaticLookupTable>::get().find(key.get().c_str());
+  StaticLookupEntry::EntryCb cb =
+      ConstSingleton<StaticLookupTable>::get().find(key.get().c_str(), key.get().size());
   if (cb) {
     StaticLookupResponse ref_lookup_response = cb(*this);
     removeInline(ref_lookup_response.entry_);
   } else {
-    for (auto i = headers_.begin(); i != headers_.end();) {
-      if (i->key() == key.get().c_str()) {
-        i = headers_.erase(i);
+    for (HeaderEntryImpl* header = headers_.front(); header != nullptr;) {
+      if (header->key() == key.get().c_str()) {
+        subtractFromByteSize(*header);
+        header = headers_.erase(*header);
       } else {
-        ++i;
+        header = header->next_;
       }
     }
   }
@@ -460,9 +602,7 @@ HeaderMapImpl::HeaderEntryImpl& HeaderMapImpl::maybeCreateInline(HeaderEntryImpl
     return **entry;
   }
 
-  std::list<HeaderEntryImpl>::iterator i = headers_.emplace(headers_.end(), key);
-  i->entry_ = i;
-  *entry = &(*i);
+  *entry = &headers_.emplaceBack(key);
   return **entry;
 }
 
@@ -474,9 +614,8 @@ HeaderMapImpl::HeaderEntryImpl& HeaderMapImpl::maybeCreateInline(HeaderEntryImpl
     return **entry;
   }
 
-  std::list<HeaderEntryImpl>::iterator i = headers_.emplace(headers_.end(), key, std::move(value));
-  i->entry_ = i;
-  *entry = &(*i);
+  *entry = &headers_.emplaceBack(key, std::move(value));
+  addToByteSize(**entry);
   return **entry;
 }
 
@@ -487,7 +626,8 @@ void HeaderMapImpl::removeInline(HeaderEntryImpl** ptr_to_entry) {
 
   HeaderEntryImpl* entry = *ptr_to_entry;
   *ptr_to_entry = nullptr;
-  headers_.erase(entry->entry_);
+  subtractFromByteSize(*entry);
+  headers_.erase(*entry);
 }
 
 } // namespace Http
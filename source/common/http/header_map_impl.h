@@ -2,9 +2,10 @@
 
 #include <array>
 #include <cstdint>
-#include <list>
 #include <memory>
+#include <new>
 #include <string>
+#include <vector>
 
 #include "envoy/http/header_map.h"
 
@@ -20,8 +21,12 @@ namespace Http {
 #define DEFINE_INLINE_HEADER_FUNCS(name)                                                           \
 public:                                                                                            \
   const HeaderEntry* name() const override { return inline_headers_.name##_; }                     \
-  HeaderEntry* name() override { return inline_headers_.name##_; }                                 \
+  HeaderEntry* name() override {                                                                   \
+    invalidateByteSize();                                                                          \
+    return inline_headers_.name##_;                                                                \
+  }                                                                                                \
   HeaderEntry& insert##name() override {                                                           \
+    invalidateByteSize();                                                                          \
     return maybeCreateInline(&inline_headers_.name##_, Headers::get().name);                       \
   }                                                                                                \
   void remove##name() override { removeInline(&inline_headers_.name##_); }
@@ -40,6 +45,8 @@ public:
   HeaderMapImpl();
   HeaderMapImpl(const std::initializer_list<std::pair<LowerCaseString, std::string>>& values);
   HeaderMapImpl(const HeaderMap& rhs);
+  HeaderMapImpl(HeaderMapImpl&& rhs);
+  HeaderMapImpl& operator=(HeaderMapImpl&& rhs);
 
   /**
    * Add a header via full move. This is the expected high performance paths for codecs populating
@@ -47,6 +54,15 @@ public:
    */
   void addViaMove(HeaderString&& key, HeaderString&& value);
 
+  /**
+   * Keep storage alive for as long as this map (or a map it is moved into) exists. Codecs use this
+   * to pin the read buffer storage that pinned header strings (HeaderString::setPinned()) point
+   * into.
+   */
+  void addPinnedStorage(std::shared_ptr<const void>&& storage) {
+    pinned_storage_.emplace_back(std::move(storage));
+  }
+
   /**
    * For testing. Equality is based on equality of the backing list. This is an exact match
    * comparison (order matters).
@@ -62,6 +78,12 @@ public:
   void setReference(const LowerCaseString& key, const std::string& value) override;
   void setReferenceKey(const LowerCaseString& key, const std::string& value) override;
 
+  /**
+   * The byte size is maintained as headers are added and removed. Handing out a mutable inline
+   * header entry invalidates it, since the value may be changed through the entry, and the next
+   * call walks the map once to recompute it. Changes made through a mutable entry after the call
+   * that follows handing it out are not seen.
+   */
   uint64_t byteSize() const override;
   const HeaderEntry* get(const LowerCaseString& key) const override;
   void iterate(ConstIterateCb cb, void* context) const override;
@@ -87,7 +109,75 @@ protected:
 
     HeaderString key_;
     HeaderString value_;
-    std::list<HeaderEntryImpl>::iterator entry_;
+    // Links for the insertion order of the map, in which the entry is a member of HeaderList.
+    HeaderEntryImpl* prev_{};
+    HeaderEntryImpl* next_{};
+  };
+
+  /**
+   * The storage for the entries of a map. Entries are constructed in place in slots that never
+   * move, so the inline header pointers stay valid until their entry is removed. The first
+   * InlineCapacity slots are part of the map itself, so maps with a typical number of headers do
+   * no allocation for their entries at all; further slots come from blocks of doubling size. Slots
+   * of removed entries are reused. Insertion order is kept by linking the entries together, which
+   * walks memory sequentially unless headers have been removed and added again.
+   */
+  class HeaderList : NonCopyable {
+  public:
+    static constexpr size_t InlineCapacity = 16;
+
+    HeaderList();
+    ~HeaderList() { clear(); }
+
+    template <class... Args> HeaderEntryImpl& emplaceBack(Args&&... args) {
+      HeaderEntryImpl* entry = new (allocate()) HeaderEntryImpl(std::forward<Args>(args)...);
+      entry->prev_ = tail_;
+      if (tail_) {
+        tail_->next_ = entry;
+      } else {
+        head_ = entry;
+      }
+      tail_ = entry;
+      size_++;
+      return *entry;
+    }
+
+    /**
+     * Destroy an entry and return its slot for reuse.
+     * @return HeaderEntryImpl* the entry that followed the erased one, or nullptr.
+     */
+    HeaderEntryImpl* erase(HeaderEntryImpl& entry);
+
+    /**
+     * Destroy all entries and free any storage blocks.
+     */
+    void clear();
+
+    HeaderEntryImpl* front() const { return head_; }
+    HeaderEntryImpl* back() const { return tail_; }
+    size_t size() const { return size_; }
+
+  private:
+    union Slot {
+      Slot() {}
+      ~Slot() {}
+
+      HeaderEntryImpl entry_;
+      Slot* next_free_;
+    };
+
+    void* allocate();
+
+    HeaderEntryImpl* head_{};
+    HeaderEntryImpl* tail_{};
+    size_t size_{};
+    // Slots of erased entries.
+    Slot* free_{};
+    std::array<Slot, InlineCapacity> inline_slots_;
+    // The never used slots of the most recently allocated storage, from next_slot_ to last_slot_.
+    Slot* next_slot_;
+    Slot* last_slot_;
+    std::vector<std::unique_ptr<Slot[]>> blocks_;
   };
 
   struct StaticLookupResponse {
@@ -98,20 +188,26 @@ protected:
   struct StaticLookupEntry {
     typedef StaticLookupResponse (*EntryCb)(HeaderMapImpl&);
 
-    EntryCb cb_{};
-    std::array<std::unique_ptr<StaticLookupEntry>, 256> entries_;
+    const char* key_;
+    uint32_t size_;
+    EntryCb cb_;
   };
 
   /**
    * This is the static lookup table that is used to determine whether a header is one of the O(1)
-   * headers. This uses a trie for lookup time at most equal to the size of the incoming string.
+   * headers. Entries are kept in a single array grouped by key length, so a lookup indexes the
+   * group for the key's length and compares against the few keys in it (checking the last
+   * character first, since many keys share a prefix), touching only a couple of cache lines.
    */
   struct StaticLookupTable {
     StaticLookupTable();
     void add(const char* key, StaticLookupEntry::EntryCb cb);
-    StaticLookupEntry::EntryCb find(const char* key) const;
+    StaticLookupEntry::EntryCb find(const char* key, size_t size) const;
 
-    StaticLookupEntry root_;
+    // Sorted by key length.
+    std::vector<StaticLookupEntry> entries_;
+    // The entries with keys of length n are entries_[offsets_[n]] up to entries_[offsets_[n + 1]].
+    std::vector<uint32_t> offsets_;
   };
 
   struct AllInlineHeaders {
@@ -123,9 +219,18 @@ protected:
   HeaderEntryImpl& maybeCreateInline(HeaderEntryImpl** entry, const LowerCaseString& key,
                                      HeaderString&& value);
   void removeInline(HeaderEntryImpl** entry);
+  void moveFrom(HeaderMapImpl& rhs);
+  void addToByteSize(const HeaderEntryImpl& entry);
+  void subtractFromByteSize(const HeaderEntryImpl& entry);
+  void invalidateByteSize() { cached_byte_size_valid_ = false; }
 
   AllInlineHeaders inline_headers_;
-  std::list<HeaderEntryImpl> headers_;
+  // Declared before headers_ so that it outlives the strings that point into it.
+  std::vector<std::shared_ptr<const void>> pinned_storage_;
+  HeaderList headers_;
+  // The sum of the key and value sizes of all headers, when cached_byte_size_valid_ is set.
+  mutable uint64_t cached_byte_size_{};
+  mutable bool cached_byte_size_valid_{true};
 
   ALL_INLINE_HEADERS(DEFINE_INLINE_HEADER_FUNCS)
 };
@@ -1,9 +1,13 @@
 #include "common/http/http1/codec_impl.h"
 
 #include <cstdint>
+#include <cstring>
 #include <string>
+#include <vector>
 
 #include "envoy/buffer/buffer.h"
+#include "envoy/common/optional.h"
+#include "envoy/event/dispatcher.h"
 #include "envoy/http/header_map.h"
 #include "envoy/network/connection.h"
 
@@ -11,6 +15,7 @@
 #include "common/common/utility.h"
 #include "common/http/exception.h"
 #include "common/http/headers.h"
+#include "common/http/http1/request_head_parser.h"
 #include "common/http/utility.h"
 
 #include "fmt/format.h"
@@ -19,9 +24,61 @@ namespace Envoy {
 namespace Http {
 namespace Http1 {
 
+namespace {
+
+/**
+ * @return the http_parser method for a method token from RequestHeadParser, if it is one that
+ *         requests routinely use without a body. Others are left to http_parser.
+ */
+Optional<http_method> fastParserMethod(const RequestHeadParser::Token& token) {
+  static const struct {
+    const char* name_;
+    http_method method_;
+  } methods[] = {{"GET", HTTP_GET},     {"HEAD", HTTP_HEAD},       {"POST", HTTP_POST},
+                 {"PUT", HTTP_PUT},     {"DELETE", HTTP_DELETE},   {"OPTIONS", HTTP_OPTIONS},
+                 {"PATCH", HTTP_PATCH}, {"TRACE", HTTP_TRACE}};
+  for (const auto& method : methods) {
+    if (strlen(method.name_) == token.size_ &&
+        memcmp(method.name_, token.data_, token.size_) == 0) {
+      return method.method_;
+    }
+  }
+  return {};
+}
+
+} // namespace
+
+constexpr uint32_t ConnectionImpl::MinPinnedValueSize;
+
 const std::string StreamEncoderImpl::CRLF = "\r\n";
 const std::string StreamEncoderImpl::LAST_CHUNK = "0\r\n\r\n";
 
+HeaderLineCache::Slot HeaderLineCache::slot(const HeaderString& key) {
+  if (key.c_str() == Headers::get().Date.get().c_str()) {
+    return Date;
+  }
+  if (key.c_str() == Headers::get().Server.get().c_str()) {
+    return Server;
+  }
+  return NumSlots;
+}
+
+const std::string& HeaderLineCache::line(Slot slot, const char* key, uint32_t key_size,
+                                         const char* value, uint32_t value_size) {
+  std::string& line = lines_[slot];
+  const size_t value_offset = key_size + 2;
+  if (line.size() != value_offset + value_size + 2 ||
+      memcmp(line.data() + value_offset, value, value_size) != 0) {
+    line.clear();
+    line.reserve(value_offset + value_size + 2);
+    line.append(key, key_size);
+    line.append(": ");
+    line.append(value, value_size);
+    line.append("\r\n");
+  }
+  return line;
+}
+
 void StreamEncoderImpl::encodeHeader(const char* key, uint32_t key_size, const char* value,
                                      uint32_t value_size) {
 
@@ -53,8 +110,18 @@ void StreamEncoderImpl::encodeHeaders(const HeaderMap& headers, bool end_stream)
           return HeaderMap::Iterate::Continue;
         }
 
-        static_cast<StreamEncoderImpl*>(context)->encodeHeader(
-            key_to_use, key_size_to_use, header.value().c_str(), header.value().size());
+        StreamEncoderImpl* encoder = static_cast<StreamEncoderImpl*>(context);
+        const HeaderLineCache::Slot slot = HeaderLineCache::slot(header.key());
+        if (slot != HeaderLineCache::NumSlots) {
+          const std::string& line = encoder->connection_.headerLineCache().line(
+              slot, key_to_use, key_size_to_use, header.value().c_str(), header.value().size());
+          encoder->connection_.reserveBuffer(line.size());
+          encoder->connection_.copyToBuffer(line.data(), line.size());
+          return HeaderMap::Iterate::Continue;
+        }
+
+        encoder->encodeHeader(key_to_use, key_size_to_use, header.value().c_str(),
+                              header.value().size());
         return HeaderMap::Iterate::Continue;
       },
       this);
@@ -91,7 +158,7 @@ void StreamEncoderImpl::encodeHeaders(const HeaderMap& headers, bool end_stream)
   if (end_stream) {
     endEncode();
   } else {
-    connection_.flushOutput();
+    flushOutput();
   }
 }
 
@@ -100,32 +167,89 @@ void StreamEncoderImpl::encodeData(Buffer::Instance& data, bool end_stream) {
   // atually write the zero length buffer out.
   if (data.length() > 0) {
     if (chunk_encoding_) {
-      connection_.buffer().add(fmt::format("{:x}\r\n", data.length()));
-    }
-
-    connection_.buffer().move(data);
-
-    if (chunk_encoding_) {
-      connection_.buffer().add(CRLF);
+      // Small chunks wait for the data that follows them to share a chunk header and trailer with,
+      // which streaming bodies made of many small writes otherwise pay for every write.
+      const bool first_pending = pending_chunk_.length() == 0;
+      pending_chunk_.move(data);
+      if (!end_stream && pending_chunk_.length() < connection_.chunkCoalesceBytes()) {
+        if (first_pending) {
+          if (!pending_chunk_timer_) {
+            pending_chunk_timer_ = connection_.connection().dispatcher().createTimer([this]() {
+              encodePendingChunk();
+              flushOutput();
+            });
+          }
+          pending_chunk_timer_->enableTimer(connection_.chunkCoalesceDelay());
+        }
+        return;
+      }
+      encodePendingChunk();
+    } else {
+      connection_.buffer().move(data);
     }
   }
 
   if (end_stream) {
     endEncode();
   } else {
-    connection_.flushOutput();
+    flushOutput();
   }
 }
 
+void StreamEncoderImpl::encodePendingChunk() {
+  if (pending_chunk_.length() == 0) {
+    return;
+  }
+
+  if (pending_chunk_timer_) {
+    pending_chunk_timer_->disableTimer();
+  }
+  connection_.buffer().add(fmt::format("{:x}\r\n", pending_chunk_.length()));
+  connection_.buffer().move(pending_chunk_);
+  connection_.buffer().add(CRLF);
+}
+
 void StreamEncoderImpl::encodeTrailers(const HeaderMap&) { endEncode(); }
 
 void StreamEncoderImpl::endEncode() {
   if (chunk_encoding_) {
+    encodePendingChunk();
     connection_.buffer().add(LAST_CHUNK);
   }
 
-  connection_.flushOutput();
-  connection_.onEncodeComplete();
+  flushOutput();
+  connection_.onEncodeComplete(*this);
+}
+
+void StreamEncoderImpl::flushOutput() {
+  if (held_output_) {
+    connection_.flushOutput(*held_output_);
+  } else {
+    connection_.flushOutput();
+  }
+}
+
+void StreamEncoderImpl::holdOutput() {
+  ASSERT(!held_output_);
+  held_output_.reset(
+      new Buffer::WatermarkBuffer([this]() -> void { runLowWatermarkCallbacks(); },
+                                  [this]() -> void { runHighWatermarkCallbacks(); }));
+  held_output_->setWatermarks(connection_.bufferLimit());
+}
+
+void StreamEncoderImpl::releaseOutput() {
+  if (held_output_) {
+    connection_.connection().write(*held_output_);
+    held_output_.reset();
+  }
+}
+
+void StreamEncoderImpl::write(Buffer::Instance& data) {
+  if (held_output_) {
+    held_output_->move(data);
+  } else {
+    connection_.connection().write(data);
+  }
 }
 
 void ConnectionImpl::flushOutput() {
@@ -139,6 +263,16 @@ void ConnectionImpl::flushOutput() {
   ASSERT(0UL == output_buffer_.length());
 }
 
+void ConnectionImpl::flushOutput(Buffer::Instance& destination) {
+  if (reserved_current_) {
+    reserved_iovec_.len_ = reserved_current_ - static_cast<char*>(reserved_iovec_.mem_);
+    output_buffer_.commit(&reserved_iovec_, 1);
+    reserved_current_ = nullptr;
+  }
+
+  destination.move(output_buffer_);
+}
+
 void ConnectionImpl::addCharToBuffer(char c) {
   ASSERT(bufferRemainingSize() >= 1);
   *reserved_current_++ = c;
@@ -175,6 +309,11 @@ void ConnectionImpl::reserveBuffer(uint64_t size) {
 }
 
 void StreamEncoderImpl::resetStream(StreamResetReason reason) {
+  // The stream will not write again, so the data waiting to be coalesced is dropped.
+  if (pending_chunk_timer_) {
+    pending_chunk_timer_->disableTimer();
+  }
+  pending_chunk_.drain(pending_chunk_.length());
   connection_.onResetStreamBase(reason);
 }
 
@@ -184,21 +323,52 @@ uint32_t StreamEncoderImpl::bufferLimit() { return connection_.bufferLimit(); }
 
 static const char RESPONSE_PREFIX[] = "HTTP/1.1 ";
 
+namespace {
+
+/**
+ * @return the serialized status line for a response code, or nullptr if the code is outside of
+ *         the range that is serialized ahead of time.
+ */
+const std::string* statusLine(uint64_t code) {
+  static constexpr uint64_t MinCode = 100;
+  static constexpr uint64_t MaxCode = 599;
+  static const std::vector<std::string> lines = []() -> std::vector<std::string> {
+    std::vector<std::string> lines;
+    for (uint64_t code = MinCode; code <= MaxCode; code++) {
+      lines.emplace_back(fmt::format("{}{} {}\r\n", RESPONSE_PREFIX, code,
+                                     CodeUtility::toString(static_cast<Code>(code))));
+    }
+    return lines;
+  }();
+
+  if (code < MinCode || code > MaxCode) {
+    return nullptr;
+  }
+  return &lines[code - MinCode];
+}
+
+} // namespace
+
 void ResponseStreamEncoderImpl::encodeHeaders(const HeaderMap& headers, bool end_stream) {
   started_response_ = true;
   uint64_t numeric_status = Utility::getResponseStatus(headers);
 
   connection_.reserveBuffer(4096);
-  connection_.copyToBuffer(RESPONSE_PREFIX, sizeof(RESPONSE_PREFIX) - 1);
-  connection_.addIntToBuffer(numeric_status);
-  connection_.addCharToBuffer(' ');
+  const std::string* status_line = statusLine(numeric_status);
+  if (status_line != nullptr) {
+    connection_.copyToBuffer(status_line->data(), status_line->size());
+  } else {
+    connection_.copyToBuffer(RESPONSE_PREFIX, sizeof(RESPONSE_PREFIX) - 1);
+    connection_.addIntToBuffer(numeric_status);
+    connection_.addCharToBuffer(' ');
 
-  const char* status_string = CodeUtility::toString(static_cast<Code>(numeric_status));
-  uint32_t status_string_len = strlen(status_string);
-  connection_.copyToBuffer(status_string, status_string_len);
+    const char* status_string = CodeUtility::toString(static_cast<Code>(numeric_status));
+    uint32_t status_string_len = strlen(status_string);
+    connection_.copyToBuffer(status_string, status_string_len);
 
-  connection_.addCharToBuffer('\r');
-  connection_.addCharToBuffer('\n');
+    connection_.addCharToBuffer('\r');
+    connection_.addCharToBuffer('\n');
+  }
 
   StreamEncoderImpl::encodeHeaders(headers, end_stream);
 }
@@ -251,7 +421,7 @@ http_parser_settings ConnectionImpl::settings_{
       return 0;
     },
     [](http_parser* parser) -> int {
-      static_cast<ConnectionImpl*>(parser->data)->onMessageComplete();
+      static_cast<ConnectionImpl*>(parser->data)->onMessageCompleteBase();
       return 0;
     },
     nullptr, // on_chunk_header
@@ -291,6 +461,10 @@ void ConnectionImpl::dispatch(Buffer::Instance& data) {
   // Always unpause before dispatch.
   http_parser_pause(&parser_, 0);
 
+  if (fast_request_parsing_ && dispatchFastRequest(data)) {
+    return;
+  }
+
   ssize_t total_parsed = 0;
   if (data.length() > 0) {
     uint64_t num_slices = data.getRawSlices(nullptr, 0);
@@ -307,6 +481,73 @@ void ConnectionImpl::dispatch(Buffer::Instance& data) {
   data.drain(total_parsed);
 }
 
+bool ConnectionImpl::dispatchFastRequest(Buffer::Instance& data) {
+  if (message_in_progress_ || reset_stream_called_ || data.length() == 0) {
+    return false;
+  }
+
+  // Only the first slice is parsed. A head that continues into the next one is left to
+  // http_parser.
+  Buffer::RawSlice slice;
+  data.getRawSlices(&slice, 1);
+  RequestHeadParser head;
+  if (!head.parse(static_cast<const char*>(slice.mem_), slice.len_)) {
+    return false;
+  }
+  const Optional<http_method> method = fastParserMethod(head.method());
+  if (!method.valid()) {
+    return false;
+  }
+
+  // Set up the parser fields that the callbacks read as http_parser would have for this head.
+  // Its parsing state is untouched, so it starts the next message from scratch.
+  parser_.method = method.value();
+  parser_.http_major = 1;
+  parser_.http_minor = 1;
+  parser_.flags = 0;
+  parser_.content_length = 0;
+
+  onMessageBeginBase();
+  onUrl(head.path().data_, head.path().size_);
+  // Large values reference the read buffer instead of being copied, and the header map pins its
+  // storage. The head is drained below, so the CR after each such value can be overwritten with a
+  // null terminator. If the storage can't be pinned, everything is copied.
+  bool pin_values = false;
+  Buffer::OwnedImpl* owned_data = dynamic_cast<Buffer::OwnedImpl*>(&data);
+  for (size_t i = 0; owned_data != nullptr && i < head.numHeaders(); i++) {
+    if (head.header(i).value_.size_ >= MinPinnedValueSize) {
+      std::shared_ptr<const void> storage = owned_data->pinFront();
+      if (storage) {
+        current_header_map_->addPinnedStorage(std::move(storage));
+        pin_values = true;
+      }
+      break;
+    }
+  }
+
+  for (size_t i = 0; i < head.numHeaders(); i++) {
+    const RequestHeadParser::Header& header = head.header(i);
+    HeaderString key;
+    key.setCopy(header.name_.data_, header.name_.size_);
+    toLowerTable().toLowerCase(key.buffer(), key.size());
+    HeaderString value;
+    if (pin_values && header.value_.size_ >= MinPinnedValueSize) {
+      const_cast<char*>(header.value_.data_)[header.value_.size_] = 0;
+      value.setPinned(header.value_.data_, header.value_.size_);
+    } else {
+      value.setCopy(header.value_.data_, header.value_.size_);
+    }
+    current_header_map_->addViaMove(std::move(key), std::move(value));
+  }
+  onHeadersCompleteBase();
+  onMessageCompleteBase();
+
+  ENVOY_CONN_LOG(trace, "parsed {} bytes with the fast request parser", connection_,
+                 head.headSize());
+  data.drain(head.headSize());
+  return true;
+}
+
 size_t ConnectionImpl::dispatchSlice(const char* slice, size_t len) {
   ssize_t rc = http_parser_execute(&parser_, &settings_, slice, len);
   if (HTTP_PARSER_ERRNO(&parser_) != HPE_OK && HTTP_PARSER_ERRNO(&parser_) != HPE_PAUSED) {
@@ -358,11 +599,17 @@ int ConnectionImpl::onHeadersCompleteBase() {
 
 void ConnectionImpl::onMessageBeginBase() {
   ASSERT(!current_header_map_);
+  message_in_progress_ = true;
   current_header_map_.reset(new HeaderMapImpl());
   header_parsing_state_ = HeaderParsingState::Field;
   onMessageBegin();
 }
 
+void ConnectionImpl::onMessageCompleteBase() {
+  message_in_progress_ = false;
+  onMessageComplete();
+}
+
 void ConnectionImpl::onResetStreamBase(StreamResetReason reason) {
   ASSERT(!reset_stream_called_);
   reset_stream_called_ = true;
@@ -372,15 +619,39 @@ void ConnectionImpl::onResetStreamBase(StreamResetReason reason) {
 ServerConnectionImpl::ServerConnectionImpl(Network::Connection& connection,
                                            ServerConnectionCallbacks& callbacks,
                                            Http1Settings settings)
-    : ConnectionImpl(connection, HTTP_REQUEST), callbacks_(callbacks), codec_settings_(settings) {}
+    : ConnectionImpl(connection, HTTP_REQUEST), callbacks_(callbacks), codec_settings_(settings) {
+  fast_request_parsing_ = settings.fast_request_parser_;
+  chunk_coalesce_bytes_ = settings.chunk_coalesce_bytes_;
+  chunk_coalesce_delay_ = settings.chunk_coalesce_delay_;
+}
+
+void ServerConnectionImpl::onEncodeComplete(StreamEncoderImpl& encoder) {
+  ASSERT(!active_requests_.empty());
+  for (auto& request : active_requests_) {
+    if (&request->response_encoder_ == &encoder) {
+      request->local_complete_ = true;
+      break;
+    }
+  }
+
+  // Only remove requests once remote is complete. If we are replying before the request is
+  // complete the only logical thing to do is for higher level code to reset() / close the
+  // connection so we leave the request around so that it can fire reset callbacks.
+  removeCompleteRequests();
+}
 
-void ServerConnectionImpl::onEncodeComplete() {
-  ASSERT(active_request_);
-  if (active_request_->remote_complete_) {
-    // Only do this if remote is complete. If we are replying before the request is complete the
-    // only logical thing to do is for higher level code to reset() / close the connection so we
-    // leave the request around so that it can fire reset callbacks.
-    active_request_.reset();
+void ServerConnectionImpl::removeCompleteRequests() {
+  // Responses are written in request order, so a pipelined response that completed early stays
+  // held until every response ahead of it is done.
+  while (!active_requests_.empty() && active_requests_.front()->remote_complete_ &&
+         active_requests_.front()->local_complete_) {
+    if (active_requests_.front().get() == active_request_) {
+      active_request_ = nullptr;
+    }
+    active_requests_.pop_front();
+    if (!active_requests_.empty()) {
+      active_requests_.front()->response_encoder_.releaseOutput();
+    }
   }
 }
 
@@ -481,7 +752,7 @@ int ServerConnectionImpl::onHeadersComplete(HeaderMapImplPtr&& headers) {
         0 == StringUtil::caseInsensitiveCompare(headers->Expect()->value().c_str(),
                                                 Headers::get().ExpectValues._100Continue.c_str())) {
       Buffer::OwnedImpl continue_response("HTTP/1.1 100 Continue\r\n\r\n");
-      connection_.write(continue_response);
+      active_request_->response_encoder_.write(continue_response);
       headers->removeExpect();
     }
 
@@ -511,8 +782,15 @@ int ServerConnectionImpl::onHeadersComplete(HeaderMapImplPtr&& headers) {
 
 void ServerConnectionImpl::onMessageBegin() {
   if (!resetStreamCalled()) {
-    ASSERT(!active_request_);
-    active_request_.reset(new ActiveRequest(*this));
+    // A request may only begin before the previous one has been responded to if the previous one
+    // is complete, i.e. when the caller has chosen to dispatch pipelined requests.
+    ASSERT(!active_request_ || active_request_->remote_complete_);
+    const bool pipelined = !active_requests_.empty();
+    active_requests_.emplace_back(new ActiveRequest(*this));
+    active_request_ = active_requests_.back().get();
+    if (pipelined) {
+      active_request_->response_encoder_.holdOutput();
+    }
     active_request_->request_decoder_ = &callbacks_.newStream(active_request_->response_encoder_);
   }
 }
@@ -547,6 +825,9 @@ void ServerConnectionImpl::onMessageComplete() {
     }
   }
 
+  // The response may have completed before the request did.
+  removeCompleteRequests();
+
   // Always pause the parser so that the calling code can process 1 request at a time and apply
   // back pressure. However this means that the calling code needs to detect if there is more data
   // in the buffer and dispatch it again.
@@ -554,9 +835,15 @@ void ServerConnectionImpl::onMessageComplete() {
 }
 
 void ServerConnectionImpl::onResetStream(StreamResetReason reason) {
-  ASSERT(active_request_);
-  active_request_->response_encoder_.runResetCallbacks(reason);
-  active_request_.reset();
+  ASSERT(!active_requests_.empty());
+  // Reset is a connection level event in HTTP/1.1, so it takes down any pipelined requests too.
+  // The list is moved out first in case a reset callback ends up back in the codec.
+  std::list<std::unique_ptr<ActiveRequest>> requests = std::move(active_requests_);
+  active_requests_.clear();
+  active_request_ = nullptr;
+  for (auto& request : requests) {
+    request->response_encoder_.runResetCallbacks(reason);
+  }
 }
 
 void ServerConnectionImpl::sendProtocolError() {
@@ -564,7 +851,11 @@ void ServerConnectionImpl::sendProtocolError() {
   // layers can only operate on streams, so there is no coherent way to allow them to send an error
   // "out of band." On one hand this is kind of a hack but on the other hand it normalizes HTTP/1.1
   // to look more like HTTP/2 to higher layers.
-  if (!active_request_ || !active_request_->response_encoder_.startedResponse()) {
+  // A pipelined error response would be written ahead of the responses still owed for earlier
+  // requests, so in that case the connection is just closed.
+  if (active_requests_.empty() ||
+      (active_requests_.size() == 1 &&
+       !active_requests_.front()->response_encoder_.startedResponse())) {
     Buffer::OwnedImpl bad_request_response(
         fmt::format("HTTP/1.1 {} {}\r\ncontent-length: 0\r\nconnection: close\r\n\r\n",
                     std::to_string(enumToInt(error_code_)), CodeUtility::toString(error_code_)));
@@ -574,18 +865,23 @@ void ServerConnectionImpl::sendProtocolError() {
 }
 
 void ServerConnectionImpl::onAboveHighWatermark() {
-  if (active_request_) {
-    active_request_->response_encoder_.runHighWatermarkCallbacks();
+  // Only the oldest request writes to the connection. The others have their own held output.
+  if (!active_requests_.empty()) {
+    active_requests_.front()->response_encoder_.runHighWatermarkCallbacks();
   }
 }
 void ServerConnectionImpl::onBelowLowWatermark() {
-  if (active_request_) {
-    active_request_->response_encoder_.runLowWatermarkCallbacks();
+  if (!active_requests_.empty()) {
+    active_requests_.front()->response_encoder_.runLowWatermarkCallbacks();
   }
 }
 
-ClientConnectionImpl::ClientConnectionImpl(Network::Connection& connection, ConnectionCallbacks&)
-    : ConnectionImpl(connection, HTTP_RESPONSE) {}
+ClientConnectionImpl::ClientConnectionImpl(Network::Connection& connection, ConnectionCallbacks&,
+                                           Http1Settings settings)
+    : ConnectionImpl(connection, HTTP_RESPONSE) {
+  chunk_coalesce_bytes_ = settings.chunk_coalesce_bytes_;
+  chunk_coalesce_delay_ = settings.chunk_coalesce_delay_;
+}
 
 bool ClientConnectionImpl::cannotHaveBody() {
   if ((!pending_responses_.empty() && pending_responses_.front().head_request_) ||
@@ -612,7 +908,7 @@ StreamEncoder& ClientConnectionImpl::newStream(StreamDecoder& response_decoder)
   return *request_encoder_;
 }
 
-void ClientConnectionImpl::onEncodeComplete() {
+void ClientConnectionImpl::onEncodeComplete(StreamEncoderImpl&) {
   // Transfer head request state into the pending response before we reuse the encoder.
   pending_responses_.back().head_request_ = request_encoder_->headRequest();
 }
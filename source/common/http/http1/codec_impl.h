@@ -8,9 +8,11 @@
 #include <memory>
 #include <string>
 
+#include "envoy/event/timer.h"
 #include "envoy/http/codec.h"
 #include "envoy/network/connection.h"
 
+#include "common/buffer/buffer_impl.h"
 #include "common/buffer/watermark_buffer.h"
 #include "common/common/assert.h"
 #include "common/common/to_lower_table.h"
@@ -24,6 +26,32 @@ namespace Http1 {
 
 class ConnectionImpl;
 
+/**
+ * Per-connection cache of serialized "key: value\r\n" lines for headers whose value usually stays
+ * the same from one message to the next, such as date (which only changes once a second) and
+ * server. On a hit the whole line is copied into the output buffer at once.
+ */
+class HeaderLineCache {
+public:
+  enum Slot { Date, Server, NumSlots };
+
+  /**
+   * @return the cache slot for a header key, or NumSlots if the header is not cached. Only keys
+   *         that reference the static header names (as inline headers do) are cached.
+   */
+  static Slot slot(const HeaderString& key);
+
+  /**
+   * @return const std::string& the serialized header line, rebuilt first if the cached line for
+   *         the slot is for a different value.
+   */
+  const std::string& line(Slot slot, const char* key, uint32_t key_size, const char* value,
+                          uint32_t value_size);
+
+private:
+  std::array<std::string, NumSlots> lines_;
+};
+
 /**
  * Base class for HTTP/1.1 request and response encoders.
  */
@@ -45,6 +73,23 @@ public:
   void readDisable(bool disable) override;
   uint32_t bufferLimit() override;
 
+  /**
+   * Hold all further output in a buffer instead of writing it to the connection. Used for
+   * pipelined responses, which cannot be written until the responses ahead of them are complete.
+   */
+  void holdOutput();
+
+  /**
+   * Write any held output to the connection and stop holding output.
+   */
+  void releaseOutput();
+
+  /**
+   * Write pre-serialized output, behind any output that is being held.
+   * @param data supplies the output, which is drained.
+   */
+  void write(Buffer::Instance& data);
+
 protected:
   StreamEncoderImpl(ConnectionImpl& connection) : connection_(connection) {}
 
@@ -68,7 +113,22 @@ private:
    */
   void endEncode();
 
+  /**
+   * Flush all pending output from encoding, either to the connection or to the held output.
+   */
+  void flushOutput();
+
+  /**
+   * Encode the data waiting to be coalesced as a single chunk, if there is any.
+   */
+  void encodePendingChunk();
+
   bool chunk_encoding_{true};
+  std::unique_ptr<Buffer::WatermarkBuffer> held_output_;
+  // The body data of small encodeData() calls, which is encoded as one chunk once it reaches the
+  // coalescing size, the coalescing delay expires or the stream ends.
+  Buffer::OwnedImpl pending_chunk_;
+  Event::TimerPtr pending_chunk_timer_;
 };
 
 /**
@@ -114,9 +174,10 @@ public:
   Network::Connection& connection() { return connection_; }
 
   /**
-   * Called when the active encoder has completed encoding the outbound half of the stream.
+   * Called when an encoder has completed encoding the outbound half of the stream.
+   * @param encoder supplies the encoder.
    */
-  virtual void onEncodeComplete() PURE;
+  virtual void onEncodeComplete(StreamEncoderImpl& encoder) PURE;
 
   /**
    * Called when resetStream() has been called on an active stream. In HTTP/1.1 the only
@@ -130,12 +191,19 @@ public:
    */
   void flushOutput();
 
+  /**
+   * Move all pending output from encoding into a buffer instead of writing it to the connection.
+   * @param destination supplies the buffer to move the output into.
+   */
+  void flushOutput(Buffer::Instance& destination);
+
   void addCharToBuffer(char c);
   void addIntToBuffer(uint64_t i);
   Buffer::WatermarkBuffer& buffer() { return output_buffer_; }
   uint64_t bufferRemainingSize();
   void copyToBuffer(const char* data, uint64_t length);
   void reserveBuffer(uint64_t size);
+  HeaderLineCache& headerLineCache() { return header_line_cache_; }
 
   // Http::Connection
   void dispatch(Buffer::Instance& data) override;
@@ -148,6 +216,8 @@ public:
 
   void readDisable(bool disable) { connection_.readDisable(disable); }
   uint32_t bufferLimit() { return connection_.bufferLimit(); }
+  uint32_t chunkCoalesceBytes() { return chunk_coalesce_bytes_; }
+  std::chrono::milliseconds chunkCoalesceDelay() { return chunk_coalesce_delay_; }
 
 protected:
   ConnectionImpl(Network::Connection& connection, http_parser_type type);
@@ -156,6 +226,11 @@ protected:
 
   Network::Connection& connection_;
   http_parser parser_;
+  // Set by the server connection when Http1Settings::fast_request_parser_ is enabled.
+  bool fast_request_parsing_{};
+  // Set from Http1Settings::chunk_coalesce_bytes_ and Http1Settings::chunk_coalesce_delay_.
+  uint32_t chunk_coalesce_bytes_{};
+  std::chrono::milliseconds chunk_coalesce_delay_{};
   HeaderMapPtr deferred_end_stream_headers_;
   Http::Code error_code_{Http::Code::BadRequest};
 
@@ -174,6 +249,18 @@ private:
    */
   size_t dispatchSlice(const char* slice, size_t len);
 
+  // Fast parsed header values of at least this size reference the read buffer instead of being
+  // copied. Smaller ones are cheaper to copy than to pin a whole read buffer slice for.
+  static constexpr uint32_t MinPinnedValueSize = 512;
+
+  /**
+   * Dispatch a whole request if the buffer starts with a head that RequestHeadParser accepts. This
+   * drives the same callbacks as http_parser would for the request.
+   * @param data supplies the buffer, which is drained of the request if it was dispatched.
+   * @return bool whether the request was dispatched. If not, nothing has been consumed.
+   */
+  bool dispatchFastRequest(Buffer::Instance& data);
+
   /**
    * Called when a request/response is beginning. A base routine happens first then a virtual
    * dispatch is invoked.
@@ -218,8 +305,10 @@ private:
   virtual void onBody(const char* data, size_t length) PURE;
 
   /**
-   * Called when the request/response is complete.
+   * Called when the request/response is complete. A base routine happens first then a virtual
+   * dispatch is invoked.
    */
+  void onMessageCompleteBase();
   virtual void onMessageComplete() PURE;
 
   /**
@@ -252,7 +341,10 @@ private:
   HeaderString current_header_field_;
   HeaderString current_header_value_;
   bool reset_stream_called_{};
+  // Whether http_parser has started a message that it has not completed yet.
+  bool message_in_progress_{};
   Buffer::WatermarkBuffer output_buffer_;
+  HeaderLineCache header_line_cache_;
   Buffer::RawSlice reserved_iovec_;
   char* reserved_current_{};
   Protocol protocol_{Protocol::Http11};
@@ -277,6 +369,7 @@ private:
     StreamDecoder* request_decoder_{};
     ResponseStreamEncoderImpl response_encoder_;
     bool remote_complete_{};
+    bool local_complete_{};
   };
 
   /**
@@ -289,8 +382,14 @@ private:
    */
   void handlePath(HeaderMapImpl& headers, unsigned int method);
 
+  /**
+   * Remove the requests at the front of active_requests_ that are complete in both directions,
+   * letting the next request write its response.
+   */
+  void removeCompleteRequests();
+
   // ConnectionImpl
-  void onEncodeComplete() override;
+  void onEncodeComplete(StreamEncoderImpl& encoder) override;
   void onMessageBegin() override;
   void onUrl(const char* data, size_t length) override;
   int onHeadersComplete(HeaderMapImplPtr&& headers) override;
@@ -302,7 +401,13 @@ private:
   void onBelowLowWatermark() override;
 
   ServerConnectionCallbacks& callbacks_;
-  std::unique_ptr<ActiveRequest> active_request_;
+  // Requests that have not completed both directions yet, oldest first. There is more than one
+  // only when requests are pipelined, in which case only the oldest writes its response to the
+  // connection and the others hold their output until it is their turn.
+  std::list<std::unique_ptr<ActiveRequest>> active_requests_;
+  // The newest request, which is the one being decoded. nullptr once it has been removed from
+  // active_requests_.
+  ActiveRequest* active_request_{};
   Http1Settings codec_settings_;
 };
 
@@ -311,7 +416,8 @@ private:
  */
 class ClientConnectionImpl : public ClientConnection, public ConnectionImpl {
 public:
-  ClientConnectionImpl(Network::Connection& connection, ConnectionCallbacks& callbacks);
+  ClientConnectionImpl(Network::Connection& connection, ConnectionCallbacks& callbacks,
+                       Http1Settings settings);
 
   // Http::ClientConnection
   StreamEncoder& newStream(StreamDecoder& response_decoder) override;
@@ -327,7 +433,7 @@ private:
   bool cannotHaveBody();
 
   // ConnectionImpl
-  void onEncodeComplete() override;
+  void onEncodeComplete(StreamEncoderImpl& encoder) override;
   void onMessageBegin() override {}
   void onUrl(const char*, size_t) override { NOT_IMPLEMENTED; }
   int onHeadersComplete(HeaderMapImplPtr&& headers) override;
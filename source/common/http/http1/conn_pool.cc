@@ -1,5 +1,7 @@
 #include "common/http/http1/conn_pool.h"
 
+#include <chrono>
+#include <cmath>
 #include <cstdint>
 #include <list>
 
@@ -14,6 +16,7 @@
 #include "common/http/codes.h"
 #include "common/http/headers.h"
 #include "common/network/utility.h"
+#include "common/upstream/local_active_requests.h"
 #include "common/upstream/upstream_impl.h"
 
 namespace Envoy {
@@ -45,6 +48,8 @@ void ConnPoolImpl::drainConnections() {
   }
 }
 
+void ConnPoolImpl::prefetch() { prefetchConnections(); }
+
 void ConnPoolImpl::addDrainedCallback(DrainedCb cb) {
   drained_callbacks_.push_back(cb);
   checkForDrained();
@@ -78,9 +83,15 @@ void ConnPoolImpl::createNewConnection() {
 ConnectionPool::Cancellable* ConnPoolImpl::newStream(StreamDecoder& response_decoder,
                                                      ConnectionPool::Callbacks& callbacks) {
   if (!ready_clients_.empty()) {
-    ready_clients_.front()->moveBetweenLists(ready_clients_, busy_clients_);
-    ENVOY_CONN_LOG(debug, "using existing connection", *busy_clients_.front()->codec_client_);
-    attachRequestToClient(*busy_clients_.front(), response_decoder, callbacks);
+    // Idle clients are pushed onto the front, so this is the most recently used one.
+    ActiveClient& client = *ready_clients_.front();
+    client.moveBetweenLists(ready_clients_, busy_clients_);
+    if (client.idle_timer_) {
+      client.idle_timer_->disableTimer();
+    }
+    ENVOY_CONN_LOG(debug, "using existing connection", *client.codec_client_);
+    attachRequestToClient(client, response_decoder, callbacks);
+    prefetchConnections();
     return nullptr;
   }
 
@@ -99,6 +110,7 @@ ConnectionPool::Cancellable* ConnPoolImpl::newStream(StreamDecoder& response_dec
     ENVOY_LOG(debug, "queueing request due to no available connections");
     PendingRequestPtr pending_request(new PendingRequest(*this, response_decoder, callbacks));
     pending_request->moveIntoList(std::move(pending_request), pending_requests_);
+    prefetchConnections();
     return pending_requests_.front().get();
   } else {
     ENVOY_LOG(debug, "max pending requests overflow");
@@ -213,16 +225,45 @@ void ConnPoolImpl::onResponseComplete(ActiveClient& client) {
   }
 }
 
+// Creates connections until there are enough for the active and pending requests and the next
+// request, given the prefetch ratio of the cluster. Connections are only prefetched for new
+// requests, not when connections close, so that a host refusing connections is not retried in a
+// loop.
+void ConnPoolImpl::prefetchConnections() {
+  const double prefetch_ratio = host_->cluster().prefetchRatio();
+  if (prefetch_ratio <= 0 || !drained_callbacks_.empty()) {
+    return;
+  }
+
+  const uint64_t wanted_connections = static_cast<uint64_t>(
+      std::ceil(prefetch_ratio * (active_streams_ + pending_requests_.size() + 1)));
+  while (ready_clients_.size() + busy_clients_.size() < wanted_connections &&
+         host_->cluster().resourceManager(priority_).connections().canCreate()) {
+    ENVOY_LOG(debug, "prefetching a connection");
+    host_->cluster().stats().upstream_cx_prefetch_.inc();
+    createNewConnection();
+  }
+}
+
 void ConnPoolImpl::processIdleClient(ActiveClient& client) {
   client.stream_wrapper_.reset();
   if (pending_requests_.empty()) {
     // There is nothing to service so just move the connection into the ready list.
     ENVOY_CONN_LOG(debug, "moving to ready", *client.codec_client_);
     client.moveBetweenLists(busy_clients_, ready_clients_);
+    const Optional<std::chrono::milliseconds>& idle_timeout = host_->cluster().idleTimeout();
+    if (idle_timeout.valid()) {
+      if (!client.idle_timer_) {
+        client.idle_timer_ =
+            dispatcher_.createCoarseTimer([&client]() -> void { client.onIdleTimeout(); });
+      }
+      client.idle_timer_->enableTimer(idle_timeout.value());
+    }
   } else {
     // There is work to do so bind a request to the client and move it to the busy list. Pending
     // requests are pushed onto the front, so pull from the back.
     ENVOY_CONN_LOG(debug, "attaching to next request", *client.codec_client_);
+    pending_requests_.back()->pending_time_->complete();
     attachRequestToClient(client, pending_requests_.back()->decoder_,
                           pending_requests_.back()->callbacks_);
     pending_requests_.pop_back();
@@ -240,11 +281,15 @@ ConnPoolImpl::StreamWrapper::StreamWrapper(StreamDecoder& response_decoder, Acti
   parent_.parent_.host_->cluster().stats().upstream_rq_active_.inc();
   parent_.parent_.host_->stats().rq_total_.inc();
   parent_.parent_.host_->stats().rq_active_.inc();
+  Upstream::LocalActiveRequests::inc(*parent_.parent_.host_);
+  parent_.parent_.active_streams_++;
 }
 
 ConnPoolImpl::StreamWrapper::~StreamWrapper() {
   parent_.parent_.host_->cluster().stats().upstream_rq_active_.dec();
   parent_.parent_.host_->stats().rq_active_.dec();
+  Upstream::LocalActiveRequests::dec(*parent_.parent_.host_);
+  parent_.parent_.active_streams_--;
 }
 
 void ConnPoolImpl::StreamWrapper::onEncodeComplete() { encode_complete_ = true; }
@@ -271,6 +316,12 @@ ConnPoolImpl::PendingRequest::PendingRequest(ConnPoolImpl& parent, StreamDecoder
   parent_.host_->cluster().stats().upstream_rq_pending_total_.inc();
   parent_.host_->cluster().stats().upstream_rq_pending_active_.inc();
   parent_.host_->cluster().resourceManager(parent_.priority_).pendingRequests().inc();
+  // Time spent waiting for a connection is tracked per priority, so that the queueing of high
+  // priority requests can be told apart from that of the default ones.
+  Upstream::ClusterStats& stats = parent_.host_->cluster().stats();
+  pending_time_.reset(new Stats::Timespan(parent_.priority_ == Upstream::ResourcePriority::High
+                                              ? stats.upstream_rq_pending_high_ms_
+                                              : stats.upstream_rq_pending_default_ms_));
 }
 
 ConnPoolImpl::PendingRequest::~PendingRequest() {
@@ -322,6 +373,13 @@ void ConnPoolImpl::ActiveClient::onConnectTimeout() {
   codec_client_->close();
 }
 
+void ConnPoolImpl::ActiveClient::onIdleTimeout() {
+  // The client is in the ready list, which it leaves through the normal close handling.
+  ENVOY_CONN_LOG(debug, "idle timeout", *codec_client_);
+  parent_.host_->cluster().stats().upstream_cx_idle_timeout_.inc();
+  codec_client_->close();
+}
+
 CodecClientPtr ConnPoolImplProd::createCodecClient(Upstream::Host::CreateConnectionData& data) {
   CodecClientPtr codec{new CodecClientProd(CodecClient::Type::HTTP1, std::move(data.connection_),
                                            data.host_description_)};
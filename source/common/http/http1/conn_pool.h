@@ -21,7 +21,9 @@ namespace Http {
 namespace Http1 {
 
 /**
- * A connection pool implementation for HTTP/1.1 connections.
+ * A connection pool implementation for HTTP/1.1 connections. Idle connections are reused most
+ * recently used first, so that with an idle timeout the connections that are not needed for the
+ * current load get closed.
  * NOTE: The connection pool does NOT do DNS resolution. It assumes it is being given a numeric IP
  *       address. Higher layer code should handle resolving DNS on error and creating a new pool
  *       bound to a different IP address.
@@ -38,6 +40,7 @@ public:
   Http::Protocol protocol() const override { return Http::Protocol::Http11; }
   void addDrainedCallback(DrainedCb cb) override;
   void drainConnections() override;
+  void prefetch() override;
   ConnectionPool::Cancellable* newStream(StreamDecoder& response_decoder,
                                          ConnectionPool::Callbacks& callbacks) override;
 
@@ -78,6 +81,7 @@ protected:
     ~ActiveClient();
 
     void onConnectTimeout();
+    void onIdleTimeout();
 
     // Network::ConnectionCallbacks
     void onEvent(Network::ConnectionEvent event) override {
@@ -91,6 +95,8 @@ protected:
     Upstream::HostDescriptionConstSharedPtr real_host_description_;
     StreamWrapperPtr stream_wrapper_;
     Event::TimerPtr connect_timer_;
+    // Only created if the cluster has an idle timeout.
+    Event::TimerPtr idle_timer_;
     Stats::TimespanPtr conn_length_;
     uint64_t remaining_requests_;
   };
@@ -108,6 +114,7 @@ protected:
     ConnPoolImpl& parent_;
     StreamDecoder& decoder_;
     ConnectionPool::Callbacks& callbacks_;
+    Stats::TimespanPtr pending_time_;
   };
 
   typedef std::unique_ptr<PendingRequest> PendingRequestPtr;
@@ -122,6 +129,7 @@ protected:
   void onPendingRequestCancel(PendingRequest& request);
   void onResponseComplete(ActiveClient& client);
   void processIdleClient(ActiveClient& client);
+  void prefetchConnections();
 
   Stats::TimespanPtr conn_connect_ms_;
   Event::Dispatcher& dispatcher_;
@@ -131,6 +139,8 @@ protected:
   std::list<PendingRequestPtr> pending_requests_;
   std::list<DrainedCb> drained_callbacks_;
   Upstream::ResourcePriority priority_;
+  // The number of clients with a stream attached.
+  uint64_t active_streams_{};
 };
 
 /**
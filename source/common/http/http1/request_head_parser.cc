@@ -0,0 +1,184 @@
+#include "common/http/http1/request_head_parser.h"
+
+#include <algorithm>
+#include <cstring>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+namespace Envoy {
+namespace Http {
+namespace Http1 {
+
+namespace {
+
+// The header field name characters of RFC 7230, section 3.2.6.
+const std::array<bool, 256>& tokenTable() {
+  static const std::array<bool, 256> table = []() -> std::array<bool, 256> {
+    std::array<bool, 256> table{};
+    for (int c = '0'; c <= '9'; c++) {
+      table[c] = true;
+    }
+    for (int c = 'a'; c <= 'z'; c++) {
+      table[c] = true;
+      table[c - 'a' + 'A'] = true;
+    }
+    for (const char* c = "!#$%&'*+-.^_`|~"; *c != 0; c++) {
+      table[static_cast<uint8_t>(*c)] = true;
+    }
+    return table;
+  }();
+  return table;
+}
+
+/**
+ * @return the first byte in [begin, end) that is at most `max` or is DEL, or end if there is none.
+ * With max set to 0x1f this finds control characters, and with 0x20 it also finds spaces.
+ */
+const char* findControl(const char* begin, const char* end, uint8_t max) {
+  const char* current = begin;
+#ifdef __SSE2__
+  const __m128i max_vector = _mm_set1_epi8(static_cast<char>(max));
+  const __m128i del_vector = _mm_set1_epi8(0x7f);
+  for (; end - current >= 16; current += 16) {
+    const __m128i block = _mm_loadu_si128(reinterpret_cast<const __m128i*>(current));
+    // An unsigned byte is at most max exactly when min(byte, max) is the byte itself.
+    const __m128i low = _mm_cmpeq_epi8(_mm_min_epu8(block, max_vector), block);
+    const __m128i del = _mm_cmpeq_epi8(block, del_vector);
+    const int mask = _mm_movemask_epi8(_mm_or_si128(low, del));
+    if (mask != 0) {
+      return current + __builtin_ctz(mask);
+    }
+  }
+#endif
+  for (; current < end; current++) {
+    const uint8_t c = *current;
+    if (c <= max || c == 0x7f) {
+      return current;
+    }
+  }
+  return end;
+}
+
+bool equalsIgnoreCase(const RequestHeadParser::Token& token, const char* lower_case) {
+  const size_t size = strlen(lower_case);
+  if (token.size_ != size) {
+    return false;
+  }
+  for (size_t i = 0; i < size; i++) {
+    if ((token.data_[i] | 0x20) != lower_case[i]) {
+      return false;
+    }
+  }
+  return true;
+}
+
+/**
+ * @return whether a header requires handling that is left to http_parser: framing of a body,
+ *         connection upgrades, or any use of connection other than keep-alive.
+ */
+bool needsFullParser(const RequestHeadParser::Header& header) {
+  switch (header.name_.size_) {
+  case 7:
+    return equalsIgnoreCase(header.name_, "upgrade");
+  case 10:
+    return equalsIgnoreCase(header.name_, "connection") &&
+           !equalsIgnoreCase(header.value_, "keep-alive");
+  case 14:
+    return equalsIgnoreCase(header.name_, "content-length");
+  case 17:
+    return equalsIgnoreCase(header.name_, "transfer-encoding");
+  default:
+    return false;
+  }
+}
+
+const char RequestLineSuffix[] = " HTTP/1.1\r\n";
+
+} // namespace
+
+constexpr size_t RequestHeadParser::MaxHeaders;
+constexpr size_t RequestHeadParser::MaxHeadSize;
+
+bool RequestHeadParser::parse(const char* data, size_t size) {
+  const char* const end = data + std::min(size, MaxHeadSize);
+  const char* current = data;
+
+  // The method. The caller checks that it is one that it knows.
+  while (current < end && *current >= 'A' && *current <= 'Z') {
+    current++;
+  }
+  if (current == data || current == end || *current != ' ') {
+    return false;
+  }
+  method_ = {data, static_cast<uint32_t>(current - data)};
+  current++;
+
+  // An origin-form request target, which runs until the first space or control character.
+  if (current == end || *current != '/') {
+    return false;
+  }
+  const char* target_end = findControl(current, end, 0x20);
+  if (static_cast<size_t>(end - target_end) < sizeof(RequestLineSuffix) - 1 ||
+      memcmp(target_end, RequestLineSuffix, sizeof(RequestLineSuffix) - 1) != 0) {
+    return false;
+  }
+  path_ = {current, static_cast<uint32_t>(target_end - current)};
+  current = target_end + sizeof(RequestLineSuffix) - 1;
+
+  const std::array<bool, 256>& token_table = tokenTable();
+  num_headers_ = 0;
+  while (true) {
+    if (end - current < 2) {
+      return false;
+    }
+    if (current[0] == '\r' && current[1] == '\n') {
+      head_size_ = current + 2 - data;
+      return true;
+    }
+    if (num_headers_ == MaxHeaders) {
+      return false;
+    }
+
+    const char* name = current;
+    while (current < end && token_table[static_cast<uint8_t>(*current)]) {
+      current++;
+    }
+    if (current == name || current == end || *current != ':') {
+      return false;
+    }
+    const uint32_t name_size = current - name;
+    current++;
+    while (current < end && (*current == ' ' || *current == '\t')) {
+      current++;
+    }
+
+    // The value runs until a control character other than a tab, which must start the CRLF.
+    const char* value = current;
+    const char* value_end = findControl(current, end, 0x1f);
+    while (value_end < end && *value_end == '\t') {
+      value_end = findControl(value_end + 1, end, 0x1f);
+    }
+    if (end - value_end < 2 || value_end[0] != '\r' || value_end[1] != '\n') {
+      return false;
+    }
+    // Empty values and trailing whitespace are left to http_parser, so that their handling stays
+    // exactly that of the http_parser path.
+    if (value_end == value || value_end[-1] == ' ' || value_end[-1] == '\t') {
+      return false;
+    }
+
+    Header& header = headers_[num_headers_++];
+    header.name_ = {name, name_size};
+    header.value_ = {value, static_cast<uint32_t>(value_end - value)};
+    if (needsFullParser(header)) {
+      return false;
+    }
+    current = value_end + 2;
+  }
+}
+
+} // namespace Http1
+} // namespace Http
+} // namespace Envoy
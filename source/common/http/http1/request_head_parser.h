@@ -0,0 +1,68 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+namespace Envoy {
+namespace Http {
+namespace Http1 {
+
+/**
+ * Parser for the common shape of an HTTP/1.1 request head: an origin-form request line followed by
+ * header fields, with no body and no connection upgrade. In the style of picohttpparser, the
+ * request target and header values are delimited by vectorized scans for control characters
+ * instead of a per-byte state machine.
+ *
+ * Only a strict subset of the protocol is accepted. Anything outside of it, including incomplete
+ * heads and every malformed one, makes parse() return false without side effects, so that the
+ * caller can hand the bytes to http_parser, which then produces the result or protocol error. For
+ * every head that the parser accepts, it produces exactly what the codec would have built from
+ * http_parser's callbacks.
+ */
+class RequestHeadParser {
+public:
+  static constexpr size_t MaxHeaders = 64;
+  // http_parser's default HTTP_MAX_HEADER_SIZE.
+  static constexpr size_t MaxHeadSize = 80 * 1024;
+
+  struct Token {
+    const char* data_;
+    uint32_t size_;
+  };
+
+  struct Header {
+    Token name_;
+    Token value_;
+  };
+
+  /**
+   * Parse a request head at the start of a buffer.
+   * @param data supplies the buffer.
+   * @param size supplies the size of the buffer.
+   * @return bool true if the buffer starts with a complete request head in the supported subset.
+   *         The accessors below are only valid in that case, and point into the buffer.
+   */
+  bool parse(const char* data, size_t size);
+
+  const Token& method() const { return method_; }
+  const Token& path() const { return path_; }
+  size_t numHeaders() const { return num_headers_; }
+  const Header& header(size_t index) const { return headers_[index]; }
+
+  /**
+   * @return size_t the size of the head, including the empty line that ends it.
+   */
+  size_t headSize() const { return head_size_; }
+
+private:
+  Token method_;
+  Token path_;
+  std::array<Header, MaxHeaders> headers_;
+  size_t num_headers_;
+  size_t head_size_;
+};
+
+} // namespace Http1
+} // namespace Http
+} // namespace Envoy
@@ -1,5 +1,6 @@
 #include "common/http/http2/codec_impl.h"
 
+#include <algorithm>
 #include <cstdint>
 #include <memory>
 #include <vector>
@@ -77,28 +78,23 @@ static void insertHeader(std::vector<nghttp2_nv>& headers, const HeaderEntry& he
 
 void ConnectionImpl::StreamImpl::buildHeaders(std::vector<nghttp2_nv>& final_headers,
                                               const HeaderMap& headers) {
-  // nghttp2 requires that all ':' headers come before all other headers. To avoid making higher
-  // layers understand that we do two passes here to build the final header list to encode.
   final_headers.reserve(headers.size());
   headers.iterate(
       [](const HeaderEntry& header, void* context) -> HeaderMap::Iterate {
-        std::vector<nghttp2_nv>* final_headers = static_cast<std::vector<nghttp2_nv>*>(context);
-        if (header.key().c_str()[0] == ':') {
-          insertHeader(*final_headers, header);
-        }
+        insertHeader(*static_cast<std::vector<nghttp2_nv>*>(context), header);
         return HeaderMap::Iterate::Continue;
       },
       &final_headers);
 
-  headers.iterate(
-      [](const HeaderEntry& header, void* context) -> HeaderMap::Iterate {
-        std::vector<nghttp2_nv>* final_headers = static_cast<std::vector<nghttp2_nv>*>(context);
-        if (header.key().c_str()[0] != ':') {
-          insertHeader(*final_headers, header);
-        }
-        return HeaderMap::Iterate::Continue;
-      },
-      &final_headers);
+  // nghttp2 requires that all ':' headers come before all other headers. To avoid making higher
+  // layers understand that we move them forward here. Pseudo headers are normally added first, so
+  // in the common case this is a single scan of the list built above and no reordering.
+  const auto is_pseudo_header = [](const nghttp2_nv& header) -> bool {
+    return header.name[0] == ':';
+  };
+  if (!std::is_partitioned(final_headers.begin(), final_headers.end(), is_pseudo_header)) {
+    std::stable_partition(final_headers.begin(), final_headers.end(), is_pseudo_header);
+  }
 }
 
 void ConnectionImpl::StreamImpl::encodeHeaders(const HeaderMap& headers, bool end_stream) {
@@ -220,9 +216,9 @@ int ConnectionImpl::StreamImpl::onDataSourceSend(const uint8_t* framehd, size_t
   // https://nghttp2.org/documentation/types.html#c.nghttp2_send_data_callback
   static const uint64_t FRAME_HEADER_SIZE = 9;
 
-  Buffer::OwnedImpl output(framehd, FRAME_HEADER_SIZE);
-  output.move(pending_send_data_, length);
-  parent_.connection_.write(output);
+  parent_.pending_output_.add(framehd, FRAME_HEADER_SIZE);
+  parent_.pending_output_.move(pending_send_data_, length);
+  parent_.pending_output_frames_++;
   return 0;
 }
 
@@ -505,8 +501,10 @@ int ConnectionImpl::onInvalidFrame(int error_code) {
 
 ssize_t ConnectionImpl::onSend(const uint8_t* data, size_t length) {
   ENVOY_CONN_LOG(trace, "send data: bytes={}", connection_, length);
-  Buffer::OwnedImpl buffer(data, length);
-  connection_.write(buffer);
+  // Control frames and headers are small, so copying them into the pending output packs
+  // consecutive ones into the same slices.
+  pending_output_.add(data, length);
+  pending_output_frames_++;
   return length;
 }
 
@@ -564,6 +562,7 @@ void ConnectionImpl::sendPendingFrames() {
   }
 
   int rc = nghttp2_session_send(session_);
+  writePendingOutput();
   if (rc != 0) {
     ASSERT(rc == NGHTTP2_ERR_CALLBACK_FAILURE);
     throw CodecProtocolException(fmt::format("{}", nghttp2_strerror(rc)));
@@ -592,6 +591,19 @@ void ConnectionImpl::sendPendingFrames() {
   }
 }
 
+void ConnectionImpl::writePendingOutput() {
+  if (pending_output_frames_ == 0) {
+    return;
+  }
+
+  ENVOY_CONN_LOG(trace, "writing {} frames: bytes={}", connection_, pending_output_frames_,
+                 pending_output_.length());
+  stats_.tx_frames_.add(pending_output_frames_);
+  stats_.tx_writes_.inc();
+  pending_output_frames_ = 0;
+  connection_.write(pending_output_);
+}
+
 void ConnectionImpl::sendSettings(const Http2Settings& http2_settings, bool disable_push) {
   ASSERT(http2_settings.hpack_table_size_ <= Http2Settings::MAX_HPACK_TABLE_SIZE);
   ASSERT(Http2Settings::MIN_MAX_CONCURRENT_STREAMS <= http2_settings.max_concurrent_streams_ &&
@@ -603,6 +615,8 @@ void ConnectionImpl::sendSettings(const Http2Settings& http2_settings, bool disa
              http2_settings.initial_connection_window_size_ &&
          http2_settings.initial_connection_window_size_ <=
              Http2Settings::MAX_INITIAL_CONNECTION_WINDOW_SIZE);
+  ASSERT(Http2Settings::MIN_MAX_FRAME_SIZE <= http2_settings.max_frame_size_ &&
+         http2_settings.max_frame_size_ <= Http2Settings::MAX_MAX_FRAME_SIZE);
 
   std::vector<nghttp2_settings_entry> iv;
 
@@ -625,6 +639,12 @@ void ConnectionImpl::sendSettings(const Http2Settings& http2_settings, bool disa
                    http2_settings.initial_stream_window_size_);
   }
 
+  if (http2_settings.max_frame_size_ != Http2Settings::DEFAULT_MAX_FRAME_SIZE) {
+    iv.push_back({NGHTTP2_SETTINGS_MAX_FRAME_SIZE, http2_settings.max_frame_size_});
+    ENVOY_CONN_LOG(debug, "setting max frame size to {}", connection_,
+                   http2_settings.max_frame_size_);
+  }
+
   if (disable_push) {
     // Universally disable receiving push promise frames as we don't currently support them. nghttp2
     // will fail the connection if the other side still sends them.
@@ -703,6 +723,16 @@ ConnectionImpl::Http2Callbacks::Http2Callbacks() {
         return static_cast<ConnectionImpl*>(user_data)->onFrameReceived(frame);
       });
 
+  // By default nghttp2 never sends DATA frames larger than 16KiB. Fill frames up to what the peer
+  // accepts instead, so that large bodies take fewer frames.
+  nghttp2_session_callbacks_set_data_source_read_length_callback(
+      callbacks_,
+      [](nghttp2_session*, uint8_t, int32_t, int32_t session_remote_window_size,
+         int32_t stream_remote_window_size, uint32_t remote_max_frame_size, void*) -> ssize_t {
+        return std::min<ssize_t>({session_remote_window_size, stream_remote_window_size,
+                                  static_cast<ssize_t>(remote_max_frame_size)});
+      });
+
   nghttp2_session_callbacks_set_on_stream_close_callback(
       callbacks_,
       [](nghttp2_session*, int32_t stream_id, uint32_t error_code, void* user_data) -> int {
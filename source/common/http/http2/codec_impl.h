@@ -41,7 +41,9 @@ const std::string CLIENT_MAGIC_PREFIX = "PRI * HTTP/2";
   COUNTER(tx_reset)                                                                                \
   COUNTER(header_overflow)                                                                         \
   COUNTER(trailers)                                                                                \
-  COUNTER(headers_cb_no_stream)
+  COUNTER(headers_cb_no_stream)                                                                    \
+  COUNTER(tx_frames)                                                                               \
+  COUNTER(tx_writes)
 // clang-format on
 
 /**
@@ -232,6 +234,8 @@ protected:
   int saveHeader(const nghttp2_frame* frame, HeaderString&& name, HeaderString&& value);
   void sendPendingFrames();
   void sendSettings(const Http2Settings& http2_settings, bool disable_push);
+  // Write the frames in pending_output_ to the connection.
+  void writePendingOutput();
 
   static Http2Callbacks http2_callbacks_;
   static Http2Options http2_options_;
@@ -241,6 +245,10 @@ protected:
   CodecStats stats_;
   Network::Connection& connection_;
   uint32_t per_stream_buffer_limit_;
+  // Frames serialized during nghttp2_session_send(). They are coalesced here and written to the
+  // connection together once it returns, rather than one write per frame.
+  Buffer::OwnedImpl pending_output_;
+  uint64_t pending_output_frames_{};
 
 private:
   virtual ConnectionCallbacks& callbacks() PURE;
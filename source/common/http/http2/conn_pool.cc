@@ -8,6 +8,7 @@
 
 #include "common/http/http2/codec_impl.h"
 #include "common/network/utility.h"
+#include "common/upstream/local_active_requests.h"
 #include "common/upstream/upstream_impl.h"
 
 namespace Envoy {
@@ -19,21 +20,30 @@ ConnPoolImpl::ConnPoolImpl(Event::Dispatcher& dispatcher, Upstream::HostConstSha
     : dispatcher_(dispatcher), host_(host), priority_(priority) {}
 
 ConnPoolImpl::~ConnPoolImpl() {
-  if (primary_client_) {
-    primary_client_->client_->close();
+  while (!primary_clients_.empty()) {
+    primary_clients_.front()->client_->close();
   }
 
-  if (draining_client_) {
-    draining_client_->client_->close();
+  while (!draining_clients_.empty()) {
+    draining_clients_.front()->client_->close();
   }
 
   // Make sure all clients are destroyed before we are destroyed.
   dispatcher_.clearDeferredDeleteList();
 }
 
-void ConnPoolImpl::ConnPoolImpl::drainConnections() {
-  if (primary_client_ != nullptr) {
-    movePrimaryClientToDraining();
+void ConnPoolImpl::ConnPoolImpl::drainConnections() { movePrimaryClientsToDraining(); }
+
+void ConnPoolImpl::prefetch() {
+  // The streams are spread over a fixed number of connections, so prefetching opens all of them.
+  if (host_->cluster().prefetchRatio() <= 0 || !drained_callbacks_.empty()) {
+    return;
+  }
+
+  while (primary_clients_.size() < host_->cluster().http2ConnectionsPerHost()) {
+    ENVOY_LOG(debug, "prefetching a connection");
+    host_->cluster().stats().upstream_cx_prefetch_.inc();
+    createPrimaryClient();
   }
 }
 
@@ -47,22 +57,11 @@ void ConnPoolImpl::checkForDrained() {
     return;
   }
 
-  bool drained = true;
-  if (primary_client_) {
-    if (primary_client_->client_->numActiveRequests() == 0) {
-      primary_client_->client_->close();
-      ASSERT(!primary_client_);
-    } else {
-      drained = false;
-    }
-  }
-
-  ASSERT(!draining_client_ || (draining_client_->client_->numActiveRequests() > 0));
-  if (draining_client_ && draining_client_->client_->numActiveRequests() > 0) {
-    drained = false;
-  }
+  // This closes the primary clients without active requests. Draining clients with active
+  // requests are closed when their last request completes.
+  movePrimaryClientsToDraining();
 
-  if (drained) {
+  if (primary_clients_.empty() && draining_clients_.empty()) {
     ENVOY_LOG(debug, "invoking drained callbacks");
     for (const DrainedCb& cb : drained_callbacks_) {
       cb();
@@ -70,38 +69,65 @@ void ConnPoolImpl::checkForDrained() {
   }
 }
 
-ConnectionPool::Cancellable* ConnPoolImpl::newStream(Http::StreamDecoder& response_decoder,
-                                                     ConnectionPool::Callbacks& callbacks) {
-  ASSERT(drained_callbacks_.empty());
-
+ConnPoolImpl::ActiveClient& ConnPoolImpl::chooseClient() {
   // First see if we need to handle max streams rollover.
   uint64_t max_streams = host_->cluster().maxRequestsPerConnection();
   if (max_streams == 0) {
     max_streams = maxTotalStreams();
   }
 
-  if (primary_client_ && primary_client_->total_streams_ >= max_streams) {
-    movePrimaryClientToDraining();
+  for (auto it = primary_clients_.begin(); it != primary_clients_.end();) {
+    ActiveClient& client = **it++;
+    if (client.total_streams_ >= max_streams) {
+      moveClientToDraining(client);
+    }
   }
 
-  if (!primary_client_) {
-    primary_client_.reset(new ActiveClient(*this));
+  ActiveClient* least_loaded = nullptr;
+  for (const ActiveClientPtr& client : primary_clients_) {
+    if (least_loaded == nullptr ||
+        client->client_->numActiveRequests() < least_loaded->client_->numActiveRequests()) {
+      least_loaded = client.get();
+    }
+  }
+
+  // A new connection is only worth it if every primary client already has streams.
+  if (least_loaded == nullptr ||
+      (least_loaded->client_->numActiveRequests() > 0 &&
+       primary_clients_.size() < host_->cluster().http2ConnectionsPerHost())) {
+    createPrimaryClient();
+    least_loaded = primary_clients_.front().get();
   }
 
+  return *least_loaded;
+}
+
+void ConnPoolImpl::createPrimaryClient() {
+  ActiveClientPtr client(new ActiveClient(*this));
+  client->moveIntoList(std::move(client), primary_clients_);
+}
+
+ConnectionPool::Cancellable* ConnPoolImpl::newStream(Http::StreamDecoder& response_decoder,
+                                                     ConnectionPool::Callbacks& callbacks) {
+  ASSERT(drained_callbacks_.empty());
+
+  ActiveClient& client = chooseClient();
+
   if (!host_->cluster().resourceManager(priority_).requests().canCreate()) {
     ENVOY_LOG(debug, "max requests overflow");
     callbacks.onPoolFailure(ConnectionPool::PoolFailureReason::Overflow, nullptr);
     host_->cluster().stats().upstream_rq_pending_overflow_.inc();
   } else {
-    ENVOY_CONN_LOG(debug, "creating stream", *primary_client_->client_);
-    primary_client_->total_streams_++;
+    ENVOY_CONN_LOG(debug, "creating stream", *client.client_);
+    client.total_streams_++;
     host_->stats().rq_total_.inc();
     host_->stats().rq_active_.inc();
+    Upstream::LocalActiveRequests::inc(*host_);
     host_->cluster().stats().upstream_rq_total_.inc();
     host_->cluster().stats().upstream_rq_active_.inc();
     host_->cluster().resourceManager(priority_).requests().inc();
-    callbacks.onPoolReady(primary_client_->client_->newStream(response_decoder),
-                          primary_client_->real_host_description_);
+    callbacks.onPoolReady(client.client_->newStream(response_decoder),
+                          client.real_host_description_);
   }
 
   return nullptr;
@@ -120,12 +146,12 @@ void ConnPoolImpl::onConnectionEvent(ActiveClient& client, Network::ConnectionEv
       }
     }
 
-    if (&client == primary_client_.get()) {
-      ENVOY_CONN_LOG(debug, "destroying primary client", *client.client_);
-      dispatcher_.deferredDelete(std::move(primary_client_));
-    } else {
+    if (client.draining_) {
       ENVOY_CONN_LOG(debug, "destroying draining client", *client.client_);
-      dispatcher_.deferredDelete(std::move(draining_client_));
+      dispatcher_.deferredDelete(client.removeFromList(draining_clients_));
+    } else {
+      ENVOY_CONN_LOG(debug, "destroying primary client", *client.client_);
+      dispatcher_.deferredDelete(client.removeFromList(primary_clients_));
     }
 
     if (client.connect_timer_) {
@@ -139,7 +165,7 @@ void ConnPoolImpl::onConnectionEvent(ActiveClient& client, Network::ConnectionEv
   }
 
   if (event == Network::ConnectionEvent::Connected) {
-    conn_connect_ms_->complete();
+    client.conn_connect_ms_->complete();
   }
 
   if (client.connect_timer_) {
@@ -148,25 +174,23 @@ void ConnPoolImpl::onConnectionEvent(ActiveClient& client, Network::ConnectionEv
   }
 }
 
-void ConnPoolImpl::movePrimaryClientToDraining() {
-  ENVOY_CONN_LOG(debug, "moving primary to draining", *primary_client_->client_);
-  if (draining_client_) {
-    // This should pretty much never happen, but is possible if we start draining and then get
-    // a goaway for example. In this case just kill the current draining connection. It's not
-    // worth keeping a list.
-    draining_client_->client_->close();
-  }
-
-  ASSERT(!draining_client_);
-  if (primary_client_->client_->numActiveRequests() == 0) {
-    // If we are making a new connection and the primary does not have any active requests just
-    // close it now.
-    primary_client_->client_->close();
+void ConnPoolImpl::moveClientToDraining(ActiveClient& client) {
+  ASSERT(!client.draining_);
+  ENVOY_CONN_LOG(debug, "moving primary to draining", *client.client_);
+  if (client.client_->numActiveRequests() == 0) {
+    // If the primary does not have any active requests just close it now.
+    client.client_->close();
   } else {
-    draining_client_ = std::move(primary_client_);
+    client.draining_ = true;
+    client.moveBetweenLists(primary_clients_, draining_clients_);
   }
+}
 
-  ASSERT(!primary_client_);
+void ConnPoolImpl::movePrimaryClientsToDraining() {
+  // Either way the client leaves the primary list, so keep going until the list is empty.
+  while (!primary_clients_.empty()) {
+    moveClientToDraining(*primary_clients_.front());
+  }
 }
 
 void ConnPoolImpl::onConnectTimeout(ActiveClient& client) {
@@ -178,8 +202,8 @@ void ConnPoolImpl::onConnectTimeout(ActiveClient& client) {
 void ConnPoolImpl::onGoAway(ActiveClient& client) {
   ENVOY_CONN_LOG(debug, "remote goaway", *client.client_);
   host_->cluster().stats().upstream_cx_close_notify_.inc();
-  if (&client == primary_client_.get()) {
-    movePrimaryClientToDraining();
+  if (!client.draining_) {
+    moveClientToDraining(client);
   }
 }
 
@@ -187,9 +211,10 @@ void ConnPoolImpl::onStreamDestroy(ActiveClient& client) {
   ENVOY_CONN_LOG(debug, "destroying stream: {} remaining", *client.client_,
                  client.client_->numActiveRequests());
   host_->stats().rq_active_.dec();
+  Upstream::LocalActiveRequests::dec(*host_);
   host_->cluster().stats().upstream_rq_active_.dec();
   host_->cluster().resourceManager(priority_).requests().dec();
-  if (&client == draining_client_.get() && client.client_->numActiveRequests() == 0) {
+  if (client.draining_ && client.client_->numActiveRequests() == 0) {
     // Close out the draining client if we no long have active requests.
     client.client_->close();
   }
@@ -218,7 +243,7 @@ ConnPoolImpl::ActiveClient::ActiveClient(ConnPoolImpl& parent)
     : parent_(parent),
       connect_timer_(parent_.dispatcher_.createTimer([this]() -> void { onConnectTimeout(); })) {
 
-  parent_.conn_connect_ms_.reset(
+  conn_connect_ms_.reset(
       new Stats::Timespan(parent_.host_->cluster().stats().upstream_cx_connect_ms_));
   Upstream::Host::CreateConnectionData data = parent_.host_->createConnection(parent_.dispatcher_);
   real_host_description_ = data.host_description_;
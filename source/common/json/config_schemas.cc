@@ -926,6 +926,46 @@ const std::string Json::Schema::HTTP_RATE_LIMITS_CONFIGURATION_SCHEMA(R"EOF(
   }
   )EOF");
 
+const std::string Json::Schema::ADAPTIVE_CONCURRENCY_HTTP_FILTER_SCHEMA(R"EOF(
+  {
+    "$schema": "http://json-schema.org/schema#",
+    "type" : "object",
+    "properties" : {
+      "initial_limit" : {
+        "type" : "integer",
+        "minimum" : 1
+      },
+      "min_limit" : {
+        "type" : "integer",
+        "minimum" : 1
+      },
+      "max_limit" : {
+        "type" : "integer",
+        "minimum" : 1
+      },
+      "window_ms" : {
+        "type" : "integer",
+        "minimum" : 1
+      },
+      "min_window_samples" : {
+        "type" : "integer",
+        "minimum" : 1
+      },
+      "smoothing" : {
+        "type" : "number",
+        "minimum" : 0,
+        "exclusiveMinimum" : true,
+        "maximum" : 1
+      },
+      "tolerance" : {
+        "type" : "number",
+        "minimum" : 1
+      }
+    },
+    "additionalProperties" : false
+  }
+  )EOF");
+
 const std::string Json::Schema::BUFFER_HTTP_FILTER_SCHEMA(R"EOF(
   {
     "$schema": "http://json-schema.org/schema#",
@@ -939,6 +979,73 @@ const std::string Json::Schema::BUFFER_HTTP_FILTER_SCHEMA(R"EOF(
   }
   )EOF");
 
+const std::string Json::Schema::CACHE_HTTP_FILTER_SCHEMA(R"EOF(
+  {
+    "$schema": "http://json-schema.org/schema#",
+    "type" : "object",
+    "properties" : {
+      "max_responses" : {
+        "type" : "integer",
+        "minimum" : 0
+      },
+      "max_bytes" : {
+        "type" : "integer",
+        "minimum" : 0
+      },
+      "shared_max_bytes" : {
+        "type" : "integer",
+        "minimum" : 0
+      },
+      "max_body_bytes" : {
+        "type" : "integer",
+        "minimum" : 0
+      },
+      "default_ttl_ms" : {
+        "type" : "integer",
+        "minimum" : 0
+      }
+    },
+    "additionalProperties" : false
+  }
+  )EOF");
+
+const std::string Json::Schema::GZIP_HTTP_FILTER_SCHEMA(R"EOF(
+  {
+    "$schema": "http://json-schema.org/schema#",
+    "type" : "object",
+    "properties" : {
+      "compression_level" : {
+        "type" : "string",
+        "enum" : ["best", "speed", "default"]
+      },
+      "compression_strategy" : {
+        "type" : "string",
+        "enum" : ["default", "filtered", "huffman", "rle"]
+      },
+      "window_bits" : {
+        "type" : "integer",
+        "minimum" : 9,
+        "maximum" : 15
+      },
+      "memory_level" : {
+        "type" : "integer",
+        "minimum" : 1,
+        "maximum" : 9
+      },
+      "content_length" : {
+        "type" : "integer",
+        "minimum" : 0
+      },
+      "content_type" : {
+        "type" : "array",
+        "items" : {"type" : "string"}
+      },
+      "sync_flush" : {"type" : "boolean"}
+    },
+    "additionalProperties" : false
+  }
+  )EOF");
+
 const std::string Json::Schema::LUA_HTTP_FILTER_SCHEMA(R"EOF(
   {
     "$schema": "http://json-schema.org/schema#",
@@ -1233,7 +1340,8 @@ const std::string Json::Schema::TOP_LEVEL_CONFIG_SCHEMA(R"EOF(
             "type" : "object",
             "properties" : {
               "collector_cluster" : {"type" : "string"},
-              "access_token_file" : {"type" : "string"}
+              "access_token_file" : {"type" : "string"},
+              "reporting_thread" : {"type" : "boolean"}
             },
             "required": ["collector_cluster", "access_token_file"],
             "additionalProperties" : false
@@ -1253,7 +1361,11 @@ const std::string Json::Schema::TOP_LEVEL_CONFIG_SCHEMA(R"EOF(
             "type" : "object",
             "properties" : {
               "collector_cluster" : {"type" : "string"},
-              "collector_endpoint": {"type": "string"}
+              "collector_endpoint": {"type": "string"},
+              "collector_endpoint_version": {
+                "type": "string",
+                "enum": ["HTTP_JSON_V1", "HTTP_PROTO"]
+              }
             },
             "required": ["collector_cluster"],
             "additionalProperties" : false
@@ -1460,7 +1572,8 @@ const std::string Json::Schema::CLUSTER_SCHEMA(R"EOF(
       },
       "lb_type" : {
         "type" : "string",
-        "enum" : ["round_robin", "least_request", "random", "ring_hash", "original_dst_lb"]
+        "enum" : ["round_robin", "least_request", "random", "ring_hash", "original_dst_lb",
+                  "maglev", "peak_ewma"]
       },
       "ring_hash_lb_config" : {
         "type" : "object",
@@ -1669,4 +1782,64 @@ const std::string Json::Schema::SDS_SCHEMA(R"EOF(
     "required" : ["hosts"]
   }
   )EOF");
+
+const std::string Json::Schema::RATE_LIMIT_LOCAL_SCHEMA(R"EOF(
+  {
+    "$schema": "http://json-schema.org/schema#",
+    "definitions" : {
+      "entry" : {
+        "type" : "object",
+        "properties" : {
+          "key" : {"type" : "string"},
+          "value" : {"type" : "string"}
+        },
+        "required" : ["key", "value"],
+        "additionalProperties" : false
+      },
+      "limit" : {
+        "type" : "object",
+        "properties" : {
+          "domain" : {"type" : "string", "minLength" : 1},
+          "descriptor" : {
+            "type" : "array",
+            "minItems" : 1,
+            "items" : {"$ref" : "#/definitions/entry"}
+          },
+          "tokens_per_second" : {
+            "type" : "number",
+            "minimum" : 0,
+            "exclusiveMinimum" : true
+          },
+          "max_tokens" : {
+            "type" : "integer",
+            "minimum" : 1
+          }
+        },
+        "required" : ["domain", "descriptor", "tokens_per_second", "max_tokens"],
+        "additionalProperties" : false
+      }
+    },
+    "type" : "object",
+    "properties" : {
+      "near_limit_ratio" : {
+        "type" : "number",
+        "minimum" : 0,
+        "maximum" : 1
+      },
+      "limits" : {
+        "type" : "array",
+        "items" : {"$ref" : "#/definitions/limit"}
+      },
+      "over_limit_cache_ms" : {
+        "type" : "integer",
+        "minimum" : 0
+      },
+      "batch_flush_interval_ms" : {
+        "type" : "integer",
+        "minimum" : 0
+      }
+    },
+    "additionalProperties" : false
+  }
+  )EOF");
 } // namespace Envoy
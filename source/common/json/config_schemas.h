@@ -36,9 +36,12 @@ public:
   static const std::string QUERY_PARAMETER_CONFIGURATION_SCHEMA;
 
   // HTTP Filter Schemas
+  static const std::string ADAPTIVE_CONCURRENCY_HTTP_FILTER_SCHEMA;
   static const std::string BUFFER_HTTP_FILTER_SCHEMA;
+  static const std::string CACHE_HTTP_FILTER_SCHEMA;
   static const std::string FAULT_HTTP_FILTER_SCHEMA;
   static const std::string GRPC_JSON_TRANSCODER_FILTER_SCHEMA;
+  static const std::string GZIP_HTTP_FILTER_SCHEMA;
   static const std::string HEALTH_CHECK_HTTP_FILTER_SCHEMA;
   static const std::string IP_TAGGING_HTTP_FILTER_SCHEMA;
   static const std::string RATE_LIMIT_HTTP_FILTER_SCHEMA;
@@ -56,6 +59,9 @@ public:
 
   // Redis Schemas
   static const std::string REDIS_CONN_POOL_SCHEMA;
+
+  // Rate Limit Schemas
+  static const std::string RATE_LIMIT_LOCAL_SCHEMA;
 };
 
 } // namespace Json
@@ -3,6 +3,8 @@
 #include <cstdint>
 #include <fstream>
 #include <limits>
+#include <memory>
+#include <mutex>
 #include <sstream>
 #include <stack>
 #include <string>
@@ -39,30 +41,49 @@ typedef std::shared_ptr<Field> FieldSharedPtr;
 
 class Field : public Object {
 public:
+  enum class Type {
+    Array,
+    Boolean,
+    Double,
+    Integer,
+    Null,
+    Object,
+    String,
+  };
+
+  // Use the factories below, which allocate the field and its reference count together.
+  explicit Field(Type type) : type_(type) {}
+  explicit Field(std::string&& value) : type_(Type::String) {
+    value_.string_value_ = std::move(value);
+  }
+  explicit Field(int64_t value) : type_(Type::Integer) { value_.integer_value_ = value; }
+  explicit Field(double value) : type_(Type::Double) { value_.double_value_ = value; }
+  explicit Field(bool value) : type_(Type::Boolean) { value_.boolean_value_ = value; }
+
   void setLineNumberStart(uint64_t line_number) { line_number_start_ = line_number; }
   void setLineNumberEnd(uint64_t line_number) { line_number_end_ = line_number; }
 
   // Container factories for handler.
-  static FieldSharedPtr createObject() { return FieldSharedPtr{new Field(Type::Object)}; }
-  static FieldSharedPtr createArray() { return FieldSharedPtr{new Field(Type::Array)}; }
-  static FieldSharedPtr createNull() { return FieldSharedPtr{new Field(Type::Null)}; }
+  static FieldSharedPtr createObject() { return std::make_shared<Field>(Type::Object); }
+  static FieldSharedPtr createArray() { return std::make_shared<Field>(Type::Array); }
+  static FieldSharedPtr createNull() { return std::make_shared<Field>(Type::Null); }
 
   bool isNull() const override { return type_ == Type::Null; }
   bool isArray() const { return type_ == Type::Array; }
   bool isObject() const { return type_ == Type::Object; }
 
   // Value factory.
-  template <typename T> static FieldSharedPtr createValue(T value) {
-    return FieldSharedPtr{new Field(value)};
+  template <typename T> static FieldSharedPtr createValue(T&& value) {
+    return std::make_shared<Field>(std::forward<T>(value));
   }
 
-  void append(FieldSharedPtr field_ptr) {
+  void append(FieldSharedPtr&& field_ptr) {
     checkType(Type::Array);
-    value_.array_value_.push_back(field_ptr);
+    value_.array_value_.push_back(std::move(field_ptr));
   }
-  void insert(const std::string& key, FieldSharedPtr field_ptr) {
+  void insert(const std::string& key, FieldSharedPtr&& field_ptr) {
     checkType(Type::Object);
-    value_.object_value_[key] = field_ptr;
+    value_.object_value_[key] = std::move(field_ptr);
   }
 
   uint64_t hash() const override;
@@ -92,15 +113,6 @@ public:
   void validateSchema(const std::string& schema) const override;
 
 private:
-  enum class Type {
-    Array,
-    Boolean,
-    Double,
-    Integer,
-    Null,
-    Object,
-    String,
-  };
   static const char* typeAsString(Type t) {
     switch (t) {
     case Type::Array:
@@ -131,12 +143,6 @@ private:
     std::string string_value_;
   };
 
-  explicit Field(Type type) : type_(type) {}
-  explicit Field(const std::string& value) : type_(Type::String) { value_.string_value_ = value; }
-  explicit Field(int64_t value) : type_(Type::Integer) { value_.integer_value_ = value; }
-  explicit Field(double value) : type_(Type::Double) { value_.double_value_ = value; }
-  explicit Field(bool value) : type_(Type::Boolean) { value_.boolean_value_ = value; }
-
   bool isType(Type type) const { return type == type_; }
   void checkType(Type type) const {
     if (!isType(type)) {
@@ -151,7 +157,7 @@ private:
     checkType(Type::String);
     return value_.string_value_;
   }
-  std::vector<FieldSharedPtr> arrayValue() const {
+  const std::vector<FieldSharedPtr>& arrayValue() const {
     checkType(Type::Array);
     return value_.array_value_;
   }
@@ -223,7 +229,7 @@ public:
   ObjectSharedPtr getRoot() { return root_; }
 
 private:
-  bool handleValueEvent(FieldSharedPtr ptr);
+  bool handleValueEvent(FieldSharedPtr&& ptr);
 
   enum State {
     expectRoot,
@@ -235,7 +241,8 @@ private:
   State state_;
   LineCountingStringStream& stream_;
 
-  std::stack<FieldSharedPtr> stack_;
+  // The containers being built. They are owned by root_.
+  std::stack<Field*> stack_;
   std::string key_;
 
   FieldSharedPtr root_;
@@ -417,7 +424,7 @@ std::vector<ObjectSharedPtr> Field::getObjectArray(const std::string& name,
                                 line_number_start_, line_number_end_));
   }
 
-  std::vector<FieldSharedPtr> array_value = value_itr->second->arrayValue();
+  const std::vector<FieldSharedPtr>& array_value = value_itr->second->arrayValue();
   return {array_value.begin(), array_value.end()};
 }
 
@@ -453,7 +460,7 @@ std::vector<std::string> Field::getStringArray(const std::string& name, bool all
                                 line_number_start_, line_number_end_));
   }
 
-  std::vector<FieldSharedPtr> array = value_itr->second->arrayValue();
+  const std::vector<FieldSharedPtr>& array = value_itr->second->arrayValue();
   string_array.reserve(array.size());
   for (const auto& element : array) {
     if (!element->isType(Type::String)) {
@@ -506,16 +513,49 @@ void Field::iterate(const ObjectCallback& callback) const {
   }
 }
 
+// Nesting depth of SkipSchemaValidation guards on this thread.
+thread_local uint32_t skip_schema_validation_depth_ = 0;
+
+/**
+ * A schema parsed into its validator form. The schemas are a fixed set of constants, so each is
+ * parsed once per process rather than on every validateSchema() call.
+ */
+class CompiledSchema {
+public:
+  CompiledSchema(const std::string& schema) {
+    if (document_.Parse<0>(schema.c_str()).HasParseError()) {
+      throw std::invalid_argument(fmt::format(
+          "Schema supplied to validateSchema is not valid JSON\n Error(offset {}) : {}\n",
+          document_.GetErrorOffset(), GetParseError_En(document_.GetParseError())));
+    }
+    schema_document_.reset(new rapidjson::SchemaDocument(document_));
+  }
+
+  const rapidjson::SchemaDocument& schemaDocument() const { return *schema_document_; }
+
+private:
+  rapidjson::Document document_;
+  std::unique_ptr<rapidjson::SchemaDocument> schema_document_;
+};
+
+const CompiledSchema& compiledSchema(const std::string& schema) {
+  static std::mutex* lock = new std::mutex();
+  static auto* schemas = new std::unordered_map<std::string, std::unique_ptr<CompiledSchema>>();
+
+  std::unique_lock<std::mutex> guard(*lock);
+  std::unique_ptr<CompiledSchema>& compiled = (*schemas)[schema];
+  if (!compiled) {
+    compiled.reset(new CompiledSchema(schema));
+  }
+  return *compiled;
+}
+
 void Field::validateSchema(const std::string& schema) const {
-  rapidjson::Document schema_document;
-  if (schema_document.Parse<0>(schema.c_str()).HasParseError()) {
-    throw std::invalid_argument(fmt::format(
-        "Schema supplied to validateSchema is not valid JSON\n Error(offset {}) : {}\n",
-        schema_document.GetErrorOffset(), GetParseError_En(schema_document.GetParseError())));
+  if (skip_schema_validation_depth_ > 0) {
+    return;
   }
 
-  rapidjson::SchemaDocument schema_document_for_validator(schema_document);
-  rapidjson::SchemaValidator schema_validator(schema_document_for_validator);
+  rapidjson::SchemaValidator schema_validator(compiledSchema(schema).schemaDocument());
 
   if (!asRapidJsonDocument().Accept(schema_validator)) {
     rapidjson::StringBuffer schema_string_buffer;
@@ -539,18 +579,18 @@ bool ObjectHandler::StartObject() {
 
   switch (state_) {
   case expectValueOrStartObjectArray:
-    stack_.top()->insert(key_, object);
-    stack_.push(object);
+    stack_.push(object.get());
+    stack_.top()->insert(key_, std::move(object));
     state_ = expectKeyOrEndObject;
     return true;
   case expectArrayValueOrEndArray:
-    stack_.top()->append(object);
-    stack_.push(object);
+    stack_.push(object.get());
+    stack_.top()->append(std::move(object));
     state_ = expectKeyOrEndObject;
     return true;
   case expectRoot:
-    root_ = object;
-    stack_.push(object);
+    stack_.push(object.get());
+    root_ = std::move(object);
     state_ = expectKeyOrEndObject;
     return true;
   default:
@@ -580,7 +620,7 @@ bool ObjectHandler::EndObject(rapidjson::SizeType) {
 bool ObjectHandler::Key(const char* value, rapidjson::SizeType size, bool) {
   switch (state_) {
   case expectKeyOrEndObject:
-    key_ = std::string(value, size);
+    key_.assign(value, size);
     state_ = expectValueOrStartObjectArray;
     return true;
   default:
@@ -594,17 +634,17 @@ bool ObjectHandler::StartArray() {
 
   switch (state_) {
   case expectValueOrStartObjectArray:
-    stack_.top()->insert(key_, array);
-    stack_.push(array);
+    stack_.push(array.get());
+    stack_.top()->insert(key_, std::move(array));
     state_ = expectArrayValueOrEndArray;
     return true;
   case expectArrayValueOrEndArray:
-    stack_.top()->append(array);
-    stack_.push(array);
+    stack_.push(array.get());
+    stack_.top()->append(std::move(array));
     return true;
   case expectRoot:
-    root_ = array;
-    stack_.push(array);
+    stack_.push(array.get());
+    root_ = std::move(array);
     state_ = expectArrayValueOrEndArray;
     return true;
   default:
@@ -661,16 +701,16 @@ bool ObjectHandler::RawNumber(const char*, rapidjson::SizeType, bool) {
   NOT_REACHED;
 }
 
-bool ObjectHandler::handleValueEvent(FieldSharedPtr ptr) {
+bool ObjectHandler::handleValueEvent(FieldSharedPtr&& ptr) {
   ptr->setLineNumberStart(stream_.getLineNumber());
 
   switch (state_) {
   case expectValueOrStartObjectArray:
     state_ = expectKeyOrEndObject;
-    stack_.top()->insert(key_, ptr);
+    stack_.top()->insert(key_, std::move(ptr));
     return true;
   case expectArrayValueOrEndArray:
-    stack_.top()->append(ptr);
+    stack_.top()->append(std::move(ptr));
     return true;
   default:
     return false;
@@ -679,6 +719,13 @@ bool ObjectHandler::handleValueEvent(FieldSharedPtr ptr) {
 
 } // namespace
 
+SkipSchemaValidation::SkipSchemaValidation() { ++skip_schema_validation_depth_; }
+
+SkipSchemaValidation::~SkipSchemaValidation() {
+  ASSERT(skip_schema_validation_depth_ > 0);
+  --skip_schema_validation_depth_;
+}
+
 ObjectSharedPtr Factory::loadFromFile(const std::string& file_path) {
   try {
     const std::string contents = Filesystem::fileReadToEnd(file_path);
@@ -28,5 +28,16 @@ public:
   static const std::string listAsJsonString(const std::list<std::string>& items);
 };
 
+/**
+ * While an instance is alive, Object::validateSchema() is a no-op on the thread that created it.
+ * Only for loading config whose exact content has already passed validation, e.g. in a prior
+ * --mode validate run. Instances may nest.
+ */
+class SkipSchemaValidation {
+public:
+  SkipSchemaValidation();
+  ~SkipSchemaValidation();
+};
+
 } // namespace Json
 } // namespace Envoy
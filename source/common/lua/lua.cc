@@ -1,11 +1,26 @@
 #include "common/lua/lua.h"
 
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+
 #include "envoy/common/exception.h"
 
 #include "common/common/assert.h"
 
 namespace Envoy {
 namespace Lua {
+namespace {
+
+int dumpWriter(lua_State*, const void* data, size_t size, void* bytecode) {
+  static_cast<std::string*>(bytecode)->append(static_cast<const char*>(data), size);
+  return 0;
+}
+
+// The coroutine running on this thread, which the instruction hook charges.
+thread_local Coroutine* running_coroutine = nullptr;
+
+} // namespace
 
 Coroutine::Coroutine(const std::pair<lua_State*, lua_State*>& new_thread_state)
     : coroutine_state_(new_thread_state, false) {}
@@ -25,7 +40,16 @@ void Coroutine::start(int function_ref, int num_args, const std::function<void()
 
 void Coroutine::resume(int num_args, const std::function<void()>& yield_callback) {
   ASSERT(state_ == State::Yielded);
+  Coroutine* previous = running_coroutine;
+  setRunning(this);
+  const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
   int rc = lua_resume(coroutine_state_.get(), num_args);
+  run_time_ += std::chrono::duration_cast<std::chrono::microseconds>(
+      std::chrono::steady_clock::now() - start);
+  if (instruction_budget_ > 0) {
+    lua_sethook(coroutine_state_.get(), nullptr, 0, 0);
+  }
+  setRunning(previous);
 
   if (0 == rc) {
     state_ = State::Finished;
@@ -41,20 +65,65 @@ void Coroutine::resume(int num_args, const std::function<void()>& yield_callback
   }
 }
 
+bool Coroutine::reset() {
+  if (state_ != State::Finished || lua_status(coroutine_state_.get()) != 0) {
+    return false;
+  }
+
+  lua_settop(coroutine_state_.get(), 0);
+  state_ = State::NotStarted;
+  instruction_budget_ = 0;
+  instructions_ = 0;
+  run_time_ = std::chrono::microseconds::zero();
+  return true;
+}
+
+void Coroutine::setRunning(Coroutine* coroutine) {
+  running_coroutine = coroutine;
+  if (coroutine != nullptr && coroutine->instruction_budget_ > 0) {
+    // Once over budget, fail on every instruction so that a script cannot catch the error with
+    // pcall() and carry on.
+    lua_sethook(coroutine->coroutine_state_.get(), instructionHook, LUA_MASKCOUNT,
+                coroutine->instruction_budget_exceeded_ ? 1 : INSTRUCTION_HOOK_INTERVAL);
+  }
+}
+
+void Coroutine::instructionHook(lua_State* state, lua_Debug*) {
+  Coroutine* coroutine = running_coroutine;
+  if (coroutine == nullptr || coroutine->instruction_budget_ == 0) {
+    return;
+  }
+
+  if (!coroutine->instruction_budget_exceeded_) {
+    coroutine->instructions_ += INSTRUCTION_HOOK_INTERVAL;
+    if (coroutine->instructions_ <= coroutine->instruction_budget_) {
+      return;
+    }
+    coroutine->instruction_budget_exceeded_ = true;
+    lua_sethook(state, instructionHook, LUA_MASKCOUNT, 1);
+  }
+  luaL_error(state, "script exceeded its budget of %d instructions",
+             static_cast<int>(std::min<uint64_t>(coroutine->instruction_budget_, INT32_MAX)));
+}
+
 ThreadLocalState::ThreadLocalState(const std::string& code, ThreadLocal::SlotAllocator& tls)
     : tls_slot_(tls.allocateSlot()) {
 
-  // First verify that the supplied code can be parsed.
+  // First verify that the supplied code can be parsed and run. The code is compiled once here and
+  // the workers load the bytecode, rather than each parsing the code again.
   CSmartPtr<lua_State, lua_close> state(lua_open());
   luaL_openlibs(state.get());
 
-  if (0 != luaL_dostring(state.get(), code.c_str())) {
+  std::shared_ptr<std::string> bytecode = std::make_shared<std::string>();
+  if (0 != luaL_loadstring(state.get(), code.c_str()) ||
+      0 != lua_dump(state.get(), dumpWriter, bytecode.get()) ||
+      0 != lua_pcall(state.get(), 0, 0, 0)) {
     throw LuaException(fmt::format("script load error: {}", lua_tostring(state.get(), -1)));
   }
 
   // Now initialize on all threads.
-  tls_slot_->set([code](Event::Dispatcher&) {
-    return ThreadLocal::ThreadLocalObjectSharedPtr{new LuaThreadLocal(code)};
+  tls_slot_->set([bytecode](Event::Dispatcher&) {
+    return ThreadLocal::ThreadLocalObjectSharedPtr{new LuaThreadLocal(*bytecode)};
   });
 }
 
@@ -80,14 +149,41 @@ uint64_t ThreadLocalState::registerGlobal(const std::string& global) {
   return current_global_slot_++;
 }
 
-CoroutinePtr ThreadLocalState::createCoroutine() {
-  lua_State* state = tls_slot_->getTyped<LuaThreadLocal>().state_.get();
-  return CoroutinePtr{new Coroutine({lua_newthread(state), state})};
+CoroutinePtr ThreadLocalState::createCoroutine(uint64_t instruction_budget) {
+  LuaThreadLocal& tls = tls_slot_->getTyped<LuaThreadLocal>();
+  lua_State* state = tls.state_.get();
+  if (instruction_budget > 0 && !tls.jit_disabled_) {
+    // Flush the compiled traces as well, as turning the compiler off does not stop them from
+    // running.
+    luaJIT_setmode(state, 0, LUAJIT_MODE_ENGINE | LUAJIT_MODE_FLUSH);
+    luaJIT_setmode(state, 0, LUAJIT_MODE_ENGINE | LUAJIT_MODE_OFF);
+    tls.jit_disabled_ = true;
+  }
+
+  CoroutinePtr coroutine;
+  if (!tls.coroutine_pool_.empty()) {
+    coroutine = std::move(tls.coroutine_pool_.back());
+    tls.coroutine_pool_.pop_back();
+  } else {
+    coroutine.reset(new Coroutine({lua_newthread(state), state}));
+  }
+  coroutine->setInstructionBudget(instruction_budget);
+  return coroutine;
+}
+
+void ThreadLocalState::releaseCoroutine(CoroutinePtr&& coroutine) {
+  LuaThreadLocal& tls = tls_slot_->getTyped<LuaThreadLocal>();
+  if (coroutine != nullptr && tls.coroutine_pool_.size() < MAX_POOLED_COROUTINES &&
+      coroutine->reset()) {
+    tls.coroutine_pool_.push_back(std::move(coroutine));
+  }
 }
 
-ThreadLocalState::LuaThreadLocal::LuaThreadLocal(const std::string& code) : state_(lua_open()) {
+ThreadLocalState::LuaThreadLocal::LuaThreadLocal(const std::string& bytecode)
+    : state_(lua_open()) {
   luaL_openlibs(state_.get());
-  int rc = luaL_dostring(state_.get(), code.c_str());
+  int rc = luaL_loadbuffer(state_.get(), bytecode.data(), bytecode.size(), "") ||
+           lua_pcall(state_.get(), 0, 0, 0);
   ASSERT(rc == 0);
   UNREFERENCED_PARAMETER(rc);
 }
@@ -1,5 +1,7 @@
 #pragma once
 
+#include <chrono>
+#include <cstdint>
 #include <memory>
 #include <string>
 #include <vector>
@@ -322,9 +324,46 @@ public:
    */
   void resume(int num_args, const std::function<void()>& yield_callback);
 
+  /**
+   * Prepare a finished coroutine so that it can be started again with another function.
+   * @return whether the coroutine can be started again. A coroutine that has not finished, or
+   *         finished with an error, cannot be.
+   */
+  bool reset();
+
+  /**
+   * Limit the number of Lua instructions the coroutine may run across start() and all resume()
+   * calls. Once it runs more, the script fails with a LuaException that it cannot catch.
+   * @param budget supplies the number of instructions, which is checked every
+   *        INSTRUCTION_HOOK_INTERVAL instructions. 0 means no limit.
+   */
+  void setInstructionBudget(uint64_t budget) { instruction_budget_ = budget; }
+
+  /**
+   * @return whether the coroutine failed because it exceeded its instruction budget.
+   */
+  bool instructionBudgetExceeded() const { return instruction_budget_exceeded_; }
+
+  /**
+   * @return the time the coroutine has spent running across start() and all resume() calls. As
+   *         the coroutine runs on the worker's thread, this is time the worker did nothing else.
+   */
+  std::chrono::microseconds runTime() const { return run_time_; }
+
+  static const int INSTRUCTION_HOOK_INTERVAL = 1000;
+
 private:
+  // Sets the coroutine that the instruction hook charges, installing the hook if the coroutine has
+  // a budget. Coroutines may be resumed from within another one, e.g. when a script responds.
+  static void setRunning(Coroutine* coroutine);
+  static void instructionHook(lua_State* state, lua_Debug*);
+
   LuaRef<lua_State> coroutine_state_;
   State state_{State::NotStarted};
+  uint64_t instruction_budget_{};
+  uint64_t instructions_{};
+  bool instruction_budget_exceeded_{};
+  std::chrono::microseconds run_time_{};
 };
 
 typedef std::unique_ptr<Coroutine> CoroutinePtr;
@@ -339,9 +378,22 @@ public:
   ThreadLocalState(const std::string& code, ThreadLocal::SlotAllocator& tls);
 
   /**
-   * @return CoroutinePtr a new coroutine.
+   * @return CoroutinePtr a new coroutine. This is a coroutine previously returned via
+   *         releaseCoroutine() if the worker has one.
+   * @param instruction_budget supplies the coroutine's instruction budget. @see
+   *        Coroutine::setInstructionBudget(). LuaJIT does not call the instruction hook from
+   *        compiled code, so the first budgeted coroutine turns the JIT compiler off for the
+   *        worker's state.
    */
-  CoroutinePtr createCoroutine();
+  CoroutinePtr createCoroutine(uint64_t instruction_budget = 0);
+
+  /**
+   * Return a coroutine that is no longer in use, so that a later createCoroutine() call on the
+   * same worker can reuse it rather than create a new Lua thread. Coroutines that cannot be
+   * reused, and coroutines beyond MAX_POOLED_COROUTINES, are destroyed.
+   * @param coroutine supplies the coroutine. May be nullptr.
+   */
+  void releaseCoroutine(CoroutinePtr&& coroutine);
 
   /**
    * @return a global reference previously registered via registerGlobal(). This may return
@@ -366,12 +418,17 @@ public:
         [this]() { T::registerType(tls_slot_->getTyped<LuaThreadLocal>().state_.get()); });
   }
 
+  static const uint64_t MAX_POOLED_COROUTINES = 256;
+
 private:
   struct LuaThreadLocal : public ThreadLocal::ThreadLocalObject {
-    LuaThreadLocal(const std::string& code);
+    LuaThreadLocal(const std::string& bytecode);
 
     CSmartPtr<lua_State, lua_close> state_;
     std::vector<int> global_slots_;
+    bool jit_disabled_{};
+    // Declared after state_ so that the pooled coroutines are destroyed before the state.
+    std::vector<CoroutinePtr> coroutine_pool_;
   };
 
   ThreadLocal::SlotPtr tls_slot_;
@@ -16,12 +16,45 @@ int BufferWrapper::luaGetBytes(lua_State* state) {
     luaL_error(state, "index/length must be >= 0 and (index + length) must be <= buffer size");
   }
 
-  // TODO(mattklein123): Reduce copies here by using Lua direct buffer builds.
+  // If the bytes are all in one slice, Lua copies them straight out of it.
+  const uint64_t num_slices = data_.getRawSlices(nullptr, 0);
+  Buffer::RawSlice slices[num_slices];
+  data_.getRawSlices(slices, num_slices);
+  uint64_t slice_start = 0;
+  for (const Buffer::RawSlice& slice : slices) {
+    if (static_cast<uint64_t>(index) < slice_start + slice.len_) {
+      if (static_cast<uint64_t>(index) + length <= slice_start + slice.len_) {
+        lua_pushlstring(state, static_cast<const char*>(slice.mem_) + (index - slice_start),
+                        length);
+        return 1;
+      }
+      break;
+    }
+    slice_start += slice.len_;
+  }
+
   std::unique_ptr<char[]> data(new char[length]);
   data_.copyOut(index, length, data.get());
   lua_pushlstring(state, data.get(), length);
   return 1;
 }
 
+int BufferWrapper::luaFind(lua_State* state) {
+  size_t size;
+  const char* pattern = luaL_checklstring(state, 2, &size);
+  const int index = luaL_optint(state, 3, 0);
+  if (index < 0 || static_cast<uint64_t>(index) > data_.length()) {
+    luaL_error(state, "index must be >= 0 and <= buffer size");
+  }
+
+  const ssize_t position = data_.search(pattern, size, index);
+  if (position == -1) {
+    return 0;
+  }
+
+  lua_pushnumber(state, position);
+  return 1;
+}
+
 } // namespace Lua
 } // namespace Envoy
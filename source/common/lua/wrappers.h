@@ -15,7 +15,9 @@ public:
   BufferWrapper(const Buffer::Instance& data) : data_(data) {}
 
   static ExportedFunctions exportedFunctions() {
-    return {{"length", static_luaLength}, {"getBytes", static_luaGetBytes}};
+    return {{"length", static_luaLength},
+            {"getBytes", static_luaGetBytes},
+            {"find", static_luaFind}};
   }
 
 private:
@@ -32,6 +34,15 @@ private:
    */
   DECLARE_LUA_FUNCTION(BufferWrapper, luaGetBytes);
 
+  /**
+   * Search the buffer for a string without copying the buffer into Lua.
+   * @param 1 (string) the string to search for.
+   * @param 2 (int) optional starting index of the search. Defaults to 0.
+   * @return int the index of the first occurrence at or after the starting index, or nil if there
+   *         is none. Throws an error if the starting index is out of range.
+   */
+  DECLARE_LUA_FUNCTION(BufferWrapper, luaFind);
+
   const Buffer::Instance& data_;
 };
 
@@ -2,6 +2,16 @@
 
 #include <cstdint>
 
+#include "common/buffer/slice_pool.h"
+
+namespace Envoy {
+namespace Memory {
+
+uint64_t Stats::totalBufferPoolRetained() { return Buffer::SlicePool::stats().retained_bytes_; }
+
+} // namespace Memory
+} // namespace Envoy
+
 #ifdef TCMALLOC
 
 #include "gperftools/malloc_extension.h"
@@ -20,6 +20,12 @@ public:
    *                  allocated.
    */
   static uint64_t totalCurrentlyReserved();
+
+  /**
+   * @return uint64_t the free buffer slice memory currently cached by the per-thread slice pools.
+   *                  This memory is counted as allocated by the heap.
+   */
+  static uint64_t totalBufferPoolRetained();
 };
 
 } // namespace Memory
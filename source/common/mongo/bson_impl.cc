@@ -1,9 +1,11 @@
 #include "common/mongo/bson_impl.h"
 
 #include <cstdint>
+#include <cstring>
 #include <sstream>
 #include <string>
 
+#include "common/buffer/cursor.h"
 #include "common/common/assert.h"
 #include "common/common/byte_order.h"
 #include "common/common/hex.h"
@@ -14,14 +16,16 @@
 namespace Envoy {
 namespace Bson {
 
+// Fields are copied out of the buffer into the caller's variables rather than read in place, so
+// that a field which spans slices does not force the buffer to be linearized.
+
 int32_t BufferHelper::peakInt32(Buffer::Instance& data) {
   if (data.length() < sizeof(int32_t)) {
     throw EnvoyException("invalid buffer size");
   }
 
   int32_t val;
-  void* mem = data.linearize(sizeof(int32_t));
-  std::memcpy(reinterpret_cast<void*>(&val), mem, sizeof(int32_t));
+  data.copyOut(0, sizeof(int32_t), &val);
   return le32toh(val);
 }
 
@@ -30,8 +34,8 @@ uint8_t BufferHelper::removeByte(Buffer::Instance& data) {
     throw EnvoyException("invalid buffer size");
   }
 
-  void* mem = data.linearize(sizeof(uint8_t));
-  uint8_t ret = *reinterpret_cast<uint8_t*>(mem);
+  uint8_t ret;
+  data.copyOut(0, sizeof(uint8_t), &ret);
   data.drain(sizeof(uint8_t));
   return ret;
 }
@@ -41,20 +45,18 @@ void BufferHelper::removeBytes(Buffer::Instance& data, uint8_t* out, size_t out_
     throw EnvoyException("invalid buffer size");
   }
 
-  void* mem = data.linearize(out_len);
-  std::memcpy(out, mem, out_len);
+  data.copyOut(0, out_len, out);
   data.drain(out_len);
 }
 
 std::string BufferHelper::removeCString(Buffer::Instance& data) {
-  char end = '\0';
-  ssize_t index = data.search(&end, sizeof(end), 0);
+  Buffer::Cursor cursor(data);
+  ssize_t index = cursor.find('\0');
   if (index == -1) {
     throw EnvoyException("invalid CString");
   }
 
-  char* start = reinterpret_cast<char*>(data.linearize(index + 1));
-  std::string ret(start);
+  std::string ret = cursor.readString(index);
   data.drain(index + 1);
   return ret;
 }
@@ -86,16 +88,21 @@ int64_t BufferHelper::removeInt64(Buffer::Instance& data) {
   }
 
   int64_t val;
-  void* mem = data.linearize(sizeof(int64_t));
-  std::memcpy(reinterpret_cast<void*>(&val), mem, sizeof(int64_t));
+  data.copyOut(0, sizeof(int64_t), &val);
   data.drain(sizeof(int64_t));
   return le64toh(val);
 }
 
 std::string BufferHelper::removeString(Buffer::Instance& data) {
   int32_t length = removeInt32(data);
-  char* start = reinterpret_cast<char*>(data.linearize(length));
-  std::string ret(start);
+  if (length < 0 || static_cast<uint64_t>(length) > data.length()) {
+    throw EnvoyException("invalid buffer size");
+  }
+
+  // The length includes the string's trailing NUL, which is not returned.
+  std::string ret(length, '\0');
+  data.copyOut(0, length, &ret[0]);
+  ret.resize(strnlen(ret.c_str(), ret.size()));
   data.drain(length);
   return ret;
 }
@@ -104,8 +111,12 @@ std::string BufferHelper::removeBinary(Buffer::Instance& data) {
   // Read out the subtype but do not store it for now.
   int32_t length = removeInt32(data);
   removeByte(data);
-  char* start = reinterpret_cast<char*>(data.linearize(length));
-  std::string ret(start, length);
+  if (length < 0 || static_cast<uint64_t>(length) > data.length()) {
+    throw EnvoyException("invalid buffer size");
+  }
+
+  std::string ret(length, '\0');
+  data.copyOut(0, length, &ret[0]);
   data.drain(length);
   return ret;
 }
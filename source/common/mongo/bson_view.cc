@@ -0,0 +1,228 @@
+#include "common/mongo/bson_view.h"
+
+#include <cstdint>
+#include <cstring>
+#include <string>
+
+#include "envoy/common/exception.h"
+
+#include "common/common/byte_order.h"
+
+#include "fmt/format.h"
+
+namespace Envoy {
+namespace Bson {
+
+namespace {
+
+int32_t readInt32(absl::string_view data, size_t offset) {
+  if (offset + sizeof(int32_t) > data.size()) {
+    throw EnvoyException("invalid buffer size");
+  }
+
+  int32_t val;
+  memcpy(&val, data.data() + offset, sizeof(int32_t));
+  return le32toh(val);
+}
+
+int64_t readInt64(absl::string_view data) {
+  int64_t val;
+  memcpy(&val, data.data(), sizeof(int64_t));
+  return le64toh(val);
+}
+
+// @return the offset following the CString starting at offset.
+size_t skipCString(absl::string_view data, size_t offset) {
+  size_t terminator = data.find('\0', offset);
+  if (terminator == absl::string_view::npos) {
+    throw EnvoyException("invalid CString");
+  }
+
+  return terminator + 1;
+}
+
+} // namespace
+
+double FieldView::asDouble() const {
+  checkType(Field::Type::DOUBLE);
+  int64_t bits = readInt64(value_);
+  double val;
+  memcpy(&val, &bits, sizeof(double));
+  return val;
+}
+
+absl::string_view FieldView::asString() const {
+  checkType(Field::Type::STRING);
+  // The length includes the string's trailing NUL, which is not returned.
+  return value_.substr(sizeof(int32_t), value_.size() - sizeof(int32_t) - 1);
+}
+
+DocumentView FieldView::asDocument() const {
+  checkType(Field::Type::DOCUMENT);
+  return DocumentView(value_);
+}
+
+DocumentView FieldView::asArray() const {
+  checkType(Field::Type::ARRAY);
+  return DocumentView(value_);
+}
+
+bool FieldView::asBoolean() const {
+  checkType(Field::Type::BOOLEAN);
+  return value_[0] != 0;
+}
+
+int64_t FieldView::asDatetime() const {
+  checkType(Field::Type::DATETIME);
+  return readInt64(value_);
+}
+
+int32_t FieldView::asInt32() const {
+  checkType(Field::Type::INT32);
+  return readInt32(value_, 0);
+}
+
+int64_t FieldView::asTimestamp() const {
+  checkType(Field::Type::TIMESTAMP);
+  return readInt64(value_);
+}
+
+int64_t FieldView::asInt64() const {
+  checkType(Field::Type::INT64);
+  return readInt64(value_);
+}
+
+void FieldView::checkType(Field::Type type) const {
+  if (type_ != type) {
+    throw EnvoyException("invalid BSON field type cast");
+  }
+}
+
+DocumentView::Iterator::Iterator(absl::string_view fields, size_t position)
+    : fields_(fields), position_(position) {
+  parse();
+}
+
+DocumentView::Iterator& DocumentView::Iterator::operator++() {
+  position_ = next_position_;
+  parse();
+  return *this;
+}
+
+void DocumentView::Iterator::parse() {
+  if (position_ == fields_.size()) {
+    return;
+  }
+
+  const uint8_t element_type = fields_[position_];
+  const size_t value_position = skipCString(fields_, position_ + 1);
+  const absl::string_view key = fields_.substr(position_ + 1, value_position - position_ - 2);
+
+  // Find the size of the value so that it can be skipped without being decoded.
+  int64_t value_size;
+  switch (static_cast<Field::Type>(element_type)) {
+  case Field::Type::DOUBLE:
+  case Field::Type::DATETIME:
+  case Field::Type::TIMESTAMP:
+  case Field::Type::INT64:
+    value_size = sizeof(int64_t);
+    break;
+
+  case Field::Type::STRING:
+    // The length does not include itself and must at least cover the trailing NUL.
+    value_size = readInt32(fields_, value_position);
+    if (value_size < 1) {
+      throw EnvoyException("invalid buffer size");
+    }
+    value_size += sizeof(int32_t);
+    break;
+
+  case Field::Type::DOCUMENT:
+  case Field::Type::ARRAY:
+    // The length includes itself, and the smallest document is the length and a terminator.
+    value_size = readInt32(fields_, value_position);
+    if (value_size < 5) {
+      throw EnvoyException("invalid BSON message length");
+    }
+    break;
+
+  case Field::Type::BINARY:
+    // The length does not include itself or the subtype.
+    value_size = readInt32(fields_, value_position);
+    if (value_size < 0) {
+      throw EnvoyException("invalid buffer size");
+    }
+    value_size += sizeof(int32_t) + 1;
+    break;
+
+  case Field::Type::OBJECT_ID:
+    value_size = sizeof(Field::ObjectId);
+    break;
+
+  case Field::Type::BOOLEAN:
+    value_size = 1;
+    break;
+
+  case Field::Type::NULL_VALUE:
+    value_size = 0;
+    break;
+
+  case Field::Type::REGEX:
+    // The pattern and the options.
+    value_size = skipCString(fields_, skipCString(fields_, value_position)) - value_position;
+    break;
+
+  case Field::Type::INT32:
+    value_size = sizeof(int32_t);
+    break;
+
+  default:
+    throw EnvoyException(
+        fmt::format("invalid BSON element type: {:#x} key: {}", element_type, std::string(key)));
+  }
+
+  if (value_size < 0 || value_position + value_size > fields_.size()) {
+    throw EnvoyException("invalid buffer size");
+  }
+
+  field_ = FieldView(static_cast<Field::Type>(element_type), key,
+                     fields_.substr(value_position, value_size));
+  next_position_ = value_position + value_size;
+}
+
+DocumentView::DocumentView(absl::string_view data) {
+  // The smallest document is the length followed by the terminating null byte.
+  int32_t document_length = readInt32(data, 0);
+  if (document_length < 5 || static_cast<uint64_t>(document_length) > data.size()) {
+    throw EnvoyException("invalid BSON message length");
+  }
+
+  if (data[document_length - 1] != 0) {
+    throw EnvoyException("invalid document");
+  }
+
+  fields_ = data.substr(sizeof(int32_t), document_length - sizeof(int32_t) - 1);
+}
+
+Optional<FieldView> DocumentView::find(absl::string_view key) const {
+  for (const FieldView& field : *this) {
+    if (field.key() == key) {
+      return field;
+    }
+  }
+
+  return {};
+}
+
+Optional<FieldView> DocumentView::find(absl::string_view key, Field::Type type) const {
+  for (const FieldView& field : *this) {
+    if (field.key() == key && field.type() == type) {
+      return field;
+    }
+  }
+
+  return {};
+}
+
+} // namespace Bson
+} // namespace Envoy
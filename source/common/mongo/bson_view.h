@@ -0,0 +1,107 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#include "envoy/common/optional.h"
+#include "envoy/mongo/bson.h"
+
+#include "absl/strings/string_view.h"
+
+namespace Envoy {
+namespace Bson {
+
+class DocumentView;
+
+/**
+ * A field of a DocumentView. The key and any string value point into the encoded document.
+ */
+class FieldView {
+public:
+  FieldView() {}
+  FieldView(Field::Type type, absl::string_view key, absl::string_view value)
+      : type_(type), key_(key), value_(value) {}
+
+  double asDouble() const;
+  absl::string_view asString() const;
+  DocumentView asDocument() const;
+  DocumentView asArray() const;
+  bool asBoolean() const;
+  int64_t asDatetime() const;
+  int32_t asInt32() const;
+  int64_t asTimestamp() const;
+  int64_t asInt64() const;
+
+  absl::string_view key() const { return key_; }
+  Field::Type type() const { return type_; }
+
+private:
+  void checkType(Field::Type type) const;
+
+  Field::Type type_{Field::Type::NULL_VALUE};
+  absl::string_view key_;
+  // The encoded value, following the key.
+  absl::string_view value_;
+};
+
+/**
+ * A read-only view of an encoded BSON document. Unlike DocumentImpl nothing is copied or
+ * allocated: fields are parsed one at a time as the document is iterated, so looking up a few
+ * fields of a large document only touches the fields before them. The encoded document must
+ * outlive the view and every FieldView taken from it.
+ */
+class DocumentView {
+public:
+  /**
+   * Iterates the fields of a document in order. Each increment parses the next field and throws
+   * EnvoyException if it is malformed.
+   */
+  class Iterator {
+  public:
+    const FieldView& operator*() const { return field_; }
+    const FieldView* operator->() const { return &field_; }
+    Iterator& operator++();
+    bool operator==(const Iterator& rhs) const { return position_ == rhs.position_; }
+    bool operator!=(const Iterator& rhs) const { return position_ != rhs.position_; }
+
+  private:
+    friend class DocumentView;
+
+    Iterator(absl::string_view fields, size_t position);
+
+    void parse();
+
+    absl::string_view fields_;
+    size_t position_;
+    size_t next_position_{};
+    FieldView field_;
+  };
+
+  /**
+   * @param data supplies the encoded document. Only the document's length and terminator are
+   *        checked here, fields are checked as they are iterated.
+   * @throw EnvoyException if the document is malformed.
+   */
+  explicit DocumentView(absl::string_view data);
+
+  Iterator begin() const { return Iterator(fields_, 0); }
+  Iterator end() const { return Iterator(fields_, fields_.size()); }
+  bool empty() const { return fields_.empty(); }
+
+  /**
+   * @return the first field with the given key, if any.
+   */
+  Optional<FieldView> find(absl::string_view key) const;
+
+  /**
+   * @return the first field with the given key and type, if any.
+   */
+  Optional<FieldView> find(absl::string_view key, Field::Type type) const;
+
+private:
+  // The encoded fields, without the document's length and terminator.
+  absl::string_view fields_;
+};
+
+} // namespace Bson
+} // namespace Envoy
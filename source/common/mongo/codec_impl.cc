@@ -9,6 +9,7 @@
 #include "envoy/buffer/buffer.h"
 #include "envoy/common/exception.h"
 
+#include "common/buffer/buffer_impl.h"
 #include "common/common/assert.h"
 #include "common/mongo/bson_impl.h"
 
@@ -17,6 +18,33 @@
 namespace Envoy {
 namespace Mongo {
 
+namespace {
+
+/**
+ * @return the encoded size of the BSON document at the start of the buffer.
+ */
+uint64_t documentLength(Buffer::Instance& data) {
+  int32_t document_length = Bson::BufferHelper::peakInt32(data);
+  // The smallest document is the length followed by the terminating null byte.
+  if (document_length < 5 || static_cast<uint64_t>(document_length) > data.length()) {
+    throw EnvoyException("invalid BSON message length");
+  }
+
+  return document_length;
+}
+
+/**
+ * Skip a BSON document without decoding it.
+ * @return the encoded size of the document.
+ */
+uint64_t skipDocument(Buffer::Instance& data) {
+  uint64_t document_length = documentLength(data);
+  data.drain(document_length);
+  return document_length;
+}
+
+} // namespace
+
 std::string
 MessageImpl::documentListToString(const std::list<Bson::DocumentSharedPtr>& documents) const {
   std::stringstream out;
@@ -36,7 +64,7 @@ MessageImpl::documentListToString(const std::list<Bson::DocumentSharedPtr>& docu
   return out.str();
 }
 
-void GetMoreMessageImpl::fromBuffer(uint32_t, Buffer::Instance& data) {
+void GetMoreMessageImpl::fromBuffer(uint32_t, Buffer::Instance& data, bool) {
   ENVOY_LOG(trace, "decoding get more message");
   Bson::BufferHelper::removeInt32(data); // "zero" (unused)
   full_collection_name_ = Bson::BufferHelper::removeCString(data);
@@ -58,7 +86,8 @@ std::string GetMoreMessageImpl::toString(bool) const {
       request_id_, response_to_, full_collection_name_, number_to_return_, cursor_id_);
 }
 
-void InsertMessageImpl::fromBuffer(uint32_t message_length, Buffer::Instance& data) {
+void InsertMessageImpl::fromBuffer(uint32_t message_length, Buffer::Instance& data,
+                                   bool decode_documents) {
   ENVOY_LOG(trace, "decoding insert message");
   uint64_t original_buffer_length = data.length();
   ASSERT(message_length <= original_buffer_length);
@@ -66,7 +95,11 @@ void InsertMessageImpl::fromBuffer(uint32_t message_length, Buffer::Instance& da
   flags_ = Bson::BufferHelper::removeInt32(data);
   full_collection_name_ = Bson::BufferHelper::removeCString(data);
   while (data.length() - (original_buffer_length - message_length) > 0) {
-    documents_.emplace_back(Bson::DocumentImpl::create(data));
+    if (decode_documents) {
+      documents_.emplace_back(Bson::DocumentImpl::create(data));
+    } else {
+      skipDocument(data);
+    }
   }
 
   ENVOY_LOG(trace, "{}", toString(true));
@@ -97,7 +130,7 @@ std::string InsertMessageImpl::toString(bool full) const {
       full ? documentListToString(documents_) : std::to_string(documents_.size()));
 }
 
-void KillCursorsMessageImpl::fromBuffer(uint32_t, Buffer::Instance& data) {
+void KillCursorsMessageImpl::fromBuffer(uint32_t, Buffer::Instance& data, bool) {
   ENVOY_LOG(trace, "decoding kill cursors message");
   Bson::BufferHelper::removeInt32(data); // zero
   number_of_cursor_ids_ = Bson::BufferHelper::removeInt32(data);
@@ -131,7 +164,8 @@ std::string KillCursorsMessageImpl::toString(bool) const {
       request_id_, response_to_, number_of_cursor_ids_, cursors.str());
 }
 
-void QueryMessageImpl::fromBuffer(uint32_t message_length, Buffer::Instance& data) {
+void QueryMessageImpl::fromBuffer(uint32_t message_length, Buffer::Instance& data,
+                                  bool decode_documents) {
   ENVOY_LOG(trace, "decoding query message");
   uint64_t original_buffer_length = data.length();
   ASSERT(message_length <= original_buffer_length);
@@ -140,10 +174,21 @@ void QueryMessageImpl::fromBuffer(uint32_t message_length, Buffer::Instance& dat
   full_collection_name_ = Bson::BufferHelper::removeCString(data);
   number_to_skip_ = Bson::BufferHelper::removeInt32(data);
   number_to_return_ = Bson::BufferHelper::removeInt32(data);
-  query_ = Bson::DocumentImpl::create(data);
+  // Stats are derived from the encoded query, so it is copied out even when it is also decoded.
+  encoded_query_.resize(documentLength(data));
+  data.copyOut(0, encoded_query_.size(), &encoded_query_[0]);
+  if (decode_documents) {
+    query_ = Bson::DocumentImpl::create(data);
+  } else {
+    data.drain(encoded_query_.size());
+  }
 
   if (data.length() - (original_buffer_length - message_length) > 0) {
-    return_fields_selector_ = Bson::DocumentImpl::create(data);
+    if (decode_documents) {
+      return_fields_selector_ = Bson::DocumentImpl::create(data);
+    } else {
+      skipDocument(data);
+    }
   }
 
   ENVOY_LOG(trace, "{}", toString(true));
@@ -172,23 +217,47 @@ bool QueryMessageImpl::operator==(const QueryMessage& rhs) const {
   return true;
 }
 
+const Bson::Document* QueryMessageImpl::query() const {
+  if (!query_ && !encoded_query_.empty()) {
+    Buffer::OwnedImpl data(encoded_query_);
+    query_ = Bson::DocumentImpl::create(data);
+  }
+
+  return query_.get();
+}
+
+const std::string& QueryMessageImpl::encodedQuery() const {
+  if (encoded_query_.empty() && query_) {
+    Buffer::OwnedImpl data;
+    query_->encode(data);
+    encoded_query_.resize(data.length());
+    data.copyOut(0, data.length(), &encoded_query_[0]);
+  }
+
+  return encoded_query_;
+}
+
 std::string QueryMessageImpl::toString(bool full) const {
   return fmt::format(
       R"EOF({{"opcode": "OP_QUERY", "id": {}, "response_to": {}, "flags": "{:#x}", "collection": "{}", )EOF"
       R"EOF("skip": {}, "return": {}, "query": {}, "fields": {}}})EOF",
       request_id_, response_to_, flags_, full_collection_name_, number_to_skip_, number_to_return_,
-      full ? query_->toString() : "\"{...}\"",
+      full ? query()->toString() : "\"{...}\"",
       return_fields_selector_ ? return_fields_selector_->toString() : "{}");
 }
 
-void ReplyMessageImpl::fromBuffer(uint32_t, Buffer::Instance& data) {
+void ReplyMessageImpl::fromBuffer(uint32_t, Buffer::Instance& data, bool decode_documents) {
   ENVOY_LOG(trace, "decoding reply message");
   flags_ = Bson::BufferHelper::removeInt32(data);
   cursor_id_ = Bson::BufferHelper::removeInt64(data);
   starting_from_ = Bson::BufferHelper::removeInt32(data);
   number_returned_ = Bson::BufferHelper::removeInt32(data);
   for (int32_t i = 0; i < number_returned_; i++) {
-    documents_.emplace_back(Bson::DocumentImpl::create(data));
+    if (decode_documents) {
+      documents_.emplace_back(Bson::DocumentImpl::create(data));
+    } else {
+      skipped_documents_byte_size_ += skipDocument(data);
+    }
   }
 
   ENVOY_LOG(trace, "{}", toString(true));
@@ -212,6 +281,15 @@ bool ReplyMessageImpl::operator==(const ReplyMessage& rhs) const {
   return true;
 }
 
+uint64_t ReplyMessageImpl::documentsByteSize() const {
+  uint64_t byte_size = skipped_documents_byte_size_;
+  for (const Bson::DocumentSharedPtr& document : documents_) {
+    byte_size += document->byteSize();
+  }
+
+  return byte_size;
+}
+
 std::string ReplyMessageImpl::toString(bool full) const {
   return fmt::format(
       R"EOF({{"opcode": "OP_REPLY", "id": {}, "response_to": {}, "flags": "{:#x}", "cursor": "{}", )EOF"
@@ -246,28 +324,28 @@ bool DecoderImpl::decode(Buffer::Instance& data) {
   switch (op_code) {
   case Message::OpCode::OP_REPLY: {
     std::unique_ptr<ReplyMessageImpl> message(new ReplyMessageImpl(request_id, response_to));
-    message->fromBuffer(message_length, data);
+    message->fromBuffer(message_length, data, decode_documents_);
     callbacks_.decodeReply(std::move(message));
     break;
   }
 
   case Message::OpCode::OP_QUERY: {
     std::unique_ptr<QueryMessageImpl> message(new QueryMessageImpl(request_id, response_to));
-    message->fromBuffer(message_length, data);
+    message->fromBuffer(message_length, data, decode_documents_);
     callbacks_.decodeQuery(std::move(message));
     break;
   }
 
   case Message::OpCode::OP_GET_MORE: {
     std::unique_ptr<GetMoreMessageImpl> message(new GetMoreMessageImpl(request_id, response_to));
-    message->fromBuffer(message_length, data);
+    message->fromBuffer(message_length, data, decode_documents_);
     callbacks_.decodeGetMore(std::move(message));
     break;
   }
 
   case Message::OpCode::OP_INSERT: {
     std::unique_ptr<InsertMessageImpl> message(new InsertMessageImpl(request_id, response_to));
-    message->fromBuffer(message_length, data);
+    message->fromBuffer(message_length, data, decode_documents_);
     callbacks_.decodeInsert(std::move(message));
     break;
   }
@@ -275,7 +353,7 @@ bool DecoderImpl::decode(Buffer::Instance& data) {
   case Message::OpCode::OP_KILL_CURSORS: {
     std::unique_ptr<KillCursorsMessageImpl> message(
         new KillCursorsMessageImpl(request_id, response_to));
-    message->fromBuffer(message_length, data);
+    message->fromBuffer(message_length, data, decode_documents_);
     callbacks_.decodeKillCursors(std::move(message));
     break;
   }
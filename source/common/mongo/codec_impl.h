@@ -17,7 +17,16 @@ public:
   MessageImpl(int32_t request_id, uint32_t response_to)
       : request_id_(request_id), response_to_(response_to) {}
 
-  virtual void fromBuffer(uint32_t message_length, Buffer::Instance& data) PURE;
+  /**
+   * Decode the message body following the common header.
+   * @param message_length supplies the length of the body.
+   * @param data supplies the buffer to decode from.
+   * @param decode_documents supplies whether documents are decoded. If false, documents that
+   *        stats do not need (inserted and returned documents and query field selectors) are
+   *        skipped after checking their length, and the query is only copied out encoded.
+   */
+  virtual void fromBuffer(uint32_t message_length, Buffer::Instance& data,
+                          bool decode_documents) PURE;
 
   // Mongo::Message
   int32_t requestId() const override { return request_id_; }
@@ -37,7 +46,8 @@ public:
   using MessageImpl::MessageImpl;
 
   // MessageImpl
-  void fromBuffer(uint32_t message_length, Buffer::Instance& data) override;
+  void fromBuffer(uint32_t message_length, Buffer::Instance& data,
+                  bool decode_documents) override;
 
   // Mongo::Message
   std::string toString(bool full) const override;
@@ -64,7 +74,8 @@ public:
   using MessageImpl::MessageImpl;
 
   // MessageImpl
-  void fromBuffer(uint32_t message_length, Buffer::Instance& data) override;
+  void fromBuffer(uint32_t message_length, Buffer::Instance& data,
+                  bool decode_documents) override;
 
   // Mongo::Message
   std::string toString(bool full) const override;
@@ -91,7 +102,8 @@ public:
   using MessageImpl::MessageImpl;
 
   // MessageImpl
-  void fromBuffer(uint32_t message_length, Buffer::Instance& data) override;
+  void fromBuffer(uint32_t message_length, Buffer::Instance& data,
+                  bool decode_documents) override;
 
   // Mongo::Message
   std::string toString(bool full) const override;
@@ -119,7 +131,8 @@ public:
   using MessageImpl::MessageImpl;
 
   // MessageImpl
-  void fromBuffer(uint32_t message_length, Buffer::Instance& data) override;
+  void fromBuffer(uint32_t message_length, Buffer::Instance& data,
+                  bool decode_documents) override;
 
   // Mongo::Message
   std::string toString(bool full) const override;
@@ -134,8 +147,12 @@ public:
   void numberToSkip(int32_t skip) override { number_to_skip_ = skip; }
   int32_t numberToReturn() const override { return number_to_return_; }
   void numberToReturn(int32_t to_return) override { number_to_return_ = to_return; }
-  virtual const Bson::Document* query() const override { return query_.get(); }
-  void query(Bson::DocumentSharedPtr&& query) override { query_ = std::move(query); }
+  virtual const Bson::Document* query() const override;
+  void query(Bson::DocumentSharedPtr&& query) override {
+    query_ = std::move(query);
+    encoded_query_.clear();
+  }
+  const std::string& encodedQuery() const override;
   virtual const Bson::Document* returnFieldsSelector() const override {
     return return_fields_selector_.get();
   }
@@ -148,7 +165,10 @@ private:
   std::string full_collection_name_;
   int32_t number_to_skip_{};
   int32_t number_to_return_{};
-  Bson::DocumentSharedPtr query_;
+  // A decoded query is kept with its encoding, and either is computed from the other when first
+  // needed.
+  mutable Bson::DocumentSharedPtr query_;
+  mutable std::string encoded_query_;
   Bson::DocumentSharedPtr return_fields_selector_;
 };
 
@@ -159,7 +179,8 @@ public:
   using MessageImpl::MessageImpl;
 
   // MessageImpl
-  void fromBuffer(uint32_t message_length, Buffer::Instance& data) override;
+  void fromBuffer(uint32_t message_length, Buffer::Instance& data,
+                  bool decode_documents) override;
 
   // Mongo::Message
   std::string toString(bool full) const override;
@@ -176,6 +197,7 @@ public:
   void numberReturned(int32_t number_returned) override { number_returned_ = number_returned; }
   const std::list<Bson::DocumentSharedPtr>& documents() const override { return documents_; }
   std::list<Bson::DocumentSharedPtr>& documents() override { return documents_; }
+  uint64_t documentsByteSize() const override;
 
 private:
   int32_t flags_{};
@@ -183,11 +205,19 @@ private:
   int32_t starting_from_{};
   int32_t number_returned_{};
   std::list<Bson::DocumentSharedPtr> documents_;
+  uint64_t skipped_documents_byte_size_{};
 };
 
 class DecoderImpl : public Decoder, Logger::Loggable<Logger::Id::mongo> {
 public:
-  DecoderImpl(DecoderCallbacks& callbacks) : callbacks_(callbacks) {}
+  /**
+   * @param callbacks supplies the callbacks to dispatch decoded messages to.
+   * @param decode_documents supplies whether documents are decoded. When false, inserted and
+   *        returned documents are skipped and queries are kept encoded until query() is called,
+   *        since stats only need message headers and a few fields of the query.
+   */
+  DecoderImpl(DecoderCallbacks& callbacks, bool decode_documents = true)
+      : callbacks_(callbacks), decode_documents_(decode_documents) {}
 
   // Mongo::Decoder
   void onData(Buffer::Instance& data) override;
@@ -196,6 +226,7 @@ private:
   bool decode(Buffer::Instance& data);
 
   DecoderCallbacks& callbacks_;
+  const bool decode_documents_;
 };
 
 class EncoderImpl : public Encoder, Logger::Loggable<Logger::Id::mongo> {
@@ -211,14 +211,8 @@ void ProxyFilter::onDrainClose() {
 
 void ProxyFilter::chargeReplyStats(ActiveQuery& active_query, const std::string& prefix,
                                    const ReplyMessage& message) {
-  uint64_t reply_documents_byte_size = 0;
-  for (const Bson::DocumentSharedPtr& document : message.documents()) {
-    reply_documents_byte_size += document->byteSize();
-  }
-
-  scope_.histogram(fmt::format("{}.reply_num_docs", prefix))
-      .recordValue(message.documents().size());
-  scope_.histogram(fmt::format("{}.reply_size", prefix)).recordValue(reply_documents_byte_size);
+  scope_.histogram(fmt::format("{}.reply_num_docs", prefix)).recordValue(message.numberReturned());
+  scope_.histogram(fmt::format("{}.reply_size", prefix)).recordValue(message.documentsByteSize());
   scope_.histogram(fmt::format("{}.reply_time_ms", prefix))
       .recordValue(std::chrono::duration_cast<std::chrono::milliseconds>(
                        std::chrono::steady_clock::now() - active_query.start_time_)
@@ -235,7 +229,9 @@ void ProxyFilter::doDecode(Buffer::Instance& buffer) {
   }
 
   if (!decoder_) {
-    decoder_ = createDecoder(*this);
+    // Documents are only decoded when they may be written to the access log. Stats only need
+    // message headers and a few fields of each query, which are read from its encoding.
+    decoder_ = createDecoder(*this, access_log_ != nullptr);
   }
 
   try {
@@ -290,8 +286,8 @@ Network::FilterStatus ProxyFilter::onWrite(Buffer::Instance& data) {
   return Network::FilterStatus::Continue;
 }
 
-DecoderPtr ProdProxyFilter::createDecoder(DecoderCallbacks& callbacks) {
-  return DecoderPtr{new DecoderImpl(callbacks)};
+DecoderPtr ProdProxyFilter::createDecoder(DecoderCallbacks& callbacks, bool decode_documents) {
+  return DecoderPtr{new DecoderImpl(callbacks, decode_documents)};
 }
 
 Optional<uint64_t> ProxyFilter::delayDuration() {
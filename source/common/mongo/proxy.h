@@ -124,7 +124,12 @@ public:
               const Network::DrainDecision& drain_decision);
   ~ProxyFilter();
 
-  virtual DecoderPtr createDecoder(DecoderCallbacks& callbacks) PURE;
+  /**
+   * @param callbacks supplies the callbacks to dispatch decoded messages to.
+   * @param decode_documents supplies whether the decoder must decode every document, see
+   *        DecoderImpl.
+   */
+  virtual DecoderPtr createDecoder(DecoderCallbacks& callbacks, bool decode_documents) PURE;
 
   // Network::ReadFilter
   Network::FilterStatus onData(Buffer::Instance& data) override;
@@ -203,7 +208,7 @@ public:
   using ProxyFilter::ProxyFilter;
 
   // ProxyFilter
-  DecoderPtr createDecoder(DecoderCallbacks& callbacks) override;
+  DecoderPtr createDecoder(DecoderCallbacks& callbacks, bool decode_documents) override;
 };
 
 } // namespace Mongo
@@ -11,15 +11,17 @@ namespace Mongo {
 
 QueryMessageInfo::QueryMessageInfo(const QueryMessage& query)
     : request_id_{query.requestId()}, max_time_{0} {
+  const Bson::DocumentView document(query.encodedQuery());
+
   // First see if this is a command, if so we are done.
-  const Bson::Document* command = parseCommand(query);
-  if (command) {
-    command_ = command->values().front()->key();
+  if (query.fullCollectionName().find("$cmd") != std::string::npos) {
+    const Bson::DocumentView command = parseCommand(document);
+    command_ = std::string(command.begin()->key());
 
     // Special case the 3.2 'find' command since it is a query.
     if (command_ == "find") {
       command_ = "";
-      parseFindCommand(*command);
+      parseFindCommand(command);
     }
 
     return;
@@ -27,9 +29,9 @@ QueryMessageInfo::QueryMessageInfo(const QueryMessage& query)
 
   // Standard query.
   collection_ = parseCollection(query.fullCollectionName());
-  callsite_ = parseCallingFunction(query);
-  max_time_ = parseMaxTime(query);
-  type_ = parseType(query);
+  callsite_ = parseCallingFunction(document);
+  max_time_ = parseMaxTime(document);
+  type_ = parseType(document);
 }
 
 std::string QueryMessageInfo::parseCollection(const std::string& full_collection_name) {
@@ -41,67 +43,59 @@ std::string QueryMessageInfo::parseCollection(const std::string& full_collection
   return full_collection_name.substr(collection_index + 1);
 }
 
-int32_t QueryMessageInfo::parseMaxTime(const QueryMessage& query) {
-  const Bson::Field* field = query.query()->find("$maxTimeMS");
-  if (!field) {
+int32_t QueryMessageInfo::parseMaxTime(const Bson::DocumentView& query) {
+  const Optional<Bson::FieldView> field = query.find("$maxTimeMS");
+  if (!field.valid()) {
     return 0;
   }
 
-  if (field->type() == Bson::Field::Type::INT32) {
-    return field->asInt32();
-  } else if (field->type() == Bson::Field::Type::INT64) {
-    return static_cast<int32_t>(field->asInt64());
+  if (field.value().type() == Bson::Field::Type::INT32) {
+    return field.value().asInt32();
+  } else if (field.value().type() == Bson::Field::Type::INT64) {
+    return static_cast<int32_t>(field.value().asInt64());
   } else {
     return 0;
   }
 }
 
-const Bson::Document* QueryMessageInfo::parseCommand(const QueryMessage& query) {
-  if (query.fullCollectionName().find("$cmd") == std::string::npos) {
-    return nullptr;
-  }
-
+Bson::DocumentView QueryMessageInfo::parseCommand(const Bson::DocumentView& query) {
   // See if there is a $query document, and use that to find the command if so.
-  const Bson::Document* doc_to_use = query.query();
-  const Bson::Field* field = query.query()->find("$query", Bson::Field::Type::DOCUMENT);
-  if (field) {
-    doc_to_use = &field->asDocument();
-  }
-
-  if (doc_to_use->values().empty()) {
+  const Optional<Bson::FieldView> field = query.find("$query", Bson::Field::Type::DOCUMENT);
+  const Bson::DocumentView doc_to_use = field.valid() ? field.value().asDocument() : query;
+  if (doc_to_use.empty()) {
     throw EnvoyException("invalid query command");
   }
 
   return doc_to_use;
 }
 
-std::string QueryMessageInfo::parseCallingFunction(const QueryMessage& query) {
-  const Bson::Field* field = query.query()->find("$comment", Bson::Field::Type::STRING);
-  if (!field) {
+std::string QueryMessageInfo::parseCallingFunction(const Bson::DocumentView& query) {
+  const Optional<Bson::FieldView> field = query.find("$comment", Bson::Field::Type::STRING);
+  if (!field.valid()) {
     return "";
   }
 
-  return parseCallingFunctionJson(field->asString());
+  return parseCallingFunctionJson(field.value().asString());
 }
 
-std::string QueryMessageInfo::parseCallingFunctionJson(const std::string& json_string) {
+std::string QueryMessageInfo::parseCallingFunctionJson(absl::string_view json_string) {
   try {
-    Json::ObjectSharedPtr json = Json::Factory::loadFromString(json_string);
+    Json::ObjectSharedPtr json = Json::Factory::loadFromString(std::string(json_string));
     return json->getString("callingFunction");
   } catch (Json::Exception&) {
     return "";
   }
 }
 
-QueryMessageInfo::QueryType QueryMessageInfo::parseType(const QueryMessage& query) {
+QueryMessageInfo::QueryType QueryMessageInfo::parseType(const Bson::DocumentView& query) {
   // First check the top level for _id.
-  QueryType type = parseTypeFromDocument(*query.query());
+  QueryType type = parseTypeFromDocument(query);
   if (type == QueryType::ScatterGet) {
     // If we didn't find it in the top level, see if we have a top level $query element and look
     // there.
-    const Bson::Field* field = query.query()->find("$query", Bson::Field::Type::DOCUMENT);
-    if (field) {
-      type = parseTypeFromDocument(field->asDocument());
+    const Optional<Bson::FieldView> field = query.find("$query", Bson::Field::Type::DOCUMENT);
+    if (field.valid()) {
+      type = parseTypeFromDocument(field.value().asDocument());
     }
   }
 
@@ -109,30 +103,31 @@ QueryMessageInfo::QueryType QueryMessageInfo::parseType(const QueryMessage& quer
 }
 
 QueryMessageInfo::QueryType
-QueryMessageInfo::parseTypeFromDocument(const Bson::Document& document) {
-  const Bson::Field* field = document.find("_id");
-  if (!field) {
+QueryMessageInfo::parseTypeFromDocument(const Bson::DocumentView& document) {
+  const Optional<Bson::FieldView> field = document.find("_id");
+  if (!field.valid()) {
     return QueryType::ScatterGet;
   }
 
   // For now we call any query where _id is equal to a non-scalar value a multi get.
-  if (field->type() == Bson::Field::Type::DOCUMENT || field->type() == Bson::Field::Type::ARRAY) {
+  if (field.value().type() == Bson::Field::Type::DOCUMENT ||
+      field.value().type() == Bson::Field::Type::ARRAY) {
     return QueryType::MultiGet;
   }
 
   return QueryType::PrimaryKey;
 }
 
-void QueryMessageInfo::parseFindCommand(const Bson::Document& command) {
-  collection_ = command.values().front()->asString();
-  const Bson::Field* comment = command.find("comment", Bson::Field::Type::STRING);
-  if (comment) {
-    callsite_ = parseCallingFunctionJson(comment->asString());
+void QueryMessageInfo::parseFindCommand(const Bson::DocumentView& command) {
+  collection_ = std::string(command.begin()->asString());
+  const Optional<Bson::FieldView> comment = command.find("comment", Bson::Field::Type::STRING);
+  if (comment.valid()) {
+    callsite_ = parseCallingFunctionJson(comment.value().asString());
   }
 
-  const Bson::Field* filter = command.find("filter", Bson::Field::Type::DOCUMENT);
-  if (filter) {
-    type_ = parseTypeFromDocument(filter->asDocument());
+  const Optional<Bson::FieldView> filter = command.find("filter", Bson::Field::Type::DOCUMENT);
+  if (filter.valid()) {
+    type_ = parseTypeFromDocument(filter.value().asDocument());
   }
 }
 
@@ -4,11 +4,14 @@
 
 #include "envoy/mongo/codec.h"
 
+#include "common/mongo/bson_view.h"
+
 namespace Envoy {
 namespace Mongo {
 
 /**
- * Parses a query into information that can be used for stat gathering.
+ * Parses a query into information that can be used for stat gathering. Only the fields needed are
+ * read from the encoded query, which is not decoded.
  */
 class QueryMessageInfo {
 public:
@@ -51,14 +54,14 @@ public:
   const std::string& command() { return command_; }
 
 private:
-  std::string parseCallingFunction(const QueryMessage& query);
-  std::string parseCallingFunctionJson(const std::string& json_string);
+  std::string parseCallingFunction(const Bson::DocumentView& query);
+  std::string parseCallingFunctionJson(absl::string_view json_string);
   std::string parseCollection(const std::string& full_collection_name);
-  int32_t parseMaxTime(const QueryMessage& query);
-  const Bson::Document* parseCommand(const QueryMessage& query);
-  void parseFindCommand(const Bson::Document& command);
-  QueryType parseType(const QueryMessage& query);
-  QueryType parseTypeFromDocument(const Bson::Document& document);
+  int32_t parseMaxTime(const Bson::DocumentView& query);
+  Bson::DocumentView parseCommand(const Bson::DocumentView& query);
+  void parseFindCommand(const Bson::DocumentView& command);
+  QueryType parseType(const Bson::DocumentView& query);
+  QueryType parseTypeFromDocument(const Bson::DocumentView& document);
 
   int32_t request_id_;
   std::string collection_;
@@ -14,6 +14,7 @@
 #include "common/common/assert.h"
 #include "common/common/utility.h"
 #include "common/network/address_impl.h"
+#include "common/network/lc_trie.h"
 #include "common/network/utility.h"
 
 #include "fmt/format.h"
@@ -221,37 +222,44 @@ InstanceConstSharedPtr CidrRange::truncateIpAddressAndLength(InstanceConstShared
 }
 
 IpList::IpList(const std::vector<std::string>& subnets) {
+  std::vector<CidrRange> ip_list;
   for (const std::string& entry : subnets) {
     CidrRange list_entry = CidrRange::create(entry);
     if (list_entry.isValid()) {
-      ip_list_.push_back(list_entry);
+      ip_list.push_back(list_entry);
     } else {
       throw EnvoyException(
           fmt::format("invalid ip/mask combo '{}' (format is <ip>/<# mask bits>)", entry));
     }
   }
+  initialize(ip_list);
 }
 
 IpList::IpList(const Protobuf::RepeatedPtrField<envoy::api::v2::CidrRange>& cidrs) {
+  std::vector<CidrRange> ip_list;
   for (const envoy::api::v2::CidrRange& entry : cidrs) {
     CidrRange list_entry = CidrRange::create(entry);
     if (list_entry.isValid()) {
-      ip_list_.push_back(list_entry);
+      ip_list.push_back(list_entry);
     } else {
       throw EnvoyException(
           fmt::format("invalid ip/mask combo '{}/{}' (format is <ip>/<# mask bits>)",
                       entry.address_prefix(), entry.prefix_len().value()));
     }
   }
+  initialize(ip_list);
 }
 
-bool IpList::contains(const Instance& address) const {
-  for (const CidrRange& entry : ip_list_) {
-    if (entry.isInRange(address)) {
-      return true;
-    }
+void IpList::initialize(const std::vector<CidrRange>& ip_list) {
+  if (!ip_list.empty()) {
+    // All the ranges carry the same, empty, tag: only whether an address has a tag matters.
+    trie_ = std::make_shared<const LcTrie::LcTrie>(
+        std::vector<std::pair<std::string, std::vector<CidrRange>>>{{"", ip_list}});
   }
-  return false;
+}
+
+bool IpList::contains(const Instance& address) const {
+  return trie_ != nullptr && !trie_->getTags(address).empty();
 }
 
 IpList::IpList(const Json::Object& config, const std::string& member_name)
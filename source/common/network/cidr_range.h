@@ -1,5 +1,6 @@
 #pragma once
 
+#include <memory>
 #include <string>
 #include <vector>
 
@@ -12,6 +13,10 @@
 
 namespace Envoy {
 namespace Network {
+namespace LcTrie {
+class LcTrie;
+}
+
 namespace Address {
 
 /**
@@ -120,7 +125,8 @@ private:
 
 /**
  * Class for keeping a list of CidrRanges, and then determining whether an
- * IP address is in the CidrRange list.
+ * IP address is in the CidrRange list. The ranges are compiled into an LC-trie, so that a lookup
+ * does not scan the list.
  */
 class IpList {
 public:
@@ -130,10 +136,13 @@ public:
   IpList(){};
 
   bool contains(const Instance& address) const;
-  bool empty() const { return ip_list_.empty(); }
+  bool empty() const { return trie_ == nullptr; }
 
 private:
-  std::vector<CidrRange> ip_list_;
+  void initialize(const std::vector<CidrRange>& ip_list);
+
+  // Immutable, so copies of the list share it. Null if the list is empty.
+  std::shared_ptr<const LcTrie::LcTrie> trie_;
 };
 
 } // namespace Address
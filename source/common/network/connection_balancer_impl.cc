@@ -0,0 +1,48 @@
+#include "common/network/connection_balancer_impl.h"
+
+#include <algorithm>
+
+#include "common/common/assert.h"
+
+namespace Envoy {
+namespace Network {
+
+void ExactConnectionBalancerImpl::registerHandler(BalancedConnectionHandler& handler) {
+  std::unique_lock<std::mutex> lock(lock_);
+  handlers_.push_back(&handler);
+}
+
+void ExactConnectionBalancerImpl::unregisterHandler(BalancedConnectionHandler& handler) {
+  std::unique_lock<std::mutex> lock(lock_);
+  auto it = std::find(handlers_.begin(), handlers_.end(), &handler);
+  ASSERT(it != handlers_.end());
+  handlers_.erase(it);
+}
+
+bool ExactConnectionBalancerImpl::balanceConnection(BalancedConnectionHandler& current, int fd,
+                                                    Address::InstanceConstSharedPtr remote_address,
+                                                    Address::InstanceConstSharedPtr local_address,
+                                                    bool using_original_dst) {
+  std::unique_lock<std::mutex> lock(lock_);
+  BalancedConnectionHandler* target = &current;
+  uint64_t target_connections = current.numConnections();
+  for (BalancedConnectionHandler* handler : handlers_) {
+    const uint64_t connections = handler->numConnections();
+    if (connections < target_connections) {
+      target = handler;
+      target_connections = connections;
+    }
+  }
+
+  if (target == &current) {
+    return false;
+  }
+
+  // Posting under the lock keeps the target from being unregistered, and destroyed, before the
+  // connection is posted to it.
+  target->post(fd, remote_address, local_address, using_original_dst);
+  return true;
+}
+
+} // namespace Network
+} // namespace Envoy
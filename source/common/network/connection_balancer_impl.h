@@ -0,0 +1,32 @@
+#pragma once
+
+#include <mutex>
+#include <vector>
+
+#include "envoy/network/listener.h"
+
+namespace Envoy {
+namespace Network {
+
+/**
+ * Connection balancer that hands each connection over to the listener with the fewest connections
+ * when it is accepted. The listeners are all compared under a lock for every connection, which is
+ * cheap next to accepting a connection for the handful of workers of a server.
+ */
+class ExactConnectionBalancerImpl : public ConnectionBalancer {
+public:
+  // Network::ConnectionBalancer
+  void registerHandler(BalancedConnectionHandler& handler) override;
+  void unregisterHandler(BalancedConnectionHandler& handler) override;
+  bool balanceConnection(BalancedConnectionHandler& current, int fd,
+                         Address::InstanceConstSharedPtr remote_address,
+                         Address::InstanceConstSharedPtr local_address,
+                         bool using_original_dst) override;
+
+private:
+  std::mutex lock_;
+  std::vector<BalancedConnectionHandler*> handlers_;
+};
+
+} // namespace Network
+} // namespace Envoy
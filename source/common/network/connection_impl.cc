@@ -1,5 +1,6 @@
 #include "common/network/connection_impl.h"
 
+#include <fcntl.h>
 #include <netinet/tcp.h>
 #include <sys/socket.h>
 #include <sys/types.h>
@@ -15,6 +16,7 @@
 #include "common/common/assert.h"
 #include "common/common/empty_string.h"
 #include "common/common/enum_to_int.h"
+#include "common/common/thread_load.h"
 #include "common/network/address_impl.h"
 #include "common/network/raw_buffer_socket.h"
 #include "common/network/utility.h"
@@ -30,6 +32,19 @@ Address::InstanceConstSharedPtr getNullLocalAddress(const Address::Instance& add
   // Default to IPv4 any address.
   return Utility::getIpv4AnyAddress();
 }
+
+// Move up to len bytes from fd_in to fd_out without blocking, one of which must be a pipe.
+ssize_t spliceFd(int fd_in, int fd_out, uint64_t len) {
+#ifdef __linux__
+  return ::splice(fd_in, nullptr, fd_out, nullptr, len, SPLICE_F_MOVE | SPLICE_F_NONBLOCK);
+#else
+  UNREFERENCED_PARAMETER(fd_in);
+  UNREFERENCED_PARAMETER(fd_out);
+  UNREFERENCED_PARAMETER(len);
+  errno = ENOSYS;
+  return -1;
+#endif
+}
 } // namespace
 
 void ConnectionImplUtility::updateBufferStats(uint64_t delta, uint64_t new_total,
@@ -135,14 +150,16 @@ void ConnectionImpl::close(ConnectionCloseType type) {
     return;
   }
 
-  uint64_t data_to_write = write_buffer_->length();
+  uint64_t data_to_write = write_buffer_->length() + splice_pipe_bytes_;
   ENVOY_CONN_LOG(debug, "closing data_to_write={} type={}", *this, data_to_write, enumToInt(type));
   if (data_to_write == 0 || type == ConnectionCloseType::NoFlush ||
       !transport_socket_->canFlushClose()) {
     if (data_to_write > 0) {
       // We aren't going to wait to flush, but try to write as much as we can if there is pending
       // data.
-      transport_socket_->doWrite(*write_buffer_);
+      if (doSpliceWrite().action_ == PostIoAction::KeepOpen && splice_pipe_bytes_ == 0) {
+        transport_socket_->doWrite(*write_buffer_);
+      }
     }
 
     closeSocket(ConnectionEvent::LocalClose);
@@ -178,6 +195,16 @@ void ConnectionImpl::closeSocket(ConnectionEvent close_type) {
   updateWriteBufferStats(0, 0);
   connection_stats_.reset();
 
+  // Anything still in the pipe is dropped along with the write buffer, and the peer goes back to
+  // reading through its filters.
+  if (splice_peer_ != nullptr) {
+    splice_peer_->splice_peer_ = nullptr;
+    splice_peer_->splice_cb_ = nullptr;
+    splice_peer_ = nullptr;
+    splice_cb_ = nullptr;
+  }
+  closeSplicePipe();
+
   file_event_.reset();
   ::close(fd_);
   fd_ = -1;
@@ -295,6 +322,8 @@ bool ConnectionImpl::readEnabled() const { return read_enabled_; }
 
 void ConnectionImpl::addConnectionCallbacks(ConnectionCallbacks& cb) { callbacks_.push_back(&cb); }
 
+void ConnectionImpl::removeConnectionCallbacks(ConnectionCallbacks& cb) { callbacks_.remove(&cb); }
+
 void ConnectionImpl::addBytesSentCallback(BytesSentCb cb) {
   bytes_sent_callbacks_.emplace_back(cb);
 }
@@ -356,6 +385,12 @@ void ConnectionImpl::setBufferLimits(uint32_t limit) {
   }
 }
 
+void ConnectionImpl::setMemoryAccount(const Buffer::MemoryAccountSharedPtr& account) {
+  memory_account_ = account;
+  read_buffer_.setMemoryAccount(account);
+  static_cast<Buffer::WatermarkBuffer*>(write_buffer_.get())->setMemoryAccount(account);
+}
+
 void ConnectionImpl::onLowWatermark() {
   ENVOY_CONN_LOG(debug, "onBelowWriteBufferLowWatermark", *this);
   ASSERT(above_high_watermark_);
@@ -419,9 +454,15 @@ void ConnectionImpl::onReadReady() {
 
   ASSERT(!connecting_);
 
+  if (splice_peer_ != nullptr) {
+    onSpliceReadReady();
+    return;
+  }
+
   IoResult result = transport_socket_->doRead(read_buffer_);
   uint64_t new_buffer_size = read_buffer_.length();
   updateReadBufferStats(result.bytes_processed_, new_buffer_size);
+  ThreadLoad::addRxBytes(result.bytes_processed_);
   if (result.bytes_processed_ != 0) {
     // Skip onRead if no bytes were processed. For instance, if the connection was closed without
     // producing more data.
@@ -461,9 +502,16 @@ void ConnectionImpl::onWriteReady() {
     }
   }
 
-  IoResult result = transport_socket_->doWrite(*write_buffer_);
-  uint64_t new_buffer_size = write_buffer_->length();
+  // Spliced data was read before anything in the write buffer, so it is written first.
+  IoResult result = doSpliceWrite();
+  if (result.action_ == PostIoAction::KeepOpen && splice_pipe_bytes_ == 0) {
+    IoResult buffer_result = transport_socket_->doWrite(*write_buffer_);
+    result.action_ = buffer_result.action_;
+    result.bytes_processed_ += buffer_result.bytes_processed_;
+  }
+  uint64_t new_buffer_size = write_buffer_->length() + splice_pipe_bytes_;
   updateWriteBufferStats(result.bytes_processed_, new_buffer_size);
+  ThreadLoad::addTxBytes(result.bytes_processed_);
 
   if (result.action_ == PostIoAction::Close) {
     // It is possible (though unlikely) for the connection to have already been closed during the
@@ -485,6 +533,153 @@ void ConnectionImpl::onWriteReady() {
   }
 }
 
+bool ConnectionImpl::startSplice(Connection& peer, SpliceCb cb) {
+#ifdef __linux__
+  ConnectionImpl* peer_impl = dynamic_cast<ConnectionImpl*>(&peer);
+  if (peer_impl == nullptr || peer_impl == this || !canSplice() || !peer_impl->canSplice()) {
+    return false;
+  }
+
+  if (!openSplicePipe() || !peer_impl->openSplicePipe()) {
+    ENVOY_CONN_LOG(debug, "unable to create splice pipe: {}", *this, strerror(errno));
+    closeSplicePipe();
+    peer_impl->closeSplicePipe();
+    return false;
+  }
+
+  ENVOY_CONN_LOG(debug, "spliced to C{}", *this, peer.id());
+  splice_peer_ = peer_impl;
+  splice_cb_ = cb;
+  peer_impl->splice_peer_ = this;
+  peer_impl->splice_cb_ = cb;
+
+  // Either socket may already have data waiting, which an edge triggered event will not report
+  // again.
+  if (read_enabled_) {
+    file_event_->activate(Event::FileReadyType::Read);
+  }
+  if (peer_impl->read_enabled_) {
+    peer_impl->file_event_->activate(Event::FileReadyType::Read);
+  }
+  return true;
+#else
+  UNREFERENCED_PARAMETER(peer);
+  UNREFERENCED_PARAMETER(cb);
+  return false;
+#endif
+}
+
+bool ConnectionImpl::canSplice() {
+  // The one read filter allowed is the one starting the splice, which has consumed everything it
+  // was given. TLS and other transports must see the bytes, so only raw sockets can be spliced.
+  return fd_ != -1 && !connecting_ && !close_with_flush_ && splice_peer_ == nullptr &&
+         read_buffer_.length() == 0 && write_buffer_->length() == 0 &&
+         filter_manager_.readFilterCount() <= 1 && filter_manager_.writeFilterCount() == 0 &&
+         dynamic_cast<RawBufferSocket*>(transport_socket_.get()) != nullptr;
+}
+
+bool ConnectionImpl::openSplicePipe() {
+#ifdef __linux__
+  if (::pipe2(splice_pipe_, O_NONBLOCK | O_CLOEXEC) != 0) {
+    return false;
+  }
+
+  // Track how much the pipe holds so that reads stop when it is full rather than failing.
+  int size = ::fcntl(splice_pipe_[1], F_GETPIPE_SZ);
+  if (size <= 0) {
+    closeSplicePipe();
+    return false;
+  }
+  splice_pipe_size_ = size;
+  splice_pipe_bytes_ = 0;
+  return true;
+#else
+  return false;
+#endif
+}
+
+void ConnectionImpl::closeSplicePipe() {
+  for (int& fd : splice_pipe_) {
+    if (fd != -1) {
+      ::close(fd);
+      fd = -1;
+    }
+  }
+  splice_pipe_bytes_ = 0;
+  splice_read_blocked_ = false;
+}
+
+void ConnectionImpl::onSpliceReadReady() {
+  if (!read_enabled_) {
+    return;
+  }
+
+  splice_read_blocked_ = false;
+  while (true) {
+    ConnectionImpl& peer = *splice_peer_;
+    const uint64_t space = peer.splice_pipe_size_ - peer.splice_pipe_bytes_;
+    if (space == 0) {
+      splice_read_blocked_ = true;
+      return;
+    }
+
+    ssize_t rc = spliceFd(fd_, peer.splice_pipe_[1], space);
+    if (rc == 0) {
+      ENVOY_CONN_LOG(debug, "remote close", *this);
+      closeSocket(ConnectionEvent::RemoteClose);
+      return;
+    }
+
+    if (rc == -1) {
+      if (errno == EAGAIN) {
+        // Either the socket is empty or the pipe is full. In the latter case the peer resumes
+        // reading after it writes some of the pipe out.
+        splice_read_blocked_ = peer.splice_pipe_bytes_ > 0;
+        return;
+      }
+
+      ENVOY_CONN_LOG(debug, "splice read error: {}", *this, errno);
+      closeSocket(ConnectionEvent::RemoteClose);
+      return;
+    }
+
+    peer.splice_pipe_bytes_ += rc;
+    updateReadBufferStats(rc, 0);
+    peer.file_event_->activate(Event::FileReadyType::Write);
+    splice_cb_(*this, rc);
+
+    // The callback may have closed either connection.
+    if (fd_ == -1 || splice_peer_ == nullptr) {
+      return;
+    }
+  }
+}
+
+IoResult ConnectionImpl::doSpliceWrite() {
+  uint64_t bytes_written = 0;
+  while (splice_pipe_bytes_ > 0) {
+    ssize_t rc = spliceFd(splice_pipe_[0], fd_, splice_pipe_bytes_);
+    if (rc == -1) {
+      if (errno == EAGAIN) {
+        break;
+      }
+
+      ENVOY_CONN_LOG(debug, "splice write error: {}", *this, errno);
+      return {PostIoAction::Close, bytes_written};
+    }
+
+    splice_pipe_bytes_ -= rc;
+    bytes_written += rc;
+  }
+
+  if (bytes_written > 0 && splice_peer_ != nullptr && splice_peer_->splice_read_blocked_ &&
+      splice_peer_->read_enabled_) {
+    splice_peer_->file_event_->activate(Event::FileReadyType::Read);
+  }
+
+  return {PostIoAction::KeepOpen, bytes_written};
+}
+
 void ConnectionImpl::doConnect() {
   ENVOY_CONN_LOG(debug, "connecting to {}", *this, remote_address_->asString());
   int rc = remote_address_->connect(fd_);
@@ -544,5 +739,14 @@ ClientConnectionImpl::ClientConnectionImpl(
                      remote_address, nullptr, source_address, std::move(transport_socket), false,
                      false) {}
 
+void ClientConnectionImpl::enableFastOpen() {
+  if (remote_address_->type() != Address::Type::Ip) {
+    return;
+  }
+  if (!Utility::setTcpFastOpenConnect(fd())) {
+    ENVOY_CONN_LOG(debug, "cannot enable TCP Fast Open: {}", *this, strerror(errno));
+  }
+}
+
 } // namespace Network
 } // namespace Envoy
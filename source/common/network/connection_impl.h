@@ -13,6 +13,7 @@
 
 #include "common/buffer/watermark_buffer.h"
 #include "common/common/logger.h"
+#include "common/common/object_pool.h"
 #include "common/event/libevent.h"
 #include "common/network/filter_manager_impl.h"
 #include "common/ssl/ssl_socket.h"
@@ -40,11 +41,14 @@ public:
 };
 
 /**
- * Implementation of Network::Connection.
+ * Implementation of Network::Connection. Connections are allocated from the ObjectPool so that the
+ * storage of closed connections, including their buffers and filter manager, is reused by the
+ * connections the worker accepts next.
  */
 class ConnectionImpl : public virtual Connection,
                        public BufferSource,
                        public TransportSocketCallbacks,
+                       public PooledObject,
                        protected Logger::Loggable<Logger::Id::connection> {
 public:
   // TODO(lizan): Remove the old style constructor when factory is ready.
@@ -70,6 +74,7 @@ public:
 
   // Network::Connection
   void addConnectionCallbacks(ConnectionCallbacks& cb) override;
+  void removeConnectionCallbacks(ConnectionCallbacks& cb) override;
   void addBytesSentCallback(BytesSentCb cb) override;
   void close(ConnectionCloseType type) override;
   Event::Dispatcher& dispatcher() override;
@@ -88,8 +93,11 @@ public:
   void write(Buffer::Instance& data) override;
   void setBufferLimits(uint32_t limit) override;
   uint32_t bufferLimit() const override { return read_buffer_limit_; }
+  void setMemoryAccount(const Buffer::MemoryAccountSharedPtr& account) override;
+  const Buffer::MemoryAccountSharedPtr& memoryAccount() const override { return memory_account_; }
   bool usingOriginalDst() const override { return using_original_dst_; }
   bool aboveHighWatermark() const override { return above_high_watermark_; }
+  bool startSplice(Connection& peer, SpliceCb cb) override;
 
   // Network::BufferSource
   Buffer::Instance& getReadBuffer() override { return read_buffer_; }
@@ -121,11 +129,13 @@ protected:
   FilterManagerImpl filter_manager_;
   Address::InstanceConstSharedPtr remote_address_;
   Address::InstanceConstSharedPtr local_address_;
-  Buffer::OwnedImpl read_buffer_;
+  // The read buffer has no watermarks. It is a WatermarkBuffer so that it can be accounted.
+  Buffer::WatermarkBuffer read_buffer_{[]() -> void {}, []() -> void {}};
   // This must be a WatermarkBuffer, but as it is created by a factory the ConnectionImpl only has
   // a generic pointer.
   Buffer::InstancePtr write_buffer_;
   uint32_t read_buffer_limit_ = 0;
+  Buffer::MemoryAccountSharedPtr memory_account_;
 
 private:
   void onFileEvent(uint32_t events);
@@ -134,6 +144,11 @@ private:
   void onWriteReady();
   void updateReadBufferStats(uint64_t num_read, uint64_t new_size);
   void updateWriteBufferStats(uint64_t num_written, uint64_t new_size);
+  bool canSplice();
+  bool openSplicePipe();
+  void closeSplicePipe();
+  void onSpliceReadReady();
+  IoResult doSpliceWrite();
 
   static std::atomic<uint64_t> next_global_id_;
 
@@ -159,6 +174,16 @@ private:
   // readDisabled(true) this allows the connection to only resume reads when readDisabled(false)
   // has been called N times.
   uint32_t read_disable_count_{0};
+  // While spliced, data read from this connection goes straight into the peer's pipe, and data
+  // in this connection's pipe is written to its socket ahead of the write buffer.
+  ConnectionImpl* splice_peer_{};
+  SpliceCb splice_cb_;
+  int splice_pipe_[2]{-1, -1};
+  uint64_t splice_pipe_size_{};
+  uint64_t splice_pipe_bytes_{};
+  // Set when reads stopped while the peer's pipe held data, so the peer resumes them once it has
+  // drained some.
+  bool splice_read_blocked_{false};
 };
 
 /**
@@ -173,6 +198,7 @@ public:
 
   // Network::ClientConnection
   void connect() override { doConnect(); }
+  void enableFastOpen() override;
 };
 
 } // namespace Network
@@ -1,9 +1,12 @@
 #include "common/network/dns_impl.h"
 
+#include <arpa/inet.h>
+#include <arpa/nameser.h>
 #include <netdb.h>
 #include <netinet/ip.h>
 #include <sys/socket.h>
 
+#include <algorithm>
 #include <chrono>
 #include <cstdint>
 #include <list>
@@ -19,10 +22,36 @@
 namespace Envoy {
 namespace Network {
 
+namespace {
+
+// The maximum number of addresses whose TTLs are parsed from an answer.
+const int MaxAddrTtls = 32;
+
+std::string cacheKey(const std::string& dns_name, DnsLookupFamily dns_lookup_family) {
+  switch (dns_lookup_family) {
+  case DnsLookupFamily::V4Only:
+    return "4/" + dns_name;
+  case DnsLookupFamily::V6Only:
+    return "6/" + dns_name;
+  case DnsLookupFamily::Auto:
+    return "a/" + dns_name;
+  }
+  NOT_REACHED;
+}
+
+bool isIpAddress(const std::string& dns_name) {
+  in6_addr address;
+  return inet_pton(AF_INET, dns_name.c_str(), &address) == 1 ||
+         inet_pton(AF_INET6, dns_name.c_str(), &address) == 1;
+}
+
+} // namespace
+
 DnsResolverImpl::DnsResolverImpl(
     Event::Dispatcher& dispatcher,
-    const std::vector<Network::Address::InstanceConstSharedPtr>& resolvers)
-    : dispatcher_(dispatcher),
+    const std::vector<Network::Address::InstanceConstSharedPtr>& resolvers,
+    MonotonicTimeSource& time_source)
+    : dispatcher_(dispatcher), time_source_(time_source),
       timer_(dispatcher.createTimer([this] { onEventCallback(ARES_SOCKET_BAD, 0); })) {
   // This is also done in main(), to satisfy the requirement that c-ares is
   // initialized prior to threading. The additional call to ares_library_init()
@@ -59,8 +88,14 @@ void DnsResolverImpl::initializeChannel(ares_options* options, int optmask) {
   ares_init_options(&channel_, options, optmask | ARES_OPT_SOCK_STATE_CB);
 }
 
+void DnsResolverImpl::initializeStats(Stats::Scope& scope, const std::string& prefix) {
+  stats_.reset(new DnsResolverStats{ALL_DNS_RESOLVER_STATS(POOL_COUNTER_PREFIX(scope, prefix),
+                                                           POOL_HISTOGRAM_PREFIX(scope, prefix))});
+}
+
 void DnsResolverImpl::PendingResolution::onAresHostCallback(int status, int timeouts,
-                                                            hostent* hostent) {
+                                                            hostent* hostent,
+                                                            std::chrono::seconds ttl) {
   // We receive ARES_EDESTRUCTION when destructing with pending queries.
   if (status == ARES_EDESTRUCTION) {
     ASSERT(owned_);
@@ -101,8 +136,11 @@ void DnsResolverImpl::PendingResolution::onAresHostCallback(int status, int time
   }
 
   if (completed_) {
-    if (!cancelled_) {
-      callback_(std::move(address_list));
+    parent_.onResolutionComplete(*this, address_list, ttl);
+    for (const auto& waiter : waiters_) {
+      if (!waiter->cancelled_) {
+        waiter->callback_(std::list<Address::InstanceConstSharedPtr>(address_list));
+      }
     }
     if (owned_) {
       delete this;
@@ -161,13 +199,83 @@ void DnsResolverImpl::onAresSocketStateChange(int fd, int read, int write) {
                           (write ? Event::FileReadyType::Write : 0));
 }
 
+void DnsResolverImpl::onResolutionComplete(
+    PendingResolution& resolution, const std::list<Address::InstanceConstSharedPtr>& address_list,
+    std::chrono::seconds ttl) {
+  const MonotonicTime now = time_source_.currentTime();
+  if (resolution.owned_) {
+    in_flight_.erase(resolution.key_);
+  }
+  if (stats_ != nullptr) {
+    stats_->resolve_time_ms_.recordValue(
+        std::chrono::duration_cast<std::chrono::milliseconds>(now - resolution.start_).count());
+    if (address_list.empty()) {
+      stats_->resolve_failure_.inc();
+    }
+  }
+
+  // Failures and answers that may not be cached are resolved again next time, while a prefetch
+  // that failed leaves the current answer until it expires.
+  if (address_list.empty() || ttl.count() <= 0) {
+    return;
+  }
+  CacheEntry& entry = cache_[resolution.key_];
+  entry.addresses_ = address_list;
+  entry.expiry_ = now + ttl;
+  entry.refresh_at_ = now + std::chrono::duration_cast<std::chrono::milliseconds>(ttl) * 9 / 10;
+}
+
 ActiveDnsQuery* DnsResolverImpl::resolve(const std::string& dns_name,
                                          DnsLookupFamily dns_lookup_family, ResolveCb callback) {
-  // TODO(hennna): Add DNS caching which will allow testing the edge case of a
-  // failed intial call to getHostbyName followed by a synchronous IPv4
-  // resolution.
+  const std::string key = cacheKey(dns_name, dns_lookup_family);
+  auto cached = cache_.find(key);
+  if (cached != cache_.end()) {
+    const MonotonicTime now = time_source_.currentTime();
+    if (now < cached->second.expiry_) {
+      if (stats_ != nullptr) {
+        stats_->cache_hit_.inc();
+      }
+      // Copied first, since the prefetch may replace the entry.
+      std::list<Address::InstanceConstSharedPtr> address_list = cached->second.addresses_;
+      if (now >= cached->second.refresh_at_ && in_flight_.find(key) == in_flight_.end()) {
+        if (stats_ != nullptr) {
+          stats_->prefetch_.inc();
+        }
+        startResolution(key, dns_name, dns_lookup_family, nullptr);
+      }
+      callback(std::move(address_list));
+      return nullptr;
+    }
+    cache_.erase(cached);
+  }
+
+  auto in_flight = in_flight_.find(key);
+  if (in_flight != in_flight_.end()) {
+    if (stats_ != nullptr) {
+      stats_->coalesced_.inc();
+    }
+    PendingResolution& resolution = *in_flight->second;
+    resolution.waiters_.emplace_back(new Waiter(callback));
+    return resolution.waiters_.back().get();
+  }
+
+  if (stats_ != nullptr) {
+    stats_->cache_miss_.inc();
+  }
+  return startResolution(key, dns_name, dns_lookup_family, callback);
+}
+
+ActiveDnsQuery* DnsResolverImpl::startResolution(const std::string& key,
+                                                 const std::string& dns_name,
+                                                 DnsLookupFamily dns_lookup_family,
+                                                 ResolveCb callback) {
   std::unique_ptr<PendingResolution> pending_resolution(
-      new PendingResolution(callback, channel_, dns_name));
+      new PendingResolution(*this, key, dns_name, time_source_.currentTime()));
+  ActiveDnsQuery* query = nullptr;
+  if (callback != nullptr) {
+    pending_resolution->waiters_.emplace_back(new Waiter(callback));
+    query = pending_resolution->waiters_.back().get();
+  }
   if (dns_lookup_family == DnsLookupFamily::Auto) {
     pending_resolution->fallback_if_failed_ = true;
   }
@@ -187,19 +295,71 @@ ActiveDnsQuery* DnsResolverImpl::resolve(const std::string& dns_name,
     updateAresTimer();
 
     // The PendingResolution will self-delete when the request completes
-    // (including if cancelled or if ~DnsResolverImpl() happens).
+    // (including if cancelled or if ~DnsResolverImpl() happens). Later
+    // resolutions of the name wait for it.
     pending_resolution->owned_ = true;
-    return pending_resolution.release();
+    in_flight_[key] = pending_resolution.get();
+    pending_resolution.release();
+    return query;
   }
 }
 
 void DnsResolverImpl::PendingResolution::getHostByName(int family) {
-  ares_gethostbyname(channel_, dns_name_.c_str(), family,
-                     [](void* arg, int status, int timeouts, hostent* hostent) {
-                       static_cast<PendingResolution*>(arg)->onAresHostCallback(status, timeouts,
-                                                                                hostent);
-                     },
-                     this);
+  const ares_channel channel = parent_.channel_;
+  // Addresses and names in the hosts file resolve synchronously and are not cached.
+  if (isIpAddress(dns_name_)) {
+    ares_gethostbyname(channel, dns_name_.c_str(), family,
+                       [](void* arg, int status, int timeouts, hostent* hostent) {
+                         static_cast<PendingResolution*>(arg)->onAresHostCallback(
+                             status, timeouts, hostent, std::chrono::seconds(0));
+                       },
+                       this);
+    return;
+  }
+  hostent* host = nullptr;
+  if (ares_gethostbyname_file(channel, dns_name_.c_str(), family, &host) == ARES_SUCCESS) {
+    onAresHostCallback(ARES_SUCCESS, 0, host, std::chrono::seconds(0));
+    ares_free_hostent(host);
+    return;
+  }
+
+  // Other names are queried with ares_search() rather than ares_gethostbyname(), which drops the
+  // TTLs of the answer.
+  auto callback = [](void* arg, int status, int timeouts, unsigned char* abuf, int alen) {
+    PendingResolution* resolution = static_cast<PendingResolution*>(arg);
+    if (status != ARES_SUCCESS) {
+      resolution->onAresHostCallback(status, timeouts, nullptr, std::chrono::seconds(0));
+      return;
+    }
+    hostent* host = nullptr;
+    int ttls[MaxAddrTtls];
+    int naddrttls = MaxAddrTtls;
+    if (resolution->family_ == AF_INET) {
+      ares_addrttl addrttls[MaxAddrTtls];
+      status = ares_parse_a_reply(abuf, alen, &host, addrttls, &naddrttls);
+      for (int i = 0; status == ARES_SUCCESS && i < naddrttls; ++i) {
+        ttls[i] = addrttls[i].ttl;
+      }
+    } else {
+      ares_addr6ttl addrttls[MaxAddrTtls];
+      status = ares_parse_aaaa_reply(abuf, alen, &host, addrttls, &naddrttls);
+      for (int i = 0; status == ARES_SUCCESS && i < naddrttls; ++i) {
+        ttls[i] = addrttls[i].ttl;
+      }
+    }
+    // The answer is cached for the TTL of the address that expires first.
+    int ttl = 0;
+    if (status == ARES_SUCCESS && naddrttls > 0) {
+      ttl = std::max(*std::min_element(ttls, ttls + naddrttls), 0);
+    }
+    resolution->onAresHostCallback(status, timeouts, status == ARES_SUCCESS ? host : nullptr,
+                                   std::chrono::seconds(ttl));
+    if (host != nullptr) {
+      ares_free_hostent(host);
+    }
+  };
+  family_ = family;
+  ares_search(channel, dns_name_.c_str(), C_IN, family == AF_INET ? T_A : T_AAAA, callback, this);
 }
 
 } // namespace Network
@@ -2,13 +2,19 @@
 
 #include <netdb.h>
 
+#include <chrono>
 #include <cstdint>
+#include <list>
+#include <memory>
 #include <string>
 #include <unordered_map>
 
+#include "envoy/common/time.h"
 #include "envoy/event/dispatcher.h"
 #include "envoy/event/file_event.h"
 #include "envoy/network/dns.h"
+#include "envoy/stats/stats.h"
+#include "envoy/stats/stats_macros.h"
 
 #include "common/common/linked_object.h"
 #include "common/common/logger.h"
@@ -21,62 +27,115 @@ namespace Network {
 
 class DnsResolverImplPeer;
 
+// clang-format off
+#define ALL_DNS_RESOLVER_STATS(COUNTER, HISTOGRAM)                                                 \
+  COUNTER(cache_hit)                                                                               \
+  COUNTER(cache_miss)                                                                              \
+  COUNTER(coalesced)                                                                               \
+  COUNTER(prefetch)                                                                                \
+  COUNTER(resolve_failure)                                                                         \
+  HISTOGRAM(resolve_time_ms)
+// clang-format on
+
+/**
+ * Struct definition for all DNS resolver stats. @see stats_macros.h
+ */
+struct DnsResolverStats {
+  ALL_DNS_RESOLVER_STATS(GENERATE_COUNTER_STRUCT, GENERATE_HISTOGRAM_STRUCT)
+};
+
 /**
  * Implementation of DnsResolver that uses c-ares. All calls and callbacks are assumed to
  * happen on the thread that owns the creating dispatcher.
+ *
+ * Answers from DNS servers are cached for their TTL and shared by the callers of the resolver.
+ * Concurrent resolutions of a name wait for the same query, and a name that is resolved again
+ * close to the expiry of its answer is queried in the background while the answer is still served.
  */
 class DnsResolverImpl : public DnsResolver, protected Logger::Loggable<Logger::Id::upstream> {
 public:
   DnsResolverImpl(Event::Dispatcher& dispatcher,
-                  const std::vector<Network::Address::InstanceConstSharedPtr>& resolvers);
+                  const std::vector<Network::Address::InstanceConstSharedPtr>& resolvers,
+                  MonotonicTimeSource& time_source = ProdMonotonicTimeSource::instance_);
   ~DnsResolverImpl() override;
 
   // Network::DnsResolver
   ActiveDnsQuery* resolve(const std::string& dns_name, DnsLookupFamily dns_lookup_family,
                           ResolveCb callback) override;
+  void initializeStats(Stats::Scope& scope, const std::string& prefix) override;
 
 private:
   friend class DnsResolverImplPeer;
-  struct PendingResolution : public ActiveDnsQuery {
-    // Network::ActiveDnsQuery
-    PendingResolution(ResolveCb callback, ares_channel channel, const std::string& dns_name)
-        : callback_(callback), channel_(channel), dns_name_(dns_name) {}
 
+  // A caller waiting for a resolution.
+  struct Waiter : public ActiveDnsQuery {
+    Waiter(ResolveCb callback) : callback_(callback) {}
+
+    // Network::ActiveDnsQuery
     void cancel() override {
       // c-ares only supports channel-wide cancellation, so we just allow the
       // network events to continue but don't invoke the callback on completion.
       cancelled_ = true;
     }
 
+    // Caller supplied callback to invoke on query completion or error.
+    const ResolveCb callback_;
+    // Was the query cancelled via cancel()?
+    bool cancelled_ = false;
+  };
+
+  struct PendingResolution {
+    PendingResolution(DnsResolverImpl& parent, const std::string& key,
+                      const std::string& dns_name, MonotonicTime start)
+        : parent_(parent), key_(key), dns_name_(dns_name), start_(start) {}
+
     /**
-     * c-ares ares_gethostbyname() query callback.
-     * @param status return status of call to ares_gethostbyname.
+     * c-ares query callback.
+     * @param status return status of the query.
      * @param timeouts the number of times the request timed out.
      * @param hostent structure that stores information about a given host.
+     * @param ttl the TTL of the answer, zero for answers that are not from a DNS server.
      */
-    void onAresHostCallback(int status, int timeouts, hostent* hostent);
+    void onAresHostCallback(int status, int timeouts, hostent* hostent, std::chrono::seconds ttl);
     /**
-     * wrapper function of call to ares_gethostbyname.
+     * Look up the name in the hosts file, or query it otherwise.
      * @param family currently AF_INET and AF_INET6 are supported.
      */
     void getHostByName(int family);
 
-    // Caller supplied callback to invoke on query completion or error.
-    const ResolveCb callback_;
+    DnsResolverImpl& parent_;
+    const std::string key_;
     // Does the object own itself? Resource reclamation occurs via self-deleting
     // on query completion or error.
     bool owned_ = false;
     // Has the query completed? Only meaningful if !owned_;
     bool completed_ = false;
-    // Was the query cancelled via cancel()?
-    bool cancelled_ = false;
     // If dns_lookup_family is "fallback", fallback to v4 address if v6
     // resolution failed.
     bool fallback_if_failed_ = false;
-    const ares_channel channel_;
     const std::string dns_name_;
+    // The family queried by ares_search().
+    int family_ = AF_UNSPEC;
+    const MonotonicTime start_;
+    // The callers to answer, none for prefetches.
+    std::list<std::unique_ptr<Waiter>> waiters_;
   };
 
+  struct CacheEntry {
+    std::list<Address::InstanceConstSharedPtr> addresses_;
+    MonotonicTime expiry_;
+    // Once passed, a resolution of the name queries it again in the background.
+    MonotonicTime refresh_at_;
+  };
+
+  // Start a resolution, which answers the callback if it is not null.
+  ActiveDnsQuery* startResolution(const std::string& key, const std::string& dns_name,
+                                  DnsLookupFamily dns_lookup_family, ResolveCb callback);
+  // Record the answer of a completed resolution before its waiters are answered.
+  void onResolutionComplete(PendingResolution& resolution,
+                            const std::list<Address::InstanceConstSharedPtr>& address_list,
+                            std::chrono::seconds ttl);
+
   // Callback for events on sockets tracked in events_.
   void onEventCallback(int fd, uint32_t events);
   // c-ares callback when a socket state changes, indicating that libevent
@@ -88,9 +147,14 @@ private:
   void updateAresTimer();
 
   Event::Dispatcher& dispatcher_;
+  MonotonicTimeSource& time_source_;
   Event::TimerPtr timer_;
   ares_channel channel_;
   std::unordered_map<int, Event::FileEventPtr> events_;
+  // Answers and asynchronous resolutions, by lookup family and name.
+  std::unordered_map<std::string, CacheEntry> cache_;
+  std::unordered_map<std::string, PendingResolution*> in_flight_;
+  std::unique_ptr<DnsResolverStats> stats_;
 };
 
 } // namespace Network
@@ -1,5 +1,6 @@
 #pragma once
 
+#include <cstdint>
 #include <list>
 #include <memory>
 
@@ -42,6 +43,8 @@ public:
   bool initializeReadFilters();
   void onRead();
   FilterStatus onWrite();
+  uint64_t readFilterCount() const { return upstream_filters_.size(); }
+  uint64_t writeFilterCount() const { return downstream_filters_.size(); }
 
 private:
   struct ActiveReadFilter : public ReadFilterCallbacks, LinkedObject<ActiveReadFilter> {
@@ -0,0 +1,71 @@
+#include "common/network/lc_trie.h"
+
+#include <arpa/inet.h>
+
+#include <array>
+#include <cstdint>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace Envoy {
+namespace Network {
+namespace LcTrie {
+
+namespace {
+
+const std::vector<std::string> NO_TAGS;
+
+} // namespace
+
+LcTrie::LcTrie(
+    const std::vector<std::pair<std::string, std::vector<Address::CidrRange>>>& tag_data) {
+  std::vector<IpPrefix<uint32_t>> ipv4_prefixes;
+  std::vector<IpPrefix<absl::uint128>> ipv6_prefixes;
+  for (const auto& tag : tag_data) {
+    for (const Address::CidrRange& range : tag.second) {
+      ASSERT(range.isValid());
+      const uint32_t length = range.length();
+      if (range.ip()->version() == Address::IpVersion::v4) {
+        ipv4_prefixes.push_back({toIpType(*range.ip()->ipv4()), length, {tag.first}, NO_PARENT});
+      } else {
+        ipv6_prefixes.push_back({toIpType(*range.ip()->ipv6()), length, {tag.first}, NO_PARENT});
+      }
+    }
+  }
+
+  ipv4_trie_.reset(new LcTrieInternal<uint32_t>(std::move(ipv4_prefixes)));
+  ipv6_trie_.reset(new LcTrieInternal<absl::uint128>(std::move(ipv6_prefixes)));
+}
+
+const std::vector<std::string>& LcTrie::getTags(const Address::Instance& address) const {
+  if (address.type() != Address::Type::Ip) {
+    return NO_TAGS;
+  }
+
+  const std::vector<std::string>* tags;
+  if (address.ip()->version() == Address::IpVersion::v4) {
+    tags = ipv4_trie_->getTags(toIpType(*address.ip()->ipv4()));
+  } else {
+    tags = ipv6_trie_->getTags(toIpType(*address.ip()->ipv6()));
+  }
+  return tags != nullptr ? *tags : NO_TAGS;
+}
+
+uint32_t LcTrie::toIpType(const Address::Ipv4& ipv4) { return ntohl(ipv4.address()); }
+
+absl::uint128 LcTrie::toIpType(const Address::Ipv6& ipv6) {
+  // The bytes are in network order, so the first one is the high order byte.
+  const std::array<uint8_t, 16> bytes = ipv6.address();
+  uint64_t high = 0;
+  uint64_t low = 0;
+  for (size_t i = 0; i < 8; i++) {
+    high = (high << 8) | bytes[i];
+    low = (low << 8) | bytes[i + 8];
+  }
+  return absl::MakeUint128(high, low);
+}
+
+} // namespace LcTrie
+} // namespace Network
+} // namespace Envoy
@@ -0,0 +1,273 @@
+#pragma once
+
+#include <algorithm>
+#include <climits>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "envoy/network/address.h"
+
+#include "common/common/assert.h"
+#include "common/network/cidr_range.h"
+
+#include "absl/numeric/int128.h"
+
+namespace Envoy {
+namespace Network {
+namespace LcTrie {
+
+/**
+ * Level-compressed trie of CIDR ranges, which finds the ranges that contain an address in time
+ * O(log log n) on average for n ranges. See S. Nilsson and G. Karlsson, "IP-address lookup using
+ * LC-tries", IEEE Journal on Selected Areas in Communications 17(6), 1999.
+ *
+ * Each range carries tags, and a lookup returns the tags of all the ranges that contain an address.
+ * The trie is immutable once built, so lookups from any number of threads need no locking.
+ */
+class LcTrie {
+public:
+  /**
+   * @param tag_data supplies each tag with its ranges. Ranges may be nested, and the same range
+   *        may come with several tags.
+   */
+  LcTrie(const std::vector<std::pair<std::string, std::vector<Address::CidrRange>>>& tag_data);
+
+  /**
+   * @param address supplies the address to look up.
+   * @return the tags of all the ranges that contain the address, sorted and without duplicates.
+   *         Empty if there are none or the address is not an IP address.
+   */
+  const std::vector<std::string>& getTags(const Address::Instance& address) const;
+
+private:
+  /**
+   * A range of the trie, with the tags of the range and of all the ranges that contain it.
+   */
+  template <class IpType> struct IpPrefix {
+    IpType ip_;
+    uint32_t length_;
+    std::vector<std::string> tags_;
+    // The index of the longest range that contains this one, or NO_PARENT.
+    uint32_t parent_;
+  };
+
+  /**
+   * The trie of the ranges of one IP version. IpType is an unsigned integer holding an address in
+   * host byte order, whose high order bit is the first bit of the address.
+   *
+   * The trie is built over the ranges that contain no other range, which are prefix free as the
+   * algorithm requires. The ranges that contain others are reached from those through the
+   * parent_ links: a lookup walks the trie to the one candidate range, and then from the
+   * candidate up through the ranges that contain it until one contains the address.
+   *
+   * Nodes only branch on bits where every combination of values is present among their ranges.
+   * This "fill factor" of one means no node has an empty child. As a result, each range that
+   * contains the address either is the candidate or contains it.
+   */
+  template <class IpType, uint32_t address_size = CHAR_BIT * sizeof(IpType)>
+  class LcTrieInternal {
+  public:
+    LcTrieInternal(std::vector<IpPrefix<IpType>>&& prefixes);
+
+    /**
+     * @return the tags of the ranges that contain the address, or nullptr if there are none.
+     */
+    const std::vector<std::string>* getTags(const IpType& ip) const;
+
+  private:
+    /**
+     * A node of the trie. An inner node has 2^branch_ children from trie_[address_] on, which
+     * follow each other in the order of the branch_ bits they stand for. The skip_ bits before
+     * those are the same for all the ranges under the node. A leaf has a branch_ of 0, and
+     * address_ is the index of its range in leaves_.
+     */
+    struct Node {
+      uint8_t branch_;
+      uint8_t skip_;
+      uint32_t address_;
+    };
+
+    static bool contains(const IpPrefix<IpType>& prefix, const IpType& ip, uint32_t length) {
+      return prefix.length_ <= length &&
+             (prefix.length_ == 0 || ((prefix.ip_ ^ ip) >> (address_size - prefix.length_)) == 0);
+    }
+
+    static uint32_t extractBits(const IpType& ip, uint32_t position, uint32_t bits) {
+      ASSERT(bits > 0 && position + bits <= address_size);
+      return static_cast<uint32_t>((ip << position) >> (address_size - bits));
+    }
+
+    const IpType& leafIp(uint32_t leaf) const { return prefixes_[leaves_[leaf]].ip_; }
+    uint32_t countPatterns(uint32_t first, uint32_t count, uint32_t position, uint32_t bits) const;
+    void build(uint32_t first, uint32_t count, uint32_t position, uint32_t node, uint32_t& next);
+
+    std::vector<IpPrefix<IpType>> prefixes_;
+    // The indices in prefixes_ of the ranges that contain no other range, sorted.
+    std::vector<uint32_t> leaves_;
+    std::vector<Node> trie_;
+  };
+
+  static constexpr uint32_t NO_PARENT = UINT32_MAX;
+
+  static uint32_t commonPrefixLength(uint32_t x, uint32_t y) {
+    return x == y ? 32 : __builtin_clz(x ^ y);
+  }
+  static uint32_t commonPrefixLength(const absl::uint128& x, const absl::uint128& y) {
+    const absl::uint128 difference = x ^ y;
+    if (absl::Uint128High64(difference) != 0) {
+      return __builtin_clzll(absl::Uint128High64(difference));
+    }
+    if (absl::Uint128Low64(difference) != 0) {
+      return 64 + __builtin_clzll(absl::Uint128Low64(difference));
+    }
+    return 128;
+  }
+
+  static uint32_t toIpType(const Address::Ipv4& ipv4);
+  static absl::uint128 toIpType(const Address::Ipv6& ipv6);
+
+  std::unique_ptr<LcTrieInternal<uint32_t>> ipv4_trie_;
+  std::unique_ptr<LcTrieInternal<absl::uint128>> ipv6_trie_;
+};
+
+template <class IpType, uint32_t address_size>
+LcTrie::LcTrieInternal<IpType, address_size>::LcTrieInternal(
+    std::vector<IpPrefix<IpType>>&& prefixes) {
+  // Sorting by address and then length puts each range right before the ranges it contains.
+  std::sort(prefixes.begin(), prefixes.end(),
+            [](const IpPrefix<IpType>& lhs, const IpPrefix<IpType>& rhs) {
+              return lhs.ip_ < rhs.ip_ || (lhs.ip_ == rhs.ip_ && lhs.length_ < rhs.length_);
+            });
+  for (IpPrefix<IpType>& prefix : prefixes) {
+    if (!prefixes_.empty() && prefixes_.back().ip_ == prefix.ip_ &&
+        prefixes_.back().length_ == prefix.length_) {
+      prefixes_.back().tags_.insert(prefixes_.back().tags_.end(), prefix.tags_.begin(),
+                                    prefix.tags_.end());
+    } else {
+      prefixes_.emplace_back(std::move(prefix));
+    }
+  }
+
+  // Link each range to the longest range that contains it, with a stack of the ranges that
+  // contain the current one, and give it the tags of that range.
+  std::vector<uint32_t> enclosing;
+  std::vector<bool> has_children(prefixes_.size());
+  for (uint32_t i = 0; i < prefixes_.size(); i++) {
+    IpPrefix<IpType>& prefix = prefixes_[i];
+    while (!enclosing.empty() &&
+           !contains(prefixes_[enclosing.back()], prefix.ip_, prefix.length_)) {
+      enclosing.pop_back();
+    }
+
+    prefix.parent_ = NO_PARENT;
+    if (!enclosing.empty()) {
+      prefix.parent_ = enclosing.back();
+      has_children[prefix.parent_] = true;
+      const std::vector<std::string>& parent_tags = prefixes_[prefix.parent_].tags_;
+      prefix.tags_.insert(prefix.tags_.end(), parent_tags.begin(), parent_tags.end());
+    }
+    std::sort(prefix.tags_.begin(), prefix.tags_.end());
+    prefix.tags_.erase(std::unique(prefix.tags_.begin(), prefix.tags_.end()), prefix.tags_.end());
+    enclosing.push_back(i);
+  }
+
+  for (uint32_t i = 0; i < prefixes_.size(); i++) {
+    if (!has_children[i]) {
+      leaves_.push_back(i);
+    }
+  }
+  if (leaves_.empty()) {
+    return;
+  }
+
+  trie_.resize(1);
+  uint32_t next = 1;
+  build(0, leaves_.size(), 0, 0, next);
+}
+
+template <class IpType, uint32_t address_size>
+uint32_t LcTrie::LcTrieInternal<IpType, address_size>::countPatterns(uint32_t first,
+                                                                     uint32_t count,
+                                                                     uint32_t position,
+                                                                     uint32_t bits) const {
+  // The leaves are sorted, so equal patterns are next to each other.
+  uint32_t patterns = 1;
+  for (uint32_t leaf = first + 1; leaf < first + count; leaf++) {
+    if (extractBits(leafIp(leaf), position, bits) !=
+        extractBits(leafIp(leaf - 1), position, bits)) {
+      patterns++;
+    }
+  }
+  return patterns;
+}
+
+template <class IpType, uint32_t address_size>
+void LcTrie::LcTrieInternal<IpType, address_size>::build(uint32_t first, uint32_t count,
+                                                         uint32_t position, uint32_t node,
+                                                         uint32_t& next) {
+  if (count == 1) {
+    trie_[node] = {0, 0, first};
+    return;
+  }
+
+  // The leaves are sorted, so the bits that the first and last leaf share are shared by all. The
+  // leaves are prefix free, so those bits are fewer than the length of any of them.
+  const uint32_t common = commonPrefixLength(leafIp(first), leafIp(first + count - 1));
+  ASSERT(common >= position && common < address_size);
+
+  // The first bit after the common ones has both values, and every further bit is added while
+  // all the combinations of values are still present.
+  uint32_t branch = 1;
+  while (common + branch < address_size && (uint64_t(1) << (branch + 1)) <= count &&
+         countPatterns(first, count, common, branch + 1) == (uint32_t(1) << (branch + 1))) {
+    branch++;
+  }
+
+  const uint32_t children = next;
+  next += uint32_t(1) << branch;
+  trie_.resize(next);
+  trie_[node] = {static_cast<uint8_t>(branch), static_cast<uint8_t>(common - position), children};
+
+  uint32_t child_first = first;
+  for (uint32_t pattern = 0; pattern < (uint32_t(1) << branch); pattern++) {
+    uint32_t child_count = 0;
+    while (child_first + child_count < first + count &&
+           extractBits(leafIp(child_first + child_count), common, branch) == pattern) {
+      child_count++;
+    }
+    ASSERT(child_count > 0);
+    build(child_first, child_count, common + branch, children + pattern, next);
+    child_first += child_count;
+  }
+}
+
+template <class IpType, uint32_t address_size>
+const std::vector<std::string>*
+LcTrie::LcTrieInternal<IpType, address_size>::getTags(const IpType& ip) const {
+  if (trie_.empty()) {
+    return nullptr;
+  }
+
+  Node node = trie_[0];
+  uint32_t position = node.skip_;
+  while (node.branch_ != 0) {
+    const uint32_t branch = node.branch_;
+    node = trie_[node.address_ + extractBits(ip, position, branch)];
+    position += branch + node.skip_;
+  }
+
+  for (uint32_t index = leaves_[node.address_]; index != NO_PARENT;
+       index = prefixes_[index].parent_) {
+    if (contains(prefixes_[index], ip, address_size)) {
+      return &prefixes_[index].tags_;
+    }
+  }
+  return nullptr;
+}
+
+} // namespace LcTrie
+} // namespace Network
+} // namespace Envoy
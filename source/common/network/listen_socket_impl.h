@@ -39,7 +39,12 @@ protected:
  */
 class TcpListenSocket : public ListenSocketImpl {
 public:
-  TcpListenSocket(Address::InstanceConstSharedPtr address, bool bind_to_port);
+  /**
+   * @param reuse_port supplies whether to set SO_REUSEPORT before binding, so that other sockets
+   *        with the option set can bind to the same address and share its connections.
+   */
+  TcpListenSocket(Address::InstanceConstSharedPtr address, bool bind_to_port,
+                  bool reuse_port = false);
   TcpListenSocket(int fd, Address::InstanceConstSharedPtr address);
 };
 
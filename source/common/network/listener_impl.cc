@@ -1,10 +1,17 @@
 #include "common/network/listener_impl.h"
 
+#include <fcntl.h>
+#include <sys/socket.h>
 #include <sys/un.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <cstdint>
 
 #include "envoy/common/exception.h"
 #include "envoy/network/connection_handler.h"
 
+#include "common/common/assert.h"
 #include "common/common/empty_string.h"
 #include "common/event/dispatcher_impl.h"
 #include "common/event/file_event_impl.h"
@@ -13,7 +20,6 @@
 #include "common/network/utility.h"
 #include "common/ssl/connection_impl.h"
 
-#include "event2/listener.h"
 #include "fmt/format.h"
 
 namespace Envoy {
@@ -27,9 +33,45 @@ Address::InstanceConstSharedPtr ListenerImpl::getOriginalDst(int fd) {
   return Utility::getOriginalDst(fd);
 }
 
-void ListenerImpl::listenCallback(evconnlistener*, evutil_socket_t fd, sockaddr* remote_addr,
-                                  int remote_addr_len, void* arg) {
-  ListenerImpl* listener = static_cast<ListenerImpl*>(arg);
+void ListenerImpl::onSocketEvent() {
+  uint32_t accepted = 0;
+  while (accepted < accept_batch_size_) {
+    sockaddr_storage remote_addr;
+    socklen_t remote_addr_len = sizeof(remote_addr);
+#if defined(__APPLE__)
+    int fd = ::accept(socket_.fd(), reinterpret_cast<sockaddr*>(&remote_addr), &remote_addr_len);
+    if (fd != -1) {
+      // accept4() is not available, and the new socket does not inherit O_NONBLOCK.
+      RELEASE_ASSERT(fcntl(fd, F_SETFL, O_NONBLOCK) != -1);
+    }
+#else
+    int fd = ::accept4(socket_.fd(), reinterpret_cast<sockaddr*>(&remote_addr), &remote_addr_len,
+                       SOCK_NONBLOCK);
+#endif
+    if (fd == -1) {
+      if (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR || errno == ECONNABORTED) {
+        break;
+      }
+      // We should never get any other error. This can happen if we run out of FDs or memory. In
+      // those cases just crash.
+      PANIC(fmt::format("listener accept failure: {}", strerror(errno)));
+    }
+
+    accepted++;
+    onAccept(fd, remote_addr, remote_addr_len);
+  }
+
+  if (accepted > 0) {
+    accept_stats_.downstream_cx_accept_batch_size_.recordValue(accepted);
+  }
+  if (accepted == accept_batch_size_) {
+    accept_stats_.downstream_cx_accept_batch_full_.inc();
+  }
+}
+
+void ListenerImpl::onAccept(int fd, const sockaddr_storage& remote_addr,
+                            socklen_t remote_addr_len) {
+  ListenerImpl* listener = this;
   Address::InstanceConstSharedPtr final_local_address = listener->socket_.localAddress();
   bool using_original_dst = false;
 
@@ -63,51 +105,90 @@ void ListenerImpl::listenCallback(evconnlistener*, evutil_socket_t fd, sockaddr*
     }
   }
 
-  if (listener->options_.use_proxy_proto_) {
-    listener->proxy_protocol_.newConnection(listener->dispatcher_, fd, *listener);
+  Address::InstanceConstSharedPtr final_remote_address;
+  if (remote_addr.ss_family == AF_UNIX) {
+    // The accept() call that filled in remote_addr doesn't fill in more than the sa_family field
+    // for Unix domain sockets; apparently there isn't a mechanism in the kernel to get the
+    // sockaddr_un associated with the client socket when starting from the server socket.
+    // We work around this by using our own name for the socket in this case.
+    final_remote_address = Address::peerAddressFromFd(fd);
+  } else {
+    final_remote_address = Address::addressFromSockAddr(remote_addr, remote_addr_len);
+  }
+
+  // The PROXY protocol header is read by the listener that ends up accepting the connection, so
+  // the connection is balanced before that.
+  ConnectionBalancer* balancer = listener->options_.connection_balancer_;
+  if (balancer != nullptr &&
+      balancer->balanceConnection(*listener, fd, final_remote_address, final_local_address,
+                                  using_original_dst)) {
+    return;
+  }
+
+  listener->acceptConnection(fd, final_remote_address, final_local_address, using_original_dst);
+}
+
+void ListenerImpl::acceptConnection(int fd, Address::InstanceConstSharedPtr remote_address,
+                                    Address::InstanceConstSharedPtr local_address,
+                                    bool using_original_dst) {
+  if (options_.use_proxy_proto_) {
+    proxy_protocol_.newConnection(dispatcher_, fd, *this);
   } else {
-    Address::InstanceConstSharedPtr final_remote_address;
-    if (remote_addr->sa_family == AF_UNIX) {
-      // The accept() call that filled in remote_addr doesn't fill in more than the sa_family field
-      // for Unix domain sockets; apparently there isn't a mechanism in the kernel to get the
-      // sockaddr_un associated with the client socket when starting from the server socket.
-      // We work around this by using our own name for the socket in this case.
-      final_remote_address = Address::peerAddressFromFd(fd);
-    } else {
-      final_remote_address = Address::addressFromSockAddr(
-          *reinterpret_cast<const sockaddr_storage*>(remote_addr), remote_addr_len);
-    }
     // TODO(jamessynge): We need to keep per-family stats. BUT, should it be based on the original
     // family or the local family? Probably local family, as the original proxy can take care of
     // stats for the original family.
-    listener->newConnection(fd, final_remote_address, final_local_address, using_original_dst);
+    newConnection(fd, remote_address, local_address, using_original_dst);
   }
 }
 
+void ListenerImpl::post(int fd, Address::InstanceConstSharedPtr remote_address,
+                        Address::InstanceConstSharedPtr local_address, bool using_original_dst) {
+  num_posted_connections_++;
+  std::shared_ptr<bool> alive = alive_;
+  dispatcher_.post([this, alive, fd, remote_address, local_address, using_original_dst]() -> void {
+    // The listener may have been destroyed after the connection was posted, on this thread.
+    if (!*alive) {
+      ::close(fd);
+      return;
+    }
+    num_posted_connections_--;
+    acceptConnection(fd, remote_address, local_address, using_original_dst);
+  });
+}
+
 ListenerImpl::ListenerImpl(Network::ConnectionHandler& conn_handler,
                            Event::DispatcherImpl& dispatcher, ListenSocket& socket,
                            ListenerCallbacks& cb, Stats::Scope& scope,
                            const Network::ListenerOptions& listener_options)
     : connection_handler_(conn_handler), dispatcher_(dispatcher), socket_(socket), cb_(cb),
-      proxy_protocol_(scope), options_(listener_options), listener_(nullptr) {
+      proxy_protocol_(scope), options_(listener_options),
+      accept_batch_size_(listener_options.accept_batch_size_),
+      accept_stats_{ALL_LISTENER_ACCEPT_STATS(POOL_COUNTER(scope), POOL_HISTOGRAM(scope))} {
+  if (accept_batch_size_ == 0) {
+    accept_batch_size_ = DEFAULT_ACCEPT_BATCH_SIZE;
+  }
 
   if (options_.bind_to_port_) {
-    listener_.reset(
-        evconnlistener_new(&dispatcher_.base(), listenCallback, this, 0, -1, socket.fd()));
-
-    if (!listener_) {
+    if (::listen(socket.fd(), 128) == -1) {
       throw CreateListenerException(
           fmt::format("cannot listen on socket: {}", socket.localAddress()->asString()));
     }
 
-    evconnlistener_set_error_cb(listener_.get(), errorCallback);
+    file_event_ = dispatcher_.createFileEvent(socket.fd(), [this](uint32_t) { onSocketEvent(); },
+                                              Event::FileTriggerType::Level,
+                                              Event::FileReadyType::Read);
+  }
+
+  if (options_.connection_balancer_ != nullptr) {
+    options_.connection_balancer_->registerHandler(*this);
   }
 }
 
-void ListenerImpl::errorCallback(evconnlistener*, void*) {
-  // We should never get an error callback. This can happen if we run out of FDs or memory. In those
-  // cases just crash.
-  PANIC(fmt::format("listener accept failure: {}", strerror(errno)));
+ListenerImpl::~ListenerImpl() {
+  if (options_.connection_balancer_ != nullptr) {
+    options_.connection_balancer_->unregisterHandler(*this);
+  }
+  *alive_ = false;
 }
 
 void ListenerImpl::newConnection(int fd, Address::InstanceConstSharedPtr remote_address,
@@ -1,26 +1,46 @@
 #pragma once
 
+#include <atomic>
+#include <memory>
+
+#include "envoy/event/file_event.h"
 #include "envoy/network/connection_handler.h"
 #include "envoy/network/listener.h"
+#include "envoy/stats/stats_macros.h"
 
 #include "common/event/dispatcher_impl.h"
-#include "common/event/libevent.h"
 #include "common/network/listen_socket_impl.h"
 #include "common/network/proxy_protocol.h"
 
-#include "event2/event.h"
-
 namespace Envoy {
 namespace Network {
 
 /**
- * libevent implementation of Network::Listener.
+ * All stats for accepting the connections of a listener. @see stats_macros.h
+ */
+// clang-format off
+#define ALL_LISTENER_ACCEPT_STATS(COUNTER, HISTOGRAM)                                              \
+  COUNTER  (downstream_cx_accept_batch_full)                                                       \
+  HISTOGRAM(downstream_cx_accept_batch_size)
+// clang-format on
+
+/**
+ * Definition of all stats for accepting the connections of a listener. @see stats_macros.h
  */
-class ListenerImpl : public Listener {
+struct ListenerAcceptStats {
+  ALL_LISTENER_ACCEPT_STATS(GENERATE_COUNTER_STRUCT, GENERATE_HISTOGRAM_STRUCT)
+};
+
+/**
+ * libevent implementation of Network::Listener. If the listener takes part in a connection
+ * balancer, the connections it accepts may be handed over to the listener of another worker.
+ */
+class ListenerImpl : public Listener, public BalancedConnectionHandler {
 public:
   ListenerImpl(Network::ConnectionHandler& conn_handler, Event::DispatcherImpl& dispatcher,
                ListenSocket& socket, ListenerCallbacks& cb, Stats::Scope& scope,
                const ListenerOptions& listener_options);
+  ~ListenerImpl();
 
   /**
    * Accept/process a new connection.
@@ -37,6 +57,17 @@ public:
    */
   ListenSocket& socket() { return socket_; }
 
+  // The number of connections a listener accepts each time its socket is ready, unless the options
+  // of the listener give another.
+  static const uint32_t DEFAULT_ACCEPT_BATCH_SIZE = 16;
+
+  // Network::BalancedConnectionHandler
+  uint64_t numConnections() override {
+    return connection_handler_.numConnections() + num_posted_connections_;
+  }
+  void post(int fd, Address::InstanceConstSharedPtr remote_address,
+            Address::InstanceConstSharedPtr local_address, bool using_original_dst) override;
+
 protected:
   virtual Address::InstanceConstSharedPtr getLocalAddress(int fd);
   virtual Address::InstanceConstSharedPtr getOriginalDst(int fd);
@@ -49,11 +80,31 @@ protected:
   const ListenerOptions options_;
 
 private:
-  static void errorCallback(evconnlistener* listener, void* context);
-  static void listenCallback(evconnlistener*, evutil_socket_t fd, sockaddr* remote_addr,
-                             int remote_addr_len, void* arg);
+  /**
+   * Accept the connections queued on the socket, up to the accept batch size. The socket is level
+   * triggered, so the connections left over are accepted on the next iteration of the event loop.
+   */
+  void onSocketEvent();
+
+  /**
+   * Hand a connection accepted on the socket to the listener that processes it.
+   */
+  void onAccept(int fd, const sockaddr_storage& remote_addr, socklen_t remote_addr_len);
+
+  /**
+   * Accept a connection on this listener, reading the PROXY protocol header first if needed.
+   */
+  void acceptConnection(int fd, Address::InstanceConstSharedPtr remote_address,
+                        Address::InstanceConstSharedPtr local_address, bool using_original_dst);
 
-  Event::Libevent::ListenerPtr listener_;
+  Event::FileEventPtr file_event_;
+  uint32_t accept_batch_size_;
+  ListenerAcceptStats accept_stats_;
+  // The connections posted to this listener that it did not accept yet.
+  std::atomic<uint64_t> num_posted_connections_{};
+  // Cleared when the listener is destroyed, so that the connections posted to it that are still
+  // queued on its dispatcher get closed.
+  std::shared_ptr<bool> alive_{std::make_shared<bool>(true)};
 };
 
 class SslListenerImpl : public ListenerImpl {
@@ -1,8 +1,12 @@
 #include "common/network/proxy_protocol.h"
 
+#include <netinet/in.h>
+#include <sys/socket.h>
 #include <unistd.h>
 
+#include <algorithm>
 #include <cstdint>
+#include <cstring>
 #include <memory>
 #include <string>
 
@@ -20,6 +24,31 @@
 namespace Envoy {
 namespace Network {
 
+namespace {
+
+// The first bytes of a V2 header, which can not start a V1 line.
+const uint8_t PROXY_PROTO_V2_SIGNATURE[] = {0x0D, 0x0A, 0x0D, 0x0A, 0x00, 0x0D,
+                                            0x0A, 0x51, 0x55, 0x49, 0x54, 0x0A};
+const size_t PROXY_PROTO_V2_SIGNATURE_LEN = sizeof(PROXY_PROTO_V2_SIGNATURE);
+
+const uint8_t PROXY_PROTO_V2_VERSION = 0x2;
+const uint8_t PROXY_PROTO_V2_LOCAL = 0x0;
+const uint8_t PROXY_PROTO_V2_PROXY = 0x1;
+const uint8_t PROXY_PROTO_V2_AF_INET = 0x1;
+const uint8_t PROXY_PROTO_V2_AF_INET6 = 0x2;
+const uint8_t PROXY_PROTO_V2_STREAM = 0x1;
+
+// The addresses and ports of the families.
+const size_t PROXY_PROTO_V2_ADDR_LEN_INET = 12;
+const size_t PROXY_PROTO_V2_ADDR_LEN_INET6 = 36;
+
+// The type and length of a TLV.
+const size_t PROXY_PROTO_V2_TLV_HEADER_LEN = 3;
+
+uint16_t readUint16(const uint8_t* buf) { return (uint16_t(buf[0]) << 8) | buf[1]; }
+
+} // namespace
+
 ProxyProtocol::ProxyProtocol(Stats::Scope& scope)
     : stats_{ALL_PROXY_PROTOCOL_STATS(POOL_COUNTER(scope))} {}
 
@@ -58,6 +87,136 @@ void ProxyProtocol::ActiveConnection::onRead() {
 }
 
 void ProxyProtocol::ActiveConnection::onReadWorker() {
+  if (version_ == 0 && !readVersion(fd_)) {
+    return;
+  }
+  if (version_ == 1) {
+    onReadV1();
+  } else {
+    onReadV2();
+  }
+}
+
+bool ProxyProtocol::ActiveConnection::readVersion(int fd) {
+  uint8_t header[PROXY_PROTO_V2_HEADER_LEN];
+  const ssize_t nread = recv(fd, header, PROXY_PROTO_V2_HEADER_LEN, MSG_PEEK);
+  if (nread == -1 && errno == EAGAIN) {
+    return false;
+  } else if (nread < 1) {
+    throw EnvoyException("failed to read proxy protocol");
+  }
+
+  if (header[0] != PROXY_PROTO_V2_SIGNATURE[0]) {
+    version_ = 1;
+    return true;
+  }
+  if (memcmp(header, PROXY_PROTO_V2_SIGNATURE,
+             std::min<size_t>(nread, PROXY_PROTO_V2_SIGNATURE_LEN)) != 0) {
+    throw EnvoyException("failed to read proxy protocol");
+  }
+  if (size_t(nread) < PROXY_PROTO_V2_HEADER_LEN) {
+    return false;
+  }
+  if ((header[12] >> 4) != PROXY_PROTO_V2_VERSION) {
+    throw EnvoyException("failed to read proxy protocol");
+  }
+
+  // The whole header is read at once from now on, as its length is known.
+  version_ = 2;
+  v2_buf_.resize(PROXY_PROTO_V2_HEADER_LEN + readUint16(header + 14));
+  return true;
+}
+
+void ProxyProtocol::ActiveConnection::onReadV2() {
+  while (v2_off_ < v2_buf_.size()) {
+    const ssize_t nread = recv(fd_, v2_buf_.data() + v2_off_, v2_buf_.size() - v2_off_, 0);
+    if (nread == -1 && errno == EAGAIN) {
+      return;
+    } else if (nread < 1) {
+      throw EnvoyException("failed to read proxy protocol");
+    }
+    v2_off_ += nread;
+  }
+
+  const uint8_t command = v2_buf_[12] & 0xF;
+  const uint8_t family = v2_buf_[13] >> 4;
+  const uint8_t transport = v2_buf_[13] & 0xF;
+  const size_t len = v2_buf_.size() - PROXY_PROTO_V2_HEADER_LEN;
+  const uint8_t* addr = v2_buf_.data() + PROXY_PROTO_V2_HEADER_LEN;
+  if (command != PROXY_PROTO_V2_LOCAL && command != PROXY_PROTO_V2_PROXY) {
+    throw EnvoyException("failed to read proxy protocol");
+  }
+
+  Address::InstanceConstSharedPtr remote_address;
+  Address::InstanceConstSharedPtr local_address;
+  size_t addr_len = 0;
+  if (command == PROXY_PROTO_V2_PROXY && family == PROXY_PROTO_V2_AF_INET) {
+    addr_len = PROXY_PROTO_V2_ADDR_LEN_INET;
+    if (transport != PROXY_PROTO_V2_STREAM || len < addr_len) {
+      throw EnvoyException("failed to read proxy protocol");
+    }
+    sockaddr_in remote;
+    sockaddr_in local;
+    memset(&remote, 0, sizeof(remote));
+    memset(&local, 0, sizeof(local));
+    remote.sin_family = AF_INET;
+    local.sin_family = AF_INET;
+    // Addresses and ports are in network byte order.
+    memcpy(&remote.sin_addr, addr, 4);
+    memcpy(&local.sin_addr, addr + 4, 4);
+    memcpy(&remote.sin_port, addr + 8, 2);
+    memcpy(&local.sin_port, addr + 10, 2);
+    remote_address = std::make_shared<Address::Ipv4Instance>(&remote);
+    local_address = std::make_shared<Address::Ipv4Instance>(&local);
+  } else if (command == PROXY_PROTO_V2_PROXY && family == PROXY_PROTO_V2_AF_INET6) {
+    addr_len = PROXY_PROTO_V2_ADDR_LEN_INET6;
+    if (transport != PROXY_PROTO_V2_STREAM || len < addr_len) {
+      throw EnvoyException("failed to read proxy protocol");
+    }
+    sockaddr_in6 remote;
+    sockaddr_in6 local;
+    memset(&remote, 0, sizeof(remote));
+    memset(&local, 0, sizeof(local));
+    remote.sin6_family = AF_INET6;
+    local.sin6_family = AF_INET6;
+    memcpy(&remote.sin6_addr, addr, 16);
+    memcpy(&local.sin6_addr, addr + 16, 16);
+    memcpy(&remote.sin6_port, addr + 32, 2);
+    memcpy(&local.sin6_port, addr + 34, 2);
+    remote_address = std::make_shared<Address::Ipv6Instance>(remote);
+    local_address = std::make_shared<Address::Ipv6Instance>(local);
+  } else {
+    // Health checks of the proxy, and families the connection can not take the addresses of, keep
+    // the addresses of the connection. Their address block is skipped.
+    addr_len = len;
+    remote_address = Address::peerAddressFromFd(fd_);
+    local_address = Address::addressFromFd(fd_);
+  }
+
+  if (command == PROXY_PROTO_V2_PROXY && (!remote_address->ip()->isUnicastAddress() ||
+                                          !local_address->ip()->isUnicastAddress())) {
+    throw EnvoyException("failed to read proxy protocol");
+  }
+
+  // The TLVs that follow the addresses carry no information that the connection takes, but they
+  // must fill the rest of the header.
+  size_t off = addr_len;
+  while (off < len) {
+    if (len - off < PROXY_PROTO_V2_TLV_HEADER_LEN) {
+      throw EnvoyException("failed to read proxy protocol");
+    }
+    const size_t tlv_len = readUint16(addr + off + 1);
+    off += PROXY_PROTO_V2_TLV_HEADER_LEN;
+    if (len - off < tlv_len) {
+      throw EnvoyException("failed to read proxy protocol");
+    }
+    off += tlv_len;
+  }
+
+  finishConnection(remote_address, local_address);
+}
+
+void ProxyProtocol::ActiveConnection::onReadV1() {
   std::string proxy_line;
   if (!readLine(fd_, proxy_line)) {
     return;
@@ -1,8 +1,10 @@
 #pragma once
 
+#include <cstdint>
 #include <list>
 #include <memory>
 #include <string>
+#include <vector>
 
 #include "envoy/event/dispatcher.h"
 #include "envoy/stats/stats_macros.h"
@@ -30,8 +32,8 @@ struct ProxyProtocolStats {
 };
 
 /**
- * Implementation the PROXY Protocol V1
- * (http://www.haproxy.org/download/1.5/doc/proxy-protocol.txt)
+ * Implementation the PROXY Protocol V1 and V2
+ * (http://www.haproxy.org/download/1.8/doc/proxy-protocol.txt)
  */
 class ProxyProtocol {
 public:
@@ -43,9 +45,21 @@ public:
 
   private:
     static const size_t MAX_PROXY_PROTO_LEN = 108;
+    // The signature, version and command, family and length of a V2 header.
+    static const size_t PROXY_PROTO_V2_HEADER_LEN = 16;
 
     void onRead();
     void onReadWorker();
+    void onReadV1();
+    void onReadV2();
+
+    /**
+     * Helper function that peeks at the fixed part of the header to tell the version of the
+     * protocol, and the length of a V2 header.
+     * throws EnvoyException on any socket errors or if the header matches neither version.
+     * @return bool true if the version is known, false if more data is needed.
+     */
+    bool readVersion(int fd);
 
     /**
      * Helper function that attempts to read a line (delimited by '\r\n') from the socket.
@@ -74,6 +88,13 @@ public:
 
     // Stores the portion of the first line that has been read so far.
     char buf_[MAX_PROXY_PROTO_LEN];
+
+    // The version of the protocol, or 0 until the first bytes show it.
+    uint32_t version_{};
+
+    // The V2 header including its addresses and TLVs, and how much of it has been read.
+    std::vector<uint8_t> v2_buf_;
+    size_t v2_off_{};
   };
 
   ProxyProtocol(Stats::Scope& scope);
@@ -1,11 +1,17 @@
 #include "common/network/raw_buffer_socket.h"
 
+#include <algorithm>
+
 #include "common/common/empty_string.h"
 #include "common/http/headers.h"
 
 namespace Envoy {
 namespace Network {
 
+constexpr uint64_t RawBufferSocket::MIN_READ_SIZE;
+constexpr uint64_t RawBufferSocket::INITIAL_READ_SIZE;
+constexpr uint64_t RawBufferSocket::MAX_READ_SIZE;
+
 void RawBufferSocket::setTransportSocketCallbacks(TransportSocketCallbacks& callbacks) {
   callbacks_ = &callbacks;
 }
@@ -13,13 +19,10 @@ void RawBufferSocket::setTransportSocketCallbacks(TransportSocketCallbacks& call
 IoResult RawBufferSocket::doRead(Buffer::Instance& buffer) {
   PostIoAction action = PostIoAction::KeepOpen;
   uint64_t bytes_read = 0;
+  // The buffer limit may have been set or lowered since the read size was last adjusted.
+  read_size_ = std::min(read_size_, maxReadSize());
   do {
-    // 16K read is arbitrary. IIRC, libevent will currently clamp this to 4K. libevent will also
-    // use an ioctl() before every read to figure out how much data there is to read.
-    //
-    // TODO(mattklein123) PERF: Tune the read size and figure out a way of getting rid of the
-    // ioctl(). The extra syscall is not worth it.
-    int rc = buffer.read(callbacks_->fd(), 16384);
+    int rc = buffer.read(callbacks_->fd(), read_size_);
     ENVOY_CONN_LOG(trace, "read returns: {}", callbacks_->connection(), rc);
 
     // Remote close. Might need to raise data before raising close.
@@ -36,6 +39,7 @@ IoResult RawBufferSocket::doRead(Buffer::Instance& buffer) {
       break;
     } else {
       bytes_read += rc;
+      adjustReadSize(rc);
       if (callbacks_->shouldDrainReadBuffer()) {
         callbacks_->setReadBufferReady();
         break;
@@ -46,14 +50,32 @@ IoResult RawBufferSocket::doRead(Buffer::Instance& buffer) {
   return {action, bytes_read};
 }
 
+uint64_t RawBufferSocket::maxReadSize() const {
+  const uint32_t buffer_limit = callbacks_->connection().bufferLimit();
+  if (buffer_limit > 0) {
+    return std::max(MIN_READ_SIZE, std::min<uint64_t>(MAX_READ_SIZE, buffer_limit));
+  }
+  return MAX_READ_SIZE;
+}
+
+void RawBufferSocket::adjustReadSize(uint64_t bytes_read) {
+  if (bytes_read >= read_size_) {
+    read_size_ = std::min(read_size_ * 2, maxReadSize());
+  } else if (bytes_read <= read_size_ / 4) {
+    read_size_ = std::max(MIN_READ_SIZE, read_size_ / 2);
+  }
+}
+
 IoResult RawBufferSocket::doWrite(Buffer::Instance& buffer) {
   PostIoAction action;
   uint64_t bytes_written = 0;
   do {
-    if (buffer.length() == 0) {
+    const uint64_t bytes_to_write = buffer.length();
+    if (bytes_to_write == 0) {
       action = PostIoAction::KeepOpen;
       break;
     }
+    const bool single_write = buffer.getRawSlices(nullptr, 0) <= Buffer::Instance::MaxWriteSlices;
     int rc = buffer.write(callbacks_->fd());
     ENVOY_CONN_LOG(trace, "write returns: {}", callbacks_->connection(), rc);
     if (rc == -1) {
@@ -67,6 +89,14 @@ IoResult RawBufferSocket::doWrite(Buffer::Instance& buffer) {
       break;
     } else {
       bytes_written += rc;
+      if (single_write && static_cast<uint64_t>(rc) < bytes_to_write) {
+        // The whole buffer was offered to the kernel in one call and only part of it was
+        // accepted, so the socket send buffer is full. Trying again now would only cost another
+        // syscall returning EAGAIN. The kernel has flagged the socket as out of space and will
+        // raise a write event once there is room again.
+        action = PostIoAction::KeepOpen;
+        break;
+      }
     }
   } while (true);
 
@@ -4,12 +4,27 @@
 #include "envoy/network/transport_socket.h"
 
 #include "common/common/logger.h"
+#include "common/common/object_pool.h"
 
 namespace Envoy {
 namespace Network {
 
-class RawBufferSocket : public TransportSocket, protected Logger::Loggable<Logger::Id::connection> {
+/**
+ * A TransportSocket that reads and writes the connection's file descriptor directly.
+ *
+ * The amount read per syscall adapts to the connection. It doubles, up to MAX_READ_SIZE, each time
+ * a read fills it, so bulk transfers need fewer syscalls. It halves, down to MIN_READ_SIZE, each
+ * time a read uses a quarter of it or less, so connections exchanging small messages do not pin
+ * large read buffers. When the connection has a buffer limit, the read size never exceeds it.
+ */
+class RawBufferSocket : public TransportSocket,
+                        public PooledObject,
+                        protected Logger::Loggable<Logger::Id::connection> {
 public:
+  static constexpr uint64_t MIN_READ_SIZE = 4096;
+  static constexpr uint64_t INITIAL_READ_SIZE = 16384;
+  static constexpr uint64_t MAX_READ_SIZE = 65536;
+
   // Network::TransportSocket
   void setTransportSocketCallbacks(TransportSocketCallbacks& callbacks) override;
   std::string protocol() const override;
@@ -21,8 +36,14 @@ public:
   Ssl::Connection* ssl() override { return nullptr; }
   const Ssl::Connection* ssl() const override { return nullptr; }
 
+  uint64_t readSizeForTest() const { return read_size_; }
+
 private:
+  uint64_t maxReadSize() const;
+  void adjustReadSize(uint64_t bytes_read);
+
   TransportSocketCallbacks* callbacks_{};
+  uint64_t read_size_{INITIAL_READ_SIZE};
 };
 
 class RawBufferSocketFactory : public TransportSocketFactory {
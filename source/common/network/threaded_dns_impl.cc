@@ -0,0 +1,153 @@
+#include "common/network/threaded_dns_impl.h"
+
+#include <list>
+#include <memory>
+#include <string>
+
+#include "common/common/assert.h"
+
+namespace Envoy {
+namespace Network {
+
+ThreadedDnsResolverImpl::ThreadedDnsResolverImpl(Event::Dispatcher& dispatcher,
+                                                 uint32_t max_concurrent_queries,
+                                                 ResolverFactory resolver_factory)
+    : dispatcher_(dispatcher), max_concurrent_queries_(max_concurrent_queries),
+      resolver_(resolver_factory(thread_.dispatcher())) {}
+
+ThreadedDnsResolverImpl::~ThreadedDnsResolverImpl() { shutdown(); }
+
+ThreadedDnsResolverImpl::ResolverFactory ThreadedDnsResolverImpl::defaultResolverFactory() {
+  return [](Event::Dispatcher& dispatcher) -> DnsResolverSharedPtr {
+    return dispatcher.createDnsResolver({});
+  };
+}
+
+void ThreadedDnsResolverImpl::start(Server::GuardDog& guard_dog) {
+  ASSERT(!started_ && !shut_down_);
+  started_ = true;
+  thread_.start(guard_dog);
+}
+
+void ThreadedDnsResolverImpl::shutdown() {
+  if (shut_down_) {
+    return;
+  }
+  shut_down_ = true;
+  if (!started_) {
+    // The thread never ran, so the resolver was never used on it.
+    resolver_.reset();
+    return;
+  }
+  // The resolver owns events of the dispatcher of the thread, which is destroyed as the thread
+  // exits. Posted callbacks run before the thread exits.
+  thread_.dispatcher().post([this]() -> void {
+    queued_queries_.clear();
+    resolver_.reset();
+  });
+  thread_.exit();
+}
+
+ActiveDnsQuery* ThreadedDnsResolverImpl::resolve(const std::string& dns_name,
+                                                 DnsLookupFamily dns_lookup_family,
+                                                 ResolveCb callback) {
+  QuerySharedPtr query = std::make_shared<Query>(*this, dns_name, dns_lookup_family, callback);
+  if (!shut_down_) {
+    thread_.dispatcher().post([this, query]() -> void { startQuery(query); });
+  }
+  // The query is kept alive by the callbacks that refer to it until it is cancelled or completes.
+  return query.get();
+}
+
+void ThreadedDnsResolverImpl::initializeStats(Stats::Scope& scope, const std::string& prefix) {
+  ASSERT(!started_);
+  stats_.reset(new ThreadedDnsResolverStats{ALL_THREADED_DNS_RESOLVER_STATS(
+      POOL_COUNTER_PREFIX(scope, prefix), POOL_GAUGE_PREFIX(scope, prefix))});
+  resolver_->initializeStats(scope, prefix);
+}
+
+void ThreadedDnsResolverImpl::Query::cancel() {
+  cancelled_ = true;
+  if (!parent_.shut_down_) {
+    QuerySharedPtr query = shared_from_this();
+    parent_.thread_.dispatcher().post([query]() -> void { query->parent_.cancelQuery(query); });
+  }
+}
+
+void ThreadedDnsResolverImpl::startQuery(QuerySharedPtr query) {
+  if (query->cancelled_) {
+    return;
+  }
+  if (max_concurrent_queries_ > 0 && active_queries_ >= max_concurrent_queries_) {
+    query->queued_ = true;
+    queued_queries_.push_back(query);
+    if (stats_ != nullptr) {
+      stats_->throttled_.inc();
+      stats_->queued_.inc();
+    }
+    return;
+  }
+
+  ++active_queries_;
+  if (stats_ != nullptr) {
+    stats_->active_.inc();
+  }
+  // The query is answered synchronously if the resolver returns nullptr.
+  ActiveDnsQuery* active_query = resolver_->resolve(
+      query->dns_name_, query->dns_lookup_family_,
+      [this, query](std::list<Address::InstanceConstSharedPtr>&& results) -> void {
+        query->active_query_ = nullptr;
+        onQueryComplete(query, std::move(results));
+      });
+  if (active_query != nullptr) {
+    query->active_query_ = active_query;
+  }
+}
+
+void ThreadedDnsResolverImpl::onQueryComplete(
+    QuerySharedPtr query, std::list<Address::InstanceConstSharedPtr>&& results) {
+  --active_queries_;
+  if (stats_ != nullptr) {
+    stats_->active_.dec();
+  }
+  dispatcher_.post([query, results = std::move(results)]() mutable -> void {
+    if (!query->cancelled_) {
+      query->callback_(std::move(results));
+    }
+  });
+  startQueued();
+}
+
+void ThreadedDnsResolverImpl::cancelQuery(QuerySharedPtr query) {
+  if (query->queued_) {
+    query->queued_ = false;
+    queued_queries_.remove(query);
+    if (stats_ != nullptr) {
+      stats_->queued_.dec();
+    }
+  } else if (query->active_query_ != nullptr) {
+    query->active_query_->cancel();
+    query->active_query_ = nullptr;
+    --active_queries_;
+    if (stats_ != nullptr) {
+      stats_->active_.dec();
+    }
+    startQueued();
+  }
+}
+
+void ThreadedDnsResolverImpl::startQueued() {
+  while (!queued_queries_.empty() &&
+         (max_concurrent_queries_ == 0 || active_queries_ < max_concurrent_queries_)) {
+    QuerySharedPtr query = queued_queries_.front();
+    queued_queries_.pop_front();
+    query->queued_ = false;
+    if (stats_ != nullptr) {
+      stats_->queued_.dec();
+    }
+    startQuery(query);
+  }
+}
+
+} // namespace Network
+} // namespace Envoy
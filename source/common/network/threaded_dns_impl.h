@@ -0,0 +1,125 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <list>
+#include <memory>
+#include <string>
+
+#include "envoy/event/dispatcher.h"
+#include "envoy/network/dns.h"
+#include "envoy/server/guarddog.h"
+#include "envoy/stats/stats.h"
+#include "envoy/stats/stats_macros.h"
+
+#include "common/event/dispatched_thread.h"
+
+namespace Envoy {
+namespace Network {
+
+// clang-format off
+#define ALL_THREADED_DNS_RESOLVER_STATS(COUNTER, GAUGE)                                            \
+  COUNTER(throttled)                                                                               \
+  GAUGE(active)                                                                                    \
+  GAUGE(queued)
+// clang-format on
+
+/**
+ * Struct definition for all threaded DNS resolver stats. @see stats_macros.h
+ */
+struct ThreadedDnsResolverStats {
+  ALL_THREADED_DNS_RESOLVER_STATS(GENERATE_COUNTER_STRUCT, GENERATE_GAUGE_STRUCT)
+};
+
+/**
+ * DnsResolver that resolves names with a resolver that runs on a dedicated dispatched thread, so
+ * that the sockets and the answers of the queries are not handled by the dispatcher of the
+ * callers. The callbacks are posted back to that dispatcher. Queries beyond a limit of concurrent
+ * queries wait in a queue on the thread. All calls and callbacks happen on the thread of the
+ * dispatcher of the callers.
+ */
+class ThreadedDnsResolverImpl : public DnsResolver {
+public:
+  /**
+   * Creates the resolver of the thread on the dispatcher of the thread.
+   */
+  typedef std::function<DnsResolverSharedPtr(Event::Dispatcher& dispatcher)> ResolverFactory;
+
+  /**
+   * @param dispatcher supplies the dispatcher the callbacks are posted to.
+   * @param max_concurrent_queries supplies the maximum number of queries that are resolved at
+   *        once, or 0 for no limit.
+   * @param resolver_factory supplies the factory of the resolver of the thread.
+   */
+  ThreadedDnsResolverImpl(Event::Dispatcher& dispatcher, uint32_t max_concurrent_queries,
+                          ResolverFactory resolver_factory = defaultResolverFactory());
+  ~ThreadedDnsResolverImpl();
+
+  /**
+   * Start the thread. Queries that were made before wait until it runs.
+   * @param guard_dog supplies the GuardDog that watches the thread.
+   */
+  void start(Server::GuardDog& guard_dog);
+
+  /**
+   * Destroy the resolver of the thread and join the thread. Must be called before the GuardDog the
+   * thread was started with is destroyed. Callbacks of queries that did not complete are never
+   * invoked.
+   */
+  void shutdown();
+
+  // Network::DnsResolver
+  ActiveDnsQuery* resolve(const std::string& dns_name, DnsLookupFamily dns_lookup_family,
+                          ResolveCb callback) override;
+  // Must be called before start().
+  void initializeStats(Stats::Scope& scope, const std::string& prefix) override;
+
+private:
+  struct Query;
+  typedef std::shared_ptr<Query> QuerySharedPtr;
+
+  struct Query : public ActiveDnsQuery, public std::enable_shared_from_this<Query> {
+    Query(ThreadedDnsResolverImpl& parent, const std::string& dns_name,
+          DnsLookupFamily dns_lookup_family, ResolveCb callback)
+        : parent_(parent), dns_name_(dns_name), dns_lookup_family_(dns_lookup_family),
+          callback_(callback) {}
+
+    // Network::ActiveDnsQuery
+    void cancel() override;
+
+    ThreadedDnsResolverImpl& parent_;
+    const std::string dns_name_;
+    const DnsLookupFamily dns_lookup_family_;
+    const ResolveCb callback_;
+    std::atomic<bool> cancelled_{};
+    // The following are only accessed on the thread. Whether the query waits in the queue, and
+    // the query of the resolver of the thread while it is resolved.
+    bool queued_{};
+    ActiveDnsQuery* active_query_{};
+  };
+
+  static ResolverFactory defaultResolverFactory();
+
+  // Called on the thread.
+  void startQuery(QuerySharedPtr query);
+  void onQueryComplete(QuerySharedPtr query, std::list<Address::InstanceConstSharedPtr>&& results);
+  void cancelQuery(QuerySharedPtr query);
+  void startQueued();
+
+  Event::Dispatcher& dispatcher_;
+  const uint32_t max_concurrent_queries_;
+  Event::DispatchedThreadImpl thread_;
+  DnsResolverSharedPtr resolver_;
+  bool started_{};
+  bool shut_down_{};
+  // The following are only accessed on the thread.
+  uint32_t active_queries_{};
+  std::list<QuerySharedPtr> queued_queries_;
+  std::unique_ptr<ThreadedDnsResolverStats> stats_;
+};
+
+typedef std::shared_ptr<ThreadedDnsResolverImpl> ThreadedDnsResolverImplSharedPtr;
+
+} // namespace Network
+} // namespace Envoy
@@ -8,8 +8,10 @@
 #endif
 
 #include <netinet/ip.h>
+#include <netinet/tcp.h>
 #include <sys/socket.h>
 
+#include <cerrno>
 #include <cstdint>
 #include <list>
 #include <sstream>
@@ -341,5 +343,47 @@ bool Utility::portInRangeList(const Address::Instance& address, const std::list<
   return false;
 }
 
+bool Utility::setTcpFastOpen(int fd, uint32_t queue_length) {
+  const int value = queue_length;
+  return setsockopt(fd, IPPROTO_TCP, TCP_FASTOPEN, &value, sizeof(value)) == 0;
+}
+
+bool Utility::setTcpDeferAccept(int fd, uint32_t timeout_seconds) {
+#ifdef TCP_DEFER_ACCEPT
+  const int value = timeout_seconds;
+  return setsockopt(fd, IPPROTO_TCP, TCP_DEFER_ACCEPT, &value, sizeof(value)) == 0;
+#else
+  UNREFERENCED_PARAMETER(fd);
+  UNREFERENCED_PARAMETER(timeout_seconds);
+  errno = ENOPROTOOPT;
+  return false;
+#endif
+}
+
+bool Utility::setTcpFastOpenConnect(int fd) {
+#ifdef TCP_FASTOPEN_CONNECT
+  const int value = 1;
+  return setsockopt(fd, IPPROTO_TCP, TCP_FASTOPEN_CONNECT, &value, sizeof(value)) == 0;
+#else
+  // The kernel headers predate TCP_FASTOPEN_CONNECT (Linux 4.11), and other platforms have no
+  // equivalent that works with a plain connect().
+  UNREFERENCED_PARAMETER(fd);
+  errno = ENOPROTOOPT;
+  return false;
+#endif
+}
+
+bool Utility::setIncomingCpu(int fd, uint32_t cpu) {
+#ifdef SO_INCOMING_CPU
+  const int value = cpu;
+  return setsockopt(fd, SOL_SOCKET, SO_INCOMING_CPU, &value, sizeof(value)) == 0;
+#else
+  UNREFERENCED_PARAMETER(fd);
+  UNREFERENCED_PARAMETER(cpu);
+  errno = ENOPROTOOPT;
+  return false;
+#endif
+}
+
 } // namespace Network
 } // namespace Envoy
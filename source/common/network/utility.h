@@ -186,6 +186,41 @@ public:
    */
   static bool portInRangeList(const Address::Instance& address, const std::list<PortRange>& list);
 
+  /**
+   * Enable TCP Fast Open on a listen socket, so that clients with a TFO cookie can send data in
+   * their SYN and have it processed before the handshake completes.
+   * @param fd supplies the listen socket.
+   * @param queue_length supplies the maximum number of pending TFO connection requests.
+   * @return bool whether the option was set. errno is set if it was not.
+   */
+  static bool setTcpFastOpen(int fd, uint32_t queue_length);
+
+  /**
+   * Have the kernel hold the connections of a listen socket back from accept() until their first
+   * data arrives.
+   * @param fd supplies the listen socket.
+   * @param timeout_seconds supplies how long the kernel waits for the first data of a connection.
+   * @return bool whether the option was set. errno is set if it was not.
+   */
+  static bool setTcpDeferAccept(int fd, uint32_t timeout_seconds);
+
+  /**
+   * Enable TCP Fast Open on a client socket before it connects, so that the first data written to
+   * the socket is sent in the SYN if the kernel has a TFO cookie for the remote host.
+   * @param fd supplies the client socket.
+   * @return bool whether the option was set. errno is set if it was not.
+   */
+  static bool setTcpFastOpenConnect(int fd);
+
+  /**
+   * Have the kernel prefer a SO_REUSEPORT listen socket for the connections whose packets are
+   * received on a CPU, so that a worker pinned to the CPU accepts them.
+   * @param fd supplies the listen socket.
+   * @param cpu supplies the CPU.
+   * @return bool whether the option was set. errno is set if it was not.
+   */
+  static bool setIncomingCpu(int fd, uint32_t cpu);
+
 private:
   static void throwWithMalformedIp(const std::string& ip_address);
 };
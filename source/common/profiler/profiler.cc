@@ -1,10 +1,14 @@
 #include "common/profiler/profiler.h"
 
+#include <unistd.h>
+
+#include <cstdio>
 #include <string>
 
 #ifdef TCMALLOC
 
 #include "gperftools/heap-profiler.h"
+#include "gperftools/malloc_extension.h"
 #include "gperftools/profiler.h"
 
 namespace Envoy {
@@ -18,6 +22,11 @@ bool Cpu::startProfiler(const std::string& output_path) {
 
 void Cpu::stopProfiler() { ProfilerStop(); }
 
+bool Heap::sampledProfile(std::string& profile) {
+  MallocExtension::instance()->GetHeapSample(&profile);
+  return true;
+}
+
 void Heap::forceLink() {
   // Currently this is here to force the inclusion of the heap profiler during static linking.
   // Without this call the heap profiler will not be included and cannot be started via env
@@ -36,8 +45,52 @@ namespace Profiler {
 bool Cpu::profilerEnabled() { return false; }
 bool Cpu::startProfiler(const std::string&) { return false; }
 void Cpu::stopProfiler() {}
+bool Heap::sampledProfile(std::string&) { return false; }
 
 } // namespace Profiler
 } // namespace Envoy
 
 #endif // #ifdef TCMALLOC
+
+namespace Envoy {
+namespace Profiler {
+
+CpuWindows::CpuWindows(const std::string& path_prefix, uint32_t max_windows)
+    : path_prefix_(path_prefix), current_path_(path_prefix + ".current"),
+      max_windows_(max_windows) {}
+
+CpuWindows::~CpuWindows() {
+  stop();
+  for (const std::string& window : windows_) {
+    ::unlink(window.c_str());
+  }
+}
+
+void CpuWindows::rotate() {
+  stop();
+  if (!Cpu::profilerEnabled()) {
+    running_ = Cpu::startProfiler(current_path_);
+  }
+}
+
+void CpuWindows::stop() {
+  if (!running_) {
+    return;
+  }
+
+  Cpu::stopProfiler();
+  running_ = false;
+  const std::string window = path_prefix_ + "." + std::to_string(next_window_++);
+  if (::rename(current_path_.c_str(), window.c_str()) != 0) {
+    return;
+  }
+
+  windows_.push_front(window);
+  while (windows_.size() > max_windows_) {
+    ::unlink(windows_.back().c_str());
+    windows_.pop_back();
+  }
+}
+
+} // namespace Profiler
+} // namespace Envoy
@@ -1,5 +1,7 @@
 #pragma once
 
+#include <cstdint>
+#include <deque>
 #include <string>
 
 namespace Envoy {
@@ -27,10 +29,58 @@ public:
   static void stopProfiler();
 };
 
+/**
+ * Continuous CPU profiling in rolling windows. Each window is a profile of its own, so that the
+ * profile of a past incident can be retrieved after the fact. The sampling frequency is the one
+ * of the profiler, which the CPUPROFILE_FREQUENCY environment variable sets.
+ */
+class CpuWindows {
+public:
+  /**
+   * @param path_prefix supplies the prefix of the paths the windows are written to.
+   * @param max_windows supplies the number of complete windows that are kept.
+   */
+  CpuWindows(const std::string& path_prefix, uint32_t max_windows);
+  ~CpuWindows();
+
+  /**
+   * Complete the current window, if any, and start profiling the next one. No window is started
+   * while the profiler is run by someone else, e.g. the /cpuprofiler admin endpoint.
+   */
+  void rotate();
+
+  /**
+   * Complete the current window, if any, without starting another one.
+   */
+  void stop();
+
+  /**
+   * @return const std::deque<std::string>& the paths of the complete windows, most recent first.
+   */
+  const std::deque<std::string>& windows() const { return windows_; }
+
+private:
+  const std::string path_prefix_;
+  const std::string current_path_;
+  const uint32_t max_windows_;
+  std::deque<std::string> windows_;
+  uint64_t next_window_{};
+  bool running_{};
+};
+
 /**
  * Process wide heap profiling
  */
 class Heap {
+public:
+  /**
+   * Retrieve a profile of the allocations that tcmalloc samples, one every
+   * TCMALLOC_SAMPLE_PARAMETER bytes on average per the environment variable, that are still live.
+   * @param profile supplies the string to write the profile to, in the pprof heap format.
+   * @return bool whether the profile was retrieved.
+   */
+  static bool sampledProfile(std::string& profile);
+
 private:
   static void forceLink();
 };
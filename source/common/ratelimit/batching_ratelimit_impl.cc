@@ -0,0 +1,108 @@
+#include "common/ratelimit/batching_ratelimit_impl.h"
+
+#include <chrono>
+#include <cstdint>
+#include <limits>
+#include <string>
+#include <vector>
+
+#include "common/common/assert.h"
+#include "common/tracing/http_tracer_impl.h"
+
+namespace Envoy {
+namespace RateLimit {
+
+BatchingFactoryImpl::BatchingFactoryImpl(RateLimitAsyncClientFactory async_client_factory,
+                                         OverLimitCacheSharedPtr cache,
+                                         std::chrono::milliseconds flush_interval,
+                                         ThreadLocal::SlotAllocator& tls, Stats::Scope& scope)
+    : shared_state_(
+          std::make_shared<SharedState>(async_client_factory, cache, flush_interval, scope)),
+      tls_slot_(tls.allocateSlot()) {
+  SharedStateSharedPtr shared_state = shared_state_;
+  tls_slot_->set([shared_state](Event::Dispatcher& dispatcher) {
+    return ThreadLocal::ThreadLocalObjectSharedPtr{
+        new ThreadLocalBatcher(shared_state, dispatcher)};
+  });
+}
+
+ClientPtr BatchingFactoryImpl::create(const Optional<std::chrono::milliseconds>&) {
+  return ClientPtr{new BatchingClientImpl(*this)};
+}
+
+void BatchingFactoryImpl::FlushRequest::onSuccess(
+    std::unique_ptr<pb::lyft::ratelimit::RateLimitResponse>&& response, Tracing::Span&) {
+  if (response->overall_code() == pb::lyft::ratelimit::RateLimitResponse_Code_OVER_LIMIT) {
+    parent_.shared_state_->cache_->insert(key_);
+  }
+  parent_.in_flight_.erase(entry_);
+}
+
+void BatchingFactoryImpl::FlushRequest::onFailure(Grpc::Status::GrpcStatus, const std::string&,
+                                                  Tracing::Span&) {
+  // The hits are lost, which only makes the limiting more lenient.
+  parent_.shared_state_->stats_.rpc_error_.inc();
+  parent_.in_flight_.erase(entry_);
+}
+
+BatchingFactoryImpl::ThreadLocalBatcher::ThreadLocalBatcher(
+    const SharedStateSharedPtr& shared_state, Event::Dispatcher& dispatcher)
+    : shared_state_(shared_state), flush_timer_(dispatcher.createTimer([this]() { flush(); })),
+      async_client_(shared_state->async_client_factory_()) {}
+
+void BatchingFactoryImpl::ThreadLocalBatcher::addHits(const std::string& domain,
+                                                      const std::vector<Descriptor>& descriptors) {
+  // The timer only runs while there are hits to send, so that idle workers do not wake up.
+  if (pending_.empty()) {
+    flush_timer_->enableTimer(shared_state_->flush_interval_);
+  }
+
+  for (const Descriptor& descriptor : descriptors) {
+    PendingHits& pending = pending_[descriptorKey(domain, descriptor.entries_)];
+    if (pending.hits_ == 0) {
+      pending.domain_ = domain;
+      pending.descriptor_ = descriptor;
+    }
+    if (pending.hits_ < std::numeric_limits<uint32_t>::max()) {
+      pending.hits_++;
+    }
+  }
+  shared_state_->stats_.hits_.inc();
+}
+
+void BatchingFactoryImpl::ThreadLocalBatcher::flush() {
+  for (const auto& pending : pending_) {
+    pb::lyft::ratelimit::RateLimitRequest request;
+    GrpcClientImpl::createRequest(request, pending.second.domain_, {pending.second.descriptor_});
+    request.set_hits_addend(pending.second.hits_);
+
+    in_flight_.emplace_front(new FlushRequest(*this, pending.first));
+    FlushRequest& flush_request = *in_flight_.front();
+    flush_request.entry_ = in_flight_.begin();
+    shared_state_->stats_.rpc_.inc();
+    // A call that fails to start calls onFailure() inline, which drops the flush request. A call
+    // that takes longer than the flush interval is stale, as the next flush has newer hits.
+    async_client_->send(shared_state_->service_method_, request, flush_request,
+                        Tracing::NullSpan::instance(),
+                        Optional<std::chrono::milliseconds>(shared_state_->flush_interval_));
+  }
+  pending_.clear();
+}
+
+void BatchingFactoryImpl::BatchingClientImpl::limit(RequestCallbacks& callbacks,
+                                                    const std::string& domain,
+                                                    const std::vector<Descriptor>& descriptors,
+                                                    Tracing::Span& parent_span) {
+  if (parent_.shared_state_->cache_->overLimit(domain, descriptors)) {
+    parent_span.setTag(Constants::get().TraceStatus, Constants::get().TraceOverLimit);
+    callbacks.complete(LimitStatus::OverLimit);
+    return;
+  }
+
+  parent_.tls_slot_->getTyped<ThreadLocalBatcher>().addHits(domain, descriptors);
+  parent_span.setTag(Constants::get().TraceStatus, Constants::get().TraceOk);
+  callbacks.complete(LimitStatus::OK);
+}
+
+} // namespace RateLimit
+} // namespace Envoy
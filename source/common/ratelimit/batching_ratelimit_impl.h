@@ -0,0 +1,145 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "envoy/event/dispatcher.h"
+#include "envoy/event/timer.h"
+#include "envoy/ratelimit/ratelimit.h"
+#include "envoy/stats/stats_macros.h"
+#include "envoy/thread_local/thread_local.h"
+
+#include "common/ratelimit/ratelimit_impl.h"
+
+namespace Envoy {
+namespace RateLimit {
+
+// clang-format off
+#define ALL_RATE_LIMIT_BATCH_STATS(COUNTER)                                                        \
+  COUNTER(hits)                                                                                    \
+  COUNTER(rpc)                                                                                     \
+  COUNTER(rpc_error)
+// clang-format on
+
+/**
+ * Struct definition for all rate limit batch stats. @see stats_macros.h
+ */
+struct RateLimitBatchStats {
+  ALL_RATE_LIMIT_BATCH_STATS(GENERATE_COUNTER_STRUCT)
+};
+
+/**
+ * Client factory for approximate rate limiting, whose clients decide requests without waiting on
+ * the rate limit service. Requests with a descriptor in the over limit cache are over limit and all
+ * others are allowed. Each worker adds up the hits of the allowed requests per descriptor and sends
+ * them to the service every flush interval, in one call per descriptor, and the descriptors that
+ * the service finds over limit are cached. Limits are thus enforced up to a flush interval late.
+ */
+class BatchingFactoryImpl : public ClientFactory {
+public:
+  /**
+   * @param async_client_factory supplies the gRPC clients of the rate limit service.
+   * @param cache supplies the over limit cache.
+   * @param flush_interval supplies how often each worker sends the hits it collected.
+   */
+  BatchingFactoryImpl(RateLimitAsyncClientFactory async_client_factory,
+                      OverLimitCacheSharedPtr cache, std::chrono::milliseconds flush_interval,
+                      ThreadLocal::SlotAllocator& tls, Stats::Scope& scope);
+
+  // RateLimit::ClientFactory
+  ClientPtr create(const Optional<std::chrono::milliseconds>& timeout) override;
+
+private:
+  /**
+   * Shared state that is owned by the per-thread batchers.
+   */
+  struct SharedState {
+    SharedState(RateLimitAsyncClientFactory async_client_factory, OverLimitCacheSharedPtr cache,
+                std::chrono::milliseconds flush_interval, Stats::Scope& scope)
+        : async_client_factory_(async_client_factory), cache_(cache),
+          flush_interval_(flush_interval),
+          stats_{ALL_RATE_LIMIT_BATCH_STATS(POOL_COUNTER_PREFIX(scope, "ratelimit.batch."))},
+          service_method_(*Protobuf::DescriptorPool::generated_pool()->FindMethodByName(
+              "pb.lyft.ratelimit.RateLimitService.ShouldRateLimit")) {}
+
+    const RateLimitAsyncClientFactory async_client_factory_;
+    OverLimitCacheSharedPtr cache_;
+    const std::chrono::milliseconds flush_interval_;
+    RateLimitBatchStats stats_;
+    const Protobuf::MethodDescriptor& service_method_;
+  };
+
+  typedef std::shared_ptr<SharedState> SharedStateSharedPtr;
+
+  struct ThreadLocalBatcher;
+
+  /**
+   * The hits of the allowed requests with a descriptor since the last flush.
+   */
+  struct PendingHits {
+    std::string domain_;
+    Descriptor descriptor_;
+    uint32_t hits_{};
+  };
+
+  /**
+   * A call to the rate limit service with the hits of a descriptor.
+   */
+  struct FlushRequest : public RateLimitAsyncCallbacks {
+    FlushRequest(ThreadLocalBatcher& parent, const std::string& key) : parent_(parent), key_(key) {}
+
+    // Grpc::AsyncRequestCallbacks
+    void onCreateInitialMetadata(Http::HeaderMap&) override {}
+    void onSuccess(std::unique_ptr<pb::lyft::ratelimit::RateLimitResponse>&& response,
+                   Tracing::Span& span) override;
+    void onFailure(Grpc::Status::GrpcStatus status, const std::string& message,
+                   Tracing::Span& span) override;
+
+    ThreadLocalBatcher& parent_;
+    const std::string key_;
+    std::list<std::unique_ptr<FlushRequest>>::iterator entry_;
+  };
+
+  /**
+   * Per-thread hits and calls in flight.
+   */
+  struct ThreadLocalBatcher : public ThreadLocal::ThreadLocalObject {
+    ThreadLocalBatcher(const SharedStateSharedPtr& shared_state, Event::Dispatcher& dispatcher);
+
+    void addHits(const std::string& domain, const std::vector<Descriptor>& descriptors);
+    void flush();
+
+    SharedStateSharedPtr shared_state_;
+    Event::TimerPtr flush_timer_;
+    std::unordered_map<std::string, PendingHits> pending_;
+    std::list<std::unique_ptr<FlushRequest>> in_flight_;
+    // Declared after the calls in flight so that it is destroyed first, which resets them without
+    // calling back.
+    RateLimitAsyncClientPtr async_client_;
+  };
+
+  class BatchingClientImpl : public Client {
+  public:
+    BatchingClientImpl(BatchingFactoryImpl& parent) : parent_(parent) {}
+
+    // RateLimit::Client
+    // Requests complete on the stack frame of limit(), so there is never one to cancel.
+    void cancel() override {}
+    void limit(RequestCallbacks& callbacks, const std::string& domain,
+               const std::vector<Descriptor>& descriptors, Tracing::Span& parent_span) override;
+
+  private:
+    BatchingFactoryImpl& parent_;
+  };
+
+  SharedStateSharedPtr shared_state_;
+  ThreadLocal::SlotPtr tls_slot_;
+};
+
+} // namespace RateLimit
+} // namespace Envoy
@@ -0,0 +1,109 @@
+#include "common/ratelimit/local_ratelimit_impl.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "common/common/assert.h"
+#include "common/json/config_schemas.h"
+#include "common/ratelimit/ratelimit_impl.h"
+
+#include "fmt/format.h"
+
+namespace Envoy {
+namespace RateLimit {
+
+TokenBucket::TokenBucket(double tokens_per_second, uint64_t max_tokens)
+    : interval_ns_(std::max<int64_t>(1, static_cast<int64_t>(1e9 / tokens_per_second))),
+      capacity_ns_(interval_ns_ * static_cast<int64_t>(max_tokens)), full_at_ns_(0) {}
+
+double TokenBucket::take(MonotonicTime now) {
+  const int64_t now_ns =
+      std::chrono::duration_cast<std::chrono::nanoseconds>(now.time_since_epoch()).count();
+  int64_t full_at_ns = full_at_ns_.load(std::memory_order_relaxed);
+  while (true) {
+    const int64_t new_full_at_ns = std::max(full_at_ns, now_ns) + interval_ns_;
+    const int64_t missing_ns = new_full_at_ns - now_ns;
+    if (missing_ns > capacity_ns_) {
+      return -1;
+    }
+    if (full_at_ns_.compare_exchange_weak(full_at_ns, new_full_at_ns, std::memory_order_relaxed)) {
+      return static_cast<double>(capacity_ns_ - missing_ns) / capacity_ns_;
+    }
+  }
+}
+
+LocalRateLimiter::LocalRateLimiter(const Json::Object& config, Stats::Scope& scope,
+                                   MonotonicTimeSource& time_source)
+    : stats_{ALL_LOCAL_RATE_LIMIT_STATS(POOL_COUNTER_PREFIX(scope, "ratelimit.local."))},
+      time_source_(time_source), near_limit_ratio_(config.getDouble("near_limit_ratio", 0.1)) {
+  config.validateSchema(Json::Schema::RATE_LIMIT_LOCAL_SCHEMA);
+
+  for (const Json::ObjectSharedPtr& limit : config.getObjectArray("limits", true)) {
+    const std::string domain = limit->getString("domain");
+    std::vector<DescriptorEntry> entries;
+    for (const Json::ObjectSharedPtr& entry : limit->getObjectArray("descriptor")) {
+      entries.push_back({entry->getString("key"), entry->getString("value")});
+    }
+
+    const std::string key = descriptorKey(domain, entries);
+    if (buckets_.count(key) != 0) {
+      throw EnvoyException(
+          fmt::format("duplicate local rate limit for a descriptor of domain '{}'", domain));
+    }
+    buckets_.emplace(key, std::unique_ptr<TokenBucket>{new TokenBucket(
+                              limit->getDouble("tokens_per_second"),
+                              limit->getInteger("max_tokens"))});
+  }
+}
+
+LocalRateLimiter::Result LocalRateLimiter::check(const std::string& domain,
+                                                 const std::vector<Descriptor>& descriptors) {
+  const MonotonicTime now = time_source_.currentTime();
+  Result result = Result::OK;
+  for (const Descriptor& descriptor : descriptors) {
+    auto bucket = buckets_.find(descriptorKey(domain, descriptor.entries_));
+    if (bucket == buckets_.end()) {
+      result = Result::Global;
+      continue;
+    }
+
+    const double left = bucket->second->take(now);
+    if (left < 0) {
+      stats_.over_limit_.inc();
+      return Result::OverLimit;
+    }
+    if (left < near_limit_ratio_) {
+      result = Result::Global;
+    }
+  }
+
+  if (result == Result::OK) {
+    stats_.ok_.inc();
+  } else {
+    stats_.global_.inc();
+  }
+  return result;
+}
+
+void LocalClientImpl::limit(RequestCallbacks& callbacks, const std::string& domain,
+                            const std::vector<Descriptor>& descriptors,
+                            Tracing::Span& parent_span) {
+  switch (limiter_->check(domain, descriptors)) {
+  case LocalRateLimiter::Result::OK:
+    callbacks.complete(LimitStatus::OK);
+    break;
+  case LocalRateLimiter::Result::OverLimit:
+    parent_span.setTag(Constants::get().TraceStatus, Constants::get().TraceOverLimit);
+    callbacks.complete(LimitStatus::OverLimit);
+    break;
+  case LocalRateLimiter::Result::Global:
+    client_->limit(callbacks, domain, descriptors, parent_span);
+    break;
+  }
+}
+
+} // namespace RateLimit
+} // namespace Envoy
@@ -0,0 +1,129 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "envoy/common/time.h"
+#include "envoy/json/json_object.h"
+#include "envoy/ratelimit/ratelimit.h"
+#include "envoy/stats/stats_macros.h"
+
+namespace Envoy {
+namespace RateLimit {
+
+// clang-format off
+#define ALL_LOCAL_RATE_LIMIT_STATS(COUNTER)                                                        \
+  COUNTER(ok)                                                                                      \
+  COUNTER(over_limit)                                                                              \
+  COUNTER(global)
+// clang-format on
+
+/**
+ * Struct definition for all local rate limit stats. @see stats_macros.h
+ */
+struct LocalRateLimitStats {
+  ALL_LOCAL_RATE_LIMIT_STATS(GENERATE_COUNTER_STRUCT)
+};
+
+/**
+ * Token bucket shared by all workers. The bucket is a single atomic, the time at which it is full
+ * again (the theoretical arrival time of the generic cell rate algorithm), so that tokens are taken
+ * without locks.
+ */
+class TokenBucket {
+public:
+  /**
+   * @param tokens_per_second supplies the rate at which the bucket refills.
+   * @param max_tokens supplies the size of the bucket, which starts full.
+   */
+  TokenBucket(double tokens_per_second, uint64_t max_tokens);
+
+  /**
+   * Take a token from the bucket.
+   * @param now supplies the current time.
+   * @return double the fraction of the bucket left after taking the token, or a negative value if
+   *         the bucket is empty, in which case no token is taken.
+   */
+  double take(MonotonicTime now);
+
+private:
+  const int64_t interval_ns_;
+  const int64_t capacity_ns_;
+  std::atomic<int64_t> full_at_ns_;
+};
+
+/**
+ * Decides rate limit requests locally where it can. Requests whose descriptors all have a local
+ * limit with plenty of tokens left are allowed, and requests for which any of those limits ran out
+ * are over limit. Other requests, with descriptors without a local limit or near one, are left to
+ * the global rate limit service.
+ */
+class LocalRateLimiter {
+public:
+  enum class Result { OK, OverLimit, Global };
+
+  /**
+   * @param config supplies the configuration. @see Json::Schema::RATE_LIMIT_LOCAL_SCHEMA.
+   */
+  LocalRateLimiter(const Json::Object& config, Stats::Scope& scope,
+                   MonotonicTimeSource& time_source);
+
+  /**
+   * Take a token for each descriptor of a request that has a local limit.
+   * @param domain supplies the rate limit domain.
+   * @param descriptors supplies the descriptors of the request.
+   * @return Result the local decision, or Result::Global if the global service decides.
+   */
+  Result check(const std::string& domain, const std::vector<Descriptor>& descriptors);
+
+private:
+  LocalRateLimitStats stats_;
+  MonotonicTimeSource& time_source_;
+  const double near_limit_ratio_;
+  // Buckets are only added by the constructor, so lookups need no lock.
+  std::unordered_map<std::string, std::unique_ptr<TokenBucket>> buckets_;
+};
+
+typedef std::shared_ptr<LocalRateLimiter> LocalRateLimiterSharedPtr;
+
+/**
+ * Client that asks a LocalRateLimiter first, and the wrapped client only for the requests that the
+ * limiter leaves to the global service. Local decisions complete on the stack frame of limit().
+ */
+class LocalClientImpl : public Client {
+public:
+  LocalClientImpl(LocalRateLimiterSharedPtr limiter, ClientPtr&& client)
+      : limiter_(limiter), client_(std::move(client)) {}
+
+  // RateLimit::Client
+  void cancel() override { client_->cancel(); }
+  void limit(RequestCallbacks& callbacks, const std::string& domain,
+             const std::vector<Descriptor>& descriptors, Tracing::Span& parent_span) override;
+
+private:
+  LocalRateLimiterSharedPtr limiter_;
+  ClientPtr client_;
+};
+
+class LocalFactoryImpl : public ClientFactory {
+public:
+  LocalFactoryImpl(LocalRateLimiterSharedPtr limiter, ClientFactoryPtr&& factory)
+      : limiter_(limiter), factory_(std::move(factory)) {}
+
+  // RateLimit::ClientFactory
+  ClientPtr create(const Optional<std::chrono::milliseconds>& timeout) override {
+    return ClientPtr{new LocalClientImpl(limiter_, factory_->create(timeout))};
+  }
+
+private:
+  LocalRateLimiterSharedPtr limiter_;
+  ClientFactoryPtr factory_;
+};
+
+} // namespace RateLimit
+} // namespace Envoy
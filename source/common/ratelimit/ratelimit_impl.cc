@@ -1,7 +1,9 @@
 #include "common/ratelimit/ratelimit_impl.h"
 
+#include <algorithm>
 #include <chrono>
 #include <cstdint>
+#include <mutex>
 #include <string>
 #include <vector>
 
@@ -14,11 +16,71 @@
 namespace Envoy {
 namespace RateLimit {
 
+const size_t OverLimitCache::MAX_ENTRIES = 16384;
+
+std::string descriptorKey(const std::string& domain, const std::vector<DescriptorEntry>& entries) {
+  // NUL separated, as it can not be part of the keys and values of descriptors.
+  std::string key = domain;
+  for (const DescriptorEntry& entry : entries) {
+    key.push_back('\0');
+    key.append(entry.key_);
+    key.push_back('\0');
+    key.append(entry.value_);
+  }
+  return key;
+}
+
+OverLimitCache::OverLimitCache(std::chrono::milliseconds ttl, Stats::Scope& scope,
+                               MonotonicTimeSource& time_source)
+    : stats_{ALL_OVER_LIMIT_CACHE_STATS(POOL_COUNTER_PREFIX(scope, "ratelimit.over_limit_cache."))},
+      ttl_(ttl), time_source_(time_source) {}
+
+bool OverLimitCache::overLimit(const std::string& domain,
+                               const std::vector<Descriptor>& descriptors) {
+  if (size_.load(std::memory_order_relaxed) == 0) {
+    return false;
+  }
+
+  const MonotonicTime now = time_source_.currentTime();
+  std::shared_lock<std::shared_timed_mutex> lock(mutex_);
+  for (const Descriptor& descriptor : descriptors) {
+    auto entry = expiry_times_.find(descriptorKey(domain, descriptor.entries_));
+    if (entry != expiry_times_.end() && entry->second > now) {
+      stats_.hit_.inc();
+      return true;
+    }
+  }
+  return false;
+}
+
+void OverLimitCache::insert(const std::string& key) {
+  const MonotonicTime now = time_source_.currentTime();
+  std::unique_lock<std::shared_timed_mutex> lock(mutex_);
+  if (expiry_times_.size() >= MAX_ENTRIES && expiry_times_.count(key) == 0) {
+    for (auto entry = expiry_times_.begin(); entry != expiry_times_.end();) {
+      if (entry->second <= now) {
+        entry = expiry_times_.erase(entry);
+      } else {
+        ++entry;
+      }
+    }
+    if (expiry_times_.size() >= MAX_ENTRIES) {
+      stats_.full_.inc();
+      return;
+    }
+  }
+
+  expiry_times_[key] = now + ttl_;
+  size_.store(expiry_times_.size(), std::memory_order_relaxed);
+  stats_.insert_.inc();
+}
+
 GrpcClientImpl::GrpcClientImpl(RateLimitAsyncClientPtr&& async_client,
-                               const Optional<std::chrono::milliseconds>& timeout)
+                               const Optional<std::chrono::milliseconds>& timeout,
+                               OverLimitCacheSharedPtr cache)
     : service_method_(*Protobuf::DescriptorPool::generated_pool()->FindMethodByName(
           "pb.lyft.ratelimit.RateLimitService.ShouldRateLimit")),
-      async_client_(std::move(async_client)), timeout_(timeout) {}
+      async_client_(std::move(async_client)), timeout_(timeout), cache_(cache) {}
 
 GrpcClientImpl::~GrpcClientImpl() { ASSERT(!callbacks_); }
 
@@ -45,6 +107,19 @@ void GrpcClientImpl::createRequest(pb::lyft::ratelimit::RateLimitRequest& reques
 void GrpcClientImpl::limit(RequestCallbacks& callbacks, const std::string& domain,
                            const std::vector<Descriptor>& descriptors, Tracing::Span& parent_span) {
   ASSERT(callbacks_ == nullptr);
+  if (cache_) {
+    if (cache_->overLimit(domain, descriptors)) {
+      parent_span.setTag(Constants::get().TraceStatus, Constants::get().TraceOverLimit);
+      callbacks.complete(LimitStatus::OverLimit);
+      return;
+    }
+
+    descriptor_keys_.clear();
+    for (const Descriptor& descriptor : descriptors) {
+      descriptor_keys_.push_back(descriptorKey(domain, descriptor.entries_));
+    }
+  }
+
   callbacks_ = &callbacks;
 
   pb::lyft::ratelimit::RateLimitRequest request;
@@ -60,6 +135,16 @@ void GrpcClientImpl::onSuccess(std::unique_ptr<pb::lyft::ratelimit::RateLimitRes
   if (response->overall_code() == pb::lyft::ratelimit::RateLimitResponse_Code_OVER_LIMIT) {
     status = LimitStatus::OverLimit;
     span.setTag(Constants::get().TraceStatus, Constants::get().TraceOverLimit);
+    if (cache_) {
+      // The statuses are in the order of the descriptors of the request.
+      const size_t statuses = std::min<size_t>(response->statuses_size(), descriptor_keys_.size());
+      for (size_t i = 0; i < statuses; i++) {
+        if (response->statuses(i).code() ==
+            pb::lyft::ratelimit::RateLimitResponse_Code_OVER_LIMIT) {
+          cache_->insert(descriptor_keys_[i]);
+        }
+      }
+    }
   } else {
     span.setTag(Constants::get().TraceStatus, Constants::get().TraceOk);
   }
@@ -77,19 +162,26 @@ void GrpcClientImpl::onFailure(Grpc::Status::GrpcStatus status, const std::strin
 }
 
 GrpcFactoryImpl::GrpcFactoryImpl(const envoy::api::v2::RateLimitServiceConfig& config,
-                                 Upstream::ClusterManager& cm)
-    : cluster_name_(config.cluster_name()), cm_(cm) {
-  if (!cm_.get(cluster_name_)) {
-    throw EnvoyException(fmt::format("unknown rate limit service cluster '{}'", cluster_name_));
+                                 Upstream::ClusterManager& cm, OverLimitCacheSharedPtr cache)
+    : async_client_factory_(asyncClientFactory(config, cm)), cache_(cache) {}
+
+RateLimitAsyncClientFactory
+GrpcFactoryImpl::asyncClientFactory(const envoy::api::v2::RateLimitServiceConfig& config,
+                                    Upstream::ClusterManager& cm) {
+  const std::string cluster_name = config.cluster_name();
+  if (!cm.get(cluster_name)) {
+    throw EnvoyException(fmt::format("unknown rate limit service cluster '{}'", cluster_name));
   }
+
+  return [&cm, cluster_name]() -> RateLimitAsyncClientPtr {
+    return RateLimitAsyncClientPtr{
+        new Grpc::AsyncClientImpl<pb::lyft::ratelimit::RateLimitRequest,
+                                  pb::lyft::ratelimit::RateLimitResponse>(cm, cluster_name)};
+  };
 }
 
 ClientPtr GrpcFactoryImpl::create(const Optional<std::chrono::milliseconds>& timeout) {
-  return ClientPtr{new GrpcClientImpl(
-      RateLimitAsyncClientPtr{
-          new Grpc::AsyncClientImpl<pb::lyft::ratelimit::RateLimitRequest,
-                                    pb::lyft::ratelimit::RateLimitResponse>(cm_, cluster_name_)},
-      timeout)};
+  return ClientPtr{new GrpcClientImpl(async_client_factory_(), timeout, cache_)};
 }
 
 } // namespace RateLimit
@@ -1,12 +1,19 @@
 #pragma once
 
+#include <atomic>
 #include <chrono>
 #include <cstdint>
+#include <functional>
+#include <memory>
+#include <shared_mutex>
 #include <string>
+#include <unordered_map>
 #include <vector>
 
+#include "envoy/common/time.h"
 #include "envoy/grpc/async_client.h"
 #include "envoy/ratelimit/ratelimit.h"
+#include "envoy/stats/stats_macros.h"
 #include "envoy/tracing/http_tracer.h"
 #include "envoy/upstream/cluster_manager.h"
 
@@ -26,6 +33,8 @@ typedef std::unique_ptr<RateLimitAsyncClient> RateLimitAsyncClientPtr;
 
 typedef Grpc::AsyncRequestCallbacks<pb::lyft::ratelimit::RateLimitResponse> RateLimitAsyncCallbacks;
 
+typedef std::function<RateLimitAsyncClientPtr()> RateLimitAsyncClientFactory;
+
 struct ConstantValues {
   const std::string TraceStatus = "ratelimit_status";
   const std::string TraceOverLimit = "over_limit";
@@ -34,13 +43,75 @@ struct ConstantValues {
 
 typedef ConstSingleton<ConstantValues> Constants;
 
+/**
+ * @return std::string a key that identifies a descriptor of a domain.
+ */
+std::string descriptorKey(const std::string& domain, const std::vector<DescriptorEntry>& entries);
+
+// clang-format off
+#define ALL_OVER_LIMIT_CACHE_STATS(COUNTER)                                                        \
+  COUNTER(hit)                                                                                     \
+  COUNTER(insert)                                                                                  \
+  COUNTER(full)
+// clang-format on
+
+/**
+ * Struct definition for all over limit cache stats. @see stats_macros.h
+ */
+struct OverLimitCacheStats {
+  ALL_OVER_LIMIT_CACHE_STATS(GENERATE_COUNTER_STRUCT)
+};
+
+/**
+ * Cache of the descriptors that the rate limit service found over limit, shared by all workers.
+ * Requests with a cached descriptor are over limit without calling the service until the entry
+ * expires, so that floods of over limit requests are rejected locally.
+ */
+class OverLimitCache {
+public:
+  /**
+   * @param ttl supplies how long descriptors stay cached.
+   */
+  OverLimitCache(std::chrono::milliseconds ttl, Stats::Scope& scope,
+                 MonotonicTimeSource& time_source);
+
+  /**
+   * @param domain supplies the rate limit domain.
+   * @param descriptors supplies the descriptors of a request.
+   * @return bool whether any of the descriptors is cached as over limit.
+   */
+  bool overLimit(const std::string& domain, const std::vector<Descriptor>& descriptors);
+
+  /**
+   * Cache a descriptor as over limit for the TTL of the cache.
+   * @param key supplies the key of the descriptor. @see descriptorKey().
+   */
+  void insert(const std::string& key);
+
+  // The most descriptors cached at once. Expired entries are dropped when the cache is full, and
+  // descriptors that do not fit then are not cached.
+  static const size_t MAX_ENTRIES;
+
+private:
+  OverLimitCacheStats stats_;
+  const std::chrono::milliseconds ttl_;
+  MonotonicTimeSource& time_source_;
+  // The number of entries, so that lookups skip the lock while nothing is over limit.
+  std::atomic<size_t> size_{};
+  std::shared_timed_mutex mutex_;
+  std::unordered_map<std::string, MonotonicTime> expiry_times_;
+};
+
+typedef std::shared_ptr<OverLimitCache> OverLimitCacheSharedPtr;
+
 // TODO(htuch): We should have only one client per thread, but today we create one per filter stack.
 // This will require support for more than one outstanding request per client (limit() assumes only
 // one today).
 class GrpcClientImpl : public Client, public RateLimitAsyncCallbacks {
 public:
   GrpcClientImpl(RateLimitAsyncClientPtr&& async_client,
-                 const Optional<std::chrono::milliseconds>& timeout);
+                 const Optional<std::chrono::milliseconds>& timeout,
+                 OverLimitCacheSharedPtr cache = nullptr);
   ~GrpcClientImpl();
 
   static void createRequest(pb::lyft::ratelimit::RateLimitRequest& request,
@@ -64,19 +135,33 @@ private:
   Grpc::AsyncRequest* request_{};
   Optional<std::chrono::milliseconds> timeout_;
   RequestCallbacks* callbacks_{};
+  OverLimitCacheSharedPtr cache_;
+  // The keys of the descriptors of the request in flight, when there is a cache to fill.
+  std::vector<std::string> descriptor_keys_;
 };
 
 class GrpcFactoryImpl : public ClientFactory {
 public:
+  /**
+   * @param cache supplies the over limit cache that the clients consult and fill, if any.
+   */
   GrpcFactoryImpl(const envoy::api::v2::RateLimitServiceConfig& config,
-                  Upstream::ClusterManager& cm);
+                  Upstream::ClusterManager& cm, OverLimitCacheSharedPtr cache = nullptr);
+
+  /**
+   * @return RateLimitAsyncClientFactory a factory of gRPC clients of the rate limit service.
+   * @throw EnvoyException if the cluster of the service does not exist.
+   */
+  static RateLimitAsyncClientFactory
+  asyncClientFactory(const envoy::api::v2::RateLimitServiceConfig& config,
+                     Upstream::ClusterManager& cm);
 
   // RateLimit::ClientFactory
   ClientPtr create(const Optional<std::chrono::milliseconds>& timeout) override;
 
 private:
-  const std::string cluster_name_;
-  Upstream::ClusterManager& cm_;
+  const RateLimitAsyncClientFactory async_client_factory_;
+  OverLimitCacheSharedPtr cache_;
 };
 
 class NullClientImpl : public Client {
@@ -0,0 +1,165 @@
+#include "common/redis/cluster_slots.h"
+
+#include <array>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "common/common/utility.h"
+
+#include "fmt/format.h"
+
+namespace Envoy {
+namespace Redis {
+
+namespace {
+
+// CRC16 with the XMODEM parameters (polynomial 0x1021, initial value 0), as Redis Cluster uses.
+std::array<uint16_t, 256> makeCrc16Table() {
+  std::array<uint16_t, 256> table;
+  for (uint32_t i = 0; i < table.size(); i++) {
+    uint16_t crc = i << 8;
+    for (uint32_t bit = 0; bit < 8; bit++) {
+      crc = (crc & 0x8000) ? (crc << 1) ^ 0x1021 : crc << 1;
+    }
+    table[i] = crc;
+  }
+  return table;
+}
+
+uint16_t crc16(const char* data, size_t size) {
+  static const std::array<uint16_t, 256> table = makeCrc16Table();
+  uint16_t crc = 0;
+  for (size_t i = 0; i < size; i++) {
+    crc = (crc << 8) ^ table[((crc >> 8) ^ static_cast<uint8_t>(data[i])) & 0xff];
+  }
+  return crc;
+}
+
+RespValue* makeCommand(const std::vector<std::string>& arguments) {
+  RespValue* command = new RespValue();
+  command->type(RespType::Array);
+  command->asArray().resize(arguments.size());
+  for (size_t i = 0; i < arguments.size(); i++) {
+    command->asArray()[i].type(RespType::BulkString);
+    command->asArray()[i].asString() = arguments[i];
+  }
+  return command;
+}
+
+} // namespace
+
+const uint32_t ClusterSlotUtility::SLOTS;
+
+uint16_t ClusterSlotUtility::keySlot(const std::string& key) {
+  const size_t open = key.find('{');
+  if (open != std::string::npos) {
+    const size_t close = key.find('}', open + 1);
+    if (close != std::string::npos && close != open + 1) {
+      return crc16(key.data() + open + 1, close - open - 1) % SLOTS;
+    }
+  }
+  return crc16(key.data(), key.size()) % SLOTS;
+}
+
+const RespValue& ClusterSlotUtility::clusterSlotsRequest() {
+  static const RespValue* request = makeCommand({"CLUSTER", "SLOTS"});
+  return *request;
+}
+
+const RespValue& ClusterSlotUtility::askingRequest() {
+  static const RespValue* request = makeCommand({"ASKING"});
+  return *request;
+}
+
+const RespValue& ClusterSlotUtility::readOnlyRequest() {
+  static const RespValue* request = makeCommand({"READONLY"});
+  return *request;
+}
+
+bool ClusterSlotUtility::parseClusterSlots(const RespValue& response,
+                                           std::vector<SlotRange>& ranges) {
+  if (response.type() != RespType::Array) {
+    return false;
+  }
+
+  for (const RespValue& range : response.asArray()) {
+    // Each range is [start, end, [ip, port, id], replicas...].
+    if (range.type() != RespType::Array || range.asArray().size() < 3) {
+      return false;
+    }
+    const RespValue& start = range.asArray()[0];
+    const RespValue& end = range.asArray()[1];
+    if (start.type() != RespType::Integer || end.type() != RespType::Integer ||
+        start.asInteger() < 0 || start.asInteger() > end.asInteger() ||
+        end.asInteger() >= SLOTS) {
+      return false;
+    }
+
+    SlotRange slot_range;
+    slot_range.start_ = start.asInteger();
+    slot_range.end_ = end.asInteger();
+    if (!parseNode(range.asArray()[2], slot_range.address_)) {
+      return false;
+    }
+    slot_range.replica_addresses_.resize(range.asArray().size() - 3);
+    for (size_t i = 3; i < range.asArray().size(); i++) {
+      if (!parseNode(range.asArray()[i], slot_range.replica_addresses_[i - 3])) {
+        return false;
+      }
+    }
+
+    ranges.push_back(std::move(slot_range));
+  }
+
+  return true;
+}
+
+bool ClusterSlotUtility::parseRedirection(const RespValue& response, Redirection& redirection) {
+  if (response.type() != RespType::Error) {
+    return false;
+  }
+
+  // The error is either "MOVED <slot> <ip>:<port>" or "ASK <slot> <ip>:<port>".
+  const std::vector<std::string> tokens = StringUtil::split(response.asString(), ' ');
+  if (tokens.size() != 3 || (tokens[0] != "MOVED" && tokens[0] != "ASK")) {
+    return false;
+  }
+
+  uint64_t slot;
+  const size_t port_separator = tokens[2].rfind(':');
+  uint64_t port;
+  if (!StringUtil::atoul(tokens[1].c_str(), slot) || slot >= SLOTS ||
+      port_separator == std::string::npos ||
+      !StringUtil::atoul(tokens[2].c_str() + port_separator + 1, port)) {
+    return false;
+  }
+
+  redirection.ask_ = tokens[0] == "ASK";
+  redirection.slot_ = slot;
+  redirection.address_ = address(tokens[2].substr(0, port_separator), port);
+  return true;
+}
+
+bool ClusterSlotUtility::parseNode(const RespValue& node, std::string& node_address) {
+  // A node is [ip, port, id].
+  if (node.type() != RespType::Array || node.asArray().size() < 2 ||
+      node.asArray()[0].type() != RespType::BulkString ||
+      node.asArray()[1].type() != RespType::Integer || node.asArray()[1].asInteger() < 0) {
+    return false;
+  }
+
+  node_address = address(node.asArray()[0].asString(), node.asArray()[1].asInteger());
+  return true;
+}
+
+std::string ClusterSlotUtility::address(const std::string& ip, uint64_t port) {
+  // Redis does not bracket IPv6 addresses, but Network::Address::Instance::asString() does.
+  if (ip.find(':') != std::string::npos && ip[0] != '[') {
+    return fmt::format("[{}]:{}", ip, port);
+  }
+  return fmt::format("{}:{}", ip, port);
+}
+
+} // namespace Redis
+} // namespace Envoy
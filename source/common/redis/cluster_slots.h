@@ -0,0 +1,86 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "envoy/redis/codec.h"
+
+namespace Envoy {
+namespace Redis {
+
+/**
+ * Helpers for the Redis Cluster protocol, see https://redis.io/topics/cluster-spec.
+ */
+class ClusterSlotUtility {
+public:
+  // The number of hash slots a Redis Cluster divides its keys into.
+  static const uint32_t SLOTS = 16384;
+
+  /**
+   * A range of slots served by one master and its replicas, as returned by CLUSTER SLOTS.
+   */
+  struct SlotRange {
+    uint16_t start_;
+    uint16_t end_;
+    // The master's address in the form returned by Network::Address::Instance::asString().
+    std::string address_;
+    // The addresses of the replicas of the master, in the same form.
+    std::vector<std::string> replica_addresses_;
+  };
+
+  /**
+   * A MOVED or ASK error returned by a node that does not serve a key.
+   */
+  struct Redirection {
+    bool ask_;
+    uint16_t slot_;
+    // The address of the node to retry on, in the same form as SlotRange::address_.
+    std::string address_;
+  };
+
+  /**
+   * @param key supplies a key.
+   * @return the slot of the key. If the key contains a non empty {hash tag}, only the tag is
+   *         hashed.
+   */
+  static uint16_t keySlot(const std::string& key);
+
+  /**
+   * @return the RESP value of a CLUSTER SLOTS command.
+   */
+  static const RespValue& clusterSlotsRequest();
+
+  /**
+   * @return the RESP value of an ASKING command.
+   */
+  static const RespValue& askingRequest();
+
+  /**
+   * @return the RESP value of a READONLY command, which lets a replica serve reads of its slots.
+   */
+  static const RespValue& readOnlyRequest();
+
+  /**
+   * Parse a CLUSTER SLOTS response.
+   * @param response supplies the response.
+   * @param ranges supplies the vector to append the slot ranges to.
+   * @return false if the response is not a valid CLUSTER SLOTS response.
+   */
+  static bool parseClusterSlots(const RespValue& response, std::vector<SlotRange>& ranges);
+
+  /**
+   * Parse a MOVED or ASK error.
+   * @param response supplies a response to a command.
+   * @param redirection supplies the redirection to fill in.
+   * @return whether the response is a MOVED or ASK error.
+   */
+  static bool parseRedirection(const RespValue& response, Redirection& redirection);
+
+private:
+  static bool parseNode(const RespValue& node, std::string& node_address);
+  static std::string address(const std::string& ip, uint64_t port);
+};
+
+} // namespace Redis
+} // namespace Envoy
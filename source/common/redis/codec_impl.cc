@@ -1,6 +1,7 @@
 #include "common/redis/codec_impl.h"
 
 #include <cstdint>
+#include <cstring>
 #include <string>
 #include <vector>
 
@@ -12,6 +13,36 @@
 namespace Envoy {
 namespace Redis {
 
+RespValue::RespValue(const RespValue& other) : type_(RespType::Null) { *this = other; }
+
+RespValue& RespValue::operator=(const RespValue& other) {
+  if (&other == this) {
+    return *this;
+  }
+
+  type(other.type());
+  switch (type_) {
+  case RespType::Array: {
+    array_ = other.array_;
+    break;
+  }
+  case RespType::SimpleString:
+  case RespType::BulkString:
+  case RespType::Error: {
+    string_ = other.string_;
+    break;
+  }
+  case RespType::Integer: {
+    integer_ = other.integer_;
+    break;
+  }
+  case RespType::Null:
+    break;
+  }
+
+  return *this;
+}
+
 std::string RespValue::toString() const {
   switch (type_) {
   case RespType::Array: {
@@ -112,6 +143,8 @@ void RespValue::type(RespType type) {
   }
 }
 
+const uint64_t DecoderImpl::MAX_BULK_STRING_RESERVE;
+
 void DecoderImpl::decode(Buffer::Instance& data) {
   uint64_t num_slices = data.getRawSlices(nullptr, 0);
   Buffer::RawSlice slices[num_slices];
@@ -133,7 +166,7 @@ void DecoderImpl::parseSlice(const Buffer::RawSlice& slice) {
     case State::ValueRootStart: {
       ENVOY_LOG(trace, "parse slice: ValueRootStart");
       pending_value_root_.reset(new RespValue());
-      pending_value_stack_.push_front({pending_value_root_.get(), 0});
+      pending_value_stack_.push_back({pending_value_root_.get(), 0});
       state_ = State::ValueStart;
       break;
     }
@@ -144,27 +177,27 @@ void DecoderImpl::parseSlice(const Buffer::RawSlice& slice) {
       switch (buffer[0]) {
       case '*': {
         state_ = State::IntegerStart;
-        pending_value_stack_.front().value_->type(RespType::Array);
+        pending_value_stack_.back().value_->type(RespType::Array);
         break;
       }
       case '$': {
         state_ = State::IntegerStart;
-        pending_value_stack_.front().value_->type(RespType::BulkString);
+        pending_value_stack_.back().value_->type(RespType::BulkString);
         break;
       }
       case '-': {
         state_ = State::SimpleString;
-        pending_value_stack_.front().value_->type(RespType::Error);
+        pending_value_stack_.back().value_->type(RespType::Error);
         break;
       }
       case '+': {
         state_ = State::SimpleString;
-        pending_value_stack_.front().value_->type(RespType::SimpleString);
+        pending_value_stack_.back().value_->type(RespType::SimpleString);
         break;
       }
       case ':': {
         state_ = State::IntegerStart;
-        pending_value_stack_.front().value_->type(RespType::Integer);
+        pending_value_stack_.back().value_->type(RespType::Integer);
         break;
       }
       default: { throw ProtocolError("invalid value type"); }
@@ -214,7 +247,7 @@ void DecoderImpl::parseSlice(const Buffer::RawSlice& slice) {
       remaining--;
       buffer++;
 
-      PendingValue& current_value = pending_value_stack_.front();
+      PendingValue& current_value = pending_value_stack_.back();
       if (current_value.value_->type() == RespType::Array) {
         if (pending_integer_.negative_) {
           // Null array. Convert to null.
@@ -225,7 +258,7 @@ void DecoderImpl::parseSlice(const Buffer::RawSlice& slice) {
         } else {
           std::vector<RespValue> values(pending_integer_.integer_);
           current_value.value_->asArray().swap(values);
-          pending_value_stack_.push_front({&current_value.value_->asArray()[0], 0});
+          pending_value_stack_.push_back({&current_value.value_->asArray()[0], 0});
           state_ = State::ValueStart;
         }
       } else if (current_value.value_->type() == RespType::Integer) {
@@ -242,7 +275,11 @@ void DecoderImpl::parseSlice(const Buffer::RawSlice& slice) {
       } else {
         ASSERT(current_value.value_->type() == RespType::BulkString);
         if (!pending_integer_.negative_) {
-          // TODO(mattklein123): reserve and define max length since we don't stream currently.
+          // Size the string up front so that a body spread over several slices is not regrown as
+          // it arrives. The reservation is capped so a bogus length cannot make us allocate
+          // memory the peer never sends.
+          current_value.value_->asString().reserve(
+              std::min(pending_integer_.integer_, MAX_BULK_STRING_RESERVE));
           state_ = State::BulkStringBody;
         } else {
           // Null bulk string. Switch type to null and move to value complete.
@@ -258,14 +295,14 @@ void DecoderImpl::parseSlice(const Buffer::RawSlice& slice) {
       ASSERT(!pending_integer_.negative_);
       uint64_t length_to_copy =
           std::min(static_cast<uint64_t>(pending_integer_.integer_), remaining);
-      pending_value_stack_.front().value_->asString().append(buffer, length_to_copy);
+      pending_value_stack_.back().value_->asString().append(buffer, length_to_copy);
       pending_integer_.integer_ -= length_to_copy;
       remaining -= length_to_copy;
       buffer += length_to_copy;
 
       if (pending_integer_.integer_ == 0) {
         ENVOY_LOG(trace, "parse slice: BulkStringBody complete: {}",
-                  pending_value_stack_.front().value_->asString());
+                  pending_value_stack_.back().value_->asString());
         state_ = State::CR;
       }
 
@@ -298,30 +335,34 @@ void DecoderImpl::parseSlice(const Buffer::RawSlice& slice) {
 
     case State::SimpleString: {
       ENVOY_LOG(trace, "parse slice: SimpleString: {}", buffer[0]);
-      if (buffer[0] == '\r') {
+      // Copy everything up to the terminating CR (or the end of the slice) at once.
+      const char* cr = static_cast<const char*>(memchr(buffer, '\r', remaining));
+      uint64_t length_to_copy = cr != nullptr ? cr - buffer : remaining;
+      pending_value_stack_.back().value_->asString().append(buffer, length_to_copy);
+      remaining -= length_to_copy;
+      buffer += length_to_copy;
+
+      if (cr != nullptr) {
         state_ = State::LF;
-      } else {
-        pending_value_stack_.front().value_->asString().push_back(buffer[0]);
+        remaining--;
+        buffer++;
       }
-
-      remaining--;
-      buffer++;
       break;
     }
 
     case State::ValueComplete: {
       ENVOY_LOG(trace, "parse slice: ValueComplete");
       ASSERT(!pending_value_stack_.empty());
-      pending_value_stack_.pop_front();
+      pending_value_stack_.pop_back();
       if (pending_value_stack_.empty()) {
         callbacks_.onRespValue(std::move(pending_value_root_));
         state_ = State::ValueRootStart;
       } else {
-        PendingValue& current_value = pending_value_stack_.front();
+        PendingValue& current_value = pending_value_stack_.back();
         ASSERT(current_value.value_->type() == RespType::Array);
         if (current_value.current_array_element_ < current_value.value_->asArray().size() - 1) {
           current_value.current_array_element_++;
-          pending_value_stack_.push_front(
+          pending_value_stack_.push_back(
               {&current_value.value_->asArray()[current_value.current_array_element_], 0});
           state_ = State::ValueStart;
         }
@@ -1,7 +1,6 @@
 #pragma once
 
 #include <cstdint>
-#include <forward_list>
 #include <string>
 #include <vector>
 
@@ -24,6 +23,9 @@ public:
   // Redis::Decoder
   void decode(Buffer::Instance& data) override;
 
+  // The most memory reserved for a bulk string before its body has arrived.
+  static const uint64_t MAX_BULK_STRING_RESERVE = 64 * 1024;
+
 private:
   enum class State {
     ValueRootStart,
@@ -59,7 +61,8 @@ private:
   State state_{State::ValueRootStart};
   PendingInteger pending_integer_;
   RespValuePtr pending_value_root_;
-  std::forward_list<PendingValue> pending_value_stack_;
+  // Used as a stack. It keeps its capacity between values so decoding does not allocate for it.
+  std::vector<PendingValue> pending_value_stack_;
 };
 
 /**
@@ -1,8 +1,10 @@
 #include "common/redis/command_splitter_impl.h"
 
+#include <chrono>
 #include <cstdint>
 #include <memory>
 #include <string>
+#include <unordered_map>
 #include <vector>
 
 #include "common/common/assert.h"
@@ -27,15 +29,24 @@ void SplitRequestBase::onWrongNumberOfArguments(SplitCallbacks& callbacks,
       fmt::format("wrong number of arguments for '{}' command", request.asArray()[0].asString())));
 }
 
+void SplitRequestBase::recordLatency() {
+  command_stats_.latency_us_.recordValue(
+      std::chrono::duration_cast<std::chrono::microseconds>(
+          ProdMonotonicTimeSource::instance_.currentTime() - start_time_)
+          .count());
+}
+
 SingleServerRequest::~SingleServerRequest() { ASSERT(!handle_); }
 
 void SingleServerRequest::onResponse(RespValuePtr&& response) {
   handle_ = nullptr;
+  recordLatency();
   callbacks_.onResponse(std::move(response));
 }
 
 void SingleServerRequest::onFailure() {
   handle_ = nullptr;
+  recordLatency();
   callbacks_.onResponse(Utility::makeError("upstream failure"));
 }
 
@@ -46,8 +57,8 @@ void SingleServerRequest::cancel() {
 
 SplitRequestPtr SimpleRequest::create(ConnPool::Instance& conn_pool,
                                       const RespValue& incoming_request,
-                                      SplitCallbacks& callbacks) {
-  std::unique_ptr<SimpleRequest> request_ptr{new SimpleRequest(callbacks)};
+                                      SplitCallbacks& callbacks, CommandStats& command_stats) {
+  std::unique_ptr<SimpleRequest> request_ptr{new SimpleRequest(callbacks, command_stats)};
 
   request_ptr->handle_ = conn_pool.makeRequest(incoming_request.asArray()[1].asString(),
                                                incoming_request, *request_ptr);
@@ -60,7 +71,8 @@ SplitRequestPtr SimpleRequest::create(ConnPool::Instance& conn_pool,
 }
 
 SplitRequestPtr EvalRequest::create(ConnPool::Instance& conn_pool,
-                                    const RespValue& incoming_request, SplitCallbacks& callbacks) {
+                                    const RespValue& incoming_request, SplitCallbacks& callbacks,
+                                    CommandStats& command_stats) {
 
   // EVAL looks like: EVAL script numkeys key [key ...] arg [arg ...]
   // Ensure there are at least three args to the command or it cannot be hashed.
@@ -69,7 +81,7 @@ SplitRequestPtr EvalRequest::create(ConnPool::Instance& conn_pool,
     return nullptr;
   }
 
-  std::unique_ptr<EvalRequest> request_ptr{new EvalRequest(callbacks)};
+  std::unique_ptr<EvalRequest> request_ptr{new EvalRequest(callbacks, command_stats)};
   request_ptr->handle_ = conn_pool.makeRequest(incoming_request.asArray()[3].asString(),
                                                incoming_request, *request_ptr);
   if (!request_ptr->handle_) {
@@ -101,52 +113,82 @@ void FragmentedRequest::onChildFailure(uint32_t index) {
   onChildResponse(Utility::makeError("upstream failure"), index);
 }
 
-SplitRequestPtr MGETRequest::create(ConnPool::Instance& conn_pool,
-                                    const RespValue& incoming_request, SplitCallbacks& callbacks) {
-  std::unique_ptr<MGETRequest> request_ptr{new MGETRequest(callbacks)};
+void FragmentedRequest::groupKeys(ConnPool::Instance& conn_pool, const RespValue& incoming_request,
+                                  uint32_t step) {
+  // Maps each key group to the index of its pending request.
+  std::unordered_map<uint64_t, uint32_t> groups;
+  for (uint32_t i = 1; i < incoming_request.asArray().size(); i += step) {
+    auto group = groups.emplace(conn_pool.keyGroup(incoming_request.asArray()[i].asString()),
+                                pending_requests_.size());
+    if (group.second) {
+      pending_requests_.emplace_back(*this, pending_requests_.size());
+    }
+    pending_requests_[group.first->second].key_indexes_.push_back(i);
+  }
 
-  request_ptr->num_pending_responses_ = incoming_request.asArray().size() - 1;
-  request_ptr->pending_requests_.reserve(request_ptr->num_pending_responses_);
+  num_pending_responses_ = pending_requests_.size();
+}
 
-  request_ptr->pending_response_.reset(new RespValue());
-  request_ptr->pending_response_->type(RespType::Array);
-  std::vector<RespValue> responses(request_ptr->num_pending_responses_);
-  request_ptr->pending_response_->asArray().swap(responses);
+void FragmentedRequest::makeRequests(ConnPool::Instance& conn_pool,
+                                     const RespValue& incoming_request, uint32_t step,
+                                     const std::string& single_command,
+                                     const std::string& multiple_command) {
+  // The fragment is reused for each pending request so that its strings keep their buffers. Only
+  // the arguments added by resize() need their type set, since setting it clears the string.
+  RespValue fragment;
+  fragment.type(RespType::Array);
+  std::vector<RespValue>& arguments = fragment.asArray();
+  for (PendingRequest& pending_request : pending_requests_) {
+    const std::vector<uint32_t>& key_indexes = pending_request.key_indexes_;
+    arguments.resize(1 + key_indexes.size() * step);
+    for (RespValue& value : arguments) {
+      if (value.type() != RespType::BulkString) {
+        value.type(RespType::BulkString);
+      }
+    }
 
-  std::vector<RespValue> values(2);
-  values[0].type(RespType::BulkString);
-  values[0].asString() = "get";
-  values[1].type(RespType::BulkString);
-  RespValue single_mget;
-  single_mget.type(RespType::Array);
-  single_mget.asArray().swap(values);
-
-  for (uint64_t i = 1; i < incoming_request.asArray().size(); i++) {
-    request_ptr->pending_requests_.emplace_back(*request_ptr, i - 1);
-    PendingRequest& pending_request = request_ptr->pending_requests_.back();
-
-    single_mget.asArray()[1].asString() = incoming_request.asArray()[i].asString();
-    ENVOY_LOG(debug, "redis: parallel get: '{}'", single_mget.toString());
-    pending_request.handle_ = conn_pool.makeRequest(incoming_request.asArray()[i].asString(),
-                                                    single_mget, pending_request);
+    arguments[0].asString() = key_indexes.size() == 1 ? single_command : multiple_command;
+    uint32_t argument = 1;
+    for (uint32_t key_index : key_indexes) {
+      for (uint32_t i = 0; i < step; i++) {
+        arguments[argument++].asString() = incoming_request.asArray()[key_index + i].asString();
+      }
+    }
+
+    ENVOY_LOG(debug, "redis: parallel {}: '{}'", arguments[0].asString(), fragment.toString());
+    pending_request.handle_ = conn_pool.makeRequest(
+        incoming_request.asArray()[key_indexes[0]].asString(), fragment, pending_request);
     if (!pending_request.handle_) {
       pending_request.onResponse(Utility::makeError("no upstream host"));
     }
   }
+}
+
+SplitRequestPtr MGETRequest::create(ConnPool::Instance& conn_pool,
+                                    const RespValue& incoming_request, SplitCallbacks& callbacks,
+                                    CommandStats& command_stats) {
+  std::unique_ptr<MGETRequest> request_ptr{new MGETRequest(callbacks, command_stats)};
+
+  request_ptr->pending_response_.reset(new RespValue());
+  request_ptr->pending_response_->type(RespType::Array);
+  std::vector<RespValue> responses(incoming_request.asArray().size() - 1);
+  request_ptr->pending_response_->asArray().swap(responses);
+
+  request_ptr->groupKeys(conn_pool, incoming_request, 1);
+  request_ptr->makeRequests(conn_pool, incoming_request, 1, "get", "mget");
 
   return request_ptr->num_pending_responses_ > 0 ? std::move(request_ptr) : nullptr;
 }
 
-void MGETRequest::onChildResponse(RespValuePtr&& value, uint32_t index) {
-  pending_requests_[index].handle_ = nullptr;
-
-  pending_response_->asArray()[index].type(value->type());
-  switch (value->type()) {
+void MGETRequest::setResponse(uint32_t key_index, RespValue& value) {
+  RespValue& response = pending_response_->asArray()[key_index - 1];
+  response.type(value.type());
+  switch (value.type()) {
   case RespType::Array:
   case RespType::Integer:
   case RespType::SimpleString: {
-    pending_response_->asArray()[index].type(RespType::Error);
-    pending_response_->asArray()[index].asString() = "upstream protocol error";
+    response.type(RespType::Error);
+    response.asString() = "upstream protocol error";
     error_count_++;
     break;
   }
@@ -155,59 +197,59 @@ void MGETRequest::onChildResponse(RespValuePtr&& value, uint32_t index) {
     FALLTHRU;
   }
   case RespType::BulkString: {
-    pending_response_->asArray()[index].asString().swap(value->asString());
+    response.asString().swap(value.asString());
     break;
   }
   case RespType::Null:
     break;
   }
+}
+
+void MGETRequest::onChildResponse(RespValuePtr&& value, uint32_t index) {
+  PendingRequest& pending_request = pending_requests_[index];
+  pending_request.handle_ = nullptr;
+
+  const std::vector<uint32_t>& key_indexes = pending_request.key_indexes_;
+  if (key_indexes.size() == 1) {
+    setResponse(key_indexes[0], *value);
+  } else if (value->type() == RespType::Array && value->asArray().size() == key_indexes.size()) {
+    for (uint32_t i = 0; i < key_indexes.size(); i++) {
+      setResponse(key_indexes[i], value->asArray()[i]);
+    }
+  } else {
+    // An error or a malformed MGET response fails every key of the fragment.
+    for (uint32_t key_index : key_indexes) {
+      RespValue& response = pending_response_->asArray()[key_index - 1];
+      response.type(RespType::Error);
+      response.asString() =
+          value->type() == RespType::Error ? value->asString() : "upstream protocol error";
+      error_count_++;
+    }
+  }
 
   ASSERT(num_pending_responses_ > 0);
   if (--num_pending_responses_ == 0) {
+    recordLatency();
     ENVOY_LOG(debug, "redis: response: '{}'", pending_response_->toString());
     callbacks_.onResponse(std::move(pending_response_));
   }
 }
 
 SplitRequestPtr MSETRequest::create(ConnPool::Instance& conn_pool,
-                                    const RespValue& incoming_request, SplitCallbacks& callbacks) {
+                                    const RespValue& incoming_request, SplitCallbacks& callbacks,
+                                    CommandStats& command_stats) {
   if ((incoming_request.asArray().size() - 1) % 2 != 0) {
     onWrongNumberOfArguments(callbacks, incoming_request);
     return nullptr;
   }
 
-  std::unique_ptr<MSETRequest> request_ptr{new MSETRequest(callbacks)};
-
-  request_ptr->num_pending_responses_ = (incoming_request.asArray().size() - 1) / 2;
-  request_ptr->pending_requests_.reserve(request_ptr->num_pending_responses_);
+  std::unique_ptr<MSETRequest> request_ptr{new MSETRequest(callbacks, command_stats)};
 
   request_ptr->pending_response_.reset(new RespValue());
   request_ptr->pending_response_->type(RespType::SimpleString);
 
-  std::vector<RespValue> values(3);
-  values[0].type(RespType::BulkString);
-  values[0].asString() = "set";
-  values[1].type(RespType::BulkString);
-  values[2].type(RespType::BulkString);
-  RespValue single_mset;
-  single_mset.type(RespType::Array);
-  single_mset.asArray().swap(values);
-
-  uint64_t fragment_index = 0;
-  for (uint64_t i = 1; i < incoming_request.asArray().size(); i += 2) {
-    request_ptr->pending_requests_.emplace_back(*request_ptr, fragment_index++);
-    PendingRequest& pending_request = request_ptr->pending_requests_.back();
-
-    single_mset.asArray()[1].asString() = incoming_request.asArray()[i].asString();
-    single_mset.asArray()[2].asString() = incoming_request.asArray()[i + 1].asString();
-
-    ENVOY_LOG(debug, "redis: parallel set: '{}'", single_mset.toString());
-    pending_request.handle_ = conn_pool.makeRequest(incoming_request.asArray()[i].asString(),
-                                                    single_mset, pending_request);
-    if (!pending_request.handle_) {
-      pending_request.onResponse(Utility::makeError("no upstream host"));
-    }
-  }
+  request_ptr->groupKeys(conn_pool, incoming_request, 2);
+  request_ptr->makeRequests(conn_pool, incoming_request, 2, "set", "mset");
 
   return request_ptr->num_pending_responses_ > 0 ? std::move(request_ptr) : nullptr;
 }
@@ -215,21 +257,13 @@ SplitRequestPtr MSETRequest::create(ConnPool::Instance& conn_pool,
 void MSETRequest::onChildResponse(RespValuePtr&& value, uint32_t index) {
   pending_requests_[index].handle_ = nullptr;
 
-  switch (value->type()) {
-  case RespType::SimpleString: {
-    if (value->asString() == "OK") {
-      break;
-    }
-    FALLTHRU;
-  }
-  default: {
-    error_count_++;
-    break;
-  }
+  if (value->type() != RespType::SimpleString || value->asString() != "OK") {
+    error_count_ += pending_requests_[index].key_indexes_.size();
   }
 
   ASSERT(num_pending_responses_ > 0);
   if (--num_pending_responses_ == 0) {
+    recordLatency();
     if (error_count_ == 0) {
       pending_response_->asString() = "OK";
       callbacks_.onResponse(std::move(pending_response_));
@@ -242,36 +276,18 @@ void MSETRequest::onChildResponse(RespValuePtr&& value, uint32_t index) {
 
 SplitRequestPtr SplitKeysSumResultRequest::create(ConnPool::Instance& conn_pool,
                                                   const RespValue& incoming_request,
-                                                  SplitCallbacks& callbacks) {
-  std::unique_ptr<SplitKeysSumResultRequest> request_ptr{new SplitKeysSumResultRequest(callbacks)};
-
-  request_ptr->num_pending_responses_ = incoming_request.asArray().size() - 1;
-  request_ptr->pending_requests_.reserve(request_ptr->num_pending_responses_);
+                                                  SplitCallbacks& callbacks,
+                                                  CommandStats& command_stats) {
+  std::unique_ptr<SplitKeysSumResultRequest> request_ptr{
+      new SplitKeysSumResultRequest(callbacks, command_stats)};
 
   request_ptr->pending_response_.reset(new RespValue());
   request_ptr->pending_response_->type(RespType::Integer);
 
-  std::vector<RespValue> values(2);
-  values[0].type(RespType::BulkString);
-  values[0].asString() = incoming_request.asArray()[0].asString();
-  values[1].type(RespType::BulkString);
-  RespValue single_fragment;
-  single_fragment.type(RespType::Array);
-  single_fragment.asArray().swap(values);
-
-  for (uint64_t i = 1; i < incoming_request.asArray().size(); i++) {
-    request_ptr->pending_requests_.emplace_back(*request_ptr, i - 1);
-    PendingRequest& pending_request = request_ptr->pending_requests_.back();
-
-    single_fragment.asArray()[1].asString() = incoming_request.asArray()[i].asString();
-    ENVOY_LOG(debug, "redis: parallel {}: '{}'", incoming_request.asArray()[0].asString(),
-              single_fragment.toString());
-    pending_request.handle_ = conn_pool.makeRequest(incoming_request.asArray()[i].asString(),
-                                                    single_fragment, pending_request);
-    if (!pending_request.handle_) {
-      pending_request.onResponse(Utility::makeError("no upstream host"));
-    }
-  }
+  // These commands take any number of keys, so a group is sent with the incoming command.
+  const std::string& command = incoming_request.asArray()[0].asString();
+  request_ptr->groupKeys(conn_pool, incoming_request, 1);
+  request_ptr->makeRequests(conn_pool, incoming_request, 1, command, command);
 
   return request_ptr->num_pending_responses_ > 0 ? std::move(request_ptr) : nullptr;
 }
@@ -279,19 +295,15 @@ SplitRequestPtr SplitKeysSumResultRequest::create(ConnPool::Instance& conn_pool,
 void SplitKeysSumResultRequest::onChildResponse(RespValuePtr&& value, uint32_t index) {
   pending_requests_[index].handle_ = nullptr;
 
-  switch (value->type()) {
-  case RespType::Integer: {
+  if (value->type() == RespType::Integer) {
     total_ += value->asInteger();
-    break;
-  }
-  default: {
-    error_count_++;
-    break;
-  }
+  } else {
+    error_count_ += pending_requests_[index].key_indexes_.size();
   }
 
   ASSERT(num_pending_responses_ > 0);
   if (--num_pending_responses_ == 0) {
+    recordLatency();
     if (error_count_ == 0) {
       pending_response_->asInteger() = total_;
       callbacks_.onResponse(std::move(pending_response_));
@@ -350,8 +362,9 @@ SplitRequestPtr InstanceImpl::makeRequest(const RespValue& request, SplitCallbac
   }
 
   ENVOY_LOG(debug, "redis: splitting '{}'", request.toString());
-  handler->second.total_.inc();
-  return handler->second.handler_.get().startRequest(request, callbacks);
+  handler->second.command_stats_.total_.inc();
+  return handler->second.handler_.get().startRequest(request, callbacks,
+                                                     handler->second.command_stats_);
 }
 
 void InstanceImpl::onInvalidRequest(SplitCallbacks& callbacks) {
@@ -363,10 +376,12 @@ void InstanceImpl::addHandler(Stats::Scope& scope, const std::string& stat_prefi
                               const std::string& name, CommandHandler& handler) {
   std::string to_lower_name(name);
   to_lower_table_.toLowerCase(to_lower_name);
-  command_map_.emplace(
-      to_lower_name,
-      HandlerData{scope.counter(fmt::format("{}command.{}.total", stat_prefix, to_lower_name)),
-                  handler});
+  const std::string command_stat_prefix = fmt::format("{}command.{}.", stat_prefix, to_lower_name);
+  command_map_.emplace(to_lower_name,
+                       HandlerData{CommandStats{ALL_COMMAND_STATS(
+                                       POOL_COUNTER_PREFIX(scope, command_stat_prefix),
+                                       POOL_HISTOGRAM_PREFIX(scope, command_stat_prefix))},
+                                   handler});
 }
 
 } // namespace CommandSplitter
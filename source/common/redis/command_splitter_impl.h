@@ -5,11 +5,14 @@
 #include <unordered_map>
 #include <vector>
 
+#include "envoy/common/time.h"
 #include "envoy/redis/command_splitter.h"
 #include "envoy/redis/conn_pool.h"
+#include "envoy/stats/stats_macros.h"
 
 #include "common/common/logger.h"
 #include "common/common/to_lower_table.h"
+#include "common/common/utility.h"
 
 namespace Envoy {
 namespace Redis {
@@ -20,11 +23,28 @@ public:
   static RespValuePtr makeError(const std::string& error);
 };
 
+/**
+ * All per command stats. @see stats_macros.h
+ */
+// clang-format off
+#define ALL_COMMAND_STATS(COUNTER, HISTOGRAM)                                                      \
+  COUNTER(total)                                                                                   \
+  HISTOGRAM(latency_us)
+// clang-format on
+
+/**
+ * Struct definition for all per command stats. @see stats_macros.h
+ */
+struct CommandStats {
+  ALL_COMMAND_STATS(GENERATE_COUNTER_STRUCT, GENERATE_HISTOGRAM_STRUCT)
+};
+
 class CommandHandler {
 public:
   virtual ~CommandHandler() {}
 
-  virtual SplitRequestPtr startRequest(const RespValue& request, SplitCallbacks& callbacks) PURE;
+  virtual SplitRequestPtr startRequest(const RespValue& request, SplitCallbacks& callbacks,
+                                       CommandStats& command_stats) PURE;
 };
 
 class CommandHandlerBase {
@@ -36,7 +56,19 @@ protected:
 
 class SplitRequestBase : public SplitRequest {
 protected:
+  SplitRequestBase(CommandStats& command_stats)
+      : command_stats_(command_stats),
+        start_time_(ProdMonotonicTimeSource::instance_.currentTime()) {}
+
   static void onWrongNumberOfArguments(SplitCallbacks& callbacks, const RespValue& request);
+
+  /**
+   * Record the time from the start of the request to its response from upstream.
+   */
+  void recordLatency();
+
+  CommandStats& command_stats_;
+  const MonotonicTime start_time_;
 };
 
 /**
@@ -54,7 +86,8 @@ public:
   void cancel() override;
 
 protected:
-  SingleServerRequest(SplitCallbacks& callbacks) : callbacks_(callbacks) {}
+  SingleServerRequest(SplitCallbacks& callbacks, CommandStats& command_stats)
+      : SplitRequestBase(command_stats), callbacks_(callbacks) {}
 
   SplitCallbacks& callbacks_;
   ConnPool::PoolRequest* handle_{};
@@ -66,10 +99,11 @@ protected:
 class SimpleRequest : public SingleServerRequest {
 public:
   static SplitRequestPtr create(ConnPool::Instance& conn_pool, const RespValue& incoming_request,
-                                SplitCallbacks& callbacks);
+                                SplitCallbacks& callbacks, CommandStats& command_stats);
 
 private:
-  SimpleRequest(SplitCallbacks& callbacks) : SingleServerRequest(callbacks) {}
+  SimpleRequest(SplitCallbacks& callbacks, CommandStats& command_stats)
+      : SingleServerRequest(callbacks, command_stats) {}
 };
 
 /**
@@ -78,18 +112,19 @@ private:
 class EvalRequest : public SingleServerRequest {
 public:
   static SplitRequestPtr create(ConnPool::Instance& conn_pool, const RespValue& incoming_request,
-                                SplitCallbacks& callbacks);
+                                SplitCallbacks& callbacks, CommandStats& command_stats);
 
 private:
-  EvalRequest(SplitCallbacks& callbacks) : SingleServerRequest(callbacks) {}
+  EvalRequest(SplitCallbacks& callbacks, CommandStats& command_stats)
+      : SingleServerRequest(callbacks, command_stats) {}
 };
 
 /**
- * FragmentedRequest is a base class for requests that contains multiple keys. An individual request
- * is sent to the appropriate server for each key. The responses from all servers are combined and
- * returned to the client.
+ * FragmentedRequest is a base class for requests that contains multiple keys. The keys are grouped
+ * by ConnPool::Instance::keyGroup() and one request is sent to the appropriate server for each
+ * group. The responses from all servers are combined and returned to the client.
  */
-class FragmentedRequest : public SplitRequestBase {
+class FragmentedRequest : public SplitRequestBase, protected Logger::Loggable<Logger::Id::redis> {
 public:
   ~FragmentedRequest();
 
@@ -97,7 +132,8 @@ public:
   void cancel() override;
 
 protected:
-  FragmentedRequest(SplitCallbacks& callbacks) : callbacks_(callbacks) {}
+  FragmentedRequest(SplitCallbacks& callbacks, CommandStats& command_stats)
+      : SplitRequestBase(command_stats), callbacks_(callbacks) {}
 
   struct PendingRequest : public ConnPool::PoolCallbacks {
     PendingRequest(FragmentedRequest& parent, uint32_t index) : parent_(parent), index_(index) {}
@@ -111,8 +147,25 @@ protected:
     FragmentedRequest& parent_;
     const uint32_t index_;
     ConnPool::PoolRequest* handle_{};
+    // The indexes in the incoming request of the keys sent in this fragment.
+    std::vector<uint32_t> key_indexes_;
   };
 
+  /**
+   * Create one pending request per group of keys of the incoming request.
+   * @param step supplies the number of arguments per key, the key being the first of them.
+   */
+  void groupKeys(ConnPool::Instance& conn_pool, const RespValue& incoming_request, uint32_t step);
+
+  /**
+   * Send the pending requests created by groupKeys().
+   * @param single_command supplies the command of the fragments with one key.
+   * @param multiple_command supplies the command of the fragments with more keys.
+   */
+  void makeRequests(ConnPool::Instance& conn_pool, const RespValue& incoming_request,
+                    uint32_t step, const std::string& single_command,
+                    const std::string& multiple_command);
+
   virtual void onChildResponse(RespValuePtr&& value, uint32_t index) PURE;
   void onChildFailure(uint32_t index);
 
@@ -124,34 +177,38 @@ protected:
 };
 
 /**
- * MGETRequest takes each key from the command and sends a GET for each to the appropriate Redis
- * server. The response contains the result from each command.
+ * MGETRequest takes each key from the command and sends a GET, or an MGET for the keys of a group,
+ * to the appropriate Redis server. The response contains the result for each key.
  */
-class MGETRequest : public FragmentedRequest, Logger::Loggable<Logger::Id::redis> {
+class MGETRequest : public FragmentedRequest {
 public:
   static SplitRequestPtr create(ConnPool::Instance& conn_pool, const RespValue& incoming_request,
-                                SplitCallbacks& callbacks);
+                                SplitCallbacks& callbacks, CommandStats& command_stats);
 
 private:
-  MGETRequest(SplitCallbacks& callbacks) : FragmentedRequest(callbacks) {}
+  MGETRequest(SplitCallbacks& callbacks, CommandStats& command_stats)
+      : FragmentedRequest(callbacks, command_stats) {}
+
+  void setResponse(uint32_t key_index, RespValue& value);
 
   // Redis::CommandSplitter::FragmentedRequest
   void onChildResponse(RespValuePtr&& value, uint32_t index) override;
 };
 
 /**
- * SplitKeysSumResultRequest takes each key from the command and sends the same incoming command
- * with each key to the appropriate Redis server. The response from each Redis (which must be an
- * integer) is summed and returned to the user. If there is any error or failure in processing the
- * fragmented commands, an error will be returned.
+ * SplitKeysSumResultRequest takes each group of keys from the command and sends the same incoming
+ * command with those keys to the appropriate Redis server. The response from each Redis (which must
+ * be an integer) is summed and returned to the user. If there is any error or failure in processing
+ * the fragmented commands, an error will be returned.
  */
-class SplitKeysSumResultRequest : public FragmentedRequest, Logger::Loggable<Logger::Id::redis> {
+class SplitKeysSumResultRequest : public FragmentedRequest {
 public:
   static SplitRequestPtr create(ConnPool::Instance& conn_pool, const RespValue& incoming_request,
-                                SplitCallbacks& callbacks);
+                                SplitCallbacks& callbacks, CommandStats& command_stats);
 
 private:
-  SplitKeysSumResultRequest(SplitCallbacks& callbacks) : FragmentedRequest(callbacks) {}
+  SplitKeysSumResultRequest(SplitCallbacks& callbacks, CommandStats& command_stats)
+      : FragmentedRequest(callbacks, command_stats) {}
 
   // Redis::CommandSplitter::FragmentedRequest
   void onChildResponse(RespValuePtr&& value, uint32_t index) override;
@@ -160,17 +217,18 @@ private:
 };
 
 /**
- * MSETRequest takes each key and value pair from the command and sends a SET for each to the
- * appropriate Redis server. The response is an OK if all commands succeeded or an ERR if any
- * failed.
+ * MSETRequest takes each key and value pair from the command and sends a SET, or an MSET for the
+ * pairs of a group, to the appropriate Redis server. The response is an OK if all commands
+ * succeeded or an ERR if any failed.
  */
-class MSETRequest : public FragmentedRequest, Logger::Loggable<Logger::Id::redis> {
+class MSETRequest : public FragmentedRequest {
 public:
   static SplitRequestPtr create(ConnPool::Instance& conn_pool, const RespValue& incoming_request,
-                                SplitCallbacks& callbacks);
+                                SplitCallbacks& callbacks, CommandStats& command_stats);
 
 private:
-  MSETRequest(SplitCallbacks& callbacks) : FragmentedRequest(callbacks) {}
+  MSETRequest(SplitCallbacks& callbacks, CommandStats& command_stats)
+      : FragmentedRequest(callbacks, command_stats) {}
 
   // Redis::CommandSplitter::FragmentedRequest
   void onChildResponse(RespValuePtr&& value, uint32_t index) override;
@@ -184,8 +242,9 @@ template <class RequestClass>
 class CommandHandlerFactory : public CommandHandler, CommandHandlerBase {
 public:
   CommandHandlerFactory(ConnPool::Instance& conn_pool) : CommandHandlerBase(conn_pool) {}
-  SplitRequestPtr startRequest(const RespValue& request, SplitCallbacks& callbacks) {
-    return RequestClass::create(conn_pool_, request, callbacks);
+  SplitRequestPtr startRequest(const RespValue& request, SplitCallbacks& callbacks,
+                               CommandStats& command_stats) {
+    return RequestClass::create(conn_pool_, request, callbacks, command_stats);
   }
 };
 
@@ -215,7 +274,7 @@ public:
 
 private:
   struct HandlerData {
-    Stats::Counter& total_;
+    CommandStats command_stats_;
     std::reference_wrapper<CommandHandler> handler_;
   };
 
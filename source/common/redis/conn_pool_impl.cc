@@ -1,11 +1,20 @@
 #include "common/redis/conn_pool_impl.h"
 
+#include <algorithm>
 #include <cstdint>
 #include <memory>
 #include <string>
 #include <vector>
 
+#include "envoy/common/exception.h"
+
 #include "common/common/assert.h"
+#include "common/config/metadata.h"
+#include "common/config/well_known_names.h"
+#include "common/redis/supported_commands.h"
+#include "common/upstream/local_active_requests.h"
+
+#include "fmt/format.h"
 
 namespace Envoy {
 namespace Redis {
@@ -32,7 +41,9 @@ ClientImpl::ClientImpl(Upstream::HostConstSharedPtr host, Event::Dispatcher& dis
                        EncoderPtr&& encoder, DecoderFactory& decoder_factory, const Config& config)
     : host_(host), encoder_(std::move(encoder)), decoder_(decoder_factory.create(*this)),
       config_(config),
-      connect_or_op_timer_(dispatcher.createTimer([this]() -> void { onConnectOrOpTimeout(); })) {
+      connect_or_op_timer_(dispatcher.createTimer([this]() -> void { onConnectOrOpTimeout(); })),
+      flush_timer_(dispatcher.createTimer([this]() -> void { flushBatch(); })),
+      batch_size_(host->cluster().statsScope().histogram("redis.upstream_rq_batch_size")) {
   host->cluster().stats().upstream_cx_total_.inc();
   host->cluster().stats().upstream_cx_active_.inc();
   host->stats().cx_total_.inc();
@@ -54,7 +65,15 @@ PoolRequest* ClientImpl::makeRequest(const RespValue& request, PoolCallbacks& ca
 
   pending_requests_.emplace_back(*this, callbacks);
   encoder_->encode(request, encoder_buffer_);
-  connection_->write(encoder_buffer_);
+
+  // Rather than writing each request on its own, coalesce all the requests made during this event
+  // loop iteration into a single write, unless a lot of data is already waiting.
+  if (batched_requests_++ == 0) {
+    flush_timer_->enableTimer(std::chrono::milliseconds(0));
+  }
+  if (encoder_buffer_.length() >= MAX_BATCH_BYTES) {
+    flushBatch();
+  }
 
   // Only boost the op timeout if:
   // - We are not already connected. Otherwise, we are governed by the connect timeout and the timer
@@ -69,6 +88,17 @@ PoolRequest* ClientImpl::makeRequest(const RespValue& request, PoolCallbacks& ca
   return &pending_requests_.back();
 }
 
+void ClientImpl::flushBatch() {
+  if (batched_requests_ == 0) {
+    return;
+  }
+
+  flush_timer_->disableTimer();
+  batch_size_.recordValue(batched_requests_);
+  batched_requests_ = 0;
+  connection_->write(encoder_buffer_);
+}
+
 void ClientImpl::onConnectOrOpTimeout() {
   putOutlierEvent(Upstream::Outlier::Result::TIMEOUT);
   if (connected_) {
@@ -121,6 +151,9 @@ void ClientImpl::onEvent(Network::ConnectionEvent event) {
     }
 
     connect_or_op_timer_->disableTimer();
+    flush_timer_->disableTimer();
+    batched_requests_ = 0;
+    encoder_buffer_.drain(encoder_buffer_.length());
   } else if (event == Network::ConnectionEvent::Connected) {
     connected_ = true;
     ASSERT(!pending_requests_.empty());
@@ -160,11 +193,13 @@ ClientImpl::PendingRequest::PendingRequest(ClientImpl& parent, PoolCallbacks& ca
   parent.host_->cluster().stats().upstream_rq_active_.inc();
   parent.host_->stats().rq_total_.inc();
   parent.host_->stats().rq_active_.inc();
+  Upstream::LocalActiveRequests::inc(*parent.host_);
 }
 
 ClientImpl::PendingRequest::~PendingRequest() {
   parent_.host_->cluster().stats().upstream_rq_active_.dec();
   parent_.host_->stats().rq_active_.dec();
+  Upstream::LocalActiveRequests::dec(*parent_.host_);
 }
 
 void ClientImpl::PendingRequest::cancel() {
@@ -182,11 +217,32 @@ ClientPtr ClientFactoryImpl::create(Upstream::HostConstSharedPtr host,
                             config);
 }
 
+const std::chrono::milliseconds InstanceImpl::SLOTS_REFRESH_INTERVAL(10000);
+const uint32_t InstanceImpl::MAX_REDIRECTIONS;
+
 InstanceImpl::InstanceImpl(
     const std::string& cluster_name, Upstream::ClusterManager& cm, ClientFactory& client_factory,
     ThreadLocal::SlotAllocator& tls,
     const envoy::api::v2::filter::network::RedisProxy::ConnPoolSettings& config)
     : cm_(cm), client_factory_(client_factory), tls_(tls.allocateSlot()), config_(config) {
+  const std::string& read_policy =
+      Config::Metadata::metadataValue(cm_.get(cluster_name)->info()->metadata(),
+                                      Config::MetadataFilters::get().ENVOY_LB,
+                                      Config::MetadataEnvoyLbKeys::get().REDIS_READ_POLICY)
+          .string_value();
+  if (read_policy == "prefer_replica") {
+    read_policy_ = ReadPolicy::PreferReplica;
+  } else if (read_policy == "any") {
+    read_policy_ = ReadPolicy::Any;
+  } else if (!read_policy.empty() && read_policy != "master") {
+    throw EnvoyException(fmt::format("invalid redis read policy '{}'", read_policy));
+  }
+
+  if (read_policy_ != ReadPolicy::Master) {
+    read_only_commands_.insert(SupportedCommands::readOnlyCommands().begin(),
+                               SupportedCommands::readOnlyCommands().end());
+  }
+
   tls_->set([this, cluster_name](
                 Event::Dispatcher& dispatcher) -> ThreadLocal::ThreadLocalObjectSharedPtr {
     return std::make_shared<ThreadLocalPool>(*this, dispatcher, cluster_name);
@@ -198,9 +254,28 @@ PoolRequest* InstanceImpl::makeRequest(const std::string& hash_key, const RespVa
   return tls_->getTyped<ThreadLocalPool>().makeRequest(hash_key, value, callbacks);
 }
 
+uint64_t InstanceImpl::keyGroup(const std::string& hash_key) {
+  return tls_->getTyped<ThreadLocalPool>().keyGroup(hash_key);
+}
+
+bool InstanceImpl::isReadOnly(const RespValue& request) const {
+  if (read_only_commands_.empty() || request.type() != RespType::Array ||
+      request.asArray().empty() || request.asArray()[0].type() != RespType::BulkString) {
+    return false;
+  }
+
+  std::string command(request.asArray()[0].asString());
+  to_lower_table_.toLowerCase(command);
+  return read_only_commands_.count(command) > 0;
+}
+
 InstanceImpl::ThreadLocalPool::ThreadLocalPool(InstanceImpl& parent, Event::Dispatcher& dispatcher,
                                                const std::string& cluster_name)
-    : parent_(parent), dispatcher_(dispatcher), cluster_(parent_.cm_.get(cluster_name)) {
+    : parent_(parent), dispatcher_(dispatcher), cluster_(parent_.cm_.get(cluster_name)),
+      redis_cluster_(Config::Metadata::metadataValue(
+                         cluster_->info()->metadata(), Config::MetadataFilters::get().ENVOY_LB,
+                         Config::MetadataEnvoyLbKeys::get().REDIS_CLUSTER)
+                         .bool_value()) {
 
   // TODO(mattklein123): Redis is not currently safe for use with CDS. In order to make this work
   //                     we will need to add thread local cluster removal callbacks so that we can
@@ -211,6 +286,11 @@ InstanceImpl::ThreadLocalPool::ThreadLocalPool(InstanceImpl& parent, Event::Disp
              const std::vector<Upstream::HostSharedPtr>& hosts_removed) -> void {
         onHostsRemoved(hosts_removed);
       });
+
+  if (redis_cluster_) {
+    slots_refresh_timer_ = dispatcher_.createTimer([this]() -> void { refreshSlots(); });
+    slots_refresh_timer_->enableTimer(std::chrono::milliseconds(0));
+  }
 }
 
 InstanceImpl::ThreadLocalPool::~ThreadLocalPool() {
@@ -229,14 +309,53 @@ void InstanceImpl::ThreadLocalPool::onHostsRemoved(
       // we just close the connection. This will fail any pending requests.
       it->second->redis_client_->close();
     }
+
+    // Stop routing to a removed master or replica until the slot map has been refreshed.
+    for (const Shard& shard : slot_shards_) {
+      if (shard.master_ == host ||
+          std::find(shard.replicas_.begin(), shard.replicas_.end(), host) !=
+              shard.replicas_.end()) {
+        slot_shards_.clear();
+        slot_shard_indexes_.clear();
+        slots_refresh_timer_->enableTimer(std::chrono::milliseconds(0));
+        break;
+      }
+    }
   }
 }
 
 PoolRequest* InstanceImpl::ThreadLocalPool::makeRequest(const std::string& hash_key,
                                                         const RespValue& request,
                                                         PoolCallbacks& callbacks) {
-  LbContextImpl lb_context(hash_key);
-  Upstream::HostConstSharedPtr host = cluster_->loadBalancer().chooseHost(&lb_context);
+  if (!redis_cluster_) {
+    return makeRequestToHost(hostForKey(hash_key, false), request, callbacks);
+  }
+
+  ClusterRequestPtr cluster_request(new ClusterRequest(*this, request, callbacks));
+  cluster_request->handle_ =
+      makeRequestToHost(hostForKey(hash_key, parent_.isReadOnly(request)),
+                        cluster_request->request_, *cluster_request);
+  if (!cluster_request->handle_) {
+    return nullptr;
+  }
+
+  cluster_request->moveIntoList(std::move(cluster_request), cluster_requests_);
+  return cluster_requests_.front().get();
+}
+
+uint64_t InstanceImpl::ThreadLocalPool::keyGroup(const std::string& hash_key) {
+  // A Redis Cluster refuses multi key commands whose keys are in different slots, even if one
+  // master serves them all.
+  if (redis_cluster_) {
+    return ClusterSlotUtility::keySlot(hash_key);
+  }
+
+  return reinterpret_cast<uintptr_t>(hostForKey(hash_key, false).get());
+}
+
+PoolRequest* InstanceImpl::ThreadLocalPool::makeRequestToHost(Upstream::HostConstSharedPtr host,
+                                                              const RespValue& request,
+                                                              PoolCallbacks& callbacks) {
   if (!host) {
     return nullptr;
   }
@@ -247,11 +366,174 @@ PoolRequest* InstanceImpl::ThreadLocalPool::makeRequest(const std::string& hash_
     client->host_ = host;
     client->redis_client_ = parent_.client_factory_.create(host, dispatcher_, parent_.config_);
     client->redis_client_->addConnectionCallbacks(*client);
+
+    // A replica only serves reads of its slots on a connection that has sent READONLY. Masters
+    // ignore it, so every connection sends it rather than tracking which hosts are replicas.
+    if (redis_cluster_ && parent_.read_policy_ != ReadPolicy::Master) {
+      client->redis_client_->makeRequest(ClusterSlotUtility::readOnlyRequest(), null_callbacks_);
+    }
   }
 
   return client->redis_client_->makeRequest(request, callbacks);
 }
 
+Upstream::HostConstSharedPtr
+InstanceImpl::ThreadLocalPool::hostForKey(const std::string& hash_key, bool read_only) {
+  if (!slot_shard_indexes_.empty()) {
+    const uint16_t index = slot_shard_indexes_[ClusterSlotUtility::keySlot(hash_key)];
+    if (index != 0) {
+      const Shard& shard = slot_shards_[index - 1];
+      return read_only ? readHost(shard) : shard.master_;
+    }
+  }
+
+  LbContextImpl lb_context(hash_key);
+  return cluster_->loadBalancer().chooseHost(&lb_context);
+}
+
+Upstream::HostConstSharedPtr
+InstanceImpl::ThreadLocalPool::hostForAddress(const std::string& address) {
+  for (const auto& host_set : cluster_->prioritySet().hostSetsPerPriority()) {
+    for (const Upstream::HostSharedPtr& host : host_set->hosts()) {
+      if (host->address()->asString() == address) {
+        return host;
+      }
+    }
+  }
+
+  return nullptr;
+}
+
+Upstream::HostConstSharedPtr InstanceImpl::ThreadLocalPool::readHost(const Shard& shard) {
+  // Round robin over the healthy replicas, which the master joins for ReadPolicy::Any or when no
+  // replica is healthy. The master is the last choice.
+  uint32_t healthy_replicas = 0;
+  for (const Upstream::HostConstSharedPtr& replica : shard.replicas_) {
+    if (replica->healthy()) {
+      healthy_replicas++;
+    }
+  }
+
+  const bool include_master = parent_.read_policy_ == ReadPolicy::Any || healthy_replicas == 0;
+  uint32_t choice = next_read_host_++ % (healthy_replicas + (include_master ? 1 : 0));
+  for (const Upstream::HostConstSharedPtr& replica : shard.replicas_) {
+    if (replica->healthy() && choice-- == 0) {
+      return replica;
+    }
+  }
+
+  return shard.master_;
+}
+
+uint16_t InstanceImpl::ThreadLocalPool::shardIndex(Upstream::HostConstSharedPtr master) {
+  auto it = std::find_if(slot_shards_.begin(), slot_shards_.end(),
+                         [&master](const Shard& shard) { return shard.master_ == master; });
+  if (it == slot_shards_.end()) {
+    it = slot_shards_.insert(slot_shards_.end(), Shard{master, {}});
+  }
+  return static_cast<uint16_t>(it - slot_shards_.begin() + 1);
+}
+
+void InstanceImpl::ThreadLocalPool::setSlotHost(uint16_t slot, Upstream::HostConstSharedPtr host) {
+  if (slot_shard_indexes_.empty()) {
+    slot_shard_indexes_.resize(ClusterSlotUtility::SLOTS);
+  }
+
+  slot_shard_indexes_[slot] = shardIndex(host);
+}
+
+void InstanceImpl::ThreadLocalPool::refreshSlots() {
+  if (slots_request_) {
+    return;
+  }
+
+  slots_request_ = makeRequestToHost(cluster_->loadBalancer().chooseHost(nullptr),
+                                     ClusterSlotUtility::clusterSlotsRequest(), *this);
+  if (!slots_request_) {
+    slots_refresh_timer_->enableTimer(SLOTS_REFRESH_INTERVAL);
+  }
+}
+
+void InstanceImpl::ThreadLocalPool::onResponse(RespValuePtr&& value) {
+  slots_request_ = nullptr;
+  slots_refresh_timer_->enableTimer(SLOTS_REFRESH_INTERVAL);
+
+  std::vector<ClusterSlotUtility::SlotRange> ranges;
+  if (!ClusterSlotUtility::parseClusterSlots(*value, ranges)) {
+    return;
+  }
+
+  // Slots whose master is not one of the cluster's hosts fall back to the load balancer. Replicas
+  // that are not hosts of the cluster are left out.
+  slot_shards_.clear();
+  slot_shard_indexes_.assign(ClusterSlotUtility::SLOTS, 0);
+  for (const ClusterSlotUtility::SlotRange& range : ranges) {
+    Upstream::HostConstSharedPtr host = hostForAddress(range.address_);
+    if (!host) {
+      continue;
+    }
+
+    const uint16_t index = shardIndex(host);
+    Shard& shard = slot_shards_[index - 1];
+    shard.replicas_.clear();
+    for (const std::string& replica_address : range.replica_addresses_) {
+      Upstream::HostConstSharedPtr replica = hostForAddress(replica_address);
+      if (replica) {
+        shard.replicas_.push_back(replica);
+      }
+    }
+    std::fill(slot_shard_indexes_.begin() + range.start_,
+              slot_shard_indexes_.begin() + range.end_ + 1, index);
+  }
+}
+
+void InstanceImpl::ThreadLocalPool::onFailure() {
+  slots_request_ = nullptr;
+  slots_refresh_timer_->enableTimer(SLOTS_REFRESH_INTERVAL);
+}
+
+void InstanceImpl::ClusterRequest::cancel() {
+  handle_->cancel();
+  removeFromList(parent_.cluster_requests_);
+}
+
+void InstanceImpl::ClusterRequest::onResponse(RespValuePtr&& value) {
+  handle_ = nullptr;
+
+  ClusterSlotUtility::Redirection redirection;
+  if (redirections_ < MAX_REDIRECTIONS &&
+      ClusterSlotUtility::parseRedirection(*value, redirection)) {
+    Upstream::HostConstSharedPtr host = parent_.hostForAddress(redirection.address_);
+    if (host) {
+      redirections_++;
+      if (redirection.ask_) {
+        // The slot is being migrated. Only this request goes to the new node, preceded by ASKING
+        // on the same connection.
+        parent_.makeRequestToHost(host, ClusterSlotUtility::askingRequest(),
+                                  parent_.null_callbacks_);
+      } else {
+        // The slot has moved for good. Use the new master right away and refresh the whole map,
+        // since a resharding rarely moves a single slot.
+        parent_.setSlotHost(redirection.slot_, host);
+        parent_.slots_refresh_timer_->enableTimer(std::chrono::milliseconds(0));
+      }
+
+      handle_ = parent_.makeRequestToHost(host, request_, *this);
+      if (handle_) {
+        return;
+      }
+    }
+  }
+
+  ClusterRequestPtr request = removeFromList(parent_.cluster_requests_);
+  callbacks_.onResponse(std::move(value));
+}
+
+void InstanceImpl::ClusterRequest::onFailure() {
+  ClusterRequestPtr request = removeFromList(parent_.cluster_requests_);
+  callbacks_.onFailure();
+}
+
 void InstanceImpl::ThreadLocalActiveClient::onEvent(Network::ConnectionEvent event) {
   if (event == Network::ConnectionEvent::RemoteClose ||
       event == Network::ConnectionEvent::LocalClose) {
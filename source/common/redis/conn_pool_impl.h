@@ -6,6 +6,7 @@
 #include <memory>
 #include <string>
 #include <unordered_map>
+#include <unordered_set>
 #include <vector>
 
 #include "envoy/redis/conn_pool.h"
@@ -13,8 +14,11 @@
 #include "envoy/upstream/cluster_manager.h"
 
 #include "common/buffer/buffer_impl.h"
+#include "common/common/linked_object.h"
+#include "common/common/to_lower_table.h"
 #include "common/network/filter_impl.h"
 #include "common/protobuf/utility.h"
+#include "common/redis/cluster_slots.h"
 #include "common/redis/codec_impl.h"
 
 #include "api/filter/network/redis_proxy.pb.h"
@@ -52,6 +56,10 @@ public:
   void close() override;
   PoolRequest* makeRequest(const RespValue& request, PoolCallbacks& callbacks) override;
 
+  // Once this many bytes of requests are batched they are written without waiting for the end of
+  // the event loop iteration.
+  static const uint64_t MAX_BATCH_BYTES = 64 * 1024;
+
 private:
   struct UpstreamReadFilter : public Network::ReadFilterBaseImpl {
     UpstreamReadFilter(ClientImpl& parent) : parent_(parent) {}
@@ -79,6 +87,7 @@ private:
 
   ClientImpl(Upstream::HostConstSharedPtr host, Event::Dispatcher& dispatcher, EncoderPtr&& encoder,
              DecoderFactory& decoder_factory, const Config& config);
+  void flushBatch();
   void onConnectOrOpTimeout();
   void onData(Buffer::Instance& data);
   void putOutlierEvent(Upstream::Outlier::Result result);
@@ -99,6 +108,11 @@ private:
   const Config& config_;
   std::list<PendingRequest> pending_requests_;
   Event::TimerPtr connect_or_op_timer_;
+  // Requests made during one event loop iteration are encoded into encoder_buffer_ and written
+  // together when this zero delay timer fires.
+  Event::TimerPtr flush_timer_;
+  uint64_t batched_requests_{};
+  Stats::Histogram& batch_size_;
   bool connected_{};
 };
 
@@ -116,6 +130,13 @@ private:
 
 class InstanceImpl : public Instance {
 public:
+  /**
+   * Where read only commands to a Redis Cluster are sent, see
+   * Config::MetadataEnvoyLbKeyValues::REDIS_READ_POLICY. Replicas are only known from CLUSTER
+   * SLOTS, so the policy does not apply to other clusters.
+   */
+  enum class ReadPolicy { Master, PreferReplica, Any };
+
   InstanceImpl(const std::string& cluster_name, Upstream::ClusterManager& cm,
                ClientFactory& client_factory, ThreadLocal::SlotAllocator& tls,
                const envoy::api::v2::filter::network::RedisProxy::ConnPoolSettings& config);
@@ -123,6 +144,7 @@ public:
   // Redis::ConnPool::Instance
   PoolRequest* makeRequest(const std::string& hash_key, const RespValue& request,
                            PoolCallbacks& callbacks) override;
+  uint64_t keyGroup(const std::string& hash_key) override;
 
 private:
   struct ThreadLocalPool;
@@ -142,19 +164,92 @@ private:
 
   typedef std::unique_ptr<ThreadLocalActiveClient> ThreadLocalActiveClientPtr;
 
-  struct ThreadLocalPool : public ThreadLocal::ThreadLocalObject {
+  /**
+   * A request to a Redis Cluster. It keeps a copy of the request so that it can follow MOVED and
+   * ASK redirections to the node that now serves the key.
+   */
+  struct ClusterRequest : public PoolRequest,
+                          public PoolCallbacks,
+                          public LinkedObject<ClusterRequest> {
+    ClusterRequest(ThreadLocalPool& parent, const RespValue& request, PoolCallbacks& callbacks)
+        : parent_(parent), request_(request), callbacks_(callbacks) {}
+
+    // Redis::ConnPool::PoolRequest
+    void cancel() override;
+
+    // Redis::ConnPool::PoolCallbacks
+    void onResponse(RespValuePtr&& value) override;
+    void onFailure() override;
+
+    ThreadLocalPool& parent_;
+    const RespValue request_;
+    PoolCallbacks& callbacks_;
+    PoolRequest* handle_{};
+    uint32_t redirections_{};
+  };
+
+  typedef std::unique_ptr<ClusterRequest> ClusterRequestPtr;
+
+  /**
+   * Swallows the responses to ASKING commands.
+   */
+  struct NullPoolCallbacks : public PoolCallbacks {
+    // Redis::ConnPool::PoolCallbacks
+    void onResponse(RespValuePtr&&) override {}
+    void onFailure() override {}
+  };
+
+  /**
+   * A master of a Redis Cluster and those of its replicas that are hosts of the cluster.
+   */
+  struct Shard {
+    Upstream::HostConstSharedPtr master_;
+    std::vector<Upstream::HostConstSharedPtr> replicas_;
+  };
+
+  /**
+   * Per worker connections to the hosts of the cluster. If the cluster is a Redis Cluster (see
+   * Config::MetadataEnvoyLbKeyValues::REDIS_CLUSTER), the pool also discovers which master serves
+   * each slot with CLUSTER SLOTS and routes keys to it directly, or to its replicas for read only
+   * commands if the read policy allows. Responses to the CLUSTER SLOTS requests arrive on the
+   * pool's own PoolCallbacks.
+   */
+  struct ThreadLocalPool : public ThreadLocal::ThreadLocalObject, public PoolCallbacks {
     ThreadLocalPool(InstanceImpl& parent, Event::Dispatcher& dispatcher,
                     const std::string& cluster_name);
     ~ThreadLocalPool();
     PoolRequest* makeRequest(const std::string& hash_key, const RespValue& request,
                              PoolCallbacks& callbacks);
+    uint64_t keyGroup(const std::string& hash_key);
+    PoolRequest* makeRequestToHost(Upstream::HostConstSharedPtr host, const RespValue& request,
+                                   PoolCallbacks& callbacks);
+    Upstream::HostConstSharedPtr hostForKey(const std::string& hash_key, bool read_only);
+    Upstream::HostConstSharedPtr hostForAddress(const std::string& address);
+    Upstream::HostConstSharedPtr readHost(const Shard& shard);
+    uint16_t shardIndex(Upstream::HostConstSharedPtr master);
+    void setSlotHost(uint16_t slot, Upstream::HostConstSharedPtr host);
+    void refreshSlots();
     void onHostsRemoved(const std::vector<Upstream::HostSharedPtr>& hosts_removed);
 
+    // Redis::ConnPool::PoolCallbacks
+    void onResponse(RespValuePtr&& value) override;
+    void onFailure() override;
+
     InstanceImpl& parent_;
     Event::Dispatcher& dispatcher_;
     Upstream::ThreadLocalCluster* cluster_;
     std::unordered_map<Upstream::HostConstSharedPtr, ThreadLocalActiveClientPtr> client_map_;
     Common::CallbackHandle* local_host_set_member_update_cb_handle_;
+    const bool redis_cluster_;
+    // The shards of the slot map, and for each slot one plus the index of its shard in
+    // slot_shards_, or 0 if the master is not known. Empty until the first CLUSTER SLOTS response.
+    std::vector<Shard> slot_shards_;
+    std::vector<uint16_t> slot_shard_indexes_;
+    uint32_t next_read_host_{};
+    Event::TimerPtr slots_refresh_timer_;
+    PoolRequest* slots_request_{};
+    std::list<ClusterRequestPtr> cluster_requests_;
+    NullPoolCallbacks null_callbacks_;
   };
 
   struct LbContextImpl : public Upstream::LoadBalancerContext {
@@ -168,10 +263,21 @@ private:
     const Optional<uint64_t> hash_key_;
   };
 
+  bool isReadOnly(const RespValue& request) const;
+
+  // How often each worker refreshes its slot map of a Redis Cluster. MOVED redirections also make
+  // it refresh.
+  static const std::chrono::milliseconds SLOTS_REFRESH_INTERVAL;
+  // How many MOVED or ASK redirections a request follows before its error is returned.
+  static const uint32_t MAX_REDIRECTIONS = 3;
+
   Upstream::ClusterManager& cm_;
   ClientFactory& client_factory_;
   ThreadLocal::SlotPtr tls_;
   ConfigImpl config_;
+  ReadPolicy read_policy_{ReadPolicy::Master};
+  std::unordered_set<std::string> read_only_commands_;
+  const ToLowerTable to_lower_table_;
 };
 
 } // namespace ConnPool
@@ -42,6 +42,20 @@ struct SupportedCommands {
     CONSTRUCT_ON_FIRST_USE(std::vector<std::string>, "del", "exists", "touch", "unlink");
   }
 
+  /**
+   * @return commands which only read, and so may be served by a replica. This includes the
+   *         commands that mget and the multiple key commands are split into.
+   */
+  static const std::vector<std::string>& readOnlyCommands() {
+    CONSTRUCT_ON_FIRST_USE(
+        std::vector<std::string>, "bitcount", "bitpos", "dump", "exists", "geodist", "geohash",
+        "geopos", "get", "getbit", "getrange", "hexists", "hget", "hgetall", "hkeys", "hlen",
+        "hmget", "hscan", "hstrlen", "hvals", "lindex", "llen", "lrange", "mget", "pttl", "scard",
+        "sismember", "smembers", "srandmember", "sscan", "strlen", "ttl", "type", "zcard", "zcount",
+        "zlexcount", "zrange", "zrangebylex", "zrangebyscore", "zrank", "zrevrange",
+        "zrevrangebylex", "zrevrangebyscore", "zrevrank", "zscan", "zscore");
+  }
+
   /**
    * @return mget command
    */
@@ -22,16 +22,49 @@ struct RequestInfoImpl : public RequestInfo {
     return request_received_duration_;
   }
   void requestReceivedDuration(MonotonicTime time) override {
-    request_received_duration_ =
-        std::chrono::duration_cast<std::chrono::microseconds>(time - start_time_monotonic_);
+    request_received_duration_ = sinceStart(time);
   }
 
   const Optional<std::chrono::microseconds>& responseReceivedDuration() const override {
     return response_received_duration_;
   }
   void responseReceivedDuration(MonotonicTime time) override {
-    response_received_duration_ =
-        std::chrono::duration_cast<std::chrono::microseconds>(time - start_time_monotonic_);
+    response_received_duration_ = sinceStart(time);
+  }
+
+  const Optional<std::chrono::microseconds>& upstreamConnectStartDuration() const override {
+    return upstream_connect_start_duration_;
+  }
+  void upstreamConnectStartDuration(MonotonicTime time) override {
+    upstream_connect_start_duration_ = sinceStart(time);
+  }
+
+  const Optional<std::chrono::microseconds>& upstreamConnectEndDuration() const override {
+    return upstream_connect_end_duration_;
+  }
+  void upstreamConnectEndDuration(MonotonicTime time) override {
+    upstream_connect_end_duration_ = sinceStart(time);
+  }
+
+  const Optional<std::chrono::microseconds>& upstreamLastByteReceivedDuration() const override {
+    return upstream_last_byte_received_duration_;
+  }
+  void upstreamLastByteReceivedDuration(MonotonicTime time) override {
+    upstream_last_byte_received_duration_ = sinceStart(time);
+  }
+
+  const Optional<std::chrono::microseconds>& downstreamFirstByteSentDuration() const override {
+    return downstream_first_byte_sent_duration_;
+  }
+  void downstreamFirstByteSentDuration(MonotonicTime time) override {
+    downstream_first_byte_sent_duration_ = sinceStart(time);
+  }
+
+  const Optional<std::chrono::microseconds>& downstreamLastByteSentDuration() const override {
+    return downstream_last_byte_sent_duration_;
+  }
+  void downstreamLastByteSentDuration(MonotonicTime time) override {
+    downstream_last_byte_sent_duration_ = sinceStart(time);
   }
 
   uint64_t bytesReceived() const override { return bytes_received_; }
@@ -74,11 +107,20 @@ struct RequestInfoImpl : public RequestInfo {
     return downstream_remote_address_;
   }
 
+  std::chrono::microseconds sinceStart(MonotonicTime time) const {
+    return std::chrono::duration_cast<std::chrono::microseconds>(time - start_time_monotonic_);
+  }
+
   Optional<Http::Protocol> protocol_;
   const SystemTime start_time_;
   const MonotonicTime start_time_monotonic_;
   Optional<std::chrono::microseconds> request_received_duration_;
   Optional<std::chrono::microseconds> response_received_duration_;
+  Optional<std::chrono::microseconds> upstream_connect_start_duration_;
+  Optional<std::chrono::microseconds> upstream_connect_end_duration_;
+  Optional<std::chrono::microseconds> upstream_last_byte_received_duration_;
+  Optional<std::chrono::microseconds> downstream_first_byte_sent_duration_;
+  Optional<std::chrono::microseconds> downstream_last_byte_sent_duration_;
   uint64_t bytes_received_{};
   Optional<uint32_t> response_code_;
   uint64_t bytes_sent_{};
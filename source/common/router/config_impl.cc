@@ -2,10 +2,10 @@
 
 #include <algorithm>
 #include <chrono>
+#include <cmath>
 #include <cstdint>
 #include <map>
 #include <memory>
-#include <regex>
 #include <string>
 #include <vector>
 
@@ -31,11 +31,118 @@
 namespace Envoy {
 namespace Router {
 
+namespace {
+
+uint64_t opaqueConfigInteger(const std::multimap<std::string, std::string>& opaque_config,
+                             const std::string& key, uint64_t min, uint64_t max,
+                             uint64_t default_value) {
+  const auto entry = opaque_config.find(key);
+  if (entry == opaque_config.end()) {
+    return default_value;
+  }
+  uint64_t value;
+  if (!StringUtil::atoul(entry->second.c_str(), value) || value < min || value > max) {
+    throw EnvoyException(fmt::format(
+        "route: invalid '{}' value '{}', must be an integer in [{}, {}]", key, entry->second, min,
+        max));
+  }
+  return value;
+}
+
+} // namespace
+
 std::string SslRedirector::newPath(const Http::HeaderMap& headers) const {
   return Http::Utility::createSslRedirectPath(headers);
 }
 
-RetryPolicyImpl::RetryPolicyImpl(const envoy::api::v2::RouteAction& config) {
+HedgePolicyImpl::HedgePolicyImpl(uint32_t percentile, uint32_t budget_percent,
+                                 std::chrono::milliseconds min_delay)
+    : percentile_(percentile), budget_percent_(budget_percent), min_delay_(min_delay) {}
+
+std::unique_ptr<const HedgePolicyImpl>
+HedgePolicyImpl::create(const std::multimap<std::string, std::string>& opaque_config) {
+  const auto percentile = opaque_config.find("hedge_percentile");
+  if (percentile == opaque_config.end()) {
+    return nullptr;
+  }
+
+  return std::unique_ptr<const HedgePolicyImpl>{new HedgePolicyImpl(
+      opaqueConfigInteger(opaque_config, percentile->first, 1, 99, 0),
+      opaqueConfigInteger(opaque_config, "hedge_budget_percent", 0, 100, DefaultBudgetPercent),
+      std::chrono::milliseconds(
+          opaqueConfigInteger(opaque_config, "hedge_min_delay_ms", 0, UINT32_MAX, 0)))};
+}
+
+size_t HedgePolicyImpl::bucket(std::chrono::milliseconds time) {
+  if (time.count() <= 1) {
+    return 0;
+  }
+  // Bucket i holds the times in (1.25^(i-1), 1.25^i] ms.
+  const double index = std::ceil(std::log(static_cast<double>(time.count())) / std::log(1.25));
+  return std::min(static_cast<size_t>(index), NumBuckets - 1);
+}
+
+std::chrono::milliseconds HedgePolicyImpl::bucketBound(size_t bucket) {
+  return std::chrono::milliseconds(
+      static_cast<uint64_t>(std::ceil(std::pow(1.25, static_cast<double>(bucket)))));
+}
+
+std::chrono::milliseconds HedgePolicyImpl::hedgeDelay() const {
+  uint64_t counts[NumBuckets];
+  uint64_t total = 0;
+  for (size_t i = 0; i < NumBuckets; i++) {
+    counts[i] = buckets_[i].load(std::memory_order_relaxed);
+    total += counts[i];
+  }
+  if (total < MinSamples) {
+    return std::chrono::milliseconds(0);
+  }
+
+  const uint64_t rank = (total * percentile_ + 99) / 100;
+  uint64_t seen = 0;
+  size_t i = 0;
+  for (; i < NumBuckets - 1; i++) {
+    seen += counts[i];
+    if (seen >= rank) {
+      break;
+    }
+  }
+  return std::max(min_delay_, bucketBound(i));
+}
+
+void HedgePolicyImpl::recordResponseTime(std::chrono::milliseconds time) const {
+  buckets_[bucket(time)].fetch_add(1, std::memory_order_relaxed);
+  if (samples_.fetch_add(1, std::memory_order_relaxed) + 1 >= WindowSamples) {
+    decay();
+  }
+}
+
+bool HedgePolicyImpl::tryHedge() const {
+  const uint64_t hedges = hedges_.fetch_add(1, std::memory_order_relaxed) + 1;
+  if (hedges * 100 > samples_.load(std::memory_order_relaxed) * budget_percent_) {
+    hedges_.fetch_sub(1, std::memory_order_relaxed);
+    return false;
+  }
+  return true;
+}
+
+void HedgePolicyImpl::decay() const {
+  std::unique_lock<std::mutex> lock(decay_lock_, std::try_to_lock);
+  if (!lock.owns_lock() || samples_.load() < WindowSamples) {
+    return;
+  }
+  for (std::atomic<uint64_t>& count : buckets_) {
+    count.store(count.load() / 2);
+  }
+  samples_.store(samples_.load() / 2);
+  hedges_.store(hedges_.load() / 2);
+}
+
+RetryPolicyImpl::RetryPolicyImpl(const envoy::api::v2::RouteAction& config,
+                                 const std::multimap<std::string, std::string>& opaque_config)
+    : hedge_policy_(HedgePolicyImpl::create(opaque_config)),
+      max_replay_bytes_(
+          opaqueConfigInteger(opaque_config, "retry_max_replay_bytes", 0, UINT64_MAX, UINT64_MAX)) {
   if (!config.has_retry_policy()) {
     return;
   }
@@ -50,6 +157,14 @@ RetryPolicyImpl::RetryPolicyImpl(const envoy::api::v2::RouteAction& config) {
 CorsPolicyImpl::CorsPolicyImpl(const envoy::api::v2::CorsPolicy& config) {
   for (const auto& origin : config.allow_origin()) {
     allow_origin_.push_back(origin);
+    const std::string& allowed = allow_origin_.back();
+    if (allowed == "*") {
+      allow_any_origin_ = true;
+    } else if (allowed.size() > 2 && allowed.compare(0, 2, "*.") == 0) {
+      origin_suffixes_.emplace_back(allowed.data() + 1, allowed.size() - 1);
+    } else {
+      exact_origins_.emplace(allowed);
+    }
   }
   allow_methods_ = config.allow_methods();
   allow_headers_ = config.allow_headers();
@@ -61,7 +176,27 @@ CorsPolicyImpl::CorsPolicyImpl(const envoy::api::v2::CorsPolicy& config) {
   enabled_ = PROTOBUF_GET_WRAPPED_OR_DEFAULT(config, enabled, true);
 }
 
-ShadowPolicyImpl::ShadowPolicyImpl(const envoy::api::v2::RouteAction& config) {
+bool CorsPolicyImpl::allowsOrigin(const Http::HeaderString& origin) const {
+  if (allow_any_origin_) {
+    return true;
+  }
+
+  const absl::string_view value(origin.c_str(), origin.size());
+  if (exact_origins_.count(value) > 0) {
+    return true;
+  }
+  for (const absl::string_view suffix : origin_suffixes_) {
+    if (value.size() > suffix.size() && value.substr(value.size() - suffix.size()) == suffix) {
+      return true;
+    }
+  }
+  return false;
+}
+
+ShadowPolicyImpl::ShadowPolicyImpl(const envoy::api::v2::RouteAction& config,
+                                   const std::multimap<std::string, std::string>& opaque_config)
+    : max_body_bytes_(opaqueConfigInteger(opaque_config, "shadow_max_body_bytes", 0, UINT64_MAX,
+                                          DefaultMaxBodyBytes)) {
   if (!config.has_request_mirror_policy()) {
     return;
   }
@@ -218,25 +353,30 @@ const std::string& DecoratorImpl::getOperation() const { return operation_; }
 const uint64_t RouteEntryImplBase::WeightedClusterEntry::MAX_CLUSTER_WEIGHT = 100UL;
 
 RouteEntryImplBase::RouteEntryImplBase(const VirtualHostImpl& vhost,
-                                       const envoy::api::v2::Route& route, Runtime::Loader& loader)
+                                       const envoy::api::v2::Route& route, Runtime::Loader& loader,
+                                       Upstream::ClusterManager& cm)
     : case_sensitive_(PROTOBUF_GET_WRAPPED_OR_DEFAULT(route.match(), case_sensitive, true)),
       prefix_rewrite_(route.route().prefix_rewrite()), host_rewrite_(route.route().host_rewrite()),
       vhost_(vhost),
       auto_host_rewrite_(PROTOBUF_GET_WRAPPED_OR_DEFAULT(route.route(), auto_host_rewrite, false)),
       use_websocket_(PROTOBUF_GET_WRAPPED_OR_DEFAULT(route.route(), use_websocket, false)),
-      cluster_name_(route.route().cluster()), cluster_header_name_(route.route().cluster_header()),
+      cluster_name_(route.route().cluster()),
+      cluster_handle_(cluster_name_.empty() ? nullptr : cm.clusterHandle(cluster_name_)),
+      cluster_header_name_(route.route().cluster_header()),
       cluster_not_found_response_code_(ConfigUtility::parseClusterNotFoundResponseCode(
           route.route().cluster_not_found_response_code())),
       timeout_(PROTOBUF_GET_MS_OR_DEFAULT(route.route(), timeout, DEFAULT_ROUTE_TIMEOUT_MS)),
       runtime_(loadRuntimeData(route.match())), loader_(loader),
       host_redirect_(route.redirect().host_redirect()),
-      path_redirect_(route.redirect().path_redirect()), retry_policy_(route.route()),
-      rate_limit_policy_(route.route().rate_limits()), shadow_policy_(route.route()),
+      path_redirect_(route.redirect().path_redirect()), opaque_config_(parseOpaqueConfig(route)),
+      retry_policy_(route.route(), opaque_config_),
+      rate_limit_policy_(route.route().rate_limits()),
+      shadow_policy_(route.route(), opaque_config_),
       priority_(ConfigUtility::parsePriority(route.route().priority())),
       request_headers_parser_(HeaderParser::configure(route.route().request_headers_to_add())),
       response_headers_parser_(HeaderParser::configure(route.route().response_headers_to_add(),
                                                        route.route().response_headers_to_remove())),
-      opaque_config_(parseOpaqueConfig(route)), decorator_(parseDecorator(route)),
+      decorator_(parseDecorator(route)),
       redirect_response_code_(
           ConfigUtility::parseRedirectResponseCode(route.redirect().response_code())) {
   if (route.route().has_metadata_match()) {
@@ -274,25 +414,26 @@ RouteEntryImplBase::RouteEntryImplBase(const VirtualHostImpl& vhost,
       }
 
       std::unique_ptr<WeightedClusterEntry> cluster_entry(
-          new WeightedClusterEntry(this, runtime_key_prefix + "." + cluster_name, loader_,
-                                   cluster_name, PROTOBUF_GET_WRAPPED_REQUIRED(cluster, weight),
+          new WeightedClusterEntry(this, runtime_key_prefix + "." + cluster_name, cm, cluster_name,
+                                   PROTOBUF_GET_WRAPPED_REQUIRED(cluster, weight),
                                    std::move(cluster_metadata_match_criteria)));
       weighted_clusters_.emplace_back(std::move(cluster_entry));
-      total_weight += weighted_clusters_.back()->clusterWeight();
+      total_weight += weighted_clusters_.back()->clusterWeight(loader_.snapshot());
     }
 
     if (total_weight != WeightedClusterEntry::MAX_CLUSTER_WEIGHT) {
       throw EnvoyException(fmt::format("Sum of weights in the weighted_cluster should add up to {}",
                                        WeightedClusterEntry::MAX_CLUSTER_WEIGHT));
     }
+    weighted_cluster_table_ = buildWeightedClusterTable(loader_.snapshot());
   }
 
   for (const auto& header_map : route.match().headers()) {
-    config_headers_.push_back(header_map);
+    config_headers_.emplace_back(header_map, vhost_.regexEngine());
   }
 
   for (const auto& query_parameter : route.match().query_parameters()) {
-    config_query_parameters_.push_back(query_parameter);
+    config_query_parameters_.emplace_back(query_parameter, vhost_.regexEngine());
   }
 
   if (!route.route().hash_policy().empty()) {
@@ -310,7 +451,14 @@ RouteEntryImplBase::RouteEntryImplBase(const VirtualHostImpl& vhost,
   }
 }
 
-bool RouteEntryImplBase::matchRoute(const Http::HeaderMap& headers, uint64_t random_value) const {
+void RouteEntryImplBase::indexHeaders(ConfigUtility::HeaderNameIndex& header_names) {
+  for (ConfigUtility::HeaderData& config_header : config_headers_) {
+    config_header.name_slot_ = header_names.add(config_header.name_);
+  }
+}
+
+bool RouteEntryImplBase::matchRoute(uint64_t random_value,
+                                    ConfigUtility::MatchContext& context) const {
   bool matches = true;
 
   if (runtime_.valid()) {
@@ -318,11 +466,9 @@ bool RouteEntryImplBase::matchRoute(const Http::HeaderMap& headers, uint64_t ran
                                                  random_value);
   }
 
-  matches &= ConfigUtility::matchHeaders(headers, config_headers_);
+  matches &= ConfigUtility::matchHeaders(context, config_headers_);
   if (!config_query_parameters_.empty()) {
-    Http::Utility::QueryParams query_parameters =
-        Http::Utility::parseQueryString(headers.Path()->value().c_str());
-    matches &= ConfigUtility::matchQueryParams(query_parameters, config_query_parameters_);
+    matches &= ConfigUtility::matchQueryParams(context.queryParams(), config_query_parameters_);
   }
 
   return matches;
@@ -465,27 +611,45 @@ RouteConstSharedPtr RouteEntryImplBase::clusterEntry(const Http::HeaderMap& head
     }
   }
 
-  uint64_t selected_value = random_value % WeightedClusterEntry::MAX_CLUSTER_WEIGHT;
-  uint64_t begin = 0UL;
-  uint64_t end = 0UL;
+  // The weights only change with the runtime, so the cluster each value selects is looked up in
+  // a table that is computed once per runtime snapshot.
+  const Runtime::Snapshot& snapshot = loader_.snapshot();
+  WeightedClusterTableConstSharedPtr table = std::atomic_load(&weighted_cluster_table_);
+  if (table->runtime_version_ != snapshot.version()) {
+    table = buildWeightedClusterTable(snapshot);
+    std::atomic_store(&weighted_cluster_table_, table);
+  }
+  const uint64_t selected_value = random_value % WeightedClusterEntry::MAX_CLUSTER_WEIGHT;
+  return weighted_clusters_[table->clusters_[selected_value]];
+}
+
+RouteEntryImplBase::WeightedClusterTableConstSharedPtr
+RouteEntryImplBase::buildWeightedClusterTable(const Runtime::Snapshot& snapshot) const {
+  std::shared_ptr<WeightedClusterTable> table = std::make_shared<WeightedClusterTable>();
+  table->runtime_version_ = snapshot.version();
+  table->clusters_.reserve(WeightedClusterEntry::MAX_CLUSTER_WEIGHT);
 
-  // Find the right cluster to route to based on the interval in which
-  // the selected value falls. The intervals are determined as
+  // Each cluster is selected by the values in its interval. The intervals are determined as
   // [0, cluster1_weight), [cluster1_weight, cluster1_weight+cluster2_weight),..
+  uint32_t index = 0;
   for (const WeightedClusterEntrySharedPtr& cluster : weighted_clusters_) {
-    end = begin + cluster->clusterWeight();
-    if (((selected_value >= begin) && (selected_value < end)) ||
-        (end >= WeightedClusterEntry::MAX_CLUSTER_WEIGHT)) {
-      // end > WeightedClusterEntry::MAX_CLUSTER_WEIGHT : This case can only occur
-      // with Runtimes, when the user specifies invalid weights such that
-      // sum(weights) > WeightedClusterEntry::MAX_CLUSTER_WEIGHT.
-      // In this case, terminate the search and just return the cluster
-      // whose weight cased the overflow
-      return cluster;
+    const uint64_t begin = table->clusters_.size();
+    const uint64_t end = begin + std::min(cluster->clusterWeight(snapshot),
+                                          WeightedClusterEntry::MAX_CLUSTER_WEIGHT - begin);
+    table->clusters_.resize(end, index);
+    if (end == WeightedClusterEntry::MAX_CLUSTER_WEIGHT) {
+      // With runtime, the user may specify invalid weights such that
+      // sum(weights) > WeightedClusterEntry::MAX_CLUSTER_WEIGHT. In this case the cluster whose
+      // weight caused the overflow takes the remaining values.
+      break;
     }
-    begin = end;
+    index++;
   }
-  NOT_REACHED;
+
+  // Invalid runtime weights may also add up to less than WeightedClusterEntry::MAX_CLUSTER_WEIGHT,
+  // in which case the last cluster takes the values that are left.
+  table->clusters_.resize(WeightedClusterEntry::MAX_CLUSTER_WEIGHT, weighted_clusters_.size() - 1);
+  return table;
 }
 
 void RouteEntryImplBase::validateClusters(Upstream::ClusterManager& cm) const {
@@ -515,8 +679,8 @@ void RouteEntryImplBase::validateClusters(Upstream::ClusterManager& cm) const {
 
 PrefixRouteEntryImpl::PrefixRouteEntryImpl(const VirtualHostImpl& vhost,
                                            const envoy::api::v2::Route& route,
-                                           Runtime::Loader& loader)
-    : RouteEntryImplBase(vhost, route, loader), prefix_(route.match().prefix()) {}
+                                           Runtime::Loader& loader, Upstream::ClusterManager& cm)
+    : RouteEntryImplBase(vhost, route, loader, cm), prefix_(route.match().prefix()) {}
 
 void PrefixRouteEntryImpl::finalizeRequestHeaders(
     Http::HeaderMap& headers, const RequestInfo::RequestInfo& request_info) const {
@@ -526,8 +690,9 @@ void PrefixRouteEntryImpl::finalizeRequestHeaders(
 }
 
 RouteConstSharedPtr PrefixRouteEntryImpl::matches(const Http::HeaderMap& headers,
-                                                  uint64_t random_value) const {
-  if (RouteEntryImplBase::matchRoute(headers, random_value) &&
+                                                  uint64_t random_value,
+                                                  ConfigUtility::MatchContext& context) const {
+  if (RouteEntryImplBase::matchRoute(random_value, context) &&
       StringUtil::startsWith(headers.Path()->value().c_str(), prefix_, case_sensitive_)) {
     return clusterEntry(headers, random_value);
   }
@@ -535,8 +700,9 @@ RouteConstSharedPtr PrefixRouteEntryImpl::matches(const Http::HeaderMap& headers
 }
 
 PathRouteEntryImpl::PathRouteEntryImpl(const VirtualHostImpl& vhost,
-                                       const envoy::api::v2::Route& route, Runtime::Loader& loader)
-    : RouteEntryImplBase(vhost, route, loader), path_(route.match().path()) {}
+                                       const envoy::api::v2::Route& route, Runtime::Loader& loader,
+                                       Upstream::ClusterManager& cm)
+    : RouteEntryImplBase(vhost, route, loader, cm), path_(route.match().path()) {}
 
 void PathRouteEntryImpl::finalizeRequestHeaders(
     Http::HeaderMap& headers, const RequestInfo::RequestInfo& request_info) const {
@@ -546,8 +712,9 @@ void PathRouteEntryImpl::finalizeRequestHeaders(
 }
 
 RouteConstSharedPtr PathRouteEntryImpl::matches(const Http::HeaderMap& headers,
-                                                uint64_t random_value) const {
-  if (RouteEntryImplBase::matchRoute(headers, random_value)) {
+                                                uint64_t random_value,
+                                                ConfigUtility::MatchContext& context) const {
+  if (RouteEntryImplBase::matchRoute(random_value, context)) {
     const Http::HeaderString& path = headers.Path()->value();
     const char* query_string_start = Http::Utility::findQueryStringStart(path);
     size_t compare_length = path.size();
@@ -575,9 +742,9 @@ RouteConstSharedPtr PathRouteEntryImpl::matches(const Http::HeaderMap& headers,
 
 RegexRouteEntryImpl::RegexRouteEntryImpl(const VirtualHostImpl& vhost,
                                          const envoy::api::v2::Route& route,
-                                         Runtime::Loader& loader)
-    : RouteEntryImplBase(vhost, route, loader),
-      regex_(std::regex{route.match().regex().c_str(), std::regex::optimize}) {}
+                                         Runtime::Loader& loader, Upstream::ClusterManager& cm)
+    : RouteEntryImplBase(vhost, route, loader, cm),
+      regex_(Regex::Utility::parseRegex(route.match().regex(), vhost.regexEngine())) {}
 
 void RegexRouteEntryImpl::finalizeRequestHeaders(
     Http::HeaderMap& headers, const RequestInfo::RequestInfo& request_info) const {
@@ -585,27 +752,45 @@ void RegexRouteEntryImpl::finalizeRequestHeaders(
 
   const Http::HeaderString& path = headers.Path()->value();
   const char* query_string_start = Http::Utility::findQueryStringStart(path);
-  ASSERT(std::regex_match(path.c_str(), query_string_start, regex_));
+  ASSERT(regex_->match(path.c_str(), query_string_start));
   std::string matched_path(path.c_str(), query_string_start);
   finalizePathHeader(headers, matched_path);
 }
 
 RouteConstSharedPtr RegexRouteEntryImpl::matches(const Http::HeaderMap& headers,
-                                                 uint64_t random_value) const {
-  if (RouteEntryImplBase::matchRoute(headers, random_value)) {
+                                                 uint64_t random_value,
+                                                 ConfigUtility::MatchContext& context) const {
+  if (RouteEntryImplBase::matchRoute(random_value, context)) {
     const Http::HeaderString& path = headers.Path()->value();
-    const char* query_string_start = Http::Utility::findQueryStringStart(path);
-    if (std::regex_match(path.c_str(), query_string_start, regex_)) {
+    if (context.pathMatched() ||
+        regex_->match(path.c_str(), Http::Utility::findQueryStringStart(path))) {
       return clusterEntry(headers, random_value);
     }
   }
   return nullptr;
 }
 
+GlobalRouteConfig::GlobalRouteConfig(const envoy::api::v2::RouteConfiguration& config)
+    : hash_(hash(config)),
+      request_headers_parser_(HeaderParser::configure(config.request_headers_to_add())),
+      response_headers_parser_(HeaderParser::configure(config.response_headers_to_add(),
+                                                       config.response_headers_to_remove())) {}
+
+uint64_t GlobalRouteConfig::hash(const envoy::api::v2::RouteConfiguration& config) {
+  envoy::api::v2::RouteConfiguration global_config;
+  global_config.mutable_request_headers_to_add()->CopyFrom(config.request_headers_to_add());
+  global_config.mutable_response_headers_to_add()->CopyFrom(config.response_headers_to_add());
+  global_config.mutable_response_headers_to_remove()->CopyFrom(
+      config.response_headers_to_remove());
+  return MessageUtil::hash(global_config);
+}
+
 VirtualHostImpl::VirtualHostImpl(const envoy::api::v2::VirtualHost& virtual_host,
-                                 const ConfigImpl& global_route_config, Runtime::Loader& runtime,
-                                 Upstream::ClusterManager& cm, bool validate_clusters)
-    : name_(virtual_host.name()), rate_limit_policy_(virtual_host.rate_limits()),
+                                 GlobalRouteConfigConstSharedPtr global_route_config,
+                                 Runtime::Loader& runtime, Upstream::ClusterManager& cm,
+                                 bool validate_clusters, Regex::Engine regex_engine)
+    : name_(virtual_host.name()), regex_engine_(regex_engine),
+      rate_limit_policy_(virtual_host.rate_limits()),
       global_route_config_(global_route_config),
       request_headers_parser_(HeaderParser::configure(virtual_host.request_headers_to_add())),
       response_headers_parser_(HeaderParser::configure(virtual_host.response_headers_to_add(),
@@ -630,15 +815,25 @@ VirtualHostImpl::VirtualHostImpl(const envoy::api::v2::VirtualHost& virtual_host
     const bool has_path = route.match().path_specifier_case() == envoy::api::v2::RouteMatch::kPath;
     const bool has_regex =
         route.match().path_specifier_case() == envoy::api::v2::RouteMatch::kRegex;
+    const uint32_t position = routes_.size();
+    std::shared_ptr<RouteEntryImplBase> route_entry;
     if (has_prefix) {
-      routes_.emplace_back(new PrefixRouteEntryImpl(*this, route, runtime));
+      route_entry.reset(new PrefixRouteEntryImpl(*this, route, runtime, cm));
+      route_index_.addPrefix(route.match().prefix(), position);
     } else if (has_path) {
-      routes_.emplace_back(new PathRouteEntryImpl(*this, route, runtime));
+      route_entry.reset(new PathRouteEntryImpl(*this, route, runtime, cm));
+      route_index_.addPath(route.match().path(), position);
     } else {
       ASSERT(has_regex);
       UNREFERENCED_PARAMETER(has_regex);
-      routes_.emplace_back(new RegexRouteEntryImpl(*this, route, runtime));
+      route_entry.reset(new RegexRouteEntryImpl(*this, route, runtime, cm));
+      if (regex_engine_ != Regex::Engine::Linear ||
+          !regex_routes_.add(route.match().regex(), position)) {
+        route_index_.addFallback(position);
+      }
     }
+    route_entry->indexHeaders(header_names_);
+    routes_.emplace_back(std::move(route_entry));
 
     if (validate_clusters) {
       routes_.back()->validateClusters(cm);
@@ -652,7 +847,10 @@ VirtualHostImpl::VirtualHostImpl(const envoy::api::v2::VirtualHost& virtual_host
   }
 
   for (const auto& virtual_cluster : virtual_host.virtual_clusters()) {
-    virtual_clusters_.push_back(VirtualClusterEntry(virtual_cluster));
+    virtual_clusters_.push_back(VirtualClusterEntry(virtual_cluster, regex_engine_));
+    virtual_clusters_.back().in_pattern_set_ =
+        regex_engine_ == Regex::Engine::Linear &&
+        virtual_cluster_patterns_.add(virtual_cluster.pattern(), virtual_clusters_.size() - 1);
   }
 
   if (virtual_host.has_cors()) {
@@ -661,42 +859,46 @@ VirtualHostImpl::VirtualHostImpl(const envoy::api::v2::VirtualHost& virtual_host
 }
 
 VirtualHostImpl::VirtualClusterEntry::VirtualClusterEntry(
-    const envoy::api::v2::VirtualCluster& virtual_cluster) {
+    const envoy::api::v2::VirtualCluster& virtual_cluster, Regex::Engine engine)
+    : pattern_(Regex::Utility::parseRegex(virtual_cluster.pattern(), engine)) {
   if (virtual_cluster.method() != envoy::api::v2::RequestMethod::METHOD_UNSPECIFIED) {
     method_ = envoy::api::v2::RequestMethod_Name(virtual_cluster.method());
   }
 
-  const std::string pattern = virtual_cluster.pattern();
-  pattern_ = std::regex{pattern, std::regex::optimize};
   name_ = virtual_cluster.name();
 }
 
-const VirtualHostImpl* RouteMatcher::findWildcardVirtualHost(const std::string& host) const {
-  // We do a longest wildcard suffix match against the host that's passed in.
-  // (e.g. foo-bar.baz.com should match *-bar.baz.com before matching *.baz.com)
-  // This is done by scanning the length => wildcards map looking for every
-  // wildcard whose size is < length.
-  for (const auto& iter : wildcard_virtual_host_suffixes_) {
-    const uint32_t wildcard_length = iter.first;
-    const auto& wildcard_map = iter.second;
-    // >= because *.foo.com shouldn't match .foo.com.
-    if (wildcard_length >= host.size()) {
-      continue;
+RouteMatcher::RouteMatcher(const envoy::api::v2::RouteConfiguration& route_config,
+                           GlobalRouteConfigConstSharedPtr global_route_config,
+                           Runtime::Loader& runtime, Upstream::ClusterManager& cm,
+                           bool validate_clusters, const RouteMatcher* previous)
+    : global_route_config_(global_route_config), validate_clusters_(validate_clusters),
+      regex_engine_(runtime.snapshot().featureEnabled("router.linear_regex_engine", 100)
+                        ? Regex::Engine::Linear
+                        : Regex::Engine::Std) {
+  // A virtual host built for the previous configuration can be reused if it was built the same
+  // way. Virtual hosts whose clusters must be validated are always rebuilt, as the clusters may
+  // have changed since.
+  const bool reuse = previous != nullptr && !validate_clusters && !previous->validate_clusters_ &&
+                     previous->global_route_config_ == global_route_config_ &&
+                     previous->regex_engine_ == regex_engine_;
+
+  for (const auto& virtual_host_config : route_config.virtual_hosts()) {
+    const uint64_t hash = MessageUtil::hash(virtual_host_config);
+    VirtualHostSharedPtr virtual_host;
+    if (reuse) {
+      const auto previous_virtual_host = previous->virtual_hosts_by_hash_.find(hash);
+      if (previous_virtual_host != previous->virtual_hosts_by_hash_.end()) {
+        virtual_host = previous_virtual_host->second;
+        reused_virtual_hosts_++;
+      }
     }
-    const auto& match = wildcard_map.find(host.substr(host.size() - wildcard_length));
-    if (match != wildcard_map.end()) {
-      return match->second.get();
+    if (!virtual_host) {
+      virtual_host.reset(new VirtualHostImpl(virtual_host_config, global_route_config_, runtime,
+                                             cm, validate_clusters, regex_engine_));
     }
-  }
-  return nullptr;
-}
+    virtual_hosts_by_hash_.emplace(hash, virtual_host);
 
-RouteMatcher::RouteMatcher(const envoy::api::v2::RouteConfiguration& route_config,
-                           const ConfigImpl& global_route_config, Runtime::Loader& runtime,
-                           Upstream::ClusterManager& cm, bool validate_clusters) {
-  for (const auto& virtual_host_config : route_config.virtual_hosts()) {
-    VirtualHostSharedPtr virtual_host(new VirtualHostImpl(virtual_host_config, global_route_config,
-                                                          runtime, cm, validate_clusters));
     for (const std::string& domain : virtual_host_config.domains()) {
       if ("*" == domain) {
         if (default_virtual_host_) {
@@ -704,14 +906,10 @@ RouteMatcher::RouteMatcher(const envoy::api::v2::RouteConfiguration& route_confi
         }
         default_virtual_host_ = virtual_host;
       } else if (domain.size() > 0 && '*' == domain[0]) {
-        wildcard_virtual_host_suffixes_[domain.size() - 1].emplace(domain.substr(1), virtual_host);
-      } else {
-        if (virtual_hosts_.find(domain) != virtual_hosts_.end()) {
-          throw EnvoyException(fmt::format(
-              "Only unique values for domains are permitted. Duplicate entry of domain {}",
-              domain));
-        }
-        virtual_hosts_.emplace(domain, virtual_host);
+        virtual_hosts_.addWildcard(domain.substr(1), virtual_host);
+      } else if (!virtual_hosts_.addDomain(domain, virtual_host)) {
+        throw EnvoyException(fmt::format(
+            "Only unique values for domains are permitted. Duplicate entry of domain {}", domain));
       }
     }
   }
@@ -727,9 +925,27 @@ RouteConstSharedPtr VirtualHostImpl::getRouteFromEntries(const Http::HeaderMap&
     return SSL_REDIRECT_ROUTE;
   }
 
-  // Check for a route that matches the request.
-  for (const RouteEntryImplBaseConstSharedPtr& route : routes_) {
-    RouteConstSharedPtr route_entry = route->matches(headers, random_value);
+  // Check for a route that matches the request. Only the routes whose path matcher may match the
+  // path are evaluated, in route table order, so the first matching route still wins. Header,
+  // query parameter and runtime constraints are checked by matches() as before, through a context
+  // that looks up each header name and parses the query string at most once for all the routes.
+  std::vector<uint32_t> candidates;
+  const Http::HeaderString& path = headers.Path()->value();
+  route_index_.candidates(path.c_str(), path.size(), candidates);
+  std::vector<uint32_t> regex_matches;
+  if (!regex_routes_.empty()) {
+    // All the regex routes the linear engine supports are matched in a single pass, so their
+    // patterns are not matched again by matches().
+    regex_routes_.match(path.c_str(), Http::Utility::findQueryStringStart(path), regex_matches);
+    const size_t indexed = candidates.size();
+    candidates.insert(candidates.end(), regex_matches.begin(), regex_matches.end());
+    std::inplace_merge(candidates.begin(), candidates.begin() + indexed, candidates.end());
+  }
+  ConfigUtility::MatchContext context(headers, header_names_);
+  for (const uint32_t candidate : candidates) {
+    context.setPathMatched(
+        std::binary_search(regex_matches.begin(), regex_matches.end(), candidate));
+    RouteConstSharedPtr route_entry = routes_[candidate]->matches(headers, random_value, context);
     if (nullptr != route_entry) {
       return route_entry;
     }
@@ -746,16 +962,10 @@ const VirtualHostImpl* RouteMatcher::findVirtualHost(const Http::HeaderMap& head
 
   // TODO (@rshriram) Match Origin header in WebSocket
   // request with VHost, using wildcard match
-  const char* host = headers.Host()->value().c_str();
-  const auto& iter = virtual_hosts_.find(host);
-  if (iter != virtual_hosts_.end()) {
-    return iter->second.get();
-  }
-  if (!wildcard_virtual_host_suffixes_.empty()) {
-    const VirtualHostImpl* vhost = findWildcardVirtualHost(host);
-    if (vhost != nullptr) {
-      return vhost;
-    }
+  const Http::HeaderString& host = headers.Host()->value();
+  const VirtualHostSharedPtr* virtual_host = virtual_hosts_.find(host.c_str(), host.size());
+  if (virtual_host != nullptr) {
+    return virtual_host->get();
   }
   return default_virtual_host_.get();
 }
@@ -777,35 +987,57 @@ const std::shared_ptr<const SslRedirectRoute> VirtualHostImpl::SSL_REDIRECT_ROUT
 
 const VirtualCluster*
 VirtualHostImpl::virtualClusterFromEntries(const Http::HeaderMap& headers) const {
-  for (const VirtualClusterEntry& entry : virtual_clusters_) {
+  if (virtual_clusters_.empty()) {
+    return nullptr;
+  }
+
+  const Http::HeaderString& path = headers.Path()->value();
+  std::vector<uint32_t> pattern_matches;
+  if (!virtual_cluster_patterns_.empty()) {
+    virtual_cluster_patterns_.match(path.c_str(), path.c_str() + path.size(), pattern_matches);
+  }
+
+  for (size_t i = 0; i < virtual_clusters_.size(); i++) {
+    const VirtualClusterEntry& entry = virtual_clusters_[i];
     bool method_matches =
         !entry.method_.valid() || headers.Method()->value().c_str() == entry.method_.value();
+    if (!method_matches) {
+      continue;
+    }
 
-    if (method_matches && std::regex_match(headers.Path()->value().c_str(), entry.pattern_)) {
+    const bool pattern_matches_path =
+        entry.in_pattern_set_
+            ? std::binary_search(pattern_matches.begin(), pattern_matches.end(), i)
+            : entry.pattern_->match(path.c_str(), path.c_str() + path.size());
+    if (pattern_matches_path) {
       return &entry;
     }
   }
 
-  if (virtual_clusters_.size() > 0) {
-    return &VIRTUAL_CLUSTER_CATCH_ALL;
-  }
-
-  return nullptr;
+  return &VIRTUAL_CLUSTER_CATCH_ALL;
 }
 
 ConfigImpl::ConfigImpl(const envoy::api::v2::RouteConfiguration& config, Runtime::Loader& runtime,
-                       Upstream::ClusterManager& cm, bool validate_clusters_default) {
+                       Upstream::ClusterManager& cm, bool validate_clusters_default,
+                       const ConfigImpl* previous) {
+  // Share the global settings with the previous configuration when they did not change, which
+  // allows its virtual hosts to be reused.
+  GlobalRouteConfigConstSharedPtr global_route_config;
+  if (previous != nullptr &&
+      previous->route_matcher_->globalRouteConfig()->hash() == GlobalRouteConfig::hash(config)) {
+    global_route_config = previous->route_matcher_->globalRouteConfig();
+  } else {
+    global_route_config = std::make_shared<const GlobalRouteConfig>(config);
+  }
+
   route_matcher_.reset(new RouteMatcher(
-      config, *this, runtime, cm,
-      PROTOBUF_GET_WRAPPED_OR_DEFAULT(config, validate_clusters, validate_clusters_default)));
+      config, global_route_config, runtime, cm,
+      PROTOBUF_GET_WRAPPED_OR_DEFAULT(config, validate_clusters, validate_clusters_default),
+      previous != nullptr ? previous->route_matcher_.get() : nullptr));
 
   for (const std::string& header : config.internal_only_headers()) {
     internal_only_headers_.push_back(Http::LowerCaseString(header));
   }
-
-  request_headers_parser_ = HeaderParser::configure(config.request_headers_to_add());
-  response_headers_parser_ = HeaderParser::configure(config.response_headers_to_add(),
-                                                     config.response_headers_to_remove());
 }
 
 } // namespace Router
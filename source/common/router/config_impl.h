@@ -1,13 +1,15 @@
 #pragma once
 
+#include <atomic>
 #include <chrono>
 #include <cstdint>
 #include <list>
 #include <map>
 #include <memory>
-#include <regex>
+#include <mutex>
 #include <string>
 #include <unordered_map>
+#include <unordered_set>
 #include <vector>
 
 #include "envoy/common/optional.h"
@@ -15,11 +17,16 @@
 #include "envoy/runtime/runtime.h"
 #include "envoy/upstream/cluster_manager.h"
 
+#include "common/common/hash.h"
+#include "common/common/regex.h"
 #include "common/router/config_utility.h"
+#include "common/router/domain_trie.h"
 #include "common/router/header_formatter.h"
 #include "common/router/header_parser.h"
+#include "common/router/route_index.h"
 #include "common/router/router_ratelimit.h"
 
+#include "absl/strings/string_view.h"
 #include "api/rds.pb.h"
 
 namespace Envoy {
@@ -37,10 +44,12 @@ public:
    * @param headers supplies the headers to match.
    * @param random_value supplies the random seed to use if a runtime choice is required. This
    *        allows stable choices between calls if desired.
+   * @param context supplies the match context of the headers, shared with the other objects
+   *        matched against them.
    * @return true if input headers match this object.
    */
-  virtual RouteConstSharedPtr matches(const Http::HeaderMap& headers,
-                                      uint64_t random_value) const PURE;
+  virtual RouteConstSharedPtr matches(const Http::HeaderMap& headers, uint64_t random_value,
+                                      ConfigUtility::MatchContext& context) const PURE;
 };
 
 class RouteEntryImplBase;
@@ -76,6 +85,7 @@ public:
 
   // Router::CorsPolicy
   const std::list<std::string>& allowOrigins() const override { return allow_origin_; };
+  bool allowsOrigin(const Http::HeaderString& origin) const override;
   const std::string& allowMethods() const override { return allow_methods_; };
   const std::string& allowHeaders() const override { return allow_headers_; };
   const std::string& exposeHeaders() const override { return expose_headers_; };
@@ -84,7 +94,15 @@ public:
   bool enabled() const override { return enabled_; };
 
 private:
+  struct StringViewHash {
+    size_t operator()(absl::string_view value) const { return HashUtil::xxHash64(value); }
+  };
+
   std::list<std::string> allow_origin_;
+  // allow_origin_ compiled for allowsOrigin(). The views refer to the strings of allow_origin_.
+  bool allow_any_origin_{};
+  std::unordered_set<absl::string_view, StringViewHash> exact_origins_;
+  std::vector<absl::string_view> origin_suffixes_;
   std::string allow_methods_;
   std::string allow_headers_;
   std::string expose_headers_;
@@ -93,20 +111,48 @@ private:
   bool enabled_;
 };
 
-class ConfigImpl;
+/**
+ * The settings of a route configuration that apply to all of its virtual hosts. They are shared
+ * with the virtual hosts, which may outlive the ConfigImpl that built them: an updated route
+ * configuration reuses the virtual hosts that did not change.
+ */
+class GlobalRouteConfig {
+public:
+  GlobalRouteConfig(const envoy::api::v2::RouteConfiguration& config);
+
+  /**
+   * @return a hash of the global settings of a route configuration. Route configurations with
+   *         the same global settings have the same hash.
+   */
+  static uint64_t hash(const envoy::api::v2::RouteConfiguration& config);
+
+  uint64_t hash() const { return hash_; }
+  const HeaderParser& requestHeaderParser() const { return *request_headers_parser_; };
+  const HeaderParser& responseHeaderParser() const { return *response_headers_parser_; };
+
+private:
+  const uint64_t hash_;
+  HeaderParserPtr request_headers_parser_;
+  HeaderParserPtr response_headers_parser_;
+};
+
+typedef std::shared_ptr<const GlobalRouteConfig> GlobalRouteConfigConstSharedPtr;
+
 /**
  * Holds all routing configuration for an entire virtual host.
  */
 class VirtualHostImpl : public VirtualHost {
 public:
   VirtualHostImpl(const envoy::api::v2::VirtualHost& virtual_host,
-                  const ConfigImpl& global_route_config, Runtime::Loader& runtime,
-                  Upstream::ClusterManager& cm, bool validate_clusters);
+                  GlobalRouteConfigConstSharedPtr global_route_config, Runtime::Loader& runtime,
+                  Upstream::ClusterManager& cm, bool validate_clusters,
+                  Regex::Engine regex_engine);
 
   RouteConstSharedPtr getRouteFromEntries(const Http::HeaderMap& headers,
                                           uint64_t random_value) const;
   const VirtualCluster* virtualClusterFromEntries(const Http::HeaderMap& headers) const;
-  const ConfigImpl& globalRouteConfig() const { return global_route_config_; }
+  const GlobalRouteConfig& globalRouteConfig() const { return *global_route_config_; }
+  Regex::Engine regexEngine() const { return regex_engine_; }
   const HeaderParser& requestHeaderParser() const { return *request_headers_parser_; };
   const HeaderParser& responseHeaderParser() const { return *response_headers_parser_; };
 
@@ -119,12 +165,15 @@ private:
   enum class SslRequirements { NONE, EXTERNAL_ONLY, ALL };
 
   struct VirtualClusterEntry : public VirtualCluster {
-    VirtualClusterEntry(const envoy::api::v2::VirtualCluster& virtual_cluster);
+    VirtualClusterEntry(const envoy::api::v2::VirtualCluster& virtual_cluster,
+                        Regex::Engine engine);
 
     // Router::VirtualCluster
     const std::string& name() const override { return name_; }
 
-    std::regex pattern_;
+    Regex::MatcherPtr pattern_;
+    // Whether the pattern is matched through virtual_cluster_patterns_ rather than pattern_.
+    bool in_pattern_set_{};
     Optional<std::string> method_;
     std::string name_;
   };
@@ -140,13 +189,21 @@ private:
   static const std::shared_ptr<const SslRedirectRoute> SSL_REDIRECT_ROUTE;
 
   const std::string name_;
+  const Regex::Engine regex_engine_;
   std::vector<RouteEntryImplBaseConstSharedPtr> routes_;
+  RouteIndex route_index_;
+  // The header names matched by routes_, each of which is looked up once per request.
+  ConfigUtility::HeaderNameIndex header_names_;
+  // The patterns of the regex routes supported by the linear engine, identified by route
+  // position. The other regex routes are fallbacks of route_index_.
+  Regex::PatternSet regex_routes_;
   std::vector<VirtualClusterEntry> virtual_clusters_;
+  // The patterns of the virtual clusters supported by the linear engine, identified by position.
+  Regex::PatternSet virtual_cluster_patterns_;
   SslRequirements ssl_requirements_;
   const RateLimitPolicyImpl rate_limit_policy_;
   std::unique_ptr<const CorsPolicyImpl> cors_policy_;
-  const ConfigImpl& global_route_config_; // See note in RouteEntryImplBase::clusterEntry() on why
-                                          // raw ref to the top level config is currently safe.
+  const GlobalRouteConfigConstSharedPtr global_route_config_;
   HeaderParserPtr request_headers_parser_;
   HeaderParserPtr response_headers_parser_;
 };
@@ -154,37 +211,96 @@ private:
 typedef std::shared_ptr<VirtualHostImpl> VirtualHostSharedPtr;
 
 /**
- * Implementation of RetryPolicy that reads from the proto route config.
+ * Implementation of HedgePolicy that reads from the route opaque config. The "hedge_percentile"
+ * key turns hedging on: requests get a second attempt once they have waited for that percentile
+ * of the recent response times of the route, and for at least "hedge_min_delay_ms". Second
+ * attempts are capped at "hedge_budget_percent" percent of the attempts.
+ *
+ * Response times are counted in buckets whose bounds grow by 25%, so the delay is within 25% of
+ * the percentile. The counts are halved every WindowSamples samples to follow recent traffic.
+ * Updates are lock free and may be lost while the counts are halved, which only makes the delay
+ * and the budget slightly less accurate.
+ */
+class HedgePolicyImpl : public HedgePolicy {
+public:
+  HedgePolicyImpl(uint32_t percentile, uint32_t budget_percent,
+                  std::chrono::milliseconds min_delay);
+
+  /**
+   * @return the policy set by the opaque config of a route, or nullptr if the route does not
+   *         hedge requests.
+   */
+  static std::unique_ptr<const HedgePolicyImpl>
+  create(const std::multimap<std::string, std::string>& opaque_config);
+
+  // Router::HedgePolicy
+  std::chrono::milliseconds hedgeDelay() const override;
+  void recordResponseTime(std::chrono::milliseconds time) const override;
+  bool tryHedge() const override;
+
+  static const uint32_t DefaultBudgetPercent = 10;
+  static const uint64_t MinSamples = 100;
+  static const uint64_t WindowSamples = 10000;
+  static const size_t NumBuckets = 64;
+
+private:
+  static size_t bucket(std::chrono::milliseconds time);
+  static std::chrono::milliseconds bucketBound(size_t bucket);
+  void decay() const;
+
+  const uint32_t percentile_;
+  const uint32_t budget_percent_;
+  const std::chrono::milliseconds min_delay_;
+  mutable std::atomic<uint64_t> buckets_[NumBuckets]{};
+  mutable std::atomic<uint64_t> samples_{};
+  mutable std::atomic<uint64_t> hedges_{};
+  mutable std::mutex decay_lock_;
+};
+
+/**
+ * Implementation of RetryPolicy that reads from the proto route config, and the hedging policy
+ * and the "retry_max_replay_bytes" replay buffer bound from the route opaque config.
  */
 class RetryPolicyImpl : public RetryPolicy {
 public:
-  RetryPolicyImpl(const envoy::api::v2::RouteAction& config);
+  RetryPolicyImpl(const envoy::api::v2::RouteAction& config,
+                  const std::multimap<std::string, std::string>& opaque_config);
 
   // Router::RetryPolicy
   std::chrono::milliseconds perTryTimeout() const override { return per_try_timeout_; }
   uint32_t numRetries() const override { return num_retries_; }
   uint32_t retryOn() const override { return retry_on_; }
+  const HedgePolicy* hedgePolicy() const override { return hedge_policy_.get(); }
+  uint64_t maxReplayBytes() const override { return max_replay_bytes_; }
 
 private:
   std::chrono::milliseconds per_try_timeout_{0};
   uint32_t num_retries_{};
   uint32_t retry_on_{};
+  std::unique_ptr<const HedgePolicyImpl> hedge_policy_;
+  const uint64_t max_replay_bytes_;
 };
 
 /**
- * Implementation of ShadowPolicy that reads from the proto route config.
+ * Implementation of ShadowPolicy that reads from the proto route config, and the largest shadowed
+ * body from the "shadow_max_body_bytes" key of the route opaque config.
  */
 class ShadowPolicyImpl : public ShadowPolicy {
 public:
-  ShadowPolicyImpl(const envoy::api::v2::RouteAction& config);
+  ShadowPolicyImpl(const envoy::api::v2::RouteAction& config,
+                   const std::multimap<std::string, std::string>& opaque_config);
 
   // Router::ShadowPolicy
   const std::string& cluster() const override { return cluster_; }
   const std::string& runtimeKey() const override { return runtime_key_; }
+  uint64_t maxBodyBytes() const override { return max_body_bytes_; }
+
+  static const uint64_t DefaultMaxBodyBytes = 1024 * 1024;
 
 private:
   std::string cluster_;
   std::string runtime_key_;
+  const uint64_t max_body_bytes_;
 };
 
 /**
@@ -291,15 +407,22 @@ class RouteEntryImplBase : public RouteEntry,
                            public std::enable_shared_from_this<RouteEntryImplBase> {
 public:
   RouteEntryImplBase(const VirtualHostImpl& vhost, const envoy::api::v2::Route& route,
-                     Runtime::Loader& loader);
+                     Runtime::Loader& loader, Upstream::ClusterManager& cm);
 
   bool isRedirect() const { return !host_redirect_.empty() || !path_redirect_.empty(); }
 
-  bool matchRoute(const Http::HeaderMap& headers, uint64_t random_value) const;
+  /**
+   * Give the route a slot for each header name it matches on.
+   * @param header_names supplies the header name index of the virtual host.
+   */
+  void indexHeaders(ConfigUtility::HeaderNameIndex& header_names);
+
+  bool matchRoute(uint64_t random_value, ConfigUtility::MatchContext& context) const;
   void validateClusters(Upstream::ClusterManager& cm) const;
 
   // Router::RouteEntry
   const std::string& clusterName() const override;
+  const Upstream::ClusterHandle* clusterHandle() const override { return cluster_handle_.get(); }
   Http::Code clusterNotFoundResponseCode() const override {
     return cluster_not_found_response_code_;
   }
@@ -362,6 +485,7 @@ private:
 
     // Router::RouteEntry
     const std::string& clusterName() const override { return cluster_name_; }
+    const Upstream::ClusterHandle* clusterHandle() const override { return nullptr; }
     Http::Code clusterNotFoundResponseCode() const override {
       return parent_->clusterNotFoundResponseCode();
     }
@@ -420,16 +544,20 @@ private:
   class WeightedClusterEntry : public DynamicRouteEntry {
   public:
     WeightedClusterEntry(const RouteEntryImplBase* parent, const std::string runtime_key,
-                         Runtime::Loader& loader, const std::string& name, uint64_t weight,
+                         Upstream::ClusterManager& cm,
+                         const std::string& name, uint64_t weight,
                          MetadataMatchCriteriaImplConstPtr cluster_metadata_match_criteria)
-        : DynamicRouteEntry(parent, name), runtime_key_(runtime_key), loader_(loader),
-          cluster_weight_(weight),
+        : DynamicRouteEntry(parent, name), runtime_key_(runtime_key),
+          cluster_handle_(cm.clusterHandle(name)), cluster_weight_(weight),
           cluster_metadata_match_criteria_(std::move(cluster_metadata_match_criteria)) {}
 
-    uint64_t clusterWeight() const {
-      return loader_.snapshot().getInteger(runtime_key_, cluster_weight_);
+    uint64_t clusterWeight(const Runtime::Snapshot& snapshot) const {
+      return snapshot.getInteger(runtime_key_, cluster_weight_);
     }
 
+    const Upstream::ClusterHandle* clusterHandle() const override {
+      return cluster_handle_.get();
+    }
     const MetadataMatchCriteria* metadataMatchCriteria() const override {
       if (cluster_metadata_match_criteria_) {
         return cluster_metadata_match_criteria_.get();
@@ -441,13 +569,27 @@ private:
 
   private:
     const std::string runtime_key_;
-    Runtime::Loader& loader_;
+    const Upstream::ClusterHandlePtr cluster_handle_;
     const uint64_t cluster_weight_;
     MetadataMatchCriteriaImplConstPtr cluster_metadata_match_criteria_;
   };
 
   typedef std::shared_ptr<WeightedClusterEntry> WeightedClusterEntrySharedPtr;
 
+  /**
+   * The weighted cluster selected by each of the MAX_CLUSTER_WEIGHT values a request can draw,
+   * computed from the weights of one runtime snapshot.
+   */
+  struct WeightedClusterTable {
+    uint64_t runtime_version_;
+    std::vector<uint32_t> clusters_;
+  };
+
+  typedef std::shared_ptr<const WeightedClusterTable> WeightedClusterTableConstSharedPtr;
+
+  WeightedClusterTableConstSharedPtr
+  buildWeightedClusterTable(const Runtime::Snapshot& snapshot) const;
+
   static Optional<RuntimeData> loadRuntimeData(const envoy::api::v2::RouteMatch& route);
 
   static std::multimap<std::string, std::string>
@@ -464,6 +606,8 @@ private:
   const bool auto_host_rewrite_;
   const bool use_websocket_;
   const std::string cluster_name_;
+  // nullptr if the route has no cluster_name_.
+  const Upstream::ClusterHandlePtr cluster_handle_;
   const Http::LowerCaseString cluster_header_name_;
   const Http::Code cluster_not_found_response_code_;
   const std::chrono::milliseconds timeout_;
@@ -471,6 +615,10 @@ private:
   Runtime::Loader& loader_;
   const std::string host_redirect_;
   const std::string path_redirect_;
+
+  // TODO(danielhochman): refactor multimap into unordered_map since JSON is unordered map.
+  const std::multimap<std::string, std::string> opaque_config_;
+
   const RetryPolicyImpl retry_policy_;
   const RateLimitPolicyImpl rate_limit_policy_;
   const ShadowPolicyImpl shadow_policy_;
@@ -478,14 +626,13 @@ private:
   std::vector<ConfigUtility::HeaderData> config_headers_;
   std::vector<ConfigUtility::QueryParameterMatcher> config_query_parameters_;
   std::vector<WeightedClusterEntrySharedPtr> weighted_clusters_;
+  // Rebuilt by whichever worker first sees a new runtime snapshot. Only accessed with
+  // std::atomic_load() and std::atomic_store().
+  mutable WeightedClusterTableConstSharedPtr weighted_cluster_table_;
   std::unique_ptr<const HashPolicyImpl> hash_policy_;
   MetadataMatchCriteriaImplConstPtr metadata_match_criteria_;
   HeaderParserPtr request_headers_parser_;
   HeaderParserPtr response_headers_parser_;
-
-  // TODO(danielhochman): refactor multimap into unordered_map since JSON is unordered map.
-  const std::multimap<std::string, std::string> opaque_config_;
-
   const DecoratorConstPtr decorator_;
   const Http::Code redirect_response_code_;
 };
@@ -496,14 +643,15 @@ private:
 class PrefixRouteEntryImpl : public RouteEntryImplBase {
 public:
   PrefixRouteEntryImpl(const VirtualHostImpl& vhost, const envoy::api::v2::Route& route,
-                       Runtime::Loader& loader);
+                       Runtime::Loader& loader, Upstream::ClusterManager& cm);
 
   // Router::RouteEntry
   void finalizeRequestHeaders(Http::HeaderMap& headers,
                               const RequestInfo::RequestInfo& request_info) const override;
 
   // Router::Matchable
-  RouteConstSharedPtr matches(const Http::HeaderMap& headers, uint64_t random_value) const override;
+  RouteConstSharedPtr matches(const Http::HeaderMap& headers, uint64_t random_value,
+                              ConfigUtility::MatchContext& context) const override;
 
 private:
   const std::string prefix_;
@@ -515,14 +663,15 @@ private:
 class PathRouteEntryImpl : public RouteEntryImplBase {
 public:
   PathRouteEntryImpl(const VirtualHostImpl& vhost, const envoy::api::v2::Route& route,
-                     Runtime::Loader& loader);
+                     Runtime::Loader& loader, Upstream::ClusterManager& cm);
 
   // Router::RouteEntry
   void finalizeRequestHeaders(Http::HeaderMap& headers,
                               const RequestInfo::RequestInfo& request_info) const override;
 
   // Router::Matchable
-  RouteConstSharedPtr matches(const Http::HeaderMap& headers, uint64_t random_value) const override;
+  RouteConstSharedPtr matches(const Http::HeaderMap& headers, uint64_t random_value,
+                              ConfigUtility::MatchContext& context) const override;
 
 private:
   const std::string path_;
@@ -534,17 +683,18 @@ private:
 class RegexRouteEntryImpl : public RouteEntryImplBase {
 public:
   RegexRouteEntryImpl(const VirtualHostImpl& vhost, const envoy::api::v2::Route& route,
-                      Runtime::Loader& loader);
+                      Runtime::Loader& loader, Upstream::ClusterManager& cm);
 
   // Router::RouteEntry
   void finalizeRequestHeaders(Http::HeaderMap& headers,
                               const RequestInfo::RequestInfo& request_info) const override;
 
   // Router::Matchable
-  RouteConstSharedPtr matches(const Http::HeaderMap& headers, uint64_t random_value) const override;
+  RouteConstSharedPtr matches(const Http::HeaderMap& headers, uint64_t random_value,
+                              ConfigUtility::MatchContext& context) const override;
 
 private:
-  const std::regex regex_;
+  const Regex::MatcherPtr regex_;
 };
 
 /**
@@ -553,28 +703,37 @@ private:
  */
 class RouteMatcher {
 public:
+  /**
+   * @param previous supplies the matcher of the previous version of the route configuration, if
+   *        any. Its virtual hosts are reused where the new configuration has identical ones.
+   */
   RouteMatcher(const envoy::api::v2::RouteConfiguration& config,
-               const ConfigImpl& global_http_config, Runtime::Loader& runtime,
-               Upstream::ClusterManager& cm, bool validate_clusters);
+               GlobalRouteConfigConstSharedPtr global_route_config, Runtime::Loader& runtime,
+               Upstream::ClusterManager& cm, bool validate_clusters,
+               const RouteMatcher* previous);
 
   RouteConstSharedPtr route(const Http::HeaderMap& headers, uint64_t random_value) const;
 
+  /**
+   * @return the number of virtual hosts reused from the previous matcher.
+   */
+  uint64_t reusedVirtualHosts() const { return reused_virtual_hosts_; }
+  const GlobalRouteConfigConstSharedPtr& globalRouteConfig() const { return global_route_config_; }
+
 private:
   const VirtualHostImpl* findVirtualHost(const Http::HeaderMap& headers) const;
-  const VirtualHostImpl* findWildcardVirtualHost(const std::string& host) const;
-
-  std::unordered_map<std::string, VirtualHostSharedPtr> virtual_hosts_;
-  // std::greater as a minor optimization to iterate from more to less specific
-  //
-  // A note on using an unordered_map versus a vector of (string, VirtualHostSharedPtr) pairs:
-  //
-  // Based on local benchmarks, each vector entry costs around 20ns for recall and (string)
-  // comparison with a fixed cost of about 25ns. For unordered_map, the empty map costs about 65ns
-  // and climbs to about 110ns once there are any entries.
-  //
-  // The break-even is 4 entries.
-  std::map<int64_t, std::unordered_map<std::string, VirtualHostSharedPtr>, std::greater<int64_t>>
-      wildcard_virtual_host_suffixes_;
+
+  const GlobalRouteConfigConstSharedPtr global_route_config_;
+  const bool validate_clusters_;
+  const Regex::Engine regex_engine_;
+  // The virtual hosts by the hash of their configuration, to be reused by the next version of the
+  // route configuration.
+  std::unordered_map<uint64_t, VirtualHostSharedPtr> virtual_hosts_by_hash_;
+  uint64_t reused_virtual_hosts_{};
+
+  // Both the virtual hosts with exact domains and those with wildcard domains, the latter
+  // resolved by longest suffix.
+  DomainTrie<VirtualHostSharedPtr> virtual_hosts_;
   VirtualHostSharedPtr default_virtual_host_;
 };
 
@@ -583,11 +742,18 @@ private:
  */
 class ConfigImpl : public Config {
 public:
+  /**
+   * @param previous supplies the previous version of the route configuration, if any. The virtual
+   *        hosts whose configuration did not change are shared with it rather than rebuilt.
+   */
   ConfigImpl(const envoy::api::v2::RouteConfiguration& config, Runtime::Loader& runtime,
-             Upstream::ClusterManager& cm, bool validate_clusters_default);
+             Upstream::ClusterManager& cm, bool validate_clusters_default,
+             const ConfigImpl* previous = nullptr);
 
-  const HeaderParser& requestHeaderParser() const { return *request_headers_parser_; };
-  const HeaderParser& responseHeaderParser() const { return *response_headers_parser_; };
+  /**
+   * @return the number of virtual hosts shared with the previous version of the configuration.
+   */
+  uint64_t reusedVirtualHosts() const { return route_matcher_->reusedVirtualHosts(); }
 
   // Router::Config
   RouteConstSharedPtr route(const Http::HeaderMap& headers, uint64_t random_value) const override {
@@ -601,10 +767,10 @@ public:
 private:
   std::unique_ptr<RouteMatcher> route_matcher_;
   std::list<Http::LowerCaseString> internal_only_headers_;
-  HeaderParserPtr request_headers_parser_;
-  HeaderParserPtr response_headers_parser_;
 };
 
+typedef std::shared_ptr<const ConfigImpl> ConfigImplConstSharedPtr;
+
 /**
  * Implementation of Config that is empty.
  */
@@ -1,6 +1,5 @@
 #include "common/router/config_utility.h"
 
-#include <regex>
 #include <string>
 #include <vector>
 
@@ -9,13 +8,44 @@
 namespace Envoy {
 namespace Router {
 
+const uint32_t ConfigUtility::HeaderNameIndex::NO_SLOT;
+
+uint32_t ConfigUtility::HeaderNameIndex::add(const Http::LowerCaseString& name) {
+  return slots_.emplace(name.get(), slots_.size()).first->second;
+}
+
+const Http::HeaderEntry* ConfigUtility::MatchContext::header(const HeaderData& config_header) {
+  const uint32_t slot = config_header.name_slot_;
+  if (slot == HeaderNameIndex::NO_SLOT) {
+    return headers_.get(config_header.name_);
+  }
+
+  ASSERT(slot < header_names_.size());
+  if (looked_up_.empty()) {
+    header_entries_.resize(header_names_.size());
+    looked_up_.resize(header_names_.size());
+  }
+  if (!looked_up_[slot]) {
+    header_entries_[slot] = headers_.get(config_header.name_);
+    looked_up_[slot] = true;
+  }
+  return header_entries_[slot];
+}
+
+const Http::Utility::QueryParams& ConfigUtility::MatchContext::queryParams() {
+  if (!query_params_.valid()) {
+    query_params_.value(Http::Utility::parseQueryString(headers_.Path()->value().c_str()));
+  }
+  return query_params_.value();
+}
+
 bool ConfigUtility::QueryParameterMatcher::matches(
     const Http::Utility::QueryParams& request_query_params) const {
   auto query_param = request_query_params.find(name_);
   if (query_param == request_query_params.end()) {
     return false;
   } else if (is_regex_) {
-    return std::regex_match(query_param->second, regex_pattern_);
+    return regex_pattern_->match(query_param->second);
   } else if (value_.length() == 0) {
     return true;
   } else {
@@ -35,28 +65,39 @@ ConfigUtility::parsePriority(const envoy::api::v2::RoutingPriority& priority) {
   }
 }
 
+bool ConfigUtility::matchHeader(const HeaderData& config_header, const Http::HeaderEntry* header) {
+  if (header == nullptr) {
+    return false;
+  } else if (config_header.value_.empty()) {
+    return true;
+  } else if (!config_header.is_regex_) {
+    return header->value() == config_header.value_.c_str();
+  } else {
+    return config_header.regex_pattern_->match(header->value().c_str(),
+                                               header->value().c_str() + header->value().size());
+  }
+}
+
 bool ConfigUtility::matchHeaders(const Http::HeaderMap& request_headers,
                                  const std::vector<HeaderData>& config_headers) {
-  bool matches = true;
-
-  if (!config_headers.empty()) {
-    for (const HeaderData& cfg_header_data : config_headers) {
-      const Http::HeaderEntry* header = request_headers.get(cfg_header_data.name_);
-      if (cfg_header_data.value_.empty()) {
-        matches &= (header != nullptr);
-      } else if (!cfg_header_data.is_regex_) {
-        matches &= (header != nullptr) && (header->value() == cfg_header_data.value_.c_str());
-      } else {
-        matches &= (header != nullptr) &&
-                   std::regex_match(header->value().c_str(), cfg_header_data.regex_pattern_);
-      }
-      if (!matches) {
-        break;
-      }
+  for (const HeaderData& cfg_header_data : config_headers) {
+    if (!matchHeader(cfg_header_data, request_headers.get(cfg_header_data.name_))) {
+      return false;
+    }
+  }
+
+  return true;
+}
+
+bool ConfigUtility::matchHeaders(MatchContext& context,
+                                 const std::vector<HeaderData>& config_headers) {
+  for (const HeaderData& cfg_header_data : config_headers) {
+    if (!matchHeader(cfg_header_data, context.header(cfg_header_data))) {
+      return false;
     }
   }
 
-  return matches;
+  return true;
 }
 
 bool ConfigUtility::matchQueryParams(
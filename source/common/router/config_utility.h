@@ -1,14 +1,18 @@
 #pragma once
 
-#include <regex>
+#include <cstdint>
 #include <string>
+#include <unordered_map>
 #include <vector>
 
+#include "envoy/common/optional.h"
 #include "envoy/http/codes.h"
+#include "envoy/http/header_map.h"
 #include "envoy/json/json_object.h"
 #include "envoy/upstream/resource_manager.h"
 
 #include "common/common/empty_string.h"
+#include "common/common/regex.h"
 #include "common/config/rds_json.h"
 #include "common/http/headers.h"
 #include "common/http/utility.h"
@@ -24,25 +28,92 @@ namespace Router {
  */
 class ConfigUtility {
 public:
+  /**
+   * Assigns a slot to each distinct header name matched by the routes of a virtual host, so that a
+   * MatchContext looks each name up in a request at most once, however many routes match on it.
+   */
+  class HeaderNameIndex {
+  public:
+    static const uint32_t NO_SLOT = UINT32_MAX;
+
+    /**
+     * @param name supplies a header name.
+     * @return uint32_t the slot of the name, which is added to the index if it is new.
+     */
+    uint32_t add(const Http::LowerCaseString& name);
+
+    /**
+     * @return size_t the number of distinct names in the index.
+     */
+    size_t size() const { return slots_.size(); }
+
+  private:
+    std::unordered_map<std::string, uint32_t> slots_;
+  };
+
   struct HeaderData {
     // An empty header value allows for matching to be only based on header presence.
     // Regex is an opt-in. Unless explicitly mentioned, the header values will be used for
     // exact string matching.
-    HeaderData(const envoy::api::v2::HeaderMatcher& config)
+    HeaderData(const envoy::api::v2::HeaderMatcher& config,
+               Regex::Engine engine = Regex::Engine::Linear)
         : name_(config.name()), value_(config.value()),
-          regex_pattern_(value_, std::regex::optimize),
-          is_regex_(PROTOBUF_GET_WRAPPED_OR_DEFAULT(config, regex, false)) {}
-    HeaderData(const Json::Object& config)
-        : HeaderData([&config] {
-            envoy::api::v2::HeaderMatcher header_matcher;
-            Envoy::Config::RdsJson::translateHeaderMatcher(config, header_matcher);
-            return header_matcher;
-          }()) {}
+          is_regex_(PROTOBUF_GET_WRAPPED_OR_DEFAULT(config, regex, false)),
+          regex_pattern_(is_regex_ ? Regex::Utility::parseRegex(value_, engine) : nullptr) {}
+    HeaderData(const Json::Object& config, Regex::Engine engine = Regex::Engine::Linear)
+        : HeaderData(
+              [&config] {
+                envoy::api::v2::HeaderMatcher header_matcher;
+                Envoy::Config::RdsJson::translateHeaderMatcher(config, header_matcher);
+                return header_matcher;
+              }(),
+              engine) {}
 
     const Http::LowerCaseString name_;
     const std::string value_;
-    const std::regex regex_pattern_;
     const bool is_regex_;
+    // Only compiled when is_regex_ is set.
+    Regex::MatcherPtr regex_pattern_;
+    // The slot of name_ in the HeaderNameIndex of the virtual host, if it has been indexed.
+    uint32_t name_slot_{HeaderNameIndex::NO_SLOT};
+  };
+
+  /**
+   * The headers and query parameters of a request, looked up and parsed on first use and then
+   * shared by all the routes that are matched against the request.
+   */
+  class MatchContext {
+  public:
+    MatchContext(const Http::HeaderMap& headers, const HeaderNameIndex& header_names)
+        : headers_(headers), header_names_(header_names) {}
+
+    /**
+     * @param config_header supplies a configured header condition.
+     * @return const Http::HeaderEntry* the request header named by the condition, or nullptr if
+     *         the request does not have it.
+     */
+    const Http::HeaderEntry* header(const HeaderData& config_header);
+
+    /**
+     * @return const Http::Utility::QueryParams& the parsed query string of the request.
+     */
+    const Http::Utility::QueryParams& queryParams();
+
+    /**
+     * Record whether the path matcher of the route about to be matched is known to match, i.e.
+     * when the pattern of a regex route matched in the single pass over all of them.
+     */
+    void setPathMatched(bool path_matched) { path_matched_ = path_matched; }
+    bool pathMatched() const { return path_matched_; }
+
+  private:
+    const Http::HeaderMap& headers_;
+    const HeaderNameIndex& header_names_;
+    bool path_matched_{};
+    // The request headers by slot of their name, only valid if the slot has been looked up.
+    std::vector<const Http::HeaderEntry*> header_entries_;
+    std::vector<bool> looked_up_;
+    Optional<Http::Utility::QueryParams> query_params_;
   };
 
   // A QueryParameterMatcher specifies one "name" or "name=value" element
@@ -50,10 +121,11 @@ public:
   // equivalent of the QueryParameterMatcher proto in the RDS v2 API.
   class QueryParameterMatcher {
   public:
-    QueryParameterMatcher(const envoy::api::v2::QueryParameterMatcher& config)
+    QueryParameterMatcher(const envoy::api::v2::QueryParameterMatcher& config,
+                          Regex::Engine engine = Regex::Engine::Linear)
         : name_(config.name()), value_(config.value()),
-          regex_pattern_(value_, std::regex::optimize),
-          is_regex_(PROTOBUF_GET_WRAPPED_OR_DEFAULT(config, regex, false)) {}
+          is_regex_(PROTOBUF_GET_WRAPPED_OR_DEFAULT(config, regex, false)),
+          regex_pattern_(is_regex_ ? Regex::Utility::parseRegex(value_, engine) : nullptr) {}
 
     /**
      * Check if the query parameters for a request contain a match for this
@@ -66,8 +138,9 @@ public:
   private:
     const std::string name_;
     const std::string value_;
-    const std::regex regex_pattern_;
     const bool is_regex_;
+    // Only compiled when is_regex_ is set.
+    Regex::MatcherPtr regex_pattern_;
   };
 
   /**
@@ -85,6 +158,16 @@ public:
   static bool matchHeaders(const Http::HeaderMap& request_headers,
                            const std::vector<HeaderData>& config_headers);
 
+  /**
+   * See if the headers specified in the config are present in a request, looking the headers up
+   * through a MatchContext.
+   * @param context supplies the match context of the request.
+   * @param config_headers supplies the list of configured header conditions on which to match.
+   * @return bool true if all the headers (and values) in the config_headers are found in the
+   *         request headers.
+   */
+  static bool matchHeaders(MatchContext& context, const std::vector<HeaderData>& config_headers);
+
   /**
    * See if the query parameters specified in the config are present in a request.
    * @param query_params supplies the query parameters from the request's query string.
@@ -110,6 +193,9 @@ public:
    */
   static Http::Code parseClusterNotFoundResponseCode(
       const envoy::api::v2::RouteAction::ClusterNotFoundResponseCode& code);
+
+private:
+  static bool matchHeader(const HeaderData& config_header, const Http::HeaderEntry* header);
 };
 
 } // namespace Router
@@ -0,0 +1,154 @@
+#pragma once
+
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace Envoy {
+namespace Router {
+
+/**
+ * Maps domains and wildcard domains to values. Wildcard domains are of the form "*suffix", e.g.
+ * "*.foo.com" or "*-bar.foo.com", and match the hosts that end with the suffix and are longer
+ * than it. find() resolves a host to the value of the identical domain if there is one and
+ * otherwise to that of the wildcard domain with the longest matching suffix, in one walk of a
+ * radix tree keyed by the reversed domains.
+ */
+template <class T> class DomainTrie {
+public:
+  /**
+   * Add a domain.
+   * @param domain supplies the domain.
+   * @param value supplies the value of the domain.
+   * @return false if the domain was already added, in which case the existing value is kept.
+   */
+  bool addDomain(const std::string& domain, T value) {
+    return add(domain, std::move(value), &Node::exact_);
+  }
+
+  /**
+   * Add a wildcard domain.
+   * @param suffix supplies the wildcard domain without its leading '*'.
+   * @param value supplies the value of the wildcard domain.
+   * @return false if the wildcard domain was already added, in which case the existing value is
+   *         kept.
+   */
+  bool addWildcard(const std::string& suffix, T value) {
+    return add(suffix, std::move(value), &Node::wildcard_);
+  }
+
+  /**
+   * @param host supplies the host to look up.
+   * @param size supplies the length of the host.
+   * @return the value of the domain equal to the host, else of the longest matching wildcard
+   *         domain, else nullptr.
+   */
+  const T* find(const char* host, size_t size) const {
+    const T* wildcard = nullptr;
+    const Node* node = &root_;
+    // The number of characters from the end of the host matched so far.
+    size_t depth = 0;
+    while (true) {
+      // >= because *.foo.com shouldn't match .foo.com.
+      if (node->wildcard_ && depth < size) {
+        wildcard = node->wildcard_.get();
+      }
+      if (depth == size) {
+        return node->exact_ ? node->exact_.get() : wildcard;
+      }
+
+      const Node* child = node->child(host[size - depth - 1]);
+      if (child == nullptr) {
+        return wildcard;
+      }
+      const std::string& label = child->label_;
+      if (label.size() > size - depth) {
+        return wildcard;
+      }
+      for (size_t i = 1; i < label.size(); i++) {
+        if (label[i] != host[size - depth - i - 1]) {
+          return wildcard;
+        }
+      }
+      node = child;
+      depth += label.size();
+    }
+  }
+
+  const T* find(const std::string& host) const { return find(host.data(), host.size()); }
+
+  bool empty() const { return empty_; }
+
+private:
+  /**
+   * A node of the tree. The edge leading to a node is labeled with the reversed characters it
+   * matches, the first of which is the key of the node in its parent's children.
+   */
+  struct Node {
+    Node* child(char c) const {
+      for (const auto& child : children_) {
+        if (child.first == c) {
+          return child.second.get();
+        }
+      }
+      return nullptr;
+    }
+
+    std::string label_;
+    // Nodes have few children, which a linear scan finds faster than a map lookup.
+    std::vector<std::pair<char, std::unique_ptr<Node>>> children_;
+    std::unique_ptr<T> exact_;
+    std::unique_ptr<T> wildcard_;
+  };
+
+  bool add(const std::string& domain, T&& value, std::unique_ptr<T> Node::*slot) {
+    const std::string key(domain.rbegin(), domain.rend());
+    Node* node = &root_;
+    size_t position = 0;
+    while (position < key.size()) {
+      auto child = node->children_.begin();
+      while (child != node->children_.end() && child->first != key[position]) {
+        child++;
+      }
+      if (child == node->children_.end()) {
+        std::unique_ptr<Node> leaf(new Node());
+        leaf->label_ = key.substr(position);
+        node->children_.emplace_back(key[position], std::move(leaf));
+        node = node->children_.back().second.get();
+        break;
+      }
+
+      const std::string& label = child->second->label_;
+      size_t common = 0;
+      while (common < label.size() && position + common < key.size() &&
+             label[common] == key[position + common]) {
+        common++;
+      }
+      if (common < label.size()) {
+        // The key ends or diverges within the edge label: split the edge at that point.
+        std::unique_ptr<Node> split(new Node());
+        split->label_ = label.substr(0, common);
+        child->second->label_ = label.substr(common);
+        const char key_char = child->second->label_[0];
+        split->children_.emplace_back(key_char, std::move(child->second));
+        child->second = std::move(split);
+      }
+      node = child->second.get();
+      position += common;
+    }
+
+    if (node->*slot) {
+      return false;
+    }
+    (node->*slot).reset(new T(std::move(value)));
+    empty_ = false;
+    return true;
+  }
+
+  Node root_;
+  bool empty_{true};
+};
+
+} // namespace Router
+} // namespace Envoy
@@ -114,12 +114,16 @@ void RdsRouteConfigProviderImpl::onConfigUpdate(const ResourceVector& resources)
   }
   const uint64_t new_hash = MessageUtil::hash(route_config);
   if (new_hash != last_config_hash_ || !initialized_) {
-    ConfigConstSharedPtr new_config(new ConfigImpl(route_config, runtime_, cm_, false));
+    ConfigImplConstSharedPtr new_config(
+        new ConfigImpl(route_config, runtime_, cm_, false, last_config_.get()));
     initialized_ = true;
     last_config_hash_ = new_hash;
+    last_config_ = new_config;
     stats_.config_reload_.inc();
-    ENVOY_LOG(debug, "rds: loading new configuration: config_name={} hash={}", route_config_name_,
-              new_hash);
+    stats_.virtual_host_reused_.add(new_config->reusedVirtualHosts());
+    ENVOY_LOG(debug,
+              "rds: loading new configuration: config_name={} hash={} reused_virtual_hosts={}",
+              route_config_name_, new_hash, new_config->reusedVirtualHosts());
     tls_->runOnAllThreads(
         [this, new_config]() -> void { tls_->getTyped<ThreadLocalConfig>().config_ = new_config; });
     route_config_proto_ = route_config;
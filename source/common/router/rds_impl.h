@@ -62,7 +62,8 @@ private:
 // clang-format off
 #define ALL_RDS_STATS(COUNTER)                                                                     \
   COUNTER(config_reload)                                                                           \
-  COUNTER(update_empty)
+  COUNTER(update_empty)                                                                            \
+  COUNTER(virtual_host_reused)
 
 // clang-format on
 
@@ -134,6 +135,8 @@ private:
   const std::string route_config_name_;
   bool initialized_{};
   uint64_t last_config_hash_{};
+  // The last configuration loaded, whose unchanged virtual hosts the next one reuses.
+  ConfigImplConstSharedPtr last_config_;
   Stats::ScopePtr scope_;
   RdsStats stats_;
   std::function<void()> initialize_callback_;
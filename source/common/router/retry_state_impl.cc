@@ -24,6 +24,13 @@ const uint32_t RetryPolicy::RETRY_ON_GRPC_CANCELLED;
 const uint32_t RetryPolicy::RETRY_ON_GRPC_DEADLINE_EXCEEDED;
 const uint32_t RetryPolicy::RETRY_ON_GRPC_RESOURCE_EXHAUSTED;
 
+namespace {
+
+const Runtime::Key BASE_RETRY_BACKOFF_MS_KEY("upstream.base_retry_backoff_ms");
+const Runtime::Key USE_RETRY_KEY("upstream.use_retry");
+
+} // namespace
+
 RetryStatePtr RetryStateImpl::create(const RetryPolicy& route_policy,
                                      Http::HeaderMap& request_headers,
                                      const Upstream::ClusterInfo& cluster, Runtime::Loader& runtime,
@@ -77,7 +84,7 @@ void RetryStateImpl::enableBackoffTimer() {
   // We use a fully jittered exponential backoff algorithm.
   current_retry_++;
   uint32_t multiplier = (1 << current_retry_) - 1;
-  uint64_t base = runtime_.snapshot().getInteger("upstream.base_retry_backoff_ms", 25);
+  uint64_t base = runtime_.snapshot().getInteger(BASE_RETRY_BACKOFF_MS_KEY, 25);
   uint64_t timeout = random_.random() % (base * multiplier);
 
   if (!retry_timer_) {
@@ -148,12 +155,16 @@ RetryStatus RetryStateImpl::shouldRetry(const Http::HeaderMap* response_headers,
     return RetryStatus::No;
   }
 
-  if (!cluster_.resourceManager(priority_).retries().canCreate()) {
+  Upstream::ResourceManager& resource_manager = cluster_.resourceManager(priority_);
+  if (!resource_manager.retries().canCreate()) {
+    if (resource_manager.retryBudgetEnabled()) {
+      cluster_.stats().upstream_rq_retry_budget_exhausted_.inc();
+    }
     cluster_.stats().upstream_rq_retry_overflow_.inc();
     return RetryStatus::NoOverflow;
   }
 
-  if (!runtime_.snapshot().featureEnabled("upstream.use_retry", 100)) {
+  if (!runtime_.snapshot().featureEnabled(USE_RETRY_KEY, 100)) {
     return RetryStatus::No;
   }
 
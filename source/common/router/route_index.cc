@@ -0,0 +1,111 @@
+#include "common/router/route_index.h"
+
+#include <algorithm>
+#include <cctype>
+#include <cstring>
+
+namespace Envoy {
+namespace Router {
+
+void RouteIndex::addPath(const std::string& path, uint32_t route) {
+  std::string key(path);
+  toLowerCase(key);
+  paths_[key].push_back(route);
+}
+
+void RouteIndex::addPrefix(const std::string& prefix, uint32_t route) {
+  std::string key(prefix);
+  toLowerCase(key);
+  Node* node = &prefixes_;
+  size_t position = 0;
+  while (position < key.size()) {
+    auto child = node->children_.find(key[position]);
+    if (child == node->children_.end()) {
+      std::unique_ptr<Node> leaf(new Node());
+      leaf->label_ = key.substr(position);
+      node = node->children_.emplace(key[position], std::move(leaf)).first->second.get();
+      break;
+    }
+
+    const std::string& label = child->second->label_;
+    size_t common = 0;
+    while (common < label.size() && position + common < key.size() &&
+           label[common] == key[position + common]) {
+      common++;
+    }
+
+    if (common < label.size()) {
+      // The prefix ends or diverges within the edge label: split the edge at that point.
+      std::unique_ptr<Node> split(new Node());
+      split->label_ = label.substr(0, common);
+      child->second->label_ = label.substr(common);
+      const char key_char = child->second->label_[0];
+      split->children_.emplace(key_char, std::move(child->second));
+      child->second = std::move(split);
+    }
+
+    node = child->second.get();
+    position += common;
+  }
+
+  node->routes_.push_back(route);
+}
+
+void RouteIndex::addFallback(uint32_t route) { fallbacks_.push_back(route); }
+
+void RouteIndex::candidates(const char* path, size_t length,
+                            std::vector<uint32_t>& candidates) const {
+  candidates.clear();
+  candidates.insert(candidates.end(), fallbacks_.begin(), fallbacks_.end());
+
+  // Walk the radix tree along the whole path, query string included, collecting the routes of
+  // every node reached.
+  const Node* node = &prefixes_;
+  size_t position = 0;
+  while (true) {
+    candidates.insert(candidates.end(), node->routes_.begin(), node->routes_.end());
+    if (position == length) {
+      break;
+    }
+    auto child = node->children_.find(
+        static_cast<char>(tolower(static_cast<unsigned char>(path[position]))));
+    if (child == node->children_.end()) {
+      break;
+    }
+    const std::string& label = child->second->label_;
+    if (length - position < label.size()) {
+      break;
+    }
+    size_t i = 1;
+    while (i < label.size() &&
+           label[i] == static_cast<char>(tolower(static_cast<unsigned char>(path[position + i])))) {
+      i++;
+    }
+    if (i < label.size()) {
+      break;
+    }
+    node = child->second.get();
+    position += label.size();
+  }
+
+  if (!paths_.empty()) {
+    const char* query_string_start = static_cast<const char*>(memchr(path, '?', length));
+    std::string key(path, query_string_start != nullptr ? query_string_start - path : length);
+    toLowerCase(key);
+    const auto exact = paths_.find(key);
+    if (exact != paths_.end()) {
+      candidates.insert(candidates.end(), exact->second.begin(), exact->second.end());
+    }
+  }
+
+  std::sort(candidates.begin(), candidates.end());
+}
+
+void RouteIndex::toLowerCase(std::string& value) {
+  std::transform(value.begin(), value.end(), value.begin(), [](char c) -> char {
+    return static_cast<char>(tolower(static_cast<unsigned char>(c)));
+  });
+}
+
+} // namespace Router
+} // namespace Envoy
@@ -0,0 +1,78 @@
+#pragma once
+
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace Envoy {
+namespace Router {
+
+/**
+ * An index over the path matchers of a virtual host's routes, used to avoid evaluating every route
+ * of a large virtual host for each request. Routes are identified by their position in the route
+ * table. Given a request path, candidates() returns, in route table order, every route whose path
+ * matcher may match it:
+ * - exact path routes whose path equals the path (up to the query string),
+ * - prefix routes whose prefix the path starts with, found by walking a radix tree along the path,
+ * - every route added through addFallback(), whatever the path.
+ *
+ * Paths and prefixes are indexed case insensitively, so candidates are a superset of the routes
+ * that match; callers still evaluate each candidate in order and the first match wins, exactly as
+ * if every route had been evaluated.
+ */
+class RouteIndex {
+public:
+  /**
+   * Index a route matching a single path.
+   * @param path supplies the path, without a query string.
+   * @param route supplies the position of the route in the route table.
+   */
+  void addPath(const std::string& path, uint32_t route);
+
+  /**
+   * Index a route matching every path starting with a prefix.
+   * @param prefix supplies the prefix.
+   * @param route supplies the position of the route in the route table.
+   */
+  void addPrefix(const std::string& prefix, uint32_t route);
+
+  /**
+   * Add a route whose path matcher cannot be indexed (e.g. a regex), which is a candidate for any
+   * path.
+   * @param route supplies the position of the route in the route table.
+   */
+  void addFallback(uint32_t route);
+
+  /**
+   * Find the routes that may match a request path.
+   * @param path supplies the request path, including any query string.
+   * @param length supplies the length of the path.
+   * @param candidates is cleared and filled with the positions of the candidate routes, in
+   *        ascending order.
+   */
+  void candidates(const char* path, size_t length, std::vector<uint32_t>& candidates) const;
+
+private:
+  /**
+   * A node of the prefix radix tree. The edge leading to a node is labeled with a string of one or
+   * more characters, the first of which is the key of the node in its parent's children.
+   */
+  struct Node {
+    std::string label_;
+    std::map<char, std::unique_ptr<Node>> children_;
+    // Routes whose prefix ends at this node.
+    std::vector<uint32_t> routes_;
+  };
+
+  static void toLowerCase(std::string& value);
+
+  std::unordered_map<std::string, std::vector<uint32_t>> paths_;
+  Node prefixes_;
+  std::vector<uint32_t> fallbacks_;
+};
+
+} // namespace Router
+} // namespace Envoy
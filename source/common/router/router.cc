@@ -1,5 +1,6 @@
 #include "common/router/router.h"
 
+#include <algorithm>
 #include <chrono>
 #include <cstdint>
 #include <string>
@@ -21,7 +22,6 @@
 #include "common/http/codes.h"
 #include "common/http/header_map_impl.h"
 #include "common/http/headers.h"
-#include "common/http/message_impl.h"
 #include "common/http/utility.h"
 #include "common/router/config_impl.h"
 #include "common/router/retry_state_impl.h"
@@ -31,6 +31,13 @@ namespace Envoy {
 namespace Router {
 namespace {
 uint32_t getLength(const Buffer::Instance* instance) { return instance ? instance->length() : 0; }
+
+const std::string RouteCollapseKey = "collapse_requests";
+const std::string RouteCollapseHeadersKey = "collapse_key_headers";
+
+// Per try timeouts at least this long use a coarse timer, which may fire a fraction of a second
+// late. Shorter ones need the precision of a regular timer.
+const std::chrono::milliseconds MinCoarsePerTryTimeout{1000};
 } // namespace
 
 void FilterUtility::setUpstreamScheme(Http::HeaderMap& headers,
@@ -98,10 +105,33 @@ FilterUtility::TimeoutData FilterUtility::finalTimeout(const RouteEntry& route,
   return timeout;
 }
 
+Upstream::ResourcePriority FilterUtility::finalPriority(const RouteEntry& route,
+                                                       Http::HeaderMap& request_headers) {
+  // A request header may override the priority of the route, so that requests of different
+  // classes sharing a route do not queue behind each other or get shed alike.
+  Upstream::ResourcePriority priority = route.priority();
+  const Http::HeaderEntry* header_priority = request_headers.EnvoyUpstreamRequestPriority();
+  if (header_priority) {
+    const auto& values = Http::Headers::get().EnvoyUpstreamRequestPriorityValues;
+    if (values.High == header_priority->value().c_str()) {
+      priority = Upstream::ResourcePriority::High;
+    } else if (values.Default == header_priority->value().c_str()) {
+      priority = Upstream::ResourcePriority::Default;
+    }
+    request_headers.removeEnvoyUpstreamRequestPriority();
+  }
+
+  return priority;
+}
+
 Filter::~Filter() {
   // Upstream resources should already have been cleaned.
   ASSERT(!upstream_request_);
+  ASSERT(!hedge_request_);
   ASSERT(!retry_state_);
+  ASSERT(collapse_key_.empty());
+  ASSERT(collapsed_followers_.empty());
+  ASSERT(!collapsed_leader_);
 }
 
 const std::string Filter::upstreamZone(Upstream::HostDescriptionConstSharedPtr upstream_host) {
@@ -139,7 +169,8 @@ void Filter::chargeUpstreamCode(uint64_t response_status_code,
                                                                : EMPTY_STRING,
                                              zone_name,
                                              upstream_zone,
-                                             is_canary};
+                                             is_canary,
+                                             &cluster_->codeStats()};
 
     Http::CodeUtility::chargeResponseStat(info);
 
@@ -172,6 +203,12 @@ void Filter::chargeUpstreamCode(Http::Code code,
 }
 
 void Filter::sendLocalReply(Http::Code code, const std::string& body, bool overloaded) {
+  // The followers of the request get the reply they would have got had they gone upstream.
+  unregisterCollapsedRequest();
+  forwardToCollapsedFollowers(true, [code, &body, overloaded](Filter& follower) -> void {
+    follower.sendLocalReply(code, body, overloaded);
+  });
+
   // This is a customized version of send local reply that allows us to set the overloaded
   // header.
   Http::Utility::sendLocalReply(
@@ -219,7 +256,7 @@ Http::FilterHeadersStatus Filter::decodeHeaders(Http::HeaderMap& headers, bool e
 
   // A route entry matches for the request.
   route_entry_ = route_->routeEntry();
-  Upstream::ThreadLocalCluster* cluster = config_.cm_.get(route_entry_->clusterName());
+  Upstream::ThreadLocalCluster* cluster = threadLocalCluster();
   if (!cluster) {
     config_.stats_.no_cluster_.inc();
     ENVOY_STREAM_LOG(debug, "unknown cluster '{}'", *callbacks_, route_entry_->clusterName());
@@ -238,6 +275,8 @@ Http::FilterHeadersStatus Filter::decodeHeaders(Http::HeaderMap& headers, bool e
   ENVOY_STREAM_LOG(debug, "cluster '{}' match for URL '{}'", *callbacks_,
                    route_entry_->clusterName(), headers.Path()->value().c_str());
 
+  priority_ = FilterUtility::finalPriority(*route_entry_, headers);
+
   const Http::HeaderEntry* request_alt_name = headers.EnvoyUpstreamAltStatName();
   if (request_alt_name) {
     alt_stat_prefix_ = std::string(request_alt_name->value().c_str()) + ".";
@@ -253,11 +292,19 @@ Http::FilterHeadersStatus Filter::decodeHeaders(Http::HeaderMap& headers, bool e
     return Http::FilterHeadersStatus::StopIteration;
   }
 
+  // Requests with a body are never collapsed.
+  if (!end_stream || !collapseRequest(headers)) {
+    startUpstreamRequest(headers, end_stream);
+  }
+  return Http::FilterHeadersStatus::StopIteration;
+}
+
+void Filter::startUpstreamRequest(Http::HeaderMap& headers, bool end_stream) {
   // Fetch a connection pool for the upstream cluster.
   Http::ConnectionPool::Instance* conn_pool = getConnPool();
   if (!conn_pool) {
     sendNoHealthyUpstreamResponse();
-    return Http::FilterHeadersStatus::StopIteration;
+    return;
   }
 
   timeout_ = FilterUtility::finalTimeout(*route_entry_, headers);
@@ -272,9 +319,9 @@ Http::FilterHeadersStatus Filter::decodeHeaders(Http::HeaderMap& headers, bool e
   FilterUtility::setUpstreamScheme(headers, *cluster_);
   retry_state_ =
       createRetryState(route_entry_->retryPolicy(), headers, *cluster_, config_.runtime_,
-                       config_.random_, callbacks_->dispatcher(), route_entry_->priority());
-  do_shadowing_ = FilterUtility::shouldShadow(route_entry_->shadowPolicy(), config_.runtime_,
-                                              callbacks_->streamId());
+                       config_.random_, callbacks_->dispatcher(), priority_);
+  // A hash policy would send the second attempt to the host of the first.
+  hedging_ = route_entry_->retryPolicy().hedgePolicy() != nullptr && !route_entry_->hashPolicy();
 
 #ifndef NVLOG
   headers.iterate(
@@ -297,14 +344,124 @@ Http::FilterHeadersStatus Filter::decodeHeaders(Http::HeaderMap& headers, bool e
   grpc_request_ = Grpc::Common::hasGrpcContentType(headers);
   upstream_request_.reset(new UpstreamRequest(*this, *conn_pool));
   upstream_request_->encodeHeaders(end_stream);
+  // Even if we got an immediate reset, we could still shadow, but that is a riskier change and
+  // seems unnecessary right now.
+  if (upstream_request_ && FilterUtility::shouldShadow(route_entry_->shadowPolicy(),
+                                                       config_.runtime_, callbacks_->streamId())) {
+    const ShadowPolicy& policy = route_entry_->shadowPolicy();
+    ASSERT(!policy.cluster().empty());
+    shadow_stream_ = config_.shadowWriter().start(policy.cluster(), headers, end_stream,
+                                                  timeout_.global_timeout_, policy.maxBodyBytes());
+  }
   if (end_stream) {
     onRequestComplete();
   }
+}
 
-  return Http::FilterHeadersStatus::StopIteration;
+std::string Filter::collapseKey(const Http::HeaderMap& headers) const {
+  const std::multimap<std::string, std::string>& opaque_config = route_entry_->opaqueConfig();
+  const auto enabled = opaque_config.find(RouteCollapseKey);
+  if (enabled == opaque_config.end() || enabled->second != "true") {
+    return EMPTY_STRING;
+  }
+  const Http::HeaderString& method = headers.Method()->value();
+  if (method != Http::Headers::get().MethodValues.Get.c_str() &&
+      method != Http::Headers::get().MethodValues.Head.c_str()) {
+    return EMPTY_STRING;
+  }
+
+  // Header values cannot contain newlines. The route entry outlives the requests keyed on it
+  // since each of them holds the route.
+  std::string key = fmt::format("{}\n{}\n{}\n{}", static_cast<const void*>(route_entry_),
+                                method.c_str(), headers.Host()->value().c_str(),
+                                headers.Path()->value().c_str());
+  const auto key_headers = opaque_config.find(RouteCollapseHeadersKey);
+  if (key_headers != opaque_config.end()) {
+    for (const std::string& name : StringUtil::split(key_headers->second, ',')) {
+      const Http::HeaderEntry* header = headers.get(Http::LowerCaseString(name));
+      // Tell a missing header from an empty one.
+      key += header ? "\n=" + std::string(header->value().c_str()) : "\n";
+    }
+  }
+  return key;
+}
+
+bool Filter::collapseRequest(const Http::HeaderMap& headers) {
+  CollapsedRequests* collapsed_requests = config_.collapsedRequests();
+  if (collapsed_requests == nullptr) {
+    return false;
+  }
+  std::string key = collapseKey(headers);
+  if (key.empty()) {
+    return false;
+  }
+
+  const auto leader = collapsed_requests->leaders_.find(key);
+  if (leader == collapsed_requests->leaders_.end()) {
+    collapse_key_ = key;
+    collapsed_requests->leaders_.emplace(std::move(key), this);
+    return false;
+  }
+
+  ENVOY_STREAM_LOG(debug, "collapsed into an identical request", *callbacks_);
+  config_.stats_.rq_collapsed_.inc();
+  collapsed_leader_ = leader->second;
+  collapsed_entry_ = collapsed_leader_->collapsed_followers_.insert(
+      collapsed_leader_->collapsed_followers_.end(), this);
+  return true;
+}
+
+void Filter::unregisterCollapsedRequest() {
+  if (!collapse_key_.empty()) {
+    config_.collapsedRequests()->leaders_.erase(collapse_key_);
+    collapse_key_.clear();
+  }
+}
+
+void Filter::forwardToCollapsedFollowers(bool detach, const std::function<void(Filter&)>& cb) {
+  if (detach) {
+    while (!collapsed_followers_.empty()) {
+      Filter& follower = *collapsed_followers_.front();
+      collapsed_followers_.pop_front();
+      follower.collapsed_leader_ = nullptr;
+      cb(follower);
+    }
+    return;
+  }
+
+  // A follower may detach itself while handling the call.
+  for (auto it = collapsed_followers_.begin(); it != collapsed_followers_.end();) {
+    Filter& follower = **it++;
+    cb(follower);
+  }
+}
+
+void Filter::onCollapsedHeaders(const Http::HeaderMap& headers, bool end_stream) {
+  Http::HeaderMapPtr response_headers{new Http::HeaderMapImpl(headers)};
+  route_entry_->finalizeResponseHeaders(*response_headers, callbacks_->requestInfo());
+  downstream_response_started_ = true;
+  callbacks_->encodeHeaders(std::move(response_headers), end_stream);
+}
+
+void Filter::onCollapsedLeaderDestroyed() {
+  // The first of the followers to be released becomes the leader of the others.
+  if (!collapseRequest(*downstream_headers_)) {
+    startUpstreamRequest(*downstream_headers_, true);
+  }
+}
+
+Upstream::ThreadLocalCluster* Filter::threadLocalCluster() {
+  const Upstream::ClusterHandle* handle = route_entry_->clusterHandle();
+  return handle != nullptr ? handle->get() : config_.cm_.get(route_entry_->clusterName());
 }
 
 Http::ConnectionPool::Instance* Filter::getConnPool() {
+  // The cluster may have been removed since the request started.
+  Upstream::ThreadLocalCluster* cluster = threadLocalCluster();
+  if (!cluster) {
+    return nullptr;
+  }
+
   // Choose protocol based on cluster configuration and downstream connection
   // Note: Cluster may downgrade HTTP2 to HTTP1 based on runtime configuration.
   auto features = cluster_->features();
@@ -316,8 +473,7 @@ Http::ConnectionPool::Instance* Filter::getConnPool() {
     protocol = (features & Upstream::ClusterInfo::Features::HTTP2) ? Http::Protocol::Http2
                                                                    : Http::Protocol::Http11;
   }
-  return config_.cm_.httpConnPoolForCluster(route_entry_->clusterName(), route_entry_->priority(),
-                                            protocol, this);
+  return cluster->httpConnPool(priority_, protocol, this);
 }
 
 void Filter::sendNoHealthyUpstreamResponse() {
@@ -326,22 +482,36 @@ void Filter::sendNoHealthyUpstreamResponse() {
   sendLocalReply(Http::Code::ServiceUnavailable, "no healthy upstream", false);
 }
 
+uint64_t Filter::replayLimit() const {
+  const uint64_t max_replay_bytes = route_entry_->retryPolicy().maxReplayBytes();
+  return buffer_limit_ > 0 ? std::min<uint64_t>(buffer_limit_, max_replay_bytes)
+                           : max_replay_bytes;
+}
+
 Http::FilterDataStatus Filter::decodeData(Buffer::Instance& data, bool end_stream) {
-  bool buffering = (retry_state_ && retry_state_->enabled()) || do_shadowing_;
-  if (buffering && buffer_limit_ > 0 &&
-      getLength(callbacks_->decodingBuffer()) + data.length() > buffer_limit_) {
-    // The request is larger than we should buffer. Give up on the retry/shadow
+  bool buffering = (retry_state_ && retry_state_->enabled()) || hedging_;
+  if (buffering && getLength(callbacks_->decodingBuffer()) + data.length() > replayLimit()) {
+    // The request is larger than we should buffer. Give up on the retry/hedge
     cluster_->stats().retry_or_shadow_abandoned_.inc();
     retry_state_.reset();
     buffering = false;
-    do_shadowing_ = false;
+    hedging_ = false;
+  }
+
+  if (shadow_stream_) {
+    // The shadow shares the slices of the data, so it has to get them before they move upstream.
+    // It goes on alone once the request is complete.
+    if (!shadow_stream_->sendData(data, end_stream) || end_stream) {
+      shadow_stream_.reset();
+    }
   }
 
-  // If we are going to buffer for retries or shadowing, we need to make a copy before encoding
-  // since it's all moves from here on.
+  // If we are going to buffer for retries or hedging, the connection manager keeps the data and
+  // the attempt gets a reference to its slices, since it's all moves from here on.
   if (buffering) {
-    Buffer::OwnedImpl copy(data);
-    upstream_request_->encodeData(copy, end_stream);
+    Buffer::OwnedImpl shared;
+    shared.addShared(data);
+    upstream_request_->encodeData(shared, end_stream);
   } else {
     upstream_request_->encodeData(data, end_stream);
   }
@@ -350,7 +520,7 @@ Http::FilterDataStatus Filter::decodeData(Buffer::Instance& data, bool end_strea
     onRequestComplete();
   }
 
-  // If we are potentially going to retry or shadow this request we need to buffer.
+  // If we are potentially going to retry or hedge this request we need to buffer.
   // This will not cause the connection manager to 413 because before we hit the
   // buffer limit we give up on retries and buffering.
   return buffering ? Http::FilterDataStatus::StopIterationAndBuffer
@@ -359,6 +529,10 @@ Http::FilterDataStatus Filter::decodeData(Buffer::Instance& data, bool end_strea
 
 Http::FilterTrailersStatus Filter::decodeTrailers(Http::HeaderMap& trailers) {
   downstream_trailers_ = &trailers;
+  if (shadow_stream_) {
+    shadow_stream_->sendTrailers(trailers);
+    shadow_stream_.reset();
+  }
   upstream_request_->encodeTrailers(trailers);
   onRequestComplete();
   return Http::FilterTrailersStatus::StopIteration;
@@ -374,6 +548,11 @@ void Filter::setDecoderFilterCallbacks(Http::StreamDecoderFilterCallbacks& callb
 
 void Filter::cleanup() {
   upstream_request_.reset();
+  if (hedge_request_) {
+    hedge_request_->resetStream();
+    hedge_request_.reset();
+  }
+  resetHedgeTimer();
   retry_state_.reset();
   if (response_timeout_) {
     response_timeout_->disableTimer();
@@ -381,52 +560,116 @@ void Filter::cleanup() {
   }
 }
 
-void Filter::maybeDoShadowing() {
-  if (!do_shadowing_) {
-    return;
-  }
-
-  ASSERT(!route_entry_->shadowPolicy().cluster().empty());
-  Http::MessagePtr request(new Http::RequestMessageImpl(
-      Http::HeaderMapPtr{new Http::HeaderMapImpl(*downstream_headers_)}));
-  if (callbacks_->decodingBuffer()) {
-    request->body().reset(new Buffer::OwnedImpl(*callbacks_->decodingBuffer()));
-  }
-  if (downstream_trailers_) {
-    request->trailers(Http::HeaderMapPtr{new Http::HeaderMapImpl(*downstream_trailers_)});
-  }
-
-  config_.shadowWriter().shadow(route_entry_->shadowPolicy().cluster(), std::move(request),
-                                timeout_.global_timeout_);
-}
-
 void Filter::onRequestComplete() {
   downstream_end_stream_ = true;
   downstream_request_complete_time_ = std::chrono::steady_clock::now();
-  callbacks_->requestInfo().requestReceivedDuration(downstream_request_complete_time_);
+  // The connection manager records when it received the request, before any filter buffered it.
+  if (!callbacks_->requestInfo().requestReceivedDuration().valid()) {
+    callbacks_->requestInfo().requestReceivedDuration(downstream_request_complete_time_);
+  }
 
   // Possible that we got an immediate reset.
   if (upstream_request_) {
     // Nominally how long it took to send the request.
     upstream_request_->request_info_.requestReceivedDuration(downstream_request_complete_time_);
 
-    // Even if we got an immediate reset, we could still shadow, but that is a riskier change and
-    // seems unnecessary right now.
-    maybeDoShadowing();
-
     upstream_request_->setupPerTryTimeout();
     if (timeout_.global_timeout_.count() > 0) {
       response_timeout_ =
           callbacks_->dispatcher().createTimer([this]() -> void { onResponseTimeout(); });
       response_timeout_->enableTimer(timeout_.global_timeout_);
     }
+
+    if (hedging_) {
+      const std::chrono::milliseconds delay =
+          route_entry_->retryPolicy().hedgePolicy()->hedgeDelay();
+      if (delay.count() > 0 &&
+          (timeout_.global_timeout_.count() == 0 || delay < timeout_.global_timeout_)) {
+        hedge_timer_ = callbacks_->dispatcher().createTimer([this]() -> void { onHedgeTimeout(); });
+        hedge_timer_->enableTimer(delay);
+      }
+    }
+  }
+}
+
+void Filter::onHedgeTimeout() {
+  // The attempt may have failed and be waiting for a retry.
+  if (!upstream_request_ || hedge_request_) {
+    return;
+  }
+  if (!route_entry_->retryPolicy().hedgePolicy()->tryHedge()) {
+    config_.stats_.rq_hedge_budget_exhausted_.inc();
+    return;
+  }
+  Http::ConnectionPool::Instance* conn_pool = getConnPool();
+  if (!conn_pool) {
+    return;
+  }
+
+  ENVOY_STREAM_LOG(debug, "hedging the request", *callbacks_);
+  config_.stats_.rq_hedged_.inc();
+  hedge_request_.reset(new UpstreamRequest(*this, *conn_pool));
+  encodeBufferedRequest(hedge_request_);
+}
+
+void Filter::resetHedgeTimer() {
+  if (hedge_timer_) {
+    hedge_timer_->disableTimer();
+    hedge_timer_.reset();
+  }
+}
+
+void Filter::onHedgeAttemptHeaders(UpstreamRequest& attempt) {
+  ASSERT(hedge_request_);
+  if (&attempt == hedge_request_.get()) {
+    config_.stats_.rq_hedge_won_.inc();
+    upstream_request_.swap(hedge_request_);
+  }
+  hedge_request_->resetStream();
+  hedge_request_.reset();
+  callbacks_->requestInfo().onUpstreamHostSelected(upstream_request_->upstream_host_);
+}
+
+void Filter::onHedgeAttemptFailed(UpstreamRequest& attempt, uint64_t response_code) {
+  ASSERT(hedge_request_);
+  ENVOY_STREAM_LOG(debug, "hedged attempt failed, waiting for the other", *callbacks_);
+  if (attempt.upstream_host_) {
+    attempt.upstream_host_->outlierDetector().putHttpResponseCode(response_code);
+    attempt.upstream_host_->stats().rq_error_.inc();
+  }
+  // This destroys the attempt.
+  if (&attempt == upstream_request_.get()) {
+    upstream_request_ = std::move(hedge_request_);
+  } else {
+    hedge_request_.reset();
+  }
+  if (upstream_request_->upstream_host_) {
+    callbacks_->requestInfo().onUpstreamHostSelected(upstream_request_->upstream_host_);
   }
 }
 
 void Filter::onDestroy() {
+  if (collapsed_leader_) {
+    collapsed_leader_->collapsed_followers_.erase(collapsed_entry_);
+    collapsed_leader_ = nullptr;
+  }
+  // The followers of the request lose its upstream request. If the response has not started they
+  // can still go upstream themselves.
+  unregisterCollapsedRequest();
+  const bool response_started = downstream_response_started_;
+  forwardToCollapsedFollowers(true, [response_started](Filter& follower) -> void {
+    if (response_started) {
+      follower.callbacks_->resetStream();
+    } else {
+      follower.onCollapsedLeaderDestroyed();
+    }
+  });
+
   if (upstream_request_) {
     upstream_request_->resetStream();
   }
+  // A shadow still attached to the request did not get all of it and is reset.
+  shadow_stream_.reset();
   stream_destroyed_ = true;
   cleanup();
 }
@@ -486,6 +729,8 @@ void Filter::onUpstreamReset(UpstreamResetType type,
     }
     // This will destroy any created retry timers.
     cleanup();
+    forwardToCollapsedFollowers(
+        true, [](Filter& follower) -> void { follower.callbacks_->resetStream(); });
     callbacks_->resetStream();
   } else {
     // This will destroy any created retry timers.
@@ -563,6 +808,8 @@ void Filter::onUpstreamHeaders(const uint64_t response_code, Http::HeaderMapPtr&
                                bool end_stream) {
   ENVOY_STREAM_LOG(debug, "upstream headers complete: end_stream={}", *callbacks_, end_stream);
   ASSERT(!downstream_response_started_);
+  ASSERT(!hedge_request_);
+  resetHedgeTimer();
 
   upstream_request_->upstream_host_->outlierDetector().putHttpResponseCode(response_code);
 
@@ -577,8 +824,7 @@ void Filter::onUpstreamHeaders(const uint64_t response_code, Http::HeaderMapPtr&
     // upstream_request_.
     const auto upstream_host = upstream_request_->upstream_host_;
     if (retry_status == RetryStatus::Yes && setupRetry(end_stream)) {
-      Http::CodeUtility::chargeBasicResponseStat(cluster_->statsScope(), "retry.",
-                                                 static_cast<Http::Code>(response_code));
+      cluster_->codeStats().chargeRetryResponseStat(response_code);
       upstream_host->stats().rq_error_.inc();
       return;
     } else if (retry_status == RetryStatus::NoOverflow) {
@@ -609,6 +855,13 @@ void Filter::onUpstreamHeaders(const uint64_t response_code, Http::HeaderMapPtr&
     handleNon5xxResponseHeaders(*headers, end_stream);
   }
 
+  // Requests arriving from now on go upstream themselves. The followers get the headers before
+  // the cookies and header mutations of this request are applied.
+  unregisterCollapsedRequest();
+  forwardToCollapsedFollowers(end_stream, [&headers, end_stream](Filter& follower) -> void {
+    follower.onCollapsedHeaders(*headers, end_stream);
+  });
+
   // Append routing cookies
   for (const auto& header_value : downstream_set_cookies_) {
     headers->addReferenceKey(Http::Headers::get().SetCookie, header_value);
@@ -636,6 +889,10 @@ void Filter::onUpstreamData(Buffer::Instance& data, bool end_stream) {
     onUpstreamComplete();
   }
 
+  forwardToCollapsedFollowers(end_stream, [&data, end_stream](Filter& follower) -> void {
+    Buffer::OwnedImpl copy(data);
+    follower.callbacks_->encodeData(copy, end_stream);
+  });
   callbacks_->encodeData(data, end_stream);
 }
 
@@ -650,19 +907,33 @@ void Filter::onUpstreamTrailers(Http::HeaderMapPtr&& trailers) {
     }
   }
   onUpstreamComplete();
+  forwardToCollapsedFollowers(true, [&trailers](Filter& follower) -> void {
+    follower.callbacks_->encodeTrailers(Http::HeaderMapPtr{new Http::HeaderMapImpl(*trailers)});
+  });
   callbacks_->encodeTrailers(std::move(trailers));
 }
 
 void Filter::onUpstreamComplete() {
+  const MonotonicTime response_complete_time = std::chrono::steady_clock::now();
+  callbacks_->requestInfo().upstreamLastByteReceivedDuration(response_complete_time);
+  upstream_request_->request_info_.upstreamLastByteReceivedDuration(response_complete_time);
+
   if (!downstream_end_stream_) {
     upstream_request_->resetStream();
   }
 
-  if (config_.emit_dynamic_stats_ && !callbacks_->requestInfo().healthCheck() &&
-      DateUtil::timePointValid(downstream_request_complete_time_)) {
-    std::chrono::milliseconds response_time = std::chrono::duration_cast<std::chrono::milliseconds>(
+  const bool response_time_valid = !callbacks_->requestInfo().healthCheck() &&
+                                   DateUtil::timePointValid(downstream_request_complete_time_);
+  std::chrono::milliseconds response_time{};
+  if (response_time_valid) {
+    response_time = std::chrono::duration_cast<std::chrono::milliseconds>(
         std::chrono::steady_clock::now() - downstream_request_complete_time_);
+    // The response time estimate of the host is used by load balancing, so unlike the stats below
+    // it is kept whether or not dynamic stats are emitted.
+    upstream_request_->upstream_host_->putResponseTime(response_time);
+  }
 
+  if (config_.emit_dynamic_stats_ && response_time_valid) {
     upstream_request_->upstream_host_->outlierDetector().putResponseTime(response_time);
 
     const Http::HeaderEntry* internal_request_header = downstream_headers_->EnvoyInternalRequest();
@@ -682,7 +953,8 @@ void Filter::onUpstreamComplete() {
                                                request_vcluster_ ? request_vcluster_->name()
                                                                  : EMPTY_STRING,
                                                zone_name,
-                                               upstreamZone(upstream_request_->upstream_host_)};
+                                               upstreamZone(upstream_request_->upstream_host_),
+                                               &cluster_->codeStats()};
 
     Http::CodeUtility::chargeResponseTiming(info);
 
@@ -721,6 +993,7 @@ bool Filter::setupRetry(bool end_stream) {
   }
 
   upstream_request_.reset();
+  resetHedgeTimer();
   return true;
 }
 
@@ -735,26 +1008,31 @@ void Filter::doRetry() {
   ASSERT(response_timeout_ || timeout_.global_timeout_.count() == 0);
   ASSERT(!upstream_request_);
   upstream_request_.reset(new UpstreamRequest(*this, *conn_pool));
-  upstream_request_->encodeHeaders(!callbacks_->decodingBuffer() && !downstream_trailers_);
+  encodeBufferedRequest(upstream_request_);
+}
+
+void Filter::encodeBufferedRequest(UpstreamRequestPtr& upstream_request) {
+  upstream_request->encodeHeaders(!callbacks_->decodingBuffer() && !downstream_trailers_);
   // It's possible we got immediately reset.
-  if (upstream_request_) {
+  if (upstream_request) {
     if (callbacks_->decodingBuffer()) {
       // If we are doing a retry we need to make a copy.
       Buffer::OwnedImpl copy(*callbacks_->decodingBuffer());
-      upstream_request_->encodeData(copy, !downstream_trailers_);
+      upstream_request->encodeData(copy, !downstream_trailers_);
     }
 
     if (downstream_trailers_) {
-      upstream_request_->encodeTrailers(*downstream_trailers_);
+      upstream_request->encodeTrailers(*downstream_trailers_);
     }
 
-    upstream_request_->setupPerTryTimeout();
+    upstream_request->setupPerTryTimeout();
   }
 }
 
 Filter::UpstreamRequest::UpstreamRequest(Filter& parent, Http::ConnectionPool::Instance& pool)
     : parent_(parent), conn_pool_(pool), grpc_rq_success_deferred_(false),
-      request_info_(pool.protocol()), calling_encode_headers_(false), upstream_canary_(false),
+      request_info_(pool.protocol()), start_time_(std::chrono::steady_clock::now()),
+      calling_encode_headers_(false), upstream_canary_(false),
       encode_complete_(false), encode_trailers_(false) {
 
   if (parent_.config_.start_child_span_) {
@@ -787,6 +1065,19 @@ void Filter::UpstreamRequest::decodeHeaders(Http::HeaderMapPtr&& headers, bool e
   upstream_headers_ = headers.get();
   const uint64_t response_code = Http::Utility::getResponseStatus(*headers);
   request_info_.response_code_.value(static_cast<uint32_t>(response_code));
+  const HedgePolicy* hedge_policy = parent_.route_entry_->retryPolicy().hedgePolicy();
+  if (hedge_policy != nullptr) {
+    hedge_policy->recordResponseTime(std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::steady_clock::now() - start_time_));
+  }
+  if (parent_.hedge_request_) {
+    if (Http::CodeUtility::is5xx(response_code)) {
+      resetStream();
+      parent_.onHedgeAttemptFailed(*this, response_code);
+      return;
+    }
+    parent_.onHedgeAttemptHeaders(*this);
+  }
   parent_.onUpstreamHeaders(response_code, std::move(headers), end_stream);
 }
 
@@ -803,6 +1094,10 @@ void Filter::UpstreamRequest::encodeHeaders(bool end_stream) {
   ASSERT(!encode_complete_);
   encode_complete_ = end_stream;
 
+  const MonotonicTime connect_start_time = std::chrono::steady_clock::now();
+  parent_.callbacks_->requestInfo().upstreamConnectStartDuration(connect_start_time);
+  request_info_.upstreamConnectStartDuration(connect_start_time);
+
   // It's possible for a reset to happen inline within the newStream() call. In this case, we might
   // get deleted inline as well. Only write the returned handle out if it is not nullptr to deal
   // with this case.
@@ -850,6 +1145,10 @@ void Filter::UpstreamRequest::onResetStream(Http::StreamResetReason reason) {
   clearRequestEncoder();
   if (!calling_encode_headers_) {
     request_info_.setResponseFlag(parent_.streamResetReasonToResponseFlag(reason));
+    if (parent_.hedge_request_) {
+      parent_.onHedgeAttemptFailed(*this, enumToInt(Http::Code::ServiceUnavailable));
+      return;
+    }
     parent_.onUpstreamReset(UpstreamResetType::Reset, Optional<Http::StreamResetReason>(reason));
   } else {
     deferred_reset_reason_ = reason;
@@ -874,8 +1173,11 @@ void Filter::UpstreamRequest::resetStream() {
 void Filter::UpstreamRequest::setupPerTryTimeout() {
   ASSERT(!per_try_timeout_);
   if (parent_.timeout_.per_try_timeout_.count() > 0) {
-    per_try_timeout_ =
-        parent_.callbacks_->dispatcher().createTimer([this]() -> void { onPerTryTimeout(); });
+    Event::Dispatcher& dispatcher = parent_.callbacks_->dispatcher();
+    Event::TimerCb cb = [this]() -> void { onPerTryTimeout(); };
+    per_try_timeout_ = parent_.timeout_.per_try_timeout_ >= MinCoarsePerTryTimeout
+                           ? dispatcher.createCoarseTimer(cb)
+                           : dispatcher.createTimer(cb);
     per_try_timeout_->enableTimer(parent_.timeout_.per_try_timeout_);
   }
 }
@@ -888,6 +1190,10 @@ void Filter::UpstreamRequest::onPerTryTimeout() {
   }
   resetStream();
   request_info_.setResponseFlag(RequestInfo::ResponseFlag::UpstreamRequestTimeout);
+  if (parent_.hedge_request_) {
+    parent_.onHedgeAttemptFailed(*this, enumToInt(parent_.timeout_response_code_));
+    return;
+  }
   parent_.onUpstreamReset(UpstreamResetType::PerTryTimeout,
                           Optional<Http::StreamResetReason>(Http::StreamResetReason::LocalReset));
 }
@@ -912,6 +1218,9 @@ void Filter::UpstreamRequest::onPoolFailure(Http::ConnectionPool::PoolFailureRea
 void Filter::UpstreamRequest::onPoolReady(Http::StreamEncoder& request_encoder,
                                           Upstream::HostDescriptionConstSharedPtr host) {
   ENVOY_STREAM_LOG(debug, "pool ready", *parent_.callbacks_);
+  const MonotonicTime connect_end_time = std::chrono::steady_clock::now();
+  parent_.callbacks_->requestInfo().upstreamConnectEndDuration(connect_end_time);
+  request_info_.upstreamConnectEndDuration(connect_end_time);
 
   // TODO(ggreenway): set upstream local address in the RequestInfo.
   onUpstreamHostSelected(host);
@@ -2,8 +2,11 @@
 
 #include <chrono>
 #include <cstdint>
+#include <functional>
+#include <list>
 #include <memory>
 #include <string>
+#include <unordered_map>
 
 #include "envoy/http/codec.h"
 #include "envoy/http/codes.h"
@@ -13,6 +16,7 @@
 #include "envoy/runtime/runtime.h"
 #include "envoy/server/filter_config.h"
 #include "envoy/stats/stats_macros.h"
+#include "envoy/thread_local/thread_local.h"
 #include "envoy/upstream/cluster_manager.h"
 
 #include "common/access_log/access_log_impl.h"
@@ -36,6 +40,10 @@ namespace Router {
   COUNTER(no_route)                                                                                \
   COUNTER(no_cluster)                                                                              \
   COUNTER(rq_redirect)                                                                             \
+  COUNTER(rq_collapsed)                                                                            \
+  COUNTER(rq_hedged)                                                                               \
+  COUNTER(rq_hedge_won)                                                                            \
+  COUNTER(rq_hedge_budget_exhausted)                                                               \
   COUNTER(rq_total)
 // clang-format on
 
@@ -79,6 +87,26 @@ public:
    * @return TimeoutData for both the global and per try timeouts.
    */
   static TimeoutData finalTimeout(const RouteEntry& route, Http::HeaderMap& request_headers);
+
+  /**
+   * Determine the priority of the upstream request, which selects the connection pools and circuit
+   * breakers it uses, based on the route as well as the request headers.
+   * @param route supplies the request route.
+   * @param request_headers supplies the request headers, which are stripped of the priority
+   *        header.
+   * @return Upstream::ResourcePriority the priority.
+   */
+  static Upstream::ResourcePriority finalPriority(const RouteEntry& route,
+                                                  Http::HeaderMap& request_headers);
+};
+
+class Filter;
+
+/**
+ * The requests of a worker that identical requests collapse into, by collapse key.
+ */
+struct CollapsedRequests : public ThreadLocal::ThreadLocalObject {
+  std::unordered_map<std::string, Filter*> leaders_;
 };
 
 /**
@@ -86,27 +114,43 @@ public:
  */
 class FilterConfig {
 public:
+  /**
+   * @param tls supplies the slot allocator of the per worker collapsed requests. Requests are
+   *        never collapsed if it is nullptr.
+   */
   FilterConfig(const std::string& stat_prefix, const LocalInfo::LocalInfo& local_info,
                Stats::Scope& scope, Upstream::ClusterManager& cm, Runtime::Loader& runtime,
                Runtime::RandomGenerator& random, ShadowWriterPtr&& shadow_writer,
-               bool emit_dynamic_stats, bool start_child_span)
+               bool emit_dynamic_stats, bool start_child_span,
+               ThreadLocal::SlotAllocator* tls = nullptr)
       : scope_(scope), local_info_(local_info), cm_(cm), runtime_(runtime),
         random_(random), stats_{ALL_ROUTER_STATS(POOL_COUNTER_PREFIX(scope, stat_prefix))},
         emit_dynamic_stats_(emit_dynamic_stats), start_child_span_(start_child_span),
-        shadow_writer_(std::move(shadow_writer)) {}
+        shadow_writer_(std::move(shadow_writer)) {
+    if (tls != nullptr) {
+      collapsed_requests_ = tls->allocateSlot();
+      collapsed_requests_->set([](Event::Dispatcher&) -> ThreadLocal::ThreadLocalObjectSharedPtr {
+        return std::make_shared<CollapsedRequests>();
+      });
+    }
+  }
 
   FilterConfig(const std::string& stat_prefix, Server::Configuration::FactoryContext& context,
                ShadowWriterPtr&& shadow_writer, const envoy::api::v2::filter::http::Router& config)
       : FilterConfig(stat_prefix, context.localInfo(), context.scope(), context.clusterManager(),
                      context.runtime(), context.random(), std::move(shadow_writer),
                      PROTOBUF_GET_WRAPPED_OR_DEFAULT(config, dynamic_stats, true),
-                     config.start_child_span()) {
+                     config.start_child_span(), &context.threadLocal()) {
     for (const auto& upstream_log : config.upstream_log()) {
       upstream_logs_.push_back(AccessLog::AccessLogFactory::fromProto(upstream_log, context));
     }
   }
 
   ShadowWriter& shadowWriter() { return *shadow_writer_; }
+  // nullptr if requests are never collapsed.
+  CollapsedRequests* collapsedRequests() {
+    return collapsed_requests_ ? &collapsed_requests_->getTyped<CollapsedRequests>() : nullptr;
+  }
 
   Stats::Scope& scope_;
   const LocalInfo::LocalInfo& local_info_;
@@ -120,20 +164,31 @@ public:
 
 private:
   ShadowWriterPtr shadow_writer_;
+  ThreadLocal::SlotPtr collapsed_requests_;
 };
 
 typedef std::shared_ptr<FilterConfig> FilterConfigSharedPtr;
 
 /**
  * Service routing filter.
+ *
+ * Routes with the "collapse_requests" opaque config key set to "true" collapse identical GET and
+ * HEAD requests without a body: while a request is waiting for the response headers of its
+ * upstream request, the identical requests arriving on the worker attach to it instead of going
+ * upstream, and the response is forwarded to each of them. Requests are identical if they have
+ * the same route entry, method, host and path, and the same values of the comma separated
+ * request headers listed by the "collapse_key_headers" key.
+ *
+ * Routes with a HedgePolicy send a second attempt of the requests that have not received response
+ * headers after the hedge delay, and take the response of the attempt that responds first without
+ * a 5xx. An attempt that fails while the other is outstanding is dropped.
  */
 class Filter : Logger::Loggable<Logger::Id::router>,
                public Http::StreamDecoderFilter,
                public Upstream::LoadBalancerContext {
 public:
   Filter(FilterConfig& config)
-      : config_(config), downstream_response_started_(false), downstream_end_stream_(false),
-        do_shadowing_(false) {}
+      : config_(config), downstream_response_started_(false), downstream_end_stream_(false) {}
 
   ~Filter();
 
@@ -268,6 +323,7 @@ private:
     Tracing::SpanPtr span_;
     RequestInfo::RequestInfoImpl request_info_;
     Http::HeaderMap* upstream_headers_{};
+    const MonotonicTime start_time_;
 
     bool calling_encode_headers_ : 1;
     bool upstream_canary_ : 1;
@@ -293,8 +349,11 @@ private:
                                          Runtime::Loader& runtime, Runtime::RandomGenerator& random,
                                          Event::Dispatcher& dispatcher,
                                          Upstream::ResourcePriority priority) PURE;
+  // The thread local cluster of the route, found through the route's cluster handle if it has one.
+  Upstream::ThreadLocalCluster* threadLocalCluster();
   Http::ConnectionPool::Instance* getConnPool();
-  void maybeDoShadowing();
+  // The size of the request body past which the request is no longer retried or hedged.
+  uint64_t replayLimit() const;
   void onRequestComplete();
   void onResponseTimeout();
   void onUpstreamHeaders(uint64_t response_code, Http::HeaderMapPtr&& headers, bool end_stream);
@@ -306,15 +365,37 @@ private:
   void sendNoHealthyUpstreamResponse();
   bool setupRetry(bool end_stream);
   void doRetry();
+  // Send headers, buffered body and trailers of the downstream request to a new attempt.
+  void encodeBufferedRequest(UpstreamRequestPtr& upstream_request);
+  void onHedgeTimeout();
+  void resetHedgeTimer();
+  // Called when an attempt of a hedged request receives response headers while the other attempt
+  // is outstanding. The other attempt is reset.
+  void onHedgeAttemptHeaders(UpstreamRequest& attempt);
+  // Called when an attempt of a hedged request fails while the other attempt is outstanding. The
+  // attempt is destroyed and the other one goes on alone.
+  void onHedgeAttemptFailed(UpstreamRequest& attempt, uint64_t response_code);
   // Called immediately after a non-5xx header is received from upstream, performs stats accounting
   // and handle difference between gRPC and non-gRPC requests.
   void handleNon5xxResponseHeaders(const Http::HeaderMap& headers, bool end_stream);
   void sendLocalReply(Http::Code code, const std::string& body, bool overloaded);
+  void startUpstreamRequest(Http::HeaderMap& headers, bool end_stream);
+  // Attach the request to the leader of an identical request, or register it as the leader if
+  // there is none. Returns true if the request was attached.
+  bool collapseRequest(const Http::HeaderMap& headers);
+  // The key of the request if the route collapses it, else empty.
+  std::string collapseKey(const Http::HeaderMap& headers) const;
+  void unregisterCollapsedRequest();
+  // Call a function on each follower, and detach them first if the leader forwards nothing more.
+  void forwardToCollapsedFollowers(bool detach, const std::function<void(Filter&)>& cb);
+  void onCollapsedHeaders(const Http::HeaderMap& headers, bool end_stream);
+  void onCollapsedLeaderDestroyed();
 
   FilterConfig& config_;
   Http::StreamDecoderFilterCallbacks* callbacks_{};
   RouteConstSharedPtr route_;
   const RouteEntry* route_entry_{};
+  Upstream::ResourcePriority priority_{};
   Upstream::ClusterInfoConstSharedPtr cluster_;
   std::string alt_stat_prefix_;
   const VirtualCluster* request_vcluster_;
@@ -322,6 +403,12 @@ private:
   FilterUtility::TimeoutData timeout_;
   Http::Code timeout_response_code_ = Http::Code::GatewayTimeout;
   UpstreamRequestPtr upstream_request_;
+  // The second attempt of a hedged request, while both attempts are outstanding.
+  UpstreamRequestPtr hedge_request_;
+  Event::TimerPtr hedge_timer_;
+  bool hedging_{};
+  // The shadow of the request, until the request is complete.
+  ShadowStreamPtr shadow_stream_;
   bool grpc_request_{};
   Http::HeaderMap* downstream_headers_{};
   Http::HeaderMap* downstream_trailers_{};
@@ -331,10 +418,15 @@ private:
 
   // list of cookies to add to upstream headers
   std::vector<std::string> downstream_set_cookies_;
+  // Set while the request is the leader identical requests collapse into.
+  std::string collapse_key_;
+  std::list<Filter*> collapsed_followers_;
+  // Set while the request waits for the response of a leader.
+  Filter* collapsed_leader_{};
+  std::list<Filter*>::iterator collapsed_entry_;
 
   bool downstream_response_started_ : 1;
   bool downstream_end_stream_ : 1;
-  bool do_shadowing_ : 1;
 };
 
 class ProdFilter : public Filter {
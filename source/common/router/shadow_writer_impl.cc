@@ -1,27 +1,169 @@
 #include "common/router/shadow_writer_impl.h"
 
 #include <chrono>
+#include <cstdint>
 #include <string>
 
+#include "common/buffer/buffer_impl.h"
 #include "common/common/assert.h"
 #include "common/http/headers.h"
 
 namespace Envoy {
 namespace Router {
 
-void ShadowWriterImpl::shadow(const std::string& cluster, Http::MessagePtr&& request,
-                              std::chrono::milliseconds timeout) {
+ActiveShadow::ActiveShadow(Upstream::ClusterInfoConstSharedPtr cluster,
+                           Event::Dispatcher& dispatcher, const Http::HeaderMap& headers,
+                           uint64_t max_body_bytes)
+    : cluster_(cluster), dispatcher_(dispatcher), headers_(headers),
+      max_body_bytes_(max_body_bytes) {
   // Switch authority to add a shadow postfix. This allows upstream logging to make a more sense.
-  // TODO PERF: Avoid copy.
-  std::string host = request->headers().Host()->value().c_str();
+  std::string host = headers_.Host()->value().c_str();
   ASSERT(!host.empty());
   host += "-shadow";
-  request->headers().Host()->value(host);
+  headers_.Host()->value(host);
+}
+
+bool ActiveShadow::start(Http::AsyncClient& client, bool end_stream,
+                         std::chrono::milliseconds timeout) {
+  local_complete_ = end_stream;
+  stream_ = client.start(*this, Optional<std::chrono::milliseconds>(timeout), false);
+  if (stream_ == nullptr) {
+    // The client may or may not have already reset us inline.
+    if (!finished_) {
+      finish();
+    }
+    return false;
+  }
+
+  // The stream may be reset or answered locally before this returns.
+  stream_->sendHeaders(headers_, end_stream);
+  return !finished_;
+}
+
+bool ActiveShadow::sendData(Buffer::Instance& data, bool end_stream) {
+  ASSERT(stream_ != nullptr && !local_complete_);
+  if (remote_complete_) {
+    // The shadow upstream has already responded, so it would discard the rest of the request.
+    reset();
+    return false;
+  }
+
+  body_bytes_ += data.length();
+  if (body_bytes_ > max_body_bytes_ || stream_->isAboveWriteBufferHighWatermark()) {
+    drop();
+    return false;
+  }
+
+  local_complete_ = end_stream;
+  // The shadow references the slices of the request rather than copying them, and the request
+  // keeps its data to send upstream.
+  Buffer::OwnedImpl shared;
+  shared.addShared(data);
+  stream_->sendData(shared, end_stream);
+  return !finished_;
+}
+
+void ActiveShadow::sendTrailers(const Http::HeaderMap& trailers) {
+  ASSERT(stream_ != nullptr && !local_complete_);
+  if (remote_complete_) {
+    reset();
+    return;
+  }
+
+  local_complete_ = true;
+  trailers_.reset(new Http::HeaderMapImpl(trailers));
+  stream_->sendTrailers(*trailers_);
+}
+
+void ActiveShadow::reset() {
+  ASSERT(stream_ != nullptr);
+  // This calls onReset(), which finishes the shadow.
+  stream_->reset();
+  ASSERT(finished_);
+}
+
+void ActiveShadow::onHeaders(Http::HeaderMapPtr&&, bool end_stream) {
+  if (end_stream) {
+    onRemoteComplete();
+  }
+}
+
+void ActiveShadow::onData(Buffer::Instance&, bool end_stream) {
+  if (end_stream) {
+    onRemoteComplete();
+  }
+}
+
+void ActiveShadow::onTrailers(Http::HeaderMapPtr&&) { onRemoteComplete(); }
+
+void ActiveShadow::onReset() {
+  stream_ = nullptr;
+  finish();
+}
+
+void ActiveShadow::drop() {
+  cluster_->stats().upstream_rq_shadow_dropped_.inc();
+  reset();
+}
+
+void ActiveShadow::onRemoteComplete() {
+  remote_complete_ = true;
+  if (local_complete_) {
+    // The stream cleans itself up once both directions are complete.
+    stream_ = nullptr;
+    finish();
+  }
+}
+
+void ActiveShadow::finish() {
+  ASSERT(!finished_);
+  finished_ = true;
+  if (handle_ != nullptr) {
+    handle_->shadow_ = nullptr;
+    handle_ = nullptr;
+  }
+  dispatcher_.deferredDelete(Event::DeferredDeletablePtr{this});
+}
+
+ShadowStreamImpl::~ShadowStreamImpl() {
+  if (shadow_ == nullptr) {
+    return;
+  }
+
+  shadow_->attach(nullptr);
+  if (!shadow_->localComplete()) {
+    // The request was abandoned before its end, so the shadow cannot be completed either.
+    shadow_->reset();
+  }
+}
+
+bool ShadowStreamImpl::sendData(Buffer::Instance& data, bool end_stream) {
+  return shadow_ != nullptr && shadow_->sendData(data, end_stream);
+}
+
+void ShadowStreamImpl::sendTrailers(const Http::HeaderMap& trailers) {
+  if (shadow_ != nullptr) {
+    shadow_->sendTrailers(trailers);
+  }
+}
+
+ShadowStreamPtr ShadowWriterImpl::start(const std::string& cluster, const Http::HeaderMap& headers,
+                                        bool end_stream, std::chrono::milliseconds timeout,
+                                        uint64_t max_body_bytes) {
+  // Configuration should guarantee that the cluster exists, but CDS may have removed it since.
+  // This is basically fire and forget once the request is complete.
+  Upstream::ThreadLocalCluster* thread_local_cluster = cm_.get(cluster);
+  if (thread_local_cluster == nullptr) {
+    return nullptr;
+  }
 
-  // Configuration should guarantee that cluster exists before calling here. This is basically
-  // fire and forget. We don't handle cancelling.
-  cm_.httpAsyncClientForCluster(cluster).send(std::move(request), *this,
-                                              Optional<std::chrono::milliseconds>(timeout));
+  Http::AsyncClient& client = cm_.httpAsyncClientForCluster(cluster);
+  ActiveShadow* shadow =
+      new ActiveShadow(thread_local_cluster->info(), client.dispatcher(), headers, max_body_bytes);
+  if (!shadow->start(client, end_stream, timeout) || end_stream) {
+    return nullptr;
+  }
+  return ShadowStreamPtr{new ShadowStreamImpl(*shadow)};
 }
 
 } // namespace Router
@@ -1,29 +1,105 @@
 #pragma once
 
 #include <chrono>
+#include <cstdint>
 #include <string>
 
+#include "envoy/event/deferred_deletable.h"
+#include "envoy/event/dispatcher.h"
+#include "envoy/http/async_client.h"
 #include "envoy/router/shadow_writer.h"
 #include "envoy/upstream/cluster_manager.h"
+#include "envoy/upstream/upstream.h"
+
+#include "common/http/header_map_impl.h"
 
 namespace Envoy {
 namespace Router {
 
+class ShadowStreamImpl;
+
 /**
- * Implementation of ShadowWriter that takes incoming requests to shadow and implements "fire and
- * forget" behavior using an async client.
+ * A shadow request in flight on an async client stream. It owns itself, so that the shadow can
+ * outlive the request it shadows, and is deleted once the stream is complete or reset.
+ *
+ * The shadow is dropped, and counted in the upstream_rq_shadow_dropped stat of the shadow
+ * cluster, when the body goes over the size limit or when data is sent while the upstream
+ * connection of the shadow is above its write buffer high watermark. Neither ever pushes back on
+ * the request being shadowed.
  */
-class ShadowWriterImpl : public ShadowWriter, public Http::AsyncClient::Callbacks {
+class ActiveShadow : public Http::AsyncClient::StreamCallbacks, public Event::DeferredDeletable {
+public:
+  ActiveShadow(Upstream::ClusterInfoConstSharedPtr cluster, Event::Dispatcher& dispatcher,
+               const Http::HeaderMap& headers, uint64_t max_body_bytes);
+
+  /**
+   * Start the stream and send the headers.
+   * @return false if the shadow is already over, in which case it has been scheduled for deletion.
+   */
+  bool start(Http::AsyncClient& client, bool end_stream, std::chrono::milliseconds timeout);
+
+  bool sendData(Buffer::Instance& data, bool end_stream);
+  void sendTrailers(const Http::HeaderMap& trailers);
+  void reset();
+  bool localComplete() const { return local_complete_; }
+  void attach(ShadowStreamImpl* handle) { handle_ = handle; }
+
+  // Http::AsyncClient::StreamCallbacks
+  void onHeaders(Http::HeaderMapPtr&&, bool end_stream) override;
+  void onData(Buffer::Instance&, bool end_stream) override;
+  void onTrailers(Http::HeaderMapPtr&&) override;
+  void onReset() override;
+
+private:
+  void drop();
+  void onRemoteComplete();
+  void finish();
+
+  Upstream::ClusterInfoConstSharedPtr cluster_;
+  Event::Dispatcher& dispatcher_;
+  // The stream keeps references to the headers and trailers until it is destroyed.
+  Http::HeaderMapImpl headers_;
+  Http::HeaderMapPtr trailers_;
+  const uint64_t max_body_bytes_;
+  uint64_t body_bytes_{};
+  Http::AsyncClient::Stream* stream_{};
+  ShadowStreamImpl* handle_{};
+  bool local_complete_{};
+  bool remote_complete_{};
+  bool finished_{};
+};
+
+/**
+ * The handle the router holds to an ActiveShadow. The shadow detaches from the handle when it is
+ * over, and the handle detaches from the shadow when it is destroyed.
+ */
+class ShadowStreamImpl : public ShadowStream {
+public:
+  ShadowStreamImpl(ActiveShadow& shadow) : shadow_(&shadow) { shadow.attach(this); }
+  ~ShadowStreamImpl();
+
+  // Router::ShadowStream
+  bool sendData(Buffer::Instance& data, bool end_stream) override;
+  void sendTrailers(const Http::HeaderMap& trailers) override;
+
+private:
+  ActiveShadow* shadow_;
+
+  friend class ActiveShadow;
+};
+
+/**
+ * Implementation of ShadowWriter that streams the requests to shadow over an async client and
+ * implements "fire and forget" behavior.
+ */
+class ShadowWriterImpl : public ShadowWriter {
 public:
   ShadowWriterImpl(Upstream::ClusterManager& cm) : cm_(cm) {}
 
   // Router::ShadowWriter
-  void shadow(const std::string& cluster, Http::MessagePtr&& request,
-              std::chrono::milliseconds timeout) override;
-
-  // Http::AsyncClient::Callbacks
-  void onSuccess(Http::MessagePtr&&) override {}
-  void onFailure(Http::AsyncClient::FailureReason) override {}
+  ShadowStreamPtr start(const std::string& cluster, const Http::HeaderMap& headers,
+                        bool end_stream, std::chrono::milliseconds timeout,
+                        uint64_t max_body_bytes) override;
 
 private:
   Upstream::ClusterManager& cm_;
@@ -3,7 +3,9 @@
 #include <fcntl.h>
 #include <unistd.h>
 
+#include <array>
 #include <cstdint>
+#include <cstring>
 #include <random>
 #include <string>
 #include <unordered_map>
@@ -24,6 +26,32 @@ namespace Runtime {
 
 const size_t RandomGeneratorImpl::UUID_LENGTH = 36;
 
+namespace {
+
+// The lowercase hex digits of every byte value, two per byte.
+const std::array<char, 512> HEX_PAIRS = []() {
+  static const char* const hex = "0123456789abcdef";
+  std::array<char, 512> pairs;
+  for (size_t i = 0; i < 256; i++) {
+    pairs[2 * i] = hex[i >> 4];
+    pairs[2 * i + 1] = hex[i & 0x0f];
+  }
+  return pairs;
+}();
+
+// The modification time of a file in nanoseconds, so that a file that is replaced or modified
+// within a second of the previous snapshot is read again.
+int64_t modificationTimeNs(const struct stat& stat_result) {
+#ifdef __APPLE__
+  const struct timespec& modification_time = stat_result.st_mtimespec;
+#else
+  const struct timespec& modification_time = stat_result.st_mtim;
+#endif
+  return static_cast<int64_t>(modification_time.tv_sec) * 1000000000 + modification_time.tv_nsec;
+}
+
+} // namespace
+
 uint64_t RandomGeneratorImpl::random() {
   // Prefetch 256 * sizeof(uint64_t) bytes of randomness. buffered_idx is initialized to 256,
   // i.e. out-of-range value, so the buffer will be filled with randomness on the first call
@@ -103,70 +131,49 @@ std::string RandomGeneratorImpl::uuid() {
   rand[6] = (rand[6] & 0x0f) | 0x40; // UUID version 4 (random)
   rand[8] = (rand[8] & 0x3f) | 0x80; // UUID variant 1 (RFC4122)
 
-  // Convert UUID to a string representation, e.g. a121e9e1-feae-4136-9e0e-6fac343d56c9.
-  static const char* const hex = "0123456789abcdef";
-  char uuid[UUID_LENGTH];
-
-  for (uint8_t i = 0; i < 4; i++) {
-    const uint8_t d = rand[i];
-    uuid[2 * i] = hex[d >> 4];
-    uuid[2 * i + 1] = hex[d & 0x0f];
-  }
-
-  uuid[8] = '-';
-
-  for (uint8_t i = 4; i < 6; i++) {
-    const uint8_t d = rand[i];
-    uuid[2 * i + 1] = hex[d >> 4];
-    uuid[2 * i + 2] = hex[d & 0x0f];
-  }
-
-  uuid[13] = '-';
-
-  for (uint8_t i = 6; i < 8; i++) {
-    const uint8_t d = rand[i];
-    uuid[2 * i + 2] = hex[d >> 4];
-    uuid[2 * i + 3] = hex[d & 0x0f];
-  }
-
-  uuid[18] = '-';
-
-  for (uint8_t i = 8; i < 10; i++) {
-    const uint8_t d = rand[i];
-    uuid[2 * i + 3] = hex[d >> 4];
-    uuid[2 * i + 4] = hex[d & 0x0f];
-  }
-
-  uuid[23] = '-';
-
-  for (uint8_t i = 10; i < 16; i++) {
-    const uint8_t d = rand[i];
-    uuid[2 * i + 4] = hex[d >> 4];
-    uuid[2 * i + 5] = hex[d & 0x0f];
+  // Convert UUID to a string representation, e.g. a121e9e1-feae-4136-9e0e-6fac343d56c9, writing
+  // the two hex digits of each byte at once straight into the string.
+  std::string uuid(UUID_LENGTH, '-');
+  char* out = &uuid[0];
+  for (uint8_t i = 0; i < 16; i++) {
+    if (i == 4 || i == 6 || i == 8 || i == 10) {
+      out++;
+    }
+    memcpy(out, &HEX_PAIRS[2 * rand[i]], 2);
+    out += 2;
   }
 
-  return std::string(uuid, UUID_LENGTH);
+  return uuid;
 }
 
 SnapshotImpl::SnapshotImpl(const std::string& root_path, const std::string& override_path,
                            RuntimeStats& stats, RandomGenerator& generator,
-                           Api::OsSysCalls& os_sys_calls)
-    : generator_(generator), os_sys_calls_(os_sys_calls) {
+                           Api::OsSysCalls& os_sys_calls, uint64_t version, FileCache& file_cache)
+    : generator_(generator), os_sys_calls_(os_sys_calls), version_(version) {
+  FileCache files;
   try {
-    walkDirectory(root_path, "");
+    walkDirectory(root_path, "", file_cache, files);
     if (Filesystem::directoryExists(override_path)) {
-      walkDirectory(override_path, "");
+      walkDirectory(override_path, "", file_cache, files);
       stats.override_dir_exists_.inc();
     } else {
       stats.override_dir_not_exists_.inc();
     }
 
     stats.load_success_.inc();
+    file_cache = std::move(files);
   } catch (EnvoyException& e) {
     stats.load_error_.inc();
     ENVOY_LOG(debug, "error creating runtime snapshot: {}", e.what());
   }
 
+  const std::vector<std::string> key_names = Key::registeredNames();
+  key_values_.reserve(key_names.size());
+  for (const std::string& name : key_names) {
+    auto entry = values_.find(name);
+    key_values_.push_back(entry == values_.end() ? nullptr : &entry->second);
+  }
+
   stats.num_keys_.set(values_.size());
 }
 
@@ -188,11 +195,27 @@ uint64_t SnapshotImpl::getInteger(const std::string& key, uint64_t default_value
   }
 }
 
+uint64_t SnapshotImpl::getInteger(const Key& key, uint64_t default_value) const {
+  key.countLookup();
+  if (key.index() >= key_values_.size()) {
+    // The key was registered after the snapshot was loaded.
+    return getInteger(key.name(), default_value);
+  }
+
+  const Entry* entry = key_values_[key.index()];
+  if (entry == nullptr || !entry->uint_value_.valid()) {
+    return default_value;
+  } else {
+    return entry->uint_value_.value();
+  }
+}
+
 const std::unordered_map<std::string, const Snapshot::Entry>& SnapshotImpl::getAll() const {
   return values_;
 }
 
-void SnapshotImpl::walkDirectory(const std::string& path, const std::string& prefix) {
+void SnapshotImpl::walkDirectory(const std::string& path, const std::string& prefix,
+                                 const FileCache& previous_files, FileCache& files) {
   ENVOY_LOG(debug, "walking directory: {}", path);
   Directory current_dir(path);
   while (true) {
@@ -222,13 +245,27 @@ void SnapshotImpl::walkDirectory(const std::string& path, const std::string& pre
 
     if (S_ISDIR(stat_result.st_mode) && std::string(entry->d_name) != "." &&
         std::string(entry->d_name) != "..") {
-      walkDirectory(full_path, full_prefix);
+      walkDirectory(full_path, full_prefix, previous_files, files);
     } else if (S_ISREG(stat_result.st_mode)) {
+      // A file is only read again if it was replaced or modified since the previous snapshot.
+      CachedFile file{stat_result.st_dev, stat_result.st_ino, stat_result.st_size,
+                      modificationTimeNs(stat_result), {}};
+      auto previous_file = previous_files.find(full_path);
+      if (previous_file != previous_files.end() &&
+          previous_file->second.device_ == file.device_ &&
+          previous_file->second.inode_ == file.inode_ &&
+          previous_file->second.size_ == file.size_ &&
+          previous_file->second.modification_time_ns_ == file.modification_time_ns_) {
+        addEntry(full_prefix, previous_file->second.entry_);
+        files[full_path] = previous_file->second;
+        continue;
+      }
+
       // Suck the file into a string. This is not very efficient but it should be good enough
       // for small files. Also, as noted elsewhere, none of this is non-blocking which could
       // theoretically lead to issues.
       ENVOY_LOG(debug, "reading file: {}", full_path);
-      Entry entry;
+      Entry& entry = file.entry_;
 
       // Read the file and remove any comments. A comment is a line starting with a '#' character.
       // Comments are useful for placeholder files with no value.
@@ -249,26 +286,41 @@ void SnapshotImpl::walkDirectory(const std::string& path, const std::string& pre
         entry.uint_value_.value(converted);
       }
 
-      // Separate erase/insert calls required due to the value type being constant; this prevents
-      // the use of the [] operator. Can leverage insert_or_assign in C++17 in the future.
-      values_.erase(full_prefix);
-      values_.insert({full_prefix, entry});
+      addEntry(full_prefix, entry);
+      files[full_path] = std::move(file);
     }
   }
 }
 
+void SnapshotImpl::addEntry(const std::string& key, const Entry& entry) {
+  // Separate erase/insert calls required due to the value type being constant; this prevents
+  // the use of the [] operator. Can leverage insert_or_assign in C++17 in the future.
+  values_.erase(key);
+  values_.insert({key, entry});
+}
+
 LoaderImpl::LoaderImpl(Event::Dispatcher& dispatcher, ThreadLocal::SlotAllocator& tls,
                        const std::string& root_symlink_path, const std::string& subdir,
                        const std::string& override_dir, Stats::Store& store,
                        RandomGenerator& generator, Api::OsSysCallsPtr os_sys_calls)
-    : watcher_(dispatcher.createFilesystemWatcher()), tls_(tls.allocateSlot()),
-      generator_(generator), root_path_(root_symlink_path + "/" + subdir),
+    : dispatcher_(dispatcher), watcher_(dispatcher.createFilesystemWatcher()),
+      tls_(tls.allocateSlot()), generator_(generator),
+      root_path_(root_symlink_path + "/" + subdir),
       override_path_(root_symlink_path + "/" + override_dir), stats_(generateStats(store)),
       os_sys_calls_(std::move(os_sys_calls)) {
   watcher_->addWatch(root_symlink_path, Filesystem::Watcher::Events::MovedTo,
                      [this](uint32_t) -> void { onSymlinkSwap(); });
 
-  onSymlinkSwap();
+  // The first snapshot is loaded on the main thread, as the server needs it to start.
+  // Snapshots of a loader are numbered from 1, so that they never look like the null snapshot.
+  setSnapshot(std::make_shared<SnapshotImpl>(root_path_, override_path_, stats_, generator_,
+                                             *os_sys_calls_, ++snapshot_version_, file_cache_));
+}
+
+LoaderImpl::~LoaderImpl() {
+  if (load_thread_ != nullptr) {
+    load_thread_->join();
+  }
 }
 
 RuntimeStats LoaderImpl::generateStats(Stats::Store& store) {
@@ -279,8 +331,44 @@ RuntimeStats LoaderImpl::generateStats(Stats::Store& store) {
 }
 
 void LoaderImpl::onSymlinkSwap() {
-  current_snapshot_.reset(
-      new SnapshotImpl(root_path_, override_path_, stats_, generator_, *os_sys_calls_));
+  // A swap while a snapshot is being loaded is loaded once that one is done, since the files may
+  // have been read before the swap.
+  if (loading_) {
+    reload_pending_ = true;
+    return;
+  }
+  loadSnapshot();
+}
+
+void LoaderImpl::loadSnapshot() {
+  ASSERT(!loading_);
+  if (load_thread_ != nullptr) {
+    // The previous load has posted its snapshot, so this does not block for long.
+    load_thread_->join();
+  }
+
+  loading_ = true;
+  const uint64_t version = ++snapshot_version_;
+  const std::weak_ptr<bool> alive = alive_;
+  load_thread_.reset(new Thread::Thread([this, version, alive]() -> void {
+    std::shared_ptr<SnapshotImpl> snapshot = std::make_shared<SnapshotImpl>(
+        root_path_, override_path_, stats_, generator_, *os_sys_calls_, version, file_cache_);
+    dispatcher_.post([this, snapshot, alive]() -> void {
+      if (alive.expired()) {
+        return;
+      }
+      loading_ = false;
+      setSnapshot(snapshot);
+      if (reload_pending_) {
+        reload_pending_ = false;
+        loadSnapshot();
+      }
+    });
+  }));
+}
+
+void LoaderImpl::setSnapshot(std::shared_ptr<SnapshotImpl> snapshot) {
+  current_snapshot_ = snapshot;
   ThreadLocal::ThreadLocalObjectSharedPtr ptr_copy = current_snapshot_;
   tls_->set([ptr_copy](Event::Dispatcher&) -> ThreadLocal::ThreadLocalObjectSharedPtr {
     return ptr_copy;
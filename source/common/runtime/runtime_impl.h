@@ -1,6 +1,7 @@
 #pragma once
 
 #include <dirent.h>
+#include <sys/stat.h>
 
 #include <cstdint>
 #include <memory>
@@ -54,6 +55,23 @@ struct RuntimeStats {
   ALL_RUNTIME_STATS(GENERATE_COUNTER_STRUCT, GENERATE_GAUGE_STRUCT)
 };
 
+/**
+ * A runtime file that a snapshot read, with the identity and the modification time the file had,
+ * so that the next snapshot of the loader does not read it again if they have not changed.
+ */
+struct CachedFile {
+  dev_t device_;
+  ino_t inode_;
+  off_t size_;
+  int64_t modification_time_ns_;
+  Snapshot::Entry entry_;
+};
+
+/**
+ * The runtime files of a snapshot, by path.
+ */
+typedef std::unordered_map<std::string, CachedFile> FileCache;
+
 /**
  * Implementation of Snapshot that reads from disk.
  */
@@ -61,8 +79,14 @@ class SnapshotImpl : public Snapshot,
                      public ThreadLocal::ThreadLocalObject,
                      Logger::Loggable<Logger::Id::runtime> {
 public:
+  /**
+   * @param file_cache supplies the files read by the previous snapshot, which are not read again
+   *        if they have not changed. It is replaced by the files of this snapshot if they are all
+   *        loaded.
+   */
   SnapshotImpl(const std::string& root_path, const std::string& override_path, RuntimeStats& stats,
-               RandomGenerator& generator, Api::OsSysCalls& os_sys_calls);
+               RandomGenerator& generator, Api::OsSysCalls& os_sys_calls, uint64_t version,
+               FileCache& file_cache);
 
   // Runtime::Snapshot
   bool featureEnabled(const std::string& key, uint64_t default_value, uint64_t random_value,
@@ -72,15 +96,7 @@ public:
   }
 
   bool featureEnabled(const std::string& key, uint64_t default_value) const override {
-    // Avoid PNRG if we know we don't need it.
-    uint64_t cutoff = std::min(getInteger(key, default_value), static_cast<uint64_t>(100));
-    if (cutoff == 0) {
-      return false;
-    } else if (cutoff == 100) {
-      return true;
-    } else {
-      return generator_.random() % 100 < cutoff;
-    }
+    return enabled(getInteger(key, default_value));
   }
 
   bool featureEnabled(const std::string& key, uint64_t default_value,
@@ -88,9 +104,21 @@ public:
     return featureEnabled(key, default_value, random_value, 100);
   }
 
+  bool featureEnabled(const Key& key, uint64_t default_value) const override {
+    return enabled(getInteger(key, default_value));
+  }
+
+  bool featureEnabled(const Key& key, uint64_t default_value,
+                      uint64_t random_value) const override {
+    return random_value % 100 <
+           std::min(getInteger(key, default_value), static_cast<uint64_t>(100));
+  }
+
   const std::string& get(const std::string& key) const override;
   uint64_t getInteger(const std::string&, uint64_t default_value) const override;
+  uint64_t getInteger(const Key& key, uint64_t default_value) const override;
   const std::unordered_map<std::string, const Snapshot::Entry>& getAll() const override;
+  uint64_t version() const override { return version_; }
 
 private:
   struct Directory {
@@ -106,18 +134,38 @@ private:
     DIR* dir_;
   };
 
-  void walkDirectory(const std::string& path, const std::string& prefix);
+  bool enabled(uint64_t value) const {
+    // Avoid PNRG if we know we don't need it.
+    uint64_t cutoff = std::min(value, static_cast<uint64_t>(100));
+    if (cutoff == 0) {
+      return false;
+    } else if (cutoff == 100) {
+      return true;
+    } else {
+      return generator_.random() % 100 < cutoff;
+    }
+  }
+
+  void walkDirectory(const std::string& path, const std::string& prefix,
+                     const FileCache& previous_files, FileCache& files);
+  void addEntry(const std::string& key, const Entry& entry);
 
   std::unordered_map<std::string, const Entry> values_;
+  // The entries of the keys that were registered when the snapshot was loaded, by index, or nullptr
+  // for the keys that do not exist. See Runtime::Key.
+  std::vector<const Entry*> key_values_;
   RandomGenerator& generator_;
   Api::OsSysCalls& os_sys_calls_;
+  const uint64_t version_;
 };
 
 /**
  * Implementation of Loader that watches a symlink for swapping and loads a specified subdirectory
  * from disk. A single snapshot is shared among all threads and referenced by shared_ptr such that
  * a new runtime can be swapped in by the main thread while workers are still using the previous
- * version.
+ * version. The snapshots after the first one are loaded on a thread of their own, so that reading
+ * a large runtime tree does not stall the main thread, and swapped in on the main thread once
+ * they are loaded.
  */
 class LoaderImpl : public Loader {
 public:
@@ -125,6 +173,7 @@ public:
              const std::string& root_symlink_path, const std::string& subdir,
              const std::string& override_dir, Stats::Store& store, RandomGenerator& generator,
              Api::OsSysCallsPtr os_sys_calls);
+  ~LoaderImpl();
 
   // Runtime::Loader
   Snapshot& snapshot() override;
@@ -132,15 +181,27 @@ public:
 private:
   RuntimeStats generateStats(Stats::Store& store);
   void onSymlinkSwap();
+  void loadSnapshot();
+  void setSnapshot(std::shared_ptr<SnapshotImpl> snapshot);
 
+  Event::Dispatcher& dispatcher_;
   Filesystem::WatcherPtr watcher_;
   ThreadLocal::SlotPtr tls_;
   RandomGenerator& generator_;
   std::string root_path_;
   std::string override_path_;
   std::shared_ptr<SnapshotImpl> current_snapshot_;
+  uint64_t snapshot_version_{};
   RuntimeStats stats_;
   Api::OsSysCallsPtr os_sys_calls_;
+  // Only used by the thread that loads a snapshot, of which there is one at a time.
+  FileCache file_cache_;
+  Thread::ThreadPtr load_thread_;
+  bool loading_{};
+  bool reload_pending_{};
+  // Lets the completion of a load that is posted to the main thread find out whether the loader
+  // has been destroyed in the meantime.
+  std::shared_ptr<bool> alive_{std::make_shared<bool>(true)};
 };
 
 /**
@@ -157,6 +218,9 @@ private:
   struct NullSnapshotImpl : public Snapshot {
     NullSnapshotImpl(RandomGenerator& generator) : generator_(generator) {}
 
+    using Snapshot::featureEnabled;
+    using Snapshot::getInteger;
+
     // Runtime::Snapshot
     bool featureEnabled(const std::string&, uint64_t default_value, uint64_t random_value,
                         uint16_t num_buckets) const override {
@@ -189,6 +253,9 @@ private:
       return values_;
     }
 
+    // The null snapshot never changes.
+    uint64_t version() const override { return 0; }
+
     RandomGenerator& generator_;
     std::unordered_map<std::string, const Snapshot::Entry> values_;
   };
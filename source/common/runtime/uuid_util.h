@@ -2,6 +2,8 @@
 
 #include <string>
 
+#include "absl/strings/string_view.h"
+
 namespace Envoy {
 enum class UuidTraceStatus { NoTrace, Sampled, Client, Forced };
 
@@ -16,7 +18,7 @@ public:
    * @param out will contain the result of the operation.
    * @param mod modulo used in the operation.
    */
-  static bool uuidModBy(const std::string& uuid, uint16_t& out, uint16_t mod);
+  static bool uuidModBy(absl::string_view uuid, uint16_t& out, uint16_t mod);
 
   /**
    * Modify uuid in a way it can be detected if uuid is traceable or not.
@@ -29,7 +31,7 @@ public:
   /**
    * @return status of the uuid, to differentiate reason for tracing, etc.
    */
-  static UuidTraceStatus isTraceableUuid(const std::string& uuid);
+  static UuidTraceStatus isTraceableUuid(absl::string_view uuid);
 
 private:
   // Byte on this position has predefined value of 4 for UUID4.
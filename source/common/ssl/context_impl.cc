@@ -10,6 +10,7 @@
 
 #include "common/common/assert.h"
 #include "common/common/hex.h"
+#include "common/common/logger.h"
 
 #include "fmt/format.h"
 #include "openssl/hmac.h"
@@ -28,7 +29,7 @@ int ContextImpl::sslContextIndex() {
 }
 
 ContextImpl::ContextImpl(ContextManagerImpl& parent, Stats::Scope& scope,
-                         const ContextConfig& config)
+                         const ContextConfig& config, bool lazy_certificate_chain)
     : parent_(parent), ctx_(SSL_CTX_new(TLS_method())), scope_(scope), stats_(generateStats(scope)),
       min_protocol_version_(config.minProtocolVersion()),
       max_protocol_version_(config.maxProtocolVersion()), ecdh_curves_(config.ecdhCurves()) {
@@ -84,20 +85,10 @@ ContextImpl::ContextImpl(ContextManagerImpl& parent, Stats::Scope& scope,
     SSL_CTX_set_cert_verify_callback(ctx_.get(), ContextImpl::verifyCallback, this);
   }
 
-  if (!config.certChainFile().empty()) {
-    cert_chain_ = loadCert(config.certChainFile());
-    cert_chain_file_path_ = config.certChainFile();
-    int rc = SSL_CTX_use_certificate_chain_file(ctx_.get(), config.certChainFile().c_str());
-    if (0 == rc) {
-      throw EnvoyException(
-          fmt::format("Failed to load certificate chain file {}", config.certChainFile()));
-    }
-
-    rc = SSL_CTX_use_PrivateKey_file(ctx_.get(), config.privateKeyFile().c_str(), SSL_FILETYPE_PEM);
-    if (0 == rc) {
-      throw EnvoyException(
-          fmt::format("Failed to load private key file {}", config.privateKeyFile()));
-    }
+  cert_chain_file_path_ = config.certChainFile();
+  private_key_file_path_ = config.privateKeyFile();
+  if (!lazy_certificate_chain) {
+    loadCertificateChain();
   }
 
   // use the server's cipher list preferences
@@ -106,6 +97,24 @@ ContextImpl::ContextImpl(ContextManagerImpl& parent, Stats::Scope& scope,
   parsed_alpn_protocols_ = parseAlpnProtocols(config.alpnProtocols());
 }
 
+void ContextImpl::loadCertificateChain() {
+  if (cert_chain_file_path_.empty()) {
+    return;
+  }
+
+  cert_chain_ = loadCert(cert_chain_file_path_);
+  int rc = SSL_CTX_use_certificate_chain_file(ctx_.get(), cert_chain_file_path_.c_str());
+  if (0 == rc) {
+    throw EnvoyException(
+        fmt::format("Failed to load certificate chain file {}", cert_chain_file_path_));
+  }
+
+  rc = SSL_CTX_use_PrivateKey_file(ctx_.get(), private_key_file_path_.c_str(), SSL_FILETYPE_PEM);
+  if (0 == rc) {
+    throw EnvoyException(fmt::format("Failed to load private key file {}", private_key_file_path_));
+  }
+}
+
 int ServerContextImpl::alpnSelectCallback(const unsigned char** out, unsigned char* outlen,
                                           const unsigned char* in, unsigned int inlen) {
   // Currently this uses the standard selection algorithm in priority order.
@@ -152,7 +161,7 @@ std::vector<uint8_t> ContextImpl::parseAlpnProtocols(const std::string& alpn_pro
   return out;
 }
 
-bssl::UniquePtr<SSL> ContextImpl::newSsl() const {
+bssl::UniquePtr<SSL> ContextImpl::newSsl() {
   return bssl::UniquePtr<SSL>(SSL_new(ctx_.get()));
 }
 
@@ -347,9 +356,64 @@ ClientContextImpl::ClientContextImpl(ContextManagerImpl& parent, Stats::Scope& s
   }
 
   server_name_indication_ = config.serverNameIndication();
+
+  SSL_CTX_set_session_cache_mode(ctx_.get(), SSL_SESS_CACHE_CLIENT);
+  SSL_CTX_sess_set_new_cb(ctx_.get(), [](SSL* ssl, SSL_SESSION* session) -> int {
+    ContextImpl* context_impl =
+        static_cast<ContextImpl*>(SSL_CTX_get_ex_data(SSL_get_SSL_CTX(ssl), sslContextIndex()));
+    dynamic_cast<ClientContextImpl*>(context_impl)->cacheSession(ssl, session);
+    // The cache took the reference to the session.
+    return 1;
+  });
+}
+
+int ClientContextImpl::sslHostIndex() {
+  CONSTRUCT_ON_FIRST_USE(int, []() -> int {
+    int ssl_host_index = SSL_get_ex_new_index(
+        0, nullptr, nullptr, nullptr,
+        [](void*, void* ptr, CRYPTO_EX_DATA*, int, long, void*) -> void {
+          delete static_cast<std::string*>(ptr);
+        });
+    RELEASE_ASSERT(ssl_host_index >= 0);
+    return ssl_host_index;
+  }());
 }
 
-bssl::UniquePtr<SSL> ClientContextImpl::newSsl() const {
+void ClientContextImpl::resumeSession(SSL* ssl, const std::string& host) {
+  ASSERT(SSL_get_ex_data(ssl, sslHostIndex()) == nullptr);
+  int rc = SSL_set_ex_data(ssl, sslHostIndex(), new std::string(host));
+  RELEASE_ASSERT(rc == 1);
+
+  std::unique_lock<std::mutex> lock(sessions_lock_);
+  auto session = sessions_.find(host);
+  if (session != sessions_.end()) {
+    rc = SSL_set_session(ssl, session->second.get());
+    ASSERT(rc == 1);
+  }
+  UNREFERENCED_PARAMETER(rc);
+}
+
+void ClientContextImpl::cacheSession(SSL* ssl, SSL_SESSION* session) {
+  bssl::UniquePtr<SSL_SESSION> session_ptr(session);
+  const std::string* host = static_cast<const std::string*>(SSL_get_ex_data(ssl, sslHostIndex()));
+  if (host == nullptr) {
+    return;
+  }
+
+  std::unique_lock<std::mutex> lock(sessions_lock_);
+  auto cached = sessions_.find(*host);
+  if (cached != sessions_.end()) {
+    cached->second = std::move(session_ptr);
+    return;
+  }
+  if (sessions_.size() >= MAX_CACHED_SESSIONS) {
+    // Hosts come and go with their clusters, so an arbitrary one makes room for the new one.
+    sessions_.erase(sessions_.begin());
+  }
+  sessions_.emplace(*host, std::move(session_ptr));
+}
+
+bssl::UniquePtr<SSL> ClientContextImpl::newSsl() {
   bssl::UniquePtr<SSL> ssl_con(ContextImpl::newSsl());
 
   if (!server_name_indication_.empty()) {
@@ -365,9 +429,12 @@ ServerContextImpl::ServerContextImpl(ContextManagerImpl& parent, const std::stri
                                      const std::vector<std::string>& server_names,
                                      Stats::Scope& scope, const ServerContextConfig& config,
                                      bool skip_context_update, Runtime::Loader& runtime)
-    : ContextImpl(parent, scope, config), listener_name_(listener_name),
-      server_names_(server_names), skip_context_update_(skip_context_update), runtime_(runtime),
-      session_ticket_keys_(config.sessionTicketKeys()) {
+    : ContextImpl(parent, scope, config,
+                  parent.lazyCertificates() && !config.certChainFile().empty()),
+      listener_name_(listener_name), server_names_(server_names),
+      skip_context_update_(skip_context_update), runtime_(runtime),
+      session_ticket_keys_(config.sessionTicketKeys()),
+      certificate_chain_loaded_(!parent.lazyCertificates() || config.certChainFile().empty()) {
   SSL_CTX_set_select_certificate_cb(
       ctx_.get(), [](const SSL_CLIENT_HELLO* client_hello) -> ssl_select_cert_result_t {
         ContextImpl* context_impl = static_cast<ContextImpl*>(
@@ -414,6 +481,72 @@ ServerContextImpl::ServerContextImpl(ContextManagerImpl& parent, const std::stri
         });
   }
 
+  if (parent.privateKeyMethodProvider() != nullptr) {
+    // The method is part of the certificate configuration that connections copy from the context
+    // they switch to on SNI, so it is set on the context rather than on each connection.
+    private_key_method_provider_ = parent.privateKeyMethodProvider();
+    SSL_CTX_set_private_key_method(ctx_.get(),
+                                   private_key_method_provider_->getBoringSslPrivateKeyMethod());
+  }
+
+  if (parent.sessionCache() != nullptr) {
+    // Sessions are only resumed from the shared cache, so that a session created on one worker or
+    // by the parent of a hot restart can be resumed on any other.
+    SSL_CTX_set_session_cache_mode(ctx_.get(),
+                                   SSL_SESS_CACHE_SERVER | SSL_SESS_CACHE_NO_INTERNAL);
+    SSL_CTX_sess_set_new_cb(ctx_.get(), [](SSL* ssl, SSL_SESSION* session) -> int {
+      ContextImpl* context_impl =
+          static_cast<ContextImpl*>(SSL_CTX_get_ex_data(SSL_get_SSL_CTX(ssl), sslContextIndex()));
+      dynamic_cast<ServerContextImpl*>(context_impl)->sessionCacheInsert(session);
+      // The session is not kept, so BoringSSL keeps the reference it passed.
+      return 0;
+    });
+    SSL_CTX_sess_set_get_cb(
+        ctx_.get(), [](SSL* ssl, const uint8_t* id, int id_length, int* out_copy) -> SSL_SESSION* {
+          ContextImpl* context_impl = static_cast<ContextImpl*>(
+              SSL_CTX_get_ex_data(SSL_get_SSL_CTX(ssl), sslContextIndex()));
+          *out_copy = 0;
+          return dynamic_cast<ServerContextImpl*>(context_impl)
+              ->sessionCacheLookup(ssl, id, id_length);
+        });
+    SSL_CTX_sess_set_remove_cb(ctx_.get(), [](SSL_CTX* ctx, SSL_SESSION* session) -> void {
+      ContextImpl* context_impl =
+          static_cast<ContextImpl*>(SSL_CTX_get_ex_data(ctx, sslContextIndex()));
+      dynamic_cast<ServerContextImpl*>(context_impl)->sessionCacheRemove(session);
+    });
+  }
+
+  if (certificate_chain_loaded_) {
+    setSessionIdContext();
+  }
+}
+
+bssl::UniquePtr<SSL> ServerContextImpl::newSsl() {
+  loadCertificateChainOnce();
+  return ContextImpl::newSsl();
+}
+
+void ServerContextImpl::loadCertificateChainOnce() {
+  if (certificate_chain_loaded_) {
+    return;
+  }
+
+  std::unique_lock<std::mutex> lock(certificate_chain_lock_);
+  if (certificate_chain_loaded_) {
+    return;
+  }
+  try {
+    loadCertificateChain();
+    setSessionIdContext();
+  } catch (const EnvoyException& e) {
+    // The handshakes of the connections of the context fail without a certificate.
+    ENVOY_LOG_MISC(error, "failed to load certificate chain of listener '{}': {}", listener_name_,
+                   e.what());
+  }
+  certificate_chain_loaded_ = true;
+}
+
+void ServerContextImpl::setSessionIdContext() {
   uint8_t session_context_buf[EVP_MAX_MD_SIZE] = {};
   unsigned session_context_len = 0;
   EVP_MD_CTX md;
@@ -537,6 +670,7 @@ ServerContextImpl::processClientHello(const SSL_CLIENT_HELLO* client_hello) {
   // Update context if it changed.
   if (new_ctx != this) {
     ServerContextImpl* new_impl = dynamic_cast<ServerContextImpl*>(new_ctx);
+    new_impl->loadCertificateChainOnce();
     new_impl->updateConnectionContext(client_hello->ssl);
   }
 
@@ -566,6 +700,37 @@ void ServerContextImpl::updateConnectionContext(SSL* ssl) {
   UNREFERENCED_PARAMETER(rc);
 }
 
+void ServerContextImpl::sessionCacheInsert(SSL_SESSION* session) {
+  uint8_t* data;
+  size_t length;
+  if (!SSL_SESSION_to_bytes(session, &data, &length)) {
+    return;
+  }
+
+  unsigned id_length;
+  const uint8_t* id = SSL_SESSION_get_id(session, &id_length);
+  parent_.sessionCache()->insert(std::string(reinterpret_cast<const char*>(id), id_length),
+                                 std::string(reinterpret_cast<const char*>(data), length));
+  OPENSSL_free(data);
+}
+
+SSL_SESSION* ServerContextImpl::sessionCacheLookup(SSL* ssl, const uint8_t* id, int id_length) {
+  std::string session;
+  if (!parent_.sessionCache()->lookup(std::string(reinterpret_cast<const char*>(id), id_length),
+                                      session)) {
+    return nullptr;
+  }
+
+  return SSL_SESSION_from_bytes(reinterpret_cast<const uint8_t*>(session.data()), session.size(),
+                                SSL_get_SSL_CTX(ssl));
+}
+
+void ServerContextImpl::sessionCacheRemove(SSL_SESSION* session) {
+  unsigned id_length;
+  const uint8_t* id = SSL_SESSION_get_id(session, &id_length);
+  parent_.sessionCache()->remove(std::string(reinterpret_cast<const char*>(id), id_length));
+}
+
 int ServerContextImpl::sessionTicketProcess(SSL*, uint8_t* key_name, uint8_t* iv,
                                             EVP_CIPHER_CTX* ctx, HMAC_CTX* hmac_ctx, int encrypt) {
   const EVP_MD* hmac = EVP_sha256();
@@ -1,6 +1,9 @@
 #pragma once
 
+#include <atomic>
+#include <mutex>
 #include <string>
+#include <unordered_map>
 #include <vector>
 
 #include "envoy/runtime/runtime.h"
@@ -31,7 +34,17 @@ namespace Ssl {
   COUNTER(fail_verify_no_cert)                                                                     \
   COUNTER(fail_verify_error)                                                                       \
   COUNTER(fail_verify_san)                                                                         \
-  COUNTER(fail_verify_cert_hash)
+  COUNTER(fail_verify_cert_hash)                                                                   \
+  COUNTER(kernel_tls_tx)                                                                           \
+  COUNTER(kernel_tls_rx)                                                                           \
+  COUNTER(private_key_method_wait)                                                                 \
+  HISTOGRAM(handshake_full_time_ms)                                                                \
+  HISTOGRAM(handshake_full_cpu_us)                                                                 \
+  HISTOGRAM(handshake_full_bytes)                                                                  \
+  HISTOGRAM(handshake_resumed_time_ms)                                                             \
+  HISTOGRAM(handshake_resumed_cpu_us)                                                              \
+  HISTOGRAM(handshake_resumed_bytes)                                                               \
+  HISTOGRAM(private_key_method_wait_ms)
 // clang-format on
 
 /**
@@ -43,7 +56,7 @@ struct SslStats {
 
 class ContextImpl : public virtual Context {
 public:
-  virtual bssl::UniquePtr<SSL> newSsl() const;
+  virtual bssl::UniquePtr<SSL> newSsl();
 
   /**
    * Logs successful TLS handshake and updates stats.
@@ -70,13 +83,39 @@ public:
 
   SslStats& stats() { return stats_; }
 
+  /**
+   * @return PrivateKeyMethodProvider* the provider that the connections of the context must be
+   *         registered with before their handshake, or nullptr if the context uses its private
+   *         key itself.
+   */
+  PrivateKeyMethodProvider* privateKeyMethodProvider() const {
+    return private_key_method_provider_;
+  }
+
+  /**
+   * @return bool whether the connections of the context hand their record encryption to the
+   *         kernel once their handshake completed, if the kernel and the cipher support it.
+   */
+  virtual bool kernelTlsEnabled() const { return false; }
+
   // Ssl::Context
   size_t daysUntilFirstCertExpires() const override;
   std::string getCaCertInformation() const override;
   std::string getCertChainInformation() const override;
 
 protected:
-  ContextImpl(ContextManagerImpl& parent, Stats::Scope& scope, const ContextConfig& config);
+  /**
+   * @param lazy_certificate_chain supplies whether the certificate chain and private key are left
+   *        for loadCertificateChain() to load, rather than loaded by the constructor.
+   */
+  ContextImpl(ContextManagerImpl& parent, Stats::Scope& scope, const ContextConfig& config,
+              bool lazy_certificate_chain = false);
+
+  /**
+   * Load the certificate chain and private key of the configuration into the context, if any.
+   * @throw EnvoyException if they cannot be loaded.
+   */
+  void loadCertificateChain();
 
   /**
    * The global SSL-library index used for storing a pointer to the context
@@ -118,21 +157,48 @@ protected:
   bssl::UniquePtr<X509> cert_chain_;
   std::string ca_file_path_;
   std::string cert_chain_file_path_;
+  std::string private_key_file_path_;
   const uint16_t min_protocol_version_;
   const uint16_t max_protocol_version_;
   const std::string ecdh_curves_;
+  PrivateKeyMethodProvider* private_key_method_provider_{};
 };
 
+/**
+ * The client context caches the last session of each host, so that the next connection to the
+ * host resumes it instead of doing a full handshake. The server name is the same for all the
+ * connections of a context, so sessions are only keyed by the address of the host.
+ */
 class ClientContextImpl : public ContextImpl, public ClientContext {
 public:
   ClientContextImpl(ContextManagerImpl& parent, Stats::Scope& scope,
                     const ClientContextConfig& config);
   ~ClientContextImpl() { parent_.releaseClientContext(this); }
 
-  bssl::UniquePtr<SSL> newSsl() const override;
+  bssl::UniquePtr<SSL> newSsl() override;
+
+  /**
+   * Resume the cached session of a host, if any, and cache the sessions that the connection
+   * establishes for the host.
+   * @param ssl supplies the connection, which must not have started its handshake.
+   * @param host supplies the address of the host.
+   */
+  void resumeSession(SSL* ssl, const std::string& host);
+
+  // The number of hosts whose sessions are cached.
+  static const size_t MAX_CACHED_SESSIONS = 1024;
 
 private:
+  /**
+   * The global SSL-library index used for storing the host of a connection in the SSL instance.
+   */
+  static int sslHostIndex();
+
+  void cacheSession(SSL* ssl, SSL_SESSION* session);
+
   std::string server_name_indication_;
+  std::mutex sessions_lock_;
+  std::unordered_map<std::string, bssl::UniquePtr<SSL_SESSION>> sessions_;
 };
 
 class ServerContextImpl : public ContextImpl, public ServerContext {
@@ -143,14 +209,31 @@ public:
                     Runtime::Loader& runtime);
   ~ServerContextImpl() { parent_.releaseServerContext(this, listener_name_, server_names_); }
 
+  // Ssl::ContextImpl
+  bssl::UniquePtr<SSL> newSsl() override;
+  bool kernelTlsEnabled() const override {
+    return runtime_.snapshot().featureEnabled("ssl.kernel_tls", 0);
+  }
+
 private:
   ssl_select_cert_result_t processClientHello(const SSL_CLIENT_HELLO* client_hello);
   void updateConnectionContext(SSL* ssl);
 
+  /**
+   * Load the certificate chain of a context that was created with lazy certificates, before it
+   * creates its first connection or a connection switches to it. A chain that fails to load is
+   * logged, and fails the handshakes of the connections of the context.
+   */
+  void loadCertificateChainOnce();
+  void setSessionIdContext();
+
   int alpnSelectCallback(const unsigned char** out, unsigned char* outlen, const unsigned char* in,
                          unsigned int inlen);
   int sessionTicketProcess(SSL* ssl, uint8_t* key_name, uint8_t* iv, EVP_CIPHER_CTX* ctx,
                            HMAC_CTX* hmac_ctx, int encrypt);
+  void sessionCacheInsert(SSL_SESSION* session);
+  SSL_SESSION* sessionCacheLookup(SSL* ssl, const uint8_t* id, int id_length);
+  void sessionCacheRemove(SSL_SESSION* session);
 
   const std::string listener_name_;
   const std::vector<std::string> server_names_;
@@ -158,6 +241,8 @@ private:
   Runtime::Loader& runtime_;
   std::vector<uint8_t> parsed_alt_alpn_protocols_;
   const std::vector<ServerContextConfig::SessionTicketKey> session_ticket_keys_;
+  std::mutex certificate_chain_lock_;
+  std::atomic<bool> certificate_chain_loaded_;
 };
 
 } // namespace Ssl
@@ -27,28 +27,28 @@ void ContextManagerImpl::releaseServerContext(ServerContext* context,
   std::unique_lock<std::shared_timed_mutex> lock(contexts_lock_);
 
   // Remove mappings.
-  auto& listener_map_exact = map_exact_[listener_name];
-  if (server_names.empty()) {
-    const auto ctx = listener_map_exact.find(EMPTY_STRING);
-    if (ctx != listener_map_exact.end() && ctx->second == context) {
-      listener_map_exact.erase(ctx);
+  auto& index = server_names_[listener_name];
+  const auto remove = [context](std::unordered_map<std::string, ServerContext*>& map,
+                                const std::string& name) {
+    const auto ctx = map.find(name);
+    if (ctx != map.end() && ctx->second == context) {
+      map.erase(ctx);
     }
+  };
+  if (server_names.empty()) {
+    remove(index.exact_, EMPTY_STRING);
   } else {
-    auto& listener_map_wildcard = map_wildcard_[listener_name];
     for (const auto& name : server_names) {
       if (isWildcardServerName(name)) {
-        const auto ctx = listener_map_wildcard.find(name);
-        if (ctx != listener_map_wildcard.end() && ctx->second == context) {
-          listener_map_wildcard.erase(ctx);
-        }
+        remove(index.wildcard_, name.substr(1));
       } else {
-        const auto ctx = listener_map_exact.find(name);
-        if (ctx != listener_map_exact.end() && ctx->second == context) {
-          listener_map_exact.erase(ctx);
-        }
+        remove(index.exact_, name);
       }
     }
   }
+  if (index.exact_.empty() && index.wildcard_.empty()) {
+    server_names_.erase(listener_name);
+  }
 
   // context may not be found, in the case that a subclass of Context throws
   // in it's constructor. In that case the context did not get added, but
@@ -77,14 +77,15 @@ ServerContextPtr ContextManagerImpl::createSslServerContext(
   contexts_.emplace_back(context.get());
 
   // Save mappings.
+  auto& index = server_names_[listener_name];
   if (server_names.empty()) {
-    map_exact_[listener_name][EMPTY_STRING] = context.get();
+    index.exact_[EMPTY_STRING] = context.get();
   } else {
     for (const auto& name : server_names) {
       if (isWildcardServerName(name)) {
-        map_wildcard_[listener_name][name] = context.get();
+        index.wildcard_[name.substr(1)] = context.get();
       } else {
-        map_exact_[listener_name][name] = context.get();
+        index.exact_[name] = context.get();
       }
     }
   }
@@ -104,34 +105,30 @@ ServerContext* ContextManagerImpl::findSslServerContext(const std::string& liste
   std::shared_lock<std::shared_timed_mutex> lock(contexts_lock_);
 
   // TODO(PiotrSikora): refactor and combine code with RouteMatcher::findVirtualHost().
-  const auto listener_map_exact = map_exact_.find(listener_name);
-  if (listener_map_exact != map_exact_.end()) {
-    const auto ctx = listener_map_exact->second.find(server_name);
-    if (ctx != listener_map_exact->second.end()) {
-      return ctx->second;
-    }
+  const auto index = server_names_.find(listener_name);
+  if (index == server_names_.end()) {
+    return nullptr;
   }
 
-  // Try to construct and match wildcard domain.
-  const size_t pos = server_name.find('.');
-  if (pos > 0 && pos < server_name.size() - 1) {
-    const std::string wildcard = '*' + server_name.substr(pos);
-    const auto listener_map_wildcard = map_wildcard_.find(listener_name);
-    if (listener_map_wildcard != map_wildcard_.end()) {
-      const auto ctx = listener_map_wildcard->second.find(wildcard);
-      if (ctx != listener_map_wildcard->second.end()) {
-        return ctx->second;
-      }
-    }
+  const auto ctx = index->second.exact_.find(server_name);
+  if (ctx != index->second.exact_.end()) {
+    return ctx->second;
   }
 
-  if (listener_map_exact != map_exact_.end()) {
-    const auto ctx = listener_map_exact->second.find(EMPTY_STRING);
-    if (ctx != listener_map_exact->second.end()) {
+  // Try to match the wildcard domain, by the part of the name after its first label.
+  const size_t pos = server_name.find('.');
+  if (pos > 0 && pos < server_name.size() - 1 && !index->second.wildcard_.empty()) {
+    const auto ctx = index->second.wildcard_.find(server_name.substr(pos));
+    if (ctx != index->second.wildcard_.end()) {
       return ctx->second;
     }
   }
 
+  const auto default_ctx = index->second.exact_.find(EMPTY_STRING);
+  if (default_ctx != index->second.exact_.end()) {
+    return default_ctx->second;
+  }
+
   return nullptr;
 }
 
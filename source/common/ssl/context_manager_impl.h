@@ -7,6 +7,8 @@
 
 #include "envoy/runtime/runtime.h"
 #include "envoy/ssl/context_manager.h"
+#include "envoy/ssl/private_key_method.h"
+#include "envoy/ssl/session_cache.h"
 
 namespace Envoy {
 namespace Ssl {
@@ -20,9 +22,28 @@ namespace Ssl {
  */
 class ContextManagerImpl final : public ContextManager {
 public:
-  ContextManagerImpl(Runtime::Loader& runtime) : runtime_(runtime) {}
+  /**
+   * @param session_cache supplies the cache of the sessions of the server contexts, which must
+   *        outlive the manager. If it is nullptr, each server context caches its sessions itself.
+   * @param private_key_method_provider supplies the provider of the private key operations of the
+   *        server contexts, which must outlive the manager. If it is nullptr, the server contexts
+   *        use their private keys on the threads of their connections.
+   * @param lazy_certificates supplies whether the server contexts load their certificate chains
+   *        and private keys when their first connection is created or selects them by SNI, rather
+   *        than when they are created.
+   */
+  ContextManagerImpl(Runtime::Loader& runtime, SessionCache* session_cache = nullptr,
+                     PrivateKeyMethodProvider* private_key_method_provider = nullptr,
+                     bool lazy_certificates = false)
+      : runtime_(runtime), session_cache_(session_cache),
+        private_key_method_provider_(private_key_method_provider),
+        lazy_certificates_(lazy_certificates) {}
   ~ContextManagerImpl();
 
+  SessionCache* sessionCache() { return session_cache_; }
+  PrivateKeyMethodProvider* privateKeyMethodProvider() { return private_key_method_provider_; }
+  bool lazyCertificates() const { return lazy_certificates_; }
+
   /**
    * Allocated contexts are owned by the caller. However, we need to be able to iterate them for
    * admin purposes. When a caller frees a context it will tell us to release it also from the list
@@ -46,13 +67,25 @@ public:
   void iterateContexts(std::function<void(const Context&)> callback) override;
 
 private:
+  /**
+   * The server contexts of a listener by server name. Wildcard names are keyed by their suffix,
+   * i.e. ".example.com" for "*.example.com", so that matching a server name against them takes a
+   * single lookup of the part of the name after its first label.
+   */
+  struct ServerNameIndex {
+    std::unordered_map<std::string, ServerContext*> exact_;
+    std::unordered_map<std::string, ServerContext*> wildcard_;
+  };
+
   static bool isWildcardServerName(const std::string& name);
 
   Runtime::Loader& runtime_;
+  SessionCache* session_cache_;
+  PrivateKeyMethodProvider* private_key_method_provider_;
+  const bool lazy_certificates_;
   std::list<Context*> contexts_;
   mutable std::shared_timed_mutex contexts_lock_;
-  std::unordered_map<std::string, std::unordered_map<std::string, ServerContext*>> map_exact_;
-  std::unordered_map<std::string, std::unordered_map<std::string, ServerContext*>> map_wildcard_;
+  std::unordered_map<std::string, ServerNameIndex> server_names_;
 };
 
 } // namespace Ssl
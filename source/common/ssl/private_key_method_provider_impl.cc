@@ -0,0 +1,215 @@
+#include "common/ssl/private_key_method_provider_impl.h"
+
+#include <cstring>
+#include <memory>
+#include <mutex>
+
+#include "common/common/assert.h"
+#include "common/common/macros.h"
+
+#include "openssl/evp.h"
+#include "openssl/rsa.h"
+
+namespace Envoy {
+namespace Ssl {
+
+const SSL_PRIVATE_KEY_METHOD ThreadPoolPrivateKeyMethodProvider::method_ = {
+    .sign = ThreadPoolPrivateKeyMethodProvider::sign,
+    .decrypt = ThreadPoolPrivateKeyMethodProvider::decrypt,
+    .complete = ThreadPoolPrivateKeyMethodProvider::complete,
+};
+
+ThreadPoolPrivateKeyMethodProvider::ThreadPoolPrivateKeyMethodProvider(uint32_t num_threads) {
+  ASSERT(num_threads > 0);
+  for (uint32_t i = 0; i < num_threads; i++) {
+    threads_.emplace_back(new Thread::Thread([this]() -> void { threadRoutine(); }));
+  }
+}
+
+ThreadPoolPrivateKeyMethodProvider::~ThreadPoolPrivateKeyMethodProvider() {
+  {
+    std::unique_lock<std::mutex> lock(queue_lock_);
+    shutdown_ = true;
+  }
+  queue_cv_.notify_all();
+  for (Thread::ThreadPtr& thread : threads_) {
+    thread->join();
+  }
+}
+
+int ThreadPoolPrivateKeyMethodProvider::sslConnectionIndex() {
+  CONSTRUCT_ON_FIRST_USE(int, []() -> int {
+    int ssl_connection_index = SSL_get_ex_new_index(
+        0, nullptr, nullptr, nullptr,
+        [](void*, void* ptr, CRYPTO_EX_DATA*, int, long, void*) -> void {
+          delete static_cast<ConnectionState*>(ptr);
+        });
+    RELEASE_ASSERT(ssl_connection_index >= 0);
+    return ssl_connection_index;
+  }());
+}
+
+void ThreadPoolPrivateKeyMethodProvider::registerPrivateKeyMethod(
+    SSL* ssl, PrivateKeyConnectionCallbacks& callbacks, Event::Dispatcher& dispatcher) {
+  ASSERT(SSL_get_ex_data(ssl, sslConnectionIndex()) == nullptr);
+  int rc =
+      SSL_set_ex_data(ssl, sslConnectionIndex(), new ConnectionState(*this, callbacks, dispatcher));
+  RELEASE_ASSERT(rc == 1);
+  UNREFERENCED_PARAMETER(rc);
+}
+
+void ThreadPoolPrivateKeyMethodProvider::unregisterPrivateKeyMethod(SSL* ssl) {
+  ConnectionState* state =
+      static_cast<ConnectionState*>(SSL_get_ex_data(ssl, sslConnectionIndex()));
+  if (state == nullptr) {
+    return;
+  }
+
+  if (state->operation_) {
+    // The thread running the operation checks this before it posts the completion, so that the
+    // completion is neither posted nor delivered once the connection is gone.
+    std::unique_lock<std::mutex> lock(state->operation_->lock_);
+    state->operation_->cancelled_ = true;
+  }
+  SSL_set_ex_data(ssl, sslConnectionIndex(), nullptr);
+  delete state;
+}
+
+ssl_private_key_result_t ThreadPoolPrivateKeyMethodProvider::sign(SSL* ssl, uint8_t*, size_t*,
+                                                                  size_t,
+                                                                  uint16_t signature_algorithm,
+                                                                  const uint8_t* in,
+                                                                  size_t in_len) {
+  return start(ssl, true, signature_algorithm, in, in_len);
+}
+
+ssl_private_key_result_t ThreadPoolPrivateKeyMethodProvider::decrypt(SSL* ssl, uint8_t*, size_t*,
+                                                                     size_t, const uint8_t* in,
+                                                                     size_t in_len) {
+  return start(ssl, false, 0, in, in_len);
+}
+
+ssl_private_key_result_t ThreadPoolPrivateKeyMethodProvider::start(SSL* ssl, bool sign,
+                                                                   uint16_t signature_algorithm,
+                                                                   const uint8_t* in,
+                                                                   size_t in_len) {
+  ConnectionState* state =
+      static_cast<ConnectionState*>(SSL_get_ex_data(ssl, sslConnectionIndex()));
+  EVP_PKEY* key = SSL_get_privatekey(ssl);
+  if (state == nullptr || state->operation_ || key == nullptr) {
+    return ssl_private_key_failure;
+  }
+
+  OperationSharedPtr operation =
+      std::make_shared<Operation>(state->callbacks_, state->dispatcher_);
+  EVP_PKEY_up_ref(key);
+  operation->key_.reset(key);
+  operation->sign_ = sign;
+  operation->signature_algorithm_ = signature_algorithm;
+  operation->input_.assign(in, in + in_len);
+  state->operation_ = operation;
+
+  {
+    std::unique_lock<std::mutex> lock(state->parent_.queue_lock_);
+    state->parent_.queue_.push_back(operation);
+  }
+  state->parent_.queue_cv_.notify_one();
+  return ssl_private_key_retry;
+}
+
+ssl_private_key_result_t ThreadPoolPrivateKeyMethodProvider::complete(SSL* ssl, uint8_t* out,
+                                                                      size_t* out_len,
+                                                                      size_t max_out) {
+  ConnectionState* state =
+      static_cast<ConnectionState*>(SSL_get_ex_data(ssl, sslConnectionIndex()));
+  if (state == nullptr || !state->operation_) {
+    return ssl_private_key_failure;
+  }
+
+  {
+    std::unique_lock<std::mutex> lock(state->operation_->lock_);
+    if (!state->operation_->done_) {
+      return ssl_private_key_retry;
+    }
+  }
+
+  OperationSharedPtr operation = std::move(state->operation_);
+  if (!operation->success_ || operation->output_.size() > max_out) {
+    return ssl_private_key_failure;
+  }
+  memcpy(out, operation->output_.data(), operation->output_.size());
+  *out_len = operation->output_.size();
+  return ssl_private_key_success;
+}
+
+void ThreadPoolPrivateKeyMethodProvider::threadRoutine() {
+  while (true) {
+    OperationSharedPtr operation;
+    {
+      std::unique_lock<std::mutex> lock(queue_lock_);
+      queue_cv_.wait(lock, [this]() -> bool { return shutdown_ || !queue_.empty(); });
+      if (shutdown_) {
+        return;
+      }
+      operation = std::move(queue_.front());
+      queue_.pop_front();
+    }
+
+    operation->run();
+
+    std::unique_lock<std::mutex> lock(operation->lock_);
+    operation->done_ = true;
+    if (!operation->cancelled_) {
+      operation->dispatcher_.post([operation]() -> void {
+        {
+          std::unique_lock<std::mutex> lock(operation->lock_);
+          if (operation->cancelled_) {
+            return;
+          }
+        }
+        // The connection can only be unregistered on this thread, so it is still registered.
+        operation->callbacks_.onPrivateKeyMethodComplete();
+      });
+    }
+  }
+}
+
+void ThreadPoolPrivateKeyMethodProvider::Operation::run() {
+  if (!sign_) {
+    // BoringSSL does the padding of RSA key exchanges itself.
+    RSA* rsa = EVP_PKEY_get0_RSA(key_.get());
+    if (rsa == nullptr) {
+      return;
+    }
+    size_t length;
+    output_.resize(RSA_size(rsa));
+    success_ = RSA_decrypt(rsa, &length, output_.data(), output_.size(), input_.data(),
+                           input_.size(), RSA_NO_PADDING);
+    output_.resize(success_ ? length : 0);
+    return;
+  }
+
+  const EVP_MD* md = SSL_get_signature_algorithm_digest(signature_algorithm_);
+  bssl::ScopedEVP_MD_CTX ctx;
+  EVP_PKEY_CTX* pkey_ctx;
+  if (md == nullptr || !EVP_DigestSignInit(ctx.get(), &pkey_ctx, md, nullptr, key_.get())) {
+    return;
+  }
+  if (SSL_is_signature_algorithm_rsa_pss(signature_algorithm_) &&
+      (!EVP_PKEY_CTX_set_rsa_padding(pkey_ctx, RSA_PKCS1_PSS_PADDING) ||
+       !EVP_PKEY_CTX_set_rsa_pss_saltlen(pkey_ctx, -1))) {
+    return;
+  }
+
+  size_t length;
+  if (!EVP_DigestSignUpdate(ctx.get(), input_.data(), input_.size()) ||
+      !EVP_DigestSignFinal(ctx.get(), nullptr, &length)) {
+    return;
+  }
+  output_.resize(length);
+  success_ = EVP_DigestSignFinal(ctx.get(), output_.data(), &length);
+  output_.resize(success_ ? length : 0);
+}
+
+} // namespace Ssl
+} // namespace Envoy
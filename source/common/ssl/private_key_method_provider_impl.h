@@ -0,0 +1,107 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include "envoy/event/dispatcher.h"
+#include "envoy/ssl/private_key_method.h"
+
+#include "common/common/thread.h"
+
+#include "openssl/ssl.h"
+
+namespace Envoy {
+namespace Ssl {
+
+/**
+ * Private key method provider that signs and decrypts on a pool of threads of its own, so that
+ * the private key operations of the handshakes do not block the event loops of the workers.
+ */
+class ThreadPoolPrivateKeyMethodProvider : public PrivateKeyMethodProvider {
+public:
+  /**
+   * @param num_threads supplies the number of threads of the pool.
+   */
+  ThreadPoolPrivateKeyMethodProvider(uint32_t num_threads);
+  ~ThreadPoolPrivateKeyMethodProvider();
+
+  // Ssl::PrivateKeyMethodProvider
+  void registerPrivateKeyMethod(SSL* ssl, PrivateKeyConnectionCallbacks& callbacks,
+                                Event::Dispatcher& dispatcher) override;
+  void unregisterPrivateKeyMethod(SSL* ssl) override;
+  const SSL_PRIVATE_KEY_METHOD* getBoringSslPrivateKeyMethod() override { return &method_; }
+
+private:
+  /**
+   * A signature or decryption that a thread of the pool runs for a connection.
+   */
+  struct Operation {
+    Operation(PrivateKeyConnectionCallbacks& callbacks, Event::Dispatcher& dispatcher)
+        : callbacks_(callbacks), dispatcher_(dispatcher) {}
+
+    void run();
+
+    PrivateKeyConnectionCallbacks& callbacks_;
+    Event::Dispatcher& dispatcher_;
+    bssl::UniquePtr<EVP_PKEY> key_;
+    bool sign_{};
+    uint16_t signature_algorithm_{};
+    std::vector<uint8_t> input_;
+    // Written by the thread that runs the operation, before it is done.
+    std::vector<uint8_t> output_;
+    bool success_{};
+    std::mutex lock_;
+    // Guarded by lock_.
+    bool done_{};
+    bool cancelled_{};
+  };
+
+  typedef std::shared_ptr<Operation> OperationSharedPtr;
+
+  /**
+   * The state of a registered connection, kept in the SSL instance.
+   */
+  struct ConnectionState {
+    ConnectionState(ThreadPoolPrivateKeyMethodProvider& parent,
+                    PrivateKeyConnectionCallbacks& callbacks, Event::Dispatcher& dispatcher)
+        : parent_(parent), callbacks_(callbacks), dispatcher_(dispatcher) {}
+
+    ThreadPoolPrivateKeyMethodProvider& parent_;
+    PrivateKeyConnectionCallbacks& callbacks_;
+    Event::Dispatcher& dispatcher_;
+    OperationSharedPtr operation_;
+  };
+
+  /**
+   * The global SSL-library index used for storing the state of a connection in the SSL instance.
+   */
+  static int sslConnectionIndex();
+
+  static ssl_private_key_result_t sign(SSL* ssl, uint8_t* out, size_t* out_len, size_t max_out,
+                                       uint16_t signature_algorithm, const uint8_t* in,
+                                       size_t in_len);
+  static ssl_private_key_result_t decrypt(SSL* ssl, uint8_t* out, size_t* out_len, size_t max_out,
+                                          const uint8_t* in, size_t in_len);
+  static ssl_private_key_result_t complete(SSL* ssl, uint8_t* out, size_t* out_len,
+                                           size_t max_out);
+  static ssl_private_key_result_t start(SSL* ssl, bool sign, uint16_t signature_algorithm,
+                                        const uint8_t* in, size_t in_len);
+
+  void threadRoutine();
+
+  static const SSL_PRIVATE_KEY_METHOD method_;
+
+  std::mutex queue_lock_;
+  std::condition_variable queue_cv_;
+  // Guarded by queue_lock_.
+  std::list<OperationSharedPtr> queue_;
+  bool shutdown_{};
+  std::vector<Thread::ThreadPtr> threads_;
+};
+
+} // namespace Ssl
+} // namespace Envoy
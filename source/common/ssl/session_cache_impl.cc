@@ -0,0 +1,147 @@
+#include "common/ssl/session_cache_impl.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <mutex>
+#include <string>
+
+#include "common/common/assert.h"
+#include "common/common/hash.h"
+
+namespace Envoy {
+namespace Ssl {
+
+const uint32_t SessionCacheImpl::NUM_SHARDS;
+const uint32_t SessionCacheImpl::WAYS;
+const size_t SessionCacheImpl::MAX_ID_LENGTH;
+const size_t SessionCacheImpl::MAX_SESSION_LENGTH;
+
+SessionCacheImpl::SessionCacheImpl(SessionCacheMemory& memory, std::chrono::seconds timeout,
+                                   Stats::Scope& scope, MonotonicTimeSource& time_source)
+    : memory_(memory),
+      timeout_ms_(std::chrono::duration_cast<std::chrono::milliseconds>(timeout).count()),
+      stats_{ALL_SSL_SESSION_CACHE_STATS(POOL_COUNTER_PREFIX(scope, "ssl.session_cache."))},
+      time_source_(time_source) {
+  ASSERT(memory_.numShards() > 0);
+  ASSERT(memory_.slotsPerShard() > 0 && memory_.slotsPerShard() % WAYS == 0);
+}
+
+uint32_t SessionCacheImpl::slotsPerShard(uint64_t max_sessions) {
+  const uint64_t sets = (max_sessions + NUM_SHARDS * WAYS - 1) / (NUM_SHARDS * WAYS);
+  return std::max<uint64_t>(sets, 1) * WAYS;
+}
+
+void SessionCacheImpl::insert(const std::string& id, const std::string& session) {
+  if (id.empty() || id.size() > MAX_ID_LENGTH) {
+    return;
+  }
+  if (session.size() > MAX_SESSION_LENGTH) {
+    stats_.insert_too_large_.inc();
+    return;
+  }
+
+  uint32_t shard;
+  Slot* set = findSet(id, shard);
+  const uint64_t now = nowMs();
+  std::unique_lock<Thread::BasicLockable> lock(memory_.lock(shard));
+
+  // Replace the session with the same ID, or else use an unused or expired slot, or else evict
+  // the session that expires first.
+  Slot* target = nullptr;
+  for (uint32_t i = 0; i < WAYS; i++) {
+    Slot& slot = set[i];
+    if (matches(slot, id)) {
+      target = &slot;
+      break;
+    }
+    if (target == nullptr || slot.expiry_ms_ < target->expiry_ms_) {
+      target = &slot;
+    }
+  }
+  if (target->expiry_ms_ > now && !matches(*target, id)) {
+    stats_.evicted_.inc();
+  }
+
+  target->expiry_ms_ = now + timeout_ms_;
+  target->id_length_ = id.size();
+  memcpy(target->id_, id.data(), id.size());
+  target->session_length_ = session.size();
+  memcpy(target->session_, session.data(), session.size());
+  stats_.insert_.inc();
+}
+
+bool SessionCacheImpl::lookup(const std::string& id, std::string& session) {
+  if (id.size() > MAX_ID_LENGTH) {
+    stats_.miss_.inc();
+    return false;
+  }
+
+  uint32_t shard;
+  Slot* set = findSet(id, shard);
+  const uint64_t now = nowMs();
+  std::unique_lock<Thread::BasicLockable> lock(memory_.lock(shard));
+
+  for (uint32_t i = 0; i < WAYS; i++) {
+    Slot& slot = set[i];
+    if (!matches(slot, id)) {
+      continue;
+    }
+    if (slot.expiry_ms_ <= now || slot.session_length_ > MAX_SESSION_LENGTH) {
+      // The session expired, or the slot was left inconsistent by a process that died while it
+      // held the lock of a shared memory shard.
+      slot.expiry_ms_ = 0;
+      break;
+    }
+    session.assign(reinterpret_cast<const char*>(slot.session_), slot.session_length_);
+    stats_.hit_.inc();
+    return true;
+  }
+
+  stats_.miss_.inc();
+  return false;
+}
+
+void SessionCacheImpl::remove(const std::string& id) {
+  uint32_t shard;
+  Slot* set = findSet(id, shard);
+  std::unique_lock<Thread::BasicLockable> lock(memory_.lock(shard));
+
+  for (uint32_t i = 0; i < WAYS; i++) {
+    if (matches(set[i], id)) {
+      set[i].expiry_ms_ = 0;
+      return;
+    }
+  }
+}
+
+SessionCacheImpl::Slot* SessionCacheImpl::findSet(const std::string& id, uint32_t& shard) {
+  // The hash must be the same in every process sharing the memory, which xxHash is.
+  const uint64_t hash = HashUtil::xxHash64(id);
+  shard = hash % memory_.numShards();
+  const uint32_t set = (hash / memory_.numShards()) % (memory_.slotsPerShard() / WAYS);
+  return reinterpret_cast<Slot*>(memory_.shard(shard)) + set * WAYS;
+}
+
+bool SessionCacheImpl::matches(const Slot& slot, const std::string& id) {
+  return slot.expiry_ms_ != 0 && slot.id_length_ == id.size() &&
+         memcmp(slot.id_, id.data(), id.size()) == 0;
+}
+
+uint64_t SessionCacheImpl::nowMs() {
+  return std::chrono::duration_cast<std::chrono::milliseconds>(
+             time_source_.currentTime().time_since_epoch())
+      .count();
+}
+
+HeapSessionCacheMemory::HeapSessionCacheMemory(uint32_t num_shards, uint32_t slots_per_shard)
+    : slots_per_shard_(slots_per_shard) {
+  for (uint32_t i = 0; i < num_shards; i++) {
+    shards_.emplace_back(slots_per_shard * SessionCacheImpl::slotSize());
+    locks_.emplace_back(new Thread::MutexBasicLockable());
+  }
+}
+
+} // namespace Ssl
+} // namespace Envoy
@@ -0,0 +1,122 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "envoy/common/time.h"
+#include "envoy/ssl/session_cache.h"
+#include "envoy/stats/stats.h"
+#include "envoy/stats/stats_macros.h"
+
+#include "common/common/thread.h"
+
+namespace Envoy {
+namespace Ssl {
+
+// clang-format off
+#define ALL_SSL_SESSION_CACHE_STATS(COUNTER)                                                       \
+  COUNTER(insert)                                                                                  \
+  COUNTER(insert_too_large)                                                                        \
+  COUNTER(evicted)                                                                                 \
+  COUNTER(hit)                                                                                     \
+  COUNTER(miss)
+// clang-format on
+
+/**
+ * Wrapper struct for session cache stats. @see stats_macros.h
+ */
+struct SessionCacheStats {
+  ALL_SSL_SESSION_CACHE_STATS(GENERATE_COUNTER_STRUCT)
+};
+
+/**
+ * Session cache that stores each session in a fixed size slot of a SessionCacheMemory. The ID of
+ * a session selects a shard, and a set of WAYS slots within the shard, so that the cache needs
+ * neither a heap nor pointers and can live in the shared memory of a hot restart. A session
+ * replaces the session of its set that expires first if all of them are in use.
+ */
+class SessionCacheImpl : public SessionCache {
+public:
+  /**
+   * @param memory supplies the memory of the sessions, which must outlive the cache.
+   * @param timeout supplies how long sessions are kept for.
+   */
+  SessionCacheImpl(SessionCacheMemory& memory, std::chrono::seconds timeout, Stats::Scope& scope,
+                   MonotonicTimeSource& time_source);
+
+  // Ssl::SessionCache
+  void insert(const std::string& id, const std::string& session) override;
+  bool lookup(const std::string& id, std::string& session) override;
+  void remove(const std::string& id) override;
+
+  /**
+   * @return size_t the size in bytes of a slot, which the shards of the memory are a multiple of.
+   */
+  static size_t slotSize() { return sizeof(Slot); }
+
+  /**
+   * @return uint32_t the number of slots the shards of the memory of a cache of max_sessions
+   *         sessions have, which is a multiple of the number of slots of a set.
+   */
+  static uint32_t slotsPerShard(uint64_t max_sessions);
+
+  // The number of shards of the memory of the caches the server creates.
+  static const uint32_t NUM_SHARDS = 16;
+  // The number of slots of a set.
+  static const uint32_t WAYS = 8;
+  // The largest session ID, as with SSL_MAX_SSL_SESSION_ID_LENGTH.
+  static const size_t MAX_ID_LENGTH = 32;
+  // The largest serialized session that fits in a slot. Sessions with a long client certificate
+  // chain may not.
+  static const size_t MAX_SESSION_LENGTH = 2000;
+
+private:
+  struct Slot {
+    // When the session expires, in milliseconds since the epoch of the monotonic clock, which is
+    // the same for all the processes of a hot restart. The slot is unused if it is 0.
+    uint64_t expiry_ms_;
+    uint16_t id_length_;
+    uint16_t session_length_;
+    uint8_t id_[MAX_ID_LENGTH];
+    uint8_t session_[MAX_SESSION_LENGTH];
+  };
+
+  /**
+   * @return Slot* the first slot of the set of the session ID, whose shard is set in shard.
+   */
+  Slot* findSet(const std::string& id, uint32_t& shard);
+
+  static bool matches(const Slot& slot, const std::string& id);
+
+  uint64_t nowMs();
+
+  SessionCacheMemory& memory_;
+  const uint64_t timeout_ms_;
+  SessionCacheStats stats_;
+  MonotonicTimeSource& time_source_;
+};
+
+/**
+ * SessionCacheMemory on the heap, for servers that do not share memory with a hot restart.
+ */
+class HeapSessionCacheMemory : public SessionCacheMemory {
+public:
+  HeapSessionCacheMemory(uint32_t num_shards, uint32_t slots_per_shard);
+
+  // Ssl::SessionCacheMemory
+  uint32_t numShards() override { return shards_.size(); }
+  uint32_t slotsPerShard() override { return slots_per_shard_; }
+  uint8_t* shard(uint32_t index) override { return shards_[index].data(); }
+  Thread::BasicLockable& lock(uint32_t index) override { return *locks_[index]; }
+
+private:
+  const uint32_t slots_per_shard_;
+  std::vector<std::vector<uint8_t>> shards_;
+  std::vector<std::unique_ptr<Thread::MutexBasicLockable>> locks_;
+};
+
+} // namespace Ssl
+} // namespace Envoy
@@ -1,5 +1,16 @@
 #include "common/ssl/ssl_socket.h"
 
+#include <sys/socket.h>
+
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+
+#include <cerrno>
+#include <chrono>
+#include <cstring>
+#include <ctime>
+#include <vector>
+
 #include "common/common/assert.h"
 #include "common/common/empty_string.h"
 #include "common/common/hex.h"
@@ -8,11 +19,40 @@
 #include "openssl/err.h"
 #include "openssl/x509v3.h"
 
+#if defined(__linux__) && defined(__has_include)
+#if __has_include(<linux/tls.h>)
+#include <linux/tls.h>
+#define ENVOY_KERNEL_TLS
+#endif
+#endif
+
+#ifdef ENVOY_KERNEL_TLS
+// Older C libraries do not define the options of the kernel TLS upper layer protocol yet.
+#ifndef TCP_ULP
+#define TCP_ULP 31
+#endif
+#ifndef SOL_TLS
+#define SOL_TLS 282
+#endif
+#endif
+
 using Envoy::Network::PostIoAction;
 
 namespace Envoy {
 namespace Ssl {
 
+namespace {
+
+std::chrono::nanoseconds threadCpuTime() {
+  timespec ts;
+  if (clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts) != 0) {
+    return std::chrono::nanoseconds(0);
+  }
+  return std::chrono::seconds(ts.tv_sec) + std::chrono::nanoseconds(ts.tv_nsec);
+}
+
+} // namespace
+
 SslSocket::SslSocket(Context& ctx, InitialState state)
     : ctx_(dynamic_cast<Ssl::ContextImpl&>(ctx)), ssl_(ctx_.newSsl()) {
   SSL_set_mode(ssl_.get(), SSL_MODE_ACCEPT_MOVING_WRITE_BUFFER);
@@ -24,12 +64,28 @@ SslSocket::SslSocket(Context& ctx, InitialState state)
   }
 }
 
+SslSocket::~SslSocket() {
+  if (ctx_.privateKeyMethodProvider() != nullptr) {
+    ctx_.privateKeyMethodProvider()->unregisterPrivateKeyMethod(ssl_.get());
+  }
+}
+
 void SslSocket::setTransportSocketCallbacks(Network::TransportSocketCallbacks& callbacks) {
   ASSERT(!callbacks_);
   callbacks_ = &callbacks;
 
   BIO* bio = BIO_new_socket(callbacks_->fd(), 0);
   SSL_set_bio(ssl_.get(), bio, bio);
+
+  if (ctx_.privateKeyMethodProvider() != nullptr) {
+    ctx_.privateKeyMethodProvider()->registerPrivateKeyMethod(
+        ssl_.get(), *this, callbacks_->connection().dispatcher());
+  }
+
+  ClientContextImpl* client_ctx = dynamic_cast<ClientContextImpl*>(&ctx_);
+  if (client_ctx != nullptr) {
+    client_ctx->resumeSession(ssl_.get(), callbacks_->connection().remoteAddress()->asString());
+  }
 }
 
 Network::IoResult SslSocket::doRead(Buffer::Instance& read_buffer) {
@@ -40,6 +96,10 @@ Network::IoResult SslSocket::doRead(Buffer::Instance& read_buffer) {
     }
   }
 
+  if (kernel_tls_rx_) {
+    return kernel_tls_socket_->doRead(read_buffer);
+  }
+
   bool keep_reading = true;
   PostIoAction action = PostIoAction::KeepOpen;
   uint64_t bytes_read = 0;
@@ -88,11 +148,21 @@ Network::IoResult SslSocket::doRead(Buffer::Instance& read_buffer) {
 
 PostIoAction SslSocket::doHandshake() {
   ASSERT(!handshake_complete_);
+  if (!handshake_started_) {
+    handshake_started_ = true;
+    handshake_start_ = std::chrono::steady_clock::now();
+  }
+  const std::chrono::nanoseconds cpu_start = threadCpuTime();
   int rc = SSL_do_handshake(ssl_.get());
+  handshake_cpu_time_ += threadCpuTime() - cpu_start;
   if (rc == 1) {
     ENVOY_CONN_LOG(debug, "handshake complete", callbacks_->connection());
     handshake_complete_ = true;
     ctx_.logHandshake(ssl_.get());
+    recordHandshake();
+    if (ctx_.kernelTlsEnabled()) {
+      enableKernelTls();
+    }
     callbacks_->raiseEvent(Network::ConnectionEvent::Connected);
 
     // It's possible that we closed during the handshake callback.
@@ -106,6 +176,14 @@ PostIoAction SslSocket::doHandshake() {
     case SSL_ERROR_WANT_READ:
     case SSL_ERROR_WANT_WRITE:
       return PostIoAction::KeepOpen;
+    case SSL_ERROR_WANT_PRIVATE_KEY_OPERATION:
+      // The handshake resumes in onPrivateKeyMethodComplete().
+      if (!private_key_method_waiting_) {
+        private_key_method_waiting_ = true;
+        private_key_method_wait_start_ = std::chrono::steady_clock::now();
+        ctx_.stats().private_key_method_wait_.inc();
+      }
+      return PostIoAction::KeepOpen;
     default:
       drainErrorQueue();
       return PostIoAction::Close;
@@ -113,6 +191,122 @@ PostIoAction SslSocket::doHandshake() {
   }
 }
 
+void SslSocket::onPrivateKeyMethodComplete() {
+  ASSERT(!handshake_complete_);
+  if (private_key_method_waiting_) {
+    private_key_method_waiting_ = false;
+    ctx_.stats().private_key_method_wait_ms_.recordValue(
+        std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() -
+                                                              private_key_method_wait_start_)
+            .count());
+  }
+  if (doHandshake() == PostIoAction::Close) {
+    callbacks_->connection().close(Network::ConnectionCloseType::NoFlush);
+  }
+}
+
+#ifdef ENVOY_KERNEL_TLS
+namespace {
+
+tls12_crypto_info_aes_gcm_128 kernelTlsCryptoInfo(const uint8_t* key, const uint8_t* salt,
+                                                  uint64_t sequence) {
+  tls12_crypto_info_aes_gcm_128 info;
+  memset(&info, 0, sizeof(info));
+  info.info.version = TLS_1_2_VERSION;
+  info.info.cipher_type = TLS_CIPHER_AES_GCM_128;
+  memcpy(info.key, key, TLS_CIPHER_AES_GCM_128_KEY_SIZE);
+  memcpy(info.salt, salt, TLS_CIPHER_AES_GCM_128_SALT_SIZE);
+  // The explicit nonce of the next record is its big endian sequence number, as with BoringSSL.
+  for (size_t i = 0; i < TLS_CIPHER_AES_GCM_128_REC_SEQ_SIZE; i++) {
+    info.rec_seq[i] = info.iv[i] = sequence >> (8 * (TLS_CIPHER_AES_GCM_128_REC_SEQ_SIZE - 1 - i));
+  }
+  return info;
+}
+
+} // namespace
+#endif
+
+void SslSocket::enableKernelTls() {
+#ifdef ENVOY_KERNEL_TLS
+  // The kernel only takes over TLS 1.2 records encrypted with AES-128-GCM, and only at a record
+  // boundary, so nothing can be left buffered by BoringSSL.
+  const SSL_CIPHER* cipher = SSL_get_current_cipher(ssl_.get());
+  if (SSL_version(ssl_.get()) != TLS1_2_VERSION || cipher == nullptr ||
+      !SSL_CIPHER_is_AES128GCM(cipher) || SSL_pending(ssl_.get()) != 0) {
+    return;
+  }
+
+  // With an AEAD cipher, the key block holds the client and server keys followed by the client
+  // and server implicit nonces, and no MAC keys.
+  const size_t key_length = TLS_CIPHER_AES_GCM_128_KEY_SIZE;
+  const size_t salt_length = TLS_CIPHER_AES_GCM_128_SALT_SIZE;
+  std::vector<uint8_t> key_block(SSL_get_key_block_len(ssl_.get()));
+  if (key_block.size() != 2 * (key_length + salt_length) ||
+      !SSL_generate_key_block(ssl_.get(), key_block.data(), key_block.size())) {
+    drainErrorQueue();
+    return;
+  }
+  const bool server = SSL_is_server(ssl_.get());
+  const uint8_t* client_key = key_block.data();
+  const uint8_t* server_key = client_key + key_length;
+  const uint8_t* client_salt = server_key + key_length;
+  const uint8_t* server_salt = client_salt + salt_length;
+
+  // Without keys, the upper layer protocol passes the records through unchanged, so the
+  // connection keeps working in user space if the kernel rejects them.
+  const int fd = callbacks_->fd();
+  if (setsockopt(fd, SOL_TCP, TCP_ULP, "tls", sizeof("tls")) != 0) {
+    ENVOY_CONN_LOG(debug, "kernel TLS unavailable: errno={}", callbacks_->connection(), errno);
+    return;
+  }
+  tls12_crypto_info_aes_gcm_128 tx =
+      kernelTlsCryptoInfo(server ? server_key : client_key, server ? server_salt : client_salt,
+                          SSL_get_write_sequence(ssl_.get()));
+  if (setsockopt(fd, SOL_TLS, TLS_TX, &tx, sizeof(tx)) != 0) {
+    ENVOY_CONN_LOG(debug, "kernel TLS TX unavailable: errno={}", callbacks_->connection(), errno);
+    return;
+  }
+  kernel_tls_tx_ = true;
+  ctx_.stats().kernel_tls_tx_.inc();
+
+  // Receive offload needs a newer kernel than transmit offload, so BoringSSL keeps decrypting
+  // the records if it is not available.
+  tls12_crypto_info_aes_gcm_128 rx =
+      kernelTlsCryptoInfo(server ? client_key : server_key, server ? client_salt : server_salt,
+                          SSL_get_read_sequence(ssl_.get()));
+  if (setsockopt(fd, SOL_TLS, TLS_RX, &rx, sizeof(rx)) == 0) {
+    kernel_tls_rx_ = true;
+    ctx_.stats().kernel_tls_rx_.inc();
+  }
+  ENVOY_CONN_LOG(debug, "kernel TLS enabled: rx={}", callbacks_->connection(), kernel_tls_rx_);
+
+  kernel_tls_socket_.reset(new Network::RawBufferSocket());
+  kernel_tls_socket_->setTransportSocketCallbacks(*callbacks_);
+#endif
+}
+
+void SslSocket::recordHandshake() {
+  const uint64_t time_ms = std::chrono::duration_cast<std::chrono::milliseconds>(
+                               std::chrono::steady_clock::now() - handshake_start_)
+                               .count();
+  const uint64_t cpu_us =
+      std::chrono::duration_cast<std::chrono::microseconds>(handshake_cpu_time_).count();
+  // The socket BIO is both the read and the write BIO, and only carried the handshake so far.
+  BIO* bio = SSL_get_rbio(ssl_.get());
+  const uint64_t bytes = BIO_number_read(bio) + BIO_number_written(bio);
+
+  SslStats& stats = ctx_.stats();
+  if (SSL_session_reused(ssl_.get())) {
+    stats.handshake_resumed_time_ms_.recordValue(time_ms);
+    stats.handshake_resumed_cpu_us_.recordValue(cpu_us);
+    stats.handshake_resumed_bytes_.recordValue(bytes);
+  } else {
+    stats.handshake_full_time_ms_.recordValue(time_ms);
+    stats.handshake_full_cpu_us_.recordValue(cpu_us);
+    stats.handshake_full_bytes_.recordValue(bytes);
+  }
+}
+
 void SslSocket::drainErrorQueue() {
   bool saw_error = false;
   bool saw_counted_error = false;
@@ -145,18 +339,20 @@ Network::IoResult SslSocket::doWrite(Buffer::Instance& write_buffer) {
     }
   }
 
+  if (kernel_tls_tx_) {
+    return kernel_tls_socket_->doWrite(write_buffer);
+  }
+
   uint64_t original_buffer_length = write_buffer.length();
   uint64_t total_bytes_written = 0;
   bool keep_writing = true;
   while ((original_buffer_length != total_bytes_written) && keep_writing) {
     // Protect against stack overflow if the buffer has a very large buffer chain.
-    // TODO(mattklein123): See the comment on getRawSlices() for why we have to also check
-    // original_buffer_length != total_bytes_written during loop iteration.
     // TODO(mattklein123): As it relates to our fairness efforts, we might want to limit the number
     // of iterations of this loop, either by pure iterations, bytes written, etc.
     const uint64_t MAX_SLICES = 32;
     Buffer::RawSlice slices[MAX_SLICES];
-    uint64_t num_slices = write_buffer.getRawSlices(slices, MAX_SLICES);
+    const uint64_t num_slices = std::min(write_buffer.getRawSlices(slices, MAX_SLICES), MAX_SLICES);
 
     uint64_t inner_bytes_written = 0;
     for (uint64_t i = 0; (i < num_slices) && (original_buffer_length != total_bytes_written); i++) {
@@ -264,7 +460,9 @@ std::string SslSocket::getUriSanFromCertificate(X509* cert) {
 }
 
 void SslSocket::closeSocket(Network::ConnectionEvent) {
-  if (handshake_complete_ &&
+  // The state of the records written by the kernel is not known by BoringSSL anymore, so a
+  // close_notify alert cannot be sent.
+  if (handshake_complete_ && !kernel_tls_tx_ &&
       callbacks_->connection().state() != Network::Connection::State::Closed) {
     // Attempt to send a shutdown before closing the socket. It's possible this won't go out if
     // there is no room on the socket. We can extend the state machine to handle this at some point
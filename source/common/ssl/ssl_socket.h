@@ -1,11 +1,16 @@
 #pragma once
 
+#include <chrono>
 #include <cstdint>
+#include <memory>
 #include <string>
 
+#include "envoy/common/time.h"
 #include "envoy/network/transport_socket.h"
+#include "envoy/ssl/private_key_method.h"
 
 #include "common/common/logger.h"
+#include "common/network/raw_buffer_socket.h"
 #include "common/ssl/context_impl.h"
 
 #include "openssl/ssl.h"
@@ -17,9 +22,11 @@ enum class InitialState { Client, Server };
 
 class SslSocket : public Network::TransportSocket,
                   public Connection,
+                  public PrivateKeyConnectionCallbacks,
                   protected Logger::Loggable<Logger::Id::connection> {
 public:
   SslSocket(Context& ctx, InitialState state);
+  ~SslSocket();
 
   // Ssl::Connection
   bool peerCertificatePresented() const override;
@@ -40,11 +47,16 @@ public:
   Ssl::Connection* ssl() override { return this; }
   const Ssl::Connection* ssl() const override { return this; }
 
+  // Ssl::PrivateKeyConnectionCallbacks
+  void onPrivateKeyMethodComplete() override;
+
   SSL* rawSslForTest() { return ssl_.get(); }
 
 private:
   Network::PostIoAction doHandshake();
   void drainErrorQueue();
+  void enableKernelTls();
+  void recordHandshake();
   std::string getUriSanFromCertificate(X509* cert);
   std::string getSubjectFromCertificate(X509* cert) const;
 
@@ -52,6 +64,18 @@ private:
   ContextImpl& ctx_;
   bssl::UniquePtr<SSL> ssl_;
   bool handshake_complete_{};
+  // The cost of the handshake, which is recorded once it completes. The CPU time only covers the
+  // handshake steps run by the connection's thread, not private key operations run elsewhere.
+  bool handshake_started_{};
+  MonotonicTime handshake_start_;
+  std::chrono::nanoseconds handshake_cpu_time_{};
+  bool private_key_method_waiting_{};
+  MonotonicTime private_key_method_wait_start_;
+  // Once the kernel encrypts the records written to the socket, or decrypts those read from it,
+  // the plaintext is moved as with a raw socket.
+  std::unique_ptr<Network::RawBufferSocket> kernel_tls_socket_;
+  bool kernel_tls_tx_{};
+  bool kernel_tls_rx_{};
 };
 
 class ClientSslSocketFactory : public Network::TransportSocketFactory {
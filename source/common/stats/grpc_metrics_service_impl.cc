@@ -0,0 +1,106 @@
+#include "common/stats/grpc_metrics_service_impl.h"
+
+#include <chrono>
+#include <cstdint>
+#include <string>
+
+#include "common/common/assert.h"
+
+namespace Envoy {
+namespace Stats {
+namespace Metrics {
+
+MetricsServiceSink::MetricsServiceSink(const LocalInfo::LocalInfo& local_info,
+                                       MetricsServiceClientPtr&& client,
+                                       SystemTimeSource& time_source)
+    : local_info_(local_info), client_(std::move(client)), time_source_(time_source) {}
+
+void MetricsServiceSink::beginFlush() {
+  message_.Clear();
+  if (stream_ == nullptr) {
+    // The message will start a new stream, which has none of the strings of the previous one.
+    strings_.clear();
+  }
+  message_.set_timestamp_ms(std::chrono::duration_cast<std::chrono::milliseconds>(
+                                time_source_.currentTime().time_since_epoch())
+                                .count());
+}
+
+void MetricsServiceSink::flushCounter(const Counter& counter, uint64_t delta) {
+  addMetric(counter, envoy::metrics::Metric::COUNTER).set_value(delta);
+}
+
+void MetricsServiceSink::flushGauge(const Gauge& gauge, uint64_t value) {
+  addMetric(gauge, envoy::metrics::Metric::GAUGE).set_value(value);
+}
+
+void MetricsServiceSink::flushHistogram(const ParentHistogram& histogram) {
+  const HistogramStatistics& statistics = histogram.intervalStatistics();
+  if (statistics.sampleCount() == 0) {
+    return;
+  }
+
+  if (message_.quantiles().empty()) {
+    for (double quantile : statistics.supportedQuantiles()) {
+      message_.add_quantiles(quantile);
+    }
+  }
+  ASSERT(static_cast<size_t>(message_.quantiles_size()) ==
+         statistics.supportedQuantiles().size());
+
+  envoy::metrics::Metric& metric = addMetric(histogram, envoy::metrics::Metric::SUMMARY);
+  metric.set_sample_count(statistics.sampleCount());
+  metric.set_sample_sum(statistics.sampleSum());
+  for (double value : statistics.computedQuantiles()) {
+    metric.add_quantile_values(value);
+  }
+}
+
+void MetricsServiceSink::endFlush() {
+  if (stream_ == nullptr) {
+    stream_ = client_->start(*Protobuf::DescriptorPool::generated_pool()->FindMethodByName(
+                                 "envoy.metrics.MetricsService.StreamMetrics"),
+                             *this);
+    auto* identifier = message_.mutable_identifier();
+    identifier->set_node_id(local_info_.nodeName());
+    identifier->set_cluster(local_info_.clusterName());
+  }
+
+  // If the stream could not be started, the metrics of this flush are dropped and the next flush
+  // tries again.
+  if (stream_ != nullptr) {
+    stream_->sendMessage(message_, false);
+  }
+}
+
+void MetricsServiceSink::onRemoteClose(Grpc::Status::GrpcStatus, const std::string&) {
+  stream_ = nullptr;
+}
+
+uint32_t MetricsServiceSink::intern(const std::string& value) {
+  auto it = strings_.find(value);
+  if (it != strings_.end()) {
+    return it->second;
+  }
+  const uint32_t index = strings_.size();
+  strings_.emplace(value, index);
+  message_.add_strings(value);
+  return index;
+}
+
+envoy::metrics::Metric& MetricsServiceSink::addMetric(const Metric& metric,
+                                                      envoy::metrics::Metric::Type type) {
+  envoy::metrics::Metric& proto_metric = *message_.add_metrics();
+  proto_metric.set_type(type);
+  proto_metric.set_name(intern(metric.tagExtractedName()));
+  for (const Tag& tag : metric.tags()) {
+    envoy::metrics::Tag& proto_tag = *proto_metric.add_tags();
+    proto_tag.set_name(intern(tag.name_));
+    proto_tag.set_value(intern(tag.value_));
+  }
+  return proto_metric;
+}
+
+} // namespace Metrics
+} // namespace Stats
+} // namespace Envoy
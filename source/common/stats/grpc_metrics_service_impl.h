@@ -0,0 +1,70 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <unordered_map>
+
+#include "envoy/common/time.h"
+#include "envoy/grpc/async_client.h"
+#include "envoy/local_info/local_info.h"
+#include "envoy/stats/stats.h"
+
+#include "source/common/stats/metrics_service.pb.h"
+
+namespace Envoy {
+namespace Stats {
+namespace Metrics {
+
+typedef std::unique_ptr<
+    Grpc::AsyncClient<envoy::metrics::StreamMetricsMessage, envoy::metrics::StreamMetricsResponse>>
+    MetricsServiceClientPtr;
+
+/**
+ * Stats sink that streams the metrics of every flush to a metrics service over gRPC. Each flush
+ * is sent as a single message, with metric names split from their tags. Names and tag values are
+ * sent once per stream and referred to by index afterwards, so that a flush mostly costs the
+ * values of the metrics. Flushes happen on the main thread, which owns the stream.
+ */
+class MetricsServiceSink
+    : public Sink,
+      public Grpc::AsyncStreamCallbacks<envoy::metrics::StreamMetricsResponse> {
+public:
+  MetricsServiceSink(const LocalInfo::LocalInfo& local_info, MetricsServiceClientPtr&& client,
+                     SystemTimeSource& time_source);
+
+  // Stats::Sink
+  void beginFlush() override;
+  void flushCounter(const Counter& counter, uint64_t delta) override;
+  void flushGauge(const Gauge& gauge, uint64_t value) override;
+  void flushHistogram(const ParentHistogram& histogram) override;
+  void endFlush() override;
+  void onHistogramComplete(const Histogram&, uint64_t) override {}
+
+  // Grpc::AsyncStreamCallbacks
+  void onCreateInitialMetadata(Http::HeaderMap&) override {}
+  void onReceiveInitialMetadata(Http::HeaderMapPtr&&) override {}
+  void onReceiveMessage(std::unique_ptr<envoy::metrics::StreamMetricsResponse>&&) override {}
+  void onReceiveTrailingMetadata(Http::HeaderMapPtr&&) override {}
+  void onRemoteClose(Grpc::Status::GrpcStatus status, const std::string& message) override;
+
+private:
+  /**
+   * @return uint32_t the index of a string in the stream, adding it to the message being built if
+   *         it was not sent yet.
+   */
+  uint32_t intern(const std::string& value);
+  envoy::metrics::Metric& addMetric(const Metric& metric, envoy::metrics::Metric::Type type);
+
+  const LocalInfo::LocalInfo& local_info_;
+  MetricsServiceClientPtr client_;
+  SystemTimeSource& time_source_;
+  Grpc::AsyncStream<envoy::metrics::StreamMetricsMessage>* stream_{};
+  // The strings sent on the current stream, by index. Cleared when a new stream is started.
+  std::unordered_map<std::string, uint32_t> strings_;
+  envoy::metrics::StreamMetricsMessage message_;
+};
+
+} // namespace Metrics
+} // namespace Stats
+} // namespace Envoy
@@ -0,0 +1,164 @@
+#include "common/stats/histogram_impl.h"
+
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <string>
+#include <vector>
+
+#include "common/common/assert.h"
+#include "common/common/utility.h"
+
+#include "fmt/format.h"
+
+namespace Envoy {
+namespace Stats {
+
+const uint32_t HistogramBuckets::SubBucketsLog2;
+const uint32_t HistogramBuckets::SubBuckets;
+const uint32_t HistogramBuckets::NumBuckets;
+
+uint32_t HistogramBuckets::index(uint64_t value) {
+  if (value < SubBuckets) {
+    return value;
+  }
+  const uint32_t exponent = 63 - __builtin_clzll(value);
+  const uint32_t shift = exponent - SubBucketsLog2;
+  return (shift + 1) * SubBuckets + ((value >> shift) & (SubBuckets - 1));
+}
+
+uint64_t HistogramBuckets::lowerBound(uint32_t index) {
+  ASSERT(index < NumBuckets);
+  if (index < SubBuckets) {
+    return index;
+  }
+  const uint32_t shift = index / SubBuckets - 1;
+  return static_cast<uint64_t>(SubBuckets + index % SubBuckets) << shift;
+}
+
+uint64_t HistogramBuckets::width(uint32_t index) {
+  ASSERT(index < NumBuckets);
+  if (index < SubBuckets) {
+    return 1;
+  }
+  return 1ULL << (index / SubBuckets - 1);
+}
+
+void HistogramBuckets::drainInto(std::vector<uint64_t>& counts, uint64_t& sum) {
+  ASSERT(counts.size() == NumBuckets);
+  if (!recorded_.exchange(false, std::memory_order_acquire)) {
+    return;
+  }
+  // Values recorded while draining are either drained now or on the next drain, as record() sets
+  // recorded_ after counting the value.
+  for (uint32_t i = 0; i < NumBuckets; i++) {
+    if (counts_[i].load(std::memory_order_relaxed) != 0) {
+      counts[i] += counts_[i].exchange(0, std::memory_order_relaxed);
+    }
+  }
+  sum += sum_.exchange(0, std::memory_order_relaxed);
+}
+
+HistogramStatisticsImpl::HistogramStatisticsImpl()
+    : computed_quantiles_(supportedQuantiles().size(), std::nan("")) {}
+
+const std::vector<double>& HistogramStatisticsImpl::supportedQuantiles() const {
+  static const std::vector<double> supported_quantiles = {0,    0.25, 0.5,   0.75, 0.9,
+                                                          0.95, 0.99, 0.999, 1};
+  return supported_quantiles;
+}
+
+void HistogramStatisticsImpl::refresh(const std::vector<uint64_t>& counts, uint64_t sum) {
+  ASSERT(counts.size() == HistogramBuckets::NumBuckets);
+  sample_count_ = 0;
+  for (uint64_t count : counts) {
+    sample_count_ += count;
+  }
+  sample_sum_ = sum;
+
+  const std::vector<double>& quantiles = supportedQuantiles();
+  if (sample_count_ == 0) {
+    computed_quantiles_.assign(quantiles.size(), std::nan(""));
+    return;
+  }
+
+  // The quantiles are ascending, so a single pass over the buckets finds all of them. A quantile
+  // is interpolated between the lowest and highest values of the bucket with its rank.
+  uint32_t bucket = 0;
+  uint64_t below = 0;
+  for (size_t i = 0; i < quantiles.size(); i++) {
+    const double rank = quantiles[i] * sample_count_;
+    while (counts[bucket] == 0 || below + counts[bucket] < rank) {
+      below += counts[bucket];
+      bucket++;
+    }
+    const double fraction = std::min(1.0, (rank - below) / counts[bucket]);
+    computed_quantiles_[i] = HistogramBuckets::lowerBound(bucket) +
+                             fraction * (HistogramBuckets::width(bucket) - 1);
+  }
+}
+
+const std::string& ThreadLocalHistogramImpl::name() const { return parent_.name(); }
+
+const std::vector<Tag>& ThreadLocalHistogramImpl::tags() const { return parent_.tags(); }
+
+const std::string& ThreadLocalHistogramImpl::tagExtractedName() const {
+  return parent_.tagExtractedName();
+}
+
+void ThreadLocalHistogramImpl::recordValue(uint64_t value) {
+  buckets_.record(value);
+  parent_.parent_.deliverHistogramToSinks(*this, value);
+}
+
+ParentHistogramImpl::ParentHistogramImpl(const std::string& name, Store& parent,
+                                         std::string&& tag_extracted_name,
+                                         std::vector<Tag>&& tags)
+    : MetricImpl(name, std::move(tag_extracted_name), std::move(tags)), parent_(parent),
+      cumulative_counts_(HistogramBuckets::NumBuckets) {}
+
+ThreadLocalHistogramSharedPtr ParentHistogramImpl::createThreadLocal() {
+  ThreadLocalHistogramSharedPtr histogram = std::make_shared<ThreadLocalHistogramImpl>(*this);
+  std::unique_lock<std::mutex> lock(lock_);
+  thread_local_histograms_.push_back(histogram);
+  return histogram;
+}
+
+void ParentHistogramImpl::recordValue(uint64_t value) {
+  buckets_.record(value);
+  parent_.deliverHistogramToSinks(*this, value);
+}
+
+void ParentHistogramImpl::merge() {
+  std::vector<uint64_t> interval_counts(HistogramBuckets::NumBuckets);
+  uint64_t interval_sum = 0;
+  buckets_.drainInto(interval_counts, interval_sum);
+  {
+    std::unique_lock<std::mutex> lock(lock_);
+    for (const ThreadLocalHistogramSharedPtr& histogram : thread_local_histograms_) {
+      histogram->buckets_.drainInto(interval_counts, interval_sum);
+    }
+  }
+
+  for (uint32_t i = 0; i < HistogramBuckets::NumBuckets; i++) {
+    cumulative_counts_[i] += interval_counts[i];
+  }
+  cumulative_sum_ += interval_sum;
+  interval_statistics_.refresh(interval_counts, interval_sum);
+  cumulative_statistics_.refresh(cumulative_counts_, cumulative_sum_);
+}
+
+std::string ParentHistogramImpl::summary() const {
+  const std::vector<double>& quantiles = interval_statistics_.supportedQuantiles();
+  std::vector<std::string> summary;
+  summary.reserve(quantiles.size());
+  for (size_t i = 0; i < quantiles.size(); i++) {
+    summary.push_back(fmt::format("P{}({},{})", 100 * quantiles[i],
+                                  interval_statistics_.computedQuantiles()[i],
+                                  cumulative_statistics_.computedQuantiles()[i]));
+  }
+  return StringUtil::join(summary, " ");
+}
+
+} // namespace Stats
+} // namespace Envoy
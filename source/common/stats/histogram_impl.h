@@ -0,0 +1,162 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "envoy/stats/stats.h"
+
+#include "common/stats/stats_impl.h"
+
+namespace Envoy {
+namespace Stats {
+
+/**
+ * Counts of recorded values in log-linear buckets: each power of two is split into 8 buckets of
+ * equal width, so the buckets of values of 8 and above are 1/8 of their lower bound wide, and
+ * values below 8 have a bucket each. Recording is lock free, so the values recorded by one thread
+ * can be drained by another.
+ */
+class HistogramBuckets {
+public:
+  static const uint32_t SubBucketsLog2 = 3;
+  static const uint32_t SubBuckets = 1 << SubBucketsLog2;
+  // Values below 2^SubBucketsLog2 take the first SubBuckets buckets, each further power of two up
+  // to 2^63 another SubBuckets.
+  static const uint32_t NumBuckets = (64 - SubBucketsLog2 + 1) * SubBuckets;
+
+  /**
+   * @return the index of the bucket of a value.
+   */
+  static uint32_t index(uint64_t value);
+
+  /**
+   * @return the lowest value of a bucket.
+   */
+  static uint64_t lowerBound(uint32_t index);
+
+  /**
+   * @return the number of values of a bucket.
+   */
+  static uint64_t width(uint32_t index);
+
+  void record(uint64_t value) {
+    counts_[index(value)].fetch_add(1, std::memory_order_relaxed);
+    sum_.fetch_add(value, std::memory_order_relaxed);
+    recorded_.store(true, std::memory_order_release);
+  }
+
+  /**
+   * Move the values recorded since the last drain into counts and sum.
+   * @param counts supplies the counts of each bucket to add the recorded values to, which must
+   *        have NumBuckets entries.
+   * @param sum supplies the sum to add the recorded values to.
+   */
+  void drainInto(std::vector<uint64_t>& counts, uint64_t& sum);
+
+private:
+  std::atomic<uint64_t> counts_[NumBuckets]{};
+  std::atomic<uint64_t> sum_{};
+  // Whether any values were recorded since the last drain, so that idle histograms are skipped.
+  std::atomic<bool> recorded_{};
+};
+
+/**
+ * Statistics computed from the bucket counts of HistogramBuckets. The value of a quantile is
+ * interpolated within its bucket.
+ */
+class HistogramStatisticsImpl : public HistogramStatistics {
+public:
+  HistogramStatisticsImpl();
+
+  /**
+   * Recompute the statistics for the given bucket counts and sum of values.
+   */
+  void refresh(const std::vector<uint64_t>& counts, uint64_t sum);
+
+  // Stats::HistogramStatistics
+  const std::vector<double>& supportedQuantiles() const override;
+  const std::vector<double>& computedQuantiles() const override { return computed_quantiles_; }
+  uint64_t sampleCount() const override { return sample_count_; }
+  uint64_t sampleSum() const override { return sample_sum_; }
+
+private:
+  std::vector<double> computed_quantiles_;
+  uint64_t sample_count_{};
+  uint64_t sample_sum_{};
+};
+
+class ParentHistogramImpl;
+
+/**
+ * The histogram of a single thread, which records into buckets of its own that the parent
+ * histogram drains when merging.
+ */
+class ThreadLocalHistogramImpl : public Histogram {
+public:
+  ThreadLocalHistogramImpl(ParentHistogramImpl& parent) : parent_(parent) {}
+
+  // Stats::Metric
+  const std::string& name() const override;
+  const std::vector<Tag>& tags() const override;
+  const std::string& tagExtractedName() const override;
+
+  // Stats::Histogram
+  void recordValue(uint64_t value) override;
+
+private:
+  ParentHistogramImpl& parent_;
+  HistogramBuckets buckets_;
+
+  friend class ParentHistogramImpl;
+};
+
+typedef std::shared_ptr<ThreadLocalHistogramImpl> ThreadLocalHistogramSharedPtr;
+
+/**
+ * Histogram that merges the values recorded by its thread local histograms, and by itself for the
+ * threads that do not have one, and delivers each value to the sinks of the store as well.
+ */
+class ParentHistogramImpl : public ParentHistogram, public MetricImpl {
+public:
+  ParentHistogramImpl(const std::string& name, Store& parent, std::string&& tag_extracted_name,
+                      std::vector<Tag>&& tags);
+
+  /**
+   * Create a histogram for the calling thread to record into. It is owned by the parent as well as
+   * the caller, so values recorded after the caller releases it are merged all the same.
+   */
+  ThreadLocalHistogramSharedPtr createThreadLocal();
+
+  // Stats::Histogram
+  void recordValue(uint64_t value) override;
+
+  // Stats::ParentHistogram
+  void merge() override;
+  const HistogramStatistics& intervalStatistics() const override { return interval_statistics_; }
+  const HistogramStatistics& cumulativeStatistics() const override {
+    return cumulative_statistics_;
+  }
+  bool used() const override { return cumulative_statistics_.sampleCount() > 0; }
+  std::string summary() const override;
+
+private:
+  Store& parent_;
+  HistogramBuckets buckets_;
+  std::mutex lock_;
+  std::vector<ThreadLocalHistogramSharedPtr> thread_local_histograms_;
+  std::vector<uint64_t> cumulative_counts_;
+  uint64_t cumulative_sum_{};
+  HistogramStatisticsImpl interval_statistics_;
+  HistogramStatisticsImpl cumulative_statistics_;
+
+  friend class ThreadLocalHistogramImpl;
+};
+
+typedef std::shared_ptr<ParentHistogramImpl> ParentHistogramImplSharedPtr;
+
+} // namespace Stats
+} // namespace Envoy
@@ -0,0 +1,66 @@
+#include "common/stats/sharded_counter_impl.h"
+
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+
+namespace Envoy {
+namespace Stats {
+
+ShardedCounterImpl::~ShardedCounterImpl() {
+  // Keep the increments that were not folded yet in the raw stat data, which may outlive the
+  // counter when it is shared with another scope or process.
+  std::unique_lock<std::mutex> lock(lock_);
+  fold();
+}
+
+size_t ShardedCounterImpl::shardIndex() {
+  static std::atomic<size_t> next_index{};
+  static thread_local const size_t index =
+      next_index.fetch_add(1, std::memory_order_relaxed) % NumShards;
+  return index;
+}
+
+void ShardedCounterImpl::add(uint64_t amount) {
+  shards_[shardIndex()].value_.fetch_add(amount, std::memory_order_relaxed);
+  if (!(data_.flags_ & RawStatData::Flags::Used)) {
+    data_.flags_ |= RawStatData::Flags::Used;
+  }
+}
+
+uint64_t ShardedCounterImpl::latch() {
+  std::unique_lock<std::mutex> lock(lock_);
+  fold();
+  return CounterImpl::latch();
+}
+
+void ShardedCounterImpl::reset() {
+  std::unique_lock<std::mutex> lock(lock_);
+  fold();
+  CounterImpl::reset();
+}
+
+uint64_t ShardedCounterImpl::value() const {
+  std::unique_lock<std::mutex> lock(lock_);
+  uint64_t value = CounterImpl::value();
+  for (size_t i = 0; i < NumShards; i++) {
+    value += shards_[i].value_.load(std::memory_order_relaxed) - folded_[i];
+  }
+  return value;
+}
+
+void ShardedCounterImpl::fold() {
+  uint64_t delta = 0;
+  for (size_t i = 0; i < NumShards; i++) {
+    const uint64_t value = shards_[i].value_.load(std::memory_order_relaxed);
+    delta += value - folded_[i];
+    folded_[i] = value;
+  }
+  if (delta > 0) {
+    data_.value_ += delta;
+    data_.pending_increment_ += delta;
+  }
+}
+
+} // namespace Stats
+} // namespace Envoy
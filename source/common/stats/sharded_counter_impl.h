@@ -0,0 +1,75 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "envoy/stats/stats.h"
+
+#include "common/stats/stats_impl.h"
+
+namespace Envoy {
+namespace Stats {
+
+/**
+ * Counter that the threads increment through shards of their own, for counters that all the
+ * workers increment for every request. The shard of the calling thread is picked at every
+ * increment, so the counter can be shared by all the threads like any other, and each shard has
+ * a cache line of its own so that the threads do not contend on the cache line of the raw stat
+ * data. Threads share a shard once there are more threads than shards, which the atomic increment
+ * of a shard allows. The increments of the shards are folded into the raw stat data whenever the
+ * counter is latched, so the shared value stays at most a flush interval behind, and value() adds
+ * those that were not folded yet.
+ */
+class ShardedCounterImpl : public CounterImpl {
+public:
+  ShardedCounterImpl(RawStatData& data, RawStatDataAllocator& alloc,
+                     std::string&& tag_extracted_name, std::vector<Tag>&& tags)
+      : CounterImpl(data, alloc, std::move(tag_extracted_name), std::move(tags)) {}
+  ~ShardedCounterImpl();
+
+  // Stats::Counter
+  void add(uint64_t amount) override;
+  void inc() override { add(1); }
+  uint64_t latch() override;
+  void reset() override;
+  uint64_t value() const override;
+
+  static const size_t NumShards = 16;
+
+private:
+  static const size_t CacheLineSize = 64;
+
+  /**
+   * The value of a shard, padded so that it has a cache line of its own whatever the alignment
+   * of the counter, which the allocator does not guarantee to be a cache line.
+   */
+  struct PaddedValue {
+    char padding_before_[CacheLineSize - sizeof(std::atomic<uint64_t>)];
+    std::atomic<uint64_t> value_{};
+    char padding_after_[CacheLineSize - sizeof(std::atomic<uint64_t>)];
+  };
+
+  /**
+   * @return size_t the index of the shard of the calling thread, assigned round robin the first
+   *         time the thread increments a sharded counter.
+   */
+  static size_t shardIndex();
+
+  /**
+   * Fold the increments of the shards since the last fold into the raw stat data. The lock must be
+   * held.
+   */
+  void fold();
+
+  std::array<PaddedValue, NumShards> shards_;
+  mutable std::mutex lock_;
+  // The values of the shards when they were last folded, guarded by the lock.
+  std::array<uint64_t, NumShards> folded_{};
+};
+
+} // namespace Stats
+} // namespace Envoy
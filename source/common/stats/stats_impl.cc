@@ -3,6 +3,7 @@
 #include <string.h>
 
 #include <algorithm>
+#include <cctype>
 #include <chrono>
 #include <string>
 
@@ -16,6 +17,30 @@ namespace Stats {
 
 namespace {
 
+// Whether a regex has a '|' outside of any group or bracket expression, in which case its
+// alternatives do not share the start of the regex.
+bool hasTopLevelAlternation(const std::string& regex) {
+  uint32_t depth = 0;
+  bool in_brackets = false;
+  for (size_t i = 0; i < regex.size(); i++) {
+    const char c = regex[i];
+    if (c == '\\') {
+      i++;
+    } else if (in_brackets) {
+      in_brackets = c != ']';
+    } else if (c == '[') {
+      in_brackets = true;
+    } else if (c == '(') {
+      depth++;
+    } else if (c == ')' && depth > 0) {
+      depth--;
+    } else if (c == '|' && depth == 0) {
+      return true;
+    }
+  }
+  return false;
+}
+
 // Round val up to the next multiple of the natural alignment.
 // Note: this implementation only works because 8 is a power of 2.
 size_t roundUpMultipleNaturalAlignment(size_t val) {
@@ -62,7 +87,35 @@ std::string Utility::sanitizeStatsName(const std::string& name) {
 }
 
 TagExtractorImpl::TagExtractorImpl(const std::string& name, const std::string& regex)
-    : name_(name), regex_(regex) {}
+    : name_(name), regex_(regex), prefix_(extractRegexPrefix(regex)) {}
+
+std::string TagExtractorImpl::extractRegexPrefix(const std::string& regex) {
+  std::string prefix;
+  if (regex.empty() || regex[0] != '^' || hasTopLevelAlternation(regex)) {
+    return prefix;
+  }
+
+  for (size_t i = 1; i < regex.size(); i++) {
+    const char c = regex[i];
+    if (c == '?' || c == '*' || c == '{') {
+      // The previous character is optional, or repeated any number of times.
+      if (!prefix.empty()) {
+        prefix.pop_back();
+      }
+      break;
+    }
+    const bool escape = c == '\\' && i + 1 < regex.size();
+    if (escape && !isalnum(static_cast<unsigned char>(regex[i + 1]))) {
+      // An escaped punctuation character is itself, unlike escapes such as \d or \w.
+      prefix.push_back(regex[++i]);
+    } else if (!escape && (isalnum(static_cast<unsigned char>(c)) || c == '_' || c == '-')) {
+      prefix.push_back(c);
+    } else {
+      break;
+    }
+  }
+  return prefix;
+}
 
 TagExtractorPtr TagExtractorImpl::createTagExtractor(const std::string& name,
                                                      const std::string& regex) {
@@ -91,6 +144,12 @@ TagExtractorPtr TagExtractorImpl::createTagExtractor(const std::string& name,
 
 std::string TagExtractorImpl::extractTag(const std::string& tag_extracted_name,
                                          std::vector<Tag>& tags) const {
+  // Most extractors only apply to the stats of one component, which the prefix of their regex
+  // tells apart much faster than the regex.
+  if (tag_extracted_name.compare(0, prefix_.size(), prefix_) != 0) {
+    return tag_extracted_name;
+  }
+
   std::smatch match;
   // The regex must match and contain one or more subexpressions (all after the first are ignored).
   if (std::regex_search(tag_extracted_name, match, regex_) && match.size() > 1) {
@@ -116,9 +175,11 @@ std::string TagExtractorImpl::extractTag(const std::string& tag_extracted_name,
 }
 
 RawStatData* HeapRawStatDataAllocator::alloc(const std::string& name) {
-  // This must be zero-initialized
-  RawStatData* data = static_cast<RawStatData*>(::calloc(RawStatData::size(), 1));
-  data->initialize(name);
+  // Heap stats are never shared with another process, so unlike the ones in shared memory they
+  // only need room for their own name rather than the longest one. This must be zero-initialized.
+  const size_t name_size = std::min(name.size(), RawStatData::maxNameLength()) + 1;
+  RawStatData* data = static_cast<RawStatData*>(::calloc(sizeof(RawStatData) + name_size, 1));
+  data->initialize(name, name_size);
   return data;
 }
 
@@ -128,12 +189,13 @@ void HeapRawStatDataAllocator::free(RawStatData& data) {
   ::free(&data);
 }
 
-void RawStatData::initialize(const std::string& name) {
+void RawStatData::initialize(const std::string& name, size_t name_size) {
   ASSERT(!initialized());
   ASSERT(name.size() <= maxNameLength());
   ASSERT(std::string::npos == name.find(':'));
+  ASSERT(name_size <= nameSize());
   ref_count_ = 1;
-  StringUtil::strlcpy(name_, name.substr(0, maxNameLength()).c_str(), nameSize());
+  StringUtil::strlcpy(name_, name.substr(0, maxNameLength()).c_str(), name_size);
 }
 
 bool RawStatData::matches(const std::string& name) {
@@ -141,5 +203,15 @@ bool RawStatData::matches(const std::string& name) {
   return 0 == strcmp(name.substr(0, maxNameLength()).c_str(), name_);
 }
 
+const std::vector<Tag>& PrimitiveCounter::tags() const {
+  static const std::vector<Tag>* no_tags = new std::vector<Tag>();
+  return *no_tags;
+}
+
+const std::vector<Tag>& PrimitiveGauge::tags() const {
+  static const std::vector<Tag>* no_tags = new std::vector<Tag>();
+  return *no_tags;
+}
+
 } // namespace Stats
 } // namespace Envoy
@@ -38,9 +38,17 @@ public:
   std::string extractTag(const std::string& tag_extracted_name,
                          std::vector<Tag>& tags) const override;
 
+  /**
+   * @return std::string the literal prefix that a name must start with for the regex to match,
+   *         which is empty unless the regex starts with '^' followed by literal characters.
+   */
+  static std::string extractRegexPrefix(const std::string& regex);
+
 private:
   const std::string name_;
   const std::regex regex_;
+  // Names that do not start with it are not run through the regex.
+  const std::string prefix_;
 };
 
 /**
@@ -118,8 +126,10 @@ struct RawStatData {
   /**
    * Initializes this object to have the specified name,
    * a refcount of 1, and all other values zero.
+   * @param name_size supplies the number of bytes of name_, which may be less than nameSize() for
+   *        stats that are not in shared memory but must fit the name and its NULL-terminator.
    */
-  void initialize(const std::string& name);
+  void initialize(const std::string& name, size_t name_size = nameSize());
 
   /**
    * Returns true if object is in use.
@@ -222,8 +232,10 @@ public:
   bool used() const override { return data_.flags_ & RawStatData::Flags::Used; }
   uint64_t value() const override { return data_.value_; }
 
-private:
+protected:
   RawStatData& data_;
+
+private:
   RawStatDataAllocator& alloc_;
 };
 
@@ -262,6 +274,76 @@ private:
   RawStatDataAllocator& alloc_;
 };
 
+/**
+ * Counter that keeps its value in place rather than in RawStatData, for metrics that belong to an
+ * object and are not part of a store. The name is not copied and must outlive the counter. There
+ * are no tags.
+ */
+class PrimitiveCounter : public Counter {
+public:
+  PrimitiveCounter(const std::string& name) : name_(name) {}
+
+  // Stats::Metric
+  const std::string& name() const override { return name_; }
+  const std::vector<Tag>& tags() const override;
+  const std::string& tagExtractedName() const override { return name_; }
+
+  // Stats::Counter
+  void add(uint64_t amount) override {
+    value_ += amount;
+    pending_increment_ += amount;
+    used_ = true;
+  }
+  void inc() override { add(1); }
+  uint64_t latch() override { return pending_increment_.exchange(0); }
+  void reset() override { value_ = 0; }
+  bool used() const override { return used_; }
+  uint64_t value() const override { return value_; }
+
+private:
+  const std::string& name_;
+  std::atomic<uint64_t> value_{};
+  std::atomic<uint64_t> pending_increment_{};
+  std::atomic<bool> used_{};
+};
+
+/**
+ * Gauge that keeps its value in place rather than in RawStatData, see PrimitiveCounter.
+ */
+class PrimitiveGauge : public Gauge {
+public:
+  PrimitiveGauge(const std::string& name) : name_(name) {}
+
+  // Stats::Metric
+  const std::string& name() const override { return name_; }
+  const std::vector<Tag>& tags() const override;
+  const std::string& tagExtractedName() const override { return name_; }
+
+  // Stats::Gauge
+  void add(uint64_t amount) override {
+    value_ += amount;
+    used_ = true;
+  }
+  void dec() override { sub(1); }
+  void inc() override { add(1); }
+  void set(uint64_t value) override {
+    value_ = value;
+    used_ = true;
+  }
+  void sub(uint64_t amount) override {
+    ASSERT(value_ >= amount);
+    ASSERT(used());
+    value_ -= amount;
+  }
+  bool used() const override { return used_; }
+  uint64_t value() const override { return value_; }
+
+private:
+  const std::string& name_;
+  std::atomic<uint64_t> value_{};
+  std::atomic<bool> used_{};
+};
+
 /**
  * Histogram implementation for the heap.
  */
@@ -354,6 +436,12 @@ public:
   // Stats::Store
   std::list<CounterSharedPtr> counters() const override { return counters_.toList(); }
   std::list<GaugeSharedPtr> gauges() const override { return gauges_.toList(); }
+  // Isolated histograms only deliver their values to the sinks of the store, which has none.
+  std::list<ParentHistogramSharedPtr> histograms() const override { return {}; }
+  // Isolated scopes only prefix the stats of the store, so there are none with stats of their own,
+  // and the store does not account for its stats.
+  std::list<ScopeStatsInfo> scopes() const override { return {}; }
+  uint64_t numStatsCreated() const override { return 0; }
 
 private:
   struct ScopeImpl : public Scope {
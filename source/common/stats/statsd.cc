@@ -1,7 +1,13 @@
 #include "common/stats/statsd.h"
 
+#include <sys/socket.h>
+
+#include <algorithm>
+#include <cerrno>
 #include <chrono>
+#include <cmath>
 #include <cstdint>
+#include <cstring>
 #include <string>
 
 #include "envoy/common/exception.h"
@@ -18,6 +24,8 @@ namespace Envoy {
 namespace Stats {
 namespace Statsd {
 
+constexpr size_t Writer::MAX_DATAGRAMS_PER_SEND;
+
 Writer::Writer(Network::Address::InstanceConstSharedPtr address) {
   fd_ = address->socket(Network::Address::SocketType::Datagram);
   ASSERT(fd_ != -1);
@@ -37,32 +45,96 @@ void Writer::write(const std::string& message) {
   ::send(fd_, message.c_str(), message.size(), MSG_DONTWAIT);
 }
 
+void Writer::writeMultiple(const std::vector<std::string>& messages) {
+#if defined(__linux__)
+  mmsghdr headers[MAX_DATAGRAMS_PER_SEND];
+  iovec iovecs[MAX_DATAGRAMS_PER_SEND];
+  size_t next = 0;
+  while (next < messages.size()) {
+    const size_t count = std::min(MAX_DATAGRAMS_PER_SEND, messages.size() - next);
+    memset(headers, 0, sizeof(mmsghdr) * count);
+    for (size_t i = 0; i < count; i++) {
+      const std::string& message = messages[next + i];
+      iovecs[i].iov_base = const_cast<char*>(message.data());
+      iovecs[i].iov_len = message.size();
+      headers[i].msg_hdr.msg_iov = &iovecs[i];
+      headers[i].msg_hdr.msg_iovlen = 1;
+    }
+
+    const int rc = ::sendmmsg(fd_, headers, count, MSG_DONTWAIT);
+    if (rc > 0) {
+      next += rc;
+    } else if (errno == EAGAIN || errno == EWOULDBLOCK) {
+      // The socket buffer is full. Anything else sent during this flush would be dropped too.
+      return;
+    } else {
+      // sendmmsg() stops at the first message that fails, e.g. because of an ICMP error from an
+      // earlier send. Drop just that message, as write() would, and carry on with the rest.
+      next++;
+    }
+  }
+#else
+  for (const std::string& message : messages) {
+    write(message);
+  }
+#endif
+}
+
+constexpr uint64_t UdpStatsdSink::DEFAULT_MAX_DATAGRAM_SIZE;
+
 UdpStatsdSink::UdpStatsdSink(ThreadLocal::SlotAllocator& tls,
-                             Network::Address::InstanceConstSharedPtr address, const bool use_tag)
-    : tls_(tls.allocateSlot()), server_address_(std::move(address)), use_tag_(use_tag) {
+                             Network::Address::InstanceConstSharedPtr address, const bool use_tag,
+                             uint64_t max_datagram_size)
+    : tls_(tls.allocateSlot()), server_address_(std::move(address)), use_tag_(use_tag),
+      max_datagram_size_(max_datagram_size) {
   tls_->set([this](Event::Dispatcher&) -> ThreadLocal::ThreadLocalObjectSharedPtr {
     return std::make_shared<Writer>(this->server_address_);
   });
 }
 
 void UdpStatsdSink::flushCounter(const Counter& counter, uint64_t delta) {
-  const std::string message(
+  addToDatagram(
       fmt::format("envoy.{}:{}|c{}", getName(counter), delta, buildTagStr(counter.tags())));
-  tls_->getTyped<Writer>().write(message);
 }
 
 void UdpStatsdSink::flushGauge(const Gauge& gauge, uint64_t value) {
-  const std::string message(
-      fmt::format("envoy.{}:{}|g{}", getName(gauge), value, buildTagStr(gauge.tags())));
-  tls_->getTyped<Writer>().write(message);
+  addToDatagram(fmt::format("envoy.{}:{}|g{}", getName(gauge), value, buildTagStr(gauge.tags())));
 }
 
-void UdpStatsdSink::onHistogramComplete(const Histogram& histogram, uint64_t value) {
-  // For statsd histograms are all timers.
-  const std::string message(fmt::format("envoy.{}:{}|ms{}", getName(histogram),
-                                        std::chrono::milliseconds(value).count(),
-                                        buildTagStr(histogram.tags())));
-  tls_->getTyped<Writer>().write(message);
+void UdpStatsdSink::endFlush() {
+  if (!datagrams_.empty()) {
+    tls_->getTyped<Writer>().writeMultiple(datagrams_);
+    datagrams_.clear();
+  }
+}
+
+void UdpStatsdSink::addToDatagram(const std::string& message) {
+  // A message that is too big on its own still gets a datagram to itself.
+  if (datagrams_.empty() ||
+      datagrams_.back().size() + 1 + message.size() > max_datagram_size_) {
+    datagrams_.push_back(message);
+  } else {
+    datagrams_.back() += '\n';
+    datagrams_.back() += message;
+  }
+}
+
+void UdpStatsdSink::flushHistogram(const ParentHistogram& histogram) {
+  const HistogramStatistics& statistics = histogram.intervalStatistics();
+  if (statistics.sampleCount() == 0) {
+    return;
+  }
+
+  const std::string name = getName(histogram);
+  const std::string tags = buildTagStr(histogram.tags());
+  const std::vector<double>& quantiles = statistics.supportedQuantiles();
+  for (size_t i = 0; i < quantiles.size(); i++) {
+    // p0, p25, ..., p99_9, p100.
+    std::string quantile = fmt::format("{}", 100 * quantiles[i]);
+    std::replace(quantile.begin(), quantile.end(), '.', '_');
+    addToDatagram(fmt::format("envoy.{}.p{}:{}|g{}", name, quantile,
+                              std::llround(statistics.computedQuantiles()[i]), tags));
+  }
 }
 
 const std::string UdpStatsdSink::getName(const Metric& metric) {
@@ -220,7 +292,9 @@ void TcpStatsdSink::TlsSink::write(Buffer::Instance& buffer) {
                                      parent_.cluster_info_->stats().upstream_cx_tx_bytes_total_,
                                      parent_.cluster_info_->stats().upstream_cx_tx_bytes_buffered_,
                                      &parent_.cluster_info_->stats().bind_errors_});
-    connection_->connect();
+    if (!info.preconnected_) {
+      connection_->connect();
+    }
   }
 
   connection_->write(buffer);
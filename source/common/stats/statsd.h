@@ -3,6 +3,7 @@
 #include <chrono>
 #include <cstdint>
 #include <string>
+#include <vector>
 
 #include "envoy/local_info/local_info.h"
 #include "envoy/network/connection.h"
@@ -27,24 +28,41 @@ public:
   virtual ~Writer();
 
   virtual void write(const std::string& message);
+
+  /**
+   * Send each message as its own datagram, batching them into as few syscalls as possible.
+   * Like write(), messages that cannot be sent immediately are dropped.
+   */
+  virtual void writeMultiple(const std::vector<std::string>& messages);
+
   // Called in unit test to validate address.
   int getFdForTests() const { return fd_; };
 
 private:
+  // Number of datagrams handed to each sendmmsg() call.
+  static constexpr size_t MAX_DATAGRAMS_PER_SEND = 64;
+
   int fd_;
 };
 
 /**
- * Implementation of Sink that writes to a UDP statsd address.
+ * Implementation of Sink that writes to a UDP statsd address. Counters and gauges flushed between
+ * beginFlush() and endFlush() are packed, newline separated, into datagrams of at most
+ * max_datagram_size bytes and sent together at the end of the flush. Rather than sending each
+ * histogram value as a timer, the quantiles of the values of each flush interval are sent as
+ * gauges named after the histogram and the quantile, e.g. "envoy.<name>.p99".
  */
 class UdpStatsdSink : public Sink {
 public:
+  // Fits in a single packet on a 1500 byte MTU link with room for IPv6, UDP and tunnel headers.
+  static constexpr uint64_t DEFAULT_MAX_DATAGRAM_SIZE = 1432;
+
   UdpStatsdSink(ThreadLocal::SlotAllocator& tls, Network::Address::InstanceConstSharedPtr address,
-                const bool use_tag);
+                const bool use_tag, uint64_t max_datagram_size = DEFAULT_MAX_DATAGRAM_SIZE);
   // For testing.
   UdpStatsdSink(ThreadLocal::SlotAllocator& tls, const std::shared_ptr<Writer>& writer,
-                const bool use_tag)
-      : tls_(tls.allocateSlot()), use_tag_(use_tag) {
+                const bool use_tag, uint64_t max_datagram_size = DEFAULT_MAX_DATAGRAM_SIZE)
+      : tls_(tls.allocateSlot()), use_tag_(use_tag), max_datagram_size_(max_datagram_size) {
     tls_->set(
         [writer](Event::Dispatcher&) -> ThreadLocal::ThreadLocalObjectSharedPtr { return writer; });
   }
@@ -53,8 +71,9 @@ public:
   void beginFlush() override {}
   void flushCounter(const Counter& counter, uint64_t delta) override;
   void flushGauge(const Gauge& gauge, uint64_t value) override;
-  void endFlush() override {}
-  void onHistogramComplete(const Histogram& histogram, uint64_t value) override;
+  void flushHistogram(const ParentHistogram& histogram) override;
+  void endFlush() override;
+  void onHistogramComplete(const Histogram&, uint64_t) override {}
 
   // Called in unit test to validate writer construction and address.
   int getFdForTests() { return tls_->getTyped<Writer>().getFdForTests(); }
@@ -63,10 +82,14 @@ public:
 private:
   const std::string getName(const Metric& metric);
   const std::string buildTagStr(const std::vector<Tag>& tags);
+  void addToDatagram(const std::string& message);
 
   ThreadLocal::SlotPtr tls_;
   Network::Address::InstanceConstSharedPtr server_address_;
   const bool use_tag_;
+  const uint64_t max_datagram_size_;
+  // Datagrams built during the current flush. The last one is still being filled.
+  std::vector<std::string> datagrams_;
 };
 
 /**
@@ -89,6 +112,9 @@ public:
     tls_->getTyped<TlsSink>().flushGauge(gauge.name(), value);
   }
 
+  // Histogram values are sent as timers as they are recorded.
+  void flushHistogram(const ParentHistogram&) override {}
+
   void endFlush() override { tls_->getTyped<TlsSink>().endFlush(true); }
 
   void onHistogramComplete(const Histogram& histogram, uint64_t value) override {
@@ -0,0 +1,101 @@
+#include "common/stats/symbol_table_impl.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "common/common/assert.h"
+
+namespace Envoy {
+namespace Stats {
+
+namespace {
+
+void appendSymbol(Symbol symbol, std::string& bytes) {
+  while (symbol >= 0x80) {
+    bytes.push_back(static_cast<char>((symbol & 0x7f) | 0x80));
+    symbol >>= 7;
+  }
+  bytes.push_back(static_cast<char>(symbol));
+}
+
+} // namespace
+
+StatName SymbolTable::encode(const std::string& name, SymbolCache* cache) {
+  StatName stat_name;
+  std::unique_lock<std::mutex> lock(lock_, std::defer_lock);
+  size_t start = 0;
+  while (true) {
+    const size_t end = std::min(name.find('.', start), name.size());
+    const std::string token = name.substr(start, end - start);
+    Symbol symbol;
+    SymbolCache::const_iterator cached;
+    if (cache != nullptr && (cached = cache->find(token)) != cache->end()) {
+      symbol = cached->second;
+    } else {
+      // Take the lock once for all the tokens that are not in the cache.
+      if (!lock.owns_lock()) {
+        lock.lock();
+      }
+      symbol = toSymbol(token);
+      if (cache != nullptr) {
+        cache->emplace(token, symbol);
+      }
+    }
+    appendSymbol(symbol, stat_name.bytes_);
+
+    if (end == name.size()) {
+      break;
+    }
+    start = end + 1;
+  }
+  return stat_name;
+}
+
+std::string SymbolTable::decode(const StatName& name) const {
+  std::string decoded;
+  std::unique_lock<std::mutex> lock(lock_);
+  const std::string& bytes = name.bytes_;
+  size_t i = 0;
+  bool first = true;
+  while (i < bytes.size()) {
+    Symbol symbol = 0;
+    uint32_t shift = 0;
+    uint8_t byte;
+    do {
+      ASSERT(i < bytes.size());
+      byte = static_cast<uint8_t>(bytes[i++]);
+      symbol |= static_cast<Symbol>(byte & 0x7f) << shift;
+      shift += 7;
+    } while (byte & 0x80);
+
+    ASSERT(symbol < decode_vec_.size());
+    if (!first) {
+      decoded.push_back('.');
+    }
+    first = false;
+    decoded += decode_vec_[symbol];
+  }
+  return decoded;
+}
+
+uint64_t SymbolTable::size() const {
+  std::unique_lock<std::mutex> lock(lock_);
+  return decode_vec_.size();
+}
+
+Symbol SymbolTable::toSymbol(const std::string& token) {
+  auto it = encode_map_.find(token);
+  if (it != encode_map_.end()) {
+    return it->second;
+  }
+  const Symbol symbol = decode_vec_.size();
+  encode_map_.emplace(token, symbol);
+  decode_vec_.push_back(token);
+  return symbol;
+}
+
+} // namespace Stats
+} // namespace Envoy
@@ -0,0 +1,86 @@
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace Envoy {
+namespace Stats {
+
+typedef uint32_t Symbol;
+
+/**
+ * A stat name encoded by a SymbolTable, as the symbols of its '.' separated tokens, each written
+ * as a little endian base 128 varint. A name of a few tokens takes a few bytes, which fit the
+ * small string buffer of the string holding them, and names compare and hash as those bytes.
+ */
+class StatName {
+public:
+  bool operator==(const StatName& other) const { return bytes_ == other.bytes_; }
+  bool operator!=(const StatName& other) const { return bytes_ != other.bytes_; }
+
+  /**
+   * @return const std::string& the encoded bytes of the name.
+   */
+  const std::string& bytes() const { return bytes_; }
+
+  struct Hash {
+    size_t operator()(const StatName& name) const { return std::hash<std::string>()(name.bytes_); }
+  };
+
+private:
+  std::string bytes_;
+
+  friend class SymbolTable;
+};
+
+/**
+ * The symbols of the tokens a thread has encoded, so that it can encode names made of them again
+ * without taking the lock of the symbol table.
+ */
+typedef std::unordered_map<std::string, Symbol> SymbolCache;
+
+/**
+ * Table of the tokens of stat names, which gives each distinct token a symbol, so that a stat name
+ * can be kept as the sequence of the symbols of its tokens. Stat names repeat the same few
+ * tokens ("cluster", the cluster names, "upstream_rq_200" and so on) over and over, so the table
+ * stays small while the names it encodes are a fraction of their length. Symbols are never freed,
+ * which keeps the symbols held by the caches of the threads valid for as long as the table. The
+ * table is thread safe.
+ */
+class SymbolTable {
+public:
+  /**
+   * Encode a stat name, adding the tokens of the name that are not in the table yet.
+   * @param name supplies the name.
+   * @param cache supplies the symbol cache of the calling thread, which is used instead of the
+   *        table for the tokens it has and gets the symbols of the others. If nullptr, the table
+   *        is used for all the tokens.
+   * @return StatName the encoded name.
+   */
+  StatName encode(const std::string& name, SymbolCache* cache = nullptr);
+
+  /**
+   * @return std::string the name that was encoded as the given stat name.
+   */
+  std::string decode(const StatName& name) const;
+
+  /**
+   * @return uint64_t the number of distinct tokens in the table.
+   */
+  uint64_t size() const;
+
+private:
+  Symbol toSymbol(const std::string& token);
+
+  mutable std::mutex lock_;
+  std::unordered_map<std::string, Symbol> encode_map_;
+  // The token of each symbol.
+  std::vector<std::string> decode_vec_;
+};
+
+} // namespace Stats
+} // namespace Envoy
@@ -2,32 +2,48 @@
 
 #include <chrono>
 #include <cstdint>
+#include <iterator>
 #include <list>
 #include <memory>
 #include <mutex>
+#include <shared_mutex>
 #include <string>
 #include <unordered_set>
+#include <vector>
+
+#include "common/common/utility.h"
 
 namespace Envoy {
 namespace Stats {
 
-ThreadLocalStoreImpl::ThreadLocalStoreImpl(RawStatDataAllocator& alloc)
-    : alloc_(alloc), default_scope_(createScope("")),
+ThreadLocalStoreImpl::ThreadLocalStoreImpl(RawStatDataAllocator& alloc,
+                                           uint32_t deleted_scope_flushes)
+    : alloc_(alloc), deleted_scope_flushes_(deleted_scope_flushes),
+      default_scope_(createScope("")),
       num_last_resort_stats_(default_scope_->counter("stats.overflow")) {}
 
 ThreadLocalStoreImpl::~ThreadLocalStoreImpl() {
   ASSERT(shutting_down_);
   default_scope_.reset();
   ASSERT(scopes_.empty());
+  retained_caches_.clear();
 }
 
 std::list<CounterSharedPtr> ThreadLocalStoreImpl::counters() const {
   // Handle de-dup due to overlapping scopes.
   std::list<CounterSharedPtr> ret;
-  std::unordered_set<std::string> names;
+  std::unordered_set<StatName, StatName::Hash> names;
   std::unique_lock<std::mutex> lock(lock_);
   for (ScopeImpl* scope : scopes_) {
-    for (auto counter : scope->central_cache_.counters_) {
+    std::shared_lock<std::shared_timed_mutex> scope_lock(scope->central_cache_lock_);
+    for (const auto& counter : scope->central_cache_.counters_) {
+      if (names.insert(counter.first).second) {
+        ret.push_back(counter.second);
+      }
+    }
+  }
+  for (const RetainedCacheEntry& retained : retained_caches_) {
+    for (const auto& counter : retained.central_cache_.counters_) {
       if (names.insert(counter.first).second) {
         ret.push_back(counter.second);
       }
@@ -44,13 +60,33 @@ ScopePtr ThreadLocalStoreImpl::createScope(const std::string& name) {
   return std::move(new_scope);
 }
 
+std::list<ScopeStatsInfo> ThreadLocalStoreImpl::scopes() const {
+  std::list<ScopeStatsInfo> ret;
+  std::unique_lock<std::mutex> lock(lock_);
+  for (ScopeImpl* scope : scopes_) {
+    std::shared_lock<std::shared_timed_mutex> scope_lock(scope->central_cache_lock_);
+    ret.push_back(
+        {scope->prefix_, scope->num_stats_, scope->num_overflow_stats_, scope->name_bytes_});
+  }
+
+  return ret;
+}
+
 std::list<GaugeSharedPtr> ThreadLocalStoreImpl::gauges() const {
   // Handle de-dup due to overlapping scopes.
   std::list<GaugeSharedPtr> ret;
-  std::unordered_set<std::string> names;
+  std::unordered_set<StatName, StatName::Hash> names;
   std::unique_lock<std::mutex> lock(lock_);
   for (ScopeImpl* scope : scopes_) {
-    for (auto gauge : scope->central_cache_.gauges_) {
+    std::shared_lock<std::shared_timed_mutex> scope_lock(scope->central_cache_lock_);
+    for (const auto& gauge : scope->central_cache_.gauges_) {
+      if (names.insert(gauge.first).second) {
+        ret.push_back(gauge.second);
+      }
+    }
+  }
+  for (const RetainedCacheEntry& retained : retained_caches_) {
+    for (const auto& gauge : retained.central_cache_.gauges_) {
       if (names.insert(gauge.first).second) {
         ret.push_back(gauge.second);
       }
@@ -60,6 +96,30 @@ std::list<GaugeSharedPtr> ThreadLocalStoreImpl::gauges() const {
   return ret;
 }
 
+std::list<ParentHistogramSharedPtr> ThreadLocalStoreImpl::histograms() const {
+  // Handle de-dup due to overlapping scopes.
+  std::list<ParentHistogramSharedPtr> ret;
+  std::unordered_set<StatName, StatName::Hash> names;
+  std::unique_lock<std::mutex> lock(lock_);
+  for (ScopeImpl* scope : scopes_) {
+    std::shared_lock<std::shared_timed_mutex> scope_lock(scope->central_cache_lock_);
+    for (const auto& histogram : scope->central_cache_.histograms_) {
+      if (names.insert(histogram.first).second) {
+        ret.push_back(histogram.second);
+      }
+    }
+  }
+  for (const RetainedCacheEntry& retained : retained_caches_) {
+    for (const auto& histogram : retained.central_cache_.histograms_) {
+      if (names.insert(histogram.first).second) {
+        ret.push_back(histogram.second);
+      }
+    }
+  }
+
+  return ret;
+}
+
 void ThreadLocalStoreImpl::initializeThreading(Event::Dispatcher& main_thread_dispatcher,
                                                ThreadLocal::Instance& tls) {
   main_thread_dispatcher_ = &main_thread_dispatcher;
@@ -74,11 +134,31 @@ void ThreadLocalStoreImpl::shutdownThreading() {
   shutting_down_ = true;
 }
 
+void ThreadLocalStoreImpl::onStatsFlushed() {
+  // The released caches are destroyed after the lock is released, as freeing their stats takes
+  // the lock of the allocator.
+  std::list<RetainedCacheEntry> released;
+  std::unique_lock<std::mutex> lock(lock_);
+  for (auto it = retained_caches_.begin(); it != retained_caches_.end();) {
+    auto next = std::next(it);
+    if (--it->flushes_ == 0) {
+      released.splice(released.end(), retained_caches_, it);
+    }
+    it = next;
+  }
+  lock.unlock();
+}
+
 void ThreadLocalStoreImpl::releaseScopeCrossThread(ScopeImpl* scope) {
   std::unique_lock<std::mutex> lock(lock_);
   ASSERT(scopes_.count(scope) == 1);
   scopes_.erase(scope);
 
+  // The scope is being destroyed, so nothing else uses its central cache anymore.
+  if (deleted_scope_flushes_ > 0 && !shutting_down_) {
+    retained_caches_.push_back({std::move(scope->central_cache_), deleted_scope_flushes_});
+  }
+
   // This can happen from any thread. We post() back to the main thread which will initiate the
   // cache flush operation.
   if (!shutting_down_ && main_thread_dispatcher_) {
@@ -96,6 +176,17 @@ std::string ThreadLocalStoreImpl::getTagsForName(const std::string& name, std::v
   return tag_extracted_name;
 }
 
+bool ThreadLocalStoreImpl::isSharded(const std::string& name) const {
+  for (const std::string& sharded_name : sharded_counters_) {
+    if (StringUtil::endsWith(name, sharded_name) &&
+        (name.size() == sharded_name.size() ||
+         name[name.size() - sharded_name.size() - 1] == '.')) {
+      return true;
+    }
+  }
+  return false;
+}
+
 void ThreadLocalStoreImpl::clearScopeFromCaches(ScopeImpl* scope) {
   // If we are shutting down we no longer perform cache flushes as workers may be shutting down
   // at the same time.
@@ -119,18 +210,71 @@ ThreadLocalStoreImpl::SafeAllocData ThreadLocalStoreImpl::safeAlloc(const std::s
   }
 }
 
+ThreadLocalStoreImpl::TlsCache* ThreadLocalStoreImpl::tlsCache() {
+  if (shutting_down_ || !tls_) {
+    return nullptr;
+  }
+  // Threads that are not registered with TLS go without a cache, like the main thread before
+  // threading is initialized.
+  ThreadLocal::ThreadLocalObjectSharedPtr tls_cache = tls_->get();
+  return static_cast<TlsCache*>(tls_cache.get());
+}
+
+StatName ThreadLocalStoreImpl::encode(const std::string& name, TlsCache* tls_cache) {
+  return symbol_table_.encode(name, tls_cache != nullptr ? &tls_cache->symbols_ : nullptr);
+}
+
 ThreadLocalStoreImpl::ScopeImpl::~ScopeImpl() { parent_.releaseScopeCrossThread(this); }
 
+template <class StatMap, class MakeStat>
+typename StatMap::mapped_type
+ThreadLocalStoreImpl::ScopeImpl::findOrCreate(StatMap& map, const StatName& stat_name,
+                                              const std::string& name, MakeStat make) {
+  // Once a stat is in the central cache it stays there until the scope is destroyed, so most
+  // thread local cache misses only need the shared lock.
+  {
+    std::shared_lock<std::shared_timed_mutex> lock(central_cache_lock_);
+    auto it = map.find(stat_name);
+    if (it != map.end()) {
+      return it->second;
+    }
+  }
+
+  std::unique_lock<std::shared_timed_mutex> lock(central_cache_lock_);
+  typename StatMap::mapped_type& central_ref = map[stat_name];
+  if (!central_ref) {
+    central_ref = make();
+    num_stats_++;
+    name_bytes_ += name.size();
+    parent_.num_stats_created_++;
+  }
+  return central_ref;
+}
+
+ThreadLocalStoreImpl::SafeAllocData
+ThreadLocalStoreImpl::ScopeImpl::safeAlloc(const std::string& name) {
+  SafeAllocData alloc = parent_.safeAlloc(name);
+  if (&alloc.free_ == &parent_.heap_allocator_) {
+    num_overflow_stats_++;
+  }
+  return alloc;
+}
+
 Counter& ThreadLocalStoreImpl::ScopeImpl::counter(const std::string& name) {
   // Determine the final name based on the prefix and the passed name.
   std::string final_name = prefix_ + name;
 
+  // Both caches are keyed by the encoded name. The symbols of the tokens this thread has encoded
+  // before come from its own cache if TLS is initialized.
+  TlsCache* tls_cache = parent_.tlsCache();
+  const StatName stat_name = parent_.encode(final_name, tls_cache);
+
   // We now try to acquire a *reference* to the TLS cache shared pointer. This might remain null
   // if we don't have TLS initialized currently. The de-referenced pointer might be null if there
   // is no cache entry.
   CounterSharedPtr* tls_ref = nullptr;
-  if (!parent_.shutting_down_ && parent_.tls_) {
-    tls_ref = &parent_.tls_->getTyped<TlsCache>().scope_cache_[this].counters_[final_name];
+  if (tls_cache) {
+    tls_ref = &tls_cache->scope_cache_[this].counters_[stat_name];
   }
 
   // If we have a valid cache entry, return it.
@@ -138,21 +282,25 @@ Counter& ThreadLocalStoreImpl::ScopeImpl::counter(const std::string& name) {
     return **tls_ref;
   }
 
-  // We must now look in the central store so we must be locked. We grab a reference to the
-  // central store location. It might contain nothing. In this case, we allocate a new stat.
-  std::unique_lock<std::mutex> lock(parent_.lock_);
-  CounterSharedPtr& central_ref = central_cache_.counters_[final_name];
-  if (!central_ref) {
-    SafeAllocData alloc = parent_.safeAlloc(final_name);
-    std::vector<Tag> tags;
-    std::string tag_extracted_name = parent_.getTagsForName(final_name, tags);
-    central_ref.reset(
-        new CounterImpl(alloc.data_, alloc.free_, std::move(tag_extracted_name), std::move(tags)));
-  }
+  // We must now look in the central store of the scope, which is shared by all threads. It might
+  // not have the stat yet. In this case, we allocate a new stat.
+  CounterSharedPtr central_ref = findOrCreate(
+      central_cache_.counters_, stat_name, final_name, [this, &final_name]() -> CounterSharedPtr {
+        SafeAllocData alloc = safeAlloc(final_name);
+        std::vector<Tag> tags;
+        std::string tag_extracted_name = parent_.getTagsForName(final_name, tags);
+        if (parent_.isSharded(final_name)) {
+          return CounterSharedPtr{new ShardedCounterImpl(
+              alloc.data_, alloc.free_, std::move(tag_extracted_name), std::move(tags))};
+        }
+        return CounterSharedPtr{new CounterImpl(alloc.data_, alloc.free_,
+                                                std::move(tag_extracted_name), std::move(tags))};
+      });
 
   // If we have a TLS location to store or allocation into, do it.
   if (tls_ref) {
     *tls_ref = central_ref;
+    return **tls_ref;
   }
 
   // Finally we return the reference.
@@ -179,24 +327,25 @@ Gauge& ThreadLocalStoreImpl::ScopeImpl::gauge(const std::string& name) {
   // See comments in counter(). There is no super clean way (via templates or otherwise) to
   // share this code so I'm leaving it largely duplicated for now.
   std::string final_name = prefix_ + name;
+  TlsCache* tls_cache = parent_.tlsCache();
+  const StatName stat_name = parent_.encode(final_name, tls_cache);
   GaugeSharedPtr* tls_ref = nullptr;
-  if (!parent_.shutting_down_ && parent_.tls_) {
-    tls_ref = &parent_.tls_->getTyped<TlsCache>().scope_cache_[this].gauges_[final_name];
+  if (tls_cache) {
+    tls_ref = &tls_cache->scope_cache_[this].gauges_[stat_name];
   }
 
   if (tls_ref && *tls_ref) {
     return **tls_ref;
   }
 
-  std::unique_lock<std::mutex> lock(parent_.lock_);
-  GaugeSharedPtr& central_ref = central_cache_.gauges_[final_name];
-  if (!central_ref) {
-    SafeAllocData alloc = parent_.safeAlloc(final_name);
-    std::vector<Tag> tags;
-    std::string tag_extracted_name = parent_.getTagsForName(final_name, tags);
-    central_ref.reset(
-        new GaugeImpl(alloc.data_, alloc.free_, std::move(tag_extracted_name), std::move(tags)));
-  }
+  GaugeSharedPtr central_ref = findOrCreate(
+      central_cache_.gauges_, stat_name, final_name, [this, &final_name]() -> GaugeSharedPtr {
+        SafeAllocData alloc = safeAlloc(final_name);
+        std::vector<Tag> tags;
+        std::string tag_extracted_name = parent_.getTagsForName(final_name, tags);
+        return GaugeSharedPtr{new GaugeImpl(alloc.data_, alloc.free_,
+                                            std::move(tag_extracted_name), std::move(tags))};
+      });
 
   if (tls_ref) {
     *tls_ref = central_ref;
@@ -207,28 +356,33 @@ Gauge& ThreadLocalStoreImpl::ScopeImpl::gauge(const std::string& name) {
 
 Histogram& ThreadLocalStoreImpl::ScopeImpl::histogram(const std::string& name) {
   // See comments in counter(). There is no super clean way (via templates or otherwise) to
-  // share this code so I'm leaving it largely duplicated for now.
+  // share this code so I'm leaving it largely duplicated for now. Unlike counters and gauges, the
+  // thread local cache holds a histogram of the thread that the central one merges, or nothing at
+  // all if TLS is not initialized, in which case the central histogram records the value itself.
   std::string final_name = prefix_ + name;
-  HistogramSharedPtr* tls_ref = nullptr;
-  if (!parent_.shutting_down_ && parent_.tls_) {
-    tls_ref = &parent_.tls_->getTyped<TlsCache>().scope_cache_[this].histograms_[final_name];
+  TlsCache* tls_cache = parent_.tlsCache();
+  const StatName stat_name = parent_.encode(final_name, tls_cache);
+  ThreadLocalHistogramSharedPtr* tls_ref = nullptr;
+  if (tls_cache) {
+    tls_ref = &tls_cache->scope_cache_[this].histograms_[stat_name];
   }
 
   if (tls_ref && *tls_ref) {
     return **tls_ref;
   }
 
-  std::unique_lock<std::mutex> lock(parent_.lock_);
-  HistogramSharedPtr& central_ref = central_cache_.histograms_[final_name];
-  if (!central_ref) {
-    std::vector<Tag> tags;
-    std::string tag_extracted_name = parent_.getTagsForName(final_name, tags);
-    central_ref.reset(
-        new HistogramImpl(final_name, parent_, std::move(tag_extracted_name), std::move(tags)));
-  }
+  ParentHistogramImplSharedPtr central_ref =
+      findOrCreate(central_cache_.histograms_, stat_name, final_name,
+                   [this, &final_name]() -> ParentHistogramImplSharedPtr {
+                     std::vector<Tag> tags;
+                     std::string tag_extracted_name = parent_.getTagsForName(final_name, tags);
+                     return std::make_shared<ParentHistogramImpl>(
+                         final_name, parent_, std::move(tag_extracted_name), std::move(tags));
+                   });
 
   if (tls_ref) {
-    *tls_ref = central_ref;
+    *tls_ref = central_ref->createThreadLocal();
+    return **tls_ref;
   }
 
   return *central_ref;
@@ -5,13 +5,18 @@
 #include <cstdint>
 #include <list>
 #include <mutex>
+#include <shared_mutex>
 #include <string>
 #include <unordered_map>
 #include <unordered_set>
+#include <vector>
 
 #include "envoy/thread_local/thread_local.h"
 
+#include "common/stats/histogram_impl.h"
+#include "common/stats/sharded_counter_impl.h"
 #include "common/stats/stats_impl.h"
+#include "common/stats/symbol_table_impl.h"
 
 namespace Envoy {
 namespace Stats {
@@ -22,7 +27,9 @@ namespace Stats {
  * - Thread local per scope stat caching.
  * - Overallaping scopes with proper reference counting (2 scopes with the same name will point to
  *   the same backing stats).
- * - Scope deletion.
+ * - Scope deletion, optionally retaining the stats of deleted scopes for their final flushes.
+ * - Accounting of the stats of each scope, and of the stats created by the store.
+ * - Sharding of the counters that every worker increments.
  *
  * This implementation is complicated so here is a rough overview of the threading model.
  * - The store can be used before threading is initialized. This is needed during server init.
@@ -30,16 +37,31 @@ namespace Stats {
  *   thread.
  * - Scopes can be deleted from any thread, and they are in practice as scopes are likely to be
  *   shared across all worker threads.
- * - Per thread caches are checked, and if empty, they are populated from the central cache.
+ * - Per thread caches are checked, and if empty, they are populated from the central cache. Each
+ *   scope has a central cache of its own with a reader/writer lock, so threads filling their
+ *   caches only exclude each other while creating a stat in the same scope.
+ * - Both caches are keyed by the names of the stats as encoded by the symbol table of the store,
+ *   which are a few bytes each instead of the whole name. The per thread cache also keeps the
+ *   symbols of the tokens the thread has encoded, so that cache hits do not take a lock.
  * - Scopes are entirely owned by the caller. The store only keeps weak pointers.
  * - When a scope is destroyed, a cache flush operation is run on all threads to flush any cached
  *   data owned by the destroyed scope.
+ * - The central cache of a destroyed scope is released with the scope, unless the store retains
+ *   deleted scopes. It is then listed by counters(), gauges() and histograms() until the given
+ *   number of flushes completed, so that the sinks get the values the stats had when the scope
+ *   was deleted. Their allocator slots are released as soon as the retention ends.
  * - NOTE: It is theoretically possible that when a scope is deleted, it could be reallocated
  *         with the same address, and a cache flush operation could race and delete cache data
  *         for the new scope. This is extremely unlikely, and if it happens the cache will be
  *         repopulated on the next access.
- * - Since it's possible to have overlapping scopes, we de-dup stats when counters() or gauges() is
- *   called since these are very uncommon operations.
+ * - Since it's possible to have overlapping scopes, we de-dup stats when counters(), gauges() or
+ *   histograms() is called since these are very uncommon operations. Overlapping scopes do not
+ *   share the values of their histograms, so only those of one of the scopes are listed.
+ * - Histograms record into a histogram of the calling thread, held in the per thread cache, and
+ *   the parent histogram in the central cache merges the values of all threads when the store is
+ *   flushed. Sharded counters are shared by all threads like the other counters, but pick a
+ *   shard of the calling thread at every increment and fold the shards into their value when
+ *   they are latched.
  * - Though this implementation is designed to work with a fixed shared memory space, it will fall
  *   back to heap allocated stats if needed. NOTE: In this case, overlapping scopes will not share
  *   the same backing store. This is to keep things simple, it could be done in the future if
@@ -47,7 +69,12 @@ namespace Stats {
  */
 class ThreadLocalStoreImpl : public StoreRoot {
 public:
-  ThreadLocalStoreImpl(RawStatDataAllocator& alloc);
+  /**
+   * @param alloc supplies the allocator of the counters and gauges.
+   * @param deleted_scope_flushes supplies the number of flushes the stats of a deleted scope are
+   *        retained for, if any.
+   */
+  ThreadLocalStoreImpl(RawStatDataAllocator& alloc, uint32_t deleted_scope_flushes = 0);
   ~ThreadLocalStoreImpl();
 
   // Stats::Scope
@@ -64,21 +91,42 @@ public:
   // Stats::Store
   std::list<CounterSharedPtr> counters() const override;
   std::list<GaugeSharedPtr> gauges() const override;
+  std::list<ParentHistogramSharedPtr> histograms() const override;
+  std::list<ScopeStatsInfo> scopes() const override;
+  uint64_t numStatsCreated() const override { return num_stats_created_; }
 
   // Stats::StoreRoot
   void addSink(Sink& sink) override { timer_sinks_.push_back(sink); }
   void setTagExtractors(const std::vector<TagExtractorPtr>& tag_extractors) override {
     tag_extractors_ = &tag_extractors;
   }
+  void setShardedCounters(const std::vector<std::string>& names) override {
+    sharded_counters_ = names;
+  }
   void initializeThreading(Event::Dispatcher& main_thread_dispatcher,
                            ThreadLocal::Instance& tls) override;
   void shutdownThreading() override;
+  void onStatsFlushed() override;
+
+  // The default number of flushes that the server retains the stats of deleted scopes for.
+  static const uint32_t DEFAULT_DELETED_SCOPE_FLUSHES = 1;
 
 private:
   struct TlsCacheEntry {
-    std::unordered_map<std::string, CounterSharedPtr> counters_;
-    std::unordered_map<std::string, GaugeSharedPtr> gauges_;
-    std::unordered_map<std::string, HistogramSharedPtr> histograms_;
+    std::unordered_map<StatName, CounterSharedPtr, StatName::Hash> counters_;
+    std::unordered_map<StatName, GaugeSharedPtr, StatName::Hash> gauges_;
+    std::unordered_map<StatName, ThreadLocalHistogramSharedPtr, StatName::Hash> histograms_;
+  };
+
+  struct CentralCacheEntry {
+    std::unordered_map<StatName, CounterSharedPtr, StatName::Hash> counters_;
+    std::unordered_map<StatName, GaugeSharedPtr, StatName::Hash> gauges_;
+    std::unordered_map<StatName, ParentHistogramImplSharedPtr, StatName::Hash> histograms_;
+  };
+
+  struct SafeAllocData {
+    RawStatData& data_;
+    RawStatDataAllocator& free_;
   };
 
   struct ScopeImpl : public Scope {
@@ -95,36 +143,70 @@ private:
     Gauge& gauge(const std::string& name) override;
     Histogram& histogram(const std::string& name) override;
 
+    /**
+     * Find a stat in the central cache, or create it with make() if it is not there yet.
+     * @param stat_name supplies the encoded name of the stat.
+     * @param name supplies the name of the stat, which is accounted for if the stat is created.
+     */
+    template <class StatMap, class MakeStat>
+    typename StatMap::mapped_type findOrCreate(StatMap& map, const StatName& stat_name,
+                                               const std::string& name, MakeStat make);
+
+    /**
+     * Allocate the data of a counter or gauge created by findOrCreate(), accounting for the stats
+     * that overflow to the heap.
+     */
+    SafeAllocData safeAlloc(const std::string& name);
+
     ThreadLocalStoreImpl& parent_;
     const std::string prefix_;
-    TlsCacheEntry central_cache_;
+    mutable std::shared_timed_mutex central_cache_lock_;
+    CentralCacheEntry central_cache_;
+    // The accounting of the stats of the central cache, guarded by its lock.
+    uint64_t num_stats_{};
+    uint64_t num_overflow_stats_{};
+    uint64_t name_bytes_{};
   };
 
-  struct TlsCache : public ThreadLocal::ThreadLocalObject {
-    std::unordered_map<ScopeImpl*, TlsCacheEntry> scope_cache_;
+  /**
+   * The central cache of a deleted scope that is retained until flushes_ more flushes completed.
+   */
+  struct RetainedCacheEntry {
+    CentralCacheEntry central_cache_;
+    uint32_t flushes_;
   };
 
-  struct SafeAllocData {
-    RawStatData& data_;
-    RawStatDataAllocator& free_;
+  struct TlsCache : public ThreadLocal::ThreadLocalObject {
+    std::unordered_map<ScopeImpl*, TlsCacheEntry> scope_cache_;
+    SymbolCache symbols_;
   };
 
   std::string getTagsForName(const std::string& name, std::vector<Tag>& tags);
+  bool isSharded(const std::string& name) const;
   void clearScopeFromCaches(ScopeImpl* scope);
   void releaseScopeCrossThread(ScopeImpl* scope);
   SafeAllocData safeAlloc(const std::string& name);
+  TlsCache* tlsCache();
+  StatName encode(const std::string& name, TlsCache* tls_cache);
 
   RawStatDataAllocator& alloc_;
+  // Declared before the default scope, which uses it to create its first stat.
+  SymbolTable symbol_table_;
   Event::Dispatcher* main_thread_dispatcher_{};
   ThreadLocal::SlotPtr tls_;
   mutable std::mutex lock_;
   std::unordered_set<ScopeImpl*> scopes_;
+  const uint32_t deleted_scope_flushes_;
   ScopePtr default_scope_;
   std::list<std::reference_wrapper<Sink>> timer_sinks_;
   const std::vector<TagExtractorPtr>* tag_extractors_{};
+  std::vector<std::string> sharded_counters_;
   std::atomic<bool> shutting_down_{};
   Counter& num_last_resort_stats_;
   HeapRawStatDataAllocator heap_allocator_;
+  std::atomic<uint64_t> num_stats_created_{};
+  // Declared after the heap allocator, which some of the retained stats may have to be freed to.
+  std::list<RetainedCacheEntry> retained_caches_;
 };
 
 } // namespace Stats
@@ -3,6 +3,8 @@
 #include <atomic>
 #include <cstdint>
 #include <list>
+#include <memory>
+#include <vector>
 
 #include "envoy/event/dispatcher.h"
 
@@ -38,7 +40,11 @@ SlotPtr InstanceImpl::allocateSlot() {
 }
 
 ThreadLocalObjectSharedPtr InstanceImpl::SlotImpl::get() {
-  ASSERT(thread_local_data_.data_.size() > index_);
+  // Threads that are not registered, e.g. the threads that build clusters at startup, have no
+  // objects.
+  if (thread_local_data_.data_.size() <= index_) {
+    return nullptr;
+  }
   return thread_local_data_.data_[index_];
 }
 
@@ -83,22 +89,31 @@ void InstanceImpl::runOnAllThreads(Event::PostCb cb) {
   ASSERT(std::this_thread::get_id() == main_thread_id_);
   ASSERT(!shutdown_);
 
-  for (Event::Dispatcher& dispatcher : registered_threads_) {
-    dispatcher.post(cb);
-  }
+  postToAllThreads([cb](Event::Dispatcher&) -> void { cb(); });
 
   // Handle main thread.
   cb();
 }
 
+void InstanceImpl::postToAllThreads(ThreadUpdateCb cb) {
+  if (batch_depth_ > 0) {
+    batch_.push_back(cb);
+    return;
+  }
+
+  for (Event::Dispatcher& dispatcher : registered_threads_) {
+    dispatcher.post([cb, &dispatcher]() -> void { cb(dispatcher); });
+  }
+}
+
 void InstanceImpl::SlotImpl::set(InitializeCb cb) {
   ASSERT(std::this_thread::get_id() == parent_.main_thread_id_);
   ASSERT(!parent_.shutdown_);
 
-  for (Event::Dispatcher& dispatcher : parent_.registered_threads_) {
-    const uint32_t index = index_;
-    dispatcher.post([index, cb, &dispatcher]() -> void { setThreadLocal(index, cb(dispatcher)); });
-  }
+  const uint32_t index = index_;
+  parent_.postToAllThreads([index, cb](Event::Dispatcher& dispatcher) -> void {
+    setThreadLocal(index, cb(dispatcher));
+  });
 
   // Handle main thread.
   setThreadLocal(index_, cb(*parent_.main_thread_dispatcher_));
@@ -112,6 +127,41 @@ void InstanceImpl::setThreadLocal(uint32_t index, ThreadLocalObjectSharedPtr obj
   thread_local_data_.data_[index] = object;
 }
 
+void InstanceImpl::beginBatch() {
+  ASSERT(std::this_thread::get_id() == main_thread_id_);
+  batch_depth_++;
+}
+
+void InstanceImpl::flushBatch() {
+  ASSERT(std::this_thread::get_id() == main_thread_id_);
+
+  // The threads are not posted to during shutdown, see removeSlot().
+  if (batch_.empty() || shutdown_) {
+    batch_.clear();
+    return;
+  }
+
+  // All the threads share the one copy of the updates.
+  std::shared_ptr<const std::vector<ThreadUpdateCb>> batch =
+      std::make_shared<const std::vector<ThreadUpdateCb>>(std::move(batch_));
+  batch_.clear();
+  for (Event::Dispatcher& dispatcher : registered_threads_) {
+    dispatcher.post([batch, &dispatcher]() -> void {
+      for (const ThreadUpdateCb& cb : *batch) {
+        cb(dispatcher);
+      }
+    });
+  }
+}
+
+void InstanceImpl::endBatch() {
+  ASSERT(std::this_thread::get_id() == main_thread_id_);
+  ASSERT(batch_depth_ > 0);
+  if (--batch_depth_ == 0) {
+    flushBatch();
+  }
+}
+
 void InstanceImpl::shutdownGlobalThreading() {
   ASSERT(std::this_thread::get_id() == main_thread_id_);
   ASSERT(!shutdown_);
@@ -2,6 +2,7 @@
 
 #include <atomic>
 #include <cstdint>
+#include <functional>
 #include <list>
 #include <vector>
 
@@ -26,6 +27,9 @@ public:
   void shutdownGlobalThreading() override;
   void shutdownThread() override;
   Event::Dispatcher& dispatcher() override;
+  void beginBatch() override;
+  void flushBatch() override;
+  void endBatch() override;
 
 private:
   struct SlotImpl : public Slot {
@@ -46,8 +50,12 @@ private:
     std::vector<ThreadLocalObjectSharedPtr> data_;
   };
 
+  // An update run on each registered thread, with the dispatcher of the thread.
+  typedef std::function<void(Event::Dispatcher& dispatcher)> ThreadUpdateCb;
+
   void removeSlot(SlotImpl& slot);
   void runOnAllThreads(Event::PostCb cb);
+  void postToAllThreads(ThreadUpdateCb cb);
   static void setThreadLocal(uint32_t index, ThreadLocalObjectSharedPtr object);
 
   static thread_local ThreadLocalData thread_local_data_;
@@ -56,6 +64,8 @@ private:
   std::thread::id main_thread_id_;
   Event::Dispatcher* main_thread_dispatcher_{};
   std::atomic<bool> shutdown_{};
+  uint32_t batch_depth_{};
+  std::vector<ThreadUpdateCb> batch_;
 };
 
 } // namespace ThreadLocal
@@ -1,5 +1,7 @@
 #include "common/tracing/http_tracer_impl.h"
 
+#include <algorithm>
+#include <chrono>
 #include <string>
 
 #include "common/access_log/access_log_formatter.h"
@@ -18,6 +20,13 @@
 namespace Envoy {
 namespace Tracing {
 
+namespace {
+
+const Runtime::Key CLIENT_ENABLED_KEY("tracing.client_enabled");
+const Runtime::Key GLOBAL_ENABLED_KEY("tracing.global_enabled");
+
+} // namespace
+
 // TODO(mattklein123) PERF: Avoid string creations/copies in this entire file.
 static std::string buildResponseCode(const RequestInfo::RequestInfo& info) {
   return info.responseCode().valid() ? std::to_string(info.responseCode().value()) : "0";
@@ -45,8 +54,8 @@ void HttpTracerUtility::mutateHeaders(Http::HeaderMap& request_headers, Runtime:
     return;
   }
 
-  // TODO PERF: Avoid copy.
-  std::string x_request_id = request_headers.RequestId()->value().c_str();
+  const Http::HeaderString& request_id = request_headers.RequestId()->value();
+  const absl::string_view x_request_id(request_id.c_str(), request_id.size());
 
   uint16_t result;
   // Skip if x-request-id is corrupted.
@@ -55,22 +64,80 @@ void HttpTracerUtility::mutateHeaders(Http::HeaderMap& request_headers, Runtime:
   }
 
   // Do not apply tracing transformations if we are currently tracing.
-  if (UuidTraceStatus::NoTrace == UuidUtils::isTraceableUuid(x_request_id)) {
+  const UuidTraceStatus trace_status = UuidUtils::isTraceableUuid(x_request_id);
+  UuidTraceStatus new_trace_status = trace_status;
+  if (UuidTraceStatus::NoTrace == trace_status) {
     if (request_headers.ClientTraceId() &&
-        runtime.snapshot().featureEnabled("tracing.client_enabled", 100)) {
-      UuidUtils::setTraceableUuid(x_request_id, UuidTraceStatus::Client);
+        runtime.snapshot().featureEnabled(CLIENT_ENABLED_KEY, 100)) {
+      new_trace_status = UuidTraceStatus::Client;
     } else if (request_headers.EnvoyForceTrace()) {
-      UuidUtils::setTraceableUuid(x_request_id, UuidTraceStatus::Forced);
+      new_trace_status = UuidTraceStatus::Forced;
     } else if (runtime.snapshot().featureEnabled("tracing.random_sampling", 10000, result, 10000)) {
-      UuidUtils::setTraceableUuid(x_request_id, UuidTraceStatus::Sampled);
+      new_trace_status = UuidTraceStatus::Sampled;
     }
   }
 
-  if (!runtime.snapshot().featureEnabled("tracing.global_enabled", 100, result)) {
-    UuidUtils::setTraceableUuid(x_request_id, UuidTraceStatus::NoTrace);
+  if (!runtime.snapshot().featureEnabled(GLOBAL_ENABLED_KEY, 100, result)) {
+    new_trace_status = UuidTraceStatus::NoTrace;
+  }
+
+  // The header is only copied for the requests whose trace status changes.
+  if (new_trace_status != trace_status) {
+    std::string new_request_id(x_request_id.data(), x_request_id.size());
+    UuidUtils::setTraceableUuid(new_request_id, new_trace_status);
+    request_headers.RequestId()->value(new_request_id);
   }
+}
+
+bool HttpTracerUtility::isRandomlySampled(const Http::HeaderMap& request_headers) {
+  if (!request_headers.RequestId()) {
+    return false;
+  }
+
+  const Http::HeaderString& request_id = request_headers.RequestId()->value();
+  return UuidUtils::isTraceableUuid(absl::string_view(request_id.c_str(), request_id.size())) ==
+         UuidTraceStatus::Sampled;
+}
 
+bool HttpTracerUtility::limitSampling(Http::HeaderMap& request_headers,
+                                      SampleRateLimiter& limiter, const std::string& key,
+                                      uint64_t max_per_second, MonotonicTime now) {
+  if (!isRandomlySampled(request_headers) || limiter.allow(key, max_per_second, now)) {
+    return false;
+  }
+
+  std::string x_request_id = request_headers.RequestId()->value().c_str();
+  UuidUtils::setTraceableUuid(x_request_id, UuidTraceStatus::NoTrace);
   request_headers.RequestId()->value(x_request_id);
+  return true;
+}
+
+constexpr size_t SampleRateLimiter::MAX_KEYS;
+
+bool SampleRateLimiter::allow(const std::string& key, uint64_t max_per_second, MonotonicTime now) {
+  auto it = buckets_.find(key);
+  if (it == buckets_.end()) {
+    // New buckets start full. The overflow bucket is only created once.
+    static const std::string overflow_key;
+    const Bucket bucket{static_cast<double>(max_per_second), now};
+    it = buckets_.emplace(buckets_.size() < MAX_KEYS ? key : overflow_key, bucket).first;
+  }
+
+  Bucket& bucket = it->second;
+  const double elapsed = std::chrono::duration<double>(now - bucket.last_refill_).count();
+  bucket.samples_ =
+      std::min<double>(max_per_second, bucket.samples_ + std::max(elapsed, 0.0) * max_per_second);
+  bucket.last_refill_ = now;
+  if (bucket.samples_ < 1) {
+    return false;
+  }
+  bucket.samples_--;
+  return true;
+}
+
+SampleRateLimiter& SampleRateLimiter::threadLocal() {
+  static thread_local SampleRateLimiter limiter;
+  return limiter;
 }
 
 const std::string HttpTracerUtility::INGRESS_OPERATION = "ingress";
@@ -98,9 +165,9 @@ Decision HttpTracerUtility::isTracing(const RequestInfo::RequestInfo& request_in
     return {Reason::NotTraceableRequestId, false};
   }
 
-  // TODO PERF: Avoid copy.
+  const Http::HeaderString& request_id = request_headers.RequestId()->value();
   UuidTraceStatus trace_status =
-      UuidUtils::isTraceableUuid(request_headers.RequestId()->value().c_str());
+      UuidUtils::isTraceableUuid(absl::string_view(request_id.c_str(), request_id.size()));
 
   switch (trace_status) {
   case UuidTraceStatus::Client:
@@ -1,7 +1,9 @@
 #pragma once
 
 #include <string>
+#include <unordered_map>
 
+#include "envoy/common/time.h"
 #include "envoy/local_info/local_info.h"
 #include "envoy/runtime/runtime.h"
 #include "envoy/thread_local/thread_local.h"
@@ -74,6 +76,40 @@ public:
 
 typedef ConstSingleton<TracingTagValues> Tags;
 
+/**
+ * Per worker token buckets that bound the rate at which requests are sampled for tracing. Each key,
+ * such as the cluster a request is routed to, has its own bucket, which holds up to a second's
+ * worth of samples.
+ */
+class SampleRateLimiter {
+public:
+  /**
+   * Take a sample from the bucket of a key.
+   * @param key supplies the key of the bucket.
+   * @param max_per_second supplies the rate at which the bucket refills.
+   * @param now supplies the current time.
+   * @return true if the bucket had a sample left.
+   */
+  bool allow(const std::string& key, uint64_t max_per_second, MonotonicTime now);
+
+  /**
+   * @return SampleRateLimiter& the calling thread's limiter.
+   */
+  static SampleRateLimiter& threadLocal();
+
+  // Keys beyond this many, which only routes that take the cluster from a request header can
+  // produce, share a single bucket.
+  static constexpr size_t MAX_KEYS = 1024;
+
+private:
+  struct Bucket {
+    double samples_;
+    MonotonicTime last_refill_;
+  };
+
+  std::unordered_map<std::string, Bucket> buckets_;
+};
+
 class HttpTracerUtility {
 public:
   /**
@@ -97,6 +133,24 @@ public:
    */
   static void mutateHeaders(Http::HeaderMap& request_headers, Runtime::Loader& runtime);
 
+  /**
+   * @return true if the x-request-id of the request marks it as sampled at random.
+   */
+  static bool isRandomlySampled(const Http::HeaderMap& request_headers);
+
+  /**
+   * Stop tracing a request that was sampled at random if the limiter has no sample left for it.
+   * Requests that are traced for any other reason are left alone.
+   * @param request_headers supplies the request headers, whose x-request-id is updated.
+   * @param limiter supplies the limiter.
+   * @param key supplies the key of the limiter bucket to take the sample from.
+   * @param max_per_second supplies the number of requests per second the key may sample.
+   * @param now supplies the current time.
+   * @return true if the request is no longer traced.
+   */
+  static bool limitSampling(Http::HeaderMap& request_headers, SampleRateLimiter& limiter,
+                            const std::string& key, uint64_t max_per_second, MonotonicTime now);
+
   /**
    * 1) Fill in span tags based on the response headers.
    * 2) Finish active span.
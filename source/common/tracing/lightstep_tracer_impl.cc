@@ -1,12 +1,18 @@
 #include "common/tracing/lightstep_tracer_impl.h"
 
+#include <algorithm>
 #include <chrono>
+#include <condition_variable>
 #include <cstdint>
 #include <memory>
+#include <mutex>
 #include <string>
+#include <vector>
 
+#include "common/buffer/buffer_impl.h"
 #include "common/buffer/zero_copy_input_stream_impl.h"
 #include "common/common/base64.h"
+#include "common/common/thread.h"
 #include "common/grpc/common.h"
 #include "common/http/message_impl.h"
 #include "common/tracing/http_tracer_impl.h"
@@ -36,13 +42,182 @@ public:
 };
 } // namespace
 
-LightStepDriver::LightStepTransporter::LightStepTransporter(LightStepDriver& driver)
-    : driver_(driver) {}
+/**
+ * Merges the reports queued by the transporters of the workers into batches and serializes them on
+ * a dedicated thread. One batch is in flight at a time, so the reports queued while a batch is sent
+ * go out together in the next one. A batch is sent by the first transporter whose report it
+ * carries, and its response is posted to each of those transporters. The transporters share the
+ * reporter, as they may be destroyed on the workers after the driver.
+ */
+class LightStepDriver::LightStepReporter {
+public:
+  static std::shared_ptr<LightStepReporter> create() {
+    std::shared_ptr<LightStepReporter> reporter = std::make_shared<LightStepReporter>();
+    reporter->self_ = reporter;
+    reporter->thread_.reset(new Thread::Thread([reporter_ptr = reporter.get()]() -> void {
+      reporter_ptr->threadRoutine();
+    }));
+    return reporter;
+  }
+
+  ~LightStepReporter() {
+    {
+      std::unique_lock<std::mutex> lock(lock_);
+      stop_ = true;
+    }
+    cv_.notify_one();
+    thread_->join();
+  }
+
+  /**
+   * Queue the report of a transporter. Called on the dispatcher of the transporter.
+   * @param transporter supplies the transporter.
+   * @param request supplies the report, which must not change until the report is completed.
+   */
+  void report(const TransporterHandleSharedPtr& transporter, const Protobuf::Message& request) {
+    {
+      std::unique_lock<std::mutex> lock(lock_);
+      pending_.emplace_back(transporter, &request);
+    }
+    cv_.notify_one();
+  }
+
+  /**
+   * Drop the queued report of a transporter that is destroyed, and stop posting to it. Called on
+   * the dispatcher of the transporter.
+   */
+  void cancel(TransporterHandle& transporter) {
+    std::unique_lock<std::mutex> lock(lock_);
+    transporter.transporter_ = nullptr;
+    pending_.erase(std::remove_if(pending_.begin(), pending_.end(),
+                                  [&transporter](const PendingReport& report) -> bool {
+                                    return report.first.get() == &transporter;
+                                  }),
+                   pending_.end());
+  }
+
+  /**
+   * Complete a batch. Called on the dispatcher of the transporter that sent it.
+   * @param reports supplies the transporters whose reports are in the batch.
+   * @param response supplies the serialized collector response, or nullptr if the batch failed.
+   */
+  void complete(const std::vector<TransporterHandleSharedPtr>& reports,
+                const std::shared_ptr<const std::string>& response) {
+    {
+      std::unique_lock<std::mutex> lock(lock_);
+      for (const TransporterHandleSharedPtr& transporter : reports) {
+        if (transporter->transporter_ == nullptr) {
+          continue;
+        }
+        transporter->dispatcher_.post([transporter, response]() -> void {
+          if (transporter->transporter_ != nullptr) {
+            transporter->transporter_->onReportComplete(response);
+          }
+        });
+      }
+      batch_in_flight_ = false;
+    }
+    cv_.notify_one();
+  }
+
+private:
+  typedef std::pair<TransporterHandleSharedPtr, const Protobuf::Message*> PendingReport;
+
+  void threadRoutine() {
+    while (true) {
+      std::unique_ptr<Protobuf::Message> batch;
+      std::vector<TransporterHandleSharedPtr> reports;
+      {
+        std::unique_lock<std::mutex> lock(lock_);
+        cv_.wait(lock, [this]() -> bool {
+          return stop_ || (!batch_in_flight_ && !pending_.empty());
+        });
+        if (stop_) {
+          return;
+        }
+
+        // The reports are owned by the workers, so they are only read under the lock.
+        batch = mergePending();
+        for (const PendingReport& report : pending_) {
+          reports.push_back(report.first);
+        }
+        pending_.clear();
+        batch_in_flight_ = true;
+      }
+
+      std::shared_ptr<Buffer::Instance> body = Grpc::Common::serializeBody(*batch);
+
+      std::unique_lock<std::mutex> lock(lock_);
+      auto sender = std::find_if(reports.begin(), reports.end(),
+                                 [](const TransporterHandleSharedPtr& transporter) -> bool {
+                                   return transporter->transporter_ != nullptr;
+                                 });
+      if (sender == reports.end()) {
+        batch_in_flight_ = false;
+        continue;
+      }
+
+      TransporterHandleSharedPtr transporter = *sender;
+      std::weak_ptr<LightStepReporter> weak_self = self_;
+      transporter->dispatcher_.post([weak_self, transporter, body, reports]() mutable -> void {
+        if (transporter->transporter_ != nullptr) {
+          transporter->transporter_->sendBatch(*body, std::move(reports));
+          return;
+        }
+        std::shared_ptr<LightStepReporter> self = weak_self.lock();
+        if (self != nullptr) {
+          self->complete(reports, nullptr);
+        }
+      });
+    }
+  }
+
+  // Merges the spans of the pending reports into a copy of the first one. The other fields of a
+  // report describe the reporter and are the same for all the workers, but for the internal metrics
+  // of the recorder, which are only kept for the first one.
+  std::unique_ptr<Protobuf::Message> mergePending() {
+    const Protobuf::Message& first = *pending_.front().second;
+    std::unique_ptr<Protobuf::Message> batch(first.New());
+    batch->CopyFrom(first);
+
+    const Protobuf::FieldDescriptor* spans = first.GetDescriptor()->FindFieldByName("spans");
+    const Protobuf::Reflection* reflection = first.GetReflection();
+    for (size_t i = 1; i < pending_.size(); i++) {
+      const Protobuf::Message& request = *pending_[i].second;
+      for (int j = 0; j < reflection->FieldSize(request, spans); j++) {
+        reflection->AddMessage(batch.get(), spans)
+            ->CopyFrom(reflection->GetRepeatedMessage(request, spans, j));
+      }
+    }
+
+    return batch;
+  }
+
+  std::weak_ptr<LightStepReporter> self_;
+  std::mutex lock_;
+  std::condition_variable cv_;
+  std::vector<PendingReport> pending_;
+  bool batch_in_flight_{};
+  bool stop_{};
+  Thread::ThreadPtr thread_;
+};
+
+LightStepDriver::LightStepTransporter::LightStepTransporter(LightStepDriver& driver,
+                                                            Event::Dispatcher& dispatcher)
+    : driver_(driver), reporter_(driver.reporter_),
+      handle_(std::make_shared<TransporterHandle>(*this, dispatcher)) {}
 
 LightStepDriver::LightStepTransporter::~LightStepTransporter() {
   if (active_request_ != nullptr) {
     active_request_->cancel();
   }
+
+  if (reporter_ != nullptr) {
+    if (!batch_reports_.empty()) {
+      completeBatch(nullptr);
+    }
+    reporter_->cancel(*handle_);
+  }
 }
 
 void LightStepDriver::LightStepTransporter::Send(const Protobuf::Message& request,
@@ -52,10 +227,29 @@ void LightStepDriver::LightStepTransporter::Send(const Protobuf::Message& reques
   active_callback_ = &callback;
   active_response_ = &response;
 
+  if (reporter_ != nullptr) {
+    reporter_->report(handle_, request);
+    return;
+  }
+
+  sendMessage(Grpc::Common::serializeBody(request));
+}
+
+void LightStepDriver::LightStepTransporter::sendBatch(
+    Buffer::Instance& body, std::vector<TransporterHandleSharedPtr>&& reports) {
+  batch_reports_ = std::move(reports);
+  driver_.tracerStats().reports_batched_.add(batch_reports_.size());
+
+  Buffer::InstancePtr message_body{new Buffer::OwnedImpl()};
+  message_body->move(body);
+  sendMessage(std::move(message_body));
+}
+
+void LightStepDriver::LightStepTransporter::sendMessage(Buffer::InstancePtr&& body) {
   Http::MessagePtr message =
       Grpc::Common::prepareHeaders(driver_.cluster()->name(), lightstep::CollectorServiceFullName(),
                                    lightstep::CollectorMethodName());
-  message->body() = Grpc::Common::serializeBody(request);
+  message->body() = std::move(body);
 
   const uint64_t timeout =
       driver_.runtime().snapshot().getInteger("tracing.lightstep.request_timeout", 5000U);
@@ -64,6 +258,22 @@ void LightStepDriver::LightStepTransporter::Send(const Protobuf::Message& reques
                         .send(std::move(message), *this, std::chrono::milliseconds(timeout));
 }
 
+void LightStepDriver::LightStepTransporter::completeBatch(
+    const std::shared_ptr<const std::string>& response) {
+  std::vector<TransporterHandleSharedPtr> reports;
+  reports.swap(batch_reports_);
+  reporter_->complete(reports, response);
+}
+
+void LightStepDriver::LightStepTransporter::onReportComplete(
+    const std::shared_ptr<const std::string>& response) {
+  if (response != nullptr && active_response_->ParseFromString(*response)) {
+    active_callback_->OnSuccess();
+  } else {
+    active_callback_->OnFailure(std::make_error_code(std::errc::network_down));
+  }
+}
+
 void LightStepDriver::LightStepTransporter::onSuccess(Http::MessagePtr&& response) {
   try {
     active_request_ = nullptr;
@@ -74,6 +284,11 @@ void LightStepDriver::LightStepTransporter::onSuccess(Http::MessagePtr&& respons
     // http://www.grpc.io/docs/guides/wire.html
     // First 5 bytes contain the message header.
     response->body()->drain(5);
+    if (reporter_ != nullptr) {
+      completeBatch(std::make_shared<const std::string>(response->bodyAsString()));
+      return;
+    }
+
     Buffer::ZeroCopyInputStreamImpl stream{std::move(response->body())};
     if (!active_response_->ParseFromZeroCopyStream(&stream)) {
       throw EnvoyException("Failed to parse LightStep collector response");
@@ -82,6 +297,10 @@ void LightStepDriver::LightStepTransporter::onSuccess(Http::MessagePtr&& respons
   } catch (const Grpc::Exception& ex) {
     Grpc::Common::chargeStat(*driver_.cluster(), lightstep::CollectorServiceFullName(),
                              lightstep::CollectorMethodName(), false);
+    if (reporter_ != nullptr) {
+      completeBatch(nullptr);
+      return;
+    }
     active_callback_->OnFailure(std::make_error_code(std::errc::network_down));
   }
 }
@@ -90,6 +309,10 @@ void LightStepDriver::LightStepTransporter::onFailure(Http::AsyncClient::Failure
   active_request_ = nullptr;
   Grpc::Common::chargeStat(*driver_.cluster(), lightstep::CollectorServiceFullName(),
                            lightstep::CollectorMethodName(), false);
+  if (reporter_ != nullptr) {
+    completeBatch(nullptr);
+    return;
+  }
   active_callback_->OnFailure(std::make_error_code(std::errc::network_down));
 }
 
@@ -142,6 +365,10 @@ LightStepDriver::LightStepDriver(const Json::Object& config,
         fmt::format("{} collector cluster must support http2 for gRPC calls", cluster_->name()));
   }
 
+  if (config.getBoolean("reporting_thread", false)) {
+    reporter_ = LightStepReporter::create();
+  }
+
   tls_->set([this](Event::Dispatcher& dispatcher) -> ThreadLocal::ThreadLocalObjectSharedPtr {
     lightstep::LightStepTracerOptions tls_options;
     tls_options.access_token = options_->access_token;
@@ -152,7 +379,7 @@ LightStepDriver::LightStepDriver(const Json::Object& config,
     tls_options.max_buffered_spans = std::function<size_t()>{
         [this] { return runtime_.snapshot().getInteger("tracing.lightstep.min_flush_spans", 5U); }};
     tls_options.metrics_observer.reset(new LightStepMetricsObserver{*this});
-    tls_options.transporter.reset(new LightStepTransporter{*this});
+    tls_options.transporter.reset(new LightStepTransporter{*this, dispatcher});
     std::shared_ptr<lightstep::LightStepTracer> tracer =
         lightstep::MakeLightStepTracer(std::move(tls_options));
 
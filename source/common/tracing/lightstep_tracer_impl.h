@@ -3,7 +3,10 @@
 #include <cstdint>
 #include <memory>
 #include <string>
+#include <vector>
 
+#include "envoy/buffer/buffer.h"
+#include "envoy/event/dispatcher.h"
 #include "envoy/runtime/runtime.h"
 #include "envoy/thread_local/thread_local.h"
 #include "envoy/tracing/http_tracer.h"
@@ -25,7 +28,8 @@ namespace Tracing {
 
 #define LIGHTSTEP_TRACER_STATS(COUNTER)                                                            \
   COUNTER(spans_sent)                                                                              \
-  COUNTER(timer_flushed)
+  COUNTER(timer_flushed)                                                                           \
+  COUNTER(reports_batched)
 
 struct LightstepTracerStats {
   LIGHTSTEP_TRACER_STATS(GENERATE_COUNTER_STRUCT)
@@ -36,6 +40,10 @@ struct LightstepTracerStats {
  * application trace data.
  *
  * LightStepSink is for flushing data to LightStep collectors.
+ *
+ * With reporting_thread set, the reports of the workers are not serialized on the workers. They
+ * are handed to a dedicated reporting thread, which merges the reports queued by all workers into
+ * one batch, serializes it, and has one of the workers send it.
  */
 class LightStepDriver : public OpenTracingDriver {
 public:
@@ -54,12 +62,43 @@ public:
   PropagationMode propagationMode() const override { return propagation_mode_; }
 
 private:
+  class LightStepTransporter;
+  class LightStepReporter;
+
+  /**
+   * Refers to a transporter from the reporting thread. transporter_ is reset under the lock of the
+   * reporter as the transporter is destroyed, and dispatcher_ is only posted to while it is set.
+   */
+  struct TransporterHandle {
+    TransporterHandle(LightStepTransporter& transporter, Event::Dispatcher& dispatcher)
+        : transporter_(&transporter), dispatcher_(dispatcher) {}
+
+    LightStepTransporter* transporter_;
+    Event::Dispatcher& dispatcher_;
+  };
+
+  typedef std::shared_ptr<TransporterHandle> TransporterHandleSharedPtr;
+
   class LightStepTransporter : public lightstep::AsyncTransporter, Http::AsyncClient::Callbacks {
   public:
-    explicit LightStepTransporter(LightStepDriver& driver);
+    LightStepTransporter(LightStepDriver& driver, Event::Dispatcher& dispatcher);
 
     ~LightStepTransporter();
 
+    /**
+     * Send a batch serialized by the reporting thread. Called on the dispatcher of the transporter.
+     * @param body supplies the serialized batch.
+     * @param reports supplies the transporters whose reports are in the batch.
+     */
+    void sendBatch(Buffer::Instance& body, std::vector<TransporterHandleSharedPtr>&& reports);
+
+    /**
+     * Complete the report of this transporter that was sent in a batch. Called on the dispatcher
+     * of the transporter.
+     * @param response supplies the serialized collector response, or nullptr if the batch failed.
+     */
+    void onReportComplete(const std::shared_ptr<const std::string>& response);
+
     // lightstep::AsyncTransporter
     void Send(const Protobuf::Message& request, Protobuf::Message& response,
               lightstep::AsyncTransporter::Callback& callback) override;
@@ -69,10 +108,17 @@ private:
     void onFailure(Http::AsyncClient::FailureReason) override;
 
   private:
+    void sendMessage(Buffer::InstancePtr&& body);
+    void completeBatch(const std::shared_ptr<const std::string>& response);
+
     Http::AsyncClient::Request* active_request_ = nullptr;
     lightstep::AsyncTransporter::Callback* active_callback_ = nullptr;
     Protobuf::Message* active_response_ = nullptr;
     LightStepDriver& driver_;
+    std::shared_ptr<LightStepReporter> reporter_;
+    TransporterHandleSharedPtr handle_;
+    // The transporters whose reports are in the batch this transporter sends.
+    std::vector<TransporterHandleSharedPtr> batch_reports_;
   };
 
   class LightStepMetricsObserver : public ::lightstep::MetricsObserver {
@@ -107,6 +153,7 @@ private:
   Runtime::Loader& runtime_;
   std::unique_ptr<lightstep::LightStepTracerOptions> options_;
   const PropagationMode propagation_mode_;
+  std::shared_ptr<LightStepReporter> reporter_;
 };
 
 } // Tracing
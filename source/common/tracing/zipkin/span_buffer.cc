@@ -1,33 +1,43 @@
 #include "common/tracing/zipkin/span_buffer.h"
 
+#include "common/common/assert.h"
+#include "common/tracing/zipkin/span_proto_encoder.h"
+
 namespace Envoy {
 namespace Zipkin {
 
-// TODO(fabolive): Need to avoid the copy to improve performance.
 bool SpanBuffer::addSpan(const Span& span) {
-  if (span_buffer_.size() == span_buffer_.capacity()) {
+  if (pending_spans_ == max_spans_) {
     // Buffer full
     return false;
   }
-  span_buffer_.push_back(std::move(span));
+
+  if (version_ == CollectorEndpointVersion::HTTP_PROTO) {
+    SpanProtoEncoder::appendSpan(span, encoded_spans_);
+  } else {
+    if (pending_spans_ != 0) {
+      encoded_spans_ += ",";
+    }
+    encoded_spans_ += span.toJson();
+  }
+  pending_spans_++;
 
   return true;
 }
 
-std::string SpanBuffer::toStringifiedJsonArray() {
-  std::string stringified_json_array = "[";
-
-  if (pendingSpans()) {
-    stringified_json_array += span_buffer_[0].toJson();
-    const uint64_t size = span_buffer_.size();
-    for (uint64_t i = 1; i < size; i++) {
-      stringified_json_array += ",";
-      stringified_json_array += span_buffer_[i].toJson();
-    }
+void SpanBuffer::serialize(Buffer::Instance& output) {
+  if (version_ == CollectorEndpointVersion::HTTP_PROTO) {
+    output.add(encoded_spans_);
+  } else {
+    output.add("[", 1);
+    output.add(encoded_spans_);
+    output.add("]", 1);
   }
-  stringified_json_array += "]";
+}
 
-  return stringified_json_array;
+std::string SpanBuffer::toStringifiedJsonArray() {
+  ASSERT(version_ == CollectorEndpointVersion::HTTP_JSON_V1);
+  return "[" + encoded_spans_ + "]";
 }
 } // namespace Zipkin
 } // namespace Envoy
@@ -1,35 +1,56 @@
 #pragma once
 
+#include "envoy/buffer/buffer.h"
+
 #include "common/tracing/zipkin/zipkin_core_types.h"
 
 namespace Envoy {
 namespace Zipkin {
 
+/**
+ * Encodings of the spans sent to a Zipkin collector.
+ */
+enum class CollectorEndpointVersion {
+  // A JSON array of v1 spans, sent to /api/v1/spans.
+  HTTP_JSON_V1,
+  // A zipkin.proto3.ListOfSpans of v2 spans, sent to /api/v2/spans.
+  HTTP_PROTO,
+};
+
 /**
  * This class implements a simple buffer to store Zipkin tracing spans
- * prior to flushing them.
+ * prior to flushing them. Spans are encoded as they are added, into storage that is kept across
+ * flushes, so that a flush only has to copy the encoded spans into the request body.
  */
 class SpanBuffer {
 public:
   /**
    * Constructor that creates an empty buffer. Space needs to be allocated by invoking
    * the method allocateBuffer(size).
+   *
+   * @param version The encoding of the buffered spans.
    */
-  SpanBuffer() {}
+  SpanBuffer(CollectorEndpointVersion version = CollectorEndpointVersion::HTTP_JSON_V1)
+      : version_(version) {}
 
   /**
    * Constructor that initializes a buffer with the given size.
    *
    * @param size The desired buffer size.
+   * @param version The encoding of the buffered spans.
    */
-  SpanBuffer(uint64_t size) { allocateBuffer(size); }
+  SpanBuffer(uint64_t size,
+             CollectorEndpointVersion version = CollectorEndpointVersion::HTTP_JSON_V1)
+      : version_(version) {
+    allocateBuffer(size);
+  }
 
   /**
    * Allocates space for an empty buffer or resizes a previously-allocated one.
    *
    * @param size The desired buffer size.
    */
-  void allocateBuffer(uint64_t size) { span_buffer_.reserve(size); }
+  void allocateBuffer(uint64_t size) { max_spans_ = size; }
 
   /**
    * Adds the given Zipkin span to the buffer.
@@ -44,12 +65,32 @@ public:
    * Empties the buffer. This method is supposed to be called when all buffered spans
    * have been sent to to the Zipkin service.
    */
-  void clear() { span_buffer_.clear(); }
+  void clear() {
+    encoded_spans_.clear();
+    pending_spans_ = 0;
+  }
 
   /**
    * @return the number of spans currently buffered.
    */
-  uint64_t pendingSpans() { return span_buffer_.size(); }
+  uint64_t pendingSpans() { return pending_spans_; }
+
+  /**
+   * @return the size of the encoded spans currently buffered.
+   */
+  uint64_t pendingBytes() { return encoded_spans_.size(); }
+
+  /**
+   * @return the encoding of the buffered spans.
+   */
+  CollectorEndpointVersion version() { return version_; }
+
+  /**
+   * Appends the buffered spans, in the encoding of the buffer, to the given buffer.
+   *
+   * @param output The buffer to append the encoded spans to.
+   */
+  void serialize(Buffer::Instance& output);
 
   /**
    * @return the contents of the buffer as a stringified array of JSONs, where
@@ -58,8 +99,12 @@ public:
   std::string toStringifiedJsonArray();
 
 private:
-  // We use a pre-allocated vector to improve performance
-  std::vector<Span> span_buffer_;
+  const CollectorEndpointVersion version_;
+  uint64_t max_spans_{};
+  uint64_t pending_spans_{};
+  // The spans in the encoding of version_. For JSON these are the comma separated elements of the
+  // array, without the brackets.
+  std::string encoded_spans_;
 };
 } // namespace Zipkin
 } // namespace Envoy
@@ -0,0 +1,189 @@
+#include "common/tracing/zipkin/span_proto_encoder.h"
+
+#include <array>
+
+#include "common/tracing/zipkin/zipkin_core_constants.h"
+
+namespace Envoy {
+namespace Zipkin {
+
+namespace {
+
+enum WireType : uint8_t { Varint = 0, Fixed64 = 1, LengthDelimited = 2 };
+
+// Values of zipkin.proto3.Span.Kind.
+enum SpanKind : uint8_t { Client = 1, Server = 2 };
+
+void appendTag(uint32_t field, WireType type, std::string& output) {
+  SpanProtoEncoder::appendVarint((field << 3) | type, output);
+}
+
+void appendVarintField(uint32_t field, uint64_t value, std::string& output) {
+  appendTag(field, Varint, output);
+  SpanProtoEncoder::appendVarint(value, output);
+}
+
+void appendFixed64Field(uint32_t field, uint64_t value, std::string& output) {
+  appendTag(field, Fixed64, output);
+  for (int i = 0; i < 8; i++) {
+    output.push_back(static_cast<char>(value >> (8 * i)));
+  }
+}
+
+void appendBytesField(uint32_t field, const void* data, size_t size, std::string& output) {
+  appendTag(field, LengthDelimited, output);
+  SpanProtoEncoder::appendVarint(size, output);
+  output.append(static_cast<const char*>(data), size);
+}
+
+void appendStringField(uint32_t field, const std::string& value, std::string& output) {
+  if (!value.empty()) {
+    appendBytesField(field, value.data(), value.size(), output);
+  }
+}
+
+// Zipkin ids are written as big endian bytes, with the high 64 bits of 128-bit trace ids first.
+void appendIdField(uint32_t field, uint64_t high, bool has_high, uint64_t low,
+                   std::string& output) {
+  appendTag(field, LengthDelimited, output);
+  output.push_back(has_high ? 16 : 8);
+  for (int i = has_high ? 0 : 1; i < 2; i++) {
+    const uint64_t value = i == 0 ? high : low;
+    for (int shift = 56; shift >= 0; shift -= 8) {
+      output.push_back(static_cast<char>(value >> shift));
+    }
+  }
+}
+
+// Nested messages are written in place after a one byte length, which is widened once the size of
+// the message is known. Endpoints, annotations and tags are nearly always shorter than 128 bytes,
+// so this only moves data for large spans.
+size_t beginMessage(uint32_t field, std::string& output) {
+  appendTag(field, LengthDelimited, output);
+  output.push_back(0);
+  return output.size();
+}
+
+void endMessage(size_t start, std::string& output) {
+  const uint64_t size = output.size() - start;
+  if (size < 0x80) {
+    output[start - 1] = static_cast<char>(size);
+    return;
+  }
+
+  std::string length;
+  SpanProtoEncoder::appendVarint(size, length);
+  output[start - 1] = length[0];
+  output.insert(start, length, 1, std::string::npos);
+}
+
+void appendEndpoint(uint32_t field, const Endpoint& endpoint, std::string& output) {
+  const size_t start = beginMessage(field, output);
+  appendStringField(1, endpoint.serviceName(), output);
+  const Network::Address::InstanceConstSharedPtr address = endpoint.address();
+  if (address && address->ip()) {
+    if (address->ip()->version() == Network::Address::IpVersion::v4) {
+      // The address is already in network byte order, which is the order of the bytes.
+      const uint32_t ipv4 = address->ip()->ipv4()->address();
+      appendBytesField(2, &ipv4, sizeof(ipv4), output);
+    } else {
+      const std::array<uint8_t, 16> ipv6 = address->ip()->ipv6()->address();
+      appendBytesField(3, ipv6.data(), ipv6.size(), output);
+    }
+    if (address->ip()->port() != 0) {
+      appendVarintField(4, address->ip()->port(), output);
+    }
+  }
+  endMessage(start, output);
+}
+
+} // namespace
+
+void SpanProtoEncoder::appendVarint(uint64_t value, std::string& output) {
+  while (value >= 0x80) {
+    output.push_back(static_cast<char>(value | 0x80));
+    value >>= 7;
+  }
+  output.push_back(static_cast<char>(value));
+}
+
+void SpanProtoEncoder::appendSpan(const Span& span, std::string& output) {
+  const ZipkinCoreConstantValues& constants = ZipkinCoreConstants::get();
+  const Annotation* start_annotation = nullptr;
+  const Annotation* end_annotation = nullptr;
+  const Annotation* endpoint_annotation = nullptr;
+  uint8_t kind = 0;
+  for (const Annotation& annotation : span.annotations()) {
+    if (annotation.value() == constants.CLIENT_SEND ||
+        annotation.value() == constants.SERVER_RECV) {
+      start_annotation = &annotation;
+      kind = annotation.value() == constants.CLIENT_SEND ? Client : Server;
+    } else if (annotation.value() == constants.CLIENT_RECV ||
+               annotation.value() == constants.SERVER_SEND) {
+      end_annotation = &annotation;
+    }
+    if (endpoint_annotation == nullptr && annotation.isSetEndpoint()) {
+      endpoint_annotation = &annotation;
+    }
+  }
+
+  const size_t start = beginMessage(1, output);
+  appendIdField(1, span.isSetTraceIdHigh() ? span.traceIdHigh() : 0, span.isSetTraceIdHigh(),
+                span.traceId(), output);
+  if (span.isSetParentId() && span.parentId()) {
+    appendIdField(2, 0, false, span.parentId(), output);
+  }
+  appendIdField(3, 0, false, span.id(), output);
+  if (kind != 0) {
+    appendVarintField(4, kind, output);
+  }
+  appendStringField(5, span.name(), output);
+
+  // In v2 the timestamp and duration of a span that shares its id with the client span are the
+  // ones its server annotations record.
+  const uint64_t timestamp = span.isSetTimestamp()
+                                 ? span.timestamp()
+                                 : (start_annotation ? start_annotation->timestamp() : 0);
+  if (timestamp != 0) {
+    appendFixed64Field(6, timestamp, output);
+  }
+  int64_t duration = 0;
+  if (span.isSetDuration()) {
+    duration = span.duration();
+  } else if (start_annotation && end_annotation) {
+    duration = end_annotation->timestamp() - start_annotation->timestamp();
+  }
+  if (duration > 0) {
+    appendVarintField(7, duration, output);
+  }
+
+  if (endpoint_annotation) {
+    appendEndpoint(8, endpoint_annotation->endpoint(), output);
+  }
+  for (const Annotation& annotation : span.annotations()) {
+    if (&annotation == start_annotation || &annotation == end_annotation) {
+      continue;
+    }
+    const size_t annotation_start = beginMessage(10, output);
+    appendFixed64Field(1, annotation.timestamp(), output);
+    appendStringField(2, annotation.value(), output);
+    endMessage(annotation_start, output);
+  }
+  for (const BinaryAnnotation& binary_annotation : span.binaryAnnotations()) {
+    const size_t tag_start = beginMessage(11, output);
+    appendStringField(1, binary_annotation.key(), output);
+    appendStringField(2, binary_annotation.value(), output);
+    endMessage(tag_start, output);
+  }
+
+  if (span.debug()) {
+    appendVarintField(12, 1, output);
+  }
+  if (kind == Server && !span.isSetTimestamp()) {
+    appendVarintField(13, 1, output);
+  }
+  endMessage(start, output);
+}
+
+} // namespace Zipkin
+} // namespace Envoy
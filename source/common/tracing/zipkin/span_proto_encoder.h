@@ -0,0 +1,38 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+
+#include "common/tracing/zipkin/zipkin_core_types.h"
+
+namespace Envoy {
+namespace Zipkin {
+
+/**
+ * Encodes spans in the Zipkin v2 proto3 format, which is what a Zipkin collector expects at
+ * /api/v2/spans when the content type is application/x-protobuf.
+ *
+ * The v1 model of this tree is mapped to v2 the way the Zipkin collector does it: the core
+ * annotations (cs, cr, sr and ss) become the kind, timestamp and duration of the span, the
+ * endpoint of the first annotation becomes the local endpoint, and binary annotations become tags.
+ */
+class SpanProtoEncoder {
+public:
+  /**
+   * Append a span to output as an entry of the spans field of a zipkin.proto3.ListOfSpans. The
+   * encoding of a ListOfSpans is the concatenation of its entries, so spans can be appended one
+   * by one as they finish.
+   *
+   * @param span The span to encode.
+   * @param output The string to append the encoded span to.
+   */
+  static void appendSpan(const Span& span, std::string& output);
+
+  /**
+   * Append the varint encoding of a value.
+   */
+  static void appendVarint(uint64_t value, std::string& output);
+};
+
+} // namespace Zipkin
+} // namespace Envoy
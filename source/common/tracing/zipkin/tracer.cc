@@ -10,6 +10,8 @@
 namespace Envoy {
 namespace Zipkin {
 
+constexpr size_t Tracer::MAX_INTERNED_TAG_KEYS;
+
 SpanPtr Tracer::startSpan(const Tracing::Config& config, const std::string& span_name,
                           SystemTime timestamp) {
   // Build the endpoint
@@ -119,6 +121,17 @@ void Tracer::reportSpan(Span&& span) {
   }
 }
 
+const std::string* Tracer::internTagKey(const std::string& key) {
+  auto it = tag_keys_.find(key);
+  if (it != tag_keys_.end()) {
+    return &*it;
+  }
+  if (tag_keys_.size() == MAX_INTERNED_TAG_KEYS) {
+    return nullptr;
+  }
+  return &*tag_keys_.insert(key).first;
+}
+
 void Tracer::setReporter(ReporterPtr reporter) { reporter_ = std::move(reporter); }
 
 } // namespace Zipkin
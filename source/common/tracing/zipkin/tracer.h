@@ -1,5 +1,8 @@
 #pragma once
 
+#include <string>
+#include <unordered_set>
+
 #include "envoy/common/pure.h"
 #include "envoy/common/time.h"
 #include "envoy/runtime/runtime.h"
@@ -84,6 +87,14 @@ public:
    */
   void reportSpan(Span&& span) override;
 
+  /**
+   * TracerInterface::internTagKey. Up to MAX_INTERNED_TAG_KEYS keys are interned, which covers the
+   * keys of the tags set by the HTTP tracer and those of the configured request header tags.
+   */
+  const std::string* internTagKey(const std::string& key) override;
+
+  static constexpr size_t MAX_INTERNED_TAG_KEYS = 128;
+
   /**
    * @return the service-name attribute associated with the Tracer.
    */
@@ -109,6 +120,8 @@ private:
   Network::Address::InstanceConstSharedPtr address_;
   ReporterPtr reporter_;
   Runtime::RandomGenerator& random_generator_;
+  // Each worker has its own tracer, so the set needs no lock.
+  std::unordered_set<std::string> tag_keys_;
 };
 
 typedef std::unique_ptr<Tracer> TracerPtr;
@@ -1,5 +1,7 @@
 #pragma once
 
+#include <string>
+
 #include "envoy/common/pure.h"
 
 namespace Envoy {
@@ -27,6 +29,16 @@ public:
    * @param span The span that needs action.
    */
   virtual void reportSpan(Span&& span) PURE;
+
+  /**
+   * Return a copy of a tag key that lives as long as the tracer, so that spans can refer to the
+   * key instead of copying it.
+   *
+   * @param key The tag key.
+   *
+   * @return the interned copy of the key, or nullptr if the tracer interns no more keys.
+   */
+  virtual const std::string* internTagKey(const std::string& key) PURE;
 };
 } // namespace Zipkin
 } // namespace Envoy
@@ -25,7 +25,7 @@ Endpoint& Endpoint::operator=(const Endpoint& ep) {
   return *this;
 }
 
-const std::string Endpoint::toJson() {
+const std::string Endpoint::toJson() const {
   rapidjson::StringBuffer s;
   rapidjson::Writer<rapidjson::StringBuffer> writer(s);
   writer.StartObject();
@@ -78,7 +78,7 @@ void Annotation::changeEndpointServiceName(const std::string& service_name) {
   }
 }
 
-const std::string Annotation::toJson() {
+const std::string Annotation::toJson() const {
   rapidjson::StringBuffer s;
   rapidjson::Writer<rapidjson::StringBuffer> writer(s);
   writer.StartObject();
@@ -99,7 +99,8 @@ const std::string Annotation::toJson() {
 }
 
 BinaryAnnotation::BinaryAnnotation(const BinaryAnnotation& ann) {
-  key_ = ann.key();
+  key_ = ann.key_;
+  interned_key_ = ann.interned_key_;
   value_ = ann.value();
   annotation_type_ = ann.annotationType();
   if (ann.isSetEndpoint()) {
@@ -108,7 +109,8 @@ BinaryAnnotation::BinaryAnnotation(const BinaryAnnotation& ann) {
 }
 
 BinaryAnnotation& BinaryAnnotation::operator=(const BinaryAnnotation& ann) {
-  key_ = ann.key();
+  key_ = ann.key_;
+  interned_key_ = ann.interned_key_;
   value_ = ann.value();
   annotation_type_ = ann.annotationType();
   if (ann.isSetEndpoint()) {
@@ -118,7 +120,7 @@ BinaryAnnotation& BinaryAnnotation::operator=(const BinaryAnnotation& ann) {
   return *this;
 }
 
-const std::string BinaryAnnotation::toJson() {
+const std::string BinaryAnnotation::toJson() const {
   rapidjson::StringBuffer s;
   rapidjson::Writer<rapidjson::StringBuffer> writer(s);
   writer.StartObject();
@@ -169,7 +171,7 @@ void Span::setServiceName(const std::string& service_name) {
   }
 }
 
-const std::string Span::toJson() {
+const std::string Span::toJson() const {
   rapidjson::StringBuffer s;
   rapidjson::Writer<rapidjson::StringBuffer> writer(s);
   writer.StartObject();
@@ -254,7 +256,17 @@ void Span::finish() {
 
 void Span::setTag(const std::string& name, const std::string& value) {
   if (name.size() > 0 && value.size() > 0) {
-    addBinaryAnnotation(BinaryAnnotation(name, value));
+    if (binary_annotations_.empty()) {
+      // Finalizing a span sets about this many tags, so reserve them at once rather than growing
+      // the vector tag by tag.
+      binary_annotations_.reserve(8);
+    }
+    const std::string* interned_name = tracer_ ? tracer_->internTagKey(name) : nullptr;
+    if (interned_name) {
+      binary_annotations_.emplace_back(interned_name, value);
+    } else {
+      binary_annotations_.emplace_back(name, value);
+    }
   }
 }
 } // namespace Zipkin
@@ -7,6 +7,7 @@
 #include "envoy/network/address.h"
 
 #include "common/common/hex.h"
+#include "common/common/object_pool.h"
 #include "common/tracing/zipkin/tracer_interface.h"
 #include "common/tracing/zipkin/util.h"
 
@@ -28,7 +29,7 @@ public:
    * All classes defining Zipkin abstractions need to implement this method to convert
    * the corresponding abstraction to a Zipkin-compliant JSON.
    */
-  virtual const std::string toJson() PURE;
+  virtual const std::string toJson() const PURE;
 };
 
 /**
@@ -86,7 +87,7 @@ public:
    *
    * @return a stringified JSON.
    */
-  const std::string toJson() override;
+  const std::string toJson() const override;
 
 private:
   std::string service_name_;
@@ -178,7 +179,7 @@ public:
    *
    * @return a stringified JSON.
    */
-  const std::string toJson() override;
+  const std::string toJson() const override;
 
 private:
   uint64_t timestamp_;
@@ -222,6 +223,16 @@ public:
   BinaryAnnotation(const std::string& key, const std::string& value)
       : key_(key), value_(value), annotation_type_(STRING) {}
 
+  /**
+   * Constructor that creates a binary annotation whose key is a string that outlives it, such as
+   * a key interned by the tracer, so that the key is not copied.
+   *
+   * @param key The key name of the annotation.
+   * @param value The value associated with the key.
+   */
+  BinaryAnnotation(const std::string* key, const std::string& value)
+      : value_(value), interned_key_(key), annotation_type_(STRING) {}
+
   /**
    * @return the type of the binary annotation.
    */
@@ -255,12 +266,15 @@ public:
   /**
    * @return the key attribute.
    */
-  const std::string& key() const { return key_; }
+  const std::string& key() const { return interned_key_ ? *interned_key_ : key_; }
 
   /**
    * Sets the key attribute.
    */
-  void setKey(const std::string& key) { key_ = key; }
+  void setKey(const std::string& key) {
+    key_ = key;
+    interned_key_ = nullptr;
+  }
 
   /**
    * @return the value attribute.
@@ -277,11 +291,13 @@ public:
    *
    * @return a stringified JSON.
    */
-  const std::string toJson() override;
+  const std::string toJson() const override;
 
 private:
   std::string key_;
   std::string value_;
+  // The key, if it is not owned by key_.
+  const std::string* interned_key_{};
   Optional<Endpoint> endpoint_;
   AnnotationType annotation_type_;
 };
@@ -289,9 +305,10 @@ private:
 typedef std::unique_ptr<Span> SpanPtr;
 
 /**
- * Represents a Zipkin span. This class is based on Zipkin's Thrift definition of a span.
+ * Represents a Zipkin span. This class is based on Zipkin's Thrift definition of a span. Spans are
+ * created for every traced request, so they are allocated from the ObjectPool.
  */
-class Span : public ZipkinBase {
+class Span : public ZipkinBase, public PooledObject {
 public:
   /**
    * Copy constructor.
@@ -494,7 +511,7 @@ public:
    *
    * @return a stringified JSON.
    */
-  const std::string toJson() override;
+  const std::string toJson() const override;
 
   /**
    * Associates a Tracer object with the span. The tracer's reportSpan() method is invoked
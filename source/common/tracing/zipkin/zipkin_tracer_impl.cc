@@ -13,39 +13,40 @@
 namespace Envoy {
 namespace Zipkin {
 
-ZipkinSpan::ZipkinSpan(Zipkin::Span& span, Zipkin::Tracer& tracer) : span_(span), tracer_(tracer) {}
+ZipkinSpan::ZipkinSpan(SpanPtr&& span, Zipkin::Tracer& tracer)
+    : span_(std::move(span)), tracer_(tracer) {}
 
-void ZipkinSpan::finishSpan() { span_.finish(); }
+void ZipkinSpan::finishSpan() { span_->finish(); }
 
-void ZipkinSpan::setOperation(const std::string& operation) { span_.setName(operation); }
+void ZipkinSpan::setOperation(const std::string& operation) { span_->setName(operation); }
 
 void ZipkinSpan::setTag(const std::string& name, const std::string& value) {
-  span_.setTag(name, value);
+  span_->setTag(name, value);
 }
 
 void ZipkinSpan::injectContext(Http::HeaderMap& request_headers) {
   // Set the trace-id and span-id headers properly, based on the newly-created span structure.
-  request_headers.insertXB3TraceId().value(span_.traceIdAsHexString());
-  request_headers.insertXB3SpanId().value(span_.idAsHexString());
+  request_headers.insertXB3TraceId().value(span_->traceIdAsHexString());
+  request_headers.insertXB3SpanId().value(span_->idAsHexString());
 
   // Set the parent-span header properly, based on the newly-created span structure.
-  if (span_.isSetParentId()) {
-    request_headers.insertXB3ParentSpanId().value(span_.parentIdAsHexString());
+  if (span_->isSetParentId()) {
+    request_headers.insertXB3ParentSpanId().value(span_->parentIdAsHexString());
   }
 
   // Set the sampled header.
   request_headers.insertXB3Sampled().value().setReference(ZipkinCoreConstants::get().ALWAYS_SAMPLE);
 
   // Set the ot-span-context header with the new context.
-  SpanContext context(span_);
+  SpanContext context(*span_);
   request_headers.insertOtSpanContext().value(context.serializeToString());
 }
 
 Tracing::SpanPtr ZipkinSpan::spawnChild(const Tracing::Config& config, const std::string& name,
                                         SystemTime start_time) {
-  SpanContext context(span_);
+  SpanContext context(*span_);
   return Tracing::SpanPtr{
-      new ZipkinSpan(*tracer_.startSpan(config, name, start_time, context), tracer_)};
+      new ZipkinSpan(tracer_.startSpan(config, name, start_time, context), tracer_)};
 }
 
 Driver::TlsTracer::TlsTracer(TracerPtr&& tracer, Driver& driver)
@@ -65,15 +66,28 @@ Driver::Driver(const Json::Object& config, Upstream::ClusterManager& cluster_man
   }
   cluster_ = cluster->info();
 
+  const std::string version = config.getString("collector_endpoint_version", "HTTP_JSON_V1");
+  CollectorEndpointVersion collector_endpoint_version;
+  std::string default_collector_endpoint;
+  if (version == "HTTP_JSON_V1") {
+    collector_endpoint_version = CollectorEndpointVersion::HTTP_JSON_V1;
+    default_collector_endpoint = ZipkinCoreConstants::get().DEFAULT_COLLECTOR_ENDPOINT;
+  } else if (version == "HTTP_PROTO") {
+    collector_endpoint_version = CollectorEndpointVersion::HTTP_PROTO;
+    default_collector_endpoint = ZipkinCoreConstants::get().DEFAULT_PROTO_COLLECTOR_ENDPOINT;
+  } else {
+    throw EnvoyException(fmt::format("unknown zipkin collector endpoint version {}", version));
+  }
+
   const std::string collector_endpoint =
-      config.getString("collector_endpoint", ZipkinCoreConstants::get().DEFAULT_COLLECTOR_ENDPOINT);
+      config.getString("collector_endpoint", default_collector_endpoint);
 
-  tls_->set([this, collector_endpoint, &random_generator](
+  tls_->set([this, collector_endpoint, collector_endpoint_version, &random_generator](
                 Event::Dispatcher& dispatcher) -> ThreadLocal::ThreadLocalObjectSharedPtr {
     TracerPtr tracer(
         new Tracer(local_info_.clusterName(), local_info_.address(), random_generator));
-    tracer->setReporter(
-        ReporterImpl::NewInstance(std::ref(*this), std::ref(dispatcher), collector_endpoint));
+    tracer->setReporter(ReporterImpl::NewInstance(std::ref(*this), std::ref(dispatcher),
+                                                  collector_endpoint, collector_endpoint_version));
     return ThreadLocal::ThreadLocalObjectSharedPtr{new TlsTracer(std::move(tracer), *this)};
   });
 }
@@ -125,13 +139,15 @@ Tracing::SpanPtr Driver::startSpan(const Tracing::Config& config, Http::HeaderMa
     new_zipkin_span = tracer.startSpan(config, request_headers.Host()->value().c_str(), start_time);
   }
 
-  ZipkinSpanPtr active_span(new ZipkinSpan(*new_zipkin_span, tracer));
+  ZipkinSpanPtr active_span(new ZipkinSpan(std::move(new_zipkin_span), tracer));
   return std::move(active_span);
 }
 
 ReporterImpl::ReporterImpl(Driver& driver, Event::Dispatcher& dispatcher,
-                           const std::string& collector_endpoint)
-    : driver_(driver), collector_endpoint_(collector_endpoint) {
+                           const std::string& collector_endpoint,
+                           CollectorEndpointVersion collector_endpoint_version)
+    : driver_(driver), span_buffer_(collector_endpoint_version),
+      collector_endpoint_(collector_endpoint) {
   flush_timer_ = dispatcher.createTimer([this]() -> void {
     driver_.tracerStats().timer_flushed_.inc();
     flushSpans();
@@ -146,18 +162,23 @@ ReporterImpl::ReporterImpl(Driver& driver, Event::Dispatcher& dispatcher,
 }
 
 ReporterPtr ReporterImpl::NewInstance(Driver& driver, Event::Dispatcher& dispatcher,
-                                      const std::string& collector_endpoint) {
-  return ReporterPtr(new ReporterImpl(driver, dispatcher, collector_endpoint));
+                                      const std::string& collector_endpoint,
+                                      CollectorEndpointVersion collector_endpoint_version) {
+  return ReporterPtr(
+      new ReporterImpl(driver, dispatcher, collector_endpoint, collector_endpoint_version));
 }
 
-// TODO(fabolive): Need to avoid the copy to improve performance.
 void ReporterImpl::reportSpan(const Span& span) {
   span_buffer_.addSpan(span);
 
   const uint64_t min_flush_spans =
       driver_.runtime().snapshot().getInteger("tracing.zipkin.min_flush_spans", 5U);
 
-  if (span_buffer_.pendingSpans() == min_flush_spans) {
+  const uint64_t min_flush_bytes =
+      driver_.runtime().snapshot().getInteger("tracing.zipkin.min_flush_bytes", 64 * 1024U);
+
+  if (span_buffer_.pendingSpans() == min_flush_spans ||
+      span_buffer_.pendingBytes() >= min_flush_bytes) {
     flushSpans();
   }
 }
@@ -172,16 +193,17 @@ void ReporterImpl::flushSpans() {
   if (span_buffer_.pendingSpans()) {
     driver_.tracerStats().spans_sent_.add(span_buffer_.pendingSpans());
 
-    const std::string request_body = span_buffer_.toStringifiedJsonArray();
     Http::MessagePtr message(new Http::RequestMessageImpl());
     message->headers().insertMethod().value().setReference(Http::Headers::get().MethodValues.Post);
     message->headers().insertPath().value(collector_endpoint_);
     message->headers().insertHost().value(driver_.cluster()->name());
     message->headers().insertContentType().value().setReference(
-        Http::Headers::get().ContentTypeValues.Json);
+        span_buffer_.version() == CollectorEndpointVersion::HTTP_PROTO
+            ? Http::Headers::get().ContentTypeValues.Protobuf
+            : Http::Headers::get().ContentTypeValues.Json);
 
     Buffer::InstancePtr body(new Buffer::OwnedImpl());
-    body->add(request_body);
+    span_buffer_.serialize(*body);
     message->body() = std::move(body);
 
     const uint64_t timeout =
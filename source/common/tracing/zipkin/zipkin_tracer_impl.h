@@ -6,6 +6,7 @@
 #include "envoy/tracing/http_tracer.h"
 #include "envoy/upstream/cluster_manager.h"
 
+#include "common/common/object_pool.h"
 #include "common/http/header_map_impl.h"
 #include "common/json/json_loader.h"
 #include "common/tracing/zipkin/span_buffer.h"
@@ -26,16 +27,17 @@ struct ZipkinTracerStats {
 };
 
 /**
- * Class for Zipkin spans, wrapping a Zipkin::Span object.
+ * Class for Zipkin spans, wrapping a Zipkin::Span object. Like the span it wraps, it is allocated
+ * from the ObjectPool.
  */
-class ZipkinSpan : public Tracing::Span {
+class ZipkinSpan : public Tracing::Span, public PooledObject {
 public:
   /**
    * Constructor. Wraps a Zipkin::Span object.
    *
-   * @param span to be wrapped.
+   * @param span to be wrapped, which the new object takes ownership of.
    */
-  ZipkinSpan(Zipkin::Span& span, Zipkin::Tracer& tracer);
+  ZipkinSpan(SpanPtr&& span, Zipkin::Tracer& tracer);
 
   /**
    * Calls Zipkin::Span::finishSpan() to perform all actions needed to finalize the span.
@@ -66,10 +68,10 @@ public:
   /**
    * @return a reference to the Zipkin::Span object.
    */
-  Zipkin::Span& span() { return span_; }
+  Zipkin::Span& span() { return *span_; }
 
 private:
-  Zipkin::Span span_;
+  SpanPtr span_;
   Zipkin::Tracer& tracer_;
 };
 
@@ -129,16 +131,17 @@ private:
 /**
  * This class derives from the abstract Zipkin::Reporter.
  * It buffers spans and relies on Http::AsyncClient to send spans to
- * Zipkin using JSON over HTTP.
+ * Zipkin using JSON or protobuf over HTTP.
  *
  * Two runtime parameters control the span buffering/flushing behavior, namely:
  * tracing.zipkin.min_flush_spans and tracing.zipkin.flush_interval_ms.
  *
  * Up to `tracing.zipkin.min_flush_spans` will be buffered. Spans are flushed (sent to Zipkin)
  * either when the buffer is full, or when a timer, set to `tracing.zipkin.flush_interval_ms`,
- * expires, whichever happens first.
+ * expires, whichever happens first. Buffered spans are also flushed once their encoding reaches
+ * `tracing.zipkin.min_flush_bytes`.
  *
- * The default values for the runtime parameters are 5 spans and 5000ms.
+ * The default values for the runtime parameters are 5 spans, 5000ms and 64KiB.
  */
 class ReporterImpl : public Reporter, Http::AsyncClient::Callbacks {
 public:
@@ -150,9 +153,11 @@ public:
    * @param collector_endpoint String representing the Zipkin endpoint to be used
    * when making HTTP POST requests carrying spans. This value comes from the
    * Zipkin-related tracing configuration.
+   * @param collector_endpoint_version The encoding of the spans sent to collector_endpoint.
    */
   ReporterImpl(Driver& driver, Event::Dispatcher& dispatcher,
-               const std::string& collector_endpoint);
+               const std::string& collector_endpoint,
+               CollectorEndpointVersion collector_endpoint_version);
 
   /**
    * Implementation of Zipkin::Reporter::reportSpan().
@@ -176,11 +181,13 @@ public:
    * @param collector_endpoint String representing the Zipkin endpoint to be used
    * when making HTTP POST requests carrying spans. This value comes from the
    * Zipkin-related tracing configuration.
+   * @param collector_endpoint_version The encoding of the spans sent to collector_endpoint.
    *
    * @return Pointer to the newly-created ZipkinReporter.
    */
   static ReporterPtr NewInstance(Driver& driver, Event::Dispatcher& dispatcher,
-                                 const std::string& collector_endpoint);
+                                 const std::string& collector_endpoint,
+                                 CollectorEndpointVersion collector_endpoint_version);
 
 private:
   /**
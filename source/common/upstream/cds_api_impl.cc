@@ -17,17 +17,18 @@ namespace Upstream {
 CdsApiPtr CdsApiImpl::create(const envoy::api::v2::ConfigSource& cds_config,
                              const Optional<envoy::api::v2::ConfigSource>& eds_config,
                              ClusterManager& cm, Event::Dispatcher& dispatcher,
-                             Runtime::RandomGenerator& random,
+                             ThreadLocal::Instance& tls, Runtime::RandomGenerator& random,
                              const LocalInfo::LocalInfo& local_info, Stats::Scope& scope) {
   return CdsApiPtr{
-      new CdsApiImpl(cds_config, eds_config, cm, dispatcher, random, local_info, scope)};
+      new CdsApiImpl(cds_config, eds_config, cm, dispatcher, tls, random, local_info, scope)};
 }
 
 CdsApiImpl::CdsApiImpl(const envoy::api::v2::ConfigSource& cds_config,
                        const Optional<envoy::api::v2::ConfigSource>& eds_config, ClusterManager& cm,
-                       Event::Dispatcher& dispatcher, Runtime::RandomGenerator& random,
-                       const LocalInfo::LocalInfo& local_info, Stats::Scope& scope)
-    : cm_(cm), scope_(scope.createScope("cluster_manager.cds.")) {
+                       Event::Dispatcher& dispatcher, ThreadLocal::Instance& tls,
+                       Runtime::RandomGenerator& random, const LocalInfo::LocalInfo& local_info,
+                       Stats::Scope& scope)
+    : cm_(cm), tls_(tls), scope_(scope.createScope("cluster_manager.cds.")) {
   Config::Utility::checkLocalInfo("cds", local_info);
   subscription_ =
       Config::SubscriptionFactory::subscriptionFromConfigSource<envoy::api::v2::Cluster>(
@@ -44,23 +45,60 @@ CdsApiImpl::CdsApiImpl(const envoy::api::v2::ConfigSource& cds_config,
 void CdsApiImpl::onConfigUpdate(const ResourceVector& resources) {
   cm_.adsMux().pause(Config::TypeUrl::get().ClusterLoadAssignment);
   Cleanup eds_resume([this] { cm_.adsMux().resume(Config::TypeUrl::get().ClusterLoadAssignment); });
+  std::vector<const envoy::api::v2::Cluster*> clusters;
   for (const auto& cluster : resources) {
     MessageUtil::validate(cluster);
+    clusters.push_back(&cluster);
   }
+  cm_.prepareClusters(clusters);
   // We need to keep track of which clusters we might need to remove.
   ClusterManager::ClusterInfoMap clusters_to_remove = cm_.clusters();
-  for (auto& cluster : resources) {
-    const std::string cluster_name = cluster.name();
-    clusters_to_remove.erase(cluster_name);
-    if (cm_.addOrUpdatePrimaryCluster(cluster)) {
-      ENVOY_LOG(debug, "cds: add/update cluster '{}'", cluster_name);
+  {
+    // The workers get the thread local updates of all the clusters in one post.
+    tls_.beginBatch();
+    Cleanup end_batch([this] { tls_.endBatch(); });
+    for (auto& cluster : resources) {
+      const std::string cluster_name = cluster.name();
+      clusters_to_remove.erase(cluster_name);
+      if (cm_.addOrUpdatePrimaryCluster(cluster)) {
+        ENVOY_LOG(debug, "cds: add/update cluster '{}'", cluster_name);
+      }
+    }
+
+    for (auto cluster : clusters_to_remove) {
+      const std::string cluster_name = cluster.first;
+      if (cm_.removePrimaryCluster(cluster_name)) {
+        ENVOY_LOG(debug, "cds: remove cluster '{}'", cluster_name);
+      }
     }
   }
 
-  for (auto cluster : clusters_to_remove) {
-    const std::string cluster_name = cluster.first;
-    if (cm_.removePrimaryCluster(cluster_name)) {
-      ENVOY_LOG(debug, "cds: remove cluster '{}'", cluster_name);
+  runInitializeCallbackIfAny();
+}
+
+void CdsApiImpl::onIncrementalConfigUpdate(const ResourceVector& added_resources,
+                                           const std::vector<std::string>& removed_resources) {
+  cm_.adsMux().pause(Config::TypeUrl::get().ClusterLoadAssignment);
+  Cleanup eds_resume([this] { cm_.adsMux().resume(Config::TypeUrl::get().ClusterLoadAssignment); });
+  std::vector<const envoy::api::v2::Cluster*> clusters;
+  for (const auto& cluster : added_resources) {
+    MessageUtil::validate(cluster);
+    clusters.push_back(&cluster);
+  }
+  cm_.prepareClusters(clusters);
+  // Only the clusters in the update are touched, rather than every cluster the cluster manager has.
+  {
+    tls_.beginBatch();
+    Cleanup end_batch([this] { tls_.endBatch(); });
+    for (const auto& cluster : added_resources) {
+      if (cm_.addOrUpdatePrimaryCluster(cluster)) {
+        ENVOY_LOG(debug, "cds: add/update cluster '{}'", cluster.name());
+      }
+    }
+    for (const std::string& cluster_name : removed_resources) {
+      if (cm_.removePrimaryCluster(cluster_name)) {
+        ENVOY_LOG(debug, "cds: remove cluster '{}'", cluster_name);
+      }
     }
   }
 
@@ -1,10 +1,13 @@
 #pragma once
 
 #include <functional>
+#include <string>
+#include <vector>
 
 #include "envoy/config/subscription.h"
 #include "envoy/event/dispatcher.h"
 #include "envoy/local_info/local_info.h"
+#include "envoy/thread_local/thread_local.h"
 #include "envoy/upstream/cluster_manager.h"
 
 #include "common/common/logger.h"
@@ -24,8 +27,8 @@ public:
   static CdsApiPtr create(const envoy::api::v2::ConfigSource& cds_config,
                           const Optional<envoy::api::v2::ConfigSource>& eds_config,
                           ClusterManager& cm, Event::Dispatcher& dispatcher,
-                          Runtime::RandomGenerator& random, const LocalInfo::LocalInfo& local_info,
-                          Stats::Scope& scope);
+                          ThreadLocal::Instance& tls, Runtime::RandomGenerator& random,
+                          const LocalInfo::LocalInfo& local_info, Stats::Scope& scope);
 
   // Upstream::CdsApi
   void initialize() override { subscription_->start({}, *this); }
@@ -36,16 +39,21 @@ public:
 
   // Config::SubscriptionCallbacks
   void onConfigUpdate(const ResourceVector& resources) override;
+  bool supportsIncrementalUpdates() const override { return true; }
+  void onIncrementalConfigUpdate(const ResourceVector& added_resources,
+                                 const std::vector<std::string>& removed_resources) override;
   void onConfigUpdateFailed(const EnvoyException* e) override;
 
 private:
   CdsApiImpl(const envoy::api::v2::ConfigSource& cds_config,
              const Optional<envoy::api::v2::ConfigSource>& eds_config, ClusterManager& cm,
-             Event::Dispatcher& dispatcher, Runtime::RandomGenerator& random,
-             const LocalInfo::LocalInfo& local_info, Stats::Scope& scope);
+             Event::Dispatcher& dispatcher, ThreadLocal::Instance& tls,
+             Runtime::RandomGenerator& random, const LocalInfo::LocalInfo& local_info,
+             Stats::Scope& scope);
   void runInitializeCallbackIfAny();
 
   ClusterManager& cm_;
+  ThreadLocal::Instance& tls_;
   std::unique_ptr<Config::Subscription<envoy::api::v2::Cluster>> subscription_;
   std::function<void()> initialize_callback_;
   Stats::ScopePtr scope_;
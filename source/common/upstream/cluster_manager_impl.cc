@@ -1,10 +1,14 @@
 #include "common/upstream/cluster_manager_impl.h"
 
+#include <algorithm>
+#include <atomic>
 #include <chrono>
 #include <cstdint>
 #include <functional>
 #include <list>
 #include <string>
+#include <thread>
+#include <unordered_set>
 #include <vector>
 
 #include "envoy/event/dispatcher.h"
@@ -12,6 +16,8 @@
 #include "envoy/runtime/runtime.h"
 
 #include "common/common/enum_to_int.h"
+#include "common/common/hash.h"
+#include "common/common/thread.h"
 #include "common/common/utility.h"
 #include "common/config/cds_json.h"
 #include "common/config/utility.h"
@@ -26,6 +32,7 @@
 #include "common/router/shadow_writer_impl.h"
 #include "common/upstream/cds_api_impl.h"
 #include "common/upstream/load_balancer_impl.h"
+#include "common/upstream/maglev_lb.h"
 #include "common/upstream/original_dst_cluster.h"
 #include "common/upstream/ring_hash_lb.h"
 #include "common/upstream/subset_lb.h"
@@ -170,7 +177,8 @@ ClusterManagerImpl::ClusterManagerImpl(const envoy::api::v2::Bootstrap& bootstra
                                        AccessLog::AccessLogManager& log_manager,
                                        Event::Dispatcher& primary_dispatcher)
     : factory_(factory), runtime_(runtime), stats_(stats), tls_(tls.allocateSlot()),
-      random_(random), local_info_(local_info), cm_stats_(generateStats(stats)),
+      random_(random), primary_dispatcher_(primary_dispatcher), local_info_(local_info),
+      cm_stats_(generateStats(stats)),
       init_helper_([this](Cluster& cluster) { onClusterInit(cluster); }) {
   const auto& ads_config = bootstrap.dynamic_resources().ads_config();
   if (ads_config.cluster_names().empty()) {
@@ -182,10 +190,24 @@ ClusterManagerImpl::ClusterManagerImpl(const envoy::api::v2::Bootstrap& bootstra
       throw EnvoyException(
           "envoy::api::v2::ApiConfigSource must have a singleton cluster name specified");
     }
-    ads_mux_.reset(new Config::GrpcMuxImpl(
-        bootstrap.node(), *this, ads_config.cluster_names()[0], primary_dispatcher,
-        *Protobuf::DescriptorPool::generated_pool()->FindMethodByName(
-            "envoy.api.v2.AggregatedDiscoveryService.StreamAggregatedResources")));
+    // The ADS cluster is static, so its metadata is known before the clusters are loaded.
+    bool incremental = false;
+    for (const auto& cluster : bootstrap.static_resources().clusters()) {
+      if (cluster.name() == ads_config.cluster_names()[0]) {
+        incremental = Config::Utility::incrementalXds(cluster.metadata());
+      }
+    }
+    if (incremental) {
+      ads_mux_.reset(new Config::IncrementalGrpcMuxImpl(
+          bootstrap.node(), *this, ads_config.cluster_names()[0], primary_dispatcher,
+          *Protobuf::DescriptorPool::generated_pool()->FindMethodByName(
+              Config::IncrementalGrpcMuxImpl::SERVICE_METHOD)));
+    } else {
+      ads_mux_.reset(new Config::GrpcMuxImpl(
+          bootstrap.node(), *this, ads_config.cluster_names()[0], primary_dispatcher,
+          *Protobuf::DescriptorPool::generated_pool()->FindMethodByName(
+              "envoy.api.v2.AggregatedDiscoveryService.StreamAggregatedResources")));
+    }
   }
 
   const auto& cm_config = bootstrap.cluster_manager();
@@ -207,6 +229,13 @@ ClusterManagerImpl::ClusterManagerImpl(const envoy::api::v2::Bootstrap& bootstra
         bootstrap.cluster_manager().upstream_bind_config().source_address());
   }
 
+  // Build the parts of the static clusters that do not need the main thread in parallel first.
+  std::vector<const envoy::api::v2::Cluster*> static_clusters;
+  for (const auto& cluster : bootstrap.static_resources().clusters()) {
+    static_clusters.push_back(&cluster);
+  }
+  factory_.prepareClusters(static_clusters, *this, false);
+
   // Cluster loading happens in two phases: first all the primary clusters are loaded, and then all
   // the secondary clusters are loaded. As it currently stands all non-EDS clusters are primary and
   // only EDS clusters are secondary. This two phase loading is done because in v2 configuration
@@ -361,7 +390,7 @@ bool ClusterManagerImpl::addOrUpdatePrimaryCluster(const envoy::api::v2::Cluster
   ENVOY_LOG(info, "add/update cluster {}", cluster_name);
   tls_->runOnAllThreads(
       [
-        this, new_cluster = primary_cluster_entry.cluster_->info(),
+        this, new_cluster = primary_cluster_entry.cluster_->info(), id = primary_cluster_entry.id_,
         thread_aware_lb_factory = primary_cluster_entry.loadBalancerFactory()
       ]()
           ->void {
@@ -374,15 +403,32 @@ bool ClusterManagerImpl::addOrUpdatePrimaryCluster(const envoy::api::v2::Cluster
               ENVOY_LOG(debug, "adding TLS cluster {}", new_cluster->name());
             }
 
-            cluster_manager.thread_local_clusters_[new_cluster->name()].reset(
-                new ThreadLocalClusterManagerImpl::ClusterEntry(cluster_manager, new_cluster,
-                                                                thread_aware_lb_factory));
+            cluster_manager.setCluster(
+                new_cluster->name(), id,
+                ThreadLocalClusterManagerImpl::ClusterEntryPtr{
+                    new ThreadLocalClusterManagerImpl::ClusterEntry(cluster_manager, new_cluster,
+                                                                    thread_aware_lb_factory)});
           });
 
   init_helper_.addCluster(*primary_cluster_entry.cluster_);
   return true;
 }
 
+void ClusterManagerImpl::prepareClusters(
+    const std::vector<const envoy::api::v2::Cluster*>& clusters) {
+  // Only the clusters that addOrUpdatePrimaryCluster() would build are worth preparing.
+  std::vector<const envoy::api::v2::Cluster*> changed_clusters;
+  for (const envoy::api::v2::Cluster* cluster : clusters) {
+    auto existing_cluster = primary_clusters_.find(cluster->name());
+    if (existing_cluster == primary_clusters_.end() ||
+        (existing_cluster->second.added_via_api_ &&
+         existing_cluster->second.config_hash_ != MessageUtil::hash(*cluster))) {
+      changed_clusters.push_back(cluster);
+    }
+  }
+  factory_.prepareClusters(changed_clusters, *this, true);
+}
+
 bool ClusterManagerImpl::removePrimaryCluster(const std::string& cluster_name) {
   auto existing_cluster = primary_clusters_.find(cluster_name);
   if (existing_cluster == primary_clusters_.end() || !existing_cluster->second.added_via_api_) {
@@ -390,22 +436,32 @@ bool ClusterManagerImpl::removePrimaryCluster(const std::string& cluster_name) {
   }
 
   init_helper_.removeCluster(*existing_cluster->second.cluster_);
+  const uint32_t id = existing_cluster->second.id_;
   primary_clusters_.erase(existing_cluster);
   cm_stats_.cluster_removed_.inc();
   cm_stats_.total_clusters_.set(primary_clusters_.size());
   ENVOY_LOG(info, "removing cluster {}", cluster_name);
-  tls_->runOnAllThreads([this, cluster_name]() -> void {
+  tls_->runOnAllThreads([this, cluster_name, id]() -> void {
     ThreadLocalClusterManagerImpl& cluster_manager =
         tls_->getTyped<ThreadLocalClusterManagerImpl>();
 
     ASSERT(cluster_manager.thread_local_clusters_.count(cluster_name) == 1);
     ENVOY_LOG(debug, "removing TLS cluster {}", cluster_name);
-    cluster_manager.thread_local_clusters_.erase(cluster_name);
+    cluster_manager.removeCluster(cluster_name, id);
   });
 
   return true;
 }
 
+void ClusterManagerImpl::inheritUnhealthyHosts(const std::string& cluster,
+                                               const std::vector<std::string>& addresses) {
+  auto existing_cluster = primary_clusters_.find(cluster);
+  if (existing_cluster != primary_clusters_.end() &&
+      existing_cluster->second.cluster_->healthChecker() != nullptr) {
+    existing_cluster->second.cluster_->healthChecker()->inheritUnhealthyHosts(addresses);
+  }
+}
+
 void ClusterManagerImpl::loadCluster(const envoy::api::v2::Cluster& cluster, bool added_via_api) {
   ClusterSharedPtr new_cluster =
       factory_.clusterFromProto(cluster, *this, outlier_event_logger_, added_via_api);
@@ -439,8 +495,10 @@ void ClusterManagerImpl::loadCluster(const envoy::api::v2::Cluster& cluster, boo
   size_t num_erased = primary_clusters_.erase(primary_cluster_reference.info()->name());
   auto cluster_entry_it = primary_clusters_
                               .emplace(primary_cluster_reference.info()->name(),
-                                       PrimaryClusterData{MessageUtil::hash(cluster), added_via_api,
-                                                          std::move(new_cluster)})
+                                       PrimaryClusterData{
+                                           MessageUtil::hash(cluster), added_via_api,
+                                           clusterId(primary_cluster_reference.info()->name()),
+                                           std::move(new_cluster)})
                               .first;
 
   // If an LB is thread aware, create it here. The LB is not initialized until cluster pre-init
@@ -448,7 +506,12 @@ void ClusterManagerImpl::loadCluster(const envoy::api::v2::Cluster& cluster, boo
   if (primary_cluster_reference.info()->lbType() == LoadBalancerType::RingHash) {
     cluster_entry_it->second.thread_aware_lb_ = std::make_unique<RingHashLoadBalancer>(
         primary_cluster_reference.prioritySet(), primary_cluster_reference.info()->stats(),
-        runtime_, random_, primary_cluster_reference.info()->lbRingHashConfig());
+        runtime_, random_, primary_cluster_reference.info()->lbRingHashConfig(),
+        &primary_dispatcher_);
+  } else if (primary_cluster_reference.info()->lbType() == LoadBalancerType::Maglev) {
+    cluster_entry_it->second.thread_aware_lb_ = std::make_unique<MaglevLoadBalancer>(
+        primary_cluster_reference.prioritySet(), primary_cluster_reference.info()->stats(),
+        runtime_, random_, &primary_dispatcher_);
   }
 
   cm_stats_.total_clusters_.set(primary_clusters_.size());
@@ -470,6 +533,21 @@ ThreadLocalCluster* ClusterManagerImpl::get(const std::string& cluster) {
   }
 }
 
+ClusterHandlePtr ClusterManagerImpl::clusterHandle(const std::string& cluster) {
+  return ClusterHandlePtr{new ClusterHandleImpl(*this, clusterId(cluster))};
+}
+
+uint32_t ClusterManagerImpl::clusterId(const std::string& cluster) {
+  return cluster_ids_.emplace(cluster, cluster_ids_.size()).first->second;
+}
+
+ThreadLocalCluster* ClusterManagerImpl::ClusterHandleImpl::get() const {
+  ThreadLocalClusterManagerImpl& cluster_manager =
+      parent_.tls_->getTyped<ThreadLocalClusterManagerImpl>();
+  return id_ < cluster_manager.clusters_by_id_.size() ? cluster_manager.clusters_by_id_[id_]
+                                                      : nullptr;
+}
+
 Http::ConnectionPool::Instance*
 ClusterManagerImpl::httpConnPoolForCluster(const std::string& cluster, ResourcePriority priority,
                                            Http::Protocol protocol, LoadBalancerContext* context) {
@@ -481,7 +559,7 @@ ClusterManagerImpl::httpConnPoolForCluster(const std::string& cluster, ResourceP
   }
 
   // Select a host and create a connection pool for it if it does not already exist.
-  return entry->second->connPool(priority, protocol, context);
+  return entry->second->httpConnPool(priority, protocol, context);
 }
 
 void ClusterManagerImpl::postThreadLocalClusterUpdate(
@@ -490,23 +568,24 @@ void ClusterManagerImpl::postThreadLocalClusterUpdate(
     const std::vector<HostSharedPtr>& hosts_removed) {
   const auto& host_set = primary_cluster.prioritySet().hostSetsPerPriority()[priority];
 
-  HostVectorConstSharedPtr hosts_copy(new std::vector<HostSharedPtr>(host_set->hosts()));
-  HostVectorConstSharedPtr healthy_hosts_copy(
-      new std::vector<HostSharedPtr>(host_set->healthyHosts()));
-  HostListsConstSharedPtr hosts_per_locality_copy(
-      new std::vector<std::vector<HostSharedPtr>>(host_set->hostsPerLocality()));
-  HostListsConstSharedPtr healthy_hosts_per_locality_copy(
-      new std::vector<std::vector<HostSharedPtr>>(host_set->healthyHostsPerLocality()));
+  // The host lists are immutable, so all workers share the lists of the primary host set. Only the
+  // delta is copied, once for all the workers.
+  HostVectorConstSharedPtr hosts = host_set->hostsPtr();
+  HostVectorConstSharedPtr healthy_hosts = host_set->healthyHostsPtr();
+  HostListsConstSharedPtr hosts_per_locality = host_set->hostsPerLocalityPtr();
+  HostListsConstSharedPtr healthy_hosts_per_locality = host_set->healthyHostsPerLocalityPtr();
+  HostVectorConstSharedPtr hosts_added_copy(new std::vector<HostSharedPtr>(hosts_added));
+  HostVectorConstSharedPtr hosts_removed_copy(new std::vector<HostSharedPtr>(hosts_removed));
 
   tls_->runOnAllThreads([
-    this, name = primary_cluster.info()->name(), priority, hosts_copy, healthy_hosts_copy,
-    hosts_per_locality_copy, healthy_hosts_per_locality_copy, hosts_added, hosts_removed
+    this, name = primary_cluster.info()->name(), priority, hosts, healthy_hosts,
+    hosts_per_locality, healthy_hosts_per_locality, hosts_added_copy, hosts_removed_copy
   ]()
                             ->void {
                               ThreadLocalClusterManagerImpl::updateClusterMembership(
-                                  name, priority, hosts_copy, healthy_hosts_copy,
-                                  hosts_per_locality_copy, healthy_hosts_per_locality_copy,
-                                  hosts_added, hosts_removed, *tls_);
+                                  name, priority, hosts, healthy_hosts, hosts_per_locality,
+                                  healthy_hosts_per_locality, *hosts_added_copy,
+                                  *hosts_removed_copy, *tls_);
                             });
 }
 
@@ -526,6 +605,13 @@ Host::CreateConnectionData ClusterManagerImpl::tcpConnForCluster(const std::stri
 
   HostConstSharedPtr logical_host = entry->second->lb_->chooseHost(context);
   if (logical_host) {
+    if (entry->second->tcp_preconnect_pool_ != nullptr) {
+      Host::CreateConnectionData preconnected =
+          entry->second->tcp_preconnect_pool_->claim(logical_host);
+      if (preconnected.connection_ != nullptr) {
+        return preconnected;
+      }
+    }
     return logical_host->createConnection(cluster_manager.thread_local_dispatcher_);
   } else {
     entry->second->cluster_info_->stats().upstream_cx_none_healthy_.inc();
@@ -553,13 +639,15 @@ const std::string ClusterManagerImpl::versionInfo() const {
 ClusterManagerImpl::ThreadLocalClusterManagerImpl::ThreadLocalClusterManagerImpl(
     ClusterManagerImpl& parent, Event::Dispatcher& dispatcher,
     const Optional<std::string>& local_cluster_name)
-    : parent_(parent), thread_local_dispatcher_(dispatcher) {
+    : parent_(parent), thread_local_dispatcher_(dispatcher),
+      worker_index_(parent.next_worker_index_++) {
   // If local cluster is defined then we need to initialize it first.
   if (local_cluster_name.valid()) {
     ENVOY_LOG(debug, "adding TLS local cluster {}", local_cluster_name.value());
     auto& local_cluster = parent.primary_clusters_.at(local_cluster_name.value());
-    thread_local_clusters_[local_cluster_name.value()].reset(new ClusterEntry(
-        *this, local_cluster.cluster_->info(), local_cluster.loadBalancerFactory()));
+    setCluster(local_cluster_name.value(), local_cluster.id_,
+               ClusterEntryPtr{new ClusterEntry(*this, local_cluster.cluster_->info(),
+                                                local_cluster.loadBalancerFactory())});
   }
 
   local_priority_set_ = local_cluster_name.valid()
@@ -574,8 +662,9 @@ ClusterManagerImpl::ThreadLocalClusterManagerImpl::ThreadLocalClusterManagerImpl
 
     ENVOY_LOG(debug, "adding TLS initial cluster {}", cluster.first);
     ASSERT(thread_local_clusters_.count(cluster.first) == 0);
-    thread_local_clusters_[cluster.first].reset(new ClusterEntry(
-        *this, cluster.second.cluster_->info(), cluster.second.loadBalancerFactory()));
+    setCluster(cluster.first, cluster.second.id_,
+               ClusterEntryPtr{new ClusterEntry(*this, cluster.second.cluster_->info(),
+                                                cluster.second.loadBalancerFactory())});
   }
 }
 
@@ -588,6 +677,7 @@ ClusterManagerImpl::ThreadLocalClusterManagerImpl::~ThreadLocalClusterManagerImp
   //                     redis/conn_pool_impl.cc. Will fix at the same time.
   ENVOY_LOG(debug, "shutting down thread local cluster manager");
   host_http_conn_pool_map_.clear();
+  clusters_by_id_.clear();
   for (auto& cluster : thread_local_clusters_) {
     if (&cluster.second->priority_set_ != local_priority_set_) {
       cluster.second.reset();
@@ -596,6 +686,23 @@ ClusterManagerImpl::ThreadLocalClusterManagerImpl::~ThreadLocalClusterManagerImp
   thread_local_clusters_.clear();
 }
 
+void ClusterManagerImpl::ThreadLocalClusterManagerImpl::setCluster(const std::string& name,
+                                                                   uint32_t id,
+                                                                   ClusterEntryPtr&& entry) {
+  if (id >= clusters_by_id_.size()) {
+    clusters_by_id_.resize(id + 1);
+  }
+  clusters_by_id_[id] = entry.get();
+  thread_local_clusters_[name] = std::move(entry);
+}
+
+void ClusterManagerImpl::ThreadLocalClusterManagerImpl::removeCluster(const std::string& name,
+                                                                      uint32_t id) {
+  ASSERT(id < clusters_by_id_.size());
+  clusters_by_id_[id] = nullptr;
+  thread_local_clusters_.erase(name);
+}
+
 void ClusterManagerImpl::ThreadLocalClusterManagerImpl::drainConnPools(
     const std::vector<HostSharedPtr>& hosts) {
   for (const HostSharedPtr& host : hosts) {
@@ -654,9 +761,15 @@ void ClusterManagerImpl::ThreadLocalClusterManagerImpl::updateClusterMembership(
   ASSERT(config.thread_local_clusters_.find(name) != config.thread_local_clusters_.end());
   const auto& cluster_entry = config.thread_local_clusters_[name];
   ENVOY_LOG(debug, "membership update for TLS cluster {}", name);
-  cluster_entry->priority_set_.getOrCreateHostSet(priority).updateHosts(
-      std::move(hosts), std::move(healthy_hosts), std::move(hosts_per_locality),
-      std::move(healthy_hosts_per_locality), hosts_added, hosts_removed);
+  if (cluster_entry->worker_subsets_ > 1) {
+    cluster_entry->updateWorkerSubsetHosts(priority, std::move(hosts), std::move(healthy_hosts),
+                                           std::move(hosts_per_locality),
+                                           std::move(healthy_hosts_per_locality));
+  } else {
+    cluster_entry->priority_set_.getOrCreateHostSet(priority).updateHosts(
+        std::move(hosts), std::move(healthy_hosts), std::move(hosts_per_locality),
+        std::move(healthy_hosts_per_locality), hosts_added, hosts_removed);
+  }
 
   // If an LB is thread aware, create a new worker local LB on membership changes.
   if (cluster_entry->lb_factory_ != nullptr) {
@@ -694,9 +807,18 @@ ClusterManagerImpl::ThreadLocalClusterManagerImpl::ClusterEntry::ClusterEntry(
       http_async_client_(*cluster, parent.parent_.stats_, parent.thread_local_dispatcher_,
                          parent.parent_.local_info_, parent.parent_, parent.parent_.runtime_,
                          parent.parent_.random_,
-                         Router::ShadowWriterPtr{new Router::ShadowWriterImpl(parent.parent_)}) {
+                         Router::ShadowWriterPtr{new Router::ShadowWriterImpl(parent.parent_)}),
+      worker_subsets_(lb_factory == nullptr && cluster->lbType() != LoadBalancerType::OriginalDst
+                          ? cluster->workerSubsets()
+                          : 1) {
   priority_set_.getOrCreateHostSet(0);
 
+  // Original destination hosts are only created for connections that have already been made, so
+  // there is nothing to connect ahead of.
+  if (cluster->tcpPreconnectPerHost() > 0 && cluster->lbType() != LoadBalancerType::OriginalDst) {
+    tcp_preconnect_pool_.reset(new TcpPreconnectPool(parent.thread_local_dispatcher_, cluster));
+  }
+
   // TODO(mattklein123): Consider converting other LBs over to thread local. All of them could
   // benefit given the healthy panic, locality, and priority calculations that take place.
   if (cluster->lbSubsetInfo().isEnabled()) {
@@ -714,6 +836,13 @@ ClusterManagerImpl::ThreadLocalClusterManagerImpl::ClusterEntry::ClusterEntry(
                                              parent.parent_.random_));
       break;
     }
+    case LoadBalancerType::PeakEwma: {
+      ASSERT(lb_factory_ == nullptr);
+      lb_.reset(new PeakEwmaLoadBalancer(priority_set_, parent_.local_priority_set_,
+                                         cluster->stats(), parent.parent_.runtime_,
+                                         parent.parent_.random_));
+      break;
+    }
     case LoadBalancerType::Random: {
       ASSERT(lb_factory_ == nullptr);
       lb_.reset(new RandomLoadBalancer(priority_set_, parent_.local_priority_set_, cluster->stats(),
@@ -727,7 +856,8 @@ ClusterManagerImpl::ThreadLocalClusterManagerImpl::ClusterEntry::ClusterEntry(
                                            parent.parent_.random_));
       break;
     }
-    case LoadBalancerType::RingHash: {
+    case LoadBalancerType::RingHash:
+    case LoadBalancerType::Maglev: {
       ASSERT(lb_factory_ != nullptr);
       lb_ = lb_factory_->create();
       break;
@@ -741,12 +871,19 @@ ClusterManagerImpl::ThreadLocalClusterManagerImpl::ClusterEntry::ClusterEntry(
     }
   }
 
-  priority_set_.addMemberUpdateCb([this](uint32_t, const std::vector<HostSharedPtr>&,
+  priority_set_.addMemberUpdateCb([this](uint32_t, const std::vector<HostSharedPtr>& hosts_added,
                                          const std::vector<HostSharedPtr>& hosts_removed) -> void {
     // We need to go through and purge any connection pools for hosts that got deleted.
     // Even if two hosts actually point to the same address this will be safe, since if a
     // host is readded it will be a different physical HostSharedPtr.
     parent_.drainConnPools(hosts_removed);
+    // The initial hosts of a cluster are added when it finishes initializing, so this also warms
+    // up the cluster.
+    prefetchConnPools(hosts_added);
+    if (tcp_preconnect_pool_ != nullptr) {
+      tcp_preconnect_pool_->removeHosts(hosts_removed);
+      tcp_preconnect_pool_->addHosts(hosts_added);
+    }
   });
 }
 
@@ -763,7 +900,7 @@ ClusterManagerImpl::ThreadLocalClusterManagerImpl::ClusterEntry::~ClusterEntry()
 }
 
 Http::ConnectionPool::Instance*
-ClusterManagerImpl::ThreadLocalClusterManagerImpl::ClusterEntry::connPool(
+ClusterManagerImpl::ThreadLocalClusterManagerImpl::ClusterEntry::httpConnPool(
     ResourcePriority priority, Http::Protocol protocol, LoadBalancerContext* context) {
   HostConstSharedPtr host = lb_->chooseHost(context);
   if (!host) {
@@ -772,6 +909,12 @@ ClusterManagerImpl::ThreadLocalClusterManagerImpl::ClusterEntry::connPool(
     return nullptr;
   }
 
+  return connPool(host, priority, protocol);
+}
+
+Http::ConnectionPool::Instance*
+ClusterManagerImpl::ThreadLocalClusterManagerImpl::ClusterEntry::connPool(
+    HostConstSharedPtr host, ResourcePriority priority, Http::Protocol protocol) {
   ConnPoolsContainer& container = parent_.host_http_conn_pool_map_[host];
   const auto idx = container.index(priority, protocol);
   if (!container.pools_[idx]) {
@@ -782,6 +925,82 @@ ClusterManagerImpl::ThreadLocalClusterManagerImpl::ClusterEntry::connPool(
   return container.pools_[idx].get();
 }
 
+void ClusterManagerImpl::ThreadLocalClusterManagerImpl::ClusterEntry::prefetchConnPools(
+    const std::vector<HostSharedPtr>& hosts) {
+  if (cluster_info_->prefetchRatio() <= 0) {
+    return;
+  }
+
+  // Only the pools for the default priority and the protocol of the cluster are warmed up, which
+  // are the ones used unless routes say otherwise.
+  const Http::Protocol protocol = (cluster_info_->features() & ClusterInfo::Features::HTTP2)
+                                      ? Http::Protocol::Http2
+                                      : Http::Protocol::Http11;
+  for (const HostSharedPtr& host : hosts) {
+    connPool(host, ResourcePriority::Default, protocol)->prefetch();
+  }
+}
+
+bool ClusterManagerImpl::ThreadLocalClusterManagerImpl::ClusterEntry::inWorkerSubset(
+    const Host& host) const {
+  // The subset of a host only depends on its address, so it stays the same across updates.
+  return HashUtil::xxHash64(host.address()->asString()) % worker_subsets_ ==
+         parent_.worker_index_ % worker_subsets_;
+}
+
+HostVectorConstSharedPtr
+ClusterManagerImpl::ThreadLocalClusterManagerImpl::ClusterEntry::workerSubset(
+    const std::vector<HostSharedPtr>& hosts) const {
+  HostVectorSharedPtr subset(new std::vector<HostSharedPtr>());
+  for (const HostSharedPtr& host : hosts) {
+    if (inWorkerSubset(*host)) {
+      subset->push_back(host);
+    }
+  }
+  return subset;
+}
+
+HostListsConstSharedPtr
+ClusterManagerImpl::ThreadLocalClusterManagerImpl::ClusterEntry::workerSubset(
+    const std::vector<std::vector<HostSharedPtr>>& hosts_per_locality) const {
+  HostListsSharedPtr subset(new std::vector<std::vector<HostSharedPtr>>());
+  for (const std::vector<HostSharedPtr>& hosts : hosts_per_locality) {
+    subset->push_back(*workerSubset(hosts));
+  }
+  return subset;
+}
+
+void ClusterManagerImpl::ThreadLocalClusterManagerImpl::ClusterEntry::updateWorkerSubsetHosts(
+    uint32_t priority, HostVectorConstSharedPtr hosts, HostVectorConstSharedPtr healthy_hosts,
+    HostListsConstSharedPtr hosts_per_locality,
+    HostListsConstSharedPtr healthy_hosts_per_locality) {
+  // Rather than leaving this worker without hosts, or with only unhealthy hosts while there are
+  // healthy ones, it uses all the hosts of the priority.
+  HostVectorConstSharedPtr subset_hosts = workerSubset(*hosts);
+  HostVectorConstSharedPtr subset_healthy_hosts = workerSubset(*healthy_hosts);
+  if (!subset_hosts->empty() && (!subset_healthy_hosts->empty() || healthy_hosts->empty())) {
+    hosts = subset_hosts;
+    healthy_hosts = subset_healthy_hosts;
+    hosts_per_locality = workerSubset(*hosts_per_locality);
+    healthy_hosts_per_locality = workerSubset(*healthy_hosts_per_locality);
+  }
+
+  // Falling back to all the hosts changes the hosts of this worker beyond the hosts that were
+  // added and removed, so the changes are worked out from the current hosts.
+  HostSet& host_set = priority_set_.getOrCreateHostSet(priority);
+  std::unordered_set<HostSharedPtr> old_hosts(host_set.hosts().begin(), host_set.hosts().end());
+  std::vector<HostSharedPtr> hosts_added;
+  for (const HostSharedPtr& host : *hosts) {
+    if (old_hosts.erase(host) == 0) {
+      hosts_added.push_back(host);
+    }
+  }
+  const std::vector<HostSharedPtr> hosts_removed(old_hosts.begin(), old_hosts.end());
+
+  host_set.updateHosts(std::move(hosts), std::move(healthy_hosts), std::move(hosts_per_locality),
+                       std::move(healthy_hosts_per_locality), hosts_added, hosts_removed);
+}
+
 ClusterManagerPtr ProdClusterManagerFactory::clusterManagerFromProto(
     const envoy::api::v2::Bootstrap& bootstrap, Stats::Store& stats, ThreadLocal::Instance& tls,
     Runtime::Loader& runtime, Runtime::RandomGenerator& random,
@@ -806,17 +1025,72 @@ ProdClusterManagerFactory::allocateConnPool(Event::Dispatcher& dispatcher, HostC
 ClusterSharedPtr ProdClusterManagerFactory::clusterFromProto(
     const envoy::api::v2::Cluster& cluster, ClusterManager& cm,
     Outlier::EventLoggerSharedPtr outlier_event_logger, bool added_via_api) {
+  ClusterInfoConstSharedPtr info;
+  auto prepared_cluster = prepared_clusters_.find(cluster.name());
+  if (prepared_cluster != prepared_clusters_.end()) {
+    if (prepared_cluster->second.added_via_api_ == added_via_api &&
+        prepared_cluster->second.config_hash_ == MessageUtil::hash(cluster)) {
+      info = std::move(prepared_cluster->second.info_);
+    }
+    prepared_clusters_.erase(prepared_cluster);
+  }
   return ClusterImplBase::create(cluster, cm, stats_, tls_, dns_resolver_, ssl_context_manager_,
                                  runtime_, random_, primary_dispatcher_, local_info_,
-                                 outlier_event_logger, added_via_api);
+                                 outlier_event_logger, added_via_api, info);
+}
+
+void ProdClusterManagerFactory::prepareClusters(
+    const std::vector<const envoy::api::v2::Cluster*>& clusters, ClusterManager& cm,
+    bool added_via_api) {
+  prepared_clusters_.clear();
+  const uint64_t concurrency = std::min<uint64_t>(
+      clusters.size(),
+      runtime_.snapshot().getInteger("upstream.cluster_init_concurrency",
+                                     std::max(1U, std::thread::hardware_concurrency())));
+  if (concurrency < 2) {
+    return;
+  }
+
+  // The cluster info holds what is costly to build: the parsed config, the stats scope and stats,
+  // and the transport socket factory with its TLS contexts. The stats store and the SSL context
+  // manager are thread safe, so the infos are built on a pool of startup threads, each taking the
+  // next cluster until there are none left. The rest of a cluster (timers, DNS, subscriptions,
+  // health checkers) needs the main thread's dispatcher and is built by clusterFromProto().
+  std::vector<ClusterInfoConstSharedPtr> infos(clusters.size());
+  std::atomic<size_t> next_cluster{0};
+  auto prepare = [&]() -> void {
+    for (size_t i = next_cluster++; i < clusters.size(); i = next_cluster++) {
+      try {
+        infos[i] = std::make_shared<ClusterInfoImpl>(*clusters[i], cm.sourceAddress(), runtime_,
+                                                     stats_, ssl_context_manager_, added_via_api);
+      } catch (const EnvoyException&) {
+        // clusterFromProto() builds the cluster again, so the error surfaces there as usual.
+      }
+    }
+  };
+  std::vector<Thread::ThreadPtr> threads;
+  for (uint64_t i = 1; i < concurrency; i++) {
+    threads.emplace_back(new Thread::Thread(prepare));
+  }
+  prepare();
+  for (Thread::ThreadPtr& thread : threads) {
+    thread->join();
+  }
+
+  for (size_t i = 0; i < clusters.size(); i++) {
+    if (infos[i] != nullptr) {
+      prepared_clusters_[clusters[i]->name()] =
+          PreparedCluster{MessageUtil::hash(*clusters[i]), added_via_api, std::move(infos[i])};
+    }
+  }
 }
 
 CdsApiPtr
 ProdClusterManagerFactory::createCds(const envoy::api::v2::ConfigSource& cds_config,
                                      const Optional<envoy::api::v2::ConfigSource>& eds_config,
                                      ClusterManager& cm) {
-  return CdsApiImpl::create(cds_config, eds_config, cm, primary_dispatcher_, random_, local_info_,
-                            stats_);
+  return CdsApiImpl::create(cds_config, eds_config, cm, primary_dispatcher_, tls_, random_,
+                            local_info_, stats_);
 }
 
 } // namespace Upstream
@@ -1,6 +1,7 @@
 #pragma once
 
 #include <array>
+#include <atomic>
 #include <cstdint>
 #include <functional>
 #include <list>
@@ -17,8 +18,10 @@
 #include "envoy/upstream/cluster_manager.h"
 
 #include "common/config/grpc_mux_impl.h"
+#include "common/config/incremental_grpc_mux_impl.h"
 #include "common/http/async_client_impl.h"
 #include "common/upstream/load_stats_reporter.h"
+#include "common/upstream/tcp_preconnect_pool.h"
 #include "common/upstream/upstream_impl.h"
 
 #include "api/bootstrap.pb.h"
@@ -55,6 +58,8 @@ public:
   ClusterSharedPtr clusterFromProto(const envoy::api::v2::Cluster& cluster, ClusterManager& cm,
                                     Outlier::EventLoggerSharedPtr outlier_event_logger,
                                     bool added_via_api) override;
+  void prepareClusters(const std::vector<const envoy::api::v2::Cluster*>& clusters,
+                       ClusterManager& cm, bool added_via_api) override;
   CdsApiPtr createCds(const envoy::api::v2::ConfigSource& cds_config,
                       const Optional<envoy::api::v2::ConfigSource>& eds_config,
                       ClusterManager& cm) override;
@@ -63,6 +68,16 @@ protected:
   Event::Dispatcher& primary_dispatcher_;
 
 private:
+  /**
+   * The info of a cluster built by prepareClusters(), until clusterFromProto() uses it. The
+   * info is only used for a cluster of the same config.
+   */
+  struct PreparedCluster {
+    uint64_t config_hash_;
+    bool added_via_api_;
+    ClusterInfoConstSharedPtr info_;
+  };
+
   Runtime::Loader& runtime_;
   Stats::Store& stats_;
   ThreadLocal::Instance& tls_;
@@ -70,6 +85,7 @@ private:
   Network::DnsResolverSharedPtr dns_resolver_;
   Ssl::ContextManager& ssl_context_manager_;
   const LocalInfo::LocalInfo& local_info_;
+  std::unordered_map<std::string, PreparedCluster> prepared_clusters_;
 };
 
 /**
@@ -154,6 +170,7 @@ public:
 
   // Upstream::ClusterManager
   bool addOrUpdatePrimaryCluster(const envoy::api::v2::Cluster& cluster) override;
+  void prepareClusters(const std::vector<const envoy::api::v2::Cluster*>& clusters) override;
   void setInitializedCb(std::function<void()> callback) override {
     init_helper_.setInitializedCb(callback);
   }
@@ -166,6 +183,7 @@ public:
     return clusters_map;
   }
   ThreadLocalCluster* get(const std::string& cluster) override;
+  ClusterHandlePtr clusterHandle(const std::string& cluster) override;
   Http::ConnectionPool::Instance* httpConnPoolForCluster(const std::string& cluster,
                                                          ResourcePriority priority,
                                                          Http::Protocol protocol,
@@ -174,6 +192,8 @@ public:
                                                LoadBalancerContext* context) override;
   Http::AsyncClient& httpAsyncClientForCluster(const std::string& cluster) override;
   bool removePrimaryCluster(const std::string& cluster) override;
+  void inheritUnhealthyHosts(const std::string& cluster,
+                             const std::vector<std::string>& addresses) override;
   void shutdown() override {
     cds_api_.reset();
     primary_clusters_.clear();
@@ -214,13 +234,25 @@ private:
                    const LoadBalancerFactorySharedPtr& lb_factory);
       ~ClusterEntry();
 
-      Http::ConnectionPool::Instance* connPool(ResourcePriority priority, Http::Protocol protocol,
-                                               LoadBalancerContext* context);
-
       // Upstream::ThreadLocalCluster
       const PrioritySet& prioritySet() override { return priority_set_; }
       ClusterInfoConstSharedPtr info() override { return cluster_info_; }
       LoadBalancer& loadBalancer() override { return *lb_; }
+      Http::ConnectionPool::Instance* httpConnPool(ResourcePriority priority,
+                                                   Http::Protocol protocol,
+                                                   LoadBalancerContext* context) override;
+
+      Http::ConnectionPool::Instance* connPool(HostConstSharedPtr host, ResourcePriority priority,
+                                               Http::Protocol protocol);
+      void prefetchConnPools(const std::vector<HostSharedPtr>& hosts);
+      bool inWorkerSubset(const Host& host) const;
+      HostVectorConstSharedPtr workerSubset(const std::vector<HostSharedPtr>& hosts) const;
+      HostListsConstSharedPtr
+      workerSubset(const std::vector<std::vector<HostSharedPtr>>& hosts_per_locality) const;
+      void updateWorkerSubsetHosts(uint32_t priority, HostVectorConstSharedPtr hosts,
+                                   HostVectorConstSharedPtr healthy_hosts,
+                                   HostListsConstSharedPtr hosts_per_locality,
+                                   HostListsConstSharedPtr healthy_hosts_per_locality);
 
       ThreadLocalClusterManagerImpl& parent_;
       PrioritySetImpl priority_set_;
@@ -232,6 +264,11 @@ private:
       LoadBalancerPtr lb_;
       ClusterInfoConstSharedPtr cluster_info_;
       Http::AsyncClientImpl http_async_client_;
+      // The number of subsets the hosts are split into for the workers, 1 if this worker uses all
+      // the hosts. Thread aware LBs choose from all the hosts, so they use no subsets.
+      const uint32_t worker_subsets_;
+      // Idle TCP connections to the hosts of this worker, if the cluster preconnects.
+      TcpPreconnectPoolPtr tcp_preconnect_pool_;
     };
 
     typedef std::unique_ptr<ClusterEntry> ClusterEntryPtr;
@@ -239,6 +276,8 @@ private:
     ThreadLocalClusterManagerImpl(ClusterManagerImpl& parent, Event::Dispatcher& dispatcher,
                                   const Optional<std::string>& local_cluster_name);
     ~ThreadLocalClusterManagerImpl();
+    void setCluster(const std::string& name, uint32_t id, ClusterEntryPtr&& entry);
+    void removeCluster(const std::string& name, uint32_t id);
     void drainConnPools(const std::vector<HostSharedPtr>& hosts);
     void drainConnPools(HostSharedPtr old_host, ConnPoolsContainer& container);
     static void updateClusterMembership(const std::string& name, uint32_t priority,
@@ -253,14 +292,30 @@ private:
 
     ClusterManagerImpl& parent_;
     Event::Dispatcher& thread_local_dispatcher_;
+    // Distinct for each thread, selects the subset of the hosts of clusters with worker subsets.
+    const uint32_t worker_index_;
     std::unordered_map<std::string, ClusterEntryPtr> thread_local_clusters_;
+    // The clusters of thread_local_clusters_ indexed by their ids, for ClusterHandleImpl.
+    std::vector<ClusterEntry*> clusters_by_id_;
     std::unordered_map<HostConstSharedPtr, ConnPoolsContainer> host_http_conn_pool_map_;
     const PrioritySet* local_priority_set_{};
   };
 
+  struct ClusterHandleImpl : public ClusterHandle {
+    ClusterHandleImpl(ClusterManagerImpl& parent, uint32_t id) : parent_(parent), id_(id) {}
+
+    // Upstream::ClusterHandle
+    ThreadLocalCluster* get() const override;
+
+    ClusterManagerImpl& parent_;
+    const uint32_t id_;
+  };
+
   struct PrimaryClusterData {
-    PrimaryClusterData(uint64_t config_hash, bool added_via_api, ClusterSharedPtr&& cluster)
-        : config_hash_(config_hash), added_via_api_(added_via_api), cluster_(std::move(cluster)) {}
+    PrimaryClusterData(uint64_t config_hash, bool added_via_api, uint32_t id,
+                       ClusterSharedPtr&& cluster)
+        : config_hash_(config_hash), added_via_api_(added_via_api), id_(id),
+          cluster_(std::move(cluster)) {}
 
     LoadBalancerFactorySharedPtr loadBalancerFactory() {
       if (thread_aware_lb_ != nullptr) {
@@ -272,12 +327,15 @@ private:
 
     const uint64_t config_hash_;
     const bool added_via_api_;
+    const uint32_t id_;
     ClusterSharedPtr cluster_;
     // Optional thread aware LB depending on the LB type. Not all clusters have one.
     ThreadAwareLoadBalancerPtr thread_aware_lb_;
   };
 
   static ClusterManagerStats generateStats(Stats::Scope& scope);
+  // The id of a cluster name, assigned on first use and never reused.
+  uint32_t clusterId(const std::string& cluster);
   void loadCluster(const envoy::api::v2::Cluster& cluster, bool added_via_api);
   void onClusterInit(Cluster& cluster);
   void postThreadLocalClusterUpdate(const Cluster& cluster, uint32_t priority,
@@ -290,7 +348,9 @@ private:
   Stats::Store& stats_;
   ThreadLocal::SlotPtr tls_;
   Runtime::RandomGenerator& random_;
+  Event::Dispatcher& primary_dispatcher_;
   std::unordered_map<std::string, PrimaryClusterData> primary_clusters_;
+  std::unordered_map<std::string, uint32_t> cluster_ids_;
   Optional<envoy::api::v2::ConfigSource> eds_config_;
   Network::Address::InstanceConstSharedPtr source_address_;
   Outlier::EventLoggerSharedPtr outlier_event_logger_;
@@ -302,6 +362,9 @@ private:
   LoadStatsReporterPtr load_stats_reporter_;
   // The name of the local cluster of this Envoy instance if defined, else the empty string.
   std::string local_cluster_name_;
+  // Assigns the worker indices of the thread local cluster managers, which are created
+  // concurrently on their threads.
+  std::atomic<uint32_t> next_worker_index_{};
 };
 
 } // namespace Upstream
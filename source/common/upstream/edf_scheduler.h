@@ -0,0 +1,77 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <queue>
+#include <vector>
+
+#include "common/common/assert.h"
+
+namespace Envoy {
+namespace Upstream {
+
+/**
+ * Earliest Deadline First (EDF) scheduler
+ * (https://en.wikipedia.org/wiki/Earliest_deadline_first_scheduling) used for weighted round robin.
+ * Each entry is scheduled with a deadline of the current time plus the inverse of its weight, so
+ * over time entries are picked in proportion to their weights, and the picks of the entries are
+ * spread out rather than bunched together. Entries with the same deadline are picked in the order
+ * they were added. Adding and picking are O(log n) in the number of entries.
+ */
+template <class C> class EdfScheduler {
+public:
+  /**
+   * Pick the entry with the earliest deadline and remove it from the schedule. The time of the
+   * schedule advances to the deadline of the entry, so an entry added back with add() is scheduled
+   * after the entries that are still waiting for their turn.
+   * @return std::shared_ptr<C> the entry, or nullptr if the schedule is empty.
+   */
+  std::shared_ptr<C> pick() {
+    if (queue_.empty()) {
+      return nullptr;
+    }
+    EdfEntry edf_entry = queue_.top();
+    queue_.pop();
+    current_time_ = edf_entry.deadline_;
+    return edf_entry.entry_;
+  }
+
+  /**
+   * Add an entry to the schedule.
+   * @param weight supplies the weight of the entry, which must be positive.
+   * @param entry supplies the entry.
+   */
+  void add(double weight, std::shared_ptr<C> entry) {
+    ASSERT(weight > 0);
+    queue_.push({current_time_ + 1.0 / weight, order_offset_++, std::move(entry)});
+  }
+
+  /**
+   * @return bool whether the schedule has no entries.
+   */
+  bool empty() const { return queue_.empty(); }
+
+private:
+  struct EdfEntry {
+    double deadline_;
+    // Breaks ties between entries with the same deadline.
+    uint64_t order_offset_;
+    std::shared_ptr<C> entry_;
+
+    // The priority queue yields the greatest entry first, so the entry with the earliest deadline
+    // has to compare greatest.
+    bool operator<(const EdfEntry& other) const {
+      if (deadline_ != other.deadline_) {
+        return deadline_ > other.deadline_;
+      }
+      return order_offset_ > other.order_offset_;
+    }
+  };
+
+  double current_time_{};
+  uint64_t order_offset_{};
+  std::priority_queue<EdfEntry> queue_;
+};
+
+} // namespace Upstream
+} // namespace Envoy
@@ -22,9 +22,9 @@ EdsClusterImpl::EdsClusterImpl(const envoy::api::v2::Cluster& cluster, Runtime::
                                Stats::Store& stats, Ssl::ContextManager& ssl_context_manager,
                                const LocalInfo::LocalInfo& local_info, ClusterManager& cm,
                                Event::Dispatcher& dispatcher, Runtime::RandomGenerator& random,
-                               bool added_via_api)
+                               bool added_via_api, ClusterInfoConstSharedPtr info)
     : BaseDynamicClusterImpl(cluster, cm.sourceAddress(), runtime, stats, ssl_context_manager,
-                             added_via_api),
+                             added_via_api, info),
       cm_(cm), local_info_(local_info),
       cluster_name_(cluster.eds_cluster_config().service_name().empty()
                         ? cluster.name()
@@ -40,12 +40,14 @@ EdsClusterImpl::EdsClusterImpl(const envoy::api::v2::Cluster& cluster, Runtime::
       },
       "envoy.api.v2.EndpointDiscoveryService.FetchEndpoints",
       "envoy.api.v2.EndpointDiscoveryService.StreamEndpoints");
+  if (info_->updateMergeWindow().valid()) {
+    merge_timer_ = dispatcher.createTimer([this]() -> void { onMergeWindowClosed(); });
+  }
 }
 
 void EdsClusterImpl::startPreInit() { subscription_->start({cluster_name_}, *this); }
 
 void EdsClusterImpl::onConfigUpdate(const ResourceVector& resources) {
-  typedef std::unique_ptr<std::vector<HostSharedPtr>> HostListPtr;
   std::vector<HostListPtr> new_hosts(1);
   if (resources.empty()) {
     ENVOY_LOG(debug, "Missing ClusterLoadAssignment for {} in onConfigUpdate()", cluster_name_);
@@ -83,15 +85,42 @@ void EdsClusterImpl::onConfigUpdate(const ResourceVector& resources) {
     }
   }
 
+  // The update replaces whatever is held back, as an EDS update carries all of the hosts of the
+  // cluster.
+  if (merge_window_open_) {
+    info_->stats().update_merged_.inc();
+    pending_hosts_ = std::move(new_hosts);
+    return;
+  }
+
+  applyHosts(new_hosts);
+
+  // If we didn't setup to initialize when our first round of health checking is complete, just
+  // do it now.
+  onPreInitComplete();
+}
+
+void EdsClusterImpl::applyHosts(std::vector<HostListPtr>& new_hosts) {
   for (size_t i = 0; i < new_hosts.size(); ++i) {
     if (new_hosts[i] != nullptr) {
       updateHostsPerLocality(priority_set_.getOrCreateHostSet(i), *new_hosts[i]);
     }
   }
 
-  // If we didn't setup to initialize when our first round of health checking is complete, just
-  // do it now.
-  onPreInitComplete();
+  if (merge_timer_ != nullptr) {
+    merge_window_open_ = true;
+    merge_timer_->enableTimer(info_->updateMergeWindow().value());
+  }
+}
+
+void EdsClusterImpl::onMergeWindowClosed() {
+  merge_window_open_ = false;
+  if (!pending_hosts_.empty()) {
+    std::vector<HostListPtr> new_hosts = std::move(pending_hosts_);
+    pending_hosts_.clear();
+    // This opens the next window, so a steady stream of updates is applied once per window.
+    applyHosts(new_hosts);
+  }
 }
 
 void EdsClusterImpl::updateHostsPerLocality(HostSet& host_set,
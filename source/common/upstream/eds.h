@@ -1,6 +1,7 @@
 #pragma once
 
 #include "envoy/config/subscription.h"
+#include "envoy/event/timer.h"
 #include "envoy/local_info/local_info.h"
 
 #include "common/upstream/upstream_impl.h"
@@ -12,7 +13,9 @@ namespace Envoy {
 namespace Upstream {
 
 /**
- * Cluster implementation that reads host information from the Endpoint Discovery Service.
+ * Cluster implementation that reads host information from the Endpoint Discovery Service. When the
+ * cluster has an update merge window, the updates that arrive within the window after an update
+ * is applied are held back, and only the latest of them is applied when the window closes.
  */
 class EdsClusterImpl : public BaseDynamicClusterImpl,
                        Config::SubscriptionCallbacks<envoy::api::v2::ClusterLoadAssignment> {
@@ -21,7 +24,7 @@ public:
                  Stats::Store& stats, Ssl::ContextManager& ssl_context_manager,
                  const LocalInfo::LocalInfo& local_info, ClusterManager& cm,
                  Event::Dispatcher& dispatcher, Runtime::RandomGenerator& random,
-                 bool added_via_api);
+                 bool added_via_api, ClusterInfoConstSharedPtr info = nullptr);
 
   const std::string versionInfo() const { return subscription_->versionInfo(); }
 
@@ -33,6 +36,10 @@ public:
   void onConfigUpdateFailed(const EnvoyException* e) override;
 
 private:
+  typedef std::unique_ptr<std::vector<HostSharedPtr>> HostListPtr;
+
+  void applyHosts(std::vector<HostListPtr>& new_hosts);
+  void onMergeWindowClosed();
   void updateHostsPerLocality(HostSet& host_set, std::vector<HostSharedPtr>& new_hosts);
 
   // ClusterImplBase
@@ -42,6 +49,10 @@ private:
   std::unique_ptr<Config::Subscription<envoy::api::v2::ClusterLoadAssignment>> subscription_;
   const LocalInfo::LocalInfo& local_info_;
   const std::string cluster_name_;
+  Event::TimerPtr merge_timer_;
+  bool merge_window_open_{};
+  // The hosts of the latest update held back during the merge window, by priority.
+  std::vector<HostListPtr> pending_hosts_;
 };
 
 } // namespace Upstream
@@ -12,10 +12,13 @@
 #include "envoy/stats/stats.h"
 
 #include "common/buffer/buffer_impl.h"
+#include "common/buffer/zero_copy_input_stream_impl.h"
 #include "common/common/empty_string.h"
 #include "common/common/enum_to_int.h"
+#include "common/common/hash.h"
 #include "common/common/hex.h"
 #include "common/common/utility.h"
+#include "common/grpc/common.h"
 #include "common/http/codec_client.h"
 #include "common/http/header_map_impl.h"
 #include "common/http/headers.h"
@@ -24,6 +27,8 @@
 #include "common/redis/conn_pool_impl.h"
 #include "common/upstream/host_utility.h"
 
+#include "fmt/format.h"
+
 namespace Envoy {
 namespace Upstream {
 
@@ -34,6 +39,10 @@ HealthCheckerSharedPtr HealthCheckerFactory::create(const envoy::api::v2::Health
                                                     Event::Dispatcher& dispatcher) {
   switch (hc_config.health_checker_case()) {
   case envoy::api::v2::HealthCheck::HealthCheckerCase::kHttpHealthCheck:
+    if (GrpcHealthCheckerImpl::isGrpcHealthCheck(hc_config)) {
+      return std::make_shared<ProdGrpcHealthCheckerImpl>(cluster, hc_config, dispatcher, runtime,
+                                                         random);
+    }
     return std::make_shared<ProdHttpHealthCheckerImpl>(cluster, hc_config, dispatcher, runtime,
                                                        random);
   case envoy::api::v2::HealthCheck::HealthCheckerCase::kTcpHealthCheck:
@@ -61,7 +70,9 @@ HealthCheckerImplBase::HealthCheckerImplBase(const Cluster& cluster,
       stats_(generateStats(cluster.info()->statsScope())), runtime_(runtime), random_(random),
       reuse_connection_(PROTOBUF_GET_WRAPPED_OR_DEFAULT(config, reuse_connection, true)),
       interval_(PROTOBUF_GET_MS_REQUIRED(config, interval)),
-      interval_jitter_(PROTOBUF_GET_MS_OR_DEFAULT(config, interval_jitter, 0)) {
+      interval_jitter_(PROTOBUF_GET_MS_OR_DEFAULT(config, interval_jitter, 0)),
+      partitions_(cluster.info()->healthCheckPartitions()),
+      partition_(partitions_ > 1 ? random_.random() % partitions_ : 0) {
   cluster_.prioritySet().addMemberUpdateCb(
       [this](uint32_t, const std::vector<HostSharedPtr>& hosts_added,
              const std::vector<HostSharedPtr>& hosts_removed) -> void {
@@ -114,12 +125,26 @@ std::chrono::milliseconds HealthCheckerImplBase::interval() const {
 void HealthCheckerImplBase::addHosts(const std::vector<HostSharedPtr>& hosts) {
   for (const HostSharedPtr& host : hosts) {
     active_sessions_[host] = makeSession(host);
+    if (!inherited_unhealthy_.empty() && inherited_unhealthy_.erase(host->address()->asString())) {
+      active_sessions_[host]->inheritUnhealthy();
+    }
     host->setHealthChecker(
         HealthCheckHostMonitorPtr{new HealthCheckHostMonitorImpl(shared_from_this(), host)});
     active_sessions_[host]->start();
   }
 }
 
+void HealthCheckerImplBase::inheritUnhealthyHosts(const std::vector<std::string>& addresses) {
+  // Hosts that are not in the cluster yet, e.g. those of a DNS cluster that has not resolved,
+  // inherit when they are added.
+  inherited_unhealthy_.insert(addresses.begin(), addresses.end());
+  for (auto& session : active_sessions_) {
+    if (inherited_unhealthy_.erase(session.first->address()->asString())) {
+      session.second->inheritUnhealthy();
+    }
+  }
+}
+
 void HealthCheckerImplBase::onClusterMemberUpdate(const std::vector<HostSharedPtr>& hosts_added,
                                                   const std::vector<HostSharedPtr>& hosts_removed) {
   addHosts(hosts_added);
@@ -130,6 +155,11 @@ void HealthCheckerImplBase::onClusterMemberUpdate(const std::vector<HostSharedPt
   }
 }
 
+bool HealthCheckerImplBase::probesHost(const Host& host) const {
+  return partitions_ == 1 ||
+         HashUtil::xxHash64(host.address()->asString()) % partitions_ == partition_;
+}
+
 void HealthCheckerImplBase::refreshHealthyStat() {
   // Each hot restarted process health checks independently. To make the stats easier to read,
   // we assume that both processes will converge and the last one that writes wins for the host.
@@ -171,8 +201,9 @@ void HealthCheckerImplBase::setUnhealthyCrossThread(const HostSharedPtr& host) {
       return;
     }
 
+    // Hosts that are not probed could never recover from a passive failure.
     const auto session = shared_this->active_sessions_.find(host);
-    if (session == shared_this->active_sessions_.end()) {
+    if (session == shared_this->active_sessions_.end() || !session->second->probed()) {
       return;
     }
 
@@ -188,9 +219,9 @@ void HealthCheckerImplBase::start() {
 
 HealthCheckerImplBase::ActiveHealthCheckSession::ActiveHealthCheckSession(
     HealthCheckerImplBase& parent, HostSharedPtr host)
-    : host_(host), parent_(parent),
-      interval_timer_(parent.dispatcher_.createTimer([this]() -> void { onIntervalBase(); })),
-      timeout_timer_(parent.dispatcher_.createTimer([this]() -> void { onTimeoutBase(); })) {
+    : host_(host), parent_(parent), probed_(parent.probesHost(*host)),
+      interval_timer_(parent.dispatcher_.createCoarseTimer([this]() -> void { onIntervalBase(); })),
+      timeout_timer_(parent.dispatcher_.createCoarseTimer([this]() -> void { onTimeoutBase(); })) {
 
   if (!host->healthFlagGet(Host::HealthFlag::FAILED_ACTIVE_HC)) {
     parent.incHealthy();
@@ -203,6 +234,15 @@ HealthCheckerImplBase::ActiveHealthCheckSession::~ActiveHealthCheckSession() {
   }
 }
 
+void HealthCheckerImplBase::ActiveHealthCheckSession::start() {
+  if (probed_) {
+    onIntervalBase();
+  } else {
+    // Like a probe result, this is reported after cluster initialization started waiting for it.
+    interval_timer_->enableTimer(std::chrono::milliseconds(0));
+  }
+}
+
 void HealthCheckerImplBase::ActiveHealthCheckSession::handleSuccess() {
   // If we are healthy, reset the # of unhealthy to zero.
   num_unhealthy_ = 0;
@@ -258,6 +298,11 @@ void HealthCheckerImplBase::ActiveHealthCheckSession::handleFailure(FailureType
 }
 
 void HealthCheckerImplBase::ActiveHealthCheckSession::onIntervalBase() {
+  if (!probed_) {
+    onUnprobed();
+    return;
+  }
+
   onInterval();
   timeout_timer_->enableTimer(parent_.timeout_);
   parent_.stats_.attempt_.inc();
@@ -268,6 +313,19 @@ void HealthCheckerImplBase::ActiveHealthCheckSession::onTimeoutBase() {
   handleFailure(FailureType::Network);
 }
 
+void HealthCheckerImplBase::ActiveHealthCheckSession::onUnprobed() {
+  // Another Envoy probes the host, so it is assumed to be healthy from now on.
+  bool changed_state = false;
+  if (host_->healthFlagGet(Host::HealthFlag::FAILED_ACTIVE_HC)) {
+    host_->healthFlagClear(Host::HealthFlag::FAILED_ACTIVE_HC);
+    parent_.incHealthy();
+    changed_state = true;
+  }
+
+  first_check_ = false;
+  parent_.runCallbacks(host_, changed_state);
+}
+
 HttpHealthCheckerImpl::HttpHealthCheckerImpl(const Cluster& cluster,
                                              const envoy::api::v2::HealthCheck& config,
                                              Event::Dispatcher& dispatcher,
@@ -394,7 +452,201 @@ void HttpHealthCheckerImpl::HttpActiveHealthCheckSession::onTimeout() {
 
 Http::CodecClient*
 ProdHttpHealthCheckerImpl::createCodecClient(Upstream::Host::CreateConnectionData& data) {
-  return new Http::CodecClientProd(Http::CodecClient::Type::HTTP1, std::move(data.connection_),
+  // HTTP/2 clusters are health checked over HTTP/2 as well.
+  const Http::CodecClient::Type type =
+      (cluster_.info()->features() & ClusterInfo::Features::HTTP2) ? Http::CodecClient::Type::HTTP2
+                                                                  : Http::CodecClient::Type::HTTP1;
+  return new Http::CodecClientProd(type, std::move(data.connection_), data.host_description_);
+}
+
+namespace {
+
+const std::string GRPC_HEALTH_CHECK_PATH = "/grpc.health.v1.Health/Check";
+
+} // namespace
+
+GrpcHealthCheckerImpl::GrpcHealthCheckerImpl(const Cluster& cluster,
+                                             const envoy::api::v2::HealthCheck& config,
+                                             Event::Dispatcher& dispatcher,
+                                             Runtime::Loader& runtime,
+                                             Runtime::RandomGenerator& random)
+    : HealthCheckerImplBase(cluster, config, dispatcher, runtime, random) {
+  if (!config.http_health_check().service_name().empty()) {
+    service_name_.value(config.http_health_check().service_name());
+  }
+}
+
+bool GrpcHealthCheckerImpl::isGrpcHealthCheck(const envoy::api::v2::HealthCheck& config) {
+  return config.health_checker_case() ==
+             envoy::api::v2::HealthCheck::HealthCheckerCase::kHttpHealthCheck &&
+         config.http_health_check().path() == GRPC_HEALTH_CHECK_PATH;
+}
+
+GrpcHealthCheckerImpl::GrpcActiveHealthCheckSession::GrpcActiveHealthCheckSession(
+    GrpcHealthCheckerImpl& parent, HostSharedPtr host)
+    : ActiveHealthCheckSession(parent, host), parent_(parent) {}
+
+GrpcHealthCheckerImpl::GrpcActiveHealthCheckSession::~GrpcActiveHealthCheckSession() {
+  if (client_) {
+    // If there is an active request it will get reset, so make sure we ignore the reset.
+    expect_reset_ = true;
+    client_->close();
+  }
+}
+
+void GrpcHealthCheckerImpl::GrpcActiveHealthCheckSession::decodeHeaders(
+    Http::HeaderMapPtr&& headers, bool end_stream) {
+  const uint64_t response_code = Http::Utility::getResponseStatus(*headers);
+  if (response_code != enumToInt(Http::Code::OK)) {
+    onProtocolError(fmt::format("non-200 HTTP response code {}", response_code));
+    return;
+  }
+  if (!Grpc::Common::hasGrpcContentType(*headers)) {
+    onProtocolError("invalid gRPC content type");
+    return;
+  }
+  if (end_stream) {
+    // A trailers only response carries the gRPC status in the headers.
+    decodeTrailers(std::move(headers));
+  }
+}
+
+void GrpcHealthCheckerImpl::GrpcActiveHealthCheckSession::decodeData(Buffer::Instance& data,
+                                                                     bool end_stream) {
+  std::vector<Grpc::Frame> frames;
+  if (!decoder_.decode(data, frames)) {
+    onProtocolError("invalid gRPC frame");
+    return;
+  }
+  for (Grpc::Frame& frame : frames) {
+    if (health_check_response_ != nullptr) {
+      onProtocolError("more than one gRPC response message");
+      return;
+    }
+    if (frame.flags_ != Grpc::GRPC_FH_DEFAULT) {
+      onProtocolError("compressed gRPC response message");
+      return;
+    }
+    health_check_response_.reset(new grpc::health::v1::HealthCheckResponse());
+    // An empty message has no data.
+    if (frame.length_ > 0) {
+      Buffer::ZeroCopyInputStreamImpl stream(std::move(frame.data_));
+      if (!health_check_response_->ParseFromZeroCopyStream(&stream)) {
+        onProtocolError("invalid gRPC response message");
+        return;
+      }
+    }
+  }
+  if (end_stream) {
+    onProtocolError("gRPC response without trailers");
+  }
+}
+
+void GrpcHealthCheckerImpl::GrpcActiveHealthCheckSession::decodeTrailers(
+    Http::HeaderMapPtr&& trailers) {
+  const Optional<Grpc::Status::GrpcStatus> grpc_status = Grpc::Common::getGrpcStatus(*trailers);
+  onRpcComplete(grpc_status.valid() ? grpc_status.value() : Grpc::Status::GrpcStatus::Unknown);
+}
+
+void GrpcHealthCheckerImpl::GrpcActiveHealthCheckSession::onEvent(Network::ConnectionEvent event) {
+  if (event == Network::ConnectionEvent::RemoteClose ||
+      event == Network::ConnectionEvent::LocalClose) {
+    // As for the HTTP health checker, a new timer is already set up if needed, so there is
+    // nothing to do here other than blow away the client.
+    parent_.dispatcher_.deferredDelete(std::move(client_));
+  }
+}
+
+void GrpcHealthCheckerImpl::GrpcActiveHealthCheckSession::onInterval() {
+  if (!client_) {
+    Upstream::Host::CreateConnectionData conn = host_->createConnection(parent_.dispatcher_);
+    client_.reset(parent_.createCodecClient(conn));
+    client_->addConnectionCallbacks(connection_callback_impl_);
+    expect_reset_ = false;
+  }
+
+  decoder_ = Grpc::Decoder();
+  health_check_response_.reset();
+  rpc_active_ = true;
+
+  Http::StreamEncoder& request_encoder = client_->newStream(*this);
+  request_encoder.getStream().addCallbacks(*this);
+
+  Http::HeaderMapImpl request_headers{
+      {Http::Headers::get().Method, "POST"},
+      {Http::Headers::get().Host, parent_.cluster_.info()->name()},
+      {Http::Headers::get().Path, GRPC_HEALTH_CHECK_PATH},
+      {Http::Headers::get().ContentType, Http::Headers::get().ContentTypeValues.Grpc},
+      {Http::Headers::get().TE, Http::Headers::get().TEValues.Trailers},
+      {Http::Headers::get().UserAgent, Http::Headers::get().UserAgentValues.EnvoyHealthChecker}};
+  request_encoder.encodeHeaders(request_headers, false);
+
+  grpc::health::v1::HealthCheckRequest request;
+  if (parent_.service_name_.valid()) {
+    request.set_service(parent_.service_name_.value());
+  }
+  request_encoder.encodeData(*Grpc::Common::serializeBody(request), true);
+}
+
+void GrpcHealthCheckerImpl::GrpcActiveHealthCheckSession::onResetStream(Http::StreamResetReason) {
+  if (expect_reset_ || !rpc_active_) {
+    return;
+  }
+
+  ENVOY_CONN_LOG(debug, "connection/stream error health_flags={}", *client_,
+                 HostUtility::healthFlagsToString(*host_));
+  rpc_active_ = false;
+  handleFailure(FailureType::Network);
+}
+
+void GrpcHealthCheckerImpl::GrpcActiveHealthCheckSession::onRpcComplete(
+    Grpc::Status::GrpcStatus grpc_status) {
+  ASSERT(rpc_active_);
+  rpc_active_ = false;
+
+  const bool serving = grpc_status == Grpc::Status::GrpcStatus::Ok &&
+                       health_check_response_ != nullptr &&
+                       health_check_response_->status() ==
+                           grpc::health::v1::HealthCheckResponse::SERVING;
+  ENVOY_CONN_LOG(debug, "hc grpc_status={} serving={} health_flags={}", *client_, grpc_status,
+                 serving, HostUtility::healthFlagsToString(*host_));
+  if (serving) {
+    handleSuccess();
+  } else {
+    handleFailure(FailureType::Active);
+  }
+
+  if (!parent_.reuse_connection_) {
+    expect_reset_ = true;
+    client_->close();
+  }
+}
+
+void GrpcHealthCheckerImpl::GrpcActiveHealthCheckSession::onProtocolError(
+    const std::string& error) {
+  ENVOY_CONN_LOG(debug, "hc protocol error: {} health_flags={}", *client_, error,
+                 HostUtility::healthFlagsToString(*host_));
+  rpc_active_ = false;
+  handleFailure(FailureType::Active);
+
+  // The rest of the response is of no use, so the connection is closed along with the stream.
+  expect_reset_ = true;
+  client_->close();
+}
+
+void GrpcHealthCheckerImpl::GrpcActiveHealthCheckSession::onTimeout() {
+  ENVOY_CONN_LOG(debug, "connection/stream timeout health_flags={}", *client_,
+                 HostUtility::healthFlagsToString(*host_));
+
+  // If there is an active request it will get reset, so make sure we ignore the reset.
+  rpc_active_ = false;
+  expect_reset_ = true;
+  client_->close();
+}
+
+Http::CodecClient*
+ProdGrpcHealthCheckerImpl::createCodecClient(Upstream::Host::CreateConnectionData& data) {
+  return new Http::CodecClientProd(Http::CodecClient::Type::HTTP2, std::move(data.connection_),
                                    data.host_description_);
 }
 
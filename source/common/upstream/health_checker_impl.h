@@ -6,9 +6,11 @@
 #include <memory>
 #include <string>
 #include <unordered_map>
+#include <unordered_set>
 #include <vector>
 
 #include "envoy/event/timer.h"
+#include "envoy/grpc/status.h"
 #include "envoy/http/codec.h"
 #include "envoy/network/connection.h"
 #include "envoy/network/filter.h"
@@ -17,11 +19,13 @@
 #include "envoy/upstream/health_checker.h"
 
 #include "common/common/logger.h"
+#include "common/grpc/codec.h"
 #include "common/http/codec_client.h"
 #include "common/network/filter_impl.h"
 #include "common/protobuf/protobuf.h"
 
 #include "api/health_check.pb.h"
+#include "source/common/grpc/health.pb.h"
 
 namespace Envoy {
 namespace Upstream {
@@ -68,7 +72,10 @@ struct HealthCheckerStats {
 };
 
 /**
- * Base implementation for both the HTTP and TCP health checker.
+ * Base implementation for both the HTTP and TCP health checker. When the hosts of the cluster are
+ * split into health check partitions, this Envoy only probes the hosts of a randomly chosen
+ * partition, and the hosts of the other partitions are reported healthy once and then left to the
+ * Envoys probing them.
  */
 class HealthCheckerImplBase : public HealthChecker,
                               protected Logger::Loggable<Logger::Id::hc>,
@@ -77,6 +84,7 @@ public:
   // Upstream::HealthChecker
   void addHostCheckCompleteCb(HostStatusCb callback) override { callbacks_.push_back(callback); }
   void start() override;
+  void inheritUnhealthyHosts(const std::vector<std::string>& addresses) override;
 
 protected:
   class ActiveHealthCheckSession {
@@ -84,8 +92,10 @@ protected:
     enum class FailureType { Active, Passive, Network };
 
     virtual ~ActiveHealthCheckSession();
+    void inheritUnhealthy() { first_check_ = false; }
+    bool probed() const { return probed_; }
     void setUnhealthy(FailureType type);
-    void start() { onIntervalBase(); }
+    void start();
 
   protected:
     ActiveHealthCheckSession(HealthCheckerImplBase& parent, HostSharedPtr host);
@@ -100,8 +110,10 @@ protected:
     void onIntervalBase();
     virtual void onTimeout() PURE;
     void onTimeoutBase();
+    void onUnprobed();
 
     HealthCheckerImplBase& parent_;
+    const bool probed_;
     Event::TimerPtr interval_timer_;
     Event::TimerPtr timeout_timer_;
     uint32_t num_unhealthy_{};
@@ -147,6 +159,7 @@ private:
   std::chrono::milliseconds interval() const;
   void onClusterMemberUpdate(const std::vector<HostSharedPtr>& hosts_added,
                              const std::vector<HostSharedPtr>& hosts_removed);
+  bool probesHost(const Host& host) const;
   void refreshHealthyStat();
   void runCallbacks(HostSharedPtr host, bool changed_state);
   void setUnhealthyCrossThread(const HostSharedPtr& host);
@@ -157,7 +170,11 @@ private:
   const std::chrono::milliseconds interval_;
   const std::chrono::milliseconds interval_jitter_;
   std::unordered_map<HostSharedPtr, ActiveHealthCheckSessionPtr> active_sessions_;
+  // Inherited unhealthy hosts that have no session yet, by address.
+  std::unordered_set<std::string> inherited_unhealthy_;
   uint64_t local_process_healthy_{};
+  const uint32_t partitions_;
+  const uint32_t partition_;
 };
 
 /**
@@ -243,6 +260,94 @@ public:
   Http::CodecClient* createCodecClient(Upstream::Host::CreateConnectionData& data) override;
 };
 
+/**
+ * gRPC health checker implementation, which follows the gRPC health checking protocol
+ * (https://github.com/grpc/grpc/blob/master/doc/health-checking.md). It is used for the HTTP
+ * health checks with the path of the grpc.health.v1.Health/Check method, and the service name of
+ * the health check is the service that is checked. The probes are sent over an HTTP/2 connection
+ * to each host that is kept open between them.
+ */
+class GrpcHealthCheckerImpl : public HealthCheckerImplBase {
+public:
+  GrpcHealthCheckerImpl(const Cluster& cluster, const envoy::api::v2::HealthCheck& config,
+                        Event::Dispatcher& dispatcher, Runtime::Loader& runtime,
+                        Runtime::RandomGenerator& random);
+
+  /**
+   * @param config supplies the health check proto.
+   * @return bool whether the health check uses the gRPC health checking protocol.
+   */
+  static bool isGrpcHealthCheck(const envoy::api::v2::HealthCheck& config);
+
+private:
+  struct GrpcActiveHealthCheckSession : public ActiveHealthCheckSession,
+                                        public Http::StreamDecoder,
+                                        public Http::StreamCallbacks {
+    GrpcActiveHealthCheckSession(GrpcHealthCheckerImpl& parent, HostSharedPtr host);
+    ~GrpcActiveHealthCheckSession();
+
+    void onRpcComplete(Grpc::Status::GrpcStatus grpc_status);
+    void onProtocolError(const std::string& error);
+
+    // ActiveHealthCheckSession
+    void onInterval() override;
+    void onTimeout() override;
+
+    // Http::StreamDecoder
+    void decodeHeaders(Http::HeaderMapPtr&& headers, bool end_stream) override;
+    void decodeData(Buffer::Instance& data, bool end_stream) override;
+    void decodeTrailers(Http::HeaderMapPtr&& trailers) override;
+
+    // Http::StreamCallbacks
+    void onResetStream(Http::StreamResetReason reason) override;
+    void onAboveWriteBufferHighWatermark() override {}
+    void onBelowWriteBufferLowWatermark() override {}
+
+    void onEvent(Network::ConnectionEvent event);
+
+    class ConnectionCallbackImpl : public Network::ConnectionCallbacks {
+    public:
+      ConnectionCallbackImpl(GrpcActiveHealthCheckSession& parent) : parent_(parent) {}
+      // Network::ConnectionCallbacks
+      void onEvent(Network::ConnectionEvent event) override { parent_.onEvent(event); }
+      void onAboveWriteBufferHighWatermark() override {}
+      void onBelowWriteBufferLowWatermark() override {}
+
+    private:
+      GrpcActiveHealthCheckSession& parent_;
+    };
+
+    ConnectionCallbackImpl connection_callback_impl_{*this};
+    GrpcHealthCheckerImpl& parent_;
+    Http::CodecClientPtr client_;
+    Grpc::Decoder decoder_;
+    std::unique_ptr<grpc::health::v1::HealthCheckResponse> health_check_response_;
+    // True while the request of the current probe is in flight.
+    bool rpc_active_{};
+    bool expect_reset_{};
+  };
+
+  virtual Http::CodecClient* createCodecClient(Upstream::Host::CreateConnectionData& data) PURE;
+
+  // HealthCheckerImplBase
+  ActiveHealthCheckSessionPtr makeSession(HostSharedPtr host) override {
+    return ActiveHealthCheckSessionPtr{new GrpcActiveHealthCheckSession(*this, host)};
+  }
+
+  Optional<std::string> service_name_;
+};
+
+/**
+ * Production implementation of the gRPC health checker that allocates a real codec client.
+ */
+class ProdGrpcHealthCheckerImpl : public GrpcHealthCheckerImpl {
+public:
+  using GrpcHealthCheckerImpl::GrpcHealthCheckerImpl;
+
+  // GrpcHealthCheckerImpl
+  Http::CodecClient* createCodecClient(Upstream::Host::CreateConnectionData& data) override;
+};
+
 /**
  * Utility class for loading a binary health checking config and matching it against a buffer.
  * Split out for ease of testing. The type of matching performed is the following (this is the
@@ -9,6 +9,7 @@
 #include "envoy/upstream/upstream.h"
 
 #include "common/common/assert.h"
+#include "common/upstream/local_active_requests.h"
 
 namespace Envoy {
 namespace Upstream {
@@ -16,6 +17,12 @@ namespace Upstream {
 static const std::string RuntimeZoneEnabled = "upstream.zone_routing.enabled";
 static const std::string RuntimeMinClusterSize = "upstream.zone_routing.min_cluster_size";
 static const std::string RuntimePanicThreshold = "upstream.healthy_panic_threshold";
+static const std::string RuntimeWeightEnabled = "upstream.weight_enabled";
+static const std::string RuntimeLocalActiveRequests =
+    "upstream.least_request.local_active_requests";
+// The cost in the peak EWMA load balancer of a busy host without a response time estimate, which
+// is that of a host taking 1000s per request.
+static const double PeakEwmaPenaltyCost = 1000000;
 
 uint32_t LoadBalancerBase::choosePriority(uint64_t hash,
                                           const std::vector<uint32_t>& per_priority_load) {
@@ -188,32 +195,60 @@ void ZoneAwareLoadBalancerBase::regenerateLocalityRoutingStructures() {
   // locality we should route. Percentage of requests routed cross locality to a specific locality
   // needed be proportional to the residual capacity upstream locality has.
   //
-  // residual_capacity contains capacity left in a given locality, we keep accumulating residual
-  // capacity to make search for sampled value easier.
+  // residual_capacity contains capacity left in a given locality.
   // For example, if we have the following upstream and local percentage:
   // local_percentage: 40000 40000 20000
   // upstream_percentage: 25000 50000 25000
   // Residual capacity would look like: 0 10000 5000. Now we need to sample proportionally to
-  // bucket sizes (residual capacity). For simplicity of finding where specific
-  // sampled value is, we accumulate values in residual capacity. This is what it will look like:
-  // residual_capacity: 0 10000 15000
-  // Now to find a locality to route (bucket) we could simply iterate over residual_capacity
-  // searching where sampled value is placed.
-  state.residual_capacity_.resize(num_localities);
+  // bucket sizes (residual capacity), which the alias table built below does with a single sample.
+  uint64_t residual_capacity[num_localities];
 
   // Local locality (index 0) does not have residual capacity as we have routed all we could.
-  state.residual_capacity_[0] = 0;
+  residual_capacity[0] = 0;
+  state.residual_capacity_ = 0;
   for (size_t i = 1; i < num_localities; ++i) {
     // Only route to the localities that have additional capacity.
-    if (upstream_percentage[i] > local_percentage[i]) {
-      state.residual_capacity_[i] =
-          state.residual_capacity_[i - 1] + upstream_percentage[i] - local_percentage[i];
-    } else {
-      // Locality with index "i" does not have residual capacity, but we keep accumulating previous
-      // values to make search easier on the next step.
-      state.residual_capacity_[i] = state.residual_capacity_[i - 1];
+    residual_capacity[i] = upstream_percentage[i] > local_percentage[i]
+                               ? upstream_percentage[i] - local_percentage[i]
+                               : 0;
+    state.residual_capacity_ += residual_capacity[i];
+  }
+
+  // Vose's alias method: every entry of the table covers residual_capacity_ / num_localities of
+  // the capacity, made of part of its own locality's capacity and the rest from a single other
+  // locality. Scaling the capacities by num_localities keeps the thresholds exact integers.
+  // Continuing the example, the scaled capacities are 0 30000 15000 against 15000 per entry,
+  // which gives the table {0, alias 1} {15000} {15000}.
+  state.residual_alias_table_.assign(num_localities, {state.residual_capacity_, 0});
+  if (state.residual_capacity_ == 0) {
+    return;
+  }
+  uint64_t scaled_capacity[num_localities];
+  std::vector<uint32_t> small;
+  std::vector<uint32_t> large;
+  for (size_t i = 0; i < num_localities; ++i) {
+    scaled_capacity[i] = residual_capacity[i] * num_localities;
+    if (scaled_capacity[i] < state.residual_capacity_) {
+      small.push_back(i);
+    } else if (scaled_capacity[i] > state.residual_capacity_) {
+      large.push_back(i);
+    }
+  }
+  while (!small.empty() && !large.empty()) {
+    const uint32_t less = small.back();
+    small.pop_back();
+    const uint32_t more = large.back();
+    state.residual_alias_table_[less] = {scaled_capacity[less], more};
+    scaled_capacity[more] -= state.residual_capacity_ - scaled_capacity[less];
+    if (scaled_capacity[more] <= state.residual_capacity_) {
+      large.pop_back();
+      if (scaled_capacity[more] < state.residual_capacity_) {
+        small.push_back(more);
+      }
     }
   }
+  // The localities that cover exactly one entry keep the default threshold, which always picks the
+  // entry's own locality.
 };
 
 void ZoneAwareLoadBalancerBase::resizePerPriorityState() {
@@ -310,23 +345,21 @@ ZoneAwareLoadBalancerBase::tryChooseLocalLocalityHosts(const HostSet& host_set)
 
   // This is *extremely* unlikely but possible due to rounding errors when calculating
   // locality percentages. In this case just select random locality.
-  if (state.residual_capacity_[number_of_localities - 1] == 0) {
+  if (state.residual_capacity_ == 0) {
     stats_.lb_zone_no_capacity_left_.inc();
     return host_set.healthyHostsPerLocality()[random_.random() % number_of_localities];
   }
 
   // Random sampling to select specific locality for cross locality traffic based on the additional
-  // capacity in localities.
-  uint64_t threshold = random_.random() % state.residual_capacity_[number_of_localities - 1];
-
-  // This potentially can be optimized to be O(log(N)) where N is the number of localities.
-  // Linear scan should be faster for smaller N, in most of the scenarios N will be small.
-  int i = 0;
-  while (threshold > state.residual_capacity_[i]) {
-    i++;
-  }
-
-  return host_set.healthyHostsPerLocality()[i];
+  // capacity in localities. A single random value picks both the alias table entry and the sample
+  // within it.
+  const uint64_t random = random_.random();
+  const uint32_t entry = random % number_of_localities;
+  const PerPriorityState::AliasEntry& alias_entry = state.residual_alias_table_[entry];
+  if ((random / number_of_localities) % state.residual_capacity_ < alias_entry.threshold_) {
+    return host_set.healthyHostsPerLocality()[entry];
+  }
+  return host_set.healthyHostsPerLocality()[alias_entry.alias_];
 }
 
 const std::vector<HostSharedPtr>& ZoneAwareLoadBalancerBase::hostsToUse() {
@@ -360,69 +393,86 @@ const std::vector<HostSharedPtr>& ZoneAwareLoadBalancerBase::hostsToUse() {
   return tryChooseLocalLocalityHosts(host_set);
 }
 
-HostConstSharedPtr RoundRobinLoadBalancer::chooseHost(LoadBalancerContext*) {
+EdfLoadBalancerBase::EdfLoadBalancerBase(const PrioritySet& priority_set,
+                                         const PrioritySet* local_priority_set,
+                                         ClusterStats& stats, Runtime::Loader& runtime,
+                                         Runtime::RandomGenerator& random)
+    : ZoneAwareLoadBalancerBase(priority_set, local_priority_set, stats, runtime, random) {
+  priority_set.addMemberUpdateCb(
+      [this](uint32_t, const std::vector<HostSharedPtr>&,
+             const std::vector<HostSharedPtr>&) -> void { schedulers_.clear(); });
+}
+
+HostConstSharedPtr EdfLoadBalancerBase::chooseHost(LoadBalancerContext*) {
   const std::vector<HostSharedPtr>& hosts_to_use = hostsToUse();
   if (hosts_to_use.empty()) {
     return nullptr;
   }
 
-  return hosts_to_use[rr_index_++ % hosts_to_use.size()];
-}
+  // The max host weight gauge is left at 0 by clusters that do not track it, whose hosts all have
+  // a weight of 1.
+  if (stats_.max_host_weight_.value() <= 1 ||
+      runtime_.snapshot().getInteger(RuntimeWeightEnabled, 1UL) == 0) {
+    return unweightedHostPick(hosts_to_use);
+  }
 
-LeastRequestLoadBalancer::LeastRequestLoadBalancer(const PrioritySet& priority_set,
-                                                   const PrioritySet* local_priority_set,
-                                                   ClusterStats& stats, Runtime::Loader& runtime,
-                                                   Runtime::RandomGenerator& random)
-    : ZoneAwareLoadBalancerBase(priority_set, local_priority_set, stats, runtime, random) {
-  priority_set.addMemberUpdateCb([this](uint32_t, const std::vector<HostSharedPtr>&,
-                                        const std::vector<HostSharedPtr>& hosts_removed) -> void {
-    if (last_host_) {
-      for (const HostSharedPtr& host : hosts_removed) {
-        if (host == last_host_) {
-          hits_left_ = 0;
-          last_host_.reset();
-
-          break;
-        }
-      }
+  Scheduler& scheduler = schedulers_[&hosts_to_use];
+  if (scheduler.hosts_size_ != hosts_to_use.size()) {
+    scheduler = Scheduler();
+    scheduler.hosts_size_ = hosts_to_use.size();
+    for (const HostSharedPtr& host : hosts_to_use) {
+      scheduler.edf_.add(hostWeight(*host), host);
     }
-  });
-}
-
-HostConstSharedPtr LeastRequestLoadBalancer::chooseHost(LoadBalancerContext*) {
-  bool is_weight_imbalanced = stats_.max_host_weight_.value() != 1;
-  bool is_weight_enabled = runtime_.snapshot().getInteger("upstream.weight_enabled", 1UL) != 0;
+  }
 
-  if (is_weight_imbalanced && hits_left_ > 0 && is_weight_enabled) {
-    --hits_left_;
+  HostSharedPtr host = scheduler.edf_.pick();
+  scheduler.edf_.add(hostWeight(*host), host);
+  return host;
+}
 
-    return last_host_;
+HostConstSharedPtr
+LeastRequestLoadBalancer::unweightedHostPick(const std::vector<HostSharedPtr>& hosts_to_use) {
+  const bool local = useLocalActiveRequests();
+  HostSharedPtr host1 = hosts_to_use[random_.random() % hosts_to_use.size()];
+  HostSharedPtr host2 = hosts_to_use[random_.random() % hosts_to_use.size()];
+  if (activeRequests(*host1, local) < activeRequests(*host2, local)) {
+    return host1;
   } else {
-    // To avoid hit stale last_host_ when all hosts become weight balanced.
-    hits_left_ = 0;
-    last_host_.reset();
+    return host2;
   }
+}
+
+bool LeastRequestLoadBalancer::useLocalActiveRequests() {
+  return runtime_.snapshot().featureEnabled(RuntimeLocalActiveRequests, 0);
+}
 
+uint64_t LeastRequestLoadBalancer::activeRequests(const Host& host, bool local) {
+  return local ? LocalActiveRequests::value(host) : host.stats().rq_active_.value();
+}
+
+HostConstSharedPtr PeakEwmaLoadBalancer::chooseHost(LoadBalancerContext*) {
   const std::vector<HostSharedPtr>& hosts_to_use = hostsToUse();
   if (hosts_to_use.empty()) {
     return nullptr;
   }
 
-  // Make weighed random if we have hosts with non 1 weights.
-  if (is_weight_imbalanced & is_weight_enabled) {
-    last_host_ = hosts_to_use[random_.random() % hosts_to_use.size()];
-    hits_left_ = last_host_->weight() - 1;
-
-    return last_host_;
+  HostSharedPtr host1 = hosts_to_use[random_.random() % hosts_to_use.size()];
+  HostSharedPtr host2 = hosts_to_use[random_.random() % hosts_to_use.size()];
+  if (cost(*host1) < cost(*host2)) {
+    return host1;
   } else {
-    HostSharedPtr host1 = hosts_to_use[random_.random() % hosts_to_use.size()];
-    HostSharedPtr host2 = hosts_to_use[random_.random() % hosts_to_use.size()];
-    if (host1->stats().rq_active_.value() < host2->stats().rq_active_.value()) {
-      return host1;
-    } else {
-      return host2;
-    }
+    return host2;
+  }
+}
+
+double PeakEwmaLoadBalancer::cost(const Host& host) {
+  const uint64_t active_requests = host.stats().rq_active_.value();
+  const double response_time = host.responseTimeEstimate();
+  if (response_time == 0 && active_requests != 0) {
+    // Nothing is known about the host yet but it is already busy.
+    return PeakEwmaPenaltyCost + active_requests;
   }
+  return response_time * (active_requests + 1);
 }
 
 HostConstSharedPtr RandomLoadBalancer::chooseHost(LoadBalancerContext*) {
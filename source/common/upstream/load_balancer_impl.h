@@ -2,12 +2,15 @@
 
 #include <cstdint>
 #include <set>
+#include <unordered_map>
 #include <vector>
 
 #include "envoy/runtime/runtime.h"
 #include "envoy/upstream/load_balancer.h"
 #include "envoy/upstream/upstream.h"
 
+#include "common/upstream/edf_scheduler.h"
+
 #include "api/cds.pb.h"
 
 namespace Envoy {
@@ -125,10 +128,17 @@ private:
     uint64_t local_percent_to_route_{};
     // Tracks the current state of locality based routing.
     LocalityRoutingState locality_routing_state_{LocalityRoutingState::NoLocalityRouting};
-    // When locality_routing_state_ == LocalityResidual this tracks the capacity
-    // for each of the non-local localities to determine what traffic should be
-    // routed where.
-    std::vector<uint64_t> residual_capacity_;
+    // When locality_routing_state_ == LocalityResidual this tracks the total capacity of the
+    // non-local localities, and an alias table (https://en.wikipedia.org/wiki/Alias_method) that
+    // picks each locality in proportion to its residual capacity in constant time.
+    uint64_t residual_capacity_{};
+    struct AliasEntry {
+      // A sample in [0, residual_capacity_) below this picks the entry's own locality, and
+      // otherwise its alias.
+      uint64_t threshold_;
+      uint32_t alias_;
+    };
+    std::vector<AliasEntry> residual_alias_table_;
   };
   typedef std::unique_ptr<PerPriorityState> PerPriorityStatePtr;
   // Routing state broken out for each priority level in priority_set_.
@@ -136,20 +146,65 @@ private:
   Common::CallbackHandle* local_priority_set_member_update_cb_handle_{};
 };
 
+/**
+ * Base class for the load balancers that pick weighted hosts with an EDF scheduler. When the
+ * cluster has hosts with weights other than 1 (and the upstream.weight_enabled runtime key is not
+ * 0), picks follow a schedule of the host list returned by hostsToUse(), in which each host gets
+ * a share of the picks proportional to hostWeight(). Otherwise picks are left to
+ * unweightedHostPick(). The schedules are built on first use, and dropped when the hosts change.
+ */
+class EdfLoadBalancerBase : public LoadBalancer, public ZoneAwareLoadBalancerBase {
+public:
+  // Upstream::LoadBalancer
+  HostConstSharedPtr chooseHost(LoadBalancerContext* context) override;
+
+protected:
+  EdfLoadBalancerBase(const PrioritySet& priority_set, const PrioritySet* local_priority_set,
+                      ClusterStats& stats, Runtime::Loader& runtime,
+                      Runtime::RandomGenerator& random);
+
+private:
+  struct Scheduler {
+    EdfScheduler<Host> edf_;
+    // The size of the host list the schedule was built from.
+    size_t hosts_size_{};
+  };
+
+  /**
+   * @return double the weight of a host in the schedule, evaluated when the host is (re)added.
+   */
+  virtual double hostWeight(const Host& host) PURE;
+
+  /**
+   * Pick a host when the hosts are not weighted.
+   * @param hosts_to_use supplies the non-empty host list to pick from.
+   */
+  virtual HostConstSharedPtr
+  unweightedHostPick(const std::vector<HostSharedPtr>& hosts_to_use) PURE;
+
+  // The schedule of each host list returned by hostsToUse(), keyed by the address of the list.
+  // The lists are replaced rather than modified when the hosts change, which also clears this.
+  std::unordered_map<const std::vector<HostSharedPtr>*, Scheduler> schedulers_;
+};
+
 /**
  * Implementation of LoadBalancer that performs RR selection across the hosts in the cluster.
+ * Weighted hosts are picked in proportion to their weights.
  */
-class RoundRobinLoadBalancer : public LoadBalancer, ZoneAwareLoadBalancerBase {
+class RoundRobinLoadBalancer : public EdfLoadBalancerBase {
 public:
   RoundRobinLoadBalancer(const PrioritySet& priority_set, const PrioritySet* local_priority_set,
                          ClusterStats& stats, Runtime::Loader& runtime,
                          Runtime::RandomGenerator& random)
-      : ZoneAwareLoadBalancerBase(priority_set, local_priority_set, stats, runtime, random) {}
-
-  // Upstream::LoadBalancer
-  HostConstSharedPtr chooseHost(LoadBalancerContext* context) override;
+      : EdfLoadBalancerBase(priority_set, local_priority_set, stats, runtime, random) {}
 
 private:
+  // EdfLoadBalancerBase
+  double hostWeight(const Host& host) override { return host.weight(); }
+  HostConstSharedPtr unweightedHostPick(const std::vector<HostSharedPtr>& hosts_to_use) override {
+    return hosts_to_use[rr_index_++ % hosts_to_use.size()];
+  }
+
   size_t rr_index_{};
 };
 
@@ -160,24 +215,56 @@ private:
  * and compares number of active requests.
  * Technique is based on http://www.eecs.harvard.edu/~michaelm/postscripts/mythesis.pdf
  *
- * When any of the hosts have non 1 weight, apply random weighted balancing.
- * Randomly pickup the host and send 'weight' number of requests to it.
- * This technique is acceptable for load testing but
- * will not work well in situations where requests take a long time.
- * In that case a different algorithm using a full scan will be required.
+ * When any of the hosts have non 1 weight, hosts are picked with weighted round robin where the
+ * weight of a host is divided by its number of active requests plus one, so that busy hosts are
+ * picked less often than their weight alone would have them.
+ *
+ * The active requests are those of the host across all workers, unless the
+ * upstream.least_request.local_active_requests runtime feature is enabled, in which case only the
+ * requests that are active on the worker of the load balancer are counted (see
+ * LocalActiveRequests). With many workers these are a noisier measure of how busy a host is, but
+ * reading them does not contend with other workers.
  */
-class LeastRequestLoadBalancer : public LoadBalancer, ZoneAwareLoadBalancerBase {
+class LeastRequestLoadBalancer : public EdfLoadBalancerBase {
 public:
   LeastRequestLoadBalancer(const PrioritySet& priority_set, const PrioritySet* local_priority_set,
                            ClusterStats& stats, Runtime::Loader& runtime,
-                           Runtime::RandomGenerator& random);
+                           Runtime::RandomGenerator& random)
+      : EdfLoadBalancerBase(priority_set, local_priority_set, stats, runtime, random) {}
+
+private:
+  // EdfLoadBalancerBase
+  double hostWeight(const Host& host) override {
+    const uint64_t active_requests = activeRequests(host, useLocalActiveRequests());
+    return static_cast<double>(host.weight()) / (active_requests + 1);
+  }
+  HostConstSharedPtr unweightedHostPick(const std::vector<HostSharedPtr>& hosts_to_use) override;
+
+  bool useLocalActiveRequests();
+  static uint64_t activeRequests(const Host& host, bool local);
+};
+
+/**
+ * Peak EWMA load balancer. Like the least request load balancer it randomly picks two hosts, but
+ * it compares their response time estimates (see PeakEwma) multiplied by their number of active
+ * requests plus one, so that slow hosts get less of the load than fast ones. Hosts without an
+ * estimate are preferred while idle, so that new hosts get to be measured, and avoided while they
+ * have active requests. The weights of the hosts are not considered.
+ * Technique is based on the P2C peak EWMA load balancer of Finagle and Linkerd
+ * (https://linkerd.io/1/features/load-balancing/).
+ */
+class PeakEwmaLoadBalancer : public LoadBalancer, ZoneAwareLoadBalancerBase {
+public:
+  PeakEwmaLoadBalancer(const PrioritySet& priority_set, const PrioritySet* local_priority_set,
+                       ClusterStats& stats, Runtime::Loader& runtime,
+                       Runtime::RandomGenerator& random)
+      : ZoneAwareLoadBalancerBase(priority_set, local_priority_set, stats, runtime, random) {}
 
   // Upstream::LoadBalancer
   HostConstSharedPtr chooseHost(LoadBalancerContext* context) override;
 
 private:
-  HostSharedPtr last_host_;
-  uint32_t hits_left_{};
+  static double cost(const Host& host);
 };
 
 /**
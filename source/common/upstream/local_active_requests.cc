@@ -0,0 +1,35 @@
+#include "common/upstream/local_active_requests.h"
+
+#include <cstdint>
+#include <unordered_map>
+
+#include "common/common/assert.h"
+
+namespace Envoy {
+namespace Upstream {
+
+namespace {
+
+// Hosts are removed when their count drops to 0, so only the hosts with active requests are kept
+// and a destroyed host can not leave a count behind for a new host at the same address.
+thread_local std::unordered_map<const Host*, uint64_t> active_requests_;
+
+} // namespace
+
+void LocalActiveRequests::inc(const Host& host) { active_requests_[&host]++; }
+
+void LocalActiveRequests::dec(const Host& host) {
+  auto it = active_requests_.find(&host);
+  ASSERT(it != active_requests_.end());
+  if (it != active_requests_.end() && --it->second == 0) {
+    active_requests_.erase(it);
+  }
+}
+
+uint64_t LocalActiveRequests::value(const Host& host) {
+  auto it = active_requests_.find(&host);
+  return it == active_requests_.end() ? 0 : it->second;
+}
+
+} // namespace Upstream
+} // namespace Envoy
@@ -0,0 +1,35 @@
+#pragma once
+
+#include <cstdint>
+
+#include "envoy/upstream/upstream.h"
+
+namespace Envoy {
+namespace Upstream {
+
+/**
+ * Counts of the active requests of hosts on the calling thread. Unlike the rq_active host gauge,
+ * which every worker updates, the counts are only touched by their own thread, so tracking them
+ * does not bounce the cache lines of busy hosts between cores. The connection pools keep them
+ * alongside the gauge, and the least request load balancer can use them instead of the gauge.
+ */
+class LocalActiveRequests {
+public:
+  /**
+   * Count a request to a host starting on this thread.
+   */
+  static void inc(const Host& host);
+
+  /**
+   * Count a request to a host that was started on this thread ending.
+   */
+  static void dec(const Host& host);
+
+  /**
+   * @return uint64_t the number of requests to a host that are active on this thread.
+   */
+  static uint64_t value(const Host& host);
+};
+
+} // namespace Upstream
+} // namespace Envoy
@@ -31,7 +31,8 @@ public:
   LogicalDnsCluster(const envoy::api::v2::Cluster& cluster, Runtime::Loader& runtime,
                     Stats::Store& stats, Ssl::ContextManager& ssl_context_manager,
                     Network::DnsResolverSharedPtr dns_resolver, ThreadLocal::SlotAllocator& tls,
-                    ClusterManager& cm, Event::Dispatcher& dispatcher, bool added_via_api);
+                    ClusterManager& cm, Event::Dispatcher& dispatcher, bool added_via_api,
+                    ClusterInfoConstSharedPtr info = nullptr);
 
   ~LogicalDnsCluster();
 
@@ -75,6 +76,10 @@ private:
     const envoy::api::v2::Locality& locality() const override {
       return envoy::api::v2::Locality().default_instance();
     }
+    void putResponseTime(std::chrono::milliseconds time) const override {
+      logical_host_->putResponseTime(time);
+    }
+    double responseTimeEstimate() const override { return logical_host_->responseTimeEstimate(); }
 
     Network::Address::InstanceConstSharedPtr address_;
     HostConstSharedPtr logical_host_;
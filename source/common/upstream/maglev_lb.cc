@@ -0,0 +1,86 @@
+#include "common/upstream/maglev_lb.h"
+
+#include <cstdint>
+#include <limits>
+#include <string>
+#include <vector>
+
+#include "common/common/assert.h"
+#include "common/common/hash.h"
+
+namespace Envoy {
+namespace Upstream {
+
+namespace {
+
+const uint32_t EmptyEntry = std::numeric_limits<uint32_t>::max();
+
+} // namespace
+
+MaglevLoadBalancer::MaglevLoadBalancer(PrioritySet& priority_set, ClusterStats& stats,
+                                       Runtime::Loader& runtime, Runtime::RandomGenerator& random,
+                                       Event::Dispatcher* dispatcher, uint64_t table_size)
+    : ThreadAwareLoadBalancerBase(
+          priority_set, stats, runtime, random,
+          [table_size](const std::vector<HostSharedPtr>& hosts) -> HashingLoadBalancerSharedPtr {
+            return std::make_shared<Table>(hosts, table_size);
+          },
+          dispatcher) {
+  ASSERT(table_size > 1);
+}
+
+MaglevLoadBalancer::Table::Table(const std::vector<HostSharedPtr>& hosts, uint64_t table_size) {
+  ENVOY_LOG(trace, "maglev: building table");
+  if (hosts.empty()) {
+    return;
+  }
+
+  RELEASE_ASSERT(hosts.size() < EmptyEntry);
+  hosts_.assign(hosts.begin(), hosts.end());
+
+  // Each host fills the entries of its permutation of the table, (offset + j * skip) % size for
+  // j = 0, 1, ..., skipping those already taken. A prime table size makes every skip generate a
+  // full permutation.
+  struct Permutation {
+    uint64_t offset_;
+    uint64_t skip_;
+    uint64_t next_;
+  };
+  std::vector<Permutation> permutations;
+  permutations.reserve(hosts.size());
+  for (const auto& host : hosts) {
+    const std::string& address_string = host->address()->asString();
+    permutations.push_back({HashUtil::xxHash64(address_string) % table_size,
+                            HashUtil::xxHash64(address_string, 1) % (table_size - 1) + 1, 0});
+  }
+
+  // With more hosts than entries, the table fills up before every host got one.
+  table_.assign(table_size, EmptyEntry);
+  uint64_t filled = 0;
+  while (true) {
+    for (uint32_t i = 0; i < permutations.size(); i++) {
+      Permutation& permutation = permutations[i];
+      uint64_t entry = (permutation.offset_ + permutation.next_ * permutation.skip_) % table_size;
+      while (table_[entry] != EmptyEntry) {
+        permutation.next_++;
+        entry = (permutation.offset_ + permutation.next_ * permutation.skip_) % table_size;
+      }
+      table_[entry] = i;
+      permutation.next_++;
+      if (++filled == table_size) {
+        ENVOY_LOG(info, "maglev: built table of size {} for {} hosts", table_size, hosts.size());
+        return;
+      }
+    }
+  }
+}
+
+HostConstSharedPtr MaglevLoadBalancer::Table::chooseHost(uint64_t hash) const {
+  if (table_.empty()) {
+    return nullptr;
+  }
+  return hosts_[table_[hash % table_.size()]];
+}
+
+} // namespace Upstream
+} // namespace Envoy
@@ -0,0 +1,49 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "envoy/runtime/runtime.h"
+#include "envoy/upstream/load_balancer.h"
+
+#include "common/common/logger.h"
+#include "common/upstream/thread_aware_lb_impl.h"
+
+namespace Envoy {
+namespace Upstream {
+
+/**
+ * A load balancer that implements Maglev consistent hashing
+ * (https://research.google.com/pubs/pub44824.html). The hosts fill a lookup table following
+ * permutations of the table derived from their addresses, taking turns so that each host gets
+ * an almost equal share of the entries. Choosing a host is then a single table lookup, and when
+ * the hosts change most entries keep their host. As with the ring hash load balancer, a table is
+ * kept for all hosts as well as for healthy hosts, and zone aware routing is not supported.
+ */
+class MaglevLoadBalancer : public ThreadAwareLoadBalancerBase,
+                           Logger::Loggable<Logger::Id::upstream> {
+public:
+  // The table size must be prime, and much larger than the number of hosts for the shares of the
+  // hosts to be even.
+  static const uint64_t DefaultTableSize = 65537;
+
+  MaglevLoadBalancer(PrioritySet& priority_set, ClusterStats& stats, Runtime::Loader& runtime,
+                     Runtime::RandomGenerator& random, Event::Dispatcher* dispatcher = nullptr,
+                     uint64_t table_size = DefaultTableSize);
+
+private:
+  struct Table : public HashingLoadBalancer {
+    Table(const std::vector<HostSharedPtr>& hosts, uint64_t table_size);
+
+    // ThreadAwareLoadBalancerBase::HashingLoadBalancer
+    HostConstSharedPtr chooseHost(uint64_t hash) const override;
+
+    std::vector<HostConstSharedPtr> hosts_;
+    // The index in hosts_ of the host of each entry.
+    std::vector<uint32_t> table_;
+  };
+};
+
+} // namespace Upstream
+} // namespace Envoy
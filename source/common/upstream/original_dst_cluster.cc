@@ -1,10 +1,14 @@
 #include "common/upstream/original_dst_cluster.h"
 
 #include <chrono>
+#include <cmath>
+#include <limits>
 #include <list>
 #include <string>
 #include <vector>
 
+#include "common/config/metadata.h"
+#include "common/config/well_known_names.h"
 #include "common/network/address_impl.h"
 #include "common/network/utility.h"
 #include "common/protobuf/protobuf.h"
@@ -21,7 +25,7 @@ namespace Upstream {
 
 OriginalDstCluster::LoadBalancer::LoadBalancer(PrioritySet& priority_set, ClusterSharedPtr& parent)
     : priority_set_(priority_set), parent_(std::static_pointer_cast<OriginalDstCluster>(parent)),
-      info_(parent->info()) {
+      info_(parent->info()), host_map_(parent_.lock()->maxHosts()) {
   // priority_set_ is initially empty.
   priority_set_.addMemberUpdateCb([this](uint32_t, const std::vector<HostSharedPtr>& hosts_added,
                                          const std::vector<HostSharedPtr>& hosts_removed) -> void {
@@ -70,14 +74,30 @@ HostConstSharedPtr OriginalDstCluster::LoadBalancer::chooseHost(LoadBalancerCont
         host_map_.insert(host, false);
 
         if (std::shared_ptr<OriginalDstCluster> parent = parent_.lock()) {
-          // lambda cannot capture a member by value.
-          std::weak_ptr<OriginalDstCluster> post_parent = parent_;
-          parent->dispatcher_.post([post_parent, host]() mutable {
-            // The main cluster may have disappeared while this post was queued.
-            if (std::shared_ptr<OriginalDstCluster> parent = post_parent.lock()) {
-              parent->addHost(host);
-            }
-          });
+          bool post;
+          {
+            std::lock_guard<std::mutex> guard(pending_hosts_->lock_);
+            // Only the first pending host posts, later ones join it until the main thread runs
+            // the post.
+            post = pending_hosts_->hosts_.empty();
+            pending_hosts_->hosts_.push_back(host);
+          }
+          if (post) {
+            // lambda cannot capture a member by value.
+            std::weak_ptr<OriginalDstCluster> post_parent = parent_;
+            std::shared_ptr<PendingHosts> pending_hosts = pending_hosts_;
+            parent->dispatcher_.post([post_parent, pending_hosts]() -> void {
+              std::vector<HostSharedPtr> hosts;
+              {
+                std::lock_guard<std::mutex> guard(pending_hosts->lock_);
+                hosts.swap(pending_hosts->hosts_);
+              }
+              // The main cluster may have disappeared while this post was queued.
+              if (std::shared_ptr<OriginalDstCluster> parent = post_parent.lock()) {
+                parent->addHosts(hosts);
+              }
+            });
+          }
         }
 
         return std::move(host);
@@ -91,27 +111,79 @@ HostConstSharedPtr OriginalDstCluster::LoadBalancer::chooseHost(LoadBalancerCont
   return nullptr;
 }
 
+namespace {
+
+// Reads the bound on the number of hosts from the envoy.lb metadata of the cluster, 0 if not set.
+uint64_t maxHostsMetadataValue(const envoy::api::v2::Cluster& config) {
+  const ProtobufWkt::Value& value =
+      Config::Metadata::metadataValue(config.metadata(), Config::MetadataFilters::get().ENVOY_LB,
+                                      Config::MetadataEnvoyLbKeys::get().ORIGINAL_DST_MAX_HOSTS);
+  if (value.kind_case() == ProtobufWkt::Value::KIND_NOT_SET) {
+    return 0;
+  }
+
+  const double number = value.number_value();
+  if (number < 1 || number > std::numeric_limits<uint32_t>::max() ||
+      number != std::floor(number)) {
+    throw EnvoyException(
+        fmt::format("cluster: original dst max hosts must be a positive integer: {}", number));
+  }
+  return static_cast<uint64_t>(number);
+}
+
+} // namespace
+
 OriginalDstCluster::OriginalDstCluster(const envoy::api::v2::Cluster& config,
                                        Runtime::Loader& runtime, Stats::Store& stats,
                                        Ssl::ContextManager& ssl_context_manager, ClusterManager& cm,
-                                       Event::Dispatcher& dispatcher, bool added_via_api)
+                                       Event::Dispatcher& dispatcher, bool added_via_api,
+                                       ClusterInfoConstSharedPtr info)
     : ClusterImplBase(config, cm.sourceAddress(), runtime, stats, ssl_context_manager,
-                      added_via_api),
+                      added_via_api, info),
       dispatcher_(dispatcher), cleanup_interval_ms_(std::chrono::milliseconds(
                                    PROTOBUF_GET_MS_OR_DEFAULT(config, cleanup_interval, 5000))),
+      max_hosts_(maxHostsMetadataValue(config)),
       cleanup_timer_(dispatcher.createTimer([this]() -> void { cleanup(); })) {
 
   cleanup_timer_->enableTimer(cleanup_interval_ms_);
 }
 
-void OriginalDstCluster::addHost(HostSharedPtr& host) {
+void OriginalDstCluster::addHosts(std::vector<HostSharedPtr>& hosts) {
   // Given the current config, only EDS clusters support multiple priorities.
   ASSERT(priority_set_.hostSetsPerPriority().size() == 1);
   auto& first_host_set = priority_set_.getOrCreateHostSet(0);
   HostVectorSharedPtr new_hosts(new std::vector<HostSharedPtr>(first_host_set.hosts()));
-  new_hosts->emplace_back(host);
+  new_hosts->insert(new_hosts->end(), hosts.begin(), hosts.end());
+
+  // Hosts are kept in the order they were added. Beyond the bound, drop the oldest hosts that have
+  // not been used since the last cleanup first, then the oldest of the others. The hosts being
+  // added are kept.
+  std::vector<HostSharedPtr> to_be_removed;
+  if (max_hosts_ != 0 && new_hosts->size() > max_hosts_) {
+    const uint64_t old_hosts = new_hosts->size() - hosts.size();
+    uint64_t excess = new_hosts->size() - max_hosts_;
+    std::vector<bool> removed(old_hosts);
+    for (bool used : {false, true}) {
+      for (uint64_t i = 0; i < old_hosts && excess > 0; i++) {
+        if (!removed[i] && (*new_hosts)[i]->used() == used) {
+          removed[i] = true;
+          to_be_removed.push_back((*new_hosts)[i]);
+          excess--;
+        }
+      }
+    }
+    HostVectorSharedPtr kept_hosts(new std::vector<HostSharedPtr>());
+    for (uint64_t i = 0; i < new_hosts->size(); i++) {
+      if (i >= old_hosts || !removed[i]) {
+        kept_hosts->emplace_back((*new_hosts)[i]);
+      }
+    }
+    new_hosts = kept_hosts;
+    ENVOY_LOG(debug, "Dropping {} hosts beyond the bound of {}.", to_be_removed.size(), max_hosts_);
+  }
+
   first_host_set.updateHosts(new_hosts, createHealthyHostList(*new_hosts), empty_host_lists_,
-                             empty_host_lists_, {std::move(host)}, {});
+                             empty_host_lists_, hosts, to_be_removed);
 }
 
 void OriginalDstCluster::cleanup() {
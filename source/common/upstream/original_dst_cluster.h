@@ -2,8 +2,12 @@
 
 #include <cstdint>
 #include <functional>
+#include <list>
+#include <memory>
+#include <mutex>
 #include <string>
 #include <unordered_map>
+#include <vector>
 
 #include "envoy/thread_local/thread_local.h"
 
@@ -18,17 +22,26 @@ namespace Upstream {
  * The OriginalDstCluster is a dynamic cluster that automatically adds hosts as needed based on the
  * original destination address of the downstream connection. These hosts are also automatically
  * cleaned up after they have not seen traffic for a configurable cleanup interval time
- * ("cleanup_interval_ms").
+ * ("cleanup_interval_ms"). The number of hosts can be bounded with the original_dst_max_hosts
+ * envoy.lb metadata key of the cluster, in which case the least recently used hosts are dropped
+ * first.
  */
 class OriginalDstCluster : public ClusterImplBase {
 public:
   OriginalDstCluster(const envoy::api::v2::Cluster& config, Runtime::Loader& runtime,
                      Stats::Store& stats, Ssl::ContextManager& ssl_context_manager,
-                     ClusterManager& cm, Event::Dispatcher& dispatcher, bool added_via_api);
+                     ClusterManager& cm, Event::Dispatcher& dispatcher, bool added_via_api,
+                     ClusterInfoConstSharedPtr info = nullptr);
 
   // Upstream::Cluster
   InitializePhase initializePhase() const override { return InitializePhase::Primary; }
 
+  /**
+   * @return uint64_t the maximum number of hosts of the cluster, and of the host cache of each
+   *         worker, or 0 if the number of hosts is not bounded.
+   */
+  uint64_t maxHosts() const { return max_hosts_; }
+
   /**
    * Special Load Balancer for Original Dst Cluster.
    *
@@ -36,9 +49,11 @@ public:
    * Original Dst cluster has a Host for the original destination. Normally load balancers can't
    * modify clusters, but in this case we access a singleton OriginalDstCluster that we can ask to
    * add hosts on demand. Additions are synced with all other threads so that the host set in the
-   * cluster remains (eventually) consistent. If multiple threads add a host to the same upstream
-   * address then two distinct HostSharedPtr's (with the same upstream IP address) will be added,
-   * and both of them will eventually time out.
+   * cluster remains (eventually) consistent. The hosts a worker creates while its previous
+   * additions are still queued for the main thread are added along with them, in a single update
+   * of the host set. If multiple threads add a host to the same upstream address then two distinct
+   * HostSharedPtr's (with the same upstream IP address) will be added, and both of them will
+   * eventually time out.
    */
   class LoadBalancer : public Upstream::LoadBalancer {
   public:
@@ -49,56 +64,86 @@ public:
 
   private:
     /**
-     * Map from an host IP address/port to a HostSharedPtr. Due to races multiple distinct host
-     * objects with the same address can be created, so we need to use a multimap.
+     * Map from an host IP address/port to a HostSharedPtr, in least recently used order. Due to
+     * races multiple distinct host objects with the same address can be created, so we need to use
+     * a multimap. If the map is bounded, inserting a host beyond the bound evicts the least
+     * recently used host from the map. The host stays in the cluster until it times out or the
+     * cluster drops it, and a later request to its address creates a new host.
      */
     class HostMap {
     public:
+      HostMap(uint64_t max_hosts) : max_hosts_(max_hosts) {}
+
       bool insert(const HostSharedPtr& host, bool check = true) {
-        if (check) {
-          auto range = map_.equal_range(host->address()->asString());
-          auto it = std::find_if(
-              range.first, range.second,
-              [&host](const decltype(map_)::value_type pair) { return pair.second == host; });
-          if (it != range.second) {
-            return false; // 'host' already in the map, no need to insert.
-          }
+        if (check && findEntry(*host) != map_.end()) {
+          return false; // 'host' already in the map, no need to insert.
+        }
+        lru_.push_front(host);
+        map_.emplace(host->address()->asString(), lru_.begin());
+        if (max_hosts_ != 0 && lru_.size() > max_hosts_) {
+          remove(lru_.back());
         }
-        map_.emplace(host->address()->asString(), host);
         return true;
       }
 
       void remove(const HostSharedPtr& host) {
-        auto range = map_.equal_range(host->address()->asString());
-        auto it =
-            std::find_if(range.first, range.second, [&host](const decltype(map_)::value_type pair) {
-              return pair.second == host;
-            });
-        ASSERT(it != range.second);
-        map_.erase(it);
+        auto it = findEntry(*host);
+        // The host may have been evicted from the map already.
+        if (it != map_.end()) {
+          lru_.erase(it->second);
+          map_.erase(it);
+        }
       }
 
       HostSharedPtr find(const Network::Address::Instance& address) {
         auto it = map_.find(address.asString());
 
         if (it != map_.end()) {
-          return it->second;
+          // Move the host to the front as the most recently used.
+          lru_.splice(lru_.begin(), lru_, it->second);
+          return *it->second;
         }
         return nullptr;
       }
 
+      uint64_t size() const { return lru_.size(); }
+
     private:
-      std::unordered_multimap<std::string, HostSharedPtr> map_;
+      typedef std::list<HostSharedPtr> LruList;
+      typedef std::unordered_multimap<std::string, LruList::iterator> Map;
+
+      Map::iterator findEntry(const Host& host) {
+        auto range = map_.equal_range(host.address()->asString());
+        auto it = std::find_if(range.first, range.second, [&host](const Map::value_type& pair) {
+          return pair.second->get() == &host;
+        });
+        return it != range.second ? it : map_.end();
+      }
+
+      const uint64_t max_hosts_;
+      // Most recently used first.
+      LruList lru_;
+      Map map_;
+    };
+
+    /**
+     * The hosts created by a worker that are yet to be added to the cluster by the main thread.
+     */
+    struct PendingHosts {
+      std::mutex lock_;
+      std::vector<HostSharedPtr> hosts_;
     };
 
     PrioritySet& priority_set_;                // Thread local priority set.
     std::weak_ptr<OriginalDstCluster> parent_; // Primary cluster managed by the main thread.
     ClusterInfoConstSharedPtr info_;
     HostMap host_map_;
+    // Shared with the post to the main thread, which may outlive the load balancer.
+    std::shared_ptr<PendingHosts> pending_hosts_{std::make_shared<PendingHosts>()};
   };
 
 private:
-  void addHost(HostSharedPtr&);
+  void addHosts(std::vector<HostSharedPtr>& hosts);
   void cleanup();
 
   // ClusterImplBase
@@ -106,6 +151,7 @@ private:
 
   Event::Dispatcher& dispatcher_;
   const std::chrono::milliseconds cleanup_interval_ms_;
+  const uint64_t max_hosts_;
   Event::TimerPtr cleanup_timer_;
 };
 
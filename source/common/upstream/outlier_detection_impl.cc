@@ -1,6 +1,8 @@
 #include "common/upstream/outlier_detection_impl.h"
 
+#include <algorithm>
 #include <chrono>
+#include <cmath>
 #include <cstdint>
 #include <memory>
 #include <string>
@@ -46,6 +48,10 @@ void DetectorHostMonitorImpl::updateCurrentSuccessRateBucket() {
   success_rate_accumulator_bucket_.store(success_rate_accumulator_.updateCurrentWriter());
 }
 
+void DetectorHostMonitorImpl::updateCurrentLatencyBucket() {
+  latency_accumulator_bucket_.store(latency_accumulator_.updateCurrentWriter());
+}
+
 void DetectorHostMonitorImpl::putHttpResponseCode(uint64_t response_code) {
   success_rate_accumulator_bucket_.load()->total_request_counter_++;
   if (Http::CodeUtility::is5xx(response_code)) {
@@ -129,7 +135,7 @@ DetectorImpl::DetectorImpl(const Cluster& cluster,
                            MonotonicTimeSource& time_source, EventLoggerSharedPtr event_logger)
     : config_(config), dispatcher_(dispatcher), runtime_(runtime), time_source_(time_source),
       stats_(generateStats(cluster.info()->statsScope())),
-      interval_timer_(dispatcher.createTimer([this]() -> void { onIntervalTimer(); })),
+      interval_timer_(dispatcher.createCoarseTimer([this]() -> void { onIntervalTimer(); })),
       event_logger_(event_logger), success_rate_average_(-1), success_rate_ejection_threshold_(-1) {
 }
 
@@ -230,6 +236,9 @@ bool DetectorImpl::enforceEjection(EjectionType type) {
   case EjectionType::SuccessRate:
     return runtime_.snapshot().featureEnabled("outlier_detection.enforcing_success_rate",
                                               config_.enforcingSuccessRate());
+  case EjectionType::Latency:
+    return runtime_.snapshot().featureEnabled("outlier_detection.enforcing_latency",
+                                              config_.enforcingLatency());
   }
 
   NOT_REACHED;
@@ -247,6 +256,9 @@ void DetectorImpl::updateEnforcedEjectionStats(EjectionType type) {
   case EjectionType::ConsecutiveGatewayFailure:
     stats_.ejections_enforced_consecutive_gateway_failure_.inc();
     break;
+  case EjectionType::Latency:
+    stats_.ejections_enforced_latency_.inc();
+    break;
   }
 }
 
@@ -340,6 +352,7 @@ void DetectorImpl::onConsecutiveErrorWorker(HostSharedPtr host, EjectionType typ
     host_monitors_[host]->resetConsecutiveGatewayFailure();
     break;
   case EjectionType::SuccessRate:
+  case EjectionType::Latency:
     NOT_REACHED;
   }
 }
@@ -428,6 +441,60 @@ void DetectorImpl::processSuccessRateEjections() {
   }
 }
 
+void DetectorImpl::processLatencyEjections() {
+  // Latency ejection is disabled unless a factor is set.
+  const uint64_t latency_factor = runtime_.snapshot().getInteger(
+      "outlier_detection.latency_factor", config_.latencyFactor());
+  const uint64_t latency_minimum_hosts = runtime_.snapshot().getInteger(
+      "outlier_detection.latency_minimum_hosts", config_.successRateMinimumHosts());
+  const uint64_t latency_request_volume = runtime_.snapshot().getInteger(
+      "outlier_detection.latency_request_volume", config_.successRateRequestVolume());
+  const double latency_percentile = std::min<uint64_t>(
+      100, runtime_.snapshot().getInteger("outlier_detection.latency_percentile",
+                                          config_.latencyPercentile()));
+
+  latency_ejection_threshold_ = -1;
+
+  if (latency_factor == 0 || host_monitors_.size() < latency_minimum_hosts) {
+    return;
+  }
+
+  std::vector<std::pair<HostSharedPtr, double>> valid_latency_hosts;
+  valid_latency_hosts.reserve(host_monitors_.size());
+  for (const auto& host : host_monitors_) {
+    if (!host.first->healthFlagGet(Host::HealthFlag::FAILED_OUTLIER_CHECK)) {
+      Optional<uint64_t> host_latency = host.second->latencyAccumulator().getPercentile(
+          latency_percentile, latency_request_volume);
+      if (host_latency.valid()) {
+        valid_latency_hosts.emplace_back(host.first, host_latency.value());
+        host.second->latency(host_latency.value());
+      }
+    }
+  }
+
+  if (valid_latency_hosts.size() < latency_minimum_hosts) {
+    return;
+  }
+
+  // The threshold is a multiple of the median latency of the hosts, which unlike the mean is not
+  // dragged up by the outliers themselves.
+  std::vector<double> latencies;
+  latencies.reserve(valid_latency_hosts.size());
+  for (const auto& host_latency : valid_latency_hosts) {
+    latencies.push_back(host_latency.second);
+  }
+  auto median = latencies.begin() + latencies.size() / 2;
+  std::nth_element(latencies.begin(), median, latencies.end());
+  latency_ejection_threshold_ = *median * latency_factor / 1000.0;
+
+  for (const auto& host_latency : valid_latency_hosts) {
+    if (host_latency.second > latency_ejection_threshold_) {
+      stats_.ejections_detected_latency_.inc();
+      ejectHost(host_latency.first, EjectionType::Latency);
+    }
+  }
+}
+
 void DetectorImpl::onIntervalTimer() {
   MonotonicTime now = time_source_.currentTime();
 
@@ -436,12 +503,16 @@ void DetectorImpl::onIntervalTimer() {
 
     // Need to update the writer bucket to keep the data valid.
     host.second->updateCurrentSuccessRateBucket();
-    // Refresh host success rate stat for the /clusters endpoint. If there is a new valid value, it
-    // will get updated in processSuccessRateEjections().
+    host.second->updateCurrentLatencyBucket();
+    // Refresh host success rate and latency stats for the /clusters endpoint. If there are new
+    // valid values, they will get updated in processSuccessRateEjections() and
+    // processLatencyEjections().
     host.second->successRate(-1);
+    host.second->latency(-1);
   }
 
   processSuccessRateEjections();
+  processLatencyEjections();
 
   armIntervalTimer();
 }
@@ -482,6 +553,20 @@ void EventLoggerImpl::logEject(HostDescriptionConstSharedPtr host, Detector& det
     "\"cluster_average_success_rate\": \"{}\", " +
     "\"cluster_success_rate_ejection_threshold\": \"{}\"" +
     "}}\n";
+
+  static const std::string json_latency =
+    std::string("{{") +
+    "\"time\": \"{}\", " +
+    "\"secs_since_last_action\": \"{}\", " +
+    "\"cluster\": \"{}\", " +
+    "\"upstream_url\": \"{}\", " +
+    "\"action\": \"eject\", " +
+    "\"type\": \"{}\", " +
+    "\"num_ejections\": \"{}\", " +
+    "\"enforced\": \"{}\", " +
+    "\"host_latency\": \"{}\", " +
+    "\"cluster_latency_ejection_threshold\": \"{}\"" +
+    "}}\n";
   // clang-format on
   SystemTime now = time_source_.currentTime();
   MonotonicTime monotonic_now = monotonic_time_source_.currentTime();
@@ -503,6 +588,14 @@ void EventLoggerImpl::logEject(HostDescriptionConstSharedPtr host, Detector& det
         host->outlierDetector().numEjections(), enforced, host->outlierDetector().successRate(),
         detector.successRateAverage(), detector.successRateEjectionThreshold()));
     break;
+  case EjectionType::Latency:
+    file_->write(fmt::format(
+        json_latency, AccessLogDateTimeFormatter::fromTime(now),
+        secsSinceLastAction(host->outlierDetector().lastUnejectionTime(), monotonic_now),
+        host->cluster().name(), host->address()->asString(), typeToString(type),
+        host->outlierDetector().numEjections(), enforced, host->outlierDetector().latency(),
+        detector.latencyEjectionThreshold()));
+    break;
   }
 }
 
@@ -535,6 +628,8 @@ std::string EventLoggerImpl::typeToString(EjectionType type) {
     return "GatewayFailure";
   case EjectionType::SuccessRate:
     return "SuccessRate";
+  case EjectionType::Latency:
+    return "Latency";
   }
 
   NOT_REACHED;
@@ -567,6 +662,65 @@ Optional<double> SuccessRateAccumulator::getSuccessRate(uint64_t success_rate_re
                           backup_success_rate_bucket_->total_request_counter_);
 }
 
+uint32_t LatencyAccumulatorBucket::index(uint64_t time_ms) {
+  if (time_ms < 2 * SubBuckets) {
+    return time_ms;
+  }
+  time_ms = std::min<uint64_t>(time_ms, (1ULL << MaxExponent) - 1);
+  // The exponent of the highest set bit picks the power of two, and the SubBucketsLog2 bits below
+  // it pick the sub bucket.
+  const uint32_t exponent = 63 - __builtin_clzll(time_ms);
+  return 2 * SubBuckets + (exponent - SubBucketsLog2 - 1) * SubBuckets +
+         ((time_ms >> (exponent - SubBucketsLog2)) - SubBuckets);
+}
+
+uint64_t LatencyAccumulatorBucket::lowerBound(uint32_t index) {
+  if (index < 2 * SubBuckets) {
+    return index;
+  }
+  const uint32_t offset = index - 2 * SubBuckets;
+  const uint32_t exponent = offset / SubBuckets + SubBucketsLog2 + 1;
+  return static_cast<uint64_t>(SubBuckets + offset % SubBuckets) << (exponent - SubBucketsLog2);
+}
+
+LatencyAccumulatorBucket* LatencyAccumulator::updateCurrentWriter() {
+  // As with success rate, current is being written to and backup is not. Hosts that got no
+  // requests over the last window have nothing to flush.
+  if (backup_latency_bucket_->total_request_counter_ != 0) {
+    for (auto& count : backup_latency_bucket_->counts_) {
+      count = 0;
+    }
+    backup_latency_bucket_->total_request_counter_ = 0;
+  }
+
+  current_latency_bucket_.swap(backup_latency_bucket_);
+
+  return current_latency_bucket_.get();
+}
+
+Optional<uint64_t> LatencyAccumulator::getPercentile(double percentile,
+                                                     uint64_t request_volume) const {
+  const uint64_t total = backup_latency_bucket_->total_request_counter_;
+  if (total == 0 || total < request_volume) {
+    return Optional<uint64_t>();
+  }
+
+  // The rank of the request at the percentile, counting from 1.
+  const uint64_t rank =
+      std::max<uint64_t>(1, static_cast<uint64_t>(std::ceil(percentile / 100 * total)));
+  uint64_t seen = 0;
+  for (uint32_t i = 0; i < LatencyAccumulatorBucket::NumBuckets; i++) {
+    seen += backup_latency_bucket_->counts_[i];
+    if (seen >= rank) {
+      return Optional<uint64_t>(LatencyAccumulatorBucket::lowerBound(i));
+    }
+  }
+
+  // Not reached, as buckets are counted before the total.
+  return Optional<uint64_t>(
+      LatencyAccumulatorBucket::lowerBound(LatencyAccumulatorBucket::NumBuckets - 1));
+}
+
 } // namespace Outlier
 } // namespace Upstream
 } // namespace Envoy
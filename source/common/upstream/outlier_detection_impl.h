@@ -34,6 +34,7 @@ public:
   const Optional<MonotonicTime>& lastEjectionTime() override { return time_; }
   const Optional<MonotonicTime>& lastUnejectionTime() override { return time_; }
   double successRate() const override { return -1; }
+  double latency() const override { return -1; }
 
 private:
   const Optional<MonotonicTime> time_;
@@ -58,6 +59,9 @@ struct HostSuccessRatePair {
       : host_(host), success_rate_(success_rate) {}
   HostSharedPtr host_;
   double success_rate_;
+  LatencyAccumulator latency_accumulator_;
+  std::atomic<LatencyAccumulatorBucket*> latency_accumulator_bucket_;
+  double latency_{-1};
 };
 
 struct SuccessRateAccumulatorBucket {
@@ -97,6 +101,74 @@ private:
   std::unique_ptr<SuccessRateAccumulatorBucket> backup_success_rate_bucket_;
 };
 
+/**
+ * Histogram of the response times of a host in milliseconds, that workers record into without
+ * locking. Response times below 2 * SubBuckets milliseconds have a bucket each, and each power of
+ * two above is split into SubBuckets buckets, so the response time at a percentile is within
+ * 1 / SubBuckets of the actual value.
+ */
+struct LatencyAccumulatorBucket {
+  static const uint32_t SubBucketsLog2 = 3;
+  static const uint32_t SubBuckets = 1 << SubBucketsLog2;
+  // Response times of 2^MaxExponent milliseconds (about 4.6 hours) and above share the last
+  // bucket.
+  static const uint32_t MaxExponent = 24;
+  static const uint32_t NumBuckets =
+      2 * SubBuckets + (MaxExponent - SubBucketsLog2 - 1) * SubBuckets;
+
+  /**
+   * @return the index of the bucket of a response time in milliseconds.
+   */
+  static uint32_t index(uint64_t time_ms);
+
+  /**
+   * @return the smallest response time in milliseconds of a bucket.
+   */
+  static uint64_t lowerBound(uint32_t index);
+
+  void record(std::chrono::milliseconds time) {
+    counts_[index(time.count())]++;
+    total_request_counter_++;
+  }
+
+  std::atomic<uint64_t> counts_[NumBuckets];
+  std::atomic<uint64_t> total_request_counter_;
+};
+
+/**
+ * The LatencyAccumulator keeps the response times of a host over a fixed window of time, in the
+ * same way as the SuccessRateAccumulator: there is a bucket to write to, and a bucket to run stats
+ * over.
+ */
+class LatencyAccumulator {
+public:
+  LatencyAccumulator()
+      : current_latency_bucket_(new LatencyAccumulatorBucket()),
+        backup_latency_bucket_(new LatencyAccumulatorBucket()) {}
+
+  /**
+   * This function updates the bucket to write data to. Clearing the bucket that is not written to
+   * anymore only takes time if it got requests.
+   * @return a pointer to the LatencyAccumulatorBucket.
+   */
+  LatencyAccumulatorBucket* updateCurrentWriter();
+
+  /**
+   * This function returns the response time of a host at a percentile over a window of time if the
+   * request volume is high enough.
+   * @param percentile supplies the percentile, in the range 0-100.
+   * @param request_volume the threshold of requests an accumulator has to have in order to be able
+   *                       to return a significant response time.
+   * @return a valid Optional<uint64_t> with the response time in milliseconds. If there were not
+   *         enough requests, an invalid Optional<uint64_t> is returned.
+   */
+  Optional<uint64_t> getPercentile(double percentile, uint64_t request_volume) const;
+
+private:
+  std::unique_ptr<LatencyAccumulatorBucket> current_latency_bucket_;
+  std::unique_ptr<LatencyAccumulatorBucket> backup_latency_bucket_;
+};
+
 class DetectorImpl;
 
 /**
@@ -106,8 +178,10 @@ class DetectorHostMonitorImpl : public DetectorHostMonitor {
 public:
   DetectorHostMonitorImpl(std::shared_ptr<DetectorImpl> detector, HostSharedPtr host)
       : detector_(detector), host_(host), success_rate_(-1) {
-    // Point the success_rate_accumulator_bucket_ pointer to a bucket.
+    // Point the success_rate_accumulator_bucket_ and latency_accumulator_bucket_ pointers to a
+    // bucket.
     updateCurrentSuccessRateBucket();
+    updateCurrentLatencyBucket();
   }
 
   void eject(MonotonicTime ejection_time);
@@ -115,6 +189,9 @@ public:
   void updateCurrentSuccessRateBucket();
   SuccessRateAccumulator& successRateAccumulator() { return success_rate_accumulator_; }
   void successRate(double new_success_rate) { success_rate_ = new_success_rate; }
+  void updateCurrentLatencyBucket();
+  LatencyAccumulator& latencyAccumulator() { return latency_accumulator_; }
+  void latency(double new_latency) { latency_ = new_latency; }
   void resetConsecutive5xx() { consecutive_5xx_ = 0; }
   void resetConsecutiveGatewayFailure() { consecutive_gateway_failure_ = 0; }
 
@@ -122,10 +199,13 @@ public:
   uint32_t numEjections() override { return num_ejections_; }
   void putHttpResponseCode(uint64_t response_code) override;
   void putResult(Result result) override;
-  void putResponseTime(std::chrono::milliseconds) override {}
+  void putResponseTime(std::chrono::milliseconds time) override {
+    latency_accumulator_bucket_.load()->record(time);
+  }
   const Optional<MonotonicTime>& lastEjectionTime() override { return last_ejection_time_; }
   const Optional<MonotonicTime>& lastUnejectionTime() override { return last_unejection_time_; }
   double successRate() const override { return success_rate_; }
+  double latency() const override { return latency_; }
 
 private:
   std::weak_ptr<DetectorImpl> detector_;
@@ -156,7 +236,9 @@ private:
   COUNTER(ejections_detected_success_rate)                                                         \
   COUNTER(ejections_enforced_success_rate)                                                         \
   COUNTER(ejections_detected_consecutive_gateway_failure)                                          \
-  COUNTER(ejections_enforced_consecutive_gateway_failure)
+  COUNTER(ejections_enforced_consecutive_gateway_failure)                                          \
+  COUNTER(ejections_detected_latency)                                                              \
+  COUNTER(ejections_enforced_latency)
 // clang-format on
 
 /**
@@ -184,6 +266,9 @@ public:
   uint64_t enforcingConsecutive5xx() { return enforcing_consecutive_5xx_; }
   uint64_t enforcingConsecutiveGatewayFailure() { return enforcing_consecutive_gateway_failure_; }
   uint64_t enforcingSuccessRate() { return enforcing_success_rate_; }
+  uint64_t latencyFactor() { return latency_factor_; }
+  uint64_t latencyPercentile() { return latency_percentile_; }
+  uint64_t enforcingLatency() { return enforcing_latency_; }
 
 private:
   const uint64_t interval_ms_;
@@ -197,6 +282,11 @@ private:
   const uint64_t enforcing_consecutive_5xx_;
   const uint64_t enforcing_consecutive_gateway_failure_;
   const uint64_t enforcing_success_rate_;
+  // Latency outlier ejection is not part of the configuration proto, and is enabled by setting
+  // the outlier_detection.latency_factor runtime key.
+  const uint64_t latency_factor_{0};
+  const uint64_t latency_percentile_{99};
+  const uint64_t enforcing_latency_{100};
 };
 
 /**
@@ -221,6 +311,7 @@ public:
   void addChangedStateCb(ChangeStateCb cb) override { callbacks_.push_back(cb); }
   double successRateAverage() const override { return success_rate_average_; }
   double successRateEjectionThreshold() const override { return success_rate_ejection_threshold_; }
+  double latencyEjectionThreshold() const override { return latency_ejection_threshold_; }
 
 private:
   DetectorImpl(const Cluster& cluster, const envoy::api::v2::Cluster::OutlierDetection& config,
@@ -240,6 +331,7 @@ private:
   bool enforceEjection(EjectionType type);
   void updateEnforcedEjectionStats(EjectionType type);
   void processSuccessRateEjections();
+  void processLatencyEjections();
 
   DetectorConfig config_;
   Event::Dispatcher& dispatcher_;
@@ -252,6 +344,7 @@ private:
   EventLoggerSharedPtr event_logger_;
   double success_rate_average_;
   double success_rate_ejection_threshold_;
+  double latency_ejection_threshold_{-1};
 };
 
 class EventLoggerImpl : public EventLogger {
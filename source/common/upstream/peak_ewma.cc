@@ -0,0 +1,44 @@
+#include "common/upstream/peak_ewma.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+
+#include "common/common/assert.h"
+
+namespace Envoy {
+namespace Upstream {
+
+constexpr std::chrono::milliseconds PeakEwma::DefaultDecayTime;
+
+PeakEwma::PeakEwma(std::chrono::milliseconds decay_time)
+    : decay_time_ns_(std::chrono::duration_cast<std::chrono::nanoseconds>(decay_time).count()) {
+  ASSERT(decay_time.count() > 0);
+}
+
+void PeakEwma::observe(std::chrono::milliseconds response_time, MonotonicTime now) {
+  const double response_time_ms = response_time.count();
+  const double ewma_ms = ewma_ms_.load();
+  if (response_time_ms > ewma_ms) {
+    ewma_ms_ = response_time_ms;
+  } else {
+    const double weight = decay(now);
+    ewma_ms_ = ewma_ms * weight + response_time_ms * (1 - weight);
+  }
+  last_update_ns_ =
+      std::chrono::duration_cast<std::chrono::nanoseconds>(now.time_since_epoch()).count();
+}
+
+double PeakEwma::value(MonotonicTime now) const { return ewma_ms_.load() * decay(now); }
+
+double PeakEwma::decay(MonotonicTime now) const {
+  const int64_t now_ns =
+      std::chrono::duration_cast<std::chrono::nanoseconds>(now.time_since_epoch()).count();
+  // Another worker may have recorded a later response since the caller got the time.
+  const int64_t elapsed_ns = std::max<int64_t>(now_ns - last_update_ns_.load(), 0);
+  return std::exp(-elapsed_ns / decay_time_ns_);
+}
+
+} // namespace Upstream
+} // namespace Envoy
@@ -0,0 +1,51 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+
+#include "envoy/common/time.h"
+
+namespace Envoy {
+namespace Upstream {
+
+/**
+ * Peak exponentially weighted moving average of the response times of a host. A response slower
+ * than the average replaces it outright, so the average reacts to a host slowing down at once,
+ * while faster responses pull it down gradually. The weight of the average decays with the time
+ * since the last response rather than with the number of responses, and reading the average
+ * decays it towards 0 as well, so that a host that has not been used for a while is tried again.
+ *
+ * The average is updated without a lock by all the workers. Concurrent updates may lose one of
+ * the responses, which is in the noise of an average.
+ */
+class PeakEwma {
+public:
+  static constexpr std::chrono::milliseconds DefaultDecayTime{10000};
+
+  PeakEwma(std::chrono::milliseconds decay_time = DefaultDecayTime);
+
+  /**
+   * Add a response time to the average.
+   * @param response_time supplies the response time.
+   * @param now supplies the current time.
+   */
+  void observe(std::chrono::milliseconds response_time, MonotonicTime now);
+
+  /**
+   * @param now supplies the current time.
+   * @return double the average in milliseconds, 0 if no response has been observed.
+   */
+  double value(MonotonicTime now) const;
+
+private:
+  double decay(MonotonicTime now) const;
+
+  const double decay_time_ns_;
+  std::atomic<double> ewma_ms_{0};
+  // The time of the last response, in nanoseconds since the epoch of the monotonic clock.
+  std::atomic<int64_t> last_update_ns_{0};
+};
+
+} // namespace Upstream
+} // namespace Envoy
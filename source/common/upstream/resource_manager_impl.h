@@ -1,5 +1,6 @@
 #pragma once
 
+#include <algorithm>
 #include <atomic>
 #include <cstdint>
 #include <memory>
@@ -21,6 +22,14 @@ namespace Upstream {
  *    occur during high contention.
  * 2) Though atomics are used, it is possible for resources to temporarily go above the supplied
  *    maximums. This should not effect overall behavior.
+ *
+ * Retries are bounded by max_retries unless the "retry_budget.budget_percent" runtime key is set,
+ * in which case active retries may be up to that percentage of the active and pending requests,
+ * with a floor of "retry_budget.min_retry_concurrency" (DefaultMinRetryConcurrency if not set).
+ *
+ * Once shedFor() gave it a higher priority resource manager, no pending requests can be created
+ * while the higher priority has pending requests if the "shed_for_high_priority" runtime key is
+ * set, so that the requests of the lower priority are shed first when the upstream is overloaded.
  */
 class ResourceManagerImpl : public ResourceManager {
 public:
@@ -28,15 +37,27 @@ public:
                       uint64_t max_connections, uint64_t max_pending_requests,
                       uint64_t max_requests, uint64_t max_retries)
       : connections_(max_connections, runtime, runtime_key + "max_connections"),
-        pending_requests_(max_pending_requests, runtime, runtime_key + "max_pending_requests"),
+        pending_requests_(max_pending_requests, runtime, runtime_key),
         requests_(max_requests, runtime, runtime_key + "max_requests"),
-        retries_(max_retries, runtime, runtime_key + "max_retries") {}
+        retries_(max_retries, runtime, runtime_key, pending_requests_, requests_) {}
 
   // Upstream::ResourceManager
   Resource& connections() override { return connections_; }
   Resource& pendingRequests() override { return pending_requests_; }
   Resource& requests() override { return requests_; }
   Resource& retries() override { return retries_; }
+  bool retryBudgetEnabled() override { return retries_.budgetPercent() > 0; }
+
+  /**
+   * Shed the pending requests of this resource manager for those of a higher priority one.
+   * @param higher supplies the resource manager of the higher priority, which must outlive this
+   *        one's use.
+   */
+  void shedFor(const ResourceManagerImpl& higher) {
+    pending_requests_.higher_ = &higher.pending_requests_;
+  }
+
+  static const uint64_t DefaultMinRetryConcurrency = 3;
 
 private:
   struct ResourceImpl : public Resource {
@@ -59,10 +80,56 @@ private:
     const std::string runtime_key_;
   };
 
+  struct PendingRequestsImpl : public ResourceImpl {
+    PendingRequestsImpl(uint64_t max, Runtime::Loader& runtime, const std::string& runtime_key)
+        : ResourceImpl(max, runtime, runtime_key + "max_pending_requests"),
+          shed_key_(runtime_key + "shed_for_high_priority") {}
+
+    // Upstream::Resource
+    bool canCreate() override {
+      if (higher_ != nullptr && higher_->current_ > 0 &&
+          runtime_.snapshot().getInteger(shed_key_, 0) > 0) {
+        return false;
+      }
+      return ResourceImpl::canCreate();
+    }
+
+    const std::string shed_key_;
+    const ResourceImpl* higher_{};
+  };
+
+  struct RetriesImpl : public ResourceImpl {
+    RetriesImpl(uint64_t max, Runtime::Loader& runtime, const std::string& runtime_key,
+                const ResourceImpl& pending_requests, const ResourceImpl& requests)
+        : ResourceImpl(max, runtime, runtime_key + "max_retries"),
+          budget_percent_key_(runtime_key + "retry_budget.budget_percent"),
+          min_retry_concurrency_key_(runtime_key + "retry_budget.min_retry_concurrency"),
+          pending_requests_(pending_requests), requests_(requests) {}
+
+    uint64_t budgetPercent() { return runtime_.snapshot().getInteger(budget_percent_key_, 0); }
+
+    // Upstream::Resource
+    uint64_t max() override {
+      const uint64_t budget_percent = budgetPercent();
+      if (budget_percent == 0) {
+        return ResourceImpl::max();
+      }
+      const uint64_t active = pending_requests_.current_ + requests_.current_;
+      return std::max(
+          runtime_.snapshot().getInteger(min_retry_concurrency_key_, DefaultMinRetryConcurrency),
+          active * budget_percent / 100);
+    }
+
+    const std::string budget_percent_key_;
+    const std::string min_retry_concurrency_key_;
+    const ResourceImpl& pending_requests_;
+    const ResourceImpl& requests_;
+  };
+
   ResourceImpl connections_;
-  ResourceImpl pending_requests_;
+  PendingRequestsImpl pending_requests_;
   ResourceImpl requests_;
-  ResourceImpl retries_;
+  RetriesImpl retries_;
 };
 
 typedef std::unique_ptr<ResourceManagerImpl> ResourceManagerImplPtr;
@@ -1,11 +1,15 @@
 #include "common/upstream/ring_hash_lb.h"
 
+#include <algorithm>
 #include <cstdint>
+#include <limits>
 #include <string>
+#include <utility>
 #include <vector>
 
 #include "common/common/assert.h"
-#include "common/upstream/load_balancer_impl.h"
+#include "common/common/hash.h"
+#include "common/common/utility.h"
 
 #include "absl/strings/string_view.h"
 
@@ -15,92 +19,45 @@ namespace Upstream {
 RingHashLoadBalancer::RingHashLoadBalancer(
     PrioritySet& priority_set, ClusterStats& stats, Runtime::Loader& runtime,
     Runtime::RandomGenerator& random,
-    const Optional<envoy::api::v2::Cluster::RingHashLbConfig>& config)
-    : LoadBalancerBase(priority_set, stats, runtime, random), config_(config),
-      factory_(new LoadBalancerFactoryImpl(stats, random)) {}
-
-void RingHashLoadBalancer::initialize() {
-  // TODO(mattklein123): In the future, once initialized and the initial ring is built, it would be
-  // better to use a background thread for computing ring updates. This has the substantial benefit
-  // that if the ring computation thread falls behind, host set updates can be trivially collapsed.
-  // I will look into doing this in a follow up. Doing everything using a background thread heavily
-  // complicated initialization as the load balancer would need its own initialized callback. I
-  // think the synchronous/asynchronous split is probably the best option.
-  priority_set_.addMemberUpdateCb([this](uint32_t, const std::vector<HostSharedPtr>&,
-                                         const std::vector<HostSharedPtr>&) -> void { refresh(); });
-
-  refresh();
-}
+    const Optional<envoy::api::v2::Cluster::RingHashLbConfig>& config,
+    Event::Dispatcher* dispatcher)
+    : ThreadAwareLoadBalancerBase(
+          priority_set, stats, runtime, random,
+          [config](const std::vector<HostSharedPtr>& hosts) -> HashingLoadBalancerSharedPtr {
+            return std::make_shared<Ring>(config, hosts);
+          },
+          dispatcher) {}
 
-HostConstSharedPtr
-RingHashLoadBalancer::LoadBalancerImpl::chooseHost(LoadBalancerContext* context) {
-  // Make sure we correctly return nullptr for any early chooseHost() calls.
-  if (per_priority_state_ == nullptr) {
+HostConstSharedPtr RingHashLoadBalancer::Ring::chooseHost(uint64_t h) const {
+  if (hashes_.empty()) {
     return nullptr;
   }
-  // If there is no hash in the context, just choose a random value (this effectively becomes
-  // the random LB but it won't crash if someone configures it this way).
-  // computeHashKey() may be computed on demand, so get it only once.
-  Optional<uint64_t> hash;
-  if (context) {
-    hash = context->computeHashKey();
-  }
-  const uint64_t h = hash.valid() ? hash.value() : random_.random();
 
-  const uint32_t priority = LoadBalancerBase::choosePriority(h, *per_priority_load_);
-  if ((*per_priority_state_)[priority]->global_panic_) {
-    stats_.lb_healthy_panic_.inc();
+  // Find the first hash at least as large as h, as the ketama search
+  // (https://github.com/RJ/ketama/blob/master/libketama/ketama.c, ketama_get_server) does on a
+  // sorted ring. Each step goes right while the hash is smaller than h, so the answer is the last
+  // position where the walk went left: k with its trailing right steps (one bits) and that left
+  // step (a zero bit) shifted out. If the walk never went left, every hash is smaller than h and
+  // the ring wraps around to its smallest hash.
+  const uint64_t size = hashes_.size() - 1;
+  uint64_t k = 1;
+  while (k <= size) {
+    k = 2 * k + (hashes_[k] < h);
   }
-  return (*per_priority_state_)[priority]->current_ring_->chooseHost(h);
-}
-
-LoadBalancerPtr RingHashLoadBalancer::LoadBalancerFactoryImpl::create() {
-  auto lb = std::make_unique<LoadBalancerImpl>(stats_, random_);
-
-  // We must protect current_ring_ via a RW lock since it is accessed and written to by multiple
-  // threads. All complex processing has already been precalculated however.
-  std::shared_lock<std::shared_timed_mutex> lock(mutex_);
-  lb->per_priority_load_ = per_priority_load_;
-  lb->per_priority_state_ = per_priority_state_;
-
-  return std::move(lb);
+  k >>= __builtin_ctzll(~k) + 1;
+  return hosts_[host_indices_[k == 0 ? first_ : k]];
 }
 
-HostConstSharedPtr RingHashLoadBalancer::Ring::chooseHost(uint64_t h) const {
-  if (ring_.empty()) {
-    return nullptr;
-  }
-
-  // Ported from https://github.com/RJ/ketama/blob/master/libketama/ketama.c (ketama_get_server)
-  // I've generally kept the variable names to make the code easier to compare.
-  // NOTE: The algorithm depends on using signed integers for lowp, midp, and highp. Do not
-  //       change them!
-  int64_t lowp = 0;
-  int64_t highp = ring_.size();
-  while (true) {
-    int64_t midp = (lowp + highp) / 2;
-
-    if (midp == static_cast<int64_t>(ring_.size())) {
-      return ring_[0].host_;
-    }
-
-    uint64_t midval = ring_[midp].hash_;
-    uint64_t midval1 = midp == 0 ? 0 : ring_[midp - 1].hash_;
-
-    if (h <= midval && h > midval1) {
-      return ring_[midp].host_;
-    }
-
-    if (midval < h) {
-      lowp = midp + 1;
-    } else {
-      highp = midp - 1;
-    }
-
-    if (lowp > highp) {
-      return ring_[0].host_;
-    }
+uint64_t
+RingHashLoadBalancer::Ring::buildLayout(const std::vector<std::pair<uint64_t, uint32_t>>& sorted,
+                                        uint64_t i, uint64_t k) {
+  if (k < hashes_.size()) {
+    i = buildLayout(sorted, i, 2 * k);
+    hashes_[k] = sorted[i].first;
+    host_indices_[k] = sorted[i].second;
+    i = buildLayout(sorted, i + 1, 2 * k + 1);
   }
+  return i;
 }
 
 RingHashLoadBalancer::Ring::Ring(const Optional<envoy::api::v2::Cluster::RingHashLbConfig>& config,
@@ -131,7 +88,10 @@ RingHashLoadBalancer::Ring::Ring(const Optional<envoy::api::v2::Cluster::RingHas
   }
 
   ENVOY_LOG(info, "ring hash: min_ring_size={} hashes_per_host={}", min_ring_size, hashes_per_host);
-  ring_.reserve(hosts.size() * hashes_per_host);
+  RELEASE_ASSERT(hosts.size() <= std::numeric_limits<uint32_t>::max());
+  std::vector<std::pair<uint64_t, uint32_t>> ring;
+  ring.reserve(hosts.size() * hashes_per_host);
+  hosts_.reserve(hosts.size());
 
   const bool use_std_hash =
       config.valid()
@@ -140,6 +100,8 @@ RingHashLoadBalancer::Ring::Ring(const Optional<envoy::api::v2::Cluster::RingHas
 
   char hash_key_buffer[196];
   for (const auto& host : hosts) {
+    const uint32_t host_index = hosts_.size();
+    hosts_.push_back(host);
     const std::string& address_string = host->address()->asString();
     uint64_t offset_start = address_string.size();
 
@@ -165,46 +127,27 @@ RingHashLoadBalancer::Ring::Ring(const Optional<envoy::api::v2::Cluster::RingHas
       const uint64_t hash = use_std_hash ? std::hash<std::string>()(std::string(hash_key))
                                          : HashUtil::xxHash64(hash_key);
       ENVOY_LOG(trace, "ring hash: hash_key={} hash={}", hash_key.data(), hash);
-      ring_.push_back({hash, host});
+      ring.push_back({hash, host_index});
     }
   }
 
-  std::sort(ring_.begin(), ring_.end(), [](const RingEntry& lhs, const RingEntry& rhs) -> bool {
-    return lhs.hash_ < rhs.hash_;
-  });
+  std::sort(ring.begin(), ring.end(),
+            [](const std::pair<uint64_t, uint32_t>& lhs,
+               const std::pair<uint64_t, uint32_t>& rhs) -> bool { return lhs.first < rhs.first; });
 #ifndef NVLOG
-  for (auto entry : ring_) {
-    ENVOY_LOG(trace, "ring hash: host={} hash={}", entry.host_->address()->asString(), entry.hash_);
+  for (const auto& entry : ring) {
+    ENVOY_LOG(trace, "ring hash: host={} hash={}", hosts_[entry.second]->address()->asString(),
+              entry.first);
   }
 #endif
-}
-
-void RingHashLoadBalancer::refresh() {
-  auto per_priority_state = std::make_shared<std::vector<PerPriorityStatePtr>>(
-      priority_set_.hostSetsPerPriority().size());
-  auto per_priority_load = std::make_shared<std::vector<uint32_t>>(per_priority_load_);
-
-  // Note that we only compute global panic on host set refresh. Given that the runtime setting will
-  // rarely change, this is a reasonable compromise to avoid creating extra rings when we only
-  // need to create one per priority level.
-  for (auto& host_set : priority_set_.hostSetsPerPriority()) {
-    uint32_t priority = host_set->priority();
-    (*per_priority_state)[priority].reset(new PerPriorityState);
-    if (isGlobalPanic(*host_set, runtime_)) {
-      (*per_priority_state)[priority]->current_ring_ =
-          std::make_shared<Ring>(config_, host_set->hosts());
-      (*per_priority_state)[priority]->global_panic_ = true;
-    } else {
-      (*per_priority_state)[priority]->current_ring_ =
-          std::make_shared<Ring>(config_, host_set->healthyHosts());
-      (*per_priority_state)[priority]->global_panic_ = false;
-    }
-  }
 
-  {
-    std::unique_lock<std::shared_timed_mutex> lock(factory_->mutex_);
-    factory_->per_priority_load_ = per_priority_load;
-    factory_->per_priority_state_ = per_priority_state;
+  hashes_.resize(ring.size() + 1);
+  host_indices_.resize(ring.size() + 1);
+  buildLayout(ring, 0, 1);
+  // The smallest hash is at the leftmost position of the tree.
+  first_ = 1;
+  while (2 * first_ < hashes_.size()) {
+    first_ *= 2;
   }
 }
 
@@ -9,6 +9,7 @@
 #include "common/config/well_known_names.h"
 #include "common/protobuf/utility.h"
 #include "common/upstream/load_balancer_impl.h"
+#include "common/upstream/maglev_lb.h"
 #include "common/upstream/ring_hash_lb.h"
 
 #include "api/cds.pb.h"
@@ -16,6 +17,13 @@
 namespace Envoy {
 namespace Upstream {
 
+namespace {
+
+// Bounds the resolved subsets kept for the criteria of routes that have been replaced.
+const size_t MaxResolvedSubsets = 1024;
+
+} // namespace
+
 SubsetLoadBalancer::SubsetLoadBalancer(
     LoadBalancerType lb_type, PrioritySet& priority_set, const PrioritySet* local_priority_set,
     ClusterStats& stats, Runtime::Loader& runtime, Runtime::RandomGenerator& random,
@@ -71,7 +79,7 @@ HostConstSharedPtr SubsetLoadBalancer::tryChooseHostFromContext(LoadBalancerCont
   }
 
   // Route has metadata match criteria defined, see if we have a matching subset.
-  LbSubsetEntryPtr entry = findSubset(match_criteria->metadataMatchCriteria());
+  LbSubsetEntryPtr entry = resolveSubset(*match_criteria);
   if (entry == nullptr || !entry->active()) {
     // No matching subset or subset not active: use fallback policy.
     return nullptr;
@@ -82,6 +90,34 @@ HostConstSharedPtr SubsetLoadBalancer::tryChooseHostFromContext(LoadBalancerCont
   return entry->priority_subset_->lb_->chooseHost(context);
 }
 
+// Finds the subset for the given metadata match criteria, reusing the subset found the last time
+// the criteria was used if the hosts have not changed since.
+SubsetLoadBalancer::LbSubsetEntryPtr
+SubsetLoadBalancer::resolveSubset(const Router::MetadataMatchCriteria& match_criteria) {
+  const std::vector<Router::MetadataMatchCriterionConstSharedPtr>& matches =
+      match_criteria.metadataMatchCriteria();
+
+  auto it = resolved_subsets_.find(&match_criteria);
+  if (it != resolved_subsets_.end()) {
+    const ResolvedSubset& resolved = it->second;
+    bool same_matches = resolved.matches_.size() == matches.size();
+    for (size_t i = 0; same_matches && i < matches.size(); i++) {
+      same_matches = !resolved.matches_[i].owner_before(matches[i]) &&
+                     !matches[i].owner_before(resolved.matches_[i]);
+    }
+    if (same_matches) {
+      return resolved.entry_;
+    }
+  } else if (resolved_subsets_.size() >= MaxResolvedSubsets) {
+    resolved_subsets_.clear();
+  }
+
+  ResolvedSubset& resolved = resolved_subsets_[&match_criteria];
+  resolved.matches_.assign(matches.begin(), matches.end());
+  resolved.entry_ = findSubset(matches);
+  return resolved.entry_;
+}
+
 // Iterates over the given metadata match criteria (which must be lexically sorted by key) and find
 // a matching LbSubsetEnryPtr, if any.
 SubsetLoadBalancer::LbSubsetEntryPtr SubsetLoadBalancer::findSubset(
@@ -190,6 +226,7 @@ void SubsetLoadBalancer::processSubsets(
 void SubsetLoadBalancer::update(uint32_t priority, const std::vector<HostSharedPtr>& hosts_added,
                                 const std::vector<HostSharedPtr>& hosts_removed) {
   updateFallbackSubset(priority, hosts_added, hosts_removed);
+  resolved_subsets_.clear();
 
   processSubsets(hosts_added, hosts_removed,
                  [&](LbSubsetEntryPtr entry, HostPredicate predicate, bool adding_host) {
@@ -338,6 +375,11 @@ SubsetLoadBalancer::PrioritySubsetImpl::PrioritySubsetImpl(const SubsetLoadBalan
                                            subset_lb.random_));
     break;
 
+  case LoadBalancerType::PeakEwma:
+    lb_.reset(new PeakEwmaLoadBalancer(*this, subset_lb.original_local_priority_set_,
+                                       subset_lb.stats_, subset_lb.runtime_, subset_lb.random_));
+    break;
+
   case LoadBalancerType::Random:
     lb_.reset(new RandomLoadBalancer(*this, subset_lb.original_local_priority_set_,
                                      subset_lb.stats_, subset_lb.runtime_, subset_lb.random_));
@@ -359,6 +401,13 @@ SubsetLoadBalancer::PrioritySubsetImpl::PrioritySubsetImpl(const SubsetLoadBalan
     lb_ = thread_aware_lb_->factory()->create();
     break;
 
+  case LoadBalancerType::Maglev:
+    thread_aware_lb_.reset(
+        new MaglevLoadBalancer(*this, subset_lb.stats_, subset_lb.runtime_, subset_lb.random_));
+    thread_aware_lb_->initialize();
+    lb_ = thread_aware_lb_->factory()->create();
+    break;
+
   case LoadBalancerType::OriginalDst:
     NOT_REACHED;
   }
@@ -5,6 +5,7 @@
 #include <memory>
 #include <string>
 #include <unordered_map>
+#include <vector>
 
 #include "envoy/common/optional.h"
 #include "envoy/runtime/runtime.h"
@@ -91,6 +92,15 @@ private:
   typedef std::unordered_map<HashedValue, LbSubsetEntryPtr> ValueSubsetMap;
   typedef std::unordered_map<std::string, ValueSubsetMap> LbSubsetMap;
 
+  // The subset found for a metadata match criteria, see resolved_subsets_.
+  struct ResolvedSubset {
+    // The matches of the criteria. The address of a destroyed criteria may be reused by a new
+    // one, which is told apart by its matches: the weak pointers keep the control blocks of the
+    // matches alive, so a new criterion can not have the same owner as an old one.
+    std::vector<std::weak_ptr<const Router::MetadataMatchCriterion>> matches_;
+    LbSubsetEntryPtr entry_;
+  };
+
   // Entry in the subset hierarchy.
   class LbSubsetEntry {
   public:
@@ -120,6 +130,7 @@ private:
   bool hostMatchesDefaultSubset(const Host& host);
   bool hostMatches(const SubsetMetadata& kvs, const Host& host);
 
+  LbSubsetEntryPtr resolveSubset(const Router::MetadataMatchCriteria& match_criteria);
   LbSubsetEntryPtr
   findSubset(const std::vector<Router::MetadataMatchCriterionConstSharedPtr>& matches);
 
@@ -145,6 +156,12 @@ private:
 
   // Forms a trie-like structure. Requires lexically sorted Host and Route metadata.
   LbSubsetMap subsets_;
+
+  // The subset found in subsets_ for each metadata match criteria, keyed by the address of the
+  // criteria. The criteria of a route rarely change, so this saves walking subsets_ for every
+  // request. Subsets are never removed from subsets_, but new ones may be added when the hosts
+  // change, which clears this.
+  std::unordered_map<const Router::MetadataMatchCriteria*, ResolvedSubset> resolved_subsets_;
 };
 
 } // namespace Upstream
@@ -0,0 +1,133 @@
+#include "common/upstream/tcp_preconnect_pool.h"
+
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+namespace Envoy {
+namespace Upstream {
+
+TcpPreconnectPool::TcpPreconnectPool(Event::Dispatcher& dispatcher,
+                                     ClusterInfoConstSharedPtr cluster)
+    : dispatcher_(dispatcher), cluster_(cluster) {}
+
+TcpPreconnectPool::~TcpPreconnectPool() {
+  for (auto& host : hosts_) {
+    closeAll(host.second);
+  }
+}
+
+void TcpPreconnectPool::addHosts(const std::vector<HostSharedPtr>& hosts) {
+  for (const HostSharedPtr& host : hosts) {
+    const IdleConnectionList& connections = hosts_[host];
+    while (connections.size() < cluster_->tcpPreconnectPerHost()) {
+      open(host);
+    }
+  }
+}
+
+void TcpPreconnectPool::removeHosts(const std::vector<HostSharedPtr>& hosts) {
+  for (const HostSharedPtr& host : hosts) {
+    auto connections = hosts_.find(host);
+    if (connections != hosts_.end()) {
+      closeAll(connections->second);
+      hosts_.erase(connections);
+    }
+  }
+}
+
+Host::CreateConnectionData TcpPreconnectPool::claim(const HostConstSharedPtr& host) {
+  Host::CreateConnectionData data{nullptr, nullptr};
+  auto entry = hosts_.find(host);
+  if (entry == hosts_.end()) {
+    return data;
+  }
+
+  // Connections are opened at the front, so the oldest established connection is handed out,
+  // leaving the newer ones the longest time before they reach their maximum age.
+  IdleConnectionList& connections = entry->second;
+  for (auto connection = connections.rbegin(); connection != connections.rend(); connection++) {
+    if ((*connection)->connected_) {
+      IdleConnectionPtr claimed = (*connection)->removeFromList(connections);
+      claimed->data_.connection_->removeConnectionCallbacks(*claimed);
+      claimed->data_.connection_->readDisable(false);
+      data = std::move(claimed->data_);
+      data.preconnected_ = true;
+      cluster_->stats().upstream_cx_preconnect_claimed_.inc();
+      ENVOY_LOG(debug, "claimed preconnected connection to {}", host->address()->asString());
+      break;
+    }
+  }
+
+  while (connections.size() < cluster_->tcpPreconnectPerHost()) {
+    open(host);
+  }
+
+  return data;
+}
+
+uint64_t TcpPreconnectPool::idleConnections(const HostConstSharedPtr& host) const {
+  auto connections = hosts_.find(host);
+  return connections == hosts_.end() ? 0 : connections->second.size();
+}
+
+void TcpPreconnectPool::open(const HostConstSharedPtr& host) {
+  ENVOY_LOG(debug, "preconnecting to {}", host->address()->asString());
+  IdleConnectionPtr connection(new IdleConnection(*this, host));
+  connection->moveIntoList(std::move(connection), hosts_[host]);
+}
+
+void TcpPreconnectPool::onClosed(IdleConnection& connection) {
+  const HostConstSharedPtr host = connection.host_;
+  const bool replace = connection.connected_;
+  ENVOY_LOG(debug, "preconnected connection to {} closed", host->address()->asString());
+  connection.timer_->disableTimer();
+  dispatcher_.deferredDelete(connection.removeFromList(hosts_[host]));
+
+  if (replace) {
+    open(host);
+  }
+}
+
+void TcpPreconnectPool::closeAll(IdleConnectionList& connections) {
+  for (const IdleConnectionPtr& connection : connections) {
+    connection->data_.connection_->removeConnectionCallbacks(*connection);
+    connection->data_.connection_->close(Network::ConnectionCloseType::NoFlush);
+  }
+  connections.clear();
+}
+
+TcpPreconnectPool::IdleConnection::IdleConnection(TcpPreconnectPool& parent,
+                                                  const HostConstSharedPtr& host)
+    : parent_(parent), host_(host), data_(host->createConnection(parent.dispatcher_)),
+      timer_(parent.dispatcher_.createTimer([this]() -> void { onTimeout(); })) {
+  parent_.cluster_->stats().upstream_cx_prefetch_.inc();
+  data_.connection_->addConnectionCallbacks(*this);
+  // With reads disabled the connection still reports a remote close.
+  data_.connection_->readDisable(true);
+  data_.connection_->connect();
+  timer_->enableTimer(parent_.cluster_->connectTimeout());
+}
+
+void TcpPreconnectPool::IdleConnection::onTimeout() {
+  if (connected_) {
+    parent_.cluster_->stats().upstream_cx_preconnect_expired_.inc();
+  } else {
+    parent_.cluster_->stats().upstream_cx_connect_timeout_.inc();
+  }
+
+  data_.connection_->close(Network::ConnectionCloseType::NoFlush);
+}
+
+void TcpPreconnectPool::IdleConnection::onEvent(Network::ConnectionEvent event) {
+  if (event == Network::ConnectionEvent::Connected) {
+    connected_ = true;
+    timer_->enableTimer(parent_.cluster_->tcpPreconnectMaxAge());
+    return;
+  }
+
+  parent_.onClosed(*this);
+}
+
+} // namespace Upstream
+} // namespace Envoy
@@ -0,0 +1,94 @@
+#pragma once
+
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+#include "envoy/event/deferred_deletable.h"
+#include "envoy/event/dispatcher.h"
+#include "envoy/event/timer.h"
+#include "envoy/network/connection.h"
+#include "envoy/upstream/upstream.h"
+
+#include "common/common/linked_object.h"
+#include "common/common/logger.h"
+
+namespace Envoy {
+namespace Upstream {
+
+/**
+ * Established idle TCP connections to the hosts of a cluster, kept by one worker so that
+ * tcpConnForCluster() can hand one out rather than making the caller wait for a connect. Each host
+ * gets ClusterInfo::tcpPreconnectPerHost() connections. Idle connections are read disabled, so
+ * anything a host sends first stays in the socket for whoever claims the connection, and they are
+ * closed and replaced when they reach ClusterInfo::tcpPreconnectMaxAge(). A connection that fails
+ * to connect is only replaced when a connection to its host is next claimed, so that hosts that
+ * are down are not reconnected to in a loop.
+ */
+class TcpPreconnectPool : Logger::Loggable<Logger::Id::upstream> {
+public:
+  TcpPreconnectPool(Event::Dispatcher& dispatcher, ClusterInfoConstSharedPtr cluster);
+  ~TcpPreconnectPool();
+
+  /**
+   * Open idle connections to hosts added to the cluster.
+   */
+  void addHosts(const std::vector<HostSharedPtr>& hosts);
+
+  /**
+   * Close the idle connections to hosts removed from the cluster.
+   */
+  void removeHosts(const std::vector<HostSharedPtr>& hosts);
+
+  /**
+   * Take an established idle connection to a host and open another in its place.
+   * @param host supplies the host chosen by the load balancer.
+   * @return the connection, with preconnected_ set, or a null connection if there is no
+   *         established connection to the host.
+   */
+  Host::CreateConnectionData claim(const HostConstSharedPtr& host);
+
+  /**
+   * @return the number of idle connections to a host, including those still connecting.
+   */
+  uint64_t idleConnections(const HostConstSharedPtr& host) const;
+
+private:
+  struct IdleConnection : public Network::ConnectionCallbacks,
+                          public Event::DeferredDeletable,
+                          LinkedObject<IdleConnection> {
+    IdleConnection(TcpPreconnectPool& parent, const HostConstSharedPtr& host);
+
+    void onTimeout();
+
+    // Network::ConnectionCallbacks
+    void onEvent(Network::ConnectionEvent event) override;
+    void onAboveWriteBufferHighWatermark() override {}
+    void onBelowWriteBufferLowWatermark() override {}
+
+    TcpPreconnectPool& parent_;
+    const HostConstSharedPtr host_;
+    Host::CreateConnectionData data_;
+    // The connect timeout until the connection is established, the maximum age after.
+    Event::TimerPtr timer_;
+    bool connected_{};
+  };
+
+  typedef std::unique_ptr<IdleConnection> IdleConnectionPtr;
+  typedef std::list<IdleConnectionPtr> IdleConnectionList;
+
+  void open(const HostConstSharedPtr& host);
+  void onClosed(IdleConnection& connection);
+  void closeAll(IdleConnectionList& connections);
+
+  Event::Dispatcher& dispatcher_;
+  const ClusterInfoConstSharedPtr cluster_;
+  std::unordered_map<HostConstSharedPtr, IdleConnectionList> hosts_;
+};
+
+typedef std::unique_ptr<TcpPreconnectPool> TcpPreconnectPoolPtr;
+
+} // namespace Upstream
+} // namespace Envoy
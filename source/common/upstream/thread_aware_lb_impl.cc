@@ -0,0 +1,218 @@
+#include "common/upstream/thread_aware_lb_impl.h"
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include "common/common/assert.h"
+#include "common/common/thread.h"
+
+namespace Envoy {
+namespace Upstream {
+
+/**
+ * Runs the builds of a load balancer on a background thread, one at a time. A request that
+ * arrives while a build is in progress replaces any request still waiting, so only the latest
+ * hosts are built. Completed builds are posted to the main thread, where they are published unless
+ * the load balancer has been destroyed since.
+ */
+class ThreadAwareLoadBalancerBase::AsyncRefresher {
+public:
+  AsyncRefresher(ThreadAwareLoadBalancerBase& parent) : parent_(parent) {}
+
+  ~AsyncRefresher() {
+    {
+      std::unique_lock<std::mutex> lock(lock_);
+      stop_ = true;
+    }
+    cv_.notify_one();
+    // This waits for a build in progress, whose result is then dropped.
+    thread_->join();
+  }
+
+  static AsyncRefresherSharedPtr create(ThreadAwareLoadBalancerBase& parent) {
+    AsyncRefresherSharedPtr refresher = std::make_shared<AsyncRefresher>(parent);
+    refresher->self_ = refresher;
+    refresher->thread_.reset(new Thread::Thread([refresher_ptr = refresher.get()]() -> void {
+      refresher_ptr->threadRoutine();
+    }));
+    return refresher;
+  }
+
+  void refresh(RefreshRequestPtr&& request) {
+    {
+      std::unique_lock<std::mutex> lock(lock_);
+      pending_ = std::move(request);
+    }
+    cv_.notify_one();
+  }
+
+private:
+  void threadRoutine() {
+    while (true) {
+      std::shared_ptr<RefreshRequest> request;
+      {
+        std::unique_lock<std::mutex> lock(lock_);
+        cv_.wait(lock, [this]() -> bool { return stop_ || pending_ != nullptr; });
+        if (stop_) {
+          return;
+        }
+        request = std::move(pending_);
+      }
+
+      const auto start = std::chrono::steady_clock::now();
+      PerPriorityStateVectorSharedPtr per_priority_state = build(parent_.builder_, *request);
+      const std::chrono::milliseconds build_time =
+          std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() -
+                                                                start);
+
+      std::weak_ptr<AsyncRefresher> weak_self = self_;
+      parent_.dispatcher_->post([weak_self, request, per_priority_state, build_time]() -> void {
+        AsyncRefresherSharedPtr self = weak_self.lock();
+        if (self != nullptr) {
+          self->parent_.publish(*request, per_priority_state, build_time);
+        }
+      });
+    }
+  }
+
+  ThreadAwareLoadBalancerBase& parent_;
+  std::weak_ptr<AsyncRefresher> self_;
+  std::mutex lock_;
+  std::condition_variable cv_;
+  RefreshRequestPtr pending_;
+  bool stop_{};
+  Thread::ThreadPtr thread_;
+};
+
+ThreadAwareLoadBalancerBase::ThreadAwareLoadBalancerBase(PrioritySet& priority_set,
+                                                         ClusterStats& stats,
+                                                         Runtime::Loader& runtime,
+                                                         Runtime::RandomGenerator& random,
+                                                         HashingLoadBalancerBuilder builder,
+                                                         Event::Dispatcher* dispatcher)
+    : LoadBalancerBase(priority_set, stats, runtime, random),
+      factory_(new LoadBalancerFactoryImpl(stats, random)), builder_(builder),
+      dispatcher_(dispatcher) {}
+
+ThreadAwareLoadBalancerBase::~ThreadAwareLoadBalancerBase() {}
+
+void ThreadAwareLoadBalancerBase::initialize() {
+  // The initial lookup structures are built inline, so that the load balancer is usable as soon as
+  // the cluster is initialized.
+  priority_set_.addMemberUpdateCb(
+      [this](uint32_t, const std::vector<HostSharedPtr>&,
+             const std::vector<HostSharedPtr>&) -> void { refresh(true); });
+
+  refresh(false);
+}
+
+HostConstSharedPtr
+ThreadAwareLoadBalancerBase::LoadBalancerImpl::chooseHost(LoadBalancerContext* context) {
+  if (factory_->version_ != version_) {
+    std::shared_lock<std::shared_timed_mutex> lock(factory_->mutex_);
+    refresh();
+  }
+
+  // Make sure we correctly return nullptr for any early chooseHost() calls.
+  if (per_priority_state_ == nullptr) {
+    return nullptr;
+  }
+  // If there is no hash in the context, just choose a random value (this effectively becomes
+  // the random LB but it won't crash if someone configures it this way).
+  // computeHashKey() may be computed on demand, so get it only once.
+  Optional<uint64_t> hash;
+  if (context) {
+    hash = context->computeHashKey();
+  }
+  const uint64_t h = hash.valid() ? hash.value() : random_.random();
+
+  const uint32_t priority = LoadBalancerBase::choosePriority(h, *per_priority_load_);
+  if ((*per_priority_state_)[priority]->global_panic_) {
+    stats_.lb_healthy_panic_.inc();
+  }
+  return (*per_priority_state_)[priority]->current_lb_->chooseHost(h);
+}
+
+void ThreadAwareLoadBalancerBase::LoadBalancerImpl::refresh() {
+  per_priority_load_ = factory_->per_priority_load_;
+  per_priority_state_ = factory_->per_priority_state_;
+  version_ = factory_->version_;
+}
+
+LoadBalancerPtr ThreadAwareLoadBalancerBase::LoadBalancerFactoryImpl::create() {
+  auto lb = std::make_unique<LoadBalancerImpl>(shared_from_this());
+
+  // We must protect current_lb_ via a RW lock since it is accessed and written to by multiple
+  // threads. All complex processing has already been precalculated however.
+  std::shared_lock<std::shared_timed_mutex> lock(mutex_);
+  lb->refresh();
+
+  return std::move(lb);
+}
+
+void ThreadAwareLoadBalancerBase::refresh(bool allow_async) {
+  // Note that we only compute global panic on host set refresh. Given that the runtime setting will
+  // rarely change, this is a reasonable compromise to avoid creating extra lookup structures when
+  // we only need to create one per priority level.
+  RefreshRequestPtr request(new RefreshRequest());
+  request->sequence_ = ++next_sequence_;
+  request->per_priority_load_ = std::make_shared<std::vector<uint32_t>>(per_priority_load_);
+  request->hosts_per_priority_.resize(priority_set_.hostSetsPerPriority().size());
+  for (auto& host_set : priority_set_.hostSetsPerPriority()) {
+    const bool global_panic = isGlobalPanic(*host_set, runtime_);
+    request->hosts_per_priority_[host_set->priority()] = {
+        global_panic ? host_set->hosts() : host_set->healthyHosts(), global_panic};
+  }
+
+  if (allow_async && dispatcher_ != nullptr &&
+      runtime_.snapshot().featureEnabled("upstream.async_lb_rebuild", 100)) {
+    if (async_refresher_ == nullptr) {
+      async_refresher_ = AsyncRefresher::create(*this);
+    }
+    async_refresher_->refresh(std::move(request));
+    return;
+  }
+
+  const auto start = std::chrono::steady_clock::now();
+  PerPriorityStateVectorSharedPtr per_priority_state = build(builder_, *request);
+  publish(*request, per_priority_state,
+          std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() -
+                                                                start));
+}
+
+ThreadAwareLoadBalancerBase::PerPriorityStateVectorSharedPtr
+ThreadAwareLoadBalancerBase::build(const HashingLoadBalancerBuilder& builder,
+                                   const RefreshRequest& request) {
+  auto per_priority_state =
+      std::make_shared<std::vector<PerPriorityStatePtr>>(request.hosts_per_priority_.size());
+  for (uint32_t priority = 0; priority < request.hosts_per_priority_.size(); priority++) {
+    (*per_priority_state)[priority].reset(new PerPriorityState);
+    (*per_priority_state)[priority]->current_lb_ =
+        builder(request.hosts_per_priority_[priority].first);
+    (*per_priority_state)[priority]->global_panic_ = request.hosts_per_priority_[priority].second;
+  }
+  return per_priority_state;
+}
+
+void ThreadAwareLoadBalancerBase::publish(const RefreshRequest& request,
+                                          PerPriorityStateVectorSharedPtr per_priority_state,
+                                          std::chrono::milliseconds build_time) {
+  // A synchronous build may have completed after a background build was requested.
+  if (request.sequence_ < published_sequence_) {
+    return;
+  }
+  published_sequence_ = request.sequence_;
+  stats_.lb_rebuild_ms_.recordValue(build_time.count());
+
+  std::unique_lock<std::shared_timed_mutex> lock(factory_->mutex_);
+  factory_->per_priority_load_ = request.per_priority_load_;
+  factory_->per_priority_state_ = per_priority_state;
+  factory_->version_++;
+}
+
+} // namespace Upstream
+} // namespace Envoy
@@ -0,0 +1,147 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <shared_mutex>
+#include <utility>
+#include <vector>
+
+#include "envoy/event/dispatcher.h"
+#include "envoy/runtime/runtime.h"
+#include "envoy/upstream/load_balancer.h"
+
+#include "common/upstream/load_balancer_impl.h"
+
+namespace Envoy {
+namespace Upstream {
+
+/**
+ * Base for the thread aware load balancers that map a hash to a host (ring hash and Maglev). The
+ * per priority lookup structures are built whenever the hosts change and are shared by all the
+ * worker load balancers created by the factory.
+ *
+ * The first lookup structures are built by initialize(). Given a main thread dispatcher, the
+ * structures for later host updates are built on a background thread while the previous ones keep
+ * serving, unless the upstream.async_lb_rebuild runtime feature is off. Host updates that arrive
+ * during a build are collapsed into the next build. The completed structures are published on the
+ * main thread, and worker load balancers pick them up on their next pick.
+ */
+class ThreadAwareLoadBalancerBase : public LoadBalancerBase, public ThreadAwareLoadBalancer {
+public:
+  /**
+   * A lookup structure that maps a hash to one of a set of hosts.
+   */
+  class HashingLoadBalancer {
+  public:
+    virtual ~HashingLoadBalancer() {}
+
+    /**
+     * @return HostConstSharedPtr the host for a hash, or nullptr if there are no hosts.
+     */
+    virtual HostConstSharedPtr chooseHost(uint64_t hash) const PURE;
+  };
+  typedef std::shared_ptr<const HashingLoadBalancer> HashingLoadBalancerSharedPtr;
+
+  /**
+   * Builds the lookup structure for a set of hosts. It may run on the background thread, so it
+   * must only use what it captures by value.
+   */
+  typedef std::function<HashingLoadBalancerSharedPtr(const std::vector<HostSharedPtr>& hosts)>
+      HashingLoadBalancerBuilder;
+
+  ~ThreadAwareLoadBalancerBase();
+
+  // Upstream::ThreadAwareLoadBalancer
+  LoadBalancerFactorySharedPtr factory() override { return factory_; }
+  void initialize() override;
+
+protected:
+  /**
+   * @param builder supplies the builder of the lookup structures.
+   * @param dispatcher supplies the main thread dispatcher to build on a background thread, or
+   *        nullptr to always build on the thread that updates the hosts.
+   */
+  ThreadAwareLoadBalancerBase(PrioritySet& priority_set, ClusterStats& stats,
+                              Runtime::Loader& runtime, Runtime::RandomGenerator& random,
+                              HashingLoadBalancerBuilder builder, Event::Dispatcher* dispatcher);
+
+private:
+  struct PerPriorityState {
+    HashingLoadBalancerSharedPtr current_lb_;
+    bool global_panic_{};
+  };
+  typedef std::unique_ptr<PerPriorityState> PerPriorityStatePtr;
+  typedef std::shared_ptr<std::vector<PerPriorityStatePtr>> PerPriorityStateVectorSharedPtr;
+
+  // The hosts of each priority (with its global panic state) and the priority load to build
+  // from, captured when the hosts change.
+  struct RefreshRequest {
+    uint64_t sequence_;
+    std::vector<std::pair<std::vector<HostSharedPtr>, bool>> hosts_per_priority_;
+    std::shared_ptr<std::vector<uint32_t>> per_priority_load_;
+  };
+  typedef std::unique_ptr<RefreshRequest> RefreshRequestPtr;
+
+  struct LoadBalancerFactoryImpl : public LoadBalancerFactory,
+                                   public std::enable_shared_from_this<LoadBalancerFactoryImpl> {
+    LoadBalancerFactoryImpl(ClusterStats& stats, Runtime::RandomGenerator& random)
+        : stats_(stats), random_(random) {}
+
+    // Upstream::LoadBalancerFactory
+    LoadBalancerPtr create() override;
+
+    ClusterStats& stats_;
+    Runtime::RandomGenerator& random_;
+    std::shared_timed_mutex mutex_;
+    // TOOD(mattklein123): Added GUARDED_BY(mutex_) to to the following variables. OSX clang
+    // seems to not like them with shared mutexes so we need to ifdef them out on OSX. I don't
+    // have time to do this right now.
+    PerPriorityStateVectorSharedPtr per_priority_state_;
+    // This is split out of PerPriorityState so LoadBalancerBase::ChoosePriorirty can be reused.
+    std::shared_ptr<std::vector<uint32_t>> per_priority_load_;
+    // Incremented, with mutex_ held, every time new state is published. Worker load balancers
+    // compare it with the version of their state before each pick.
+    std::atomic<uint64_t> version_{};
+  };
+
+  struct LoadBalancerImpl : public LoadBalancer {
+    LoadBalancerImpl(std::shared_ptr<LoadBalancerFactoryImpl> factory)
+        : factory_(factory), stats_(factory->stats_), random_(factory->random_) {}
+
+    // Upstream::LoadBalancer
+    HostConstSharedPtr chooseHost(LoadBalancerContext* context) override;
+
+    // Take the state last published to the factory. Requires the factory mutex.
+    void refresh();
+
+    std::shared_ptr<LoadBalancerFactoryImpl> factory_;
+    ClusterStats& stats_;
+    Runtime::RandomGenerator& random_;
+    uint64_t version_{};
+    PerPriorityStateVectorSharedPtr per_priority_state_;
+    std::shared_ptr<std::vector<uint32_t>> per_priority_load_;
+  };
+
+  class AsyncRefresher;
+  typedef std::shared_ptr<AsyncRefresher> AsyncRefresherSharedPtr;
+
+  void refresh(bool allow_async);
+  static PerPriorityStateVectorSharedPtr build(const HashingLoadBalancerBuilder& builder,
+                                               const RefreshRequest& request);
+  void publish(const RefreshRequest& request, PerPriorityStateVectorSharedPtr per_priority_state,
+               std::chrono::milliseconds build_time);
+
+  std::shared_ptr<LoadBalancerFactoryImpl> factory_;
+  const HashingLoadBalancerBuilder builder_;
+  Event::Dispatcher* dispatcher_;
+  uint64_t next_sequence_{};
+  uint64_t published_sequence_{};
+  // Created on the first background build, and destroyed before builder_.
+  AsyncRefresherSharedPtr async_refresher_;
+};
+
+} // namespace Upstream
+} // namespace Envoy
@@ -1,7 +1,9 @@
 #include "common/upstream/upstream_impl.h"
 
 #include <chrono>
+#include <cmath>
 #include <cstdint>
+#include <limits>
 #include <list>
 #include <memory>
 #include <string>
@@ -17,9 +19,11 @@
 
 #include "common/common/enum_to_int.h"
 #include "common/common/utility.h"
+#include "common/config/metadata.h"
 #include "common/config/protocol_json.h"
 #include "common/config/tls_context_json.h"
 #include "common/config/utility.h"
+#include "common/config/well_known_names.h"
 #include "common/http/utility.h"
 #include "common/network/address_impl.h"
 #include "common/network/raw_buffer_socket.h"
@@ -51,8 +55,54 @@ getSourceAddress(const envoy::api::v2::Cluster& cluster,
   // If there's no source address in the cluster config, use any default from the bootstrap proto.
   return source_address;
 }
+
+// Reads an integer of at least 1 from the envoy.lb metadata of a cluster, 1 if the key is not set.
+uint32_t getPositiveIntegerMetadataValue(const envoy::api::v2::Cluster& cluster,
+                                         const std::string& key, const std::string& description) {
+  const ProtobufWkt::Value& value = Config::Metadata::metadataValue(
+      cluster.metadata(), Config::MetadataFilters::get().ENVOY_LB, key);
+  if (value.kind_case() == ProtobufWkt::Value::KIND_NOT_SET) {
+    return 1;
+  }
+
+  const double number = value.number_value();
+  if (number < 1 || number > std::numeric_limits<uint32_t>::max() ||
+      number != std::floor(number)) {
+    throw EnvoyException(
+        fmt::format("cluster: {} must be a positive integer: {}", description, number));
+  }
+  return static_cast<uint32_t>(number);
+}
 } // namespace
 
+#define GENERATE_HOST_STAT_INIT(NAME) NAME##_(HostStatNames::get().NAME##_),
+#define GENERATE_HOST_STAT_REF(NAME) NAME##_,
+#define GENERATE_HOST_COUNTER_LIST(NAME) counters.emplace_back(&NAME##_, [](Stats::Counter*) {});
+#define GENERATE_HOST_GAUGE_LIST(NAME) gauges.emplace_back(&NAME##_, [](Stats::Gauge*) {});
+#define IGNORE_HOST_STAT(NAME)
+
+HostMetrics::HostMetrics()
+    : ALL_HOST_STATS(GENERATE_HOST_STAT_INIT, GENERATE_HOST_STAT_INIT)
+          stats_{ALL_HOST_STATS(GENERATE_HOST_STAT_REF, GENERATE_HOST_STAT_REF)} {}
+
+std::list<Stats::CounterSharedPtr> HostMetrics::counters() const {
+  std::list<Stats::CounterSharedPtr> counters;
+  ALL_HOST_STATS(GENERATE_HOST_COUNTER_LIST, IGNORE_HOST_STAT)
+  return counters;
+}
+
+std::list<Stats::GaugeSharedPtr> HostMetrics::gauges() const {
+  std::list<Stats::GaugeSharedPtr> gauges;
+  ALL_HOST_STATS(IGNORE_HOST_STAT, GENERATE_HOST_GAUGE_LIST)
+  return gauges;
+}
+
+#undef GENERATE_HOST_STAT_INIT
+#undef GENERATE_HOST_STAT_REF
+#undef GENERATE_HOST_COUNTER_LIST
+#undef GENERATE_HOST_GAUGE_LIST
+#undef IGNORE_HOST_STAT
+
 Host::CreateConnectionData HostImpl::createConnection(Event::Dispatcher& dispatcher) const {
   return {createConnection(dispatcher, *cluster_, address_), shared_from_this()};
 }
@@ -63,6 +113,9 @@ HostImpl::createConnection(Event::Dispatcher& dispatcher, const ClusterInfo& clu
   Network::ClientConnectionPtr connection = dispatcher.createClientConnection(
       address, cluster.sourceAddress(), cluster.transportSocketFactory().createTransportSocket());
   connection->setBufferLimits(cluster.perConnectionBufferLimitBytes());
+  if (cluster.tcpFastOpen()) {
+    connection->enableFastOpen();
+  }
   return connection;
 }
 
@@ -98,12 +151,28 @@ ClusterInfoImpl::ClusterInfoImpl(const envoy::api::v2::Cluster& config,
     : runtime_(runtime), name_(config.name()), type_(config.type()),
       max_requests_per_connection_(
           PROTOBUF_GET_WRAPPED_OR_DEFAULT(config, max_requests_per_connection, 0)),
+      prefetch_ratio_(Config::Metadata::metadataValue(
+                          config.metadata(), Config::MetadataFilters::get().ENVOY_LB,
+                          Config::MetadataEnvoyLbKeys::get().PREFETCH_RATIO)
+                          .number_value()),
+      http2_connections_per_host_(getPositiveIntegerMetadataValue(
+          config, Config::MetadataEnvoyLbKeys::get().HTTP2_CONNECTIONS_PER_HOST,
+          "HTTP/2 connections per host")),
+      worker_subsets_(getPositiveIntegerMetadataValue(
+          config, Config::MetadataEnvoyLbKeys::get().WORKER_SUBSETS, "worker subsets")),
+      health_check_partitions_(getPositiveIntegerMetadataValue(
+          config, Config::MetadataEnvoyLbKeys::get().HEALTH_CHECK_PARTITIONS,
+          "health check partitions")),
       connect_timeout_(
           std::chrono::milliseconds(PROTOBUF_GET_MS_REQUIRED(config, connect_timeout))),
       per_connection_buffer_limit_bytes_(
           PROTOBUF_GET_WRAPPED_OR_DEFAULT(config, per_connection_buffer_limit_bytes, 1024 * 1024)),
+      tcp_fast_open_(Config::Metadata::metadataValue(
+                         config.metadata(), Config::MetadataFilters::get().ENVOY_LB,
+                         Config::MetadataEnvoyLbKeys::get().TCP_FAST_OPEN)
+                         .bool_value()),
       stats_scope_(stats.createScope(fmt::format("cluster.{}.", name_))),
-      stats_(generateStats(*stats_scope_)),
+      stats_(generateStats(*stats_scope_)), code_stats_(*stats_scope_),
       load_report_stats_(generateLoadReportStats(load_report_stats_store_)),
       features_(parseFeatures(config)),
       http2_settings_(Http::Utility::parseHttp2Settings(config.http2_protocol_options())),
@@ -114,6 +183,45 @@ ClusterInfoImpl::ClusterInfoImpl(const envoy::api::v2::Cluster& config,
       ssl_context_manager_(ssl_context_manager), added_via_api_(added_via_api),
       lb_subset_(LoadBalancerSubsetInfoImpl(config.lb_subset_config())),
       metadata_(config.metadata()) {
+  if (prefetch_ratio_ < 0) {
+    throw EnvoyException(
+        fmt::format("cluster: prefetch ratio must not be negative: {}", prefetch_ratio_));
+  }
+
+  const std::string& idle_timeout_key = Config::MetadataEnvoyLbKeys::get().IDLE_TIMEOUT_MS;
+  if (Config::Metadata::metadataValue(config.metadata(), Config::MetadataFilters::get().ENVOY_LB,
+                                      idle_timeout_key)
+          .kind_case() != ProtobufWkt::Value::KIND_NOT_SET) {
+    idle_timeout_.value(std::chrono::milliseconds(
+        getPositiveIntegerMetadataValue(config, idle_timeout_key, "idle timeout")));
+  }
+
+  const std::string& tcp_preconnect_key =
+      Config::MetadataEnvoyLbKeys::get().TCP_PRECONNECT_PER_HOST;
+  if (Config::Metadata::metadataValue(config.metadata(), Config::MetadataFilters::get().ENVOY_LB,
+                                      tcp_preconnect_key)
+          .kind_case() != ProtobufWkt::Value::KIND_NOT_SET) {
+    tcp_preconnect_per_host_ =
+        getPositiveIntegerMetadataValue(config, tcp_preconnect_key, "TCP preconnects per host");
+  }
+
+  const std::string& tcp_preconnect_max_age_key =
+      Config::MetadataEnvoyLbKeys::get().TCP_PRECONNECT_MAX_AGE_MS;
+  if (Config::Metadata::metadataValue(config.metadata(), Config::MetadataFilters::get().ENVOY_LB,
+                                      tcp_preconnect_max_age_key)
+          .kind_case() != ProtobufWkt::Value::KIND_NOT_SET) {
+    tcp_preconnect_max_age_ = std::chrono::milliseconds(getPositiveIntegerMetadataValue(
+        config, tcp_preconnect_max_age_key, "TCP preconnect max age"));
+  }
+
+  const std::string& update_merge_window_key =
+      Config::MetadataEnvoyLbKeys::get().UPDATE_MERGE_WINDOW_MS;
+  if (Config::Metadata::metadataValue(config.metadata(), Config::MetadataFilters::get().ENVOY_LB,
+                                      update_merge_window_key)
+          .kind_case() != ProtobufWkt::Value::KIND_NOT_SET) {
+    update_merge_window_.value(std::chrono::milliseconds(getPositiveIntegerMetadataValue(
+        config, update_merge_window_key, "update merge window")));
+  }
 
   auto transport_socket = config.transport_socket();
   if (!config.has_transport_socket()) {
@@ -136,13 +244,25 @@ ClusterInfoImpl::ClusterInfoImpl(const envoy::api::v2::Cluster& config,
     lb_type_ = LoadBalancerType::RoundRobin;
     break;
   case envoy::api::v2::Cluster::LEAST_REQUEST:
-    lb_type_ = LoadBalancerType::LeastRequest;
+    // As with Maglev, least request clusters opt into peak EWMA through their metadata.
+    lb_type_ = Config::Metadata::metadataValue(config.metadata(),
+                                               Config::MetadataFilters::get().ENVOY_LB,
+                                               Config::MetadataEnvoyLbKeys::get().PEAK_EWMA)
+                       .bool_value()
+                   ? LoadBalancerType::PeakEwma
+                   : LoadBalancerType::LeastRequest;
     break;
   case envoy::api::v2::Cluster::RANDOM:
     lb_type_ = LoadBalancerType::Random;
     break;
   case envoy::api::v2::Cluster::RING_HASH:
-    lb_type_ = LoadBalancerType::RingHash;
+    // The v2 API has no Maglev policy, so ring hash clusters opt into it through their metadata.
+    lb_type_ = Config::Metadata::metadataValue(config.metadata(),
+                                               Config::MetadataFilters::get().ENVOY_LB,
+                                               Config::MetadataEnvoyLbKeys::get().MAGLEV)
+                       .bool_value()
+                   ? LoadBalancerType::Maglev
+                   : LoadBalancerType::RingHash;
     break;
   case envoy::api::v2::Cluster::ORIGINAL_DST_LB:
     if (config.type() != envoy::api::v2::Cluster::ORIGINAL_DST) {
@@ -175,7 +295,7 @@ ClusterSharedPtr ClusterImplBase::create(const envoy::api::v2::Cluster& cluster,
                                          Event::Dispatcher& dispatcher,
                                          const LocalInfo::LocalInfo& local_info,
                                          Outlier::EventLoggerSharedPtr outlier_event_logger,
-                                         bool added_via_api) {
+                                         bool added_via_api, ClusterInfoConstSharedPtr info) {
   std::unique_ptr<ClusterImplBase> new_cluster;
 
   // We make this a shared pointer to deal with the distinct ownership
@@ -193,22 +313,23 @@ ClusterSharedPtr ClusterImplBase::create(const envoy::api::v2::Cluster& cluster,
       resolvers.push_back(Network::Address::resolveProtoAddress(resolver_addr));
     }
     selected_dns_resolver = dispatcher.createDnsResolver(resolvers);
+    selected_dns_resolver->initializeStats(stats, fmt::format("cluster.{}.dns.", cluster.name()));
   }
 
   switch (cluster.type()) {
   case envoy::api::v2::Cluster::STATIC:
-    new_cluster.reset(
-        new StaticClusterImpl(cluster, runtime, stats, ssl_context_manager, cm, added_via_api));
+    new_cluster.reset(new StaticClusterImpl(cluster, runtime, stats, ssl_context_manager, cm,
+                                            added_via_api, info));
     break;
   case envoy::api::v2::Cluster::STRICT_DNS:
     new_cluster.reset(new StrictDnsClusterImpl(cluster, runtime, stats, ssl_context_manager,
-                                               selected_dns_resolver, cm, dispatcher,
-                                               added_via_api));
+                                               selected_dns_resolver, cm, dispatcher, added_via_api,
+                                               info));
     break;
   case envoy::api::v2::Cluster::LOGICAL_DNS:
     new_cluster.reset(new LogicalDnsCluster(cluster, runtime, stats, ssl_context_manager,
                                             selected_dns_resolver, tls, cm, dispatcher,
-                                            added_via_api));
+                                            added_via_api, info));
     break;
   case envoy::api::v2::Cluster::ORIGINAL_DST:
     if (cluster.lb_policy() != envoy::api::v2::Cluster::ORIGINAL_DST_LB) {
@@ -220,7 +341,7 @@ ClusterSharedPtr ClusterImplBase::create(const envoy::api::v2::Cluster& cluster,
           "cluster: cluster type 'original_dst' may not be used with lb_subset_config"));
     }
     new_cluster.reset(new OriginalDstCluster(cluster, runtime, stats, ssl_context_manager, cm,
-                                             dispatcher, added_via_api));
+                                             dispatcher, added_via_api, info));
     break;
   case envoy::api::v2::Cluster::EDS:
     if (!cluster.has_eds_cluster_config()) {
@@ -229,7 +350,7 @@ ClusterSharedPtr ClusterImplBase::create(const envoy::api::v2::Cluster& cluster,
 
     // We map SDS to EDS, since EDS provides backwards compatibility with SDS.
     new_cluster.reset(new EdsClusterImpl(cluster, runtime, stats, ssl_context_manager, local_info,
-                                         cm, dispatcher, random, added_via_api));
+                                         cm, dispatcher, random, added_via_api, info));
     break;
   default:
     NOT_REACHED;
@@ -250,9 +371,13 @@ ClusterSharedPtr ClusterImplBase::create(const envoy::api::v2::Cluster& cluster,
 ClusterImplBase::ClusterImplBase(const envoy::api::v2::Cluster& cluster,
                                  const Network::Address::InstanceConstSharedPtr source_address,
                                  Runtime::Loader& runtime, Stats::Store& stats,
-                                 Ssl::ContextManager& ssl_context_manager, bool added_via_api)
-    : runtime_(runtime), info_(new ClusterInfoImpl(cluster, source_address, runtime, stats,
-                                                   ssl_context_manager, added_via_api)) {
+                                 Ssl::ContextManager& ssl_context_manager, bool added_via_api,
+                                 ClusterInfoConstSharedPtr info)
+    : runtime_(runtime),
+      info_(info != nullptr ? info
+                            : std::make_shared<ClusterInfoImpl>(cluster, source_address, runtime,
+                                                                stats, ssl_context_manager,
+                                                                added_via_api)) {
   // Create the default (empty) priority set before registering callbacks to
   // avoid getting an update the first time it is accessed.
   priority_set_.getOrCreateHostSet(0);
@@ -302,6 +427,15 @@ ClusterImplBase::createHealthyHostLists(const std::vector<std::vector<HostShared
   return healthy_list;
 }
 
+Http::Http1Settings ClusterInfoImpl::http1Settings() const {
+  Http::Http1Settings settings;
+  settings.chunk_coalesce_bytes_ =
+      runtime_.snapshot().getInteger("upstream.http1_chunk_coalesce_bytes", 0);
+  settings.chunk_coalesce_delay_ = std::chrono::milliseconds(
+      runtime_.snapshot().getInteger("upstream.http1_chunk_coalesce_delay_ms", 0));
+  return settings;
+}
+
 bool ClusterInfoImpl::maintenanceMode() const {
   return runtime_.snapshot().featureEnabled(maintenance_mode_runtime_key_, 0);
 }
@@ -405,11 +539,9 @@ void ClusterImplBase::reloadHealthyHosts() {
   }
 
   for (auto& host_set : prioritySet().hostSetsPerPriority()) {
-    HostVectorConstSharedPtr hosts_copy(new std::vector<HostSharedPtr>(host_set->hosts()));
-    HostListsConstSharedPtr hosts_per_locality_copy(
-        new std::vector<std::vector<HostSharedPtr>>(host_set->hostsPerLocality()));
-    host_set->updateHosts(hosts_copy, createHealthyHostList(host_set->hosts()),
-                          hosts_per_locality_copy,
+    // Only the healthy lists change, the host lists are shared as is.
+    host_set->updateHosts(host_set->hostsPtr(), createHealthyHostList(host_set->hosts()),
+                          host_set->hostsPerLocalityPtr(),
                           createHealthyHostLists(host_set->hostsPerLocality()), {}, {});
   }
 }
@@ -421,6 +553,8 @@ ClusterInfoImpl::ResourceManagers::ResourceManagers(const envoy::api::v2::Cluste
       load(config, runtime, cluster_name, envoy::api::v2::RoutingPriority::DEFAULT);
   managers_[enumToInt(ResourcePriority::High)] =
       load(config, runtime, cluster_name, envoy::api::v2::RoutingPriority::HIGH);
+  managers_[enumToInt(ResourcePriority::Default)]->shedFor(
+      *managers_[enumToInt(ResourcePriority::High)]);
 }
 
 ResourceManagerImplPtr
@@ -467,9 +601,9 @@ ClusterInfoImpl::ResourceManagers::load(const envoy::api::v2::Cluster& config,
 StaticClusterImpl::StaticClusterImpl(const envoy::api::v2::Cluster& cluster,
                                      Runtime::Loader& runtime, Stats::Store& stats,
                                      Ssl::ContextManager& ssl_context_manager, ClusterManager& cm,
-                                     bool added_via_api)
+                                     bool added_via_api, ClusterInfoConstSharedPtr info)
     : ClusterImplBase(cluster, cm.sourceAddress(), runtime, stats, ssl_context_manager,
-                      added_via_api),
+                      added_via_api, info),
       initial_hosts_(new std::vector<HostSharedPtr>()) {
 
   for (const auto& host : cluster.hosts()) {
@@ -587,9 +721,9 @@ StrictDnsClusterImpl::StrictDnsClusterImpl(const envoy::api::v2::Cluster& cluste
                                            Ssl::ContextManager& ssl_context_manager,
                                            Network::DnsResolverSharedPtr dns_resolver,
                                            ClusterManager& cm, Event::Dispatcher& dispatcher,
-                                           bool added_via_api)
+                                           bool added_via_api, ClusterInfoConstSharedPtr info)
     : BaseDynamicClusterImpl(cluster, cm.sourceAddress(), runtime, stats, ssl_context_manager,
-                             added_via_api),
+                             added_via_api, info),
       dns_resolver_(dns_resolver),
       dns_refresh_rate_ms_(
           std::chrono::milliseconds(PROTOBUF_GET_MS_OR_DEFAULT(cluster, dns_refresh_rate, 5000))) {
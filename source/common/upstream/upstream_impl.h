@@ -26,11 +26,15 @@
 #include "common/common/callback_impl.h"
 #include "common/common/enum_to_int.h"
 #include "common/common/logger.h"
+#include "common/common/utility.h"
 #include "common/config/metadata.h"
 #include "common/config/well_known_names.h"
+#include "common/http/codes.h"
+#include "common/singleton/const_singleton.h"
 #include "common/stats/stats_impl.h"
 #include "common/upstream/load_balancer_impl.h"
 #include "common/upstream/outlier_detection_impl.h"
+#include "common/upstream/peak_ewma.h"
 #include "common/upstream/resource_manager_impl.h"
 
 #include "api/base.pb.h"
@@ -65,6 +69,50 @@ public:
 /**
  * Implementation of Upstream::HostDescription.
  */
+/**
+ * The names of the per host stats, shared by all hosts.
+ */
+class HostStatNameValues {
+public:
+#define GENERATE_HOST_STAT_NAME(NAME) const std::string NAME##_{#NAME};
+  ALL_HOST_STATS(GENERATE_HOST_STAT_NAME, GENERATE_HOST_STAT_NAME)
+#undef GENERATE_HOST_STAT_NAME
+};
+
+typedef ConstSingleton<HostStatNameValues> HostStatNames;
+
+/**
+ * The per host stats. There can be hundreds of thousands of hosts, so rather than each host having
+ * a stats store, the values are kept in place and the lists of the metrics are only built when
+ * asked for.
+ */
+class HostMetrics {
+public:
+  HostMetrics();
+
+  const HostStats& stats() const { return stats_; }
+
+  /**
+   * @return the counters of the host. They do not own the counters, and must not outlive the
+   *         host.
+   */
+  std::list<Stats::CounterSharedPtr> counters() const;
+
+  /**
+   * @return the gauges of the host. They do not own the gauges, and must not outlive the host.
+   */
+  std::list<Stats::GaugeSharedPtr> gauges() const;
+
+private:
+#define GENERATE_HOST_COUNTER_MEMBER(NAME) mutable Stats::PrimitiveCounter NAME##_;
+#define GENERATE_HOST_GAUGE_MEMBER(NAME) mutable Stats::PrimitiveGauge NAME##_;
+  ALL_HOST_STATS(GENERATE_HOST_COUNTER_MEMBER, GENERATE_HOST_GAUGE_MEMBER)
+#undef GENERATE_HOST_COUNTER_MEMBER
+#undef GENERATE_HOST_GAUGE_MEMBER
+
+  HostStats stats_;
+};
+
 class HostDescriptionImpl : virtual public HostDescription {
 public:
   HostDescriptionImpl(ClusterInfoConstSharedPtr cluster, const std::string& hostname,
@@ -75,13 +123,14 @@ public:
         canary_(Config::Metadata::metadataValue(metadata, Config::MetadataFilters::get().ENVOY_LB,
                                                 Config::MetadataEnvoyLbKeys::get().CANARY)
                     .bool_value()),
-        metadata_(metadata), locality_(locality), stats_{ALL_HOST_STATS(POOL_COUNTER(stats_store_),
-                                                                        POOL_GAUGE(stats_store_))} {
-  }
+        metadata_(metadata.ByteSize() == 0 ? nullptr : new envoy::api::v2::Metadata(metadata)),
+        locality_(locality.ByteSize() == 0 ? nullptr : new envoy::api::v2::Locality(locality)) {}
 
   // Upstream::HostDescription
   bool canary() const override { return canary_; }
-  const envoy::api::v2::Metadata& metadata() const override { return metadata_; }
+  const envoy::api::v2::Metadata& metadata() const override {
+    return metadata_ ? *metadata_ : envoy::api::v2::Metadata::default_instance();
+  }
   const ClusterInfo& cluster() const override { return *cluster_; }
   HealthCheckHostMonitor& healthChecker() const override {
     if (health_checker_) {
@@ -101,22 +150,31 @@ public:
       return *null_outlier_detector;
     }
   }
-  const HostStats& stats() const override { return stats_; }
+  const HostStats& stats() const override { return metrics_.stats(); }
   const std::string& hostname() const override { return hostname_; }
   Network::Address::InstanceConstSharedPtr address() const override { return address_; }
-  const envoy::api::v2::Locality& locality() const override { return locality_; }
+  const envoy::api::v2::Locality& locality() const override {
+    return locality_ ? *locality_ : envoy::api::v2::Locality::default_instance();
+  }
+  void putResponseTime(std::chrono::milliseconds time) const override {
+    response_time_.observe(time, ProdMonotonicTimeSource::instance_.currentTime());
+  }
+  double responseTimeEstimate() const override {
+    return response_time_.value(ProdMonotonicTimeSource::instance_.currentTime());
+  }
 
 protected:
   ClusterInfoConstSharedPtr cluster_;
   const std::string hostname_;
   Network::Address::InstanceConstSharedPtr address_;
   const bool canary_;
-  const envoy::api::v2::Metadata metadata_;
-  const envoy::api::v2::Locality locality_;
-  Stats::IsolatedStoreImpl stats_store_;
-  HostStats stats_;
+  // The metadata and locality are only copied when they are set, as most hosts have none.
+  const std::unique_ptr<const envoy::api::v2::Metadata> metadata_;
+  const std::unique_ptr<const envoy::api::v2::Locality> locality_;
+  HostMetrics metrics_;
   Outlier::DetectorHostMonitorPtr outlier_detector_;
   HealthCheckHostMonitorPtr health_checker_;
+  mutable PeakEwma response_time_;
 };
 
 /**
@@ -135,9 +193,9 @@ public:
   }
 
   // Upstream::Host
-  std::list<Stats::CounterSharedPtr> counters() const override { return stats_store_.counters(); }
+  std::list<Stats::CounterSharedPtr> counters() const override { return metrics_.counters(); }
   CreateConnectionData createConnection(Event::Dispatcher& dispatcher) const override;
-  std::list<Stats::GaugeSharedPtr> gauges() const override { return stats_store_.gauges(); }
+  std::list<Stats::GaugeSharedPtr> gauges() const override { return metrics_.gauges(); }
   void healthFlagClear(HealthFlag flag) override { health_flags_ &= ~enumToInt(flag); }
   bool healthFlagGet(HealthFlag flag) const override { return health_flags_ & enumToInt(flag); }
   void healthFlagSet(HealthFlag flag) override { health_flags_ |= enumToInt(flag); }
@@ -213,6 +271,12 @@ public:
   const std::vector<std::vector<HostSharedPtr>>& healthyHostsPerLocality() const override {
     return *healthy_hosts_per_locality_;
   }
+  HostVectorConstSharedPtr hostsPtr() const override { return hosts_; }
+  HostVectorConstSharedPtr healthyHostsPtr() const override { return healthy_hosts_; }
+  HostListsConstSharedPtr hostsPerLocalityPtr() const override { return hosts_per_locality_; }
+  HostListsConstSharedPtr healthyHostsPerLocalityPtr() const override {
+    return healthy_hosts_per_locality_;
+  }
   uint32_t priority() const override { return priority_; }
 
 protected:
@@ -293,8 +357,10 @@ public:
   uint32_t perConnectionBufferLimitBytes() const override {
     return per_connection_buffer_limit_bytes_;
   }
+  bool tcpFastOpen() const override { return tcp_fast_open_; }
   uint64_t features() const override { return features_; }
   const Http::Http2Settings& http2Settings() const override { return http2_settings_; }
+  Http::Http1Settings http1Settings() const override;
   LoadBalancerType lbType() const override { return lb_type_; }
   envoy::api::v2::Cluster::DiscoveryType type() const override { return type_; }
   const Optional<envoy::api::v2::Cluster::RingHashLbConfig>& lbRingHashConfig() const override {
@@ -302,6 +368,18 @@ public:
   }
   bool maintenanceMode() const override;
   uint64_t maxRequestsPerConnection() const override { return max_requests_per_connection_; }
+  const Optional<std::chrono::milliseconds>& idleTimeout() const override { return idle_timeout_; }
+  const Optional<std::chrono::milliseconds>& updateMergeWindow() const override {
+    return update_merge_window_;
+  }
+  double prefetchRatio() const override { return prefetch_ratio_; }
+  uint32_t http2ConnectionsPerHost() const override { return http2_connections_per_host_; }
+  uint32_t workerSubsets() const override { return worker_subsets_; }
+  uint32_t healthCheckPartitions() const override { return health_check_partitions_; }
+  uint32_t tcpPreconnectPerHost() const override { return tcp_preconnect_per_host_; }
+  std::chrono::milliseconds tcpPreconnectMaxAge() const override {
+    return tcp_preconnect_max_age_;
+  }
   const std::string& name() const override { return name_; }
   ResourceManager& resourceManager(ResourcePriority priority) const override;
   Network::TransportSocketFactory& transportSocketFactory() const override {
@@ -309,6 +387,7 @@ public:
   }
   ClusterStats& stats() const override { return stats_; }
   Stats::Scope& statsScope() const override { return *stats_scope_; }
+  Http::CodeStats& codeStats() const override { return code_stats_; }
   ClusterLoadReportStats& loadReportStats() const override { return load_report_stats_; }
   const Network::Address::InstanceConstSharedPtr& sourceAddress() const override {
     return source_address_;
@@ -338,10 +417,20 @@ private:
   const std::string name_;
   const envoy::api::v2::Cluster::DiscoveryType type_;
   const uint64_t max_requests_per_connection_;
+  Optional<std::chrono::milliseconds> idle_timeout_;
+  Optional<std::chrono::milliseconds> update_merge_window_;
+  const double prefetch_ratio_;
+  const uint32_t http2_connections_per_host_;
+  const uint32_t worker_subsets_;
+  const uint32_t health_check_partitions_;
   const std::chrono::milliseconds connect_timeout_;
   const uint32_t per_connection_buffer_limit_bytes_;
+  const bool tcp_fast_open_;
+  uint32_t tcp_preconnect_per_host_{};
+  std::chrono::milliseconds tcp_preconnect_max_age_{60000};
   Stats::ScopePtr stats_scope_;
   mutable ClusterStats stats_;
+  mutable Http::CodeStatsImpl code_stats_;
   Stats::IsolatedStoreImpl load_report_stats_store_;
   mutable ClusterLoadReportStats load_report_stats_;
   Network::TransportSocketFactoryPtr transport_socket_factory_;
@@ -371,7 +460,7 @@ public:
                                  Runtime::RandomGenerator& random, Event::Dispatcher& dispatcher,
                                  const LocalInfo::LocalInfo& local_info,
                                  Outlier::EventLoggerSharedPtr outlier_event_logger,
-                                 bool added_via_api);
+                                 bool added_via_api, ClusterInfoConstSharedPtr info = nullptr);
   // From Upstream::Cluster
   virtual PrioritySet& prioritySet() override { return priority_set_; }
   virtual const PrioritySet& prioritySet() const override { return priority_set_; }
@@ -397,10 +486,15 @@ public:
   void initialize(std::function<void()> callback) override;
 
 protected:
+  /**
+   * @param info supplies the info of the cluster if it was built ahead of the cluster, e.g. by
+   *        ProdClusterManagerFactory::prepareClusters(). If nullptr, it is built from cluster.
+   */
   ClusterImplBase(const envoy::api::v2::Cluster& cluster,
                   const Network::Address::InstanceConstSharedPtr source_address,
                   Runtime::Loader& runtime, Stats::Store& stats,
-                  Ssl::ContextManager& ssl_context_manager, bool added_via_api);
+                  Ssl::ContextManager& ssl_context_manager, bool added_via_api,
+                  ClusterInfoConstSharedPtr info);
 
   static HostVectorConstSharedPtr createHealthyHostList(const std::vector<HostSharedPtr>& hosts);
   static HostListsConstSharedPtr
@@ -447,7 +541,8 @@ class StaticClusterImpl : public ClusterImplBase {
 public:
   StaticClusterImpl(const envoy::api::v2::Cluster& cluster, Runtime::Loader& runtime,
                     Stats::Store& stats, Ssl::ContextManager& ssl_context_manager,
-                    ClusterManager& cm, bool added_via_api);
+                    ClusterManager& cm, bool added_via_api,
+                    ClusterInfoConstSharedPtr info = nullptr);
 
   // Upstream::Cluster
   InitializePhase initializePhase() const override { return InitializePhase::Primary; }
@@ -481,7 +576,8 @@ public:
   StrictDnsClusterImpl(const envoy::api::v2::Cluster& cluster, Runtime::Loader& runtime,
                        Stats::Store& stats, Ssl::ContextManager& ssl_context_manager,
                        Network::DnsResolverSharedPtr dns_resolver, ClusterManager& cm,
-                       Event::Dispatcher& dispatcher, bool added_via_api);
+                       Event::Dispatcher& dispatcher, bool added_via_api,
+                       ClusterInfoConstSharedPtr info = nullptr);
 
   // Upstream::Cluster
   InitializePhase initializePhase() const override { return InitializePhase::Primary; }
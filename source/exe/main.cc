@@ -33,13 +33,13 @@ int main(int argc, char** argv) {
 #ifdef ENVOY_HOT_RESTART
   // Enabled by default, except on OS X. Control with "bazel --define=hot_restart=disabled"
   const Envoy::OptionsImpl::HotRestartVersionCb hot_restart_version_cb =
-      [](uint64_t max_num_stats, uint64_t max_stat_name_len) {
-        return Envoy::Server::SharedMemory::version(max_num_stats, max_stat_name_len);
+      [](uint64_t max_num_stats, uint64_t max_stat_name_len, uint64_t max_ssl_sessions) {
+        return Envoy::Server::SharedMemory::version(max_num_stats, max_stat_name_len,
+                                                    max_ssl_sessions);
       };
 #else
-  const Envoy::OptionsImpl::HotRestartVersionCb hot_restart_version_cb = [](uint64_t, uint64_t) {
-    return "disabled";
-  };
+  const Envoy::OptionsImpl::HotRestartVersionCb hot_restart_version_cb =
+      [](uint64_t, uint64_t, uint64_t) { return "disabled"; };
 #endif
 
   std::unique_ptr<Envoy::OptionsImpl> options;
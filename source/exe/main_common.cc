@@ -82,7 +82,8 @@ int main_common(OptionsImpl& options) {
   Logger::Registry::initialize(options.logLevel(), log_lock);
   DefaultTestHooks default_test_hooks;
   ThreadLocal::InstanceImpl tls;
-  Stats::ThreadLocalStoreImpl stats_store(stats_allocator);
+  Stats::ThreadLocalStoreImpl stats_store(
+      stats_allocator, Stats::ThreadLocalStoreImpl::DEFAULT_DELETED_SCOPE_FLUSHES);
   try {
     Server::InstanceImpl server(options, local_address, default_test_hooks, *restarter, stats_store,
                                 access_log_lock, component_factory, tls);
@@ -1,9 +1,13 @@
 #pragma once
 
+#include <string>
+
 #include <backward.hpp>
 
 #include "common/common/logger.h"
 
+#include "fmt/format.h"
+
 namespace Envoy {
 #define BACKTRACE_LOG()                                                                            \
   do {                                                                                             \
@@ -67,22 +71,42 @@ public:
    * Log the stack trace.
    */
   void logTrace() {
+    if (!formatTrace([](const std::string& line) { ENVOY_LOG(critical, "{}", line); })) {
+      ENVOY_LOG(critical, "Back trace attempt failed");
+    }
+  }
+
+  /**
+   * @return std::string the stack trace in the format logTrace() logs it, one line per frame, or an
+   *         empty string if the capture failed.
+   */
+  std::string traceString() {
+    std::string trace;
+    formatTrace([&trace](const std::string& line) { trace += line + "\n"; });
+    return trace;
+  }
+
+  void logFault(const char* signame, const void* addr) {
+    ENVOY_LOG(critical, "Caught {}, suspect faulting address {}", signame, addr);
+  }
+
+private:
+  template <class LineCb> bool formatTrace(LineCb line_cb) {
     backward::TraceResolver resolver;
     resolver.load_stacktrace(stack_trace_);
     // If there's nothing in the captured trace we cannot do anything.
     // The size must be at least two for useful info - there is a sentinel frame
     // at the end that we ignore.
     if (stack_trace_.size() < 2) {
-      ENVOY_LOG(critical, "Back trace attempt failed");
-      return;
+      return false;
     }
 
     const auto thread_id = stack_trace_.thread_id();
     backward::ResolvedTrace first_frame_trace = resolver.resolve(stack_trace_[0]);
     auto obj_name = first_frame_trace.object_filename;
 
-    ENVOY_LOG(critical, "Backtrace obj<{}> thr<{}> (use tools/stack_decode.py):", obj_name,
-              thread_id);
+    line_cb(fmt::format("Backtrace obj<{}> thr<{}> (use tools/stack_decode.py):", obj_name,
+                        thread_id));
 
     // Backtrace gets tagged by ASAN when we try the object name resolution for the last
     // frame on stack, so skip the last one. It has no useful info anyway.
@@ -90,18 +114,14 @@ public:
       backward::ResolvedTrace trace = resolver.resolve(stack_trace_[i]);
       if (trace.object_filename != obj_name) {
         obj_name = trace.object_filename;
-        ENVOY_LOG(critical, "thr<{}> obj<{}>", thread_id, obj_name);
+        line_cb(fmt::format("thr<{}> obj<{}>", thread_id, obj_name));
       }
-      ENVOY_LOG(critical, "thr<{}> #{} {}", thread_id, stack_trace_[i].idx, stack_trace_[i].addr);
+      line_cb(fmt::format("thr<{}> #{} {}", thread_id, stack_trace_[i].idx, stack_trace_[i].addr));
     }
-    ENVOY_LOG(critical, "end backtrace thread {}", stack_trace_.thread_id());
+    line_cb(fmt::format("end backtrace thread {}", stack_trace_.thread_id()));
+    return true;
   }
 
-  void logFault(const char* signame, const void* addr) {
-    ENVOY_LOG(critical, "Caught {}, suspect faulting address {}", signame, addr);
-  }
-
-private:
   static const int MAX_STACK_DEPTH = 64;
   backward::StackTrace stack_trace_;
 };
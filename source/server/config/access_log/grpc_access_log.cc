@@ -1,6 +1,9 @@
 #include "server/config/access_log/grpc_access_log.h"
 
+#include <chrono>
+
 #include "envoy/registry/registry.h"
+#include "envoy/runtime/runtime.h"
 #include "envoy/server/filter_config.h"
 
 #include "common/access_log/grpc_access_log_impl.h"
@@ -44,12 +47,25 @@ AccessLog::InstanceSharedPtr HttpGrpcAccessLogFactory::createAccessLogInstance(
   std::shared_ptr<AccessLog::GrpcAccessLogStreamer> grpc_access_log_streamer =
       context.singletonManager().getTyped<AccessLog::GrpcAccessLogStreamer>(
           SINGLETON_MANAGER_REGISTERED_NAME(grpc_access_log_streamer), [&context, &proto_config] {
+            // The streamer is shared by all gRPC access logs, so its batching is configured
+            // process wide through runtime when it is created.
+            const Runtime::Snapshot& snapshot = context.runtime().snapshot();
+            AccessLog::GrpcAccessLogStreamerImpl::BatchConfig batch_config;
+            batch_config.max_batch_entries_ = snapshot.getInteger(
+                "access_log.grpc.max_batch_entries", batch_config.max_batch_entries_);
+            batch_config.max_batch_bytes_ = snapshot.getInteger("access_log.grpc.max_batch_bytes",
+                                                                batch_config.max_batch_bytes_);
+            batch_config.flush_interval_ = std::chrono::milliseconds(
+                snapshot.getInteger("access_log.grpc.flush_interval_ms",
+                                    batch_config.flush_interval_.count()));
+            batch_config.max_buffered_bytes_ = snapshot.getInteger(
+                "access_log.grpc.max_buffered_bytes", batch_config.max_buffered_bytes_);
             return std::make_shared<AccessLog::GrpcAccessLogStreamerImpl>(
                 std::make_unique<GrpcAccessLogClientFactoryImpl>(
                     context.clusterManager(),
                     // TODO(htuch): Support Google gRPC client.
                     proto_config.common_config().grpc_service().envoy_grpc().cluster_name()),
-                context.threadLocal(), context.localInfo());
+                context.threadLocal(), context.localInfo(), context.scope(), batch_config);
           });
 
   return AccessLog::InstanceSharedPtr{
@@ -0,0 +1,64 @@
+#include "server/config/access_log/structured_file_access_log.h"
+
+#include <map>
+#include <string>
+
+#include "envoy/common/exception.h"
+#include "envoy/registry/registry.h"
+#include "envoy/server/filter_config.h"
+
+#include "common/access_log/access_log_impl.h"
+#include "common/access_log/structured_formatter.h"
+#include "common/protobuf/utility.h"
+
+#include "fmt/format.h"
+
+namespace Envoy {
+namespace Server {
+namespace Configuration {
+
+AccessLog::InstanceSharedPtr StructuredFileAccessLogFactory::createAccessLogInstance(
+    const Protobuf::Message& config, AccessLog::FilterPtr&& filter, FactoryContext& context) {
+  Json::ObjectSharedPtr json_config = MessageUtil::getJsonObjectFromMessage(config);
+  const std::string format = json_config->getString("format", "json");
+
+  AccessLog::FormatterPtr formatter;
+  if (format == "json") {
+    if (json_config->hasObject("fields")) {
+      Json::ObjectSharedPtr json_fields = json_config->getObject("fields");
+      std::map<std::string, std::string> fields;
+      json_fields->iterate([&fields](const std::string& key, const Json::Object&) -> bool {
+        fields[key];
+        return true;
+      });
+      for (auto& field : fields) {
+        field.second = json_fields->getString(field.first);
+      }
+      formatter.reset(new AccessLog::JsonFormatterImpl(fields));
+    } else {
+      formatter.reset(
+          new AccessLog::JsonFormatterImpl(AccessLog::JsonFormatterImpl::defaultFields()));
+    }
+  } else if (format == "binary") {
+    if (json_config->hasObject("fields")) {
+      throw EnvoyException("structured file access log: fields are only supported by json");
+    }
+    formatter.reset(new AccessLog::ProtobufFormatterImpl());
+  } else {
+    throw EnvoyException(fmt::format("structured file access log: unknown format '{}'", format));
+  }
+
+  return AccessLog::InstanceSharedPtr{
+      new AccessLog::FileAccessLog(json_config->getString("path"), std::move(filter),
+                                   std::move(formatter), context.accessLogManager())};
+}
+
+/**
+ * Static registration for the structured file access log. @see RegisterFactory.
+ */
+static Registry::RegisterFactory<StructuredFileAccessLogFactory, AccessLogInstanceFactory>
+    register_;
+
+} // namespace Configuration
+} // namespace Server
+} // namespace Envoy
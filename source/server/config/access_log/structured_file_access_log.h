@@ -0,0 +1,38 @@
+#pragma once
+
+#include <string>
+
+#include "envoy/server/access_log_config.h"
+
+#include "common/config/well_known_names.h"
+#include "common/protobuf/protobuf.h"
+
+namespace Envoy {
+namespace Server {
+namespace Configuration {
+
+/**
+ * Config registration for the structured file access log. @see AccessLogInstanceFactory. The
+ * config is a google.protobuf.Struct with these fields:
+ *   path: the path of the log file.
+ *   format: "json" for a JSON object per line, the default, or "binary" for length delimited
+ *     HTTPAccessLogEntry protobufs.
+ *   fields: for the json format, an object that maps each key to the format string of its value,
+ *     in the syntax of the text file access log. Defaults to the fields of the default format.
+ */
+class StructuredFileAccessLogFactory : public AccessLogInstanceFactory {
+public:
+  AccessLog::InstanceSharedPtr createAccessLogInstance(const Protobuf::Message& config,
+                                                       AccessLog::FilterPtr&& filter,
+                                                       FactoryContext& context) override;
+
+  ProtobufTypes::MessagePtr createEmptyConfigProto() override {
+    return ProtobufTypes::MessagePtr{new Envoy::ProtobufWkt::Struct()};
+  }
+
+  std::string name() const override { return Config::AccessLogNames::get().STRUCTURED_FILE; }
+};
+
+} // namespace Configuration
+} // namespace Server
+} // namespace Envoy
@@ -0,0 +1,43 @@
+#include "server/config/http/adaptive_concurrency.h"
+
+#include <string>
+
+#include "envoy/registry/registry.h"
+
+#include "common/common/utility.h"
+#include "common/http/filter/adaptive_concurrency_filter.h"
+#include "common/protobuf/utility.h"
+
+namespace Envoy {
+namespace Server {
+namespace Configuration {
+
+HttpFilterFactoryCb
+AdaptiveConcurrencyFilterConfig::createFilterFactory(const Json::Object& json_config,
+                                                     const std::string& stats_prefix,
+                                                     FactoryContext& context) {
+  Http::AdaptiveConcurrencyFilterConfigSharedPtr config =
+      std::make_shared<Http::AdaptiveConcurrencyFilterConfig>(
+          json_config, stats_prefix, context.scope(), context.runtime(), context.threadLocal(),
+          ProdMonotonicTimeSource::instance_);
+  return [config](Http::FilterChainFactoryCallbacks& callbacks) -> void {
+    callbacks.addStreamFilter(std::make_shared<Http::AdaptiveConcurrencyFilter>(config));
+  };
+}
+
+HttpFilterFactoryCb AdaptiveConcurrencyFilterConfig::createFilterFactoryFromProto(
+    const Protobuf::Message& proto_config, const std::string& stats_prefix,
+    FactoryContext& context) {
+  return createFilterFactory(*MessageUtil::getJsonObjectFromMessage(proto_config), stats_prefix,
+                             context);
+}
+
+/**
+ * Static registration for the adaptive concurrency filter. @see RegisterFactory.
+ */
+static Registry::RegisterFactory<AdaptiveConcurrencyFilterConfig, NamedHttpFilterConfigFactory>
+    register_;
+
+} // namespace Configuration
+} // namespace Server
+} // namespace Envoy
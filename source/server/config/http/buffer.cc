@@ -2,9 +2,11 @@
 
 #include <chrono>
 #include <cstdint>
+#include <cstdlib>
 #include <string>
 
 #include "envoy/registry/registry.h"
+#include "envoy/runtime/runtime.h"
 
 #include "common/config/filter_json.h"
 #include "common/http/filter/buffer_filter.h"
@@ -22,13 +24,18 @@ BufferFilterConfig::createFilter(const envoy::api::v2::filter::http::Buffer& pro
   ASSERT(proto_config.has_max_request_bytes());
   ASSERT(proto_config.has_max_request_time());
 
+  // The buffer proto has no spilling fields, so spilling is enabled through runtime. Temporary
+  // files go where other programs would put them.
+  const char* tmpdir = ::getenv("TMPDIR");
   Http::BufferFilterConfigConstSharedPtr filter_config(new Http::BufferFilterConfig{
       Http::BufferFilter::generateStats(stats_prefix, context.scope()),
       static_cast<uint64_t>(proto_config.max_request_bytes().value()),
-      std::chrono::seconds(PROTOBUF_GET_SECONDS_REQUIRED(proto_config, max_request_time))});
+      std::chrono::seconds(PROTOBUF_GET_SECONDS_REQUIRED(proto_config, max_request_time)),
+      context.runtime().snapshot().getInteger("buffer.spill_threshold_bytes", 0),
+      tmpdir != nullptr ? tmpdir : "/tmp"});
   return [filter_config](Http::FilterChainFactoryCallbacks& callbacks) -> void {
     callbacks.addStreamDecoderFilter(
-        Http::StreamDecoderFilterSharedPtr{new Http::BufferFilter(filter_config)});
+        callbacks.arena().makeShared<Http::BufferFilter>(filter_config));
   };
 }
 
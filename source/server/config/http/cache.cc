@@ -0,0 +1,41 @@
+#include "server/config/http/cache.h"
+
+#include <string>
+
+#include "envoy/registry/registry.h"
+
+#include "common/common/utility.h"
+#include "common/http/filter/cache_filter.h"
+#include "common/protobuf/utility.h"
+
+namespace Envoy {
+namespace Server {
+namespace Configuration {
+
+HttpFilterFactoryCb CacheFilterConfig::createFilterFactory(const Json::Object& json_config,
+                                                           const std::string& stats_prefix,
+                                                           FactoryContext& context) {
+  Http::CacheFilterConfigSharedPtr config = std::make_shared<Http::CacheFilterConfig>(
+      json_config, stats_prefix, context.scope(), context.runtime(), context.threadLocal(),
+      ProdMonotonicTimeSource::instance_);
+  return [config](Http::FilterChainFactoryCallbacks& callbacks) -> void {
+    callbacks.addStreamFilter(std::make_shared<Http::CacheFilter>(config));
+  };
+}
+
+HttpFilterFactoryCb
+CacheFilterConfig::createFilterFactoryFromProto(const Protobuf::Message& proto_config,
+                                                const std::string& stats_prefix,
+                                                FactoryContext& context) {
+  return createFilterFactory(*MessageUtil::getJsonObjectFromMessage(proto_config), stats_prefix,
+                             context);
+}
+
+/**
+ * Static registration for the cache filter. @see RegisterFactory.
+ */
+static Registry::RegisterFactory<CacheFilterConfig, NamedHttpFilterConfigFactory> register_;
+
+} // namespace Configuration
+} // namespace Server
+} // namespace Envoy
@@ -11,7 +11,7 @@ namespace Configuration {
 HttpFilterFactoryCb CorsFilterConfig::createFilter(const std::string&, FactoryContext&) {
 
   return [](Http::FilterChainFactoryCallbacks& callbacks) -> void {
-    callbacks.addStreamFilter(Http::StreamFilterSharedPtr{new Http::CorsFilter()});
+    callbacks.addStreamFilter(callbacks.arena().makeShared<Http::CorsFilter>());
   };
 }
 
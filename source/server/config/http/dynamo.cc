@@ -13,8 +13,8 @@ namespace Configuration {
 HttpFilterFactoryCb DynamoFilterConfig::createFilter(const std::string& stat_prefix,
                                                      FactoryContext& context) {
   return [&context, stat_prefix](Http::FilterChainFactoryCallbacks& callbacks) -> void {
-    callbacks.addStreamFilter(Http::StreamFilterSharedPtr{
-        new Dynamo::DynamoFilter(context.runtime(), stat_prefix, context.scope())});
+    callbacks.addStreamFilter(callbacks.arena().makeShared<Dynamo::DynamoFilter>(
+        context.runtime(), stat_prefix, context.scope()));
   };
 }
 
@@ -18,7 +18,7 @@ FaultFilterConfig::createFilter(const envoy::api::v2::filter::http::HTTPFault& c
       new Http::FaultFilterConfig(config, context.runtime(), stats_prefix, context.scope()));
   return [filter_config](Http::FilterChainFactoryCallbacks& callbacks) -> void {
     callbacks.addStreamDecoderFilter(
-        Http::StreamDecoderFilterSharedPtr{new Http::FaultFilter(filter_config)});
+        callbacks.arena().makeShared<Http::FaultFilter>(filter_config));
   };
 }
 
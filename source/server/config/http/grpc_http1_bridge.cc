@@ -14,7 +14,7 @@ HttpFilterFactoryCb GrpcHttp1BridgeFilterConfig::createFilter(const std::string&
                                                               FactoryContext& context) {
   return [&context](Http::FilterChainFactoryCallbacks& callbacks) -> void {
     callbacks.addStreamFilter(
-        Http::StreamFilterSharedPtr{new Grpc::Http1BridgeFilter(context.clusterManager())});
+        callbacks.arena().makeShared<Grpc::Http1BridgeFilter>(context.clusterManager()));
   };
 }
 
@@ -11,7 +11,7 @@ namespace Configuration {
 HttpFilterFactoryCb GrpcWebFilterConfig::createFilter(const std::string&, FactoryContext& context) {
   return [&context](Http::FilterChainFactoryCallbacks& callbacks) -> void {
     callbacks.addStreamFilter(
-        Http::StreamFilterSharedPtr{new Grpc::GrpcWebFilter(context.clusterManager())});
+        callbacks.arena().makeShared<Grpc::GrpcWebFilter>(context.clusterManager()));
   };
 }
 
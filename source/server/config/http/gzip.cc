@@ -0,0 +1,39 @@
+#include "server/config/http/gzip.h"
+
+#include <string>
+
+#include "envoy/registry/registry.h"
+
+#include "common/http/filter/gzip_filter.h"
+#include "common/protobuf/utility.h"
+
+namespace Envoy {
+namespace Server {
+namespace Configuration {
+
+HttpFilterFactoryCb GzipFilterConfig::createFilterFactory(const Json::Object& json_config,
+                                                          const std::string& stats_prefix,
+                                                          FactoryContext& context) {
+  Http::GzipFilterConfigSharedPtr config = std::make_shared<Http::GzipFilterConfig>(
+      json_config, stats_prefix, context.scope(), context.runtime(), context.threadLocal());
+  return [config](Http::FilterChainFactoryCallbacks& callbacks) -> void {
+    callbacks.addStreamFilter(callbacks.arena().makeShared<Http::GzipFilter>(config));
+  };
+}
+
+HttpFilterFactoryCb
+GzipFilterConfig::createFilterFactoryFromProto(const Protobuf::Message& proto_config,
+                                               const std::string& stats_prefix,
+                                               FactoryContext& context) {
+  return createFilterFactory(*MessageUtil::getJsonObjectFromMessage(proto_config), stats_prefix,
+                             context);
+}
+
+/**
+ * Static registration for the gzip filter. @see RegisterFactory.
+ */
+static Registry::RegisterFactory<GzipFilterConfig, NamedHttpFilterConfigFactory> register_;
+
+} // namespace Configuration
+} // namespace Server
+} // namespace Envoy
@@ -24,7 +24,8 @@ RouterFilterConfig::createFilter(const envoy::api::v2::filter::http::Router& pro
       proto_config));
 
   return [filter_config](Http::FilterChainFactoryCallbacks& callbacks) -> void {
-    callbacks.addStreamDecoderFilter(std::make_shared<Router::ProdFilter>(*filter_config));
+    callbacks.addStreamDecoderFilter(
+        callbacks.arena().makeShared<Router::ProdFilter>(*filter_config));
   };
 }
 
@@ -64,7 +64,8 @@ NetworkFilterFactoryCb HttpConnectionManagerFilterConfigFactory::createFilter(
           date_provider](Network::FilterManager& filter_manager) -> void {
     filter_manager.addReadFilter(Network::ReadFilterSharedPtr{new Http::ConnectionManagerImpl(
         *filter_config, context.drainDecision(), context.random(), context.httpTracer(),
-        context.runtime(), context.localInfo(), context.clusterManager())});
+        context.runtime(), context.localInfo(), context.clusterManager(),
+        &context.overloadManager())});
   };
 }
 
@@ -232,16 +233,31 @@ HttpConnectionManagerConfig::HttpConnectionManagerConfig(
 
     // Now see if there is a factory that will accept the config.
     auto& factory = Config::Utility::getAndCheckFactory<NamedHttpFilterConfigFactory>(string_name);
+    // Only the first filter sees every request, so only it may answer requests early.
     HttpFilterFactoryCb callback;
     if (filter_config->getBoolean("deprecated_v1", false)) {
-      callback = factory.createFilterFactory(*filter_config->getObject("value", true),
-                                             stats_prefix_, context);
+      if (i == 0) {
+        callback = factory.createFilterFactoryWithResponder(
+            *filter_config->getObject("value", true), stats_prefix_, context,
+            header_only_responder_);
+      } else {
+        callback = factory.createFilterFactory(*filter_config->getObject("value", true),
+                                               stats_prefix_, context);
+      }
     } else {
       ProtobufTypes::MessagePtr message =
           Config::Utility::translateToFactoryConfig(proto_config, factory);
-      callback = factory.createFilterFactoryFromProto(*message, stats_prefix_, context);
+      if (i == 0) {
+        callback = factory.createFilterFactoryFromProtoWithResponder(
+            *message, stats_prefix_, context, header_only_responder_);
+      } else {
+        callback = factory.createFilterFactoryFromProto(*message, stats_prefix_, context);
+      }
     }
     filter_factories_.push_back(callback);
+    const std::string latency_prefix = stats_prefix_ + "filter." + string_name + ".";
+    filter_latency_stats_.push_back(
+        {ALL_FILTER_LATENCY_STATS(POOL_HISTOGRAM_PREFIX(context_.scope(), latency_prefix))});
   }
 }
 
@@ -252,7 +268,7 @@ HttpConnectionManagerConfig::createCodec(Network::Connection& connection,
   switch (codec_type_) {
   case CodecType::HTTP1:
     return Http::ServerConnectionPtr{
-        new Http::Http1::ServerConnectionImpl(connection, callbacks, http1_settings_)};
+        new Http::Http1::ServerConnectionImpl(connection, callbacks, http1Settings())};
   case CodecType::HTTP2:
     return Http::ServerConnectionPtr{new Http::Http2::ServerConnectionImpl(
         connection, callbacks, context_.scope(), http2_settings_)};
@@ -263,17 +279,46 @@ HttpConnectionManagerConfig::createCodec(Network::Connection& connection,
           connection, callbacks, context_.scope(), http2_settings_)};
     } else {
       return Http::ServerConnectionPtr{
-          new Http::Http1::ServerConnectionImpl(connection, callbacks, http1_settings_)};
+          new Http::Http1::ServerConnectionImpl(connection, callbacks, http1Settings())};
     }
   }
 
   NOT_REACHED;
 }
 
+Http::Http1Settings HttpConnectionManagerConfig::http1Settings() {
+  Http::Http1Settings settings = http1_settings_;
+  Runtime::Snapshot& snapshot = context_.runtime().snapshot();
+  settings.fast_request_parser_ =
+      snapshot.featureEnabled("http_connection_manager.http1_fast_request_parser", 0);
+  settings.chunk_coalesce_bytes_ =
+      snapshot.getInteger("http_connection_manager.http1_chunk_coalesce_bytes", 0);
+  settings.chunk_coalesce_delay_ = std::chrono::milliseconds(
+      snapshot.getInteger("http_connection_manager.http1_chunk_coalesce_delay_ms", 0));
+  return settings;
+}
+
+uint32_t HttpConnectionManagerConfig::maxPipelinedRequests() {
+  return context_.runtime().snapshot().getInteger(
+      "http_connection_manager.http1_max_pipelined_requests", 0);
+}
+
 void HttpConnectionManagerConfig::createFilterChain(Http::FilterChainFactoryCallbacks& callbacks) {
+  // Timing is sampled per stream, since it reads the clock around every filter callback.
+  if (!context_.runtime().snapshot().featureEnabled(
+          "http_connection_manager.filter_latency_stats", 0)) {
+    for (const HttpFilterFactoryCb& factory : filter_factories_) {
+      factory(callbacks);
+    }
+    return;
+  }
+
+  auto latency_stats = filter_latency_stats_.begin();
   for (const HttpFilterFactoryCb& factory : filter_factories_) {
+    callbacks.setFilterLatencyStats(&*latency_stats++);
     factory(callbacks);
   }
+  callbacks.setFilterLatencyStats(nullptr);
 }
 
 const Network::Address::Instance& HttpConnectionManagerConfig::localAddress() {
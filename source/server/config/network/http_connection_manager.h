@@ -81,6 +81,7 @@ public:
   FilterChainFactory& filterFactory() override { return *this; }
   bool generateRequestId() override { return generate_request_id_; }
   const Optional<std::chrono::milliseconds>& idleTimeout() override { return idle_timeout_; }
+  uint32_t maxPipelinedRequests() override;
   Router::RouteConfigProvider& routeConfigProvider() override { return *route_config_provider_; }
   const std::string& serverName() override { return server_name_; }
   Http::ConnectionManagerStats& stats() override { return stats_; }
@@ -96,14 +97,23 @@ public:
   const Network::Address::Instance& localAddress() override;
   const Optional<std::string>& userAgent() override { return user_agent_; }
   Http::ConnectionManagerListenerStats& listenerStats() override { return listener_stats_; }
+  Http::HeaderOnlyResponder* headerOnlyResponder() override {
+    return header_only_responder_.get();
+  }
 
   static const std::string DEFAULT_SERVER_STRING;
 
 private:
   enum class CodecType { HTTP1, HTTP2, AUTO };
 
+  // @return the HTTP/1 settings for a new connection, with the runtime controlled ones applied.
+  Http::Http1Settings http1Settings();
+
   FactoryContext& context_;
   std::list<HttpFilterFactoryCb> filter_factories_;
+  // The latency stats of the filters, in the order of filter_factories_.
+  std::list<Http::FilterLatencyStats> filter_latency_stats_;
+  Http::HeaderOnlyResponderSharedPtr header_only_responder_;
   std::list<AccessLog::InstanceSharedPtr> access_logs_;
   const std::string stats_prefix_;
   Http::ConnectionManagerStats stats_;
@@ -0,0 +1,55 @@
+#include "server/config/stats/metrics_service.h"
+
+#include <string>
+
+#include "envoy/common/exception.h"
+#include "envoy/registry/registry.h"
+
+#include "common/common/utility.h"
+#include "common/config/well_known_names.h"
+#include "common/grpc/async_client_impl.h"
+#include "common/stats/grpc_metrics_service_impl.h"
+
+#include "source/common/stats/metrics_service.pb.h"
+
+namespace Envoy {
+namespace Server {
+namespace Configuration {
+
+Stats::SinkPtr MetricsServiceSinkFactory::createStatsSink(const Protobuf::Message& config,
+                                                          Server::Instance& server) {
+  const auto& sink_config = dynamic_cast<const envoy::metrics::MetricsServiceSinkConfig&>(config);
+  const std::string& cluster_name = sink_config.grpc_cluster_name();
+  if (!server.clusterManager().get(cluster_name)) {
+    throw EnvoyException(
+        fmt::format("unknown metrics service cluster '{}' for {} Stats::Sink config", cluster_name,
+                    name()));
+  }
+
+  ENVOY_LOG(debug, "metrics service cluster: {}", cluster_name);
+  return Stats::SinkPtr(new Stats::Metrics::MetricsServiceSink(
+      server.localInfo(),
+      Stats::Metrics::MetricsServiceClientPtr{
+          new Grpc::AsyncClientImpl<envoy::metrics::StreamMetricsMessage,
+                                    envoy::metrics::StreamMetricsResponse>(server.clusterManager(),
+                                                                           cluster_name)},
+      ProdSystemTimeSource::instance_));
+}
+
+ProtobufTypes::MessagePtr MetricsServiceSinkFactory::createEmptyConfigProto() {
+  return std::unique_ptr<envoy::metrics::MetricsServiceSinkConfig>(
+      new envoy::metrics::MetricsServiceSinkConfig());
+}
+
+std::string MetricsServiceSinkFactory::name() {
+  return Config::StatsSinkNames::get().METRICS_SERVICE;
+}
+
+/**
+ * Static registration for the metrics service sink factory. @see RegisterFactory.
+ */
+static Registry::RegisterFactory<MetricsServiceSinkFactory, StatsSinkFactory> register_;
+
+} // namespace Configuration
+} // namespace Server
+} // namespace Envoy
@@ -17,6 +17,7 @@ public:
   // Network::DnsResolver
   ActiveDnsQuery* resolve(const std::string& dns_name, DnsLookupFamily dns_lookup_family,
                           ResolveCb callback) override;
+  void initializeStats(Stats::Scope&, const std::string&) override {}
 };
 
 } // namespace Network
@@ -23,6 +23,10 @@ bool validateConfig(Options& options, Network::Address::InstanceConstSharedPtr l
   try {
     ValidationInstance server(options, local_address, stats_store, access_log_lock,
                               component_factory);
+    if (!options.validatedConfigCachePath().empty()) {
+      InstanceUtil::recordValidatedConfig(options.validatedConfigCachePath(),
+                                          options.configPath());
+    }
     std::cout << "configuration '" << options.configPath() << "' OK" << std::endl;
     server.shutdown();
     return true;
@@ -15,7 +15,11 @@
 #include "common/common/utility.h"
 #include "common/config/lds_json.h"
 #include "common/config/utility.h"
+#include "common/json/config_schemas.h"
+#include "common/json/json_loader.h"
 #include "common/protobuf/utility.h"
+#include "common/ratelimit/batching_ratelimit_impl.h"
+#include "common/ratelimit/local_ratelimit_impl.h"
 #include "common/ratelimit/ratelimit_impl.h"
 #include "common/tracing/http_tracer_impl.h"
 
@@ -51,8 +55,9 @@ void MainImpl::initialize(const envoy::api::v2::Bootstrap& bootstrap, Instance&
 
   if (bootstrap.dynamic_resources().has_lds_config()) {
     lds_api_.reset(new LdsApi(bootstrap.dynamic_resources().lds_config(), *cluster_manager_,
-                              server.dispatcher(), server.random(), server.initManager(),
-                              server.localInfo(), server.stats(), server.listenerManager()));
+                              server.dispatcher(), server.threadLocal(), server.random(),
+                              server.initManager(), server.localInfo(), server.stats(),
+                              server.listenerManager()));
   }
 
   stats_flush_interval_ =
@@ -70,13 +75,46 @@ void MainImpl::initialize(const envoy::api::v2::Bootstrap& bootstrap, Instance&
 
   initializeTracers(bootstrap.tracing(), server);
 
-  if (bootstrap.has_rate_limit_service()) {
-    ratelimit_client_factory_.reset(
-        new RateLimit::GrpcFactoryImpl(bootstrap.rate_limit_service(), *cluster_manager_));
+  // The local rate limit config also holds the settings of the over limit cache and of batching.
+  const std::string& local_rate_limits_path = server.options().rateLimitLocalConfigPath();
+  Json::ObjectSharedPtr local_rate_limits;
+  RateLimit::OverLimitCacheSharedPtr over_limit_cache;
+  std::chrono::milliseconds batch_flush_interval(0);
+  if (!local_rate_limits_path.empty()) {
+    local_rate_limits = Json::Factory::loadFromFile(local_rate_limits_path);
+    local_rate_limits->validateSchema(Json::Schema::RATE_LIMIT_LOCAL_SCHEMA);
+    const std::chrono::milliseconds over_limit_cache_ttl(
+        local_rate_limits->getInteger("over_limit_cache_ms", 0));
+    if (over_limit_cache_ttl.count() > 0) {
+      over_limit_cache = std::make_shared<RateLimit::OverLimitCache>(
+          over_limit_cache_ttl, server.stats(), ProdMonotonicTimeSource::instance_);
+    }
+    batch_flush_interval =
+        std::chrono::milliseconds(local_rate_limits->getInteger("batch_flush_interval_ms", 0));
+    if (batch_flush_interval.count() > 0 && !over_limit_cache) {
+      throw EnvoyException("rate limit batching requires an over limit cache");
+    }
+  }
+
+  if (bootstrap.has_rate_limit_service() && batch_flush_interval.count() > 0) {
+    ratelimit_client_factory_.reset(new RateLimit::BatchingFactoryImpl(
+        RateLimit::GrpcFactoryImpl::asyncClientFactory(bootstrap.rate_limit_service(),
+                                                       *cluster_manager_),
+        over_limit_cache, batch_flush_interval, server.threadLocal(), server.stats()));
+  } else if (bootstrap.has_rate_limit_service()) {
+    ratelimit_client_factory_.reset(new RateLimit::GrpcFactoryImpl(
+        bootstrap.rate_limit_service(), *cluster_manager_, over_limit_cache));
   } else {
     ratelimit_client_factory_.reset(new RateLimit::NullFactoryImpl());
   }
 
+  if (local_rate_limits) {
+    RateLimit::LocalRateLimiterSharedPtr limiter = std::make_shared<RateLimit::LocalRateLimiter>(
+        *local_rate_limits, server.stats(), ProdMonotonicTimeSource::instance_);
+    ratelimit_client_factory_.reset(
+        new RateLimit::LocalFactoryImpl(limiter, std::move(ratelimit_client_factory_)));
+  }
+
   initializeStatsSinks(bootstrap, server);
 }
 
@@ -4,6 +4,7 @@
 #include <cstdint>
 #include <list>
 #include <memory>
+#include <string>
 
 #include "envoy/common/time.h"
 #include "envoy/event/deferred_deletable.h"
@@ -12,10 +13,12 @@
 #include "envoy/network/filter.h"
 #include "envoy/network/listen_socket.h"
 #include "envoy/network/listener.h"
+#include "envoy/stats/stats_macros.h"
 #include "envoy/stats/timespan.h"
 
 #include "common/common/linked_object.h"
 #include "common/common/non_copyable.h"
+#include "common/common/object_pool.h"
 
 #include "spdlog/spdlog.h"
 
@@ -37,13 +40,32 @@ struct ListenerStats {
   ALL_LISTENER_STATS(GENERATE_COUNTER_STRUCT, GENERATE_GAUGE_STRUCT, GENERATE_HISTOGRAM_STRUCT)
 };
 
+// clang-format off
+#define ALL_PER_HANDLER_LISTENER_STATS(COUNTER, GAUGE)                                             \
+  COUNTER(downstream_cx_total)                                                                     \
+  GAUGE  (downstream_cx_active)
+// clang-format on
+
+/**
+ * Wrapper struct for the listener stats of a single connection handler. @see stats_macros.h
+ */
+struct PerHandlerListenerStats {
+  ALL_PER_HANDLER_LISTENER_STATS(GENERATE_COUNTER_STRUCT, GENERATE_GAUGE_STRUCT)
+};
+
 /**
  * Server side connection handler. This is used both by workers as well as the
  * main thread for non-threaded listeners.
  */
 class ConnectionHandlerImpl : public Network::ConnectionHandler, NonCopyable {
 public:
-  ConnectionHandlerImpl(spdlog::logger& logger, Event::Dispatcher& dispatcher);
+  /**
+   * @param per_handler_stat_prefix supplies the prefix of the stats that the handler keeps of each
+   *        listener for itself, in the scope of the listener, or an empty string for none. Workers
+   *        use this to give the distribution of the connections across the workers.
+   */
+  ConnectionHandlerImpl(spdlog::logger& logger, Event::Dispatcher& dispatcher,
+                        const std::string& per_handler_stat_prefix = "");
 
   // Network::ConnectionHandler
   uint64_t numConnections() override { return num_connections_; }
@@ -92,6 +114,7 @@ private:
     Network::FilterChainFactory& factory_;
     Network::ListenerPtr listener_;
     ListenerStats stats_;
+    std::unique_ptr<PerHandlerListenerStats> per_handler_stats_;
     std::list<ActiveConnectionPtr> connections_;
     const uint64_t listener_tag_;
   };
@@ -106,11 +129,13 @@ private:
   typedef std::unique_ptr<ActiveListener> ActiveListenerPtr;
 
   /**
-   * Wrapper for an active connection owned by this handler.
+   * Wrapper for an active connection owned by this handler. Allocated from the ObjectPool like the
+   * connection it wraps.
    */
   struct ActiveConnection : LinkedObject<ActiveConnection>,
                             public Event::DeferredDeletable,
-                            public Network::ConnectionCallbacks {
+                            public Network::ConnectionCallbacks,
+                            public PooledObject {
     ActiveConnection(ActiveListener& listener, Network::ConnectionPtr&& new_connection);
     ~ActiveConnection();
 
@@ -131,9 +156,11 @@ private:
   };
 
   static ListenerStats generateStats(Stats::Scope& scope);
+  std::unique_ptr<PerHandlerListenerStats> generatePerHandlerStats(Stats::Scope& scope);
 
   spdlog::logger& logger_;
   Event::Dispatcher& dispatcher_;
+  const std::string per_handler_stat_prefix_;
   std::list<std::pair<Network::Address::InstanceConstSharedPtr, ActiveListenerPtr>> listeners_;
   std::atomic<uint64_t> num_connections_{};
 };
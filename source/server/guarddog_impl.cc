@@ -1,7 +1,14 @@
 #include "server/guarddog_impl.h"
 
+#include <signal.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include <atomic>
 #include <chrono>
+#include <cstring>
 #include <mutex>
+#include <thread>
 
 #include "common/common/assert.h"
 
@@ -9,9 +16,59 @@
 
 #include "fmt/format.h"
 
+#if defined(ENVOY_HANDLE_SIGNALS) && defined(__linux__)
+#define ENVOY_SAMPLE_STALLS
+#include "server/backtrace.h"
+#endif
+
 namespace Envoy {
 namespace Server {
 
+#ifdef ENVOY_SAMPLE_STALLS
+namespace {
+
+// Stalled threads are sampled with a signal that is ignored by default, so that a sample request
+// that arrives after the thread gave up waiting for it cannot terminate the process.
+const int STALL_SAMPLE_SIGNAL = SIGURG;
+const std::chrono::milliseconds STALL_SAMPLE_TIMEOUT(100);
+const size_t MAX_STALL_SAMPLES = 16;
+
+enum class SampleState { Idle, Requested, Capturing, Captured };
+
+// One thread is sampled at a time, by whichever guard dog holds the lock. The trace is captured
+// once when the handler is installed so that it keeps room for a full trace, and capturing again
+// in the signal handler does not allocate.
+std::mutex sample_lock;
+std::atomic<SampleState> sample_state{SampleState::Idle};
+BackwardsTrace* sample_trace;
+
+void onStallSampleSignal(int) {
+  SampleState expected = SampleState::Requested;
+  if (sample_state.compare_exchange_strong(expected, SampleState::Capturing)) {
+    sample_trace->capture();
+    sample_state.store(SampleState::Captured);
+  }
+}
+
+void installStallSampleHandler() {
+  static const bool installed = []() -> bool {
+    sample_trace = new BackwardsTrace();
+    sample_trace->capture();
+
+    struct sigaction action;
+    memset(&action, 0, sizeof(action));
+    action.sa_handler = onStallSampleSignal;
+    // Do not interrupt the system calls of the sampled thread.
+    action.sa_flags = SA_RESTART;
+    sigemptyset(&action.sa_mask);
+    return sigaction(STALL_SAMPLE_SIGNAL, &action, nullptr) == 0;
+  }();
+  UNREFERENCED_PARAMETER(installed);
+}
+
+} // namespace
+#endif
+
 GuardDogImpl::GuardDogImpl(Stats::Scope& stats_scope, const Server::Configuration::Main& config,
                            MonotonicTimeSource& tsource)
     : time_source_(tsource), miss_timeout_(config.wdMissTimeout()),
@@ -28,7 +85,11 @@ GuardDogImpl::GuardDogImpl(Stats::Scope& stats_scope, const Server::Configuratio
       }()),
       watchdog_miss_counter_(stats_scope.counter("server.watchdog_miss")),
       watchdog_megamiss_counter_(stats_scope.counter("server.watchdog_mega_miss")),
+      watchdog_loop_stall_histogram_(stats_scope.histogram("server.watchdog_loop_stall")),
       run_thread_(true) {
+#ifdef ENVOY_SAMPLE_STALLS
+  installStallSampleHandler();
+#endif
   start();
 }
 
@@ -51,6 +112,8 @@ void GuardDogImpl::threadRoutine() {
           watchdog_miss_counter_.inc();
           watched_dog.last_alert_time_.value(ltt);
           watched_dog.miss_alerted_ = true;
+          sampleStalledThread(watched_dog.dog_->threadId(),
+                              std::chrono::duration_cast<std::chrono::milliseconds>(delta));
         }
       }
       if (delta > megamiss_timeout_) {
@@ -78,6 +141,58 @@ void GuardDogImpl::threadRoutine() {
   } while (waitOrDetectStop());
 }
 
+void GuardDogImpl::sampleStalledThread(int32_t thread_id, std::chrono::milliseconds stalled_for) {
+#ifdef ENVOY_SAMPLE_STALLS
+  std::string trace;
+  {
+    std::lock_guard<std::mutex> guard(sample_lock);
+    sample_state.store(SampleState::Requested);
+    if (syscall(SYS_tgkill, getpid(), thread_id, STALL_SAMPLE_SIGNAL) != 0) {
+      sample_state.store(SampleState::Idle);
+      return;
+    }
+
+    // This waits on the steady clock rather than on time_source_, which does not advance in tests.
+    const auto deadline = std::chrono::steady_clock::now() + STALL_SAMPLE_TIMEOUT;
+    while (sample_state.load() != SampleState::Captured) {
+      if (std::chrono::steady_clock::now() > deadline) {
+        // Withdraw the request, unless the handler is already capturing and must be waited for.
+        SampleState expected = SampleState::Requested;
+        if (sample_state.compare_exchange_strong(expected, SampleState::Idle)) {
+          ENVOY_LOG(warn, "GuardDog: thread {} stalled for {}ms and could not be sampled",
+                    thread_id, stalled_for.count());
+          return;
+        }
+      }
+      std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    trace = sample_trace->traceString();
+    sample_state.store(SampleState::Idle);
+  }
+
+  const std::string sample =
+      fmt::format("thread {} stalled for {}ms:\n{}", thread_id, stalled_for.count(), trace);
+  ENVOY_LOG(warn, "GuardDog: {}", sample);
+  std::lock_guard<std::mutex> guard(stall_samples_lock_);
+  stall_samples_.push_front(sample);
+  if (stall_samples_.size() > MAX_STALL_SAMPLES) {
+    stall_samples_.pop_back();
+  }
+#else
+  UNREFERENCED_PARAMETER(thread_id);
+  UNREFERENCED_PARAMETER(stalled_for);
+#endif
+}
+
+std::string GuardDogImpl::stallSamples() {
+  std::lock_guard<std::mutex> guard(stall_samples_lock_);
+  std::string samples;
+  for (const std::string& sample : stall_samples_) {
+    samples += sample;
+  }
+  return samples;
+}
+
 WatchDogSharedPtr GuardDogImpl::createWatchDog(int32_t thread_id) {
   // Timer started by WatchDog will try to fire at 1/2 of the interval of the
   // minimum timeout specified. loop_interval_ is const so all shared state
@@ -85,7 +200,8 @@ WatchDogSharedPtr GuardDogImpl::createWatchDog(int32_t thread_id) {
   // state).
   auto wd_interval = loop_interval_ / 2;
   WatchDogSharedPtr new_watchdog =
-      std::make_shared<WatchDogImpl>(thread_id, time_source_, wd_interval);
+      std::make_shared<WatchDogImpl>(thread_id, time_source_, wd_interval,
+                                     watchdog_loop_stall_histogram_);
   WatchedDog watched_dog;
   watched_dog.dog_ = new_watchdog;
   {
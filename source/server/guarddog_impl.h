@@ -2,7 +2,9 @@
 
 #include <chrono>
 #include <condition_variable>
+#include <list>
 #include <mutex>
+#include <string>
 #include <vector>
 
 #include "envoy/common/optional.h"
@@ -25,9 +27,12 @@ namespace Server {
  * intervals. If it finds starved threads or suspected deadlocks it will take
  * the appropriate action depending on the config parameters described below.
  *
+ * When a thread first misses, its stack is sampled by signalling it, and the sample is logged and
+ * kept for stallSamples().
+ *
  * Thread lifetime is tied to GuardDog object lifetime (RAII style).
  */
-class GuardDogImpl : public GuardDog {
+class GuardDogImpl : public GuardDog, Logger::Loggable<Logger::Id::main> {
 public:
   /**
    * @param stats_scope Statistics scope to write watchdog_miss and
@@ -50,11 +55,17 @@ public:
     force_checked_event_.wait(exit_lock_);
   }
 
+  /**
+   * @return std::string the stack samples of the threads that most recently missed, newest first.
+   */
+  std::string stallSamples();
+
   // Server::GuardDog
   WatchDogSharedPtr createWatchDog(int32_t thread_id) override;
   void stopWatching(WatchDogSharedPtr wd) override;
 
 private:
+  void sampleStalledThread(int32_t thread_id, std::chrono::milliseconds stalled_for);
   void threadRoutine();
   /**
    * @return True if we should continue, false if signalled to stop.
@@ -82,6 +93,7 @@ private:
   const std::chrono::milliseconds loop_interval_;
   Stats::Counter& watchdog_miss_counter_;
   Stats::Counter& watchdog_megamiss_counter_;
+  Stats::Histogram& watchdog_loop_stall_histogram_;
   std::vector<WatchedDog> watched_dogs_;
   std::mutex wd_lock_;
   Thread::ThreadPtr thread_;
@@ -89,6 +101,8 @@ private:
   std::condition_variable_any exit_event_;
   bool run_thread_;
   std::condition_variable_any force_checked_event_;
+  std::list<std::string> stall_samples_;
+  std::mutex stall_samples_lock_;
 };
 
 } // namespace Server
@@ -5,6 +5,7 @@
 #include <sys/types.h>
 #include <sys/un.h>
 
+#include <algorithm>
 #include <cstdint>
 #include <string>
 
@@ -14,6 +15,7 @@
 #include "envoy/server/options.h"
 
 #include "common/api/os_sys_calls_impl.h"
+#include "common/common/hash.h"
 #include "common/common/utility.h"
 #include "common/network/utility.h"
 
@@ -24,13 +26,34 @@ namespace Server {
 
 // Increment this whenever there is a shared memory / RPC change that will prevent a hot restart
 // from working. Operations code can then cope with this and do a full restart.
-const uint64_t SharedMemory::VERSION = 9;
+const uint64_t SharedMemory::VERSION = 13;
+const uint32_t SharedMemory::NO_SLOT;
+
+uint64_t SharedMemory::totalSize(uint64_t max_num_stats, uint64_t entry_size,
+                                 uint64_t session_slots_per_shard) {
+  return sizeof(SharedMemory) + sessionsOffset(max_num_stats, entry_size) +
+         Ssl::SessionCacheImpl::slotSize() * session_slots_per_shard *
+             Ssl::SessionCacheImpl::NUM_SHARDS;
+}
+
+uint64_t SharedMemory::sessionsOffset(uint64_t max_num_stats, uint64_t entry_size) {
+  // The slots, then a bucket and a next slot per slot, rounded up to keep the sessions aligned.
+  const uint64_t size = entry_size * max_num_stats + 2 * sizeof(uint32_t) * max_num_stats;
+  return (size + alignof(uint64_t) - 1) / alignof(uint64_t) * alignof(uint64_t);
+}
+
+uint64_t SharedMemory::sessionSlotsPerShard(uint64_t max_ssl_sessions) {
+  return max_ssl_sessions == 0 ? 0 : Ssl::SessionCacheImpl::slotsPerShard(max_ssl_sessions);
+}
 
 SharedMemory& SharedMemory::initialize(Options& options) {
   Api::OsSysCalls& os_sys_calls = Api::OsSysCallsSingleton::get();
 
   const uint64_t entry_size = Stats::RawStatData::size();
-  const uint64_t total_size = sizeof(SharedMemory) + (entry_size * options.maxStats());
+  const uint64_t session_slots_per_shard = sessionSlotsPerShard(options.sslSessionCacheSize());
+  const uint64_t total_size = totalSize(options.maxStats(), entry_size, session_slots_per_shard);
+  // Slots are indexed with 32 bits, NO_SLOT excluded.
+  RELEASE_ASSERT(options.maxStats() < NO_SLOT);
 
   int flags = O_RDWR;
   const std::string shmem_name = fmt::format("/envoy_shared_memory_{}", options.baseId());
@@ -63,15 +86,21 @@ SharedMemory& SharedMemory::initialize(Options& options) {
     shmem->version_ = VERSION;
     shmem->num_stats_ = options.maxStats();
     shmem->entry_size_ = entry_size;
+    shmem->session_slots_per_shard_ = session_slots_per_shard;
     shmem->initializeMutex(shmem->log_lock_);
     shmem->initializeMutex(shmem->access_log_lock_);
     shmem->initializeMutex(shmem->stat_lock_);
     shmem->initializeMutex(shmem->init_lock_);
+    for (pthread_mutex_t& mutex : shmem->session_locks_) {
+      shmem->initializeMutex(mutex);
+    }
+    shmem->rebuildIndex();
   } else {
     RELEASE_ASSERT(shmem->size_ == total_size);
     RELEASE_ASSERT(shmem->version_ == VERSION);
     RELEASE_ASSERT(shmem->num_stats_ == options.maxStats());
     RELEASE_ASSERT(shmem->entry_size_ == entry_size);
+    RELEASE_ASSERT(shmem->session_slots_per_shard_ == session_slots_per_shard);
   }
 
   // Stats::RawStatData must be naturally aligned for atomics to work properly.
@@ -91,6 +120,26 @@ SharedMemory& SharedMemory::initialize(Options& options) {
   return *shmem;
 }
 
+void SharedMemory::rebuildIndex() {
+  uint32_t* next_slots = nextSlots();
+  std::fill(buckets(), buckets() + num_stats_, NO_SLOT);
+  free_slot_ = NO_SLOT;
+  // Going backwards keeps the free list in slot order.
+  for (uint32_t i = num_stats_; i-- > 0;) {
+    Stats::RawStatData& data = slot(i);
+    uint32_t& first_slot = data.initialized() ? bucket(data.name_) : free_slot_;
+    next_slots[i] = first_slot;
+    first_slot = i;
+  }
+}
+
+uint32_t& SharedMemory::bucket(absl::string_view name) {
+  // Stats whose names are truncated are matched on the truncated name, so that is what is hashed.
+  // The hash must be the same in every process sharing the memory, which xxHash is.
+  const uint64_t hash = HashUtil::xxHash64(name.substr(0, Stats::RawStatData::maxNameLength()));
+  return buckets()[hash % num_stats_];
+}
+
 void SharedMemory::initializeMutex(pthread_mutex_t& mutex) {
   pthread_mutexattr_t attribute;
   pthread_mutexattr_init(&attribute);
@@ -99,24 +148,32 @@ void SharedMemory::initializeMutex(pthread_mutex_t& mutex) {
   pthread_mutex_init(&mutex, &attribute);
 }
 
-std::string SharedMemory::version(size_t max_num_stats, size_t max_stat_name_len) {
-  return fmt::format("{}.{}.{}.{}", VERSION, sizeof(SharedMemory), max_num_stats,
-                     max_stat_name_len);
+std::string SharedMemory::version(uint64_t max_num_stats, uint64_t max_stat_name_len,
+                                  uint64_t max_ssl_sessions) {
+  return fmt::format("{}.{}.{}.{}.{}", VERSION, sizeof(SharedMemory), max_num_stats,
+                     max_stat_name_len, sessionSlotsPerShard(max_ssl_sessions));
 }
 
 std::string SharedMemory::version() {
-  return version(num_stats_, Stats::RawStatData::maxNameLength());
+  return fmt::format("{}.{}.{}.{}.{}", VERSION, sizeof(SharedMemory), num_stats_,
+                     Stats::RawStatData::maxNameLength(), session_slots_per_shard_);
 }
 
 HotRestartImpl::HotRestartImpl(Options& options)
     : options_(options), shmem_(SharedMemory::initialize(options)), log_lock_(shmem_.log_lock_),
       access_log_lock_(shmem_.access_log_lock_), stat_lock_(shmem_.stat_lock_),
       init_lock_(shmem_.init_lock_) {
+  for (pthread_mutex_t& mutex : shmem_.session_locks_) {
+    session_locks_.emplace_back(new ProcessSharedMutex(mutex));
+  }
   my_domain_socket_ = bindDomainSocket(options.restartEpoch());
   child_address_ = createDomainSocketAddress((options.restartEpoch() + 1));
   initDomainSocketAddress(&parent_address_);
   if (options.restartEpoch() != 0) {
     parent_address_ = createDomainSocketAddress((options.restartEpoch() + -1));
+
+    std::unique_lock<Thread::BasicLockable> lock(stat_lock_);
+    shmem_.rebuildIndex();
   }
 
   // If our parent ever goes away just terminate us so that we don't have to rely on ops/launching
@@ -128,25 +185,39 @@ HotRestartImpl::HotRestartImpl(Options& options)
 
 Stats::RawStatData* HotRestartImpl::alloc(const std::string& name) {
   // Try to find the existing slot in shared memory, otherwise allocate a new one.
-  Stats::RawStatData* unused = nullptr;
   std::unique_lock<Thread::BasicLockable> lock(stat_lock_);
-  for (uint64_t i = 0; i < shmem_.num_stats_; i++) {
-    const size_t offset = shmem_.entry_size_ * i;
-    Stats::RawStatData* data = reinterpret_cast<Stats::RawStatData*>(shmem_.stats_slots_ + offset);
-    if (!data->initialized()) {
-      unused = data;
-    } else if (data->matches(name)) {
-      data->ref_count_++;
-      return data;
+  if (shmem_.num_stats_ == 0) {
+    return nullptr;
+  }
+
+  uint32_t* next_slots = shmem_.nextSlots();
+  uint32_t& first_slot = shmem_.bucket(name);
+  for (uint32_t i = first_slot; i != SharedMemory::NO_SLOT; i = next_slots[i]) {
+    Stats::RawStatData& data = shmem_.slot(i);
+    if (data.matches(name)) {
+      data.ref_count_++;
+      return &data;
     }
   }
 
-  if (unused != nullptr) {
-    unused->initialize(name);
-    return unused;
+  if (shmem_.free_slot_ == SharedMemory::NO_SLOT) {
+    if (!stats_full_logged_) {
+      ENVOY_LOG(warn,
+                "all {} stats in shared memory are in use, new stats will not be kept across hot "
+                "restarts (see --max-stats)",
+                shmem_.num_stats_);
+      stats_full_logged_ = true;
+    }
+    return nullptr;
   }
 
-  return nullptr;
+  const uint32_t index = shmem_.free_slot_;
+  shmem_.free_slot_ = next_slots[index];
+  next_slots[index] = first_slot;
+  first_slot = index;
+  Stats::RawStatData& data = shmem_.slot(index);
+  data.initialize(name);
+  return &data;
 }
 
 void HotRestartImpl::free(Stats::RawStatData& data) {
@@ -157,6 +228,19 @@ void HotRestartImpl::free(Stats::RawStatData& data) {
     return;
   }
 
+  // Move the slot from its bucket to the free list.
+  const uint32_t index =
+      (reinterpret_cast<uint8_t*>(&data) - shmem_.stats_slots_) / shmem_.entry_size_;
+  uint32_t* next_slots = shmem_.nextSlots();
+  uint32_t* link = &shmem_.bucket(data.name_);
+  while (*link != index) {
+    ASSERT(*link != SharedMemory::NO_SLOT);
+    link = &next_slots[*link];
+  }
+  *link = next_slots[index];
+  next_slots[index] = shmem_.free_slot_;
+  shmem_.free_slot_ = index;
+
   memset(&data, 0, Stats::RawStatData::size());
 }
 
@@ -207,7 +291,8 @@ void HotRestartImpl::drainParentListeners() {
   shmem_.flags_ &= ~SharedMemory::Flags::INITIALIZING;
 }
 
-int HotRestartImpl::duplicateParentListenSocket(const std::string& address) {
+int HotRestartImpl::duplicateParentListenSocket(const std::string& address,
+                                                uint32_t worker_index) {
   if (options_.restartEpoch() == 0 || parent_terminated_) {
     return -1;
   }
@@ -215,6 +300,7 @@ int HotRestartImpl::duplicateParentListenSocket(const std::string& address) {
   RpcGetListenSocketRequest rpc;
   ASSERT(address.length() < sizeof(rpc.address_));
   StringUtil::strlcpy(rpc.address_, address.c_str(), sizeof(rpc.address_));
+  rpc.worker_index_ = worker_index;
   sendMessage(parent_address_, rpc);
   RpcGetListenSocketReply* reply =
       receiveTypedRpc<RpcGetListenSocketReply, RpcMessageType::GetListenSocketReply>();
@@ -349,7 +435,10 @@ void HotRestartImpl::onGetListenSocket(RpcGetListenSocketRequest& rpc) {
       Network::Utility::resolveUrl(std::string(rpc.address_));
   for (const auto& listener : server_->listenerManager().listeners()) {
     if (*listener.get().socket().localAddress() == *addr) {
-      reply.fd_ = listener.get().socket().fd();
+      Network::ListenSocket* socket = listener.get().workerSocket(rpc.worker_index_);
+      if (socket != nullptr) {
+        reply.fd_ = socket->fd();
+      }
       break;
     }
   }
@@ -386,6 +475,23 @@ void HotRestartImpl::onGetListenSocket(RpcGetListenSocketRequest& rpc) {
   }
 }
 
+void HotRestartImpl::onGetState(RpcGetStateRequest& rpc) {
+  const std::string name(rpc.name_);
+  if (rpc.offset_ == 0 || name != exported_state_name_) {
+    auto exporter = state_exporters_.find(name);
+    exported_state_name_ = name;
+    exported_state_ = exporter != state_exporters_.end() ? exporter->second() : "";
+  }
+
+  RpcGetStateReply reply;
+  const uint64_t offset = std::min<uint64_t>(rpc.offset_, exported_state_.size());
+  const uint64_t length = std::min<uint64_t>(exported_state_.size() - offset, sizeof(reply.data_));
+  memcpy(reply.data_, exported_state_.data() + offset, length);
+  reply.total_length_ = exported_state_.size();
+  reply.length_ = sizeof(reply) - sizeof(reply.data_) + length;
+  sendMessage(child_address_, reply);
+}
+
 void HotRestartImpl::onSocketEvent() {
   while (true) {
     RpcBase* base_message = receiveRpc(false);
@@ -419,6 +525,11 @@ void HotRestartImpl::onSocketEvent() {
       break;
     }
 
+    case RpcMessageType::GetStateRequest: {
+      onGetState(*reinterpret_cast<RpcGetStateRequest*>(base_message));
+      break;
+    }
+
     case RpcMessageType::DrainListenersRequest: {
       server_->drainListeners();
       break;
@@ -467,5 +578,43 @@ void HotRestartImpl::shutdown() { socket_event_.reset(); }
 
 std::string HotRestartImpl::version() { return shmem_.version(); }
 
+Ssl::SessionCacheMemory* HotRestartImpl::sessionCacheMemory() {
+  return shmem_.session_slots_per_shard_ > 0 ? this : nullptr;
+}
+
+void HotRestartImpl::addStateExporter(const std::string& name, StateExporter exporter) {
+  ASSERT(name.length() < sizeof(RpcGetStateRequest::name_));
+  state_exporters_[name] = exporter;
+}
+
+std::string HotRestartImpl::getParentState(const std::string& name) {
+  // See large comment in getParentStats() on why this operation is locked.
+  std::unique_lock<Thread::BasicLockable> lock(init_lock_);
+  if (options_.restartEpoch() == 0 || parent_terminated_) {
+    return "";
+  }
+
+  RpcGetStateRequest rpc;
+  ASSERT(name.length() < sizeof(rpc.name_));
+  StringUtil::strlcpy(rpc.name_, name.c_str(), sizeof(rpc.name_));
+  const uint64_t header_length = sizeof(RpcGetStateReply) - sizeof(RpcGetStateReply::data_);
+  std::string state;
+  uint64_t total_length;
+  do {
+    rpc.offset_ = state.size();
+    sendMessage(parent_address_, rpc);
+    RpcBase* base_message = receiveRpc(true);
+    RELEASE_ASSERT(base_message->type_ == RpcMessageType::GetStateReply);
+    RELEASE_ASSERT(base_message->length_ >= header_length);
+    RpcGetStateReply* reply = reinterpret_cast<RpcGetStateReply*>(base_message);
+    total_length = reply->total_length_;
+    // Every chunk but that of an empty section makes progress.
+    RELEASE_ASSERT(reply->length_ > header_length || total_length == 0);
+    state.append(reply->data_, reply->length_ - header_length);
+  } while (state.size() < total_length);
+
+  return state;
+}
+
 } // namespace Server
 } // namespace Envoy
@@ -6,25 +6,36 @@
 #include <array>
 #include <atomic>
 #include <cstdint>
+#include <memory>
 #include <string>
+#include <unordered_map>
+#include <vector>
 
 #include "envoy/server/hot_restart.h"
 #include "envoy/server/options.h"
 
 #include "common/common/assert.h"
+#include "common/ssl/session_cache_impl.h"
 #include "common/stats/stats_impl.h"
 
+#include "absl/strings/string_view.h"
+
 namespace Envoy {
 namespace Server {
 
 /**
  * Shared memory segment. This structure is laid directly into shared memory and is used amongst
- * all running envoy processes.
+ * all running envoy processes. The stat slots are followed by a hash index of the slots in use,
+ * so that stats are found without scanning the slots:
+ * - One bucket per slot, holding the index of the first slot of the bucket or NO_SLOT.
+ * - The next slot of each slot, either in its bucket or, for unused slots, in the free list.
+ * The index is followed by the shards of the TLS session cache, if there is one.
  */
 class SharedMemory {
 public:
   static void configure(size_t max_num_stats, size_t max_stat_name_len);
-  static std::string version(uint64_t max_num_stats, uint64_t max_stat_name_len);
+  static std::string version(uint64_t max_num_stats, uint64_t max_stat_name_len,
+                             uint64_t max_ssl_sessions);
   std::string version();
 
 private:
@@ -48,17 +59,64 @@ private:
    */
   void initializeMutex(pthread_mutex_t& mutex);
 
+  /**
+   * @return the size of the segment for the given number of stats of the given size, and the
+   *         given number of slots per session cache shard.
+   */
+  static uint64_t totalSize(uint64_t max_num_stats, uint64_t entry_size,
+                            uint64_t session_slots_per_shard);
+
+  /**
+   * @return the number of slots per session cache shard for the given number of sessions, which
+   *         is 0 if the session cache is disabled.
+   */
+  static uint64_t sessionSlotsPerShard(uint64_t max_ssl_sessions);
+
+  /**
+   * @return the offset of the session cache shards from the start of the stat slots.
+   */
+  static uint64_t sessionsOffset(uint64_t max_num_stats, uint64_t entry_size);
+
+  /**
+   * Build the index from the slots in use, putting the others in the free list. This is done when
+   * attaching to the segment as well, as a process that died while holding the stat lock may
+   * have left the index inconsistent. The stat lock must be held unless the segment is new.
+   */
+  void rebuildIndex();
+
+  /**
+   * @return the bucket of the given stat name in the index.
+   */
+  uint32_t& bucket(absl::string_view name);
+
+  Stats::RawStatData& slot(uint32_t index) {
+    return *reinterpret_cast<Stats::RawStatData*>(stats_slots_ + entry_size_ * index);
+  }
+  uint32_t* buckets() {
+    return reinterpret_cast<uint32_t*>(stats_slots_ + entry_size_ * num_stats_);
+  }
+  uint32_t* nextSlots() { return buckets() + num_stats_; }
+  uint8_t* sessionShard(uint32_t index) {
+    return stats_slots_ + sessionsOffset(num_stats_, entry_size_) +
+           Ssl::SessionCacheImpl::slotSize() * session_slots_per_shard_ * index;
+  }
+
   static const uint64_t VERSION;
+  static const uint32_t NO_SLOT = UINT32_MAX;
 
   uint64_t size_;
   uint64_t version_;
   uint64_t num_stats_;
   uint64_t entry_size_;
+  uint32_t free_slot_;
+  uint32_t unused_;
+  uint64_t session_slots_per_shard_;
   std::atomic<uint64_t> flags_;
   pthread_mutex_t log_lock_;
   pthread_mutex_t access_log_lock_;
   pthread_mutex_t stat_lock_;
   pthread_mutex_t init_lock_;
+  pthread_mutex_t session_locks_[Ssl::SessionCacheImpl::NUM_SHARDS];
   alignas(Stats::RawStatData) uint8_t
       stats_slots_[]; // array of Stats::RawStatData, which has a flexible-array-length member
                       // so non-fixed size
@@ -113,6 +171,7 @@ private:
  */
 class HotRestartImpl : public HotRestart,
                        public Stats::RawStatDataAllocator,
+                       public Ssl::SessionCacheMemory,
                        Logger::Loggable<Logger::Id::main> {
 public:
   HotRestartImpl(Options& options);
@@ -122,18 +181,27 @@ public:
 
   // Server::HotRestart
   void drainParentListeners() override;
-  int duplicateParentListenSocket(const std::string& address) override;
+  int duplicateParentListenSocket(const std::string& address, uint32_t worker_index) override;
   void getParentStats(GetParentStatsInfo& info) override;
   void initialize(Event::Dispatcher& dispatcher, Server::Instance& server) override;
   void shutdownParentAdmin(ShutdownParentAdminInfo& info) override;
   void terminateParent() override;
   void shutdown() override;
   std::string version() override;
+  Ssl::SessionCacheMemory* sessionCacheMemory() override;
+  void addStateExporter(const std::string& name, StateExporter exporter) override;
+  std::string getParentState(const std::string& name) override;
 
   // RawStatDataAllocator
   Stats::RawStatData* alloc(const std::string& name) override;
   void free(Stats::RawStatData& data) override;
 
+  // Ssl::SessionCacheMemory
+  uint32_t numShards() override { return Ssl::SessionCacheImpl::NUM_SHARDS; }
+  uint32_t slotsPerShard() override { return shmem_.session_slots_per_shard_; }
+  uint8_t* shard(uint32_t index) override { return shmem_.sessionShard(index); }
+  Thread::BasicLockable& lock(uint32_t index) override { return *session_locks_[index]; }
+
 private:
   enum class RpcMessageType {
     DrainListenersRequest = 1,
@@ -144,7 +212,9 @@ private:
     TerminateRequest = 6,
     UnknownRequestReply = 7,
     GetStatsRequest = 8,
-    GetStatsReply = 9
+    GetStatsReply = 9,
+    GetStateRequest = 10,
+    GetStateReply = 11
   };
 
   struct RpcBase {
@@ -159,6 +229,7 @@ private:
     RpcGetListenSocketRequest() : RpcBase(RpcMessageType::GetListenSocketRequest, sizeof(*this)) {}
 
     char address_[256]{0};
+    uint32_t worker_index_{0};
   } __attribute__((packed));
 
   struct RpcGetListenSocketReply : public RpcBase {
@@ -181,6 +252,22 @@ private:
     uint64_t unused_[16]{0};
   } __attribute__((packed));
 
+  struct RpcGetStateRequest : public RpcBase {
+    RpcGetStateRequest() : RpcBase(RpcMessageType::GetStateRequest, sizeof(*this)) {}
+
+    char name_[256]{0};
+    uint64_t offset_{0};
+  } __attribute__((packed));
+
+  // A section of state is sent in chunks. Each reply is only as long as the chunk it carries, so
+  // length_ is at most sizeof(RpcGetStateReply).
+  struct RpcGetStateReply : public RpcBase {
+    RpcGetStateReply() : RpcBase(RpcMessageType::GetStateReply, sizeof(*this)) {}
+
+    uint64_t total_length_{0};
+    char data_[4096 - sizeof(RpcBase) - sizeof(uint64_t)];
+  } __attribute__((packed));
+
   template <class rpc_class, RpcMessageType rpc_type> rpc_class* receiveTypedRpc() {
     RpcBase* base_message = receiveRpc(true);
     RELEASE_ASSERT(base_message->length_ == sizeof(rpc_class));
@@ -192,23 +279,31 @@ private:
   void initDomainSocketAddress(sockaddr_un* address);
   sockaddr_un createDomainSocketAddress(uint64_t id);
   void onGetListenSocket(RpcGetListenSocketRequest& rpc);
+  void onGetState(RpcGetStateRequest& rpc);
   void onSocketEvent();
   RpcBase* receiveRpc(bool block);
   void sendMessage(sockaddr_un& address, RpcBase& rpc);
 
   Options& options_;
   SharedMemory& shmem_;
+  // Guarded by stat_lock_.
+  bool stats_full_logged_{};
   ProcessSharedMutex log_lock_;
   ProcessSharedMutex access_log_lock_;
   ProcessSharedMutex stat_lock_;
   ProcessSharedMutex init_lock_;
+  std::vector<std::unique_ptr<ProcessSharedMutex>> session_locks_;
   int my_domain_socket_{-1};
   sockaddr_un parent_address_;
   sockaddr_un child_address_;
   Event::FileEventPtr socket_event_;
-  std::array<uint8_t, 4096> rpc_buffer_;
+  std::array<uint8_t, sizeof(RpcGetStateReply)> rpc_buffer_;
   Server::Instance* server_{};
   bool parent_terminated_{};
+  std::unordered_map<std::string, StateExporter> state_exporters_;
+  // The section a child is fetching. It is exported once, when the child asks for its first chunk.
+  std::string exported_state_name_;
+  std::string exported_state_;
 };
 
 } // namespace Server
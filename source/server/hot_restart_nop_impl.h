@@ -15,13 +15,16 @@ public:
   HotRestartNopImpl(){};
 
   void drainParentListeners() override {}
-  int duplicateParentListenSocket(const std::string&) override { return -1; }
+  int duplicateParentListenSocket(const std::string&, uint32_t) override { return -1; }
   void getParentStats(GetParentStatsInfo& info) override { memset(&info, 0, sizeof(info)); }
   void initialize(Event::Dispatcher&, Server::Instance&) override {}
   void shutdownParentAdmin(ShutdownParentAdminInfo&) override {}
   void terminateParent() override {}
   void shutdown() override {}
   std::string version() override { return "disabled"; }
+  Ssl::SessionCacheMemory* sessionCacheMemory() override { return nullptr; }
+  void addStateExporter(const std::string&, StateExporter) override {}
+  std::string getParentState(const std::string&) override { return ""; }
 };
 
 } // namespace Server
@@ -1,8 +1,13 @@
 #include "server/http/admin.h"
 
 #include <algorithm>
+#include <cmath>
 #include <cstdint>
 #include <fstream>
+#include <regex>
+#include <list>
+#include <map>
+#include <memory>
 #include <string>
 #include <unordered_map>
 #include <unordered_set>
@@ -25,6 +30,7 @@
 #include "common/common/enum_to_int.h"
 #include "common/common/utility.h"
 #include "common/common/version.h"
+#include "common/filesystem/filesystem_impl.h"
 #include "common/html/utility.h"
 #include "common/http/codes.h"
 #include "common/http/header_map_impl.h"
@@ -56,6 +62,10 @@ namespace Server {
 
 namespace {
 
+// Number of complete continuous CPU profile windows that are kept, e.g. the last hour with one
+// minute windows.
+const uint32_t MaxCpuProfileWindows = 60;
+
 /**
  * Favicon base64 image was harvested by screen-capturing the favicon from a Chrome tab
  * while visiting https://www.envoyproxy.io/. The resulting PNG was translated to base64
@@ -202,6 +212,8 @@ void AdminImpl::addOutlierInfo(const std::string& cluster_name,
                              outlier_detector->successRateAverage()));
     response.add(fmt::format("{}::outlier::success_rate_ejection_threshold::{}\n", cluster_name,
                              outlier_detector->successRateEjectionThreshold()));
+    response.add(fmt::format("{}::outlier::latency_ejection_threshold::{}\n", cluster_name,
+                             outlier_detector->latencyEjectionThreshold()));
   }
 }
 
@@ -218,11 +230,20 @@ void AdminImpl::addCircuitSettings(const std::string& cluster_name, const std::s
                            resource_manager.retries().max()));
 }
 
-Http::Code AdminImpl::handlerClusters(const std::string&, Http::HeaderMap&,
+Http::Code AdminImpl::handlerClusters(const std::string& url, Http::HeaderMap&,
                                       Buffer::Instance& response) {
+  // Clusters can be restricted to those whose names match a regex.
+  Regex::MatcherPtr filter;
+  if (!parseFilter(Http::Utility::parseQueryString(url), filter, response)) {
+    return Http::Code::BadRequest;
+  }
+
   response.add(fmt::format("version_info::{}\n", server_.clusterManager().versionInfo()));
 
   for (auto& cluster : server_.clusterManager().clusters()) {
+    if (filter != nullptr && !filter->match(cluster.first)) {
+      continue;
+    }
     addOutlierInfo(cluster.second.get().info()->name(), cluster.second.get().outlierDetector(),
                    response);
 
@@ -268,6 +289,8 @@ Http::Code AdminImpl::handlerClusters(const std::string&, Http::HeaderMap&,
         response.add(fmt::format("{}::{}::success_rate::{}\n", cluster.second.get().info()->name(),
                                  host->address()->asString(),
                                  host->outlierDetector().successRate()));
+        response.add(fmt::format("{}::{}::latency::{}\n", cluster.second.get().info()->name(),
+                                 host->address()->asString(), host->outlierDetector().latency()));
       }
     }
   }
@@ -285,6 +308,10 @@ Http::Code AdminImpl::handlerCpuProfiler(const std::string& url, Http::HeaderMap
   }
 
   bool enable = query_params.begin()->second == "y";
+  if (enable && cpu_profile_windows_) {
+    // The continuous profile yields to the requested one until the next window.
+    cpu_profile_windows_->stop();
+  }
   if (enable && !Profiler::Cpu::profilerEnabled()) {
     if (!Profiler::Cpu::startProfiler(profile_path_)) {
       response.add("failure to start the profiler");
@@ -299,6 +326,35 @@ Http::Code AdminImpl::handlerCpuProfiler(const std::string& url, Http::HeaderMap
   return Http::Code::OK;
 }
 
+Http::Code AdminImpl::handlerCpuProfilerWindows(const std::string& url, Http::HeaderMap&,
+                                                Buffer::Instance& response) {
+  const std::deque<std::string> no_windows;
+  const std::deque<std::string>& windows =
+      cpu_profile_windows_ ? cpu_profile_windows_->windows() : no_windows;
+
+  Http::Utility::QueryParams query_params = Http::Utility::parseQueryString(url);
+  if (query_params.empty()) {
+    for (size_t i = 0; i < windows.size(); i++) {
+      response.add(fmt::format("{}: {}\n", i, windows[i]));
+    }
+    return Http::Code::OK;
+  }
+
+  uint64_t index;
+  if (query_params.size() != 1 || query_params.begin()->first != "index" ||
+      !StringUtil::atoul(query_params.begin()->second.c_str(), index)) {
+    response.add("?index=<window>\n");
+    return Http::Code::BadRequest;
+  }
+  if (index >= windows.size()) {
+    response.add(fmt::format("no window {}\n", index));
+    return Http::Code::NotFound;
+  }
+
+  response.add(Filesystem::fileReadToEnd(windows[index]));
+  return Http::Code::OK;
+}
+
 Http::Code AdminImpl::handlerHealthcheckFail(const std::string&, Http::HeaderMap&,
                                              Buffer::Instance& response) {
   server_.failHealthcheck(true);
@@ -313,6 +369,18 @@ Http::Code AdminImpl::handlerHealthcheckOk(const std::string&, Http::HeaderMap&,
   return Http::Code::OK;
 }
 
+Http::Code AdminImpl::handlerHeapProfiler(const std::string&, Http::HeaderMap&,
+                                          Buffer::Instance& response) {
+  std::string profile;
+  if (!Profiler::Heap::sampledProfile(profile)) {
+    response.add("heap sampling requires tcmalloc\n");
+    return Http::Code::InternalServerError;
+  }
+
+  response.add(profile);
+  return Http::Code::OK;
+}
+
 Http::Code AdminImpl::handlerHotRestartVersion(const std::string&, Http::HeaderMap&,
                                                Buffer::Instance& response) {
   response.add(server_.hotRestart().version());
@@ -368,80 +436,233 @@ Http::Code AdminImpl::handlerServerInfo(const std::string&, Http::HeaderMap&,
 
 Http::Code AdminImpl::handlerStats(const std::string& url, Http::HeaderMap& response_headers,
                                    Buffer::Instance& response) {
-  // We currently don't support timers locally (only via statsd) so just group all the counters
-  // and gauges together, alpha sort them, and spit them out.
-  Http::Code rc = Http::Code::OK;
+  // Group all the counters and gauges together, alpha sort them, and spit them out. The plain text
+  // format lists the quantiles of the histograms after them, as of the last stats flush. Stats
+  // can be restricted to those that were used or whose names match a regex in every format.
   const Http::Utility::QueryParams params = Http::Utility::parseQueryString(url);
-  std::map<std::string, uint64_t> all_stats;
+  const auto format = params.find("format");
+  for (const auto& param : params) {
+    if (param.first != "format" && param.first != "usedonly" && param.first != "filter") {
+      return statsUsage(response);
+    }
+  }
+  const bool used_only = params.count("usedonly") > 0;
+  Regex::MatcherPtr filter;
+  if (!parseFilter(params, filter, response)) {
+    return Http::Code::BadRequest;
+  }
+  auto shown = [used_only, &filter](const Stats::Metric& metric, bool used) -> bool {
+    return (used || !used_only) && (filter == nullptr || filter->match(metric.name()));
+  };
+
+  std::list<Stats::CounterSharedPtr> counters;
   for (const Stats::CounterSharedPtr& counter : server_.stats().counters()) {
+    if (shown(*counter, counter->used())) {
+      counters.push_back(counter);
+    }
+  }
+  std::list<Stats::GaugeSharedPtr> gauges;
+  for (const Stats::GaugeSharedPtr& gauge : server_.stats().gauges()) {
+    if (shown(*gauge, gauge->used())) {
+      gauges.push_back(gauge);
+    }
+  }
+  // Histograms that had no values recorded have no quantiles to show.
+  std::list<Stats::ParentHistogramSharedPtr> histograms;
+  for (const Stats::ParentHistogramSharedPtr& histogram : server_.stats().histograms()) {
+    if (histogram->used() && shown(*histogram, true)) {
+      histograms.push_back(histogram);
+    }
+  }
+
+  if (format != params.end() && format->second == "prometheus") {
+    PrometheusStatsFormatter::statsAsPrometheus(counters, gauges, histograms, response);
+    return Http::Code::OK;
+  }
+
+  std::map<std::string, uint64_t> all_stats;
+  for (const Stats::CounterSharedPtr& counter : counters) {
     all_stats.emplace(counter->name(), counter->value());
   }
 
-  for (const Stats::GaugeSharedPtr& gauge : server_.stats().gauges()) {
+  for (const Stats::GaugeSharedPtr& gauge : gauges) {
     all_stats.emplace(gauge->name(), gauge->value());
   }
 
-  if (params.size() == 0) {
-    // No Arguments so use the standard.
+  if (format == params.end()) {
+    // No format so use the standard.
     for (auto stat : all_stats) {
       response.add(fmt::format("{}: {}\n", stat.first, stat.second));
     }
+    std::map<std::string, std::string> all_histograms;
+    for (const Stats::ParentHistogramSharedPtr& histogram : histograms) {
+      all_histograms.emplace(histogram->name(), histogram->summary());
+    }
+    for (auto histogram : all_histograms) {
+      response.add(fmt::format("{}: {}\n", histogram.first, histogram.second));
+    }
+  } else if (format->second == "json") {
+    response_headers.insertContentType().value().setReference(
+        Http::Headers::get().ContentTypeValues.Json);
+    response.add(AdminImpl::statsAsJson(all_stats));
   } else {
-    const std::string format_key = params.begin()->first;
-    const std::string format_value = params.begin()->second;
-    if (format_key == "format" && format_value == "json") {
-      response_headers.insertContentType().value().setReference(
-          Http::Headers::get().ContentTypeValues.Json);
-      response.add(AdminImpl::statsAsJson(all_stats));
-    } else if (format_key == "format" && format_value == "prometheus") {
-      PrometheusStatsFormatter::statsAsPrometheus(server_.stats().counters(),
-                                                  server_.stats().gauges(), response);
-    } else {
-      response.add("usage: /stats?format=json \n");
-      response.add("\n");
-      rc = Http::Code::NotFound;
+    return statsUsage(response);
+  }
+  return Http::Code::OK;
+}
+
+Http::Code AdminImpl::handlerStatsScopes(const std::string& url, Http::HeaderMap&,
+                                         Buffer::Instance& response) {
+  // List the scopes with the most stats first, as those are the ones to look at when the number of
+  // stats grows.
+  const Http::Utility::QueryParams params = Http::Utility::parseQueryString(url);
+  uint64_t limit = DEFAULT_STATS_SCOPES_LIMIT;
+  const auto limit_param = params.find("limit");
+  if (limit_param != params.end() && !StringUtil::atoul(limit_param->second.c_str(), limit)) {
+    response.add("usage: /stats/scopes?limit=<number of scopes>\n");
+    return Http::Code::BadRequest;
+  }
+
+  std::list<Stats::ScopeStatsInfo> scopes = server_.stats().scopes();
+  scopes.sort([](const Stats::ScopeStatsInfo& a, const Stats::ScopeStatsInfo& b) -> bool {
+    return a.num_stats_ != b.num_stats_ ? a.num_stats_ > b.num_stats_ : a.prefix_ < b.prefix_;
+  });
+  if (scopes.size() > limit) {
+    scopes.resize(limit);
+  }
+  for (const Stats::ScopeStatsInfo& scope : scopes) {
+    const std::string prefix = scope.prefix_.empty() ? "(root)" : scope.prefix_;
+    response.add(fmt::format("{}: {}\n", prefix, scope.num_stats_));
+  }
+  return Http::Code::OK;
+}
+
+Http::Code AdminImpl::handlerWorkers(const std::string&, Http::HeaderMap&,
+                                     Buffer::Instance& response) {
+  // The rates of a worker are computed since the previous request, or since the worker started for
+  // the first one, so that polling /workers gives the current load of each worker.
+  const MonotonicTime now = std::chrono::steady_clock::now();
+  std::vector<WorkerLoad> loads = server_.listenerManager().workerLoads();
+  for (size_t i = 0; i < loads.size(); i++) {
+    const WorkerLoad& load = loads[i];
+    WorkerLoad since;
+    MonotonicTime since_time = load.started_;
+    if (i < last_worker_loads_.size() && last_worker_loads_[i].started_ == load.started_ &&
+        last_worker_loads_time_ > load.started_) {
+      since = last_worker_loads_[i];
+      since_time = last_worker_loads_time_;
+    }
+    const double interval_us =
+        load.started_ == MonotonicTime()
+            ? 0
+            : std::chrono::duration_cast<std::chrono::microseconds>(now - since_time).count();
+
+    std::string line = fmt::format(
+        "worker_{}: connections={} active_requests={} requests={} rps={:.1f} rx_bytes={} "
+        "tx_bytes={}",
+        i, load.connections_, load.active_requests_, load.requests_total_,
+        interval_us > 0 ? (load.requests_total_ - since.requests_total_) * 1000000 / interval_us
+                        : 0,
+        load.rx_bytes_, load.tx_bytes_);
+    // The busy time is only tracked along with the histograms of the event loops.
+    if (load.busy_tracked_) {
+      line += fmt::format(
+          " busy_pct={:.1f}",
+          interval_us > 0 ? (load.busy_time_ - since.busy_time_).count() * 100 / interval_us : 0);
     }
+    response.add(fmt::format("{} pending_posts={}\n", line, load.pending_posts_));
   }
-  return rc;
+
+  last_worker_loads_ = std::move(loads);
+  last_worker_loads_time_ = now;
+  return Http::Code::OK;
+}
+
+Http::Code AdminImpl::statsUsage(Buffer::Instance& response) {
+  response.add("usage: /stats?format=json \n");
+  response.add("       /stats?format=prometheus\n");
+  response.add("       /stats?usedonly&filter=<regex>\n");
+  response.add("\n");
+  return Http::Code::NotFound;
 }
 
-std::string PrometheusStatsFormatter::sanitizeName(const std::string& name) {
-  std::string stats_name = name;
-  std::replace(stats_name.begin(), stats_name.end(), '.', '_');
-  std::replace(stats_name.begin(), stats_name.end(), '-', '_');
-  return stats_name;
+bool AdminImpl::parseFilter(const Http::Utility::QueryParams& params, Regex::MatcherPtr& filter,
+                            Buffer::Instance& response) {
+  const auto param = params.find("filter");
+  if (param == params.end()) {
+    return true;
+  }
+  // Names match if the regex matches any part of them.
+  try {
+    filter = Regex::Utility::parseRegex(fmt::format(".*({}).*", param->second));
+  } catch (const std::regex_error& e) {
+    response.add(fmt::format("invalid filter regex {}: {}\n", param->second, e.what()));
+    return false;
+  }
+  return true;
 }
 
-std::string PrometheusStatsFormatter::formattedTags(const std::vector<Stats::Tag>& tags) {
-  std::vector<std::string> buf;
-  for (const Stats::Tag& tag : tags) {
-    buf.push_back(fmt::format("{}=\"{}\"", sanitizeName(tag.name_), tag.value_));
+namespace {
+
+/**
+ * Group stats by their Prometheus metric name, as all the series of a metric must follow its
+ * single TYPE line. The metric names are sorted, which keeps the output stable between scrapes.
+ */
+template <class StatType>
+std::map<std::string, std::vector<const StatType*>>
+groupByMetricName(const std::list<std::shared_ptr<StatType>>& stats) {
+  std::map<std::string, std::vector<const StatType*>> groups;
+  for (const auto& stat : stats) {
+    groups[PrometheusStatsFormatter::metricName(stat->tagExtractedName())].push_back(stat.get());
   }
-  return StringUtil::join(buf, ",");
+  return groups;
 }
 
-std::string PrometheusStatsFormatter::metricName(const std::string& extractedName) {
-  // Add namespacing prefix to avoid conflicts, as per best practice:
-  // https://prometheus.io/docs/practices/naming/#metric-names
-  // Also, naming conventions on https://prometheus.io/docs/concepts/data_model/
-  return fmt::format("envoy_{0}", sanitizeName(extractedName));
+std::string prometheusValue(double value) {
+  return std::isnan(value) ? "NaN" : fmt::format("{}", value);
 }
 
-void PrometheusStatsFormatter::statsAsPrometheus(const std::list<Stats::CounterSharedPtr>& counters,
-                                                 const std::list<Stats::GaugeSharedPtr>& gauges,
-                                                 Buffer::Instance& response) {
-  for (const auto& counter : counters) {
-    const std::string tags = formattedTags(counter->tags());
-    const std::string metric_name = metricName(counter->tagExtractedName());
-    response.add(fmt::format("# TYPE {0} counter\n", metric_name));
-    response.add(fmt::format("{0}{{{1}}} {2}\n", metric_name, tags, counter->value()));
+} // namespace
+
+void PrometheusStatsFormatter::statsAsPrometheus(
+    const std::list<Stats::CounterSharedPtr>& counters,
+    const std::list<Stats::GaugeSharedPtr>& gauges,
+    const std::list<Stats::ParentHistogramSharedPtr>& histograms, Buffer::Instance& response) {
+  for (const auto& group : groupByMetricName(counters)) {
+    response.add(fmt::format("# TYPE {0} counter\n", group.first));
+    for (const Stats::Counter* counter : group.second) {
+      response.add(fmt::format("{0}{{{1}}} {2}\n", group.first, formattedTags(counter->tags()),
+                               counter->value()));
+    }
+  }
+
+  for (const auto& group : groupByMetricName(gauges)) {
+    response.add(fmt::format("# TYPE {0} gauge\n", group.first));
+    for (const Stats::Gauge* gauge : group.second) {
+      response.add(fmt::format("{0}{{{1}}} {2}\n", group.first, formattedTags(gauge->tags()),
+                               gauge->value()));
+    }
   }
 
-  for (const auto& gauge : gauges) {
-    const std::string tags = formattedTags(gauge->tags());
-    const std::string metric_name = metricName(gauge->tagExtractedName());
-    response.add(fmt::format("# TYPE {0} gauge\n", metric_name));
-    response.add(fmt::format("{0}{{{1}}} {2}\n", metric_name, tags, gauge->value()));
+  // Histograms are summaries: the quantiles of the last stats flush interval, and the count and
+  // sum of all the values recorded.
+  for (const auto& group : groupByMetricName(histograms)) {
+    response.add(fmt::format("# TYPE {0} summary\n", group.first));
+    for (const Stats::ParentHistogram* histogram : group.second) {
+      const std::string tags = formattedTags(histogram->tags());
+      const std::string separator = tags.empty() ? "" : ",";
+      const Stats::HistogramStatistics& interval = histogram->intervalStatistics();
+      const std::vector<double>& quantiles = interval.supportedQuantiles();
+      for (size_t i = 0; i < quantiles.size(); i++) {
+        response.add(fmt::format("{0}{{{1}{2}quantile=\"{3}\"}} {4}\n", group.first, tags,
+                                 separator, quantiles[i],
+                                 prometheusValue(interval.computedQuantiles()[i])));
+      }
+      const Stats::HistogramStatistics& cumulative = histogram->cumulativeStatistics();
+      response.add(fmt::format("{0}_sum{{{1}}} {2}\n", group.first, tags, cumulative.sampleSum()));
+      response.add(
+          fmt::format("{0}_count{{{1}}} {2}\n", group.first, tags, cumulative.sampleCount()));
+    }
   }
 }
 
@@ -532,6 +753,22 @@ Http::Code AdminImpl::handlerRuntime(const std::string& url, Http::HeaderMap& re
   return rc;
 }
 
+Http::Code AdminImpl::handlerRuntimeLookups(const std::string&, Http::HeaderMap&,
+                                            Buffer::Instance& response) {
+  // List the registered keys that are looked up the most first, as those are the ones whose
+  // lookups cost the most.
+  std::vector<std::pair<std::string, uint64_t>> lookups = Runtime::Key::lookups();
+  std::sort(lookups.begin(), lookups.end(),
+            [](const std::pair<std::string, uint64_t>& a,
+               const std::pair<std::string, uint64_t>& b) -> bool {
+              return a.second != b.second ? a.second > b.second : a.first < b.first;
+            });
+  for (const auto& lookup : lookups) {
+    response.add(fmt::format("{}: {}\n", lookup.first, lookup.second));
+  }
+  return Http::Code::OK;
+}
+
 const std::vector<std::pair<std::string, Runtime::Snapshot::Entry>> AdminImpl::sortedRuntime(
     const std::unordered_map<std::string, const Runtime::Snapshot::Entry>& entries) {
   std::vector<std::pair<std::string, Runtime::Snapshot::Entry>> pairs(entries.begin(),
@@ -622,10 +859,14 @@ AdminImpl::AdminImpl(const std::string& access_log_path, const std::string& prof
            false},
           {"/cpuprofiler", "enable/disable the CPU profiler",
            MAKE_ADMIN_HANDLER(handlerCpuProfiler), false, true},
+          {"/cpuprofiler/windows", "list/print the continuous CPU profile windows",
+           MAKE_ADMIN_HANDLER(handlerCpuProfilerWindows), false, false},
           {"/healthcheck/fail", "cause the server to fail health checks",
            MAKE_ADMIN_HANDLER(handlerHealthcheckFail), false, true},
           {"/healthcheck/ok", "cause the server to pass health checks",
            MAKE_ADMIN_HANDLER(handlerHealthcheckOk), false, true},
+          {"/heapprofiler", "print a profile of the heap sampled by tcmalloc",
+           MAKE_ADMIN_HANDLER(handlerHeapProfiler), false, false},
           {"/help", "print out list of admin commands", MAKE_ADMIN_HANDLER(handlerHelp), false,
            false},
           {"/hot_restart_version", "print the hot restart compatability version",
@@ -639,9 +880,15 @@ AdminImpl::AdminImpl(const std::string& access_log_path, const std::string& prof
           {"/server_info", "print server version/status information",
            MAKE_ADMIN_HANDLER(handlerServerInfo), false, false},
           {"/stats", "print server stats", MAKE_ADMIN_HANDLER(handlerStats), false, false},
+          {"/stats/scopes", "print the stats scopes with the most stats",
+           MAKE_ADMIN_HANDLER(handlerStatsScopes), false, false},
           {"/listeners", "print listener addresses", MAKE_ADMIN_HANDLER(handlerListenerInfo), false,
            false},
-          {"/runtime", "print runtime values", MAKE_ADMIN_HANDLER(handlerRuntime), false, false}},
+          {"/runtime", "print runtime values", MAKE_ADMIN_HANDLER(handlerRuntime), false, false},
+          {"/runtime/lookups", "print the lookups of the registered runtime keys",
+           MAKE_ADMIN_HANDLER(handlerRuntimeLookups), false, false},
+          {"/workers", "print the load of each worker", MAKE_ADMIN_HANDLER(handlerWorkers), false,
+           false}},
       listener_stats_(
           Http::ConnectionManagerImpl::generateListenerStats("http.admin.", listener_scope)) {
 
@@ -658,6 +905,18 @@ AdminImpl::AdminImpl(const std::string& access_log_path, const std::string& prof
   access_logs_.emplace_back(new AccessLog::FileAccessLog(
       access_log_path, {}, AccessLog::AccessLogFormatUtils::defaultAccessLogFormatter(),
       server.accessLogManager()));
+
+  const std::chrono::milliseconds cpu_profile_window = server_.options().cpuProfileWindow();
+  if (cpu_profile_window.count() > 0) {
+    cpu_profile_windows_.reset(
+        new Profiler::CpuWindows(profile_path_ + ".window", MaxCpuProfileWindows));
+    cpu_profile_window_timer_ = server_.dispatcher().createTimer([this, cpu_profile_window]() {
+      cpu_profile_windows_->rotate();
+      cpu_profile_window_timer_->enableTimer(cpu_profile_window);
+    });
+    cpu_profile_windows_->rotate();
+    cpu_profile_window_timer_->enableTimer(cpu_profile_window);
+  }
 }
 
 Http::ServerConnectionPtr AdminImpl::createCodec(Network::Connection& connection,
@@ -670,7 +929,7 @@ Http::ServerConnectionPtr AdminImpl::createCodec(Network::Connection& connection
 bool AdminImpl::createFilterChain(Network::Connection& connection) {
   connection.addReadFilter(Network::ReadFilterSharedPtr{new Http::ConnectionManagerImpl(
       *this, server_.drainManager(), server_.random(), server_.httpTracer(), server_.runtime(),
-      server_.localInfo(), server_.clusterManager())});
+      server_.localInfo(), server_.clusterManager(), nullptr)});
   return true;
 }
 
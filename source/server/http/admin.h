@@ -2,6 +2,7 @@
 
 #include <chrono>
 #include <list>
+#include <memory>
 #include <string>
 #include <unordered_map>
 #include <utility>
@@ -17,9 +18,11 @@
 
 #include "common/common/logger.h"
 #include "common/common/macros.h"
+#include "common/common/regex.h"
 #include "common/http/conn_manager_impl.h"
 #include "common/http/date_provider_impl.h"
 #include "common/http/utility.h"
+#include "common/profiler/profiler.h"
 
 #include "server/config/network/http_connection_manager.h"
 
@@ -65,6 +68,7 @@ public:
   Http::FilterChainFactory& filterFactory() override { return *this; }
   bool generateRequestId() override { return false; }
   const Optional<std::chrono::milliseconds>& idleTimeout() override { return idle_timeout_; }
+  uint32_t maxPipelinedRequests() override { return 0; }
   Router::RouteConfigProvider& routeConfigProvider() override { return route_config_provider_; }
   const std::string& serverName() override {
     return Server::Configuration::HttpConnectionManagerConfig::DEFAULT_SERVER_STRING;
@@ -82,6 +86,7 @@ public:
   const Optional<std::string>& userAgent() override { return user_agent_; }
   const Http::TracingConnectionManagerConfig* tracingConfig() override { return nullptr; }
   Http::ConnectionManagerListenerStats& listenerStats() override { return listener_stats_; }
+  Http::HeaderOnlyResponder* headerOnlyResponder() override { return nullptr; }
 
 private:
   /**
@@ -119,7 +124,17 @@ private:
   void addOutlierInfo(const std::string& cluster_name,
                       const Upstream::Outlier::Detector* outlier_detector,
                       Buffer::Instance& response);
+  // Number of scopes listed by /stats/scopes without a limit parameter.
+  static const uint64_t DEFAULT_STATS_SCOPES_LIMIT = 20;
+
   static std::string statsAsJson(const std::map<std::string, uint64_t>& all_stats);
+  static Http::Code statsUsage(Buffer::Instance& response);
+  /**
+   * Compile the regex of the filter query parameter, if any.
+   * @return false if the regex is invalid, after adding the error to the response.
+   */
+  static bool parseFilter(const Http::Utility::QueryParams& params, Regex::MatcherPtr& filter,
+                          Buffer::Instance& response);
   static std::string
   runtimeAsJson(const std::vector<std::pair<std::string, Runtime::Snapshot::Entry>>& entries);
   std::vector<const UrlHandler*> sortedHandlers() const;
@@ -137,10 +152,15 @@ private:
                              Buffer::Instance& response);
   Http::Code handlerCpuProfiler(const std::string& path_and_query,
                                 Http::HeaderMap& response_headers, Buffer::Instance& response);
+  Http::Code handlerCpuProfilerWindows(const std::string& path_and_query,
+                                       Http::HeaderMap& response_headers,
+                                       Buffer::Instance& response);
   Http::Code handlerHealthcheckFail(const std::string& path_and_query,
                                     Http::HeaderMap& response_headers, Buffer::Instance& response);
   Http::Code handlerHealthcheckOk(const std::string& path_and_query,
                                   Http::HeaderMap& response_headers, Buffer::Instance& response);
+  Http::Code handlerHeapProfiler(const std::string& path_and_query,
+                                 Http::HeaderMap& response_headers, Buffer::Instance& response);
   Http::Code handlerHelp(const std::string& path_and_query, Http::HeaderMap& response_headers,
                          Buffer::Instance& response);
   Http::Code handlerHotRestartVersion(const std::string& path_and_query,
@@ -159,8 +179,14 @@ private:
                                Buffer::Instance& response);
   Http::Code handlerStats(const std::string& path_and_query, Http::HeaderMap& response_headers,
                           Buffer::Instance& response);
+  Http::Code handlerStatsScopes(const std::string& path_and_query,
+                                Http::HeaderMap& response_headers, Buffer::Instance& response);
   Http::Code handlerRuntime(const std::string& path_and_query, Http::HeaderMap& response_headers,
                             Buffer::Instance& response);
+  Http::Code handlerRuntimeLookups(const std::string& path_and_query,
+                                   Http::HeaderMap& response_headers, Buffer::Instance& response);
+  Http::Code handlerWorkers(const std::string& path_and_query, Http::HeaderMap& response_headers,
+                            Buffer::Instance& response);
 
   Server::Instance& server_;
   std::list<AccessLog::InstanceSharedPtr> access_logs_;
@@ -175,6 +201,11 @@ private:
   Http::SlowDateProviderImpl date_provider_;
   std::vector<Http::ClientCertDetailsType> set_current_client_cert_details_;
   Http::ConnectionManagerListenerStats listener_stats_;
+  std::unique_ptr<Profiler::CpuWindows> cpu_profile_windows_;
+  Event::TimerPtr cpu_profile_window_timer_;
+  // The worker loads that /workers last printed, which its rates are computed since.
+  std::vector<WorkerLoad> last_worker_loads_;
+  MonotonicTime last_worker_loads_time_;
 };
 
 /**
@@ -215,11 +246,13 @@ private:
 class PrometheusStatsFormatter {
 public:
   /**
-   * Extracts counters and gauges and relevant tags, appending them to
-   * the response buffer after sanitizing the metric / label names.
+   * Extracts counters, gauges and histograms and relevant tags, appending them to
+   * the response buffer after sanitizing the metric / label names. Histograms are
+   * exported as summaries.
    */
   static void statsAsPrometheus(const std::list<Stats::CounterSharedPtr>& counters,
                                 const std::list<Stats::GaugeSharedPtr>& gauges,
+                                const std::list<Stats::ParentHistogramSharedPtr>& histograms,
                                 Buffer::Instance& response);
   /**
    * Format the given tags, returning a string as a comma-separated list
@@ -25,7 +25,8 @@ namespace Configuration {
 
 HttpFilterFactoryCb
 HealthCheckFilterConfig::createFilter(const envoy::api::v2::filter::http::HealthCheck& proto_config,
-                                      const std::string&, FactoryContext& context) {
+                                      const std::string&, FactoryContext& context,
+                                      Http::HeaderOnlyResponderSharedPtr& responder) {
   ASSERT(proto_config.has_pass_through_mode());
   ASSERT(!proto_config.endpoint().empty());
 
@@ -43,10 +44,12 @@ HealthCheckFilterConfig::createFilter(const envoy::api::v2::filter::http::Health
                                                     std::chrono::milliseconds(cache_time_ms)));
   }
 
+  responder.reset(new HealthCheckResponder(context, pass_through_mode, cache_manager, hc_endpoint));
+
   return [&context, pass_through_mode, cache_manager,
           hc_endpoint](Http::FilterChainFactoryCallbacks& callbacks) -> void {
-    callbacks.addStreamFilter(Http::StreamFilterSharedPtr{
-        new HealthCheckFilter(context, pass_through_mode, cache_manager, hc_endpoint)});
+    callbacks.addStreamFilter(callbacks.arena().makeShared<HealthCheckFilter>(
+        context, pass_through_mode, cache_manager, hc_endpoint));
   };
 }
 
@@ -56,17 +59,31 @@ HealthCheckFilterConfig::createFilter(const envoy::api::v2::filter::http::Health
 HttpFilterFactoryCb HealthCheckFilterConfig::createFilterFactory(const Json::Object& json_config,
                                                                  const std::string& stats_prefix,
                                                                  FactoryContext& context) {
-  envoy::api::v2::filter::http::HealthCheck proto_config;
-  Config::FilterJson::translateHealthCheckFilter(json_config, proto_config);
-  return createFilter(proto_config, stats_prefix, context);
+  Http::HeaderOnlyResponderSharedPtr responder;
+  return createFilterFactoryWithResponder(json_config, stats_prefix, context, responder);
 }
 
 HttpFilterFactoryCb
 HealthCheckFilterConfig::createFilterFactoryFromProto(const Protobuf::Message& proto_config,
                                                       const std::string& stats_prefix,
                                                       FactoryContext& context) {
+  Http::HeaderOnlyResponderSharedPtr responder;
+  return createFilterFactoryFromProtoWithResponder(proto_config, stats_prefix, context, responder);
+}
+
+HttpFilterFactoryCb HealthCheckFilterConfig::createFilterFactoryWithResponder(
+    const Json::Object& json_config, const std::string& stats_prefix, FactoryContext& context,
+    Http::HeaderOnlyResponderSharedPtr& responder) {
+  envoy::api::v2::filter::http::HealthCheck proto_config;
+  Config::FilterJson::translateHealthCheckFilter(json_config, proto_config);
+  return createFilter(proto_config, stats_prefix, context, responder);
+}
+
+HttpFilterFactoryCb HealthCheckFilterConfig::createFilterFactoryFromProtoWithResponder(
+    const Protobuf::Message& proto_config, const std::string& stats_prefix,
+    FactoryContext& context, Http::HeaderOnlyResponderSharedPtr& responder) {
   return createFilter(dynamic_cast<const envoy::api::v2::filter::http::HealthCheck&>(proto_config),
-                      stats_prefix, context);
+                      stats_prefix, context, responder);
 }
 
 /**
@@ -77,6 +94,30 @@ static Registry::RegisterFactory<HealthCheckFilterConfig, NamedHttpFilterConfigF
 } // namespace Configuration
 } // namespace Server
 
+namespace {
+
+// Returns the code to answer a health check with locally, setting the matching response flag.
+Http::Code localResponseCode(Server::Configuration::FactoryContext& context,
+                             const HealthCheckCacheManagerSharedPtr& cache_manager,
+                             RequestInfo::RequestInfo& request_info) {
+  if (context.healthCheckFailed()) {
+    request_info.setResponseFlag(RequestInfo::ResponseFlag::FailedLocalHealthCheck);
+    return Http::Code::ServiceUnavailable;
+  }
+
+  Http::Code final_status = Http::Code::OK;
+  if (cache_manager) {
+    final_status = cache_manager->getCachedResponseCode();
+  }
+
+  if (!Http::CodeUtility::is2xx(enumToInt(final_status))) {
+    request_info.setResponseFlag(RequestInfo::ResponseFlag::FailedLocalHealthCheck);
+  }
+  return final_status;
+}
+
+} // namespace
+
 HealthCheckCacheManager::HealthCheckCacheManager(Event::Dispatcher& dispatcher,
                                                  std::chrono::milliseconds timeout)
     : clear_cache_timer_(dispatcher.createTimer([this]() -> void { onTimer(); })),
@@ -146,26 +187,34 @@ Http::FilterHeadersStatus HealthCheckFilter::encodeHeaders(Http::HeaderMap& head
 
 void HealthCheckFilter::onComplete() {
   ASSERT(handling_);
-  Http::HeaderMapPtr headers;
-  if (context_.healthCheckFailed()) {
-    callbacks_->requestInfo().setResponseFlag(RequestInfo::ResponseFlag::FailedLocalHealthCheck);
-    headers.reset(new Http::HeaderMapImpl{
-        {Http::Headers::get().Status, std::to_string(enumToInt(Http::Code::ServiceUnavailable))}});
-  } else {
-    Http::Code final_status = Http::Code::OK;
-    if (cache_manager_) {
-      final_status = cache_manager_->getCachedResponseCode();
-    }
+  const Http::Code final_status =
+      localResponseCode(context_, cache_manager_, callbacks_->requestInfo());
+  Http::HeaderMapPtr headers{new Http::HeaderMapImpl{
+      {Http::Headers::get().Status, std::to_string(enumToInt(final_status))}}};
+  callbacks_->encodeHeaders(std::move(headers), true);
+}
 
-    if (!Http::CodeUtility::is2xx(enumToInt(final_status))) {
-      callbacks_->requestInfo().setResponseFlag(RequestInfo::ResponseFlag::FailedLocalHealthCheck);
-    }
+bool HealthCheckResponder::respond(const Http::HeaderMap& request_headers,
+                                   Http::HeaderMap& response_headers,
+                                   RequestInfo::RequestInfo& request_info) {
+  // This mirrors what HealthCheckFilter does for a header only request it handles, including the
+  // work of its encodeHeaders().
+  if (request_headers.Path()->value() != endpoint_.c_str() ||
+      !(!pass_through_mode_ || context_.healthCheckFailed() ||
+        (cache_manager_ && cache_manager_->useCachedResponseCode()))) {
+    return false;
+  }
 
-    headers.reset(new Http::HeaderMapImpl{
-        {Http::Headers::get().Status, std::to_string(enumToInt(final_status))}});
+  request_info.healthCheck(true);
+  const Http::Code final_status = localResponseCode(context_, cache_manager_, request_info);
+  if (cache_manager_) {
+    cache_manager_->setCachedResponseCode(final_status);
   }
 
-  callbacks_->encodeHeaders(std::move(headers), true);
+  response_headers.insertStatus().value(enumToInt(final_status));
+  response_headers.insertEnvoyUpstreamHealthCheckedCluster().value(
+      context_.localInfo().clusterName());
+  return true;
 }
 
 } // namespace Envoy
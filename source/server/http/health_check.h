@@ -29,11 +29,22 @@ public:
     return ProtobufTypes::MessagePtr{new envoy::api::v2::filter::http::HealthCheck()};
   }
 
+  HttpFilterFactoryCb
+  createFilterFactoryWithResponder(const Json::Object& json_config, const std::string& stats_prefix,
+                                   FactoryContext& context,
+                                   Http::HeaderOnlyResponderSharedPtr& responder) override;
+  HttpFilterFactoryCb
+  createFilterFactoryFromProtoWithResponder(const Protobuf::Message& proto_config,
+                                            const std::string& stats_prefix,
+                                            FactoryContext& context,
+                                            Http::HeaderOnlyResponderSharedPtr& responder) override;
+
   std::string name() override { return Config::HttpFilterNames::get().HEALTH_CHECK; }
 
 private:
   HttpFilterFactoryCb createFilter(const envoy::api::v2::filter::http::HealthCheck& proto_config,
-                                   const std::string& stats_prefix, FactoryContext& context);
+                                   const std::string& stats_prefix, FactoryContext& context,
+                                   Http::HeaderOnlyResponderSharedPtr& responder);
 };
 
 } // namespace Configuration
@@ -68,6 +79,29 @@ private:
 
 typedef std::shared_ptr<HealthCheckCacheManager> HealthCheckCacheManagerSharedPtr;
 
+/**
+ * Answers the header only health check requests that a health check filter with the same
+ * configuration would answer itself, so that the connection manager can answer them without a
+ * filter chain when the filter is first in the chain.
+ */
+class HealthCheckResponder : public Http::HeaderOnlyResponder {
+public:
+  HealthCheckResponder(Server::Configuration::FactoryContext& context, bool pass_through_mode,
+                       HealthCheckCacheManagerSharedPtr cache_manager, const std::string& endpoint)
+      : context_(context), pass_through_mode_(pass_through_mode), cache_manager_(cache_manager),
+        endpoint_(endpoint) {}
+
+  // Http::HeaderOnlyResponder
+  bool respond(const Http::HeaderMap& request_headers, Http::HeaderMap& response_headers,
+               RequestInfo::RequestInfo& request_info) override;
+
+private:
+  Server::Configuration::FactoryContext& context_;
+  const bool pass_through_mode_;
+  HealthCheckCacheManagerSharedPtr cache_manager_;
+  const std::string endpoint_;
+};
+
 /**
  * Health check responder filter.
  */
@@ -16,10 +16,11 @@ namespace Envoy {
 namespace Server {
 
 LdsApi::LdsApi(const envoy::api::v2::ConfigSource& lds_config, Upstream::ClusterManager& cm,
-               Event::Dispatcher& dispatcher, Runtime::RandomGenerator& random,
-               Init::Manager& init_manager, const LocalInfo::LocalInfo& local_info,
-               Stats::Scope& scope, ListenerManager& lm)
-    : listener_manager_(lm), scope_(scope.createScope("listener_manager.lds.")), cm_(cm) {
+               Event::Dispatcher& dispatcher, ThreadLocal::Instance& tls,
+               Runtime::RandomGenerator& random, Init::Manager& init_manager,
+               const LocalInfo::LocalInfo& local_info, Stats::Scope& scope, ListenerManager& lm)
+    : listener_manager_(lm), scope_(scope.createScope("listener_manager.lds.")), cm_(cm),
+      tls_(tls) {
   subscription_ =
       Envoy::Config::SubscriptionFactory::subscriptionFromConfigSource<envoy::api::v2::Listener>(
           lds_config, local_info.node(), dispatcher, cm, random, *scope_,
@@ -51,19 +52,26 @@ void LdsApi::onConfigUpdate(const ResourceVector& resources) {
     listeners_to_remove.emplace(listener.get().name(), listener);
   }
 
-  for (const auto& listener : resources) {
-    const std::string listener_name = listener.name();
-    listeners_to_remove.erase(listener_name);
-    if (listener_manager_.addOrUpdateListener(listener, true)) {
-      ENVOY_LOG(info, "lds: add/update listener '{}'", listener_name);
-    } else {
-      ENVOY_LOG(debug, "lds: add/update listener '{}' skipped", listener_name);
+  {
+    // The workers get the thread local updates of the listeners, e.g. of their filters and route
+    // configs, in one post. The listener manager flushes the batch before handing a listener to
+    // the workers, see ListenerManagerImpl::addListenerToWorker().
+    tls_.beginBatch();
+    Cleanup end_batch([this] { tls_.endBatch(); });
+    for (const auto& listener : resources) {
+      const std::string listener_name = listener.name();
+      listeners_to_remove.erase(listener_name);
+      if (listener_manager_.addOrUpdateListener(listener, true)) {
+        ENVOY_LOG(info, "lds: add/update listener '{}'", listener_name);
+      } else {
+        ENVOY_LOG(debug, "lds: add/update listener '{}' skipped", listener_name);
+      }
     }
-  }
 
-  for (const auto& listener : listeners_to_remove) {
-    if (listener_manager_.removeListener(listener.first)) {
-      ENVOY_LOG(info, "lds: remove listener '{}'", listener.first);
+    for (const auto& listener : listeners_to_remove) {
+      if (listener_manager_.removeListener(listener.first)) {
+        ENVOY_LOG(info, "lds: remove listener '{}'", listener.first);
+      }
     }
   }
 
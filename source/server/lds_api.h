@@ -5,6 +5,7 @@
 #include "envoy/config/subscription.h"
 #include "envoy/init/init.h"
 #include "envoy/server/listener_manager.h"
+#include "envoy/thread_local/thread_local.h"
 
 #include "common/common/logger.h"
 
@@ -21,9 +22,9 @@ class LdsApi : public Init::Target,
                Logger::Loggable<Logger::Id::upstream> {
 public:
   LdsApi(const envoy::api::v2::ConfigSource& lds_config, Upstream::ClusterManager& cm,
-         Event::Dispatcher& dispatcher, Runtime::RandomGenerator& random,
-         Init::Manager& init_manager, const LocalInfo::LocalInfo& local_info, Stats::Scope& scope,
-         ListenerManager& lm);
+         Event::Dispatcher& dispatcher, ThreadLocal::Instance& tls,
+         Runtime::RandomGenerator& random, Init::Manager& init_manager,
+         const LocalInfo::LocalInfo& local_info, Stats::Scope& scope, ListenerManager& lm);
 
   const std::string versionInfo() const { return subscription_->versionInfo(); }
 
@@ -41,6 +42,7 @@ private:
   ListenerManager& listener_manager_;
   Stats::ScopePtr scope_;
   Upstream::ClusterManager& cm_;
+  ThreadLocal::Instance& tls_;
   std::function<void()> initialize_callback_;
 };
 
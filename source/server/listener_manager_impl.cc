@@ -2,8 +2,12 @@
 
 #include "envoy/registry/registry.h"
 
+#include "common/buffer/memory_account_impl.h"
 #include "common/common/assert.h"
+#include "common/config/metadata.h"
 #include "common/config/utility.h"
+#include "common/config/well_known_names.h"
+#include "common/network/connection_balancer_impl.h"
 #include "common/network/listen_socket_impl.h"
 #include "common/network/utility.h"
 #include "common/protobuf/utility.h"
@@ -11,6 +15,7 @@
 
 #include "server/configuration_impl.h"
 #include "server/drain_manager_impl.h"
+#include "server/worker_impl.h"
 
 #include "fmt/format.h"
 
@@ -57,7 +62,7 @@ ProdListenerComponentFactory::createListenSocket(Network::Address::InstanceConst
   // TODO(mattklein123): UDS support.
   ASSERT(address->type() == Network::Address::Type::Ip);
   const std::string addr = fmt::format("tcp://{}", address->asString());
-  const int fd = server_.hotRestart().duplicateParentListenSocket(addr);
+  const int fd = server_.hotRestart().duplicateParentListenSocket(addr, 0);
   if (fd != -1) {
     ENVOY_LOG(debug, "obtained socket for address {} from parent", addr);
     return std::make_shared<Network::TcpListenSocket>(fd, address);
@@ -66,6 +71,31 @@ ProdListenerComponentFactory::createListenSocket(Network::Address::InstanceConst
   }
 }
 
+Network::ListenSocketSharedPtr ProdListenerComponentFactory::createReusePortListenSocket(
+    Network::Address::InstanceConstSharedPtr address, uint32_t worker_index) {
+  // Each worker gets the socket of the worker with the same index from our parent, if it has one.
+  ASSERT(address->type() == Network::Address::Type::Ip);
+  const std::string addr = fmt::format("tcp://{}", address->asString());
+  const int fd = server_.hotRestart().duplicateParentListenSocket(addr, worker_index);
+  Network::ListenSocketSharedPtr socket;
+  if (fd != -1) {
+    ENVOY_LOG(debug, "obtained socket for address {} worker {} from parent", addr, worker_index);
+    socket = std::make_shared<Network::TcpListenSocket>(fd, address);
+  } else {
+    socket = std::make_shared<Network::TcpListenSocket>(address, true, true);
+  }
+
+  // Steer the connections received on the CPU of the worker to its socket, so that the RX queue,
+  // its interrupts and the worker share a core.
+  const Optional<uint32_t> cpu =
+      ProdWorkerFactory::workerCpu(server_.options().workerCpuSet(), worker_index);
+  if (cpu.valid() && !Network::Utility::setIncomingCpu(socket->fd(), cpu.value())) {
+    ENVOY_LOG(warn, "unable to steer the connections of {} on CPU {} to worker {}: {}", addr,
+              cpu.value(), worker_index, strerror(errno));
+  }
+  return socket;
+}
+
 DrainManagerPtr
 ProdListenerComponentFactory::createDrainManager(envoy::api::v2::Listener::DrainType drain_type) {
   return DrainManagerPtr{new DrainManagerImpl(server_, drain_type)};
@@ -83,12 +113,35 @@ ListenerImpl::ListenerImpl(const envoy::api::v2::Listener& config, ListenerManag
       global_scope_(parent_.server_.stats().createScope("")),
       listener_scope_(
           parent_.server_.stats().createScope(fmt::format("listener.{}.", address_->asString()))),
+      overload_reject_(listener_scope_->counter("downstream_cx_overload_reject")),
+      memory_account_(
+          Buffer::MemoryAccountImpl::createChild(Buffer::MemoryAccountImpl::processAccount())),
       bind_to_port_(PROTOBUF_GET_WRAPPED_OR_DEFAULT(config.deprecated_v1(), bind_to_port, true)),
+      reuse_port_(
+          Config::Metadata::metadataValue(config.metadata(),
+                                          Config::MetadataFilters::get().ENVOY_LISTENER,
+                                          Config::MetadataEnvoyListenerKeys::get().REUSE_PORT)
+              .bool_value()),
       use_proxy_proto_(
           PROTOBUF_GET_WRAPPED_OR_DEFAULT(config.filter_chains()[0], use_proxy_proto, false)),
       use_original_dst_(PROTOBUF_GET_WRAPPED_OR_DEFAULT(config, use_original_dst, false)),
       per_connection_buffer_limit_bytes_(
           PROTOBUF_GET_WRAPPED_OR_DEFAULT(config, per_connection_buffer_limit_bytes, 1024 * 1024)),
+      accept_batch_size_(static_cast<uint32_t>(
+          Config::Metadata::metadataValue(
+              config.metadata(), Config::MetadataFilters::get().ENVOY_LISTENER,
+              Config::MetadataEnvoyListenerKeys::get().ACCEPT_BATCH_SIZE)
+              .number_value())),
+      tcp_fast_open_queue_length_(static_cast<uint32_t>(
+          Config::Metadata::metadataValue(
+              config.metadata(), Config::MetadataFilters::get().ENVOY_LISTENER,
+              Config::MetadataEnvoyListenerKeys::get().TCP_FAST_OPEN_QUEUE_LENGTH)
+              .number_value())),
+      tcp_defer_accept_seconds_(static_cast<uint32_t>(
+          Config::Metadata::metadataValue(
+              config.metadata(), Config::MetadataFilters::get().ENVOY_LISTENER,
+              Config::MetadataEnvoyListenerKeys::get().TCP_DEFER_ACCEPT_SECONDS)
+              .number_value())),
       listener_tag_(parent_.factory_.nextListenerTag()), name_(name), modifiable_(modifiable),
       workers_started_(workers_started), hash_(hash),
       local_drain_manager_(parent.factory_.createDrainManager(config.drain_type())) {
@@ -96,46 +149,30 @@ ListenerImpl::ListenerImpl(const envoy::api::v2::Listener& config, ListenerManag
   // filter chain #1308.
   ASSERT(config.filter_chains().size() >= 1);
 
-  // Skip lookup and update of the SSL Context if there is only one filter chain
-  // and it doesn't enforce any SNI restrictions.
-  const bool skip_context_update =
-      (config.filter_chains().size() == 1 &&
-       config.filter_chains()[0].filter_chain_match().sni_domains().empty());
+  if (Config::Metadata::metadataValue(config.metadata(),
+                                      Config::MetadataFilters::get().ENVOY_LISTENER,
+                                      Config::MetadataEnvoyListenerKeys::get().BALANCE_CONNECTIONS)
+          .bool_value()) {
+    connection_balancer_.reset(new Network::ExactConnectionBalancerImpl());
+  }
 
-  Optional<uint64_t> filters_hash;
-  uint32_t has_tls = 0;
-  uint32_t has_stk = 0;
-  for (const auto& filter_chain : config.filter_chains()) {
-    std::vector<std::string> sni_domains(filter_chain.filter_chain_match().sni_domains().begin(),
-                                         filter_chain.filter_chain_match().sni_domains().end());
-    if (!filters_hash.valid()) {
-      filters_hash.value(RepeatedPtrUtil::hash(filter_chain.filters()));
-      filter_factories_ = parent_.factory_.createFilterFactoryList(filter_chain.filters(), *this);
-    } else if (filters_hash.value() != RepeatedPtrUtil::hash(filter_chain.filters())) {
-      throw EnvoyException(fmt::format("error adding listener '{}': use of different filter chains "
-                                       "is currently not supported",
-                                       address_->asString()));
-    }
-    if (filter_chain.has_tls_context()) {
-      Ssl::ServerContextConfigImpl context_config(filter_chain.tls_context());
-      tls_contexts_.emplace_back(parent_.server_.sslContextManager().createSslServerContext(
-          name_, sni_domains, *listener_scope_, context_config, skip_context_update));
-      has_tls++;
-      if (filter_chain.tls_context().has_session_ticket_keys()) {
-        has_stk++;
-      }
-    }
+  if (reuse_port_ && !bind_to_port_) {
+    throw EnvoyException(fmt::format(
+        "error adding listener '{}': reuse_port requires the listener to bind to its port",
+        address_->asString()));
   }
 
-  // TODO(PiotrSikora): allow filter chains with mixed use of Session Ticket Keys.
-  // This doesn't work right now, because BoringSSL uses "session context" (initial SSL_CTX that
-  // accepted connection, before SNI update) for session related stuff, including Session Ticket
-  // callback, which is going to be called iff it's set on the initial SSL_CTX, even if it's not
-  // set on the current SSL_CTX that doesn't have any Session Ticket Keys configured.
-  if (has_stk != 0 && has_stk != has_tls) {
-    throw EnvoyException(fmt::format("error adding listener '{}': filter chains with mixed use of "
-                                     "Session Ticket Keys are currently not supported",
-                                     address_->asString()));
+  const std::string& filter_chain_group =
+      Config::Metadata::metadataValue(config.metadata(),
+                                      Config::MetadataFilters::get().ENVOY_LISTENER,
+                                      Config::MetadataEnvoyListenerKeys::get().FILTER_CHAIN_GROUP)
+          .string_value();
+  if (!filter_chain_group.empty()) {
+    shared_filter_chain_ =
+        parent_.sharedFilterChain(config, filter_chain_group, *address_, initManager());
+  } else {
+    parent_.createFilterChains(config, *address_, name_, *this, *listener_scope_,
+                               filter_factories_, tls_contexts_);
   }
 }
 
@@ -147,17 +184,29 @@ ListenerImpl::~ListenerImpl() {
   // vector for clarity.
   initialize_canceled_ = true;
   filter_factories_.clear();
+  shared_filter_chain_.reset();
 }
 
 bool ListenerImpl::createFilterChain(Network::Connection& connection) {
-  return Configuration::FilterChainUtility::buildFilterChain(connection, filter_factories_);
+  // Returning no filters makes the connection handler close the connection straight away.
+  if (parent_.server_.overloadManager().isActive(OverloadAction::StopAcceptingConnections)) {
+    overload_reject_.inc();
+    return false;
+  }
+
+  connection.setMemoryAccount(Buffer::MemoryAccountImpl::createChild(memory_account_));
+  return Configuration::FilterChainUtility::buildFilterChain(
+      connection, shared_filter_chain_ != nullptr ? shared_filter_chain_->filterFactories()
+                                                  : filter_factories_);
 }
 
 bool ListenerImpl::drainClose() const {
   // When a listener is draining, the "drain close" decision is the union of the per-listener drain
   // manager and the server wide drain manager. This allows individual listeners to be drained and
   // removed independently of a server-wide drain event (e.g., /healthcheck/fail or hot restart).
-  return local_drain_manager_->drainClose() || parent_.server_.drainManager().drainClose();
+  // Connections are also closed after their current request while the server is overloaded.
+  return local_drain_manager_->drainClose() || parent_.server_.drainManager().drainClose() ||
+         parent_.server_.overloadManager().isActive(OverloadAction::DisableHttpKeepAlive);
 }
 
 void ListenerImpl::debugLog(const std::string& message) {
@@ -187,9 +236,68 @@ Init::Manager& ListenerImpl::initManager() {
   }
 }
 
-void ListenerImpl::setSocket(const Network::ListenSocketSharedPtr& socket) {
-  ASSERT(!socket_);
-  socket_ = socket;
+void ListenerImpl::setSockets(const std::vector<Network::ListenSocketSharedPtr>& sockets) {
+  ASSERT(sockets_.empty());
+  ASSERT(!sockets.empty());
+  sockets_ = sockets;
+
+  // The options are set on sockets taken over from a draining listener or from the parent process
+  // as well, so that a listener whose options changed gets them.
+  for (const Network::ListenSocketSharedPtr& socket : sockets_) {
+    if (socket == nullptr) {
+      // The validation server does not create sockets.
+      continue;
+    }
+    if (tcp_fast_open_queue_length_ > 0 &&
+        !Network::Utility::setTcpFastOpen(socket->fd(), tcp_fast_open_queue_length_)) {
+      throw EnvoyException(
+          fmt::format("error adding listener '{}': cannot enable TCP Fast Open: {}",
+                      address_->asString(), strerror(errno)));
+    }
+    if (tcp_defer_accept_seconds_ > 0 &&
+        !Network::Utility::setTcpDeferAccept(socket->fd(), tcp_defer_accept_seconds_)) {
+      throw EnvoyException(
+          fmt::format("error adding listener '{}': cannot enable TCP_DEFER_ACCEPT: {}",
+                      address_->asString(), strerror(errno)));
+    }
+  }
+}
+
+Network::ListenSocket* ListenerImpl::workerSocket(uint32_t worker_index) {
+  if (!reuse_port_) {
+    return sockets_[0].get();
+  }
+  return worker_index < sockets_.size() ? sockets_[worker_index].get() : nullptr;
+}
+
+SharedFilterChain::SharedFilterChain(const envoy::api::v2::Listener& config,
+                                     ListenerManagerImpl& parent, const std::string& key,
+                                     const std::string& group,
+                                     const Network::Address::Instance& address,
+                                     Init::Manager& init_manager)
+    : parent_(parent), key_(key), global_scope_(parent_.server_.stats().createScope("")),
+      listener_scope_(parent_.server_.stats().createScope(fmt::format("listener.{}.", group))),
+      init_manager_(&init_manager) {
+  ENVOY_LOG(debug, "creating filter chains of filter chain group {}", group);
+  parent_.createFilterChains(config, address, fmt::format("filter_chain_group.{}", key_), *this,
+                             *listener_scope_, filter_factories_, tls_contexts_);
+  init_manager_ = nullptr;
+}
+
+SharedFilterChain::~SharedFilterChain() {
+  // A listener that is created for the same filter chains after the last listener that used these
+  // released them has already replaced the entry, so it is only removed if it has expired.
+  auto it = parent_.shared_filter_chains_.find(key_);
+  if (it != parent_.shared_filter_chains_.end() && it->second.expired()) {
+    parent_.shared_filter_chains_.erase(it);
+  }
+}
+
+bool SharedFilterChain::drainClose() const {
+  // See ListenerImpl::drainClose(). The listeners of the group drain on their own when they are
+  // removed or updated, which is not reflected here.
+  return parent_.server_.drainManager().drainClose() ||
+         parent_.server_.overloadManager().isActive(OverloadAction::DisableHttpKeepAlive);
 }
 
 ListenerManagerImpl::ListenerManagerImpl(Instance& server,
@@ -197,10 +305,78 @@ ListenerManagerImpl::ListenerManagerImpl(Instance& server,
                                          WorkerFactory& worker_factory)
     : server_(server), factory_(listener_factory), stats_(generateStats(server.stats())) {
   for (uint32_t i = 0; i < std::max(1U, server.options().concurrency()); i++) {
-    workers_.emplace_back(worker_factory.createWorker());
+    workers_.emplace_back(worker_factory.createWorker(i));
+  }
+}
+
+void ListenerManagerImpl::createFilterChains(
+    const envoy::api::v2::Listener& config, const Network::Address::Instance& address,
+    const std::string& context_name, Configuration::FactoryContext& context, Stats::Scope& scope,
+    std::vector<Configuration::NetworkFilterFactoryCb>& filter_factories,
+    std::vector<Ssl::ServerContextPtr>& tls_contexts) {
+  // Skip lookup and update of the SSL Context if there is only one filter chain
+  // and it doesn't enforce any SNI restrictions.
+  const bool skip_context_update =
+      (config.filter_chains().size() == 1 &&
+       config.filter_chains()[0].filter_chain_match().sni_domains().empty());
+
+  Optional<uint64_t> filters_hash;
+  uint32_t has_tls = 0;
+  uint32_t has_stk = 0;
+  for (const auto& filter_chain : config.filter_chains()) {
+    std::vector<std::string> sni_domains(filter_chain.filter_chain_match().sni_domains().begin(),
+                                         filter_chain.filter_chain_match().sni_domains().end());
+    if (!filters_hash.valid()) {
+      filters_hash.value(RepeatedPtrUtil::hash(filter_chain.filters()));
+      filter_factories = factory_.createFilterFactoryList(filter_chain.filters(), context);
+    } else if (filters_hash.value() != RepeatedPtrUtil::hash(filter_chain.filters())) {
+      throw EnvoyException(fmt::format("error adding listener '{}': use of different filter chains "
+                                       "is currently not supported",
+                                       address.asString()));
+    }
+    if (filter_chain.has_tls_context()) {
+      Ssl::ServerContextConfigImpl context_config(filter_chain.tls_context());
+      tls_contexts.emplace_back(server_.sslContextManager().createSslServerContext(
+          context_name, sni_domains, scope, context_config, skip_context_update));
+      has_tls++;
+      if (filter_chain.tls_context().has_session_ticket_keys()) {
+        has_stk++;
+      }
+    }
+  }
+
+  // TODO(PiotrSikora): allow filter chains with mixed use of Session Ticket Keys.
+  // This doesn't work right now, because BoringSSL uses "session context" (initial SSL_CTX that
+  // accepted connection, before SNI update) for session related stuff, including Session Ticket
+  // callback, which is going to be called iff it's set on the initial SSL_CTX, even if it's not
+  // set on the current SSL_CTX that doesn't have any Session Ticket Keys configured.
+  if (has_stk != 0 && has_stk != has_tls) {
+    throw EnvoyException(fmt::format("error adding listener '{}': filter chains with mixed use of "
+                                     "Session Ticket Keys are currently not supported",
+                                     address.asString()));
   }
 }
 
+SharedFilterChainSharedPtr ListenerManagerImpl::sharedFilterChain(
+    const envoy::api::v2::Listener& config, const std::string& group,
+    const Network::Address::Instance& address, Init::Manager& init_manager) {
+  const std::string key =
+      fmt::format("{}.{}", group, RepeatedPtrUtil::hash(config.filter_chains()));
+  auto it = shared_filter_chains_.find(key);
+  if (it != shared_filter_chains_.end()) {
+    SharedFilterChainSharedPtr filter_chain = it->second.lock();
+    if (filter_chain != nullptr) {
+      return filter_chain;
+    }
+  }
+
+  // The entry is only added once the filter chains have been created, as they throw on error.
+  SharedFilterChainSharedPtr filter_chain =
+      std::make_shared<SharedFilterChain>(config, *this, key, group, address, init_manager);
+  shared_filter_chains_[key] = filter_chain;
+  return filter_chain;
+}
+
 ListenerManagerStats ListenerManagerImpl::generateStats(Stats::Scope& scope) {
   const std::string final_prefix = "listener_manager.";
   return {ALL_LISTENER_MANAGER_STATS(POOL_COUNTER_PREFIX(scope, final_prefix),
@@ -250,17 +426,29 @@ bool ListenerManagerImpl::addOrUpdateListener(const envoy::api::v2::Listener& co
     throw EnvoyException(message);
   }
 
+  // Similarly, the new listener uses the sockets of the existing listener, so it can not change
+  // whether there is a socket per worker.
+  if ((existing_warming_listener != warming_listeners_.end() &&
+       (*existing_warming_listener)->reusePort() != new_listener->reusePort()) ||
+      (existing_active_listener != active_listeners_.end() &&
+       (*existing_active_listener)->reusePort() != new_listener->reusePort())) {
+    const std::string message = fmt::format(
+        "error updating listener: '{}' has a different reuse_port from existing listener", name);
+    ENVOY_LOG(warn, "{}", message);
+    throw EnvoyException(message);
+  }
+
   bool added = false;
   if (existing_warming_listener != warming_listeners_.end()) {
     // In this case we can just replace inline.
     ASSERT(workers_started_);
     new_listener->debugLog("update warming listener");
-    new_listener->setSocket((*existing_warming_listener)->getSocket());
+    new_listener->setSockets((*existing_warming_listener)->getSockets());
     *existing_warming_listener = std::move(new_listener);
   } else if (existing_active_listener != active_listeners_.end()) {
     // In this case we have no warming listener, so what we do depends on whether workers
     // have been started or not. Either way we get the socket from the existing listener.
-    new_listener->setSocket((*existing_active_listener)->getSocket());
+    new_listener->setSockets((*existing_active_listener)->getSockets());
     if (workers_started_) {
       new_listener->debugLog("add warming listener");
       warming_listeners_.emplace_back(std::move(new_listener));
@@ -289,20 +477,17 @@ bool ListenerManagerImpl::addOrUpdateListener(const envoy::api::v2::Listener& co
     // to see if there is a listener that has a socket bound to the address we are configured for.
     // This is an edge case, but may happen if a listener is removed and then added back with a same
     // or different name and intended to listen on the same address. This should work and not fail.
-    Network::ListenSocketSharedPtr draining_listener_socket;
+    // The sockets are only reused if the listeners agree on whether there is a socket per worker.
     auto existing_draining_listener = std::find_if(
         draining_listeners_.cbegin(), draining_listeners_.cend(),
         [&new_listener](const DrainingListener& listener) {
-          return *new_listener->address() == *listener.listener_->socket().localAddress();
+          return *new_listener->address() == *listener.listener_->socket().localAddress() &&
+                 new_listener->reusePort() == listener.listener_->reusePort();
         });
-    if (existing_draining_listener != draining_listeners_.cend()) {
-      draining_listener_socket = existing_draining_listener->listener_->getSocket();
-    }
 
-    new_listener->setSocket(
-        draining_listener_socket
-            ? draining_listener_socket
-            : factory_.createListenSocket(new_listener->address(), new_listener->bindToPort()));
+    new_listener->setSockets(existing_draining_listener != draining_listeners_.cend()
+                                 ? existing_draining_listener->listener_->getSockets()
+                                 : createListenSockets(*new_listener));
     if (workers_started_) {
       new_listener->debugLog("add warming listener");
       warming_listeners_.emplace_back(std::move(new_listener));
@@ -398,7 +583,28 @@ std::vector<std::reference_wrapper<Listener>> ListenerManagerImpl::listeners() {
   return ret;
 }
 
+std::vector<Network::ListenSocketSharedPtr>
+ListenerManagerImpl::createListenSockets(ListenerImpl& listener) {
+  if (!listener.reusePort()) {
+    return {factory_.createListenSocket(listener.address(), listener.bindToPort())};
+  }
+
+  // If the configured port is zero, the sockets after the first bind to the port the first one
+  // got, so that they all share it.
+  std::vector<Network::ListenSocketSharedPtr> sockets;
+  Network::Address::InstanceConstSharedPtr address = listener.address();
+  for (uint32_t i = 0; i < workers_.size(); i++) {
+    sockets.push_back(factory_.createReusePortListenSocket(address, i));
+    if (i == 0 && address->ip()->port() == 0) {
+      address = sockets[0]->localAddress();
+    }
+  }
+  return sockets;
+}
+
 void ListenerManagerImpl::addListenerToWorker(Worker& worker, ListenerImpl& listener) {
+  // The worker must have the thread local state of the listener before it accepts on it.
+  server_.threadLocal().flushBatch();
   worker.addListener(listener, [this, &listener](bool success) -> void {
     // The add listener completion runs on the worker thread. Post back to the main thread to
     // avoid locking.
@@ -454,6 +660,16 @@ uint64_t ListenerManagerImpl::numConnections() {
   return num_connections;
 }
 
+std::vector<WorkerLoad> ListenerManagerImpl::workerLoads() {
+  std::vector<WorkerLoad> loads;
+  loads.reserve(workers_.size());
+  for (const auto& worker : workers_) {
+    loads.push_back(worker->load());
+  }
+
+  return loads;
+}
+
 bool ListenerManagerImpl::removeListener(const std::string& name) {
   ENVOY_LOG(debug, "begin remove listener: name={}", name);
 
@@ -39,6 +39,9 @@ public:
   }
   Network::ListenSocketSharedPtr
   createListenSocket(Network::Address::InstanceConstSharedPtr address, bool bind_to_port) override;
+  Network::ListenSocketSharedPtr
+  createReusePortListenSocket(Network::Address::InstanceConstSharedPtr address,
+                              uint32_t worker_index) override;
   DrainManagerPtr createDrainManager(envoy::api::v2::Listener::DrainType drain_type) override;
   uint64_t nextListenerTag() override { return next_listener_tag_++; }
 
@@ -50,6 +53,9 @@ private:
 class ListenerImpl;
 typedef std::unique_ptr<ListenerImpl> ListenerImplPtr;
 
+class SharedFilterChain;
+typedef std::shared_ptr<SharedFilterChain> SharedFilterChainSharedPtr;
+
 /**
  * All listener manager stats. @see stats_macros.h
  */
@@ -82,10 +88,44 @@ public:
 
   void onListenerWarmed(ListenerImpl& listener);
 
+  /**
+   * Create the network filter factories and the TLS contexts of the filter chains of a listener.
+   * Throws on error.
+   * @param config supplies the configuration proto of the listener.
+   * @param address supplies the address of the listener, for error messages.
+   * @param context_name supplies the name the TLS contexts are registered under for SNI.
+   * @param context supplies the factory context the filter factories are created with.
+   * @param scope supplies the stats scope of the TLS contexts.
+   * @param filter_factories supplies the vector the filter factories are stored in.
+   * @param tls_contexts supplies the vector the TLS contexts are stored in.
+   */
+  void createFilterChains(const envoy::api::v2::Listener& config,
+                          const Network::Address::Instance& address,
+                          const std::string& context_name, Configuration::FactoryContext& context,
+                          Stats::Scope& scope,
+                          std::vector<Configuration::NetworkFilterFactoryCb>& filter_factories,
+                          std::vector<Ssl::ServerContextPtr>& tls_contexts);
+
+  /**
+   * Get the filter chains of a listener of a filter chain group, which are shared with the other
+   * listeners of the group that have identical filter chains. They are created if there are no
+   * such listeners. Throws on error.
+   * @param config supplies the configuration proto of the listener.
+   * @param group supplies the filter chain group of the listener.
+   * @param address supplies the address of the listener, for error messages.
+   * @param init_manager supplies the init manager of the listener, which the filter factories are
+   *        initialized by if they are created.
+   */
+  SharedFilterChainSharedPtr sharedFilterChain(const envoy::api::v2::Listener& config,
+                                               const std::string& group,
+                                               const Network::Address::Instance& address,
+                                               Init::Manager& init_manager);
+
   // Server::ListenerManager
   bool addOrUpdateListener(const envoy::api::v2::Listener& config, bool modifiable) override;
   std::vector<std::reference_wrapper<Listener>> listeners() override;
   uint64_t numConnections() override;
+  std::vector<WorkerLoad> workerLoads() override;
   bool removeListener(const std::string& listener_name) override;
   void startWorkers(GuardDog& guard_dog) override;
   void stopListeners() override;
@@ -95,6 +135,8 @@ public:
   ListenerComponentFactory& factory_;
 
 private:
+  friend class SharedFilterChain;
+
   typedef std::list<ListenerImplPtr> ListenerList;
 
   struct DrainingListener {
@@ -106,6 +148,12 @@ private:
   };
 
   void addListenerToWorker(Worker& worker, ListenerImpl& listener);
+
+  /**
+   * Create the sockets of a new listener: a socket per worker if the listener uses reuse_port,
+   * and a socket that all the workers share otherwise.
+   */
+  std::vector<Network::ListenSocketSharedPtr> createListenSockets(ListenerImpl& listener);
   static ListenerManagerStats generateStats(Stats::Scope& scope);
   static bool hasListenerWithAddress(const ListenerList& list,
                                      const Network::Address::Instance& address);
@@ -131,6 +179,10 @@ private:
    */
   ListenerList::iterator getListenerByName(ListenerList& listeners, const std::string& name);
 
+  // The filter chains shared by the listeners of filter chain groups, by group and hash of the
+  // filter chains. The entry of a SharedFilterChain is removed when the last listener that uses it
+  // is destroyed, so this is declared before the listener lists.
+  std::unordered_map<std::string, std::weak_ptr<SharedFilterChain>> shared_filter_chains_;
   // Active listeners are listeners that are currently accepting new connections on the workers.
   ListenerList active_listeners_;
   // Warming listeners are listeners that may need further initialization via the listener's init
@@ -147,6 +199,83 @@ private:
   ListenerManagerStats stats_;
 };
 
+/**
+ * The network filter factories and TLS contexts of the filter chains of the listeners of a filter
+ * chain group whose filter chains are identical, e.g. the listeners of the ports of many tenants.
+ * They are created once for the group rather than once per listener, which saves the memory and
+ * the time of creating them for each listener that is added by LDS.
+ *
+ * The filter factories are created with this as their factory context, so their stats are in the
+ * "listener.<group>." scope rather than in the scopes of the listeners, and they wait for the
+ * init manager of the listener that created them only. The connections of the listeners are
+ * drain closed when the server drains, but not while a listener of the group is drained on its
+ * own, since the other listeners of the group keep using the filter chains.
+ */
+class SharedFilterChain : public Configuration::FactoryContext,
+                          public Network::DrainDecision,
+                          Logger::Loggable<Logger::Id::config> {
+public:
+  /**
+   * @param config supplies the configuration proto of the listener that creates the filter chains.
+   * @param parent supplies the owning manager.
+   * @param key supplies the key of the filter chains in the manager.
+   * @param group supplies the filter chain group.
+   * @param address supplies the address of the listener, for error messages.
+   * @param init_manager supplies the init manager of the listener.
+   */
+  SharedFilterChain(const envoy::api::v2::Listener& config, ListenerManagerImpl& parent,
+                    const std::string& key, const std::string& group,
+                    const Network::Address::Instance& address, Init::Manager& init_manager);
+  ~SharedFilterChain();
+
+  const std::vector<Configuration::NetworkFilterFactoryCb>& filterFactories() const {
+    return filter_factories_;
+  }
+  Ssl::ServerContext* defaultSslContext() {
+    return tls_contexts_.empty() ? nullptr : tls_contexts_[0].get();
+  }
+
+  // Server::Configuration::FactoryContext
+  AccessLog::AccessLogManager& accessLogManager() override {
+    return parent_.server_.accessLogManager();
+  }
+  Upstream::ClusterManager& clusterManager() override { return parent_.server_.clusterManager(); }
+  Event::Dispatcher& dispatcher() override { return parent_.server_.dispatcher(); }
+  Network::DrainDecision& drainDecision() override { return *this; }
+  bool healthCheckFailed() override { return parent_.server_.healthCheckFailed(); }
+  Tracing::HttpTracer& httpTracer() override { return parent_.server_.httpTracer(); }
+  Init::Manager& initManager() override {
+    // The filter factories only register with the init manager while they are created.
+    ASSERT(init_manager_ != nullptr);
+    return *init_manager_;
+  }
+  const LocalInfo::LocalInfo& localInfo() override { return parent_.server_.localInfo(); }
+  OverloadManager& overloadManager() override { return parent_.server_.overloadManager(); }
+  Envoy::Runtime::RandomGenerator& random() override { return parent_.server_.random(); }
+  RateLimit::ClientPtr
+  rateLimitClient(const Optional<std::chrono::milliseconds>& timeout) override {
+    return parent_.server_.rateLimitClient(timeout);
+  }
+  Envoy::Runtime::Loader& runtime() override { return parent_.server_.runtime(); }
+  Stats::Scope& scope() override { return *global_scope_; }
+  Singleton::Manager& singletonManager() override { return parent_.server_.singletonManager(); }
+  ThreadLocal::Instance& threadLocal() override { return parent_.server_.threadLocal(); }
+  Admin& admin() override { return parent_.server_.admin(); }
+  Stats::Scope& listenerScope() override { return *listener_scope_; }
+
+  // Network::DrainDecision
+  bool drainClose() const override;
+
+private:
+  ListenerManagerImpl& parent_;
+  const std::string key_;
+  Stats::ScopePtr global_scope_;
+  Stats::ScopePtr listener_scope_;
+  Init::Manager* init_manager_;
+  std::vector<Ssl::ServerContextPtr> tls_contexts_;
+  std::vector<Configuration::NetworkFilterFactoryCb> filter_factories_;
+};
+
 // TODO(mattklein123): Consider getting rid of pre-worker start and post-worker start code by
 //                     initializing all listeners after workers are started.
 
@@ -190,22 +319,38 @@ public:
   }
 
   Network::Address::InstanceConstSharedPtr address() const { return address_; }
-  const Network::ListenSocketSharedPtr& getSocket() const { return socket_; }
+  const std::vector<Network::ListenSocketSharedPtr>& getSockets() const { return sockets_; }
   void debugLog(const std::string& message);
   void initialize();
   DrainManager& localDrainManager() const { return *local_drain_manager_; }
-  void setSocket(const Network::ListenSocketSharedPtr& socket);
+  void setSockets(const std::vector<Network::ListenSocketSharedPtr>& sockets);
+
+  /**
+   * @return bool whether each worker accepts connections on a SO_REUSEPORT socket of its own
+   *         rather than on a socket that all the workers share, which lets the kernel balance the
+   *         connections across the workers. The sockets are handed over to the workers with the
+   *         same indexes in a hot restart, so the new process takes over the sockets of the
+   *         workers it has, and the connections queued on those of the other workers of the parent
+   *         are reset when it exits.
+   */
+  bool reusePort() const { return reuse_port_; }
 
   // Server::Listener
   Network::FilterChainFactory& filterChainFactory() override { return *this; }
-  Network::ListenSocket& socket() override { return *socket_; }
+  Network::ListenSocket& socket() override { return *sockets_[0]; }
+  Network::ListenSocket* workerSocket(uint32_t worker_index) override;
+  Network::ConnectionBalancer* connectionBalancer() override { return connection_balancer_.get(); }
   bool bindToPort() override { return bind_to_port_; }
   Ssl::ServerContext* defaultSslContext() override {
+    if (shared_filter_chain_ != nullptr) {
+      return shared_filter_chain_->defaultSslContext();
+    }
     return tls_contexts_.empty() ? nullptr : tls_contexts_[0].get();
   }
   bool useProxyProto() override { return use_proxy_proto_; }
   bool useOriginalDst() override { return use_original_dst_; }
   uint32_t perConnectionBufferLimitBytes() override { return per_connection_buffer_limit_bytes_; }
+  uint32_t acceptBatchSize() override { return accept_batch_size_; }
   Stats::Scope& listenerScope() override { return *listener_scope_; }
   uint64_t listenerTag() override { return listener_tag_; }
   const std::string& name() const override { return name_; }
@@ -221,6 +366,7 @@ public:
   Tracing::HttpTracer& httpTracer() override { return parent_.server_.httpTracer(); }
   Init::Manager& initManager() override;
   const LocalInfo::LocalInfo& localInfo() override { return parent_.server_.localInfo(); }
+  OverloadManager& overloadManager() override { return parent_.server_.overloadManager(); }
   Envoy::Runtime::RandomGenerator& random() override { return parent_.server_.random(); }
   RateLimit::ClientPtr
   rateLimitClient(const Optional<std::chrono::milliseconds>& timeout) override {
@@ -241,14 +387,24 @@ public:
 private:
   ListenerManagerImpl& parent_;
   Network::Address::InstanceConstSharedPtr address_;
-  Network::ListenSocketSharedPtr socket_;
+  // A socket per worker if the listener uses reuse_port, and the socket of all the workers
+  // otherwise.
+  std::vector<Network::ListenSocketSharedPtr> sockets_;
   Stats::ScopePtr global_scope_;   // Stats with global named scope, but needed for LDS cleanup.
   Stats::ScopePtr listener_scope_; // Stats with listener named scope.
+  Stats::Counter& overload_reject_;
+  // Parent of the memory accounts of the listener's connections.
+  const Buffer::MemoryAccountSharedPtr memory_account_;
   std::vector<Ssl::ServerContextPtr> tls_contexts_;
   const bool bind_to_port_;
+  const bool reuse_port_;
+  Network::ConnectionBalancerPtr connection_balancer_;
   const bool use_proxy_proto_;
   const bool use_original_dst_;
   const uint32_t per_connection_buffer_limit_bytes_;
+  const uint32_t accept_batch_size_;
+  const uint32_t tcp_fast_open_queue_length_;
+  const uint32_t tcp_defer_accept_seconds_;
   const uint64_t listener_tag_;
   const std::string name_;
   const bool modifiable_;
@@ -257,6 +413,9 @@ private:
   InitManagerImpl dynamic_init_manager_;
   bool initialize_canceled_{};
   std::vector<Configuration::NetworkFilterFactoryCb> filter_factories_;
+  // The filter chains of the listener if it is in a filter chain group, in which case
+  // filter_factories_ and tls_contexts_ are empty.
+  SharedFilterChainSharedPtr shared_filter_chain_;
   DrainManagerPtr local_drain_manager_;
   bool saw_listener_create_failure_{};
 };
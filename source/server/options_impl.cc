@@ -5,7 +5,9 @@
 #include <iostream>
 #include <string>
 
+#include "common/buffer/slice_pool.h"
 #include "common/common/macros.h"
+#include "common/common/utility.h"
 #include "common/common/version.h"
 #include "common/stats/stats_impl.h"
 
@@ -73,6 +75,12 @@ OptionsImpl::OptionsImpl(int argc, char** argv, const HotRestartVersionCb& hot_r
   TCLAP::ValueArg<uint32_t> file_flush_interval_msec("", "file-flush-interval-msec",
                                                      "Interval for log flushing in msec", false,
                                                      10000, "uint32_t", cmd);
+  TCLAP::ValueArg<std::string> file_write_overflow_policy(
+      "", "file-write-overflow-policy",
+      "What a log write does when the buffer of the writing thread for the file is full: one of "
+      "'spill' (default; add it to a buffer that all threads share under a lock), 'block' (wait "
+      "for the flush thread) or 'drop' (drop and count it)",
+      false, "spill", "string", cmd);
   TCLAP::ValueArg<uint32_t> drain_time_s("", "drain-time-s", "Hot restart drain time in seconds",
                                          false, 600, "uint32_t", cmd);
   TCLAP::ValueArg<uint32_t> parent_shutdown_time_s("", "parent-shutdown-time-s",
@@ -92,6 +100,74 @@ OptionsImpl::OptionsImpl(int argc, char** argv, const HotRestartVersionCb& hot_r
                                              " the cluster name)",
                                              false, ENVOY_DEFAULT_MAX_OBJ_NAME_LENGTH, "uint64_t",
                                              cmd);
+  TCLAP::ValueArg<uint64_t> buffer_pool_max_retained_bytes(
+      "", "buffer-pool-max-retained-bytes",
+      "Maximum number of bytes of free buffer memory each worker thread keeps for reuse", false,
+      Buffer::SlicePool::DefaultMaxRetainedBytes, "uint64_t", cmd);
+  TCLAP::ValueArg<std::string> sharded_counters(
+      "", "sharded-counters",
+      "Comma separated names of counters that each worker thread increments in a shard of its "
+      "own, such as 'downstream_rq_total,upstream_rq_total'",
+      false, "", "string", cmd);
+  TCLAP::ValueArg<uint64_t> ssl_session_cache_size(
+      "", "ssl-session-cache-size",
+      "Number of TLS sessions of the session cache that the worker threads and hot restarts share, "
+      "or 0 for a session cache per TLS context",
+      false, 0, "uint64_t", cmd);
+  TCLAP::ValueArg<uint32_t> ssl_session_cache_timeout_s(
+      "", "ssl-session-cache-timeout-s", "Shared TLS session cache timeout in seconds", false, 300,
+      "uint32_t", cmd);
+  TCLAP::ValueArg<uint32_t> ssl_private_key_threads(
+      "", "ssl-private-key-threads",
+      "# of threads that sign and decrypt with the private keys of the listeners' TLS handshakes, "
+      "or 0 for the worker threads to do it",
+      false, 0, "uint32_t", cmd);
+  TCLAP::SwitchArg ssl_lazy_certificates(
+      "", "ssl-lazy-certificates",
+      "load the certificates of listener filter chains on their first TLS handshake", cmd, false);
+  TCLAP::SwitchArg worker_loop_stats(
+      "", "worker-loop-stats", "record histograms of the event loop iterations of the workers",
+      cmd, false);
+  TCLAP::ValueArg<uint32_t> worker_callback_budget_us(
+      "", "worker-callback-budget-us",
+      "Microseconds that a batch of posted callbacks or deferred deletions of a worker runs for "
+      "before the rest wait for the next event loop iteration, or 0 for no limit",
+      false, 0, "uint32_t", cmd);
+  TCLAP::SwitchArg worker_io_uring(
+      "", "worker-io-uring",
+      "experimental: poll the connections of the workers with io_uring if the kernel supports it",
+      cmd, false);
+  TCLAP::ValueArg<std::string> worker_cpu_set(
+      "", "worker-cpu-set",
+      "comma separated CPUs and CPU ranges, e.g. 0-3,8-11, to pin the workers to in order, and "
+      "to steer the connections of reuse_port listeners to",
+      false, "", "string", cmd);
+  TCLAP::SwitchArg worker_numa_local_memory(
+      "", "worker-numa-local-memory",
+      "allocate the memory of each worker from the NUMA node of the CPU it runs on", cmd, false);
+  TCLAP::SwitchArg dns_thread("", "dns-thread",
+                              "resolve the names of clusters on a dedicated thread rather than on "
+                              "the main thread",
+                              cmd, false);
+  TCLAP::ValueArg<uint32_t> dns_max_concurrent_queries(
+      "", "dns-max-concurrent-queries",
+      "# of DNS queries the DNS thread resolves at once before further queries wait, or 0 for no "
+      "limit",
+      false, 0, "uint32_t", cmd);
+  TCLAP::ValueArg<std::string> rate_limit_local_config(
+      "", "rate-limit-local-config",
+      "path to a JSON file with local rate limits that are checked before the rate limit service",
+      false, "", "string", cmd);
+  TCLAP::ValueArg<uint32_t> cpu_profile_window_s(
+      "", "cpu-profile-window-s",
+      "length in seconds of the windows of a continuous CPU profile kept for the admin "
+      "/cpuprofiler/windows endpoint, or 0 not to profile continuously",
+      false, 0, "uint32_t", cmd);
+  TCLAP::ValueArg<std::string> validated_config_cache(
+      "", "validated-config-cache",
+      "path to a file of the content hashes of configs that passed --mode validate, which it "
+      "records and which skip JSON schema validation when served",
+      false, "", "string", cmd);
 
   cmd.setExceptionHandling(false);
   try {
@@ -121,7 +197,8 @@ OptionsImpl::OptionsImpl(int argc, char** argv, const HotRestartVersionCb& hot_r
   if (hot_restart_version_option.getValue()) {
     std::cerr << hot_restart_version_cb(max_stats.getValue(),
                                         max_obj_name_len.getValue() +
-                                            Stats::RawStatData::maxStatSuffixLength());
+                                            Stats::RawStatData::maxStatSuffixLength(),
+                                        ssl_session_cache_size.getValue());
     throw NoServingException();
   }
 
@@ -142,6 +219,19 @@ OptionsImpl::OptionsImpl(int argc, char** argv, const HotRestartVersionCb& hot_r
     throw MalformedArgvException(message);
   }
 
+  if (file_write_overflow_policy.getValue() == "spill") {
+    file_write_overflow_policy_ = Filesystem::OverflowPolicy::Spill;
+  } else if (file_write_overflow_policy.getValue() == "block") {
+    file_write_overflow_policy_ = Filesystem::OverflowPolicy::Block;
+  } else if (file_write_overflow_policy.getValue() == "drop") {
+    file_write_overflow_policy_ = Filesystem::OverflowPolicy::Drop;
+  } else {
+    const std::string message = fmt::format("error: unknown file write overflow policy '{}'",
+                                            file_write_overflow_policy.getValue());
+    std::cerr << message << std::endl;
+    throw MalformedArgvException(message);
+  }
+
   if (local_address_ip_version.getValue() == "v4") {
     local_address_ip_version_ = Network::Address::IpVersion::v4;
   } else if (local_address_ip_version.getValue() == "v6") {
@@ -153,6 +243,27 @@ OptionsImpl::OptionsImpl(int argc, char** argv, const HotRestartVersionCb& hot_r
     throw MalformedArgvException(message);
   }
 
+  // Each CPU is a number or an inclusive range, up to the 1024 CPUs of the glibc cpu_set_t.
+  const std::vector<std::string> worker_cpus =
+      worker_cpu_set.getValue().empty()
+          ? std::vector<std::string>{}
+          : StringUtil::split(worker_cpu_set.getValue(), ",", true);
+  for (const std::string& cpus : worker_cpus) {
+    const std::vector<std::string> range = StringUtil::split(cpus, "-", true);
+    uint64_t first;
+    uint64_t last;
+    if (range.size() > 2 || !StringUtil::atoul(range[0].c_str(), first) ||
+        !StringUtil::atoul(range.back().c_str(), last) || first > last || last >= 1024) {
+      const std::string message =
+          fmt::format("error: invalid worker CPU set '{}'", worker_cpu_set.getValue());
+      std::cerr << message << std::endl;
+      throw MalformedArgvException(message);
+    }
+    for (uint64_t cpu = first; cpu <= last; cpu++) {
+      worker_cpu_set_.push_back(cpu);
+    }
+  }
+
   // For base ID, scale what the user inputs by 10 so that we have spread for domain sockets.
   base_id_ = base_id.getValue() * 10;
   concurrency_ = concurrency.getValue();
@@ -169,5 +280,20 @@ OptionsImpl::OptionsImpl(int argc, char** argv, const HotRestartVersionCb& hot_r
   parent_shutdown_time_ = std::chrono::seconds(parent_shutdown_time_s.getValue());
   max_stats_ = max_stats.getValue();
   max_obj_name_length_ = max_obj_name_len.getValue();
+  buffer_pool_max_retained_bytes_ = buffer_pool_max_retained_bytes.getValue();
+  sharded_counters_ = StringUtil::split(sharded_counters.getValue(), ",");
+  ssl_session_cache_size_ = ssl_session_cache_size.getValue();
+  ssl_session_cache_timeout_ = std::chrono::seconds(ssl_session_cache_timeout_s.getValue());
+  ssl_private_key_threads_ = ssl_private_key_threads.getValue();
+  ssl_lazy_certificates_ = ssl_lazy_certificates.getValue();
+  worker_loop_stats_ = worker_loop_stats.getValue();
+  worker_callback_budget_ = std::chrono::microseconds(worker_callback_budget_us.getValue());
+  worker_io_uring_ = worker_io_uring.getValue();
+  worker_numa_local_memory_ = worker_numa_local_memory.getValue();
+  dns_thread_ = dns_thread.getValue();
+  dns_max_concurrent_queries_ = dns_max_concurrent_queries.getValue();
+  rate_limit_local_config_path_ = rate_limit_local_config.getValue();
+  cpu_profile_window_ = std::chrono::seconds(cpu_profile_window_s.getValue());
+  validated_config_cache_path_ = validated_config_cache.getValue();
 }
 } // namespace Envoy
@@ -3,6 +3,7 @@
 #include <chrono>
 #include <cstdint>
 #include <string>
+#include <vector>
 
 #include "envoy/common/exception.h"
 #include "envoy/server/options.h"
@@ -15,7 +16,7 @@ namespace Envoy {
  */
 class OptionsImpl : public Server::Options {
 public:
-  typedef std::function<std::string(uint64_t, uint64_t)> HotRestartVersionCb;
+  typedef std::function<std::string(uint64_t, uint64_t, uint64_t)> HotRestartVersionCb;
 
   /**
    * @throw NoServingException if Envoy has already done everything specified by the argv (e.g.
@@ -41,11 +42,30 @@ public:
   uint64_t restartEpoch() override { return restart_epoch_; }
   Server::Mode mode() const override { return mode_; }
   std::chrono::milliseconds fileFlushIntervalMsec() override { return file_flush_interval_msec_; }
+  Filesystem::OverflowPolicy fileWriteOverflowPolicy() override {
+    return file_write_overflow_policy_;
+  }
   const std::string& serviceClusterName() override { return service_cluster_; }
   const std::string& serviceNodeName() override { return service_node_; }
   const std::string& serviceZone() override { return service_zone_; }
   uint64_t maxStats() override { return max_stats_; }
   uint64_t maxObjNameLength() override { return max_obj_name_length_; }
+  uint64_t bufferPoolMaxRetainedBytes() override { return buffer_pool_max_retained_bytes_; }
+  const std::vector<std::string>& shardedCounters() override { return sharded_counters_; }
+  uint64_t sslSessionCacheSize() override { return ssl_session_cache_size_; }
+  std::chrono::seconds sslSessionCacheTimeout() override { return ssl_session_cache_timeout_; }
+  uint32_t sslPrivateKeyThreads() override { return ssl_private_key_threads_; }
+  bool sslLazyCertificates() override { return ssl_lazy_certificates_; }
+  bool workerLoopStats() override { return worker_loop_stats_; }
+  std::chrono::microseconds workerCallbackBudget() override { return worker_callback_budget_; }
+  bool workerIoUring() override { return worker_io_uring_; }
+  const std::vector<uint32_t>& workerCpuSet() override { return worker_cpu_set_; }
+  bool workerNumaLocalMemory() override { return worker_numa_local_memory_; }
+  bool dnsThread() override { return dns_thread_; }
+  uint32_t dnsMaxConcurrentQueries() override { return dns_max_concurrent_queries_; }
+  const std::string& rateLimitLocalConfigPath() override { return rate_limit_local_config_path_; }
+  std::chrono::seconds cpuProfileWindow() override { return cpu_profile_window_; }
+  const std::string& validatedConfigCachePath() override { return validated_config_cache_path_; }
 
 private:
   uint64_t base_id_;
@@ -61,11 +81,28 @@ private:
   std::string service_node_;
   std::string service_zone_;
   std::chrono::milliseconds file_flush_interval_msec_;
+  Filesystem::OverflowPolicy file_write_overflow_policy_;
   std::chrono::seconds drain_time_;
   std::chrono::seconds parent_shutdown_time_;
   Server::Mode mode_;
   uint64_t max_stats_;
   uint64_t max_obj_name_length_;
+  uint64_t buffer_pool_max_retained_bytes_;
+  std::vector<std::string> sharded_counters_;
+  uint64_t ssl_session_cache_size_;
+  std::chrono::seconds ssl_session_cache_timeout_;
+  uint32_t ssl_private_key_threads_;
+  bool ssl_lazy_certificates_;
+  bool worker_loop_stats_;
+  std::chrono::microseconds worker_callback_budget_;
+  bool worker_io_uring_;
+  std::vector<uint32_t> worker_cpu_set_;
+  bool worker_numa_local_memory_;
+  bool dns_thread_;
+  uint32_t dns_max_concurrent_queries_;
+  std::string rate_limit_local_config_path_;
+  std::chrono::seconds cpu_profile_window_;
+  std::string validated_config_cache_path_;
 };
 
 /**
@@ -0,0 +1,68 @@
+#include "server/overload_manager_impl.h"
+
+#include <algorithm>
+#include <chrono>
+
+#include "common/buffer/memory_account_impl.h"
+#include "common/common/assert.h"
+#include "common/common/enum_to_int.h"
+#include "common/memory/stats.h"
+
+namespace Envoy {
+namespace Server {
+
+constexpr size_t OverloadManagerImpl::NumActions;
+
+OverloadManagerImpl::OverloadManagerImpl(Event::Dispatcher& dispatcher, Stats::Scope& scope,
+                                         Runtime::Loader& runtime)
+    : dispatcher_(dispatcher),
+      stats_{ALL_OVERLOAD_MANAGER_STATS(POOL_GAUGE_PREFIX(scope, "overload."))},
+      runtime_(runtime) {}
+
+void OverloadManagerImpl::start() {
+  ASSERT(!refresh_timer_);
+  refresh_timer_ = dispatcher_.createTimer([this]() -> void {
+    refresh();
+    refresh_timer_->enableTimer(std::chrono::milliseconds(
+        runtime_.snapshot().getInteger("overload.refresh_interval_ms", 1000)));
+  });
+  refresh_timer_->enableTimer(std::chrono::milliseconds(0));
+}
+
+bool OverloadManagerImpl::isActive(OverloadAction action) const {
+  return active_[enumToInt(action)].load(std::memory_order_relaxed);
+}
+
+void OverloadManagerImpl::refresh() {
+  const uint64_t usage =
+      std::max(Memory::Stats::totalCurrentlyAllocated(),
+               Buffer::MemoryAccountImpl::processAccount()->balance());
+  stats_.memory_usage_bytes_.set(usage);
+
+  const Runtime::Snapshot& snapshot = runtime_.snapshot();
+  const uint64_t max_heap_bytes = snapshot.getInteger("overload.max_heap_bytes", 0);
+  const auto reached = [&](const std::string& key, uint64_t default_percent) -> bool {
+    return max_heap_bytes > 0 &&
+           usage * 100 >= max_heap_bytes * snapshot.getInteger(key, default_percent);
+  };
+
+  setActive(OverloadAction::DisableHttpKeepAlive,
+            reached("overload.disable_http_keepalive_percent", 80),
+            stats_.disable_http_keepalive_active_);
+  setActive(OverloadAction::StopAcceptingConnections,
+            reached("overload.stop_accepting_connections_percent", 90),
+            stats_.stop_accepting_connections_active_);
+  setActive(OverloadAction::StopAcceptingRequests,
+            reached("overload.stop_accepting_requests_percent", 95),
+            stats_.stop_accepting_requests_active_);
+}
+
+void OverloadManagerImpl::setActive(OverloadAction action, bool active, Stats::Gauge& gauge) {
+  if (active_[enumToInt(action)].exchange(active) != active) {
+    ENVOY_LOG(warn, "overload action {} {}", enumToInt(action), active ? "activated" : "cleared");
+  }
+  gauge.set(active ? 1 : 0);
+}
+
+} // namespace Server
+} // namespace Envoy
@@ -0,0 +1,68 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+
+#include "envoy/event/dispatcher.h"
+#include "envoy/event/timer.h"
+#include "envoy/runtime/runtime.h"
+#include "envoy/server/overload_manager.h"
+#include "envoy/stats/stats_macros.h"
+
+#include "common/common/logger.h"
+
+namespace Envoy {
+namespace Server {
+
+/**
+ * All overload manager stats. @see stats_macros.h
+ */
+// clang-format off
+#define ALL_OVERLOAD_MANAGER_STATS(GAUGE)                                                          \
+  GAUGE(memory_usage_bytes)                                                                        \
+  GAUGE(disable_http_keepalive_active)                                                             \
+  GAUGE(stop_accepting_connections_active)                                                         \
+  GAUGE(stop_accepting_requests_active)
+// clang-format on
+
+/**
+ * Struct definition for all overload manager stats. @see stats_macros.h
+ */
+struct OverloadManagerStats {
+  ALL_OVERLOAD_MANAGER_STATS(GENERATE_GAUGE_STRUCT)
+};
+
+/**
+ * Overload manager driven by runtime. Memory usage is the heap in use as reported by the
+ * allocator, or, when the allocator does not report it, the bytes held by accounted buffers (see
+ * Buffer::MemoryAccountImpl::processAccount()). The limit is overload.max_heap_bytes; zero, the
+ * default, disables the manager. Each action becomes active once usage reaches its percentage of
+ * the limit, given by overload.<action>_percent.
+ */
+class OverloadManagerImpl : Logger::Loggable<Logger::Id::main>, public OverloadManager {
+public:
+  OverloadManagerImpl(Event::Dispatcher& dispatcher, Stats::Scope& scope, Runtime::Loader& runtime);
+
+  // Server::OverloadManager
+  void start() override;
+  bool isActive(OverloadAction action) const override;
+
+  /**
+   * Sample memory usage and update the actions. Called periodically once started.
+   */
+  void refresh();
+
+private:
+  static constexpr size_t NumActions = 3;
+
+  void setActive(OverloadAction action, bool active, Stats::Gauge& gauge);
+
+  Event::Dispatcher& dispatcher_;
+  OverloadManagerStats stats_;
+  Runtime::Loader& runtime_;
+  Event::TimerPtr refresh_timer_;
+  std::atomic<bool> active_[NumActions]{};
+};
+
+} // namespace Server
+} // namespace Envoy
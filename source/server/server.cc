@@ -3,9 +3,12 @@
 #include <signal.h>
 
 #include <cstdint>
+#include <fstream>
 #include <functional>
 #include <string>
+#include <unordered_map>
 #include <unordered_set>
+#include <vector>
 
 #include "envoy/event/dispatcher.h"
 #include "envoy/event/signal.h"
@@ -16,10 +19,15 @@
 
 #include "common/api/api_impl.h"
 #include "common/api/os_sys_calls_impl.h"
+#include "common/buffer/slice_pool.h"
+#include "common/common/hash.h"
+#include "common/common/hex.h"
 #include "common/common/utility.h"
 #include "common/common/version.h"
 #include "common/config/bootstrap_json.h"
 #include "common/config/utility.h"
+#include "common/filesystem/filesystem_impl.h"
+#include "common/json/json_loader.h"
 #include "common/local_info/local_info_impl.h"
 #include "common/memory/stats.h"
 #include "common/network/address_impl.h"
@@ -47,10 +55,14 @@ InstanceImpl::InstanceImpl(Options& options, Network::Address::InstanceConstShar
                            ComponentFactory& component_factory, ThreadLocal::Instance& tls)
     : options_(options), restarter_(restarter), start_time_(time(nullptr)),
       original_start_time_(start_time_), stats_store_(store), thread_local_(tls),
-      api_(new Api::Impl(options.fileFlushIntervalMsec())), dispatcher_(api_->allocateDispatcher()),
+      api_(new Api::Impl(options.fileFlushIntervalMsec(), options.fileWriteOverflowPolicy())),
+      dispatcher_(api_->allocateDispatcher()),
       singleton_manager_(new Singleton::ManagerImpl()),
       handler_(new ConnectionHandlerImpl(ENVOY_LOGGER(), *dispatcher_)),
-      listener_component_factory_(*this), worker_factory_(thread_local_, *api_, hooks),
+      listener_component_factory_(*this),
+      worker_factory_(thread_local_, *api_, hooks, store, options.workerLoopStats(),
+                      options.workerCallbackBudget(), options.workerIoUring(),
+                      options.workerCpuSet(), options.workerNumaLocalMemory()),
       dns_resolver_(dispatcher_->createDnsResolver({})),
       access_log_manager_(*api_, *dispatcher_, access_log_lock, store) {
 
@@ -83,6 +95,10 @@ InstanceImpl::InstanceImpl(Options& options, Network::Address::InstanceConstShar
 }
 
 InstanceImpl::~InstanceImpl() {
+  // The DNS thread is watched by the GuardDog.
+  if (threaded_dns_resolver_) {
+    threaded_dns_resolver_->shutdown();
+  }
   restarter_.shutdown();
 
   // Stop logging to file before all the AccessLogManager and its dependencies are
@@ -105,15 +121,16 @@ void InstanceImpl::failHealthcheck(bool fail) {
   server_stats_->live_.set(!fail);
 }
 
-void InstanceUtil::flushCountersAndGaugesToSinks(const std::list<Stats::SinkPtr>& sinks,
-                                                 Stats::Store& store) {
+void InstanceUtil::flushMetricsToSinks(const std::list<Stats::SinkPtr>& sinks,
+                                       Stats::Store& store) {
   for (const auto& sink : sinks) {
     sink->beginFlush();
   }
 
   for (const Stats::CounterSharedPtr& counter : store.counters()) {
+    // Sinks only report the deltas of counters, so counters that did not change are skipped.
     uint64_t delta = counter->latch();
-    if (counter->used()) {
+    if (delta > 0) {
       for (const auto& sink : sinks) {
         sink->flushCounter(*counter, delta);
       }
@@ -128,11 +145,54 @@ void InstanceUtil::flushCountersAndGaugesToSinks(const std::list<Stats::SinkPtr>
     }
   }
 
+  for (const Stats::ParentHistogramSharedPtr& histogram : store.histograms()) {
+    histogram->merge();
+    if (histogram->used()) {
+      for (const auto& sink : sinks) {
+        sink->flushHistogram(*histogram);
+      }
+    }
+  }
+
   for (const auto& sink : sinks) {
     sink->endFlush();
   }
 }
 
+void InstanceUtil::updateStatsStoreStats(const Stats::Store& store, StatsStoreStats& stats,
+                                         uint64_t& num_stats_created) {
+  uint64_t num_scopes = 0;
+  uint64_t num_stats = 0;
+  uint64_t num_overflow_stats = 0;
+  uint64_t name_bytes = 0;
+  for (const Stats::ScopeStatsInfo& scope : store.scopes()) {
+    num_scopes++;
+    num_stats += scope.num_stats_;
+    num_overflow_stats += scope.num_overflow_stats_;
+    name_bytes += scope.name_bytes_;
+  }
+  stats.num_scopes_.set(num_scopes);
+  stats.num_stats_.set(num_stats);
+  stats.num_overflow_stats_.set(num_overflow_stats);
+  stats.name_bytes_.set(name_bytes);
+
+  // The counter may also hold the stats created by the parent process, so only the stats created
+  // since the last update are added to it.
+  const uint64_t created = store.numStatsCreated();
+  stats.created_.add(created - num_stats_created);
+  num_stats_created = created;
+}
+
+void InstanceUtil::updateObjectPoolStats(const ObjectPoolStats& pool_stats,
+                                         ServerObjectPoolStats& stats,
+                                         ObjectPoolStats& last_pool_stats) {
+  stats.allocated_.add(pool_stats.allocated_ - last_pool_stats.allocated_);
+  stats.reused_.add(pool_stats.reused_ - last_pool_stats.reused_);
+  stats.retained_bytes_.set(pool_stats.retained_bytes_);
+  stats.retained_objects_.set(pool_stats.retained_objects_);
+  last_pool_stats = pool_stats;
+}
+
 void InstanceImpl::flushStats() {
   ENVOY_LOG(debug, "flushing stats");
   HotRestart::GetParentStatsInfo info;
@@ -141,12 +201,17 @@ void InstanceImpl::flushStats() {
   server_stats_->memory_allocated_.set(Memory::Stats::totalCurrentlyAllocated() +
                                        info.memory_allocated_);
   server_stats_->memory_heap_size_.set(Memory::Stats::totalCurrentlyReserved());
+  server_stats_->memory_buffer_pool_retained_.set(Memory::Stats::totalBufferPoolRetained());
   server_stats_->parent_connections_.set(info.num_connections_);
   server_stats_->total_connections_.set(numConnections() + info.num_connections_);
   server_stats_->days_until_first_cert_expiring_.set(
       sslContextManager().daysUntilFirstCertExpires());
+  InstanceUtil::updateStatsStoreStats(stats_store_, *stats_store_stats_, num_stats_created_);
+  InstanceUtil::updateObjectPoolStats(ObjectPool::stats(), *object_pool_stats_,
+                                      last_object_pool_stats_);
 
-  InstanceUtil::flushCountersAndGaugesToSinks(config_->statsSinks(), stats_store_);
+  InstanceUtil::flushMetricsToSinks(config_->statsSinks(), stats_store_);
+  stats_store_.onStatsFlushed();
   stat_flush_timer_->enableTimer(config_->statsFlushInterval());
 }
 
@@ -178,23 +243,105 @@ void InstanceUtil::loadBootstrapConfig(envoy::api::v2::Bootstrap& bootstrap,
   }
 }
 
+std::string InstanceUtil::configHash(const std::string& config_path) {
+  return Hex::uint64ToHex(HashUtil::xxHash64(Filesystem::fileReadToEnd(config_path)));
+}
+
+bool InstanceUtil::configValidated(const std::string& cache_path,
+                                   const std::string& config_path) {
+  if (!Filesystem::fileExists(cache_path)) {
+    return false;
+  }
+  const std::string hash = configHash(config_path);
+  for (const std::string& line : StringUtil::split(Filesystem::fileReadToEnd(cache_path), '\n')) {
+    if (line == hash) {
+      return true;
+    }
+  }
+  return false;
+}
+
+void InstanceUtil::recordValidatedConfig(const std::string& cache_path,
+                                         const std::string& config_path) {
+  if (configValidated(cache_path, config_path)) {
+    return;
+  }
+  std::ofstream cache(cache_path, std::ios_base::app);
+  cache << configHash(config_path) << "\n";
+  if (!cache) {
+    throw EnvoyException(fmt::format("unable to write validated config cache '{}'", cache_path));
+  }
+}
+
+const std::string InstanceUtil::UNHEALTHY_HOSTS_STATE = "upstream.unhealthy_hosts";
+
+std::string InstanceUtil::exportUnhealthyHosts(Upstream::ClusterManager& cm) {
+  std::string state;
+  for (const auto& cluster : cm.clusters()) {
+    for (const auto& host_set : cluster.second.get().prioritySet().hostSetsPerPriority()) {
+      for (const Upstream::HostSharedPtr& host : host_set->hosts()) {
+        if (host->healthFlagGet(Upstream::Host::HealthFlag::FAILED_ACTIVE_HC)) {
+          state += fmt::format("{}\t{}\n", cluster.first, host->address()->asString());
+        }
+      }
+    }
+  }
+  return state;
+}
+
+void InstanceUtil::inheritUnhealthyHosts(Upstream::ClusterManager& cm, const std::string& state) {
+  std::unordered_map<std::string, std::vector<std::string>> addresses_by_cluster;
+  for (const std::string& line : StringUtil::split(state, '\n')) {
+    const size_t separator = line.find('\t');
+    if (separator != std::string::npos) {
+      addresses_by_cluster[line.substr(0, separator)].push_back(line.substr(separator + 1));
+    }
+  }
+  for (const auto& addresses : addresses_by_cluster) {
+    cm.inheritUnhealthyHosts(addresses.first, addresses.second);
+  }
+}
+
 void InstanceImpl::initialize(Options& options,
                               Network::Address::InstanceConstSharedPtr local_address,
                               ComponentFactory& component_factory) {
   ENVOY_LOG(info, "initializing epoch {} (hot restart version={})", options.restartEpoch(),
             restarter_.version());
 
+  // A config already validated by --mode validate is not schema checked again while it is loaded.
+  // Config delivered later by the management servers is always validated.
+  std::unique_ptr<Json::SkipSchemaValidation> skip_schema_validation;
+  if (!options.validatedConfigCachePath().empty() &&
+      InstanceUtil::configValidated(options.validatedConfigCachePath(), options.configPath())) {
+    ENVOY_LOG(info, "config '{}' found in validated config cache, skipping schema validation",
+              options.configPath());
+    skip_schema_validation.reset(new Json::SkipSchemaValidation());
+  }
+
   // Handle configuration that needs to take place prior to the main configuration load.
   envoy::api::v2::Bootstrap bootstrap;
   InstanceUtil::loadBootstrapConfig(bootstrap, options.configPath(), options.v2ConfigOnly());
+  Buffer::SlicePool::setMaxRetainedBytes(options.bufferPoolMaxRetainedBytes());
 
   // Needs to happen as early as possible in the instantiation to preempt the objects that require
   // stats.
   tag_extractors_ = Config::Utility::createTagExtractors(bootstrap);
   stats_store_.setTagExtractors(tag_extractors_);
+  stats_store_.setShardedCounters(options.shardedCounters());
 
   server_stats_.reset(
       new ServerStats{ALL_SERVER_STATS(POOL_GAUGE_PREFIX(stats_store_, "server."))});
+  stats_store_stats_.reset(new StatsStoreStats{ALL_STATS_STORE_STATS(
+      POOL_COUNTER_PREFIX(stats_store_, "stats."), POOL_GAUGE_PREFIX(stats_store_, "stats."))});
+  object_pool_stats_.reset(new ServerObjectPoolStats{
+      ALL_OBJECT_POOL_STATS(POOL_COUNTER_PREFIX(stats_store_, "server.object_pool."),
+                            POOL_GAUGE_PREFIX(stats_store_, "server.object_pool."))});
+  if (options_.dnsThread()) {
+    threaded_dns_resolver_ = std::make_shared<Network::ThreadedDnsResolverImpl>(
+        *dispatcher_, options_.dnsMaxConcurrentQueries());
+    dns_resolver_ = threaded_dns_resolver_;
+  }
+  dns_resolver_->initializeStats(stats_store_, "dns.");
 
   failHealthcheck(false);
 
@@ -242,8 +389,31 @@ void InstanceImpl::initialize(Options& options,
   // load things may grab a reference to the loader for later use.
   runtime_loader_ = component_factory.createRuntime(*this, initial_config);
 
-  // Once we have runtime we can initialize the SSL context manager.
-  ssl_context_manager_.reset(new Ssl::ContextManagerImpl(*runtime_loader_));
+  // Memory usage is sampled on the main thread. Sampling starts once the main loop runs.
+  overload_manager_.reset(new OverloadManagerImpl(*dispatcher_, stats_store_, *runtime_loader_));
+  overload_manager_->start();
+
+  // Once we have runtime we can initialize the SSL context manager. The shared session cache is
+  // kept in the shared memory of hot restarts if there is any, or else on the heap.
+  if (options_.sslSessionCacheSize() > 0) {
+    Ssl::SessionCacheMemory* session_cache_memory = restarter_.sessionCacheMemory();
+    if (session_cache_memory == nullptr) {
+      heap_session_cache_memory_.reset(new Ssl::HeapSessionCacheMemory(
+          Ssl::SessionCacheImpl::NUM_SHARDS,
+          Ssl::SessionCacheImpl::slotsPerShard(options_.sslSessionCacheSize())));
+      session_cache_memory = heap_session_cache_memory_.get();
+    }
+    ssl_session_cache_.reset(new Ssl::SessionCacheImpl(
+        *session_cache_memory, options_.sslSessionCacheTimeout(), stats_store_,
+        ProdMonotonicTimeSource::instance_));
+  }
+  if (options_.sslPrivateKeyThreads() > 0) {
+    ssl_private_key_method_provider_.reset(
+        new Ssl::ThreadPoolPrivateKeyMethodProvider(options_.sslPrivateKeyThreads()));
+  }
+  ssl_context_manager_.reset(new Ssl::ContextManagerImpl(
+      *runtime_loader_, ssl_session_cache_.get(), ssl_private_key_method_provider_.get(),
+      options_.sslLazyCertificates()));
 
   cluster_manager_factory_.reset(new Upstream::ProdClusterManagerFactory(
       runtime(), stats(), threadLocal(), random(), dnsResolver(), sslContextManager(), dispatcher(),
@@ -254,6 +424,15 @@ void InstanceImpl::initialize(Options& options,
   Configuration::MainImpl* main_config = new Configuration::MainImpl();
   config_.reset(main_config);
   main_config->initialize(bootstrap, *this, *cluster_manager_factory_);
+  skip_schema_validation.reset();
+
+  // Carry health checking state across a hot restart, so that hosts failing in the parent do not
+  // become healthy in the child after a single successful check.
+  InstanceUtil::inheritUnhealthyHosts(
+      clusterManager(), restarter_.getParentState(InstanceUtil::UNHEALTHY_HOSTS_STATE));
+  restarter_.addStateExporter(InstanceUtil::UNHEALTHY_HOSTS_STATE, [this]() -> std::string {
+    return InstanceUtil::exportUnhealthyHosts(clusterManager());
+  });
 
   for (Stats::SinkPtr& sink : main_config->statsSinks()) {
     stats_store_.addSink(*sink);
@@ -268,6 +447,16 @@ void InstanceImpl::initialize(Options& options,
   // started and before our own run() loop runs.
   guard_dog_.reset(
       new Server::GuardDogImpl(stats_store_, *config_, ProdMonotonicTimeSource::instance_));
+  admin_->addHandler("/stalls", "print stack samples of the threads the watchdog found stalled",
+                     [this](const std::string&, Http::HeaderMap&,
+                            Buffer::Instance& response) -> Http::Code {
+                       response.add(guard_dog_->stallSamples());
+                       return Http::Code::OK;
+                     },
+                     false, false);
+  if (threaded_dns_resolver_) {
+    threaded_dns_resolver_->start(*guard_dog_);
+  }
 }
 
 void InstanceImpl::startWorkers() {
@@ -18,12 +18,18 @@
 #include "envoy/tracing/http_tracer.h"
 
 #include "common/access_log/access_log_manager_impl.h"
+#include "common/common/object_pool.h"
+#include "common/network/threaded_dns_impl.h"
 #include "common/runtime/runtime_impl.h"
 #include "common/ssl/context_manager_impl.h"
+#include "common/ssl/private_key_method_provider_impl.h"
+#include "common/ssl/session_cache_impl.h"
 
+#include "server/guarddog_impl.h"
 #include "server/http/admin.h"
 #include "server/init_manager_impl.h"
 #include "server/listener_manager_impl.h"
+#include "server/overload_manager_impl.h"
 #include "server/test_hooks.h"
 #include "server/worker_impl.h"
 
@@ -38,6 +44,7 @@ namespace Server {
   GAUGE(uptime)                                                                                    \
   GAUGE(memory_allocated)                                                                          \
   GAUGE(memory_heap_size)                                                                          \
+  GAUGE(memory_buffer_pool_retained)                                                               \
   GAUGE(live)                                                                                      \
   GAUGE(parent_connections)                                                                        \
   GAUGE(total_connections)                                                                         \
@@ -49,6 +56,38 @@ struct ServerStats {
   ALL_SERVER_STATS(GENERATE_GAUGE_STRUCT)
 };
 
+/**
+ * Stats of the stats store of the server, updated when the stats are flushed. @see stats_macros.h
+ */
+// clang-format off
+#define ALL_STATS_STORE_STATS(COUNTER, GAUGE)                                                      \
+  COUNTER(created)                                                                                 \
+  GAUGE(name_bytes)                                                                                \
+  GAUGE(num_overflow_stats)                                                                        \
+  GAUGE(num_scopes)                                                                                \
+  GAUGE(num_stats)
+// clang-format on
+
+struct StatsStoreStats {
+  ALL_STATS_STORE_STATS(GENERATE_COUNTER_STRUCT, GENERATE_GAUGE_STRUCT)
+};
+
+/**
+ * Stats of the object pools of all threads, updated when the stats are flushed. The reuse rate is
+ * reused / (reused + allocated). @see stats_macros.h
+ */
+// clang-format off
+#define ALL_OBJECT_POOL_STATS(COUNTER, GAUGE)                                                      \
+  COUNTER(allocated)                                                                               \
+  COUNTER(reused)                                                                                  \
+  GAUGE(retained_bytes)                                                                            \
+  GAUGE(retained_objects)
+// clang-format on
+
+struct ServerObjectPoolStats {
+  ALL_OBJECT_POOL_STATS(GENERATE_COUNTER_STRUCT, GENERATE_GAUGE_STRUCT)
+};
+
 /**
  * Interface for creating service components during boot.
  */
@@ -79,13 +118,33 @@ public:
   static Runtime::LoaderPtr createRuntime(Instance& server, Server::Configuration::Initial& config);
 
   /**
-   * Helper for flushing counters and gauges to sinks. This takes care of calling beginFlush(),
-   * latching of counters and flushing, flushing of gauges, and calling endFlush(), on each sink.
+   * Helper for flushing counters, gauges and histograms to sinks. This takes care of calling
+   * beginFlush(), latching of counters and flushing of those that changed, flushing of gauges,
+   * merging of histograms and flushing, and calling endFlush(), on each sink.
    * @param sinks supplies the list of sinks.
    * @param store supplies the store to flush.
    */
-  static void flushCountersAndGaugesToSinks(const std::list<Stats::SinkPtr>& sinks,
-                                            Stats::Store& store);
+  static void flushMetricsToSinks(const std::list<Stats::SinkPtr>& sinks, Stats::Store& store);
+
+  /**
+   * Update the stats of a stats store from the accounting of its scopes.
+   * @param store supplies the store.
+   * @param stats supplies the stats to update.
+   * @param num_stats_created supplies the number of stats the store had created when the stats
+   *        were last updated, which is set to the current one.
+   */
+  static void updateStatsStoreStats(const Stats::Store& store, StatsStoreStats& stats,
+                                    uint64_t& num_stats_created);
+
+  /**
+   * Update the object pool stats from the occupancy of the pools.
+   * @param pool_stats supplies the current occupancy of the pools.
+   * @param stats supplies the stats to update.
+   * @param last_pool_stats supplies the occupancy when the stats were last updated, which is set to
+   *        the current one.
+   */
+  static void updateObjectPoolStats(const ObjectPoolStats& pool_stats,
+                                    ServerObjectPoolStats& stats, ObjectPoolStats& last_pool_stats);
 
   /**
    * Load a bootstrap config from either v1 or v2 and perform validation.
@@ -95,6 +154,48 @@ public:
    */
   static void loadBootstrapConfig(envoy::api::v2::Bootstrap& bootstrap,
                                   const std::string& config_path, bool v2_only);
+
+  /**
+   * @param config_path supplies the config path.
+   * @return std::string the hex content hash of the config file, as kept in the validated config
+   *         cache.
+   */
+  static std::string configHash(const std::string& config_path);
+
+  /**
+   * @param cache_path supplies the validated config cache, a file of one config hash per line.
+   * @param config_path supplies the config path.
+   * @return bool whether the current content of the config file was recorded in the cache by a
+   *         successful --mode validate run. A missing cache file holds no configs.
+   */
+  static bool configValidated(const std::string& cache_path, const std::string& config_path);
+
+  /**
+   * Record the current content of a config file as validated in the validated config cache.
+   * @param cache_path supplies the validated config cache.
+   * @param config_path supplies the config path.
+   */
+  static void recordValidatedConfig(const std::string& cache_path, const std::string& config_path);
+
+  /**
+   * Serialize the hosts that fail active health checking, for a hot restarted child to inherit.
+   * @param cm supplies the cluster manager.
+   * @return std::string one "<cluster>\t<address>" line per host.
+   */
+  static std::string exportUnhealthyHosts(Upstream::ClusterManager& cm);
+
+  /**
+   * Hand the unhealthy hosts exported by exportUnhealthyHosts() in the parent process over to the
+   * health checkers of the clusters of the same name. Other lines are ignored.
+   * @param cm supplies the cluster manager.
+   * @param state supplies the exported hosts.
+   */
+  static void inheritUnhealthyHosts(Upstream::ClusterManager& cm, const std::string& state);
+
+  /**
+   * Name of the hot restart state section exportUnhealthyHosts() produces.
+   */
+  static const std::string UNHEALTHY_HOSTS_STATE;
 };
 
 /**
@@ -157,6 +258,7 @@ public:
   Singleton::Manager& singletonManager() override { return *singleton_manager_; }
   bool healthCheckFailed() override;
   Options& options() override { return options_; }
+  OverloadManager& overloadManager() override { return *overload_manager_; }
   time_t startTimeCurrentEpoch() override { return start_time_; }
   time_t startTimeFirstEpoch() override { return original_start_time_; }
   Stats::Store& stats() override { return stats_store_; }
@@ -179,6 +281,10 @@ private:
   Stats::StoreRoot& stats_store_;
   std::vector<Stats::TagExtractorPtr> tag_extractors_;
   std::unique_ptr<ServerStats> server_stats_;
+  std::unique_ptr<StatsStoreStats> stats_store_stats_;
+  uint64_t num_stats_created_{};
+  std::unique_ptr<ServerObjectPoolStats> object_pool_stats_;
+  ObjectPoolStats last_object_pool_stats_;
   ThreadLocal::Instance& thread_local_;
   Api::ApiPtr api_;
   Event::DispatcherPtr dispatcher_;
@@ -187,6 +293,10 @@ private:
   Network::ConnectionHandlerPtr handler_;
   Runtime::RandomGeneratorImpl random_generator_;
   Runtime::LoaderPtr runtime_loader_;
+  std::unique_ptr<OverloadManagerImpl> overload_manager_;
+  Ssl::SessionCacheMemoryPtr heap_session_cache_memory_;
+  Ssl::SessionCachePtr ssl_session_cache_;
+  Ssl::PrivateKeyMethodProviderPtr ssl_private_key_method_provider_;
   std::unique_ptr<Ssl::ContextManagerImpl> ssl_context_manager_;
   ProdListenerComponentFactory listener_component_factory_;
   ProdWorkerFactory worker_factory_;
@@ -194,13 +304,15 @@ private:
   std::unique_ptr<Configuration::Main> config_;
   Stats::ScopePtr admin_scope_;
   Network::DnsResolverSharedPtr dns_resolver_;
+  // Also dns_resolver_ if names are resolved on a dedicated thread.
+  Network::ThreadedDnsResolverImplSharedPtr threaded_dns_resolver_;
   Event::TimerPtr stat_flush_timer_;
   LocalInfo::LocalInfoPtr local_info_;
   DrainManagerPtr drain_manager_;
   AccessLog::AccessLogManagerImpl access_log_manager_;
   std::unique_ptr<Upstream::ClusterManagerFactory> cluster_manager_factory_;
   InitManagerImpl init_manager_;
-  std::unique_ptr<Server::GuardDog> guard_dog_;
+  std::unique_ptr<GuardDogImpl> guard_dog_;
 };
 
 } // Server
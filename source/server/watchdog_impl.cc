@@ -1,5 +1,7 @@
 #include "server/watchdog_impl.h"
 
+#include <algorithm>
+
 #include "envoy/event/dispatcher.h"
 
 #include "common/common/assert.h"
@@ -10,8 +12,17 @@ namespace Server {
 void WatchDogImpl::startWatchdog(Event::Dispatcher& dispatcher) {
   timer_ = dispatcher.createTimer([this]() -> void {
     this->touch();
-    timer_->enableTimer(timer_interval_);
+    // The timer fires late by as long as the event loop was busy when it was due.
+    const auto stall = time_source_.currentTime() - timer_due_time_;
+    stall_histogram_.recordValue(std::max<int64_t>(
+        0, std::chrono::duration_cast<std::chrono::milliseconds>(stall).count()));
+    enableTimer();
   });
+  enableTimer();
+}
+
+void WatchDogImpl::enableTimer() {
+  timer_due_time_ = time_source_.currentTime() + timer_interval_;
   timer_->enableTimer(timer_interval_);
 }
 
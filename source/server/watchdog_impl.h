@@ -6,6 +6,7 @@
 #include "envoy/common/time.h"
 #include "envoy/event/dispatcher.h"
 #include "envoy/server/watchdog.h"
+#include "envoy/stats/stats.h"
 
 namespace Envoy {
 namespace Server {
@@ -19,11 +20,14 @@ public:
   /**
    * @param thread_id A system thread ID (such as from Thread::currentThreadId())
    * @param interval WatchDog timer interval (used after startWatchdog())
+   * @param stall_histogram records how late, in milliseconds, the timer fires, i.e. for how long
+   * the event loop of the thread was stalled (used after startWatchdog())
    */
-  WatchDogImpl(int32_t thread_id, MonotonicTimeSource& tsource, std::chrono::milliseconds interval)
+  WatchDogImpl(int32_t thread_id, MonotonicTimeSource& tsource, std::chrono::milliseconds interval,
+               Stats::Histogram& stall_histogram)
       : thread_id_(thread_id), time_source_(tsource),
         latest_touch_time_since_epoch_(tsource.currentTime().time_since_epoch()),
-        timer_interval_(interval) {}
+        timer_interval_(interval), stall_histogram_(stall_histogram) {}
 
   int32_t threadId() const override { return thread_id_; }
   MonotonicTime lastTouchTime() const override {
@@ -37,11 +41,15 @@ public:
   }
 
 private:
+  void enableTimer();
+
   const int32_t thread_id_;
   MonotonicTimeSource& time_source_;
   std::atomic<std::chrono::steady_clock::duration> latest_touch_time_since_epoch_;
   Event::TimerPtr timer_;
   const std::chrono::milliseconds timer_interval_;
+  Stats::Histogram& stall_histogram_;
+  MonotonicTime timer_due_time_;
 };
 
 } // namespace Server
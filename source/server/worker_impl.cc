@@ -1,5 +1,7 @@
 #include "server/worker_impl.h"
 
+#include <cerrno>
+#include <cstring>
 #include <functional>
 
 #include "envoy/event/dispatcher.h"
@@ -7,23 +9,38 @@
 #include "envoy/server/configuration.h"
 #include "envoy/thread_local/thread_local.h"
 
+#include "common/common/assert.h"
 #include "common/common/thread.h"
 
 #include "server/connection_handler_impl.h"
 
+#include "fmt/format.h"
+
 namespace Envoy {
 namespace Server {
 
-WorkerPtr ProdWorkerFactory::createWorker() {
+WorkerPtr ProdWorkerFactory::createWorker(uint32_t index) {
   Event::DispatcherPtr dispatcher(api_.allocateDispatcher());
-  return WorkerPtr{new WorkerImpl(
-      tls_, hooks_, std::move(dispatcher),
-      Network::ConnectionHandlerPtr{new ConnectionHandlerImpl(ENVOY_LOGGER(), *dispatcher)})};
+  if (loop_stats_) {
+    dispatcher->initializeStats(scope_, fmt::format("worker_{}.", index));
+  }
+  dispatcher->setCallbackBudget(callback_budget_);
+  if (io_uring_ && !dispatcher->enableIoUring()) {
+    ENVOY_LOG(warn, "io_uring is not supported, worker {} polls with libevent", index);
+  }
+  // The handler also counts the connections of each listener under worker_<index>, which gives
+  // the distribution of the connections across the workers.
+  Network::ConnectionHandlerPtr handler{
+      new ConnectionHandlerImpl(ENVOY_LOGGER(), *dispatcher, fmt::format("worker_{}.", index))};
+  return WorkerPtr{new WorkerImpl(tls_, hooks_, std::move(dispatcher), std::move(handler), index,
+                                 workerCpu(cpu_set_, index), numa_local_memory_)};
 }
 
 WorkerImpl::WorkerImpl(ThreadLocal::Instance& tls, TestHooks& hooks,
-                       Event::DispatcherPtr&& dispatcher, Network::ConnectionHandlerPtr handler)
-    : tls_(tls), hooks_(hooks), dispatcher_(std::move(dispatcher)), handler_(std::move(handler)) {
+                       Event::DispatcherPtr&& dispatcher, Network::ConnectionHandlerPtr handler,
+                       uint32_t index, Optional<uint32_t> cpu, bool numa_local_memory)
+    : tls_(tls), hooks_(hooks), dispatcher_(std::move(dispatcher)), handler_(std::move(handler)),
+      index_(index), cpu_(cpu), numa_local_memory_(numa_local_memory) {
   tls_.registerThread(*dispatcher_, false);
 }
 
@@ -47,14 +64,19 @@ void WorkerImpl::addListenerWorker(Listener& listener) {
                                                      .use_proxy_proto_ = listener.useProxyProto(),
                                                      .use_original_dst_ = listener.useOriginalDst(),
                                                      .per_connection_buffer_limit_bytes_ =
-                                                         listener.perConnectionBufferLimitBytes()};
+                                                         listener.perConnectionBufferLimitBytes(),
+                                                     .connection_balancer_ =
+                                                         listener.connectionBalancer(),
+                                                     .accept_batch_size_ =
+                                                         listener.acceptBatchSize()};
+  Network::ListenSocket* socket = listener.workerSocket(index_);
+  ASSERT(socket != nullptr);
   if (listener.defaultSslContext()) {
-    handler_->addSslListener(listener.filterChainFactory(), *listener.defaultSslContext(),
-                             listener.socket(), listener.listenerScope(), listener.listenerTag(),
-                             listener_options);
+    handler_->addSslListener(listener.filterChainFactory(), *listener.defaultSslContext(), *socket,
+                             listener.listenerScope(), listener.listenerTag(), listener_options);
   } else {
-    handler_->addListener(listener.filterChainFactory(), listener.socket(),
-                          listener.listenerScope(), listener.listenerTag(), listener_options);
+    handler_->addListener(listener.filterChainFactory(), *socket, listener.listenerScope(),
+                          listener.listenerTag(), listener_options);
   }
 
   hooks_.onWorkerListenerAdded();
@@ -68,6 +90,20 @@ uint64_t WorkerImpl::numConnections() {
   return ret;
 }
 
+WorkerLoad WorkerImpl::load() {
+  WorkerLoad load;
+  load.connections_ = numConnections();
+  load.active_requests_ = load_.activeRequests();
+  load.requests_total_ = load_.requestsTotal();
+  load.rx_bytes_ = load_.rxBytes();
+  load.tx_bytes_ = load_.txBytes();
+  load.busy_tracked_ = load_.busyTracked();
+  load.busy_time_ = load_.busyTime();
+  load.pending_posts_ = dispatcher_->pendingPosts();
+  load.started_ = started_;
+  return load;
+}
+
 void WorkerImpl::removeListener(Listener& listener, std::function<void()> completion) {
   ASSERT(thread_);
   const uint64_t listener_tag = listener.listenerTag();
@@ -80,6 +116,7 @@ void WorkerImpl::removeListener(Listener& listener, std::function<void()> comple
 
 void WorkerImpl::start(GuardDog& guard_dog) {
   ASSERT(!thread_);
+  started_ = std::chrono::steady_clock::now();
   thread_.reset(new Thread::Thread([this, &guard_dog]() -> void { threadRoutine(guard_dog); }));
 }
 
@@ -104,6 +141,17 @@ void WorkerImpl::stopListeners() {
 }
 
 void WorkerImpl::threadRoutine(GuardDog& guard_dog) {
+  // Both apply to the calling thread only, so they are set up before the worker allocates on it.
+  // The memory policy follows the CPU, so the thread is pinned first.
+  if (cpu_.valid() && !Thread::Thread::pinCurrentThread(cpu_.value())) {
+    ENVOY_LOG(warn, "unable to pin worker {} to CPU {}: {}", index_, cpu_.value(), strerror(errno));
+  }
+  if (numa_local_memory_ && !Thread::Thread::useLocalNumaMemory()) {
+    ENVOY_LOG(warn, "unable to allocate the memory of worker {} from its NUMA node: {}", index_,
+              strerror(errno));
+  }
+
+  ThreadLoad::setCurrent(&load_);
   ENVOY_LOG(debug, "worker entering dispatch loop");
   auto watchdog = guard_dog.createWatchDog(Thread::Thread::currentThreadId());
   watchdog->startWatchdog(*dispatcher_);
@@ -118,6 +166,7 @@ void WorkerImpl::threadRoutine(GuardDog& guard_dog) {
   handler_.reset();
   tls_.shutdownThread();
   watchdog.reset();
+  ThreadLoad::setCurrent(nullptr);
 }
 
 } // namespace Server
@@ -1,17 +1,22 @@
 #pragma once
 
+#include <chrono>
 #include <functional>
 #include <memory>
+#include <vector>
 
 #include "envoy/api/api.h"
+#include "envoy/common/optional.h"
 #include "envoy/network/connection_handler.h"
 #include "envoy/server/guarddog.h"
 #include "envoy/server/listener_manager.h"
 #include "envoy/server/worker.h"
+#include "envoy/stats/stats.h"
 #include "envoy/thread_local/thread_local.h"
 
 #include "common/common/logger.h"
 #include "common/common/thread.h"
+#include "common/common/thread_load.h"
 
 #include "server/test_hooks.h"
 
@@ -20,16 +25,49 @@ namespace Server {
 
 class ProdWorkerFactory : public WorkerFactory, Logger::Loggable<Logger::Id::main> {
 public:
-  ProdWorkerFactory(ThreadLocal::Instance& tls, Api::Api& api, TestHooks& hooks)
-      : tls_(tls), api_(api), hooks_(hooks) {}
+  /**
+   * @param loop_stats supplies whether the workers record the histograms of their event loops in
+   *        the scope.
+   * @param callback_budget supplies the callback budget of the dispatchers of the workers.
+   * @param io_uring supplies whether the dispatchers of the workers poll with io_uring.
+   * @param cpu_set supplies the CPUs to pin the workers to, @see workerCpu().
+   * @param numa_local_memory supplies whether the workers allocate memory from their NUMA node.
+   */
+  ProdWorkerFactory(ThreadLocal::Instance& tls, Api::Api& api, TestHooks& hooks,
+                    Stats::Scope& scope, bool loop_stats,
+                    std::chrono::microseconds callback_budget, bool io_uring,
+                    const std::vector<uint32_t>& cpu_set, bool numa_local_memory)
+      : tls_(tls), api_(api), hooks_(hooks), scope_(scope), loop_stats_(loop_stats),
+        callback_budget_(callback_budget), io_uring_(io_uring), cpu_set_(cpu_set),
+        numa_local_memory_(numa_local_memory) {}
+
+  /**
+   * @param cpu_set supplies the CPUs that the workers are pinned to.
+   * @param index supplies the index of a worker.
+   * @return Optional<uint32_t> the CPU that the worker is pinned to, the CPUs of the set being
+   *         handed out in order and reused once all the set has a worker, or none if the set is
+   *         empty.
+   */
+  static Optional<uint32_t> workerCpu(const std::vector<uint32_t>& cpu_set, uint32_t index) {
+    if (cpu_set.empty()) {
+      return {};
+    }
+    return cpu_set[index % cpu_set.size()];
+  }
 
   // Server::WorkerFactory
-  WorkerPtr createWorker() override;
+  WorkerPtr createWorker(uint32_t index) override;
 
 private:
   ThreadLocal::Instance& tls_;
   Api::Api& api_;
   TestHooks& hooks_;
+  Stats::Scope& scope_;
+  const bool loop_stats_;
+  const std::chrono::microseconds callback_budget_;
+  const bool io_uring_;
+  const std::vector<uint32_t> cpu_set_;
+  const bool numa_local_memory_;
 };
 
 /**
@@ -37,12 +75,20 @@ private:
  */
 class WorkerImpl : public Worker, Logger::Loggable<Logger::Id::main> {
 public:
+  /**
+   * @param index supplies the index of the worker, @see WorkerFactory::createWorker().
+   * @param cpu supplies the CPU to pin the worker thread to, if any.
+   * @param numa_local_memory supplies whether the worker thread allocates memory from the NUMA
+   *        node of the CPU it runs on.
+   */
   WorkerImpl(ThreadLocal::Instance& tls, TestHooks& hooks, Event::DispatcherPtr&& dispatcher,
-             Network::ConnectionHandlerPtr handler);
+             Network::ConnectionHandlerPtr handler, uint32_t index, Optional<uint32_t> cpu,
+             bool numa_local_memory);
 
   // Server::Worker
   void addListener(Listener& listener, AddListenerCompletion completion) override;
   uint64_t numConnections() override;
+  WorkerLoad load() override;
   void removeListener(Listener& listener, std::function<void()> completion) override;
   void start(GuardDog& guard_dog) override;
   void stop() override;
@@ -57,6 +103,13 @@ private:
   TestHooks& hooks_;
   Event::DispatcherPtr dispatcher_;
   Network::ConnectionHandlerPtr handler_;
+  const uint32_t index_;
+  const Optional<uint32_t> cpu_;
+  const bool numa_local_memory_;
+  // Made current on the worker thread, which updates it from its connections, HTTP streams and
+  // event loop.
+  ThreadLoad load_;
+  MonotonicTime started_;
   Thread::ThreadPtr thread_;
 };
 
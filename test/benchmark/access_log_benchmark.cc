@@ -0,0 +1,207 @@
+// Microbenchmarks for the access log write path. Run with an optimized build:
+//
+//   bazel run -c opt //test/benchmark:access_log_benchmark
+//
+// The requests carry the headers a browser typically sends and the request info of a proxied
+// request, so that the benchmarks give the cost each access log adds to a request. The format
+// benchmarks cover the formatters of the file access log, the file benchmarks the writes of the
+// worker threads to a file shared by all of them, and the gRPC benchmarks the entries of the gRPC
+// access log up to their serialization.
+
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "common/access_log/access_log_formatter.h"
+#include "common/access_log/grpc_access_log_impl.h"
+#include "common/common/thread.h"
+#include "common/filesystem/filesystem_impl.h"
+#include "common/http/header_map_impl.h"
+#include "common/network/address_impl.h"
+#include "common/request_info/request_info_impl.h"
+#include "common/stats/stats_impl.h"
+
+#include "test/mocks/event/mocks.h"
+#include "test/test_common/utility.h"
+
+#include "benchmark/benchmark.h"
+#include "gmock/gmock.h"
+
+using testing::NiceMock;
+
+namespace Envoy {
+namespace AccessLog {
+namespace {
+
+// Format strings of increasing cost: a few request info fields, the default format, and the
+// default format with custom request and response headers.
+const std::vector<std::string>& formats() {
+  static const std::vector<std::string> formats{
+      "%START_TIME% %RESPONSE_CODE% %DURATION%\n",
+      "[%START_TIME%] \"%REQ(:METHOD)% %REQ(X-ENVOY-ORIGINAL-PATH?:PATH)% %PROTOCOL%\" "
+      "%RESPONSE_CODE% %RESPONSE_FLAGS% %BYTES_RECEIVED% %BYTES_SENT% %DURATION% "
+      "%RESP(X-ENVOY-UPSTREAM-SERVICE-TIME)% \"%REQ(X-FORWARDED-FOR)%\" \"%REQ(USER-AGENT)%\" "
+      "\"%REQ(X-REQUEST-ID)%\" \"%REQ(:AUTHORITY)%\" \"%UPSTREAM_HOST%\"\n",
+      "[%START_TIME%] \"%REQ(:METHOD)% %REQ(X-ENVOY-ORIGINAL-PATH?:PATH)% %PROTOCOL%\" "
+      "%RESPONSE_CODE% %RESPONSE_FLAGS% %BYTES_RECEIVED% %BYTES_SENT% %DURATION% "
+      "%RESP(X-ENVOY-UPSTREAM-SERVICE-TIME)% \"%REQ(X-FORWARDED-FOR)%\" \"%REQ(USER-AGENT)%\" "
+      "\"%REQ(X-REQUEST-ID)%\" \"%REQ(:AUTHORITY)%\" \"%UPSTREAM_HOST%\" "
+      "\"%REQ(X-CUSTOM-TENANT)%\" \"%REQ(REFERER)%\" \"%RESP(CONTENT-TYPE)%\" "
+      "%REQUEST_HEADERS_BYTES% %RESPONSE_HEADERS_BYTES% %DOWNSTREAM_REMOTE_ADDRESS%\n"};
+  return formats;
+}
+
+/**
+ * The headers and request info of a proxied request.
+ */
+struct TestRequest {
+  TestRequest() : request_info_(Http::Protocol::Http11) {
+    request_info_.bytes_received_ = 1024;
+    request_info_.bytes_sent_ = 16384;
+    request_info_.response_code_.value(200);
+    request_info_.downstream_remote_address_ =
+        std::make_shared<Network::Address::Ipv4Instance>("10.0.0.1", 43210);
+    request_info_.downstream_local_address_ =
+        std::make_shared<Network::Address::Ipv4Instance>("10.0.0.2", 443);
+  }
+
+  Http::TestHeaderMapImpl request_headers_{
+      {":method", "GET"},
+      {":path", "/some/path/to/a/resource?with=a&query=string"},
+      {":authority", "www.example.com"},
+      {":scheme", "https"},
+      {"user-agent", "Mozilla/5.0 (X11; Linux x86_64) AppleWebKit/537.36 (KHTML, like Gecko)"},
+      {"referer", "https://www.example.com/"},
+      {"x-forwarded-for", "10.0.0.1"},
+      {"x-request-id", "0b5c7f1e-3b1a-4c8e-9d6f-2a4e8c1b7d3f"},
+      {"x-custom-tenant", "tenant-1234"}};
+  Http::TestHeaderMapImpl response_headers_{{":status", "200"},
+                                            {"content-type", "application/json"},
+                                            {"x-envoy-upstream-service-time", "12"}};
+  RequestInfo::RequestInfoImpl request_info_;
+};
+
+// Format a request into a new string. The parameter is the index of the format string.
+void format(benchmark::State& state) {
+  TestRequest request;
+  FormatterImpl formatter(formats()[state.range(0)]);
+  size_t bytes = 0;
+  for (auto _ : state) {
+    const std::string line = formatter.format(request.request_headers_, request.response_headers_,
+                                              request.request_info_);
+    bytes += line.size();
+  }
+  state.SetBytesProcessed(bytes);
+}
+BENCHMARK(format)->DenseRange(0, 2);
+
+// Format a request into a string reused across requests, as the file access log does. The
+// parameter is the index of the format string.
+void formatTo(benchmark::State& state) {
+  TestRequest request;
+  FormatterImpl formatter(formats()[state.range(0)]);
+  std::string line;
+  size_t bytes = 0;
+  for (auto _ : state) {
+    line.clear();
+    formatter.formatTo(request.request_headers_, request.response_headers_, request.request_info_,
+                       line);
+    bytes += line.size();
+  }
+  state.SetBytesProcessed(bytes);
+}
+BENCHMARK(formatTo)->DenseRange(0, 2);
+
+// The file shared by the threads of the file benchmarks, which thread 0 creates before the threads
+// start iterating and deletes after they all stopped. The flush thread of the file writes to
+// /dev/null, so that the benchmarks measure the handoff of the lines rather than the disk.
+NiceMock<Event::MockDispatcher> file_dispatcher;
+Thread::MutexBasicLockable file_lock;
+Stats::IsolatedStoreImpl file_stats;
+std::unique_ptr<Filesystem::FileImpl> shared_file;
+
+void setUpSharedFile(const benchmark::State& state) {
+  if (state.thread_index == 0) {
+    shared_file.reset(new Filesystem::FileImpl("/dev/null", file_dispatcher, file_lock, file_stats,
+                                               std::chrono::milliseconds(1000)));
+  }
+}
+
+void tearDownSharedFile(const benchmark::State& state) {
+  if (state.thread_index == 0) {
+    shared_file.reset();
+  }
+}
+
+// Each thread writes lines of the default format to the shared file.
+void fileWrite(benchmark::State& state) {
+  setUpSharedFile(state);
+  TestRequest request;
+  const std::string line = AccessLogFormatUtils::defaultAccessLogFormatter()->format(
+      request.request_headers_, request.response_headers_, request.request_info_);
+  for (auto _ : state) {
+    shared_file->write(line);
+  }
+  state.SetBytesProcessed(state.iterations() * line.size());
+  tearDownSharedFile(state);
+}
+BENCHMARK(fileWrite)->ThreadRange(1, 8)->UseRealTime();
+
+// Each thread formats requests with the default format and writes them to the shared file, which is
+// the cost of the file access log for each request.
+void formatAndFileWrite(benchmark::State& state) {
+  setUpSharedFile(state);
+  TestRequest request;
+  FormatterPtr formatter = AccessLogFormatUtils::defaultAccessLogFormatter();
+  std::string line;
+  size_t bytes = 0;
+  for (auto _ : state) {
+    line.clear();
+    formatter->formatTo(request.request_headers_, request.response_headers_, request.request_info_,
+                        line);
+    shared_file->write(line);
+    bytes += line.size();
+  }
+  state.SetBytesProcessed(bytes);
+  tearDownSharedFile(state);
+}
+BENCHMARK(formatAndFileWrite)->ThreadRange(1, 8)->UseRealTime();
+
+// Fill in the gRPC access log entry of a request.
+void grpcPopulate(benchmark::State& state) {
+  TestRequest request;
+  for (auto _ : state) {
+    envoy::api::v2::filter::accesslog::HTTPAccessLogEntry log_entry;
+    HttpGrpcAccessLog::populateLogEntry(log_entry, request.request_headers_,
+                                        request.response_headers_, request.request_info_);
+    benchmark::DoNotOptimize(log_entry);
+  }
+}
+BENCHMARK(grpcPopulate);
+
+// Fill in the gRPC access log entries of a batch of requests and serialize the batch, as the
+// streams of the gRPC access log do. The parameter is the number of entries in the batch.
+void grpcSerializeBatch(benchmark::State& state) {
+  TestRequest request;
+  size_t bytes = 0;
+  for (auto _ : state) {
+    envoy::api::v2::filter::accesslog::StreamAccessLogsMessage message;
+    for (int64_t i = 0; i < state.range(0); i++) {
+      HttpGrpcAccessLog::populateLogEntry(*message.mutable_http_logs()->add_log_entry(),
+                                          request.request_headers_, request.response_headers_,
+                                          request.request_info_);
+    }
+    bytes += message.SerializeAsString().size();
+  }
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+  state.SetBytesProcessed(bytes);
+}
+BENCHMARK(grpcSerializeBatch)->Arg(1)->Arg(16)->Arg(128);
+
+} // namespace
+} // namespace AccessLog
+} // namespace Envoy
+
+BENCHMARK_MAIN();
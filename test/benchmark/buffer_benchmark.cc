@@ -0,0 +1,212 @@
+// Microbenchmarks for Buffer::OwnedImpl and Buffer::WatermarkBuffer. Run with an optimized build:
+//
+//   bazel run -c opt //test/benchmark:buffer_benchmark -- --benchmark_filter=Move
+//
+// Most benchmarks take two parameters: the total number of bytes held by the buffer, and the size
+// of the slices it is made of, so that both contiguous and fragmented buffers are covered.
+
+#include <algorithm>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "envoy/buffer/buffer.h"
+
+#include "common/buffer/buffer_impl.h"
+#include "common/buffer/watermark_buffer.h"
+
+#include "benchmark/benchmark.h"
+
+namespace Envoy {
+namespace Buffer {
+namespace {
+
+template <class BufferType> struct BufferFactory;
+
+template <> struct BufferFactory<OwnedImpl> {
+  static OwnedImpl* create() { return new OwnedImpl(); }
+};
+
+template <> struct BufferFactory<WatermarkBuffer> {
+  static WatermarkBuffer* create() {
+    WatermarkBuffer* buffer = new WatermarkBuffer([]() -> void {}, []() -> void {});
+    // Watermarks that are never crossed, so that every resize pays for the watermark checks.
+    buffer->setWatermarks(1 << 30);
+    return buffer;
+  }
+};
+
+template <class BufferType> InstancePtr createBuffer() {
+  return InstancePtr{BufferFactory<BufferType>::create()};
+}
+
+// Append `data` to `buffer` in slices of `slice_size` bytes each.
+void fill(Instance& buffer, const std::string& data, uint64_t slice_size) {
+  for (uint64_t offset = 0; offset < data.size(); offset += slice_size) {
+    // Moving a buffer appends its slices as they are, so each chunk stays a separate slice.
+    OwnedImpl chunk(data.data() + offset, std::min<uint64_t>(data.size() - offset, slice_size));
+    buffer.move(chunk);
+  }
+}
+
+// Total size and slice size pairs, from a single small slice up to 1MB in 128 byte slices.
+void sizeAndSliceSizeArgs(benchmark::internal::Benchmark* b) {
+  for (int64_t size : {256, 16384, 1048576}) {
+    for (int64_t slice_size : {128, 4096, 16384}) {
+      if (slice_size <= size || slice_size == 128) {
+        b->Args({size, std::min(size, slice_size)});
+      }
+    }
+  }
+}
+
+// Append `size` bytes in one call and drain them again, as a read followed by a full consume.
+template <class BufferType> void bufferAdd(benchmark::State& state) {
+  const std::string data(state.range(0), 'a');
+  InstancePtr buffer = createBuffer<BufferType>();
+  for (auto _ : state) {
+    buffer->add(data.data(), data.size());
+    buffer->drain(data.size());
+  }
+  state.SetBytesProcessed(state.iterations() * data.size());
+}
+BENCHMARK_TEMPLATE(bufferAdd, OwnedImpl)->Range(1, 1 << 20);
+BENCHMARK_TEMPLATE(bufferAdd, WatermarkBuffer)->Range(1, 1 << 20);
+
+// Append many small writes, as a codec serializing headers does.
+template <class BufferType> void bufferAddSmall(benchmark::State& state) {
+  const std::string data(state.range(0), 'a');
+  const uint64_t count = 16384 / data.size();
+  InstancePtr buffer = createBuffer<BufferType>();
+  for (auto _ : state) {
+    for (uint64_t i = 0; i < count; i++) {
+      buffer->add(data.data(), data.size());
+    }
+    buffer->drain(buffer->length());
+  }
+  state.SetBytesProcessed(state.iterations() * count * data.size());
+}
+BENCHMARK_TEMPLATE(bufferAddSmall, OwnedImpl)->Range(1, 1024);
+BENCHMARK_TEMPLATE(bufferAddSmall, WatermarkBuffer)->Range(1, 1024);
+
+// Move a whole buffer into another and back.
+template <class BufferType> void bufferMove(benchmark::State& state) {
+  InstancePtr buffer1 = createBuffer<BufferType>();
+  InstancePtr buffer2 = createBuffer<BufferType>();
+  fill(*buffer1, std::string(state.range(0), 'a'), state.range(1));
+  for (auto _ : state) {
+    buffer2->move(*buffer1);
+    buffer1->move(*buffer2);
+  }
+  state.SetBytesProcessed(state.iterations() * 2 * state.range(0));
+}
+BENCHMARK_TEMPLATE(bufferMove, OwnedImpl)->Apply(sizeAndSliceSizeArgs);
+BENCHMARK_TEMPLATE(bufferMove, WatermarkBuffer)->Apply(sizeAndSliceSizeArgs);
+
+// Move part of a buffer into another and back, which splits a slice when the length does not fall
+// on a slice boundary.
+template <class BufferType> void bufferPartialMove(benchmark::State& state) {
+  InstancePtr buffer1 = createBuffer<BufferType>();
+  InstancePtr buffer2 = createBuffer<BufferType>();
+  fill(*buffer1, std::string(state.range(0), 'a'), state.range(1));
+  const uint64_t length = state.range(0) / 2 + 1;
+  for (auto _ : state) {
+    buffer2->move(*buffer1, length);
+    buffer1->move(*buffer2);
+  }
+  state.SetBytesProcessed(state.iterations() * 2 * length);
+}
+BENCHMARK_TEMPLATE(bufferPartialMove, OwnedImpl)->Apply(sizeAndSliceSizeArgs);
+BENCHMARK_TEMPLATE(bufferPartialMove, WatermarkBuffer)->Apply(sizeAndSliceSizeArgs);
+
+// Drain a buffer in 1KB steps. Filling it again is not timed.
+template <class BufferType> void bufferDrain(benchmark::State& state) {
+  const std::string data(state.range(0), 'a');
+  InstancePtr buffer = createBuffer<BufferType>();
+  for (auto _ : state) {
+    state.PauseTiming();
+    fill(*buffer, data, state.range(1));
+    state.ResumeTiming();
+    while (buffer->length() > 0) {
+      buffer->drain(std::min<uint64_t>(buffer->length(), 1024));
+    }
+  }
+  state.SetBytesProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK_TEMPLATE(bufferDrain, OwnedImpl)->Apply(sizeAndSliceSizeArgs);
+BENCHMARK_TEMPLATE(bufferDrain, WatermarkBuffer)->Apply(sizeAndSliceSizeArgs);
+
+// Linearize the whole of a fragmented buffer. Fragmenting it again is not timed.
+template <class BufferType> void bufferLinearize(benchmark::State& state) {
+  const std::string data(state.range(0), 'a');
+  InstancePtr buffer = createBuffer<BufferType>();
+  for (auto _ : state) {
+    state.PauseTiming();
+    buffer->drain(buffer->length());
+    fill(*buffer, data, state.range(1));
+    state.ResumeTiming();
+    benchmark::DoNotOptimize(buffer->linearize(state.range(0)));
+  }
+  state.SetBytesProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK_TEMPLATE(bufferLinearize, OwnedImpl)->Apply(sizeAndSliceSizeArgs);
+BENCHMARK_TEMPLATE(bufferLinearize, WatermarkBuffer)->Apply(sizeAndSliceSizeArgs);
+
+// Search for a pattern that is only found at the very end of the buffer, so the whole buffer is
+// scanned. The buffer holds near misses so that the first byte of the pattern matches often.
+template <class BufferType> void bufferSearch(benchmark::State& state) {
+  InstancePtr buffer = createBuffer<BufferType>();
+  const std::string pattern = "\r\n\r\n";
+  std::string data;
+  while (data.size() + pattern.size() < static_cast<uint64_t>(state.range(0))) {
+    data += (data.size() % 64 == 0) ? '\r' : 'a';
+  }
+  data += pattern;
+  fill(*buffer, data, state.range(1));
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(buffer->search(pattern.data(), pattern.size(), 0));
+  }
+  state.SetBytesProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK_TEMPLATE(bufferSearch, OwnedImpl)->Apply(sizeAndSliceSizeArgs);
+BENCHMARK_TEMPLATE(bufferSearch, WatermarkBuffer)->Apply(sizeAndSliceSizeArgs);
+
+// Count and then fetch the slices of a buffer, as the socket write path does.
+template <class BufferType> void bufferGetRawSlices(benchmark::State& state) {
+  InstancePtr buffer = createBuffer<BufferType>();
+  fill(*buffer, std::string(state.range(0), 'a'), state.range(1));
+  std::vector<RawSlice> slices;
+  for (auto _ : state) {
+    slices.resize(buffer->getRawSlices(nullptr, 0));
+    benchmark::DoNotOptimize(buffer->getRawSlices(slices.data(), slices.size()));
+  }
+  state.SetItemsProcessed(state.iterations() * slices.size());
+}
+BENCHMARK_TEMPLATE(bufferGetRawSlices, OwnedImpl)->Apply(sizeAndSliceSizeArgs);
+BENCHMARK_TEMPLATE(bufferGetRawSlices, WatermarkBuffer)->Apply(sizeAndSliceSizeArgs);
+
+// Reserve space, commit it as a socket read would, then consume it.
+template <class BufferType> void bufferReserveCommit(benchmark::State& state) {
+  InstancePtr buffer = createBuffer<BufferType>();
+  const uint64_t size = state.range(0);
+  for (auto _ : state) {
+    RawSlice iovecs[2];
+    const uint64_t num_iovecs = buffer->reserve(size, iovecs, 2);
+    uint64_t remaining = size;
+    for (uint64_t i = 0; i < num_iovecs; i++) {
+      iovecs[i].len_ = std::min<uint64_t>(iovecs[i].len_, remaining);
+      remaining -= iovecs[i].len_;
+    }
+    buffer->commit(iovecs, num_iovecs);
+    buffer->drain(buffer->length());
+  }
+  state.SetBytesProcessed(state.iterations() * size);
+}
+BENCHMARK_TEMPLATE(bufferReserveCommit, OwnedImpl)->Range(512, 1 << 16);
+BENCHMARK_TEMPLATE(bufferReserveCommit, WatermarkBuffer)->Range(512, 1 << 16);
+
+} // namespace
+} // namespace Buffer
+} // namespace Envoy
+
+BENCHMARK_MAIN();
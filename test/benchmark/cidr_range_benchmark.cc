@@ -0,0 +1,93 @@
+// Microbenchmarks for matching addresses against lists of CIDR ranges. Run with an optimized build:
+//
+//   bazel run -c opt //test/benchmark:cidr_range_benchmark
+//
+// Each benchmark takes the number of ranges as its parameter, and looks up a mix of addresses in
+// and out of the ranges. IpList is compared with the scan of the ranges it replaced.
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "common/network/address_impl.h"
+#include "common/network/cidr_range.h"
+
+#include "benchmark/benchmark.h"
+#include "fmt/format.h"
+
+namespace Envoy {
+namespace Network {
+namespace Address {
+namespace {
+
+std::string ipv4(uint32_t ip) {
+  return fmt::format("{}.{}.{}.{}", ip >> 24, (ip >> 16) & 0xff, (ip >> 8) & 0xff, ip & 0xff);
+}
+
+// Ranges of /16 to /28 spread over the address space, as a list of customer networks would be.
+std::vector<std::string> ranges(int64_t num_ranges) {
+  std::vector<std::string> ranges;
+  uint32_t seed = 1;
+  for (int64_t i = 0; i < num_ranges; i++) {
+    seed = seed * 1103515245 + 12345;
+    ranges.push_back(fmt::format("{}/{}", ipv4(seed), 16 + i % 13));
+  }
+  return ranges;
+}
+
+std::vector<Ipv4Instance> addresses(const std::vector<std::string>& ranges) {
+  std::vector<Ipv4Instance> addresses;
+  uint32_t seed = 7;
+  for (size_t i = 0; i < 64; i++) {
+    seed = seed * 1103515245 + 12345;
+    // Every other address is in a range, and the rest are most likely in none.
+    addresses.emplace_back(i % 2 == 0 ? CidrRange::create(ranges[seed % ranges.size()])
+                                            .ip()
+                                            ->addressAsString()
+                                      : ipv4(seed));
+  }
+  return addresses;
+}
+
+void linearScan(benchmark::State& state) {
+  const std::vector<std::string> subnets = ranges(state.range(0));
+  std::vector<CidrRange> list;
+  for (const std::string& subnet : subnets) {
+    list.push_back(CidrRange::create(subnet));
+  }
+  const std::vector<Ipv4Instance> requests = addresses(subnets);
+  for (auto _ : state) {
+    for (const Ipv4Instance& address : requests) {
+      bool found = false;
+      for (const CidrRange& range : list) {
+        if (range.isInRange(address)) {
+          found = true;
+          break;
+        }
+      }
+      benchmark::DoNotOptimize(found);
+    }
+  }
+  state.SetItemsProcessed(state.iterations() * requests.size());
+}
+BENCHMARK(linearScan)->Arg(16)->Arg(1000)->Arg(100000);
+
+void ipListContains(benchmark::State& state) {
+  const std::vector<std::string> subnets = ranges(state.range(0));
+  const IpList list(subnets);
+  const std::vector<Ipv4Instance> requests = addresses(subnets);
+  for (auto _ : state) {
+    for (const Ipv4Instance& address : requests) {
+      benchmark::DoNotOptimize(list.contains(address));
+    }
+  }
+  state.SetItemsProcessed(state.iterations() * requests.size());
+}
+BENCHMARK(ipListContains)->Arg(16)->Arg(1000)->Arg(100000);
+
+} // namespace
+} // namespace Address
+} // namespace Network
+} // namespace Envoy
+
+BENCHMARK_MAIN();
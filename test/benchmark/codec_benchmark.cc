@@ -0,0 +1,209 @@
+// Microbenchmarks for the HTTP/1 and HTTP/2 server codecs. Run with an optimized build:
+//
+//   bazel run -c opt //test/benchmark:codec_benchmark
+//
+// Each iteration creates a server connection, dispatches a corpus of requests through it and
+// answers each request with a header only response as soon as it is complete, the way a local
+// reply would. The network connection is a mock that discards everything written to it.
+
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <string>
+
+#include "envoy/http/codec.h"
+
+#include "common/buffer/buffer_impl.h"
+#include "common/http/header_map_impl.h"
+#include "common/http/http1/codec_impl.h"
+#include "common/http/http2/codec_impl.h"
+#include "common/stats/stats_impl.h"
+
+#include "test/mocks/http/mocks.h"
+#include "test/mocks/network/mocks.h"
+#include "test/test_common/utility.h"
+
+#include "benchmark/benchmark.h"
+#include "gmock/gmock.h"
+
+using testing::Invoke;
+using testing::NiceMock;
+using testing::_;
+
+namespace Envoy {
+namespace Http {
+namespace {
+
+// Each request in the corpus: a mix of header only GETs and POSTs with a small body.
+const uint32_t NumRequests = 16;
+const uint64_t BodySize = 1024;
+
+TestHeaderMapImpl requestHeaders(uint32_t i) {
+  TestHeaderMapImpl headers{
+      {":method", i % 4 == 3 ? "POST" : "GET"},
+      {":path", "/some/path/to/a/resource?with=a&query=string&request=" + std::to_string(i)},
+      {":authority", "www.example.com"},
+      {":scheme", "https"},
+      {"user-agent", "Mozilla/5.0 (X11; Linux x86_64) AppleWebKit/537.36 (KHTML, like Gecko)"},
+      {"accept", "text/html,application/xhtml+xml,application/xml;q=0.9,*/*;q=0.8"},
+      {"accept-encoding", "gzip, deflate, br"},
+      {"accept-language", "en-US,en;q=0.5"},
+      {"cookie", "session=0b5c7f1e3b1a4c8e9d6f2a4e8c1b7d3f; preferences=dark-mode"},
+      {"x-request-id", "0b5c7f1e-3b1a-4c8e-9d6f-2a4e8c1b7d3f"}};
+  if (i % 4 == 3) {
+    headers.addCopy("content-length", std::to_string(BodySize));
+  }
+  return headers;
+}
+
+std::string http1RequestCorpus() {
+  std::string corpus;
+  for (uint32_t i = 0; i < NumRequests; i++) {
+    TestHeaderMapImpl headers = requestHeaders(i);
+    corpus += headers.get_(":method") + " " + headers.get_(":path") + " HTTP/1.1\r\n";
+    headers.iterate(
+        [](const HeaderEntry& header, void* context) -> HeaderMap::Iterate {
+          std::string& out = *static_cast<std::string*>(context);
+          if (header.key().c_str()[0] != ':') {
+            out += std::string(header.key().c_str()) + ": " + header.value().c_str() + "\r\n";
+          } else if (header.key() == ":authority") {
+            out += std::string("host: ") + header.value().c_str() + "\r\n";
+          }
+          return HeaderMap::Iterate::Continue;
+        },
+        &corpus);
+    corpus += "\r\n";
+    if (headers.has("content-length")) {
+      corpus += std::string(BodySize, 'a');
+    }
+  }
+  return corpus;
+}
+
+// Everything a client codec writes to its connection when sending the corpus, from the connection
+// preface on.
+std::string http2RequestCorpus() {
+  NiceMock<Network::MockConnection> connection;
+  std::string corpus;
+  ON_CALL(connection, write(_)).WillByDefault(Invoke([&corpus](Buffer::Instance& data) -> void {
+    corpus += TestUtility::bufferToString(data);
+    data.drain(data.length());
+  }));
+  NiceMock<MockConnectionCallbacks> callbacks;
+  Stats::IsolatedStoreImpl stats;
+  Http2::ClientConnectionImpl client(connection, callbacks, stats, Http2Settings());
+
+  std::list<NiceMock<MockStreamDecoder>> decoders;
+  for (uint32_t i = 0; i < NumRequests; i++) {
+    decoders.emplace_back();
+    StreamEncoder& encoder = client.newStream(decoders.back());
+    TestHeaderMapImpl headers = requestHeaders(i);
+    if (headers.has("content-length")) {
+      encoder.encodeHeaders(headers, false);
+      Buffer::OwnedImpl body(std::string(BodySize, 'a'));
+      encoder.encodeData(body, true);
+    } else {
+      encoder.encodeHeaders(headers, true);
+    }
+  }
+  return corpus;
+}
+
+/**
+ * Server connection callbacks that answer every request once it is complete.
+ */
+class Server : public ServerConnectionCallbacks {
+public:
+  // Http::ConnectionCallbacks
+  void onGoAway() override {}
+
+  // Http::ServerConnectionCallbacks
+  StreamDecoder& newStream(StreamEncoder& response_encoder) override {
+    requests_.emplace_back(response_encoder);
+    return requests_.back();
+  }
+
+private:
+  struct ActiveRequest : public StreamDecoder {
+    ActiveRequest(StreamEncoder& response_encoder) : response_encoder_(response_encoder) {}
+
+    // Http::StreamDecoder
+    void decodeHeaders(HeaderMapPtr&& headers, bool end_stream) override {
+      benchmark::DoNotOptimize(headers->size());
+      if (end_stream) {
+        respond();
+      }
+    }
+    void decodeData(Buffer::Instance& data, bool end_stream) override {
+      benchmark::DoNotOptimize(data.length());
+      if (end_stream) {
+        respond();
+      }
+    }
+    void decodeTrailers(HeaderMapPtr&&) override { respond(); }
+
+    void respond() {
+      response_encoder_.encodeHeaders(TestHeaderMapImpl{{":status", "200"}}, true);
+    }
+
+    StreamEncoder& response_encoder_;
+  };
+
+  std::list<ActiveRequest> requests_;
+};
+
+class BenchmarkConnection {
+public:
+  BenchmarkConnection() {
+    ON_CALL(connection_, write(_)).WillByDefault(Invoke([](Buffer::Instance& data) -> void {
+      data.drain(data.length());
+    }));
+  }
+
+  NiceMock<Network::MockConnection> connection_;
+};
+
+void http1Dispatch(benchmark::State& state, bool fast_request_parser) {
+  const std::string corpus = http1RequestCorpus();
+  BenchmarkConnection connection;
+  Http1Settings settings;
+  settings.fast_request_parser_ = fast_request_parser;
+  for (auto _ : state) {
+    Server server;
+    Http1::ServerConnectionImpl codec(connection.connection_, server, settings);
+    Buffer::OwnedImpl data(corpus);
+    // The codec pauses after each request, so keep dispatching until the corpus is consumed.
+    while (data.length() > 0) {
+      codec.dispatch(data);
+    }
+  }
+  state.SetBytesProcessed(state.iterations() * corpus.size());
+  state.SetItemsProcessed(state.iterations() * NumRequests);
+}
+
+void http1ServerDispatch(benchmark::State& state) { http1Dispatch(state, false); }
+BENCHMARK(http1ServerDispatch);
+
+void http1ServerDispatchFastRequestParser(benchmark::State& state) { http1Dispatch(state, true); }
+BENCHMARK(http1ServerDispatchFastRequestParser);
+
+void http2ServerDispatch(benchmark::State& state) {
+  const std::string corpus = http2RequestCorpus();
+  BenchmarkConnection connection;
+  Stats::IsolatedStoreImpl stats;
+  for (auto _ : state) {
+    Server server;
+    Http2::ServerConnectionImpl codec(connection.connection_, server, stats, Http2Settings());
+    Buffer::OwnedImpl data(corpus);
+    codec.dispatch(data);
+  }
+  state.SetBytesProcessed(state.iterations() * corpus.size());
+  state.SetItemsProcessed(state.iterations() * NumRequests);
+}
+BENCHMARK(http2ServerDispatch);
+
+} // namespace
+} // namespace Http
+} // namespace Envoy
+
+BENCHMARK_MAIN();
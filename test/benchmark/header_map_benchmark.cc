@@ -0,0 +1,141 @@
+// Microbenchmarks for Http::HeaderMapImpl. Run with an optimized build:
+//
+//   bazel run -c opt //test/benchmark:header_map_benchmark -- --benchmark_filter=get
+//
+// Each benchmark takes the number of headers in the map as its parameter. The maps are made of
+// the inline headers a typical request carries followed by custom headers, so that both the O(1)
+// inline paths and the linear paths for other headers are covered.
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "envoy/http/header_map.h"
+
+#include "common/http/header_map_impl.h"
+
+#include "benchmark/benchmark.h"
+
+namespace Envoy {
+namespace Http {
+namespace {
+
+// Inline headers, in the order a browser typically sends them.
+const std::vector<std::pair<std::string, std::string>>& inlineHeaders() {
+  static const std::vector<std::pair<std::string, std::string>> headers{
+      {":method", "GET"},
+      {":path", "/some/path/to/a/resource?with=a&query=string"},
+      {":authority", "www.example.com"},
+      {":scheme", "https"},
+      {"user-agent", "Mozilla/5.0 (X11; Linux x86_64) AppleWebKit/537.36 (KHTML, like Gecko)"},
+      {"accept-encoding", "gzip, deflate, br"},
+      {"x-forwarded-for", "10.0.0.1"},
+      {"x-request-id", "0b5c7f1e-3b1a-4c8e-9d6f-2a4e8c1b7d3f"}};
+  return headers;
+}
+
+// The headers of a map with `num_headers` entries, as key/value pairs.
+std::vector<std::pair<std::string, std::string>> headerPairs(int64_t num_headers) {
+  std::vector<std::pair<std::string, std::string>> headers;
+  for (int64_t i = 0; i < num_headers; i++) {
+    if (static_cast<size_t>(i) < inlineHeaders().size()) {
+      headers.push_back(inlineHeaders()[i]);
+    } else {
+      headers.emplace_back("x-custom-header-" + std::to_string(i),
+                           "a header value of a realistic length");
+    }
+  }
+  return headers;
+}
+
+HeaderMapImpl headerMap(int64_t num_headers) {
+  HeaderMapImpl headers;
+  for (const auto& header : headerPairs(num_headers)) {
+    headers.addCopy(LowerCaseString(header.first), header.second);
+  }
+  return headers;
+}
+
+// Populate a map the way the codecs do when receiving headers.
+void addViaMove(benchmark::State& state) {
+  const std::vector<std::pair<std::string, std::string>> headers = headerPairs(state.range(0));
+  for (auto _ : state) {
+    HeaderMapImpl map;
+    for (const auto& header : headers) {
+      HeaderString key;
+      key.setCopy(header.first.data(), header.first.size());
+      HeaderString value;
+      value.setCopy(header.second.data(), header.second.size());
+      map.addViaMove(std::move(key), std::move(value));
+    }
+    benchmark::DoNotOptimize(map.size());
+  }
+}
+BENCHMARK(addViaMove)->Arg(8)->Arg(16)->Arg(64);
+
+// Find the last custom header, which has to walk the whole map.
+void get(benchmark::State& state) {
+  const int64_t num_headers = state.range(0);
+  const HeaderMapImpl map = headerMap(num_headers);
+  const LowerCaseString key("x-custom-header-" + std::to_string(num_headers - 1));
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(map.get(key));
+  }
+}
+BENCHMARK(get)->Arg(16)->Arg(64);
+
+// Find an inline header by name.
+void lookup(benchmark::State& state) {
+  const HeaderMapImpl map = headerMap(state.range(0));
+  const LowerCaseString key("x-request-id");
+  for (auto _ : state) {
+    const HeaderEntry* entry;
+    benchmark::DoNotOptimize(map.lookup(key, &entry));
+    benchmark::DoNotOptimize(entry);
+  }
+}
+BENCHMARK(lookup)->Arg(8)->Arg(64);
+
+// Add a custom header and remove it again, as filters commonly do with internal headers.
+void remove(benchmark::State& state) {
+  HeaderMapImpl map = headerMap(state.range(0));
+  const LowerCaseString key("x-internal-header");
+  const std::string value("a header value of a realistic length");
+  for (auto _ : state) {
+    map.addReference(key, value);
+    map.remove(key);
+  }
+  benchmark::DoNotOptimize(map.size());
+}
+BENCHMARK(remove)->Arg(8)->Arg(16)->Arg(64);
+
+void iterate(benchmark::State& state) {
+  const HeaderMapImpl map = headerMap(state.range(0));
+  for (auto _ : state) {
+    uint64_t bytes = 0;
+    map.iterate(
+        [](const HeaderEntry& header, void* context) -> HeaderMap::Iterate {
+          *static_cast<uint64_t*>(context) += header.key().size() + header.value().size();
+          return HeaderMap::Iterate::Continue;
+        },
+        &bytes);
+    benchmark::DoNotOptimize(bytes);
+  }
+}
+BENCHMARK(iterate)->Arg(8)->Arg(16)->Arg(64);
+
+// Copy a map, as the router does for retries and shadowing.
+void copy(benchmark::State& state) {
+  const HeaderMapImpl map = headerMap(state.range(0));
+  for (auto _ : state) {
+    HeaderMapImpl copy(static_cast<const HeaderMap&>(map));
+    benchmark::DoNotOptimize(copy.size());
+  }
+}
+BENCHMARK(copy)->Arg(8)->Arg(16)->Arg(64);
+
+} // namespace
+} // namespace Http
+} // namespace Envoy
+
+BENCHMARK_MAIN();
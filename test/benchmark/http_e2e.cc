@@ -0,0 +1,323 @@
+// End to end HTTP benchmarks through a complete Envoy server. Run with an optimized build:
+//
+//   bazel run -c opt //test/benchmark:http_e2e -- [benchmark flags] [--http_filter=<file>...]
+//       [--routes=<count>]
+//
+// Each benchmark starts an Envoy with the integration test framework's HTTP proxy configuration,
+// routing to an AutonomousUpstream that answers every request with a 200 and 10 bytes of body. A
+// closed loop load generator opens range(0) client connections and keeps range(1) requests in
+// flight on each of them, issuing the next request on a slot as soon as the response to the
+// previous one is complete. The http1 benchmark uses HTTP/1.1 on both sides of Envoy, which allows
+// one request per connection at a time; the http2 benchmark uses HTTP/2 on both.
+//
+// Every --http_filter names a file holding the YAML of an HTTP filter, e.g. "name: envoy.buffer"
+// followed by its config. The filters run in the order given, ahead of the router. --routes adds
+// that many prefix routes that do not match ahead of the route that does, to measure route
+// matching.
+//
+// Every benchmark reports items_per_second as responses per second, p50_us, p90_us and p99_us as
+// request latency percentiles in microseconds, errors as the number of requests that were reset or
+// did not get a 200 and, with tcmalloc, allocs_per_op as heap allocations per request. Envoy, the
+// upstream and the load generator all run in the benchmark's process, so allocs_per_op includes the
+// allocations of the load generator and the upstream; compare it between runs rather than reading
+// it as Envoy's alone.
+
+#include <unistd.h>
+
+#include <algorithm>
+#include <chrono>
+#include <climits>
+#include <cstdint>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "common/common/logger.h"
+#include "common/common/thread.h"
+#include "common/common/utility.h"
+#include "common/event/libevent.h"
+#include "common/http/utility.h"
+
+#include "test/integration/http_integration.h"
+#include "test/test_common/environment.h"
+
+#include "benchmark/benchmark.h"
+#include "fmt/format.h"
+#include "gmock/gmock.h"
+
+#ifdef TCMALLOC
+#include "gperftools/malloc_hook.h"
+#endif
+
+namespace Envoy {
+namespace {
+
+// HTTP filter YAML from --http_filter, in the order given.
+std::vector<std::string> http_filters;
+// Non-matching routes from --routes.
+uint64_t extra_routes = 0;
+
+#ifdef TCMALLOC
+uint64_t allocations = 0;
+void countAllocation(const void*, size_t) { allocations++; }
+#endif
+
+class HttpE2eBenchmark : public HttpIntegrationTest {
+public:
+  HttpE2eBenchmark(Http::CodecClient::Type type)
+      : HttpIntegrationTest(type, TestEnvironment::getIpVersionsForTest().front()) {
+    autonomous_upstream_ = true;
+    setUpstreamProtocol(type == Http::CodecClient::Type::HTTP2 ? FakeHttpConnection::Type::HTTP2
+                                                               : FakeHttpConnection::Type::HTTP1);
+    // addFilter() puts each filter at the front of the chain.
+    for (auto filter = http_filters.rbegin(); filter != http_filters.rend(); filter++) {
+      config_helper_.addFilter(*filter);
+    }
+    if (extra_routes > 0) {
+      config_helper_.addConfigModifier(
+          [](envoy::api::v2::filter::network::HttpConnectionManager& hcm) -> void {
+            auto* virtual_host = hcm.mutable_route_config()->mutable_virtual_hosts(0);
+            for (uint64_t i = 0; i < extra_routes; i++) {
+              auto* route = virtual_host->add_routes();
+              route->mutable_match()->set_prefix(fmt::format("/route{}/", i));
+              route->mutable_route()->set_cluster("cluster_0");
+            }
+            // Move the catch-all route behind the new ones.
+            for (int i = 0; i < virtual_host->routes_size() - 1; i++) {
+              virtual_host->mutable_routes()->SwapElements(i, i + 1);
+            }
+          });
+    }
+    initialize();
+  }
+
+  ~HttpE2eBenchmark() {
+    drain();
+    for (IntegrationCodecClientPtr& client : clients_) {
+      client->close();
+    }
+    clients_.clear();
+    requests_.clear();
+  }
+
+  // Open connections, each with streams request slots.
+  void connect(uint32_t connections, uint32_t streams) {
+    for (uint32_t i = 0; i < connections; i++) {
+      clients_.push_back(makeHttpConnection(lookupPort("http")));
+      for (uint32_t j = 0; j < streams; j++) {
+        requests_.emplace_back(new Request(*this, *clients_.back()));
+        ready_.push_back(requests_.back().get());
+      }
+    }
+  }
+
+  // Start a request on every free slot and wait for at least one response.
+  // @return false if every request has failed, so that there is nothing left to wait for.
+  bool step() {
+    for (Request* request : ready_) {
+      request->start();
+    }
+    outstanding_ += ready_.size();
+    ready_.clear();
+    if (outstanding_ == 0) {
+      return false;
+    }
+    dispatcher_->run(Event::Dispatcher::RunType::Block);
+    return true;
+  }
+
+  // Wait for the requests in flight without starting more.
+  void drain() {
+    while (outstanding_ > 0) {
+      dispatcher_->run(Event::Dispatcher::RunType::Block);
+    }
+    ready_.clear();
+  }
+
+  uint64_t completed() const { return latencies_.size(); }
+  uint64_t errors() const { return errors_; }
+
+  // @return the latency in microseconds that percentile percent of the completed requests were
+  //         within.
+  uint64_t latency(uint32_t percentile) {
+    if (latencies_.empty()) {
+      return 0;
+    }
+    auto nth = latencies_.begin() + (latencies_.size() - 1) * percentile / 100;
+    std::nth_element(latencies_.begin(), nth, latencies_.end());
+    return *nth;
+  }
+
+private:
+  // A request slot: one stream at a time on a client connection.
+  class Request : public Http::StreamDecoder, public Http::StreamCallbacks {
+  public:
+    Request(HttpE2eBenchmark& parent, IntegrationCodecClient& client)
+        : parent_(parent), client_(client) {}
+
+    void start() {
+      start_time_ = std::chrono::steady_clock::now();
+      success_ = false;
+      Http::StreamEncoder& encoder = client_.newStream(*this);
+      encoder.getStream().addCallbacks(*this);
+      encoder.encodeHeaders(parent_.request_headers_, true);
+    }
+
+    // Http::StreamDecoder
+    void decodeHeaders(Http::HeaderMapPtr&& headers, bool end_stream) override {
+      success_ = Http::Utility::getResponseStatus(*headers) == 200;
+      if (end_stream) {
+        parent_.onComplete(*this, false);
+      }
+    }
+    void decodeData(Buffer::Instance&, bool end_stream) override {
+      if (end_stream) {
+        parent_.onComplete(*this, false);
+      }
+    }
+    void decodeTrailers(Http::HeaderMapPtr&&) override { parent_.onComplete(*this, false); }
+
+    // Http::StreamCallbacks
+    void onResetStream(Http::StreamResetReason) override { parent_.onComplete(*this, true); }
+    void onAboveWriteBufferHighWatermark() override {}
+    void onBelowWriteBufferLowWatermark() override {}
+
+    HttpE2eBenchmark& parent_;
+    IntegrationCodecClient& client_;
+    std::chrono::steady_clock::time_point start_time_;
+    bool success_{};
+  };
+
+  typedef std::unique_ptr<Request> RequestPtr;
+
+  // A slot whose stream was reset is not reused, since its connection may be gone.
+  void onComplete(Request& request, bool reset) {
+    outstanding_--;
+    if (reset || !request.success_) {
+      errors_++;
+    }
+    if (!reset) {
+      latencies_.push_back(std::chrono::duration_cast<std::chrono::microseconds>(
+                               std::chrono::steady_clock::now() - request.start_time_)
+                               .count());
+      ready_.push_back(&request);
+    }
+    dispatcher_->exit();
+  }
+
+  const Http::TestHeaderMapImpl request_headers_{
+      {":method", "GET"}, {":path", "/"}, {":scheme", "http"}, {":authority", "host"}};
+  std::vector<IntegrationCodecClientPtr> clients_;
+  std::vector<RequestPtr> requests_;
+  std::vector<Request*> ready_;
+  std::vector<uint64_t> latencies_;
+  uint64_t outstanding_{};
+  uint64_t errors_{};
+};
+
+void run(benchmark::State& state, Http::CodecClient::Type type) {
+  HttpE2eBenchmark envoy(type);
+  envoy.connect(state.range(0), state.range(1));
+#ifdef TCMALLOC
+  const uint64_t start_allocations = allocations;
+  MallocHook::AddNewHook(&countAllocation);
+#endif
+
+  for (auto _ : state) {
+    if (!envoy.step()) {
+      state.SkipWithError("every request failed");
+      break;
+    }
+  }
+
+#ifdef TCMALLOC
+  MallocHook::RemoveNewHook(&countAllocation);
+  state.counters["allocs_per_op"] = static_cast<double>(allocations - start_allocations) /
+                                    std::max<uint64_t>(envoy.completed(), 1);
+#endif
+  state.SetItemsProcessed(envoy.completed());
+  state.counters["p50_us"] = envoy.latency(50);
+  state.counters["p90_us"] = envoy.latency(90);
+  state.counters["p99_us"] = envoy.latency(99);
+  state.counters["errors"] = envoy.errors();
+}
+
+void http1(benchmark::State& state) { run(state, Http::CodecClient::Type::HTTP1); }
+BENCHMARK(http1)
+    ->Args({1, 1})
+    ->Args({16, 1})
+    ->Args({64, 1})
+    ->Unit(benchmark::kMicrosecond)
+    ->UseRealTime();
+
+void http2(benchmark::State& state) { run(state, Http::CodecClient::Type::HTTP2); }
+BENCHMARK(http2)
+    ->Args({1, 1})
+    ->Args({1, 16})
+    ->Args({16, 16})
+    ->Args({64, 1})
+    ->Unit(benchmark::kMicrosecond)
+    ->UseRealTime();
+
+// @return true if arg is --name=value, setting value.
+bool flag(const std::string& arg, const std::string& name, std::string& value) {
+  const std::string prefix = "--" + name + "=";
+  if (arg.compare(0, prefix.size(), prefix) != 0) {
+    return false;
+  }
+  value = arg.substr(prefix.size());
+  return true;
+}
+
+} // namespace
+} // namespace Envoy
+
+int main(int argc, char** argv) {
+  benchmark::Initialize(&argc, argv);
+  testing::InitGoogleMock(&argc, argv);
+  Envoy::Event::Libevent::Global::initialize();
+
+  // Take out the load flags, leaving Envoy options.
+  int remaining = 1;
+  for (int i = 1; i < argc; i++) {
+    std::string value;
+    if (Envoy::flag(argv[i], "http_filter", value)) {
+      std::ifstream file(value);
+      if (!file) {
+        std::cerr << "unable to read " << value << std::endl;
+        return 1;
+      }
+      std::stringstream contents;
+      contents << file.rdbuf();
+      Envoy::http_filters.push_back(contents.str());
+    } else if (Envoy::flag(argv[i], "routes", value)) {
+      if (!Envoy::StringUtil::atoul(value.c_str(), Envoy::extra_routes)) {
+        std::cerr << "invalid --routes " << value << std::endl;
+        return 1;
+      }
+    } else {
+      argv[remaining++] = argv[i];
+    }
+  }
+  argc = remaining;
+
+  // bazel run starts the binary in its runfiles directory, without the environment that bazel test
+  // provides.
+  char cwd[PATH_MAX];
+  if (::getcwd(cwd, sizeof(cwd)) != nullptr) {
+    ::setenv("TEST_RUNDIR", cwd, 0);
+  }
+  ::setenv("TEST_TMPDIR", "/tmp", 0);
+  ::setenv("TEST_UDSDIR", "/tmp", 0);
+
+  // The remaining arguments are Envoy options, e.g. -l to change the log level.
+  Envoy::TestEnvironment::initializeOptions(argc, argv);
+  Envoy::Thread::MutexBasicLockable lock;
+  Envoy::Logger::Registry::initialize(Envoy::TestEnvironment::getOptions().logLevel(), lock);
+
+  benchmark::RunSpecifiedBenchmarks();
+  return 0;
+}
@@ -0,0 +1,220 @@
+// Benchmarks for L4 proxying through a complete Envoy server. Run with an optimized build:
+//
+//   bazel run -c opt //test/benchmark:l4_proxy_benchmark -- [benchmark flags]
+//
+// Each benchmark starts an Envoy with a single listener through the integration test framework and
+// opens range(0) client connections to it. Every iteration writes range(1) bytes on each connection
+// and waits until all of them have come back, so the time of an iteration is the round trip latency
+// at that concurrency. The echo benchmarks use the envoy.echo filter. The tcp_proxy benchmarks go
+// through envoy.tcp_proxy to a FakeUpstream that echoes the data back, so they also cover the
+// upstream half of the network path. The tls variants terminate TLS on the listener; the upstream
+// connections are plaintext.
+//
+// Every benchmark reports bytes_per_second as the bytes written by the clients, so that echo and
+// tcp_proxy results compare directly. Envoy runs in the benchmark's process, so the results are
+// wall clock times.
+
+#include <unistd.h>
+
+#include <climits>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "common/buffer/buffer_impl.h"
+#include "common/common/logger.h"
+#include "common/common/thread.h"
+#include "common/event/libevent.h"
+#include "common/network/filter_impl.h"
+#include "common/network/utility.h"
+#include "common/ssl/context_manager_impl.h"
+
+#include "test/integration/integration.h"
+#include "test/integration/ssl_utility.h"
+#include "test/integration/utility.h"
+#include "test/mocks/runtime/mocks.h"
+#include "test/test_common/environment.h"
+#include "test/test_common/network_utility.h"
+
+#include "benchmark/benchmark.h"
+#include "fmt/format.h"
+#include "gmock/gmock.h"
+
+namespace Envoy {
+namespace {
+
+const std::string EchoConfig = ConfigHelper::BASE_CONFIG + R"EOF(
+    filter_chains:
+      filters:
+        name: envoy.echo
+        config:
+)EOF";
+
+// Counts the bytes that come back on a client connection, and stops the dispatcher once every
+// client has received what it is waiting for.
+class EchoReader : public Network::ReadFilterBaseImpl {
+public:
+  EchoReader(Event::Dispatcher& dispatcher, uint32_t& waiting)
+      : dispatcher_(dispatcher), waiting_(waiting) {}
+
+  void expect(uint64_t length) {
+    expected_ += length;
+    waiting_++;
+  }
+
+  // Network::ReadFilter
+  Network::FilterStatus onData(Buffer::Instance& data) override {
+    received_ += data.length();
+    data.drain(data.length());
+    if (received_ == expected_ && --waiting_ == 0) {
+      dispatcher_.exit();
+    }
+    return Network::FilterStatus::StopIteration;
+  }
+
+private:
+  Event::Dispatcher& dispatcher_;
+  uint32_t& waiting_;
+  uint64_t expected_{};
+  uint64_t received_{};
+};
+
+class L4ProxyBenchmark : public BaseIntegrationTest {
+public:
+  L4ProxyBenchmark(bool tcp_proxy, bool tls)
+      : BaseIntegrationTest(TestEnvironment::getIpVersionsForTest().front(),
+                            tcp_proxy ? ConfigHelper::TCP_PROXY_CONFIG : EchoConfig),
+        tcp_proxy_(tcp_proxy), context_manager_(runtime_) {
+    named_ports_ = {{"listener"}};
+    if (tls) {
+      config_helper_.addSslConfig();
+      client_ssl_context_ =
+          Ssl::createClientSslTransportSocketFactory(false, false, context_manager_);
+    }
+    initialize();
+  }
+
+  ~L4ProxyBenchmark() {
+    for (Network::ClientConnectionPtr& client : clients_) {
+      client->close(Network::ConnectionCloseType::NoFlush);
+    }
+    for (FakeRawConnectionPtr& upstream : upstreams_) {
+      upstream->waitForDisconnect(true);
+    }
+    clients_.clear();
+    upstreams_.clear();
+    test_server_.reset();
+    fake_upstreams_.clear();
+  }
+
+  void connect(uint32_t connections) {
+    std::vector<ConnectionStatusCallbacks> status(connections);
+    for (uint32_t i = 0; i < connections; i++) {
+      Network::TransportSocketPtr transport_socket =
+          client_ssl_context_ != nullptr ? client_ssl_context_->createTransportSocket()
+                                         : Network::Test::createRawBufferSocket();
+      clients_.push_back(dispatcher_->createClientConnection(
+          Network::Utility::resolveUrl(fmt::format(
+              "tcp://{}:{}", Network::Test::getLoopbackAddressUrlString(version_),
+              lookupPort("listener"))),
+          Network::Address::InstanceConstSharedPtr(), std::move(transport_socket)));
+      readers_.push_back(std::make_shared<EchoReader>(*dispatcher_, waiting_));
+      clients_.back()->addReadFilter(readers_.back());
+      clients_.back()->addConnectionCallbacks(status[i]);
+      clients_.back()->connect();
+    }
+
+    for (uint32_t i = 0; i < connections; i++) {
+      while (!status[i].connected()) {
+        dispatcher_->run(Event::Dispatcher::RunType::NonBlock);
+      }
+      clients_[i]->removeConnectionCallbacks(status[i]);
+    }
+
+    if (tcp_proxy_) {
+      for (uint32_t i = 0; i < connections; i++) {
+        upstreams_.push_back(fake_upstreams_[0]->waitForRawConnection());
+        upstreams_.back()->echo();
+      }
+    }
+  }
+
+  // Write chunk on every client connection and wait until all of it has come back.
+  void roundTrip(const std::string& chunk) {
+    for (uint32_t i = 0; i < clients_.size(); i++) {
+      readers_[i]->expect(chunk.size());
+      Buffer::OwnedImpl buffer(chunk);
+      clients_[i]->write(buffer);
+    }
+    dispatcher_->run(Event::Dispatcher::RunType::Block);
+  }
+
+private:
+  const bool tcp_proxy_;
+  testing::NiceMock<Runtime::MockLoader> runtime_;
+  Ssl::ContextManagerImpl context_manager_;
+  Network::TransportSocketFactoryPtr client_ssl_context_;
+  std::vector<Network::ClientConnectionPtr> clients_;
+  std::vector<std::shared_ptr<EchoReader>> readers_;
+  std::vector<FakeRawConnectionPtr> upstreams_;
+  uint32_t waiting_{};
+};
+
+void run(benchmark::State& state, bool tcp_proxy, bool tls) {
+  L4ProxyBenchmark proxy(tcp_proxy, tls);
+  proxy.connect(state.range(0));
+  const std::string chunk(state.range(1), 'a');
+
+  for (auto _ : state) {
+    proxy.roundTrip(chunk);
+  }
+
+  state.SetBytesProcessed(state.iterations() * state.range(0) * state.range(1));
+}
+
+void echo(benchmark::State& state) { run(state, false, false); }
+void echoTls(benchmark::State& state) { run(state, false, true); }
+void tcpProxy(benchmark::State& state) { run(state, true, false); }
+void tcpProxyTls(benchmark::State& state) { run(state, true, true); }
+
+// Connections, then bytes written on each connection per round trip.
+void arguments(benchmark::internal::Benchmark* benchmark) {
+  for (int connections : {1, 16, 128}) {
+    for (int chunk : {1024, 64 * 1024}) {
+      benchmark->Args({connections, chunk});
+    }
+  }
+  benchmark->Unit(benchmark::kMicrosecond)->UseRealTime();
+}
+
+BENCHMARK(echo)->Apply(arguments);
+BENCHMARK(echoTls)->Apply(arguments);
+BENCHMARK(tcpProxy)->Apply(arguments);
+BENCHMARK(tcpProxyTls)->Apply(arguments);
+
+} // namespace
+} // namespace Envoy
+
+int main(int argc, char** argv) {
+  benchmark::Initialize(&argc, argv);
+  testing::InitGoogleMock(&argc, argv);
+  Envoy::Event::Libevent::Global::initialize();
+
+  // bazel run starts the binary in its runfiles directory, where the integration test framework
+  // finds its certificates, but without the environment that bazel test provides.
+  char cwd[PATH_MAX];
+  if (::getcwd(cwd, sizeof(cwd)) != nullptr) {
+    ::setenv("TEST_RUNDIR", cwd, 0);
+  }
+  ::setenv("TEST_TMPDIR", "/tmp", 0);
+  ::setenv("TEST_UDSDIR", "/tmp", 0);
+
+  // The remaining arguments are Envoy options, e.g. -l to change the log level.
+  Envoy::TestEnvironment::initializeOptions(argc, argv);
+  Envoy::Thread::MutexBasicLockable lock;
+  Envoy::Logger::Registry::initialize(Envoy::TestEnvironment::getOptions().logLevel(), lock);
+
+  benchmark::RunSpecifiedBenchmarks();
+  return 0;
+}
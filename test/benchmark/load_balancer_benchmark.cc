@@ -0,0 +1,315 @@
+// Microbenchmarks for the load balancers. Run with an optimized build:
+//
+//   bazel run -c opt //test/benchmark:load_balancer_benchmark
+//
+// The chooseHost benchmarks take the number of hosts as their first parameter, and whether the
+// hosts have weights (of 1 to 8) as their second. The zone aware benchmark takes the number of
+// localities as its second parameter instead, with as many local Envoys in each locality, except
+// for the local one that has twice as many, so that a share of the requests is routed across
+// localities. The build benchmarks measure creating the load balancer and its lookup structures
+// for a host set, and the time a host set update takes to rebuild them. Benchmarks that build a
+// load balancer report the heap memory it holds as lb_bytes.
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "common/config/metadata.h"
+#include "common/config/well_known_names.h"
+#include "common/memory/stats.h"
+#include "common/network/utility.h"
+#include "common/protobuf/utility.h"
+#include "common/runtime/runtime_impl.h"
+#include "common/stats/stats_impl.h"
+#include "common/upstream/load_balancer_impl.h"
+#include "common/upstream/ring_hash_lb.h"
+#include "common/upstream/subset_lb.h"
+#include "common/upstream/upstream_impl.h"
+
+#include "test/mocks/upstream/mocks.h"
+
+#include "api/cds.pb.h"
+#include "benchmark/benchmark.h"
+#include "fmt/format.h"
+#include "gmock/gmock.h"
+
+using testing::NiceMock;
+
+namespace Envoy {
+namespace Upstream {
+namespace {
+
+// The number of different values of the version metadata of the hosts, which the subset load
+// balancer splits the hosts by.
+const uint32_t NumVersions = 4;
+
+class HashLoadBalancerContext : public LoadBalancerContext {
+public:
+  // Upstream::LoadBalancerContext
+  Optional<uint64_t> computeHashKey() override { return hash_key_++; }
+  const Router::MetadataMatchCriteria* metadataMatchCriteria() const override { return nullptr; }
+  const Network::Connection* downstreamConnection() const override { return nullptr; }
+
+  uint64_t hash_key_{};
+};
+
+class VersionMatchCriterion : public Router::MetadataMatchCriterion {
+public:
+  VersionMatchCriterion(const HashedValue& value) : value_(value) {}
+
+  // Router::MetadataMatchCriterion
+  const std::string& name() const override { return name_; }
+  const HashedValue& value() const override { return value_; }
+
+private:
+  const std::string name_{"version"};
+  const HashedValue value_;
+};
+
+class VersionMatchCriteria : public Router::MetadataMatchCriteria {
+public:
+  VersionMatchCriteria(const std::string& version) {
+    ProtobufWkt::Value value;
+    value.set_string_value(version);
+    criteria_.emplace_back(new VersionMatchCriterion(HashedValue(value)));
+  }
+
+  // Router::MetadataMatchCriteria
+  const std::vector<Router::MetadataMatchCriterionConstSharedPtr>&
+  metadataMatchCriteria() const override {
+    return criteria_;
+  }
+
+private:
+  std::vector<Router::MetadataMatchCriterionConstSharedPtr> criteria_;
+};
+
+class VersionLoadBalancerContext : public LoadBalancerContext {
+public:
+  VersionLoadBalancerContext(const std::string& version) : criteria_(version) {}
+
+  // Upstream::LoadBalancerContext
+  Optional<uint64_t> computeHashKey() override { return {}; }
+  const Router::MetadataMatchCriteria* metadataMatchCriteria() const override {
+    return &criteria_;
+  }
+  const Network::Connection* downstreamConnection() const override { return nullptr; }
+
+private:
+  const VersionMatchCriteria criteria_;
+};
+
+/**
+ * Cluster state the load balancers are built for: the hosts of priority 0 of the cluster, and
+ * optionally the local Envoys.
+ */
+class Tester {
+public:
+  Tester() : stats_(ClusterInfoImpl::generateStats(stats_store_)), runtime_(random_) {}
+
+  /**
+   * Fill P=0 with hosts spread round robin over the localities. Hosts get versions round robin as
+   * well.
+   */
+  void addHosts(uint32_t num_hosts, bool weighted, uint32_t num_localities) {
+    HostVectorSharedPtr hosts(new std::vector<HostSharedPtr>());
+    HostListsSharedPtr per_locality(new std::vector<std::vector<HostSharedPtr>>(num_localities));
+    for (uint32_t i = 0; i < num_hosts; i++) {
+      envoy::api::v2::Metadata metadata;
+      Config::Metadata::mutableMetadataValue(metadata, Config::MetadataFilters::get().ENVOY_LB,
+                                             "version")
+          .set_string_value("v" + std::to_string(i % NumVersions));
+      envoy::api::v2::Locality locality;
+      locality.set_zone("zone" + std::to_string(i % num_localities));
+      hosts->emplace_back(new HostImpl(info_, "", address(i), metadata,
+                                       weighted ? 1 + i % 8 : 1, locality));
+      (*per_locality)[i % num_localities].push_back(hosts->back());
+    }
+    if (num_localities == 1) {
+      per_locality->clear();
+    }
+    hosts_ = hosts;
+    hosts_per_locality_ = per_locality;
+    update();
+  }
+
+  /**
+   * Fill the local priority set with the given number of Envoys in each locality, and twice as
+   * many in the first one, the local locality.
+   */
+  void addLocalHosts(uint32_t per_locality_hosts, uint32_t num_localities) {
+    local_priority_set_.reset(new PrioritySetImpl());
+    HostVectorSharedPtr hosts(new std::vector<HostSharedPtr>());
+    HostListsSharedPtr per_locality(new std::vector<std::vector<HostSharedPtr>>(num_localities));
+    uint32_t port = 0;
+    for (uint32_t locality = 0; locality < num_localities; locality++) {
+      const uint32_t locality_hosts = locality == 0 ? 2 * per_locality_hosts : per_locality_hosts;
+      for (uint32_t i = 0; i < locality_hosts; i++) {
+        hosts->emplace_back(new HostImpl(info_, "", address(port++),
+                                         envoy::api::v2::Metadata::default_instance(), 1,
+                                         envoy::api::v2::Locality::default_instance()));
+        (*per_locality)[locality].push_back(hosts->back());
+      }
+    }
+    local_priority_set_->getOrCreateHostSet(0).updateHosts(hosts, hosts, per_locality,
+                                                           per_locality, *hosts, {});
+  }
+
+  /**
+   * Update P=0 with the same hosts, which rebuilds the structures of the load balancers.
+   */
+  void update() {
+    priority_set_.getOrCreateHostSet(0).updateHosts(hosts_, hosts_, hosts_per_locality_,
+                                                    hosts_per_locality_, {}, {});
+  }
+
+  Network::Address::InstanceConstSharedPtr address(uint32_t i) {
+    return Network::Utility::resolveUrl(fmt::format("tcp://10.{}.{}.{}:80", (i >> 16) & 0xff,
+                                                    (i >> 8) & 0xff, i & 0xff));
+  }
+
+  std::shared_ptr<MockClusterInfo> info_{new NiceMock<MockClusterInfo>()};
+  Stats::IsolatedStoreImpl stats_store_;
+  ClusterStats stats_;
+  Runtime::RandomGeneratorImpl random_;
+  Runtime::NullLoaderImpl runtime_;
+  PrioritySetImpl priority_set_;
+  std::unique_ptr<PrioritySetImpl> local_priority_set_;
+  HostVectorSharedPtr hosts_;
+  HostListsSharedPtr hosts_per_locality_;
+};
+
+// 10 to 100k hosts, without and with weights.
+void hostArgs(benchmark::internal::Benchmark* benchmark) {
+  for (int64_t num_hosts = 10; num_hosts <= 100000; num_hosts *= 10) {
+    benchmark->Args({num_hosts, 0});
+    benchmark->Args({num_hosts, 1});
+  }
+}
+
+template <class Lb> void chooseHost(benchmark::State& state) {
+  Tester tester;
+  tester.addHosts(state.range(0), state.range(1) != 0, 1);
+  const uint64_t allocated = Memory::Stats::totalCurrentlyAllocated();
+  Lb lb(tester.priority_set_, nullptr, tester.stats_, tester.runtime_, tester.random_);
+  state.counters["lb_bytes"] = Memory::Stats::totalCurrentlyAllocated() - allocated;
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(lb.chooseHost(nullptr));
+  }
+}
+
+template <class Lb> void rebuild(benchmark::State& state) {
+  Tester tester;
+  tester.addHosts(state.range(0), state.range(1) != 0, 1);
+  Lb lb(tester.priority_set_, nullptr, tester.stats_, tester.runtime_, tester.random_);
+  for (auto _ : state) {
+    tester.update();
+  }
+}
+
+void roundRobinChooseHost(benchmark::State& state) { chooseHost<RoundRobinLoadBalancer>(state); }
+BENCHMARK(roundRobinChooseHost)->Apply(hostArgs);
+
+void leastRequestChooseHost(benchmark::State& state) {
+  chooseHost<LeastRequestLoadBalancer>(state);
+}
+BENCHMARK(leastRequestChooseHost)->Apply(hostArgs);
+
+void randomChooseHost(benchmark::State& state) { chooseHost<RandomLoadBalancer>(state); }
+BENCHMARK(randomChooseHost)->Apply(hostArgs);
+
+void roundRobinRebuild(benchmark::State& state) { rebuild<RoundRobinLoadBalancer>(state); }
+BENCHMARK(roundRobinRebuild)->Apply(hostArgs)->Unit(benchmark::kMicrosecond);
+
+void leastRequestRebuild(benchmark::State& state) { rebuild<LeastRequestLoadBalancer>(state); }
+BENCHMARK(leastRequestRebuild)->Apply(hostArgs)->Unit(benchmark::kMicrosecond);
+
+void roundRobinZoneAwareChooseHost(benchmark::State& state) {
+  Tester tester;
+  const uint32_t num_localities = state.range(1);
+  tester.addLocalHosts(2, num_localities);
+  tester.addHosts(state.range(0), false, num_localities);
+  RoundRobinLoadBalancer lb(tester.priority_set_, tester.local_priority_set_.get(), tester.stats_,
+                            tester.runtime_, tester.random_);
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(lb.chooseHost(nullptr));
+  }
+  state.counters["cross_zone"] = tester.stats_.lb_zone_routing_cross_zone_.value();
+}
+BENCHMARK(roundRobinZoneAwareChooseHost)
+    ->Args({100, 3})
+    ->Args({10000, 3})
+    ->Args({10000, 30})
+    ->Args({100000, 30});
+
+void ringHashChooseHost(benchmark::State& state) {
+  Tester tester;
+  tester.addHosts(state.range(0), false, 1);
+  const uint64_t allocated = Memory::Stats::totalCurrentlyAllocated();
+  RingHashLoadBalancer lb(tester.priority_set_, tester.stats_, tester.runtime_, tester.random_,
+                          Optional<envoy::api::v2::Cluster::RingHashLbConfig>());
+  lb.initialize();
+  LoadBalancerPtr worker_lb = lb.factory()->create();
+  state.counters["lb_bytes"] = Memory::Stats::totalCurrentlyAllocated() - allocated;
+  HashLoadBalancerContext context;
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(worker_lb->chooseHost(&context));
+  }
+}
+BENCHMARK(ringHashChooseHost)->RangeMultiplier(10)->Range(10, 100000);
+
+void ringHashBuild(benchmark::State& state) {
+  Tester tester;
+  tester.addHosts(state.range(0), false, 1);
+  for (auto _ : state) {
+    RingHashLoadBalancer lb(tester.priority_set_, tester.stats_, tester.runtime_, tester.random_,
+                            Optional<envoy::api::v2::Cluster::RingHashLbConfig>());
+    lb.initialize();
+  }
+}
+BENCHMARK(ringHashBuild)->RangeMultiplier(10)->Range(10, 100000)->Unit(benchmark::kMillisecond);
+
+std::unique_ptr<SubsetLoadBalancer> subsetLoadBalancer(Tester& tester,
+                                                     const LoadBalancerSubsetInfo& subset_info) {
+  return std::unique_ptr<SubsetLoadBalancer>(new SubsetLoadBalancer(
+      LoadBalancerType::RoundRobin, tester.priority_set_, nullptr, tester.stats_, tester.runtime_,
+      tester.random_, subset_info, Optional<envoy::api::v2::Cluster::RingHashLbConfig>()));
+}
+
+envoy::api::v2::Cluster::LbSubsetConfig versionSubsetConfig() {
+  envoy::api::v2::Cluster::LbSubsetConfig subset_config;
+  subset_config.set_fallback_policy(envoy::api::v2::Cluster::LbSubsetConfig::ANY_ENDPOINT);
+  subset_config.add_subset_selectors()->add_keys("version");
+  return subset_config;
+}
+
+void subsetChooseHost(benchmark::State& state) {
+  Tester tester;
+  tester.addHosts(state.range(0), state.range(1) != 0, 1);
+  LoadBalancerSubsetInfoImpl subset_info(versionSubsetConfig());
+  const uint64_t allocated = Memory::Stats::totalCurrentlyAllocated();
+  std::unique_ptr<SubsetLoadBalancer> lb = subsetLoadBalancer(tester, subset_info);
+  state.counters["lb_bytes"] = Memory::Stats::totalCurrentlyAllocated() - allocated;
+  VersionLoadBalancerContext context("v1");
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(lb->chooseHost(&context));
+  }
+}
+BENCHMARK(subsetChooseHost)->Apply(hostArgs);
+
+void subsetBuild(benchmark::State& state) {
+  Tester tester;
+  tester.addHosts(state.range(0), false, 1);
+  LoadBalancerSubsetInfoImpl subset_info(versionSubsetConfig());
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(subsetLoadBalancer(tester, subset_info));
+  }
+}
+BENCHMARK(subsetBuild)->RangeMultiplier(10)->Range(10, 100000)->Unit(benchmark::kMillisecond);
+
+} // namespace
+} // namespace Upstream
+} // namespace Envoy
+
+BENCHMARK_MAIN();
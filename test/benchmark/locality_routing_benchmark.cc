@@ -0,0 +1,76 @@
+// Microbenchmark for zone aware host selection. Run with an optimized build:
+//
+//   bazel run -c opt //test/benchmark:locality_routing_benchmark
+//
+// The benchmark takes the number of localities as its parameter. Every Envoy of the local cluster
+// is in a locality of its own, and the upstream cluster has a single host in the local locality
+// and four in each of the others, so most requests are routed across localities, picking a
+// locality in proportion to its residual capacity.
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "common/runtime/runtime_impl.h"
+#include "common/stats/stats_impl.h"
+#include "common/upstream/load_balancer_impl.h"
+#include "common/upstream/upstream_impl.h"
+
+#include "test/common/upstream/utility.h"
+#include "test/mocks/upstream/mocks.h"
+
+#include "benchmark/benchmark.h"
+#include "gmock/gmock.h"
+
+using testing::NiceMock;
+
+namespace Envoy {
+namespace Upstream {
+namespace {
+
+// Fills a host set with the given number of hosts per locality.
+void addHosts(ClusterInfoConstSharedPtr info, HostSet& host_set,
+              const std::vector<uint32_t>& hosts_per_locality, uint32_t& port) {
+  HostVectorSharedPtr hosts(new std::vector<HostSharedPtr>());
+  HostListsSharedPtr per_locality(new std::vector<std::vector<HostSharedPtr>>());
+  for (uint32_t locality_hosts : hosts_per_locality) {
+    per_locality->emplace_back();
+    for (uint32_t i = 0; i < locality_hosts; i++) {
+      hosts->push_back(makeTestHost(info, "tcp://127.0.0.1:" + std::to_string(port++)));
+      per_locality->back().push_back(hosts->back());
+    }
+  }
+  host_set.updateHosts(hosts, hosts, per_locality, per_locality, *hosts, {});
+}
+
+void zoneAwareChooseHost(benchmark::State& state) {
+  const uint32_t num_localities = state.range(0);
+  std::shared_ptr<MockClusterInfo> info{new NiceMock<MockClusterInfo>()};
+  Stats::IsolatedStoreImpl stats_store;
+  ClusterStats stats = ClusterInfoImpl::generateStats(stats_store);
+  Runtime::RandomGeneratorImpl random;
+  Runtime::NullLoaderImpl runtime(random);
+
+  uint32_t port = 1000;
+  PrioritySetImpl priority_set;
+  std::vector<uint32_t> upstream_hosts(num_localities, 4);
+  upstream_hosts[0] = 1;
+  addHosts(info, priority_set.getOrCreateHostSet(0), upstream_hosts, port);
+  PrioritySetImpl local_priority_set;
+  addHosts(info, local_priority_set.getOrCreateHostSet(0), std::vector<uint32_t>(num_localities, 1),
+           port);
+
+  RoundRobinLoadBalancer lb(priority_set, &local_priority_set, stats, runtime, random);
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(lb.chooseHost(nullptr));
+  }
+  state.counters["cross_zone"] = stats.lb_zone_routing_cross_zone_.value();
+}
+BENCHMARK(zoneAwareChooseHost)->Arg(3)->Arg(16)->Arg(64)->Arg(256);
+
+} // namespace
+} // namespace Upstream
+} // namespace Envoy
+
+BENCHMARK_MAIN();
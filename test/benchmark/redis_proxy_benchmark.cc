@@ -0,0 +1,303 @@
+// Benchmarks for the Redis proxy request path. Run with an optimized build:
+//
+//   bazel run -c opt //test/benchmark:redis_proxy_benchmark -- [benchmark flags] [traffic...]
+//
+// Each benchmark feeds RESP requests through DecoderImpl, CommandSplitter::InstanceImpl and
+// EncoderImpl the way ProxyFilter does, against a connection pool that answers every request as
+// soon as the read that carried it has been split, as an upstream on the same host would. The
+// synthetic benchmarks take the number of requests per read (the pipeline depth) as their
+// parameter, and mgetRequest the number of keys. Each file given on the command line holds
+// recorded client traffic, the raw bytes a client wrote, and adds a benchmark that replays it in
+// reads of ReadSize bytes.
+//
+// Every benchmark reports items_per_second as requests per second and, with tcmalloc,
+// allocs_per_op as heap allocations per request.
+
+#include <algorithm>
+#include <cstdint>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <list>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "common/buffer/buffer_impl.h"
+#include "common/common/utility.h"
+#include "common/redis/codec_impl.h"
+#include "common/redis/command_splitter_impl.h"
+#include "common/stats/stats_impl.h"
+
+#include "benchmark/benchmark.h"
+
+#ifdef TCMALLOC
+#include "gperftools/malloc_hook.h"
+#endif
+
+namespace Envoy {
+namespace Redis {
+namespace {
+
+// The upstream servers the keys are spread over.
+const uint64_t Servers = 4;
+// The size of the reads recorded traffic is replayed in.
+const uint64_t ReadSize = 16 * 1024;
+
+std::string key(uint64_t i) { return "user:" + std::to_string(i % 10000) + ":profile"; }
+
+/**
+ * A connection pool that answers each request with a response of the expected type once
+ * respond() is called. GET returns a 64 byte value, MGET one per key, SET OK and any other
+ * command an integer.
+ */
+class FakeConnPool : public ConnPool::Instance {
+public:
+  // Redis::ConnPool::Instance
+  ConnPool::PoolRequest* makeRequest(const std::string&, const RespValue& request,
+                                     ConnPool::PoolCallbacks& callbacks) override {
+    const char* command = request.asArray()[0].asString().c_str();
+    RespValuePtr response(new RespValue());
+    if (StringUtil::caseInsensitiveCompare(command, "get") == 0) {
+      response->type(RespType::BulkString);
+      response->asString() = value_;
+    } else if (StringUtil::caseInsensitiveCompare(command, "mget") == 0) {
+      response->type(RespType::Array);
+      response->asArray().resize(request.asArray().size() - 1);
+      for (RespValue& value : response->asArray()) {
+        value.type(RespType::BulkString);
+        value.asString() = value_;
+      }
+    } else if (StringUtil::caseInsensitiveCompare(command, "set") == 0 ||
+               StringUtil::caseInsensitiveCompare(command, "mset") == 0) {
+      response->type(RespType::SimpleString);
+      response->asString() = "OK";
+    } else {
+      response->type(RespType::Integer);
+      response->asInteger() = 1;
+    }
+    pending_.push_back({&callbacks, std::move(response)});
+    return &request_;
+  }
+  uint64_t keyGroup(const std::string& hash_key) override {
+    return std::hash<std::string>()(hash_key) % Servers;
+  }
+
+  void respond() {
+    for (PendingResponse& pending : pending_) {
+      pending.callbacks_->onResponse(std::move(pending.response_));
+    }
+    pending_.clear();
+  }
+
+private:
+  struct NullPoolRequest : public ConnPool::PoolRequest {
+    // Redis::ConnPool::PoolRequest
+    void cancel() override {}
+  };
+
+  struct PendingResponse {
+    ConnPool::PoolCallbacks* callbacks_;
+    RespValuePtr response_;
+  };
+
+  const std::string value_ = std::string(64, 'v');
+  NullPoolRequest request_;
+  std::vector<PendingResponse> pending_;
+};
+
+/**
+ * The request path of ProxyFilter without a connection: requests are decoded, split and their
+ * responses encoded in order into a buffer.
+ */
+class Proxy : public DecoderCallbacks {
+public:
+  Proxy()
+      : conn_pool_(new FakeConnPool()), fake_conn_pool_(*conn_pool_),
+        splitter_(ConnPool::InstancePtr{conn_pool_}, store_, "redis.bench.") {}
+
+  // Process one read of client traffic, including the responses of the connection pool.
+  void onData(Buffer::Instance& data) {
+    decoder_.decode(data);
+    fake_conn_pool_.respond();
+    output_.drain(output_.length());
+  }
+
+  uint64_t requests() const { return requests_; }
+
+  // Redis::DecoderCallbacks
+  void onRespValue(RespValuePtr&& value) override {
+    requests_++;
+    pending_requests_.emplace_back(*this);
+    PendingRequest& request = pending_requests_.back();
+    CommandSplitter::SplitRequestPtr split = splitter_.makeRequest(*value, request);
+    if (split) {
+      request.request_handle_ = std::move(split);
+    }
+  }
+
+private:
+  struct PendingRequest : public CommandSplitter::SplitCallbacks {
+    PendingRequest(Proxy& parent) : parent_(parent) {}
+
+    // Redis::CommandSplitter::SplitCallbacks
+    void onResponse(RespValuePtr&& value) override { parent_.onResponse(*this, std::move(value)); }
+
+    Proxy& parent_;
+    RespValuePtr pending_response_;
+    CommandSplitter::SplitRequestPtr request_handle_;
+  };
+
+  void onResponse(PendingRequest& request, RespValuePtr&& value) {
+    request.pending_response_ = std::move(value);
+    request.request_handle_ = nullptr;
+    while (!pending_requests_.empty() && pending_requests_.front().pending_response_) {
+      encoder_.encode(*pending_requests_.front().pending_response_, output_);
+      pending_requests_.pop_front();
+    }
+  }
+
+  Stats::IsolatedStoreImpl store_;
+  FakeConnPool* conn_pool_;
+  FakeConnPool& fake_conn_pool_;
+  CommandSplitter::InstanceImpl splitter_;
+  DecoderImpl decoder_{*this};
+  EncoderImpl encoder_;
+  Buffer::OwnedImpl output_;
+  std::list<PendingRequest> pending_requests_;
+  uint64_t requests_{};
+};
+
+#ifdef TCMALLOC
+uint64_t allocations = 0;
+void countAllocation(const void*, size_t) { allocations++; }
+#endif
+
+// Encode commands into the raw bytes a client would write.
+std::string encode(const std::vector<std::vector<std::string>>& commands) {
+  EncoderImpl encoder;
+  Buffer::OwnedImpl buffer;
+  for (const std::vector<std::string>& command : commands) {
+    RespValue value;
+    value.type(RespType::Array);
+    value.asArray().resize(command.size());
+    for (size_t i = 0; i < command.size(); i++) {
+      value.asArray()[i].type(RespType::BulkString);
+      value.asArray()[i].asString() = command[i];
+    }
+    encoder.encode(value, buffer);
+  }
+
+  std::string bytes(buffer.length(), 0);
+  buffer.copyOut(0, buffer.length(), &bytes[0]);
+  return bytes;
+}
+
+/**
+ * Replay reads of client traffic through a proxy.
+ */
+void replay(benchmark::State& state, const std::vector<std::string>& reads) {
+  Proxy proxy;
+  Buffer::OwnedImpl data;
+#ifdef TCMALLOC
+  const uint64_t start_allocations = allocations;
+  MallocHook::AddNewHook(&countAllocation);
+#endif
+
+  for (auto _ : state) {
+    for (const std::string& read : reads) {
+      data.add(read);
+      proxy.onData(data);
+    }
+  }
+
+#ifdef TCMALLOC
+  MallocHook::RemoveNewHook(&countAllocation);
+  state.counters["allocs_per_op"] = static_cast<double>(allocations - start_allocations) /
+                                    std::max<uint64_t>(proxy.requests(), 1);
+#endif
+  state.SetItemsProcessed(proxy.requests());
+}
+
+// One read carrying state.range(0) requests made by next(i).
+template <class Generator> void pipeline(benchmark::State& state, Generator next) {
+  std::vector<std::vector<std::string>> commands;
+  for (int64_t i = 0; i < state.range(0); i++) {
+    commands.push_back(next(i));
+  }
+  replay(state, {encode(commands)});
+}
+
+void getRequest(benchmark::State& state) {
+  pipeline(state, [](int64_t i) -> std::vector<std::string> { return {"GET", key(i)}; });
+}
+BENCHMARK(getRequest)->Arg(1)->Arg(16)->Arg(128);
+
+void setRequest(benchmark::State& state) {
+  pipeline(state, [](int64_t i) -> std::vector<std::string> {
+    return {"SET", key(i), std::string(64, 'v')};
+  });
+}
+BENCHMARK(setRequest)->Arg(1)->Arg(16)->Arg(128);
+
+// 80% GET, 15% SET and 5% MGET of 10 keys.
+void mixedRequest(benchmark::State& state) {
+  pipeline(state, [](int64_t i) -> std::vector<std::string> {
+    if (i % 20 == 19) {
+      std::vector<std::string> command{"MGET"};
+      for (int64_t j = 0; j < 10; j++) {
+        command.push_back(key(i * 10 + j));
+      }
+      return command;
+    }
+    if (i % 20 >= 16) {
+      return {"SET", key(i), std::string(64, 'v')};
+    }
+    return {"GET", key(i)};
+  });
+}
+BENCHMARK(mixedRequest)->Arg(1)->Arg(16)->Arg(128);
+
+void mgetRequest(benchmark::State& state) {
+  std::vector<std::string> command{"MGET"};
+  for (int64_t i = 0; i < state.range(0); i++) {
+    command.push_back(key(i));
+  }
+  replay(state, {encode({command})});
+}
+BENCHMARK(mgetRequest)->Arg(10)->Arg(100)->Arg(1000);
+
+} // namespace
+} // namespace Redis
+} // namespace Envoy
+
+int main(int argc, char** argv) {
+  benchmark::Initialize(&argc, argv);
+
+  // The arguments left after the benchmark flags are files of recorded client traffic.
+  for (int i = 1; i < argc; i++) {
+    const std::string path = argv[i];
+    std::ifstream file(path, std::ios::binary);
+    if (!file) {
+      std::cerr << "unable to read " << path << std::endl;
+      return 1;
+    }
+    std::stringstream contents;
+    contents << file.rdbuf();
+
+    std::shared_ptr<std::vector<std::string>> reads = std::make_shared<std::vector<std::string>>();
+    const std::string traffic = contents.str();
+    for (size_t offset = 0; offset < traffic.size(); offset += Envoy::Redis::ReadSize) {
+      reads->push_back(traffic.substr(offset, Envoy::Redis::ReadSize));
+    }
+
+    benchmark::RegisterBenchmark(("recorded/" + path).c_str(),
+                                 [reads](benchmark::State& state) {
+                                   Envoy::Redis::replay(state, *reads);
+                                 });
+  }
+
+  benchmark::RunSpecifiedBenchmarks();
+  return 0;
+}
@@ -0,0 +1,238 @@
+// Benchmarks for route table construction and lookup. Run with an optimized build:
+//
+//   bazel run -c opt //test/benchmark:router_benchmark -- [benchmark flags] [route configs...]
+//
+// The synthetic benchmarks take the number of virtual hosts as their parameter. Each virtual host
+// has an exact domain, every fourth one a wildcard domain as well, and a mix of prefix, path,
+// regex and header constrained routes ending with a catch all. Each route config file given on the
+// command line (a v2 RouteConfiguration in JSON or YAML) adds benchmarks of its own, with requests
+// generated from its domains and route matchers.
+//
+// routeLookup measures ConfigImpl::route() over a fixed set of requests and reports the heap
+// memory held by the route table as config_bytes. configBuild measures ConfigImpl construction.
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "common/memory/stats.h"
+#include "common/protobuf/utility.h"
+#include "common/router/config_impl.h"
+#include "common/runtime/runtime_impl.h"
+
+#include "test/mocks/upstream/mocks.h"
+#include "test/test_common/utility.h"
+
+#include "api/rds.pb.h"
+#include "benchmark/benchmark.h"
+#include "gmock/gmock.h"
+
+using testing::NiceMock;
+
+namespace Envoy {
+namespace Router {
+namespace {
+
+// The routes of each synthetic virtual host, before the catch all.
+const int64_t RoutesPerVirtualHost = 24;
+// The most requests generated for a route configuration.
+const size_t MaxRequests = 1024;
+
+std::string domain(int64_t i) { return "svc" + std::to_string(i) + ".example.com"; }
+
+envoy::api::v2::RouteConfiguration syntheticConfig(int64_t num_virtual_hosts) {
+  envoy::api::v2::RouteConfiguration config;
+  for (int64_t i = 0; i < num_virtual_hosts; i++) {
+    auto* virtual_host = config.add_virtual_hosts();
+    virtual_host->set_name("vhost" + std::to_string(i));
+    virtual_host->add_domains(domain(i));
+    if (i % 4 == 0) {
+      virtual_host->add_domains("*.tenant" + std::to_string(i) + ".example.com");
+    }
+
+    for (int64_t j = 0; j < RoutesPerVirtualHost; j++) {
+      auto* route = virtual_host->add_routes();
+      const std::string resource = "/api/v" + std::to_string(j % 3) + "/resource" +
+                                   std::to_string(j);
+      switch (j % 6) {
+      case 0:
+        route->mutable_match()->set_path(resource);
+        break;
+      case 1:
+        route->mutable_match()->set_regex(resource + "/[0-9]+/profile");
+        break;
+      case 2: {
+        route->mutable_match()->set_prefix(resource);
+        auto* header = route->mutable_match()->add_headers();
+        header->set_name("x-canary");
+        header->set_value("true");
+        break;
+      }
+      case 3: {
+        route->mutable_match()->set_prefix(resource);
+        auto* header = route->mutable_match()->add_headers();
+        header->set_name("x-user-agent-class");
+        header->set_value("^(mobile|tablet)-[a-z]+$");
+        header->mutable_regex()->set_value(true);
+        break;
+      }
+      default:
+        route->mutable_match()->set_prefix(resource);
+        break;
+      }
+      route->mutable_route()->set_cluster("cluster" + std::to_string((i + j) % 64));
+    }
+
+    auto* route = virtual_host->add_routes();
+    route->mutable_match()->set_prefix("/");
+    route->mutable_route()->set_cluster("default");
+  }
+  return config;
+}
+
+// Requests for the virtual hosts spread over the configuration, hitting each kind of route and
+// the catch all, as well as unknown hosts.
+std::vector<Http::TestHeaderMapImpl> syntheticRequests(int64_t num_virtual_hosts) {
+  std::vector<Http::TestHeaderMapImpl> requests;
+  for (int64_t i = 0; i < 64; i++) {
+    const int64_t vhost = (i * 7919) % num_virtual_hosts;
+    const int64_t route = i % (RoutesPerVirtualHost + 1);
+    std::string host = domain(vhost);
+    if (i % 8 == 7) {
+      host = "unknown" + std::to_string(i) + ".example.org";
+    } else if (vhost % 4 == 0 && i % 2 == 0) {
+      host = "www.tenant" + std::to_string(vhost) + ".example.com";
+    }
+    std::string path = "/api/v" + std::to_string(route % 3) + "/resource" + std::to_string(route);
+    if (route % 6 == 1) {
+      path += "/" + std::to_string(i) + "/profile";
+    } else if (route == RoutesPerVirtualHost) {
+      path = "/static/index.html";
+    }
+    requests.push_back(
+        Http::TestHeaderMapImpl{{":authority", host}, {":path", path}, {":method", "GET"}});
+    if (i % 3 == 0) {
+      requests.back().addCopy("x-canary", "true");
+    }
+    if (i % 5 == 0) {
+      requests.back().addCopy("x-user-agent-class", "mobile-android");
+    }
+  }
+  return requests;
+}
+
+// Requests generated from a route configuration: one for each domain and route of each virtual
+// host, up to MaxRequests, with the headers the route matches on.
+std::vector<Http::TestHeaderMapImpl>
+configRequests(const envoy::api::v2::RouteConfiguration& config) {
+  std::vector<Http::TestHeaderMapImpl> requests;
+  for (const auto& virtual_host : config.virtual_hosts()) {
+    for (std::string host : virtual_host.domains()) {
+      if (host == "*") {
+        host = "unknown.example.org";
+      } else if (host[0] == '*') {
+        host = "www" + host.substr(1);
+      }
+      for (const auto& route : virtual_host.routes()) {
+        if (requests.size() == MaxRequests) {
+          return requests;
+        }
+        std::string path = "/";
+        if (route.match().path_specifier_case() == envoy::api::v2::RouteMatch::kPath) {
+          path = route.match().path();
+        } else if (route.match().path_specifier_case() == envoy::api::v2::RouteMatch::kPrefix) {
+          path = route.match().prefix();
+        }
+        requests.push_back(
+            Http::TestHeaderMapImpl{{":authority", host}, {":path", path}, {":method", "GET"}});
+        for (const auto& header : route.match().headers()) {
+          if (!PROTOBUF_GET_WRAPPED_OR_DEFAULT(header, regex, false)) {
+            requests.back().addCopy(header.name(), header.value());
+          }
+        }
+      }
+    }
+  }
+  return requests;
+}
+
+class RouteTable {
+public:
+  RouteTable() : runtime_(random_) {}
+
+  std::unique_ptr<ConfigImpl> build(const envoy::api::v2::RouteConfiguration& config) {
+    return std::unique_ptr<ConfigImpl>(new ConfigImpl(config, runtime_, cm_, false));
+  }
+
+private:
+  Runtime::RandomGeneratorImpl random_;
+  Runtime::NullLoaderImpl runtime_;
+  NiceMock<Upstream::MockClusterManager> cm_;
+};
+
+void routeLookup(benchmark::State& state, const envoy::api::v2::RouteConfiguration& config,
+                 const std::vector<Http::TestHeaderMapImpl>& requests) {
+  RouteTable table;
+  const uint64_t allocated = Memory::Stats::totalCurrentlyAllocated();
+  std::unique_ptr<ConfigImpl> route_config = table.build(config);
+  state.counters["config_bytes"] = Memory::Stats::totalCurrentlyAllocated() - allocated;
+
+  uint64_t random_value = 0;
+  for (auto _ : state) {
+    for (const Http::TestHeaderMapImpl& headers : requests) {
+      benchmark::DoNotOptimize(route_config->route(headers, random_value++));
+    }
+  }
+  state.SetItemsProcessed(state.iterations() * requests.size());
+}
+
+void configBuild(benchmark::State& state, const envoy::api::v2::RouteConfiguration& config) {
+  RouteTable table;
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(table.build(config));
+  }
+  state.counters["virtual_hosts"] = config.virtual_hosts_size();
+}
+
+void syntheticRouteLookup(benchmark::State& state) {
+  routeLookup(state, syntheticConfig(state.range(0)), syntheticRequests(state.range(0)));
+}
+BENCHMARK(syntheticRouteLookup)->Arg(10)->Arg(1000)->Arg(10000);
+
+void syntheticConfigBuild(benchmark::State& state) {
+  configBuild(state, syntheticConfig(state.range(0)));
+}
+BENCHMARK(syntheticConfigBuild)->Arg(10)->Arg(1000)->Arg(10000)->Unit(benchmark::kMillisecond);
+
+} // namespace
+} // namespace Router
+} // namespace Envoy
+
+int main(int argc, char** argv) {
+  benchmark::Initialize(&argc, argv);
+
+  // The arguments left after the benchmark flags are route configuration files.
+  for (int i = 1; i < argc; i++) {
+    const std::string path = argv[i];
+    std::shared_ptr<envoy::api::v2::RouteConfiguration> config =
+        std::make_shared<envoy::api::v2::RouteConfiguration>();
+    Envoy::MessageUtil::loadFromFile(path, *config);
+    std::shared_ptr<std::vector<Envoy::Http::TestHeaderMapImpl>> requests =
+        std::make_shared<std::vector<Envoy::Http::TestHeaderMapImpl>>(
+            Envoy::Router::configRequests(*config));
+
+    benchmark::RegisterBenchmark(("routeLookup/" + path).c_str(),
+                                 [config, requests](benchmark::State& state) {
+                                   Envoy::Router::routeLookup(state, *config, *requests);
+                                 });
+    benchmark::RegisterBenchmark(("configBuild/" + path).c_str(),
+                                 [config](benchmark::State& state) {
+                                   Envoy::Router::configBuild(state, *config);
+                                 })
+        ->Unit(benchmark::kMillisecond);
+  }
+
+  benchmark::RunSpecifiedBenchmarks();
+  return 0;
+}
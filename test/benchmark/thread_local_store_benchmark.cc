@@ -0,0 +1,226 @@
+// Microbenchmarks for Stats::ThreadLocalStoreImpl. Run with an optimized build:
+//
+//   bazel run -c opt //test/benchmark:thread_local_store_benchmark
+//
+// The stats are named like those of a cluster. Stores with threading initialized use the thread
+// local mocks, which run cross thread operations inline on the calling thread, so the scope
+// benchmarks include the cache flush that deleting a scope runs on all threads. Lookups that miss
+// the thread local cache take the same path as the lookups of a store without threading, so
+// those use one. The concurrent benchmarks share a store without threading between the benchmark
+// threads, which is the path of every thread local cache miss: encoding the name with the symbol
+// table and finding or creating the stat in the central cache of the scope.
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "common/config/utility.h"
+#include "common/stats/stats_impl.h"
+#include "common/stats/thread_local_store.h"
+
+#include "test/mocks/event/mocks.h"
+#include "test/mocks/thread_local/mocks.h"
+
+#include "api/bootstrap.pb.h"
+#include "benchmark/benchmark.h"
+#include "fmt/format.h"
+#include "gmock/gmock.h"
+
+using testing::NiceMock;
+
+namespace Envoy {
+namespace Stats {
+namespace {
+
+// Names of some of the stats of a cluster, which tag extraction applies to.
+const std::vector<std::string>& clusterStatNames() {
+  static const std::vector<std::string> names{
+      "upstream_cx_total",      "upstream_cx_active",       "upstream_cx_connect_fail",
+      "upstream_rq_total",      "upstream_rq_active",       "upstream_rq_pending_total",
+      "upstream_rq_timeout",    "upstream_rq_retry",        "upstream_rq_200",
+      "upstream_rq_2xx",        "upstream_rq_503",          "upstream_rq_5xx",
+      "canary.upstream_rq_200", "internal.upstream_rq_2xx", "lb_healthy_panic",
+      "membership_healthy"};
+  return names;
+}
+
+// The full names of the stats of `num_clusters` clusters.
+std::vector<std::string> statNames(int64_t num_clusters) {
+  std::vector<std::string> names;
+  for (int64_t i = 0; i < num_clusters; i++) {
+    for (const std::string& name : clusterStatNames()) {
+      names.push_back(fmt::format("cluster.cluster_{}.{}", i, name));
+    }
+  }
+  return names;
+}
+
+/**
+ * A store with threading initialized on the thread local mocks.
+ */
+class TlsStoreTester {
+public:
+  TlsStoreTester() : store_(alloc_) { store_.initializeThreading(dispatcher_, tls_); }
+  ~TlsStoreTester() {
+    store_.shutdownThreading();
+    tls_.shutdownThread();
+  }
+
+  HeapRawStatDataAllocator alloc_;
+  NiceMock<Event::MockDispatcher> dispatcher_;
+  NiceMock<ThreadLocal::MockInstance> tls_;
+  ThreadLocalStoreImpl store_;
+};
+
+// Create a scope with the stats of a cluster, if the parameter is 1, and delete it.
+void createScope(benchmark::State& state) {
+  TlsStoreTester tester;
+  const bool create_stats = state.range(0) != 0;
+  for (auto _ : state) {
+    ScopePtr scope = tester.store_.createScope("cluster.cluster_0.");
+    if (create_stats) {
+      for (const std::string& name : clusterStatNames()) {
+        scope->counter(name);
+      }
+    }
+  }
+}
+BENCHMARK(createScope)->Arg(0)->Arg(1);
+
+// Look up counters that are in the thread local cache. The parameter is the number of clusters.
+void counterTlsHit(benchmark::State& state) {
+  TlsStoreTester tester;
+  const std::vector<std::string> names = statNames(state.range(0));
+  for (const std::string& name : names) {
+    tester.store_.counter(name);
+  }
+
+  for (auto _ : state) {
+    for (const std::string& name : names) {
+      tester.store_.counter(name).inc();
+    }
+  }
+  state.SetItemsProcessed(state.iterations() * names.size());
+}
+BENCHMARK(counterTlsHit)->Arg(1)->Arg(100);
+
+// Look up counters that are only in the central cache. The parameter is the number of clusters.
+void counterTlsMiss(benchmark::State& state) {
+  HeapRawStatDataAllocator alloc;
+  ThreadLocalStoreImpl store(alloc);
+  const std::vector<std::string> names = statNames(state.range(0));
+  for (const std::string& name : names) {
+    store.counter(name);
+  }
+
+  for (auto _ : state) {
+    for (const std::string& name : names) {
+      store.counter(name).inc();
+    }
+  }
+  state.SetItemsProcessed(state.iterations() * names.size());
+  store.shutdownThreading();
+}
+BENCHMARK(counterTlsMiss)->Arg(1)->Arg(100);
+
+// The store shared by the threads of the concurrent benchmarks, which thread 0 creates before
+// the threads start iterating and deletes after they all stopped.
+HeapRawStatDataAllocator shared_alloc;
+std::unique_ptr<ThreadLocalStoreImpl> shared_store;
+
+void setUpSharedStore(const benchmark::State& state) {
+  if (state.thread_index == 0) {
+    shared_store.reset(new ThreadLocalStoreImpl(shared_alloc));
+  }
+}
+
+void tearDownSharedStore(const benchmark::State& state) {
+  if (state.thread_index == 0) {
+    shared_store->shutdownThreading();
+    shared_store.reset();
+  }
+}
+
+// Each thread creates a scope of its own with the stats of a cluster, and deletes it.
+void concurrentCreation(benchmark::State& state) {
+  setUpSharedStore(state);
+  const std::string prefix = fmt::format("cluster.cluster_{}.", state.thread_index);
+  for (auto _ : state) {
+    ScopePtr scope = shared_store->createScope(prefix);
+    for (const std::string& name : clusterStatNames()) {
+      scope->counter(name);
+    }
+  }
+  state.SetItemsProcessed(state.iterations() * clusterStatNames().size());
+  tearDownSharedStore(state);
+}
+BENCHMARK(concurrentCreation)->ThreadRange(1, 8)->UseRealTime();
+
+// All threads look up the same counters of the central cache.
+void concurrentLookup(benchmark::State& state) {
+  setUpSharedStore(state);
+  const std::vector<std::string> names = statNames(1);
+  for (auto _ : state) {
+    for (const std::string& name : names) {
+      shared_store->counter(name).inc();
+    }
+  }
+  state.SetItemsProcessed(state.iterations() * names.size());
+  tearDownSharedStore(state);
+}
+BENCHMARK(concurrentLookup)->ThreadRange(1, 8)->UseRealTime();
+
+// Iterate the counters and gauges of the store the way a flush does, latching the counters. The
+// parameter is the number of clusters, each with a scope of its own.
+void flush(benchmark::State& state) {
+  TlsStoreTester tester;
+  std::vector<ScopePtr> scopes;
+  for (int64_t i = 0; i < state.range(0); i++) {
+    scopes.push_back(tester.store_.createScope(fmt::format("cluster.cluster_{}.", i)));
+    for (const std::string& name : clusterStatNames()) {
+      scopes.back()->counter(name);
+      scopes.back()->gauge(name);
+    }
+  }
+
+  for (auto _ : state) {
+    uint64_t total = 0;
+    for (const CounterSharedPtr& counter : tester.store_.counters()) {
+      total += counter->latch();
+    }
+    for (const GaugeSharedPtr& gauge : tester.store_.gauges()) {
+      total += gauge->value();
+    }
+    benchmark::DoNotOptimize(total);
+  }
+  state.SetItemsProcessed(state.iterations() * state.range(0) * clusterStatNames().size() * 2);
+}
+BENCHMARK(flush)->Arg(10)->Arg(100)->Arg(1000);
+
+// Create the stats of a cluster with the default tag extractors, if the parameter is 1, or with
+// none, which gives the cost of the extraction by difference.
+void tagExtraction(benchmark::State& state) {
+  HeapRawStatDataAllocator alloc;
+  ThreadLocalStoreImpl store(alloc);
+  const std::vector<TagExtractorPtr> tag_extractors =
+      state.range(0) != 0 ? Config::Utility::createTagExtractors(envoy::api::v2::Bootstrap())
+                          : std::vector<TagExtractorPtr>();
+  store.setTagExtractors(tag_extractors);
+
+  for (auto _ : state) {
+    ScopePtr scope = store.createScope("cluster.cluster_0.");
+    for (const std::string& name : clusterStatNames()) {
+      scope->counter(name);
+    }
+  }
+  state.SetItemsProcessed(state.iterations() * clusterStatNames().size());
+  store.shutdownThreading();
+}
+BENCHMARK(tagExtraction)->Arg(0)->Arg(1);
+
+} // namespace
+} // namespace Stats
+} // namespace Envoy
+
+BENCHMARK_MAIN();
@@ -81,6 +81,23 @@ TEST(AccessLogFormatterTest, requestInfoFormatter) {
     EXPECT_EQ("-", response_duration_format.format(header, header, request_info));
   }
 
+  {
+    request_info.upstream_connect_start_duration_ = std::chrono::microseconds(1000);
+    request_info.upstream_connect_end_duration_ = std::chrono::microseconds(3000);
+    request_info.upstream_last_byte_received_duration_ = std::chrono::microseconds(12000);
+    request_info.downstream_first_byte_sent_duration_ = std::chrono::microseconds(11000);
+    EXPECT_EQ("1", RequestInfoFormatter("UPSTREAM_CONNECT_START_DURATION")
+                       .format(header, header, request_info));
+    EXPECT_EQ("3", RequestInfoFormatter("UPSTREAM_CONNECT_END_DURATION")
+                       .format(header, header, request_info));
+    EXPECT_EQ("12", RequestInfoFormatter("UPSTREAM_LAST_BYTE_RECEIVED_DURATION")
+                        .format(header, header, request_info));
+    EXPECT_EQ("11", RequestInfoFormatter("DOWNSTREAM_FIRST_BYTE_SENT_DURATION")
+                        .format(header, header, request_info));
+    EXPECT_EQ("-", RequestInfoFormatter("DOWNSTREAM_LAST_BYTE_SENT_DURATION")
+                       .format(header, header, request_info));
+  }
+
   {
     RequestInfoFormatter bytes_received_format("BYTES_RECEIVED");
     EXPECT_CALL(request_info, bytesReceived()).WillOnce(Return(1));
@@ -225,6 +242,27 @@ TEST(AccessLogFormatterTest, responseHeaderFormatter) {
   }
 }
 
+TEST(AccessLogFormatterTest, headersByteSizeFormatter) {
+  RequestInfo::MockRequestInfo request_info;
+  Http::TestHeaderMapImpl request_header{{":method", "GET"}, {":path", "/"}};
+  Http::TestHeaderMapImpl response_header{{":status", "200"}};
+
+  {
+    HeadersByteSizeFormatter formatter(HeadersByteSizeFormatter::HeaderType::Request);
+    EXPECT_EQ("16", formatter.format(request_header, response_header, request_info));
+  }
+
+  {
+    HeadersByteSizeFormatter formatter(HeadersByteSizeFormatter::HeaderType::Response);
+    EXPECT_EQ("10", formatter.format(request_header, response_header, request_info));
+  }
+
+  {
+    FormatterImpl formatter("%REQUEST_HEADERS_BYTES% %RESPONSE_HEADERS_BYTES%");
+    EXPECT_EQ("16 10", formatter.format(request_header, response_header, request_info));
+  }
+}
+
 TEST(AccessLogFormatterTest, CompositeFormatterSuccess) {
   RequestInfo::MockRequestInfo request_info;
   Http::TestHeaderMapImpl request_header{{"first", "GET"}, {":path", "/"}};
@@ -258,6 +296,22 @@ TEST(AccessLogFormatterTest, CompositeFormatterSuccess) {
   }
 }
 
+TEST(AccessLogFormatterTest, CompositeFormatterAppends) {
+  NiceMock<RequestInfo::MockRequestInfo> request_info;
+  Http::TestHeaderMapImpl request_header{{"first", "GET"}};
+  Http::TestHeaderMapImpl response_header;
+  FormatterImpl formatter("%REQ(FIRST)% %BYTES_RECEIVED% %RESPONSE_CODE%\n");
+
+  EXPECT_CALL(request_info, bytesReceived()).WillRepeatedly(Return(18446744073709551615UL));
+  Optional<uint32_t> response_code{200};
+  EXPECT_CALL(request_info, responseCode()).WillRepeatedly(ReturnRef(response_code));
+
+  std::string output = "previous\n";
+  formatter.formatTo(request_header, response_header, request_info, output);
+  formatter.formatTo(request_header, response_header, request_info, output);
+  EXPECT_EQ("previous\nGET 18446744073709551615 200\nGET 18446744073709551615 200\n", output);
+}
+
 TEST(AccessLogFormatterTest, ParserFailures) {
   AccessLogFormatParser parser;
 
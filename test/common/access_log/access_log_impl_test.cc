@@ -60,6 +60,30 @@ public:
     return request_received_duration_;
   }
   void responseReceivedDuration(MonotonicTime time) override { UNREFERENCED_PARAMETER(time); }
+  const Optional<std::chrono::microseconds>& upstreamConnectStartDuration() const override {
+    return upstream_connect_start_duration_;
+  }
+  void upstreamConnectStartDuration(MonotonicTime time) override { UNREFERENCED_PARAMETER(time); }
+  const Optional<std::chrono::microseconds>& upstreamConnectEndDuration() const override {
+    return upstream_connect_end_duration_;
+  }
+  void upstreamConnectEndDuration(MonotonicTime time) override { UNREFERENCED_PARAMETER(time); }
+  const Optional<std::chrono::microseconds>& upstreamLastByteReceivedDuration() const override {
+    return upstream_last_byte_received_duration_;
+  }
+  void upstreamLastByteReceivedDuration(MonotonicTime time) override {
+    UNREFERENCED_PARAMETER(time);
+  }
+  const Optional<std::chrono::microseconds>& downstreamFirstByteSentDuration() const override {
+    return downstream_first_byte_sent_duration_;
+  }
+  void downstreamFirstByteSentDuration(MonotonicTime time) override {
+    UNREFERENCED_PARAMETER(time);
+  }
+  const Optional<std::chrono::microseconds>& downstreamLastByteSentDuration() const override {
+    return downstream_last_byte_sent_duration_;
+  }
+  void downstreamLastByteSentDuration(MonotonicTime time) override { UNREFERENCED_PARAMETER(time); }
   uint64_t bytesReceived() const override { return 1; }
   const Optional<Http::Protocol>& protocol() const override { return protocol_; }
   void protocol(Http::Protocol protocol) override { protocol_ = protocol; }
@@ -93,6 +117,11 @@ public:
   SystemTime start_time_;
   Optional<std::chrono::microseconds> request_received_duration_{std::chrono::microseconds(1000)};
   Optional<std::chrono::microseconds> response_received_duration_{std::chrono::microseconds(2000)};
+  Optional<std::chrono::microseconds> upstream_connect_start_duration_;
+  Optional<std::chrono::microseconds> upstream_connect_end_duration_;
+  Optional<std::chrono::microseconds> upstream_last_byte_received_duration_;
+  Optional<std::chrono::microseconds> downstream_first_byte_sent_duration_;
+  Optional<std::chrono::microseconds> downstream_last_byte_sent_duration_;
   Optional<Http::Protocol> protocol_{Http::Protocol::Http11};
   Optional<uint32_t> response_code_;
   uint64_t response_flags_{};
@@ -276,6 +305,56 @@ TEST_F(AccessLogImplTest, RuntimeFilter) {
   log->log(&request_headers_, &response_headers_, request_info_);
 }
 
+TEST_F(AccessLogImplTest, RuntimeFilterMayLog) {
+  const std::string json = R"EOF(
+  {
+    "path": "/dev/null",
+    "filter": {"type": "logical_and", "filters": [
+        {"type": "runtime", "key": "access_log.test_key"},
+        {"type": "status_code", "op": ">=", "value": 500}
+      ]
+    }
+  }
+  )EOF";
+
+  InstanceSharedPtr log = AccessLogFactory::fromProto(parseAccessLogFromJson(json), context_);
+
+  // Without a request ID the decision is left to the time of logging.
+  EXPECT_CALL(runtime_.snapshot_, getInteger(_, _)).Times(0);
+  EXPECT_TRUE(log->mayLog(request_headers_));
+
+  request_headers_.addCopy("x-request-id", "000000ff-0000-0000-0000-000000000000");
+  EXPECT_CALL(runtime_.snapshot_, getInteger("access_log.test_key", 0)).WillOnce(Return(56));
+  EXPECT_TRUE(log->mayLog(request_headers_));
+
+  EXPECT_CALL(runtime_.snapshot_, getInteger("access_log.test_key", 0)).WillOnce(Return(55));
+  EXPECT_FALSE(log->mayLog(request_headers_));
+}
+
+TEST_F(AccessLogImplTest, OrFilterMayLog) {
+  const std::string json = R"EOF(
+  {
+    "path": "/dev/null",
+    "filter": {"type": "logical_or", "filters": [
+        {"type": "runtime", "key": "access_log.test_key"},
+        {"type": "runtime", "key": "access_log.other_key"}
+      ]
+    }
+  }
+  )EOF";
+
+  InstanceSharedPtr log = AccessLogFactory::fromProto(parseAccessLogFromJson(json), context_);
+  request_headers_.addCopy("x-request-id", "000000ff-0000-0000-0000-000000000000");
+
+  EXPECT_CALL(runtime_.snapshot_, getInteger("access_log.test_key", 0)).WillOnce(Return(0));
+  EXPECT_CALL(runtime_.snapshot_, getInteger("access_log.other_key", 0)).WillOnce(Return(100));
+  EXPECT_TRUE(log->mayLog(request_headers_));
+
+  EXPECT_CALL(runtime_.snapshot_, getInteger("access_log.test_key", 0)).WillOnce(Return(0));
+  EXPECT_CALL(runtime_.snapshot_, getInteger("access_log.other_key", 0)).WillOnce(Return(0));
+  EXPECT_FALSE(log->mayLog(request_headers_));
+}
+
 TEST_F(AccessLogImplTest, PathRewrite) {
   request_headers_ = {{":method", "GET"}, {":path", "/foo"}, {"x-envoy-original-path", "/bar"}};
 
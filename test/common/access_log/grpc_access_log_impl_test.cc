@@ -1,7 +1,14 @@
+#include <chrono>
+#include <memory>
+#include <string>
+#include <vector>
+
 #include "common/access_log/grpc_access_log_impl.h"
 #include "common/network/address_impl.h"
+#include "common/stats/stats_impl.h"
 
 #include "test/mocks/access_log/mocks.h"
+#include "test/mocks/event/mocks.h"
 #include "test/mocks/grpc/mocks.h"
 #include "test/mocks/local_info/mocks.h"
 #include "test/mocks/request_info/mocks.h"
@@ -36,6 +43,20 @@ public:
   typedef Grpc::AsyncStreamCallbacks<envoy::api::v2::filter::accesslog::StreamAccessLogsResponse>
       AccessLogCallbacks;
 
+  GrpcAccessLogStreamerImplTest() {
+    // Send each log as soon as it arrives unless a test sets up batching.
+    GrpcAccessLogStreamerImpl::BatchConfig batch_config;
+    batch_config.max_batch_entries_ = 1;
+    batch_config.flush_interval_ = std::chrono::milliseconds(0);
+    setup(batch_config);
+  }
+
+  void setup(const GrpcAccessLogStreamerImpl::BatchConfig& batch_config) {
+    factory_ = new TestGrpcAccessLogClientFactory;
+    streamer_.reset(new GrpcAccessLogStreamerImpl(GrpcAccessLogClientFactoryPtr{factory_}, tls_,
+                                                  local_info_, stats_store_, batch_config));
+  }
+
   void expectStreamStart(MockAccessLogStream& stream, AccessLogCallbacks** callbacks_to_set) {
     EXPECT_CALL(*factory_->async_client_, start(_, _))
         .WillOnce(Invoke([&stream, callbacks_to_set](const Protobuf::MethodDescriptor&,
@@ -45,10 +66,36 @@ public:
         }));
   }
 
+  // Send a message with a log entry with the given path.
+  void send(const std::string& log_name, const std::string& path = "/") {
+    envoy::api::v2::filter::accesslog::StreamAccessLogsMessage message;
+    message.mutable_http_logs()->add_log_entry()->mutable_request()->set_path(path);
+    streamer_->send(message, log_name);
+  }
+
+  // Expect a message with log entries with the given paths.
+  void expectSend(MockAccessLogStream& stream, const std::vector<std::string>& paths) {
+    EXPECT_CALL(stream, sendMessage(_, false))
+        .WillOnce(Invoke(
+            [paths](const envoy::api::v2::filter::accesslog::StreamAccessLogsMessage& message,
+                    bool) {
+              std::vector<std::string> sent;
+              for (const auto& entry : message.http_logs().log_entry()) {
+                sent.push_back(entry.request().path());
+              }
+              EXPECT_EQ(paths, sent);
+            }));
+  }
+
+  uint64_t counter(const std::string& name) {
+    return stats_store_.counter("access_log.grpc." + name).value();
+  }
+
   NiceMock<ThreadLocal::MockInstance> tls_;
   LocalInfo::MockLocalInfo local_info_;
-  TestGrpcAccessLogClientFactory* factory_{new TestGrpcAccessLogClientFactory};
-  GrpcAccessLogStreamerImpl streamer_{GrpcAccessLogClientFactoryPtr{factory_}, tls_, local_info_};
+  Stats::IsolatedStoreImpl stats_store_;
+  TestGrpcAccessLogClientFactory* factory_;
+  std::unique_ptr<GrpcAccessLogStreamerImpl> streamer_;
 };
 
 // Test basic stream logging flow.
@@ -61,12 +108,10 @@ TEST_F(GrpcAccessLogStreamerImplTest, BasicFlow) {
   expectStreamStart(stream1, &callbacks1);
   EXPECT_CALL(local_info_, node());
   EXPECT_CALL(stream1, sendMessage(_, false));
-  envoy::api::v2::filter::accesslog::StreamAccessLogsMessage message_log1;
-  streamer_.send(message_log1, "log1");
+  send("log1");
 
-  message_log1.Clear();
   EXPECT_CALL(stream1, sendMessage(_, false));
-  streamer_.send(message_log1, "log1");
+  send("log1");
 
   // Start a stream for the second log.
   MockAccessLogStream stream2;
@@ -74,8 +119,7 @@ TEST_F(GrpcAccessLogStreamerImplTest, BasicFlow) {
   expectStreamStart(stream2, &callbacks2);
   EXPECT_CALL(local_info_, node());
   EXPECT_CALL(stream2, sendMessage(_, false));
-  envoy::api::v2::filter::accesslog::StreamAccessLogsMessage message_log2;
-  streamer_.send(message_log2, "log2");
+  send("log2");
 
   // Verify that sending an empty response message doesn't do anything bad.
   callbacks1->onReceiveMessage(
@@ -86,7 +130,10 @@ TEST_F(GrpcAccessLogStreamerImplTest, BasicFlow) {
   expectStreamStart(stream2, &callbacks2);
   EXPECT_CALL(local_info_, node());
   EXPECT_CALL(stream2, sendMessage(_, false));
-  streamer_.send(message_log2, "log2");
+  send("log2");
+
+  EXPECT_EQ(4UL, counter("batches_sent"));
+  EXPECT_EQ(4UL, counter("logs_sent"));
 }
 
 // Test that stream failure is handled correctly.
@@ -99,8 +146,86 @@ TEST_F(GrpcAccessLogStreamerImplTest, StreamFailure) {
         return nullptr;
       }));
   EXPECT_CALL(local_info_, node());
-  envoy::api::v2::filter::accesslog::StreamAccessLogsMessage message_log1;
-  streamer_.send(message_log1, "log1");
+  send("log1");
+  EXPECT_EQ(1UL, counter("logs_dropped"));
+}
+
+// Test that logs are sent in batches of max_batch_entries_ entries, and after the flush interval.
+TEST_F(GrpcAccessLogStreamerImplTest, BatchByEntries) {
+  GrpcAccessLogStreamerImpl::BatchConfig batch_config;
+  batch_config.max_batch_entries_ = 2;
+  setup(batch_config);
+  Event::MockTimer* timer = new Event::MockTimer(&tls_.dispatcher_);
+  InSequence s;
+
+  EXPECT_CALL(*timer, enableTimer(std::chrono::milliseconds(1000)));
+  send("log1", "/a");
+  MockAccessLogStream stream;
+  AccessLogCallbacks* callbacks;
+  expectStreamStart(stream, &callbacks);
+  EXPECT_CALL(local_info_, node());
+  expectSend(stream, {"/a", "/b"});
+  send("log1", "/b");
+
+  EXPECT_CALL(*timer, enableTimer(std::chrono::milliseconds(1000)));
+  send("log1", "/c");
+  expectSend(stream, {"/c"});
+  timer->callback_();
+
+  // A timer that fires with an empty batch sends nothing.
+  timer->callback_();
+  EXPECT_EQ(2UL, counter("batches_sent"));
+  EXPECT_EQ(3UL, counter("logs_sent"));
+}
+
+// Test that logs are sent once the batch reaches max_batch_bytes_.
+TEST_F(GrpcAccessLogStreamerImplTest, BatchByBytes) {
+  GrpcAccessLogStreamerImpl::BatchConfig batch_config;
+  batch_config.max_batch_bytes_ = 100;
+  setup(batch_config);
+  Event::MockTimer* timer = new Event::MockTimer(&tls_.dispatcher_);
+  InSequence s;
+
+  EXPECT_CALL(*timer, enableTimer(_));
+  send("log1", "/a");
+  MockAccessLogStream stream;
+  AccessLogCallbacks* callbacks;
+  expectStreamStart(stream, &callbacks);
+  EXPECT_CALL(local_info_, node());
+  expectSend(stream, {"/a", "/" + std::string(100, 'b')});
+  send("log1", "/" + std::string(100, 'b'));
+}
+
+// Test that the batch is kept while the stream cannot be started, up to max_buffered_bytes_.
+TEST_F(GrpcAccessLogStreamerImplTest, BufferWhileStreamFails) {
+  GrpcAccessLogStreamerImpl::BatchConfig batch_config;
+  batch_config.max_batch_entries_ = 1;
+  batch_config.max_buffered_bytes_ = 20;
+  setup(batch_config);
+  Event::MockTimer* timer = new Event::MockTimer(&tls_.dispatcher_);
+  InSequence s;
+
+  EXPECT_CALL(*factory_->async_client_, start(_, _)).WillOnce(Return(nullptr));
+  EXPECT_CALL(local_info_, node());
+  EXPECT_CALL(*timer, enableTimer(_));
+  send("log1", "/a");
+
+  // The batch is full, so this entry is dropped.
+  send("log1", "/" + std::string(20, 'b'));
+  EXPECT_EQ(1UL, counter("logs_dropped"));
+
+  EXPECT_CALL(*factory_->async_client_, start(_, _)).WillOnce(Return(nullptr));
+  EXPECT_CALL(local_info_, node());
+  EXPECT_CALL(*timer, enableTimer(_));
+  timer->callback_();
+
+  MockAccessLogStream stream;
+  AccessLogCallbacks* callbacks;
+  expectStreamStart(stream, &callbacks);
+  EXPECT_CALL(local_info_, node());
+  expectSend(stream, {"/a"});
+  timer->callback_();
+  EXPECT_EQ(1UL, counter("logs_sent"));
 }
 
 class MockGrpcAccessLogStreamer : public GrpcAccessLogStreamer {
@@ -172,6 +297,8 @@ http_logs:
     request_info.start_time_ = SystemTime(1h);
     request_info.request_received_duration_ = 2ms;
     request_info.response_received_duration_ = 4ms;
+    request_info.upstream_last_byte_received_duration_ = 5ms;
+    request_info.downstream_first_byte_sent_duration_ = 5ms;
     request_info.duration_ = 6ms;
     request_info.upstream_local_address_ =
         std::make_shared<Network::Address::Ipv4Instance>("10.0.0.2");
@@ -212,6 +339,10 @@ http_logs:
         nanos: 2000000
       time_to_first_upstream_rx_byte:
         nanos: 4000000
+      time_to_last_upstream_rx_byte:
+        nanos: 5000000
+      time_to_first_downstream_tx_byte:
+        nanos: 5000000
       time_to_last_downstream_tx_byte:
         nanos: 6000000
       upstream_remote_address:
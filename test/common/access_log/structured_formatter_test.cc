@@ -0,0 +1,105 @@
+#include <map>
+#include <string>
+
+#include "common/access_log/structured_formatter.h"
+#include "common/http/header_map_impl.h"
+
+#include "test/mocks/request_info/mocks.h"
+#include "test/test_common/utility.h"
+
+#include "api/filter/accesslog/accesslog.pb.h"
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+
+using testing::NiceMock;
+
+namespace Envoy {
+namespace AccessLog {
+
+TEST(JsonFormatterImplTest, EscapeTail) {
+  std::string output = "\"kept\"";
+  JsonFormatterImpl::escapeTail(output, output.size());
+  EXPECT_EQ("\"kept\"", output);
+
+  output += "a\"b\\c\nd\te\x01";
+  JsonFormatterImpl::escapeTail(output, 6);
+  EXPECT_EQ("\"kept\"a\\\"b\\\\c\\nd\\te\\u0001", output);
+}
+
+TEST(JsonFormatterImplTest, Format) {
+  NiceMock<RequestInfo::MockRequestInfo> request_info;
+  request_info.response_code_.value(404);
+  request_info.bytes_sent_ = 12;
+  Http::TestHeaderMapImpl request_headers{{":method", "GET"}, {"user-agent", "say \"hi\""}};
+  Http::TestHeaderMapImpl response_headers;
+
+  JsonFormatterImpl formatter({{"user_agent", "agent: %REQ(USER-AGENT)%"},
+                               {"code", "%RESPONSE_CODE%"},
+                               {"missing", "%RESP(X-MISSING)%"},
+                               {"method", "%REQ(:METHOD)%"},
+                               {"sent", "%BYTES_SENT%"}});
+  std::string output;
+  formatter.formatTo(request_headers, response_headers, request_info, output);
+  formatter.formatTo(request_headers, response_headers, request_info, output);
+  const std::string line = "{\"code\":\"404\",\"method\":\"GET\",\"missing\":\"-\",\"sent\":\"12\","
+                           "\"user_agent\":\"agent: say \\\"hi\\\"\"}\n";
+  EXPECT_EQ(line + line, output);
+}
+
+TEST(JsonFormatterImplTest, NoFields) {
+  NiceMock<RequestInfo::MockRequestInfo> request_info;
+  Http::TestHeaderMapImpl headers;
+  JsonFormatterImpl formatter({});
+  EXPECT_EQ("{}\n", formatter.format(headers, headers, request_info));
+}
+
+TEST(JsonFormatterImplTest, DefaultFields) {
+  NiceMock<RequestInfo::MockRequestInfo> request_info;
+  Http::TestHeaderMapImpl headers{{":method", "GET"}, {":path", "/"}};
+  JsonFormatterImpl formatter(JsonFormatterImpl::defaultFields());
+  const std::string output = formatter.format(headers, headers, request_info);
+  EXPECT_NE(std::string::npos, output.find("\"method\":\"GET\""));
+  EXPECT_NE(std::string::npos, output.find("\"path\":\"/\""));
+  EXPECT_EQ('\n', output.back());
+}
+
+TEST(ProtobufFormatterImplTest, AppendVarint) {
+  std::string output;
+  ProtobufFormatterImpl::appendVarint(output, 1);
+  ProtobufFormatterImpl::appendVarint(output, 300);
+  EXPECT_EQ(std::string("\x01\xac\x02"), output);
+}
+
+TEST(ProtobufFormatterImplTest, Format) {
+  NiceMock<RequestInfo::MockRequestInfo> request_info;
+  request_info.host_.reset();
+  request_info.response_code_.value(200);
+  request_info.bytes_received_ = 300;
+  Http::TestHeaderMapImpl request_headers{{":method", "GET"}, {":path", "/foo"}};
+  Http::TestHeaderMapImpl response_headers;
+
+  ProtobufFormatterImpl formatter;
+  std::string output;
+  formatter.formatTo(request_headers, response_headers, request_info, output);
+  formatter.formatTo(request_headers, response_headers, request_info, output);
+
+  size_t offset = 0;
+  for (int i = 0; i < 2; i++) {
+    ASSERT_LT(offset, output.size());
+    // Entries of this size have a one byte length.
+    const size_t length = static_cast<uint8_t>(output[offset]);
+    ASSERT_LT(length, 0x80U);
+    envoy::api::v2::filter::accesslog::HTTPAccessLogEntry log_entry;
+    ASSERT_TRUE(log_entry.ParseFromArray(output.data() + offset + 1, length));
+    EXPECT_EQ("/foo", log_entry.request().path());
+    EXPECT_EQ(300U, log_entry.request().request_body_bytes());
+    EXPECT_EQ(200U, log_entry.response().response_code().value());
+    EXPECT_EQ("127.0.0.1",
+              log_entry.common_properties().downstream_remote_address().socket_address().address());
+    offset += 1 + length;
+  }
+  EXPECT_EQ(output.size(), offset);
+}
+
+} // namespace AccessLog
+} // namespace Envoy
@@ -0,0 +1,99 @@
+#include <cstdint>
+#include <string>
+
+#include "envoy/common/exception.h"
+
+#include "common/buffer/buffer_impl.h"
+#include "common/buffer/cursor.h"
+
+#include "gtest/gtest.h"
+
+namespace Envoy {
+namespace Buffer {
+namespace {
+
+// Build a buffer holding `data` in slices of `slice_size` bytes.
+void fill(Instance& buffer, const std::string& data, uint64_t slice_size) {
+  for (uint64_t offset = 0; offset < data.size(); offset += slice_size) {
+    OwnedImpl slice(data.data() + offset, std::min<uint64_t>(slice_size, data.size() - offset));
+    buffer.move(slice);
+  }
+}
+
+TEST(CursorTest, Empty) {
+  OwnedImpl buffer;
+  Cursor cursor(buffer);
+  EXPECT_EQ(0, cursor.position());
+  EXPECT_EQ(0, cursor.remaining());
+  EXPECT_EQ(-1, cursor.find('a'));
+  EXPECT_EQ("", cursor.readString(0));
+  EXPECT_THROW(cursor.skip(1), EnvoyException);
+}
+
+TEST(CursorTest, ReadAcrossSlices) {
+  OwnedImpl buffer;
+  fill(buffer, "abcdefghij", 3);
+  ASSERT_EQ(4, buffer.getRawSlices(nullptr, 0));
+  Cursor cursor(buffer);
+
+  char field[4];
+  cursor.peek(field, 4);
+  EXPECT_EQ("abcd", std::string(field, 4));
+  EXPECT_EQ(0, cursor.position());
+
+  cursor.read(field, 4);
+  EXPECT_EQ("abcd", std::string(field, 4));
+  EXPECT_EQ(4, cursor.position());
+  EXPECT_EQ(6, cursor.remaining());
+
+  cursor.skip(2);
+  EXPECT_EQ("ghij", cursor.readString(4));
+  EXPECT_EQ(0, cursor.remaining());
+
+  // The cursor does not modify the buffer.
+  EXPECT_EQ(10, buffer.length());
+  EXPECT_EQ(4, buffer.getRawSlices(nullptr, 0));
+}
+
+TEST(CursorTest, ReadPastEnd) {
+  OwnedImpl buffer("abc");
+  Cursor cursor(buffer);
+  char field[4];
+  EXPECT_THROW(cursor.peek(field, 4), EnvoyException);
+  EXPECT_THROW(cursor.read(field, 4), EnvoyException);
+  EXPECT_EQ(0, cursor.position());
+  EXPECT_EQ("abc", cursor.readString(3));
+}
+
+TEST(CursorTest, Find) {
+  OwnedImpl buffer;
+  fill(buffer, std::string("ab\0cd\0e", 7), 2);
+  Cursor cursor(buffer);
+  EXPECT_EQ(2, cursor.find('\0'));
+  EXPECT_EQ(6, cursor.find('e'));
+  EXPECT_EQ(-1, cursor.find('x'));
+
+  cursor.skip(3);
+  EXPECT_EQ(2, cursor.find('\0'));
+  EXPECT_EQ(0, cursor.find('c'));
+}
+
+TEST(CursorTest, ManySlices) {
+  // More slices than are held inline.
+  std::string data;
+  for (int i = 0; i < 100; i++) {
+    data.push_back('a' + i % 26);
+  }
+  OwnedImpl buffer;
+  fill(buffer, data, 1);
+  ASSERT_EQ(100, buffer.getRawSlices(nullptr, 0));
+
+  Cursor cursor(buffer);
+  EXPECT_EQ(data.substr(0, 50), cursor.readString(50));
+  EXPECT_EQ(3, cursor.find('b'));
+  EXPECT_EQ(data.substr(50), cursor.readString(50));
+}
+
+} // namespace
+} // namespace Buffer
+} // namespace Envoy
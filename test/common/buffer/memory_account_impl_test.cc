@@ -0,0 +1,83 @@
+#include <thread>
+#include <vector>
+
+#include "common/buffer/memory_account_impl.h"
+
+#include "gtest/gtest.h"
+
+namespace Envoy {
+namespace Buffer {
+namespace {
+
+TEST(MemoryAccountImplTest, ChargesPropagateToAncestors) {
+  auto root = std::make_shared<MemoryAccountImpl>(nullptr);
+  auto listener = std::make_shared<MemoryAccountImpl>(root);
+  auto connection1 = std::make_shared<MemoryAccountImpl>(listener);
+  auto connection2 = std::make_shared<MemoryAccountImpl>(listener);
+  auto stream = std::make_shared<MemoryAccountImpl>(connection1);
+
+  stream->charge(100);
+  connection1->charge(10);
+  connection2->charge(5);
+  EXPECT_EQ(100, stream->balance());
+  EXPECT_EQ(110, connection1->balance());
+  EXPECT_EQ(5, connection2->balance());
+  EXPECT_EQ(115, listener->balance());
+  EXPECT_EQ(115, root->balance());
+
+  stream->credit(100);
+  connection1->credit(10);
+  connection2->credit(5);
+  EXPECT_EQ(0, root->balance());
+}
+
+TEST(MemoryAccountImplTest, ChildKeepsParentAlive) {
+  auto root = std::make_shared<MemoryAccountImpl>(nullptr);
+  auto listener = std::make_shared<MemoryAccountImpl>(root);
+  MemoryAccountSharedPtr connection = MemoryAccountImpl::createChild(listener);
+  listener.reset();
+
+  connection->charge(7);
+  EXPECT_EQ(7, root->balance());
+  connection->credit(7);
+}
+
+TEST(MemoryAccountImplTest, CreateChildOfNothing) {
+  EXPECT_EQ(nullptr, MemoryAccountImpl::createChild(nullptr));
+}
+
+TEST(MemoryAccountImplTest, ProcessAccount) {
+  const MemoryAccountSharedPtr& process = MemoryAccountImpl::processAccount();
+  EXPECT_EQ(process, MemoryAccountImpl::processAccount());
+  const uint64_t initial_balance = process->balance();
+  {
+    MemoryAccountSharedPtr listener = MemoryAccountImpl::createChild(process);
+    listener->charge(3);
+    EXPECT_EQ(initial_balance + 3, process->balance());
+    listener->credit(3);
+  }
+  EXPECT_EQ(initial_balance, process->balance());
+}
+
+TEST(MemoryAccountImplTest, SharedAcrossThreads) {
+  auto root = std::make_shared<MemoryAccountImpl>(nullptr);
+  std::vector<std::thread> threads;
+  for (int i = 0; i < 4; i++) {
+    threads.emplace_back([root]() -> void {
+      auto account = std::make_shared<MemoryAccountImpl>(root);
+      for (int j = 0; j < 10000; j++) {
+        account->charge(2);
+        account->credit(1);
+      }
+      account->credit(10000);
+    });
+  }
+  for (std::thread& thread : threads) {
+    thread.join();
+  }
+  EXPECT_EQ(0, root->balance());
+}
+
+} // namespace
+} // namespace Buffer
+} // namespace Envoy
@@ -1,5 +1,16 @@
+#include <fcntl.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cstring>
+#include <random>
+#include <string>
+
 #include "common/buffer/buffer_impl.h"
 
+#include "test/test_common/environment.h"
+
 #include "gtest/gtest.h"
 
 namespace Envoy {
@@ -67,6 +78,467 @@ TEST_F(OwnedImplTest, addBufferFragmentDynamicAllocation) {
   EXPECT_TRUE(release_callback_called_);
 }
 
+
+TEST_F(OwnedImplTest, AddAndDrainAcrossSlices) {
+  Buffer::OwnedImpl buffer;
+  const std::string large(10000, 'a');
+  buffer.add(large);
+  buffer.add("b", 1);
+  EXPECT_EQ(10001, buffer.length());
+
+  buffer.drain(9999);
+  EXPECT_EQ(2, buffer.length());
+  char out[2];
+  buffer.copyOut(0, 2, out);
+  EXPECT_EQ("ab", std::string(out, 2));
+
+  buffer.drain(2);
+  EXPECT_EQ(0, buffer.length());
+  EXPECT_EQ(0, buffer.getRawSlices(nullptr, 0));
+}
+
+TEST_F(OwnedImplTest, SmallAddsShareSlice) {
+  Buffer::OwnedImpl buffer;
+  for (int i = 0; i < 10; i++) {
+    buffer.add("0123456789", 10);
+  }
+  EXPECT_EQ(100, buffer.length());
+  EXPECT_EQ(1, buffer.getRawSlices(nullptr, 0));
+}
+
+TEST_F(OwnedImplTest, AddEmptyBuffer) {
+  Buffer::OwnedImpl buffer("foo");
+  Buffer::OwnedImpl empty;
+  buffer.add(empty);
+  EXPECT_EQ(3, buffer.length());
+  EXPECT_EQ(1, buffer.getRawSlices(nullptr, 0));
+}
+
+TEST_F(OwnedImplTest, ReserveCommit) {
+  Buffer::OwnedImpl buffer;
+  RawSlice iovecs[2];
+  uint64_t num_reserved = buffer.reserve(100, iovecs, 2);
+  ASSERT_EQ(1, num_reserved);
+  EXPECT_LE(100, iovecs[0].len_);
+  memcpy(iovecs[0].mem_, "hello", 5);
+  iovecs[0].len_ = 5;
+  buffer.commit(iovecs, 1);
+  EXPECT_EQ(5, buffer.length());
+
+  // The next reservation continues at the end of the existing slice.
+  num_reserved = buffer.reserve(5, iovecs, 2);
+  ASSERT_EQ(1, num_reserved);
+  memcpy(iovecs[0].mem_, "world", 5);
+  buffer.commit(iovecs, 1);
+  EXPECT_EQ(10, buffer.length());
+  EXPECT_EQ(1, buffer.getRawSlices(nullptr, 0));
+  EXPECT_EQ(0, memcmp(buffer.linearize(10), "helloworld", 10));
+
+  // An abandoned reservation leaves no visible slices behind.
+  buffer.reserve(100000, iovecs, 2);
+  EXPECT_EQ(10, buffer.length());
+  EXPECT_EQ(1, buffer.getRawSlices(nullptr, 0));
+}
+
+TEST_F(OwnedImplTest, ReserveCommitMultipleSlices) {
+  Buffer::OwnedImpl buffer;
+  buffer.add("a", 1);
+  RawSlice iovecs[2];
+  const uint64_t num_reserved = buffer.reserve(16384, iovecs, 2);
+  ASSERT_EQ(2, num_reserved);
+  EXPECT_EQ(16384, iovecs[0].len_ + iovecs[1].len_);
+  memset(iovecs[0].mem_, 'b', iovecs[0].len_);
+  memset(iovecs[1].mem_, 'c', iovecs[1].len_);
+  buffer.commit(iovecs, 2);
+  EXPECT_EQ(16385, buffer.length());
+  EXPECT_EQ(2, buffer.getRawSlices(nullptr, 0));
+}
+
+TEST_F(OwnedImplTest, MoveWholeSlices) {
+  Buffer::OwnedImpl buffer1("hello");
+  Buffer::OwnedImpl buffer2("world");
+  const void* original_data = buffer2.linearize(5);
+  buffer1.move(buffer2);
+  EXPECT_EQ(0, buffer2.length());
+  EXPECT_EQ(10, buffer1.length());
+
+  // No copy was made: the slice of buffer2 now belongs to buffer1.
+  RawSlice slices[2];
+  ASSERT_EQ(2, buffer1.getRawSlices(slices, 2));
+  EXPECT_EQ(original_data, slices[1].mem_);
+}
+
+TEST_F(OwnedImplTest, MovePartialSmall) {
+  Buffer::OwnedImpl buffer1;
+  Buffer::OwnedImpl buffer2("hello world");
+  buffer1.move(buffer2, 5);
+  EXPECT_EQ(5, buffer1.length());
+  EXPECT_EQ(6, buffer2.length());
+
+  char out[6];
+  buffer1.copyOut(0, 5, out);
+  EXPECT_EQ("hello", std::string(out, 5));
+  buffer2.copyOut(0, 6, out);
+  EXPECT_EQ(" world", std::string(out, 6));
+}
+
+TEST_F(OwnedImplTest, MovePartialLargeSharesStorage) {
+  const std::string data(20000, 'x');
+  Buffer::OwnedImpl buffer1;
+  Buffer::OwnedImpl buffer2(data);
+  ASSERT_EQ(1, buffer2.getRawSlices(nullptr, 0));
+  const uint8_t* original = static_cast<const uint8_t*>(buffer2.linearize(1));
+
+  buffer1.move(buffer2, 15000);
+  EXPECT_EQ(15000, buffer1.length());
+  EXPECT_EQ(5000, buffer2.length());
+
+  RawSlice slice;
+  ASSERT_EQ(1, buffer1.getRawSlices(&slice, 1));
+  EXPECT_EQ(original, slice.mem_);
+  ASSERT_EQ(1, buffer2.getRawSlices(&slice, 1));
+  EXPECT_EQ(original + 15000, slice.mem_);
+
+  // The storage outlives either reference.
+  buffer2.drain(5000);
+  EXPECT_EQ(std::string(15000, 'x'),
+            std::string(static_cast<char*>(buffer1.linearize(15000)), 15000));
+}
+
+TEST_F(OwnedImplTest, AddSharedWithFragment) {
+  char input[] = "hello world";
+  BufferFragmentImpl frag(input, 11, [this](const void*, size_t, const BufferFragmentImpl*) {
+    release_callback_called_ = true;
+  });
+
+  {
+    Buffer::OwnedImpl buffer1;
+    {
+      Buffer::OwnedImpl buffer2;
+      buffer2.addBufferFragment(frag);
+      buffer1.addShared(buffer2);
+      EXPECT_EQ(11, buffer1.length());
+      EXPECT_EQ(11, buffer2.length());
+
+      RawSlice slice;
+      ASSERT_EQ(1, buffer1.getRawSlices(&slice, 1));
+      EXPECT_EQ(input, slice.mem_);
+      buffer2.drain(6);
+      EXPECT_EQ(11, buffer1.length());
+    }
+    // buffer2 is gone but buffer1 still references the fragment.
+    EXPECT_FALSE(release_callback_called_);
+    buffer1.add("!", 1);
+    EXPECT_EQ(12, buffer1.length());
+    EXPECT_EQ(2, buffer1.getRawSlices(nullptr, 0));
+  }
+  EXPECT_TRUE(release_callback_called_);
+}
+
+TEST_F(OwnedImplTest, PinFront) {
+  Buffer::OwnedImpl empty;
+  EXPECT_EQ(nullptr, empty.pinFront());
+
+  std::shared_ptr<const void> pin;
+  const char* original;
+  {
+    Buffer::OwnedImpl buffer("hello world");
+    original = static_cast<const char*>(buffer.linearize(11));
+    pin = buffer.pinFront();
+    ASSERT_NE(nullptr, pin);
+
+    // Pinned storage is never appended to, and can't be pinned twice.
+    buffer.add("!", 1);
+    EXPECT_EQ(2, buffer.getRawSlices(nullptr, 0));
+    EXPECT_EQ(nullptr, buffer.pinFront());
+
+    buffer.drain(6);
+    RawSlice slice;
+    ASSERT_EQ(2, buffer.getRawSlices(&slice, 1));
+    EXPECT_EQ(original + 6, slice.mem_);
+  }
+  // The buffer is gone but the pin still keeps its storage.
+  EXPECT_EQ("hello world", std::string(original, 11));
+}
+
+TEST_F(OwnedImplTest, PinFrontShared) {
+  Buffer::OwnedImpl buffer1("hello");
+  Buffer::OwnedImpl buffer2;
+  buffer2.addShared(buffer1);
+  EXPECT_EQ(nullptr, buffer1.pinFront());
+  EXPECT_EQ(nullptr, buffer2.pinFront());
+}
+
+TEST_F(OwnedImplTest, Linearize) {
+  Buffer::OwnedImpl buffer;
+  EXPECT_EQ(nullptr, buffer.linearize(0));
+
+  Buffer::OwnedImpl other1("abc");
+  Buffer::OwnedImpl other2("def");
+  buffer.move(other1);
+  buffer.move(other2);
+  EXPECT_EQ(2, buffer.getRawSlices(nullptr, 0));
+  EXPECT_EQ(0, memcmp("abcd", buffer.linearize(4), 4));
+  EXPECT_EQ(6, buffer.length());
+  EXPECT_EQ(2, buffer.getRawSlices(nullptr, 0));
+  EXPECT_EQ(0, memcmp("abcdef", buffer.linearize(6), 6));
+  EXPECT_EQ(1, buffer.getRawSlices(nullptr, 0));
+}
+
+TEST_F(OwnedImplTest, SearchAcrossSlices) {
+  Buffer::OwnedImpl buffer;
+  Buffer::OwnedImpl other1("abcab");
+  Buffer::OwnedImpl other2("cde");
+  buffer.move(other1);
+  buffer.move(other2);
+
+  EXPECT_EQ(0, buffer.search("abc", 3, 0));
+  EXPECT_EQ(3, buffer.search("abc", 3, 1));
+  EXPECT_EQ(3, buffer.search("abcde", 5, 1));
+  EXPECT_EQ(-1, buffer.search("abcdef", 6, 0));
+  EXPECT_EQ(-1, buffer.search("x", 1, 0));
+  EXPECT_EQ(7, buffer.search("e", 1, 7));
+  EXPECT_EQ(-1, buffer.search("e", 1, 9));
+  EXPECT_EQ(2, buffer.search("", 0, 2));
+}
+
+// Compare search() against std::string::find() on long buffers, which exercise the vectorized scan
+// within slices as well as matches that span slices.
+TEST_F(OwnedImplTest, SearchMatchesStringFind) {
+  std::mt19937 prng(1);
+  // A small alphabet gives many partial matches.
+  std::uniform_int_distribution<int> letter('a', 'c');
+  std::string data;
+  for (int i = 0; i < 4096; i++) {
+    data.push_back(letter(prng));
+  }
+
+  for (size_t slice_size : {1, 7, 31, 100, 4096}) {
+    Buffer::OwnedImpl buffer;
+    for (size_t offset = 0; offset < data.size(); offset += slice_size) {
+      Buffer::OwnedImpl slice(data.data() + offset, std::min(slice_size, data.size() - offset));
+      buffer.move(slice);
+    }
+
+    for (size_t needle_size : {1, 2, 3, 8, 17, 40}) {
+      for (size_t start : {0, 1, 15, 33, 1000, 4090}) {
+        // Needles taken from the data match somewhere; a needle of one repeated letter rarely does.
+        const std::string found = data.substr(std::min<size_t>(start + 301, 4000), needle_size);
+        const std::string repeated(needle_size, 'a');
+        for (const std::string& needle : {found, repeated}) {
+          const size_t expected = data.find(needle, start);
+          EXPECT_EQ(expected == std::string::npos ? -1 : static_cast<ssize_t>(expected),
+                    buffer.search(needle.data(), needle.size(), start))
+              << "slice_size=" << slice_size << " needle=" << needle << " start=" << start;
+        }
+      }
+    }
+  }
+}
+
+TEST_F(OwnedImplTest, ReadWrite) {
+  int fds[2];
+  ASSERT_EQ(0, pipe(fds));
+
+  Buffer::OwnedImpl write_buffer;
+  Buffer::OwnedImpl other1("hello ");
+  Buffer::OwnedImpl other2("world");
+  write_buffer.move(other1);
+  write_buffer.move(other2);
+  EXPECT_EQ(11, write_buffer.write(fds[1]));
+  EXPECT_EQ(0, write_buffer.length());
+  EXPECT_EQ(0, write_buffer.write(fds[1]));
+
+  Buffer::OwnedImpl read_buffer;
+  EXPECT_EQ(11, read_buffer.read(fds[0], 100));
+  EXPECT_EQ(11, read_buffer.length());
+  EXPECT_EQ(0, memcmp("hello world", read_buffer.linearize(11), 11));
+
+  close(fds[0]);
+  close(fds[1]);
+}
+
+TEST_F(OwnedImplTest, ReadHonorsMaxLength) {
+  int fds[2];
+  ASSERT_EQ(0, pipe(fds));
+  const std::string data(1000, 'a');
+  ASSERT_EQ(1000, ::write(fds[1], data.data(), data.size()));
+
+  // The reservation behind the read is bigger than 100 bytes, but no more than that is read.
+  Buffer::OwnedImpl buffer;
+  EXPECT_EQ(100, buffer.read(fds[0], 100));
+  EXPECT_EQ(100, buffer.length());
+  EXPECT_EQ(900, buffer.read(fds[0], 2000));
+  EXPECT_EQ(1000, buffer.length());
+
+  close(fds[0]);
+  close(fds[1]);
+}
+
+TEST_F(OwnedImplTest, WriteGathersUpToMaxWriteSlices) {
+  int fds[2];
+  ASSERT_EQ(0, pipe(fds));
+
+  // One slice more than a single write() will take.
+  Buffer::OwnedImpl write_buffer;
+  for (uint64_t i = 0; i < Instance::MaxWriteSlices + 1; i++) {
+    Buffer::OwnedImpl other("a");
+    write_buffer.move(other);
+  }
+  EXPECT_EQ(Instance::MaxWriteSlices + 1, write_buffer.getRawSlices(nullptr, 0));
+  EXPECT_EQ(static_cast<int>(Instance::MaxWriteSlices), write_buffer.write(fds[1]));
+  EXPECT_EQ(1, write_buffer.length());
+  EXPECT_EQ(1, write_buffer.write(fds[1]));
+  EXPECT_EQ(0, write_buffer.length());
+
+  close(fds[0]);
+  close(fds[1]);
+}
+
+class FileFragmentTest : public OwnedImplTest {
+public:
+  FileFragmentTest() {
+    const std::string path =
+        TestEnvironment::writeStringToFileForTest("file_fragment", "0123456789abcdef");
+    file_fd_ = open(path.c_str(), O_RDONLY);
+    EXPECT_NE(-1, file_fd_);
+    EXPECT_EQ(0, socketpair(AF_UNIX, SOCK_STREAM, 0, sockets_));
+  }
+
+  ~FileFragmentTest() {
+    close(file_fd_);
+    close(sockets_[0]);
+    close(sockets_[1]);
+  }
+
+  std::string readSocket(uint64_t size) {
+    std::string data(size, '\0');
+    EXPECT_EQ(static_cast<ssize_t>(size), recv(sockets_[1], &data[0], size, MSG_WAITALL));
+    return data;
+  }
+
+  std::function<void(const FileFragmentImpl*)> releasor() {
+    return [this](const FileFragmentImpl*) { release_callback_called_ = true; };
+  }
+
+  int file_fd_;
+  int sockets_[2];
+};
+
+TEST_F(FileFragmentTest, Data) {
+  FileFragmentImpl fragment(file_fd_, 3, 10, releasor());
+  EXPECT_EQ(file_fd_, fragment.fd());
+  EXPECT_EQ(3, fragment.offset());
+
+  Buffer::OwnedImpl buffer;
+  buffer.addBufferFragment(fragment);
+  EXPECT_EQ(10, buffer.length());
+  EXPECT_EQ("3456789abc", std::string(static_cast<char*>(buffer.linearize(10)), 10));
+  EXPECT_EQ(6, buffer.search("9", 1, 0));
+  EXPECT_FALSE(release_callback_called_);
+  buffer.drain(10);
+  EXPECT_TRUE(release_callback_called_);
+}
+
+TEST_F(FileFragmentTest, Write) {
+  FileFragmentImpl fragment(file_fd_, 2, 12, releasor());
+  Buffer::OwnedImpl buffer("<");
+  buffer.addBufferFragment(fragment);
+  buffer.add(">");
+  buffer.drain(4);
+  EXPECT_EQ(10, buffer.length());
+
+  // The head of the fragment was drained, so only the rest of it is sent from the file.
+  EXPECT_EQ(10, buffer.write(sockets_[0]));
+  EXPECT_EQ(0, buffer.length());
+  EXPECT_TRUE(release_callback_called_);
+  EXPECT_EQ("56789abcd>", readSocket(10));
+}
+
+TEST_F(FileFragmentTest, WriteAfterMemorySlices) {
+  FileFragmentImpl fragment(file_fd_, 0, 4, releasor());
+  Buffer::OwnedImpl buffer("hello ");
+  buffer.add(" world");
+  buffer.addBufferFragment(fragment);
+  EXPECT_EQ(16, buffer.write(sockets_[0]));
+  EXPECT_EQ("hello  world0123", readSocket(16));
+}
+
+TEST_F(FileFragmentTest, WriteErrorAfterFileSlice) {
+  int pipe_fds[2];
+  ASSERT_EQ(0, pipe2(pipe_fds, O_NONBLOCK));
+  // Fill the pipe a page at a time, then free a single page, so that the file slice goes into it
+  // and the writev() of the memory slice that follows it fails with EAGAIN.
+  char page[4096];
+  memset(page, 'x', sizeof(page));
+  const ssize_t page_size = sizeof(page);
+  while (::write(pipe_fds[1], page, sizeof(page)) == page_size) {
+  }
+  ASSERT_EQ(page_size, ::read(pipe_fds[0], page, sizeof(page)));
+
+  FileFragmentImpl fragment(file_fd_, 0, 4, releasor());
+  Buffer::OwnedImpl buffer;
+  buffer.addBufferFragment(fragment);
+  buffer.add(">");
+  EXPECT_EQ(4, buffer.write(pipe_fds[1]));
+  // The data that was sent is drained, so it is not sent again.
+  EXPECT_EQ(1, buffer.length());
+  EXPECT_TRUE(release_callback_called_);
+  EXPECT_EQ(-1, buffer.write(pipe_fds[1]));
+  EXPECT_EQ(EAGAIN, errno);
+  EXPECT_EQ(1, buffer.length());
+
+  close(pipe_fds[0]);
+  close(pipe_fds[1]);
+}
+
+TEST_F(FileFragmentTest, FragmentPastEndOfFile) {
+  FileFragmentImpl fragment(file_fd_, 12, 8, releasor());
+  Buffer::OwnedImpl buffer;
+  buffer.addBufferFragment(fragment);
+  EXPECT_EQ(4, buffer.write(sockets_[0]));
+  EXPECT_EQ("cdef", readSocket(4));
+  EXPECT_EQ(-1, buffer.write(sockets_[0]));
+  EXPECT_EQ(EIO, errno);
+  EXPECT_EQ(4, buffer.length());
+}
+
+TEST_F(OwnedImplTest, ManySlices) {
+  // Exercise growth of the slice queue beyond its inline capacity.
+  Buffer::OwnedImpl buffer;
+  for (int i = 0; i < 100; i++) {
+    Buffer::OwnedImpl other(std::to_string(i % 10));
+    buffer.move(other);
+  }
+  EXPECT_EQ(100, buffer.length());
+  EXPECT_EQ(100, buffer.getRawSlices(nullptr, 0));
+  buffer.drain(50);
+  EXPECT_EQ(50, buffer.getRawSlices(nullptr, 0));
+  char c;
+  buffer.copyOut(49, 1, &c);
+  EXPECT_EQ('9', c);
+}
+
+TEST_F(OwnedImplTest, SliceDequeReleasesRingWhenEmpty) {
+  // A deque that grew beyond its inline ring goes back to it once emptied.
+  SliceDeque slices;
+  for (int i = 0; i < 20; i++) {
+    slices.emplace_back(OwnedSlice::create(1));
+  }
+  EXPECT_EQ(32, slices.capacity());
+  slices.pop_back();
+  for (int i = 0; i < 18; i++) {
+    slices.pop_front();
+  }
+  EXPECT_EQ(32, slices.capacity());
+  slices.pop_front();
+  EXPECT_TRUE(slices.empty());
+  EXPECT_EQ(8, slices.capacity());
+
+  slices.emplace_front(OwnedSlice::create(1));
+  EXPECT_EQ(1, slices.size());
+}
+
 } // namespace
 } // namespace Buffer
 } // namespace Envoy
@@ -0,0 +1,100 @@
+#include <thread>
+
+#include "common/buffer/buffer_impl.h"
+#include "common/buffer/slice_pool.h"
+
+#include "gtest/gtest.h"
+
+namespace Envoy {
+namespace Buffer {
+namespace {
+
+class SlicePoolTest : public testing::Test {
+public:
+  SlicePoolTest() { SlicePool::setMaxRetainedBytes(SlicePool::DefaultMaxRetainedBytes); }
+  ~SlicePoolTest() { SlicePool::setMaxRetainedBytes(SlicePool::DefaultMaxRetainedBytes); }
+};
+
+TEST_F(SlicePoolTest, AllocationSize) {
+  EXPECT_EQ(512, SlicePool::allocationSize(1));
+  EXPECT_EQ(512, SlicePool::allocationSize(512));
+  EXPECT_EQ(1024, SlicePool::allocationSize(513));
+  EXPECT_EQ(16384, SlicePool::allocationSize(16000));
+  EXPECT_EQ(32768, SlicePool::allocationSize(32768));
+  EXPECT_EQ(36864, SlicePool::allocationSize(32769));
+}
+
+TEST_F(SlicePoolTest, ReuseFreedMemory) {
+  void* memory = SlicePool::allocate(16384);
+  SlicePool::release(memory, 16384);
+  const SlicePoolStats before = SlicePool::stats();
+  EXPECT_LE(16384, before.retained_bytes_);
+
+  EXPECT_EQ(memory, SlicePool::allocate(16384));
+  const SlicePoolStats after = SlicePool::stats();
+  EXPECT_EQ(before.hits_ + 1, after.hits_);
+  EXPECT_EQ(before.retained_bytes_ - 16384, after.retained_bytes_);
+  SlicePool::release(memory, 16384);
+}
+
+TEST_F(SlicePoolTest, DifferentSizeClassesDoNotMix) {
+  void* small = SlicePool::allocate(4096);
+  SlicePool::release(small, 4096);
+  const uint64_t misses = SlicePool::stats().misses_;
+  void* large = SlicePool::allocate(8192);
+  EXPECT_EQ(misses + 1, SlicePool::stats().misses_);
+  SlicePool::release(large, 8192);
+}
+
+TEST_F(SlicePoolTest, RetentionLimit) {
+  SlicePool::setMaxRetainedBytes(0);
+  // Freed memory goes straight back to the heap and any cached memory is released.
+  void* memory = SlicePool::allocate(4096);
+  SlicePool::release(memory, 4096);
+
+  std::thread thread([]() {
+    const SlicePoolStats before = SlicePool::stats();
+    void* memory = SlicePool::allocate(2048);
+    SlicePool::release(memory, 2048);
+    EXPECT_EQ(before.retained_bytes_, SlicePool::stats().retained_bytes_);
+  });
+  thread.join();
+
+  SlicePool::setMaxRetainedBytes(8192);
+  std::thread thread2([]() {
+    const SlicePoolStats before = SlicePool::stats();
+    void* memory1 = SlicePool::allocate(8192);
+    void* memory2 = SlicePool::allocate(8192);
+    SlicePool::release(memory1, 8192);
+    SlicePool::release(memory2, 8192);
+    EXPECT_EQ(before.retained_bytes_ + 8192, SlicePool::stats().retained_bytes_);
+  });
+  thread2.join();
+}
+
+TEST_F(SlicePoolTest, ThreadExitReleasesPool) {
+  const uint64_t retained_before = SlicePool::stats().retained_bytes_;
+  std::thread thread([]() {
+    Buffer::OwnedImpl buffer(std::string(10000, 'a'));
+    buffer.drain(buffer.length());
+  });
+  thread.join();
+  EXPECT_EQ(retained_before, SlicePool::stats().retained_bytes_);
+}
+
+TEST_F(SlicePoolTest, BuffersDrawFromPool) {
+  {
+    Buffer::OwnedImpl buffer(std::string(10000, 'a'));
+  }
+  const SlicePoolStats before = SlicePool::stats();
+  {
+    Buffer::OwnedImpl buffer(std::string(10000, 'a'));
+    RawSlice iovec;
+    buffer.reserve(100, &iovec, 1);
+  }
+  EXPECT_EQ(before.hits_ + 1, SlicePool::stats().hits_);
+}
+
+} // namespace
+} // namespace Buffer
+} // namespace Envoy
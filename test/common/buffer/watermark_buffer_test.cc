@@ -1,6 +1,7 @@
 #include <array>
 
 #include "common/buffer/buffer_impl.h"
+#include "common/buffer/memory_account_impl.h"
 #include "common/buffer/watermark_buffer.h"
 
 #include "gtest/gtest.h"
@@ -222,6 +223,60 @@ TEST_F(WatermarkBufferTest, MoveBackWithWatermarks) {
   EXPECT_EQ(1, low_watermark_buffer1);
 }
 
+TEST_F(WatermarkBufferTest, MemoryAccount) {
+  auto parent = std::make_shared<MemoryAccountImpl>(nullptr);
+  auto account = std::make_shared<MemoryAccountImpl>(parent);
+
+  // Bytes already in the buffer are charged when the account is set.
+  buffer_.add(TEN_BYTES, 4);
+  buffer_.setMemoryAccount(account);
+  EXPECT_EQ(4, account->balance());
+  EXPECT_EQ(4, parent->balance());
+
+  buffer_.add(TEN_BYTES, 10);
+  EXPECT_EQ(14, account->balance());
+  buffer_.drain(6);
+  EXPECT_EQ(8, account->balance());
+
+  // Moving data between accounted buffers moves the charge.
+  {
+    auto other_account = std::make_shared<MemoryAccountImpl>(parent);
+    Buffer::WatermarkBuffer other{[]() -> void {}, []() -> void {}};
+    other.setMemoryAccount(other_account);
+    other.move(buffer_, 3);
+    EXPECT_EQ(5, account->balance());
+    EXPECT_EQ(3, other_account->balance());
+    EXPECT_EQ(8, parent->balance());
+    other.add(TEN_BYTES, 10);
+    EXPECT_EQ(18, parent->balance());
+  }
+  // Destroying a buffer credits everything it held.
+  EXPECT_EQ(5, parent->balance());
+
+  char c;
+  buffer_.copyOut(0, 1, &c);
+  buffer_.linearize(5);
+  EXPECT_EQ(5, account->balance());
+  RawSlice slice;
+  buffer_.reserve(100, &slice, 1);
+  EXPECT_EQ(5, account->balance());
+
+  BufferFragmentImpl fragment(TEN_BYTES, 10, nullptr);
+  buffer_.addBufferFragment(fragment);
+  EXPECT_EQ(15, account->balance());
+
+  // Switching accounts moves the bytes held to the new account.
+  auto new_account = std::make_shared<MemoryAccountImpl>(parent);
+  buffer_.setMemoryAccount(new_account);
+  EXPECT_EQ(0, account->balance());
+  EXPECT_EQ(15, new_account->balance());
+  EXPECT_EQ(15, parent->balance());
+
+  buffer_.setMemoryAccount(nullptr);
+  EXPECT_EQ(0, parent->balance());
+  buffer_.drain(15);
+}
+
 } // namespace
 } // namespace Buffer
 } // namespace Envoy
@@ -71,6 +71,26 @@ TEST_F(ZeroCopyInputStreamTest, BackUpFull) {
   EXPECT_EQ(4, stream_.ByteCount());
 }
 
+TEST_F(ZeroCopyInputStreamTest, Skip) {
+  Buffer::OwnedImpl buffer("efgh");
+  stream_.move(buffer);
+
+  EXPECT_TRUE(stream_.Next(&data_, &size_));
+  stream_.BackUp(3);
+  EXPECT_TRUE(stream_.Skip(4));
+  EXPECT_EQ(5, stream_.ByteCount());
+
+  EXPECT_TRUE(stream_.Next(&data_, &size_));
+  EXPECT_EQ(3, size_);
+  EXPECT_EQ(0, memcmp("fgh", data_, size_));
+
+  stream_.BackUp(1);
+  EXPECT_FALSE(stream_.Skip(2));
+  EXPECT_EQ(8, stream_.ByteCount());
+  stream_.finish();
+  EXPECT_FALSE(stream_.Next(&data_, &size_));
+}
+
 TEST_F(ZeroCopyInputStreamTest, ByteCount) {
   EXPECT_EQ(0, stream_.ByteCount());
   EXPECT_TRUE(stream_.Next(&data_, &size_));
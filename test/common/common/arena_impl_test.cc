@@ -0,0 +1,114 @@
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "common/common/arena_impl.h"
+
+#include "gtest/gtest.h"
+
+namespace Envoy {
+
+TEST(ArenaImplTest, Alignment) {
+  ArenaImpl arena(256);
+  for (size_t alignment : {1, 2, 4, 8, 16}) {
+    for (size_t size : {1, 3, 17, 100}) {
+      void* memory = arena.allocate(size, alignment);
+      EXPECT_EQ(0U, reinterpret_cast<uintptr_t>(memory) % alignment);
+      memset(memory, 0, size);
+    }
+  }
+}
+
+TEST(ArenaImplTest, SequentialAllocations) {
+  ArenaImpl arena(1024);
+  char* first = static_cast<char*>(arena.allocate(8, 8));
+  char* second = static_cast<char*>(arena.allocate(8, 8));
+  EXPECT_EQ(first + 8, second);
+  EXPECT_EQ(16U, arena.bytesAllocated());
+}
+
+TEST(ArenaImplTest, LargeAllocation) {
+  ArenaImpl arena(1024);
+  char* first = static_cast<char*>(arena.allocate(8, 8));
+  // Does not fit in the current block's remaining space, nor a quarter of a block.
+  char* large = static_cast<char*>(arena.allocate(4096, 8));
+  memset(large, 0, 4096);
+  // The current block is still used for small allocations.
+  char* second = static_cast<char*>(arena.allocate(8, 8));
+  EXPECT_EQ(first + 8, second);
+  EXPECT_EQ(4112U, arena.bytesAllocated());
+}
+
+TEST(ArenaImplTest, ManyBlocks) {
+  ArenaImpl arena(64);
+  std::vector<char*> allocations;
+  for (size_t i = 0; i < 1000; i++) {
+    allocations.push_back(static_cast<char*>(arena.allocate(16, 1)));
+    memset(allocations.back(), i % 256, 16);
+  }
+  for (size_t i = 0; i < 1000; i++) {
+    EXPECT_EQ(static_cast<char>(i % 256), allocations[i][15]);
+  }
+}
+
+TEST(ArenaImplTest, CreateRunsDestructorsInReverseOrder) {
+  struct Tracker {
+    Tracker(std::vector<int>& destroyed, int id) : destroyed_(destroyed), id_(id) {}
+    ~Tracker() { destroyed_.push_back(id_); }
+
+    std::vector<int>& destroyed_;
+    const int id_;
+  };
+
+  std::vector<int> destroyed;
+  {
+    ArenaImpl arena;
+    Tracker* first = arena.create<Tracker>(destroyed, 1);
+    arena.create<Tracker>(destroyed, 2);
+    std::string* string = arena.create<std::string>(1000, 'a');
+    EXPECT_EQ(1, first->id_);
+    EXPECT_EQ(1000U, string->size());
+    EXPECT_TRUE(destroyed.empty());
+  }
+  EXPECT_EQ((std::vector<int>{2, 1}), destroyed);
+}
+
+TEST(ArenaImplTest, MakeUnique) {
+  bool destroyed = false;
+  struct Flag {
+    Flag(bool& destroyed) : destroyed_(destroyed) {}
+    ~Flag() { destroyed_ = true; }
+
+    bool& destroyed_;
+  };
+
+  ArenaImpl arena;
+  ArenaPtr<Flag> flag = arena.makeUnique<Flag>(destroyed);
+  EXPECT_FALSE(destroyed);
+  flag.reset();
+  EXPECT_TRUE(destroyed);
+}
+
+TEST(ArenaImplTest, MakeShared) {
+  bool destroyed = false;
+  struct Flag {
+    Flag(bool& destroyed) : destroyed_(destroyed) {}
+    ~Flag() { destroyed_ = true; }
+
+    bool& destroyed_;
+  };
+
+  ArenaImpl arena;
+  std::shared_ptr<Flag> flag = arena.makeShared<Flag>(destroyed);
+  // The object and its reference count both come from the arena.
+  EXPECT_LE(sizeof(Flag), arena.bytesAllocated());
+  std::shared_ptr<Flag> copy = flag;
+  flag.reset();
+  EXPECT_FALSE(destroyed);
+  copy.reset();
+  EXPECT_TRUE(destroyed);
+}
+
+} // namespace Envoy
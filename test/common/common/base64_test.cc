@@ -1,3 +1,4 @@
+#include <algorithm>
 #include <string>
 
 #include "common/buffer/buffer_impl.h"
@@ -8,6 +9,16 @@
 #include "gtest/gtest.h"
 
 namespace Envoy {
+namespace {
+
+// Appends data as a slice of its own, where add() would copy it into the last slice.
+void addSlice(Buffer::OwnedImpl& buffer, const std::string& data) {
+  Buffer::OwnedImpl slice(data);
+  buffer.addShared(slice);
+}
+
+} // namespace
+
 TEST(Base64Test, EmptyBufferEncode) {
   {
     Buffer::OwnedImpl buffer;
@@ -108,4 +119,62 @@ TEST(Base64Test, BinaryBufferEncode) {
   EXPECT_EQ("AAECAwgKCQCqvA==", Base64::encode(buffer, 10));
   EXPECT_EQ("AAECAwgKCQCqvN4=", Base64::encode(buffer, 30));
 }
+
+TEST(Base64Test, MultiSlicesBufferDecode) {
+  Buffer::OwnedImpl buffer;
+  addSlice(buffer, "Zm9v");
+  addSlice(buffer, "Ym");
+  addSlice(buffer, "F");
+  addSlice(buffer, "yYmF6");
+  EXPECT_EQ("foo", Base64::decode(buffer, 4));
+  EXPECT_EQ("", Base64::decode(buffer, 6));
+  EXPECT_EQ("foobar", Base64::decode(buffer, 8));
+  EXPECT_EQ("foobarbaz", Base64::decode(buffer, 12));
+  EXPECT_EQ("foobarbaz", Base64::decode(buffer, 13));
+  EXPECT_EQ("", Base64::decode(buffer, 0));
+
+  Buffer::OwnedImpl padded;
+  addSlice(padded, "Zm9vYg");
+  addSlice(padded, "==");
+  EXPECT_EQ("foob", Base64::decode(padded, 8));
+
+  Buffer::OwnedImpl invalid;
+  addSlice(invalid, "Zm9v");
+  addSlice(invalid, "Y.Fy");
+  EXPECT_EQ("", Base64::decode(invalid, 8));
+}
+
+// Inputs long enough to take the vectorized paths, with a byte changed at each position of the
+// encoding to check that the vectorized validation agrees with the encoder.
+TEST(Base64Test, LongInput) {
+  std::string input;
+  for (uint32_t i = 0; i < 1000; i++) {
+    input.push_back(static_cast<char>(i * 7 + i / 256));
+  }
+
+  for (uint64_t length : {47, 48, 49, 50, 100, 1000}) {
+    const std::string encoded = Base64::encode(input.data(), length);
+    EXPECT_EQ(input.substr(0, length), Base64::decode(encoded));
+
+    // Split both the input and the encoding over slices that do not line up with blocks.
+    Buffer::OwnedImpl buffer;
+    Buffer::OwnedImpl encoded_buffer;
+    for (uint64_t i = 0; i < length; i += 17) {
+      addSlice(buffer, input.substr(i, std::min<uint64_t>(17, length - i)));
+    }
+    for (uint64_t i = 0; i < encoded.size(); i += 29) {
+      addSlice(encoded_buffer, encoded.substr(i, 29));
+    }
+    EXPECT_EQ(encoded, Base64::encode(buffer, length));
+    EXPECT_EQ(input.substr(0, length), Base64::decode(encoded_buffer, encoded.size()));
+
+    for (uint64_t i = 0; i < encoded.size() - 4; i++) {
+      std::string invalid = encoded;
+      invalid[i] = i % 2 == 0 ? '.' : '\xff';
+      EXPECT_EQ("", Base64::decode(invalid));
+      invalid[i] = '=';
+      EXPECT_EQ("", Base64::decode(invalid));
+    }
+  }
+}
 } // namespace Envoy
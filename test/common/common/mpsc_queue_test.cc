@@ -0,0 +1,74 @@
+#include <cstdint>
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include "common/common/mpsc_queue.h"
+
+#include "gtest/gtest.h"
+
+namespace Envoy {
+
+struct TestNode : public MpscQueueNode {
+  TestNode(uint32_t producer, uint32_t sequence) : producer_(producer), sequence_(sequence) {}
+
+  const uint32_t producer_;
+  const uint32_t sequence_;
+};
+
+TEST(MpscQueueTest, Fifo) {
+  MpscQueue<TestNode> queue;
+  EXPECT_TRUE(queue.empty());
+  EXPECT_EQ(nullptr, queue.pop());
+
+  TestNode node1(0, 1);
+  TestNode node2(0, 2);
+  queue.push(&node1);
+  EXPECT_FALSE(queue.empty());
+  queue.push(&node2);
+  EXPECT_EQ(&node1, queue.pop());
+  EXPECT_EQ(&node2, queue.pop());
+  EXPECT_TRUE(queue.empty());
+  EXPECT_EQ(nullptr, queue.pop());
+
+  // A popped node can be pushed again.
+  queue.push(&node1);
+  EXPECT_EQ(&node1, queue.pop());
+  EXPECT_TRUE(queue.empty());
+}
+
+TEST(MpscQueueTest, ConcurrentProducers) {
+  const uint32_t num_producers = 4;
+  const uint32_t num_nodes = 10000;
+  MpscQueue<TestNode> queue;
+
+  std::vector<std::thread> producers;
+  for (uint32_t i = 0; i < num_producers; i++) {
+    producers.emplace_back([&queue, i]() -> void {
+      for (uint32_t j = 0; j < num_nodes; j++) {
+        queue.push(new TestNode(i, j));
+      }
+    });
+  }
+
+  // The nodes of each producer come out in the order it pushed them in.
+  std::vector<uint32_t> next(num_producers, 0);
+  uint32_t popped = 0;
+  while (popped < num_producers * num_nodes) {
+    std::unique_ptr<TestNode> node(queue.pop());
+    if (node == nullptr) {
+      std::this_thread::yield();
+      continue;
+    }
+    EXPECT_EQ(next[node->producer_]++, node->sequence_);
+    popped++;
+  }
+
+  for (std::thread& producer : producers) {
+    producer.join();
+  }
+  EXPECT_TRUE(queue.empty());
+  EXPECT_EQ(nullptr, queue.pop());
+}
+
+} // namespace Envoy
@@ -0,0 +1,114 @@
+#include <cstdint>
+#include <memory>
+#include <thread>
+
+#include "common/common/object_pool.h"
+
+#include "gtest/gtest.h"
+
+namespace Envoy {
+namespace {
+
+class ObjectPoolTest : public testing::Test {
+public:
+  ObjectPoolTest() { ObjectPool::setMaxRetainedBytes(ObjectPool::DefaultMaxRetainedBytes); }
+  ~ObjectPoolTest() { ObjectPool::setMaxRetainedBytes(ObjectPool::DefaultMaxRetainedBytes); }
+};
+
+class Base : public PooledObject {
+public:
+  virtual ~Base() {}
+
+  uint64_t base_[8];
+};
+
+class Derived : public Base {
+public:
+  uint64_t derived_[32];
+};
+
+TEST_F(ObjectPoolTest, ReuseFreedMemory) {
+  void* memory = ObjectPool::allocate(100);
+  ObjectPool::release(memory, 100);
+  const ObjectPoolStats before = ObjectPool::stats();
+  EXPECT_LE(1UL, before.retained_objects_);
+  EXPECT_LE(128UL, before.retained_bytes_);
+
+  // Sizes in the same size class share the storage.
+  EXPECT_EQ(memory, ObjectPool::allocate(128));
+  const ObjectPoolStats after = ObjectPool::stats();
+  EXPECT_EQ(before.reused_ + 1, after.reused_);
+  EXPECT_EQ(before.retained_objects_ - 1, after.retained_objects_);
+  EXPECT_EQ(before.retained_bytes_ - 128, after.retained_bytes_);
+  ObjectPool::release(memory, 128);
+}
+
+TEST_F(ObjectPoolTest, DifferentSizeClassesDoNotMix) {
+  void* small = ObjectPool::allocate(64);
+  ObjectPool::release(small, 64);
+  const uint64_t allocated = ObjectPool::stats().allocated_;
+  void* large = ObjectPool::allocate(1000);
+  EXPECT_EQ(allocated + 1, ObjectPool::stats().allocated_);
+  ObjectPool::release(large, 1000);
+}
+
+TEST_F(ObjectPoolTest, LargeObjectsAreNotPooled) {
+  const ObjectPoolStats before = ObjectPool::stats();
+  void* memory = ObjectPool::allocate(ObjectPool::MaxObjectSize + 1);
+  ObjectPool::release(memory, ObjectPool::MaxObjectSize + 1);
+  const ObjectPoolStats after = ObjectPool::stats();
+  EXPECT_EQ(before.allocated_, after.allocated_);
+  EXPECT_EQ(before.retained_bytes_, after.retained_bytes_);
+}
+
+TEST_F(ObjectPoolTest, RetentionLimit) {
+  ObjectPool::setMaxRetainedBytes(0);
+  // Freed storage goes straight back to the heap and any cached storage is released.
+  void* memory = ObjectPool::allocate(256);
+  ObjectPool::release(memory, 256);
+
+  std::thread thread([]() {
+    const ObjectPoolStats before = ObjectPool::stats();
+    void* memory = ObjectPool::allocate(256);
+    ObjectPool::release(memory, 256);
+    EXPECT_EQ(before.retained_bytes_, ObjectPool::stats().retained_bytes_);
+  });
+  thread.join();
+
+  ObjectPool::setMaxRetainedBytes(256);
+  std::thread thread2([]() {
+    const ObjectPoolStats before = ObjectPool::stats();
+    void* memory1 = ObjectPool::allocate(256);
+    void* memory2 = ObjectPool::allocate(256);
+    ObjectPool::release(memory1, 256);
+    ObjectPool::release(memory2, 256);
+    EXPECT_EQ(before.retained_bytes_ + 256, ObjectPool::stats().retained_bytes_);
+  });
+  thread2.join();
+}
+
+TEST_F(ObjectPoolTest, ThreadExitReleasesPool) {
+  const ObjectPoolStats before = ObjectPool::stats();
+  std::thread thread([]() { delete new Base(); });
+  thread.join();
+  const ObjectPoolStats after = ObjectPool::stats();
+  EXPECT_EQ(before.retained_bytes_, after.retained_bytes_);
+  EXPECT_EQ(before.retained_objects_, after.retained_objects_);
+  // The counts of the exited thread are kept.
+  EXPECT_EQ(before.allocated_ + 1, after.allocated_);
+}
+
+// Validate that objects are freed into the size class of their most derived class.
+TEST_F(ObjectPoolTest, PooledObjects) {
+  std::unique_ptr<Base> derived{new Derived()};
+  Base* derived_memory = derived.get();
+  derived.reset();
+  std::unique_ptr<Base> base{new Base()};
+  const ObjectPoolStats before = ObjectPool::stats();
+  derived.reset(new Derived());
+  EXPECT_EQ(derived_memory, derived.get());
+  EXPECT_EQ(before.reused_ + 1, ObjectPool::stats().reused_);
+}
+
+} // namespace
+} // namespace Envoy
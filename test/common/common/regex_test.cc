@@ -0,0 +1,108 @@
+#include <regex>
+#include <string>
+#include <vector>
+
+#include "common/common/regex.h"
+
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+
+using testing::ElementsAre;
+using testing::IsEmpty;
+
+namespace Envoy {
+namespace Regex {
+
+// Check that both engines agree with std::regex_match on each input.
+void expectSameAsStd(const std::string& pattern, const std::vector<std::string>& inputs) {
+  const std::regex regex(pattern);
+  const MatcherPtr linear = Utility::parseRegex(pattern, Engine::Linear);
+  const MatcherPtr std_engine = Utility::parseRegex(pattern, Engine::Std);
+  for (const std::string& input : inputs) {
+    const bool expected = std::regex_match(input, regex);
+    EXPECT_EQ(expected, linear->match(input)) << pattern << " on " << input;
+    EXPECT_EQ(expected, std_engine->match(input)) << pattern << " on " << input;
+  }
+}
+
+TEST(RegexTest, Literals) {
+  expectSameAsStd("/foo/bar", {"/foo/bar", "/foo/ba", "/foo/bar/", "", "/FOO/bar"});
+  expectSameAsStd("", {"", "a"});
+  expectSameAsStd("a\\.b\\/c\\\\", {"a.b/c\\", "axb/c\\"});
+}
+
+TEST(RegexTest, Classes) {
+  expectSameAsStd(".", {"a", "\n", "\r", "\t", "", "ab"});
+  expectSameAsStd("\\d\\w\\s", {"1a ", "1_\t", "a1 ", "11\n", "1a"});
+  expectSameAsStd("\\D\\W\\S", {"a-x", "1-x", "a x", "a- "});
+  expectSameAsStd("[a-c_\\d-]+", {"abc", "a_9-", "abcd", "", "-"});
+  expectSameAsStd("[^/]+", {"foo", "fo/o", ""});
+  expectSameAsStd("[\\s\\]]", {" ", "]", "\\"});
+}
+
+TEST(RegexTest, Quantifiers) {
+  expectSameAsStd("a*b+c?", {"b", "aabbc", "abcc", "ac", ""});
+  expectSameAsStd("a{2}b{1,3}c{2,}", {"aabcc", "aabbbccc", "abcc", "aabbbbcc", "aabc"});
+  expectSameAsStd("a*?b+?", {"aab", "b", "a"});
+  expectSameAsStd("(a*)*b", {"aaab", "b", "aaa"});
+}
+
+TEST(RegexTest, GroupsAlternationAndAnchors) {
+  expectSameAsStd("/api/(v1|v2)/(?:users|groups)/\\d+",
+                  {"/api/v1/users/12", "/api/v3/users/12", "/api/v2/groups/", "/api/v2/groups/9"});
+  expectSameAsStd("a|b|", {"a", "b", "", "ab"});
+  expectSameAsStd("^/foo.*$", {"/foo", "/foo/bar", "/fo"});
+  expectSameAsStd("(^a|b)+", {"a", "ab", "ba", "bb"});
+}
+
+// Patterns outside of the linear engine's grammar go through std::regex.
+TEST(RegexTest, Unsupported) {
+  expectSameAsStd("(a)\\1", {"aa", "ab"});
+  expectSameAsStd("a(?=b).", {"ab", "ac"});
+  expectSameAsStd("\\bfoo\\b", {"foo", "foox"});
+  expectSameAsStd("[[:digit:]]+", {"123", "12a"});
+  expectSameAsStd("\\x41", {"A", "x41"});
+}
+
+TEST(RegexTest, Invalid) {
+  EXPECT_THROW(Utility::parseRegex("(a", Engine::Linear), std::regex_error);
+  EXPECT_THROW(Utility::parseRegex("*a", Engine::Linear), std::regex_error);
+  EXPECT_THROW(Utility::parseRegex("[b-a]", Engine::Std), std::regex_error);
+}
+
+// The linear engine does not backtrack, so this completes quickly.
+TEST(RegexTest, PathologicalPattern) {
+  const MatcherPtr matcher = Utility::parseRegex("(a|a)*b", Engine::Linear);
+  EXPECT_FALSE(matcher->match(std::string(10000, 'a')));
+  EXPECT_TRUE(matcher->match(std::string(10000, 'a') + "b"));
+}
+
+TEST(RegexTest, PatternSet) {
+  PatternSet set;
+  EXPECT_TRUE(set.empty());
+  EXPECT_TRUE(set.add("/foo/.*", 3));
+  EXPECT_FALSE(set.add("(a)\\1", 4));
+  EXPECT_TRUE(set.add("/foo/\\d+", 1));
+  EXPECT_TRUE(set.add(".*", 7));
+  EXPECT_FALSE(set.empty());
+
+  std::vector<uint32_t> ids{42};
+  const std::string input("/foo/123");
+  set.match(input.data(), input.data() + input.size(), ids);
+  EXPECT_THAT(ids, ElementsAre(1, 3, 7));
+
+  const std::string other("/bar");
+  set.match(other.data(), other.data() + other.size(), ids);
+  EXPECT_THAT(ids, ElementsAre(7));
+}
+
+TEST(RegexTest, EmptyPatternSet) {
+  PatternSet set;
+  std::vector<uint32_t> ids{42};
+  const std::string input("/foo");
+  set.match(input.data(), input.data() + input.size(), ids);
+  EXPECT_THAT(ids, IsEmpty());
+}
+
+} // namespace Regex
+} // namespace Envoy
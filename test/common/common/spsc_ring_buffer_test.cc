@@ -0,0 +1,79 @@
+#include <cstdint>
+#include <string>
+#include <thread>
+
+#include "common/common/spsc_ring_buffer.h"
+
+#include "gtest/gtest.h"
+
+namespace Envoy {
+
+std::string readAll(SpscRingBuffer& ring) {
+  std::string data;
+  ring.read([&data](const char* piece, uint64_t size) -> void { data.append(piece, size); });
+  return data;
+}
+
+TEST(SpscRingBufferTest, WriteRead) {
+  SpscRingBuffer ring(16);
+  EXPECT_EQ(16UL, ring.capacity());
+  EXPECT_EQ(16UL, ring.writable());
+  EXPECT_EQ(0UL, ring.readable());
+  EXPECT_EQ("", readAll(ring));
+
+  ring.write("hello", 5);
+  ring.write(" world", 6);
+  EXPECT_EQ(5UL, ring.writable());
+  EXPECT_EQ(11UL, ring.readable());
+  EXPECT_EQ("hello world", readAll(ring));
+  EXPECT_EQ(16UL, ring.writable());
+  EXPECT_EQ(0UL, ring.readable());
+}
+
+// Validate that data that wraps around the end of the ring is read back in two pieces.
+TEST(SpscRingBufferTest, WrapAround) {
+  SpscRingBuffer ring(8);
+  ring.write("abcdef", 6);
+  EXPECT_EQ("abcdef", readAll(ring));
+
+  ring.write("ghijklmn", 8);
+  EXPECT_EQ(0UL, ring.writable());
+  uint32_t pieces = 0;
+  std::string data;
+  EXPECT_EQ(8UL, ring.read([&](const char* piece, uint64_t size) -> void {
+    pieces++;
+    data.append(piece, size);
+  }));
+  EXPECT_EQ(2U, pieces);
+  EXPECT_EQ("ghijklmn", data);
+}
+
+TEST(SpscRingBufferTest, ConcurrentProducerConsumer) {
+  SpscRingBuffer ring(64);
+  const uint32_t count = 20000;
+  std::thread producer([&ring, count]() -> void {
+    for (uint32_t i = 0; i < count; i++) {
+      while (ring.writable() < sizeof(i)) {
+        std::this_thread::yield();
+      }
+      ring.write(&i, sizeof(i));
+    }
+  });
+
+  // The values read back are the sequence that was written.
+  std::string data;
+  uint32_t next = 0;
+  while (next < count) {
+    ring.read([&data](const char* piece, uint64_t size) -> void { data.append(piece, size); });
+    while (data.size() >= sizeof(next)) {
+      uint32_t value;
+      memcpy(&value, data.data(), sizeof(value));
+      data.erase(0, sizeof(value));
+      EXPECT_EQ(next++, value);
+    }
+  }
+  producer.join();
+  EXPECT_EQ(0UL, ring.readable());
+}
+
+} // namespace Envoy
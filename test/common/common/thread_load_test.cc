@@ -0,0 +1,37 @@
+#include <chrono>
+
+#include "common/common/thread_load.h"
+
+#include "gtest/gtest.h"
+
+namespace Envoy {
+
+TEST(ThreadLoadTest, NoCurrent) {
+  EXPECT_EQ(nullptr, ThreadLoad::current());
+  ThreadLoad::addRxBytes(10);
+  ThreadLoad::onRequestStart();
+}
+
+TEST(ThreadLoadTest, Counters) {
+  ThreadLoad load;
+  ThreadLoad::setCurrent(&load);
+  EXPECT_EQ(&load, ThreadLoad::current());
+
+  ThreadLoad::addRxBytes(10);
+  ThreadLoad::addTxBytes(20);
+  ThreadLoad::onRequestStart();
+  ThreadLoad::onRequestStart();
+  ThreadLoad::onRequestEnd();
+  EXPECT_FALSE(load.busyTracked());
+  ThreadLoad::addBusyTime(std::chrono::microseconds(5));
+  ThreadLoad::setCurrent(nullptr);
+
+  EXPECT_EQ(10UL, load.rxBytes());
+  EXPECT_EQ(20UL, load.txBytes());
+  EXPECT_EQ(2UL, load.requestsTotal());
+  EXPECT_EQ(1UL, load.activeRequests());
+  EXPECT_TRUE(load.busyTracked());
+  EXPECT_EQ(std::chrono::microseconds(5), load.busyTime());
+}
+
+} // namespace Envoy
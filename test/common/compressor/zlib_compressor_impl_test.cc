@@ -5,6 +5,7 @@
 #include "test/test_common/utility.h"
 
 #include "gtest/gtest.h"
+#include "zlib.h"
 
 namespace Envoy {
 namespace Compressor {
@@ -15,6 +16,29 @@ protected:
   static const int64_t gzip_window_bits{31};
   static const int64_t memory_level{8};
   static const uint64_t default_input_size{796};
+
+  // Decompresses a complete gzip stream, expecting it to be terminated.
+  static std::string decompress(const Buffer::Instance& compressed) {
+    std::string input = TestUtility::bufferToString(compressed);
+    z_stream zstream{};
+    EXPECT_EQ(Z_OK, inflateInit2(&zstream, gzip_window_bits));
+    zstream.avail_in = input.size();
+    zstream.next_in = reinterpret_cast<Bytef*>(&input[0]);
+
+    std::string output;
+    int result = Z_OK;
+    while (result == Z_OK) {
+      unsigned char chunk[4096];
+      zstream.avail_out = sizeof(chunk);
+      zstream.next_out = chunk;
+      result = inflate(&zstream, Z_NO_FLUSH);
+      output.append(reinterpret_cast<char*>(chunk), sizeof(chunk) - zstream.avail_out);
+    }
+    EXPECT_EQ(Z_STREAM_END, result);
+    EXPECT_EQ(0, zstream.avail_in);
+    inflateEnd(&zstream);
+    return output;
+  }
 };
 
 class ZlibCompressorImplDeathTest : public ZlibCompressorImplTest {
@@ -281,6 +305,65 @@ TEST_F(ZlibCompressorImplTest, CompressWithNotCommonParams) {
   EXPECT_EQ("0000ffff", footer_hex_str.substr(footer_hex_str.size() - 8, 10));
 }
 
+/**
+ * Exercises finishing a stream, which has to produce a complete gzip stream rather than one ending
+ * in a sync flush marker.
+ */
+TEST_F(ZlibCompressorImplTest, CompressAndFinish) {
+  Buffer::OwnedImpl input_buffer;
+  Buffer::OwnedImpl output_buffer;
+  std::string expected;
+
+  // A small output chunk makes finish() write the end of the stream over several chunks.
+  Envoy::Compressor::ZlibCompressorImpl compressor(64);
+  compressor.init(ZlibCompressorImpl::CompressionLevel::Standard,
+                  ZlibCompressorImpl::CompressionStrategy::Standard, gzip_window_bits,
+                  memory_level);
+
+  for (uint64_t i = 0; i < 10; i++) {
+    TestUtility::feedBufferWithRandomCharacters(input_buffer, default_input_size * i, i);
+    expected += TestUtility::bufferToString(input_buffer);
+    compressor.compress(input_buffer, output_buffer);
+    input_buffer.drain(default_input_size * i);
+  }
+
+  compressor.finish(output_buffer);
+  EXPECT_EQ(expected, decompress(output_buffer));
+
+  const std::string compressed = TestUtility::bufferToString(output_buffer);
+  const std::string hex_str =
+      Hex::encode(reinterpret_cast<const uint8_t*>(compressed.data()), compressed.size());
+  // HEADER 0x1f = 31 (window_bits)
+  EXPECT_EQ("1f8b", hex_str.substr(0, 4));
+  EXPECT_NE("0000ffff", hex_str.substr(hex_str.size() - 8, 10));
+}
+
+/**
+ * Exercises reusing a compressor for a second stream after reset.
+ */
+TEST_F(ZlibCompressorImplTest, ResetAndReuse) {
+  Envoy::Compressor::ZlibCompressorImpl compressor;
+  compressor.init(ZlibCompressorImpl::CompressionLevel::Standard,
+                  ZlibCompressorImpl::CompressionStrategy::Standard, gzip_window_bits,
+                  memory_level);
+
+  for (uint64_t i = 1; i < 4; i++) {
+    Buffer::OwnedImpl input_buffer;
+    Buffer::OwnedImpl output_buffer;
+    TestUtility::feedBufferWithRandomCharacters(input_buffer, default_input_size * i, i);
+    const std::string expected = TestUtility::bufferToString(input_buffer);
+
+    compressor.compress(input_buffer, output_buffer);
+    compressor.flush(output_buffer);
+    compressor.compress(input_buffer, output_buffer);
+    compressor.finish(output_buffer);
+    EXPECT_EQ(expected + expected, decompress(output_buffer));
+
+    compressor.reset();
+    EXPECT_EQ(0, compressor.checksum());
+  }
+}
+
 } // namespace
 } // namespace Compressor
 } // namespace Envoy
@@ -0,0 +1,277 @@
+#include <map>
+#include <string>
+#include <vector>
+
+#include "common/config/incremental_grpc_mux_impl.h"
+#include "common/protobuf/protobuf.h"
+
+#include "test/mocks/config/mocks.h"
+#include "test/mocks/event/mocks.h"
+#include "test/mocks/grpc/mocks.h"
+#include "test/test_common/utility.h"
+
+#include "fmt/format.h"
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+
+using testing::InSequence;
+using testing::Invoke;
+using testing::IsSubstring;
+using testing::NiceMock;
+using testing::Return;
+using testing::_;
+
+namespace Envoy {
+namespace Config {
+namespace {
+
+typedef Grpc::MockAsyncClient<envoy::config::IncrementalDiscoveryRequest,
+                              envoy::config::IncrementalDiscoveryResponse>
+    IncrementalMockAsyncClient;
+
+class IncrementalGrpcMuxImplTest : public testing::Test {
+public:
+  IncrementalGrpcMuxImplTest()
+      : async_client_(new IncrementalMockAsyncClient()), timer_(new Event::MockTimer()) {
+    node_.set_id("node");
+    EXPECT_CALL(dispatcher_, createTimer_(_)).WillOnce(Invoke([this](Event::TimerCb timer_cb) {
+      timer_cb_ = timer_cb;
+      return timer_;
+    }));
+    grpc_mux_.reset(new IncrementalGrpcMuxImpl(
+        node_, std::unique_ptr<IncrementalMockAsyncClient>(async_client_), dispatcher_,
+        *Protobuf::DescriptorPool::generated_pool()->FindMethodByName(
+            IncrementalGrpcMuxImpl::SERVICE_METHOD)));
+  }
+
+  void expectSendMessage(const std::string& type_url, const std::vector<std::string>& subscribe,
+                         const std::vector<std::string>& unsubscribe,
+                         const std::string& nonce = "", bool first = false,
+                         const std::map<std::string, std::string>& versions = {},
+                         const std::string& error_detail = "") {
+    envoy::config::IncrementalDiscoveryRequest expected_request;
+    if (first) {
+      expected_request.mutable_node()->CopyFrom(node_);
+    }
+    expected_request.set_type_url(type_url);
+    for (const auto& resource : subscribe) {
+      expected_request.add_resource_names_subscribe(resource);
+    }
+    for (const auto& resource : unsubscribe) {
+      expected_request.add_resource_names_unsubscribe(resource);
+    }
+    for (const auto& version : versions) {
+      (*expected_request.mutable_initial_resource_versions())[version.first] = version.second;
+    }
+    expected_request.set_response_nonce(nonce);
+    expected_request.set_error_detail(error_detail);
+    EXPECT_CALL(async_stream_, sendMessage(ProtoEq(expected_request), false));
+  }
+
+  std::unique_ptr<envoy::config::IncrementalDiscoveryResponse>
+  response(const std::string& type_url, const std::vector<std::string>& added,
+           const std::vector<std::string>& removed, const std::string& nonce) {
+    std::unique_ptr<envoy::config::IncrementalDiscoveryResponse> response(
+        new envoy::config::IncrementalDiscoveryResponse());
+    response->set_type_url(type_url);
+    response->set_system_version_info("system");
+    response->set_nonce(nonce);
+    for (const std::string& name : added) {
+      auto* resource = response->add_resources();
+      resource->set_name(name);
+      resource->set_version(name + "1");
+      resource->mutable_resource()->set_type_url(type_url);
+      resource->mutable_resource()->set_value(name);
+    }
+    for (const std::string& name : removed) {
+      response->add_removed_resources(name);
+    }
+    return response;
+  }
+
+  // Expect an update of callbacks with the resources whose values are added and the names removed.
+  void expectUpdate(MockGrpcMuxCallbacks& callbacks, const std::vector<std::string>& added,
+                    const std::vector<std::string>& removed) {
+    EXPECT_CALL(callbacks, onIncrementalConfigUpdate(_, removed, "system"))
+        .WillOnce(Invoke([added](const Protobuf::RepeatedPtrField<ProtobufWkt::Any>& resources,
+                                 const std::vector<std::string>&, const std::string&) {
+          ASSERT_EQ(added.size(), resources.size());
+          for (size_t i = 0; i < added.size(); i++) {
+            EXPECT_EQ(added[i], resources[i].value());
+          }
+        }));
+  }
+
+  envoy::api::v2::Node node_;
+  NiceMock<Event::MockDispatcher> dispatcher_;
+  IncrementalMockAsyncClient* async_client_;
+  Event::MockTimer* timer_;
+  Event::TimerCb timer_cb_;
+  Grpc::MockAsyncStream<envoy::config::IncrementalDiscoveryRequest> async_stream_;
+  std::unique_ptr<IncrementalGrpcMuxImpl> grpc_mux_;
+  MockGrpcMuxCallbacks callbacks_;
+};
+
+// Only the names that watches start or stop watching are sent.
+TEST_F(IncrementalGrpcMuxImplTest, SubscriptionDeltas) {
+  InSequence s;
+  auto foo_sub = grpc_mux_->subscribe("foo", {"x", "y"}, callbacks_);
+  auto bar_sub = grpc_mux_->subscribe("bar", {}, callbacks_);
+  EXPECT_CALL(*async_client_, start(_, _)).WillOnce(Return(&async_stream_));
+  expectSendMessage("foo", {"x", "y"}, {}, "", true);
+  expectSendMessage("bar", {}, {}, "", true);
+  grpc_mux_->start();
+
+  expectSendMessage("foo", {"z"}, {});
+  auto foo_yz_sub = grpc_mux_->subscribe("foo", {"y", "z"}, callbacks_);
+  // Nothing new to subscribe to.
+  auto foo_z_sub = grpc_mux_->subscribe("foo", {"z"}, callbacks_);
+  expectSendMessage("foo", {}, {"x"});
+  foo_sub.reset();
+
+  expectSendMessage("foo", {}, {"y"});
+  foo_yz_sub.reset();
+  expectSendMessage("foo", {}, {"z"});
+  foo_z_sub.reset();
+}
+
+// Watches are only called back with the resources that concern them, and with any update until
+// they have heard back once.
+TEST_F(IncrementalGrpcMuxImplTest, WatchDemux) {
+  InSequence s;
+  MockGrpcMuxCallbacks foo_callbacks;
+  auto foo_sub = grpc_mux_->subscribe("foo", {"x", "y"}, foo_callbacks);
+  MockGrpcMuxCallbacks bar_callbacks;
+  auto bar_sub = grpc_mux_->subscribe("foo", {"z"}, bar_callbacks);
+  EXPECT_CALL(*async_client_, start(_, _)).WillOnce(Return(&async_stream_));
+  expectSendMessage("foo", {"x", "y", "z"}, {}, "", true);
+  grpc_mux_->start();
+
+  expectUpdate(bar_callbacks, {}, {});
+  expectUpdate(foo_callbacks, {"x"}, {});
+  expectSendMessage("foo", {}, {}, "1");
+  grpc_mux_->onReceiveMessage(response("foo", {"x"}, {}, "1"));
+
+  expectUpdate(foo_callbacks, {"y"}, {"x"});
+  expectSendMessage("foo", {}, {}, "2");
+  grpc_mux_->onReceiveMessage(response("foo", {"y"}, {"x"}, "2"));
+
+  expectUpdate(bar_callbacks, {"z"}, {});
+  expectSendMessage("foo", {}, {}, "3");
+  grpc_mux_->onReceiveMessage(response("foo", {"z"}, {}, "3"));
+
+  expectSendMessage("foo", {}, {"z"});
+  expectSendMessage("foo", {}, {"x", "y"});
+}
+
+// A watch of every resource gets the whole update.
+TEST_F(IncrementalGrpcMuxImplTest, WildcardWatch) {
+  InSequence s;
+  auto foo_sub = grpc_mux_->subscribe("foo", {}, callbacks_);
+  EXPECT_CALL(*async_client_, start(_, _)).WillOnce(Return(&async_stream_));
+  expectSendMessage("foo", {}, {}, "", true);
+  grpc_mux_->start();
+
+  expectUpdate(callbacks_, {"x", "y"}, {"z"});
+  expectSendMessage("foo", {}, {}, "1");
+  grpc_mux_->onReceiveMessage(response("foo", {"x", "y"}, {"z"}, "1"));
+}
+
+// A rejected update is reported to the server, and its versions are not kept.
+TEST_F(IncrementalGrpcMuxImplTest, Reject) {
+  InSequence s;
+  auto foo_sub = grpc_mux_->subscribe("foo", {"x"}, callbacks_);
+  EXPECT_CALL(*async_client_, start(_, _)).WillOnce(Return(&async_stream_));
+  expectSendMessage("foo", {"x"}, {}, "", true);
+  grpc_mux_->start();
+
+  EXPECT_CALL(callbacks_, onIncrementalConfigUpdate(_, _, _))
+      .WillOnce(Invoke([](const Protobuf::RepeatedPtrField<ProtobufWkt::Any>&,
+                          const std::vector<std::string>&,
+                          const std::string&) { throw EnvoyException("bad x"); }));
+  EXPECT_CALL(callbacks_, onConfigUpdateFailed(_));
+  expectSendMessage("foo", {}, {}, "1", false, {}, "bad x");
+  grpc_mux_->onReceiveMessage(response("foo", {"x"}, {}, "1"));
+
+  EXPECT_CALL(callbacks_, onConfigUpdateFailed(nullptr));
+  EXPECT_CALL(*timer_, enableTimer(_));
+  grpc_mux_->onRemoteClose(Grpc::Status::GrpcStatus::Canceled, "");
+  EXPECT_CALL(*async_client_, start(_, _)).WillOnce(Return(&async_stream_));
+  expectSendMessage("foo", {"x"}, {}, "", true);
+  timer_cb_();
+
+  expectSendMessage("foo", {}, {"x"});
+}
+
+// Validate behavior when type URL mismatches occur.
+TEST_F(IncrementalGrpcMuxImplTest, TypeUrlMismatch) {
+  InSequence s;
+  auto foo_sub = grpc_mux_->subscribe("foo", {"x"}, callbacks_);
+  EXPECT_CALL(*async_client_, start(_, _)).WillOnce(Return(&async_stream_));
+  expectSendMessage("foo", {"x"}, {}, "", true);
+  grpc_mux_->start();
+
+  // Unknown types are ignored.
+  grpc_mux_->onReceiveMessage(response("bar", {"x"}, {}, "1"));
+
+  auto mismatch = response("foo", {"x"}, {}, "2");
+  mismatch->mutable_resources(0)->mutable_resource()->set_type_url("bar");
+  const std::string error = "bar does not match foo type URL is IncrementalDiscoveryResponse";
+  EXPECT_CALL(callbacks_, onConfigUpdateFailed(_))
+      .WillOnce(Invoke([&error](const EnvoyException* e) {
+        EXPECT_TRUE(IsSubstring("", "", error, e->what()));
+      }));
+  expectSendMessage("foo", {}, {}, "2", false, {},
+                    fmt::format("{} {}", error, mismatch->DebugString()));
+  grpc_mux_->onReceiveMessage(std::move(mismatch));
+
+  expectSendMessage("foo", {}, {"x"});
+}
+
+// A new stream starts over with the names watched and the versions of the resources received.
+TEST_F(IncrementalGrpcMuxImplTest, ResumeWithVersions) {
+  InSequence s;
+  auto foo_sub = grpc_mux_->subscribe("foo", {"x", "y"}, callbacks_);
+  EXPECT_CALL(*async_client_, start(_, _)).WillOnce(Return(&async_stream_));
+  expectSendMessage("foo", {"x", "y"}, {}, "", true);
+  grpc_mux_->start();
+
+  expectUpdate(callbacks_, {"x", "y"}, {});
+  expectSendMessage("foo", {}, {}, "1");
+  grpc_mux_->onReceiveMessage(response("foo", {"x", "y"}, {}, "1"));
+  expectUpdate(callbacks_, {}, {"y"});
+  expectSendMessage("foo", {}, {}, "2");
+  grpc_mux_->onReceiveMessage(response("foo", {}, {"y"}, "2"));
+
+  EXPECT_CALL(callbacks_, onConfigUpdateFailed(nullptr));
+  EXPECT_CALL(*timer_, enableTimer(_));
+  grpc_mux_->onRemoteClose(Grpc::Status::GrpcStatus::Canceled, "");
+  EXPECT_CALL(*async_client_, start(_, _)).WillOnce(Return(&async_stream_));
+  expectSendMessage("foo", {"x", "y"}, {}, "", true, {{"x", "x1"}});
+  timer_cb_();
+
+  expectSendMessage("foo", {}, {"x", "y"});
+}
+
+// Subscription changes during a pause are sent together on resume.
+TEST_F(IncrementalGrpcMuxImplTest, PauseResume) {
+  InSequence s;
+  auto foo_sub = grpc_mux_->subscribe("foo", {"x"}, callbacks_);
+  EXPECT_CALL(*async_client_, start(_, _)).WillOnce(Return(&async_stream_));
+  expectSendMessage("foo", {"x"}, {}, "", true);
+  grpc_mux_->start();
+
+  grpc_mux_->pause("foo");
+  auto foo_y_sub = grpc_mux_->subscribe("foo", {"y"}, callbacks_);
+  auto foo_z_sub = grpc_mux_->subscribe("foo", {"z"}, callbacks_);
+  foo_sub.reset();
+  expectSendMessage("foo", {"y", "z"}, {"x"});
+  grpc_mux_->resume("foo");
+
+  expectSendMessage("foo", {}, {"z"});
+  expectSendMessage("foo", {}, {"y"});
+}
+
+} // namespace
+} // namespace Config
+} // namespace Envoy
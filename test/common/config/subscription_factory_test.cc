@@ -1,6 +1,8 @@
 #include "envoy/common/exception.h"
 
+#include "common/config/metadata.h"
 #include "common/config/subscription_factory.h"
+#include "common/config/well_known_names.h"
 
 #include "test/mocks/config/mocks.h"
 #include "test/mocks/event/mocks.h"
@@ -146,7 +148,7 @@ TEST_F(SubscriptionFactoryTest, GrpcSubscription) {
   Upstream::MockCluster cluster;
   cluster_map.emplace("eds_cluster", cluster);
   EXPECT_CALL(cm_, clusters()).WillOnce(Return(cluster_map));
-  EXPECT_CALL(cluster, info()).Times(2);
+  EXPECT_CALL(cluster, info()).Times(3);
   EXPECT_CALL(*cluster.info_, addedViaApi());
   EXPECT_CALL(dispatcher_, createTimer_(_));
   EXPECT_CALL(cm_, httpAsyncClientForCluster("eds_cluster"));
@@ -163,6 +165,37 @@ TEST_F(SubscriptionFactoryTest, GrpcSubscription) {
   subscriptionFromConfigSource(config)->start({"foo"}, callbacks_);
 }
 
+// A management server cluster with the incremental_xds metadata key gets an incremental stream.
+TEST_F(SubscriptionFactoryTest, IncrementalGrpcSubscription) {
+  envoy::api::v2::ConfigSource config;
+  auto* api_config_source = config.mutable_api_config_source();
+  api_config_source->set_api_type(envoy::api::v2::ApiConfigSource::GRPC);
+  api_config_source->add_cluster_names("eds_cluster");
+  Upstream::ClusterManager::ClusterInfoMap cluster_map;
+  Upstream::MockCluster cluster;
+  cluster_map.emplace("eds_cluster", cluster);
+  Metadata::mutableMetadataValue(cluster.info_->metadata_, MetadataFilters::get().ENVOY_LB,
+                                 MetadataEnvoyLbKeys::get().INCREMENTAL_XDS)
+      .set_bool_value(true);
+  EXPECT_CALL(cm_, clusters()).WillOnce(Return(cluster_map));
+  EXPECT_CALL(cluster, info()).Times(3);
+  EXPECT_CALL(*cluster.info_, addedViaApi());
+  EXPECT_CALL(dispatcher_, createTimer_(_));
+  EXPECT_CALL(cm_, httpAsyncClientForCluster("eds_cluster"));
+  NiceMock<Http::MockAsyncClientStream> stream;
+  EXPECT_CALL(cm_.async_client_, start(_, _, false)).WillOnce(Return(&stream));
+  Http::TestHeaderMapImpl headers{
+      {":method", "POST"},
+      {":path",
+       "/envoy.config.IncrementalAggregatedDiscoveryService/IncrementalAggregatedResources"},
+      {":authority", "eds_cluster"},
+      {"content-type", "application/grpc"},
+      {"te", "trailers"}};
+  EXPECT_CALL(stream, sendHeaders(HeaderMapEqualRef(&headers), _));
+  EXPECT_CALL(cm_.async_client_.dispatcher_, deferredDelete_(_));
+  subscriptionFromConfigSource(config)->start({"foo"}, callbacks_);
+}
+
 INSTANTIATE_TEST_CASE_P(SubscriptionFactoryTestApiConfigSource,
                         SubscriptionFactoryTestApiConfigSource,
                         ::testing::Values(envoy::api::v2::ApiConfigSource::REST_LEGACY,
@@ -43,6 +43,59 @@ TEST(UtilityTest, GetTypedResources) {
   EXPECT_EQ("1", typed_resources[1].cluster_name());
 }
 
+TEST(UtilityTest, UnpackResources) {
+  Protobuf::RepeatedPtrField<ProtobufWkt::Any> resources;
+  envoy::api::v2::ClusterLoadAssignment load_assignment;
+  load_assignment.set_cluster_name("0");
+  resources.Add()->PackFrom(load_assignment);
+  load_assignment.set_cluster_name("1");
+  resources.Add()->PackFrom(load_assignment);
+
+  Protobuf::Arena arena;
+  Protobuf::RepeatedPtrField<envoy::api::v2::ClusterLoadAssignment> typed_resources(&arena);
+  Utility::unpackResources(resources, typed_resources);
+  EXPECT_EQ(2, typed_resources.size());
+  EXPECT_EQ("0", typed_resources[0].cluster_name());
+  EXPECT_EQ("1", typed_resources[1].cluster_name());
+
+  resources.Mutable(1)->set_value("\xff");
+  EXPECT_THROW(Utility::unpackResources(resources, typed_resources), EnvoyException);
+}
+
+TEST(UtilityTest, ResourceName) {
+  envoy::api::v2::Cluster cluster;
+  cluster.set_name("cluster_0");
+  cluster.set_type(envoy::api::v2::Cluster::STRICT_DNS);
+  cluster.mutable_connect_timeout()->set_seconds(5);
+  cluster.mutable_per_connection_buffer_limit_bytes()->set_value(1024);
+  ProtobufWkt::Any resource;
+  resource.PackFrom(cluster);
+  EXPECT_EQ("cluster_0", Utility::resourceName(resource));
+
+  // As when parsing, the last occurrence of the name wins.
+  envoy::api::v2::Cluster renamed_cluster;
+  renamed_cluster.set_name("cluster_1");
+  resource.set_value(resource.value() + renamed_cluster.SerializeAsString());
+  EXPECT_EQ("cluster_1", Utility::resourceName(resource));
+
+  envoy::api::v2::ClusterLoadAssignment load_assignment;
+  load_assignment.set_cluster_name("cluster_0");
+  load_assignment.add_endpoints()->mutable_locality()->set_zone("zone");
+  resource.PackFrom(load_assignment);
+  EXPECT_EQ("cluster_0", Utility::resourceName(resource));
+
+  resource.PackFrom(envoy::api::v2::ClusterLoadAssignment());
+  EXPECT_EQ("", Utility::resourceName(resource));
+
+  // A malformed resource is reported by the full parse.
+  resource.set_value("\xff");
+  EXPECT_THROW(Utility::resourceName(resource), EnvoyException);
+
+  resource.set_type_url("foo");
+  EXPECT_THROW_WITH_MESSAGE(Utility::resourceName(resource), EnvoyException,
+                            "Unknown type URL foo in DiscoveryResponse");
+}
+
 TEST(UtilityTest, ComputeHashedVersion) {
   EXPECT_EQ("hash_2e1472b57af294d1", Utility::computeHashedVersion("{}").first);
   EXPECT_EQ("hash_33bf00a859c4ba3f", Utility::computeHashedVersion("foo").first);
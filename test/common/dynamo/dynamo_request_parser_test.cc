@@ -1,9 +1,10 @@
 #include <string>
 #include <vector>
 
+#include "envoy/json/json_object.h"
+
 #include "common/dynamo/dynamo_request_parser.h"
 #include "common/http/header_map_impl.h"
-#include "common/json/json_loader.h"
 
 #include "test/test_common/printers.h"
 #include "test/test_common/utility.h"
@@ -12,6 +13,18 @@
 
 namespace Envoy {
 namespace Dynamo {
+namespace {
+
+// Splits the given body in to one slice per chunk, so that tokens may straddle slices.
+std::vector<Buffer::RawSlice> body(const std::vector<std::string>& chunks) {
+  std::vector<Buffer::RawSlice> slices;
+  for (const std::string& chunk : chunks) {
+    slices.push_back({const_cast<char*>(chunk.data()), chunk.size()});
+  }
+  return slices;
+}
+
+} // namespace
 
 TEST(DynamoRequestParser, parseOperation) {
   // Well formed x-amz-target header, in a format, Version.Operation
@@ -53,40 +66,45 @@ TEST(DynamoRequestParser, parseTableNameSingleOperation) {
       }
     }
     )EOF";
-    Json::ObjectSharedPtr json_data = Json::Factory::loadFromString(json_string);
 
     // Supported operation
     for (const std::string& operation : supported_single_operations) {
-      EXPECT_EQ("Pets", RequestParser::parseTable(operation, *json_data).table_name);
+      EXPECT_EQ("Pets", RequestParser::parseTable(operation, body({json_string})).table_name);
     }
 
     // Not supported operation
-    EXPECT_EQ("", RequestParser::parseTable("NotSupportedOperation", *json_data).table_name);
+    EXPECT_EQ("", RequestParser::parseTable("NotSupportedOperation", body({json_string}))
+                      .table_name);
   }
 
   {
-    Json::ObjectSharedPtr json_data = Json::Factory::loadFromString("{\"TableName\":\"Pets\"}");
-    EXPECT_EQ("Pets", RequestParser::parseTable("GetItem", *json_data).table_name);
+    EXPECT_EQ("Pets",
+              RequestParser::parseTable("GetItem", body({"{\"TableName\":\"Pets\"}"})).table_name);
   }
-}
 
-TEST(DynamoRequestParser, parseErrorType) {
+  // The table name may be split across slices.
   {
-    EXPECT_EQ("ResourceNotFoundException",
-              RequestParser::parseErrorType(*Json::Factory::loadFromString(
-                  "{\"__type\":\"com.amazonaws.dynamodb.v20120810#ResourceNotFoundException\"}")));
+    EXPECT_EQ("Pets",
+              RequestParser::parseTable("GetItem", body({"{\"Table", "Name\":\"P", "ets\"}"}))
+                  .table_name);
   }
 
+  // Only a top level TableName counts.
   {
-    EXPECT_EQ("ResourceNotFoundException",
-              RequestParser::parseErrorType(*Json::Factory::loadFromString(
-                  "{\"__type\":\"com.amazonaws.dynamodb.v20120810#ResourceNotFoundException\","
-                  "\"message\":\"Requested resource not found: Table: tablename not found\"}")));
+    const std::string json_string = "{\"Key\":{\"TableName\":\"Fido\"},\"TableName\":\"Pets\"}";
+    EXPECT_EQ("Pets", RequestParser::parseTable("Query", body({json_string})).table_name);
+  }
+
+  // Parsing stops once the table name is found, so the rest of the body is not validated.
+  {
+    EXPECT_EQ("Pets",
+              RequestParser::parseTable("GetItem", body({"{\"TableName\":\"Pets\",", "garbage"}))
+                  .table_name);
   }
 
   {
-    EXPECT_EQ("", RequestParser::parseErrorType(
-                      *Json::Factory::loadFromString("{\"__type\":\"UnKnownError\"}")));
+    EXPECT_THROW(RequestParser::parseTable("GetItem", body({"{\"Key\":", "garbage"})),
+                 Json::Exception);
   }
 }
 
@@ -100,9 +118,9 @@ TEST(DynamoRequestParser, parseTableNameBatchOperation) {
       }
     }
     )EOF";
-    Json::ObjectSharedPtr json_data = Json::Factory::loadFromString(json_string);
 
-    RequestParser::TableDescriptor table = RequestParser::parseTable("BatchGetItem", *json_data);
+    RequestParser::TableDescriptor table =
+        RequestParser::parseTable("BatchGetItem", body({json_string}));
     EXPECT_EQ("", table.table_name);
     EXPECT_FALSE(table.is_single_table);
   }
@@ -116,9 +134,9 @@ TEST(DynamoRequestParser, parseTableNameBatchOperation) {
       }
     }
     )EOF";
-    Json::ObjectSharedPtr json_data = Json::Factory::loadFromString(json_string);
 
-    RequestParser::TableDescriptor table = RequestParser::parseTable("BatchGetItem", *json_data);
+    RequestParser::TableDescriptor table =
+        RequestParser::parseTable("BatchGetItem", body({json_string}));
     EXPECT_EQ("table_2", table.table_name);
     EXPECT_TRUE(table.is_single_table);
   }
@@ -133,9 +151,9 @@ TEST(DynamoRequestParser, parseTableNameBatchOperation) {
       }
     }
     )EOF";
-    Json::ObjectSharedPtr json_data = Json::Factory::loadFromString(json_string);
 
-    RequestParser::TableDescriptor table = RequestParser::parseTable("BatchGetItem", *json_data);
+    RequestParser::TableDescriptor table =
+        RequestParser::parseTable("BatchGetItem", body({json_string}));
     EXPECT_EQ("", table.table_name);
     EXPECT_FALSE(table.is_single_table);
   }
@@ -149,51 +167,82 @@ TEST(DynamoRequestParser, parseTableNameBatchOperation) {
       }
     }
     )EOF";
-    Json::ObjectSharedPtr json_data = Json::Factory::loadFromString(json_string);
 
-    RequestParser::TableDescriptor table = RequestParser::parseTable("BatchWriteItem", *json_data);
+    RequestParser::TableDescriptor table =
+        RequestParser::parseTable("BatchWriteItem", body({json_string}));
     EXPECT_EQ("table_2", table.table_name);
     EXPECT_TRUE(table.is_single_table);
   }
 
+  // Keys nested inside a table's items are not table names.
+  {
+    RequestParser::TableDescriptor table = RequestParser::parseTable(
+        "BatchGetItem", body({"{\"RequestItems\":{\"table_1\":{\"table_2\":{}}}}"}));
+    EXPECT_EQ("table_1", table.table_name);
+    EXPECT_TRUE(table.is_single_table);
+  }
+
   {
-    Json::ObjectSharedPtr json_data = Json::Factory::loadFromString("{}");
     RequestParser::TableDescriptor table =
-        RequestParser::parseTable("BatchWriteItem", *Json::Factory::loadFromString("{}"));
+        RequestParser::parseTable("BatchWriteItem", body({"{}"}));
     EXPECT_EQ("", table.table_name);
     EXPECT_TRUE(table.is_single_table);
   }
 
   {
-    Json::ObjectSharedPtr json_data = Json::Factory::loadFromString("{\"RequestItems\":{}}");
-    RequestParser::TableDescriptor table = RequestParser::parseTable("BatchWriteItem", *json_data);
+    RequestParser::TableDescriptor table =
+        RequestParser::parseTable("BatchWriteItem", body({"{\"RequestItems\":{}}"}));
     EXPECT_EQ("", table.table_name);
     EXPECT_TRUE(table.is_single_table);
   }
 
   {
-    Json::ObjectSharedPtr json_data = Json::Factory::loadFromString("{}");
-    RequestParser::TableDescriptor table = RequestParser::parseTable("BatchGetItem", *json_data);
+    RequestParser::TableDescriptor table = RequestParser::parseTable("BatchGetItem", body({"{}"}));
     EXPECT_EQ("", table.table_name);
     EXPECT_TRUE(table.is_single_table);
   }
 }
-TEST(DynamoRequestParser, parseBatchUnProcessedKeys) {
+
+TEST(DynamoRequestParser, parseResponseErrorType) {
   {
-    Json::ObjectSharedPtr json_data = Json::Factory::loadFromString("{}");
-    std::vector<std::string> unprocessed_tables =
-        RequestParser::parseBatchUnProcessedKeys(*json_data);
-    EXPECT_EQ(0u, unprocessed_tables.size());
+    const std::string json_string =
+        "{\"__type\":\"com.amazonaws.dynamodb.v20120810#ResourceNotFoundException\"}";
+    EXPECT_EQ("ResourceNotFoundException",
+              RequestParser::parseResponse(body({json_string})).error_type);
+  }
+
+  {
+    const std::string type_chunk =
+        "{\"__type\":\"com.amazonaws.dynamodb.v20120810#ResourceNotFoundException\",";
+    const std::string message_chunk =
+        "\"message\":\"Requested resource not found: Table: tablename not found\"}";
+    EXPECT_EQ("ResourceNotFoundException",
+              RequestParser::parseResponse(body({type_chunk, message_chunk})).error_type);
+  }
+
+  {
+    EXPECT_EQ("", RequestParser::parseResponse(body({"{\"__type\":\"UnKnownError\"}"})).error_type);
+  }
+
+  {
+    EXPECT_EQ("", RequestParser::parseResponse(body({"{}"})).error_type);
+  }
+}
+
+TEST(DynamoRequestParser, parseResponseUnProcessedKeys) {
+  {
+    EXPECT_EQ(0u, RequestParser::parseResponse(body({"{}"})).unprocessed_tables.size());
   }
+
   {
-    std::vector<std::string> unprocessed_tables = RequestParser::parseBatchUnProcessedKeys(
-        *Json::Factory::loadFromString("{\"UnprocessedKeys\":{}}"));
-    EXPECT_EQ(0u, unprocessed_tables.size());
+    EXPECT_EQ(0u, RequestParser::parseResponse(body({"{\"UnprocessedKeys\":{}}"}))
+                      .unprocessed_tables.size());
   }
 
   {
-    std::vector<std::string> unprocessed_tables = RequestParser::parseBatchUnProcessedKeys(
-        *Json::Factory::loadFromString("{\"UnprocessedKeys\":{\"table_1\" :{}}}"));
+    std::vector<std::string> unprocessed_tables =
+        RequestParser::parseResponse(body({"{\"UnprocessedKeys\":{\"table_1\" :{}}}"}))
+            .unprocessed_tables;
     EXPECT_EQ("table_1", unprocessed_tables[0]);
     EXPECT_EQ(1u, unprocessed_tables.size());
   }
@@ -207,10 +256,9 @@ TEST(DynamoRequestParser, parseBatchUnProcessedKeys) {
       }
     }
     )EOF";
-    Json::ObjectSharedPtr json_data = Json::Factory::loadFromString(json_string);
 
     std::vector<std::string> unprocessed_tables =
-        RequestParser::parseBatchUnProcessedKeys(*json_data);
+        RequestParser::parseResponse(body({json_string})).unprocessed_tables;
     EXPECT_TRUE(find(unprocessed_tables.begin(), unprocessed_tables.end(), "table_1") !=
                 unprocessed_tables.end());
     EXPECT_TRUE(find(unprocessed_tables.begin(), unprocessed_tables.end(), "table_2") !=
@@ -219,47 +267,54 @@ TEST(DynamoRequestParser, parseBatchUnProcessedKeys) {
   }
 }
 
-TEST(DynamoRequestParser, parsePartitionIds) {
+TEST(DynamoRequestParser, parseResponsePartitionIds) {
   {
-    std::vector<RequestParser::PartitionDescriptor> partitions =
-        RequestParser::parsePartitions(*Json::Factory::loadFromString("{}"));
-    EXPECT_EQ(0u, partitions.size());
+    EXPECT_EQ(0u, RequestParser::parseResponse(body({"{}"})).partitions.size());
   }
+
   {
-    std::vector<RequestParser::PartitionDescriptor> partitions =
-        RequestParser::parsePartitions(*Json::Factory::loadFromString("{\"ConsumedCapacity\":{}}"));
-    EXPECT_EQ(0u, partitions.size());
+    EXPECT_EQ(0u,
+              RequestParser::parseResponse(body({"{\"ConsumedCapacity\":{}}"})).partitions.size());
   }
+
   {
-    std::vector<RequestParser::PartitionDescriptor> partitions = RequestParser::parsePartitions(
-        *Json::Factory::loadFromString("{\"ConsumedCapacity\":{ \"Partitions\":{}}}"));
-    EXPECT_EQ(0u, partitions.size());
+    const std::string json_string = "{\"ConsumedCapacity\":{ \"Partitions\":{}}}";
+    EXPECT_EQ(0u, RequestParser::parseResponse(body({json_string})).partitions.size());
   }
+
   {
     std::string json_string = R"EOF(
     {
       "ConsumedCapacity": {
         "Partitions": {
           "partition_1" : 0.5,
-          "partition_2" : 3.0
+          "partition_2" : 3.0,
+          "partition_3" : 2
         }
       }
     }
     )EOF";
-    Json::ObjectSharedPtr json_data = Json::Factory::loadFromString(json_string);
 
     std::vector<RequestParser::PartitionDescriptor> partitions =
-        RequestParser::parsePartitions(*json_data);
+        RequestParser::parseResponse(body({json_string})).partitions;
     for (const RequestParser::PartitionDescriptor& partition : partitions) {
       if (partition.partition_id_ == "partition_1") {
         EXPECT_EQ(1u, partition.capacity_);
-      } else {
+      } else if (partition.partition_id_ == "partition_2") {
         EXPECT_EQ(3u, partition.capacity_);
+      } else {
+        EXPECT_EQ(2u, partition.capacity_);
       }
     }
-    EXPECT_EQ(2u, partitions.size());
+    EXPECT_EQ(3u, partitions.size());
   }
 }
 
+TEST(DynamoRequestParser, parseResponseInvalid) {
+  EXPECT_THROW(RequestParser::parseResponse(body({"{\"__type\":"})), Json::Exception);
+  EXPECT_THROW(RequestParser::parseResponse(body({"{}", "garbage"})), Json::Exception);
+  EXPECT_THROW(RequestParser::parseResponse(body({})), Json::Exception);
+}
+
 } // namespace Dynamo
 } // namespace Envoy
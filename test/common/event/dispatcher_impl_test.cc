@@ -1,16 +1,24 @@
+#include <chrono>
 #include <condition_variable>
 #include <functional>
 #include <mutex>
+#include <thread>
 
 #include "common/common/thread.h"
+#include "common/common/thread_load.h"
 #include "common/event/dispatcher_impl.h"
 
 #include "test/mocks/common.h"
+#include "test/mocks/stats/mocks.h"
 
 #include "gmock/gmock.h"
 #include "gtest/gtest.h"
 
+using testing::AtLeast;
 using testing::InSequence;
+using testing::NiceMock;
+using testing::Property;
+using testing::_;
 
 namespace Envoy {
 namespace Event {
@@ -54,6 +62,120 @@ TEST(DeferredDeleteTest, DeferredDelete) {
   dispatcher.clearDeferredDeleteList();
 }
 
+// Once the budget is exhausted, the rest of the deletions wait for the timer that was enabled
+// during the first one.
+TEST(DeferredDeleteTest, CallbackBudget) {
+  InSequence s;
+  DispatcherImpl dispatcher;
+  dispatcher.setCallbackBudget(std::chrono::microseconds(1));
+  ReadyWatcher watcher1;
+  ReadyWatcher watcher2;
+  ReadyWatcher timer_watcher;
+  TimerPtr timer = dispatcher.createTimer([&]() -> void { timer_watcher.ready(); });
+  TimerPtr start = dispatcher.createTimer([&]() -> void {
+    dispatcher.deferredDelete(DeferredDeletablePtr{new TestDeferredDeletable([&]() -> void {
+      watcher1.ready();
+      timer->enableTimer(std::chrono::milliseconds(0));
+      std::this_thread::sleep_for(std::chrono::microseconds(10));
+    })});
+    dispatcher.deferredDelete(
+        DeferredDeletablePtr{new TestDeferredDeletable([&]() -> void { watcher2.ready(); })});
+  });
+  start->enableTimer(std::chrono::milliseconds(0));
+
+  EXPECT_CALL(watcher1, ready());
+  EXPECT_CALL(timer_watcher, ready());
+  EXPECT_CALL(watcher2, ready());
+  dispatcher.run(Dispatcher::RunType::Block);
+}
+
+TEST(PostTest, CallbackBudget) {
+  InSequence s;
+  DispatcherImpl dispatcher;
+  dispatcher.setCallbackBudget(std::chrono::microseconds(1));
+  ReadyWatcher watcher1;
+  ReadyWatcher watcher2;
+  ReadyWatcher timer_watcher;
+  TimerPtr timer = dispatcher.createTimer([&]() -> void { timer_watcher.ready(); });
+  TimerPtr start = dispatcher.createTimer([&]() -> void {
+    dispatcher.post([&]() -> void {
+      watcher1.ready();
+      timer->enableTimer(std::chrono::milliseconds(0));
+      std::this_thread::sleep_for(std::chrono::microseconds(10));
+    });
+    dispatcher.post([&]() -> void { watcher2.ready(); });
+  });
+  start->enableTimer(std::chrono::milliseconds(0));
+
+  EXPECT_CALL(watcher1, ready());
+  EXPECT_CALL(timer_watcher, ready());
+  EXPECT_CALL(watcher2, ready());
+  dispatcher.run(Dispatcher::RunType::Block);
+}
+
+TEST(DispatcherStatsTest, LoopAndPostHistograms) {
+  NiceMock<Stats::MockIsolatedStatsStore> store;
+  EXPECT_CALL(store, deliverHistogramToSinks(
+                         Property(&Stats::Metric::name, "test.dispatcher.loop_duration_us"), _))
+      .Times(AtLeast(1));
+  EXPECT_CALL(store, deliverHistogramToSinks(
+                         Property(&Stats::Metric::name, "test.dispatcher.poll_delay_us"), _))
+      .Times(AtLeast(1));
+  EXPECT_CALL(store, deliverHistogramToSinks(
+                         Property(&Stats::Metric::name, "test.dispatcher.post_delay_us"), _));
+
+  DispatcherImpl dispatcher;
+  dispatcher.initializeStats(store, "test.");
+  TimerPtr timer = dispatcher.createTimer(
+      [&]() -> void { dispatcher.post([&]() -> void { dispatcher.exit(); }); });
+  timer->enableTimer(std::chrono::milliseconds(1));
+  dispatcher.run(Dispatcher::RunType::Block);
+  EXPECT_EQ(1UL, store.counter("test.dispatcher.post_wakeups").value());
+}
+
+TEST(DispatcherStatsTest, CoalescedPostWakeups) {
+  NiceMock<Stats::MockIsolatedStatsStore> store;
+  DispatcherImpl dispatcher;
+  dispatcher.initializeStats(store, "test.");
+
+  // The callbacks posted before the event loop runs them all wake it once.
+  uint32_t ran = 0;
+  TimerPtr timer = dispatcher.createTimer([&]() -> void {
+    for (uint32_t i = 0; i < 3; i++) {
+      dispatcher.post([&]() -> void { ran++; });
+    }
+  });
+  timer->enableTimer(std::chrono::milliseconds(0));
+  dispatcher.run(Dispatcher::RunType::NonBlock);
+  dispatcher.run(Dispatcher::RunType::NonBlock);
+  EXPECT_EQ(3U, ran);
+  EXPECT_EQ(1UL, store.counter("test.dispatcher.post_wakeups").value());
+}
+
+TEST(DispatcherStatsTest, LoopBusyTime) {
+  NiceMock<Stats::MockIsolatedStatsStore> store;
+  DispatcherImpl dispatcher;
+  dispatcher.initializeStats(store, "test.");
+  ThreadLoad load;
+  ThreadLoad::setCurrent(&load);
+
+  TimerPtr timer = dispatcher.createTimer([&]() -> void { dispatcher.exit(); });
+  timer->enableTimer(std::chrono::milliseconds(1));
+  dispatcher.run(Dispatcher::RunType::Block);
+  ThreadLoad::setCurrent(nullptr);
+  EXPECT_TRUE(load.busyTracked());
+}
+
+TEST(PostTest, PendingPosts) {
+  DispatcherImpl dispatcher;
+  EXPECT_EQ(0UL, dispatcher.pendingPosts());
+  dispatcher.post([]() -> void {});
+  dispatcher.post([]() -> void {});
+  EXPECT_EQ(2UL, dispatcher.pendingPosts());
+  dispatcher.run(Dispatcher::RunType::NonBlock);
+  EXPECT_EQ(0UL, dispatcher.pendingPosts());
+}
+
 class DispatcherImplTest : public ::testing::Test {
 protected:
   DispatcherImplTest() : dispatcher_(std::make_unique<DispatcherImpl>()), work_finished_(false) {
@@ -0,0 +1,146 @@
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <cstdint>
+
+#include "envoy/event/file_event.h"
+
+#include "common/event/dispatcher_impl.h"
+#include "common/event/io_uring_impl.h"
+
+#include "test/mocks/common.h"
+
+#include "gtest/gtest.h"
+
+namespace Envoy {
+namespace Event {
+
+class IoUringPollerTest : public testing::Test {
+public:
+  void SetUp() override {
+    if (!IoUringPoller::isSupported()) {
+      return;
+    }
+    ASSERT_TRUE(dispatcher_.enableIoUring());
+    int rc = socketpair(AF_UNIX, SOCK_DGRAM, 0, fds_);
+    ASSERT_EQ(0, rc);
+    int data = 1;
+    rc = write(fds_[1], &data, sizeof(data));
+    ASSERT_EQ(sizeof(data), static_cast<size_t>(rc));
+  }
+
+  void TearDown() override {
+    if (fds_[0] != -1) {
+      close(fds_[0]);
+      close(fds_[1]);
+    }
+  }
+
+  FileEventPtr createFileEvent(FileTriggerType trigger, uint32_t events) {
+    return dispatcher_.createFileEvent(fds_[0],
+                                       [this](uint32_t events) -> void {
+                                         if (events & FileReadyType::Read) {
+                                           read_event_.ready();
+                                         }
+
+                                         if (events & FileReadyType::Write) {
+                                           write_event_.ready();
+                                         }
+                                       },
+                                       trigger, events);
+  }
+
+protected:
+  DispatcherImpl dispatcher_;
+  int fds_[2]{-1, -1};
+  ReadyWatcher read_event_;
+  ReadyWatcher write_event_;
+};
+
+TEST_F(IoUringPollerTest, EdgeTrigger) {
+  if (!IoUringPoller::isSupported()) {
+    return;
+  }
+  EXPECT_CALL(read_event_, ready()).Times(1);
+  EXPECT_CALL(write_event_, ready()).Times(1);
+  FileEventPtr file_event =
+      createFileEvent(FileTriggerType::Edge, FileReadyType::Read | FileReadyType::Write);
+  dispatcher_.run(Dispatcher::RunType::NonBlock);
+  dispatcher_.run(Dispatcher::RunType::NonBlock);
+
+  // Another datagram is another edge.
+  EXPECT_CALL(read_event_, ready()).Times(1);
+  int data = 2;
+  ASSERT_EQ(sizeof(data), static_cast<size_t>(write(fds_[1], &data, sizeof(data))));
+  dispatcher_.run(Dispatcher::RunType::NonBlock);
+}
+
+TEST_F(IoUringPollerTest, LevelTrigger) {
+  if (!IoUringPoller::isSupported()) {
+    return;
+  }
+  EXPECT_CALL(read_event_, ready()).Times(2);
+  EXPECT_CALL(write_event_, ready()).Times(2);
+
+  int count = 2;
+  FileEventPtr file_event = dispatcher_.createFileEvent(
+      fds_[0],
+      [&](uint32_t events) -> void {
+        if (count-- == 0) {
+          dispatcher_.exit();
+          return;
+        }
+        if (events & FileReadyType::Read) {
+          read_event_.ready();
+        }
+
+        if (events & FileReadyType::Write) {
+          write_event_.ready();
+        }
+      },
+      FileTriggerType::Level, FileReadyType::Read | FileReadyType::Write);
+
+  dispatcher_.run(Dispatcher::RunType::Block);
+}
+
+TEST_F(IoUringPollerTest, SetEnabled) {
+  if (!IoUringPoller::isSupported()) {
+    return;
+  }
+  EXPECT_CALL(read_event_, ready()).Times(2);
+  EXPECT_CALL(write_event_, ready()).Times(2);
+  FileEventPtr file_event =
+      createFileEvent(FileTriggerType::Edge, FileReadyType::Read | FileReadyType::Write);
+
+  file_event->setEnabled(FileReadyType::Read);
+  dispatcher_.run(Dispatcher::RunType::NonBlock);
+
+  file_event->setEnabled(FileReadyType::Write);
+  dispatcher_.run(Dispatcher::RunType::NonBlock);
+
+  file_event->setEnabled(0);
+  dispatcher_.run(Dispatcher::RunType::NonBlock);
+
+  file_event->setEnabled(FileReadyType::Read | FileReadyType::Write);
+  dispatcher_.run(Dispatcher::RunType::NonBlock);
+}
+
+TEST_F(IoUringPollerTest, ActivateAndDestroy) {
+  if (!IoUringPoller::isSupported()) {
+    return;
+  }
+  EXPECT_CALL(read_event_, ready()).Times(0);
+  EXPECT_CALL(write_event_, ready()).Times(1);
+  FileEventPtr file_event = createFileEvent(FileTriggerType::Edge, 0);
+  file_event->activate(FileReadyType::Write);
+  dispatcher_.run(Dispatcher::RunType::NonBlock);
+
+  // Neither the activation nor the poll of a destroyed event run.
+  file_event->setEnabled(FileReadyType::Read);
+  file_event->activate(FileReadyType::Read);
+  file_event.reset();
+  dispatcher_.run(Dispatcher::RunType::NonBlock);
+}
+
+} // namespace Event
+} // namespace Envoy
@@ -0,0 +1,131 @@
+#include <chrono>
+#include <cstdint>
+
+#include "common/event/timer_wheel_impl.h"
+
+#include "test/mocks/common.h"
+#include "test/mocks/event/mocks.h"
+
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+
+using testing::NiceMock;
+using testing::_;
+
+namespace Envoy {
+namespace Event {
+
+class TimerWheelTest : public testing::Test {
+public:
+  TimerWheelTest()
+      : tick_timer_(new NiceMock<MockTimer>(&dispatcher_)),
+        wheel_(dispatcher_, std::chrono::milliseconds(100), 4) {}
+
+  void tick(uint32_t ticks) {
+    for (uint32_t i = 0; i < ticks; i++) {
+      tick_timer_->callback_();
+    }
+  }
+
+  NiceMock<MockDispatcher> dispatcher_;
+  // Owned by the wheel.
+  MockTimer* tick_timer_;
+  TimerWheel wheel_;
+  ReadyWatcher watcher1_;
+  ReadyWatcher watcher2_;
+};
+
+// A timer fires after its timeout, rounded up to the next tick plus one.
+TEST_F(TimerWheelTest, Fire) {
+  TimerPtr timer = wheel_.createTimer([this]() -> void { watcher1_.ready(); });
+  // The wheel starts ticking, and keeps ticking while the timer is enabled.
+  EXPECT_CALL(*tick_timer_, enableTimer(std::chrono::milliseconds(100))).Times(4);
+  timer->enableTimer(std::chrono::milliseconds(250));
+
+  EXPECT_CALL(watcher1_, ready()).Times(0);
+  tick(3);
+
+  EXPECT_CALL(watcher1_, ready());
+  EXPECT_CALL(*tick_timer_, disableTimer());
+  EXPECT_CALL(*tick_timer_, enableTimer(_)).Times(0);
+  tick(1);
+}
+
+// A timer with a zero timeout fires on the next tick.
+TEST_F(TimerWheelTest, ZeroTimeout) {
+  TimerPtr timer = wheel_.createTimer([this]() -> void { watcher1_.ready(); });
+  timer->enableTimer(std::chrono::milliseconds(0));
+
+  EXPECT_CALL(watcher1_, ready());
+  tick(1);
+}
+
+// Timers with timeouts longer than a rotation of the wheel wait for their rotation.
+TEST_F(TimerWheelTest, Rotations) {
+  TimerPtr timer = wheel_.createTimer([this]() -> void { watcher1_.ready(); });
+  timer->enableTimer(std::chrono::milliseconds(1000));
+
+  EXPECT_CALL(watcher1_, ready()).Times(0);
+  tick(10);
+
+  EXPECT_CALL(watcher1_, ready());
+  tick(1);
+}
+
+// Disabling the last timer stops the ticks, and enabling a timer again resets its timeout.
+TEST_F(TimerWheelTest, Disable) {
+  TimerPtr timer = wheel_.createTimer([this]() -> void { watcher1_.ready(); });
+  timer->enableTimer(std::chrono::milliseconds(100));
+  timer->enableTimer(std::chrono::milliseconds(300));
+
+  EXPECT_CALL(watcher1_, ready()).Times(0);
+  tick(2);
+
+  EXPECT_CALL(*tick_timer_, disableTimer());
+  timer->disableTimer();
+  tick(4);
+  timer->disableTimer();
+}
+
+// Enabling an enabled timer moves it without stopping the wheel, as an idle timeout reset on every
+// read does.
+TEST_F(TimerWheelTest, Reenable) {
+  TimerPtr timer = wheel_.createTimer([this]() -> void { watcher1_.ready(); });
+  EXPECT_CALL(*tick_timer_, disableTimer()).Times(0);
+  timer->enableTimer(std::chrono::milliseconds(100));
+  tick(1);
+  timer->enableTimer(std::chrono::milliseconds(200));
+
+  EXPECT_CALL(watcher1_, ready()).Times(0);
+  tick(2);
+
+  EXPECT_CALL(watcher1_, ready());
+  EXPECT_CALL(*tick_timer_, disableTimer());
+  tick(1);
+}
+
+// Timers due in the same tick fire together, and their callbacks may change the other timers.
+TEST_F(TimerWheelTest, Batch) {
+  TimerPtr timer1;
+  TimerPtr timer2 = wheel_.createTimer([this]() -> void { watcher2_.ready(); });
+  timer1 = wheel_.createTimer([&]() -> void {
+    watcher1_.ready();
+    timer1->enableTimer(std::chrono::milliseconds(100));
+    timer2.reset();
+  });
+  timer1->enableTimer(std::chrono::milliseconds(100));
+  timer2->enableTimer(std::chrono::milliseconds(50));
+
+  // The callback of the first timer destroys the second one before it fires.
+  EXPECT_CALL(watcher1_, ready());
+  EXPECT_CALL(watcher2_, ready()).Times(0);
+  tick(2);
+
+  // The timer enabled from its own callback fires again.
+  EXPECT_CALL(watcher1_, ready());
+  tick(2);
+  timer1.reset();
+}
+
+} // namespace Event
+} // namespace Envoy
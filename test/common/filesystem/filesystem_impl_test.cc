@@ -1,5 +1,8 @@
 #include <chrono>
+#include <sstream>
 #include <string>
+#include <thread>
+#include <vector>
 
 #include "common/api/os_sys_calls_impl.h"
 #include "common/common/thread.h"
@@ -13,6 +16,7 @@
 #include "test/test_common/environment.h"
 #include "test/test_common/threadsafe_singleton_injector.h"
 
+#include "fmt/format.h"
 #include "gmock/gmock.h"
 #include "gtest/gtest.h"
 
@@ -364,4 +368,96 @@ TEST(FilesystemImpl, bigDataChunkShouldBeFlushedWithoutTimer) {
     }
   }
 }
+
+// Validate that the writes of each thread are written in the order of the thread, whether they
+// went through the buffer of the thread or spilled.
+TEST(FilesystemImpl, threadBuffersKeepWriteOrder) {
+  NiceMock<Event::MockDispatcher> dispatcher;
+  new NiceMock<Event::MockTimer>(&dispatcher);
+  Thread::MutexBasicLockable mutex;
+  Stats::IsolatedStoreImpl stats_store;
+  const std::string path = TestEnvironment::temporaryPath("envoy_thread_buffers");
+  unlink(path.c_str());
+
+  const uint32_t num_threads = 4;
+  const uint32_t num_writes = 5000;
+  {
+    Filesystem::FileImpl file(path, dispatcher, mutex, stats_store, std::chrono::milliseconds(40));
+    std::vector<std::thread> threads;
+    for (uint32_t i = 0; i < num_threads; i++) {
+      threads.emplace_back([&file, i]() -> void {
+        for (uint32_t j = 0; j < num_writes; j++) {
+          file.write(fmt::format("{} {} {}\n", i, j, std::string(100, 'a')));
+        }
+      });
+    }
+    for (std::thread& thread : threads) {
+      thread.join();
+    }
+  }
+
+  std::vector<uint32_t> next(num_threads);
+  std::istringstream lines(Filesystem::fileReadToEnd(path));
+  uint32_t thread;
+  uint32_t write;
+  std::string padding;
+  while (lines >> thread >> write >> padding) {
+    ASSERT_LT(thread, num_threads);
+    EXPECT_EQ(next[thread]++, write);
+  }
+  EXPECT_EQ(std::vector<uint32_t>(num_threads, num_writes), next);
+  EXPECT_EQ(num_threads * num_writes, stats_store.counter("filesystem.write_buffered").value());
+  EXPECT_EQ(0UL, stats_store.gauge("filesystem.write_total_buffered").value());
+}
+
+class FilesystemImplOverflowTest : public testing::Test {
+public:
+  FilesystemImplOverflowTest()
+      : path_(TestEnvironment::temporaryPath("envoy_overflow")),
+        big_write_(Filesystem::FileImpl::THREAD_BUFFER_SIZE * 2 + 1, 'a') {
+    new NiceMock<Event::MockTimer>(&dispatcher_);
+    unlink(path_.c_str());
+  }
+
+  void write(Filesystem::OverflowPolicy overflow_policy) {
+    Filesystem::FileImpl file(path_, dispatcher_, mutex_, stats_store_,
+                              std::chrono::milliseconds(40), overflow_policy);
+    file.write("small\n");
+    file.write(big_write_);
+    file.write("small\n");
+    file.flush();
+  }
+
+  uint64_t counter(const std::string& name) {
+    return stats_store_.counter("filesystem." + name).value();
+  }
+
+  NiceMock<Event::MockDispatcher> dispatcher_;
+  Thread::MutexBasicLockable mutex_;
+  Stats::IsolatedStoreImpl stats_store_;
+  const std::string path_;
+  const std::string big_write_;
+};
+
+TEST_F(FilesystemImplOverflowTest, Spill) {
+  write(Filesystem::OverflowPolicy::Spill);
+  EXPECT_EQ("small\n" + big_write_ + "small\n", Filesystem::fileReadToEnd(path_));
+  // The write that follows a spilled one spills as well unless the flush thread took the spilled
+  // one in between.
+  EXPECT_LE(1UL, counter("write_spilled"));
+}
+
+TEST_F(FilesystemImplOverflowTest, Block) {
+  write(Filesystem::OverflowPolicy::Block);
+  EXPECT_EQ("small\n" + big_write_ + "small\n", Filesystem::fileReadToEnd(path_));
+  EXPECT_EQ(1UL, counter("write_blocked"));
+}
+
+TEST_F(FilesystemImplOverflowTest, Drop) {
+  write(Filesystem::OverflowPolicy::Drop);
+  EXPECT_EQ("small\nsmall\n", Filesystem::fileReadToEnd(path_));
+  EXPECT_EQ(1UL, counter("write_dropped"));
+  EXPECT_EQ(3UL, counter("write_buffered"));
+}
+
 } // namespace Envoy
@@ -4,6 +4,7 @@
 
 #include "common/config/filter_json.h"
 #include "common/filesystem/filesystem_impl.h"
+#include "common/common/utility.h"
 #include "common/filter/auth/client_ssl.h"
 #include "common/http/message_impl.h"
 #include "common/network/address_impl.h"
@@ -17,6 +18,7 @@
 #include "test/test_common/printers.h"
 #include "test/test_common/utility.h"
 
+#include "fmt/format.h"
 #include "gmock/gmock.h"
 #include "gtest/gtest.h"
 
@@ -39,6 +41,44 @@ TEST(ClientSslAuthAllowedPrincipalsTest, EmptyString) {
   EXPECT_EQ(0UL, principals.size());
 }
 
+TEST(ClientSslAuthAllowedPrincipalsTest, Digests) {
+  const std::string digest = "1b7d42ef0025ad89c1c911d6c10d7e86a4cb7c5863b2980abcbad1895f8b5314";
+  const std::string zero_digest(64, '0');
+  AllowedPrincipals principals;
+  EXPECT_FALSE(principals.allowed(digest));
+
+  principals.add(digest);
+  principals.add(digest);
+  principals.add("not_a_digest");
+  principals.add(digest.substr(1));
+  EXPECT_EQ(1UL, principals.size());
+  EXPECT_TRUE(principals.allowed(digest));
+  EXPECT_TRUE(principals.allowed(StringUtil::toUpper(digest)));
+  EXPECT_FALSE(principals.allowed(zero_digest));
+  EXPECT_FALSE(principals.allowed("digest"));
+
+  principals.add(zero_digest);
+  EXPECT_EQ(2UL, principals.size());
+  EXPECT_TRUE(principals.allowed(zero_digest));
+}
+
+TEST(ClientSslAuthAllowedPrincipalsTest, Equality) {
+  AllowedPrincipals principals;
+  AllowedPrincipals other;
+  other.reserve(1000);
+  for (uint32_t i = 0; i < 1000; i++) {
+    principals.add(fmt::format("{:064x}", i));
+    other.add(fmt::format("{:064x}", 999 - i));
+  }
+  EXPECT_EQ(1000UL, principals.size());
+  EXPECT_TRUE(principals == other);
+  EXPECT_TRUE(principals.allowed(fmt::format("{:064x}", 500)));
+  EXPECT_FALSE(principals.allowed(fmt::format("{:064x}", 1000)));
+
+  other.add(fmt::format("{:064x}", 1000));
+  EXPECT_TRUE(principals != other);
+}
+
 TEST(ClientSslAuthConfigTest, BadClientSslAuthConfig) {
   std::string json = R"EOF(
   {
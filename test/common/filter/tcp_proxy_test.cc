@@ -21,8 +21,10 @@
 #include "gmock/gmock.h"
 #include "gtest/gtest.h"
 
+using testing::DoAll;
 using testing::MatchesRegex;
 using testing::NiceMock;
+using testing::Ref;
 using testing::Return;
 using testing::ReturnPointee;
 using testing::ReturnRef;
@@ -819,6 +821,94 @@ TEST_F(TcpProxyTest, AccessLogBytesRxTxDuration) {
                   "bytesreceived=1 bytessent=2 datetime=[0-9-]+T[0-9:.]+Z nonzeronum=[1-9][0-9]*"));
 }
 
+// Test that connections are spliced once the upstream connects when the runtime key is set, and
+// that spliced bytes are accounted as if they had been proxied through the filter.
+TEST_F(TcpProxyTest, Splice) {
+  envoy::api::v2::filter::network::TcpProxy config =
+      accessLogConfig("bytesreceived=%BYTES_RECEIVED% bytessent=%BYTES_SENT%");
+  config.mutable_idle_timeout()->set_seconds(1);
+  setup(1, config);
+
+  Event::MockTimer* idle_timer = new Event::MockTimer(&filter_callbacks_.connection_.dispatcher_);
+  EXPECT_CALL(*idle_timer, enableTimer(std::chrono::milliseconds(1000)));
+  EXPECT_CALL(factory_context_.runtime_loader_.snapshot_,
+              featureEnabled("tcp_proxy.splice_enabled", 0))
+      .WillOnce(Return(true));
+  Network::Connection::SpliceCb splice_cb;
+  EXPECT_CALL(filter_callbacks_.connection_, startSplice(Ref(*upstream_connections_.at(0)), _))
+      .WillOnce(DoAll(SaveArg<1>(&splice_cb), Return(true)));
+  raiseEventUpstreamConnected(0);
+  EXPECT_EQ(1U, config_->stats().downstream_cx_splice_total_.value());
+
+  EXPECT_CALL(*idle_timer, enableTimer(std::chrono::milliseconds(1000)));
+  splice_cb(filter_callbacks_.connection_, 3);
+  EXPECT_CALL(*idle_timer, enableTimer(std::chrono::milliseconds(1000)));
+  splice_cb(*upstream_connections_.at(0), 5);
+
+  EXPECT_CALL(*idle_timer, disableTimer());
+  upstream_connections_.at(0)->raiseEvent(Network::ConnectionEvent::RemoteClose);
+  filter_.reset();
+  EXPECT_EQ(access_log_data_, "bytesreceived=3 bytessent=5");
+}
+
+// Test that the proxy keeps forwarding through the filter when the connections can't be spliced.
+TEST_F(TcpProxyTest, SpliceUnavailable) {
+  setup(1);
+
+  EXPECT_CALL(factory_context_.runtime_loader_.snapshot_,
+              featureEnabled("tcp_proxy.splice_enabled", 0))
+      .WillOnce(Return(true));
+  EXPECT_CALL(filter_callbacks_.connection_, startSplice(_, _)).WillOnce(Return(false));
+  raiseEventUpstreamConnected(0);
+  EXPECT_EQ(0U, config_->stats().downstream_cx_splice_total_.value());
+
+  Buffer::OwnedImpl buffer("hello");
+  EXPECT_CALL(*upstream_connections_.at(0), write(BufferEqual(&buffer)));
+  filter_->onData(buffer);
+}
+
+// Test that connections are not spliced unless the runtime key is set.
+TEST_F(TcpProxyTest, SpliceDisabled) {
+  setup(1);
+
+  EXPECT_CALL(filter_callbacks_.connection_, startSplice(_, _)).Times(0);
+  raiseEventUpstreamConnected(0);
+}
+
+// Test that a preconnected upstream connection is used straight away, without connecting it or
+// waiting for a connected event.
+TEST_F(TcpProxyTest, Preconnected) {
+  configure(defaultConfig());
+  NiceMock<Network::MockClientConnection>* upstream_connection =
+      new NiceMock<Network::MockClientConnection>();
+  std::shared_ptr<NiceMock<Upstream::MockHost>> upstream_host =
+      std::make_shared<NiceMock<Upstream::MockHost>>();
+  ON_CALL(*upstream_host, cluster())
+      .WillByDefault(
+          ReturnPointee(factory_context_.cluster_manager_.thread_local_cluster_.cluster_.info_));
+  Upstream::MockHost::MockCreateConnectionData conn_info;
+  conn_info.connection_ = upstream_connection;
+  conn_info.host_description_ = upstream_host;
+  conn_info.preconnected_ = true;
+  EXPECT_CALL(factory_context_.cluster_manager_, tcpConnForCluster_("fake_cluster", _))
+      .WillOnce(Return(conn_info));
+
+  EXPECT_CALL(*upstream_connection, connect()).Times(0);
+  EXPECT_CALL(filter_callbacks_.connection_.dispatcher_, createTimer_(_)).Times(0);
+  filter_.reset(new TcpProxy(config_, factory_context_.cluster_manager_));
+  {
+    testing::InSequence sequence;
+    EXPECT_CALL(filter_callbacks_.connection_, readDisable(true));
+    EXPECT_CALL(filter_callbacks_.connection_, readDisable(false));
+  }
+  filter_->initializeReadFilterCallbacks(filter_callbacks_);
+  EXPECT_EQ(Network::FilterStatus::Continue, filter_->onNewConnection());
+
+  Buffer::OwnedImpl buffer("hello");
+  EXPECT_CALL(*upstream_connection, write(BufferEqual(&buffer)));
+  filter_->onData(buffer);
+}
+
 // Tests that upstream flush works properly with no idle timeout configured.
 TEST_F(TcpProxyTest, UpstreamFlushNoTimeout) {
   setup(1);
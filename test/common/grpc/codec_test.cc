@@ -8,6 +8,7 @@
 
 #include "test/proto/helloworld.pb.h"
 #include "test/test_common/printers.h"
+#include "test/test_common/utility.h"
 
 #include "gtest/gtest.h"
 
@@ -166,5 +167,53 @@ TEST(GrpcCodecTest, decodeMultipleFrame) {
   }
 }
 
+// Feed the frames a byte at a time, so that headers and data are split across calls.
+TEST(GrpcCodecTest, decodeSplitFrames) {
+  helloworld::HelloRequest request;
+  request.set_name("hello");
+
+  std::string input;
+  std::array<uint8_t, 5> header;
+  Encoder encoder;
+  encoder.newFrame(GRPC_FH_COMPRESSED, request.ByteSize(), header);
+  input.append(reinterpret_cast<const char*>(header.data()), 5);
+  input.append(request.SerializeAsString());
+  encoder.newFrame(GRPC_FH_DEFAULT, 0, header);
+  input.append(reinterpret_cast<const char*>(header.data()), 5);
+  encoder.newFrame(GRPC_FH_DEFAULT, request.ByteSize(), header);
+  input.append(reinterpret_cast<const char*>(header.data()), 5);
+  input.append(request.SerializeAsString());
+
+  std::vector<Frame> frames;
+  Decoder decoder;
+  for (char c : input) {
+    Buffer::OwnedImpl buffer(&c, 1);
+    EXPECT_TRUE(decoder.decode(buffer, frames));
+    EXPECT_EQ(0, buffer.length());
+  }
+
+  ASSERT_EQ(3, frames.size());
+  EXPECT_EQ(GRPC_FH_COMPRESSED, frames[0].flags_);
+  EXPECT_EQ(0, frames[1].length_);
+  EXPECT_EQ(GRPC_FH_DEFAULT, frames[2].flags_);
+  for (size_t i : {0, 2}) {
+    EXPECT_EQ(static_cast<uint32_t>(request.ByteSize()), frames[i].length_);
+    helloworld::HelloRequest result;
+    EXPECT_TRUE(result.ParseFromArray(frames[i].data_->linearize(frames[i].data_->length()),
+                                      frames[i].data_->length()));
+    EXPECT_EQ("hello", result.name());
+  }
+}
+
+TEST(GrpcCodecTest, decodeInvalidFrameAfterValidFrame) {
+  Buffer::OwnedImpl buffer("\0\0\0\0\1a\2\0\0\0\1b", 12);
+
+  std::vector<Frame> frames;
+  Decoder decoder;
+  EXPECT_FALSE(decoder.decode(buffer, frames));
+  EXPECT_EQ(1, frames.size());
+  EXPECT_EQ("\2\0\0\0\1b", TestUtility::bufferToString(buffer));
+}
+
 } // namespace Grpc
 } // namespace Envoy
@@ -210,5 +210,77 @@ TEST(CodeUtilityResponseTimingTest, All) {
   CodeUtility::chargeResponseTiming(info);
 }
 
+// The code stats of a cluster charge the same counters as CodeUtility does on the cluster scope.
+TEST(CodeStatsImplTest, SameAsCodeUtility) {
+  Stats::IsolatedStoreImpl global_store;
+  Stats::IsolatedStoreImpl utility_scope;
+  Stats::IsolatedStoreImpl code_stats_scope;
+  CodeStatsImpl code_stats(code_stats_scope);
+
+  for (uint64_t code : {200, 200, 299, 302, 404, 503, 100, 600}) {
+    for (bool canary : {false, true}) {
+      for (bool internal_request : {false, true}) {
+        CodeUtility::ResponseStatInfo info{global_store,  utility_scope,    EMPTY_STRING,
+                                           code,          internal_request, EMPTY_STRING,
+                                           EMPTY_STRING,  EMPTY_STRING,     EMPTY_STRING,
+                                           canary};
+        CodeUtility::chargeResponseStat(info);
+        code_stats.chargeResponseStat(code, canary, internal_request);
+      }
+    }
+    CodeUtility::chargeBasicResponseStat(utility_scope, "retry.", static_cast<Code>(code));
+    code_stats.chargeRetryResponseStat(code);
+  }
+
+  EXPECT_EQ(utility_scope.counters().size(), code_stats_scope.counters().size());
+  for (const Stats::CounterSharedPtr& counter : utility_scope.counters()) {
+    EXPECT_EQ(counter->value(), code_stats_scope.counter(counter->name()).value())
+        << counter->name();
+  }
+  EXPECT_EQ(8U, code_stats_scope.counter("upstream_rq_200").value());
+  EXPECT_EQ(1U, code_stats_scope.counter("retry.upstream_rq_5xx").value());
+}
+
+// The counters of the codes of Http::Code are only looked up in the scope the first time they are
+// charged, those of other codes every time.
+TEST(CodeStatsImplTest, CountersBound) {
+  Stats::MockStore scope;
+  CodeStatsImpl code_stats(scope);
+
+  EXPECT_CALL(scope, counter("upstream_rq_2xx"));
+  EXPECT_CALL(scope, counter("upstream_rq_200"));
+  EXPECT_CALL(scope, counter("external.upstream_rq_2xx"));
+  EXPECT_CALL(scope, counter("external.upstream_rq_200"));
+  EXPECT_CALL(scope, counter("upstream_rq_299")).Times(2);
+  EXPECT_CALL(scope, counter("external.upstream_rq_299")).Times(2);
+  EXPECT_CALL(scope.counter_, inc()).Times(12);
+  code_stats.chargeResponseStat(200, false, false);
+  code_stats.chargeResponseStat(200, false, false);
+  code_stats.chargeResponseStat(299, false, false);
+  code_stats.chargeResponseStat(299, false, false);
+}
+
+TEST(CodeStatsImplTest, ResponseTiming) {
+  Stats::MockStore scope;
+  CodeStatsImpl code_stats(scope);
+
+  EXPECT_CALL(scope, histogram("upstream_rq_time"));
+  EXPECT_CALL(scope, histogram("canary.upstream_rq_time"));
+  EXPECT_CALL(scope, histogram("internal.upstream_rq_time"));
+  EXPECT_CALL(scope, histogram("external.upstream_rq_time"));
+  EXPECT_CALL(scope, deliverHistogramToSinks(Property(&Stats::Metric::name, "upstream_rq_time"), 5))
+      .Times(3);
+  EXPECT_CALL(scope, deliverHistogramToSinks(
+                         Property(&Stats::Metric::name, "canary.upstream_rq_time"), 5));
+  EXPECT_CALL(scope, deliverHistogramToSinks(
+                         Property(&Stats::Metric::name, "internal.upstream_rq_time"), 5));
+  EXPECT_CALL(scope, deliverHistogramToSinks(
+                         Property(&Stats::Metric::name, "external.upstream_rq_time"), 5))
+      .Times(2);
+  code_stats.chargeResponseTiming(std::chrono::milliseconds(5), true, true);
+  code_stats.chargeResponseTiming(std::chrono::milliseconds(5), false, false);
+  code_stats.chargeResponseTiming(std::chrono::milliseconds(5), false, false);
+}
+
 } // namespace Http
 } // namespace Envoy
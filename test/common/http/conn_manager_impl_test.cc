@@ -3,6 +3,7 @@
 #include <list>
 #include <memory>
 #include <string>
+#include <vector>
 
 #include "envoy/access_log/access_log.h"
 #include "envoy/buffer/buffer.h"
@@ -29,7 +30,9 @@
 #include "test/mocks/local_info/mocks.h"
 #include "test/mocks/network/mocks.h"
 #include "test/mocks/runtime/mocks.h"
+#include "test/mocks/server/mocks.h"
 #include "test/mocks/ssl/mocks.h"
+#include "test/mocks/stats/mocks.h"
 #include "test/mocks/tracing/mocks.h"
 #include "test/mocks/upstream/mocks.h"
 #include "test/test_common/printers.h"
@@ -100,7 +103,8 @@ public:
     filter_callbacks_.connection_.remote_address_ =
         std::make_shared<Network::Address::Ipv4Instance>("0.0.0.0");
     conn_manager_.reset(new ConnectionManagerImpl(*this, drain_close_, random_, tracer_, runtime_,
-                                                  local_info_, cluster_manager_));
+                                                  local_info_, cluster_manager_,
+                                                  &overload_manager_));
     conn_manager_->initializeReadFilterCallbacks(filter_callbacks_);
 
     if (tracing) {
@@ -230,6 +234,7 @@ public:
   FilterChainFactory& filterFactory() override { return filter_factory_; }
   bool generateRequestId() override { return true; }
   const Optional<std::chrono::milliseconds>& idleTimeout() override { return idle_timeout_; }
+  uint32_t maxPipelinedRequests() override { return max_pipelined_requests_; }
   Router::RouteConfigProvider& routeConfigProvider() override { return route_config_provider_; }
   const std::string& serverName() override { return server_name_; }
   ConnectionManagerStats& stats() override { return stats_; }
@@ -243,6 +248,7 @@ public:
   const Optional<std::string>& userAgent() override { return user_agent_; }
   const TracingConnectionManagerConfig* tracingConfig() override { return tracing_config_.get(); }
   ConnectionManagerListenerStats& listenerStats() override { return listener_stats_; }
+  HeaderOnlyResponder* headerOnlyResponder() override { return header_only_responder_; }
 
   NiceMock<Tracing::MockHttpTracer> tracer_;
   NiceMock<Runtime::MockLoader> runtime_;
@@ -253,6 +259,7 @@ public:
   NiceMock<Network::MockReadFilterCallbacks> filter_callbacks_;
   MockServerConnection* codec_;
   NiceMock<MockFilterChainFactory> filter_factory_;
+  HeaderOnlyResponder* header_only_responder_{};
   ConnectionManagerStats stats_;
   ConnectionManagerTracingStats tracing_stats_;
   NiceMock<Network::MockDrainDecision> drain_close_;
@@ -264,6 +271,7 @@ public:
   std::vector<Http::ClientCertDetailsType> set_current_client_cert_details_;
   Optional<std::string> user_agent_;
   Optional<std::chrono::milliseconds> idle_timeout_;
+  uint32_t max_pipelined_requests_{};
   NiceMock<Runtime::MockRandomGenerator> random_;
   NiceMock<LocalInfo::MockLocalInfo> local_info_;
   std::unique_ptr<Ssl::MockConnection> ssl_connection_;
@@ -273,6 +281,7 @@ public:
   MockStream stream_;
   Http::StreamCallbacks* stream_callbacks_{nullptr};
   NiceMock<Upstream::MockClusterManager> cluster_manager_;
+  NiceMock<Server::MockOverloadManager> overload_manager_;
   uint32_t initial_buffer_limit_{};
   bool streaming_filter_{false};
   Stats::IsolatedStoreImpl fake_listener_stats_;
@@ -346,6 +355,212 @@ TEST_F(HttpConnectionManagerImplTest, HeaderOnlyRequestAndResponse) {
   EXPECT_EQ(1U, listener_stats_.downstream_rq_2xx_.value());
 }
 
+// Header only requests the responder answers never get a filter chain. The others get one once
+// their headers are in.
+TEST_F(HttpConnectionManagerImplTest, HeaderOnlyResponder) {
+  MockHeaderOnlyResponder responder;
+  header_only_responder_ = &responder;
+  setup(false, "envoy-custom-server", false);
+
+  EXPECT_CALL(responder, respond(_, _, _))
+      .Times(2)
+      .WillRepeatedly(Invoke([](const HeaderMap& request_headers, HeaderMap& response_headers,
+                                RequestInfo::RequestInfo& request_info) -> bool {
+        if (request_headers.Path()->value() != "/healthcheck") {
+          return false;
+        }
+        request_info.healthCheck(true);
+        response_headers.insertStatus().value(std::string("200"));
+        return true;
+      }));
+
+  std::shared_ptr<MockStreamDecoderFilter> filter(new NiceMock<MockStreamDecoderFilter>());
+  EXPECT_CALL(filter_factory_, createFilterChain(_))
+      .Times(2)
+      .WillRepeatedly(Invoke([&](FilterChainFactoryCallbacks& callbacks) -> void {
+        callbacks.addStreamDecoderFilter(filter);
+      }));
+  EXPECT_CALL(*filter, decodeHeaders(_, false)).WillOnce(Return(FilterHeadersStatus::Continue));
+  EXPECT_CALL(*filter, decodeData(_, true))
+      .WillOnce(Return(FilterDataStatus::StopIterationNoBuffer));
+  EXPECT_CALL(*filter, decodeHeaders(_, true)).WillOnce(Return(FilterHeadersStatus::StopIteration));
+
+  EXPECT_CALL(filter_callbacks_.connection_.dispatcher_, deferredDelete_(_));
+
+  StreamDecoder* decoder = nullptr;
+  NiceMock<MockStreamEncoder> encoder;
+  EXPECT_CALL(*codec_, dispatch(_)).WillOnce(Invoke([&](Buffer::Instance& data) -> void {
+    decoder = &conn_manager_->newStream(encoder);
+    HeaderMapPtr headers{new TestHeaderMapImpl{{":authority", "host"}, {":path", "/healthcheck"}}};
+    decoder->decodeHeaders(std::move(headers), true);
+
+    // A request with a body is not offered to the responder.
+    decoder = &conn_manager_->newStream(encoder);
+    headers.reset(new TestHeaderMapImpl{{":authority", "host"}, {":path", "/healthcheck"}});
+    decoder->decodeHeaders(std::move(headers), false);
+    Buffer::OwnedImpl body("hello");
+    decoder->decodeData(body, true);
+
+    // Nor is one the responder turns down.
+    decoder = &conn_manager_->newStream(encoder);
+    headers.reset(new TestHeaderMapImpl{{":authority", "host"}, {":path", "/"}});
+    decoder->decodeHeaders(std::move(headers), true);
+    data.drain(4);
+  }));
+
+  Buffer::OwnedImpl fake_input("1234");
+  conn_manager_->onData(fake_input);
+
+  EXPECT_EQ(1U, stats_.named_.downstream_rq_header_only_response_.value());
+  EXPECT_EQ(1U, stats_.named_.downstream_rq_2xx_.value());
+  EXPECT_EQ(1U, tracing_stats_.health_check_.value());
+}
+
+// With pipelining enabled, a complete request is followed by dispatching the next one before it
+// has been responded to, up to the configured depth. Past that, reads are disabled.
+TEST_F(HttpConnectionManagerImplTest, PipelinedRequests) {
+  max_pipelined_requests_ = 1;
+  setup(false, "");
+
+  std::shared_ptr<MockStreamDecoderFilter> filter(new NiceMock<MockStreamDecoderFilter>());
+  std::vector<StreamDecoderFilterCallbacks*> decoder_callbacks;
+  EXPECT_CALL(*filter, decodeHeaders(_, true))
+      .Times(2)
+      .WillRepeatedly(InvokeWithoutArgs([&]() -> FilterHeadersStatus {
+        decoder_callbacks.push_back(filter->callbacks_);
+        return FilterHeadersStatus::StopIteration;
+      }));
+
+  EXPECT_CALL(*filter, setDecoderFilterCallbacks(_)).Times(2);
+
+  EXPECT_CALL(filter_factory_, createFilterChain(_))
+      .Times(2)
+      .WillRepeatedly(Invoke([&](FilterChainFactoryCallbacks& callbacks) -> void {
+        callbacks.addStreamDecoderFilter(filter);
+      }));
+
+  NiceMock<MockStreamEncoder> encoders[2];
+  size_t num_streams = 0;
+  EXPECT_CALL(*codec_, dispatch(_))
+      .Times(2)
+      .WillRepeatedly(Invoke([&](Buffer::Instance& data) -> void {
+        StreamDecoder* decoder = &conn_manager_->newStream(encoders[num_streams++]);
+        HeaderMapPtr headers{new TestHeaderMapImpl{{":authority", "host"}, {":path", "/"}}};
+        decoder->decodeHeaders(std::move(headers), true);
+        data.drain(1);
+      }));
+
+  // The second request is dispatched right away, but the third has to wait for a response.
+  EXPECT_CALL(filter_callbacks_.connection_, readDisable(true));
+  Buffer::OwnedImpl fake_input("1234");
+  conn_manager_->onData(fake_input);
+  ASSERT_EQ(2U, decoder_callbacks.size());
+
+  // Responding to the first request lets the third one in.
+  EXPECT_CALL(filter_callbacks_.connection_, readDisable(false));
+  EXPECT_CALL(filter_callbacks_.connection_.dispatcher_, deferredDelete_(_)).Times(2);
+  for (StreamDecoderFilterCallbacks* stream_callbacks : decoder_callbacks) {
+    HeaderMapPtr response_headers{new TestHeaderMapImpl{{":status", "200"}}};
+    stream_callbacks->encodeHeaders(std::move(response_headers), true);
+  }
+
+  EXPECT_EQ(2U, stats_.named_.downstream_rq_2xx_.value());
+}
+
+// Ending a pipelined stream only undoes the read-disable waiting for a response, not those that
+// the streams still active took for flow control.
+TEST_F(HttpConnectionManagerImplTest, PipelinedRequestsKeepFlowControl) {
+  max_pipelined_requests_ = 1;
+  setup(false, "");
+
+  int read_disabled_count = 0;
+  EXPECT_CALL(filter_callbacks_.connection_, readDisable(_))
+      .WillRepeatedly(Invoke([&](bool disable) -> void {
+        read_disabled_count += disable ? 1 : -1;
+        ASSERT_GE(read_disabled_count, 0);
+        filter_callbacks_.connection_.read_enabled_ = read_disabled_count == 0;
+      }));
+
+  std::shared_ptr<MockStreamDecoderFilter> filter(new NiceMock<MockStreamDecoderFilter>());
+  std::vector<StreamDecoderFilterCallbacks*> decoder_callbacks;
+  EXPECT_CALL(*filter, decodeHeaders(_, true))
+      .Times(2)
+      .WillRepeatedly(InvokeWithoutArgs([&]() -> FilterHeadersStatus {
+        decoder_callbacks.push_back(filter->callbacks_);
+        return FilterHeadersStatus::StopIteration;
+      }));
+
+  EXPECT_CALL(*filter, setDecoderFilterCallbacks(_)).Times(2);
+
+  EXPECT_CALL(filter_factory_, createFilterChain(_))
+      .Times(2)
+      .WillRepeatedly(Invoke([&](FilterChainFactoryCallbacks& callbacks) -> void {
+        callbacks.addStreamDecoderFilter(filter);
+      }));
+
+  NiceMock<MockStreamEncoder> encoders[2];
+  // Like the HTTP/1 codec, read-disabling a stream read-disables the connection.
+  for (NiceMock<MockStreamEncoder>& encoder : encoders) {
+    ON_CALL(encoder.stream_, readDisable(_)).WillByDefault(Invoke([&](bool disable) -> void {
+      filter_callbacks_.connection_.readDisable(disable);
+    }));
+  }
+  size_t num_streams = 0;
+  EXPECT_CALL(*codec_, dispatch(_))
+      .Times(2)
+      .WillRepeatedly(Invoke([&](Buffer::Instance& data) -> void {
+        StreamDecoder* decoder = &conn_manager_->newStream(encoders[num_streams++]);
+        HeaderMapPtr headers{new TestHeaderMapImpl{{":authority", "host"}, {":path", "/"}}};
+        decoder->decodeHeaders(std::move(headers), true);
+        data.drain(1);
+      }));
+
+  Buffer::OwnedImpl fake_input("1234");
+  conn_manager_->onData(fake_input);
+  ASSERT_EQ(2U, decoder_callbacks.size());
+  EXPECT_EQ(1, read_disabled_count);
+
+  // The second stream goes above its watermark before the first one completes.
+  decoder_callbacks[1]->onDecoderFilterAboveWriteBufferHighWatermark();
+  EXPECT_EQ(2, read_disabled_count);
+
+  EXPECT_CALL(filter_callbacks_.connection_.dispatcher_, deferredDelete_(_)).Times(2);
+  HeaderMapPtr response_headers{new TestHeaderMapImpl{{":status", "200"}}};
+  decoder_callbacks[0]->encodeHeaders(std::move(response_headers), true);
+  EXPECT_EQ(1, read_disabled_count);
+  EXPECT_FALSE(filter_callbacks_.connection_.read_enabled_);
+
+  // Once no stream is left, reading is fully enabled again.
+  response_headers.reset(new TestHeaderMapImpl{{":status", "200"}});
+  decoder_callbacks[1]->encodeHeaders(std::move(response_headers), true);
+  EXPECT_EQ(0, read_disabled_count);
+  EXPECT_TRUE(filter_callbacks_.connection_.read_enabled_);
+}
+
+TEST_F(HttpConnectionManagerImplTest, RejectRequestWhenOverloaded) {
+  InSequence s;
+  setup(false, "");
+
+  ON_CALL(overload_manager_, isActive(Server::OverloadAction::StopAcceptingRequests))
+      .WillByDefault(Return(true));
+
+  EXPECT_CALL(*codec_, dispatch(_)).WillOnce(Invoke([&](Buffer::Instance& data) -> void {
+    StreamDecoder* decoder = &conn_manager_->newStream(response_encoder_);
+    HeaderMapPtr headers{new TestHeaderMapImpl{{":authority", "host"}, {":path", "/"}}};
+    decoder->decodeHeaders(std::move(headers), true);
+    data.drain(4);
+  }));
+
+  EXPECT_CALL(response_encoder_, encodeHeaders(_, true))
+      .WillOnce(Invoke([](const HeaderMap& headers, bool) -> void {
+        EXPECT_STREQ("503", headers.Status()->value().c_str());
+      }));
+
+  Buffer::OwnedImpl fake_input("1234");
+  conn_manager_->onData(fake_input);
+  EXPECT_EQ(1U, stats_.named_.downstream_rq_overload_reject_.value());
+}
+
 TEST_F(HttpConnectionManagerImplTest, InvalidPathWithDualFilter) {
   InSequence s;
   setup(false, "");
@@ -714,6 +929,10 @@ TEST_F(HttpConnectionManagerImplTest, TestAccessLog) {
             EXPECT_EQ(request_info.responseCode().value(), uint32_t(200));
             EXPECT_NE(nullptr, request_info.downstreamLocalAddress());
             EXPECT_NE(nullptr, request_info.downstreamRemoteAddress());
+            EXPECT_TRUE(request_info.requestReceivedDuration().valid());
+            EXPECT_TRUE(request_info.downstreamFirstByteSentDuration().valid());
+            EXPECT_TRUE(request_info.downstreamLastByteSentDuration().valid());
+            EXPECT_FALSE(request_info.upstreamConnectStartDuration().valid());
           }));
 
   StreamDecoder* decoder = nullptr;
@@ -738,6 +957,45 @@ TEST_F(HttpConnectionManagerImplTest, TestAccessLog) {
   conn_manager_->onData(fake_input);
 }
 
+TEST_F(HttpConnectionManagerImplTest, SkipAccessLogRuledOutByRequestHeaders) {
+  std::shared_ptr<AccessLog::MockInstance> skipped(new NiceMock<AccessLog::MockInstance>());
+  std::shared_ptr<AccessLog::MockInstance> logged(new NiceMock<AccessLog::MockInstance>());
+  access_logs_ = {skipped, logged};
+  setup(false, "");
+
+  std::shared_ptr<MockStreamDecoderFilter> filter(new NiceMock<MockStreamDecoderFilter>());
+  EXPECT_CALL(filter_factory_, createFilterChain(_))
+      .WillOnce(Invoke([&](FilterChainFactoryCallbacks& callbacks) -> void {
+        callbacks.addStreamDecoderFilter(filter);
+      }));
+
+  EXPECT_CALL(*skipped, mayLog(_)).WillOnce(Invoke([](const HeaderMap& headers) -> bool {
+    EXPECT_NE(nullptr, headers.RequestId());
+    return false;
+  }));
+  EXPECT_CALL(*skipped, log(_, _, _)).Times(0);
+  EXPECT_CALL(*logged, mayLog(_)).WillOnce(Return(true));
+  EXPECT_CALL(*logged, log(_, _, _));
+
+  StreamDecoder* decoder = nullptr;
+  NiceMock<MockStreamEncoder> encoder;
+  EXPECT_CALL(*codec_, dispatch(_)).WillRepeatedly(Invoke([&](Buffer::Instance& data) -> void {
+    decoder = &conn_manager_->newStream(encoder);
+
+    HeaderMapPtr headers{
+        new TestHeaderMapImpl{{":method", "GET"}, {":authority", "host"}, {":path", "/"}}};
+    decoder->decodeHeaders(std::move(headers), true);
+
+    HeaderMapPtr response_headers{new TestHeaderMapImpl{{":status", "200"}}};
+    filter->callbacks_->encodeHeaders(std::move(response_headers), true);
+
+    data.drain(4);
+  }));
+
+  Buffer::OwnedImpl fake_input("1234");
+  conn_manager_->onData(fake_input);
+}
+
 TEST_F(HttpConnectionManagerImplTest, DoNotStartSpanIfTracingIsNotEnabled) {
   setup(false, "");
 
@@ -835,6 +1093,53 @@ TEST_F(HttpConnectionManagerImplTest, StartSpanOnlyHealthCheckRequest) {
   EXPECT_EQ(0UL, tracing_stats_.service_forced_.value());
 }
 
+TEST_F(HttpConnectionManagerImplTest, DoNotLimitSamplingOfDownstreamTraces) {
+  setup(false, "");
+
+  EXPECT_CALL(tracer_, startSpan_(_, _, _)).Times(2).WillRepeatedly(InvokeWithoutArgs([]() {
+    return new NiceMock<Tracing::MockSpan>();
+  }));
+  ON_CALL(runtime_.snapshot_, featureEnabled("tracing.global_enabled", 100, _))
+      .WillByDefault(Return(true));
+  ON_CALL(runtime_.snapshot_, getInteger("tracing.max_sampled_per_second", 0))
+      .WillByDefault(Return(1));
+
+  std::shared_ptr<MockStreamDecoderFilter> filter(new NiceMock<MockStreamDecoderFilter>());
+
+  EXPECT_CALL(filter_factory_, createFilterChain(_))
+      .WillRepeatedly(Invoke([&](FilterChainFactoryCallbacks& callbacks) -> void {
+        callbacks.addStreamDecoderFilter(filter);
+      }));
+
+  // Treat requests as internal, otherwise x-request-id header will be overwritten.
+  use_remote_address_ = false;
+
+  NiceMock<MockStreamEncoder> encoder;
+  EXPECT_CALL(*codec_, dispatch(_)).WillRepeatedly(Invoke([&](Buffer::Instance& data) -> void {
+    // Both requests arrive sampled, which is more than the limit allows.
+    for (int i = 0; i < 2; i++) {
+      StreamDecoder& decoder = conn_manager_->newStream(encoder);
+      HeaderMapPtr headers{
+          new TestHeaderMapImpl{{":method", "GET"},
+                                {":authority", "host"},
+                                {":path", "/"},
+                                {"x-request-id", "125a4afb-6f55-94ba-ad80-413f09f48a28"}}};
+      decoder.decodeHeaders(std::move(headers), true);
+
+      HeaderMapPtr response_headers{new TestHeaderMapImpl{{":status", "200"}}};
+      filter->callbacks_->encodeHeaders(std::move(response_headers), true);
+    }
+
+    data.drain(4);
+  }));
+
+  Buffer::OwnedImpl fake_input("1234");
+  conn_manager_->onData(fake_input);
+
+  EXPECT_EQ(2UL, tracing_stats_.random_sampling_.value());
+  EXPECT_EQ(0UL, tracing_stats_.rate_limited_.value());
+}
+
 TEST_F(HttpConnectionManagerImplTest, NoPath) {
   setup(false, "");
 
@@ -1658,6 +1963,83 @@ TEST_F(HttpConnectionManagerImplTest, FilterClearRouteCache) {
   conn_manager_->onData(fake_input);
 }
 
+TEST_F(HttpConnectionManagerImplTest, FilterArena) {
+  setup(false, "");
+
+  EXPECT_CALL(*codec_, dispatch(_)).WillOnce(Invoke([&](Buffer::Instance&) -> void {
+    StreamDecoder* decoder = &conn_manager_->newStream(response_encoder_);
+    HeaderMapPtr headers{new TestHeaderMapImpl{{":authority", "host"}, {":path", "/"}}};
+    decoder->decodeHeaders(std::move(headers), true);
+  }));
+
+  setupFilterChain(2, 0);
+
+  // Objects the filters allocate from the stream's arena live until the stream is destroyed.
+  std::shared_ptr<bool> alive = std::make_shared<bool>(true);
+  std::weak_ptr<bool> watcher = alive;
+  EXPECT_CALL(*decoder_filters_[0], decodeHeaders(_, true))
+      .WillOnce(InvokeWithoutArgs([&]() -> FilterHeadersStatus {
+        decoder_filters_[0]->callbacks_->arena().create<std::shared_ptr<bool>>(std::move(alive));
+        return FilterHeadersStatus::Continue;
+      }));
+  EXPECT_CALL(*decoder_filters_[1], decodeHeaders(_, true))
+      .WillOnce(InvokeWithoutArgs([&]() -> FilterHeadersStatus {
+        EXPECT_EQ(&decoder_filters_[0]->callbacks_->arena(),
+                  &decoder_filters_[1]->callbacks_->arena());
+        return FilterHeadersStatus::StopIteration;
+      }));
+
+  // Kick off the incoming data.
+  Buffer::OwnedImpl fake_input("1234");
+  conn_manager_->onData(fake_input);
+  EXPECT_FALSE(watcher.expired());
+
+  expectOnDestroy();
+  conn_manager_->onEvent(Network::ConnectionEvent::RemoteClose);
+  EXPECT_FALSE(watcher.expired());
+  filter_callbacks_.connection_.dispatcher_.clearDeferredDeleteList();
+  EXPECT_TRUE(watcher.expired());
+}
+
+TEST_F(HttpConnectionManagerImplTest, FilterConstructedInArena) {
+  setup(false, "");
+
+  EXPECT_CALL(*codec_, dispatch(_)).WillOnce(Invoke([&](Buffer::Instance&) -> void {
+    StreamDecoder* decoder = &conn_manager_->newStream(response_encoder_);
+    HeaderMapPtr headers{new TestHeaderMapImpl{{":authority", "host"}, {":path", "/"}}};
+    decoder->decodeHeaders(std::move(headers), true);
+  }));
+
+  // The filter is constructed in the same arena the stream hands out to its filters, and is
+  // destroyed with the stream.
+  std::weak_ptr<MockStreamDecoderFilter> watcher;
+  EXPECT_CALL(filter_factory_, createFilterChain(_))
+      .WillOnce(Invoke([&](FilterChainFactoryCallbacks& callbacks) -> void {
+        std::shared_ptr<MockStreamDecoderFilter> filter =
+            callbacks.arena().makeShared<MockStreamDecoderFilter>();
+        watcher = filter;
+        EXPECT_CALL(*filter, setDecoderFilterCallbacks(_))
+            .WillOnce(Invoke([&callbacks](StreamDecoderFilterCallbacks& filter_callbacks) -> void {
+              EXPECT_EQ(&callbacks.arena(), &filter_callbacks.arena());
+            }));
+        EXPECT_CALL(*filter, decodeHeaders(_, true))
+            .WillOnce(Return(FilterHeadersStatus::StopIteration));
+        EXPECT_CALL(*filter, onDestroy());
+        callbacks.addStreamDecoderFilter(filter);
+      }));
+
+  // Kick off the incoming data.
+  Buffer::OwnedImpl fake_input("1234");
+  conn_manager_->onData(fake_input);
+  EXPECT_FALSE(watcher.expired());
+
+  EXPECT_CALL(filter_callbacks_.connection_.dispatcher_, deferredDelete_(_));
+  conn_manager_->onEvent(Network::ConnectionEvent::RemoteClose);
+  EXPECT_FALSE(watcher.expired());
+  filter_callbacks_.connection_.dispatcher_.clearDeferredDeleteList();
+  EXPECT_TRUE(watcher.expired());
+}
+
 TEST_F(HttpConnectionManagerImplTest, UpstreamWatermarkCallbacks) {
   setup(false, "");
   setUpEncoderAndDecoder();
@@ -2011,6 +2393,55 @@ TEST_F(HttpConnectionManagerImplTest, FilterAddBodyContinuation) {
   encoder_filters_[0]->callbacks_->continueEncoding();
 }
 
+TEST_F(HttpConnectionManagerImplTest, FilterLatencyStats) {
+  setup(false, "");
+
+  NiceMock<Stats::MockHistogram> callback_time;
+  NiceMock<Stats::MockHistogram> decode_stopped_time;
+  NiceMock<Stats::MockHistogram> encode_stopped_time;
+  FilterLatencyStats latency_stats{callback_time,       callback_time, callback_time,
+                                   decode_stopped_time, callback_time, callback_time,
+                                   callback_time,       encode_stopped_time};
+
+  decoder_filters_.push_back(new MockStreamDecoderFilter());
+  decoder_filters_.push_back(new MockStreamDecoderFilter());
+  EXPECT_CALL(filter_factory_, createFilterChain(_))
+      .WillOnce(Invoke([&](FilterChainFactoryCallbacks& callbacks) -> void {
+        callbacks.setFilterLatencyStats(&latency_stats);
+        callbacks.addStreamDecoderFilter(StreamDecoderFilterSharedPtr{decoder_filters_[0]});
+        callbacks.setFilterLatencyStats(nullptr);
+        callbacks.addStreamDecoderFilter(StreamDecoderFilterSharedPtr{decoder_filters_[1]});
+      }));
+  EXPECT_CALL(*decoder_filters_[0], setDecoderFilterCallbacks(_));
+  EXPECT_CALL(*decoder_filters_[1], setDecoderFilterCallbacks(_));
+
+  EXPECT_CALL(*codec_, dispatch(_)).WillOnce(Invoke([&](Buffer::Instance&) -> void {
+    StreamDecoder* decoder = &conn_manager_->newStream(response_encoder_);
+    HeaderMapPtr headers{new TestHeaderMapImpl{{":authority", "host"}, {":path", "/"}}};
+    decoder->decodeHeaders(std::move(headers), true);
+  }));
+
+  // Only the callbacks of the first filter are timed.
+  EXPECT_CALL(*decoder_filters_[0], decodeHeaders(_, true))
+      .WillOnce(Return(FilterHeadersStatus::StopIteration));
+  EXPECT_CALL(callback_time, recordValue(_));
+  EXPECT_CALL(decode_stopped_time, recordValue(_)).Times(0);
+
+  Buffer::OwnedImpl fake_input("1234");
+  conn_manager_->onData(fake_input);
+
+  // The time the first filter was stopped for is charged when it continues.
+  EXPECT_CALL(decode_stopped_time, recordValue(_));
+  EXPECT_CALL(*decoder_filters_[1], decodeHeaders(_, true))
+      .WillOnce(Return(FilterHeadersStatus::StopIteration));
+  decoder_filters_[0]->callbacks_->continueDecoding();
+
+  EXPECT_CALL(response_encoder_, encodeHeaders(_, true));
+  expectOnDestroy();
+  decoder_filters_[1]->callbacks_->encodeHeaders(
+      HeaderMapPtr{new TestHeaderMapImpl{{":status", "200"}}}, true);
+}
+
 TEST_F(HttpConnectionManagerImplTest, MultipleFilters) {
   InSequence s;
   setup(false, "");
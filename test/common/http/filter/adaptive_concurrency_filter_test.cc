@@ -0,0 +1,295 @@
+#include <chrono>
+#include <memory>
+#include <string>
+
+#include "common/buffer/buffer_impl.h"
+#include "common/http/filter/adaptive_concurrency_filter.h"
+#include "common/http/header_map_impl.h"
+#include "common/json/json_loader.h"
+#include "common/stats/stats_impl.h"
+
+#include "test/mocks/common.h"
+#include "test/mocks/http/mocks.h"
+#include "test/mocks/router/mocks.h"
+#include "test/mocks/runtime/mocks.h"
+#include "test/mocks/thread_local/mocks.h"
+#include "test/test_common/utility.h"
+
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+
+using testing::Invoke;
+using testing::NiceMock;
+using testing::Return;
+using testing::_;
+
+namespace Envoy {
+namespace Http {
+
+class ConcurrencyLimitTest : public testing::Test {
+public:
+  ConcurrencyLimitTest() {
+    settings_.initial_limit_ = 20;
+    settings_.min_limit_ = 5;
+    settings_.max_limit_ = 100;
+    settings_.window_ = std::chrono::milliseconds(100);
+    settings_.min_window_samples_ = 10;
+    settings_.smoothing_ = 1;
+    settings_.tolerance_ = 1.5;
+  }
+
+  void setUpLimit() {
+    limit_.reset(new ConcurrencyLimit(settings_,
+                                      AdaptiveConcurrencyStats{ALL_ADAPTIVE_CONCURRENCY_STATS(
+                                          POOL_COUNTER_PREFIX(stats_, "test."),
+                                          POOL_GAUGE_PREFIX(stats_, "test."))},
+                                      now_));
+  }
+
+  void acquire(uint32_t requests) {
+    for (uint32_t i = 0; i < requests; i++) {
+      EXPECT_TRUE(limit_->tryAcquire());
+    }
+  }
+
+  // Ends the current window, completing the given requests with a latency.
+  void completeWindow(uint32_t requests, std::chrono::milliseconds latency) {
+    now_ += settings_.window_;
+    const std::chrono::microseconds sample = latency;
+    for (uint32_t i = 0; i < requests; i++) {
+      limit_->release(&sample, now_);
+    }
+  }
+
+  ConcurrencyLimitSettings settings_;
+  Stats::IsolatedStoreImpl stats_;
+  MonotonicTime now_;
+  std::unique_ptr<ConcurrencyLimit> limit_;
+};
+
+TEST_F(ConcurrencyLimitTest, Admission) {
+  setUpLimit();
+  acquire(20);
+  EXPECT_FALSE(limit_->tryAcquire());
+  EXPECT_EQ(1U, stats_.counter("test.rq_rejected").value());
+  EXPECT_EQ(20U, limit_->inFlight());
+
+  limit_->release(nullptr, now_);
+  EXPECT_TRUE(limit_->tryAcquire());
+  EXPECT_EQ(20U, stats_.gauge("test.concurrency_limit").value());
+}
+
+TEST_F(ConcurrencyLimitTest, GrowAndShrink) {
+  setUpLimit();
+
+  // With a steady latency the limit grows by its square root.
+  acquire(20);
+  completeWindow(10, std::chrono::milliseconds(10));
+  EXPECT_EQ(24U, limit_->limit());
+  EXPECT_EQ(24U, stats_.gauge("test.concurrency_limit").value());
+  EXPECT_EQ(10000U, stats_.gauge("test.sample_rtt_us").value());
+  EXPECT_EQ(10000U, stats_.gauge("test.long_rtt_us").value());
+  for (uint32_t i = 0; i < 10; i++) {
+    limit_->release(nullptr, now_);
+  }
+
+  // A latency beyond the tolerance halves the limit, plus its square root.
+  acquire(24);
+  completeWindow(10, std::chrono::milliseconds(40));
+  EXPECT_EQ(17U, limit_->limit());
+  EXPECT_EQ(10050U, stats_.gauge("test.long_rtt_us").value());
+  EXPECT_EQ(14U, limit_->inFlight());
+  acquire(3);
+  EXPECT_FALSE(limit_->tryAcquire());
+}
+
+TEST_F(ConcurrencyLimitTest, MinLimit) {
+  setUpLimit();
+  acquire(20);
+  completeWindow(20, std::chrono::milliseconds(10));
+  for (uint32_t i = 0; i < 50; i++) {
+    const uint32_t limit = limit_->limit();
+    acquire(limit);
+    completeWindow(limit, std::chrono::milliseconds(1000));
+  }
+  EXPECT_EQ(5U, limit_->limit());
+  EXPECT_EQ(0U, limit_->inFlight());
+}
+
+TEST_F(ConcurrencyLimitTest, WaitForWindowSamples) {
+  setUpLimit();
+  acquire(20);
+  completeWindow(9, std::chrono::milliseconds(10));
+  EXPECT_EQ(20U, limit_->limit());
+  EXPECT_EQ(0U, stats_.gauge("test.sample_rtt_us").value());
+
+  // Requests that did not complete are not samples.
+  limit_->release(nullptr, now_);
+  EXPECT_EQ(20U, limit_->limit());
+
+  const std::chrono::microseconds sample = std::chrono::milliseconds(10);
+  limit_->release(&sample, now_);
+  EXPECT_EQ(24U, limit_->limit());
+}
+
+TEST_F(ConcurrencyLimitTest, NoGrowthWhenUnused) {
+  settings_.min_window_samples_ = 1;
+  setUpLimit();
+  acquire(9);
+  completeWindow(9, std::chrono::milliseconds(10));
+  EXPECT_EQ(20U, limit_->limit());
+  EXPECT_EQ(10000U, stats_.gauge("test.sample_rtt_us").value());
+}
+
+class AdaptiveConcurrencyFilterTest : public testing::Test {
+public:
+  AdaptiveConcurrencyFilterTest() {
+    ON_CALL(runtime_.snapshot_, featureEnabled("adaptive_concurrency.enabled", 100))
+        .WillByDefault(Return(true));
+    ON_CALL(time_source_, currentTime()).WillByDefault(Invoke([this]() { return now_; }));
+    setUpFilter(R"EOF({"initial_limit" : 2, "min_limit" : 1})EOF");
+  }
+
+  void setUpFilter(const std::string& json) {
+    Json::ObjectSharedPtr config = Json::Factory::loadFromString(json);
+    config_.reset(new AdaptiveConcurrencyFilterConfig(*config, "test.", stats_, runtime_, tls_,
+                                                      time_source_));
+  }
+
+  // A stream through a new filter, with its own callbacks.
+  struct Stream {
+    Stream(AdaptiveConcurrencyFilterConfigSharedPtr config) : filter_(config) {
+      filter_.setDecoderFilterCallbacks(decoder_callbacks_);
+      filter_.setEncoderFilterCallbacks(encoder_callbacks_);
+    }
+    ~Stream() { filter_.onDestroy(); }
+
+    NiceMock<MockStreamDecoderFilterCallbacks> decoder_callbacks_;
+    NiceMock<MockStreamEncoderFilterCallbacks> encoder_callbacks_;
+    AdaptiveConcurrencyFilter filter_;
+  };
+
+  std::unique_ptr<Stream> request(FilterHeadersStatus expected_status) {
+    std::unique_ptr<Stream> stream(new Stream(config_));
+    EXPECT_EQ(expected_status, stream->filter_.decodeHeaders(request_headers_, false));
+    return stream;
+  }
+
+  uint32_t inFlight() { return config_->limit("fake_cluster").inFlight(); }
+
+  NiceMock<Runtime::MockLoader> runtime_;
+  NiceMock<ThreadLocal::MockInstance> tls_;
+  NiceMock<MockMonotonicTimeSource> time_source_;
+  Stats::IsolatedStoreImpl stats_;
+  MonotonicTime now_;
+  AdaptiveConcurrencyFilterConfigSharedPtr config_;
+  TestHeaderMapImpl request_headers_{{":method", "GET"}, {":path", "/"}, {":authority", "host"}};
+};
+
+TEST_F(AdaptiveConcurrencyFilterTest, RejectOverLimit) {
+  std::unique_ptr<Stream> stream1 = request(FilterHeadersStatus::Continue);
+  std::unique_ptr<Stream> stream2 = request(FilterHeadersStatus::Continue);
+  EXPECT_EQ(2U, inFlight());
+
+  std::unique_ptr<Stream> stream3(new Stream(config_));
+  EXPECT_CALL(stream3->decoder_callbacks_.request_info_,
+              setResponseFlag(RequestInfo::ResponseFlag::UpstreamOverflow));
+  EXPECT_CALL(stream3->decoder_callbacks_, encodeHeaders_(_, false))
+      .WillOnce(Invoke([](HeaderMap& headers, bool) -> void {
+        EXPECT_STREQ("503", headers.Status()->value().c_str());
+        EXPECT_STREQ("true", headers.EnvoyOverloaded()->value().c_str());
+      }));
+  EXPECT_CALL(stream3->decoder_callbacks_, encodeData(_, true));
+  EXPECT_EQ(FilterHeadersStatus::StopIteration,
+            stream3->filter_.decodeHeaders(request_headers_, false));
+  EXPECT_EQ(1U, stats_.counter("test.adaptive_concurrency.fake_cluster.rq_rejected").value());
+
+  // The rejected stream held no slot.
+  stream3.reset();
+  EXPECT_EQ(2U, inFlight());
+}
+
+TEST_F(AdaptiveConcurrencyFilterTest, ReleaseOnComplete) {
+  std::unique_ptr<Stream> stream1 = request(FilterHeadersStatus::Continue);
+  std::unique_ptr<Stream> stream2 = request(FilterHeadersStatus::Continue);
+
+  TestHeaderMapImpl response_headers{{":status", "200"}};
+  EXPECT_EQ(FilterHeadersStatus::Continue,
+            stream1->filter_.encodeHeaders(response_headers, false));
+  EXPECT_EQ(2U, inFlight());
+  Buffer::OwnedImpl data("hello");
+  EXPECT_EQ(FilterDataStatus::Continue, stream1->filter_.encodeData(data, true));
+  EXPECT_EQ(1U, inFlight());
+
+  // Trailers end the response as well, and the slot is only released once.
+  EXPECT_EQ(FilterHeadersStatus::Continue,
+            stream2->filter_.encodeHeaders(response_headers, false));
+  TestHeaderMapImpl response_trailers{{"grpc-status", "0"}};
+  EXPECT_EQ(FilterTrailersStatus::Continue, stream2->filter_.encodeTrailers(response_trailers));
+  EXPECT_EQ(0U, inFlight());
+  stream2.reset();
+  EXPECT_EQ(0U, inFlight());
+
+  std::unique_ptr<Stream> stream3 = request(FilterHeadersStatus::Continue);
+  EXPECT_EQ(1U, inFlight());
+}
+
+TEST_F(AdaptiveConcurrencyFilterTest, ReleaseOnReset) {
+  std::unique_ptr<Stream> stream1 = request(FilterHeadersStatus::Continue);
+  std::unique_ptr<Stream> stream2 = request(FilterHeadersStatus::Continue);
+  stream1.reset();
+  EXPECT_EQ(1U, inFlight());
+  std::unique_ptr<Stream> stream3 = request(FilterHeadersStatus::Continue);
+}
+
+TEST_F(AdaptiveConcurrencyFilterTest, LimitPerCluster) {
+  std::unique_ptr<Stream> stream1 = request(FilterHeadersStatus::Continue);
+  std::unique_ptr<Stream> stream2 = request(FilterHeadersStatus::Continue);
+
+  std::unique_ptr<Stream> stream3(new Stream(config_));
+  stream3->decoder_callbacks_.route_->route_entry_.cluster_name_ = "other_cluster";
+  EXPECT_EQ(FilterHeadersStatus::Continue,
+            stream3->filter_.decodeHeaders(request_headers_, false));
+  EXPECT_EQ(1U, config_->limit("other_cluster").inFlight());
+  EXPECT_EQ(2U, inFlight());
+}
+
+TEST_F(AdaptiveConcurrencyFilterTest, LatencySamples) {
+  setUpFilter(R"EOF({"initial_limit" : 2, "min_limit" : 1, "min_window_samples" : 1})EOF");
+  std::unique_ptr<Stream> stream = request(FilterHeadersStatus::Continue);
+  now_ += std::chrono::milliseconds(150);
+  TestHeaderMapImpl response_headers{{":status", "200"}};
+  stream->filter_.encodeHeaders(response_headers, true);
+  EXPECT_EQ(150000U, stats_.gauge("test.adaptive_concurrency.fake_cluster.sample_rtt_us").value());
+}
+
+TEST_F(AdaptiveConcurrencyFilterTest, Disabled) {
+  ON_CALL(runtime_.snapshot_, featureEnabled("adaptive_concurrency.enabled", 100))
+      .WillByDefault(Return(false));
+  std::unique_ptr<Stream> stream1 = request(FilterHeadersStatus::Continue);
+  std::unique_ptr<Stream> stream2 = request(FilterHeadersStatus::Continue);
+  std::unique_ptr<Stream> stream3 = request(FilterHeadersStatus::Continue);
+  EXPECT_EQ(0U, inFlight());
+}
+
+TEST_F(AdaptiveConcurrencyFilterTest, NoRoute) {
+  std::unique_ptr<Stream> stream(new Stream(config_));
+  ON_CALL(stream->decoder_callbacks_, route()).WillByDefault(Return(nullptr));
+  EXPECT_EQ(FilterHeadersStatus::Continue, stream->filter_.decodeHeaders(request_headers_, true));
+}
+
+TEST_F(AdaptiveConcurrencyFilterTest, BadConfig) {
+  EXPECT_THROW_WITH_MESSAGE(
+      setUpFilter(R"EOF({"min_limit" : 100, "max_limit" : 10})EOF"), EnvoyException,
+      "adaptive concurrency: min_limit 100 is greater than max_limit 10");
+  EXPECT_THROW(setUpFilter(R"EOF({"tolerance" : 0.5})EOF"), Json::Exception);
+}
+
+TEST_F(AdaptiveConcurrencyFilterTest, InitialLimitClamped) {
+  setUpFilter(R"EOF({"initial_limit" : 1000, "max_limit" : 50})EOF");
+  EXPECT_EQ(50U, config_->settings().initial_limit_);
+  EXPECT_EQ(50U, config_->limit("fake_cluster").limit());
+}
+
+} // namespace Http
+} // namespace Envoy
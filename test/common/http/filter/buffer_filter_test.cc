@@ -9,13 +9,16 @@
 
 #include "test/mocks/buffer/mocks.h"
 #include "test/mocks/http/mocks.h"
+#include "test/test_common/environment.h"
 #include "test/test_common/printers.h"
+#include "test/test_common/utility.h"
 
 #include "gmock/gmock.h"
 #include "gtest/gtest.h"
 
 using testing::DoAll;
 using testing::InSequence;
+using testing::Invoke;
 using testing::NiceMock;
 using testing::Return;
 using testing::SaveArg;
@@ -99,5 +102,106 @@ TEST_F(BufferFilterTest, TxResetAfterEndStream) {
   filter_.onDestroy();
 }
 
+class BufferFilterSpillTest : public testing::Test {
+public:
+  BufferFilterSpillTest()
+      : config_{new BufferFilterConfig{BufferFilter::generateStats("", store_), 64,
+                                       std::chrono::seconds(0), 8,
+                                       TestEnvironment::temporaryDirectory()}} {}
+
+  void setup() {
+    filter_.reset(new BufferFilter(config_));
+    filter_->setDecoderFilterCallbacks(callbacks_);
+    new NiceMock<Event::MockTimer>(&callbacks_.dispatcher_);
+    TestHeaderMapImpl headers;
+    EXPECT_EQ(FilterHeadersStatus::StopIteration, filter_->decodeHeaders(headers, false));
+  }
+
+  ~BufferFilterSpillTest() { filter_->onDestroy(); }
+
+  NiceMock<MockStreamDecoderFilterCallbacks> callbacks_;
+  Stats::IsolatedStoreImpl store_;
+  std::shared_ptr<BufferFilterConfig> config_;
+  std::unique_ptr<BufferFilter> filter_;
+};
+
+TEST_F(BufferFilterSpillTest, BelowThreshold) {
+  setup();
+
+  Buffer::OwnedImpl data1("hell");
+  EXPECT_EQ(FilterDataStatus::StopIterationNoBuffer, filter_->decodeData(data1, false));
+  EXPECT_EQ(0, data1.length());
+
+  Buffer::OwnedImpl data2("o");
+  EXPECT_EQ(FilterDataStatus::Continue, filter_->decodeData(data2, true));
+  EXPECT_EQ("hello", TestUtility::bufferToString(data2));
+  EXPECT_EQ(0U, config_->stats_.rq_spilled_.value());
+}
+
+TEST_F(BufferFilterSpillTest, SpillToFile) {
+  setup();
+
+  Buffer::OwnedImpl data1("hello");
+  EXPECT_EQ(FilterDataStatus::StopIterationNoBuffer, filter_->decodeData(data1, false));
+  Buffer::OwnedImpl data2(" world");
+  EXPECT_EQ(FilterDataStatus::StopIterationNoBuffer, filter_->decodeData(data2, false));
+  EXPECT_EQ(1U, config_->stats_.rq_spilled_.value());
+  Buffer::OwnedImpl data3(", spilled");
+  EXPECT_EQ(FilterDataStatus::StopIterationNoBuffer, filter_->decodeData(data3, false));
+
+  Buffer::OwnedImpl data4("!");
+  EXPECT_EQ(FilterDataStatus::Continue, filter_->decodeData(data4, true));
+  EXPECT_EQ("hello world, spilled!", TestUtility::bufferToString(data4));
+  EXPECT_EQ(1U, config_->stats_.rq_spilled_.value());
+  EXPECT_EQ(0U, config_->stats_.rq_spill_failed_.value());
+}
+
+TEST_F(BufferFilterSpillTest, TooLarge) {
+  setup();
+
+  Buffer::OwnedImpl data1(std::string(60, 'a'));
+  EXPECT_EQ(FilterDataStatus::StopIterationNoBuffer, filter_->decodeData(data1, false));
+
+  TestHeaderMapImpl response_headers{
+      {":status", "413"}, {"content-length", "17"}, {"content-type", "text/plain"}};
+  EXPECT_CALL(callbacks_, encodeHeaders_(HeaderMapEqualRef(&response_headers), false));
+  EXPECT_CALL(callbacks_, encodeData(_, true));
+  Buffer::OwnedImpl data2(std::string(5, 'a'));
+  EXPECT_EQ(FilterDataStatus::StopIterationNoBuffer, filter_->decodeData(data2, false));
+}
+
+TEST_F(BufferFilterSpillTest, SpillWithTrailers) {
+  setup();
+
+  Buffer::OwnedImpl data("hello world");
+  EXPECT_EQ(FilterDataStatus::StopIterationNoBuffer, filter_->decodeData(data, false));
+
+  Event::MockTimer* replay_timer = new NiceMock<Event::MockTimer>(&callbacks_.dispatcher_);
+  EXPECT_CALL(*replay_timer, enableTimer(std::chrono::milliseconds(0)));
+  TestHeaderMapImpl trailers;
+  EXPECT_EQ(FilterTrailersStatus::StopIteration, filter_->decodeTrailers(trailers));
+
+  InSequence s;
+  EXPECT_CALL(callbacks_, addDecodedData(_, false))
+      .WillOnce(Invoke([](Buffer::Instance& body, bool) {
+        EXPECT_EQ("hello world", TestUtility::bufferToString(body));
+      }));
+  EXPECT_CALL(callbacks_, continueDecoding());
+  replay_timer->callback_();
+}
+
+TEST_F(BufferFilterSpillTest, SpillFailure) {
+  config_->spill_directory_ = TestEnvironment::temporaryPath("does_not_exist");
+  setup();
+
+  Buffer::OwnedImpl data1("hello world");
+  EXPECT_EQ(FilterDataStatus::StopIterationNoBuffer, filter_->decodeData(data1, false));
+  Buffer::OwnedImpl data2("!");
+  EXPECT_EQ(FilterDataStatus::Continue, filter_->decodeData(data2, true));
+  EXPECT_EQ("hello world!", TestUtility::bufferToString(data2));
+  EXPECT_EQ(0U, config_->stats_.rq_spilled_.value());
+  EXPECT_EQ(1U, config_->stats_.rq_spill_failed_.value());
+}
+
 } // namespace Http
 } // namespace Envoy
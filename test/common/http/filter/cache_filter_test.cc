@@ -0,0 +1,436 @@
+#include <chrono>
+#include <memory>
+#include <string>
+
+#include "common/buffer/buffer_impl.h"
+#include "common/http/filter/cache_filter.h"
+#include "common/http/header_map_impl.h"
+#include "common/json/json_loader.h"
+#include "common/stats/stats_impl.h"
+
+#include "test/mocks/common.h"
+#include "test/mocks/http/mocks.h"
+#include "test/mocks/router/mocks.h"
+#include "test/mocks/runtime/mocks.h"
+#include "test/mocks/thread_local/mocks.h"
+#include "test/test_common/utility.h"
+
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+
+using testing::Invoke;
+using testing::NiceMock;
+using testing::Return;
+using testing::_;
+
+namespace Envoy {
+namespace Http {
+
+class CacheFilterTest : public testing::Test {
+public:
+  CacheFilterTest() {
+    ON_CALL(runtime_.snapshot_, featureEnabled("cache.enabled", 100)).WillByDefault(Return(true));
+    ON_CALL(time_source_, currentTime()).WillByDefault(Invoke([this]() { return now_; }));
+    setUpFilter("{}");
+  }
+
+  void setUpFilter(const std::string& json) {
+    Json::ObjectSharedPtr config = Json::Factory::loadFromString(json);
+    config_.reset(new CacheFilterConfig(*config, "test.", stats_, runtime_, tls_, time_source_));
+  }
+
+  // A stream through a new filter, with its own callbacks.
+  struct Stream {
+    Stream(CacheFilterConfigSharedPtr config) : filter_(config) {
+      filter_.setDecoderFilterCallbacks(decoder_callbacks_);
+      filter_.setEncoderFilterCallbacks(encoder_callbacks_);
+    }
+    ~Stream() { filter_.onDestroy(); }
+
+    NiceMock<MockStreamDecoderFilterCallbacks> decoder_callbacks_;
+    NiceMock<MockStreamEncoderFilterCallbacks> encoder_callbacks_;
+    CacheFilter filter_;
+  };
+
+  std::unique_ptr<Stream> newStream() { return std::unique_ptr<Stream>(new Stream(config_)); }
+
+  // Runs a request through a new stream and returns it.
+  std::unique_ptr<Stream> request(TestHeaderMapImpl& request_headers,
+                                  FilterHeadersStatus expected_status) {
+    std::unique_ptr<Stream> stream = newStream();
+    EXPECT_EQ(expected_status, stream->filter_.decodeHeaders(request_headers, true));
+    return stream;
+  }
+
+  // Runs a response through a stream.
+  void respond(Stream& stream, TestHeaderMapImpl&& response_headers, const std::string& body) {
+    EXPECT_EQ(FilterHeadersStatus::Continue,
+              stream.filter_.encodeHeaders(response_headers, body.empty()));
+    if (!body.empty()) {
+      Buffer::OwnedImpl data(body);
+      EXPECT_EQ(FilterDataStatus::Continue, stream.filter_.encodeData(data, true));
+    }
+  }
+
+  // Fetches a response for a request so that later requests may be served from the cache.
+  void fetch(TestHeaderMapImpl& request_headers, TestHeaderMapImpl&& response_headers,
+             const std::string& body) {
+    std::unique_ptr<Stream> stream = request(request_headers, FilterHeadersStatus::Continue);
+    respond(*stream, std::move(response_headers), body);
+    stream->filter_.onDestroy();
+  }
+
+  // Expects a stream to be served a cached response.
+  void expectServed(Stream& stream, const std::string& body, const std::string& age) {
+    EXPECT_CALL(stream.decoder_callbacks_, encodeHeaders_(_, body.empty()))
+        .WillOnce(Invoke([age](HeaderMap& headers, bool) -> void {
+          EXPECT_STREQ("200", headers.Status()->value().c_str());
+          EXPECT_STREQ(age.c_str(), headers.get(Headers::get().Age)->value().c_str());
+        }));
+    if (!body.empty()) {
+      EXPECT_CALL(stream.decoder_callbacks_, encodeData(_, true))
+          .WillOnce(Invoke([body](Buffer::Instance& data, bool) -> void {
+            EXPECT_EQ(body, TestUtility::bufferToString(data));
+          }));
+    }
+  }
+
+  uint64_t counter(const std::string& name) { return stats_.counter("test.cache." + name).value(); }
+
+  TestHeaderMapImpl get(const std::string& path = "/") {
+    return TestHeaderMapImpl{{":method", "GET"}, {":authority", "host"}, {":path", path}};
+  }
+
+  Stats::IsolatedStoreImpl stats_;
+  NiceMock<Runtime::MockLoader> runtime_;
+  NiceMock<ThreadLocal::MockInstance> tls_;
+  NiceMock<MockMonotonicTimeSource> time_source_;
+  MonotonicTime now_;
+  CacheFilterConfigSharedPtr config_;
+};
+
+TEST_F(CacheFilterTest, ParseCacheControl) {
+  CacheControl cache_control = CacheControl::parse("public, max-age=60, S-MAXAGE=\"120\"");
+  EXPECT_FALSE(cache_control.no_store_);
+  EXPECT_FALSE(cache_control.no_cache_);
+  EXPECT_FALSE(cache_control.private_);
+  EXPECT_EQ(60, cache_control.max_age_);
+  EXPECT_EQ(120, cache_control.s_maxage_);
+
+  cache_control = CacheControl::parse("no-store,no-cache , private, max-age=bad");
+  EXPECT_TRUE(cache_control.no_store_);
+  EXPECT_TRUE(cache_control.no_cache_);
+  EXPECT_TRUE(cache_control.private_);
+  EXPECT_EQ(-1, cache_control.max_age_);
+  EXPECT_EQ(-1, cache_control.s_maxage_);
+}
+
+TEST_F(CacheFilterTest, MissThenHit) {
+  TestHeaderMapImpl request_headers = get();
+  fetch(request_headers, {{":status", "200"}, {"cache-control", "max-age=60"}}, "hello");
+  EXPECT_EQ(1U, counter("miss"));
+  EXPECT_EQ(1U, counter("insert"));
+  EXPECT_EQ(1U, stats_.gauge("test.cache.cached_responses").value());
+
+  now_ += std::chrono::seconds(10);
+  std::unique_ptr<Stream> stream = newStream();
+  expectServed(*stream, "hello", "10");
+  EXPECT_EQ(FilterHeadersStatus::StopIteration,
+            stream->filter_.decodeHeaders(request_headers, true));
+  EXPECT_EQ(1U, counter("hit"));
+
+  // The response expires after its max-age.
+  now_ += std::chrono::seconds(50);
+  request(request_headers, FilterHeadersStatus::Continue);
+  EXPECT_EQ(2U, counter("miss"));
+  EXPECT_EQ(0U, stats_.gauge("test.cache.cached_responses").value());
+}
+
+TEST_F(CacheFilterTest, HeadServedFromGet) {
+  TestHeaderMapImpl request_headers = get();
+  fetch(request_headers, {{":status", "200"}, {"cache-control", "s-maxage=60, max-age=0"}},
+        "hello");
+
+  TestHeaderMapImpl head_headers{{":method", "HEAD"}, {":authority", "host"}, {":path", "/"}};
+  std::unique_ptr<Stream> stream = newStream();
+  expectServed(*stream, "", "0");
+  EXPECT_EQ(FilterHeadersStatus::StopIteration, stream->filter_.decodeHeaders(head_headers, true));
+}
+
+TEST_F(CacheFilterTest, AgeFromUpstream) {
+  TestHeaderMapImpl request_headers = get();
+  fetch(request_headers, {{":status", "200"}, {"cache-control", "max-age=60"}, {"age", "30"}},
+        "hello");
+
+  std::unique_ptr<Stream> stream = newStream();
+  expectServed(*stream, "hello", "30");
+  stream->filter_.decodeHeaders(request_headers, true);
+
+  // The response was 30 seconds old, so it expires after another 30.
+  now_ += std::chrono::seconds(30);
+  request(request_headers, FilterHeadersStatus::Continue);
+}
+
+TEST_F(CacheFilterTest, UncacheableResponses) {
+  TestHeaderMapImpl request_headers = get();
+  fetch(request_headers, {{":status", "200"}}, "no freshness");
+  fetch(request_headers, {{":status", "200"}, {"cache-control", "no-store, max-age=60"}}, "x");
+  fetch(request_headers, {{":status", "200"}, {"cache-control", "private, max-age=60"}}, "x");
+  fetch(request_headers, {{":status", "200"}, {"cache-control", "no-cache, max-age=60"}}, "x");
+  fetch(request_headers, {{":status", "206"}, {"cache-control", "max-age=60"}}, "x");
+  fetch(request_headers,
+        {{":status", "200"}, {"cache-control", "max-age=60"}, {"set-cookie", "a=b"}}, "x");
+  fetch(request_headers, {{":status", "200"}, {"cache-control", "max-age=60"}, {"vary", "*"}},
+        "x");
+  fetch(request_headers, {{":status", "200"}, {"cache-control", "max-age=60"}, {"age", "60"}},
+        "x");
+  EXPECT_EQ(8U, counter("uncacheable"));
+  EXPECT_EQ(0U, counter("insert"));
+
+  request(request_headers, FilterHeadersStatus::Continue);
+  EXPECT_EQ(0U, counter("hit"));
+}
+
+TEST_F(CacheFilterTest, ResponseWithTrailers) {
+  TestHeaderMapImpl request_headers = get();
+  std::unique_ptr<Stream> stream = request(request_headers, FilterHeadersStatus::Continue);
+  TestHeaderMapImpl response_headers{{":status", "200"}, {"cache-control", "max-age=60"}};
+  stream->filter_.encodeHeaders(response_headers, false);
+  TestHeaderMapImpl trailers{{"grpc-status", "0"}};
+  EXPECT_EQ(FilterTrailersStatus::Continue, stream->filter_.encodeTrailers(trailers));
+  EXPECT_EQ(1U, counter("uncacheable"));
+  EXPECT_EQ(0U, counter("insert"));
+}
+
+TEST_F(CacheFilterTest, BodyTooLarge) {
+  setUpFilter(R"EOF({"max_body_bytes": 4})EOF");
+  TestHeaderMapImpl request_headers = get();
+  fetch(request_headers, {{":status", "200"}, {"cache-control", "max-age=60"}}, "hello");
+  EXPECT_EQ(1U, counter("uncacheable"));
+  EXPECT_EQ(0U, counter("insert"));
+}
+
+TEST_F(CacheFilterTest, DefaultTtl) {
+  setUpFilter(R"EOF({"default_ttl_ms": 10000})EOF");
+  TestHeaderMapImpl request_headers = get();
+  fetch(request_headers, {{":status", "200"}}, "hello");
+  EXPECT_EQ(1U, counter("insert"));
+
+  now_ += std::chrono::seconds(10);
+  request(request_headers, FilterHeadersStatus::Continue);
+  EXPECT_EQ(2U, counter("miss"));
+}
+
+TEST_F(CacheFilterTest, RouteConfig) {
+  TestHeaderMapImpl request_headers = get();
+
+  // The route sets the lifetime of the responses that have none.
+  std::unique_ptr<Stream> stream = newStream();
+  stream->decoder_callbacks_.route_->route_entry_.opaque_config_.emplace("cache_ttl_ms", "5000");
+  EXPECT_EQ(FilterHeadersStatus::Continue, stream->filter_.decodeHeaders(request_headers, true));
+  respond(*stream, {{":status", "200"}}, "hello");
+  EXPECT_EQ(1U, counter("insert"));
+
+  // The route turns caching off.
+  stream = newStream();
+  stream->decoder_callbacks_.route_->route_entry_.opaque_config_.emplace("cache", "false");
+  EXPECT_EQ(FilterHeadersStatus::Continue, stream->filter_.decodeHeaders(request_headers, true));
+  EXPECT_EQ(0U, counter("hit"));
+  EXPECT_EQ(1U, counter("miss"));
+}
+
+TEST_F(CacheFilterTest, Bypass) {
+  TestHeaderMapImpl request_headers = get();
+  fetch(request_headers, {{":status", "200"}, {"cache-control", "max-age=60"}}, "hello");
+
+  TestHeaderMapImpl authorized = get();
+  authorized.addCopy("authorization", "secret");
+  request(authorized, FilterHeadersStatus::Continue);
+  TestHeaderMapImpl no_cache = get();
+  no_cache.addCopy("cache-control", "no-cache");
+  request(no_cache, FilterHeadersStatus::Continue);
+  TestHeaderMapImpl max_age_0 = get();
+  max_age_0.addCopy("cache-control", "max-age=0");
+  request(max_age_0, FilterHeadersStatus::Continue);
+  TestHeaderMapImpl pragma = get();
+  pragma.addCopy("pragma", "No-Cache");
+  request(pragma, FilterHeadersStatus::Continue);
+  EXPECT_EQ(4U, counter("bypass"));
+
+  TestHeaderMapImpl post{{":method", "POST"}, {":authority", "host"}, {":path", "/"}};
+  request(post, FilterHeadersStatus::Continue);
+  EXPECT_EQ(0U, counter("hit"));
+  EXPECT_EQ(1U, counter("miss"));
+
+  ON_CALL(runtime_.snapshot_, featureEnabled("cache.enabled", 100)).WillByDefault(Return(false));
+  request(request_headers, FilterHeadersStatus::Continue);
+  EXPECT_EQ(0U, counter("hit"));
+}
+
+TEST_F(CacheFilterTest, Vary) {
+  TestHeaderMapImpl gzip_request = get();
+  gzip_request.addCopy("accept-encoding", "gzip");
+  fetch(gzip_request,
+        {{":status", "200"}, {"cache-control", "max-age=60"}, {"vary", "Accept-Encoding"}},
+        "gzipped");
+
+  TestHeaderMapImpl identity_request = get();
+  request(identity_request, FilterHeadersStatus::Continue);
+  EXPECT_EQ(2U, counter("miss"));
+  fetch(identity_request,
+        {{":status", "200"}, {"cache-control", "max-age=60"}, {"vary", "Accept-Encoding"}},
+        "plain");
+  EXPECT_EQ(2U, stats_.gauge("test.cache.cached_responses").value());
+
+  std::unique_ptr<Stream> stream = newStream();
+  expectServed(*stream, "gzipped", "0");
+  stream->filter_.decodeHeaders(gzip_request, true);
+  stream = newStream();
+  expectServed(*stream, "plain", "0");
+  stream->filter_.decodeHeaders(identity_request, true);
+  EXPECT_EQ(2U, counter("hit"));
+}
+
+TEST_F(CacheFilterTest, CoalesceConcurrentMisses) {
+  TestHeaderMapImpl request_headers = get();
+  std::unique_ptr<Stream> leader = request(request_headers, FilterHeadersStatus::Continue);
+  std::unique_ptr<Stream> waiter1 = request(request_headers, FilterHeadersStatus::StopIteration);
+  std::unique_ptr<Stream> waiter2 = request(request_headers, FilterHeadersStatus::StopIteration);
+  std::unique_ptr<Stream> destroyed = request(request_headers, FilterHeadersStatus::StopIteration);
+  EXPECT_EQ(3U, counter("coalesced"));
+
+  // A waiter going away is forgotten.
+  destroyed->filter_.onDestroy();
+  EXPECT_CALL(destroyed->decoder_callbacks_, encodeHeaders_(_, _)).Times(0);
+
+  // Requests for other keys do not wait.
+  TestHeaderMapImpl other_headers = get("/other");
+  request(other_headers, FilterHeadersStatus::Continue);
+
+  expectServed(*waiter1, "hello", "0");
+  expectServed(*waiter2, "hello", "0");
+  respond(*leader, {{":status", "200"}, {"cache-control", "max-age=60"}}, "hello");
+  EXPECT_EQ(2U, counter("hit"));
+  EXPECT_EQ(1U, counter("insert"));
+}
+
+TEST_F(CacheFilterTest, CoalescedRequestsFetchWhenUncacheable) {
+  TestHeaderMapImpl request_headers = get();
+  std::unique_ptr<Stream> leader = request(request_headers, FilterHeadersStatus::Continue);
+  std::unique_ptr<Stream> waiter = request(request_headers, FilterHeadersStatus::StopIteration);
+
+  EXPECT_CALL(waiter->decoder_callbacks_, continueDecoding());
+  TestHeaderMapImpl response_headers{{":status", "200"}, {"cache-control", "no-store"}};
+  leader->filter_.encodeHeaders(response_headers, false);
+  EXPECT_EQ(1U, counter("uncacheable"));
+
+  // The waiter does not store its response.
+  respond(*waiter, {{":status", "200"}, {"cache-control", "max-age=60"}}, "hello");
+  EXPECT_EQ(0U, counter("insert"));
+}
+
+TEST_F(CacheFilterTest, CoalescedRequestsFetchWhenLeaderReset) {
+  TestHeaderMapImpl request_headers = get();
+  std::unique_ptr<Stream> leader = request(request_headers, FilterHeadersStatus::Continue);
+  std::unique_ptr<Stream> waiter = request(request_headers, FilterHeadersStatus::StopIteration);
+
+  EXPECT_CALL(waiter->decoder_callbacks_, continueDecoding());
+  leader->filter_.onDestroy();
+
+  // The next request fetches the response again.
+  request(request_headers, FilterHeadersStatus::Continue);
+}
+
+TEST_F(CacheFilterTest, CoalescedRequestOfOtherVariant) {
+  TestHeaderMapImpl request_headers = get();
+  std::unique_ptr<Stream> leader = request(request_headers, FilterHeadersStatus::Continue);
+  TestHeaderMapImpl gzip_request = get();
+  gzip_request.addCopy("accept-encoding", "gzip");
+  std::unique_ptr<Stream> waiter = request(gzip_request, FilterHeadersStatus::StopIteration);
+
+  EXPECT_CALL(waiter->decoder_callbacks_, continueDecoding());
+  respond(*leader,
+          {{":status", "200"}, {"cache-control", "max-age=60"}, {"vary", "accept-encoding"}},
+          "plain");
+  EXPECT_EQ(0U, counter("hit"));
+}
+
+TEST_F(CacheFilterTest, SharedStore) {
+  // Workers keep nothing, so that hits come from the shared store.
+  setUpFilter(R"EOF({"max_responses": 0, "shared_max_bytes": 1048576})EOF");
+  TestHeaderMapImpl request_headers = get();
+  fetch(request_headers, {{":status", "200"}, {"cache-control", "max-age=60"}}, "hello");
+  EXPECT_EQ(0U, stats_.gauge("test.cache.cached_responses").value());
+  EXPECT_EQ(1U, stats_.gauge("test.cache.shared_cached_responses").value());
+
+  std::unique_ptr<Stream> stream = newStream();
+  expectServed(*stream, "hello", "0");
+  stream->filter_.decodeHeaders(request_headers, true);
+  EXPECT_EQ(1U, counter("hit"));
+  EXPECT_EQ(1U, counter("shared_hit"));
+}
+
+class ResponseStoreTest : public testing::Test {
+public:
+  ResponseStoreTest()
+      : evictions_(stats_.counter("evictions")), responses_(stats_.gauge("responses")),
+        bytes_(stats_.gauge("bytes")) {}
+
+  CachedResponseConstSharedPtr response(const std::string& body) {
+    CachedResponseSharedPtr response =
+        std::make_shared<CachedResponse>(request_headers_, TestHeaderMapImpl{{":status", "200"}},
+                                         std::vector<LowerCaseString>{}, now_,
+                                         now_ + std::chrono::seconds(60), std::chrono::seconds(0));
+    response->appendBody(Buffer::OwnedImpl(body));
+    return response;
+  }
+
+  Stats::IsolatedStoreImpl stats_;
+  Stats::Counter& evictions_;
+  Stats::Gauge& responses_;
+  Stats::Gauge& bytes_;
+  TestHeaderMapImpl request_headers_;
+  MonotonicTime now_;
+};
+
+TEST_F(ResponseStoreTest, EvictLeastRecentlyUsed) {
+  ResponseStore store(2, 1024, evictions_, responses_, bytes_);
+  store.insert("a", response("a"));
+  store.insert("b", response("b"));
+  EXPECT_NE(nullptr, store.lookup("a", request_headers_, now_));
+  store.insert("c", response("c"));
+
+  EXPECT_EQ(nullptr, store.lookup("b", request_headers_, now_));
+  EXPECT_NE(nullptr, store.lookup("a", request_headers_, now_));
+  EXPECT_NE(nullptr, store.lookup("c", request_headers_, now_));
+  EXPECT_EQ(1U, evictions_.value());
+  EXPECT_EQ(2U, responses_.value());
+}
+
+TEST_F(ResponseStoreTest, BoundedBySize) {
+  ResponseStore store(100, 1000, evictions_, responses_, bytes_);
+  store.insert("a", response(std::string(400, 'a')));
+  store.insert("b", response(std::string(400, 'b')));
+  store.insert("c", response(std::string(400, 'c')));
+  EXPECT_EQ(nullptr, store.lookup("a", request_headers_, now_));
+  EXPECT_EQ(2U, store.responses());
+  EXPECT_LE(store.bytes(), 1000U);
+  EXPECT_EQ(store.bytes(), bytes_.value());
+
+  // Responses larger than the store are not stored.
+  store.insert("d", response(std::string(1000, 'd')));
+  EXPECT_EQ(nullptr, store.lookup("d", request_headers_, now_));
+  EXPECT_EQ(2U, store.responses());
+}
+
+TEST_F(ResponseStoreTest, ReplaceResponse) {
+  ResponseStore store(100, 1000, evictions_, responses_, bytes_);
+  store.insert("a", response("first"));
+  store.insert("a", response("second"));
+  EXPECT_EQ(1U, store.responses());
+  EXPECT_EQ("second", store.lookup("a", request_headers_, now_)->body());
+  EXPECT_EQ(0U, evictions_.value());
+}
+
+} // namespace Http
+} // namespace Envoy
@@ -2,6 +2,7 @@
 #include <cstdint>
 #include <memory>
 #include <string>
+#include <unordered_map>
 
 #include "envoy/event/dispatcher.h"
 
@@ -725,5 +726,50 @@ TEST_F(FaultFilterTest, FaultWithTargetClusterNullRoute) {
   EXPECT_EQ(0UL, config_->stats().aborts_injected_.value());
 }
 
+// With no fault percentage in the config, requests are only looked at once the runtime has one.
+TEST_F(FaultFilterTest, DisabledFaultsBypassed) {
+  const std::string json = R"EOF(
+    {
+      "abort" : {
+        "abort_percent" : 0,
+        "http_status" : 503
+      },
+      "headers" : [
+        {"name" : "X-Foo"}
+      ]
+    }
+    )EOF";
+  SetUpTest(json);
+
+  std::unordered_map<std::string, const Runtime::Snapshot::Entry> entries;
+  entries.emplace("fault.http.abort.http_status", Runtime::Snapshot::Entry{"503", 503});
+  entries.emplace("fault.http.cluster.abort.abort_percent", Runtime::Snapshot::Entry{"0", 0});
+  ON_CALL(runtime_.snapshot_, getAll()).WillByDefault(ReturnRef(entries));
+  ON_CALL(runtime_.snapshot_, version()).WillByDefault(Return(1));
+
+  TestHeaderMapImpl request_headers{{"x-envoy-downstream-service-cluster", "cluster"},
+                                    {"x-foo", "bar"}};
+  EXPECT_CALL(runtime_.snapshot_, getAll());
+  EXPECT_CALL(runtime_.snapshot_, featureEnabled(_, _)).Times(0);
+  EXPECT_EQ(FilterHeadersStatus::Continue, filter_->decodeHeaders(request_headers, false));
+  EXPECT_EQ(FilterHeadersStatus::Continue, filter_->decodeHeaders(request_headers, false));
+
+  // A new snapshot enabling aborts for the downstream cluster.
+  entries.erase("fault.http.cluster.abort.abort_percent");
+  entries.emplace("fault.http.cluster.abort.abort_percent", Runtime::Snapshot::Entry{"100", 100});
+  ON_CALL(runtime_.snapshot_, version()).WillByDefault(Return(2));
+  EXPECT_CALL(runtime_.snapshot_, getAll());
+  EXPECT_CALL(runtime_.snapshot_, featureEnabled(_, 0)).WillRepeatedly(Return(false));
+  EXPECT_CALL(runtime_.snapshot_, featureEnabled("fault.http.cluster.abort.abort_percent", 0))
+      .WillOnce(Return(true));
+
+  Http::TestHeaderMapImpl response_headers{
+      {":status", "503"}, {"content-length", "18"}, {"content-type", "text/plain"}};
+  EXPECT_CALL(filter_callbacks_, encodeHeaders_(HeaderMapEqualRef(&response_headers), false));
+  EXPECT_CALL(filter_callbacks_, encodeData(_, true));
+  EXPECT_EQ(FilterHeadersStatus::StopIteration, filter_->decodeHeaders(request_headers, false));
+  EXPECT_EQ(1UL, config_->stats().aborts_injected_.value());
+}
+
 } // namespace Http
 } // namespace Envoy
@@ -0,0 +1,314 @@
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "common/buffer/buffer_impl.h"
+#include "common/http/filter/gzip_filter.h"
+#include "common/http/header_map_impl.h"
+#include "common/json/json_loader.h"
+#include "common/stats/stats_impl.h"
+
+#include "test/mocks/http/mocks.h"
+#include "test/mocks/runtime/mocks.h"
+#include "test/mocks/thread_local/mocks.h"
+#include "test/test_common/utility.h"
+
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+#include "zlib.h"
+
+using testing::Invoke;
+using testing::NiceMock;
+using testing::Return;
+using testing::_;
+
+namespace Envoy {
+namespace Http {
+
+class GzipFilterTest : public testing::Test {
+public:
+  GzipFilterTest() {
+    ON_CALL(runtime_.snapshot_, featureEnabled("gzip.enabled", 100)).WillByDefault(Return(true));
+    setUpFilter("{}");
+  }
+
+  void setUpFilter(const std::string& json) {
+    Json::ObjectSharedPtr config = Json::Factory::loadFromString(json);
+    config_.reset(new GzipFilterConfig(*config, "test.", stats_, runtime_, tls_));
+    newFilter();
+  }
+
+  // Starts a new stream with the current config.
+  void newFilter() {
+    filter_.reset(new GzipFilter(config_));
+    filter_->setEncoderFilterCallbacks(encoder_callbacks_);
+  }
+
+  // Runs the request headers and the response headers through the filter.
+  void doHeaders(const std::string& accept_encoding, TestHeaderMapImpl& response_headers) {
+    TestHeaderMapImpl request_headers{{":method", "get"}, {":path", "/"}};
+    if (!accept_encoding.empty()) {
+      request_headers.addCopy("accept-encoding", accept_encoding);
+    }
+    EXPECT_EQ(FilterHeadersStatus::Continue, filter_->decodeHeaders(request_headers, true));
+    EXPECT_EQ(FilterHeadersStatus::Continue, filter_->encodeHeaders(response_headers, false));
+  }
+
+  // Runs a body made of `chunks` chunks of `chunk_size` bytes through the filter.
+  std::string doBody(uint64_t chunks, uint64_t chunk_size, std::string& original) {
+    std::string encoded;
+    for (uint64_t i = 0; i < chunks; i++) {
+      Buffer::OwnedImpl data;
+      TestUtility::feedBufferWithRandomCharacters(data, chunk_size, i);
+      original += TestUtility::bufferToString(data);
+      EXPECT_EQ(FilterDataStatus::Continue, filter_->encodeData(data, i == chunks - 1));
+      encoded += TestUtility::bufferToString(data);
+    }
+    return encoded;
+  }
+
+  // Decompresses a gzip (window_bits 31) or zlib (window_bits 15) stream.
+  static std::string decompress(const std::string& compressed, int window_bits,
+                                bool expect_end = true) {
+    std::string input = compressed;
+    z_stream zstream{};
+    EXPECT_EQ(Z_OK, inflateInit2(&zstream, window_bits));
+    zstream.avail_in = input.size();
+    zstream.next_in = reinterpret_cast<Bytef*>(&input[0]);
+
+    std::string output;
+    int result = Z_OK;
+    while (result == Z_OK && (zstream.avail_in > 0 || zstream.avail_out == 0)) {
+      unsigned char chunk[4096];
+      zstream.avail_out = sizeof(chunk);
+      zstream.next_out = chunk;
+      result = inflate(&zstream, Z_NO_FLUSH);
+      output.append(reinterpret_cast<char*>(chunk), sizeof(chunk) - zstream.avail_out);
+    }
+    EXPECT_EQ(expect_end ? Z_STREAM_END : Z_OK, result);
+    inflateEnd(&zstream);
+    return output;
+  }
+
+  Stats::IsolatedStoreImpl stats_;
+  NiceMock<Runtime::MockLoader> runtime_;
+  NiceMock<ThreadLocal::MockInstance> tls_;
+  NiceMock<MockStreamEncoderFilterCallbacks> encoder_callbacks_;
+  GzipFilterConfigSharedPtr config_;
+  std::unique_ptr<GzipFilter> filter_;
+};
+
+TEST_F(GzipFilterTest, SelectEncoding) {
+  EXPECT_EQ(ContentEncoding::Gzip, GzipFilter::selectEncoding("gzip"));
+  EXPECT_EQ(ContentEncoding::Gzip, GzipFilter::selectEncoding("deflate, gzip"));
+  EXPECT_EQ(ContentEncoding::Gzip, GzipFilter::selectEncoding(" GZIP ;q=0.5, br"));
+  EXPECT_EQ(ContentEncoding::Gzip, GzipFilter::selectEncoding("*"));
+  EXPECT_EQ(ContentEncoding::Deflate, GzipFilter::selectEncoding("deflate"));
+  EXPECT_EQ(ContentEncoding::Deflate, GzipFilter::selectEncoding("gzip;q=0.5, deflate"));
+  EXPECT_EQ(ContentEncoding::Deflate, GzipFilter::selectEncoding("gzip;q=0, *"));
+  EXPECT_EQ(ContentEncoding::Identity, GzipFilter::selectEncoding("gzip;q=0"));
+  EXPECT_EQ(ContentEncoding::Identity, GzipFilter::selectEncoding("*;q=0"));
+  EXPECT_EQ(ContentEncoding::Identity, GzipFilter::selectEncoding("identity, br"));
+  EXPECT_EQ(ContentEncoding::Identity, GzipFilter::selectEncoding(""));
+}
+
+TEST_F(GzipFilterTest, CompressGzip) {
+  TestHeaderMapImpl response_headers{{":status", "200"},
+                                     {"content-type", "application/json; charset=utf-8"},
+                                     {"content-length", "3000"}};
+  doHeaders("gzip, deflate", response_headers);
+  EXPECT_FALSE(response_headers.has("content-length"));
+  EXPECT_EQ("gzip", response_headers.get_("content-encoding"));
+  EXPECT_EQ("Accept-Encoding", response_headers.get_("vary"));
+
+  std::string original;
+  const std::string encoded = doBody(3, 1000, original);
+  EXPECT_GT(original.size(), encoded.size());
+  EXPECT_EQ(original, decompress(encoded, 31));
+  filter_->onDestroy();
+
+  EXPECT_EQ(1U, stats_.counter("test.gzip.compressed").value());
+  EXPECT_EQ(3000U, stats_.counter("test.gzip.total_uncompressed_bytes").value());
+  EXPECT_EQ(encoded.size(), stats_.counter("test.gzip.total_compressed_bytes").value());
+}
+
+TEST_F(GzipFilterTest, CompressDeflate) {
+  TestHeaderMapImpl response_headers{{":status", "200"}, {"content-type", "text/html"}};
+  doHeaders("deflate", response_headers);
+  EXPECT_EQ("deflate", response_headers.get_("content-encoding"));
+
+  std::string original;
+  const std::string encoded = doBody(2, 500, original);
+  EXPECT_EQ(original, decompress(encoded, 15));
+  filter_->onDestroy();
+}
+
+TEST_F(GzipFilterTest, NoAcceptEncoding) {
+  TestHeaderMapImpl response_headers{{":status", "200"}, {"content-type", "text/html"}};
+  doHeaders("", response_headers);
+  EXPECT_FALSE(response_headers.has("content-encoding"));
+
+  std::string original;
+  const std::string encoded = doBody(1, 100, original);
+  EXPECT_EQ(original, encoded);
+  filter_->onDestroy();
+  EXPECT_EQ(1U, stats_.counter("test.gzip.no_accept_header").value());
+}
+
+TEST_F(GzipFilterTest, NotCompressible) {
+  const std::vector<std::vector<std::pair<std::string, std::string>>> uncompressible{
+      {{"content-type", "image/png"}},
+      {},
+      {{"content-type", "text/html"}, {"content-length", "29"}},
+      {{"content-type", "text/html"}, {"content-encoding", "br"}},
+      {{"content-type", "text/html"}, {"cache-control", "No-Transform"}}};
+
+  for (const auto& headers : uncompressible) {
+    newFilter();
+    TestHeaderMapImpl response_headers{{":status", "200"}};
+    for (const auto& header : headers) {
+      response_headers.addCopy(header.first, header.second);
+    }
+    doHeaders("gzip", response_headers);
+    EXPECT_NE("gzip", response_headers.get_("content-encoding"));
+    filter_->onDestroy();
+  }
+  EXPECT_EQ(uncompressible.size(), stats_.counter("test.gzip.not_compressed").value());
+
+  // Header only responses are not counted.
+  newFilter();
+  TestHeaderMapImpl request_headers{{"accept-encoding", "gzip"}};
+  filter_->decodeHeaders(request_headers, true);
+  TestHeaderMapImpl response_headers{{":status", "200"}, {"content-type", "text/html"}};
+  filter_->encodeHeaders(response_headers, true);
+  EXPECT_FALSE(response_headers.has("content-encoding"));
+  filter_->onDestroy();
+}
+
+TEST_F(GzipFilterTest, RuntimeDisabled) {
+  EXPECT_CALL(runtime_.snapshot_, featureEnabled("gzip.enabled", 100)).WillOnce(Return(false));
+  TestHeaderMapImpl response_headers{{":status", "200"}, {"content-type", "text/html"}};
+  doHeaders("gzip", response_headers);
+  EXPECT_FALSE(response_headers.has("content-encoding"));
+  filter_->onDestroy();
+}
+
+TEST_F(GzipFilterTest, VaryAndEtag) {
+  TestHeaderMapImpl response_headers{{":status", "200"},
+                                     {"content-type", "text/html"},
+                                     {"vary", "Cookie"},
+                                     {"etag", "\"abc\""}};
+  doHeaders("gzip", response_headers);
+  EXPECT_EQ("Cookie, Accept-Encoding", response_headers.get_("vary"));
+  EXPECT_EQ("W/\"abc\"", response_headers.get_("etag"));
+  filter_->onDestroy();
+
+  newFilter();
+  TestHeaderMapImpl weak_headers{{":status", "200"},
+                                 {"content-type", "text/html"},
+                                 {"vary", "accept-encoding"},
+                                 {"etag", "W/\"abc\""}};
+  doHeaders("gzip", weak_headers);
+  EXPECT_EQ("accept-encoding", weak_headers.get_("vary"));
+  EXPECT_EQ("W/\"abc\"", weak_headers.get_("etag"));
+  filter_->onDestroy();
+}
+
+TEST_F(GzipFilterTest, Trailers) {
+  TestHeaderMapImpl response_headers{{":status", "200"}, {"content-type", "text/plain"}};
+  doHeaders("gzip", response_headers);
+
+  Buffer::OwnedImpl data;
+  TestUtility::feedBufferWithRandomCharacters(data, 1000);
+  const std::string original = TestUtility::bufferToString(data);
+  filter_->encodeData(data, false);
+  std::string encoded = TestUtility::bufferToString(data);
+
+  EXPECT_CALL(encoder_callbacks_, addEncodedData(_, true))
+      .WillOnce(Invoke([&encoded](Buffer::Instance& data, bool) -> void {
+        encoded += TestUtility::bufferToString(data);
+      }));
+  TestHeaderMapImpl trailers;
+  EXPECT_EQ(FilterTrailersStatus::Continue, filter_->encodeTrailers(trailers));
+  EXPECT_EQ(original, decompress(encoded, 31));
+  filter_->onDestroy();
+}
+
+TEST_F(GzipFilterTest, SyncFlush) {
+  setUpFilter(R"EOF({"sync_flush": true, "compression_level": "speed"})EOF");
+  TestHeaderMapImpl response_headers{{":status", "200"}, {"content-type", "text/plain"}};
+  doHeaders("gzip", response_headers);
+
+  // Every chunk can be decompressed as soon as it is received.
+  Buffer::OwnedImpl data;
+  TestUtility::feedBufferWithRandomCharacters(data, 100);
+  const std::string original = TestUtility::bufferToString(data);
+  filter_->encodeData(data, false);
+  EXPECT_EQ(original, decompress(TestUtility::bufferToString(data), 31, false));
+  filter_->onDestroy();
+}
+
+TEST_F(GzipFilterTest, CompressorPool) {
+  EXPECT_EQ(0U, config_->compressorPool().idle());
+
+  for (int i = 0; i < 3; i++) {
+    newFilter();
+    TestHeaderMapImpl response_headers{{":status", "200"}, {"content-type", "text/plain"}};
+    doHeaders("gzip", response_headers);
+    EXPECT_EQ(0U, config_->compressorPool().idle());
+    std::string original;
+    const std::string encoded = doBody(2, 1000, original);
+    EXPECT_EQ(original, decompress(encoded, 31));
+    EXPECT_EQ(1U, config_->compressorPool().idle());
+    filter_->onDestroy();
+  }
+
+  // A response reset part way through gives back its compressor too, reset for the next stream.
+  newFilter();
+  TestHeaderMapImpl response_headers{{":status", "200"}, {"content-type", "text/plain"}};
+  doHeaders("gzip", response_headers);
+  Buffer::OwnedImpl data("hello");
+  filter_->encodeData(data, false);
+  filter_->onDestroy();
+  EXPECT_EQ(1U, config_->compressorPool().idle());
+
+  // Streams at a different level do not share compressors.
+  EXPECT_CALL(runtime_.snapshot_, getInteger("gzip.compression_level", 0)).WillOnce(Return(9));
+  newFilter();
+  TestHeaderMapImpl best_headers{{":status", "200"}, {"content-type", "text/plain"}};
+  doHeaders("gzip", best_headers);
+  EXPECT_EQ(1U, config_->compressorPool().idle());
+  std::string original;
+  const std::string encoded = doBody(1, 1000, original);
+  EXPECT_EQ(original, decompress(encoded, 31));
+  filter_->onDestroy();
+  EXPECT_EQ(2U, config_->compressorPool().idle());
+}
+
+TEST(CompressorPoolTest, MaxRetained) {
+  CompressorPool pool(Compressor::ZlibCompressorImpl::CompressionStrategy::Standard, 8, 2);
+  std::vector<PooledCompressorPtr> compressors;
+  for (int i = 0; i < 3; i++) {
+    compressors.push_back(
+        pool.acquire(Compressor::ZlibCompressorImpl::CompressionLevel::Standard, 31));
+  }
+  const PooledCompressor* last_released = compressors.back().get();
+  for (PooledCompressorPtr& compressor : compressors) {
+    pool.release(std::move(compressor));
+  }
+  EXPECT_EQ(2U, pool.idle());
+
+  // The most recently released compressor is handed out first, and only for equal parameters.
+  PooledCompressorPtr compressor =
+      pool.acquire(Compressor::ZlibCompressorImpl::CompressionLevel::Standard, 31);
+  EXPECT_EQ(last_released, compressor.get());
+  EXPECT_EQ(1U, pool.idle());
+  PooledCompressorPtr other =
+      pool.acquire(Compressor::ZlibCompressorImpl::CompressionLevel::Standard, 15);
+  EXPECT_EQ(15, other->window_bits_);
+  EXPECT_EQ(1U, pool.idle());
+}
+
+} // namespace Http
+} // namespace Envoy
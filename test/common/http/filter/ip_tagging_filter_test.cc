@@ -2,6 +2,8 @@
 #include "common/http/filter/ip_tagging_filter.h"
 #include "common/http/header_map_impl.h"
 #include "common/http/headers.h"
+#include "common/network/utility.h"
+#include "common/stats/stats_impl.h"
 
 #include "test/mocks/http/mocks.h"
 #include "test/test_common/utility.h"
@@ -47,7 +49,15 @@ public:
       "ip_tags" : [
         {
           "ip_tag_name" : "test_both",
-          "ip_list" : ["1.2.3.4"]
+          "ip_list" : ["1.2.3.4", "10.0.0.0/8"]
+        },
+        {
+          "ip_tag_name" : "test_ipv6",
+          "ip_list" : ["2001:abcd:ef01:2345::/64"]
+        },
+        {
+          "ip_tag_name" : "test_nested",
+          "ip_list" : ["10.1.0.0/16"]
         }
       ]
     }
@@ -55,13 +65,23 @@ public:
 
   void SetUpTest(const std::string json) {
     Json::ObjectSharedPtr config = Json::Factory::loadFromString(json);
-    config_.reset(new IpTaggingFilterConfig(*config));
+    config_.reset(new IpTaggingFilterConfig(*config, "prefix.", stats_));
     filter_.reset(new IpTaggingFilter(config_));
     filter_->setDecoderFilterCallbacks(filter_callbacks_);
   }
 
-  ~IpTaggingFilterTest() { filter_->onDestroy(); }
+  void setRemoteAddress(const std::string& address) {
+    filter_callbacks_.request_info_.downstream_remote_address_ =
+        Network::Utility::parseInternetAddress(address);
+  }
+
+  ~IpTaggingFilterTest() {
+    if (filter_) {
+      filter_->onDestroy();
+    }
+  }
 
+  Stats::IsolatedStoreImpl stats_;
   IpTaggingFilterConfigSharedPtr config_;
   std::unique_ptr<IpTaggingFilter> filter_;
   NiceMock<MockStreamDecoderFilterCallbacks> filter_callbacks_;
@@ -71,16 +91,41 @@ public:
 
 TEST_F(IpTaggingFilterTest, InternalRequest) {
   SetUpTest(internal_request_json);
+  setRemoteAddress("1.2.3.5");
+
+  // External requests are not looked up.
+  EXPECT_EQ(FilterHeadersStatus::Continue, filter_->decodeHeaders(request_headers_, false));
+  EXPECT_FALSE(request_headers_.has(Headers::get().EnvoyIpTags));
+  EXPECT_EQ(0UL, stats_.counter("prefix.ip_tagging.total").value());
+
+  request_headers_.addCopy(Headers::get().EnvoyInternalRequest, "true");
+  EXPECT_EQ(FilterHeadersStatus::Continue, filter_->decodeHeaders(request_headers_, false));
+  EXPECT_FALSE(request_headers_.has(Headers::get().EnvoyIpTags));
+  EXPECT_EQ(1UL, stats_.counter("prefix.ip_tagging.no_hit").value());
 
+  setRemoteAddress("1.2.3.4");
   EXPECT_EQ(FilterHeadersStatus::Continue, filter_->decodeHeaders(request_headers_, false));
+  EXPECT_EQ("test_internal", request_headers_.get_(Headers::get().EnvoyIpTags));
+  EXPECT_EQ(1UL, stats_.counter("prefix.ip_tagging.test_internal.hit").value());
+  EXPECT_EQ(2UL, stats_.counter("prefix.ip_tagging.total").value());
+
   EXPECT_EQ(FilterDataStatus::Continue, filter_->decodeData(data_, false));
   EXPECT_EQ(FilterTrailersStatus::Continue, filter_->decodeTrailers(request_headers_));
 }
 
 TEST_F(IpTaggingFilterTest, ExternalRequest) {
   SetUpTest(external_request_json);
+  setRemoteAddress("1.2.3.4");
 
   EXPECT_EQ(FilterHeadersStatus::Continue, filter_->decodeHeaders(request_headers_, false));
+  EXPECT_EQ("test_external", request_headers_.get_(Headers::get().EnvoyIpTags));
+
+  // Internal requests are not looked up.
+  TestHeaderMapImpl internal_headers{{"x-envoy-internal", "true"}};
+  EXPECT_EQ(FilterHeadersStatus::Continue, filter_->decodeHeaders(internal_headers, false));
+  EXPECT_FALSE(internal_headers.has(Headers::get().EnvoyIpTags));
+  EXPECT_EQ(1UL, stats_.counter("prefix.ip_tagging.total").value());
+
   EXPECT_EQ(FilterDataStatus::Continue, filter_->decodeData(data_, false));
   EXPECT_EQ(FilterTrailersStatus::Continue, filter_->decodeTrailers(request_headers_));
 }
@@ -88,10 +133,49 @@ TEST_F(IpTaggingFilterTest, ExternalRequest) {
 TEST_F(IpTaggingFilterTest, BothRequest) {
   SetUpTest(both_request_json);
 
+  setRemoteAddress("10.1.2.3");
   EXPECT_EQ(FilterHeadersStatus::Continue, filter_->decodeHeaders(request_headers_, false));
+  EXPECT_EQ("test_both,test_nested", request_headers_.get_(Headers::get().EnvoyIpTags));
+
+  TestHeaderMapImpl internal_headers{{"x-envoy-internal", "true"}};
+  setRemoteAddress("2001:abcd:ef01:2345::1");
+  EXPECT_EQ(FilterHeadersStatus::Continue, filter_->decodeHeaders(internal_headers, false));
+  EXPECT_EQ("test_ipv6", internal_headers.get_(Headers::get().EnvoyIpTags));
+
+  EXPECT_EQ(1UL, stats_.counter("prefix.ip_tagging.test_both.hit").value());
+  EXPECT_EQ(1UL, stats_.counter("prefix.ip_tagging.test_nested.hit").value());
+  EXPECT_EQ(1UL, stats_.counter("prefix.ip_tagging.test_ipv6.hit").value());
+  EXPECT_EQ(2UL, stats_.counter("prefix.ip_tagging.total").value());
+
   EXPECT_EQ(FilterDataStatus::Continue, filter_->decodeData(data_, false));
   EXPECT_EQ(FilterTrailersStatus::Continue, filter_->decodeTrailers(request_headers_));
 }
 
+TEST_F(IpTaggingFilterTest, AppendToExistingTags) {
+  SetUpTest(both_request_json);
+  setRemoteAddress("1.2.3.4");
+
+  TestHeaderMapImpl request_headers{{"x-envoy-ip-tags", "earlier_tag"}};
+  EXPECT_EQ(FilterHeadersStatus::Continue, filter_->decodeHeaders(request_headers, false));
+  EXPECT_EQ("earlier_tag,test_both", request_headers.get_(Headers::get().EnvoyIpTags));
+}
+
+TEST_F(IpTaggingFilterTest, InvalidRange) {
+  const std::string json = R"EOF(
+    {
+      "ip_tags" : [
+        {
+          "ip_tag_name" : "test",
+          "ip_list" : ["10.0.0.0/33"]
+        }
+      ]
+    }
+  )EOF";
+
+  Json::ObjectSharedPtr config = Json::Factory::loadFromString(json);
+  EXPECT_THROW_WITH_MESSAGE(IpTaggingFilterConfig(*config, "prefix.", stats_), EnvoyException,
+                            "invalid ip/mask combo '10.0.0.0/33' (format is <ip>/<# mask bits>)");
+}
+
 } // namespace Http
 } // namespace Envoy
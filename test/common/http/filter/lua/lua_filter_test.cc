@@ -1,8 +1,10 @@
 #include "common/buffer/buffer_impl.h"
 #include "common/http/filter/lua/lua_filter.h"
 #include "common/http/message_impl.h"
+#include "common/stats/stats_impl.h"
 
 #include "test/mocks/http/mocks.h"
+#include "test/mocks/runtime/mocks.h"
 #include "test/mocks/thread_local/mocks.h"
 #include "test/mocks/upstream/mocks.h"
 #include "test/test_common/printers.h"
@@ -11,8 +13,10 @@
 #include "gmock/gmock.h"
 
 using testing::AtLeast;
+using testing::HasSubstr;
 using testing::InSequence;
 using testing::Invoke;
+using testing::NiceMock;
 using testing::Return;
 using testing::StrEq;
 using testing::_;
@@ -59,7 +63,8 @@ public:
   ~LuaHttpFilterTest() { filter_->onDestroy(); }
 
   void setup(const std::string& lua_code) {
-    config_.reset(new FilterConfig(lua_code, tls_, cluster_manager_));
+    config_.reset(
+        new FilterConfig(lua_code, tls_, cluster_manager_, runtime_, stats_store_, "test."));
     filter_.reset(new TestFilter(config_));
     filter_->setDecoderFilterCallbacks(decoder_callbacks_);
     filter_->setEncoderFilterCallbacks(encoder_callbacks_);
@@ -67,6 +72,8 @@ public:
 
   NiceMock<ThreadLocal::MockInstance> tls_;
   Upstream::MockClusterManager cluster_manager_;
+  NiceMock<Runtime::MockLoader> runtime_;
+  Stats::IsolatedStoreImpl stats_store_;
   std::shared_ptr<FilterConfig> config_;
   std::unique_ptr<TestFilter> filter_;
   MockStreamDecoderFilterCallbacks decoder_callbacks_;
@@ -158,7 +165,10 @@ TEST(LuaHttpFilterConfigTest, BadCode) {
 
   NiceMock<ThreadLocal::MockInstance> tls;
   NiceMock<Upstream::MockClusterManager> cluster_manager;
-  EXPECT_THROW_WITH_MESSAGE(FilterConfig(SCRIPT, tls, cluster_manager), Envoy::Lua::LuaException,
+  NiceMock<Runtime::MockLoader> runtime;
+  Stats::IsolatedStoreImpl stats_store;
+  EXPECT_THROW_WITH_MESSAGE(FilterConfig(SCRIPT, tls, cluster_manager, runtime, stats_store, ""),
+                            Envoy::Lua::LuaException,
                             "script load error: [string \"...\"]:3: '=' expected near '<eof>'");
 }
 
@@ -519,6 +529,43 @@ TEST_F(LuaHttpFilterTest, ScriptErrorHeadersRequestBodyTrailers) {
   EXPECT_EQ(FilterTrailersStatus::Continue, filter_->decodeTrailers(request_trailers));
 }
 
+// Script that runs past its instruction budget, even while catching errors.
+TEST_F(LuaHttpFilterTest, InstructionBudgetExceeded) {
+  const std::string SCRIPT{R"EOF(
+    function envoy_on_request(request_handle)
+      while true do
+        pcall(function() while true do end end)
+      end
+    end
+  )EOF"};
+
+  InSequence s;
+  setup(SCRIPT);
+  ON_CALL(runtime_.snapshot_, getInteger("lua.instruction_budget", 0))
+      .WillByDefault(Return(100000));
+
+  TestHeaderMapImpl request_headers{{":path", "/"}};
+  EXPECT_CALL(*filter_, scriptLog(spdlog::level::err,
+                                  HasSubstr("script exceeded its budget of 100000 instructions")));
+  EXPECT_EQ(FilterHeadersStatus::Continue, filter_->decodeHeaders(request_headers, true));
+  EXPECT_EQ(1U, stats_store_.counter("test.lua.errors").value());
+  EXPECT_EQ(1U, stats_store_.counter("test.lua.instruction_budget_exceeded").value());
+}
+
+// A script within its instruction budget runs as usual.
+TEST_F(LuaHttpFilterTest, InstructionBudget) {
+  InSequence s;
+  setup(HEADER_ONLY_SCRIPT);
+  ON_CALL(runtime_.snapshot_, getInteger("lua.instruction_budget", 0))
+      .WillByDefault(Return(100000));
+
+  TestHeaderMapImpl request_headers{{":path", "/"}};
+  EXPECT_CALL(*filter_, scriptLog(spdlog::level::trace, StrEq("/")));
+  EXPECT_EQ(FilterHeadersStatus::Continue, filter_->decodeHeaders(request_headers, true));
+  EXPECT_EQ(0U, stats_store_.counter("test.lua.errors").value());
+  EXPECT_EQ(0U, stats_store_.counter("test.lua.instruction_budget_exceeded").value());
+}
+
 // Script that tries to store a local variable to a global and then use it.
 TEST_F(LuaHttpFilterTest, ThreadEnvironments) {
   const std::string SCRIPT{R"EOF(
@@ -659,6 +706,56 @@ TEST_F(LuaHttpFilterTest, RequestAndResponse) {
   EXPECT_EQ(FilterTrailersStatus::Continue, filter_->encodeTrailers(response_trailers));
 }
 
+// The headers wrapper is the same object across yields.
+TEST_F(LuaHttpFilterTest, HeadersAcrossYield) {
+  const std::string SCRIPT{R"EOF(
+    function envoy_on_request(request_handle)
+      local headers = request_handle:headers()
+      request_handle:body()
+      if rawequal(headers, request_handle:headers()) then
+        request_handle:logTrace("same headers")
+      end
+      headers:replace("foo", "bar")
+    end
+  )EOF"};
+
+  InSequence s;
+  setup(SCRIPT);
+
+  TestHeaderMapImpl request_headers{{":path", "/"}, {"foo", "baz"}};
+  EXPECT_EQ(FilterHeadersStatus::StopIteration, filter_->decodeHeaders(request_headers, false));
+
+  Buffer::OwnedImpl data("hello");
+  EXPECT_CALL(*filter_, scriptLog(spdlog::level::trace, StrEq("same headers")));
+  EXPECT_CALL(decoder_callbacks_, clearRouteCache());
+  EXPECT_EQ(FilterDataStatus::Continue, filter_->decodeData(data, true));
+  EXPECT_EQ("bar", request_headers.get_("foo"));
+}
+
+// A later stream reuses the coroutine of a finished stream.
+TEST_F(LuaHttpFilterTest, CoroutineReuse) {
+  const std::string SCRIPT{R"EOF(
+    function envoy_on_request(request_handle)
+      if last_coroutine == coroutine.running() then
+        request_handle:logTrace("reused")
+      end
+      last_coroutine = coroutine.running()
+    end
+  )EOF"};
+
+  InSequence s;
+  setup(SCRIPT);
+
+  TestHeaderMapImpl request_headers{{":path", "/"}};
+  EXPECT_EQ(FilterHeadersStatus::Continue, filter_->decodeHeaders(request_headers, true));
+  filter_->onDestroy();
+
+  TestFilter filter2(config_);
+  EXPECT_CALL(filter2, scriptLog(spdlog::level::trace, StrEq("reused")));
+  EXPECT_EQ(FilterHeadersStatus::Continue, filter2.decodeHeaders(request_headers, true));
+  filter2.onDestroy();
+}
+
 // Response blocking body.
 TEST_F(LuaHttpFilterTest, ResponseBlockingBody) {
   const std::string SCRIPT{R"EOF(
@@ -53,6 +53,29 @@ TEST_F(LuaHeaderMapWrapperTest, Methods) {
   start("callMe");
 }
 
+// Replace header values.
+TEST_F(LuaHeaderMapWrapperTest, Replace) {
+  const std::string SCRIPT{R"EOF(
+    function callMe(object)
+      object:replace("FOO", "baz")
+      object:replace("hello", "world")
+      for key, value in pairs(object) do
+        testPrint(string.format("'%s' '%s'", key, value))
+      end
+    end
+  )EOF"};
+
+  InSequence s;
+  setup(SCRIPT);
+
+  TestHeaderMapImpl headers{{"foo", "bar"}, {"foo", "qux"}, {"other", "value"}};
+  HeaderMapWrapper::create(coroutine_->luaState(), headers, []() { return true; });
+  EXPECT_CALL(*this, testPrint("'other' 'value'"));
+  EXPECT_CALL(*this, testPrint("'foo' 'baz'"));
+  EXPECT_CALL(*this, testPrint("'hello' 'world'"));
+  start("callMe");
+}
+
 // Test modifiable methods.
 TEST_F(LuaHeaderMapWrapperTest, ModifiableMethods) {
   const std::string SCRIPT{R"EOF(
@@ -69,6 +92,10 @@ TEST_F(LuaHeaderMapWrapperTest, ModifiableMethods) {
     function shouldFailAdd(object)
       object:add("foo")
     end
+
+    function shouldFailReplace(object)
+      object:replace("foo", "bar")
+    end
   )EOF"};
 
   InSequence s;
@@ -87,6 +114,11 @@ TEST_F(LuaHeaderMapWrapperTest, ModifiableMethods) {
   HeaderMapWrapper::create(coroutine_->luaState(), headers, []() { return false; });
   EXPECT_THROW_WITH_MESSAGE(start("shouldFailAdd"), Envoy::Lua::LuaException,
                             "[string \"...\"]:13: header map can no longer be modified");
+
+  setup(SCRIPT);
+  HeaderMapWrapper::create(coroutine_->luaState(), headers, []() { return false; });
+  EXPECT_THROW_WITH_MESSAGE(start("shouldFailReplace"), Envoy::Lua::LuaException,
+                            "[string \"...\"]:17: header map can no longer be modified");
 }
 
 // Modify during iteration.
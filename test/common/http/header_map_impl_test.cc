@@ -5,6 +5,7 @@
 #include "test/test_common/printers.h"
 #include "test/test_common/utility.h"
 
+#include "fmt/format.h"
 #include "gtest/gtest.h"
 
 namespace Envoy {
@@ -259,6 +260,58 @@ TEST(HeaderStringTest, All) {
     EXPECT_EQ(HeaderString::Type::Reference, string.type());
   }
 
+  // Pinned is not copied, until it is modified.
+  {
+    const std::string pinned("hello");
+    HeaderString string;
+    string.setPinned(pinned.c_str(), pinned.size());
+    EXPECT_EQ(HeaderString::Type::Pinned, string.type());
+    EXPECT_EQ(pinned.c_str(), string.c_str());
+
+    HeaderString moved(std::move(string));
+    EXPECT_EQ(HeaderString::Type::Pinned, moved.type());
+    EXPECT_EQ(pinned.c_str(), moved.c_str());
+
+    moved.append(" world", 6);
+    EXPECT_EQ(HeaderString::Type::Inline, moved.type());
+    EXPECT_STREQ("hello world", moved.c_str());
+    EXPECT_EQ("hello", pinned);
+  }
+
+  // Pinned to buffer() copies, to dynamic storage if needed.
+  {
+    const std::string pinned(4096, 'A');
+    HeaderString string;
+    string.setPinned(pinned.c_str(), pinned.size());
+    char* buffer = string.buffer();
+    EXPECT_EQ(HeaderString::Type::Dynamic, string.type());
+    EXPECT_NE(pinned.c_str(), string.c_str());
+    buffer[0] = 'a';
+    EXPECT_EQ('a', string.c_str()[0]);
+    EXPECT_EQ(4096U, string.size());
+    EXPECT_EQ('A', pinned[0]);
+  }
+
+  // Pinned clear() and set.
+  {
+    const std::string pinned("hello");
+    HeaderString string;
+    string.setPinned(pinned.c_str(), pinned.size());
+    string.clear();
+    EXPECT_EQ(HeaderString::Type::Inline, string.type());
+    EXPECT_TRUE(string.empty());
+
+    string.setPinned(pinned.c_str(), pinned.size());
+    string.setInteger(5);
+    EXPECT_EQ(HeaderString::Type::Inline, string.type());
+    EXPECT_STREQ("5", string.c_str());
+
+    string.setPinned(pinned.c_str(), pinned.size());
+    string.setCopy("world", 5);
+    EXPECT_EQ(HeaderString::Type::Inline, string.type());
+    EXPECT_STREQ("world", string.c_str());
+  }
+
   // caseInsensitiveContains
   {
     const std::string static_string("keep-alive, Upgrade, close");
@@ -571,5 +624,139 @@ TEST(HeaderMapImplTest, Lookup) {
     EXPECT_EQ(nullptr, entry);
   }
 }
+
+TEST(HeaderMapImplTest, StaticLookup) {
+  TestHeaderMapImpl headers;
+  const HeaderEntry* entry;
+
+  // Every inline header is found by its key, and the legacy host header maps to :authority.
+#define CHECK_INLINE_HEADER_LOOKUP(name)                                                           \
+  EXPECT_NE(HeaderMap::Lookup::NotSupported, headers.lookup(Headers::get().name, &entry));
+  ALL_INLINE_HEADERS(CHECK_INLINE_HEADER_LOOKUP)
+#undef CHECK_INLINE_HEADER_LOOKUP
+  headers.addCopy("host", "example.com");
+  EXPECT_STREQ("example.com", headers.Host()->value().c_str());
+
+  // Keys that only differ from an inline header in length or in a single character are not.
+  for (const char* key : {"", ":pat", ":paths", ":patx", "xath", "x-envoy-upstream-rq",
+                          "x-envoy-upstream-rq-timeout-msx", "content-lengtx"}) {
+    EXPECT_EQ(HeaderMap::Lookup::NotSupported, headers.lookup(LowerCaseString(key), &entry)) << key;
+  }
+}
+
+// Exercise the entry storage past its inline capacity, with slots being freed and reused, and check
+// that the inline header pointers stay valid throughout.
+TEST(HeaderMapImplTest, ManyHeaders) {
+  TestHeaderMapImpl headers;
+  headers.insertHost().value(std::string("host"));
+  for (size_t i = 0; i < 100; i++) {
+    headers.addCopy(fmt::format("header{}", i), fmt::format("{}", i));
+  }
+  headers.insertPath().value(std::string("/"));
+  EXPECT_EQ(102UL, headers.size());
+  EXPECT_STREQ("host", headers.Host()->value().c_str());
+  EXPECT_STREQ("/", headers.Path()->value().c_str());
+
+  for (size_t i = 0; i < 100; i += 2) {
+    headers.remove(LowerCaseString(fmt::format("header{}", i)));
+  }
+  headers.removeHost();
+  EXPECT_EQ(51UL, headers.size());
+  for (size_t i = 100; i < 150; i++) {
+    headers.addCopy(fmt::format("header{}", i), fmt::format("{}", i));
+  }
+  EXPECT_EQ(101UL, headers.size());
+  EXPECT_STREQ("/", headers.Path()->value().c_str());
+
+  std::vector<std::string> keys;
+  headers.iterate(
+      [](const HeaderEntry& header, void* context) -> HeaderMap::Iterate {
+        static_cast<std::vector<std::string>*>(context)->push_back(header.key().c_str());
+        return HeaderMap::Iterate::Continue;
+      },
+      &keys);
+  std::vector<std::string> expected;
+  for (size_t i = 1; i < 100; i += 2) {
+    expected.push_back(fmt::format("header{}", i));
+  }
+  expected.push_back(":path");
+  for (size_t i = 100; i < 150; i++) {
+    expected.push_back(fmt::format("header{}", i));
+  }
+  EXPECT_EQ(expected, keys);
+}
+
+TEST(HeaderMapImplTest, Move) {
+  TestHeaderMapImpl headers{{":path", "/"}, {"hello", "world"}};
+  TestHeaderMapImpl moved(std::move(headers));
+  EXPECT_EQ(0UL, headers.size());
+  EXPECT_EQ(nullptr, headers.Path());
+  EXPECT_EQ((TestHeaderMapImpl{{":path", "/"}, {"hello", "world"}}), moved);
+  EXPECT_STREQ("/", moved.Path()->value().c_str());
+
+  TestHeaderMapImpl assigned{{":method", "GET"}};
+  assigned = std::move(moved);
+  EXPECT_EQ((TestHeaderMapImpl{{":path", "/"}, {"hello", "world"}}), assigned);
+  EXPECT_EQ(nullptr, assigned.Method());
+  EXPECT_STREQ("/", assigned.Path()->value().c_str());
+  EXPECT_EQ(0UL, moved.size());
+}
+
+TEST(HeaderMapImplTest, ByteSize) {
+  HeaderMapImpl headers;
+  EXPECT_EQ(0UL, headers.byteSize());
+
+  headers.addCopy(LowerCaseString("hello"), "world");
+  headers.addReference(Headers::get().Path, "/");
+  EXPECT_EQ(16UL, headers.byteSize());
+
+  // A second inline header with the same key is dropped, so it is not counted.
+  headers.addReference(Headers::get().Path, "/dropped");
+  EXPECT_EQ(16UL, headers.byteSize());
+
+  headers.insertHost().value(std::string("host"));
+  EXPECT_EQ(30UL, headers.byteSize());
+
+  headers.Host()->value().setCopy("a", 1);
+  EXPECT_EQ(27UL, headers.byteSize());
+
+  headers.remove(LowerCaseString("hello"));
+  EXPECT_EQ(17UL, headers.byteSize());
+  headers.removePath();
+  EXPECT_EQ(11UL, headers.byteSize());
+
+  HeaderMapImpl moved(std::move(headers));
+  EXPECT_EQ(11UL, moved.byteSize());
+  EXPECT_EQ(0UL, headers.byteSize());
+
+  HeaderMapImpl copied(static_cast<const HeaderMap&>(moved));
+  EXPECT_EQ(11UL, copied.byteSize());
+}
+
+TEST(HeaderMapImplTest, PinnedStorage) {
+  std::shared_ptr<std::string> storage = std::make_shared<std::string>(1024, 'a');
+  std::weak_ptr<std::string> weak_storage = storage;
+
+  HeaderMapImpl moved;
+  {
+    HeaderMapImpl headers;
+    HeaderString key;
+    key.setCopy("cookie", 6);
+    HeaderString value;
+    value.setPinned(storage->c_str(), storage->size());
+    headers.addViaMove(std::move(key), std::move(value));
+    headers.addPinnedStorage(std::move(storage));
+
+    moved = std::move(headers);
+  }
+
+  EXPECT_FALSE(weak_storage.expired());
+  EXPECT_EQ(HeaderString::Type::Pinned, moved.get(LowerCaseString("cookie"))->value().type());
+  EXPECT_EQ(weak_storage.lock()->c_str(), moved.get(LowerCaseString("cookie"))->value().c_str());
+
+  moved = HeaderMapImpl();
+  EXPECT_TRUE(weak_storage.expired());
+}
+
 } // namespace Http
 } // namespace Envoy
@@ -1,4 +1,5 @@
 #include <string>
+#include <vector>
 
 #include "envoy/buffer/buffer.h"
 #include "envoy/event/dispatcher.h"
@@ -9,10 +10,12 @@
 #include "common/http/http1/codec_impl.h"
 
 #include "test/mocks/buffer/mocks.h"
+#include "test/mocks/event/mocks.h"
 #include "test/mocks/http/mocks.h"
 #include "test/mocks/network/mocks.h"
 #include "test/test_common/printers.h"
 
+#include "fmt/format.h"
 #include "gmock/gmock.h"
 #include "gtest/gtest.h"
 
@@ -347,6 +350,62 @@ TEST_F(Http1ServerConnectionImplTest, HeaderOnlyResponse) {
   EXPECT_EQ("HTTP/1.1 200 OK\r\ncontent-length: 0\r\n\r\n", output);
 }
 
+TEST_F(Http1ServerConnectionImplTest, CachedHeaderLines) {
+  initialize();
+
+  NiceMock<Http::MockStreamDecoder> decoder;
+  Http::StreamEncoder* response_encoder = nullptr;
+  EXPECT_CALL(callbacks_, newStream(_))
+      .Times(3)
+      .WillRepeatedly(Invoke([&](Http::StreamEncoder& encoder) -> Http::StreamDecoder& {
+        response_encoder = &encoder;
+        return decoder;
+      }));
+
+  std::string output;
+  ON_CALL(connection_, write(_)).WillByDefault(AddBufferToString(&output));
+
+  // The second response reuses both cached lines, the third one has a new date.
+  for (const char* date : {"Mon, 01 Jan 2018 00:00:00 GMT", "Mon, 01 Jan 2018 00:00:00 GMT",
+                           "Mon, 01 Jan 2018 00:00:01 GMT"}) {
+    Buffer::OwnedImpl buffer("GET / HTTP/1.1\r\n\r\n");
+    codec_->dispatch(buffer);
+    EXPECT_EQ(0U, buffer.length());
+
+    output.clear();
+    TestHeaderMapImpl headers{{":status", "404"}};
+    headers.insertDate().value(std::string(date));
+    headers.insertServer().value(std::string("envoy"));
+    response_encoder->encodeHeaders(headers, true);
+    EXPECT_EQ(fmt::format("HTTP/1.1 404 Not Found\r\ndate: {}\r\nserver: envoy\r\n"
+                          "content-length: 0\r\n\r\n",
+                          date),
+              output);
+  }
+}
+
+TEST_F(Http1ServerConnectionImplTest, UnknownStatusResponse) {
+  initialize();
+
+  NiceMock<Http::MockStreamDecoder> decoder;
+  Http::StreamEncoder* response_encoder = nullptr;
+  EXPECT_CALL(callbacks_, newStream(_))
+      .WillOnce(Invoke([&](Http::StreamEncoder& encoder) -> Http::StreamDecoder& {
+        response_encoder = &encoder;
+        return decoder;
+      }));
+
+  Buffer::OwnedImpl buffer("GET / HTTP/1.1\r\n\r\n");
+  codec_->dispatch(buffer);
+
+  std::string output;
+  ON_CALL(connection_, write(_)).WillByDefault(AddBufferToString(&output));
+
+  TestHeaderMapImpl headers{{":status", "999"}};
+  response_encoder->encodeHeaders(headers, true);
+  EXPECT_EQ("HTTP/1.1 999 Unknown\r\ncontent-length: 0\r\n\r\n", output);
+}
+
 TEST_F(Http1ServerConnectionImplTest, ChunkedResponse) {
   initialize();
 
@@ -374,6 +433,60 @@ TEST_F(Http1ServerConnectionImplTest, ChunkedResponse) {
             output);
 }
 
+TEST_F(Http1ServerConnectionImplTest, ChunkCoalescing) {
+  codec_settings_.chunk_coalesce_bytes_ = 16;
+  codec_settings_.chunk_coalesce_delay_ = std::chrono::milliseconds(5);
+  initialize();
+
+  NiceMock<Http::MockStreamDecoder> decoder;
+  Http::StreamEncoder* response_encoder = nullptr;
+  EXPECT_CALL(callbacks_, newStream(_))
+      .WillOnce(Invoke([&](Http::StreamEncoder& encoder) -> Http::StreamDecoder& {
+        response_encoder = &encoder;
+        return decoder;
+      }));
+
+  Buffer::OwnedImpl buffer("GET / HTTP/1.1\r\n\r\n");
+  codec_->dispatch(buffer);
+
+  std::string output;
+  ON_CALL(connection_, write(_)).WillByDefault(AddBufferToString(&output));
+
+  TestHeaderMapImpl headers{{":status", "200"}};
+  response_encoder->encodeHeaders(headers, false);
+  output.clear();
+
+  // Small writes wait for the coalescing delay, which only the first of them starts.
+  Event::MockTimer* timer = new Event::MockTimer(&connection_.dispatcher_);
+  EXPECT_CALL(*timer, enableTimer(std::chrono::milliseconds(5)));
+  EXPECT_CALL(*timer, disableTimer()).Times(3);
+  Buffer::OwnedImpl hello("Hello");
+  response_encoder->encodeData(hello, false);
+  Buffer::OwnedImpl world(" World");
+  response_encoder->encodeData(world, false);
+  EXPECT_EQ("", output);
+
+  timer->callback_();
+  EXPECT_EQ("b\r\nHello World\r\n", output);
+  output.clear();
+
+  // Data that reaches the coalescing size is encoded right away, along with what is pending.
+  EXPECT_CALL(*timer, enableTimer(_));
+  Buffer::OwnedImpl small("a");
+  response_encoder->encodeData(small, false);
+  Buffer::OwnedImpl large("0123456789abcdef");
+  response_encoder->encodeData(large, false);
+  EXPECT_EQ("11\r\na0123456789abcdef\r\n", output);
+  output.clear();
+
+  // The end of the stream encodes pending data without waiting.
+  EXPECT_CALL(*timer, enableTimer(_));
+  Buffer::OwnedImpl last("z");
+  response_encoder->encodeData(last, false);
+  response_encoder->encodeTrailers(TestHeaderMapImpl{});
+  EXPECT_EQ("1\r\nz\r\n0\r\n\r\n", output);
+}
+
 TEST_F(Http1ServerConnectionImplTest, ContentLengthResponse) {
   initialize();
 
@@ -473,6 +586,42 @@ TEST_F(Http1ServerConnectionImplTest, DoubleRequest) {
   EXPECT_EQ(0U, buffer.length());
 }
 
+// A request that is dispatched before the previous response is complete has its response
+// held until the previous one is written out.
+TEST_F(Http1ServerConnectionImplTest, PipelinedRequests) {
+  initialize();
+
+  NiceMock<Http::MockStreamDecoder> decoder;
+  std::vector<Http::StreamEncoder*> response_encoders;
+  EXPECT_CALL(callbacks_, newStream(_))
+      .Times(2)
+      .WillRepeatedly(Invoke([&](Http::StreamEncoder& encoder) -> Http::StreamDecoder& {
+        response_encoders.push_back(&encoder);
+        return decoder;
+      }));
+
+  std::string request("GET / HTTP/1.1\r\n\r\n");
+  Buffer::OwnedImpl buffer(request);
+  buffer.add(request);
+
+  codec_->dispatch(buffer);
+  EXPECT_EQ(request.size(), buffer.length());
+  codec_->dispatch(buffer);
+  EXPECT_EQ(0U, buffer.length());
+  ASSERT_EQ(2U, response_encoders.size());
+
+  std::string output;
+  ON_CALL(connection_, write(_)).WillByDefault(AddBufferToString(&output));
+
+  response_encoders[1]->encodeHeaders(TestHeaderMapImpl{{":status", "404"}}, true);
+  EXPECT_EQ("", output);
+
+  response_encoders[0]->encodeHeaders(TestHeaderMapImpl{{":status", "200"}}, true);
+  EXPECT_EQ("HTTP/1.1 200 OK\r\ncontent-length: 0\r\n\r\n"
+            "HTTP/1.1 404 Not Found\r\ncontent-length: 0\r\n\r\n",
+            output);
+}
+
 TEST_F(Http1ServerConnectionImplTest, RequestWithTrailers) {
   initialize();
 
@@ -490,6 +639,129 @@ TEST_F(Http1ServerConnectionImplTest, RequestWithTrailers) {
   EXPECT_EQ(0U, buffer.length());
 }
 
+TEST_F(Http1ServerConnectionImplTest, FastRequestParserSimpleGet) {
+  codec_settings_.fast_request_parser_ = true;
+  initialize();
+
+  InSequence sequence;
+
+  Http::MockStreamDecoder decoder;
+  EXPECT_CALL(callbacks_, newStream(_)).WillOnce(ReturnRef(decoder));
+
+  TestHeaderMapImpl expected_headers{
+      {":authority", "host"}, {"x-foo", "a\tb"}, {":path", "/a?b=c"}, {":method", "GET"}};
+  EXPECT_CALL(decoder, decodeHeaders_(HeaderMapEqual(&expected_headers), true)).Times(1);
+
+  Buffer::OwnedImpl buffer("GET /a?b=c HTTP/1.1\r\nHost: host\r\nX-Foo:  a\tb\r\n\r\n");
+  codec_->dispatch(buffer);
+  EXPECT_EQ(0U, buffer.length());
+  EXPECT_EQ(Protocol::Http11, codec_->protocol());
+}
+
+TEST_F(Http1ServerConnectionImplTest, FastRequestParserDoubleRequest) {
+  codec_settings_.fast_request_parser_ = true;
+  initialize();
+
+  NiceMock<Http::MockStreamDecoder> decoder;
+  Http::StreamEncoder* response_encoder = nullptr;
+  EXPECT_CALL(callbacks_, newStream(_))
+      .Times(2)
+      .WillRepeatedly(Invoke([&](Http::StreamEncoder& encoder) -> Http::StreamDecoder& {
+        response_encoder = &encoder;
+        return decoder;
+      }));
+
+  std::string request("GET / HTTP/1.1\r\nhost: host\r\n\r\n");
+  Buffer::OwnedImpl buffer(request);
+  buffer.add(request);
+
+  codec_->dispatch(buffer);
+  EXPECT_EQ(request.size(), buffer.length());
+
+  response_encoder->encodeHeaders(TestHeaderMapImpl{{":status", "200"}}, true);
+
+  codec_->dispatch(buffer);
+  EXPECT_EQ(0U, buffer.length());
+}
+
+// Requests with a body go through http_parser, as do the requests that follow them.
+TEST_F(Http1ServerConnectionImplTest, FastRequestParserFallback) {
+  codec_settings_.fast_request_parser_ = true;
+  initialize();
+
+  InSequence sequence;
+
+  Http::MockStreamDecoder decoder;
+  EXPECT_CALL(callbacks_, newStream(_)).WillOnce(ReturnRef(decoder));
+
+  TestHeaderMapImpl expected_headers{{"content-length", "5"}, {":path", "/"}, {":method", "POST"}};
+  EXPECT_CALL(decoder, decodeHeaders_(HeaderMapEqual(&expected_headers), false)).Times(1);
+
+  Buffer::OwnedImpl expected_data1("12345");
+  EXPECT_CALL(decoder, decodeData(BufferEqual(&expected_data1), false)).Times(1);
+
+  Buffer::OwnedImpl expected_data2;
+  EXPECT_CALL(decoder, decodeData(BufferEqual(&expected_data2), true)).Times(1);
+
+  Buffer::OwnedImpl buffer("POST / HTTP/1.1\r\ncontent-length: 5\r\n\r\n12345");
+  codec_->dispatch(buffer);
+  EXPECT_EQ(0U, buffer.length());
+}
+
+// A head that is split across reads is left to http_parser.
+TEST_F(Http1ServerConnectionImplTest, FastRequestParserPartialHead) {
+  codec_settings_.fast_request_parser_ = true;
+  initialize();
+
+  InSequence sequence;
+
+  Http::MockStreamDecoder decoder;
+  EXPECT_CALL(callbacks_, newStream(_)).WillOnce(ReturnRef(decoder));
+
+  TestHeaderMapImpl expected_headers{{":authority", "host"}, {":path", "/"}, {":method", "GET"}};
+  EXPECT_CALL(decoder, decodeHeaders_(HeaderMapEqual(&expected_headers), true)).Times(1);
+
+  Buffer::OwnedImpl buffer("GET / HTTP/1.1\r\nhost: ho");
+  codec_->dispatch(buffer);
+  EXPECT_EQ(0U, buffer.length());
+
+  buffer.add("st\r\n\r\n");
+  codec_->dispatch(buffer);
+  EXPECT_EQ(0U, buffer.length());
+}
+
+// Large header values reference the read buffer, which stays allocated until the headers are gone.
+TEST_F(Http1ServerConnectionImplTest, FastRequestParserPinnedValue) {
+  codec_settings_.fast_request_parser_ = true;
+  initialize();
+
+  InSequence sequence;
+
+  Http::MockStreamDecoder decoder;
+  EXPECT_CALL(callbacks_, newStream(_)).WillOnce(ReturnRef(decoder));
+
+  const std::string cookie(2048, 'c');
+  HeaderMapPtr headers;
+  EXPECT_CALL(decoder, decodeHeaders_(_, true))
+      .WillOnce(Invoke([&](HeaderMapPtr& decoded_headers, bool) -> void {
+        headers = std::move(decoded_headers);
+      }));
+
+  {
+    Buffer::OwnedImpl buffer("GET / HTTP/1.1\r\nhost: host\r\ncookie: " + cookie + "\r\n\r\n");
+    codec_->dispatch(buffer);
+    EXPECT_EQ(0U, buffer.length());
+  }
+
+  ASSERT_NE(nullptr, headers);
+  const HeaderEntry* entry = headers->get(LowerCaseString("cookie"));
+  ASSERT_NE(nullptr, entry);
+  EXPECT_EQ(HeaderString::Type::Pinned, entry->value().type());
+  EXPECT_EQ(cookie, entry->value().c_str());
+  EXPECT_EQ(HeaderString::Type::Inline, headers->Host()->value().type());
+  EXPECT_STREQ("host", headers->Host()->value().c_str());
+}
+
 TEST_F(Http1ServerConnectionImplTest, WatermarkTest) {
   EXPECT_CALL(connection_, bufferLimit()).Times(1).WillOnce(Return(10));
   initialize();
@@ -526,10 +798,13 @@ TEST_F(Http1ServerConnectionImplTest, WatermarkTest) {
 
 class Http1ClientConnectionImplTest : public testing::Test {
 public:
-  void initialize() { codec_.reset(new ClientConnectionImpl(connection_, callbacks_)); }
+  void initialize() {
+    codec_.reset(new ClientConnectionImpl(connection_, callbacks_, codec_settings_));
+  }
 
   NiceMock<Network::MockConnection> connection_;
   NiceMock<Http::MockConnectionCallbacks> callbacks_;
+  Http1Settings codec_settings_;
   std::unique_ptr<ClientConnectionImpl> codec_;
 };
 
@@ -547,6 +822,29 @@ TEST_F(Http1ClientConnectionImplTest, SimpleGet) {
   EXPECT_EQ("GET / HTTP/1.1\r\ncontent-length: 0\r\n\r\n", output);
 }
 
+TEST_F(Http1ClientConnectionImplTest, ChunkCoalescing) {
+  codec_settings_.chunk_coalesce_bytes_ = 16;
+  initialize();
+
+  Http::MockStreamDecoder response_decoder;
+  Http::StreamEncoder& request_encoder = codec_->newStream(response_decoder);
+
+  std::string output;
+  ON_CALL(connection_, write(_)).WillByDefault(AddBufferToString(&output));
+
+  TestHeaderMapImpl headers{{":method", "POST"}, {":path", "/"}};
+  request_encoder.encodeHeaders(headers, false);
+  output.clear();
+
+  Event::MockTimer* timer = new Event::MockTimer(&connection_.dispatcher_);
+  EXPECT_CALL(*timer, enableTimer(std::chrono::milliseconds(0)));
+  Buffer::OwnedImpl hel("Hel");
+  request_encoder.encodeData(hel, false);
+  Buffer::OwnedImpl lo("lo");
+  request_encoder.encodeData(lo, true);
+  EXPECT_EQ("5\r\nHello\r\n0\r\n\r\n", output);
+}
+
 TEST_F(Http1ClientConnectionImplTest, HostHeaderTranslate) {
   initialize();
 
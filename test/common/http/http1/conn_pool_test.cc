@@ -209,6 +209,67 @@ TEST_F(Http1ConnPoolImplTest, DrainConnections) {
   dispatcher_.clearDeferredDeleteList();
 }
 
+/**
+ * Test that a connection is created ahead of each request when prefetching.
+ */
+TEST_F(Http1ConnPoolImplTest, Prefetch) {
+  cluster_->resource_manager_.reset(
+      new Upstream::ResourceManagerImpl(runtime_, "fake_key", 3, 1024, 1024, 1));
+
+  // Without prefetching there is nothing to do.
+  conn_pool_.prefetch();
+
+  // Warming up creates a connection for the first request.
+  cluster_->prefetch_ratio_ = 1;
+  conn_pool_.expectClientCreate();
+  conn_pool_.prefetch();
+  EXPECT_CALL(*conn_pool_.test_clients_[0].connect_timer_, disableTimer());
+  conn_pool_.test_clients_[0].connection_->raiseEvent(Network::ConnectionEvent::Connected);
+  EXPECT_EQ(1U, cluster_->stats_.upstream_cx_prefetch_.value());
+
+  // The request uses it right away, and a connection is prefetched for the next request.
+  conn_pool_.expectClientCreate();
+  ActiveTestRequest r1(*this, 0, ActiveTestRequest::Type::Immediate);
+  EXPECT_EQ(2U, cluster_->stats_.upstream_cx_prefetch_.value());
+  conn_pool_.prefetch();
+  EXPECT_EQ(2U, cluster_->stats_.upstream_cx_prefetch_.value());
+
+  r1.startRequest();
+  r1.completeResponse(false);
+
+  EXPECT_CALL(conn_pool_, onClientDestroy()).Times(2);
+  conn_pool_.test_clients_[0].connection_->raiseEvent(Network::ConnectionEvent::RemoteClose);
+  conn_pool_.test_clients_[1].connection_->raiseEvent(Network::ConnectionEvent::RemoteClose);
+  dispatcher_.clearDeferredDeleteList();
+}
+
+/**
+ * Test that prefetching follows the prefetch ratio within the connection circuit breaker.
+ */
+TEST_F(Http1ConnPoolImplTest, PrefetchRatio) {
+  cluster_->resource_manager_.reset(
+      new Upstream::ResourceManagerImpl(runtime_, "fake_key", 2, 1024, 1024, 1));
+  cluster_->prefetch_ratio_ = 1.5;
+
+  // The request creates a connection on demand, and 2 more are wanted for it and the next request
+  // but only 1 is allowed.
+  NiceMock<Http::MockStreamDecoder> outer_decoder;
+  ConnPoolCallbacks callbacks;
+  {
+    InSequence s;
+    conn_pool_.expectClientCreate();
+    conn_pool_.expectClientCreate();
+  }
+  EXPECT_NE(nullptr, conn_pool_.newStream(outer_decoder, callbacks));
+  EXPECT_EQ(1U, cluster_->stats_.upstream_cx_prefetch_.value());
+
+  EXPECT_CALL(conn_pool_, onClientDestroy()).Times(2);
+  EXPECT_CALL(callbacks.pool_failure_, ready());
+  conn_pool_.test_clients_[0].connection_->raiseEvent(Network::ConnectionEvent::RemoteClose);
+  conn_pool_.test_clients_[1].connection_->raiseEvent(Network::ConnectionEvent::RemoteClose);
+  dispatcher_.clearDeferredDeleteList();
+}
+
 /**
  * Test all timing stats are set.
  */
@@ -217,6 +278,9 @@ TEST_F(Http1ConnPoolImplTest, VerifyTimingStats) {
               deliverHistogramToSinks(Property(&Stats::Metric::name, "upstream_cx_connect_ms"), _));
   EXPECT_CALL(cluster_->stats_store_,
               deliverHistogramToSinks(Property(&Stats::Metric::name, "upstream_cx_length_ms"), _));
+  EXPECT_CALL(cluster_->stats_store_,
+              deliverHistogramToSinks(
+                  Property(&Stats::Metric::name, "upstream_rq_pending_default_ms"), _));
 
   ActiveTestRequest r1(*this, 0, ActiveTestRequest::Type::CreateConnection);
   r1.startRequest();
@@ -268,6 +332,58 @@ TEST_F(Http1ConnPoolImplTest, MultipleRequestAndResponse) {
   dispatcher_.clearDeferredDeleteList();
 }
 
+/**
+ * Test that the most recently used connection is reused first.
+ */
+TEST_F(Http1ConnPoolImplTest, MostRecentlyUsedConnection) {
+  cluster_->resource_manager_.reset(
+      new Upstream::ResourceManagerImpl(runtime_, "fake_key", 2, 1024, 1024, 1));
+  InSequence s;
+
+  ActiveTestRequest r1(*this, 0, ActiveTestRequest::Type::CreateConnection);
+  r1.startRequest();
+  ActiveTestRequest r2(*this, 1, ActiveTestRequest::Type::CreateConnection);
+  r2.startRequest();
+  r1.completeResponse(false);
+  r2.completeResponse(false);
+
+  // The second connection became idle last.
+  ActiveTestRequest r3(*this, 1, ActiveTestRequest::Type::Immediate);
+  r3.startRequest();
+  r3.completeResponse(false);
+
+  EXPECT_CALL(conn_pool_, onClientDestroy()).Times(2);
+  conn_pool_.test_clients_[0].connection_->raiseEvent(Network::ConnectionEvent::RemoteClose);
+  conn_pool_.test_clients_[1].connection_->raiseEvent(Network::ConnectionEvent::RemoteClose);
+  dispatcher_.clearDeferredDeleteList();
+}
+
+/**
+ * Test that an idle connection is closed after the idle timeout of the cluster.
+ */
+TEST_F(Http1ConnPoolImplTest, IdleTimeout) {
+  cluster_->idle_timeout_.value(std::chrono::milliseconds(1000));
+  InSequence s;
+
+  ActiveTestRequest r1(*this, 0, ActiveTestRequest::Type::CreateConnection);
+  r1.startRequest();
+  Event::MockTimer* idle_timer = new Event::MockTimer(&dispatcher_);
+  EXPECT_CALL(*idle_timer, enableTimer(std::chrono::milliseconds(1000)));
+  r1.completeResponse(false);
+
+  // Reusing the connection stops the timer until it is idle again.
+  EXPECT_CALL(*idle_timer, disableTimer());
+  ActiveTestRequest r2(*this, 0, ActiveTestRequest::Type::Immediate);
+  r2.startRequest();
+  EXPECT_CALL(*idle_timer, enableTimer(std::chrono::milliseconds(1000)));
+  r2.completeResponse(false);
+
+  EXPECT_CALL(conn_pool_, onClientDestroy());
+  idle_timer->callback_();
+  dispatcher_.clearDeferredDeleteList();
+  EXPECT_EQ(1U, cluster_->stats_.upstream_cx_idle_timeout_.value());
+}
+
 /**
  * Test when we overflow max pending requests.
  */
@@ -0,0 +1,119 @@
+#include <cstring>
+#include <string>
+
+#include "common/http/http1/request_head_parser.h"
+
+#include "gtest/gtest.h"
+
+namespace Envoy {
+namespace Http {
+namespace Http1 {
+
+namespace {
+
+std::string str(const RequestHeadParser::Token& token) {
+  return std::string(token.data_, token.size_);
+}
+
+} // namespace
+
+TEST(RequestHeadParserTest, Basic) {
+  const std::string head = "GET /path?query=1 HTTP/1.1\r\n"
+                           "Host: example.com\r\n"
+                           "user-agent:\tcurl/7.54 (x86_64)\r\n"
+                           "x-tab: a\tb\r\n"
+                           "Connection: Keep-Alive\r\n"
+                           "\r\n";
+  const std::string request = head + "GET / HTTP/1.1";
+
+  RequestHeadParser parser;
+  ASSERT_TRUE(parser.parse(request.data(), request.size()));
+  EXPECT_EQ("GET", str(parser.method()));
+  EXPECT_EQ("/path?query=1", str(parser.path()));
+  EXPECT_EQ(head.size(), parser.headSize());
+  ASSERT_EQ(4U, parser.numHeaders());
+  EXPECT_EQ("Host", str(parser.header(0).name_));
+  EXPECT_EQ("example.com", str(parser.header(0).value_));
+  EXPECT_EQ("user-agent", str(parser.header(1).name_));
+  EXPECT_EQ("curl/7.54 (x86_64)", str(parser.header(1).value_));
+  EXPECT_EQ("a\tb", str(parser.header(2).value_));
+  EXPECT_EQ("Keep-Alive", str(parser.header(3).value_));
+}
+
+TEST(RequestHeadParserTest, NoHeaders) {
+  const std::string request = "DELETE /resource HTTP/1.1\r\n\r\n";
+  RequestHeadParser parser;
+  ASSERT_TRUE(parser.parse(request.data(), request.size()));
+  EXPECT_EQ("DELETE", str(parser.method()));
+  EXPECT_EQ(0U, parser.numHeaders());
+  EXPECT_EQ(request.size(), parser.headSize());
+}
+
+// Long values cross several vector blocks before the delimiter is found.
+TEST(RequestHeadParserTest, LongValues) {
+  for (size_t length = 1; length < 100; length++) {
+    const std::string value(length, 'v');
+    const std::string path = "/" + std::string(length, 'p');
+    const std::string request = "GET " + path + " HTTP/1.1\r\ncookie: " + value + "\r\n\r\n";
+    RequestHeadParser parser;
+    ASSERT_TRUE(parser.parse(request.data(), request.size())) << length;
+    EXPECT_EQ(path, str(parser.path()));
+    EXPECT_EQ(value, str(parser.header(0).value_));
+  }
+}
+
+TEST(RequestHeadParserTest, Incomplete) {
+  const std::string request = "GET / HTTP/1.1\r\nhost: example.com\r\n\r\n";
+  RequestHeadParser parser;
+  for (size_t size = 0; size < request.size(); size++) {
+    EXPECT_FALSE(parser.parse(request.data(), size)) << size;
+  }
+  EXPECT_TRUE(parser.parse(request.data(), request.size()));
+}
+
+TEST(RequestHeadParserTest, Unsupported) {
+  for (const char* request : {
+           // Request line.
+           "get / HTTP/1.1\r\n\r\n",
+           "GET  / HTTP/1.1\r\n\r\n",
+           "GET http://example.com/ HTTP/1.1\r\n\r\n",
+           "OPTIONS * HTTP/1.1\r\n\r\n",
+           "GET / HTTP/1.0\r\n\r\n",
+           "GET /\x7f HTTP/1.1\r\n\r\n",
+           "GET /\t HTTP/1.1\r\n\r\n",
+           "GET / HTTP/1.1\n\n",
+           // Header fields.
+           "GET / HTTP/1.1\r\nhost : example.com\r\n\r\n",
+           "GET / HTTP/1.1\r\n: example.com\r\n\r\n",
+           "GET / HTTP/1.1\r\nho\"st: example.com\r\n\r\n",
+           "GET / HTTP/1.1\r\nhost: example.com\n\r\n",
+           "GET / HTTP/1.1\r\nhost: exam\x01ple.com\r\n\r\n",
+           "GET / HTTP/1.1\r\nhost: example.com \r\n\r\n",
+           "GET / HTTP/1.1\r\nhost:\r\n\r\n",
+           "GET / HTTP/1.1\r\nhost: example.com\r\n folded\r\n\r\n",
+           // Headers whose semantics are left to http_parser.
+           "POST / HTTP/1.1\r\ncontent-length: 0\r\n\r\n",
+           "POST / HTTP/1.1\r\nTransfer-Encoding: chunked\r\n\r\n",
+           "GET / HTTP/1.1\r\nupgrade: websocket\r\n\r\n",
+           "GET / HTTP/1.1\r\nconnection: close\r\n\r\n",
+       }) {
+    RequestHeadParser parser;
+    EXPECT_FALSE(parser.parse(request, strlen(request))) << request;
+  }
+}
+
+TEST(RequestHeadParserTest, TooManyHeaders) {
+  std::string request = "GET / HTTP/1.1\r\n";
+  for (size_t i = 0; i < RequestHeadParser::MaxHeaders; i++) {
+    request += "a: b\r\n";
+  }
+  RequestHeadParser parser;
+  const std::string at_limit = request + "\r\n";
+  EXPECT_TRUE(parser.parse(at_limit.data(), at_limit.size()));
+  const std::string over_limit = request + "a: b\r\n\r\n";
+  EXPECT_FALSE(parser.parse(over_limit.data(), over_limit.size()));
+}
+
+} // namespace Http1
+} // namespace Http
+} // namespace Envoy
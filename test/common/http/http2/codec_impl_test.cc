@@ -215,6 +215,37 @@ TEST_P(Http2CodecImplTest, InvalidFrame) {
   EXPECT_THROW(server_wrapper_.dispatch(Buffer::OwnedImpl(), server_), CodecProtocolException);
 }
 
+TEST_P(Http2CodecImplTest, PseudoHeadersEncodedFirst) {
+  initialize();
+
+  TestHeaderMapImpl request_headers{{"a", "1"}, {":method", "GET"}, {"b", "2"}};
+  request_headers.addCopy(":scheme", "http");
+  request_headers.addCopy("c", "3");
+  request_headers.addCopy(":authority", "host");
+  request_headers.addCopy(":path", "/");
+  TestHeaderMapImpl expected_headers{{":method", "GET"}, {":scheme", "http"},
+                                     {":authority", "host"}, {":path", "/"},
+                                     {"a", "1"}, {"b", "2"}, {"c", "3"}};
+  EXPECT_CALL(request_decoder_, decodeHeaders_(HeaderMapEqual(&expected_headers), true));
+  request_encoder_->encodeHeaders(request_headers, true);
+}
+
+// The frames that a single nghttp2_session_send() produces are written together.
+TEST_P(Http2CodecImplTest, CoalescedWrites) {
+  initialize();
+
+  TestHeaderMapImpl request_headers;
+  HttpTestUtility::addDefaultHeaders(request_headers);
+  EXPECT_CALL(request_decoder_, decodeHeaders_(_, false));
+  request_encoder_->encodeHeaders(request_headers, false);
+
+  // Each side sends at least SETTINGS along with other frames in its first write.
+  const uint64_t tx_frames = stats_store_.counter("http2.tx_frames").value();
+  const uint64_t tx_writes = stats_store_.counter("http2.tx_writes").value();
+  EXPECT_GT(tx_writes, 0);
+  EXPECT_GT(tx_frames, tx_writes);
+}
+
 TEST_P(Http2CodecImplTest, TrailingHeaders) {
   initialize();
 
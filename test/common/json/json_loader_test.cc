@@ -336,6 +336,32 @@ TEST(JsonLoaderTest, NestedSchema) {
                             "key: #/value1");
 }
 
+TEST(JsonLoaderTest, SkipSchemaValidation) {
+  std::string schema = R"EOF(
+  {
+    "properties": {
+      "value1": {"type" : "number"}
+    }
+  }
+  )EOF";
+
+  ObjectSharedPtr json = Factory::loadFromString(R"EOF({"value1": "not a number"})EOF");
+  EXPECT_THROW(json->validateSchema(schema), Exception);
+
+  {
+    SkipSchemaValidation skip;
+    {
+      SkipSchemaValidation nested;
+      EXPECT_NO_THROW(json->validateSchema(schema));
+    }
+    EXPECT_NO_THROW(json->validateSchema(schema));
+  }
+
+  // The compiled schema is reused once validation is back on.
+  EXPECT_THROW(json->validateSchema(schema), Exception);
+  EXPECT_NO_THROW(Factory::loadFromString(R"EOF({"value1": 1})EOF")->validateSchema(schema));
+}
+
 TEST(JsonLoaderTest, MissingEnclosingDocument) {
 
   std::string json_string = R"EOF(
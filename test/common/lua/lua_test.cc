@@ -149,5 +149,104 @@ TEST_F(LuaTest, MarkDead) {
   lua_gc(cr1->luaState(), LUA_GCCOLLECT, 0);
 }
 
+// Released coroutines are reused if they finished without error.
+TEST_F(LuaTest, CoroutineReuse) {
+  const std::string SCRIPT{R"EOF(
+    function callMe(object)
+      object:testCall()
+    end
+
+    function fail()
+      error("failed")
+    end
+  )EOF"};
+
+  InSequence s;
+  setup(SCRIPT);
+  EXPECT_NE(LUA_REFNIL, state_->getGlobalRef(state_->registerGlobal("callMe")));
+  EXPECT_NE(LUA_REFNIL, state_->getGlobalRef(state_->registerGlobal("fail")));
+
+  CoroutinePtr cr1(state_->createCoroutine());
+  lua_State* thread = cr1->luaState();
+  TestObject* object1 = TestObject::create(cr1->luaState()).first;
+  EXPECT_CALL(*object1, doTestCall(_));
+  cr1->start(state_->getGlobalRef(0), 1, yield_callback_);
+  EXPECT_EQ(cr1->state(), Coroutine::State::Finished);
+  state_->releaseCoroutine(std::move(cr1));
+
+  // The finished coroutine runs the next function, and no longer references its arguments.
+  CoroutinePtr cr2(state_->createCoroutine());
+  EXPECT_EQ(thread, cr2->luaState());
+  EXPECT_EQ(cr2->state(), Coroutine::State::NotStarted);
+  EXPECT_EQ(0, lua_gettop(cr2->luaState()));
+  EXPECT_CALL(*object1, onDestroy());
+  lua_gc(cr2->luaState(), LUA_GCCOLLECT, 0);
+
+  TestObject* object2 = TestObject::create(cr2->luaState()).first;
+  EXPECT_CALL(*object2, doTestCall(_));
+  cr2->start(state_->getGlobalRef(0), 1, yield_callback_);
+  EXPECT_EQ(cr2->state(), Coroutine::State::Finished);
+  EXPECT_CALL(*object2, onDestroy());
+  state_->releaseCoroutine(std::move(cr2));
+  lua_gc(thread, LUA_GCCOLLECT, 0);
+
+  // A coroutine that failed is not reused.
+  CoroutinePtr cr3(state_->createCoroutine());
+  EXPECT_EQ(thread, cr3->luaState());
+  EXPECT_THROW_WITH_MESSAGE(cr3->start(state_->getGlobalRef(1), 0, yield_callback_), LuaException,
+                            "[string \"...\"]:7: failed");
+  EXPECT_FALSE(cr3->reset());
+
+  // Nor is one that has not finished.
+  CoroutinePtr cr4(state_->createCoroutine());
+  EXPECT_FALSE(cr4->reset());
+}
+
+// A coroutine that runs past its instruction budget fails, even if the script catches errors.
+TEST_F(LuaTest, InstructionBudget) {
+  const std::string SCRIPT{R"EOF(
+    function spin()
+      while true do
+        pcall(function() while true do end end)
+      end
+    end
+
+    function count(n)
+      local total = 0
+      for i = 1, n do
+        total = total + i
+      end
+    end
+  )EOF"};
+
+  setup(SCRIPT);
+  EXPECT_NE(LUA_REFNIL, state_->getGlobalRef(state_->registerGlobal("spin")));
+  EXPECT_NE(LUA_REFNIL, state_->getGlobalRef(state_->registerGlobal("count")));
+
+  CoroutinePtr cr1(state_->createCoroutine(10000));
+  try {
+    cr1->start(state_->getGlobalRef(0), 0, yield_callback_);
+    FAIL();
+  } catch (const LuaException& e) {
+    EXPECT_THAT(e.what(), testing::HasSubstr("script exceeded its budget of 10000 instructions"));
+  }
+  EXPECT_TRUE(cr1->instructionBudgetExceeded());
+  EXPECT_FALSE(cr1->reset());
+
+  // A script within its budget runs to completion and is charged the time it ran.
+  CoroutinePtr cr2(state_->createCoroutine(10000));
+  lua_pushnumber(cr2->luaState(), 100);
+  cr2->start(state_->getGlobalRef(1), 1, yield_callback_);
+  EXPECT_EQ(cr2->state(), Coroutine::State::Finished);
+  EXPECT_FALSE(cr2->instructionBudgetExceeded());
+  EXPECT_LE(0, cr2->runTime().count());
+
+  // Without a budget the same script may run longer.
+  CoroutinePtr cr3(state_->createCoroutine());
+  lua_pushnumber(cr3->luaState(), 100000);
+  cr3->start(state_->getGlobalRef(1), 1, yield_callback_);
+  EXPECT_EQ(cr3->state(), Coroutine::State::Finished);
+}
+
 } // namespace Lua
 } // namespace Envoy
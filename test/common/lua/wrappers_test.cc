@@ -44,5 +44,68 @@ TEST_F(LuaBufferWrapperTest, GetBytesInvalidParams) {
       "[string \"...\"]:3: index/length must be >= 0 and (index + length) must be <= buffer size");
 }
 
+// getBytes() within one slice and across slices.
+TEST_F(LuaBufferWrapperTest, GetBytesAcrossSlices) {
+  const std::string SCRIPT{R"EOF(
+    function callMe(object)
+      testPrint(object:getBytes(1, 3))
+      testPrint(object:getBytes(3, 4))
+      testPrint(object:getBytes(0, 11))
+      testPrint(object:getBytes(11, 0))
+    end
+  )EOF"};
+
+  setup(SCRIPT);
+  Buffer::OwnedImpl data("hello");
+  Buffer::OwnedImpl world(" world");
+  data.addShared(world);
+  BufferWrapper::create(coroutine_->luaState(), data);
+  EXPECT_CALL(*this, testPrint("ell"));
+  EXPECT_CALL(*this, testPrint("lo w"));
+  EXPECT_CALL(*this, testPrint("hello world"));
+  EXPECT_CALL(*this, testPrint(""));
+  start("callMe");
+}
+
+// Search a buffer without copying it into Lua.
+TEST_F(LuaBufferWrapperTest, Find) {
+  const std::string SCRIPT{R"EOF(
+    function callMe(object)
+      testPrint(object:find("lo w"))
+      testPrint(object:find("o"))
+      testPrint(object:find("o", 5))
+      testPrint(tostring(object:find("x")))
+      testPrint(tostring(object:find("d", 11)))
+    end
+  )EOF"};
+
+  setup(SCRIPT);
+  Buffer::OwnedImpl data("hello");
+  Buffer::OwnedImpl world(" world");
+  data.addShared(world);
+  BufferWrapper::create(coroutine_->luaState(), data);
+  EXPECT_CALL(*this, testPrint("3"));
+  EXPECT_CALL(*this, testPrint("4"));
+  EXPECT_CALL(*this, testPrint("7"));
+  EXPECT_CALL(*this, testPrint("nil"));
+  EXPECT_CALL(*this, testPrint("nil"));
+  start("callMe");
+}
+
+// Invalid params for the buffer wrapper find() call.
+TEST_F(LuaBufferWrapperTest, FindInvalidParams) {
+  const std::string SCRIPT{R"EOF(
+    function callMe(object)
+      object:find("hello", 12)
+    end
+  )EOF"};
+
+  setup(SCRIPT);
+  Buffer::OwnedImpl data("hello world");
+  BufferWrapper::create(coroutine_->luaState(), data);
+  EXPECT_THROW_WITH_MESSAGE(start("callMe"), LuaException,
+                            "[string \"...\"]:3: index must be >= 0 and <= buffer size");
+}
+
 } // namespace Lua
 } // namespace Envoy
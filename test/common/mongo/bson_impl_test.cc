@@ -59,5 +59,35 @@ TEST(BufferHelperTest, InvalidSize) {
   EXPECT_THROW(BufferHelper::removeString(buffer), EnvoyException);
 }
 
+TEST(BufferHelperTest, FieldsAcrossSlices) {
+  // Lay out each field one byte per slice.
+  Buffer::OwnedImpl fields;
+  BufferHelper::writeInt32(fields, 1);
+  BufferHelper::writeInt64(fields, 2);
+  BufferHelper::writeCString(fields, "hello");
+  BufferHelper::writeString(fields, "world");
+  BufferHelper::writeBinary(fields, std::string("\0\1", 2));
+  Buffer::OwnedImpl buffer;
+  while (fields.length() > 0) {
+    Buffer::OwnedImpl byte;
+    byte.move(fields, 1);
+    buffer.move(byte);
+  }
+
+  EXPECT_EQ(1, BufferHelper::removeInt32(buffer));
+  EXPECT_EQ(2, BufferHelper::removeInt64(buffer));
+  EXPECT_EQ("hello", BufferHelper::removeCString(buffer));
+  EXPECT_EQ("world", BufferHelper::removeString(buffer));
+  EXPECT_EQ(std::string("\0\1", 2), BufferHelper::removeBinary(buffer));
+  EXPECT_EQ(0, buffer.length());
+}
+
+TEST(BufferHelperTest, StringLengthPastEnd) {
+  Buffer::OwnedImpl buffer;
+  BufferHelper::writeInt32(buffer, 100);
+  buffer.add("abc", 4);
+  EXPECT_THROW(BufferHelper::removeString(buffer), EnvoyException);
+}
+
 } // namespace Bson
 } // namespace Envoy
@@ -0,0 +1,126 @@
+#include <string>
+#include <vector>
+
+#include "common/buffer/buffer_impl.h"
+#include "common/mongo/bson_impl.h"
+#include "common/mongo/bson_view.h"
+
+#include "test/test_common/printers.h"
+#include "test/test_common/utility.h"
+
+#include "gtest/gtest.h"
+
+namespace Envoy {
+namespace Bson {
+
+namespace {
+
+std::string encode(const Document& document) {
+  Buffer::OwnedImpl buffer;
+  document.encode(buffer);
+  return TestUtility::bufferToString(buffer);
+}
+
+} // namespace
+
+TEST(BsonViewTest, AllTypes) {
+  const std::string encoded = encode(
+      *DocumentImpl::create()
+           ->addDouble("double", 2.5)
+           ->addString("string", "hello")
+           ->addDocument("document", DocumentImpl::create()->addInt32("nested", 1))
+           ->addArray("array", DocumentImpl::create()->addString("0", "a"))
+           ->addBinary("binary", "\x01\x02")
+           ->addObjectId("object_id", Field::ObjectId())
+           ->addBoolean("boolean", true)
+           ->addDatetime("datetime", 3)
+           ->addNull("null")
+           ->addRegex("regex", {"^a", "i"})
+           ->addInt32("int32", -4)
+           ->addTimestamp("timestamp", 5)
+           ->addInt64("int64", 1LL << 40));
+  const DocumentView view(encoded);
+
+  std::vector<std::string> keys;
+  for (const FieldView& field : view) {
+    keys.push_back(std::string(field.key()));
+  }
+  EXPECT_EQ((std::vector<std::string>{"double", "string", "document", "array", "binary",
+                                      "object_id", "boolean", "datetime", "null", "regex", "int32",
+                                      "timestamp", "int64"}),
+            keys);
+
+  EXPECT_EQ(2.5, view.find("double").value().asDouble());
+  EXPECT_EQ("hello", view.find("string").value().asString());
+  EXPECT_EQ(1, view.find("document").value().asDocument().find("nested").value().asInt32());
+  EXPECT_EQ("a", view.find("array").value().asArray().find("0").value().asString());
+  EXPECT_EQ(Field::Type::BINARY, view.find("binary").value().type());
+  EXPECT_EQ(Field::Type::OBJECT_ID, view.find("object_id").value().type());
+  EXPECT_TRUE(view.find("boolean").value().asBoolean());
+  EXPECT_EQ(3, view.find("datetime").value().asDatetime());
+  EXPECT_EQ(Field::Type::NULL_VALUE, view.find("null").value().type());
+  EXPECT_EQ(Field::Type::REGEX, view.find("regex").value().type());
+  EXPECT_EQ(-4, view.find("int32").value().asInt32());
+  EXPECT_EQ(5, view.find("timestamp").value().asTimestamp());
+  EXPECT_EQ(1LL << 40, view.find("int64").value().asInt64());
+}
+
+TEST(BsonViewTest, Find) {
+  const std::string encoded =
+      encode(*DocumentImpl::create()->addInt32("_id", 1)->addString("_id", "two"));
+  const DocumentView view(encoded);
+
+  EXPECT_EQ(Field::Type::INT32, view.find("_id").value().type());
+  EXPECT_EQ("two", view.find("_id", Field::Type::STRING).value().asString());
+  EXPECT_FALSE(view.find("_id", Field::Type::DOUBLE).valid());
+  EXPECT_FALSE(view.find("id").valid());
+  EXPECT_FALSE(view.empty());
+
+  const std::string empty = encode(*DocumentImpl::create());
+  EXPECT_TRUE(DocumentView(empty).empty());
+  EXPECT_TRUE(DocumentView(empty).begin() == DocumentView(empty).end());
+}
+
+TEST(BsonViewTest, BadCast) {
+  const std::string encoded = encode(*DocumentImpl::create()->addString("hello", "world"));
+  EXPECT_THROW(DocumentView(encoded).begin()->asDouble(), EnvoyException);
+  EXPECT_THROW(DocumentView(encoded).begin()->asDocument(), EnvoyException);
+}
+
+TEST(BsonViewTest, InvalidDocument) {
+  // Too short for a document, longer than the data and not terminated.
+  EXPECT_THROW(DocumentView(absl::string_view("\x04\x00\x00\x00", 4)), EnvoyException);
+  EXPECT_THROW(DocumentView(absl::string_view("\x64\x00\x00\x00\x00", 5)), EnvoyException);
+  EXPECT_THROW(DocumentView(absl::string_view("\x05\x00\x00\x00\x01", 5)), EnvoyException);
+}
+
+TEST(BsonViewTest, InvalidField) {
+  // An unknown element type.
+  const std::string invalid_type("\x0c\x00\x00\x00\x20hello\x00\x00", 12);
+  EXPECT_THROW(DocumentView(invalid_type).begin(), EnvoyException);
+
+  // A key without a terminator.
+  const std::string invalid_key("\x0a\x00\x00\x00\x10hell\x00", 10);
+  EXPECT_THROW(DocumentView(invalid_key).begin(), EnvoyException);
+
+  // An int32 cut short.
+  const std::string short_value("\x0a\x00\x00\x00\x10k\x00\x01\x00\x00", 10);
+  EXPECT_THROW(DocumentView(short_value).begin(), EnvoyException);
+
+  // A string longer than the document.
+  const std::string long_string("\x0e\x00\x00\x00\x02k\x00\x10\x00\x00\x00\x61\x00\x00", 14);
+  EXPECT_THROW(DocumentView(long_string).begin(), EnvoyException);
+
+  // The second field is checked when the first is skipped.
+  const std::string encoded = encode(*DocumentImpl::create()->addInt32("a", 1)->addInt32("b", 2));
+  std::string truncated = encoded.substr(0, encoded.size() - 3);
+  truncated[0] = truncated.size();
+  truncated.back() = 0;
+  const DocumentView view(truncated);
+  DocumentView::Iterator field = view.begin();
+  EXPECT_EQ("a", field->key());
+  EXPECT_THROW(++field, EnvoyException);
+}
+
+} // namespace Bson
+} // namespace Envoy
@@ -6,13 +6,16 @@
 #include "common/mongo/codec_impl.h"
 
 #include "test/test_common/printers.h"
+#include "test/test_common/utility.h"
 
 #include "gmock/gmock.h"
 #include "gtest/gtest.h"
 
 using testing::Eq;
+using testing::Invoke;
 using testing::NiceMock;
 using testing::Pointee;
+using testing::_;
 
 namespace Envoy {
 namespace Mongo {
@@ -314,6 +317,73 @@ TEST_F(MongoCodecImplTest, InvalidMessage) {
   EXPECT_THROW(decoder_.onData(output_), EnvoyException);
 }
 
+TEST_F(MongoCodecImplTest, SkipDocuments) {
+  DecoderImpl decoder(callbacks_, false);
+
+  QueryMessageImpl query(1, 1);
+  query.fullCollectionName("test");
+  query.query(Bson::DocumentImpl::create()->addString("hello", "world"));
+  query.returnFieldsSelector(Bson::DocumentImpl::create()->addInt32("hello", 1));
+  encoder_.encodeQuery(query);
+  EXPECT_CALL(callbacks_, decodeQuery_(_)).WillOnce(Invoke([&](QueryMessagePtr& message) -> void {
+    EXPECT_EQ("test", message->fullCollectionName());
+    EXPECT_EQ(query.encodedQuery(), message->encodedQuery());
+    EXPECT_EQ(*query.query(), *message->query());
+    EXPECT_EQ(nullptr, message->returnFieldsSelector());
+  }));
+  decoder.onData(output_);
+
+  InsertMessageImpl insert(2, 2);
+  insert.fullCollectionName("test");
+  insert.documents().push_back(Bson::DocumentImpl::create()->addString("hello", "world"));
+  insert.documents().push_back(Bson::DocumentImpl::create());
+  encoder_.encodeInsert(insert);
+  EXPECT_CALL(callbacks_, decodeInsert_(_)).WillOnce(Invoke([&](InsertMessagePtr& message) -> void {
+    EXPECT_EQ("test", message->fullCollectionName());
+    EXPECT_TRUE(message->documents().empty());
+  }));
+  decoder.onData(output_);
+
+  ReplyMessageImpl reply(3, 3);
+  reply.numberReturned(2);
+  reply.documents().push_back(Bson::DocumentImpl::create()->addString("hello", "world"));
+  reply.documents().push_back(Bson::DocumentImpl::create());
+  encoder_.encodeReply(reply);
+  EXPECT_CALL(callbacks_, decodeReply_(_)).WillOnce(Invoke([&](ReplyMessagePtr& message) -> void {
+    EXPECT_EQ(2, message->numberReturned());
+    EXPECT_TRUE(message->documents().empty());
+    EXPECT_EQ(reply.documentsByteSize(), message->documentsByteSize());
+  }));
+  decoder.onData(output_);
+  EXPECT_EQ(27U, reply.documentsByteSize());
+  EXPECT_EQ(0U, output_.length());
+
+  // A document cannot be shorter than its length and terminator.
+  Bson::BufferHelper::writeInt32(output_, 40); // Size
+  Bson::BufferHelper::writeInt32(output_, 4);  // Request ID
+  Bson::BufferHelper::writeInt32(output_, 0);  // Response to
+  Bson::BufferHelper::writeInt32(output_, static_cast<int32_t>(Message::OpCode::OP_REPLY));
+  Bson::BufferHelper::writeInt32(output_, 0);  // Flags
+  Bson::BufferHelper::writeInt64(output_, 0);  // Cursor ID
+  Bson::BufferHelper::writeInt32(output_, 0);  // Starting from
+  Bson::BufferHelper::writeInt32(output_, 1);  // Number returned
+  Bson::BufferHelper::writeInt32(output_, 4);  // Document size
+  EXPECT_THROW(decoder.onData(output_), EnvoyException);
+}
+
+TEST_F(MongoCodecImplTest, EncodedQuery) {
+  QueryMessageImpl query(1, 1);
+  EXPECT_EQ("", query.encodedQuery());
+
+  query.query(Bson::DocumentImpl::create()->addString("hello", "world"));
+  Buffer::OwnedImpl encoded;
+  query.query()->encode(encoded);
+  EXPECT_EQ(TestUtility::bufferToString(encoded), query.encodedQuery());
+
+  query.query(Bson::DocumentImpl::create());
+  EXPECT_EQ(5U, query.encodedQuery().size());
+}
+
 TEST_F(MongoCodecImplTest, QueryToStringWithEscape) {
   QueryMessageImpl query(1, 1);
   query.flags(0x4);
@@ -45,13 +45,15 @@ public:
   using ProxyFilter::ProxyFilter;
 
   // ProxyFilter
-  DecoderPtr createDecoder(DecoderCallbacks& callbacks) override {
+  DecoderPtr createDecoder(DecoderCallbacks& callbacks, bool decode_documents) override {
     callbacks_ = &callbacks;
+    decode_documents_ = decode_documents;
     return DecoderPtr{decoder_};
   }
 
   MockDecoder* decoder_{new MockDecoder()};
   DecoderCallbacks* callbacks_{};
+  bool decode_documents_{};
 };
 
 class MongoProxyFilterTest : public testing::Test {
@@ -181,6 +183,20 @@ TEST_F(MongoProxyFilterTest, DelayFaultsRuntimeDisabled) {
   EXPECT_EQ(0U, store_.counter("test.delays_injected").value());
 }
 
+TEST_F(MongoProxyFilterTest, DecodeDocumentsOnlyForAccessLog) {
+  initializeFilter();
+  EXPECT_CALL(*filter_->decoder_, onData(_));
+  filter_->onData(fake_data_);
+  EXPECT_TRUE(filter_->decode_documents_);
+
+  ON_CALL(runtime_.snapshot_, featureEnabled("mongo.connection_logging_enabled", 100))
+      .WillByDefault(Return(false));
+  initializeFilter();
+  EXPECT_CALL(*filter_->decoder_, onData(_));
+  filter_->onData(fake_data_);
+  EXPECT_FALSE(filter_->decode_documents_);
+}
+
 TEST_F(MongoProxyFilterTest, Stats) {
   initializeFilter();
 
@@ -209,6 +225,7 @@ TEST_F(MongoProxyFilterTest, Stats) {
     ReplyMessagePtr message(new ReplyMessageImpl(0, 0));
     message->flags(0b11);
     message->cursorId(1);
+    message->numberReturned(1);
     message->documents().push_back(Bson::DocumentImpl::create()->addString("hello", "world"));
     filter_->callbacks_->decodeReply(std::move(message));
 
@@ -284,6 +301,7 @@ TEST_F(MongoProxyFilterTest, CommandStats) {
     ReplyMessagePtr message(new ReplyMessageImpl(0, 0));
     message->flags(0b11);
     message->cursorId(1);
+    message->numberReturned(1);
     message->documents().push_back(Bson::DocumentImpl::create()->addString("hello", "world"));
     filter_->callbacks_->decodeReply(std::move(message));
   }));
@@ -346,6 +364,7 @@ TEST_F(MongoProxyFilterTest, CallingFunctionStats) {
     ReplyMessagePtr message(new ReplyMessageImpl(0, 0));
     message->flags(0b11);
     message->cursorId(1);
+    message->numberReturned(1);
     message->documents().push_back(Bson::DocumentImpl::create()->addString("hello", "world"));
     filter_->callbacks_->decodeReply(std::move(message));
 
@@ -423,12 +442,14 @@ TEST_F(MongoProxyFilterTest, ConcurrentQueryWithDrainClose) {
     ReplyMessagePtr message(new ReplyMessageImpl(0, 1));
     message->flags(0b11);
     message->cursorId(1);
+    message->numberReturned(1);
     message->documents().push_back(Bson::DocumentImpl::create()->addString("hello", "world"));
     filter_->callbacks_->decodeReply(std::move(message));
 
     message.reset(new ReplyMessageImpl(0, 2));
     message->flags(0b11);
     message->cursorId(1);
+    message->numberReturned(1);
     message->documents().push_back(Bson::DocumentImpl::create()->addString("hello", "world"));
     ON_CALL(runtime_.snapshot_, featureEnabled("mongo.drain_close_enabled", 100))
         .WillByDefault(Return(true));
@@ -463,6 +484,7 @@ TEST_F(MongoProxyFilterTest, EmptyActiveQueryList) {
     ReplyMessagePtr message(new ReplyMessageImpl(0, 0));
     message->flags(0b11);
     message->cursorId(1);
+    message->numberReturned(1);
     message->documents().push_back(Bson::DocumentImpl::create()->addString("hello", "world"));
     filter_->callbacks_->decodeReply(std::move(message));
   }));
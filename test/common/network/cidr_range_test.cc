@@ -571,6 +571,31 @@ TEST(IpListTest, MatchAnyAll) {
   EXPECT_FALSE(wl.contains(Address::PipeInstance("foo")));
 }
 
+TEST(IpListTest, NestedRanges) {
+  IpList wl(std::vector<std::string>{"10.0.0.0/8", "10.1.0.0/16", "10.1.2.0/24", "10.3.0.0/16"});
+
+  EXPECT_TRUE(wl.contains(Address::Ipv4Instance("10.1.2.3")));
+  EXPECT_TRUE(wl.contains(Address::Ipv4Instance("10.1.3.3")));
+  EXPECT_TRUE(wl.contains(Address::Ipv4Instance("10.2.0.1")));
+  EXPECT_TRUE(wl.contains(Address::Ipv4Instance("10.3.0.1")));
+  EXPECT_FALSE(wl.contains(Address::Ipv4Instance("11.0.0.1")));
+
+  // Copies share the ranges.
+  IpList copy = wl;
+  EXPECT_TRUE(copy.contains(Address::Ipv4Instance("10.255.255.255")));
+  EXPECT_FALSE(copy.contains(Address::Ipv4Instance("9.255.255.255")));
+}
+
+TEST(IpListTest, Empty) {
+  IpList wl(std::vector<std::string>{});
+  EXPECT_TRUE(wl.empty());
+  EXPECT_FALSE(wl.contains(Address::Ipv4Instance("10.0.0.1")));
+  EXPECT_FALSE(wl.contains(Address::Ipv6Instance("::1")));
+
+  EXPECT_TRUE(IpList().empty());
+  EXPECT_FALSE(IpList(std::vector<std::string>{"10.0.0.0/8"}).empty());
+}
+
 } // namespace Address
 } // namespace Network
 } // namespace Envoy
@@ -0,0 +1,67 @@
+#include "common/network/address_impl.h"
+#include "common/network/connection_balancer_impl.h"
+
+#include "test/mocks/network/mocks.h"
+
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+
+using testing::NiceMock;
+using testing::Return;
+using testing::_;
+
+namespace Envoy {
+namespace Network {
+
+class ExactConnectionBalancerImplTest : public testing::Test {
+public:
+  ExactConnectionBalancerImplTest() {
+    balancer_.registerHandler(handler1_);
+    balancer_.registerHandler(handler2_);
+  }
+
+  bool balance(BalancedConnectionHandler& current) {
+    return balancer_.balanceConnection(current, 10, remote_address_, local_address_, false);
+  }
+
+  ExactConnectionBalancerImpl balancer_;
+  NiceMock<MockBalancedConnectionHandler> handler1_;
+  NiceMock<MockBalancedConnectionHandler> handler2_;
+  const Address::InstanceConstSharedPtr remote_address_{
+      new Address::Ipv4Instance("10.0.0.1", 50000)};
+  const Address::InstanceConstSharedPtr local_address_{new Address::Ipv4Instance("10.0.0.2", 80)};
+};
+
+// A connection is handed over to the handler with the fewest connections.
+TEST_F(ExactConnectionBalancerImplTest, PostToLeastLoaded) {
+  ON_CALL(handler1_, numConnections()).WillByDefault(Return(3));
+  ON_CALL(handler2_, numConnections()).WillByDefault(Return(1));
+
+  EXPECT_CALL(handler1_, post(_, _, _, _)).Times(0);
+  EXPECT_CALL(handler2_, post(10, remote_address_, local_address_, false));
+  EXPECT_TRUE(balance(handler1_));
+}
+
+// A connection stays on the handler that accepted it unless another has fewer connections.
+TEST_F(ExactConnectionBalancerImplTest, KeepOnTie) {
+  ON_CALL(handler1_, numConnections()).WillByDefault(Return(2));
+  ON_CALL(handler2_, numConnections()).WillByDefault(Return(2));
+
+  EXPECT_CALL(handler1_, post(_, _, _, _)).Times(0);
+  EXPECT_CALL(handler2_, post(_, _, _, _)).Times(0);
+  EXPECT_FALSE(balance(handler1_));
+  EXPECT_FALSE(balance(handler2_));
+}
+
+// Connections are not handed over to unregistered handlers.
+TEST_F(ExactConnectionBalancerImplTest, Unregister) {
+  ON_CALL(handler1_, numConnections()).WillByDefault(Return(3));
+  ON_CALL(handler2_, numConnections()).WillByDefault(Return(1));
+  balancer_.unregisterHandler(handler2_);
+
+  EXPECT_CALL(handler2_, post(_, _, _, _)).Times(0);
+  EXPECT_FALSE(balance(handler1_));
+}
+
+} // namespace Network
+} // namespace Envoy
@@ -1,8 +1,12 @@
+#include <sys/socket.h>
+#include <unistd.h>
+
 #include <cstdint>
 #include <memory>
 #include <string>
 
 #include "common/buffer/buffer_impl.h"
+#include "common/common/assert.h"
 #include "common/common/empty_string.h"
 #include "common/event/dispatcher_impl.h"
 #include "common/network/address_impl.h"
@@ -532,6 +536,27 @@ TEST_P(ConnectionImplTest, WatermarkFuzzing) {
   disconnect(true);
 }
 
+// Test that a short write of a buffer that fit in a single write() call ends the flush instead of
+// retrying until the socket returns EAGAIN.
+TEST_P(ConnectionImplTest, ShortWriteEndsFlush) {
+  useMockBuffer();
+  setUpBasicConnection();
+  connect();
+
+  Buffer::OwnedImpl buffer_to_write("hello world");
+  EXPECT_CALL(*client_write_buffer_, move(_))
+      .WillOnce(Invoke(client_write_buffer_, &MockWatermarkBuffer::baseMove));
+  EXPECT_CALL(*client_write_buffer_, write(_)).WillOnce(Invoke([&](int) -> int {
+    client_write_buffer_->baseDrain(5);
+    return 5;
+  }));
+  client_connection_->write(buffer_to_write);
+  dispatcher_->run(Event::Dispatcher::RunType::NonBlock);
+  EXPECT_EQ(6UL, client_write_buffer_->length());
+
+  disconnect(true);
+}
+
 TEST_P(ConnectionImplTest, BindTest) {
   std::string address_string = TestUtility::getIpv4Loopback();
   if (GetParam() == Network::Address::IpVersion::v4) {
@@ -735,6 +760,104 @@ TEST_F(ConnectionImplBytesSentTest, CloseInCallback) {
   EXPECT_EQ(connection_->state(), Connection::State::Closed);
 }
 
+#ifdef __linux__
+class ConnectionImplSpliceTest : public testing::Test {
+public:
+  ConnectionImplSpliceTest() {
+    RELEASE_ASSERT(socketpair(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK, 0, downstream_fds_) == 0);
+    RELEASE_ASSERT(socketpair(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK, 0, upstream_fds_) == 0);
+    downstream_.reset(new ConnectionImpl(dispatcher_, downstream_fds_[0], address_, address_,
+                                         nullptr, false, true));
+    upstream_.reset(new ConnectionImpl(dispatcher_, upstream_fds_[0], address_, address_, nullptr,
+                                       false, true));
+  }
+
+  ~ConnectionImplSpliceTest() {
+    downstream_->close(ConnectionCloseType::NoFlush);
+    upstream_->close(ConnectionCloseType::NoFlush);
+    ::close(downstream_fds_[1]);
+    ::close(upstream_fds_[1]);
+  }
+
+  // Run the dispatcher until the far end of a connection has data to read.
+  std::string readFrom(int fd) {
+    char data[64];
+    while (true) {
+      dispatcher_.run(Event::Dispatcher::RunType::NonBlock);
+      ssize_t rc = ::read(fd, data, sizeof(data));
+      if (rc > 0) {
+        return std::string(data, rc);
+      }
+    }
+  }
+
+  Event::DispatcherImpl dispatcher_;
+  Address::InstanceConstSharedPtr address_{
+      Network::Test::getCanonicalLoopbackAddress(Address::IpVersion::v4)};
+  int downstream_fds_[2];
+  int upstream_fds_[2];
+  std::unique_ptr<ConnectionImpl> downstream_;
+  std::unique_ptr<ConnectionImpl> upstream_;
+};
+
+// Test that spliced connections forward data in both directions without reading it into their
+// filters.
+TEST_F(ConnectionImplSpliceTest, Forward) {
+  std::shared_ptr<MockReadFilter> read_filter(new StrictMock<MockReadFilter>());
+  downstream_->addReadFilter(read_filter);
+
+  uint64_t received = 0;
+  uint64_t sent = 0;
+  EXPECT_TRUE(downstream_->startSplice(*upstream_, [&](Connection& from, uint64_t bytes) {
+    if (&from == downstream_.get()) {
+      received += bytes;
+    } else {
+      sent += bytes;
+    }
+  }));
+  EXPECT_FALSE(upstream_->startSplice(*downstream_, [](Connection&, uint64_t) {}));
+
+  ASSERT_EQ(5, ::write(downstream_fds_[1], "hello", 5));
+  EXPECT_EQ("hello", readFrom(upstream_fds_[1]));
+  ASSERT_EQ(6, ::write(upstream_fds_[1], "world!", 6));
+  EXPECT_EQ("world!", readFrom(downstream_fds_[1]));
+  EXPECT_EQ(5U, received);
+  EXPECT_EQ(6U, sent);
+
+  // The remote close of one side is seen through the splice, and the other side goes back to
+  // reading through its filters.
+  ::close(downstream_fds_[1]);
+  downstream_fds_[1] = -1;
+  while (downstream_->state() != Connection::State::Closed) {
+    dispatcher_.run(Event::Dispatcher::RunType::NonBlock);
+  }
+  EXPECT_EQ(Connection::State::Open, upstream_->state());
+}
+
+// Test that connections whose data must be seen by filters or buffers are not spliced.
+TEST_F(ConnectionImplSpliceTest, Unavailable) {
+  auto cb = [](Connection&, uint64_t) {};
+  EXPECT_FALSE(downstream_->startSplice(*downstream_, cb));
+
+  NiceMock<MockConnection> mock_connection;
+  EXPECT_FALSE(downstream_->startSplice(mock_connection, cb));
+
+  // Only the filter asking for the splice may be installed.
+  downstream_->addReadFilter(std::make_shared<NiceMock<MockReadFilter>>());
+  downstream_->addReadFilter(std::make_shared<NiceMock<MockReadFilter>>());
+  EXPECT_FALSE(downstream_->startSplice(*upstream_, cb));
+  EXPECT_FALSE(upstream_->startSplice(*downstream_, cb));
+}
+
+// Test that a connection with a write filter is not spliced.
+TEST_F(ConnectionImplSpliceTest, WriteFilter) {
+  auto cb = [](Connection&, uint64_t) {};
+  upstream_->addWriteFilter(std::make_shared<NiceMock<MockWriteFilter>>());
+  EXPECT_FALSE(downstream_->startSplice(*upstream_, cb));
+  EXPECT_FALSE(upstream_->startSplice(*downstream_, cb));
+}
+#endif
+
 class ReadBufferLimitTest : public ConnectionImplTest {
 public:
   void readBufferLimitTest(uint32_t read_buffer_limit, uint32_t expected_chunk_size) {
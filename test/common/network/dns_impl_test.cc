@@ -19,6 +19,7 @@
 #include "common/network/utility.h"
 #include "common/stats/stats_impl.h"
 
+#include "test/mocks/common.h"
 #include "test/mocks/network/mocks.h"
 #include "test/test_common/environment.h"
 #include "test/test_common/network_utility.h"
@@ -32,6 +33,7 @@ using testing::InSequence;
 using testing::Mock;
 using testing::NiceMock;
 using testing::Return;
+using testing::ReturnPointee;
 using testing::_;
 
 namespace Envoy {
@@ -49,8 +51,10 @@ enum record_type { A, AAAA };
 
 class TestDnsServerQuery {
 public:
-  TestDnsServerQuery(ConnectionPtr connection, const HostMap& hosts_A, const HostMap& hosts_AAAA)
-      : connection_(std::move(connection)), hosts_A_(hosts_A), hosts_AAAA_(hosts_AAAA) {
+  TestDnsServerQuery(ConnectionPtr connection, const HostMap& hosts_A, const HostMap& hosts_AAAA,
+                     const uint32_t& ttl, uint32_t& queries)
+      : connection_(std::move(connection)), hosts_A_(hosts_A), hosts_AAAA_(hosts_AAAA), ttl_(ttl),
+        queries_(queries) {
     connection_->addReadFilter(Network::ReadFilterSharedPtr{new ReadFilter(*this)});
   }
 
@@ -92,6 +96,7 @@ private:
         unsigned char* request = static_cast<unsigned char*>(buffer_.linearize(size_));
         // Only expecting a single question.
         ASSERT_EQ(1, DNS_HEADER_QDCOUNT(request));
+        ++parent_.queries_;
         // Decode the question and perform lookup.
         const unsigned char* question = request + HFIXEDSZ;
         // The number of bytes the encoded question name takes up in the request.
@@ -143,7 +148,7 @@ private:
           DNS_RR_SET_LEN(response_rr_fixed, sizeof(in6_addr));
         }
         DNS_RR_SET_CLASS(response_rr_fixed, C_IN);
-        DNS_RR_SET_TTL(response_rr_fixed, 0);
+        DNS_RR_SET_TTL(response_rr_fixed, parent_.ttl_);
 
         size_t response_rest_len;
         if (q_type == T_A) {
@@ -194,13 +199,15 @@ private:
   ConnectionPtr connection_;
   const HostMap& hosts_A_;
   const HostMap& hosts_AAAA_;
+  const uint32_t& ttl_;
+  uint32_t& queries_;
 };
 
 class TestDnsServer : public ListenerCallbacks {
 public:
   void onNewConnection(ConnectionPtr&& new_connection) override {
     TestDnsServerQuery* query =
-        new TestDnsServerQuery(std::move(new_connection), hosts_A_, hosts_AAAA_);
+        new TestDnsServerQuery(std::move(new_connection), hosts_A_, hosts_AAAA_, ttl_, queries_);
     queries_.emplace_back(query);
   }
 
@@ -212,9 +219,16 @@ public:
     }
   }
 
+  // Set the TTL of the answers, which are not cached by default.
+  void setTtl(uint32_t ttl) { ttl_ = ttl; }
+  // The number of questions answered.
+  uint32_t queries() const { return queries_; }
+
 private:
   HostMap hosts_A_;
   HostMap hosts_AAAA_;
+  uint32_t ttl_ = 0;
+  uint32_t queries_ = 0;
   // All queries are tracked so we can do resource reclamation when the test is
   // over.
   std::vector<std::unique_ptr<TestDnsServerQuery>> queries_;
@@ -226,6 +240,7 @@ public:
   DnsResolverImplPeer(DnsResolverImpl* resolver) : resolver_(resolver) {}
   ares_channel channel() const { return resolver_->channel_; }
   const std::unordered_map<int, Event::FileEventPtr>& events() { return resolver_->events_; }
+  size_t inFlight() const { return resolver_->in_flight_.size(); }
   // Reset the channel state for a DnsResolverImpl such that it will only use
   // TCP and optionally has a zero timeout (for validating timeout behavior).
   void resetChannelTcpOnly(bool zero_timeout) {
@@ -273,7 +288,10 @@ TEST(DnsImplConstructor, SupportsCustomResolvers) {
 class DnsImplTest : public testing::TestWithParam<Address::IpVersion> {
 public:
   void SetUp() override {
-    resolver_ = dispatcher_.createDnsResolver({});
+    ON_CALL(time_source_, currentTime()).WillByDefault(ReturnPointee(&now_));
+    resolver_ = std::make_shared<DnsResolverImpl>(
+        dispatcher_, std::vector<Address::InstanceConstSharedPtr>{}, time_source_);
+    resolver_->initializeStats(stats_store_, "dns.");
 
     // Instantiate TestDnsServer and listen on a random port on the loopback address.
     server_.reset(new TestDnsServer());
@@ -307,6 +325,8 @@ protected:
   Stats::IsolatedStoreImpl stats_store_;
   std::unique_ptr<Network::Listener> listener_;
   Event::DispatcherImpl dispatcher_;
+  MonotonicTime now_;
+  NiceMock<MockMonotonicTimeSource> time_source_;
   DnsResolverSharedPtr resolver_;
 };
 
@@ -564,6 +584,118 @@ TEST_P(DnsImplTest, Cancel) {
   EXPECT_TRUE(hasAddress(address_list, "201.134.56.7"));
 }
 
+// Validate that answers are served from the cache until their TTL expires.
+TEST_P(DnsImplTest, CachedLookup) {
+  server_->addHosts("some.good.domain", {"201.134.56.7"}, A);
+  server_->setTtl(30);
+  std::list<Address::InstanceConstSharedPtr> address_list;
+  auto callback = [&](std::list<Address::InstanceConstSharedPtr>&& results) -> void {
+    address_list = results;
+    dispatcher_.exit();
+  };
+  EXPECT_NE(nullptr, resolver_->resolve("some.good.domain", DnsLookupFamily::V4Only, callback));
+  dispatcher_.run(Event::Dispatcher::RunType::Block);
+  EXPECT_TRUE(hasAddress(address_list, "201.134.56.7"));
+
+  address_list.clear();
+  now_ += std::chrono::seconds(10);
+  EXPECT_EQ(nullptr, resolver_->resolve("some.good.domain", DnsLookupFamily::V4Only, callback));
+  EXPECT_TRUE(hasAddress(address_list, "201.134.56.7"));
+  EXPECT_EQ(1U, server_->queries());
+
+  // Other lookup families are cached apart.
+  EXPECT_NE(nullptr, resolver_->resolve("some.good.domain", DnsLookupFamily::Auto, callback));
+  dispatcher_.run(Event::Dispatcher::RunType::Block);
+
+  address_list.clear();
+  now_ += std::chrono::seconds(20);
+  EXPECT_NE(nullptr, resolver_->resolve("some.good.domain", DnsLookupFamily::V4Only, callback));
+  dispatcher_.run(Event::Dispatcher::RunType::Block);
+  EXPECT_TRUE(hasAddress(address_list, "201.134.56.7"));
+
+  EXPECT_EQ(1UL, stats_store_.counter("dns.cache_hit").value());
+  EXPECT_EQ(3UL, stats_store_.counter("dns.cache_miss").value());
+  EXPECT_EQ(0UL, stats_store_.counter("dns.prefetch").value());
+}
+
+// Validate that failures are not cached.
+TEST_P(DnsImplTest, FailureNotCached) {
+  server_->setTtl(30);
+  std::list<Address::InstanceConstSharedPtr> address_list;
+  auto callback = [&](std::list<Address::InstanceConstSharedPtr>&& results) -> void {
+    address_list = results;
+    dispatcher_.exit();
+  };
+  EXPECT_NE(nullptr, resolver_->resolve("some.bad.domain", DnsLookupFamily::V4Only, callback));
+  dispatcher_.run(Event::Dispatcher::RunType::Block);
+  EXPECT_TRUE(address_list.empty());
+
+  EXPECT_NE(nullptr, resolver_->resolve("some.bad.domain", DnsLookupFamily::V4Only, callback));
+  dispatcher_.run(Event::Dispatcher::RunType::Block);
+  EXPECT_TRUE(address_list.empty());
+  EXPECT_EQ(2U, server_->queries());
+  EXPECT_EQ(2UL, stats_store_.counter("dns.resolve_failure").value());
+}
+
+// Validate that concurrent resolutions of a name wait for the same query, and that each of them
+// can be cancelled.
+TEST_P(DnsImplTest, CoalescedLookup) {
+  server_->addHosts("some.good.domain", {"201.134.56.7"}, A);
+  ActiveDnsQuery* query =
+      resolver_->resolve("some.good.domain", DnsLookupFamily::V4Only,
+                         [](std::list<Address::InstanceConstSharedPtr> &&) -> void { FAIL(); });
+  ASSERT_NE(nullptr, query);
+
+  std::list<Address::InstanceConstSharedPtr> address_list;
+  EXPECT_NE(nullptr,
+            resolver_->resolve("some.good.domain", DnsLookupFamily::V4Only,
+                               [&](std::list<Address::InstanceConstSharedPtr>&& results) -> void {
+                                 address_list = results;
+                                 dispatcher_.exit();
+                               }));
+  query->cancel();
+
+  dispatcher_.run(Event::Dispatcher::RunType::Block);
+  EXPECT_TRUE(hasAddress(address_list, "201.134.56.7"));
+  EXPECT_EQ(1U, server_->queries());
+  EXPECT_EQ(1UL, stats_store_.counter("dns.coalesced").value());
+  EXPECT_EQ(0U, peer_->inFlight());
+}
+
+// Validate that an answer close to its expiry is served while the name is queried again.
+TEST_P(DnsImplTest, PrefetchLookup) {
+  server_->addHosts("some.good.domain", {"201.134.56.7"}, A);
+  server_->setTtl(10);
+  std::list<Address::InstanceConstSharedPtr> address_list;
+  EXPECT_NE(nullptr,
+            resolver_->resolve("some.good.domain", DnsLookupFamily::V4Only,
+                               [&](std::list<Address::InstanceConstSharedPtr>&& results) -> void {
+                                 address_list = results;
+                                 dispatcher_.exit();
+                               }));
+  dispatcher_.run(Event::Dispatcher::RunType::Block);
+
+  server_->addHosts("some.good.domain", {"123.4.5.6"}, A);
+  now_ += std::chrono::seconds(9);
+  auto callback = [&](std::list<Address::InstanceConstSharedPtr>&& results) -> void {
+    address_list = results;
+  };
+  EXPECT_EQ(nullptr, resolver_->resolve("some.good.domain", DnsLookupFamily::V4Only, callback));
+  EXPECT_TRUE(hasAddress(address_list, "201.134.56.7"));
+  EXPECT_EQ(1UL, stats_store_.counter("dns.prefetch").value());
+  EXPECT_EQ(1U, peer_->inFlight());
+  while (peer_->inFlight() > 0) {
+    dispatcher_.run(Event::Dispatcher::RunType::NonBlock);
+  }
+
+  // The prefetched answer is cached for its own TTL.
+  now_ += std::chrono::seconds(5);
+  EXPECT_EQ(nullptr, resolver_->resolve("some.good.domain", DnsLookupFamily::V4Only, callback));
+  EXPECT_TRUE(hasAddress(address_list, "123.4.5.6"));
+  EXPECT_EQ(2U, server_->queries());
+  EXPECT_EQ(1UL, stats_store_.counter("dns.prefetch").value());
+}
+
 class DnsImplZeroTimeoutTest : public DnsImplTest {
 protected:
   bool zero_timeout() const override { return true; }
@@ -0,0 +1,112 @@
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "common/network/address_impl.h"
+#include "common/network/cidr_range.h"
+#include "common/network/lc_trie.h"
+#include "common/network/utility.h"
+
+#include "fmt/format.h"
+#include "gtest/gtest.h"
+
+namespace Envoy {
+namespace Network {
+namespace LcTrie {
+
+class LcTrieTest : public testing::Test {
+public:
+  void setup(const std::vector<std::pair<std::string, std::vector<std::string>>>& tag_data) {
+    std::vector<std::pair<std::string, std::vector<Address::CidrRange>>> ranges;
+    for (const auto& tag : tag_data) {
+      ranges.emplace_back(tag.first, std::vector<Address::CidrRange>());
+      for (const std::string& range : tag.second) {
+        ranges.back().second.push_back(Address::CidrRange::create(range));
+      }
+    }
+    trie_.reset(new LcTrie(ranges));
+  }
+
+  std::vector<std::string> tags(const std::string& address) {
+    return trie_->getTags(*Utility::parseInternetAddress(address));
+  }
+
+  std::unique_ptr<LcTrie> trie_;
+};
+
+TEST_F(LcTrieTest, Ipv4) {
+  setup({{"tag_1", {"10.0.0.0/24", "10.0.2.0/23", "192.168.0.1/32"}},
+         {"tag_2", {"10.0.0.0/8"}},
+         {"tag_3", {"10.0.2.128/25", "172.16.0.0/12"}}});
+
+  EXPECT_EQ(std::vector<std::string>({"tag_1", "tag_2"}), tags("10.0.0.1"));
+  EXPECT_EQ(std::vector<std::string>({"tag_2"}), tags("10.0.1.1"));
+  EXPECT_EQ(std::vector<std::string>({"tag_1", "tag_2"}), tags("10.0.3.1"));
+  EXPECT_EQ(std::vector<std::string>({"tag_1", "tag_2", "tag_3"}), tags("10.0.2.200"));
+  EXPECT_EQ(std::vector<std::string>({"tag_2"}), tags("10.255.255.255"));
+  EXPECT_EQ(std::vector<std::string>({"tag_3"}), tags("172.31.0.1"));
+  EXPECT_EQ(std::vector<std::string>({"tag_1"}), tags("192.168.0.1"));
+  EXPECT_EQ(std::vector<std::string>(), tags("192.168.0.2"));
+  EXPECT_EQ(std::vector<std::string>(), tags("11.0.0.1"));
+  EXPECT_EQ(std::vector<std::string>(), tags("::1"));
+}
+
+TEST_F(LcTrieTest, Ipv6) {
+  setup({{"tag_1", {"2001:db8::/32", "::1/128"}},
+         {"tag_2", {"2001:db8:0:1::/64", "::/0"}},
+         {"tag_3", {"2001:db8::/32"}}});
+
+  EXPECT_EQ(std::vector<std::string>({"tag_1", "tag_2", "tag_3"}), tags("2001:db8::1"));
+  EXPECT_EQ(std::vector<std::string>({"tag_1", "tag_2", "tag_3"}), tags("2001:db8:0:1::1"));
+  EXPECT_EQ(std::vector<std::string>({"tag_1", "tag_2"}), tags("::1"));
+  EXPECT_EQ(std::vector<std::string>({"tag_2"}), tags("2001:db9::1"));
+  EXPECT_EQ(std::vector<std::string>(), tags("10.0.0.1"));
+}
+
+TEST_F(LcTrieTest, Empty) {
+  setup({});
+  EXPECT_EQ(std::vector<std::string>(), tags("10.0.0.1"));
+  EXPECT_EQ(std::vector<std::string>(), tags("::1"));
+
+  Address::PipeInstance pipe("/foo");
+  EXPECT_TRUE(trie_->getTags(pipe).empty());
+}
+
+// Compare the trie with a scan of the ranges for many ranges and addresses.
+TEST_F(LcTrieTest, ManyRanges) {
+  std::vector<std::pair<std::string, std::vector<Address::CidrRange>>> tag_data{
+      {"tag_0", {}}, {"tag_1", {}}, {"tag_2", {}}};
+  uint32_t seed = 1;
+  auto next = [&seed]() -> uint32_t {
+    seed = seed * 1103515245 + 12345;
+    return seed;
+  };
+  for (uint32_t i = 0; i < 3000; i++) {
+    const uint32_t ip = next();
+    const std::string address = fmt::format("{}.{}.{}.{}", ip >> 24, (ip >> 16) & 0xff,
+                                            (ip >> 8) & 0xf, ip & 0xff);
+    tag_data[i % 3].second.push_back(Address::CidrRange::create(address, 8 + next() % 25));
+  }
+  LcTrie trie(tag_data);
+
+  for (uint32_t i = 0; i < 3000; i++) {
+    const uint32_t ip = i % 2 == 0 ? next() : next() & 0xff0f0000;
+    const Address::Ipv4Instance address(fmt::format("{}.{}.{}.{}", ip >> 24, (ip >> 16) & 0xff,
+                                                    (ip >> 8) & 0xff, ip & 0xff));
+    std::vector<std::string> expected;
+    for (const auto& tag : tag_data) {
+      for (const Address::CidrRange& range : tag.second) {
+        if (range.isInRange(address)) {
+          expected.push_back(tag.first);
+          break;
+        }
+      }
+    }
+    EXPECT_EQ(expected, trie.getTags(address));
+  }
+}
+
+} // namespace LcTrie
+} // namespace Network
+} // namespace Envoy
@@ -1,4 +1,7 @@
+#include <vector>
+
 #include "common/network/address_impl.h"
+#include "common/network/connection_balancer_impl.h"
 #include "common/network/listener_impl.h"
 #include "common/network/utility.h"
 #include "common/stats/stats_impl.h"
@@ -137,6 +140,100 @@ TEST_P(ListenerImplTest, NormalRedirect) {
   dispatcher.run(Event::Dispatcher::RunType::Block);
 }
 
+// A connection accepted by a listener is handed over to the listener of the worker with fewer
+// connections by the connection balancer.
+TEST_P(ListenerImplTest, BalancedConnection) {
+  Stats::IsolatedStoreImpl stats_store;
+  Event::DispatcherImpl dispatcher;
+  ExactConnectionBalancerImpl balancer;
+  Network::TcpListenSocket socket(Network::Test::getCanonicalLoopbackAddress(version_), true);
+  Network::MockListenerCallbacks listener_callbacks1;
+  Network::MockConnectionHandler connection_handler1;
+  Network::TestListenerImpl listener1(connection_handler1, dispatcher, socket, listener_callbacks1,
+                                      stats_store,
+                                      {.bind_to_port_ = true,
+                                       .use_proxy_proto_ = false,
+                                       .use_original_dst_ = false,
+                                       .per_connection_buffer_limit_bytes_ = 0,
+                                       .connection_balancer_ = &balancer});
+  // The listener of the other worker does not accept connections itself, so that the connection
+  // can only reach it through the balancer.
+  Network::MockListenerCallbacks listener_callbacks2;
+  Network::MockConnectionHandler connection_handler2;
+  Network::TestListenerImpl listener2(connection_handler2, dispatcher, socket, listener_callbacks2,
+                                      stats_store,
+                                      {.bind_to_port_ = false,
+                                       .use_proxy_proto_ = false,
+                                       .use_original_dst_ = false,
+                                       .per_connection_buffer_limit_bytes_ = 0,
+                                       .connection_balancer_ = &balancer});
+
+  Network::ClientConnectionPtr client_connection = dispatcher.createClientConnection(
+      socket.localAddress(), Network::Address::InstanceConstSharedPtr(),
+      Network::Test::createRawBufferSocket());
+  client_connection->connect();
+
+  EXPECT_CALL(connection_handler1, numConnections()).WillRepeatedly(Return(5));
+  EXPECT_CALL(connection_handler2, numConnections()).WillRepeatedly(Return(2));
+  EXPECT_CALL(listener1, newConnection(_, _, _, _)).Times(0);
+  EXPECT_CALL(listener2, newConnection(_, _, _, _));
+  EXPECT_CALL(listener_callbacks2, onNewConnection_(_))
+      .WillOnce(Invoke([&](Network::ConnectionPtr& conn) -> void {
+        EXPECT_EQ(2UL, listener2.numConnections());
+        client_connection->close(ConnectionCloseType::NoFlush);
+        conn->close(ConnectionCloseType::NoFlush);
+        dispatcher.exit();
+      }));
+
+  dispatcher.run(Event::Dispatcher::RunType::Block);
+}
+
+// A listener accepts at most a batch of connections each time its socket is ready, and the rest on
+// the next iterations of the event loop.
+TEST_P(ListenerImplTest, AcceptBatch) {
+  Stats::IsolatedStoreImpl stats_store;
+  Event::DispatcherImpl dispatcher;
+  Network::TcpListenSocket socket(Network::Test::getCanonicalLoopbackAddress(version_), true);
+  Network::MockListenerCallbacks listener_callbacks;
+  Network::MockConnectionHandler connection_handler;
+  Network::ListenerPtr listener =
+      dispatcher.createListener(connection_handler, socket, listener_callbacks, stats_store,
+                                {.bind_to_port_ = true,
+                                 .use_proxy_proto_ = false,
+                                 .use_original_dst_ = false,
+                                 .per_connection_buffer_limit_bytes_ = 0,
+                                 .connection_balancer_ = nullptr,
+                                 .accept_batch_size_ = 2});
+
+  std::vector<Network::ClientConnectionPtr> client_connections;
+  for (int i = 0; i < 3; i++) {
+    client_connections.push_back(dispatcher.createClientConnection(
+        socket.localAddress(), Network::Address::InstanceConstSharedPtr(),
+        Network::Test::createRawBufferSocket()));
+    client_connections.back()->connect();
+  }
+
+  std::vector<Network::ConnectionPtr> server_connections;
+  EXPECT_CALL(listener_callbacks, onNewConnection_(_))
+      .Times(3)
+      .WillRepeatedly(Invoke([&](Network::ConnectionPtr& conn) -> void {
+        server_connections.push_back(std::move(conn));
+        if (server_connections.size() == 3) {
+          dispatcher.exit();
+        }
+      }));
+
+  dispatcher.run(Event::Dispatcher::RunType::Block);
+  EXPECT_EQ(1UL, stats_store.counter("downstream_cx_accept_batch_full").value());
+
+  for (Network::ConnectionPtr& conn : server_connections) {
+    conn->close(ConnectionCloseType::NoFlush);
+  }
+  for (Network::ClientConnectionPtr& client_connection : client_connections) {
+    client_connection->close(ConnectionCloseType::NoFlush);
+  }
+}
+
 TEST_P(ListenerImplTest, FallbackToWildcardListener) {
   Stats::IsolatedStoreImpl stats_store;
   Event::DispatcherImpl dispatcher;
@@ -283,6 +283,128 @@ TEST_P(ProxyProtocolTest, ClosedEmpty) {
   dispatcher_.run(Event::Dispatcher::RunType::NonBlock);
 }
 
+// The signature of V2 headers.
+static const std::string V2_SIGNATURE("\r\n\r\n\0\r\nQUIT\n", 12);
+
+TEST_P(ProxyProtocolTest, V2Basic) {
+  connect();
+  // PROXY over TCP/IPv4 from 1.2.3.4:65535 to 254.254.254.254:1234, with an ALPN TLV.
+  write(V2_SIGNATURE + std::string("\x21\x11\x00\x11"
+                                   "\x01\x02\x03\x04\xfe\xfe\xfe\xfe\xff\xff\x04\xd2"
+                                   "\x01\x00\x02h2",
+                                   21) +
+        "more data");
+
+  EXPECT_CALL(*read_filter_, onNewConnection());
+  EXPECT_CALL(*read_filter_, onData(_))
+      .WillOnce(Invoke([&](Buffer::Instance& buffer) -> FilterStatus {
+        EXPECT_EQ(server_connection_->remoteAddress()->asString(), "1.2.3.4:65535");
+        EXPECT_EQ(server_connection_->localAddress()->asString(), "254.254.254.254:1234");
+
+        EXPECT_EQ(TestUtility::bufferToString(buffer), "more data");
+        buffer.drain(9);
+        return Network::FilterStatus::Continue;
+      }));
+
+  dispatcher_.run(Event::Dispatcher::RunType::NonBlock);
+
+  disconnect();
+}
+
+TEST_P(ProxyProtocolTest, V2BasicV6) {
+  connect();
+  // PROXY over TCP/IPv6 from [1:2:3::4]:65535 to [5:6::7:8]:1234.
+  write(V2_SIGNATURE + std::string("\x21\x21\x00\x24"
+                                   "\x00\x01\x00\x02\x00\x03\x00\x00"
+                                   "\x00\x00\x00\x00\x00\x00\x00\x04"
+                                   "\x00\x05\x00\x06\x00\x00\x00\x00"
+                                   "\x00\x00\x00\x00\x00\x07\x00\x08"
+                                   "\xff\xff\x04\xd2",
+                                   40) +
+        "more data");
+
+  EXPECT_CALL(*read_filter_, onNewConnection());
+  EXPECT_CALL(*read_filter_, onData(_))
+      .WillOnce(Invoke([&](Buffer::Instance& buffer) -> FilterStatus {
+        EXPECT_EQ(server_connection_->remoteAddress()->asString(), "[1:2:3::4]:65535");
+        EXPECT_EQ(server_connection_->localAddress()->asString(), "[5:6::7:8]:1234");
+
+        EXPECT_EQ(TestUtility::bufferToString(buffer), "more data");
+        buffer.drain(9);
+        return Network::FilterStatus::Continue;
+      }));
+
+  dispatcher_.run(Event::Dispatcher::RunType::NonBlock);
+
+  disconnect();
+}
+
+TEST_P(ProxyProtocolTest, V2Local) {
+  connect();
+  // LOCAL connections of the proxy keep their own addresses, and may carry addresses anyway.
+  write(V2_SIGNATURE + std::string("\x20\x11\x00\x0c"
+                                   "\x01\x02\x03\x04\xfe\xfe\xfe\xfe\xff\xff\x04\xd2",
+                                   16) +
+        "more data");
+
+  EXPECT_CALL(*read_filter_, onNewConnection());
+  EXPECT_CALL(*read_filter_, onData(_))
+      .WillOnce(Invoke([&](Buffer::Instance& buffer) -> FilterStatus {
+        EXPECT_EQ(server_connection_->remoteAddress()->ip()->addressAsString(),
+                  Network::Test::getLoopbackAddressString(GetParam()));
+
+        EXPECT_EQ(TestUtility::bufferToString(buffer), "more data");
+        buffer.drain(9);
+        return Network::FilterStatus::Continue;
+      }));
+
+  dispatcher_.run(Event::Dispatcher::RunType::NonBlock);
+
+  disconnect();
+}
+
+TEST_P(ProxyProtocolTest, V2PartialRead) {
+  connect();
+
+  write(V2_SIGNATURE.substr(0, 7));
+  dispatcher_.run(Event::Dispatcher::RunType::NonBlock);
+  write(V2_SIGNATURE.substr(7) + std::string("\x21\x11\x00\x0c\xfe\xfe", 6));
+  dispatcher_.run(Event::Dispatcher::RunType::NonBlock);
+  write(std::string("\xfe\xfe\x01\x02\x03\x04\xff\xff\x04\xd2", 10));
+  dispatcher_.run(Event::Dispatcher::RunType::NonBlock);
+
+  disconnect();
+
+  EXPECT_EQ(server_connection_->remoteAddress()->ip()->addressAsString(), "254.254.254.254");
+}
+
+TEST_P(ProxyProtocolTest, V2BadSignature) {
+  connectNoRead();
+  write(std::string("\r\n\r\n\0\r\nQUIX\n\x21\x11\x00\x0c", 16));
+  expectProxyProtoError();
+}
+
+TEST_P(ProxyProtocolTest, V2BadVersion) {
+  connectNoRead();
+  write(V2_SIGNATURE + std::string("\x11\x11\x00\x00", 4));
+  expectProxyProtoError();
+}
+
+TEST_P(ProxyProtocolTest, V2ShortAddresses) {
+  connectNoRead();
+  write(V2_SIGNATURE + std::string("\x21\x11\x00\x08\x01\x02\x03\x04\xfe\xfe\xfe\xfe", 12));
+  expectProxyProtoError();
+}
+
+TEST_P(ProxyProtocolTest, V2TruncatedTlv) {
+  connectNoRead();
+  write(V2_SIGNATURE + std::string("\x21\x11\x00\x0f"
+                                   "\x01\x02\x03\x04\xfe\xfe\xfe\xfe\xff\xff\x04\xd2"
+                                   "\x01\x00\x02",
+                                   19));
+  expectProxyProtoError();
+}
+
 class WildcardProxyProtocolTest : public testing::TestWithParam<Address::IpVersion> {
 public:
   WildcardProxyProtocolTest()
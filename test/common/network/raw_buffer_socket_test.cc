@@ -0,0 +1,110 @@
+#include <fcntl.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <string>
+
+#include "common/buffer/buffer_impl.h"
+#include "common/network/raw_buffer_socket.h"
+
+#include "test/mocks/network/mocks.h"
+
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+
+using testing::NiceMock;
+using testing::Return;
+
+namespace Envoy {
+namespace Network {
+
+class RawBufferSocketTest : public testing::Test {
+public:
+  RawBufferSocketTest() {
+    EXPECT_EQ(0, socketpair(AF_UNIX, SOCK_STREAM, 0, fds_));
+    EXPECT_NE(-1, fcntl(fds_[0], F_SETFL, O_NONBLOCK));
+    ON_CALL(callbacks_, fd()).WillByDefault(Return(fds_[0]));
+    socket_.setTransportSocketCallbacks(callbacks_);
+  }
+
+  ~RawBufferSocketTest() {
+    close(fds_[0]);
+    if (fds_[1] != -1) {
+      close(fds_[1]);
+    }
+  }
+
+  void writePeer(uint64_t size) {
+    const std::string data(size, 'a');
+    ASSERT_EQ(static_cast<ssize_t>(size), ::write(fds_[1], data.data(), size));
+  }
+
+  int fds_[2];
+  NiceMock<MockTransportSocketCallbacks> callbacks_;
+  RawBufferSocket socket_;
+  Buffer::OwnedImpl buffer_;
+};
+
+TEST_F(RawBufferSocketTest, ReadSizeGrowsOnFullReads) {
+  EXPECT_EQ(RawBufferSocket::INITIAL_READ_SIZE, socket_.readSizeForTest());
+  // Reads of 16K, 32K and 64K, each of which fills the read size.
+  writePeer(112 * 1024);
+  IoResult result = socket_.doRead(buffer_);
+  EXPECT_EQ(PostIoAction::KeepOpen, result.action_);
+  EXPECT_EQ(112 * 1024, result.bytes_processed_);
+  EXPECT_EQ(RawBufferSocket::MAX_READ_SIZE, socket_.readSizeForTest());
+}
+
+TEST_F(RawBufferSocketTest, ReadSizeShrinksOnSmallReads) {
+  writePeer(100);
+  socket_.doRead(buffer_);
+  EXPECT_EQ(RawBufferSocket::INITIAL_READ_SIZE / 2, socket_.readSizeForTest());
+
+  writePeer(100);
+  socket_.doRead(buffer_);
+  EXPECT_EQ(RawBufferSocket::MIN_READ_SIZE, socket_.readSizeForTest());
+
+  writePeer(100);
+  socket_.doRead(buffer_);
+  EXPECT_EQ(RawBufferSocket::MIN_READ_SIZE, socket_.readSizeForTest());
+  EXPECT_EQ(300, buffer_.length());
+}
+
+TEST_F(RawBufferSocketTest, ReadSizeKeptForMediumReads) {
+  writePeer(RawBufferSocket::INITIAL_READ_SIZE / 2);
+  socket_.doRead(buffer_);
+  EXPECT_EQ(RawBufferSocket::INITIAL_READ_SIZE, socket_.readSizeForTest());
+}
+
+TEST_F(RawBufferSocketTest, ReadSizeLimitedByBufferLimit) {
+  ON_CALL(callbacks_.connection_, bufferLimit()).WillByDefault(Return(20000));
+  writePeer(112 * 1024);
+  socket_.doRead(buffer_);
+  EXPECT_EQ(20000, socket_.readSizeForTest());
+}
+
+TEST_F(RawBufferSocketTest, InitialReadSizeLimitedByBufferLimit) {
+  ON_CALL(callbacks_.connection_, bufferLimit()).WillByDefault(Return(8192));
+  writePeer(8192);
+  IoResult result = socket_.doRead(buffer_);
+  EXPECT_EQ(8192, result.bytes_processed_);
+  EXPECT_EQ(8192, socket_.readSizeForTest());
+
+  // The read size never goes below the minimum whatever the limit.
+  ON_CALL(callbacks_.connection_, bufferLimit()).WillByDefault(Return(100));
+  writePeer(100);
+  socket_.doRead(buffer_);
+  EXPECT_EQ(RawBufferSocket::MIN_READ_SIZE, socket_.readSizeForTest());
+}
+
+TEST_F(RawBufferSocketTest, RemoteClose) {
+  writePeer(10);
+  close(fds_[1]);
+  fds_[1] = -1;
+  IoResult result = socket_.doRead(buffer_);
+  EXPECT_EQ(PostIoAction::Close, result.action_);
+  EXPECT_EQ(10, result.bytes_processed_);
+}
+
+} // namespace Network
+} // namespace Envoy
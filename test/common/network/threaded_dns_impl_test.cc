@@ -0,0 +1,167 @@
+#include <functional>
+#include <future>
+#include <list>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "common/common/thread.h"
+#include "common/common/utility.h"
+#include "common/event/dispatcher_impl.h"
+#include "common/network/threaded_dns_impl.h"
+#include "common/network/utility.h"
+#include "common/stats/stats_impl.h"
+
+#include "server/guarddog_impl.h"
+
+#include "test/mocks/network/mocks.h"
+#include "test/mocks/server/mocks.h"
+#include "test/mocks/stats/mocks.h"
+
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+
+using testing::Invoke;
+using testing::NiceMock;
+using testing::_;
+
+namespace Envoy {
+namespace Network {
+
+class ThreadedDnsResolverImplTest : public testing::Test {
+protected:
+  ThreadedDnsResolverImplTest()
+      : config_(1000, 1000, 1000, 1000), guard_dog_(fakestats_, config_, time_source_),
+        inner_(std::make_shared<NiceMock<MockDnsResolver>>()) {
+    ON_CALL(*inner_, resolve(_, _, _))
+        .WillByDefault(Invoke([this](const std::string& dns_name, DnsLookupFamily,
+                                     DnsResolver::ResolveCb callback) -> ActiveDnsQuery* {
+          resolved_.push_back(dns_name);
+          callbacks_.push_back(callback);
+          return &inner_->active_query_;
+        }));
+  }
+
+  void setup(uint32_t max_concurrent_queries) {
+    resolver_.reset(new ThreadedDnsResolverImpl(
+        dispatcher_, max_concurrent_queries, [this](Event::Dispatcher& dispatcher) {
+          thread_dispatcher_ = &dispatcher;
+          return inner_;
+        }));
+    resolver_->initializeStats(stats_store_, "dns.");
+    resolver_->start(guard_dog_);
+  }
+
+  // Run a function on the DNS thread once it handled the queries and cancellations made before.
+  void runOnThread(std::function<void()> cb) {
+    std::promise<void> done;
+    thread_dispatcher_->post([&]() -> void {
+      cb();
+      done.set_value();
+    });
+    done.get_future().wait();
+  }
+
+  DnsResolver::ResolveCb exitCallback(std::list<Address::InstanceConstSharedPtr>& results) {
+    return [this, &results](std::list<Address::InstanceConstSharedPtr>&& r) -> void {
+      results = std::move(r);
+      dispatcher_.exit();
+    };
+  }
+
+  NiceMock<Server::Configuration::MockMain> config_;
+  NiceMock<Stats::MockStore> fakestats_;
+  ProdMonotonicTimeSource time_source_;
+  Server::GuardDogImpl guard_dog_;
+  Stats::IsolatedStoreImpl stats_store_;
+  Event::DispatcherImpl dispatcher_;
+  std::shared_ptr<NiceMock<MockDnsResolver>> inner_;
+  // Only accessed on the DNS thread.
+  std::vector<std::string> resolved_;
+  std::vector<DnsResolver::ResolveCb> callbacks_;
+  Event::Dispatcher* thread_dispatcher_{};
+  std::unique_ptr<ThreadedDnsResolverImpl> resolver_;
+};
+
+// Validate that names are resolved on the DNS thread and answered on the dispatcher of the caller.
+TEST_F(ThreadedDnsResolverImplTest, ResolveOnThread) {
+  const Thread::ThreadId main_thread = Thread::Thread::currentThreadId();
+  Thread::ThreadId resolve_thread{};
+  EXPECT_CALL(*inner_, resolve("foo.example", DnsLookupFamily::V4Only, _))
+      .WillOnce(Invoke([&](const std::string&, DnsLookupFamily,
+                           DnsResolver::ResolveCb callback) -> ActiveDnsQuery* {
+        resolve_thread = Thread::Thread::currentThreadId();
+        callback({Utility::parseInternetAddress("1.2.3.4")});
+        return nullptr;
+      }));
+  setup(0);
+
+  std::list<Address::InstanceConstSharedPtr> results;
+  Thread::ThreadId callback_thread{};
+  ActiveDnsQuery* query = resolver_->resolve(
+      "foo.example", DnsLookupFamily::V4Only,
+      [&](std::list<Address::InstanceConstSharedPtr>&& r) -> void {
+        callback_thread = Thread::Thread::currentThreadId();
+        results = std::move(r);
+        dispatcher_.exit();
+      });
+  EXPECT_NE(nullptr, query);
+  dispatcher_.run(Event::Dispatcher::RunType::Block);
+
+  ASSERT_EQ(1U, results.size());
+  EXPECT_EQ("1.2.3.4:0", results.front()->asString());
+  EXPECT_NE(main_thread, resolve_thread);
+  EXPECT_EQ(main_thread, callback_thread);
+}
+
+// Validate that queries beyond the limit wait until a query completes.
+TEST_F(ThreadedDnsResolverImplTest, MaxConcurrentQueries) {
+  setup(1);
+  std::list<Address::InstanceConstSharedPtr> results_a;
+  std::list<Address::InstanceConstSharedPtr> results_b;
+  resolver_->resolve("a.example", DnsLookupFamily::V4Only, exitCallback(results_a));
+  resolver_->resolve("b.example", DnsLookupFamily::V4Only, exitCallback(results_b));
+
+  runOnThread([this]() -> void {
+    EXPECT_EQ(std::vector<std::string>{"a.example"}, resolved_);
+    EXPECT_EQ(1UL, stats_store_.gauge("dns.active").value());
+    EXPECT_EQ(1UL, stats_store_.gauge("dns.queued").value());
+    callbacks_[0]({Utility::parseInternetAddress("1.2.3.4")});
+    EXPECT_EQ((std::vector<std::string>{"a.example", "b.example"}), resolved_);
+  });
+  dispatcher_.run(Event::Dispatcher::RunType::Block);
+  ASSERT_EQ(1U, results_a.size());
+  EXPECT_TRUE(results_b.empty());
+
+  runOnThread([this]() -> void { callbacks_[1]({Utility::parseInternetAddress("5.6.7.8")}); });
+  dispatcher_.run(Event::Dispatcher::RunType::Block);
+  ASSERT_EQ(1U, results_b.size());
+  EXPECT_EQ(1UL, stats_store_.counter("dns.throttled").value());
+  EXPECT_EQ(0UL, stats_store_.gauge("dns.active").value());
+  EXPECT_EQ(0UL, stats_store_.gauge("dns.queued").value());
+}
+
+// Validate that cancelled queries free their slot and are never answered.
+TEST_F(ThreadedDnsResolverImplTest, Cancel) {
+  setup(1);
+  auto fail = [](std::list<Address::InstanceConstSharedPtr> &&) -> void { FAIL(); };
+  ActiveDnsQuery* query_a = resolver_->resolve("a.example", DnsLookupFamily::V4Only, fail);
+  ActiveDnsQuery* query_b = resolver_->resolve("b.example", DnsLookupFamily::V4Only, fail);
+  runOnThread([]() -> void {});
+
+  EXPECT_CALL(inner_->active_query_, cancel());
+  query_b->cancel();
+  query_a->cancel();
+  std::list<Address::InstanceConstSharedPtr> results;
+  resolver_->resolve("c.example", DnsLookupFamily::V4Only, exitCallback(results));
+
+  runOnThread([this]() -> void {
+    EXPECT_EQ((std::vector<std::string>{"a.example", "c.example"}), resolved_);
+    callbacks_[1]({Utility::parseInternetAddress("1.2.3.4")});
+  });
+  dispatcher_.run(Event::Dispatcher::RunType::Block);
+  EXPECT_EQ(1U, results.size());
+}
+
+} // namespace Network
+} // namespace Envoy
@@ -1,3 +1,8 @@
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
 #include <cstdint>
 #include <list>
 #include <string>
@@ -273,5 +278,49 @@ TEST(PortRangeListTest, Normal) {
   }
 }
 
+TEST(NetworkUtility, TcpFastOpen) {
+  const int fd = Test::getCanonicalLoopbackAddress(Address::IpVersion::v4)
+                     ->socket(Address::SocketType::Stream);
+  ASSERT_NE(-1, fd);
+  EXPECT_TRUE(Utility::setTcpFastOpen(fd, 16));
+
+  int value = 0;
+  socklen_t value_len = sizeof(value);
+  EXPECT_EQ(0, getsockopt(fd, IPPROTO_TCP, TCP_FASTOPEN, &value, &value_len));
+  EXPECT_EQ(16, value);
+  ::close(fd);
+}
+
+#ifdef TCP_DEFER_ACCEPT
+TEST(NetworkUtility, TcpDeferAccept) {
+  const int fd = Test::getCanonicalLoopbackAddress(Address::IpVersion::v4)
+                     ->socket(Address::SocketType::Stream);
+  ASSERT_NE(-1, fd);
+  EXPECT_TRUE(Utility::setTcpDeferAccept(fd, 1));
+
+  // The kernel rounds the timeout to a number of SYN-ACK retransmissions.
+  int value = 0;
+  socklen_t value_len = sizeof(value);
+  EXPECT_EQ(0, getsockopt(fd, IPPROTO_TCP, TCP_DEFER_ACCEPT, &value, &value_len));
+  EXPECT_LT(0, value);
+  ::close(fd);
+}
+#endif
+
+#ifdef SO_INCOMING_CPU
+TEST(NetworkUtility, SetIncomingCpu) {
+  const int fd = Test::getCanonicalLoopbackAddress(Address::IpVersion::v4)
+                     ->socket(Address::SocketType::Stream);
+  ASSERT_NE(-1, fd);
+  EXPECT_TRUE(Utility::setIncomingCpu(fd, 0));
+
+  int value = -1;
+  socklen_t value_len = sizeof(value);
+  EXPECT_EQ(0, getsockopt(fd, SOL_SOCKET, SO_INCOMING_CPU, &value, &value_len));
+  EXPECT_EQ(0, value);
+  ::close(fd);
+}
+#endif
+
 } // namespace Network
 } // namespace Envoy
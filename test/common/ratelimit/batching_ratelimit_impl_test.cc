@@ -0,0 +1,151 @@
+#include <chrono>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "common/ratelimit/batching_ratelimit_impl.h"
+#include "common/stats/stats_impl.h"
+
+#include "test/mocks/common.h"
+#include "test/mocks/event/mocks.h"
+#include "test/mocks/grpc/mocks.h"
+#include "test/mocks/thread_local/mocks.h"
+#include "test/mocks/tracing/mocks.h"
+#include "test/test_common/utility.h"
+
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+
+using testing::Invoke;
+using testing::NiceMock;
+using testing::Return;
+using testing::_;
+
+namespace Envoy {
+namespace RateLimit {
+
+class MockRequestCallbacks : public RequestCallbacks {
+public:
+  MOCK_METHOD1(complete, void(LimitStatus status));
+};
+
+class BatchingRateLimitTest : public testing::Test {
+public:
+  BatchingRateLimitTest() {
+    ON_CALL(time_source_, currentTime()).WillByDefault(Return(now_));
+    flush_timer_ = new Event::MockTimer(&tls_.dispatcher_);
+    factory_.reset(new BatchingFactoryImpl(
+        [this]() -> RateLimitAsyncClientPtr {
+          async_client_ = new Grpc::MockAsyncClient<pb::lyft::ratelimit::RateLimitRequest,
+                                                    pb::lyft::ratelimit::RateLimitResponse>();
+          return RateLimitAsyncClientPtr{async_client_};
+        },
+        cache_, std::chrono::milliseconds(50), tls_, stats_store_));
+  }
+
+  void expectRequest(const std::string& domain, const Descriptor& descriptor, uint32_t hits,
+                     RateLimitAsyncCallbacks*& callbacks) {
+    pb::lyft::ratelimit::RateLimitRequest request;
+    GrpcClientImpl::createRequest(request, domain, {descriptor});
+    request.set_hits_addend(hits);
+    EXPECT_CALL(*async_client_, send(_, ProtoEq(request), _, _, _))
+        .WillOnce(Invoke([this, &callbacks](const Protobuf::MethodDescriptor&,
+                                            const pb::lyft::ratelimit::RateLimitRequest&,
+                                            RateLimitAsyncCallbacks& request_callbacks,
+                                            Tracing::Span&,
+                                            const Optional<std::chrono::milliseconds>& timeout)
+                             -> Grpc::AsyncRequest* {
+          EXPECT_EQ(std::chrono::milliseconds(50), timeout.value());
+          callbacks = &request_callbacks;
+          return &async_request_;
+        }));
+  }
+
+  std::unique_ptr<pb::lyft::ratelimit::RateLimitResponse>
+  response(pb::lyft::ratelimit::RateLimitResponse::Code code) {
+    std::unique_ptr<pb::lyft::ratelimit::RateLimitResponse> response(
+        new pb::lyft::ratelimit::RateLimitResponse());
+    response->set_overall_code(code);
+    response->add_statuses()->set_code(code);
+    return response;
+  }
+
+  const MonotonicTime now_{std::chrono::seconds(1000)};
+  NiceMock<MockMonotonicTimeSource> time_source_;
+  Stats::IsolatedStoreImpl stats_store_;
+  OverLimitCacheSharedPtr cache_{
+      std::make_shared<OverLimitCache>(std::chrono::seconds(1), stats_store_, time_source_)};
+  NiceMock<ThreadLocal::MockInstance> tls_;
+  Event::MockTimer* flush_timer_;
+  Grpc::MockAsyncClient<pb::lyft::ratelimit::RateLimitRequest,
+                        pb::lyft::ratelimit::RateLimitResponse>* async_client_{};
+  Grpc::MockAsyncRequest async_request_;
+  std::unique_ptr<BatchingFactoryImpl> factory_;
+  MockRequestCallbacks request_callbacks_;
+  NiceMock<Tracing::MockSpan> span_;
+};
+
+TEST_F(BatchingRateLimitTest, FlushHits) {
+  ClientPtr client = factory_->create(Optional<std::chrono::milliseconds>());
+  const Descriptor foo{{{"foo", "bar"}}};
+  const Descriptor baz{{{"baz", "qux"}}};
+
+  // Requests are allowed while their hits are collected, and the timer is armed on the first hit.
+  EXPECT_CALL(*flush_timer_, enableTimer(std::chrono::milliseconds(50)));
+  EXPECT_CALL(request_callbacks_, complete(LimitStatus::OK)).Times(3);
+  client->limit(request_callbacks_, "domain", {foo}, span_);
+  client->limit(request_callbacks_, "domain", {foo, baz}, span_);
+  client->limit(request_callbacks_, "domain", {foo}, span_);
+  EXPECT_EQ(3UL, stats_store_.counter("ratelimit.batch.hits").value());
+
+  // One call per descriptor with the hits since the last flush.
+  RateLimitAsyncCallbacks* foo_callbacks{};
+  RateLimitAsyncCallbacks* baz_callbacks{};
+  expectRequest("domain", foo, 3, foo_callbacks);
+  expectRequest("domain", baz, 1, baz_callbacks);
+  flush_timer_->callback_();
+  EXPECT_EQ(2UL, stats_store_.counter("ratelimit.batch.rpc").value());
+
+  // Descriptors the service finds over limit are cached, and requests with them are over limit.
+  foo_callbacks->onSuccess(response(pb::lyft::ratelimit::RateLimitResponse_Code_OVER_LIMIT),
+                           span_);
+  baz_callbacks->onFailure(Grpc::Status::Unavailable, "", span_);
+  EXPECT_EQ(1UL, stats_store_.counter("ratelimit.batch.rpc_error").value());
+
+  EXPECT_CALL(span_, setTag("ratelimit_status", "over_limit"));
+  EXPECT_CALL(request_callbacks_, complete(LimitStatus::OverLimit));
+  client->limit(request_callbacks_, "domain", {baz, foo}, span_);
+
+  EXPECT_CALL(*flush_timer_, enableTimer(_));
+  EXPECT_CALL(request_callbacks_, complete(LimitStatus::OK));
+  client->limit(request_callbacks_, "domain", {baz}, span_);
+  EXPECT_EQ(4UL, stats_store_.counter("ratelimit.batch.hits").value());
+
+  // Calls still in flight at shutdown are reset with the gRPC client.
+  expectRequest("domain", baz, 1, baz_callbacks);
+  flush_timer_->callback_();
+  tls_.shutdownThread();
+}
+
+TEST_F(BatchingRateLimitTest, FailToStart) {
+  ClientPtr client = factory_->create(Optional<std::chrono::milliseconds>());
+
+  EXPECT_CALL(request_callbacks_, complete(LimitStatus::OK));
+  client->limit(request_callbacks_, "domain", {{{{"foo", "bar"}}}}, span_);
+
+  EXPECT_CALL(*async_client_, send(_, _, _, _, _))
+      .WillOnce(Invoke([this](const Protobuf::MethodDescriptor&,
+                              const pb::lyft::ratelimit::RateLimitRequest&,
+                              RateLimitAsyncCallbacks& callbacks, Tracing::Span&,
+                              const Optional<std::chrono::milliseconds>&) -> Grpc::AsyncRequest* {
+        callbacks.onFailure(Grpc::Status::Unavailable, "", span_);
+        return nullptr;
+      }));
+  flush_timer_->callback_();
+  EXPECT_EQ(1UL, stats_store_.counter("ratelimit.batch.rpc_error").value());
+
+  client->cancel();
+}
+
+} // namespace RateLimit
+} // namespace Envoy
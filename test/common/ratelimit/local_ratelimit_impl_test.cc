@@ -0,0 +1,165 @@
+#include <chrono>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "common/json/json_loader.h"
+#include "common/ratelimit/local_ratelimit_impl.h"
+#include "common/stats/stats_impl.h"
+
+#include "test/mocks/common.h"
+#include "test/mocks/ratelimit/mocks.h"
+#include "test/mocks/tracing/mocks.h"
+
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+
+using testing::NiceMock;
+using testing::Ref;
+using testing::Return;
+using testing::_;
+
+namespace Envoy {
+namespace RateLimit {
+
+class MockRequestCallbacks : public RequestCallbacks {
+public:
+  MOCK_METHOD1(complete, void(LimitStatus status));
+};
+
+TEST(TokenBucketTest, TakeAndRefill) {
+  TokenBucket bucket(10, 4);
+  const MonotonicTime start{std::chrono::seconds(1000)};
+
+  EXPECT_DOUBLE_EQ(0.75, bucket.take(start));
+  EXPECT_DOUBLE_EQ(0.5, bucket.take(start));
+  EXPECT_DOUBLE_EQ(0.25, bucket.take(start));
+  EXPECT_DOUBLE_EQ(0, bucket.take(start));
+  EXPECT_LT(bucket.take(start), 0);
+
+  // One token every 100ms.
+  EXPECT_LT(bucket.take(start + std::chrono::milliseconds(99)), 0);
+  EXPECT_DOUBLE_EQ(0, bucket.take(start + std::chrono::milliseconds(100)));
+
+  // The bucket does not fill beyond its size.
+  EXPECT_DOUBLE_EQ(0.75, bucket.take(start + std::chrono::seconds(10)));
+}
+
+class LocalRateLimiterTest : public testing::Test {
+public:
+  LocalRateLimiterTest() { ON_CALL(time_source_, currentTime()).WillByDefault(Return(now_)); }
+
+  void setup(const std::string& json) {
+    Json::ObjectSharedPtr config = Json::Factory::loadFromString(json);
+    limiter_ = std::make_shared<LocalRateLimiter>(*config, stats_store_, time_source_);
+  }
+
+  const std::string config_ = R"EOF(
+  {
+    "near_limit_ratio": 0.5,
+    "limits": [
+      {
+        "domain": "foo",
+        "descriptor": [{"key": "remote_address", "value": "10.0.0.1"}],
+        "tokens_per_second": 1,
+        "max_tokens": 4
+      },
+      {
+        "domain": "foo",
+        "descriptor": [{"key": "route", "value": "a"}, {"key": "method", "value": "GET"}],
+        "tokens_per_second": 1,
+        "max_tokens": 100
+      }
+    ]
+  }
+  )EOF";
+
+  const MonotonicTime now_{std::chrono::seconds(1000)};
+  NiceMock<MockMonotonicTimeSource> time_source_;
+  Stats::IsolatedStoreImpl stats_store_;
+  LocalRateLimiterSharedPtr limiter_;
+};
+
+TEST_F(LocalRateLimiterTest, BadConfig) {
+  EXPECT_THROW(setup(R"EOF({"limits": [{"domain": "foo"}]})EOF"), Json::Exception);
+  EXPECT_THROW(setup(R"EOF(
+  {
+    "limits": [
+      {"domain": "foo", "descriptor": [{"key": "a", "value": "b"}], "tokens_per_second": 1,
+       "max_tokens": 1},
+      {"domain": "foo", "descriptor": [{"key": "a", "value": "b"}], "tokens_per_second": 2,
+       "max_tokens": 2}
+    ]
+  }
+  )EOF"),
+               EnvoyException);
+}
+
+TEST_F(LocalRateLimiterTest, NoLimits) {
+  setup(R"EOF({"over_limit_cache_ms": 100, "batch_flush_interval_ms": 10})EOF");
+  EXPECT_EQ(LocalRateLimiter::Result::Global, limiter_->check("foo", {{{{"foo", "bar"}}}}));
+}
+
+TEST_F(LocalRateLimiterTest, Check) {
+  setup(config_);
+  const std::vector<Descriptor> address{{{{"remote_address", "10.0.0.1"}}}};
+
+  // Plenty of tokens, then near the limit, then over it.
+  EXPECT_EQ(LocalRateLimiter::Result::OK, limiter_->check("foo", address));
+  EXPECT_EQ(LocalRateLimiter::Result::OK, limiter_->check("foo", address));
+  EXPECT_EQ(LocalRateLimiter::Result::Global, limiter_->check("foo", address));
+  EXPECT_EQ(LocalRateLimiter::Result::Global, limiter_->check("foo", address));
+  EXPECT_EQ(LocalRateLimiter::Result::OverLimit, limiter_->check("foo", address));
+
+  // Descriptors of other domains, or without a local limit, are left to the global service.
+  EXPECT_EQ(LocalRateLimiter::Result::Global, limiter_->check("bar", address));
+  EXPECT_EQ(LocalRateLimiter::Result::Global,
+            limiter_->check("foo", {{{{"remote_address", "10.0.0.2"}}}}));
+  EXPECT_EQ(LocalRateLimiter::Result::Global, limiter_->check("foo", {{{{"route", "a"}}}}));
+
+  // Every descriptor of a request has to be decided locally.
+  const std::vector<Descriptor> route{{{{"route", "a"}, {"method", "GET"}}}};
+  EXPECT_EQ(LocalRateLimiter::Result::OK, limiter_->check("foo", route));
+  EXPECT_EQ(LocalRateLimiter::Result::Global,
+            limiter_->check("foo", {route[0], {{{"remote_address", "10.0.0.2"}}}}));
+  EXPECT_EQ(LocalRateLimiter::Result::OverLimit, limiter_->check("foo", {route[0], address[0]}));
+
+  EXPECT_EQ(3U, stats_store_.counter("ratelimit.local.ok").value());
+  EXPECT_EQ(6U, stats_store_.counter("ratelimit.local.global").value());
+  EXPECT_EQ(2U, stats_store_.counter("ratelimit.local.over_limit").value());
+
+  // Tokens are back as time passes.
+  ON_CALL(time_source_, currentTime()).WillByDefault(Return(now_ + std::chrono::seconds(4)));
+  EXPECT_EQ(LocalRateLimiter::Result::OK, limiter_->check("foo", address));
+}
+
+TEST_F(LocalRateLimiterTest, Client) {
+  setup(config_);
+  MockClient* global_client = new MockClient();
+  LocalClientImpl client(limiter_, ClientPtr{global_client});
+  MockRequestCallbacks callbacks;
+  NiceMock<Tracing::MockSpan> span;
+  const std::vector<Descriptor> address{{{{"remote_address", "10.0.0.1"}}}};
+
+  // Decided locally while the bucket has plenty of tokens.
+  EXPECT_CALL(*global_client, limit(_, _, _, _)).Times(0);
+  EXPECT_CALL(callbacks, complete(LimitStatus::OK)).Times(2);
+  client.limit(callbacks, "foo", address, span);
+  client.limit(callbacks, "foo", address, span);
+
+  // Near the limit, the global service decides, and its calls can be cancelled.
+  EXPECT_CALL(*global_client, limit(Ref(callbacks), "foo", address, Ref(span))).Times(2);
+  client.limit(callbacks, "foo", address, span);
+  EXPECT_CALL(*global_client, cancel());
+  client.cancel();
+  client.limit(callbacks, "foo", address, span);
+
+  // Over the limit without asking the global service.
+  EXPECT_CALL(*global_client, limit(_, _, _, _)).Times(0);
+  EXPECT_CALL(span, setTag("ratelimit_status", "over_limit"));
+  EXPECT_CALL(callbacks, complete(LimitStatus::OverLimit));
+  client.limit(callbacks, "foo", address, span);
+}
+
+} // namespace RateLimit
+} // namespace Envoy
@@ -5,7 +5,9 @@
 #include "common/http/header_map_impl.h"
 #include "common/http/headers.h"
 #include "common/ratelimit/ratelimit_impl.h"
+#include "common/stats/stats_impl.h"
 
+#include "test/mocks/common.h"
 #include "test/mocks/grpc/mocks.h"
 #include "test/mocks/upstream/mocks.h"
 #include "test/test_common/printers.h"
@@ -16,6 +18,7 @@
 
 using testing::AtLeast;
 using testing::Invoke;
+using testing::NiceMock;
 using testing::Ref;
 using testing::Return;
 using testing::WithArg;
@@ -123,6 +126,85 @@ TEST_F(RateLimitGrpcClientTest, Cancel) {
   client_.cancel();
 }
 
+class OverLimitCacheTest : public testing::Test {
+public:
+  OverLimitCacheTest() {
+    ON_CALL(time_source_, currentTime()).WillByDefault(testing::ReturnPointee(&now_));
+  }
+
+  MonotonicTime now_{std::chrono::seconds(1000)};
+  NiceMock<MockMonotonicTimeSource> time_source_;
+  Stats::IsolatedStoreImpl stats_store_;
+  OverLimitCacheSharedPtr cache_{
+      std::make_shared<OverLimitCache>(std::chrono::milliseconds(100), stats_store_, time_source_)};
+};
+
+TEST_F(OverLimitCacheTest, InsertAndExpire) {
+  EXPECT_FALSE(cache_->overLimit("foo", {{{{"foo", "bar"}}}}));
+
+  cache_->insert(descriptorKey("foo", {{"foo", "bar"}}));
+  EXPECT_TRUE(cache_->overLimit("foo", {{{{"foo", "bar"}}}}));
+  EXPECT_TRUE(cache_->overLimit("foo", {{{{"foo", "baz"}}}, {{{"foo", "bar"}}}}));
+  EXPECT_FALSE(cache_->overLimit("foo", {{{{"foo", "baz"}}}}));
+  EXPECT_FALSE(cache_->overLimit("bar", {{{{"foo", "bar"}}}}));
+  EXPECT_FALSE(cache_->overLimit("foo", {{{{"foo", "bar"}, {"bar", "baz"}}}}));
+  EXPECT_EQ(2UL, stats_store_.counter("ratelimit.over_limit_cache.hit").value());
+
+  now_ += std::chrono::milliseconds(99);
+  EXPECT_TRUE(cache_->overLimit("foo", {{{{"foo", "bar"}}}}));
+  now_ += std::chrono::milliseconds(1);
+  EXPECT_FALSE(cache_->overLimit("foo", {{{{"foo", "bar"}}}}));
+  EXPECT_EQ(1UL, stats_store_.counter("ratelimit.over_limit_cache.insert").value());
+}
+
+TEST_F(OverLimitCacheTest, Full) {
+  for (size_t i = 0; i < OverLimitCache::MAX_ENTRIES; i++) {
+    cache_->insert(descriptorKey("foo", {{"foo", std::to_string(i)}}));
+  }
+  cache_->insert(descriptorKey("foo", {{"foo", "bar"}}));
+  EXPECT_FALSE(cache_->overLimit("foo", {{{{"foo", "bar"}}}}));
+  EXPECT_EQ(1UL, stats_store_.counter("ratelimit.over_limit_cache.full").value());
+
+  // Expired entries make room.
+  now_ += std::chrono::milliseconds(100);
+  cache_->insert(descriptorKey("foo", {{"foo", "bar"}}));
+  EXPECT_TRUE(cache_->overLimit("foo", {{{{"foo", "bar"}}}}));
+  EXPECT_FALSE(cache_->overLimit("foo", {{{{"foo", "0"}}}}));
+}
+
+TEST_F(OverLimitCacheTest, GrpcClient) {
+  auto* async_client = new Grpc::MockAsyncClient<pb::lyft::ratelimit::RateLimitRequest,
+                                                 pb::lyft::ratelimit::RateLimitResponse>();
+  Grpc::MockAsyncRequest async_request;
+  GrpcClientImpl client(RateLimitAsyncClientPtr{async_client},
+                        Optional<std::chrono::milliseconds>(), cache_);
+  MockRequestCallbacks request_callbacks;
+  NiceMock<Tracing::MockSpan> span;
+
+  // Only the descriptors the service finds over limit are cached.
+  EXPECT_CALL(*async_client, send(_, _, _, _, _)).WillOnce(Return(&async_request));
+  client.limit(request_callbacks, "foo", {{{{"foo", "bar"}}}, {{{"foo", "baz"}}}}, span);
+
+  std::unique_ptr<pb::lyft::ratelimit::RateLimitResponse> response(
+      new pb::lyft::ratelimit::RateLimitResponse());
+  response->set_overall_code(pb::lyft::ratelimit::RateLimitResponse_Code_OVER_LIMIT);
+  response->add_statuses()->set_code(pb::lyft::ratelimit::RateLimitResponse_Code_OK);
+  response->add_statuses()->set_code(pb::lyft::ratelimit::RateLimitResponse_Code_OVER_LIMIT);
+  EXPECT_CALL(request_callbacks, complete(LimitStatus::OverLimit));
+  client.onSuccess(std::move(response), span);
+
+  // A cached descriptor is over limit without calling the service.
+  EXPECT_CALL(*async_client, send(_, _, _, _, _)).Times(0);
+  EXPECT_CALL(span, setTag("ratelimit_status", "over_limit"));
+  EXPECT_CALL(request_callbacks, complete(LimitStatus::OverLimit));
+  client.limit(request_callbacks, "foo", {{{{"foo", "baz"}}}}, span);
+
+  EXPECT_CALL(*async_client, send(_, _, _, _, _)).WillOnce(Return(&async_request));
+  client.limit(request_callbacks, "foo", {{{{"foo", "bar"}}}}, span);
+  EXPECT_CALL(async_request, cancel());
+  client.cancel();
+}
+
 TEST(RateLimitGrpcFactoryTest, NoCluster) {
   envoy::api::v2::RateLimitServiceConfig config;
   config.set_cluster_name("foo");
@@ -0,0 +1,122 @@
+#include <string>
+#include <vector>
+
+#include "common/redis/cluster_slots.h"
+
+#include "test/mocks/redis/mocks.h"
+#include "test/test_common/printers.h"
+
+#include "gtest/gtest.h"
+
+namespace Envoy {
+namespace Redis {
+
+namespace {
+
+RespValue integer(int64_t value) {
+  RespValue ret;
+  ret.type(RespType::Integer);
+  ret.asInteger() = value;
+  return ret;
+}
+
+RespValue string(const std::string& value, RespType type = RespType::BulkString) {
+  RespValue ret;
+  ret.type(type);
+  ret.asString() = value;
+  return ret;
+}
+
+RespValue array(const std::vector<RespValue>& values) {
+  RespValue ret;
+  ret.type(RespType::Array);
+  ret.asArray() = values;
+  return ret;
+}
+
+} // namespace
+
+TEST(RedisClusterSlotUtilityTest, KeySlot) {
+  // Values from CLUSTER KEYSLOT.
+  EXPECT_EQ(12182, ClusterSlotUtility::keySlot("foo"));
+  EXPECT_EQ(5061, ClusterSlotUtility::keySlot("bar"));
+  EXPECT_EQ(12739, ClusterSlotUtility::keySlot("123456789"));
+  EXPECT_EQ(0, ClusterSlotUtility::keySlot(""));
+
+  // Only a non empty hash tag is hashed.
+  EXPECT_EQ(ClusterSlotUtility::keySlot("user1000"),
+            ClusterSlotUtility::keySlot("{user1000}.following"));
+  EXPECT_EQ(ClusterSlotUtility::keySlot("user1000"),
+            ClusterSlotUtility::keySlot("foo{user1000}{bar}"));
+  EXPECT_NE(ClusterSlotUtility::keySlot("foo"), ClusterSlotUtility::keySlot("{}.foo"));
+  EXPECT_NE(ClusterSlotUtility::keySlot("foo"), ClusterSlotUtility::keySlot("{foo"));
+}
+
+TEST(RedisClusterSlotUtilityTest, Requests) {
+  EXPECT_EQ(array({string("CLUSTER"), string("SLOTS")}), ClusterSlotUtility::clusterSlotsRequest());
+  EXPECT_EQ(array({string("ASKING")}), ClusterSlotUtility::askingRequest());
+  EXPECT_EQ(array({string("READONLY")}), ClusterSlotUtility::readOnlyRequest());
+}
+
+TEST(RedisClusterSlotUtilityTest, ParseClusterSlots) {
+  std::vector<ClusterSlotUtility::SlotRange> ranges;
+  RespValue response =
+      array({array({integer(0), integer(5460),
+                    array({string("10.0.0.1"), integer(6379), string("id1")}),
+                    array({string("10.0.0.4"), integer(6379), string("id4")})}),
+             array({integer(5461), integer(16383),
+                    array({string("::1"), integer(6380), string("id2")})})});
+  EXPECT_TRUE(ClusterSlotUtility::parseClusterSlots(response, ranges));
+  ASSERT_EQ(2UL, ranges.size());
+  EXPECT_EQ(0, ranges[0].start_);
+  EXPECT_EQ(5460, ranges[0].end_);
+  EXPECT_EQ("10.0.0.1:6379", ranges[0].address_);
+  EXPECT_EQ(std::vector<std::string>{"10.0.0.4:6379"}, ranges[0].replica_addresses_);
+  EXPECT_EQ(5461, ranges[1].start_);
+  EXPECT_EQ(16383, ranges[1].end_);
+  EXPECT_EQ("[::1]:6380", ranges[1].address_);
+  EXPECT_TRUE(ranges[1].replica_addresses_.empty());
+
+  EXPECT_FALSE(ClusterSlotUtility::parseClusterSlots(string("ERR"), ranges));
+  EXPECT_FALSE(ClusterSlotUtility::parseClusterSlots(
+      array({array({integer(0), integer(16384), array({string("10.0.0.1"), integer(6379)})})}),
+      ranges));
+  EXPECT_FALSE(ClusterSlotUtility::parseClusterSlots(
+      array({array({integer(10), integer(5), array({string("10.0.0.1"), integer(6379)})})}),
+      ranges));
+  EXPECT_FALSE(ClusterSlotUtility::parseClusterSlots(
+      array({array({integer(0), integer(5), array({integer(1), integer(6379)})})}), ranges));
+  EXPECT_FALSE(
+      ClusterSlotUtility::parseClusterSlots(array({array({integer(0), integer(5)})}), ranges));
+  EXPECT_FALSE(ClusterSlotUtility::parseClusterSlots(
+      array({array({integer(0), integer(5), array({string("10.0.0.1"), integer(6379)}),
+                    array({string("10.0.0.4")})})}),
+      ranges));
+}
+
+TEST(RedisClusterSlotUtilityTest, ParseRedirection) {
+  ClusterSlotUtility::Redirection redirection;
+  EXPECT_TRUE(ClusterSlotUtility::parseRedirection(
+      string("MOVED 3999 10.0.0.1:6381", RespType::Error), redirection));
+  EXPECT_FALSE(redirection.ask_);
+  EXPECT_EQ(3999, redirection.slot_);
+  EXPECT_EQ("10.0.0.1:6381", redirection.address_);
+
+  EXPECT_TRUE(ClusterSlotUtility::parseRedirection(string("ASK 12 ::1:6381", RespType::Error),
+                                                   redirection));
+  EXPECT_TRUE(redirection.ask_);
+  EXPECT_EQ(12, redirection.slot_);
+  EXPECT_EQ("[::1]:6381", redirection.address_);
+
+  EXPECT_FALSE(ClusterSlotUtility::parseRedirection(string("MOVED 3999 10.0.0.1:6381"),
+                                                    redirection));
+  EXPECT_FALSE(ClusterSlotUtility::parseRedirection(
+      string("ERR wrong number of arguments", RespType::Error), redirection));
+  EXPECT_FALSE(ClusterSlotUtility::parseRedirection(
+      string("MOVED 16384 10.0.0.1:6381", RespType::Error), redirection));
+  EXPECT_FALSE(ClusterSlotUtility::parseRedirection(string("MOVED 1 10.0.0.1", RespType::Error),
+                                                    redirection));
+}
+
+} // namespace Redis
+} // namespace Envoy
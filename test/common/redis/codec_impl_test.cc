@@ -155,6 +155,32 @@ TEST_F(RedisEncoderDecoderImplTest, NestedArray) {
   EXPECT_EQ(value, *decoded_values_[0]);
 }
 
+TEST_F(RedisEncoderDecoderImplTest, FragmentedStrings) {
+  std::vector<RespValue> values(2);
+  values[0].type(RespType::SimpleString);
+  values[0].asString() = "simple string";
+  values[1].type(RespType::BulkString);
+  values[1].asString() = std::string(3 * DecoderImpl::MAX_BULK_STRING_RESERVE / 2, 'a');
+
+  RespValue value;
+  value.type(RespType::Array);
+  value.asArray().swap(values);
+  encoder_.encode(value, buffer_);
+
+  // Feed the encoded value in small pieces at first and then larger ones, so that both strings
+  // span several slices.
+  const std::string encoded = TestUtility::bufferToString(buffer_);
+  for (size_t i = 0, size = 0; i < encoded.size(); i += size) {
+    size = i < 64 ? 5 : 4099;
+    Buffer::OwnedImpl temp_buffer(encoded.substr(i, size));
+    decoder_.decode(temp_buffer);
+    EXPECT_EQ(0UL, temp_buffer.length());
+  }
+
+  ASSERT_EQ(1UL, decoded_values_.size());
+  EXPECT_EQ(value, *decoded_values_[0]);
+}
+
 TEST_F(RedisEncoderDecoderImplTest, NullArray) {
   buffer_.add("*-1\r\n");
   decoder_.decode(buffer_);
@@ -9,6 +9,7 @@
 
 #include "test/mocks/common.h"
 #include "test/mocks/redis/mocks.h"
+#include "test/mocks/stats/mocks.h"
 #include "test/test_common/printers.h"
 
 #include "fmt/format.h"
@@ -19,6 +20,8 @@ using testing::ByRef;
 using testing::DoAll;
 using testing::Eq;
 using testing::InSequence;
+using testing::NiceMock;
+using testing::Property;
 using testing::Ref;
 using testing::Return;
 using testing::WithArg;
@@ -41,8 +44,8 @@ public:
     value.asArray().swap(values);
   }
 
-  ConnPool::MockInstance* conn_pool_{new ConnPool::MockInstance()};
-  Stats::IsolatedStoreImpl store_;
+  ConnPool::MockInstance* conn_pool_{new NiceMock<ConnPool::MockInstance>()};
+  NiceMock<Stats::MockIsolatedStatsStore> store_;
   InstanceImpl splitter_{ConnPool::InstancePtr{conn_pool_}, store_, "redis.foo."};
   MockSplitCallbacks callbacks_;
   SplitRequestPtr handle_;
@@ -132,12 +135,16 @@ TEST_P(RedisSingleServerRequestTest, Success) {
   makeRequest("hello", request);
   EXPECT_NE(nullptr, handle_);
 
-  respond();
-
   ToLowerTable table;
   std::string lower_command(GetParam());
   table.toLowerCase(lower_command);
 
+  EXPECT_CALL(store_, deliverHistogramToSinks(
+                          Property(&Stats::Metric::name,
+                                   fmt::format("redis.foo.command.{}.latency_us", lower_command)),
+                          _));
+  respond();
+
   EXPECT_EQ(1UL, store_.counter(fmt::format("redis.foo.command.{}.total", lower_command)).value());
 };
 
@@ -325,6 +332,8 @@ TEST_F(RedisMGETCommandHandlerTest, Normal) {
   RespValuePtr response1(new RespValue());
   response1->type(RespType::BulkString);
   response1->asString() = "response";
+  EXPECT_CALL(store_, deliverHistogramToSinks(
+                          Property(&Stats::Metric::name, "redis.foo.command.mget.latency_us"), _));
   EXPECT_CALL(callbacks_, onResponse_(PointeesEq(&expected_response)));
   pool_callbacks_[0]->onResponse(std::move(response1));
 
@@ -449,6 +458,73 @@ TEST_F(RedisMGETCommandHandlerTest, Cancel) {
   handle_->cancel();
 };
 
+TEST_F(RedisMGETCommandHandlerTest, GroupedKeys) {
+  InSequence s;
+
+  // Keys "0" and "2" are served together and are sent in one MGET.
+  ON_CALL(*conn_pool_, keyGroup("0")).WillByDefault(Return(1));
+  ON_CALL(*conn_pool_, keyGroup("1")).WillByDefault(Return(2));
+  ON_CALL(*conn_pool_, keyGroup("2")).WillByDefault(Return(1));
+
+  RespValue request;
+  makeBulkStringArray(request, {"mget", "0", "1", "2"});
+  RespValue expected_request1;
+  makeBulkStringArray(expected_request1, {"mget", "0", "2"});
+  RespValue expected_request2;
+  makeBulkStringArray(expected_request2, {"get", "1"});
+  ConnPool::PoolCallbacks* pool_callbacks1;
+  ConnPool::PoolCallbacks* pool_callbacks2;
+  ConnPool::MockPoolRequest pool_request1;
+  ConnPool::MockPoolRequest pool_request2;
+  EXPECT_CALL(*conn_pool_, makeRequest("0", Eq(ByRef(expected_request1)), _))
+      .WillOnce(DoAll(WithArg<2>(SaveArgAddress(&pool_callbacks1)), Return(&pool_request1)));
+  EXPECT_CALL(*conn_pool_, makeRequest("1", Eq(ByRef(expected_request2)), _))
+      .WillOnce(DoAll(WithArg<2>(SaveArgAddress(&pool_callbacks2)), Return(&pool_request2)));
+  handle_ = splitter_.makeRequest(request, callbacks_);
+  EXPECT_NE(nullptr, handle_);
+
+  RespValuePtr response2(new RespValue());
+  response2->type(RespType::BulkString);
+  response2->asString() = "b";
+  pool_callbacks2->onResponse(std::move(response2));
+
+  RespValue expected_response;
+  makeBulkStringArray(expected_response, {"a", "b", ""});
+  expected_response.asArray()[2].type(RespType::Null);
+  RespValuePtr response1(new RespValue());
+  makeBulkStringArray(*response1, {"a", ""});
+  response1->asArray()[1].type(RespType::Null);
+  EXPECT_CALL(callbacks_, onResponse_(PointeesEq(&expected_response)));
+  pool_callbacks1->onResponse(std::move(response1));
+};
+
+TEST_F(RedisMGETCommandHandlerTest, GroupedKeysError) {
+  InSequence s;
+
+  ON_CALL(*conn_pool_, keyGroup(_)).WillByDefault(Return(1));
+
+  RespValue request;
+  makeBulkStringArray(request, {"mget", "0", "1"});
+  RespValue expected_request;
+  makeBulkStringArray(expected_request, {"mget", "0", "1"});
+  ConnPool::PoolCallbacks* pool_callbacks;
+  ConnPool::MockPoolRequest pool_request;
+  EXPECT_CALL(*conn_pool_, makeRequest("0", Eq(ByRef(expected_request)), _))
+      .WillOnce(DoAll(WithArg<2>(SaveArgAddress(&pool_callbacks)), Return(&pool_request)));
+  handle_ = splitter_.makeRequest(request, callbacks_);
+  EXPECT_NE(nullptr, handle_);
+
+  // An error fails every key of the fragment.
+  RespValue expected_response;
+  makeBulkStringArray(expected_response, {"", ""});
+  expected_response.asArray()[0].type(RespType::Error);
+  expected_response.asArray()[0].asString() = "upstream failure";
+  expected_response.asArray()[1].type(RespType::Error);
+  expected_response.asArray()[1].asString() = "upstream failure";
+  EXPECT_CALL(callbacks_, onResponse_(PointeesEq(&expected_response)));
+  pool_callbacks->onFailure();
+};
+
 class RedisMSETCommandHandlerTest : public RedisCommandSplitterImplTest {
 public:
   void setup(uint32_t num_sets, const std::list<uint64_t>& null_handle_indexes) {
@@ -563,6 +639,30 @@ TEST_F(RedisMSETCommandHandlerTest, WrongNumberOfArgs) {
   EXPECT_EQ(nullptr, splitter_.makeRequest(request, callbacks_));
 };
 
+TEST_F(RedisMSETCommandHandlerTest, GroupedKeys) {
+  InSequence s;
+
+  ON_CALL(*conn_pool_, keyGroup(_)).WillByDefault(Return(1));
+
+  RespValue request;
+  makeBulkStringArray(request, {"mset", "0", "a", "1", "b"});
+  RespValue expected_request;
+  makeBulkStringArray(expected_request, {"mset", "0", "a", "1", "b"});
+  ConnPool::PoolCallbacks* pool_callbacks;
+  ConnPool::MockPoolRequest pool_request;
+  EXPECT_CALL(*conn_pool_, makeRequest("0", Eq(ByRef(expected_request)), _))
+      .WillOnce(DoAll(WithArg<2>(SaveArgAddress(&pool_callbacks)), Return(&pool_request)));
+  handle_ = splitter_.makeRequest(request, callbacks_);
+  EXPECT_NE(nullptr, handle_);
+
+  // A failed fragment counts an error per key.
+  RespValue expected_response;
+  expected_response.type(RespType::Error);
+  expected_response.asString() = "finished with 2 error(s)";
+  EXPECT_CALL(callbacks_, onResponse_(PointeesEq(&expected_response)));
+  pool_callbacks->onFailure();
+};
+
 class RedisSplitKeysSumResultHandlerTest : public RedisCommandSplitterImplTest,
                                            public testing::WithParamInterface<std::string> {
 public:
@@ -659,6 +759,30 @@ TEST_P(RedisSplitKeysSumResultHandlerTest, NoUpstreamHostForAll) {
   EXPECT_EQ(nullptr, handle_);
 };
 
+TEST_P(RedisSplitKeysSumResultHandlerTest, GroupedKeys) {
+  InSequence s;
+
+  ON_CALL(*conn_pool_, keyGroup(_)).WillByDefault(Return(1));
+
+  RespValue request;
+  makeBulkStringArray(request, {GetParam(), "0", "1"});
+  ConnPool::PoolCallbacks* pool_callbacks;
+  ConnPool::MockPoolRequest pool_request;
+  EXPECT_CALL(*conn_pool_, makeRequest("0", Eq(ByRef(request)), _))
+      .WillOnce(DoAll(WithArg<2>(SaveArgAddress(&pool_callbacks)), Return(&pool_request)));
+  handle_ = splitter_.makeRequest(request, callbacks_);
+  EXPECT_NE(nullptr, handle_);
+
+  RespValue expected_response;
+  expected_response.type(RespType::Integer);
+  expected_response.asInteger() = 2;
+  RespValuePtr response(new RespValue());
+  response->type(RespType::Integer);
+  response->asInteger() = 2;
+  EXPECT_CALL(callbacks_, onResponse_(PointeesEq(&expected_response)));
+  pool_callbacks->onResponse(std::move(response));
+};
+
 INSTANTIATE_TEST_CASE_P(RedisSplitKeysSumResultHandlerTest, RedisSplitKeysSumResultHandlerTest,
                         testing::ValuesIn(SupportedCommands::hashMultipleSumResultCommands()));
 
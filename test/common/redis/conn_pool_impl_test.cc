@@ -1,22 +1,28 @@
 #include <memory>
 #include <string>
 
+#include "common/config/metadata.h"
+#include "common/config/well_known_names.h"
 #include "common/network/utility.h"
 #include "common/redis/conn_pool_impl.h"
 #include "common/upstream/upstream_impl.h"
 
+#include "test/common/upstream/utility.h"
 #include "test/mocks/network/mocks.h"
 #include "test/mocks/redis/mocks.h"
 #include "test/mocks/thread_local/mocks.h"
 #include "test/mocks/upstream/mocks.h"
 #include "test/test_common/printers.h"
+#include "test/test_common/utility.h"
 
 #include "gmock/gmock.h"
 #include "gtest/gtest.h"
 
+using testing::DoAll;
 using testing::Eq;
 using testing::InSequence;
 using testing::Invoke;
+using testing::Property;
 using testing::Ref;
 using testing::Return;
 using testing::ReturnRef;
@@ -27,6 +33,9 @@ namespace Envoy {
 namespace Redis {
 namespace ConnPool {
 
+// Saves the address of the callbacks passed to Client::makeRequest().
+ACTION_P(SaveCallbacksAddress, target) { *target = &arg1; }
+
 envoy::api::v2::filter::network::RedisProxy::ConnPoolSettings createConnPoolSettings() {
   envoy::api::v2::filter::network::RedisProxy::ConnPoolSettings setting{};
   setting.mutable_op_timeout()->CopyFrom(Protobuf::util::TimeUtil::MillisecondsToDuration(20));
@@ -87,6 +96,9 @@ public:
   const std::string cluster_name_{"foo"};
   std::shared_ptr<Upstream::MockHost> host_{new NiceMock<Upstream::MockHost>()};
   Event::MockDispatcher dispatcher_;
+  // The most recently constructed mock timer is handed out first, and the client creates the
+  // connect timer before the flush timer.
+  NiceMock<Event::MockTimer>* flush_timer_{new NiceMock<Event::MockTimer>(&dispatcher_)};
   Event::MockTimer* connect_or_op_timer_{new Event::MockTimer(&dispatcher_)};
   MockEncoder* encoder_{new MockEncoder()};
   MockDecoder* decoder_{new MockDecoder()};
@@ -355,6 +367,56 @@ TEST_F(RedisClientImplTest, OpTimeout) {
   EXPECT_EQ(1UL, host_->cluster_.stats_.upstream_rq_timeout_.value());
 }
 
+TEST_F(RedisClientImplTest, Batching) {
+  InSequence s;
+
+  setup();
+
+  // Requests made in the same event loop iteration go out in one write.
+  RespValue request1;
+  MockPoolCallbacks callbacks1;
+  EXPECT_CALL(*encoder_, encode(Ref(request1), _));
+  EXPECT_CALL(*flush_timer_, enableTimer(std::chrono::milliseconds(0)));
+  client_->makeRequest(request1, callbacks1);
+
+  onConnected();
+
+  RespValue request2;
+  MockPoolCallbacks callbacks2;
+  EXPECT_CALL(*encoder_, encode(Ref(request2), _));
+  EXPECT_CALL(*flush_timer_, enableTimer(_)).Times(0);
+  client_->makeRequest(request2, callbacks2);
+
+  EXPECT_CALL(*flush_timer_, disableTimer());
+  EXPECT_CALL(host_->cluster_.stats_store_,
+              deliverHistogramToSinks(
+                  Property(&Stats::Metric::name, "redis.upstream_rq_batch_size"), 2));
+  EXPECT_CALL(*upstream_connection_, write(_));
+  flush_timer_->callback_();
+
+  // A batch that grows too large is written right away.
+  RespValue request3;
+  MockPoolCallbacks callbacks3;
+  EXPECT_CALL(*encoder_, encode(Ref(request3), _))
+      .WillOnce(Invoke([](const RespValue&, Buffer::Instance& out) -> void {
+        out.add(std::string(ClientImpl::MAX_BATCH_BYTES, 'a'));
+      }));
+  EXPECT_CALL(*flush_timer_, enableTimer(std::chrono::milliseconds(0)));
+  EXPECT_CALL(*flush_timer_, disableTimer());
+  EXPECT_CALL(host_->cluster_.stats_store_,
+              deliverHistogramToSinks(
+                  Property(&Stats::Metric::name, "redis.upstream_rq_batch_size"), 1));
+  EXPECT_CALL(*upstream_connection_, write(_));
+  client_->makeRequest(request3, callbacks3);
+
+  EXPECT_CALL(*upstream_connection_, close(Network::ConnectionCloseType::NoFlush));
+  EXPECT_CALL(callbacks1, onFailure());
+  EXPECT_CALL(callbacks2, onFailure());
+  EXPECT_CALL(callbacks3, onFailure());
+  EXPECT_CALL(*connect_or_op_timer_, disableTimer());
+  client_->close();
+}
+
 TEST(RedisClientFactoryImplTest, Basic) {
   ClientFactoryImpl factory;
   Upstream::MockHost::MockCreateConnectionData conn_info;
@@ -479,6 +541,330 @@ TEST_F(RedisConnPoolImplTest, RemoteClose) {
   tls_.shutdownThread();
 }
 
+TEST_F(RedisConnPoolImplTest, KeyGroup) {
+  // Keys are grouped by the host the load balancer chooses for them.
+  std::shared_ptr<Upstream::MockHost> host1(new Upstream::MockHost());
+  std::shared_ptr<Upstream::MockHost> host2(new Upstream::MockHost());
+  EXPECT_CALL(cm_.thread_local_cluster_.lb_, chooseHost(_))
+      .WillOnce(Return(host1))
+      .WillOnce(Return(host2))
+      .WillOnce(Return(host1));
+  const uint64_t group = conn_pool_->keyGroup("foo");
+  EXPECT_NE(group, conn_pool_->keyGroup("bar"));
+  EXPECT_EQ(group, conn_pool_->keyGroup("baz"));
+
+  tls_.shutdownThread();
+}
+
+TEST_F(RedisConnPoolImplTest, InvalidReadPolicy) {
+  Config::Metadata::mutableMetadataValue(cm_.thread_local_cluster_.cluster_.info_->metadata_,
+                                         Config::MetadataFilters::get().ENVOY_LB,
+                                         Config::MetadataEnvoyLbKeys::get().REDIS_READ_POLICY)
+      .set_string_value("slave");
+  EXPECT_THROW_WITH_MESSAGE(
+      InstanceImpl(cluster_name_, cm_, *this, tls_, createConnPoolSettings()), EnvoyException,
+      "invalid redis read policy 'slave'");
+}
+
+class RedisClusterConnPoolImplTest : public RedisConnPoolImplTest {
+public:
+  RedisClusterConnPoolImplTest(const std::string& read_policy = "") {
+    Config::Metadata::mutableMetadataValue(cm_.thread_local_cluster_.cluster_.info_->metadata_,
+                                           Config::MetadataFilters::get().ENVOY_LB,
+                                           Config::MetadataEnvoyLbKeys::get().REDIS_CLUSTER)
+        .set_bool_value(true);
+    if (!read_policy.empty()) {
+      Config::Metadata::mutableMetadataValue(cm_.thread_local_cluster_.cluster_.info_->metadata_,
+                                             Config::MetadataFilters::get().ENVOY_LB,
+                                             Config::MetadataEnvoyLbKeys::get().REDIS_READ_POLICY)
+          .set_string_value(read_policy);
+    }
+    cm_.thread_local_cluster_.cluster_.prioritySet().getMockHostSet(0)->hosts_ = {host1_, host2_,
+                                                                                  host3_};
+
+    slots_refresh_timer_ = new Event::MockTimer(&tls_.dispatcher_);
+    EXPECT_CALL(*slots_refresh_timer_, enableTimer(std::chrono::milliseconds(0)));
+    conn_pool_.reset(new InstanceImpl(cluster_name_, cm_, *this, tls_, createConnPoolSettings()));
+  }
+
+  // Redis::ConnPool::ClientFactory
+  ClientPtr create(Upstream::HostConstSharedPtr host, Event::Dispatcher&, const Config&) override {
+    Client* client = create_(host);
+    for (ClientPtr& unused_client : unused_clients_) {
+      if (unused_client.get() == client) {
+        unused_client.release();
+      }
+    }
+    return ClientPtr{client};
+  }
+
+  // Load a slot map in which host1 serves the slots below 8192 and host2 the others.
+  void loadSlots() {
+    EXPECT_CALL(cm_.thread_local_cluster_.lb_, chooseHost(_)).WillOnce(Return(host1_));
+    EXPECT_CALL(*this, create_(Eq(host1_))).WillOnce(Return(client1_));
+    PoolCallbacks* slots_callbacks;
+    MockPoolRequest slots_request;
+    EXPECT_CALL(*client1_, makeRequest(Eq(ClusterSlotUtility::clusterSlotsRequest()), _))
+        .WillOnce(DoAll(SaveCallbacksAddress(&slots_callbacks), Return(&slots_request)));
+    slots_refresh_timer_->callback_();
+
+    std::vector<RespValue> ranges(2);
+    ranges[0] = slotRange(0, 8191, "10.0.0.1", 6379);
+    ranges[1] = slotRange(8192, 16383, "10.0.0.2", 6379);
+    RespValuePtr response(new RespValue());
+    response->type(RespType::Array);
+    response->asArray().swap(ranges);
+    EXPECT_CALL(*slots_refresh_timer_, enableTimer(std::chrono::milliseconds(10000)));
+    slots_callbacks->onResponse(std::move(response));
+  }
+
+  static RespValue slotRange(int64_t start, int64_t end, const std::string& ip, int64_t port,
+                             const std::string& replica_ip = "") {
+    std::vector<RespValue> values(replica_ip.empty() ? 3 : 4);
+    values[0].type(RespType::Integer);
+    values[0].asInteger() = start;
+    values[1].type(RespType::Integer);
+    values[1].asInteger() = end;
+    values[2] = node(ip, port);
+    if (!replica_ip.empty()) {
+      values[3] = node(replica_ip, port);
+    }
+
+    RespValue range;
+    range.type(RespType::Array);
+    range.asArray().swap(values);
+    return range;
+  }
+
+  static RespValue node(const std::string& ip, int64_t port) {
+    RespValue node;
+    node.type(RespType::Array);
+    node.asArray().resize(2);
+    node.asArray()[0].type(RespType::BulkString);
+    node.asArray()[0].asString() = ip;
+    node.asArray()[1].type(RespType::Integer);
+    node.asArray()[1].asInteger() = port;
+    return node;
+  }
+
+  static RespValue command(const std::vector<std::string>& arguments) {
+    RespValue command;
+    command.type(RespType::Array);
+    command.asArray().resize(arguments.size());
+    for (size_t i = 0; i < arguments.size(); i++) {
+      command.asArray()[i].type(RespType::BulkString);
+      command.asArray()[i].asString() = arguments[i];
+    }
+    return command;
+  }
+
+  static RespValuePtr error(const std::string& message) {
+    RespValuePtr value(new RespValue());
+    value->type(RespType::Error);
+    value->asString() = message;
+    return value;
+  }
+
+  Upstream::HostSharedPtr host1_{
+      Upstream::makeTestHost(cm_.thread_local_cluster_.cluster_.info_, "tcp://10.0.0.1:6379")};
+  Upstream::HostSharedPtr host2_{
+      Upstream::makeTestHost(cm_.thread_local_cluster_.cluster_.info_, "tcp://10.0.0.2:6379")};
+  Upstream::HostSharedPtr host3_{
+      Upstream::makeTestHost(cm_.thread_local_cluster_.cluster_.info_, "tcp://10.0.0.4:6379")};
+  MockClient* client1_{new NiceMock<MockClient>()};
+  MockClient* client2_{new NiceMock<MockClient>()};
+  MockClient* client3_{new NiceMock<MockClient>()};
+  // Owns the clients until the pool creates them.
+  ClientPtr unused_clients_[3]{ClientPtr{client1_}, ClientPtr{client2_}, ClientPtr{client3_}};
+  Event::MockTimer* slots_refresh_timer_;
+};
+
+TEST_F(RedisClusterConnPoolImplTest, RouteBySlot) {
+  loadSlots();
+
+  // "foo" hashes to slot 12182, which host2 serves, and "bar" to slot 5061 on host1. Neither goes
+  // through the load balancer.
+  RespValue value;
+  MockPoolCallbacks callbacks;
+  MockPoolRequest active_request1;
+  EXPECT_CALL(cm_.thread_local_cluster_.lb_, chooseHost(_)).Times(0);
+  EXPECT_CALL(*this, create_(Eq(host2_))).WillOnce(Return(client2_));
+  EXPECT_CALL(*client2_, makeRequest(Eq(value), _)).WillOnce(Return(&active_request1));
+  EXPECT_NE(nullptr, conn_pool_->makeRequest("foo", value, callbacks));
+
+  MockPoolRequest active_request2;
+  EXPECT_CALL(*client1_, makeRequest(Eq(value), _)).WillOnce(Return(&active_request2));
+  PoolRequest* request2 = conn_pool_->makeRequest("bar", value, callbacks);
+  EXPECT_NE(nullptr, request2);
+
+  EXPECT_CALL(active_request2, cancel());
+  request2->cancel();
+
+  EXPECT_CALL(*client1_, close());
+  EXPECT_CALL(*client2_, close());
+  tls_.shutdownThread();
+}
+
+TEST_F(RedisClusterConnPoolImplTest, KeyGroup) {
+  // Keys are grouped by slot, without asking the load balancer.
+  EXPECT_CALL(cm_.thread_local_cluster_.lb_, chooseHost(_)).Times(0);
+  EXPECT_EQ(12182, conn_pool_->keyGroup("foo"));
+  EXPECT_EQ(12182, conn_pool_->keyGroup("{foo}.bar"));
+
+  tls_.shutdownThread();
+}
+
+TEST_F(RedisClusterConnPoolImplTest, NoSlotMap) {
+  // Until the slot map is known keys are routed by the load balancer.
+  RespValue value;
+  MockPoolCallbacks callbacks;
+  MockPoolRequest active_request;
+  EXPECT_CALL(cm_.thread_local_cluster_.lb_, chooseHost(_)).WillOnce(Return(host2_));
+  EXPECT_CALL(*this, create_(Eq(host2_))).WillOnce(Return(client2_));
+  EXPECT_CALL(*client2_, makeRequest(Eq(value), _)).WillOnce(Return(&active_request));
+  EXPECT_NE(nullptr, conn_pool_->makeRequest("foo", value, callbacks));
+
+  EXPECT_CALL(*client2_, close());
+  tls_.shutdownThread();
+}
+
+TEST_F(RedisClusterConnPoolImplTest, Redirections) {
+  loadSlots();
+  EXPECT_CALL(*this, create_(Eq(host2_))).WillOnce(Return(client2_));
+
+  RespValue value;
+  MockPoolCallbacks callbacks;
+  PoolCallbacks* request_callbacks;
+  MockPoolRequest active_request;
+  EXPECT_CALL(*client2_, makeRequest(Eq(value), _))
+      .WillOnce(DoAll(SaveCallbacksAddress(&request_callbacks), Return(&active_request)));
+  conn_pool_->makeRequest("foo", value, callbacks);
+
+  // A MOVED error sends the request to the new master, which then serves the slot, and refreshes
+  // the slot map.
+  EXPECT_CALL(*slots_refresh_timer_, enableTimer(std::chrono::milliseconds(0)));
+  EXPECT_CALL(*client1_, makeRequest(Eq(value), _))
+      .WillOnce(DoAll(SaveCallbacksAddress(&request_callbacks), Return(&active_request)));
+  request_callbacks->onResponse(error("MOVED 12182 10.0.0.1:6379"));
+
+  RespValuePtr response(new RespValue());
+  EXPECT_CALL(callbacks, onResponse_(Ref(response)));
+  request_callbacks->onResponse(std::move(response));
+
+  EXPECT_CALL(*client1_, makeRequest(Eq(value), _))
+      .WillOnce(DoAll(SaveCallbacksAddress(&request_callbacks), Return(&active_request)));
+  conn_pool_->makeRequest("foo", value, callbacks);
+
+  // An ASK error sends the request, preceded by ASKING, to the node importing the slot, without
+  // changing the slot map.
+  {
+    InSequence s;
+    EXPECT_CALL(*client2_, makeRequest(Eq(ClusterSlotUtility::askingRequest()), _));
+    EXPECT_CALL(*client2_, makeRequest(Eq(value), _))
+        .WillOnce(DoAll(SaveCallbacksAddress(&request_callbacks), Return(&active_request)));
+  }
+  request_callbacks->onResponse(error("ASK 12182 10.0.0.2:6379"));
+
+  // Redirections to unknown nodes and too many redirections are returned to the caller.
+  response = error("MOVED 12182 10.0.0.3:6379");
+  EXPECT_CALL(callbacks, onResponse_(Ref(response)));
+  request_callbacks->onResponse(std::move(response));
+
+  EXPECT_CALL(*client1_, makeRequest(Eq(ClusterSlotUtility::askingRequest()), _));
+  EXPECT_CALL(*client2_, makeRequest(Eq(ClusterSlotUtility::askingRequest()), _)).Times(2);
+  EXPECT_CALL(*client1_, makeRequest(Eq(value), _))
+      .Times(2)
+      .WillRepeatedly(DoAll(SaveCallbacksAddress(&request_callbacks), Return(&active_request)));
+  EXPECT_CALL(*client2_, makeRequest(Eq(value), _))
+      .Times(2)
+      .WillRepeatedly(DoAll(SaveCallbacksAddress(&request_callbacks), Return(&active_request)));
+  conn_pool_->makeRequest("foo", value, callbacks);
+  request_callbacks->onResponse(error("ASK 12182 10.0.0.2:6379"));
+  request_callbacks->onResponse(error("ASK 12182 10.0.0.1:6379"));
+  request_callbacks->onResponse(error("ASK 12182 10.0.0.2:6379"));
+  response = error("ASK 12182 10.0.0.1:6379");
+  EXPECT_CALL(callbacks, onResponse_(Ref(response)));
+  request_callbacks->onResponse(std::move(response));
+
+  EXPECT_CALL(*client1_, close());
+  EXPECT_CALL(*client2_, close());
+  tls_.shutdownThread();
+}
+
+class RedisClusterReadPolicyConnPoolImplTest : public RedisClusterConnPoolImplTest,
+                                              public testing::WithParamInterface<std::string> {
+public:
+  RedisClusterReadPolicyConnPoolImplTest() : RedisClusterConnPoolImplTest(GetParam()) {}
+
+  // Load a slot map in which host1 serves all slots with host3 as its replica. Every connection
+  // starts with READONLY.
+  void loadSlots() {
+    EXPECT_CALL(cm_.thread_local_cluster_.lb_, chooseHost(_)).WillOnce(Return(host1_));
+    EXPECT_CALL(*this, create_(Eq(host1_))).WillOnce(Return(client1_));
+    PoolCallbacks* slots_callbacks;
+    MockPoolRequest slots_request;
+    {
+      InSequence s;
+      EXPECT_CALL(*client1_, makeRequest(Eq(ClusterSlotUtility::readOnlyRequest()), _));
+      EXPECT_CALL(*client1_, makeRequest(Eq(ClusterSlotUtility::clusterSlotsRequest()), _))
+          .WillOnce(DoAll(SaveCallbacksAddress(&slots_callbacks), Return(&slots_request)));
+    }
+    slots_refresh_timer_->callback_();
+
+    std::vector<RespValue> ranges(1);
+    ranges[0] = slotRange(0, 16383, "10.0.0.1", 6379, "10.0.0.4");
+    RespValuePtr response(new RespValue());
+    response->type(RespType::Array);
+    response->asArray().swap(ranges);
+    EXPECT_CALL(*slots_refresh_timer_, enableTimer(std::chrono::milliseconds(10000)));
+    slots_callbacks->onResponse(std::move(response));
+  }
+};
+
+INSTANTIATE_TEST_CASE_P(ReadPolicies, RedisClusterReadPolicyConnPoolImplTest,
+                        testing::Values("prefer_replica", "any"));
+
+TEST_P(RedisClusterReadPolicyConnPoolImplTest, ReadFromReplica) {
+  loadSlots();
+
+  // Reads go to the replica first, after READONLY on its new connection.
+  RespValue get = command({"GET", "foo"});
+  MockPoolCallbacks callbacks;
+  MockPoolRequest active_request;
+  EXPECT_CALL(*this, create_(Eq(host3_))).WillOnce(Return(client3_));
+  {
+    InSequence s;
+    EXPECT_CALL(*client3_, makeRequest(Eq(ClusterSlotUtility::readOnlyRequest()), _));
+    EXPECT_CALL(*client3_, makeRequest(Eq(get), _)).WillOnce(Return(&active_request));
+  }
+  EXPECT_NE(nullptr, conn_pool_->makeRequest("foo", get, callbacks));
+
+  // With the "any" policy the next read goes to the master, otherwise to the replica again.
+  if (GetParam() == "any") {
+    EXPECT_CALL(*client1_, makeRequest(Eq(get), _)).WillOnce(Return(&active_request));
+  } else {
+    EXPECT_CALL(*client3_, makeRequest(Eq(get), _)).WillOnce(Return(&active_request));
+  }
+  EXPECT_NE(nullptr, conn_pool_->makeRequest("foo", get, callbacks));
+
+  // Writes always go to the master.
+  RespValue set = command({"SET", "foo", "bar"});
+  EXPECT_CALL(*client1_, makeRequest(Eq(set), _)).WillOnce(Return(&active_request));
+  EXPECT_NE(nullptr, conn_pool_->makeRequest("foo", set, callbacks));
+
+  // Without a healthy replica reads go to the master.
+  host3_->healthFlagSet(Upstream::Host::HealthFlag::FAILED_ACTIVE_HC);
+  EXPECT_CALL(*client1_, makeRequest(Eq(get), _))
+      .Times(2)
+      .WillRepeatedly(Return(&active_request));
+  EXPECT_NE(nullptr, conn_pool_->makeRequest("foo", get, callbacks));
+  EXPECT_NE(nullptr, conn_pool_->makeRequest("foo", get, callbacks));
+
+  EXPECT_CALL(*client1_, close());
+  EXPECT_CALL(*client3_, close());
+  tls_.shutdownThread();
+}
+
 } // namespace ConnPool
 } // namespace Redis
 } // namespace Envoy
@@ -63,6 +63,41 @@ TEST(RequestInfoImplTest, TimingTest) {
       },
       "response received");
 
+  wrapper.checkTimingBounds(
+      [](RequestInfoImpl& request_info) {
+        request_info.upstreamConnectStartDuration(std::chrono::steady_clock::now());
+        return request_info.upstreamConnectStartDuration().value();
+      },
+      "upstream connect start");
+
+  wrapper.checkTimingBounds(
+      [](RequestInfoImpl& request_info) {
+        request_info.upstreamConnectEndDuration(std::chrono::steady_clock::now());
+        return request_info.upstreamConnectEndDuration().value();
+      },
+      "upstream connect end");
+
+  wrapper.checkTimingBounds(
+      [](RequestInfoImpl& request_info) {
+        request_info.upstreamLastByteReceivedDuration(std::chrono::steady_clock::now());
+        return request_info.upstreamLastByteReceivedDuration().value();
+      },
+      "upstream last byte received");
+
+  wrapper.checkTimingBounds(
+      [](RequestInfoImpl& request_info) {
+        request_info.downstreamFirstByteSentDuration(std::chrono::steady_clock::now());
+        return request_info.downstreamFirstByteSentDuration().value();
+      },
+      "downstream first byte sent");
+
+  wrapper.checkTimingBounds(
+      [](RequestInfoImpl& request_info) {
+        request_info.downstreamLastByteSentDuration(std::chrono::steady_clock::now());
+        return request_info.downstreamLastByteSentDuration().value();
+      },
+      "downstream last byte sent");
+
   wrapper.checkTimingBounds([](RequestInfoImpl& request_info) { return request_info.duration(); },
                             "stream duration");
 }
@@ -134,6 +169,11 @@ TEST(RequestInfoImplTest, MiscSettersAndGetters) {
     EXPECT_FALSE(request_info.protocol().valid());
     EXPECT_FALSE(request_info.requestReceivedDuration().valid());
     EXPECT_FALSE(request_info.responseReceivedDuration().valid());
+    EXPECT_FALSE(request_info.upstreamConnectStartDuration().valid());
+    EXPECT_FALSE(request_info.upstreamConnectEndDuration().valid());
+    EXPECT_FALSE(request_info.upstreamLastByteReceivedDuration().valid());
+    EXPECT_FALSE(request_info.downstreamFirstByteSentDuration().valid());
+    EXPECT_FALSE(request_info.downstreamLastByteSentDuration().valid());
 
     request_info.protocol(Http::Protocol::Http10);
     request_info.requestReceivedDuration(std::chrono::steady_clock::now());
@@ -477,6 +477,35 @@ TEST(RouteMatcherTest, TestRoutes) {
 }
 
 // Validates behavior of request_headers_to_add at router, vhost, and route levels.
+// Wildcard domains are honoured even when no virtual host has an exact domain.
+TEST(RouteMatcherTest, WildcardDomainsOnly) {
+  std::string json = R"EOF(
+{
+  "virtual_hosts": [
+    {
+      "name": "wildcard",
+      "domains": ["*.foo.com"],
+      "routes": [{"prefix": "/", "cluster": "wildcard"}]
+    },
+    {
+      "name": "default",
+      "domains": ["*"],
+      "routes": [{"prefix": "/", "cluster": "default"}]
+    }
+  ]
+}
+  )EOF";
+
+  NiceMock<Runtime::MockLoader> runtime;
+  NiceMock<Upstream::MockClusterManager> cm;
+  ConfigImpl config(parseRouteConfigurationFromJson(json), runtime, cm, true);
+
+  EXPECT_EQ("wildcard",
+            config.route(genHeaders("www.foo.com", "/", "GET"), 0)->routeEntry()->clusterName());
+  EXPECT_EQ("default",
+            config.route(genHeaders("foo.com", "/", "GET"), 0)->routeEntry()->clusterName());
+}
+
 TEST(RouteMatcherTest, TestAddRemoveRequestHeaders) {
   std::string json = R"EOF(
 {
@@ -995,6 +1024,169 @@ TEST(RouteMatcherTest, HeaderMatchedRouting) {
   }
 }
 
+// Routes are indexed by path matcher type; make sure the first matching route in the route table
+// still wins whatever mix of matchers precedes it.
+TEST(RouteMatcherTest, MixedMatcherOrdering) {
+  std::string json = R"EOF(
+{
+  "virtual_hosts": [
+    {
+      "name": "local_service",
+      "domains": ["*"],
+      "routes": [
+        {
+          "prefix": "/api/v1/users",
+          "cluster": "users_with_header",
+          "headers" : [
+            {"name": "test_header", "value": "test"}
+          ]
+        },
+        {
+          "regex": "/api/v[0-9]+/admin.*",
+          "cluster": "admin"
+        },
+        {
+          "path": "/api/v1/users/me",
+          "cluster": "me",
+          "case_sensitive": false
+        },
+        {
+          "prefix": "/api/v1/users",
+          "cluster": "users"
+        },
+        {
+          "path": "/api/v1/health",
+          "cluster": "health"
+        },
+        {
+          "prefix": "/API",
+          "cluster": "api",
+          "case_sensitive": false
+        },
+        {
+          "regex": ".*",
+          "cluster": "catch_all"
+        },
+        {
+          "path": "/unreachable",
+          "cluster": "unreachable"
+        }
+      ]
+    }
+  ]
+}
+  )EOF";
+
+  NiceMock<Runtime::MockLoader> runtime;
+  NiceMock<Upstream::MockClusterManager> cm;
+  ConfigImpl config(parseRouteConfigurationFromJson(json), runtime, cm, true);
+
+  {
+    Http::TestHeaderMapImpl headers = genHeaders("www.lyft.com", "/api/v1/users/me", "GET");
+    headers.addCopy("test_header", "test");
+    EXPECT_EQ("users_with_header", config.route(headers, 0)->routeEntry()->clusterName());
+  }
+
+  EXPECT_EQ("admin", config.route(genHeaders("www.lyft.com", "/api/v1/admin/users", "GET"), 0)
+                         ->routeEntry()
+                         ->clusterName());
+  EXPECT_EQ("me", config.route(genHeaders("www.lyft.com", "/API/V1/Users/Me?x=y", "GET"), 0)
+                      ->routeEntry()
+                      ->clusterName());
+  EXPECT_EQ("users", config.route(genHeaders("www.lyft.com", "/api/v1/users/me/x", "GET"), 0)
+                         ->routeEntry()
+                         ->clusterName());
+  EXPECT_EQ("health", config.route(genHeaders("www.lyft.com", "/api/v1/health", "GET"), 0)
+                          ->routeEntry()
+                          ->clusterName());
+  EXPECT_EQ("api", config.route(genHeaders("www.lyft.com", "/api/v1/HEALTH", "GET"), 0)
+                       ->routeEntry()
+                       ->clusterName());
+  EXPECT_EQ("api", config.route(genHeaders("www.lyft.com", "/Api/v1/users", "GET"), 0)
+                       ->routeEntry()
+                       ->clusterName());
+  EXPECT_EQ("catch_all", config.route(genHeaders("www.lyft.com", "/unreachable", "GET"), 0)
+                             ->routeEntry()
+                             ->clusterName());
+}
+
+TEST(RouteMatcherTest, LinearRegexEngine) {
+  std::string json = R"EOF(
+{
+  "virtual_hosts": [
+    {
+      "name": "local_service",
+      "domains": ["*"],
+      "routes": [
+        {
+          "regex": "/users/\\d+",
+          "cluster": "users_with_header",
+          "headers" : [
+            {"name": "test_header", "value": "^te+st$", "regex": true}
+          ]
+        },
+        {
+          "regex": "/users/(?!admin)\\w+",
+          "cluster": "users_lookahead"
+        },
+        {
+          "prefix": "/users/admin",
+          "cluster": "admin"
+        },
+        {
+          "regex": "/(users|groups)/.*",
+          "cluster": "users_or_groups"
+        }
+      ],
+      "virtual_clusters": [
+        {"pattern": "^/users/\\d+$", "method": "PUT", "name": "update_user"},
+        {"pattern": "^/users/(?!admin)\\w+$", "method": "POST", "name": "create_user"},
+        {"pattern": "^/(users|groups)/.*$", "name": "users_or_groups"}]
+    }
+  ]
+}
+  )EOF";
+
+  for (const bool linear : {true, false}) {
+    NiceMock<Runtime::MockLoader> runtime;
+    NiceMock<Upstream::MockClusterManager> cm;
+    ON_CALL(runtime.snapshot_, featureEnabled("router.linear_regex_engine", 100))
+        .WillByDefault(Return(linear));
+    ConfigImpl config(parseRouteConfigurationFromJson(json), runtime, cm, true);
+
+    {
+      Http::TestHeaderMapImpl headers = genHeaders("www.lyft.com", "/users/123", "PUT");
+      headers.addCopy("test_header", "teeest");
+      EXPECT_EQ("users_with_header", config.route(headers, 0)->routeEntry()->clusterName());
+      EXPECT_EQ("update_user",
+                config.route(headers, 0)->routeEntry()->virtualCluster(headers)->name());
+    }
+
+    {
+      Http::TestHeaderMapImpl headers = genHeaders("www.lyft.com", "/users/123", "POST");
+      EXPECT_EQ("users_lookahead", config.route(headers, 0)->routeEntry()->clusterName());
+      EXPECT_EQ("create_user",
+                config.route(headers, 0)->routeEntry()->virtualCluster(headers)->name());
+    }
+
+    {
+      Http::TestHeaderMapImpl headers = genHeaders("www.lyft.com", "/users/admin", "POST");
+      EXPECT_EQ("admin", config.route(headers, 0)->routeEntry()->clusterName());
+      EXPECT_EQ("users_or_groups",
+                config.route(headers, 0)->routeEntry()->virtualCluster(headers)->name());
+    }
+
+    {
+      Http::TestHeaderMapImpl headers = genHeaders("www.lyft.com", "/groups/1/members", "GET");
+      EXPECT_EQ("users_or_groups", config.route(headers, 0)->routeEntry()->clusterName());
+      EXPECT_EQ("users_or_groups",
+                config.route(headers, 0)->routeEntry()->virtualCluster(headers)->name());
+    }
+
+    EXPECT_EQ(nullptr, config.route(genHeaders("www.lyft.com", "/groups", "GET"), 0));
+  }
+}
+
 TEST(RouteMatcherTest, QueryParamMatchedRouting) {
   std::string json = R"EOF(
 {
@@ -1729,7 +1921,10 @@ TEST(RouteMatcherTest, Shadow) {
             "cluster": "some_cluster2",
             "runtime_key": "foo"
           },
-          "cluster": "www2"
+          "cluster": "www2",
+          "opaque_config" : {
+              "shadow_max_body_bytes": "4096"
+          }
         },
         {
           "prefix": "/baz",
@@ -1763,6 +1958,16 @@ TEST(RouteMatcherTest, Shadow) {
                        ->shadowPolicy()
                        .runtimeKey());
 
+  EXPECT_EQ(ShadowPolicyImpl::DefaultMaxBodyBytes,
+            config.route(genHeaders("www.lyft.com", "/foo", "GET"), 0)
+                ->routeEntry()
+                ->shadowPolicy()
+                .maxBodyBytes());
+  EXPECT_EQ(4096U, config.route(genHeaders("www.lyft.com", "/bar", "GET"), 0)
+                       ->routeEntry()
+                       ->shadowPolicy()
+                       .maxBodyBytes());
+
   EXPECT_EQ("", config.route(genHeaders("www.lyft.com", "/baz", "GET"), 0)
                     ->routeEntry()
                     ->shadowPolicy()
@@ -1773,6 +1978,38 @@ TEST(RouteMatcherTest, Shadow) {
                     .runtimeKey());
 }
 
+TEST(RouteMatcherTest, BadShadowMaxBodyBytes) {
+  std::string json = R"EOF(
+{
+  "virtual_hosts": [
+    {
+      "name": "www2",
+      "domains": ["www.lyft.com"],
+      "routes": [
+        {
+          "prefix": "/foo",
+          "shadow": {
+            "cluster": "some_cluster"
+          },
+          "cluster": "www2",
+          "opaque_config" : {
+              "shadow_max_body_bytes": "big"
+          }
+        }
+      ]
+    }
+  ]
+}
+  )EOF";
+
+  NiceMock<Runtime::MockLoader> runtime;
+  NiceMock<Upstream::MockClusterManager> cm;
+  EXPECT_THROW_WITH_MESSAGE(
+      ConfigImpl(parseRouteConfigurationFromJson(json), runtime, cm, true), EnvoyException,
+      "route: invalid 'shadow_max_body_bytes' value 'big', must be an integer in [0, "
+      "18446744073709551615]");
+}
+
 TEST(RouteMatcherTest, Retry) {
   std::string json = R"EOF(
 {
@@ -2278,6 +2515,7 @@ TEST(RouteMatcherTest, WeightedClusters) {
   // Weighted Cluster with valid runtime values
   {
     Http::TestHeaderMapImpl headers = genHeaders("www2.lyft.com", "/foo", "GET");
+    ON_CALL(runtime.snapshot_, version()).WillByDefault(Return(1));
     EXPECT_CALL(runtime.snapshot_, featureEnabled("www2", 100, _)).WillRepeatedly(Return(true));
     EXPECT_CALL(runtime.snapshot_, getInteger("www2_weights.cluster1", 30))
         .WillRepeatedly(Return(80));
@@ -2294,6 +2532,7 @@ TEST(RouteMatcherTest, WeightedClusters) {
   // Weighted Cluster with invalid runtime values
   {
     Http::TestHeaderMapImpl headers = genHeaders("www2.lyft.com", "/foo", "GET");
+    ON_CALL(runtime.snapshot_, version()).WillByDefault(Return(2));
     EXPECT_CALL(runtime.snapshot_, featureEnabled("www2", 100, _)).WillRepeatedly(Return(true));
     EXPECT_CALL(runtime.snapshot_, getInteger("www2_weights.cluster1", 30))
         .WillRepeatedly(Return(10));
@@ -2309,6 +2548,67 @@ TEST(RouteMatcherTest, WeightedClusters) {
     EXPECT_EQ("cluster2", config.route(headers, 82)->routeEntry()->clusterName());
     EXPECT_EQ("cluster2", config.route(headers, 92)->routeEntry()->clusterName());
   }
+
+  // Weighted Cluster with runtime values that add up to less than 100
+  {
+    Http::TestHeaderMapImpl headers = genHeaders("www2.lyft.com", "/foo", "GET");
+    ON_CALL(runtime.snapshot_, version()).WillByDefault(Return(3));
+    EXPECT_CALL(runtime.snapshot_, featureEnabled("www2", 100, _)).WillRepeatedly(Return(true));
+    EXPECT_CALL(runtime.snapshot_, getInteger("www2_weights.cluster1", 30))
+        .WillRepeatedly(Return(10));
+    EXPECT_CALL(runtime.snapshot_, getInteger("www2_weights.cluster2", 30))
+        .WillRepeatedly(Return(10));
+    EXPECT_CALL(runtime.snapshot_, getInteger("www2_weights.cluster3", 40))
+        .WillRepeatedly(Return(10));
+
+    // The last cluster takes the values past the sum of the weights.
+    EXPECT_EQ("cluster2", config.route(headers, 15)->routeEntry()->clusterName());
+    EXPECT_EQ("cluster3", config.route(headers, 25)->routeEntry()->clusterName());
+    EXPECT_EQ("cluster3", config.route(headers, 99)->routeEntry()->clusterName());
+  }
+}
+
+TEST(RouteMatcherTest, WeightedClustersRuntimeVersion) {
+  std::string json = R"EOF(
+{
+  "virtual_hosts": [
+    {
+      "name": "www2",
+      "domains": ["www2.lyft.com"],
+      "routes": [
+        {
+          "prefix": "/",
+          "weighted_clusters": {
+            "runtime_key_prefix" : "www2_weights",
+            "clusters" : [
+              { "name" : "cluster1", "weight" : 30 },
+              { "name" : "cluster2", "weight" : 70 }
+            ]
+          }
+        }
+      ]
+    }
+  ]
+}
+  )EOF";
+
+  NiceMock<Runtime::MockLoader> runtime;
+  NiceMock<Upstream::MockClusterManager> cm;
+  ConfigImpl config(parseRouteConfigurationFromJson(json), runtime, cm, true);
+  Http::TestHeaderMapImpl headers = genHeaders("www2.lyft.com", "/foo", "GET");
+
+  // The weights are only looked up again once the runtime snapshot changes.
+  EXPECT_CALL(runtime.snapshot_, getInteger("www2_weights.cluster1", 30)).Times(0);
+  EXPECT_CALL(runtime.snapshot_, getInteger("www2_weights.cluster2", 70)).Times(0);
+  EXPECT_EQ("cluster1", config.route(headers, 29)->routeEntry()->clusterName());
+  EXPECT_EQ("cluster2", config.route(headers, 30)->routeEntry()->clusterName());
+
+  EXPECT_CALL(runtime.snapshot_, version()).WillRepeatedly(Return(1));
+  EXPECT_CALL(runtime.snapshot_, getInteger("www2_weights.cluster1", 30)).WillOnce(Return(50));
+  EXPECT_CALL(runtime.snapshot_, getInteger("www2_weights.cluster2", 70)).WillOnce(Return(50));
+  EXPECT_EQ("cluster1", config.route(headers, 30)->routeEntry()->clusterName());
+  EXPECT_EQ("cluster1", config.route(headers, 49)->routeEntry()->clusterName());
+  EXPECT_EQ("cluster2", config.route(headers, 50)->routeEntry()->clusterName());
 }
 
 TEST(RouteMatcherTest, ExclusiveWeightedClustersOrClusterConfig) {
@@ -2489,6 +2789,62 @@ TEST(RouteMatcherTest, TestWeightedClusterInvalidClusterName) {
                EnvoyException);
 }
 
+TEST(RouteMatcherTest, ReuseUnchangedVirtualHosts) {
+  const std::string yaml = R"EOF(
+name: foo
+virtual_hosts:
+  - name: unchanged
+    domains: [unchanged.lyft.com]
+    routes:
+      - match: { prefix: "/" }
+        route: { cluster: unchanged }
+  - name: changed
+    domains: [changed.lyft.com]
+    routes:
+      - match: { prefix: "/" }
+        route: { cluster: before }
+  )EOF";
+
+  NiceMock<Runtime::MockLoader> runtime;
+  NiceMock<Upstream::MockClusterManager> cm;
+  const envoy::api::v2::RouteConfiguration route_config = parseRouteConfigurationFromV2Yaml(yaml);
+  ConfigImpl config(route_config, runtime, cm, false);
+  EXPECT_EQ(0UL, config.reusedVirtualHosts());
+
+  envoy::api::v2::RouteConfiguration updated_route_config = route_config;
+  updated_route_config.mutable_virtual_hosts(1)->mutable_routes(0)->mutable_route()->set_cluster(
+      "after");
+  ConfigImpl updated_config(updated_route_config, runtime, cm, false, &config);
+  EXPECT_EQ(1UL, updated_config.reusedVirtualHosts());
+
+  const Http::TestHeaderMapImpl unchanged_headers = genHeaders("unchanged.lyft.com", "/", "GET");
+  EXPECT_EQ(&config.route(unchanged_headers, 0)->routeEntry()->virtualHost(),
+            &updated_config.route(unchanged_headers, 0)->routeEntry()->virtualHost());
+
+  const Http::TestHeaderMapImpl changed_headers = genHeaders("changed.lyft.com", "/", "GET");
+  EXPECT_NE(&config.route(changed_headers, 0)->routeEntry()->virtualHost(),
+            &updated_config.route(changed_headers, 0)->routeEntry()->virtualHost());
+  EXPECT_EQ("after", updated_config.route(changed_headers, 0)->routeEntry()->clusterName());
+
+  // Virtual hosts are not reused when the global settings change, nor when clusters are
+  // validated.
+  updated_route_config.add_response_headers_to_remove("x-foo");
+  EXPECT_EQ(0UL,
+            ConfigImpl(updated_route_config, runtime, cm, false, &config).reusedVirtualHosts());
+  EXPECT_EQ(0UL, ConfigImpl(route_config, runtime, cm, true, &config).reusedVirtualHosts());
+
+  // The reused virtual hosts keep working once the configuration that built them is gone.
+  std::unique_ptr<ConfigImpl> first(new ConfigImpl(route_config, runtime, cm, false));
+  ConfigImpl second(route_config, runtime, cm, false, first.get());
+  EXPECT_EQ(2UL, second.reusedVirtualHosts());
+  first.reset();
+  Http::TestHeaderMapImpl headers = genHeaders("unchanged.lyft.com", "/", "GET");
+  const RouteEntry* route_entry = second.route(headers, 0)->routeEntry();
+  EXPECT_EQ("unchanged", route_entry->clusterName());
+  NiceMock<Envoy::RequestInfo::MockRequestInfo> request_info;
+  route_entry->finalizeRequestHeaders(headers, request_info);
+}
+
 TEST(NullConfigImplTest, All) {
   NullConfigImpl config;
   Http::TestHeaderMapImpl headers = genRedirectHeaders("redirect.lyft.com", "/baz", true, false);
@@ -2764,6 +3120,214 @@ TEST(RouteMatcherTest, TestOpaqueConfig) {
   EXPECT_EQ(opaque_config.find("name2")->second, "value2");
 }
 
+TEST(RouteMatcherTest, ClusterHandle) {
+  std::string json = R"EOF(
+{
+  "virtual_hosts": [
+    {
+      "name": "default",
+      "domains": ["*"],
+      "routes": [
+        {
+          "prefix": "/weighted",
+          "weighted_clusters": {
+            "clusters" : [
+              { "name" : "cluster1", "weight" : 50 },
+              { "name" : "cluster2", "weight" : 50 }
+            ]
+          }
+        },
+        {
+          "prefix": "/header",
+          "cluster_header": "some_header"
+        },
+        {
+          "prefix": "/",
+          "cluster": "www2"
+        }
+      ]
+    }
+  ]
+}
+)EOF";
+
+  NiceMock<Runtime::MockLoader> runtime;
+  NiceMock<Upstream::MockClusterManager> cm;
+  Upstream::MockClusterHandle* cluster1 = new Upstream::MockClusterHandle();
+  Upstream::MockClusterHandle* cluster2 = new Upstream::MockClusterHandle();
+  Upstream::MockClusterHandle* www2 = new Upstream::MockClusterHandle();
+  EXPECT_CALL(cm, clusterHandle_("cluster1")).WillOnce(Return(cluster1));
+  EXPECT_CALL(cm, clusterHandle_("cluster2")).WillOnce(Return(cluster2));
+  EXPECT_CALL(cm, clusterHandle_("www2")).WillOnce(Return(www2));
+  ConfigImpl config(parseRouteConfigurationFromJson(json), runtime, cm, true);
+
+  EXPECT_EQ(cluster1, config.route(genHeaders("www.lyft.com", "/weighted", "GET"), 10)
+                          ->routeEntry()
+                          ->clusterHandle());
+  EXPECT_EQ(cluster2, config.route(genHeaders("www.lyft.com", "/weighted", "GET"), 60)
+                          ->routeEntry()
+                          ->clusterHandle());
+  EXPECT_EQ(www2,
+            config.route(genHeaders("www.lyft.com", "/", "GET"), 0)->routeEntry()->clusterHandle());
+
+  Http::TestHeaderMapImpl headers = genHeaders("www.lyft.com", "/header", "GET");
+  headers.addCopy("some_header", "www2");
+  EXPECT_EQ(nullptr, config.route(headers, 0)->routeEntry()->clusterHandle());
+}
+
+TEST(RouteMatcherTest, HedgePolicy) {
+  std::string json = R"EOF(
+{
+  "virtual_hosts": [
+    {
+      "name": "default",
+      "domains": ["*"],
+      "routes": [
+        {
+          "prefix": "/hedged",
+          "cluster": "ats",
+          "opaque_config" : {
+              "hedge_percentile": "95",
+              "hedge_budget_percent": "5"
+          }
+        },
+        {
+          "prefix": "/",
+          "cluster": "ats"
+        }
+      ]
+    }
+  ]
+}
+)EOF";
+
+  NiceMock<Runtime::MockLoader> runtime;
+  NiceMock<Upstream::MockClusterManager> cm;
+  ConfigImpl config(parseRouteConfigurationFromJson(json), runtime, cm, true);
+
+  EXPECT_NE(nullptr, config.route(genHeaders("www.lyft.com", "/hedged", "GET"), 0)
+                         ->routeEntry()
+                         ->retryPolicy()
+                         .hedgePolicy());
+  EXPECT_EQ(nullptr, config.route(genHeaders("www.lyft.com", "/", "GET"), 0)
+                         ->routeEntry()
+                         ->retryPolicy()
+                         .hedgePolicy());
+}
+
+TEST(RouteMatcherTest, RetryMaxReplayBytes) {
+  std::string json = R"EOF(
+{
+  "virtual_hosts": [
+    {
+      "name": "default",
+      "domains": ["*"],
+      "routes": [
+        {
+          "prefix": "/bounded",
+          "cluster": "ats",
+          "opaque_config" : {
+              "retry_max_replay_bytes": "16384"
+          }
+        },
+        {
+          "prefix": "/",
+          "cluster": "ats"
+        }
+      ]
+    }
+  ]
+}
+)EOF";
+
+  NiceMock<Runtime::MockLoader> runtime;
+  NiceMock<Upstream::MockClusterManager> cm;
+  ConfigImpl config(parseRouteConfigurationFromJson(json), runtime, cm, true);
+
+  EXPECT_EQ(16384U, config.route(genHeaders("www.lyft.com", "/bounded", "POST"), 0)
+                        ->routeEntry()
+                        ->retryPolicy()
+                        .maxReplayBytes());
+  EXPECT_EQ(UINT64_MAX, config.route(genHeaders("www.lyft.com", "/", "POST"), 0)
+                            ->routeEntry()
+                            ->retryPolicy()
+                            .maxReplayBytes());
+}
+
+TEST(RouteMatcherTest, BadHedgePolicy) {
+  std::string json = R"EOF(
+{
+  "virtual_hosts": [
+    {
+      "name": "default",
+      "domains": ["*"],
+      "routes": [
+        {
+          "prefix": "/",
+          "cluster": "ats",
+          "opaque_config" : {
+              "hedge_percentile": "100"
+          }
+        }
+      ]
+    }
+  ]
+}
+)EOF";
+
+  NiceMock<Runtime::MockLoader> runtime;
+  NiceMock<Upstream::MockClusterManager> cm;
+  EXPECT_THROW_WITH_MESSAGE(
+      ConfigImpl(parseRouteConfigurationFromJson(json), runtime, cm, true), EnvoyException,
+      "route: invalid 'hedge_percentile' value '100', must be an integer in [1, 99]");
+}
+
+TEST(HedgePolicyImplTest, DelayFollowsPercentile) {
+  HedgePolicyImpl policy(90, 10, std::chrono::milliseconds(0));
+  for (uint64_t i = 1; i < HedgePolicyImpl::MinSamples; i++) {
+    policy.recordResponseTime(std::chrono::milliseconds(i));
+  }
+  // Not enough samples yet.
+  EXPECT_EQ(std::chrono::milliseconds(0), policy.hedgeDelay());
+
+  policy.recordResponseTime(std::chrono::milliseconds(HedgePolicyImpl::MinSamples));
+  // The 90th of the times 1..100 ms, rounded up to the bound of its bucket.
+  EXPECT_LE(std::chrono::milliseconds(90), policy.hedgeDelay());
+  EXPECT_GE(std::chrono::milliseconds(113), policy.hedgeDelay());
+}
+
+TEST(HedgePolicyImplTest, MinDelay) {
+  HedgePolicyImpl policy(50, 10, std::chrono::milliseconds(200));
+  for (uint64_t i = 0; i < HedgePolicyImpl::MinSamples; i++) {
+    policy.recordResponseTime(std::chrono::milliseconds(10));
+  }
+  EXPECT_EQ(std::chrono::milliseconds(200), policy.hedgeDelay());
+}
+
+TEST(HedgePolicyImplTest, Budget) {
+  HedgePolicyImpl policy(90, 10, std::chrono::milliseconds(0));
+  EXPECT_FALSE(policy.tryHedge());
+  for (uint64_t i = 0; i < 100; i++) {
+    policy.recordResponseTime(std::chrono::milliseconds(10));
+  }
+  for (uint64_t i = 0; i < 10; i++) {
+    EXPECT_TRUE(policy.tryHedge());
+  }
+  EXPECT_FALSE(policy.tryHedge());
+}
+
+TEST(HedgePolicyImplTest, RecentTimesWin) {
+  HedgePolicyImpl policy(50, 10, std::chrono::milliseconds(0));
+  for (uint64_t i = 0; i < HedgePolicyImpl::WindowSamples / 2; i++) {
+    policy.recordResponseTime(std::chrono::milliseconds(10));
+  }
+  // Halving the counts leaves the slow times in the majority.
+  for (uint64_t i = 0; i < HedgePolicyImpl::WindowSamples; i++) {
+    policy.recordResponseTime(std::chrono::milliseconds(1000));
+  }
+  EXPECT_LE(std::chrono::milliseconds(1000), policy.hedgeDelay());
+}
+
 TEST(RoutePropertyTest, excludeVHRateLimits) {
   std::string json = R"EOF(
   {
@@ -2937,6 +3501,53 @@ TEST(RoutePropertyTest, TestRouteCorsConfig) {
   EXPECT_EQ(cors_policy->allowCredentials(), true);
 }
 
+TEST(RoutePropertyTest, TestCorsAllowsOrigin) {
+  std::string json = R"EOF(
+{
+  "virtual_hosts": [
+    {
+      "name": "default",
+      "domains": ["*"],
+      "routes": [
+        {
+          "prefix": "/api",
+          "cluster": "ats",
+          "cors" : {
+              "allow_origin": ["https://www.lyft.com", "*.lyft.net"]
+          }
+        },
+        {
+          "prefix": "/",
+          "cluster": "ats",
+          "cors" : {
+              "allow_origin": ["https://www.lyft.com", "*"]
+          }
+        }
+      ]
+    }
+  ]
+}
+)EOF";
+
+  NiceMock<Runtime::MockLoader> runtime;
+  NiceMock<Upstream::MockClusterManager> cm;
+  ConfigImpl config(parseRouteConfigurationFromJson(json), runtime, cm, true);
+  auto allows = [&config](const std::string& path, const std::string& origin) -> bool {
+    return config.route(genHeaders("api.lyft.com", path, "GET"), 0)
+        ->routeEntry()
+        ->corsPolicy()
+        ->allowsOrigin(Http::HeaderString(origin));
+  };
+
+  EXPECT_TRUE(allows("/api", "https://www.lyft.com"));
+  EXPECT_TRUE(allows("/api", "https://api.lyft.net"));
+  EXPECT_FALSE(allows("/api", ".lyft.net"));
+  EXPECT_FALSE(allows("/api", "https://www.lyft.com.evil"));
+  EXPECT_FALSE(allows("/api", "https://www.lyft.net.evil"));
+  EXPECT_FALSE(allows("/api", "*"));
+  EXPECT_TRUE(allows("/", "https://www.example.com"));
+}
+
 TEST(RoutePropertyTest, TestBadCorsConfig) {
   std::string json = R"EOF(
 {
@@ -3318,6 +3929,87 @@ TEST(ConfigUtility, ParseResponseCode) {
   }
 }
 
+TEST(ConfigUtility, MatchContext) {
+  envoy::api::v2::HeaderMatcher config;
+  config.set_name("x-shard");
+  config.set_value("1");
+  ConfigUtility::HeaderData shard1(config);
+  config.set_value("2");
+  ConfigUtility::HeaderData shard2(config);
+  config.set_name("x-region");
+  config.set_value("");
+  ConfigUtility::HeaderData region(config);
+  ConfigUtility::HeaderData unindexed(config);
+
+  // Header data with the same name share a slot.
+  ConfigUtility::HeaderNameIndex header_names;
+  shard1.name_slot_ = header_names.add(shard1.name_);
+  shard2.name_slot_ = header_names.add(shard2.name_);
+  region.name_slot_ = header_names.add(region.name_);
+  EXPECT_EQ(shard1.name_slot_, shard2.name_slot_);
+  EXPECT_NE(shard1.name_slot_, region.name_slot_);
+  EXPECT_EQ(2U, header_names.size());
+  EXPECT_EQ(ConfigUtility::HeaderNameIndex::NO_SLOT, unindexed.name_slot_);
+
+  Http::TestHeaderMapImpl headers{{":path", "/foo?bar=baz"}, {"x-shard", "2"}};
+  ConfigUtility::MatchContext context(headers, header_names);
+  EXPECT_EQ(nullptr, context.header(region));
+  EXPECT_EQ(nullptr, context.header(unindexed));
+  EXPECT_STREQ("2", context.header(shard1)->value().c_str());
+
+  std::vector<ConfigUtility::HeaderData> config_headers;
+  config_headers.emplace_back(std::move(shard2));
+  EXPECT_TRUE(ConfigUtility::matchHeaders(context, config_headers));
+  config_headers.emplace_back(std::move(region));
+  EXPECT_FALSE(ConfigUtility::matchHeaders(context, config_headers));
+
+  EXPECT_EQ("baz", context.queryParams().at("bar"));
+  EXPECT_EQ(&context.queryParams(), &context.queryParams());
+
+  EXPECT_FALSE(context.pathMatched());
+  context.setPathMatched(true);
+  EXPECT_TRUE(context.pathMatched());
+}
+
+TEST(RouteMatcherTest, ManyHeaderMatchedRoutes) {
+  envoy::api::v2::RouteConfiguration route_config;
+  auto* virtual_host = route_config.add_virtual_hosts();
+  virtual_host->set_name("shards");
+  virtual_host->add_domains("*");
+  for (int i = 0; i < 100; i++) {
+    auto* route = virtual_host->add_routes();
+    route->mutable_match()->set_prefix("/");
+    auto* header = route->mutable_match()->add_headers();
+    header->set_name("x-shard");
+    header->set_value(std::to_string(i));
+    if (i % 2 == 1) {
+      auto* query_parameter = route->mutable_match()->add_query_parameters();
+      query_parameter->set_name("odd");
+    }
+    route->mutable_route()->set_cluster("shard" + std::to_string(i));
+  }
+  auto* route = virtual_host->add_routes();
+  route->mutable_match()->set_prefix("/");
+  route->mutable_route()->set_cluster("default");
+
+  NiceMock<Runtime::MockLoader> runtime;
+  NiceMock<Upstream::MockClusterManager> cm;
+  ConfigImpl config(route_config, runtime, cm, true);
+
+  Http::TestHeaderMapImpl headers = genHeaders("www.lyft.com", "/", "GET");
+  EXPECT_EQ("default", config.route(headers, 0)->routeEntry()->clusterName());
+
+  headers.addCopy("x-shard", "42");
+  EXPECT_EQ("shard42", config.route(headers, 0)->routeEntry()->clusterName());
+
+  // Odd shards also require the query parameter.
+  headers.remove(Http::LowerCaseString("x-shard"));
+  headers.addCopy("x-shard", "43");
+  EXPECT_EQ("default", config.route(headers, 0)->routeEntry()->clusterName());
+  headers.insertPath().value(std::string("/?odd"));
+  EXPECT_EQ("shard43", config.route(headers, 0)->routeEntry()->clusterName());
+}
+
 TEST(RouteConfigurationV2, RedirectCode) {
   std::string yaml = R"EOF(
 name: foo
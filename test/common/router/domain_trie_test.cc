@@ -0,0 +1,71 @@
+#include <string>
+
+#include "common/router/domain_trie.h"
+
+#include "gtest/gtest.h"
+
+namespace Envoy {
+namespace Router {
+
+int find(const DomainTrie<int>& trie, const std::string& host) {
+  const int* value = trie.find(host);
+  return value != nullptr ? *value : -1;
+}
+
+TEST(DomainTrieTest, Empty) {
+  DomainTrie<int> trie;
+  EXPECT_TRUE(trie.empty());
+  EXPECT_EQ(-1, find(trie, "foo.com"));
+  EXPECT_EQ(-1, find(trie, ""));
+}
+
+TEST(DomainTrieTest, Exact) {
+  DomainTrie<int> trie;
+  EXPECT_TRUE(trie.addDomain("foo.com", 1));
+  EXPECT_TRUE(trie.addDomain("bar.foo.com", 2));
+  EXPECT_TRUE(trie.addDomain("oo.com", 3));
+  EXPECT_FALSE(trie.addDomain("foo.com", 4));
+  EXPECT_FALSE(trie.empty());
+
+  EXPECT_EQ(1, find(trie, "foo.com"));
+  EXPECT_EQ(2, find(trie, "bar.foo.com"));
+  EXPECT_EQ(3, find(trie, "oo.com"));
+  EXPECT_EQ(-1, find(trie, "o.com"));
+  EXPECT_EQ(-1, find(trie, "baz.foo.com"));
+  EXPECT_EQ(-1, find(trie, "afoo.com"));
+  EXPECT_EQ(-1, find(trie, ""));
+}
+
+TEST(DomainTrieTest, LongestWildcard) {
+  DomainTrie<int> trie;
+  EXPECT_TRUE(trie.addWildcard(".baz.com", 1));
+  EXPECT_TRUE(trie.addWildcard("-bar.baz.com", 2));
+  EXPECT_TRUE(trie.addWildcard("az.com", 3));
+  EXPECT_FALSE(trie.addWildcard(".baz.com", 4));
+
+  EXPECT_EQ(2, find(trie, "foo-bar.baz.com"));
+  EXPECT_EQ(1, find(trie, "foo.bar.baz.com"));
+  EXPECT_EQ(1, find(trie, "-bar.baz.com"));
+  EXPECT_EQ(3, find(trie, "quaz.com"));
+  EXPECT_EQ(3, find(trie, "baz.com"));
+  // *.baz.com doesn't match .baz.com.
+  EXPECT_EQ(3, find(trie, ".baz.com"));
+  EXPECT_EQ(-1, find(trie, "az.com"));
+  EXPECT_EQ(-1, find(trie, "foo.com"));
+}
+
+TEST(DomainTrieTest, ExactBeforeWildcard) {
+  DomainTrie<int> trie;
+  EXPECT_TRUE(trie.addWildcard(".foo.com", 1));
+  EXPECT_TRUE(trie.addDomain("www.foo.com", 2));
+  EXPECT_TRUE(trie.addWildcard("w.foo.com", 3));
+
+  EXPECT_EQ(2, find(trie, "www.foo.com"));
+  EXPECT_EQ(3, find(trie, "ww.foo.com"));
+  EXPECT_EQ(3, find(trie, "wwww.foo.com"));
+  EXPECT_EQ(1, find(trie, "api.foo.com"));
+  EXPECT_EQ(-1, find(trie, "foo.com"));
+}
+
+} // namespace Router
+} // namespace Envoy
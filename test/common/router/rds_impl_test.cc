@@ -281,9 +281,10 @@ TEST_F(RdsImplTest, Basic) {
   expectRequest();
   interval_timer_->callback_();
 
-  // Load the config and verified shared count.
+  // Load the config and verified shared count. The provider keeps a reference to the last config
+  // loaded, in addition to the thread local one.
   ConfigConstSharedPtr config = rds_->config();
-  EXPECT_EQ(2, config.use_count());
+  EXPECT_EQ(3, config.use_count());
 
   // Third request.
   const std::string response2_json = R"EOF(
@@ -364,6 +365,7 @@ TEST_F(RdsImplTest, Basic) {
   EXPECT_EQ(1, config.use_count());
 
   EXPECT_EQ(2UL, store_.counter("foo.rds.foo_route_config.config_reload").value());
+  EXPECT_EQ(0UL, store_.counter("foo.rds.foo_route_config.virtual_host_reused").value());
   EXPECT_EQ(3UL, store_.counter("foo.rds.foo_route_config.update_attempt").value());
   EXPECT_EQ(3UL, store_.counter("foo.rds.foo_route_config.update_success").value());
   EXPECT_EQ(8808926191882896258U, store_.gauge("foo.rds.foo_route_config.version").value());
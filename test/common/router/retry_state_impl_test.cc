@@ -251,6 +251,24 @@ TEST_F(RouterRetryStateImplTest, NoAvailableRetries) {
 
   EXPECT_EQ(RetryStatus::NoOverflow, state_->shouldRetry(nullptr, connect_failure_, callback_));
   EXPECT_EQ(1UL, cluster_.stats().upstream_rq_retry_overflow_.value());
+  EXPECT_EQ(0UL, cluster_.stats().upstream_rq_retry_budget_exhausted_.value());
+}
+
+TEST_F(RouterRetryStateImplTest, RetryBudgetExhausted) {
+  cluster_.resource_manager_.reset(
+      new Upstream::ResourceManagerImpl(runtime_, "fake_key.", 0, 0, 0, 0));
+  ON_CALL(runtime_.snapshot_, getInteger("fake_key.retry_budget.budget_percent", 0))
+      .WillByDefault(Return(20));
+  ON_CALL(runtime_.snapshot_, getInteger("fake_key.retry_budget.min_retry_concurrency", 3))
+      .WillByDefault(Return(0));
+
+  Http::TestHeaderMapImpl request_headers{{"x-envoy-retry-on", "connect-failure"}};
+  setup(request_headers);
+  EXPECT_TRUE(state_->enabled());
+
+  EXPECT_EQ(RetryStatus::NoOverflow, state_->shouldRetry(nullptr, connect_failure_, callback_));
+  EXPECT_EQ(1UL, cluster_.stats().upstream_rq_retry_overflow_.value());
+  EXPECT_EQ(1UL, cluster_.stats().upstream_rq_retry_budget_exhausted_.value());
 }
 
 TEST_F(RouterRetryStateImplTest, MaxRetriesHeader) {
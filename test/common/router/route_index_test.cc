@@ -0,0 +1,86 @@
+#include <string>
+#include <vector>
+
+#include "common/router/route_index.h"
+
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+
+using testing::ElementsAre;
+using testing::IsEmpty;
+
+namespace Envoy {
+namespace Router {
+
+class RouteIndexTest : public testing::Test {
+public:
+  std::vector<uint32_t> candidates(const std::string& path) {
+    std::vector<uint32_t> candidates{1234};
+    index_.candidates(path.c_str(), path.size(), candidates);
+    return candidates;
+  }
+
+  RouteIndex index_;
+};
+
+TEST_F(RouteIndexTest, Empty) { EXPECT_THAT(candidates("/foo"), IsEmpty()); }
+
+TEST_F(RouteIndexTest, Paths) {
+  index_.addPath("/foo", 0);
+  index_.addPath("/foo/bar", 1);
+  index_.addPath("/foo", 2);
+
+  EXPECT_THAT(candidates("/foo"), ElementsAre(0, 2));
+  EXPECT_THAT(candidates("/foo?bar=baz"), ElementsAre(0, 2));
+  EXPECT_THAT(candidates("/FOO/Bar"), ElementsAre(1));
+  EXPECT_THAT(candidates("/foo/"), IsEmpty());
+  EXPECT_THAT(candidates("/fo"), IsEmpty());
+  EXPECT_THAT(candidates(""), IsEmpty());
+}
+
+TEST_F(RouteIndexTest, Prefixes) {
+  index_.addPrefix("/foo/bar", 0);
+  index_.addPrefix("/foo", 1);
+  index_.addPrefix("/foo/baz", 2);
+  index_.addPrefix("/", 3);
+  index_.addPrefix("/fo", 4);
+  index_.addPrefix("/foo/bar", 5);
+
+  EXPECT_THAT(candidates("/foo/bar/qux"), ElementsAre(0, 1, 3, 4, 5));
+  EXPECT_THAT(candidates("/foo/ba"), ElementsAre(1, 3, 4));
+  EXPECT_THAT(candidates("/Foo/BAZ"), ElementsAre(1, 2, 3, 4));
+  EXPECT_THAT(candidates("/fox"), ElementsAre(3, 4));
+  EXPECT_THAT(candidates("/bar"), ElementsAre(3));
+  EXPECT_THAT(candidates("bar"), IsEmpty());
+  EXPECT_THAT(candidates(""), IsEmpty());
+}
+
+TEST_F(RouteIndexTest, PrefixIncludesQueryString) {
+  index_.addPrefix("/foo?bar", 0);
+
+  EXPECT_THAT(candidates("/foo?bar=baz"), ElementsAre(0));
+  EXPECT_THAT(candidates("/foo"), IsEmpty());
+}
+
+TEST_F(RouteIndexTest, EmptyPrefixMatchesEverything) {
+  index_.addPrefix("", 0);
+
+  EXPECT_THAT(candidates("/foo"), ElementsAre(0));
+  EXPECT_THAT(candidates(""), ElementsAre(0));
+}
+
+TEST_F(RouteIndexTest, Ordering) {
+  index_.addFallback(0);
+  index_.addPrefix("/foo", 1);
+  index_.addPath("/foo/bar", 2);
+  index_.addFallback(3);
+  index_.addPrefix("/", 4);
+  index_.addPath("/baz", 5);
+
+  EXPECT_THAT(candidates("/foo/bar"), ElementsAre(0, 1, 2, 3, 4));
+  EXPECT_THAT(candidates("/baz"), ElementsAre(0, 3, 4, 5));
+  EXPECT_THAT(candidates("qux"), ElementsAre(0, 3));
+}
+
+} // namespace Router
+} // namespace Envoy
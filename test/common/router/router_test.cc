@@ -8,12 +8,14 @@
 #include "common/upstream/upstream_impl.h"
 
 #include "test/common/http/common.h"
+#include "test/mocks/buffer/mocks.h"
 #include "test/mocks/http/mocks.h"
 #include "test/mocks/local_info/mocks.h"
 #include "test/mocks/network/mocks.h"
 #include "test/mocks/router/mocks.h"
 #include "test/mocks/runtime/mocks.h"
 #include "test/mocks/ssl/mocks.h"
+#include "test/mocks/thread_local/mocks.h"
 #include "test/mocks/upstream/mocks.h"
 #include "test/test_common/printers.h"
 #include "test/test_common/utility.h"
@@ -24,7 +26,6 @@
 using testing::AssertionFailure;
 using testing::AssertionResult;
 using testing::AssertionSuccess;
-using testing::AtLeast;
 using testing::Invoke;
 using testing::MockFunction;
 using testing::NiceMock;
@@ -146,6 +147,38 @@ TEST_F(RouterTest, ClusterNotFound) {
   EXPECT_TRUE(verifyHostUpstreamStats(0, 0));
 }
 
+TEST_F(RouterTest, ClusterHandle) {
+  NiceMock<Upstream::MockClusterHandle> cluster_handle;
+  ON_CALL(callbacks_.route_->route_entry_, clusterHandle()).WillByDefault(Return(&cluster_handle));
+  EXPECT_CALL(cluster_handle, get()).WillRepeatedly(Return(&cm_.thread_local_cluster_));
+  EXPECT_CALL(cm_, get(_)).Times(0);
+
+  EXPECT_CALL(cm_.thread_local_cluster_, httpConnPool(_, _, &router_));
+  EXPECT_CALL(cm_.conn_pool_, newStream(_, _)).WillOnce(Return(&cancellable_));
+  expectResponseTimerCreate();
+
+  Http::TestHeaderMapImpl headers;
+  HttpTestUtility::addDefaultHeaders(headers);
+  router_.decodeHeaders(headers, true);
+
+  EXPECT_CALL(cancellable_, cancel());
+  router_.onDestroy();
+}
+
+TEST_F(RouterTest, ClusterHandleNotFound) {
+  EXPECT_CALL(callbacks_.request_info_, setResponseFlag(RequestInfo::ResponseFlag::NoRouteFound));
+
+  NiceMock<Upstream::MockClusterHandle> cluster_handle;
+  ON_CALL(callbacks_.route_->route_entry_, clusterHandle()).WillByDefault(Return(&cluster_handle));
+  EXPECT_CALL(cm_, get(_)).Times(0);
+
+  Http::TestHeaderMapImpl headers;
+  HttpTestUtility::addDefaultHeaders(headers);
+  router_.decodeHeaders(headers, true);
+  EXPECT_EQ(1UL, stats_store_.counter("test.no_cluster").value());
+  EXPECT_TRUE(verifyHostUpstreamStats(0, 0));
+}
+
 TEST_F(RouterTest, PoolFailureWithPriority) {
   ON_CALL(callbacks_.route_->route_entry_, priority())
       .WillByDefault(Return(Upstream::ResourcePriority::High));
@@ -1215,6 +1248,7 @@ TEST_F(RouterTest, RetryTimeoutDuringRetryDelay) {
               setResponseFlag(RequestInfo::ResponseFlag::UpstreamRequestTimeout));
 
   EXPECT_CALL(cm_.conn_pool_.host_->outlier_detector_, putResponseTime(_)).Times(0);
+  EXPECT_CALL(*cm_.conn_pool_.host_, putResponseTime(_)).Times(0);
   Http::TestHeaderMapImpl response_headers{
       {":status", "504"}, {"content-length", "24"}, {"content-type", "text/plain"}};
   EXPECT_CALL(callbacks_, encodeHeaders_(HeaderMapEqualRef(&response_headers), false));
@@ -1261,6 +1295,7 @@ TEST_F(RouterTest, RetryTimeoutDuringRetryDelayWithUpstreamRequestNoHost) {
               setResponseFlag(RequestInfo::ResponseFlag::UpstreamRequestTimeout));
 
   EXPECT_CALL(cm_.conn_pool_.host_->outlier_detector_, putResponseTime(_)).Times(0);
+  EXPECT_CALL(*cm_.conn_pool_.host_, putResponseTime(_)).Times(0);
   Http::TestHeaderMapImpl response_headers{
       {":status", "504"}, {"content-length", "24"}, {"content-type", "text/plain"}};
   EXPECT_CALL(callbacks_, encodeHeaders_(HeaderMapEqualRef(&response_headers), false));
@@ -1310,6 +1345,7 @@ TEST_F(RouterTest, RetryTimeoutDuringRetryDelayWithUpstreamRequestNoHostAltRespo
               setResponseFlag(RequestInfo::ResponseFlag::UpstreamRequestTimeout));
 
   EXPECT_CALL(cm_.conn_pool_.host_->outlier_detector_, putResponseTime(_)).Times(0);
+  EXPECT_CALL(*cm_.conn_pool_.host_, putResponseTime(_)).Times(0);
   Http::TestHeaderMapImpl response_headers{{":status", "204"}};
   EXPECT_CALL(callbacks_, encodeHeaders_(HeaderMapEqualRef(&response_headers), true));
   response_timeout_->callback_();
@@ -1366,6 +1402,7 @@ TEST_F(RouterTest, RetryUpstream5xxNotComplete) {
   EXPECT_CALL(*router_.retry_state_, shouldRetry(_, _, _)).WillOnce(Return(RetryStatus::No));
   EXPECT_CALL(cm_.conn_pool_.host_->outlier_detector_, putHttpResponseCode(200));
   EXPECT_CALL(cm_.conn_pool_.host_->outlier_detector_, putResponseTime(_));
+  EXPECT_CALL(*cm_.conn_pool_.host_, putResponseTime(_));
   EXPECT_CALL(cm_.conn_pool_.host_->health_checker_, setUnhealthy());
   Http::HeaderMapPtr response_headers2(new Http::TestHeaderMapImpl{
       {":status", "200"}, {"x-envoy-immediate-health-check-fail", "true"}});
@@ -1436,6 +1473,7 @@ TEST_F(RouterTest, RetryUpstreamGrpcCancelled) {
 TEST_F(RouterTest, Shadow) {
   callbacks_.route_->route_entry_.shadow_policy_.cluster_ = "foo";
   callbacks_.route_->route_entry_.shadow_policy_.runtime_key_ = "bar";
+  callbacks_.route_->route_entry_.shadow_policy_.max_body_bytes_ = 100;
   ON_CALL(callbacks_, streamId()).WillByDefault(Return(43));
 
   NiceMock<Http::MockStreamEncoder> encoder;
@@ -1447,27 +1485,25 @@ TEST_F(RouterTest, Shadow) {
         callbacks.onPoolReady(encoder, cm_.conn_pool_.host_);
         return nullptr;
       }));
-  expectResponseTimerCreate();
 
   EXPECT_CALL(runtime_.snapshot_, featureEnabled("bar", 0, 43, 10000)).WillOnce(Return(true));
 
   Http::TestHeaderMapImpl headers;
   HttpTestUtility::addDefaultHeaders(headers);
+  MockShadowStream* shadow_stream = new MockShadowStream();
+  EXPECT_CALL(*shadow_writer_, start_("foo", _, false, std::chrono::milliseconds(10), 100))
+      .WillOnce(Return(shadow_stream));
   router_.decodeHeaders(headers, false);
 
-  Buffer::InstancePtr body_data(new Buffer::OwnedImpl("hello"));
-  EXPECT_EQ(Http::FilterDataStatus::StopIterationAndBuffer, router_.decodeData(*body_data, false));
+  // The shadow gets the data as it is proxied, so shadowing does not buffer the request.
+  Buffer::OwnedImpl body_data("hello");
+  EXPECT_CALL(*shadow_stream, sendData(BufferStringEqual("hello"), false)).WillOnce(Return(true));
+  EXPECT_CALL(encoder, encodeData(BufferStringEqual("hello"), false));
+  EXPECT_EQ(Http::FilterDataStatus::StopIterationNoBuffer, router_.decodeData(body_data, false));
 
+  expectResponseTimerCreate();
   Http::TestHeaderMapImpl trailers{{"some", "trailer"}};
-  EXPECT_CALL(callbacks_, decodingBuffer())
-      .Times(AtLeast(1))
-      .WillRepeatedly(Return(body_data.get()));
-  EXPECT_CALL(*shadow_writer_, shadow_("foo", _, std::chrono::milliseconds(10)))
-      .WillOnce(Invoke(
-          [](const std::string&, Http::MessagePtr& request, std::chrono::milliseconds) -> void {
-            EXPECT_NE(nullptr, request->body());
-            EXPECT_NE(nullptr, request->trailers());
-          }));
+  EXPECT_CALL(*shadow_stream, sendTrailers(HeaderMapEqualRef(&trailers)));
   router_.decodeTrailers(trailers);
 
   Http::HeaderMapPtr response_headers(new Http::TestHeaderMapImpl{{":status", "200"}});
@@ -1475,6 +1511,66 @@ TEST_F(RouterTest, Shadow) {
   EXPECT_TRUE(verifyHostUpstreamStats(1, 0));
 }
 
+TEST_F(RouterTest, ShadowDropped) {
+  callbacks_.route_->route_entry_.shadow_policy_.cluster_ = "foo";
+
+  NiceMock<Http::MockStreamEncoder> encoder;
+  Http::StreamDecoder* response_decoder = nullptr;
+  EXPECT_CALL(cm_.conn_pool_, newStream(_, _))
+      .WillOnce(Invoke([&](Http::StreamDecoder& decoder, Http::ConnectionPool::Callbacks& callbacks)
+                           -> Http::ConnectionPool::Cancellable* {
+        response_decoder = &decoder;
+        callbacks.onPoolReady(encoder, cm_.conn_pool_.host_);
+        return nullptr;
+      }));
+
+  Http::TestHeaderMapImpl headers;
+  HttpTestUtility::addDefaultHeaders(headers);
+  MockShadowStream* shadow_stream = new MockShadowStream();
+  EXPECT_CALL(*shadow_writer_, start_("foo", _, false, _, _)).WillOnce(Return(shadow_stream));
+  router_.decodeHeaders(headers, false);
+
+  // Once the shadow is dropped the rest of the request only goes to the primary upstream.
+  Buffer::OwnedImpl data1("hello");
+  EXPECT_CALL(*shadow_stream, sendData(_, false)).WillOnce(Return(false));
+  EXPECT_CALL(encoder, encodeData(BufferStringEqual("hello"), false));
+  router_.decodeData(data1, false);
+
+  expectResponseTimerCreate();
+  Buffer::OwnedImpl data2("world");
+  EXPECT_CALL(encoder, encodeData(BufferStringEqual("world"), true));
+  router_.decodeData(data2, true);
+
+  Http::HeaderMapPtr response_headers(new Http::TestHeaderMapImpl{{":status", "200"}});
+  response_decoder->decodeHeaders(std::move(response_headers), true);
+  EXPECT_TRUE(verifyHostUpstreamStats(1, 0));
+}
+
+TEST_F(RouterTest, ShadowHeaderOnly) {
+  callbacks_.route_->route_entry_.shadow_policy_.cluster_ = "foo";
+
+  NiceMock<Http::MockStreamEncoder> encoder;
+  Http::StreamDecoder* response_decoder = nullptr;
+  EXPECT_CALL(cm_.conn_pool_, newStream(_, _))
+      .WillOnce(Invoke([&](Http::StreamDecoder& decoder, Http::ConnectionPool::Callbacks& callbacks)
+                           -> Http::ConnectionPool::Cancellable* {
+        response_decoder = &decoder;
+        callbacks.onPoolReady(encoder, cm_.conn_pool_.host_);
+        return nullptr;
+      }));
+  expectResponseTimerCreate();
+
+  Http::TestHeaderMapImpl headers;
+  HttpTestUtility::addDefaultHeaders(headers);
+  EXPECT_CALL(*shadow_writer_, start_("foo", _, true, std::chrono::milliseconds(10), _))
+      .WillOnce(Return(nullptr));
+  router_.decodeHeaders(headers, true);
+
+  Http::HeaderMapPtr response_headers(new Http::TestHeaderMapImpl{{":status", "200"}});
+  response_decoder->decodeHeaders(std::move(response_headers), true);
+  EXPECT_TRUE(verifyHostUpstreamStats(1, 0));
+}
+
 TEST_F(RouterTest, AltStatName) {
   // Also test no upstream timeout here.
   EXPECT_CALL(callbacks_.route_->route_entry_, timeout())
@@ -1498,6 +1594,7 @@ TEST_F(RouterTest, AltStatName) {
 
   EXPECT_CALL(cm_.conn_pool_.host_->outlier_detector_, putHttpResponseCode(200));
   EXPECT_CALL(cm_.conn_pool_.host_->outlier_detector_, putResponseTime(_));
+  EXPECT_CALL(*cm_.conn_pool_.host_, putResponseTime(_));
 
   Http::HeaderMapPtr response_headers(
       new Http::TestHeaderMapImpl{{":status", "200"},
@@ -1631,6 +1728,33 @@ TEST(RouterFilterUtilityTest, finalTimeout) {
   }
 }
 
+TEST(RouterFilterUtilityTest, finalPriority) {
+  {
+    NiceMock<MockRouteEntry> route;
+    Http::TestHeaderMapImpl headers;
+    EXPECT_EQ(Upstream::ResourcePriority::Default, FilterUtility::finalPriority(route, headers));
+  }
+  {
+    NiceMock<MockRouteEntry> route;
+    Http::TestHeaderMapImpl headers{{"x-envoy-upstream-rq-priority", "high"}};
+    EXPECT_EQ(Upstream::ResourcePriority::High, FilterUtility::finalPriority(route, headers));
+    EXPECT_FALSE(headers.has("x-envoy-upstream-rq-priority"));
+  }
+  {
+    NiceMock<MockRouteEntry> route;
+    EXPECT_CALL(route, priority()).WillOnce(Return(Upstream::ResourcePriority::High));
+    Http::TestHeaderMapImpl headers{{"x-envoy-upstream-rq-priority", "default"}};
+    EXPECT_EQ(Upstream::ResourcePriority::Default, FilterUtility::finalPriority(route, headers));
+  }
+  {
+    NiceMock<MockRouteEntry> route;
+    EXPECT_CALL(route, priority()).WillOnce(Return(Upstream::ResourcePriority::High));
+    Http::TestHeaderMapImpl headers{{"x-envoy-upstream-rq-priority", "bad"}};
+    EXPECT_EQ(Upstream::ResourcePriority::High, FilterUtility::finalPriority(route, headers));
+    EXPECT_FALSE(headers.has("x-envoy-upstream-rq-priority"));
+  }
+}
+
 TEST(RouterFilterUtilityTest, setUpstreamScheme) {
   {
     Upstream::MockClusterInfo cluster;
@@ -1971,6 +2095,306 @@ TEST_F(WatermarkTest, RetryRequestNotComplete) {
   encoder1.stream_.resetStream(Http::StreamResetReason::RemoteReset);
 }
 
+// The route bounds the replayed body below the buffer limit. The body is streamed upstream
+// throughout, and the request stops being retryable once it goes over the bound.
+TEST_F(WatermarkTest, RetryRequestOverReplayLimit) {
+  EXPECT_CALL(callbacks_, decoderBufferLimit()).WillOnce(Return(100));
+  router_.setDecoderFilterCallbacks(callbacks_);
+  callbacks_.route_->route_entry_.retry_policy_.max_replay_bytes_ = 8;
+  NiceMock<Http::MockStreamEncoder> encoder1;
+  EXPECT_CALL(cm_.conn_pool_, newStream(_, _))
+      .WillOnce(Invoke([&](Http::StreamDecoder&, Http::ConnectionPool::Callbacks& callbacks)
+                           -> Http::ConnectionPool::Cancellable* {
+        callbacks.onPoolReady(encoder1, cm_.conn_pool_.host_);
+        return nullptr;
+      }));
+  EXPECT_CALL(callbacks_.request_info_,
+              setResponseFlag(RequestInfo::ResponseFlag::UpstreamRemoteReset));
+
+  Http::TestHeaderMapImpl headers{{"x-envoy-retry-on", "5xx"}, {"x-envoy-internal", "true"}};
+  HttpTestUtility::addDefaultHeaders(headers);
+  router_.decodeHeaders(headers, false);
+  EXPECT_CALL(*router_.retry_state_, enabled()).WillRepeatedly(Return(true));
+
+  Buffer::OwnedImpl data1("1234");
+  EXPECT_CALL(encoder1, encodeData(BufferStringEqual("1234"), false));
+  EXPECT_EQ(Http::FilterDataStatus::StopIterationAndBuffer, router_.decodeData(data1, false));
+
+  Buffer::OwnedImpl buffered("1234");
+  EXPECT_CALL(callbacks_, decodingBuffer()).WillRepeatedly(Return(&buffered));
+  Buffer::OwnedImpl data2("56789");
+  EXPECT_CALL(encoder1, encodeData(BufferStringEqual("56789"), false));
+  // This will result in retry_state_ being deleted.
+  EXPECT_EQ(Http::FilterDataStatus::StopIterationNoBuffer, router_.decodeData(data2, false));
+  EXPECT_EQ(1U, cm_.thread_local_cluster_.cluster_.info_->stats_store_
+                    .counter("retry_or_shadow_abandoned")
+                    .value());
+
+  // This should not trigger a retry as the retry state has been deleted.
+  EXPECT_CALL(cm_.conn_pool_.host_->outlier_detector_, putHttpResponseCode(503));
+  encoder1.stream_.resetStream(Http::StreamResetReason::RemoteReset);
+}
+
+class RouterHedgeTest : public RouterTest {
+public:
+  RouterHedgeTest() {
+    callbacks_.route_->route_entry_.retry_policy_.hedge_policy_ = &hedge_policy_;
+    ON_CALL(hedge_policy_, hedgeDelay()).WillByDefault(Return(std::chrono::milliseconds(50)));
+    EXPECT_CALL(callbacks_.route_->route_entry_, timeout())
+        .WillOnce(Return(std::chrono::milliseconds(0)));
+  }
+
+  // Send a request and fire the hedge timer.
+  void sendHedgedRequest(bool budget_allows = true) {
+    EXPECT_CALL(cm_.conn_pool_, newStream(_, _))
+        .Times(budget_allows ? 2 : 1)
+        .WillRepeatedly(Invoke(
+            [&](Http::StreamDecoder& decoder,
+                Http::ConnectionPool::Callbacks& callbacks) -> Http::ConnectionPool::Cancellable* {
+              const size_t attempt = response_decoders_.size();
+              response_decoders_.push_back(&decoder);
+              callbacks.onPoolReady(encoders_[attempt], cm_.conn_pool_.host_);
+              return nullptr;
+            }));
+    Event::MockTimer* hedge_timer = new Event::MockTimer(&callbacks_.dispatcher_);
+    EXPECT_CALL(*hedge_timer, enableTimer(std::chrono::milliseconds(50)));
+    EXPECT_CALL(*hedge_timer, disableTimer());
+
+    HttpTestUtility::addDefaultHeaders(headers_);
+    router_.decodeHeaders(headers_, true);
+
+    EXPECT_CALL(hedge_policy_, tryHedge()).WillOnce(Return(budget_allows));
+    hedge_timer->callback_();
+  }
+
+  NiceMock<MockHedgePolicy> hedge_policy_;
+  NiceMock<Http::MockStreamEncoder> encoders_[2];
+  std::vector<Http::StreamDecoder*> response_decoders_;
+  Http::TestHeaderMapImpl headers_;
+};
+
+TEST_F(RouterHedgeTest, SecondAttemptWins) {
+  sendHedgedRequest();
+  EXPECT_EQ(1U, stats_store_.counter("test.rq_hedged").value());
+
+  // The attempt that responds first wins and the other one is reset.
+  EXPECT_CALL(encoders_[0].stream_, resetStream(Http::StreamResetReason::LocalReset));
+  EXPECT_CALL(hedge_policy_, recordResponseTime(_));
+  EXPECT_CALL(callbacks_, encodeHeaders_(_, true));
+  response_decoders_[1]->decodeHeaders(
+      Http::HeaderMapPtr{new Http::TestHeaderMapImpl{{":status", "200"}}}, true);
+  EXPECT_EQ(1U, stats_store_.counter("test.rq_hedge_won").value());
+  EXPECT_TRUE(verifyHostUpstreamStats(1, 0));
+}
+
+TEST_F(RouterHedgeTest, FailedAttemptDropped) {
+  sendHedgedRequest();
+
+  // The first attempt fails while the second one is outstanding.
+  EXPECT_CALL(cm_.conn_pool_.host_->outlier_detector_, putHttpResponseCode(503));
+  EXPECT_CALL(callbacks_, encodeHeaders_(_, _)).Times(0);
+  encoders_[0].stream_.resetStream(Http::StreamResetReason::RemoteReset);
+
+  EXPECT_CALL(cm_.conn_pool_.host_->outlier_detector_, putHttpResponseCode(200));
+  EXPECT_CALL(callbacks_, encodeHeaders_(_, true));
+  response_decoders_[1]->decodeHeaders(
+      Http::HeaderMapPtr{new Http::TestHeaderMapImpl{{":status", "200"}}}, true);
+  EXPECT_EQ(0U, stats_store_.counter("test.rq_hedge_won").value());
+  EXPECT_TRUE(verifyHostUpstreamStats(1, 1));
+}
+
+TEST_F(RouterHedgeTest, FailedResponseDropped) {
+  sendHedgedRequest();
+
+  // A 5xx of one attempt leaves the response to the other one.
+  EXPECT_CALL(encoders_[1].stream_, resetStream(Http::StreamResetReason::LocalReset));
+  EXPECT_CALL(callbacks_, encodeHeaders_(_, _)).Times(0);
+  response_decoders_[1]->decodeHeaders(
+      Http::HeaderMapPtr{new Http::TestHeaderMapImpl{{":status", "503"}}}, false);
+
+  Http::TestHeaderMapImpl response_headers{{":status", "200"}};
+  EXPECT_CALL(callbacks_, encodeHeaders_(HeaderMapEqualRef(&response_headers), true));
+  response_decoders_[0]->decodeHeaders(
+      Http::HeaderMapPtr{new Http::TestHeaderMapImpl(response_headers)}, true);
+  EXPECT_TRUE(verifyHostUpstreamStats(1, 1));
+}
+
+TEST_F(RouterHedgeTest, BudgetExhausted) {
+  sendHedgedRequest(false);
+  EXPECT_EQ(0U, stats_store_.counter("test.rq_hedged").value());
+  EXPECT_EQ(1U, stats_store_.counter("test.rq_hedge_budget_exhausted").value());
+
+  EXPECT_CALL(callbacks_, encodeHeaders_(_, true));
+  response_decoders_[0]->decodeHeaders(
+      Http::HeaderMapPtr{new Http::TestHeaderMapImpl{{":status", "200"}}}, true);
+  EXPECT_TRUE(verifyHostUpstreamStats(1, 0));
+}
+
+class RouterCollapseTest : public RouterTest {
+public:
+  RouterCollapseTest()
+      : collapse_config_("test.", local_info_, stats_store_, cm_, runtime_, random_,
+                         ShadowWriterPtr{new MockShadowWriter()}, true, false, &tls_),
+        leader_(collapse_config_), follower_(collapse_config_) {
+    callbacks_.route_->route_entry_.opaque_config_.emplace("collapse_requests", "true");
+    ON_CALL(callbacks_.route_->route_entry_, timeout())
+        .WillByDefault(Return(std::chrono::milliseconds(0)));
+    ON_CALL(follower_callbacks_, route()).WillByDefault(Return(callbacks_.route_));
+    leader_.setDecoderFilterCallbacks(callbacks_);
+    follower_.setDecoderFilterCallbacks(follower_callbacks_);
+    HttpTestUtility::addDefaultHeaders(leader_headers_);
+    HttpTestUtility::addDefaultHeaders(follower_headers_);
+  }
+
+  void expectNewStream(int times) {
+    EXPECT_CALL(cm_.conn_pool_, newStream(_, _))
+        .Times(times)
+        .WillRepeatedly(Invoke(
+            [&](Http::StreamDecoder& decoder,
+                Http::ConnectionPool::Callbacks& callbacks) -> Http::ConnectionPool::Cancellable* {
+              response_decoder_ = &decoder;
+              pool_callbacks_ = &callbacks;
+              return &cancellable_;
+            }));
+  }
+
+  NiceMock<ThreadLocal::MockInstance> tls_;
+  FilterConfig collapse_config_;
+  TestFilter leader_;
+  TestFilter follower_;
+  NiceMock<Http::MockStreamDecoderFilterCallbacks> follower_callbacks_;
+  NiceMock<Http::MockStreamEncoder> encoder_;
+  Http::StreamDecoder* response_decoder_{};
+  Http::ConnectionPool::Callbacks* pool_callbacks_{};
+  Http::TestHeaderMapImpl leader_headers_;
+  Http::TestHeaderMapImpl follower_headers_;
+};
+
+TEST_F(RouterCollapseTest, FollowerGetsLeaderResponse) {
+  expectNewStream(1);
+  EXPECT_EQ(Http::FilterHeadersStatus::StopIteration,
+            leader_.decodeHeaders(leader_headers_, true));
+  EXPECT_EQ(Http::FilterHeadersStatus::StopIteration,
+            follower_.decodeHeaders(follower_headers_, true));
+  EXPECT_EQ(1U, stats_store_.counter("test.rq_collapsed").value());
+  pool_callbacks_->onPoolReady(encoder_, cm_.conn_pool_.host_);
+
+  EXPECT_CALL(callbacks_, encodeHeaders_(_, false));
+  EXPECT_CALL(follower_callbacks_, encodeHeaders_(_, false));
+  response_decoder_->decodeHeaders(
+      Http::HeaderMapPtr{new Http::TestHeaderMapImpl{{":status", "200"}}}, false);
+
+  Buffer::OwnedImpl data("hello");
+  EXPECT_CALL(callbacks_, encodeData(BufferStringEqual("hello"), false));
+  EXPECT_CALL(follower_callbacks_, encodeData(BufferStringEqual("hello"), false));
+  response_decoder_->decodeData(data, false);
+
+  Http::TestHeaderMapImpl trailers{{"some", "trailer"}};
+  EXPECT_CALL(callbacks_, encodeTrailers_(HeaderMapEqualRef(&trailers)));
+  EXPECT_CALL(follower_callbacks_, encodeTrailers_(HeaderMapEqualRef(&trailers)));
+  response_decoder_->decodeTrailers(Http::HeaderMapPtr{new Http::TestHeaderMapImpl(trailers)});
+  EXPECT_TRUE(verifyHostUpstreamStats(1, 0));
+}
+
+TEST_F(RouterCollapseTest, RequestArrivingAfterResponseHeadersGoesUpstream) {
+  expectNewStream(2);
+  leader_.decodeHeaders(leader_headers_, true);
+  pool_callbacks_->onPoolReady(encoder_, cm_.conn_pool_.host_);
+  response_decoder_->decodeHeaders(
+      Http::HeaderMapPtr{new Http::TestHeaderMapImpl{{":status", "200"}}}, false);
+
+  follower_.decodeHeaders(follower_headers_, true);
+  EXPECT_EQ(0U, stats_store_.counter("test.rq_collapsed").value());
+
+  EXPECT_CALL(cancellable_, cancel());
+  follower_.onDestroy();
+  leader_.onDestroy();
+}
+
+TEST_F(RouterCollapseTest, DifferentKeyHeadersNotCollapsed) {
+  callbacks_.route_->route_entry_.opaque_config_.emplace("collapse_key_headers",
+                                                         "accept-encoding,accept-language");
+  leader_headers_.addCopy("accept-encoding", "gzip");
+  follower_headers_.addCopy("accept-encoding", "br");
+
+  expectNewStream(2);
+  leader_.decodeHeaders(leader_headers_, true);
+  follower_.decodeHeaders(follower_headers_, true);
+  EXPECT_EQ(0U, stats_store_.counter("test.rq_collapsed").value());
+
+  EXPECT_CALL(cancellable_, cancel()).Times(2);
+  follower_.onDestroy();
+  leader_.onDestroy();
+}
+
+TEST_F(RouterCollapseTest, RequestWithBodyNotCollapsed) {
+  expectNewStream(2);
+  leader_.decodeHeaders(leader_headers_, true);
+  follower_.decodeHeaders(follower_headers_, false);
+  EXPECT_EQ(0U, stats_store_.counter("test.rq_collapsed").value());
+
+  EXPECT_CALL(cancellable_, cancel()).Times(2);
+  follower_.onDestroy();
+  leader_.onDestroy();
+}
+
+TEST_F(RouterCollapseTest, FollowerGetsLeaderLocalReply) {
+  expectNewStream(1);
+  leader_.decodeHeaders(leader_headers_, true);
+  follower_.decodeHeaders(follower_headers_, true);
+
+  Http::TestHeaderMapImpl response_headers{
+      {":status", "503"}, {"content-length", "57"}, {"content-type", "text/plain"}};
+  EXPECT_CALL(callbacks_, encodeHeaders_(HeaderMapEqualRef(&response_headers), false));
+  EXPECT_CALL(callbacks_, encodeData(_, true));
+  EXPECT_CALL(follower_callbacks_, encodeHeaders_(HeaderMapEqualRef(&response_headers), false));
+  EXPECT_CALL(follower_callbacks_, encodeData(_, true));
+  pool_callbacks_->onPoolFailure(Http::ConnectionPool::PoolFailureReason::ConnectionFailure,
+                                 cm_.conn_pool_.host_);
+  EXPECT_TRUE(verifyHostUpstreamStats(0, 1));
+}
+
+TEST_F(RouterCollapseTest, LeaderDestroyedBeforeResponseReleasesFollower) {
+  expectNewStream(2);
+  leader_.decodeHeaders(leader_headers_, true);
+  follower_.decodeHeaders(follower_headers_, true);
+
+  // The follower goes upstream itself.
+  EXPECT_CALL(cancellable_, cancel());
+  leader_.onDestroy();
+
+  EXPECT_CALL(cancellable_, cancel());
+  follower_.onDestroy();
+}
+
+TEST_F(RouterCollapseTest, LeaderResetAfterResponseHeadersResetsFollower) {
+  expectNewStream(1);
+  leader_.decodeHeaders(leader_headers_, true);
+  follower_.decodeHeaders(follower_headers_, true);
+  pool_callbacks_->onPoolReady(encoder_, cm_.conn_pool_.host_);
+
+  EXPECT_CALL(follower_callbacks_, encodeHeaders_(_, false));
+  response_decoder_->decodeHeaders(
+      Http::HeaderMapPtr{new Http::TestHeaderMapImpl{{":status", "200"}}}, false);
+
+  EXPECT_CALL(callbacks_, resetStream());
+  EXPECT_CALL(follower_callbacks_, resetStream());
+  encoder_.stream_.resetStream(Http::StreamResetReason::RemoteReset);
+}
+
+TEST_F(RouterCollapseTest, DestroyedFollowerGetsNoResponse) {
+  expectNewStream(1);
+  leader_.decodeHeaders(leader_headers_, true);
+  follower_.decodeHeaders(follower_headers_, true);
+  follower_.onDestroy();
+  pool_callbacks_->onPoolReady(encoder_, cm_.conn_pool_.host_);
+
+  EXPECT_CALL(callbacks_, encodeHeaders_(_, true));
+  EXPECT_CALL(follower_callbacks_, encodeHeaders_(_, _)).Times(0);
+  response_decoder_->decodeHeaders(
+      Http::HeaderMapPtr{new Http::TestHeaderMapImpl{{":status", "200"}}}, true);
+}
+
 class RouterTestChildSpan : public RouterTestBase {
 public:
   RouterTestChildSpan() : RouterTestBase(true) {}
@@ -1,62 +1,163 @@
 #include <chrono>
 #include <string>
 
+#include "common/buffer/buffer_impl.h"
 #include "common/http/headers.h"
-#include "common/http/message_impl.h"
 #include "common/router/shadow_writer_impl.h"
 
+#include "test/mocks/buffer/mocks.h"
+#include "test/mocks/http/mocks.h"
 #include "test/mocks/upstream/mocks.h"
+#include "test/test_common/utility.h"
 
 #include "gmock/gmock.h"
 #include "gtest/gtest.h"
 
 using testing::Invoke;
+using testing::NiceMock;
+using testing::Return;
+using testing::ReturnRef;
 using testing::_;
 
 namespace Envoy {
 namespace Router {
 
-TEST(ShadowWriterImplTest, All) {
-  Upstream::MockClusterManager cm;
-  ShadowWriterImpl writer(cm);
-
-  // Success case
-  Http::MessagePtr message(new Http::RequestMessageImpl());
-  message->headers().insertHost().value(std::string("cluster1"));
-  EXPECT_CALL(cm, httpAsyncClientForCluster("foo")).WillOnce(ReturnRef(cm.async_client_));
-  Http::MockAsyncClientRequest request(&cm.async_client_);
-  Http::AsyncClient::Callbacks* callback;
-  EXPECT_CALL(cm.async_client_,
-              send_(_, _, Optional<std::chrono::milliseconds>(std::chrono::milliseconds(5))))
-      .WillOnce(
-          Invoke([&](Http::MessagePtr& inner_message, Http::AsyncClient::Callbacks& callbacks,
-                     const Optional<std::chrono::milliseconds>&) -> Http::AsyncClient::Request* {
-            EXPECT_EQ(message, inner_message);
-            EXPECT_STREQ("cluster1-shadow", message->headers().Host()->value().c_str());
-            callback = &callbacks;
-            return &request;
-          }));
-  writer.shadow("foo", std::move(message), std::chrono::milliseconds(5));
-
-  Http::MessagePtr response(new Http::RequestMessageImpl());
-  callback->onSuccess(std::move(response));
-
-  // Failure case
-  message.reset(new Http::RequestMessageImpl());
-  message->headers().insertHost().value(std::string("cluster2"));
-  EXPECT_CALL(cm, httpAsyncClientForCluster("bar")).WillOnce(ReturnRef(cm.async_client_));
-  EXPECT_CALL(cm.async_client_,
-              send_(_, _, Optional<std::chrono::milliseconds>(std::chrono::milliseconds(10))))
-      .WillOnce(
-          Invoke([&](Http::MessagePtr& inner_message, Http::AsyncClient::Callbacks& callbacks,
-                     const Optional<std::chrono::milliseconds>&) -> Http::AsyncClient::Request* {
-            EXPECT_EQ(message, inner_message);
-            EXPECT_STREQ("cluster2-shadow", message->headers().Host()->value().c_str());
-            callback = &callbacks;
-            return &request;
-          }));
-  writer.shadow("bar", std::move(message), std::chrono::milliseconds(10));
-  callback->onFailure(Http::AsyncClient::FailureReason::Reset);
+class ShadowWriterImplTest : public testing::Test {
+public:
+  ShadowWriterImplTest() {
+    headers_.insertHost().value(std::string("cluster1"));
+    ON_CALL(stream_, reset()).WillByDefault(Invoke([this]() -> void { callbacks_->onReset(); }));
+  }
+
+  ShadowStreamPtr start(bool end_stream) {
+    EXPECT_CALL(cm_, httpAsyncClientForCluster("foo")).WillOnce(ReturnRef(cm_.async_client_));
+    EXPECT_CALL(cm_.async_client_,
+                start(_, Optional<std::chrono::milliseconds>(std::chrono::milliseconds(5)), false))
+        .WillOnce(Invoke([this](Http::AsyncClient::StreamCallbacks& callbacks,
+                                const Optional<std::chrono::milliseconds>&,
+                                bool) -> Http::AsyncClient::Stream* {
+          callbacks_ = &callbacks;
+          return &stream_;
+        }));
+    EXPECT_CALL(stream_, sendHeaders(_, end_stream))
+        .WillOnce(Invoke([](Http::HeaderMap& headers, bool) -> void {
+          EXPECT_STREQ("cluster1-shadow", headers.Host()->value().c_str());
+        }));
+    return writer_.start("foo", headers_, end_stream, std::chrono::milliseconds(5), 10);
+  }
+
+  uint64_t dropped() {
+    return cm_.thread_local_cluster_.cluster_.info_->stats_.upstream_rq_shadow_dropped_.value();
+  }
+
+  NiceMock<Upstream::MockClusterManager> cm_;
+  ShadowWriterImpl writer_{cm_};
+  Http::TestHeaderMapImpl headers_;
+  NiceMock<Http::MockAsyncClientStream> stream_;
+  Http::AsyncClient::StreamCallbacks* callbacks_{};
+};
+
+TEST_F(ShadowWriterImplTest, HeaderOnly) {
+  EXPECT_EQ(nullptr, start(true));
+  EXPECT_STREQ("cluster1", headers_.Host()->value().c_str());
+
+  EXPECT_CALL(cm_.async_client_.dispatcher_, deferredDelete_(_));
+  callbacks_->onHeaders(Http::HeaderMapPtr{new Http::TestHeaderMapImpl{{":status", "200"}}}, true);
+}
+
+TEST_F(ShadowWriterImplTest, Stream) {
+  ShadowStreamPtr shadow = start(false);
+  ASSERT_NE(nullptr, shadow);
+
+  // The shadow shares the data rather than taking it.
+  Buffer::OwnedImpl data("hello");
+  EXPECT_CALL(stream_, sendData(BufferStringEqual("hello"), false));
+  EXPECT_TRUE(shadow->sendData(data, false));
+  EXPECT_EQ("hello", TestUtility::bufferToString(data));
+
+  Http::TestHeaderMapImpl trailers{{"some", "trailer"}};
+  EXPECT_CALL(stream_, sendTrailers(HeaderMapEqualRef(&trailers)));
+  shadow->sendTrailers(trailers);
+
+  // The shadow outlives the handle once the request is complete.
+  EXPECT_CALL(stream_, reset()).Times(0);
+  shadow.reset();
+
+  EXPECT_CALL(cm_.async_client_.dispatcher_, deferredDelete_(_));
+  callbacks_->onHeaders(Http::HeaderMapPtr{new Http::TestHeaderMapImpl{{":status", "200"}}},
+                        false);
+  Buffer::OwnedImpl response("world");
+  callbacks_->onData(response, true);
+  EXPECT_EQ(0U, dropped());
+}
+
+TEST_F(ShadowWriterImplTest, DropTooLarge) {
+  ShadowStreamPtr shadow = start(false);
+
+  Buffer::OwnedImpl data1("hello");
+  EXPECT_CALL(stream_, sendData(_, false));
+  EXPECT_TRUE(shadow->sendData(data1, false));
+
+  Buffer::OwnedImpl data2("world!");
+  EXPECT_CALL(stream_, reset());
+  EXPECT_CALL(cm_.async_client_.dispatcher_, deferredDelete_(_));
+  EXPECT_FALSE(shadow->sendData(data2, true));
+  EXPECT_EQ(1U, dropped());
+  EXPECT_EQ("world!", TestUtility::bufferToString(data2));
+
+  EXPECT_FALSE(shadow->sendData(data2, true));
+  shadow.reset();
+}
+
+TEST_F(ShadowWriterImplTest, DropAboveHighWatermark) {
+  ShadowStreamPtr shadow = start(false);
+
+  Buffer::OwnedImpl data("hello");
+  EXPECT_CALL(stream_, isAboveWriteBufferHighWatermark()).WillOnce(Return(true));
+  EXPECT_CALL(stream_, sendData(_, _)).Times(0);
+  EXPECT_CALL(stream_, reset());
+  EXPECT_FALSE(shadow->sendData(data, false));
+  EXPECT_EQ(1U, dropped());
+}
+
+TEST_F(ShadowWriterImplTest, RequestAbandoned) {
+  ShadowStreamPtr shadow = start(false);
+
+  EXPECT_CALL(stream_, reset());
+  EXPECT_CALL(cm_.async_client_.dispatcher_, deferredDelete_(_));
+  shadow.reset();
+  EXPECT_EQ(0U, dropped());
+}
+
+TEST_F(ShadowWriterImplTest, EarlyResponse) {
+  ShadowStreamPtr shadow = start(false);
+  callbacks_->onHeaders(Http::HeaderMapPtr{new Http::TestHeaderMapImpl{{":status", "503"}}}, true);
+
+  // The rest of the request would be discarded.
+  Buffer::OwnedImpl data("hello");
+  EXPECT_CALL(stream_, sendData(_, _)).Times(0);
+  EXPECT_CALL(stream_, reset());
+  EXPECT_FALSE(shadow->sendData(data, true));
+  EXPECT_EQ(0U, dropped());
+}
+
+TEST_F(ShadowWriterImplTest, UpstreamReset) {
+  ShadowStreamPtr shadow = start(false);
+
+  EXPECT_CALL(cm_.async_client_.dispatcher_, deferredDelete_(_));
+  callbacks_->onReset();
+
+  Buffer::OwnedImpl data("hello");
+  EXPECT_CALL(stream_, sendData(_, _)).Times(0);
+  EXPECT_FALSE(shadow->sendData(data, true));
+  EXPECT_CALL(stream_, reset()).Times(0);
+  shadow.reset();
+}
+
+TEST_F(ShadowWriterImplTest, UnknownCluster) {
+  EXPECT_CALL(cm_, get("bar")).WillOnce(Return(nullptr));
+  EXPECT_CALL(cm_, httpAsyncClientForCluster(_)).Times(0);
+  EXPECT_EQ(nullptr, writer_.start("bar", headers_, false, std::chrono::milliseconds(5), 10));
 }
 
 } // namespace Router
@@ -1,3 +1,9 @@
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <fstream>
+#include <future>
 #include <memory>
 #include <string>
 
@@ -17,7 +23,7 @@
 using testing::Invoke;
 using testing::NiceMock;
 using testing::Return;
-using testing::ReturnNew;
+using testing::SaveArg;
 using testing::_;
 
 namespace Envoy {
@@ -73,7 +79,11 @@ public:
 
   void setup() {
     EXPECT_CALL(dispatcher, createFilesystemWatcher_())
-        .WillOnce(ReturnNew<NiceMock<Filesystem::MockWatcher>>());
+        .WillOnce(Invoke([this]() -> Filesystem::Watcher* {
+          Filesystem::MockWatcher* watcher = new NiceMock<Filesystem::MockWatcher>();
+          EXPECT_CALL(*watcher, addWatch(_, _, _)).WillOnce(SaveArg<2>(&on_changed_));
+          return watcher;
+        }));
 
     os_sys_calls_ = new NiceMock<Api::MockOsSysCalls>;
     ON_CALL(*os_sys_calls_, stat(_, _))
@@ -87,6 +97,17 @@ public:
                                 "envoy", override_dir, store, generator, std::move(os_sys_calls)));
   }
 
+  // Swap the symlink and wait for the new snapshot, which is loaded on a thread of its own, running
+  // the completion that it posts as the main thread would.
+  void swapSymlink() {
+    std::promise<Event::PostCb> posted;
+    EXPECT_CALL(dispatcher, post(_)).WillOnce(Invoke([&posted](Event::PostCb callback) -> void {
+      posted.set_value(callback);
+    }));
+    on_changed_(Filesystem::Watcher::Events::MovedTo);
+    posted.get_future().get()();
+  }
+
   Event::MockDispatcher dispatcher;
   NiceMock<ThreadLocal::MockInstance> tls;
   NiceMock<Api::MockOsSysCalls>* os_sys_calls_{};
@@ -94,6 +115,7 @@ public:
   Stats::IsolatedStoreImpl store;
   MockRandomGenerator generator;
   std::unique_ptr<LoaderImpl> loader;
+  Filesystem::Watcher::OnChangedCb on_changed_;
 };
 
 TEST_F(RuntimeImplTest, All) {
@@ -134,6 +156,50 @@ TEST_F(RuntimeImplTest, All) {
   EXPECT_EQ("hello override", loader->snapshot().get("file1"));
 }
 
+TEST_F(RuntimeImplTest, Keys) {
+  const auto lookups = [](const std::string& name) -> uint64_t {
+    for (const auto& lookup : Key::lookups()) {
+      if (lookup.first == name) {
+        return lookup.second;
+      }
+    }
+    return 0;
+  };
+
+  // Keys registered before the snapshot is loaded are looked up by index.
+  const Key file3("file3");
+  const Key file4("file4");
+  const Key invalid("invalid");
+  const uint64_t file3_lookups = lookups("file3");
+
+  setup();
+  run("test/common/runtime/test_data/current", "envoy_override");
+
+  EXPECT_EQ(2UL, loader->snapshot().getInteger(file3, 1));
+  EXPECT_EQ(123UL, loader->snapshot().getInteger(file4, 1));
+  EXPECT_EQ(1UL, loader->snapshot().getInteger(invalid, 1));
+
+  EXPECT_CALL(generator, random()).WillOnce(Return(1));
+  EXPECT_TRUE(loader->snapshot().featureEnabled(file3, 1));
+  EXPECT_CALL(generator, random()).WillOnce(Return(2));
+  EXPECT_FALSE(loader->snapshot().featureEnabled(file3, 1));
+  EXPECT_TRUE(loader->snapshot().featureEnabled(file3, 1, 1));
+  EXPECT_FALSE(loader->snapshot().featureEnabled(file3, 1, 3));
+  EXPECT_EQ(file3_lookups + 5, lookups("file3"));
+
+  // Keys with the same name share their index.
+  const Key file3_again("file3");
+  EXPECT_EQ(file3.index(), file3_again.index());
+  EXPECT_EQ(2UL, loader->snapshot().getInteger(file3_again, 1));
+  EXPECT_EQ(file3_lookups + 6, lookups("file3"));
+
+  // Keys registered after the snapshot was loaded are looked up by name until the next one.
+  const Key file5("file5");
+  EXPECT_EQ(123UL, loader->snapshot().getInteger(file5, 1));
+  on_changed_(Filesystem::Watcher::Events::MovedTo);
+  EXPECT_EQ(123UL, loader->snapshot().getInteger(file5, 1));
+}
+
 TEST_F(RuntimeImplTest, GetAll) {
   setup();
   run("test/common/runtime/test_data/current", "envoy_override");
@@ -160,6 +226,80 @@ TEST_F(RuntimeImplTest, GetAll) {
   EXPECT_TRUE(entry == values.end());
 }
 
+TEST_F(RuntimeImplTest, Version) {
+  setup();
+  run("test/common/runtime/test_data/current", "envoy_override");
+
+  const uint64_t version = loader->snapshot().version();
+  EXPECT_NE(0UL, version);
+  EXPECT_EQ(version, loader->snapshot().version());
+
+  // Swapping the symlink loads a new snapshot.
+  swapSymlink();
+  EXPECT_NE(version, loader->snapshot().version());
+  EXPECT_EQ("world", loader->snapshot().get("file2"));
+}
+
+// Files that have not been replaced or modified since the previous snapshot are not read again.
+TEST_F(RuntimeImplTest, ReloadChangedFiles) {
+  const std::string foo_path =
+      TestEnvironment::writeStringToFileForTest("reload/root/envoy/foo", "1");
+  TestEnvironment::writeStringToFileForTest("reload/root/envoy/bar", "2");
+  const std::string current_path = TestEnvironment::temporaryPath("reload/current");
+  unlink(current_path.c_str());
+  ASSERT_EQ(0,
+            symlink(TestEnvironment::temporaryPath("reload/root").c_str(), current_path.c_str()));
+
+  setup();
+  run("reload/current", "envoy_override");
+  EXPECT_EQ(1UL, loader->snapshot().getInteger("foo", 0));
+  EXPECT_EQ(2UL, loader->snapshot().getInteger("bar", 0));
+
+  // Rewrite foo in place, keeping its size and modification time.
+  struct stat foo_stat;
+  ASSERT_EQ(0, ::stat(foo_path.c_str(), &foo_stat));
+  {
+    std::ofstream foo_file(foo_path);
+    foo_file << "3";
+  }
+  const struct timespec times[2] = {foo_stat.st_atim, foo_stat.st_mtim};
+  ASSERT_EQ(0, utimensat(AT_FDCWD, foo_path.c_str(), times, 0));
+  TestEnvironment::writeStringToFileForTest("reload/root/envoy/bar", "22");
+
+  swapSymlink();
+  EXPECT_EQ(1UL, loader->snapshot().getInteger("foo", 0));
+  EXPECT_EQ(22UL, loader->snapshot().getInteger("bar", 0));
+
+  // Once its modification time changes, foo is read again.
+  ASSERT_EQ(0, utimensat(AT_FDCWD, foo_path.c_str(), nullptr, 0));
+  swapSymlink();
+  EXPECT_EQ(3UL, loader->snapshot().getInteger("foo", 0));
+  EXPECT_EQ(22UL, loader->snapshot().getInteger("bar", 0));
+}
+
+// A swap while a snapshot is being loaded loads another snapshot once it is done.
+TEST_F(RuntimeImplTest, SwapWhileLoading) {
+  setup();
+  run("test/common/runtime/test_data/current", "envoy_override");
+  const uint64_t version = loader->snapshot().version();
+
+  std::promise<Event::PostCb> first_posted;
+  std::promise<Event::PostCb> second_posted;
+  EXPECT_CALL(dispatcher, post(_))
+      .WillOnce(Invoke(
+          [&first_posted](Event::PostCb callback) -> void { first_posted.set_value(callback); }))
+      .WillOnce(Invoke(
+          [&second_posted](Event::PostCb callback) -> void { second_posted.set_value(callback); }));
+  on_changed_(Filesystem::Watcher::Events::MovedTo);
+  on_changed_(Filesystem::Watcher::Events::MovedTo);
+
+  first_posted.get_future().get()();
+  EXPECT_EQ(version + 1, loader->snapshot().version());
+  second_posted.get_future().get()();
+  EXPECT_EQ(version + 2, loader->snapshot().version());
+  EXPECT_EQ("world", loader->snapshot().get("file2"));
+}
+
 TEST_F(RuntimeImplTest, BadDirectory) {
   setup();
   run("/baddir", "/baddir");
@@ -187,6 +327,12 @@ TEST(NullRuntimeImplTest, All) {
   EXPECT_CALL(generator, random()).WillOnce(Return(49));
   EXPECT_TRUE(loader.snapshot().featureEnabled("foo", 50));
   EXPECT_TRUE(loader.snapshot().getAll().empty());
+  EXPECT_EQ(0UL, loader.snapshot().version());
+
+  const Key foo("foo");
+  EXPECT_EQ(1UL, loader.snapshot().getInteger(foo, 1));
+  EXPECT_TRUE(loader.snapshot().featureEnabled(foo, 50, 49));
+  EXPECT_FALSE(loader.snapshot().featureEnabled(foo, 0));
 }
 
 } // namespace Runtime
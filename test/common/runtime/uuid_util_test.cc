@@ -33,6 +33,12 @@ TEST(UUIDUtilsTest, mod) {
 
   EXPECT_TRUE(UuidUtils::uuidModBy("ffffffff-0012-0110-00ff-0c00400600ff", result, 10000));
   EXPECT_EQ(7295, result);
+
+  EXPECT_TRUE(UuidUtils::uuidModBy("FFFFFFFF-0012-0110-00ff-0c00400600ff", result, 10000));
+  EXPECT_EQ(7295, result);
+
+  EXPECT_FALSE(UuidUtils::uuidModBy("0000000g-0000-0000-0000-000000000000", result, 100));
+  EXPECT_FALSE(UuidUtils::uuidModBy("0000-000-0000-0000-0000-000000000000", result, 100));
 }
 
 TEST(UUIDUtilsTest, checkDistribution) {
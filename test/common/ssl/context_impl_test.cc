@@ -168,6 +168,50 @@ TEST_F(SslContextImplTest, TestNoCert) {
   EXPECT_EQ("", context->getCertChainInformation());
 }
 
+TEST_F(SslContextImplTest, LazyCertificates) {
+  std::string json = R"EOF(
+  {
+    "cert_chain_file": "{{ test_tmpdir }}/unittestcert.pem",
+    "private_key_file": "{{ test_tmpdir }}/unittestkey.pem"
+  }
+  )EOF";
+
+  Json::ObjectSharedPtr loader = TestEnvironment::jsonLoadFromString(json);
+  ServerContextConfigImpl cfg(*loader);
+  Runtime::MockLoader runtime;
+  ContextManagerImpl manager(runtime, nullptr, nullptr, true);
+  Stats::IsolatedStoreImpl store;
+  ServerContextPtr context(manager.createSslServerContext("", {}, store, cfg, true));
+  EXPECT_EQ("", context->getCertChainInformation());
+
+  bssl::UniquePtr<SSL> ssl = dynamic_cast<ServerContextImpl&>(*context).newSsl();
+  EXPECT_NE(nullptr, SSL_get_certificate(ssl.get()));
+  std::string cert_chain_partial_output(
+      TestEnvironment::substitute("Certificate Path: {{ test_tmpdir }}/unittestcert.pem"));
+  EXPECT_NE(std::string::npos, context->getCertChainInformation().find(cert_chain_partial_output));
+}
+
+// A certificate that cannot be loaded is only noticed on the first handshake of the context.
+TEST_F(SslContextImplTest, LazyCertificatesBadPrivateKey) {
+  std::string json = R"EOF(
+  {
+    "cert_chain_file": "{{ test_tmpdir }}/unittestcert.pem",
+    "private_key_file": "{{ test_tmpdir }}/nonexistent_key.pem"
+  }
+  )EOF";
+
+  Json::ObjectSharedPtr loader = TestEnvironment::jsonLoadFromString(json);
+  ServerContextConfigImpl cfg(*loader);
+  Runtime::MockLoader runtime;
+  ContextManagerImpl manager(runtime, nullptr, nullptr, true);
+  Stats::IsolatedStoreImpl store;
+  ServerContextPtr context(manager.createSslServerContext("", {}, store, cfg, true));
+
+  bssl::UniquePtr<SSL> ssl = dynamic_cast<ServerContextImpl&>(*context).newSsl();
+  EXPECT_NE(nullptr, ssl);
+  EXPECT_EQ(nullptr, SSL_get_privatekey(ssl.get()));
+}
+
 class SslServerContextImplTicketTest : public SslContextImplTest {
 public:
   static void loadConfig(ServerContextConfigImpl& cfg) {
@@ -0,0 +1,133 @@
+#include <chrono>
+#include <string>
+
+#include "common/ssl/session_cache_impl.h"
+#include "common/stats/stats_impl.h"
+
+#include "test/mocks/common.h"
+
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+
+using testing::NiceMock;
+using testing::Return;
+
+namespace Envoy {
+namespace Ssl {
+
+class SessionCacheImplTest : public testing::Test {
+public:
+  // A single set, so that all the sessions compete for the same slots.
+  SessionCacheImplTest() : memory_(1, SessionCacheImpl::WAYS) {
+    ON_CALL(time_source_, currentTime()).WillByDefault(testing::Invoke([this]() {
+      return MonotonicTime(now_);
+    }));
+  }
+
+  std::string lookup(SessionCacheImpl& cache, const std::string& id) {
+    std::string session;
+    return cache.lookup(id, session) ? session : "";
+  }
+
+  HeapSessionCacheMemory memory_;
+  Stats::IsolatedStoreImpl store_;
+  NiceMock<MockMonotonicTimeSource> time_source_;
+  std::chrono::seconds now_{1000};
+};
+
+TEST_F(SessionCacheImplTest, InsertLookupRemove) {
+  SessionCacheImpl cache(memory_, std::chrono::seconds(300), store_, time_source_);
+
+  EXPECT_EQ("", lookup(cache, "id1"));
+  cache.insert("id1", "session1");
+  cache.insert("id2", "session2");
+  EXPECT_EQ("session1", lookup(cache, "id1"));
+  EXPECT_EQ("session2", lookup(cache, "id2"));
+
+  cache.insert("id1", "session3");
+  EXPECT_EQ("session3", lookup(cache, "id1"));
+
+  cache.remove("id1");
+  EXPECT_EQ("", lookup(cache, "id1"));
+  EXPECT_EQ("session2", lookup(cache, "id2"));
+
+  EXPECT_EQ(3U, store_.counter("ssl.session_cache.insert").value());
+  EXPECT_EQ(4U, store_.counter("ssl.session_cache.hit").value());
+  EXPECT_EQ(2U, store_.counter("ssl.session_cache.miss").value());
+  EXPECT_EQ(0U, store_.counter("ssl.session_cache.evicted").value());
+}
+
+TEST_F(SessionCacheImplTest, Expiry) {
+  SessionCacheImpl cache(memory_, std::chrono::seconds(300), store_, time_source_);
+
+  cache.insert("id1", "session1");
+  now_ += std::chrono::seconds(299);
+  EXPECT_EQ("session1", lookup(cache, "id1"));
+  now_ += std::chrono::seconds(1);
+  EXPECT_EQ("", lookup(cache, "id1"));
+}
+
+TEST_F(SessionCacheImplTest, EvictFirstToExpire) {
+  SessionCacheImpl cache(memory_, std::chrono::seconds(300), store_, time_source_);
+
+  for (uint32_t i = 0; i < SessionCacheImpl::WAYS; i++) {
+    cache.insert("id" + std::to_string(i), "session");
+    now_ += std::chrono::seconds(1);
+  }
+  // Replacing a session makes it expire last.
+  cache.insert("id0", "session");
+  EXPECT_EQ(0U, store_.counter("ssl.session_cache.evicted").value());
+
+  cache.insert("new", "session");
+  EXPECT_EQ(1U, store_.counter("ssl.session_cache.evicted").value());
+  EXPECT_EQ("session", lookup(cache, "id0"));
+  EXPECT_EQ("", lookup(cache, "id1"));
+  EXPECT_EQ("session", lookup(cache, "id2"));
+  EXPECT_EQ("session", lookup(cache, "new"));
+
+  // Expired sessions are replaced without an eviction.
+  now_ += std::chrono::seconds(300);
+  cache.insert("id1", "session");
+  EXPECT_EQ(1U, store_.counter("ssl.session_cache.evicted").value());
+  EXPECT_EQ("session", lookup(cache, "id1"));
+}
+
+TEST_F(SessionCacheImplTest, TooLarge) {
+  SessionCacheImpl cache(memory_, std::chrono::seconds(300), store_, time_source_);
+
+  cache.insert("id1", std::string(SessionCacheImpl::MAX_SESSION_LENGTH + 1, 'a'));
+  EXPECT_EQ("", lookup(cache, "id1"));
+  cache.insert(std::string(SessionCacheImpl::MAX_ID_LENGTH + 1, 'a'), "session");
+  EXPECT_EQ("", lookup(cache, std::string(SessionCacheImpl::MAX_ID_LENGTH + 1, 'a')));
+  EXPECT_EQ(1U, store_.counter("ssl.session_cache.insert_too_large").value());
+
+  const std::string session(SessionCacheImpl::MAX_SESSION_LENGTH, 'a');
+  cache.insert(std::string(SessionCacheImpl::MAX_ID_LENGTH, 'a'), session);
+  EXPECT_EQ(session, lookup(cache, std::string(SessionCacheImpl::MAX_ID_LENGTH, 'a')));
+}
+
+TEST_F(SessionCacheImplTest, SlotsPerShard) {
+  // The number of sessions that a set in every shard holds.
+  const uint64_t sessions_per_set = SessionCacheImpl::NUM_SHARDS * SessionCacheImpl::WAYS;
+  EXPECT_EQ(SessionCacheImpl::WAYS, SessionCacheImpl::slotsPerShard(1));
+  EXPECT_EQ(SessionCacheImpl::WAYS, SessionCacheImpl::slotsPerShard(sessions_per_set));
+  EXPECT_EQ(2 * SessionCacheImpl::WAYS, SessionCacheImpl::slotsPerShard(sessions_per_set + 1));
+}
+
+TEST_F(SessionCacheImplTest, SharedMemory) {
+  // Caches sharing memory, as the processes of a hot restart do, see each other's sessions.
+  HeapSessionCacheMemory memory(SessionCacheImpl::NUM_SHARDS,
+                                SessionCacheImpl::slotsPerShard(1000));
+  SessionCacheImpl cache1(memory, std::chrono::seconds(300), store_, time_source_);
+  SessionCacheImpl cache2(memory, std::chrono::seconds(300), store_, time_source_);
+
+  for (uint32_t i = 0; i < 100; i++) {
+    cache1.insert("id" + std::to_string(i), "session" + std::to_string(i));
+  }
+  for (uint32_t i = 0; i < 100; i++) {
+    EXPECT_EQ("session" + std::to_string(i), lookup(cache2, "id" + std::to_string(i)));
+  }
+}
+
+} // namespace Ssl
+} // namespace Envoy
@@ -0,0 +1,192 @@
+#include <chrono>
+#include <string>
+#include <vector>
+
+#include "common/stats/grpc_metrics_service_impl.h"
+#include "common/stats/histogram_impl.h"
+#include "common/stats/stats_impl.h"
+
+#include "test/mocks/common.h"
+#include "test/mocks/grpc/mocks.h"
+#include "test/mocks/local_info/mocks.h"
+#include "test/mocks/stats/mocks.h"
+
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+
+using testing::InSequence;
+using testing::Invoke;
+using testing::NiceMock;
+using testing::Return;
+using testing::ReturnRef;
+using testing::SaveArg;
+using testing::_;
+
+namespace Envoy {
+namespace Stats {
+namespace Metrics {
+
+class MetricsServiceSinkTest : public testing::Test {
+public:
+  typedef Grpc::MockAsyncStream<envoy::metrics::StreamMetricsMessage> MockMetricsStream;
+
+  MetricsServiceSinkTest() {
+    ON_CALL(time_source_, currentTime())
+        .WillByDefault(Return(SystemTime(std::chrono::milliseconds(1000))));
+    counter_.name_ = "cluster.foo.upstream_rq";
+    counter_.tags_ = {{"envoy.cluster_name", "foo"}};
+    ON_CALL(counter_, tagExtractedName()).WillByDefault(ReturnRef(counter_extracted_name_));
+    gauge_.name_ = "cluster.foo.membership_total";
+    gauge_.tags_ = {{"envoy.cluster_name", "foo"}};
+    ON_CALL(gauge_, tagExtractedName()).WillByDefault(ReturnRef(gauge_extracted_name_));
+  }
+
+  void expectStreamStart(MockMetricsStream& stream) {
+    EXPECT_CALL(*async_client_, start(_, _))
+        .WillOnce(Invoke([this, &stream](const Protobuf::MethodDescriptor&,
+                                         Grpc::AsyncStreamCallbacks<
+                                             envoy::metrics::StreamMetricsResponse>& callbacks) {
+          EXPECT_EQ(&sink_, &callbacks);
+          return &stream;
+        }));
+  }
+
+  void flush() {
+    sink_.beginFlush();
+    sink_.flushCounter(counter_, 3);
+    sink_.flushGauge(gauge_, 7);
+    sink_.endFlush();
+  }
+
+  NiceMock<LocalInfo::MockLocalInfo> local_info_;
+  NiceMock<MockSystemTimeSource> time_source_;
+  Grpc::MockAsyncClient<envoy::metrics::StreamMetricsMessage,
+                        envoy::metrics::StreamMetricsResponse>* async_client_{
+      new Grpc::MockAsyncClient<envoy::metrics::StreamMetricsMessage,
+                                envoy::metrics::StreamMetricsResponse>()};
+  MetricsServiceSink sink_{local_info_, MetricsServiceClientPtr{async_client_}, time_source_};
+  NiceMock<MockCounter> counter_;
+  const std::string counter_extracted_name_{"cluster.upstream_rq"};
+  NiceMock<MockGauge> gauge_;
+  const std::string gauge_extracted_name_{"cluster.membership_total"};
+};
+
+// The first flush starts the stream and sends the identifier and all the strings, later flushes
+// only refer to them.
+TEST_F(MetricsServiceSinkTest, StringsInternedAcrossFlushes) {
+  InSequence s;
+  MockMetricsStream stream;
+  expectStreamStart(stream);
+  envoy::metrics::StreamMetricsMessage message;
+  EXPECT_CALL(stream, sendMessage(_, false)).WillOnce(SaveArg<0>(&message));
+  flush();
+
+  EXPECT_EQ("node_name", message.identifier().node_id());
+  EXPECT_EQ("cluster_name", message.identifier().cluster());
+  EXPECT_EQ(1000, message.timestamp_ms());
+  ASSERT_EQ(4, message.strings_size());
+  EXPECT_EQ("cluster.upstream_rq", message.strings(0));
+  EXPECT_EQ("envoy.cluster_name", message.strings(1));
+  EXPECT_EQ("foo", message.strings(2));
+  EXPECT_EQ("cluster.membership_total", message.strings(3));
+  ASSERT_EQ(2, message.metrics_size());
+  EXPECT_EQ(envoy::metrics::Metric::COUNTER, message.metrics(0).type());
+  EXPECT_EQ(0, message.metrics(0).name());
+  ASSERT_EQ(1, message.metrics(0).tags_size());
+  EXPECT_EQ(1, message.metrics(0).tags(0).name());
+  EXPECT_EQ(2, message.metrics(0).tags(0).value());
+  EXPECT_EQ(3, message.metrics(0).value());
+  EXPECT_EQ(envoy::metrics::Metric::GAUGE, message.metrics(1).type());
+  EXPECT_EQ(3, message.metrics(1).name());
+  EXPECT_EQ(7, message.metrics(1).value());
+
+  EXPECT_CALL(stream, sendMessage(_, false)).WillOnce(SaveArg<0>(&message));
+  flush();
+
+  EXPECT_FALSE(message.has_identifier());
+  EXPECT_EQ(0, message.strings_size());
+  ASSERT_EQ(2, message.metrics_size());
+  EXPECT_EQ(0, message.metrics(0).name());
+  EXPECT_EQ(3, message.metrics(1).name());
+}
+
+// A new stream is started after the previous one is closed, with its own strings.
+TEST_F(MetricsServiceSinkTest, StreamRestartedAfterClose) {
+  InSequence s;
+  MockMetricsStream stream1;
+  expectStreamStart(stream1);
+  EXPECT_CALL(stream1, sendMessage(_, false));
+  flush();
+  sink_.onRemoteClose(Grpc::Status::Internal, "bad");
+
+  MockMetricsStream stream2;
+  expectStreamStart(stream2);
+  envoy::metrics::StreamMetricsMessage message;
+  EXPECT_CALL(stream2, sendMessage(_, false)).WillOnce(SaveArg<0>(&message));
+  flush();
+
+  EXPECT_TRUE(message.has_identifier());
+  EXPECT_EQ(4, message.strings_size());
+  EXPECT_EQ(0, message.metrics(0).name());
+}
+
+// The metrics of a flush are dropped if the stream cannot be started.
+TEST_F(MetricsServiceSinkTest, StreamStartFailure) {
+  InSequence s;
+  EXPECT_CALL(*async_client_, start(_, _))
+      .WillOnce(Invoke(
+          [](const Protobuf::MethodDescriptor&,
+             Grpc::AsyncStreamCallbacks<envoy::metrics::StreamMetricsResponse>& callbacks) {
+            callbacks.onRemoteClose(Grpc::Status::Internal, "bad");
+            return nullptr;
+          }));
+  flush();
+
+  MockMetricsStream stream;
+  expectStreamStart(stream);
+  envoy::metrics::StreamMetricsMessage message;
+  EXPECT_CALL(stream, sendMessage(_, false)).WillOnce(SaveArg<0>(&message));
+  flush();
+
+  EXPECT_TRUE(message.has_identifier());
+  EXPECT_EQ(4, message.strings_size());
+}
+
+// Histograms are sent as summaries of the values recorded since the previous flush.
+TEST_F(MetricsServiceSinkTest, Histogram) {
+  IsolatedStoreImpl store;
+  ParentHistogramImpl histogram("test_timer", store, std::string("test_timer"),
+                                std::vector<Tag>());
+  histogram.recordValue(5);
+  histogram.merge();
+
+  MockMetricsStream stream;
+  expectStreamStart(stream);
+  envoy::metrics::StreamMetricsMessage message;
+  EXPECT_CALL(stream, sendMessage(_, false)).WillRepeatedly(SaveArg<0>(&message));
+  sink_.beginFlush();
+  sink_.flushHistogram(histogram);
+  sink_.endFlush();
+
+  const std::vector<double>& quantiles = histogram.intervalStatistics().supportedQuantiles();
+  ASSERT_EQ(quantiles.size(), static_cast<size_t>(message.quantiles_size()));
+  EXPECT_EQ(quantiles.front(), message.quantiles(0));
+  ASSERT_EQ(1, message.metrics_size());
+  EXPECT_EQ(envoy::metrics::Metric::SUMMARY, message.metrics(0).type());
+  EXPECT_EQ(1, message.metrics(0).sample_count());
+  EXPECT_EQ(5, message.metrics(0).sample_sum());
+  ASSERT_EQ(quantiles.size(), static_cast<size_t>(message.metrics(0).quantile_values_size()));
+  EXPECT_EQ(5, message.metrics(0).quantile_values(0));
+
+  // Nothing is sent for a histogram without values in the interval.
+  histogram.merge();
+  sink_.beginFlush();
+  sink_.flushHistogram(histogram);
+  sink_.endFlush();
+  EXPECT_EQ(0, message.metrics_size());
+  EXPECT_EQ(0, message.quantiles_size());
+}
+
+} // namespace Metrics
+} // namespace Stats
+} // namespace Envoy
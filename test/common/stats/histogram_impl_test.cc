@@ -0,0 +1,132 @@
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <string>
+#include <vector>
+
+#include "common/stats/histogram_impl.h"
+#include "common/stats/stats_impl.h"
+
+#include "gtest/gtest.h"
+
+namespace Envoy {
+namespace Stats {
+
+TEST(HistogramBucketsTest, Index) {
+  // Values below 8 have a bucket each.
+  for (uint64_t value = 0; value < 8; value++) {
+    EXPECT_EQ(value, HistogramBuckets::index(value));
+    EXPECT_EQ(value, HistogramBuckets::lowerBound(value));
+    EXPECT_EQ(1UL, HistogramBuckets::width(value));
+  }
+
+  EXPECT_EQ(8U, HistogramBuckets::index(8));
+  EXPECT_EQ(15U, HistogramBuckets::index(15));
+  EXPECT_EQ(16U, HistogramBuckets::index(16));
+  EXPECT_EQ(16U, HistogramBuckets::index(17));
+  EXPECT_EQ(17U, HistogramBuckets::index(18));
+  EXPECT_EQ(16UL, HistogramBuckets::lowerBound(16));
+  EXPECT_EQ(2UL, HistogramBuckets::width(16));
+  EXPECT_EQ(HistogramBuckets::NumBuckets - 1,
+            HistogramBuckets::index(std::numeric_limits<uint64_t>::max()));
+
+  // Every bucket starts right after the previous one.
+  for (uint32_t index = 1; index < HistogramBuckets::NumBuckets; index++) {
+    const uint64_t lower_bound = HistogramBuckets::lowerBound(index);
+    EXPECT_EQ(lower_bound, HistogramBuckets::lowerBound(index - 1) +
+                               HistogramBuckets::width(index - 1));
+    EXPECT_EQ(index, HistogramBuckets::index(lower_bound));
+    EXPECT_EQ(index, HistogramBuckets::index(lower_bound + HistogramBuckets::width(index) - 1));
+  }
+}
+
+TEST(HistogramBucketsTest, Drain) {
+  HistogramBuckets buckets;
+  buckets.record(3);
+  buckets.record(3);
+  buckets.record(100);
+
+  std::vector<uint64_t> counts(HistogramBuckets::NumBuckets);
+  uint64_t sum = 0;
+  buckets.drainInto(counts, sum);
+  EXPECT_EQ(2UL, counts[3]);
+  EXPECT_EQ(1UL, counts[HistogramBuckets::index(100)]);
+  EXPECT_EQ(106UL, sum);
+
+  // Drained values are not drained again.
+  buckets.drainInto(counts, sum);
+  EXPECT_EQ(2UL, counts[3]);
+  EXPECT_EQ(106UL, sum);
+}
+
+TEST(HistogramStatisticsImplTest, Quantiles) {
+  HistogramStatisticsImpl statistics;
+  for (double value : statistics.computedQuantiles()) {
+    EXPECT_TRUE(std::isnan(value));
+  }
+
+  // 1 to 100, once each.
+  HistogramBuckets buckets;
+  for (uint64_t value = 1; value <= 100; value++) {
+    buckets.record(value);
+  }
+  std::vector<uint64_t> counts(HistogramBuckets::NumBuckets);
+  uint64_t sum = 0;
+  buckets.drainInto(counts, sum);
+  statistics.refresh(counts, sum);
+
+  EXPECT_EQ(100UL, statistics.sampleCount());
+  EXPECT_EQ(5050UL, statistics.sampleSum());
+  const std::vector<double>& quantiles = statistics.supportedQuantiles();
+  ASSERT_EQ(quantiles.size(), statistics.computedQuantiles().size());
+  for (size_t i = 0; i < quantiles.size(); i++) {
+    // Within the 1/8 width of the buckets.
+    const double expected = std::max(1.0, 100 * quantiles[i]);
+    EXPECT_NEAR(expected, statistics.computedQuantiles()[i], expected / 8) << quantiles[i];
+  }
+  EXPECT_EQ(1, statistics.computedQuantiles().front());
+  EXPECT_EQ(103, statistics.computedQuantiles().back());
+
+  // Refreshing without values resets the quantiles.
+  statistics.refresh(std::vector<uint64_t>(HistogramBuckets::NumBuckets), 0);
+  EXPECT_EQ(0UL, statistics.sampleCount());
+  EXPECT_TRUE(std::isnan(statistics.computedQuantiles()[0]));
+}
+
+TEST(ParentHistogramImplTest, Merge) {
+  IsolatedStoreImpl store;
+  ParentHistogramImpl parent("h", store, std::string("h"), std::vector<Tag>());
+  ThreadLocalHistogramSharedPtr thread_local_histogram = parent.createThreadLocal();
+  EXPECT_EQ("h", thread_local_histogram->name());
+  EXPECT_FALSE(parent.used());
+
+  parent.recordValue(1);
+  thread_local_histogram->recordValue(2);
+  {
+    // Values recorded by a released thread local histogram are merged as well.
+    ThreadLocalHistogramSharedPtr released = parent.createThreadLocal();
+    released->recordValue(3);
+  }
+  parent.merge();
+  EXPECT_TRUE(parent.used());
+  EXPECT_EQ(3UL, parent.intervalStatistics().sampleCount());
+  EXPECT_EQ(6UL, parent.intervalStatistics().sampleSum());
+  EXPECT_EQ(3UL, parent.cumulativeStatistics().sampleCount());
+  EXPECT_EQ("P0(1,1) P25(1,1) P50(2,2) P75(3,3) P90(3,3) P95(3,3) P99(3,3) P99.9(3,3) P100(3,3)",
+            parent.summary());
+
+  thread_local_histogram->recordValue(5);
+  parent.merge();
+  EXPECT_EQ(1UL, parent.intervalStatistics().sampleCount());
+  EXPECT_EQ(4UL, parent.cumulativeStatistics().sampleCount());
+  EXPECT_EQ(11UL, parent.cumulativeStatistics().sampleSum());
+
+  // The interval statistics are empty once a merge finds no values.
+  parent.merge();
+  EXPECT_EQ(0UL, parent.intervalStatistics().sampleCount());
+  EXPECT_TRUE(std::isnan(parent.intervalStatistics().computedQuantiles()[0]));
+  EXPECT_TRUE(parent.used());
+}
+
+} // namespace Stats
+} // namespace Envoy
@@ -0,0 +1,95 @@
+#include <cstdint>
+#include <cstdlib>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "common/stats/sharded_counter_impl.h"
+#include "common/stats/stats_impl.h"
+
+#include "gtest/gtest.h"
+
+namespace Envoy {
+namespace Stats {
+
+/**
+ * Heap allocator that reference counts the raw stat data, like the shared memory one does.
+ */
+class TestAllocator : public RawStatDataAllocator {
+public:
+  RawStatData* alloc(const std::string& name) override { return heap_alloc_.alloc(name); }
+  void free(RawStatData& data) override {
+    if (--data.ref_count_ == 0) {
+      ::free(&data);
+    }
+  }
+
+private:
+  HeapRawStatDataAllocator heap_alloc_;
+};
+
+class ShardedCounterImplTest : public testing::Test {
+public:
+  ShardedCounterImplTest()
+      : data_(*alloc_.alloc("foo")),
+        counter_(new ShardedCounterImpl(data_, alloc_, "foo", std::vector<Tag>())) {}
+
+  TestAllocator alloc_;
+  RawStatData& data_;
+  std::unique_ptr<ShardedCounterImpl> counter_;
+};
+
+TEST_F(ShardedCounterImplTest, Shards) {
+  EXPECT_EQ("foo", counter_->name());
+  EXPECT_FALSE(counter_->used());
+
+  // The increments of the shards are only in the raw stat data once they are folded.
+  counter_->inc();
+  counter_->add(2);
+  EXPECT_TRUE(counter_->used());
+  EXPECT_EQ(3UL, counter_->value());
+  EXPECT_EQ(0UL, data_.value_);
+
+  EXPECT_EQ(3UL, counter_->latch());
+  EXPECT_EQ(3UL, data_.value_);
+  EXPECT_EQ(0UL, counter_->latch());
+
+  counter_->inc();
+  EXPECT_EQ(4UL, counter_->value());
+  counter_->reset();
+  EXPECT_EQ(0UL, counter_->value());
+  EXPECT_EQ(1UL, counter_->latch());
+}
+
+TEST_F(ShardedCounterImplTest, FoldedOnDestruction) {
+  // The raw stat data outlives the counter when another counter shares it.
+  data_.ref_count_++;
+  counter_->add(3);
+  counter_.reset();
+  EXPECT_EQ(3UL, data_.value_);
+  EXPECT_EQ(3UL, data_.pending_increment_);
+  alloc_.free(data_);
+}
+
+TEST_F(ShardedCounterImplTest, Threads) {
+  // More threads than shards, so that some of them share a shard.
+  std::vector<std::thread> threads;
+  for (uint32_t i = 0; i < ShardedCounterImpl::NumShards + 4; i++) {
+    threads.emplace_back([this]() -> void {
+      for (uint32_t j = 0; j < 1000; j++) {
+        counter_->inc();
+        if (j % 100 == 0) {
+          counter_->latch();
+        }
+      }
+    });
+  }
+  for (std::thread& thread : threads) {
+    thread.join();
+  }
+  EXPECT_EQ((ShardedCounterImpl::NumShards + 4) * 1000, counter_->value());
+}
+
+} // namespace Stats
+} // namespace Envoy
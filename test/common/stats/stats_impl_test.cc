@@ -53,6 +53,35 @@ TEST(StatsIsolatedStoreImplTest, All) {
   EXPECT_EQ(2UL, store.gauges().size());
 }
 
+TEST(StatsPrimitiveImplTest, All) {
+  const std::string counter_name = "c1";
+  PrimitiveCounter c1(counter_name);
+  EXPECT_EQ("c1", c1.name());
+  EXPECT_EQ("c1", c1.tagExtractedName());
+  EXPECT_EQ(0, c1.tags().size());
+  EXPECT_FALSE(c1.used());
+  c1.inc();
+  c1.add(2);
+  EXPECT_TRUE(c1.used());
+  EXPECT_EQ(3UL, c1.value());
+  EXPECT_EQ(3UL, c1.latch());
+  EXPECT_EQ(0UL, c1.latch());
+  c1.reset();
+  EXPECT_EQ(0UL, c1.value());
+
+  const std::string gauge_name = "g1";
+  PrimitiveGauge g1(gauge_name);
+  EXPECT_EQ("g1", g1.name());
+  EXPECT_EQ(0, g1.tags().size());
+  EXPECT_FALSE(g1.used());
+  g1.set(5);
+  g1.inc();
+  g1.sub(2);
+  g1.dec();
+  EXPECT_TRUE(g1.used());
+  EXPECT_EQ(3UL, g1.value());
+}
+
 /**
  * Test stats macros. @see stats_macros.h
  */
@@ -83,6 +112,20 @@ TEST(StatsMacros, All) {
   EXPECT_EQ("test.test_histogram", histogram.name());
 }
 
+TEST(HeapRawStatDataAllocatorTest, Names) {
+  HeapRawStatDataAllocator alloc;
+  RawStatData* data = alloc.alloc("a");
+  EXPECT_STREQ("a", data->name_);
+  EXPECT_TRUE(data->matches("a"));
+  alloc.free(*data);
+
+  const std::string long_name(RawStatData::maxNameLength(), 'a');
+  data = alloc.alloc(long_name);
+  EXPECT_EQ(RawStatData::maxNameLength(), strlen(data->name_));
+  EXPECT_TRUE(data->matches(long_name));
+  alloc.free(*data);
+}
+
 TEST(TagExtractorTest, TwoSubexpressions) {
   TagExtractorImpl tag_extractor("cluster_name", "^cluster\\.((.+?)\\.)");
   std::string name = "cluster.test_cluster.upstream_cx_total";
@@ -110,6 +153,29 @@ TEST(TagExtractorTest, EmptyName) {
                             EnvoyException, "tag_name cannot be empty");
 }
 
+TEST(TagExtractorTest, RegexPrefix) {
+  EXPECT_EQ("cluster.", TagExtractorImpl::extractRegexPrefix("^cluster\\.((.*?)\\.)"));
+  EXPECT_EQ("http", TagExtractorImpl::extractRegexPrefix("^http(?=\\.).*?\\.fault\\."));
+  EXPECT_EQ("auth.clientssl.", TagExtractorImpl::extractRegexPrefix("^auth\\.clientssl\\.(.*)"));
+  EXPECT_EQ("", TagExtractorImpl::extractRegexPrefix("^(?:|listener(?=\\.).*?\\.)http"));
+  EXPECT_EQ("", TagExtractorImpl::extractRegexPrefix("cluster\\.(.*)"));
+  EXPECT_EQ("", TagExtractorImpl::extractRegexPrefix("^\\w+"));
+  // The last character is optional or repeated.
+  EXPECT_EQ("abc", TagExtractorImpl::extractRegexPrefix("^abcd?"));
+  EXPECT_EQ("abc", TagExtractorImpl::extractRegexPrefix("^abc\\.*"));
+  EXPECT_EQ("abc", TagExtractorImpl::extractRegexPrefix("^abc+"));
+  // Alternatives outside of groups do not share the prefix.
+  EXPECT_EQ("", TagExtractorImpl::extractRegexPrefix("^abc|def"));
+  EXPECT_EQ("ab", TagExtractorImpl::extractRegexPrefix("^ab(c|d)[|]"));
+
+  std::vector<Tag> tags;
+  TagExtractorImpl tag_extractor("name", "^cluster\\.((.*?)\\.)");
+  EXPECT_EQ("listener.cluster.foo.bar", tag_extractor.extractTag("listener.cluster.foo.bar", tags));
+  EXPECT_TRUE(tags.empty());
+  EXPECT_EQ("cluster.bar", tag_extractor.extractTag("cluster.foo.bar", tags));
+  EXPECT_EQ(1UL, tags.size());
+}
+
 class DefaultTagRegexTester {
 public:
   DefaultTagRegexTester() {
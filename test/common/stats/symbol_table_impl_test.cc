@@ -0,0 +1,57 @@
+#include <string>
+
+#include "common/stats/symbol_table_impl.h"
+
+#include "gtest/gtest.h"
+
+namespace Envoy {
+namespace Stats {
+
+TEST(SymbolTableTest, RoundTrip) {
+  SymbolTable table;
+  for (const std::string name : {"cluster.foo.upstream_rq_200", "", ".", "a..b.", "single"}) {
+    EXPECT_EQ(name, table.decode(table.encode(name)));
+  }
+}
+
+TEST(SymbolTableTest, SharedTokens) {
+  SymbolTable table;
+  const StatName name1 = table.encode("cluster.foo.upstream_rq_200");
+  const StatName name2 = table.encode("cluster.bar.upstream_rq_200");
+  EXPECT_EQ(4UL, table.size());
+  EXPECT_NE(name1, name2);
+  EXPECT_EQ(name1, table.encode("cluster.foo.upstream_rq_200"));
+  EXPECT_EQ(4UL, table.size());
+  // A byte per token while there are fewer than 128 distinct tokens.
+  EXPECT_EQ(3UL, name1.bytes().size());
+  EXPECT_EQ(StatName::Hash()(name1), StatName::Hash()(table.encode("cluster.foo.upstream_rq_200")));
+}
+
+TEST(SymbolTableTest, MultiByteSymbols) {
+  SymbolTable table;
+  for (int i = 0; i < 200; i++) {
+    table.encode(std::to_string(i));
+  }
+  const StatName name = table.encode("199.0.150");
+  EXPECT_EQ(5UL, name.bytes().size());
+  EXPECT_EQ("199.0.150", table.decode(name));
+  EXPECT_EQ("150", table.decode(table.encode("150")));
+}
+
+TEST(SymbolTableTest, Cache) {
+  SymbolTable table;
+  SymbolCache cache;
+  const StatName name = table.encode("a.b.a", &cache);
+  EXPECT_EQ(2UL, cache.size());
+  EXPECT_EQ(name, table.encode("a.b.a"));
+  EXPECT_EQ(name, table.encode("a.b.a", &cache));
+
+  // Another thread's cache gets the same symbols from the table.
+  SymbolCache other_cache;
+  EXPECT_EQ(table.encode("b.c"), table.encode("b.c", &other_cache));
+  EXPECT_EQ(cache["b"], other_cache["b"]);
+  EXPECT_EQ(3UL, table.size());
+}
+
+} // namespace Stats
+} // namespace Envoy
@@ -1,4 +1,6 @@
 #include <chrono>
+#include <cstring>
+#include <map>
 #include <memory>
 #include <string>
 #include <unordered_map>
@@ -156,6 +158,31 @@ TEST_F(StatsThreadLocalStoreTest, Tls) {
   EXPECT_CALL(*this, free(_)).Times(3);
 }
 
+TEST_F(StatsThreadLocalStoreTest, HistogramMerge) {
+  InSequence s;
+  store_->initializeThreading(main_thread_dispatcher_, tls_);
+
+  // The histogram of the thread is merged by the histogram of the central cache.
+  Histogram& h1 = store_->histogram("h1");
+  EXPECT_CALL(sink_, onHistogramComplete(Ref(h1), 10));
+  h1.recordValue(10);
+  ASSERT_EQ(1UL, store_->histograms().size());
+  ParentHistogramSharedPtr parent = store_->histograms().front();
+  EXPECT_NE(&h1, static_cast<Histogram*>(parent.get()));
+  EXPECT_EQ("h1", parent->name());
+  EXPECT_FALSE(parent->used());
+  parent->merge();
+  EXPECT_TRUE(parent->used());
+  EXPECT_EQ(1UL, parent->intervalStatistics().sampleCount());
+  EXPECT_EQ(10UL, parent->intervalStatistics().sampleSum());
+
+  store_->shutdownThreading();
+  tls_.shutdownThread();
+
+  // Includes overflow stat.
+  EXPECT_CALL(*this, free(_));
+}
+
 TEST_F(StatsThreadLocalStoreTest, BasicScope) {
   InSequence s;
   store_->initializeThreading(main_thread_dispatcher_, tls_);
@@ -217,6 +244,42 @@ TEST_F(StatsThreadLocalStoreTest, ScopeDelete) {
   EXPECT_CALL(*this, free(_));
 }
 
+TEST_F(StatsThreadLocalStoreTest, RetainDeletedScopes) {
+  InSequence s;
+
+  // Replace the store with one that retains the stats of deleted scopes for a flush.
+  store_->shutdownThreading();
+  EXPECT_CALL(*this, free(_));
+  store_.reset();
+  EXPECT_CALL(*this, alloc("stats.overflow"));
+  store_.reset(new ThreadLocalStoreImpl(*this, 1));
+  store_->initializeThreading(main_thread_dispatcher_, tls_);
+
+  ScopePtr scope1 = store_->createScope("scope1.");
+  EXPECT_CALL(*this, alloc(_)).Times(2);
+  scope1->counter("c1").inc();
+  scope1->gauge("g1").set(5);
+  EXPECT_CALL(main_thread_dispatcher_, post(_));
+  EXPECT_CALL(tls_, runOnAllThreads(_));
+  scope1.reset();
+
+  // The stats of the deleted scope are listed until the next flush completes.
+  EXPECT_EQ(2UL, store_->counters().size());
+  EXPECT_EQ(1UL, TestUtility::findCounter(*store_, "scope1.c1")->latch());
+  EXPECT_EQ(5UL, TestUtility::findGauge(*store_, "scope1.g1")->value());
+
+  EXPECT_CALL(*this, free(_)).Times(2);
+  store_->onStatsFlushed();
+  EXPECT_EQ(1UL, store_->counters().size());
+  EXPECT_EQ(0UL, store_->gauges().size());
+
+  store_->shutdownThreading();
+  tls_.shutdownThread();
+
+  // Includes overflow stat.
+  EXPECT_CALL(*this, free(_));
+}
+
 TEST_F(StatsThreadLocalStoreTest, NestedScopes) {
   InSequence s;
   store_->initializeThreading(main_thread_dispatcher_, tls_);
@@ -302,6 +365,79 @@ TEST_F(StatsThreadLocalStoreTest, OverlappingScopes) {
   EXPECT_CALL(*this, free(_)).Times(3);
 }
 
+TEST_F(StatsThreadLocalStoreTest, ScopeAccounting) {
+  InSequence s;
+  store_->initializeThreading(main_thread_dispatcher_, tls_);
+
+  ScopePtr scope1 = store_->createScope("scope1.");
+  EXPECT_CALL(*this, alloc(_)).Times(2);
+  scope1->counter("c1");
+  scope1->counter("c1");
+  scope1->gauge("g1");
+  scope1->histogram("h1");
+
+  // The default scope has the overflow stat.
+  std::map<std::string, ScopeStatsInfo> scopes;
+  for (const ScopeStatsInfo& scope : store_->scopes()) {
+    scopes.emplace(scope.prefix_, scope);
+  }
+  EXPECT_EQ(2UL, scopes.size());
+  EXPECT_EQ(1UL, scopes[""].num_stats_);
+  EXPECT_EQ(0UL, scopes[""].num_overflow_stats_);
+  EXPECT_EQ(strlen("stats.overflow"), scopes[""].name_bytes_);
+  EXPECT_EQ(3UL, scopes["scope1."].num_stats_);
+  EXPECT_EQ(0UL, scopes["scope1."].num_overflow_stats_);
+  EXPECT_EQ(strlen("scope1.c1scope1.g1scope1.h1"), scopes["scope1."].name_bytes_);
+  EXPECT_EQ(4UL, store_->numStatsCreated());
+
+  // The stats of a deleted scope are no longer listed, but still count as created.
+  EXPECT_CALL(main_thread_dispatcher_, post(_));
+  EXPECT_CALL(tls_, runOnAllThreads(_));
+  EXPECT_CALL(*this, free(_)).Times(2);
+  scope1.reset();
+  EXPECT_EQ(1UL, store_->scopes().size());
+  EXPECT_EQ("", store_->scopes().front().prefix_);
+  EXPECT_EQ(4UL, store_->numStatsCreated());
+
+  store_->shutdownThreading();
+  tls_.shutdownThread();
+
+  // Includes overflow stat.
+  EXPECT_CALL(*this, free(_));
+}
+
+TEST_F(StatsThreadLocalStoreTest, ShardedCounters) {
+  InSequence s;
+  store_->setShardedCounters({"rq_total"});
+  store_->initializeThreading(main_thread_dispatcher_, tls_);
+
+  EXPECT_CALL(*this, alloc(_)).Times(3);
+  Counter& c1 = store_->counter("cluster.foo.rq_total");
+  Counter& c2 = store_->counter("cluster.foo.upstream_rq_total");
+  Counter& c3 = store_->counter("rq_total");
+  EXPECT_EQ(&c1, &store_->counter("cluster.foo.rq_total"));
+
+  // Sharded counters are shared by the threads like the others.
+  CounterSharedPtr central_c1 = TestUtility::findCounter(*store_, "cluster.foo.rq_total");
+  EXPECT_EQ(&c1, central_c1.get());
+  EXPECT_NE(nullptr, dynamic_cast<ShardedCounterImpl*>(central_c1.get()));
+  EXPECT_NE(nullptr, dynamic_cast<ShardedCounterImpl*>(&c3));
+  EXPECT_EQ(nullptr, dynamic_cast<ShardedCounterImpl*>(&c2));
+  c1.inc();
+  c1.inc();
+  EXPECT_EQ("cluster.foo.rq_total", c1.name());
+  EXPECT_EQ(2UL, c1.value());
+  EXPECT_EQ(2UL, c1.latch());
+  EXPECT_EQ(0UL, c1.latch());
+  central_c1.reset();
+
+  store_->shutdownThreading();
+  tls_.shutdownThread();
+
+  // Includes overflow stat.
+  EXPECT_CALL(*this, free(_)).Times(4);
+}
+
 TEST_F(StatsThreadLocalStoreTest, AllocFailed) {
   InSequence s;
   store_->initializeThreading(main_thread_dispatcher_, tls_);
@@ -309,6 +445,7 @@ TEST_F(StatsThreadLocalStoreTest, AllocFailed) {
   EXPECT_CALL(*this, alloc("foo")).WillOnce(Return(nullptr));
   Counter& c1 = store_->counter("foo");
   EXPECT_EQ(1UL, store_->counter("stats.overflow").value());
+  EXPECT_EQ(1UL, store_->scopes().front().num_overflow_stats_);
 
   c1.inc();
   EXPECT_EQ(1UL, c1.value());
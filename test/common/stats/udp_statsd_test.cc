@@ -2,6 +2,7 @@
 
 #include "common/network/address_impl.h"
 #include "common/network/utility.h"
+#include "common/stats/histogram_impl.h"
 #include "common/stats/statsd.h"
 
 #include "test/mocks/stats/mocks.h"
@@ -14,6 +15,7 @@
 #include "spdlog/spdlog.h"
 
 using testing::NiceMock;
+using testing::_;
 
 namespace Envoy {
 namespace Stats {
@@ -22,6 +24,7 @@ namespace Statsd {
 class MockWriter : public Writer {
 public:
   MOCK_METHOD1(write, void(const std::string& message));
+  MOCK_METHOD1(writeMultiple, void(const std::vector<std::string>& messages));
 };
 
 class UdpStatsdSinkTest : public testing::TestWithParam<Network::Address::IpVersion> {};
@@ -110,21 +113,39 @@ TEST(UdpStatsdSinkTest, CheckActualStats) {
 
   NiceMock<MockCounter> counter;
   counter.name_ = "test_counter";
-  EXPECT_CALL(*std::dynamic_pointer_cast<NiceMock<MockWriter>>(writer_ptr),
-              write("envoy.test_counter:1|c"));
-  sink.flushCounter(counter, 1);
-
   NiceMock<MockGauge> gauge;
   gauge.name_ = "test_gauge";
-  EXPECT_CALL(*std::dynamic_pointer_cast<NiceMock<MockWriter>>(writer_ptr),
-              write("envoy.test_gauge:1|g"));
+  EXPECT_CALL(*writer_ptr, writeMultiple(std::vector<std::string>{
+                               "envoy.test_counter:1|c\nenvoy.test_gauge:1|g"}));
+  sink.beginFlush();
+  sink.flushCounter(counter, 1);
   sink.flushGauge(gauge, 1);
-
-  NiceMock<MockHistogram> timer;
-  timer.name_ = "test_timer";
-  EXPECT_CALL(*std::dynamic_pointer_cast<NiceMock<MockWriter>>(writer_ptr),
-              write("envoy.test_timer:5|ms"));
-  sink.onHistogramComplete(timer, 5);
+  sink.endFlush();
+
+  // Histogram values are only sent as quantiles when flushed.
+  IsolatedStoreImpl store;
+  ParentHistogramImpl histogram("test_timer", store, std::string("test_timer"),
+                                std::vector<Tag>());
+  histogram.recordValue(5);
+  EXPECT_CALL(*writer_ptr, write(_)).Times(0);
+  sink.onHistogramComplete(histogram, 5);
+  histogram.merge();
+  EXPECT_CALL(*writer_ptr, writeMultiple(std::vector<std::string>{
+                               "envoy.test_timer.p0:5|g\nenvoy.test_timer.p25:5|g\n"
+                               "envoy.test_timer.p50:5|g\nenvoy.test_timer.p75:5|g\n"
+                               "envoy.test_timer.p90:5|g\nenvoy.test_timer.p95:5|g\n"
+                               "envoy.test_timer.p99:5|g\nenvoy.test_timer.p99_9:5|g\n"
+                               "envoy.test_timer.p100:5|g"}));
+  sink.beginFlush();
+  sink.flushHistogram(histogram);
+  sink.endFlush();
+
+  // Nothing is sent for a histogram without values in the interval.
+  histogram.merge();
+  EXPECT_CALL(*writer_ptr, writeMultiple(_)).Times(0);
+  sink.beginFlush();
+  sink.flushHistogram(histogram);
+  sink.endFlush();
 
   tls_.shutdownThread();
 }
@@ -138,27 +159,95 @@ TEST(UdpStatsdSinkWithTagsTest, CheckActualStats) {
   NiceMock<MockCounter> counter;
   counter.name_ = "test_counter";
   counter.tags_ = tags;
-  EXPECT_CALL(*std::dynamic_pointer_cast<NiceMock<MockWriter>>(writer_ptr),
-              write("envoy.test_counter:1|c|#key1:value1,key2:value2"));
-  sink.flushCounter(counter, 1);
-
   NiceMock<MockGauge> gauge;
   gauge.name_ = "test_gauge";
   gauge.tags_ = tags;
-  EXPECT_CALL(*std::dynamic_pointer_cast<NiceMock<MockWriter>>(writer_ptr),
-              write("envoy.test_gauge:1|g|#key1:value1,key2:value2"));
+  EXPECT_CALL(*writer_ptr, writeMultiple(std::vector<std::string>{
+                               "envoy.test_counter:1|c|#key1:value1,key2:value2\n"
+                               "envoy.test_gauge:1|g|#key1:value1,key2:value2"}));
+  sink.beginFlush();
+  sink.flushCounter(counter, 1);
   sink.flushGauge(gauge, 1);
+  sink.endFlush();
+
+  IsolatedStoreImpl store;
+  ParentHistogramImpl histogram("test_timer", store, std::string("test_timer"),
+                                std::vector<Tag>(tags));
+  histogram.recordValue(1);
+  histogram.recordValue(3);
+  histogram.merge();
+  EXPECT_CALL(*writer_ptr, writeMultiple(std::vector<std::string>{
+                               "envoy.test_timer.p0:1|g|#key1:value1,key2:value2\n"
+                               "envoy.test_timer.p25:1|g|#key1:value1,key2:value2\n"
+                               "envoy.test_timer.p50:1|g|#key1:value1,key2:value2\n"
+                               "envoy.test_timer.p75:3|g|#key1:value1,key2:value2\n"
+                               "envoy.test_timer.p90:3|g|#key1:value1,key2:value2\n"
+                               "envoy.test_timer.p95:3|g|#key1:value1,key2:value2\n"
+                               "envoy.test_timer.p99:3|g|#key1:value1,key2:value2\n"
+                               "envoy.test_timer.p99_9:3|g|#key1:value1,key2:value2\n"
+                               "envoy.test_timer.p100:3|g|#key1:value1,key2:value2"}));
+  sink.beginFlush();
+  sink.flushHistogram(histogram);
+  sink.endFlush();
 
-  NiceMock<MockHistogram> timer;
-  timer.name_ = "test_timer";
-  timer.tags_ = tags;
-  EXPECT_CALL(*std::dynamic_pointer_cast<NiceMock<MockWriter>>(writer_ptr),
-              write("envoy.test_timer:5|ms|#key1:value1,key2:value2"));
-  sink.onHistogramComplete(timer, 5);
+  tls_.shutdownThread();
+}
+
+TEST(UdpStatsdSinkTest, SplitIntoDatagrams) {
+  auto writer_ptr = std::make_shared<NiceMock<MockWriter>>();
+  NiceMock<ThreadLocal::MockInstance> tls_;
+  // Room for two of the 22 byte messages and the separator between them.
+  UdpStatsdSink sink(tls_, writer_ptr, false, 45);
+
+  NiceMock<MockCounter> counter;
+  counter.name_ = "test_counter";
+  NiceMock<MockCounter> long_counter;
+  long_counter.name_ = "a_counter_name_longer_than_a_datagram";
+  EXPECT_CALL(*writer_ptr,
+              writeMultiple(std::vector<std::string>{
+                  "envoy.test_counter:1|c\nenvoy.test_counter:2|c", "envoy.test_counter:3|c",
+                  "envoy.a_counter_name_longer_than_a_datagram:4|c", "envoy.test_counter:5|c"}));
+  sink.beginFlush();
+  sink.flushCounter(counter, 1);
+  sink.flushCounter(counter, 2);
+  sink.flushCounter(counter, 3);
+  sink.flushCounter(long_counter, 4);
+  sink.flushCounter(counter, 5);
+  sink.endFlush();
+
+  // Nothing is sent for an empty flush.
+  EXPECT_CALL(*writer_ptr, writeMultiple(_)).Times(0);
+  sink.beginFlush();
+  sink.endFlush();
 
   tls_.shutdownThread();
 }
 
+class UdpStatsdWriterTest : public testing::TestWithParam<Network::Address::IpVersion> {};
+INSTANTIATE_TEST_CASE_P(IpVersions, UdpStatsdWriterTest,
+                        testing::ValuesIn(TestEnvironment::getIpVersionsForTest()));
+
+TEST_P(UdpStatsdWriterTest, WriteMultiple) {
+  auto server =
+      Network::Test::bindFreeLoopbackPort(GetParam(), Network::Address::SocketType::Datagram);
+  Writer writer(server.first);
+
+  // More datagrams than fit in a single sendmmsg() call.
+  std::vector<std::string> messages;
+  for (int i = 0; i < 100; i++) {
+    messages.push_back(fmt::format("envoy.counter_{}:1|c", i));
+  }
+  writer.writeMultiple(messages);
+
+  for (const std::string& message : messages) {
+    char datagram[64];
+    const ssize_t rc = ::recv(server.second, datagram, sizeof(datagram), 0);
+    ASSERT_EQ(static_cast<ssize_t>(message.size()), rc);
+    EXPECT_EQ(message, std::string(datagram, rc));
+  }
+  close(server.second);
+}
+
 } // namespace Statsd
 } // namespace Stats
 } // namespace Envoy
@@ -8,6 +8,7 @@
 using testing::InSequence;
 using testing::Ref;
 using testing::ReturnPointee;
+using testing::SaveArg;
 using testing::_;
 
 namespace Envoy {
@@ -82,6 +83,43 @@ TEST_F(ThreadLocalInstanceImplTest, All) {
   tls_.shutdownThread();
 }
 
+TEST_F(ThreadLocalInstanceImplTest, Batch) {
+  SlotPtr slot = tls_.allocateSlot();
+  std::vector<int> runs;
+
+  // The main thread runs each update right away, and the other threads get nothing until the
+  // outermost batch is flushed or ends.
+  tls_.beginBatch();
+  tls_.beginBatch();
+  slot->runOnAllThreads([&runs]() -> void { runs.push_back(1); });
+  slot->runOnAllThreads([&runs]() -> void { runs.push_back(2); });
+  EXPECT_EQ((std::vector<int>{1, 2}), runs);
+  tls_.endBatch();
+
+  Event::PostCb post_cb;
+  EXPECT_CALL(thread_dispatcher_, post(_)).WillOnce(SaveArg<0>(&post_cb));
+  tls_.flushBatch();
+  runs.clear();
+  post_cb();
+  EXPECT_EQ((std::vector<int>{1, 2}), runs);
+
+  slot->runOnAllThreads([&runs]() -> void { runs.push_back(3); });
+  EXPECT_CALL(thread_dispatcher_, post(_)).WillOnce(SaveArg<0>(&post_cb));
+  tls_.endBatch();
+  runs.clear();
+  post_cb();
+  EXPECT_EQ(std::vector<int>{3}, runs);
+
+  // An empty batch posts nothing.
+  tls_.beginBatch();
+  tls_.endBatch();
+
+  EXPECT_CALL(thread_dispatcher_, post(_));
+  slot.reset();
+  tls_.shutdownGlobalThreading();
+  tls_.shutdownThread();
+}
+
 // Validate ThreadLocal::InstanceImpl's dispatcher() behavior.
 TEST(ThreadLocalInstanceImplDispatcherTest, Dispatcher) {
   InstanceImpl tls;
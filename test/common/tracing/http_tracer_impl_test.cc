@@ -1,3 +1,4 @@
+#include <chrono>
 #include <cstdint>
 #include <memory>
 #include <string>
@@ -234,6 +235,62 @@ TEST(HttpTracerUtilityTest, IsTracing) {
   }
 }
 
+TEST(SampleRateLimiterTest, RefillsPerKey) {
+  SampleRateLimiter limiter;
+  const MonotonicTime start;
+
+  // A new bucket holds a second's worth of samples.
+  EXPECT_TRUE(limiter.allow("a", 2, start));
+  EXPECT_TRUE(limiter.allow("a", 2, start));
+  EXPECT_FALSE(limiter.allow("a", 2, start));
+  EXPECT_TRUE(limiter.allow("b", 2, start));
+
+  // Half a second refills one sample.
+  EXPECT_TRUE(limiter.allow("a", 2, start + std::chrono::milliseconds(500)));
+  EXPECT_FALSE(limiter.allow("a", 2, start + std::chrono::milliseconds(500)));
+
+  // The bucket never holds more than a second's worth.
+  EXPECT_TRUE(limiter.allow("a", 2, start + std::chrono::seconds(10)));
+  EXPECT_TRUE(limiter.allow("a", 2, start + std::chrono::seconds(10)));
+  EXPECT_FALSE(limiter.allow("a", 2, start + std::chrono::seconds(10)));
+}
+
+TEST(SampleRateLimiterTest, OverflowKeysShareABucket) {
+  SampleRateLimiter limiter;
+  const MonotonicTime start;
+  for (size_t i = 0; i < SampleRateLimiter::MAX_KEYS; i++) {
+    EXPECT_TRUE(limiter.allow(std::to_string(i), 1, start));
+  }
+
+  EXPECT_TRUE(limiter.allow("overflow_a", 1, start));
+  EXPECT_FALSE(limiter.allow("overflow_b", 1, start));
+}
+
+TEST(HttpTracerUtilityTest, LimitSampling) {
+  SampleRateLimiter limiter;
+  const MonotonicTime start;
+  Runtime::RandomGeneratorImpl random;
+
+  std::string sampled_guid = random.uuid();
+  UuidUtils::setTraceableUuid(sampled_guid, UuidTraceStatus::Sampled);
+  Http::TestHeaderMapImpl first_headers{{"x-request-id", sampled_guid}};
+  Http::TestHeaderMapImpl second_headers{{"x-request-id", sampled_guid}};
+
+  EXPECT_FALSE(HttpTracerUtility::limitSampling(first_headers, limiter, "cluster", 1, start));
+  EXPECT_EQ(sampled_guid, first_headers.get_("x-request-id"));
+
+  EXPECT_TRUE(HttpTracerUtility::limitSampling(second_headers, limiter, "cluster", 1, start));
+  EXPECT_EQ(UuidTraceStatus::NoTrace,
+            UuidUtils::isTraceableUuid(second_headers.get_("x-request-id")));
+
+  // Requests that are traced for other reasons are never limited.
+  std::string forced_guid = random.uuid();
+  UuidUtils::setTraceableUuid(forced_guid, UuidTraceStatus::Forced);
+  Http::TestHeaderMapImpl forced_headers{{"x-request-id", forced_guid}};
+  EXPECT_FALSE(HttpTracerUtility::limitSampling(forced_headers, limiter, "cluster", 1, start));
+  EXPECT_EQ(forced_guid, forced_headers.get_("x-request-id"));
+}
+
 TEST(HttpConnManFinalizerImpl, OriginalAndLongPath) {
   const std::string path(300, 'a');
   const std::string path_prefix = "http://";
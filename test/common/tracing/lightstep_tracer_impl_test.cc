@@ -1,7 +1,10 @@
 #include <chrono>
 #include <memory>
+#include <mutex>
 #include <sstream>
 #include <string>
+#include <thread>
+#include <vector>
 
 #include "common/common/base64.h"
 #include "common/grpc/common.h"
@@ -348,6 +351,81 @@ TEST_F(LightStepDriverTest, CancelRequestOnDestruction) {
   driver_.reset();
 }
 
+TEST_F(LightStepDriverTest, FlushSpansOnReportingThread) {
+  EXPECT_CALL(cm_, get("fake_cluster")).WillRepeatedly(Return(&cm_.thread_local_cluster_));
+  ON_CALL(*cm_.thread_local_cluster_.cluster_.info_, features())
+      .WillByDefault(Return(Upstream::ClusterInfo::Features::HTTP2));
+
+  // Callbacks posted by the reporting thread are run on the test thread.
+  std::mutex posted_lock;
+  std::vector<Event::PostCb> posted;
+  ON_CALL(tls_.dispatcher_, post(_)).WillByDefault(Invoke([&](Event::PostCb cb) -> void {
+    std::unique_lock<std::mutex> lock(posted_lock);
+    posted.push_back(cb);
+  }));
+  auto run_posted = [&]() -> void {
+    std::vector<Event::PostCb> callbacks;
+    while (callbacks.empty()) {
+      std::this_thread::yield();
+      std::unique_lock<std::mutex> lock(posted_lock);
+      callbacks.swap(posted);
+    }
+    for (const Event::PostCb& cb : callbacks) {
+      cb();
+    }
+  };
+
+  std::string valid_config = R"EOF(
+    {"collector_cluster": "fake_cluster", "reporting_thread": true}
+  )EOF";
+  Json::ObjectSharedPtr loader = Json::Factory::loadFromString(valid_config);
+  setup(*loader, true);
+
+  Http::MockAsyncClientRequest request(&cm_.async_client_);
+  Http::AsyncClient::Callbacks* callback;
+  const Optional<std::chrono::milliseconds> timeout(std::chrono::seconds(5));
+
+  EXPECT_CALL(cm_.async_client_, send_(_, _, timeout))
+      .WillOnce(
+          Invoke([&](Http::MessagePtr& message, Http::AsyncClient::Callbacks& callbacks,
+                     const Optional<std::chrono::milliseconds>&) -> Http::AsyncClient::Request* {
+            callback = &callbacks;
+
+            EXPECT_STREQ("/lightstep.collector.CollectorService/Report",
+                         message->headers().Path()->value().c_str());
+            EXPECT_STREQ("fake_cluster", message->headers().Host()->value().c_str());
+
+            return &request;
+          }));
+  EXPECT_CALL(runtime_.snapshot_, getInteger("tracing.lightstep.min_flush_spans", 5))
+      .WillOnce(Return(1));
+  EXPECT_CALL(runtime_.snapshot_, getInteger("tracing.lightstep.request_timeout", 5000U))
+      .WillOnce(Return(5000U));
+
+  SpanPtr span = driver_->startSpan(config_, request_headers_, operation_name_, start_time_);
+  span->finishSpan();
+
+  // The batch is serialized on the reporting thread and sent from the dispatcher of the worker.
+  run_posted();
+  EXPECT_EQ(1U, stats_.counter("tracing.lightstep.reports_batched").value());
+
+  Http::MessagePtr msg(new Http::ResponseMessageImpl(
+      Http::HeaderMapPtr{new Http::TestHeaderMapImpl{{":status", "200"}}}));
+  msg->trailers(Http::HeaderMapPtr{new Http::TestHeaderMapImpl{{"grpc-status", "0"}}});
+  std::unique_ptr<Protobuf::Message> collector_response =
+      lightstep::Transporter::MakeCollectorResponse();
+  msg->body() = Grpc::Common::serializeBody(*collector_response);
+
+  callback->onSuccess(std::move(msg));
+
+  // The response is posted to the worker whose report is in the batch.
+  run_posted();
+  EXPECT_EQ(1U, cm_.thread_local_cluster_.cluster_.info_->stats_store_
+                    .counter("grpc.lightstep.collector.CollectorService.Report.success")
+                    .value());
+  EXPECT_EQ(1U, stats_.counter("tracing.lightstep.spans_sent").value());
+}
+
 TEST_F(LightStepDriverTest, SerializeAndDeserializeContext) {
   for (OpenTracingDriver::PropagationMode propagation_mode :
        {OpenTracingDriver::PropagationMode::SingleHeader,
@@ -1,4 +1,8 @@
+#include "common/buffer/buffer_impl.h"
 #include "common/tracing/zipkin/span_buffer.h"
+#include "common/tracing/zipkin/span_proto_encoder.h"
+
+#include "test/test_common/utility.h"
 
 #include "gtest/gtest.h"
 
@@ -101,5 +105,47 @@ TEST(ZipkinSpanBufferTest, sizeConstructorEndtoEnd) {
   EXPECT_EQ(0ULL, buffer.pendingSpans());
   EXPECT_EQ("[]", buffer.toStringifiedJsonArray());
 }
+
+TEST(ZipkinSpanBufferTest, serializeJson) {
+  SpanBuffer buffer(2);
+  Buffer::OwnedImpl output;
+  buffer.serialize(output);
+  EXPECT_EQ("[]", TestUtility::bufferToString(output));
+
+  buffer.addSpan(Span());
+  buffer.addSpan(Span());
+  EXPECT_FALSE(buffer.addSpan(Span()));
+  EXPECT_EQ(2ULL, buffer.pendingSpans());
+  const std::string expected_json_array_string = buffer.toStringifiedJsonArray();
+  EXPECT_EQ(expected_json_array_string.size() - 2, buffer.pendingBytes());
+
+  output.drain(output.length());
+  buffer.serialize(output);
+  EXPECT_EQ(expected_json_array_string, TestUtility::bufferToString(output));
+}
+
+TEST(ZipkinSpanBufferTest, serializeProto) {
+  SpanBuffer buffer(2, CollectorEndpointVersion::HTTP_PROTO);
+  EXPECT_EQ(CollectorEndpointVersion::HTTP_PROTO, buffer.version());
+
+  Span span;
+  span.setName("span");
+  buffer.addSpan(span);
+  buffer.addSpan(span);
+  EXPECT_EQ(2ULL, buffer.pendingSpans());
+
+  // A ListOfSpans is the concatenation of its spans.
+  std::string expected;
+  SpanProtoEncoder::appendSpan(span, expected);
+  SpanProtoEncoder::appendSpan(span, expected);
+  EXPECT_EQ(expected.size(), buffer.pendingBytes());
+  Buffer::OwnedImpl output;
+  buffer.serialize(output);
+  EXPECT_EQ(expected, TestUtility::bufferToString(output));
+
+  buffer.clear();
+  EXPECT_EQ(0ULL, buffer.pendingSpans());
+  EXPECT_EQ(0ULL, buffer.pendingBytes());
+}
 } // namespace Zipkin
 } // namespace Envoy
@@ -0,0 +1,102 @@
+#include <string>
+
+#include "common/tracing/zipkin/span_proto_encoder.h"
+#include "common/tracing/zipkin/zipkin_core_constants.h"
+
+#include "gtest/gtest.h"
+
+namespace Envoy {
+namespace Zipkin {
+
+namespace {
+
+std::string bytes(std::initializer_list<uint8_t> values) {
+  return std::string(values.begin(), values.end());
+}
+
+Span testSpan() {
+  Span span;
+  span.setTraceId(1);
+  span.setId(2);
+  span.setName("a");
+  return span;
+}
+
+} // namespace
+
+TEST(ZipkinSpanProtoEncoderTest, AppendVarint) {
+  std::string output;
+  SpanProtoEncoder::appendVarint(1, output);
+  SpanProtoEncoder::appendVarint(300, output);
+  EXPECT_EQ(bytes({0x01, 0xac, 0x02}), output);
+}
+
+TEST(ZipkinSpanProtoEncoderTest, MinimalSpan) {
+  std::string output;
+  SpanProtoEncoder::appendSpan(testSpan(), output);
+  EXPECT_EQ(bytes({0x0a, 0x17,                                           // spans
+                   0x0a, 0x08, 0, 0, 0, 0, 0, 0, 0, 1,                   // trace_id
+                   0x1a, 0x08, 0, 0, 0, 0, 0, 0, 0, 2,                   // id
+                   0x2a, 0x01, 'a'}),                                    // name
+            output);
+}
+
+TEST(ZipkinSpanProtoEncoderTest, ClientSpan) {
+  Span span = testSpan();
+  span.setTimestamp(3);
+  span.setDuration(4);
+  Endpoint endpoint("s", nullptr);
+  span.addAnnotation(Annotation(3, ZipkinCoreConstants::get().CLIENT_SEND, endpoint));
+  span.addAnnotation(Annotation(7, ZipkinCoreConstants::get().CLIENT_RECV, endpoint));
+
+  std::string output;
+  SpanProtoEncoder::appendSpan(span, output);
+  EXPECT_EQ(bytes({0x0a, 0x29,                                           // spans
+                   0x0a, 0x08, 0, 0, 0, 0, 0, 0, 0, 1,                   // trace_id
+                   0x1a, 0x08, 0, 0, 0, 0, 0, 0, 0, 2,                   // id
+                   0x20, 0x01,                                           // kind CLIENT
+                   0x2a, 0x01, 'a',                                      // name
+                   0x31, 3, 0, 0, 0, 0, 0, 0, 0,                         // timestamp
+                   0x38, 0x04,                                           // duration
+                   0x42, 0x03, 0x0a, 0x01, 's'}),                        // local_endpoint
+            output);
+}
+
+TEST(ZipkinSpanProtoEncoderTest, SharedServerSpan) {
+  Span span;
+  span.setTraceId(1);
+  span.setId(2);
+  Endpoint endpoint("s", nullptr);
+  span.addAnnotation(Annotation(5, ZipkinCoreConstants::get().SERVER_RECV, endpoint));
+  span.addAnnotation(Annotation(9, ZipkinCoreConstants::get().SERVER_SEND, endpoint));
+
+  // The timestamp and duration come from the server annotations.
+  std::string output;
+  SpanProtoEncoder::appendSpan(span, output);
+  EXPECT_EQ(bytes({0x0a, 0x28,                                           // spans
+                   0x0a, 0x08, 0, 0, 0, 0, 0, 0, 0, 1,                   // trace_id
+                   0x1a, 0x08, 0, 0, 0, 0, 0, 0, 0, 2,                   // id
+                   0x20, 0x02,                                           // kind SERVER
+                   0x31, 5, 0, 0, 0, 0, 0, 0, 0,                         // timestamp
+                   0x38, 0x04,                                           // duration
+                   0x42, 0x03, 0x0a, 0x01, 's',                          // local_endpoint
+                   0x68, 0x01}),                                         // shared
+            output);
+}
+
+TEST(ZipkinSpanProtoEncoderTest, LongTag) {
+  Span span = testSpan();
+  span.setTag("k", std::string(200, 'v'));
+
+  std::string output;
+  SpanProtoEncoder::appendSpan(span, output);
+  // The tag entry is 206 bytes, so both its length and the span's take two bytes.
+  const std::string tag = bytes({0x5a, 0xce, 0x01, 0x0a, 0x01, 'k', 0x12, 0xc8, 0x01}) +
+                          std::string(200, 'v');
+  EXPECT_EQ(bytes({0x0a, 0xe8, 0x01}) + bytes({0x0a, 0x08, 0, 0, 0, 0, 0, 0, 0, 1}) +
+                bytes({0x1a, 0x08, 0, 0, 0, 0, 0, 0, 0, 2}) + bytes({0x2a, 0x01, 'a'}) + tag,
+            output);
+}
+
+} // namespace Zipkin
+} // namespace Envoy
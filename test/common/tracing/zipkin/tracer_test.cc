@@ -297,5 +297,32 @@ TEST(ZipkinTracerTest, finishSpan) {
   endpoint = ann.endpoint();
   EXPECT_EQ("my_service_name", endpoint.serviceName());
 }
+
+TEST(ZipkinTracerTest, internTagKeys) {
+  NiceMock<Runtime::MockRandomGenerator> random_generator;
+  Tracer tracer("my_service_name", nullptr, random_generator);
+
+  const std::string* key = tracer.internTagKey("upstream_cluster");
+  ASSERT_NE(nullptr, key);
+  EXPECT_EQ("upstream_cluster", *key);
+  EXPECT_EQ(key, tracer.internTagKey(std::string("upstream_cluster")));
+
+  // Spans of the tracer refer to the interned key.
+  NiceMock<Tracing::MockConfig> config;
+  SpanPtr span = tracer.startSpan(config, "my_span", SystemTime());
+  span->setTag("upstream_cluster", "cluster");
+  EXPECT_EQ(key, &span->binaryAnnotations()[0].key());
+  EXPECT_EQ("cluster", span->binaryAnnotations()[0].value());
+
+  // Keys beyond the limit are copied into the spans.
+  for (size_t i = 1; i < Tracer::MAX_INTERNED_TAG_KEYS; i++) {
+    EXPECT_NE(nullptr, tracer.internTagKey(std::to_string(i)));
+  }
+  EXPECT_EQ(nullptr, tracer.internTagKey("one_too_many"));
+  EXPECT_EQ(key, tracer.internTagKey("upstream_cluster"));
+  span->setTag("one_too_many", "value");
+  EXPECT_EQ("one_too_many", span->binaryAnnotations()[1].key());
+}
+
 } // namespace Zipkin
 } // namespace Envoy
@@ -111,6 +111,22 @@ TEST_F(ZipkinDriverTest, InitializeDriver) {
     EXPECT_THROW(setup(*loader, false), EnvoyException);
   }
 
+  {
+    // Unknown collector endpoint version.
+    EXPECT_CALL(cm_, get("fake_cluster")).WillOnce(Return(&cm_.thread_local_cluster_));
+
+    std::string invalid_config = R"EOF(
+      {
+       "collector_cluster": "fake_cluster",
+       "collector_endpoint_version": "HTTP_THRIFT"
+       }
+    )EOF";
+    Json::ObjectSharedPtr loader = Json::Factory::loadFromString(invalid_config);
+
+    EXPECT_THROW_WITH_MESSAGE(setup(*loader, false), EnvoyException,
+                              "unknown zipkin collector endpoint version HTTP_THRIFT");
+  }
+
   {
     // valid config
     EXPECT_CALL(cm_, get("fake_cluster")).WillRepeatedly(Return(&cm_.thread_local_cluster_));
@@ -177,6 +193,66 @@ TEST_F(ZipkinDriverTest, FlushSeveralSpans) {
   EXPECT_EQ(1U, stats_.counter("tracing.zipkin.reports_failed").value());
 }
 
+TEST_F(ZipkinDriverTest, FlushSpansProto) {
+  EXPECT_CALL(cm_, get("fake_cluster")).WillRepeatedly(Return(&cm_.thread_local_cluster_));
+  std::string proto_config = R"EOF(
+    {
+     "collector_cluster": "fake_cluster",
+     "collector_endpoint_version": "HTTP_PROTO"
+     }
+  )EOF";
+  Json::ObjectSharedPtr loader = Json::Factory::loadFromString(proto_config);
+  setup(*loader, true);
+
+  Http::MockAsyncClientRequest request(&cm_.async_client_);
+  const Optional<std::chrono::milliseconds> timeout(std::chrono::seconds(5));
+  EXPECT_CALL(cm_.async_client_, send_(_, _, timeout))
+      .WillOnce(
+          Invoke([&](Http::MessagePtr& message, Http::AsyncClient::Callbacks&,
+                     const Optional<std::chrono::milliseconds>&) -> Http::AsyncClient::Request* {
+            EXPECT_STREQ("/api/v2/spans", message->headers().Path()->value().c_str());
+            EXPECT_STREQ("application/x-protobuf",
+                         message->headers().ContentType()->value().c_str());
+            // Each span is an entry of the spans field of a ListOfSpans.
+            const std::string body = TestUtility::bufferToString(*message->body());
+            EXPECT_EQ('\x0a', body[0]);
+
+            return &request;
+          }));
+  EXPECT_CALL(runtime_.snapshot_, getInteger("tracing.zipkin.min_flush_spans", 5))
+      .WillOnce(Return(1));
+
+  Tracing::SpanPtr span =
+      driver_->startSpan(config_, request_headers_, operation_name_, start_time_);
+  span->finishSpan();
+
+  EXPECT_EQ(1U, stats_.counter("tracing.zipkin.spans_sent").value());
+}
+
+TEST_F(ZipkinDriverTest, FlushSpansBySize) {
+  setupValidDriver();
+
+  EXPECT_CALL(cm_.async_client_, send_(_, _, _)).Times(0);
+  EXPECT_CALL(runtime_.snapshot_, getInteger("tracing.zipkin.min_flush_bytes", 64 * 1024U))
+      .WillOnce(Return(64 * 1024U));
+
+  Tracing::SpanPtr first_span =
+      driver_->startSpan(config_, request_headers_, operation_name_, start_time_);
+  first_span->finishSpan();
+
+  // The second span is flushed with the first one once the buffered spans reach the size.
+  Http::MockAsyncClientRequest request(&cm_.async_client_);
+  EXPECT_CALL(cm_.async_client_, send_(_, _, _)).WillOnce(Return(&request));
+  EXPECT_CALL(runtime_.snapshot_, getInteger("tracing.zipkin.min_flush_bytes", 64 * 1024U))
+      .WillOnce(Return(1));
+
+  Tracing::SpanPtr second_span =
+      driver_->startSpan(config_, request_headers_, operation_name_, start_time_);
+  second_span->finishSpan();
+
+  EXPECT_EQ(2U, stats_.counter("tracing.zipkin.spans_sent").value());
+}
+
 TEST_F(ZipkinDriverTest, FlushOneSpanReportFailure) {
   setupValidDriver();
 
@@ -9,6 +9,7 @@
 
 #include "test/common/upstream/utility.h"
 #include "test/mocks/local_info/mocks.h"
+#include "test/mocks/thread_local/mocks.h"
 #include "test/mocks/upstream/mocks.h"
 #include "test/test_common/printers.h"
 #include "test/test_common/utility.h"
@@ -54,7 +55,8 @@ public:
     EXPECT_CALL(cluster, info());
     EXPECT_CALL(*cluster.info_, type());
     cds_ =
-        CdsApiImpl::create(cds_config, eds_config_, cm_, dispatcher_, random_, local_info_, store_);
+        CdsApiImpl::create(cds_config, eds_config_, cm_, dispatcher_, tls_, random_, local_info_,
+                           store_);
     cds_->setInitializedCb([this]() -> void { initialized_.ready(); });
 
     expectRequest();
@@ -97,6 +99,7 @@ public:
   bool v2_rest_{};
   NiceMock<MockClusterManager> cm_;
   NiceMock<Event::MockDispatcher> dispatcher_;
+  NiceMock<ThreadLocal::MockInstance> tls_;
   NiceMock<Runtime::MockRandomGenerator> random_;
   NiceMock<LocalInfo::MockLocalInfo> local_info_;
   Stats::IsolatedStoreImpl store_;
@@ -122,6 +125,27 @@ TEST_F(CdsApiImplTest, ValidateFail) {
   EXPECT_CALL(request_, cancel());
 }
 
+// Incremental updates only add the clusters sent and remove the ones named.
+TEST_F(CdsApiImplTest, IncrementalUpdate) {
+  InSequence s;
+
+  setup(true);
+
+  Protobuf::RepeatedPtrField<envoy::api::v2::Cluster> clusters;
+  clusters.Add()->CopyFrom(defaultStaticCluster("cluster1"));
+  EXPECT_CALL(cm_, clusters()).Times(0);
+  EXPECT_CALL(tls_, beginBatch());
+  expectAdd("cluster1");
+  EXPECT_CALL(cm_, removePrimaryCluster("cluster2")).WillOnce(Return(true));
+  EXPECT_CALL(tls_, endBatch());
+  EXPECT_CALL(initialized_, ready());
+  CdsApiImpl* cds = dynamic_cast<CdsApiImpl*>(cds_.get());
+  EXPECT_TRUE(cds->supportsIncrementalUpdates());
+  cds->onIncrementalConfigUpdate(clusters, {"cluster2"});
+
+  EXPECT_CALL(request_, cancel());
+}
+
 TEST_F(CdsApiImplTest, InvalidOptions) {
   const std::string config_json = R"EOF(
   {
@@ -137,7 +161,8 @@ TEST_F(CdsApiImplTest, InvalidOptions) {
   envoy::api::v2::ConfigSource cds_config;
   Config::Utility::translateCdsConfig(*config, cds_config);
   EXPECT_THROW(
-      CdsApiImpl::create(cds_config, eds_config_, cm_, dispatcher_, random_, local_info_, store_),
+      CdsApiImpl::create(cds_config, eds_config_, cm_, dispatcher_, tls_, random_, local_info_,
+                           store_),
       EnvoyException);
 }
 
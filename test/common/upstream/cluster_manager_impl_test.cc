@@ -1,13 +1,17 @@
 #include <memory>
 #include <string>
+#include <unordered_set>
+#include <vector>
 
 #include "envoy/upstream/upstream.h"
 
+#include "common/common/hash.h"
 #include "common/config/bootstrap_json.h"
 #include "common/config/utility.h"
 #include "common/network/utility.h"
 #include "common/ssl/context_manager_impl.h"
 #include "common/stats/stats_impl.h"
+#include "common/stats/thread_local_store.h"
 #include "common/upstream/cluster_manager_impl.h"
 
 #include "test/common/upstream/utility.h"
@@ -92,6 +96,8 @@ public:
                                 Outlier::EventLoggerSharedPtr outlier_event_logger,
                                 bool added_via_api));
   MOCK_METHOD0(createCds_, CdsApi*());
+  MOCK_METHOD3(prepareClusters, void(const std::vector<const envoy::api::v2::Cluster*>& clusters,
+                                     ClusterManager& cm, bool added_via_api));
 
   Stats::IsolatedStoreImpl stats_;
   NiceMock<ThreadLocal::MockInstance> tls_;
@@ -480,6 +486,30 @@ TEST_F(ClusterManagerImplTest, RingHashLoadBalancerThreadAwareUpdate) {
             cluster_manager_->get("cluster_0")->loadBalancer().chooseHost(nullptr));
 }
 
+TEST_F(ClusterManagerImplTest, MaglevLoadBalancerThreadAwareUpdate) {
+  const std::string json =
+      fmt::sprintf("{%s}", clustersJson({defaultStaticClusterJson("cluster_0")}));
+
+  std::shared_ptr<MockCluster> cluster1(new NiceMock<MockCluster>());
+  cluster1->info_->name_ = "cluster_0";
+  cluster1->info_->lb_type_ = LoadBalancerType::Maglev;
+
+  InSequence s;
+  EXPECT_CALL(factory_, clusterFromProto_(_, _, _, _)).WillOnce(Return(cluster1));
+  ON_CALL(*cluster1, initializePhase()).WillByDefault(Return(Cluster::InitializePhase::Primary));
+  create(parseBootstrapFromJson(json));
+
+  EXPECT_EQ(nullptr, cluster_manager_->get("cluster_0")->loadBalancer().chooseHost(nullptr));
+
+  cluster1->prioritySet().getMockHostSet(0)->hosts_ = {
+      makeTestHost(cluster1->info_, "tcp://127.0.0.1:80")};
+  cluster1->prioritySet().getMockHostSet(0)->runCallbacks(
+      cluster1->prioritySet().getMockHostSet(0)->hosts_, {});
+  cluster1->initialize_callback_();
+  EXPECT_EQ(cluster1->prioritySet().getMockHostSet(0)->hosts_[0],
+            cluster_manager_->get("cluster_0")->loadBalancer().chooseHost(nullptr));
+}
+
 TEST_F(ClusterManagerImplTest, TcpHealthChecker) {
   const std::string json = R"EOF(
   {
@@ -610,6 +640,24 @@ TEST_F(ClusterManagerImplTest, ShutdownOrder) {
   EXPECT_EQ(3U, cluster.info().use_count());
 }
 
+// Thread local host sets share the immutable host lists of the primary host set.
+TEST_F(ClusterManagerImplTest, ThreadLocalHostListsShared) {
+  const std::string json =
+      fmt::sprintf("{%s}", clustersJson({defaultStaticClusterJson("cluster_1")}));
+
+  create(parseBootstrapFromJson(json));
+  const Cluster& cluster = cluster_manager_->clusters().begin()->second;
+  const HostSet& primary_host_set = *cluster.prioritySet().hostSetsPerPriority()[0];
+  const HostSet& local_host_set =
+      *cluster_manager_->get("cluster_1")->prioritySet().hostSetsPerPriority()[0];
+  EXPECT_EQ(1UL, local_host_set.hosts().size());
+  EXPECT_EQ(primary_host_set.hostsPtr(), local_host_set.hostsPtr());
+  EXPECT_EQ(primary_host_set.healthyHostsPtr(), local_host_set.healthyHostsPtr());
+  EXPECT_EQ(primary_host_set.hostsPerLocalityPtr(), local_host_set.hostsPerLocalityPtr());
+  EXPECT_EQ(primary_host_set.healthyHostsPerLocalityPtr(),
+            local_host_set.healthyHostsPerLocalityPtr());
+}
+
 TEST_F(ClusterManagerImplTest, InitializeOrder) {
   const std::string json = fmt::sprintf(
       R"EOF(
@@ -821,6 +869,93 @@ TEST_F(ClusterManagerImplTest, DynamicAddRemove) {
   EXPECT_TRUE(Mock::VerifyAndClearExpectations(cluster2.get()));
 }
 
+// The static clusters are prepared as a batch before any of them is loaded.
+TEST_F(ClusterManagerImplTest, PrepareStaticClusters) {
+  const std::string json = fmt::sprintf(
+      "{%s}", clustersJson({defaultStaticClusterJson("cluster_0"),
+                            defaultStaticClusterJson("cluster_1")}));
+
+  EXPECT_CALL(factory_, prepareClusters(_, _, false))
+      .WillOnce(Invoke([](const std::vector<const envoy::api::v2::Cluster*>& clusters,
+                          ClusterManager&, bool) -> void {
+        ASSERT_EQ(2UL, clusters.size());
+        EXPECT_EQ("cluster_0", clusters[0]->name());
+        EXPECT_EQ("cluster_1", clusters[1]->name());
+      }));
+  create(parseBootstrapFromJson(json));
+}
+
+// Only the clusters that addOrUpdatePrimaryCluster() would build are prepared.
+TEST_F(ClusterManagerImplTest, PrepareChangedClusters) {
+  const std::string json =
+      fmt::sprintf("{%s}", clustersJson({defaultStaticClusterJson("static_cluster")}));
+  create(parseBootstrapFromJson(json));
+
+  std::shared_ptr<MockCluster> cluster1(new NiceMock<MockCluster>());
+  EXPECT_CALL(factory_, clusterFromProto_(_, _, _, _)).WillOnce(Return(cluster1));
+  EXPECT_TRUE(cluster_manager_->addOrUpdatePrimaryCluster(defaultStaticCluster("fake_cluster")));
+
+  const envoy::api::v2::Cluster static_cluster = defaultStaticCluster("static_cluster");
+  const envoy::api::v2::Cluster unchanged_cluster = defaultStaticCluster("fake_cluster");
+  envoy::api::v2::Cluster changed_cluster = defaultStaticCluster("fake_cluster");
+  changed_cluster.mutable_per_connection_buffer_limit_bytes()->set_value(12345);
+  const envoy::api::v2::Cluster new_cluster = defaultStaticCluster("new_cluster");
+
+  EXPECT_CALL(factory_, prepareClusters(_, _, true))
+      .WillOnce(Invoke([&](const std::vector<const envoy::api::v2::Cluster*>& clusters,
+                           ClusterManager&, bool) -> void {
+        EXPECT_EQ(std::vector<const envoy::api::v2::Cluster*>({&changed_cluster, &new_cluster}),
+                  clusters);
+      }));
+  cluster_manager_->prepareClusters(
+      {&static_cluster, &unchanged_cluster, &changed_cluster, &new_cluster});
+}
+
+TEST_F(ClusterManagerImplTest, ClusterHandle) {
+  const std::string json =
+      fmt::sprintf("{%s}", clustersJson({defaultStaticClusterJson("cluster_1")}));
+  create(parseBootstrapFromJson(json));
+
+  ClusterHandlePtr static_handle = cluster_manager_->clusterHandle("cluster_1");
+  EXPECT_EQ(cluster_manager_->get("cluster_1"), static_handle->get());
+
+  // A handle can be resolved before the cluster exists.
+  ClusterHandlePtr dynamic_handle = cluster_manager_->clusterHandle("fake_cluster");
+  EXPECT_EQ(nullptr, dynamic_handle->get());
+
+  std::shared_ptr<MockCluster> cluster1(new NiceMock<MockCluster>());
+  EXPECT_CALL(factory_, clusterFromProto_(_, _, _, _)).WillOnce(Return(cluster1));
+  EXPECT_TRUE(cluster_manager_->addOrUpdatePrimaryCluster(defaultStaticCluster("fake_cluster")));
+  ASSERT_NE(nullptr, dynamic_handle->get());
+  EXPECT_EQ(cluster1->info_, dynamic_handle->get()->info());
+
+  // The handle follows updates of the cluster.
+  auto update_cluster = defaultStaticCluster("fake_cluster");
+  update_cluster.mutable_per_connection_buffer_limit_bytes()->set_value(12345);
+  std::shared_ptr<MockCluster> cluster2(new NiceMock<MockCluster>());
+  cluster2->prioritySet().getMockHostSet(0)->hosts_ = {
+      makeTestHost(cluster2->info_, "tcp://127.0.0.1:80")};
+  EXPECT_CALL(factory_, clusterFromProto_(_, _, _, _)).WillOnce(Return(cluster2));
+  EXPECT_TRUE(cluster_manager_->addOrUpdatePrimaryCluster(update_cluster));
+  EXPECT_EQ(cluster2->info_, dynamic_handle->get()->info());
+  EXPECT_EQ(cluster_manager_->get("fake_cluster"), dynamic_handle->get());
+
+  Http::ConnectionPool::MockInstance* cp = new Http::ConnectionPool::MockInstance();
+  EXPECT_CALL(factory_, allocateConnPool_(_)).WillOnce(Return(cp));
+  EXPECT_EQ(cp, dynamic_handle->get()->httpConnPool(ResourcePriority::Default,
+                                                    Http::Protocol::Http11, nullptr));
+
+  Http::ConnectionPool::Instance::DrainedCb drained_cb;
+  EXPECT_CALL(*cp, addDrainedCallback(_)).WillOnce(SaveArg<0>(&drained_cb));
+  EXPECT_TRUE(cluster_manager_->removePrimaryCluster("fake_cluster"));
+  EXPECT_EQ(nullptr, dynamic_handle->get());
+  EXPECT_EQ(cluster_manager_->get("cluster_1"), static_handle->get());
+  drained_cb();
+
+  EXPECT_TRUE(Mock::VerifyAndClearExpectations(cluster1.get()));
+  EXPECT_TRUE(Mock::VerifyAndClearExpectations(cluster2.get()));
+}
+
 TEST_F(ClusterManagerImplTest, AddOrUpdatePrimaryClusterStaticExists) {
   const std::string json =
       fmt::sprintf("{%s}", clustersJson({defaultStaticClusterJson("some_cluster")}));
@@ -906,6 +1041,73 @@ TEST_F(ClusterManagerImplTest, CloseConnectionsOnHealthFailure) {
   EXPECT_TRUE(Mock::VerifyAndClearExpectations(cluster1.get()));
 }
 
+// Test that the connection pools of the hosts are warmed up when a cluster asks for prefetching.
+TEST_F(ClusterManagerImplTest, PrefetchConnPools) {
+  const std::string yaml = R"EOF(
+  static_resources:
+    clusters:
+    - name: cluster_1
+      connect_timeout: 0.250s
+      lb_policy: ROUND_ROBIN
+      hosts:
+      - socket_address:
+          address: 127.0.0.1
+          port_value: 11001
+      metadata:
+        filter_metadata:
+          envoy.lb:
+            prefetch_ratio: 1.5
+  )EOF";
+
+  Http::ConnectionPool::MockInstance* cp = new Http::ConnectionPool::MockInstance();
+  EXPECT_CALL(factory_, allocateConnPool_(_)).WillOnce(Return(cp));
+  EXPECT_CALL(*cp, prefetch());
+  create(parseBootstrapFromV2Yaml(yaml));
+  EXPECT_DOUBLE_EQ(1.5, cluster_manager_->get("cluster_1")->info()->prefetchRatio());
+
+  // Requests use the pool that has been warmed up.
+  EXPECT_EQ(cp, cluster_manager_->httpConnPoolForCluster("cluster_1", ResourcePriority::Default,
+                                                         Http::Protocol::Http11, nullptr));
+}
+
+// Test that a worker only load balances over its subset of the hosts of a cluster with worker
+// subsets.
+TEST_F(ClusterManagerImplTest, WorkerSubsets) {
+  std::string yaml = R"EOF(
+  static_resources:
+    clusters:
+    - name: cluster_1
+      connect_timeout: 0.250s
+      lb_policy: ROUND_ROBIN
+      metadata:
+        filter_metadata:
+          envoy.lb:
+            worker_subsets: 2
+      hosts:
+  )EOF";
+  for (uint32_t port = 11001; port <= 11008; port++) {
+    yaml += fmt::format("      - socket_address: {{ address: 127.0.0.1, port_value: {} }}\n", port);
+  }
+  create(parseBootstrapFromV2Yaml(yaml));
+
+  // The only thread local cluster manager of the test has the first worker index.
+  const HostSet& primary_host_set =
+      *cluster_manager_->clusters().at("cluster_1").get().prioritySet().hostSetsPerPriority()[0];
+  std::vector<HostSharedPtr> expected_hosts;
+  for (const HostSharedPtr& host : primary_host_set.hosts()) {
+    if (HashUtil::xxHash64(host->address()->asString()) % 2 == 0) {
+      expected_hosts.push_back(host);
+    }
+  }
+  ASSERT_FALSE(expected_hosts.empty());
+  ASSERT_LT(expected_hosts.size(), primary_host_set.hosts().size());
+
+  const HostSet& host_set =
+      *cluster_manager_->get("cluster_1")->prioritySet().hostSetsPerPriority()[0];
+  EXPECT_EQ(expected_hosts, host_set.hosts());
+  EXPECT_EQ(expected_hosts, host_set.healthyHosts());
+}
+
 TEST_F(ClusterManagerImplTest, DynamicHostRemove) {
   const std::string json = R"EOF(
   {
@@ -1216,6 +1418,55 @@ TEST_F(ClusterManagerInitHelperTest, RemoveClusterWithinInitLoop) {
   init_helper_.onStaticLoadComplete();
 }
 
+// Clusters are prepared on several threads, and a prepared cluster is only used for the same
+// config.
+TEST(ProdClusterManagerFactoryTest, PrepareClusters) {
+  Stats::HeapRawStatDataAllocator alloc;
+  Stats::ThreadLocalStoreImpl stats(alloc);
+  NiceMock<Runtime::MockLoader> runtime;
+  NiceMock<ThreadLocal::MockInstance> tls;
+  NiceMock<Runtime::MockRandomGenerator> random;
+  std::shared_ptr<NiceMock<Network::MockDnsResolver>> dns_resolver{
+      new NiceMock<Network::MockDnsResolver>};
+  Ssl::ContextManagerImpl ssl_context_manager{runtime};
+  NiceMock<Event::MockDispatcher> dispatcher;
+  NiceMock<LocalInfo::MockLocalInfo> local_info;
+  NiceMock<MockClusterManager> cm;
+  ProdClusterManagerFactory factory(runtime, stats, tls, random, dns_resolver, ssl_context_manager,
+                                    dispatcher, local_info);
+
+  ON_CALL(runtime.snapshot_, getInteger("upstream.cluster_init_concurrency", _))
+      .WillByDefault(Return(4));
+  std::vector<envoy::api::v2::Cluster> configs;
+  for (uint32_t i = 0; i < 8; i++) {
+    configs.push_back(defaultStaticCluster(fmt::format("cluster_{}", i)));
+  }
+  std::vector<const envoy::api::v2::Cluster*> clusters;
+  for (const envoy::api::v2::Cluster& config : configs) {
+    clusters.push_back(&config);
+  }
+  factory.prepareClusters(clusters, cm, false);
+
+  // The stats of every cluster exist before any cluster is built.
+  std::unordered_set<std::string> counters;
+  for (const Stats::CounterSharedPtr& counter : stats.counters()) {
+    counters.insert(counter->name());
+  }
+  for (uint32_t i = 0; i < 8; i++) {
+    EXPECT_EQ(1UL, counters.count(fmt::format("cluster.cluster_{}.upstream_cx_total", i)));
+  }
+
+  ClusterSharedPtr cluster = factory.clusterFromProto(configs[0], cm, nullptr, false);
+  EXPECT_EQ("cluster_0", cluster->info()->name());
+
+  // A cluster whose config changed since it was prepared is built from its new config.
+  configs[1].mutable_connect_timeout()->set_seconds(5);
+  ClusterSharedPtr changed_cluster = factory.clusterFromProto(configs[1], cm, nullptr, false);
+  EXPECT_EQ(std::chrono::milliseconds(5000), changed_cluster->info()->connectTimeout());
+
+  stats.shutdownThreading();
+}
+
 } // namespace
 } // namespace Upstream
 } // namespace Envoy
@@ -0,0 +1,79 @@
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "common/upstream/edf_scheduler.h"
+
+#include "gtest/gtest.h"
+
+namespace Envoy {
+namespace Upstream {
+
+TEST(EdfSchedulerTest, Empty) {
+  EdfScheduler<uint32_t> sched;
+  EXPECT_TRUE(sched.empty());
+  EXPECT_EQ(nullptr, sched.pick());
+}
+
+// Picks of equally weighted entries cycle through them in the order they were added.
+TEST(EdfSchedulerTest, Unweighted) {
+  EdfScheduler<uint32_t> sched;
+  std::vector<std::shared_ptr<uint32_t>> entries;
+  for (uint32_t i = 0; i < 4; ++i) {
+    entries.push_back(std::make_shared<uint32_t>(i));
+    sched.add(1, entries.back());
+  }
+  EXPECT_FALSE(sched.empty());
+
+  for (uint32_t rounds = 0; rounds < 3; ++rounds) {
+    for (uint32_t i = 0; i < 4; ++i) {
+      auto entry = sched.pick();
+      EXPECT_EQ(i, *entry);
+      sched.add(1, entry);
+    }
+  }
+}
+
+// Entries are picked in proportion to their weights, with the picks of the heavier entry spread
+// between those of the lighter one.
+TEST(EdfSchedulerTest, Weighted) {
+  EdfScheduler<uint32_t> sched;
+  const std::vector<double> weights{1, 4};
+  sched.add(weights[0], std::make_shared<uint32_t>(0));
+  sched.add(weights[1], std::make_shared<uint32_t>(1));
+
+  std::vector<uint32_t> picks;
+  std::vector<uint32_t> counts(2);
+  for (uint32_t i = 0; i < 100; ++i) {
+    auto entry = sched.pick();
+    picks.push_back(*entry);
+    counts[*entry]++;
+    sched.add(weights[*entry], entry);
+  }
+  EXPECT_EQ(std::vector<uint32_t>({1, 1, 1, 0, 1, 1, 1, 1, 0, 1}),
+            std::vector<uint32_t>(picks.begin(), picks.begin() + 10));
+  EXPECT_EQ(20U, counts[0]);
+  EXPECT_EQ(80U, counts[1]);
+}
+
+// An entry added back with a lower weight is scheduled later.
+TEST(EdfSchedulerTest, ChangedWeight) {
+  EdfScheduler<uint32_t> sched;
+  auto entry0 = std::make_shared<uint32_t>(0);
+  auto entry1 = std::make_shared<uint32_t>(1);
+  sched.add(1, entry0);
+  sched.add(1, entry1);
+
+  EXPECT_EQ(entry0, sched.pick());
+  sched.add(0.25, entry0);
+  for (uint32_t i = 0; i < 3; ++i) {
+    EXPECT_EQ(entry1, sched.pick());
+    sched.add(1, entry1);
+  }
+  EXPECT_EQ(entry1, sched.pick());
+  sched.add(1, entry1);
+  EXPECT_EQ(entry0, sched.pick());
+}
+
+} // namespace Upstream
+} // namespace Envoy
@@ -40,6 +40,10 @@ protected:
     eds_config.mutable_api_config_source()->mutable_refresh_delay()->set_seconds(1);
     local_info_.node_.mutable_locality()->set_zone("us-east-1a");
     eds_cluster_ = parseSdsClusterFromJson(json_config, eds_config);
+    createCluster();
+  }
+
+  void createCluster() {
     Upstream::ClusterManager::ClusterInfoMap cluster_map;
     Upstream::MockCluster cluster;
     cluster_map.emplace("eds", cluster);
@@ -188,6 +192,60 @@ TEST_F(EdsTest, EndpointMetadata) {
   EXPECT_TRUE(hosts[1]->canary());
 }
 
+// Validate that updates within the merge window are held back, and only the latest is applied when
+// the window closes.
+TEST_F(EdsTest, UpdateMergeWindow) {
+  Config::Metadata::mutableMetadataValue(*eds_cluster_.mutable_metadata(),
+                                         Config::MetadataFilters::get().ENVOY_LB,
+                                         Config::MetadataEnvoyLbKeys::get().UPDATE_MERGE_WINDOW_MS)
+      .set_number_value(1000);
+  Event::MockTimer* merge_timer = new Event::MockTimer(&dispatcher_);
+  createCluster();
+
+  auto update = [this](uint32_t num_hosts) {
+    Protobuf::RepeatedPtrField<envoy::api::v2::ClusterLoadAssignment> resources;
+    auto* cluster_load_assignment = resources.Add();
+    cluster_load_assignment->set_cluster_name("fare");
+    auto* endpoints = cluster_load_assignment->add_endpoints();
+    for (uint32_t i = 0; i < num_hosts; i++) {
+      auto* socket_address = endpoints->add_lb_endpoints()
+                                 ->mutable_endpoint()
+                                 ->mutable_address()
+                                 ->mutable_socket_address();
+      socket_address->set_address("1.2.3.4");
+      socket_address->set_port_value(80 + i);
+    }
+    VERBOSE_EXPECT_NO_THROW(cluster_->onConfigUpdate(resources));
+  };
+  auto num_hosts = [this]() -> size_t {
+    return cluster_->prioritySet().hostSetsPerPriority()[0]->hosts().size();
+  };
+
+  // The first update is applied right away and opens the window.
+  bool initialized = false;
+  cluster_->initialize([&initialized] { initialized = true; });
+  EXPECT_CALL(*merge_timer, enableTimer(std::chrono::milliseconds(1000)));
+  update(1);
+  EXPECT_TRUE(initialized);
+  EXPECT_EQ(1UL, num_hosts());
+
+  update(2);
+  update(3);
+  EXPECT_EQ(1UL, num_hosts());
+  EXPECT_EQ(2UL, stats_.counter("cluster.name.update_merged").value());
+
+  // Closing the window applies the latest update and opens the next window.
+  EXPECT_CALL(*merge_timer, enableTimer(std::chrono::milliseconds(1000)));
+  merge_timer->callback_();
+  EXPECT_EQ(3UL, num_hosts());
+
+  // Nothing was held back in the second window.
+  merge_timer->callback_();
+  EXPECT_CALL(*merge_timer, enableTimer(std::chrono::milliseconds(1000)));
+  update(2);
+  EXPECT_EQ(2UL, num_hosts());
+}
+
 // Validate that onConfigUpdate() updates the endpoint locality.
 TEST_F(EdsTest, EndpointLocality) {
   Protobuf::RepeatedPtrField<envoy::api::v2::ClusterLoadAssignment> resources;
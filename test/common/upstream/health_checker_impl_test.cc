@@ -4,7 +4,11 @@
 #include <vector>
 
 #include "common/buffer/buffer_impl.h"
+#include "common/buffer/zero_copy_input_stream_impl.h"
+#include "common/common/hash.h"
 #include "common/config/cds_json.h"
+#include "common/grpc/codec.h"
+#include "common/grpc/common.h"
 #include "common/http/headers.h"
 #include "common/json/json_loader.h"
 #include "common/network/utility.h"
@@ -21,6 +25,7 @@
 #include "test/test_common/printers.h"
 #include "test/test_common/utility.h"
 
+#include "fmt/format.h"
 #include "gmock/gmock.h"
 #include "gtest/gtest.h"
 
@@ -68,6 +73,28 @@ TEST(HealthCheckerFactoryTest, createRedis) {
                              .get()));
 }
 
+TEST(HealthCheckerFactoryTest, createGrpc) {
+  std::string json = R"EOF(
+  {
+    "type": "http",
+    "timeout_ms": 1000,
+    "interval_ms": 1000,
+    "unhealthy_threshold": 1,
+    "healthy_threshold": 1,
+    "path": "/grpc.health.v1.Health/Check"
+  }
+  )EOF";
+
+  NiceMock<Upstream::MockCluster> cluster;
+  Runtime::MockLoader runtime;
+  Runtime::MockRandomGenerator random;
+  Event::MockDispatcher dispatcher;
+  EXPECT_NE(nullptr, dynamic_cast<GrpcHealthCheckerImpl*>(
+                         HealthCheckerFactory::create(parseHealthCheckFromJson(json), cluster,
+                                                      runtime, random, dispatcher)
+                             .get()));
+}
+
 // TODO(htuch): This provides coverage on MissingFieldException and missing health check type
 // handling for HealthCheck construction, but should eventually be subsumed by whatever we do for
 // #1308.
@@ -311,6 +338,53 @@ TEST_F(HttpHealthCheckerImplTest, SuccessWithMultipleHosts) {
   EXPECT_TRUE(cluster_->prioritySet().getMockHostSet(0)->hosts_[1]->healthy());
 }
 
+// With health check partitions, only the hosts of the partition of this Envoy are probed, and the
+// other hosts are reported healthy.
+TEST_F(HttpHealthCheckerImplTest, Partitions) {
+  cluster_->info_->health_check_partitions_ = 2;
+  // The random generator returns 0, so this Envoy probes partition 0.
+  setupNoServiceValidationHC();
+
+  HostSharedPtr probed_host;
+  HostSharedPtr unprobed_host;
+  for (uint32_t port = 80; probed_host == nullptr || unprobed_host == nullptr; port++) {
+    HostSharedPtr host = makeTestHost(cluster_->info_, fmt::format("tcp://127.0.0.1:{}", port));
+    HostSharedPtr& partition_host =
+        HashUtil::xxHash64(host->address()->asString()) % 2 == 0 ? probed_host : unprobed_host;
+    if (partition_host == nullptr) {
+      partition_host = host;
+    }
+  }
+  probed_host->healthFlagSet(Host::HealthFlag::FAILED_ACTIVE_HC);
+  unprobed_host->healthFlagSet(Host::HealthFlag::FAILED_ACTIVE_HC);
+  cluster_->prioritySet().getMockHostSet(0)->hosts_ = {probed_host, unprobed_host};
+  cluster_->info_->stats().upstream_cx_total_.inc();
+  expectSessionCreate();
+  expectStreamCreate(0);
+  EXPECT_CALL(*test_sessions_[0]->timeout_timer_, enableTimer(_));
+  expectSessionCreate();
+  EXPECT_CALL(*test_sessions_[1]->interval_timer_, enableTimer(std::chrono::milliseconds(0)));
+  health_checker_->start();
+
+  EXPECT_CALL(*this, onHostStatus(unprobed_host, true));
+  test_sessions_[1]->interval_timer_->callback_();
+  EXPECT_TRUE(unprobed_host->healthy());
+
+  // Passive failures of hosts that are not probed are ignored.
+  unprobed_host->healthChecker().setUnhealthy();
+  EXPECT_TRUE(unprobed_host->healthy());
+
+  EXPECT_CALL(*this, onHostStatus(probed_host, true));
+  EXPECT_CALL(*test_sessions_[0]->interval_timer_, enableTimer(_));
+  EXPECT_CALL(*test_sessions_[0]->timeout_timer_, disableTimer());
+  respond(0, "200", false, true);
+  EXPECT_TRUE(probed_host->healthy());
+
+  EXPECT_EQ(1UL, cluster_->info_->stats_store_.counter("health_check.attempt").value());
+  EXPECT_EQ(0UL, cluster_->info_->stats_store_.counter("health_check.passive_failure").value());
+  EXPECT_EQ(2UL, cluster_->info_->stats_store_.gauge("health_check.healthy").value());
+}
+
 // Test host check success with multiple hosts across multiple priorities.
 TEST_F(HttpHealthCheckerImplTest, SuccessWithMultipleHostSets) {
   setupNoServiceValidationHC();
@@ -574,6 +648,36 @@ TEST_F(HttpHealthCheckerImplTest, SuccessStartFailedFailFirst) {
   EXPECT_TRUE(cluster_->prioritySet().getMockHostSet(0)->hosts_[0]->healthy());
 }
 
+TEST_F(HttpHealthCheckerImplTest, SuccessStartFailedInheritedUnhealthy) {
+  setupNoServiceValidationHC();
+  cluster_->prioritySet().getMockHostSet(0)->hosts_ = {
+      makeTestHost(cluster_->info_, "tcp://127.0.0.1:80")};
+  cluster_->prioritySet().getMockHostSet(0)->hosts_[0]->healthFlagSet(
+      Host::HealthFlag::FAILED_ACTIVE_HC);
+  health_checker_->inheritUnhealthyHosts({"127.0.0.1:80"});
+  expectSessionCreate();
+  expectStreamCreate(0);
+  EXPECT_CALL(*test_sessions_[0]->timeout_timer_, enableTimer(_));
+  health_checker_->start();
+
+  // Test that a host the parent process found unhealthy does not take the fast success.
+  EXPECT_CALL(*this, onHostStatus(_, false));
+  EXPECT_CALL(*test_sessions_[0]->interval_timer_, enableTimer(_));
+  EXPECT_CALL(*test_sessions_[0]->timeout_timer_, disableTimer());
+  respond(0, "200", false);
+  EXPECT_FALSE(cluster_->prioritySet().getMockHostSet(0)->hosts_[0]->healthy());
+
+  EXPECT_CALL(*test_sessions_[0]->timeout_timer_, enableTimer(_));
+  expectStreamCreate(0);
+  test_sessions_[0]->interval_timer_->callback_();
+
+  EXPECT_CALL(*this, onHostStatus(_, true));
+  EXPECT_CALL(*test_sessions_[0]->interval_timer_, enableTimer(_));
+  EXPECT_CALL(*test_sessions_[0]->timeout_timer_, disableTimer());
+  respond(0, "200", false);
+  EXPECT_TRUE(cluster_->prioritySet().getMockHostSet(0)->hosts_[0]->healthy());
+}
+
 TEST_F(HttpHealthCheckerImplTest, HttpFail) {
   setupNoServiceValidationHC();
   cluster_->prioritySet().getMockHostSet(0)->hosts_ = {
@@ -816,6 +920,221 @@ TEST_F(HttpHealthCheckerImplTest, ConnectionReachesWatermarkDuringCheck) {
   EXPECT_TRUE(cluster_->prioritySet().getMockHostSet(0)->hosts_[0]->healthy());
 }
 
+class TestGrpcHealthCheckerImpl : public GrpcHealthCheckerImpl {
+public:
+  using GrpcHealthCheckerImpl::GrpcHealthCheckerImpl;
+
+  Http::CodecClient* createCodecClient(Upstream::Host::CreateConnectionData& conn_data) override {
+    return createCodecClient_(conn_data);
+  };
+
+  // GrpcHealthCheckerImpl
+  MOCK_METHOD1(createCodecClient_, Http::CodecClient*(Upstream::Host::CreateConnectionData&));
+};
+
+class GrpcHealthCheckerImplTest : public testing::Test {
+public:
+  GrpcHealthCheckerImplTest() : cluster_(new NiceMock<MockCluster>()) {}
+
+  void setup() {
+    std::string json = R"EOF(
+    {
+      "type": "http",
+      "timeout_ms": 1000,
+      "interval_ms": 1000,
+      "unhealthy_threshold": 2,
+      "healthy_threshold": 2,
+      "service_name": "locations",
+      "path": "/grpc.health.v1.Health/Check"
+    }
+    )EOF";
+
+    health_checker_.reset(new TestGrpcHealthCheckerImpl(*cluster_, parseHealthCheckFromJson(json),
+                                                        dispatcher_, runtime_, random_));
+    health_checker_->addHostCheckCompleteCb([this](HostSharedPtr host, bool changed_state) -> void {
+      onHostStatus(host, changed_state);
+    });
+
+    cluster_->prioritySet().getMockHostSet(0)->hosts_ = {
+        makeTestHost(cluster_->info_, "tcp://127.0.0.1:80")};
+    timeout_timer_ = new Event::MockTimer(&dispatcher_);
+    interval_timer_ = new Event::MockTimer(&dispatcher_);
+  }
+
+  void expectClientCreate() {
+    codec_ = new NiceMock<Http::MockClientConnection>();
+    client_connection_ = new NiceMock<Network::MockClientConnection>();
+    EXPECT_CALL(dispatcher_, createClientConnection_(_, _, _)).WillOnce(Return(client_connection_));
+    EXPECT_CALL(*health_checker_, createCodecClient_(_))
+        .WillOnce(
+            Invoke([&](Upstream::Host::CreateConnectionData& conn_data) -> Http::CodecClient* {
+              return new CodecClientForTest(std::move(conn_data.connection_), codec_, nullptr,
+                                            nullptr);
+            }));
+  }
+
+  void expectStreamCreate() {
+    request_encoder_.stream_.callbacks_.clear();
+    EXPECT_CALL(*codec_, newStream(_))
+        .WillOnce(DoAll(SaveArgAddress(&stream_response_callbacks_), ReturnRef(request_encoder_)));
+    EXPECT_CALL(request_encoder_, encodeHeaders(_, false))
+        .WillOnce(Invoke([](const Http::HeaderMap& headers, bool) -> void {
+          EXPECT_STREQ("POST", headers.Method()->value().c_str());
+          EXPECT_STREQ("/grpc.health.v1.Health/Check", headers.Path()->value().c_str());
+          EXPECT_STREQ("application/grpc", headers.ContentType()->value().c_str());
+        }));
+    EXPECT_CALL(request_encoder_, encodeData(_, true))
+        .WillOnce(Invoke([](Buffer::Instance& data, bool) -> void {
+          std::vector<Grpc::Frame> frames;
+          Grpc::Decoder decoder;
+          ASSERT_TRUE(decoder.decode(data, frames));
+          ASSERT_EQ(1U, frames.size());
+          grpc::health::v1::HealthCheckRequest request;
+          Buffer::ZeroCopyInputStreamImpl stream(std::move(frames[0].data_));
+          ASSERT_TRUE(request.ParseFromZeroCopyStream(&stream));
+          EXPECT_EQ("locations", request.service());
+        }));
+  }
+
+  void respond(grpc::health::v1::HealthCheckResponse::ServingStatus serving_status,
+               const std::string& grpc_status = "0") {
+    stream_response_callbacks_->decodeHeaders(
+        Http::HeaderMapPtr{new Http::TestHeaderMapImpl{{":status", "200"},
+                                                       {"content-type", "application/grpc"}}},
+        false);
+    grpc::health::v1::HealthCheckResponse response;
+    response.set_status(serving_status);
+    stream_response_callbacks_->decodeData(*Grpc::Common::serializeBody(response), false);
+    stream_response_callbacks_->decodeTrailers(
+        Http::HeaderMapPtr{new Http::TestHeaderMapImpl{{"grpc-status", grpc_status}}});
+  }
+
+  MOCK_METHOD2(onHostStatus, void(HostSharedPtr host, bool changed_state));
+
+  std::shared_ptr<MockCluster> cluster_;
+  NiceMock<Event::MockDispatcher> dispatcher_;
+  std::shared_ptr<TestGrpcHealthCheckerImpl> health_checker_;
+  NiceMock<Runtime::MockLoader> runtime_;
+  NiceMock<Runtime::MockRandomGenerator> random_;
+  Event::MockTimer* timeout_timer_{};
+  Event::MockTimer* interval_timer_{};
+  Http::MockClientConnection* codec_{};
+  Network::MockClientConnection* client_connection_{};
+  NiceMock<Http::MockStreamEncoder> request_encoder_;
+  Http::StreamDecoder* stream_response_callbacks_{};
+};
+
+// Probes that find the service serving succeed, and reuse the connection.
+TEST_F(GrpcHealthCheckerImplTest, Success) {
+  setup();
+  expectClientCreate();
+  expectStreamCreate();
+  EXPECT_CALL(*timeout_timer_, enableTimer(_));
+  health_checker_->start();
+
+  EXPECT_CALL(*this, onHostStatus(_, false));
+  EXPECT_CALL(*interval_timer_, enableTimer(_));
+  EXPECT_CALL(*timeout_timer_, disableTimer());
+  respond(grpc::health::v1::HealthCheckResponse::SERVING);
+  EXPECT_TRUE(cluster_->prioritySet().getMockHostSet(0)->hosts_[0]->healthy());
+
+  expectStreamCreate();
+  EXPECT_CALL(*timeout_timer_, enableTimer(_));
+  interval_timer_->callback_();
+
+  EXPECT_CALL(*this, onHostStatus(_, false));
+  EXPECT_CALL(*interval_timer_, enableTimer(_));
+  EXPECT_CALL(*timeout_timer_, disableTimer());
+  respond(grpc::health::v1::HealthCheckResponse::SERVING);
+  EXPECT_EQ(2UL, cluster_->info_->stats_store_.counter("health_check.success").value());
+}
+
+TEST_F(GrpcHealthCheckerImplTest, NotServing) {
+  setup();
+  expectClientCreate();
+  expectStreamCreate();
+  EXPECT_CALL(*timeout_timer_, enableTimer(_));
+  health_checker_->start();
+
+  EXPECT_CALL(*this, onHostStatus(_, true));
+  EXPECT_CALL(*interval_timer_, enableTimer(_));
+  EXPECT_CALL(*timeout_timer_, disableTimer());
+  respond(grpc::health::v1::HealthCheckResponse::NOT_SERVING);
+  EXPECT_FALSE(cluster_->prioritySet().getMockHostSet(0)->hosts_[0]->healthy());
+}
+
+TEST_F(GrpcHealthCheckerImplTest, GrpcError) {
+  setup();
+  expectClientCreate();
+  expectStreamCreate();
+  EXPECT_CALL(*timeout_timer_, enableTimer(_));
+  health_checker_->start();
+
+  EXPECT_CALL(*this, onHostStatus(_, true));
+  EXPECT_CALL(*interval_timer_, enableTimer(_));
+  EXPECT_CALL(*timeout_timer_, disableTimer());
+  respond(grpc::health::v1::HealthCheckResponse::SERVING, "14");
+  EXPECT_FALSE(cluster_->prioritySet().getMockHostSet(0)->hosts_[0]->healthy());
+}
+
+// A trailers only response carries the gRPC status in the headers.
+TEST_F(GrpcHealthCheckerImplTest, TrailersOnlyResponse) {
+  setup();
+  expectClientCreate();
+  expectStreamCreate();
+  EXPECT_CALL(*timeout_timer_, enableTimer(_));
+  health_checker_->start();
+
+  EXPECT_CALL(*this, onHostStatus(_, true));
+  EXPECT_CALL(*interval_timer_, enableTimer(_));
+  EXPECT_CALL(*timeout_timer_, disableTimer());
+  stream_response_callbacks_->decodeHeaders(
+      Http::HeaderMapPtr{new Http::TestHeaderMapImpl{
+          {":status", "200"}, {"content-type", "application/grpc"}, {"grpc-status", "12"}}},
+      true);
+  EXPECT_FALSE(cluster_->prioritySet().getMockHostSet(0)->hosts_[0]->healthy());
+}
+
+// Responses that do not follow the protocol fail the probe and close the connection.
+TEST_F(GrpcHealthCheckerImplTest, Non200Response) {
+  setup();
+  expectClientCreate();
+  expectStreamCreate();
+  EXPECT_CALL(*timeout_timer_, enableTimer(_));
+  health_checker_->start();
+
+  EXPECT_CALL(*this, onHostStatus(_, true));
+  EXPECT_CALL(*interval_timer_, enableTimer(_));
+  EXPECT_CALL(*timeout_timer_, disableTimer());
+  EXPECT_CALL(*client_connection_, close(_));
+  stream_response_callbacks_->decodeHeaders(
+      Http::HeaderMapPtr{new Http::TestHeaderMapImpl{{":status", "503"}}}, false);
+  EXPECT_FALSE(cluster_->prioritySet().getMockHostSet(0)->hosts_[0]->healthy());
+
+  // The next probe opens a new connection.
+  expectClientCreate();
+  expectStreamCreate();
+  EXPECT_CALL(*timeout_timer_, enableTimer(_));
+  interval_timer_->callback_();
+}
+
+TEST_F(GrpcHealthCheckerImplTest, Timeout) {
+  setup();
+  expectClientCreate();
+  expectStreamCreate();
+  EXPECT_CALL(*timeout_timer_, enableTimer(_));
+  health_checker_->start();
+
+  // The first network failure is below the unhealthy threshold.
+  EXPECT_CALL(*this, onHostStatus(_, false));
+  EXPECT_CALL(*client_connection_, close(_));
+  EXPECT_CALL(*interval_timer_, enableTimer(_));
+  EXPECT_CALL(*timeout_timer_, disableTimer());
+  timeout_timer_->callback_();
+  EXPECT_TRUE(cluster_->prioritySet().getMockHostSet(0)->hosts_[0]->healthy());
+  EXPECT_EQ(1UL, cluster_->info_->stats_store_.counter("health_check.network_failure").value());
+}
+
 TEST(TcpHealthCheckMatcher, loadJsonBytes) {
   {
     Protobuf::RepeatedPtrField<envoy::api::v2::HealthCheck::Payload> repeated_payload;
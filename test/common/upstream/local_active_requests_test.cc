@@ -0,0 +1,43 @@
+#include "common/common/thread.h"
+#include "common/upstream/local_active_requests.h"
+#include "common/upstream/upstream_impl.h"
+
+#include "test/common/upstream/utility.h"
+#include "test/mocks/upstream/mocks.h"
+
+#include "gtest/gtest.h"
+
+namespace Envoy {
+namespace Upstream {
+
+TEST(LocalActiveRequestsTest, All) {
+  ClusterInfoConstSharedPtr cluster{new MockClusterInfo()};
+  HostSharedPtr host1 = makeTestHost(cluster, "tcp://127.0.0.1:80");
+  HostSharedPtr host2 = makeTestHost(cluster, "tcp://127.0.0.1:81");
+  EXPECT_EQ(0U, LocalActiveRequests::value(*host1));
+
+  LocalActiveRequests::inc(*host1);
+  LocalActiveRequests::inc(*host1);
+  LocalActiveRequests::inc(*host2);
+  EXPECT_EQ(2U, LocalActiveRequests::value(*host1));
+  EXPECT_EQ(1U, LocalActiveRequests::value(*host2));
+
+  // The counts are per thread.
+  Thread::Thread thread([&]() -> void {
+    EXPECT_EQ(0U, LocalActiveRequests::value(*host1));
+    LocalActiveRequests::inc(*host1);
+    EXPECT_EQ(1U, LocalActiveRequests::value(*host1));
+    LocalActiveRequests::dec(*host1);
+  });
+  thread.join();
+  EXPECT_EQ(2U, LocalActiveRequests::value(*host1));
+
+  LocalActiveRequests::dec(*host1);
+  LocalActiveRequests::dec(*host1);
+  LocalActiveRequests::dec(*host2);
+  EXPECT_EQ(0U, LocalActiveRequests::value(*host1));
+  EXPECT_EQ(0U, LocalActiveRequests::value(*host2));
+}
+
+} // namespace Upstream
+} // namespace Envoy
@@ -0,0 +1,163 @@
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+
+#include "envoy/router/router.h"
+
+#include "common/upstream/maglev_lb.h"
+#include "common/upstream/upstream_impl.h"
+
+#include "test/common/upstream/utility.h"
+#include "test/mocks/runtime/mocks.h"
+#include "test/mocks/upstream/mocks.h"
+
+#include "fmt/format.h"
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+
+using testing::NiceMock;
+using testing::Return;
+
+namespace Envoy {
+namespace Upstream {
+
+class TestLoadBalancerContext : public LoadBalancerContext {
+public:
+  TestLoadBalancerContext(uint64_t hash_key) : hash_key_(hash_key) {}
+
+  // Upstream::LoadBalancerContext
+  Optional<uint64_t> computeHashKey() override { return hash_key_; }
+  const Router::MetadataMatchCriteria* metadataMatchCriteria() const override { return nullptr; }
+  const Network::Connection* downstreamConnection() const override { return nullptr; }
+
+  Optional<uint64_t> hash_key_;
+};
+
+class MaglevLoadBalancerTest : public ::testing::TestWithParam<bool> {
+public:
+  MaglevLoadBalancerTest() : stats_(ClusterInfoImpl::generateStats(stats_store_)) {}
+
+  void init(uint64_t table_size) {
+    lb_.reset(
+        new MaglevLoadBalancer(priority_set_, stats_, runtime_, random_, nullptr, table_size));
+    lb_->initialize();
+  }
+
+  // Run all tests aginst both priority 0 and priority 1 host sets, to ensure
+  // all the load balancers have equivalent functonality for failover host sets.
+  MockHostSet& hostSet() { return GetParam() ? host_set_ : failover_host_set_; }
+
+  void setHosts(uint32_t first_port, uint32_t num_hosts) {
+    hostSet().hosts_.clear();
+    for (uint32_t i = 0; i < num_hosts; i++) {
+      hostSet().hosts_.push_back(
+          makeTestHost(info_, fmt::format("tcp://127.0.0.1:{}", first_port + i)));
+    }
+    hostSet().healthy_hosts_ = hostSet().hosts_;
+    hostSet().runCallbacks({}, {});
+  }
+
+  // Check the host chosen for each entry of the table against the expected host indices.
+  void expectTable(LoadBalancer& lb, const std::vector<uint32_t>& expected) {
+    for (uint64_t i = 0; i < expected.size(); i++) {
+      TestLoadBalancerContext context(i);
+      EXPECT_EQ(hostSet().hosts_[expected[i]], lb.chooseHost(&context)) << "entry " << i;
+    }
+  }
+
+  NiceMock<MockPrioritySet> priority_set_;
+  MockHostSet& host_set_ = *priority_set_.getMockHostSet(0);
+  MockHostSet& failover_host_set_ = *priority_set_.getMockHostSet(1);
+  std::shared_ptr<MockClusterInfo> info_{new NiceMock<MockClusterInfo>()};
+  Stats::IsolatedStoreImpl stats_store_;
+  ClusterStats stats_;
+  NiceMock<Runtime::MockLoader> runtime_;
+  NiceMock<Runtime::MockRandomGenerator> random_;
+  std::unique_ptr<MaglevLoadBalancer> lb_;
+};
+
+INSTANTIATE_TEST_CASE_P(MaglevPrimaryOrFailover, MaglevLoadBalancerTest,
+                        ::testing::Values(true, false));
+
+TEST_P(MaglevLoadBalancerTest, NoHost) {
+  init(7);
+  EXPECT_EQ(nullptr, lb_->factory()->create()->chooseHost(nullptr));
+}
+
+TEST_P(MaglevLoadBalancerTest, Basic) {
+  setHosts(90, 3);
+  init(7);
+
+  // The table follows the permutations of :90, :91 and :92 taking turns.
+  LoadBalancerPtr lb = lb_->factory()->create();
+  expectTable(*lb, {2, 1, 0, 1, 2, 0, 0});
+  {
+    // Hashes wrap around the table.
+    TestLoadBalancerContext context(8);
+    EXPECT_EQ(hostSet().hosts_[1], lb->chooseHost(&context));
+  }
+  {
+    EXPECT_CALL(random_, random()).WillOnce(Return(4));
+    EXPECT_EQ(hostSet().hosts_[2], lb->chooseHost(nullptr));
+  }
+  EXPECT_EQ(0UL, stats_.lb_healthy_panic_.value());
+
+  hostSet().healthy_hosts_.clear();
+  hostSet().runCallbacks({}, {});
+  lb = lb_->factory()->create();
+  {
+    TestLoadBalancerContext context(0);
+    if (GetParam()) {
+      EXPECT_EQ(hostSet().hosts_[2], lb->chooseHost(&context));
+    } else {
+      // When all hosts are unhealthy, the default behavior of the load balancer is to send
+      // traffic to P=0. In this case, P=0 has no backends so it returns nullptr.
+      EXPECT_EQ(nullptr, lb->chooseHost(&context));
+    }
+  }
+  EXPECT_EQ(1UL, stats_.lb_healthy_panic_.value());
+}
+
+// Removing a host only moves the entries that host had.
+TEST_P(MaglevLoadBalancerTest, RemoveHost) {
+  setHosts(90, 3);
+  init(7);
+
+  hostSet().hosts_.erase(hostSet().hosts_.begin() + 1);
+  hostSet().healthy_hosts_ = hostSet().hosts_;
+  hostSet().runCallbacks({}, {});
+
+  // Entries 1 and 3 belonged to :91.
+  LoadBalancerPtr lb = lb_->factory()->create();
+  expectTable(*lb, {1, 1, 0, 0, 1, 0, 0});
+}
+
+// With more hosts than entries, the last hosts get no entries.
+TEST_P(MaglevLoadBalancerTest, MoreHostsThanEntries) {
+  setHosts(90, 8);
+  init(7);
+
+  LoadBalancerPtr lb = lb_->factory()->create();
+  expectTable(*lb, {2, 4, 0, 1, 5, 6, 3});
+}
+
+// Each host gets an almost equal share of the table.
+TEST_P(MaglevLoadBalancerTest, EvenShares) {
+  setHosts(8000, 10);
+  init(MaglevLoadBalancer::DefaultTableSize);
+
+  LoadBalancerPtr lb = lb_->factory()->create();
+  std::unordered_map<HostConstSharedPtr, uint64_t> entries;
+  for (uint64_t i = 0; i < MaglevLoadBalancer::DefaultTableSize; i++) {
+    TestLoadBalancerContext context(i);
+    entries[lb->chooseHost(&context)]++;
+  }
+  ASSERT_EQ(10U, entries.size());
+  for (const auto& host_entries : entries) {
+    EXPECT_GE(host_entries.second, MaglevLoadBalancer::DefaultTableSize / 10);
+    EXPECT_LE(host_entries.second, MaglevLoadBalancer::DefaultTableSize / 10 + 1);
+  }
+}
+
+} // namespace Upstream
+} // namespace Envoy
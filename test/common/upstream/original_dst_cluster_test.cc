@@ -4,6 +4,8 @@
 #include <tuple>
 #include <vector>
 
+#include "common/config/metadata.h"
+#include "common/config/well_known_names.h"
 #include "common/network/address_impl.h"
 #include "common/network/utility.h"
 #include "common/upstream/original_dst_cluster.h"
@@ -51,10 +53,12 @@ public:
   // take care of destructing it!
   OriginalDstClusterTest() : cleanup_timer_(new Event::MockTimer(&dispatcher_)) {}
 
-  void setup(const std::string& json) {
+  void setup(const std::string& json) { setup(parseClusterFromJson(json)); }
+
+  void setup(const envoy::api::v2::Cluster& config) {
     NiceMock<MockClusterManager> cm;
-    cluster_.reset(new OriginalDstCluster(parseClusterFromJson(json), runtime_, stats_store_,
-                                          ssl_context_manager_, cm, dispatcher_, false));
+    cluster_.reset(new OriginalDstCluster(config, runtime_, stats_store_, ssl_context_manager_, cm,
+                                          dispatcher_, false));
     cluster_->prioritySet().addMemberUpdateCb(
         [&](uint32_t, const std::vector<HostSharedPtr>&,
             const std::vector<HostSharedPtr>&) -> void { membership_updated_.ready(); });
@@ -99,6 +103,32 @@ TEST(OriginalDstClusterConfigTest, GoodConfig) {
   EXPECT_TRUE(parseClusterFromJson(json).has_cleanup_interval());
 }
 
+TEST(OriginalDstClusterConfigTest, BadMaxHosts) {
+  std::string json = R"EOF(
+  {
+    "name": "name",
+    "connect_timeout_ms": 250,
+    "type": "original_dst",
+    "lb_type": "original_dst_lb"
+  }
+  )EOF"; // Help Emacs balance quotation marks: "
+
+  envoy::api::v2::Cluster config = parseClusterFromJson(json);
+  Config::Metadata::mutableMetadataValue(*config.mutable_metadata(),
+                                         Config::MetadataFilters::get().ENVOY_LB,
+                                         Config::MetadataEnvoyLbKeys::get().ORIGINAL_DST_MAX_HOSTS)
+      .set_number_value(0);
+  Stats::IsolatedStoreImpl stats_store;
+  Ssl::MockContextManager ssl_context_manager;
+  NiceMock<Runtime::MockLoader> runtime;
+  NiceMock<Event::MockDispatcher> dispatcher;
+  NiceMock<MockClusterManager> cm;
+  EXPECT_THROW_WITH_MESSAGE(OriginalDstCluster(config, runtime, stats_store, ssl_context_manager,
+                                               cm, dispatcher, false),
+                            EnvoyException,
+                            "cluster: original dst max hosts must be a positive integer: 0");
+}
+
 TEST_F(OriginalDstClusterTest, CleanupInterval) {
   std::string json = R"EOF(
   {
@@ -450,6 +480,116 @@ TEST_F(OriginalDstClusterTest, MultipleClusters) {
   EXPECT_EQ(host, second.hostSetsPerPriority()[0]->hosts()[0]);
 }
 
+// Hosts created while the post of an earlier one is queued are added along with it.
+TEST_F(OriginalDstClusterTest, BatchedAdditions) {
+  std::string json = R"EOF(
+  {
+    "name": "name",
+    "connect_timeout_ms": 1250,
+    "type": "original_dst",
+    "lb_type": "original_dst_lb"
+  }
+  )EOF";
+
+  EXPECT_CALL(initialized_, ready());
+  EXPECT_CALL(*cleanup_timer_, enableTimer(_));
+  setup(json);
+
+  NiceMock<Network::MockConnection> connection1;
+  TestLoadBalancerContext lb_context1(&connection1);
+  connection1.local_address_ = std::make_shared<Network::Address::Ipv4Instance>("10.10.11.11");
+  EXPECT_CALL(connection1, usingOriginalDst()).WillRepeatedly(Return(true));
+
+  NiceMock<Network::MockConnection> connection2;
+  TestLoadBalancerContext lb_context2(&connection2);
+  connection2.local_address_ = std::make_shared<Network::Address::Ipv4Instance>("10.10.11.12");
+  EXPECT_CALL(connection2, usingOriginalDst()).WillRepeatedly(Return(true));
+
+  OriginalDstCluster::LoadBalancer lb(cluster_->prioritySet(), cluster_);
+  Event::PostCb post_cb;
+  EXPECT_CALL(dispatcher_, post(_)).WillOnce(SaveArg<0>(&post_cb));
+  HostConstSharedPtr host1 = lb.chooseHost(&lb_context1);
+  HostConstSharedPtr host2 = lb.chooseHost(&lb_context2);
+  ASSERT_NE(host1, nullptr);
+  ASSERT_NE(host2, nullptr);
+
+  EXPECT_CALL(membership_updated_, ready());
+  post_cb();
+  ASSERT_EQ(2UL, cluster_->prioritySet().hostSetsPerPriority()[0]->hosts().size());
+  EXPECT_EQ(host1, cluster_->prioritySet().hostSetsPerPriority()[0]->hosts()[0]);
+  EXPECT_EQ(host2, cluster_->prioritySet().hostSetsPerPriority()[0]->hosts()[1]);
+
+  // The next host posts again.
+  NiceMock<Network::MockConnection> connection3;
+  TestLoadBalancerContext lb_context3(&connection3);
+  connection3.local_address_ = std::make_shared<Network::Address::Ipv4Instance>("10.10.11.13");
+  EXPECT_CALL(connection3, usingOriginalDst()).WillRepeatedly(Return(true));
+
+  EXPECT_CALL(dispatcher_, post(_)).WillOnce(SaveArg<0>(&post_cb));
+  HostConstSharedPtr host3 = lb.chooseHost(&lb_context3);
+  EXPECT_CALL(membership_updated_, ready());
+  post_cb();
+  EXPECT_EQ(3UL, cluster_->prioritySet().hostSetsPerPriority()[0]->hosts().size());
+}
+
+// Beyond the bound, the cluster drops the oldest unused hosts first.
+TEST_F(OriginalDstClusterTest, MaxHosts) {
+  std::string json = R"EOF(
+  {
+    "name": "name",
+    "connect_timeout_ms": 1250,
+    "type": "original_dst",
+    "lb_type": "original_dst_lb"
+  }
+  )EOF";
+
+  envoy::api::v2::Cluster config = parseClusterFromJson(json);
+  Config::Metadata::mutableMetadataValue(*config.mutable_metadata(),
+                                         Config::MetadataFilters::get().ENVOY_LB,
+                                         Config::MetadataEnvoyLbKeys::get().ORIGINAL_DST_MAX_HOSTS)
+      .set_number_value(2);
+  EXPECT_CALL(initialized_, ready());
+  EXPECT_CALL(*cleanup_timer_, enableTimer(_));
+  setup(config);
+
+  OriginalDstCluster::LoadBalancer lb(cluster_->prioritySet(), cluster_);
+  std::vector<std::unique_ptr<NiceMock<Network::MockConnection>>> connections;
+  auto choose_host = [&](const std::string& address) -> HostConstSharedPtr {
+    connections.emplace_back(new NiceMock<Network::MockConnection>());
+    connections.back()->local_address_ =
+        std::make_shared<Network::Address::Ipv4Instance>(address);
+    ON_CALL(*connections.back(), usingOriginalDst()).WillByDefault(Return(true));
+    TestLoadBalancerContext lb_context(connections.back().get());
+    return lb.chooseHost(&lb_context);
+  };
+  Event::PostCb post_cb;
+  EXPECT_CALL(dispatcher_, post(_)).Times(2).WillRepeatedly(SaveArg<0>(&post_cb));
+  EXPECT_CALL(membership_updated_, ready()).Times(2);
+  HostConstSharedPtr host1 = choose_host("10.10.11.11");
+  post_cb();
+  HostConstSharedPtr host2 = choose_host("10.10.11.12");
+  post_cb();
+
+  // Both hosts become unused, then the older one is used again.
+  EXPECT_CALL(*cleanup_timer_, enableTimer(_));
+  cleanup_timer_->callback_();
+  EXPECT_EQ(host1, choose_host("10.10.11.11"));
+
+  // The third host drops the second one, which is unused.
+  EXPECT_CALL(dispatcher_, post(_)).WillOnce(SaveArg<0>(&post_cb));
+  EXPECT_CALL(membership_updated_, ready());
+  HostConstSharedPtr host3 = choose_host("10.10.11.13");
+  post_cb();
+  ASSERT_EQ(2UL, cluster_->prioritySet().hostSetsPerPriority()[0]->hosts().size());
+  EXPECT_EQ(host1, cluster_->prioritySet().hostSetsPerPriority()[0]->hosts()[0]);
+  EXPECT_EQ(host3, cluster_->prioritySet().hostSetsPerPriority()[0]->hosts()[1]);
+
+  // The dropped host is gone from the host map of the load balancer as well.
+  EXPECT_CALL(dispatcher_, post(_)).WillOnce(SaveArg<0>(&post_cb));
+  HostConstSharedPtr host4 = choose_host("10.10.11.12");
+  EXPECT_NE(host2, host4);
+}
+
 } // namespace OriginalDstClusterTest
 } // namespace Upstream
 } // namespace Envoy
@@ -83,6 +83,12 @@ public:
     }
   }
 
+  void loadResponseTime(HostSharedPtr host, int num_rq, std::chrono::milliseconds time) {
+    for (int i = 0; i < num_rq; i++) {
+      host->outlierDetector().putResponseTime(time);
+    }
+  }
+
   NiceMock<MockCluster> cluster_;
   std::vector<HostSharedPtr>& hosts_ = cluster_.prioritySet().getMockHostSet(0)->hosts_;
   std::vector<HostSharedPtr>& failover_hosts_ = cluster_.prioritySet().getMockHostSet(1)->hosts_;
@@ -535,6 +541,93 @@ TEST_F(OutlierDetectorImplTest, BasicFlowSuccessRate) {
   EXPECT_EQ(-1, detector->successRateEjectionThreshold());
 }
 
+TEST_F(OutlierDetectorImplTest, BasicFlowLatency) {
+  EXPECT_CALL(cluster_.prioritySet(), addMemberUpdateCb(_));
+  addHosts({
+      "tcp://127.0.0.1:80",
+      "tcp://127.0.0.1:81",
+      "tcp://127.0.0.1:82",
+      "tcp://127.0.0.1:83",
+      "tcp://127.0.0.1:84",
+  });
+
+  EXPECT_CALL(*interval_timer_, enableTimer(std::chrono::milliseconds(10000)));
+  std::shared_ptr<DetectorImpl> detector(DetectorImpl::create(
+      cluster_, empty_outlier_detection_, dispatcher_, runtime_, time_source_, event_logger_));
+  detector->addChangedStateCb([&](HostSharedPtr host) -> void { checker_.check(host); });
+
+  ON_CALL(runtime_.snapshot_, getInteger("outlier_detection.latency_factor", 0))
+      .WillByDefault(Return(3000));
+  ON_CALL(runtime_.snapshot_, featureEnabled("outlier_detection.enforcing_latency", 100))
+      .WillByDefault(Return(true));
+
+  // Four hosts answer in 10ms, and the fifth takes 100ms for its slowest requests.
+  loadRq(hosts_, 200, 200);
+  for (uint64_t i = 0; i < 4; i++) {
+    loadResponseTime(hosts_[i], 200, std::chrono::milliseconds(10));
+  }
+  loadResponseTime(hosts_[4], 190, std::chrono::milliseconds(10));
+  loadResponseTime(hosts_[4], 10, std::chrono::milliseconds(100));
+
+  EXPECT_CALL(time_source_, currentTime())
+      .Times(2)
+      .WillRepeatedly(Return(MonotonicTime(std::chrono::milliseconds(10000))));
+  EXPECT_CALL(checker_, check(hosts_[4]));
+  EXPECT_CALL(*event_logger_, logEject(std::static_pointer_cast<const HostDescription>(hosts_[4]),
+                                       _, EjectionType::Latency, true));
+  EXPECT_CALL(*interval_timer_, enableTimer(std::chrono::milliseconds(10000)));
+  interval_timer_->callback_();
+  // 100ms falls in the bucket starting at 96ms.
+  EXPECT_EQ(96, hosts_[4]->outlierDetector().latency());
+  EXPECT_EQ(10, hosts_[0]->outlierDetector().latency());
+  EXPECT_EQ(30, detector->latencyEjectionThreshold());
+  EXPECT_TRUE(hosts_[4]->healthFlagGet(Host::HealthFlag::FAILED_OUTLIER_CHECK));
+  EXPECT_EQ(1UL, cluster_.info_->stats_store_.gauge("outlier_detection.ejections_active").value());
+  EXPECT_EQ(1UL,
+            cluster_.info_->stats_store_.counter("outlier_detection.ejections_detected_latency")
+                .value());
+  EXPECT_EQ(1UL,
+            cluster_.info_->stats_store_.counter("outlier_detection.ejections_enforced_latency")
+                .value());
+
+  // Without requests over the next interval there are no latencies to compare.
+  EXPECT_CALL(time_source_, currentTime())
+      .WillOnce(Return(MonotonicTime(std::chrono::milliseconds(19999))));
+  EXPECT_CALL(*interval_timer_, enableTimer(std::chrono::milliseconds(10000)));
+  interval_timer_->callback_();
+  EXPECT_EQ(-1, hosts_[0]->outlierDetector().latency());
+  EXPECT_EQ(-1, detector->latencyEjectionThreshold());
+  EXPECT_EQ(1UL, cluster_.info_->stats_store_.gauge("outlier_detection.ejections_active").value());
+}
+
+// Latency ejection is off by default.
+TEST_F(OutlierDetectorImplTest, LatencyDisabled) {
+  EXPECT_CALL(cluster_.prioritySet(), addMemberUpdateCb(_));
+  addHosts({
+      "tcp://127.0.0.1:80",
+      "tcp://127.0.0.1:81",
+      "tcp://127.0.0.1:82",
+      "tcp://127.0.0.1:83",
+      "tcp://127.0.0.1:84",
+  });
+
+  EXPECT_CALL(*interval_timer_, enableTimer(std::chrono::milliseconds(10000)));
+  std::shared_ptr<DetectorImpl> detector(DetectorImpl::create(
+      cluster_, empty_outlier_detection_, dispatcher_, runtime_, time_source_, event_logger_));
+
+  for (uint64_t i = 0; i < 4; i++) {
+    loadResponseTime(hosts_[i], 200, std::chrono::milliseconds(10));
+  }
+  loadResponseTime(hosts_[4], 200, std::chrono::milliseconds(1000));
+
+  EXPECT_CALL(time_source_, currentTime())
+      .WillOnce(Return(MonotonicTime(std::chrono::milliseconds(10000))));
+  EXPECT_CALL(*interval_timer_, enableTimer(std::chrono::milliseconds(10000)));
+  interval_timer_->callback_();
+  EXPECT_FALSE(hosts_[4]->healthFlagGet(Host::HealthFlag::FAILED_OUTLIER_CHECK));
+  EXPECT_EQ(-1, detector->latencyEjectionThreshold());
+}
+
 TEST_F(OutlierDetectorImplTest, RemoveWhileEjected) {
   EXPECT_CALL(cluster_.prioritySet(), addMemberUpdateCb(_));
   addHosts({"tcp://127.0.0.1:80"});
@@ -739,6 +832,36 @@ TEST(DetectorHostMonitorNullImplTest, All) {
   EXPECT_EQ(0UL, null_sink.numEjections());
   EXPECT_FALSE(null_sink.lastEjectionTime().valid());
   EXPECT_FALSE(null_sink.lastUnejectionTime().valid());
+  EXPECT_EQ(-1, null_sink.latency());
+}
+
+TEST(LatencyAccumulatorTest, Percentiles) {
+  LatencyAccumulator accumulator;
+  LatencyAccumulatorBucket* bucket = accumulator.updateCurrentWriter();
+  for (uint64_t i = 1; i <= 100; i++) {
+    bucket->record(std::chrono::milliseconds(i));
+  }
+  accumulator.updateCurrentWriter();
+
+  EXPECT_FALSE(accumulator.getPercentile(50, 101).valid());
+  // Response times below 16ms are exact, and larger ones are within 1/8th.
+  EXPECT_EQ(10UL, accumulator.getPercentile(10, 100).value());
+  EXPECT_EQ(48UL, accumulator.getPercentile(50, 100).value());
+  EXPECT_EQ(96UL, accumulator.getPercentile(99, 100).value());
+  EXPECT_EQ(1UL, accumulator.getPercentile(0, 100).value());
+
+  // The bucket that was read is cleared before it is written to again.
+  bucket = accumulator.updateCurrentWriter();
+  bucket->record(std::chrono::milliseconds(5));
+  accumulator.updateCurrentWriter();
+  EXPECT_EQ(5UL, accumulator.getPercentile(100, 1).value());
+
+  // Response times beyond the last bucket share it.
+  bucket = accumulator.updateCurrentWriter();
+  bucket->record(std::chrono::hours(100));
+  accumulator.updateCurrentWriter();
+  EXPECT_EQ(LatencyAccumulatorBucket::lowerBound(LatencyAccumulatorBucket::NumBuckets - 1),
+            accumulator.getPercentile(100, 1).value());
 }
 
 TEST(OutlierDetectionEventLoggerImplTest, All) {
@@ -807,6 +930,20 @@ TEST(OutlierDetectionEventLoggerImplTest, All) {
       .WillOnce(SaveArg<0>(&log4));
   event_logger.logUneject(host);
   Json::Factory::loadFromString(log4);
+
+  std::string log5;
+  EXPECT_CALL(host->outlier_detector_, lastUnejectionTime()).WillOnce(ReturnRef(monotonic_time));
+  EXPECT_CALL(host->outlier_detector_, latency()).WillOnce(Return(96));
+  EXPECT_CALL(detector, latencyEjectionThreshold()).WillOnce(Return(30));
+  EXPECT_CALL(*file, write("{\"time\": \"1970-01-01T00:00:00.000Z\", \"secs_since_last_action\": "
+                           "\"30\", \"cluster\": "
+                           "\"fake_cluster\", \"upstream_url\": \"10.0.0.1:443\", \"action\": "
+                           "\"eject\", \"type\": \"Latency\", \"num_ejections\": \"0\", "
+                           "\"enforced\": \"true\", \"host_latency\": \"96\", "
+                           "\"cluster_latency_ejection_threshold\": \"30\"}\n"))
+      .WillOnce(SaveArg<0>(&log5));
+  event_logger.logEject(host, detector, EjectionType::Latency, true);
+  Json::Factory::loadFromString(log5);
 }
 
 TEST(OutlierUtility, SRThreshold) {
@@ -0,0 +1,51 @@
+#include <chrono>
+#include <cmath>
+
+#include "common/upstream/peak_ewma.h"
+
+#include "gtest/gtest.h"
+
+namespace Envoy {
+namespace Upstream {
+
+class PeakEwmaTest : public testing::Test {
+public:
+  MonotonicTime at(uint64_t ms) { return start_ + std::chrono::milliseconds(ms); }
+
+  const MonotonicTime start_{std::chrono::hours(1)};
+  PeakEwma ewma_{std::chrono::milliseconds(1000)};
+};
+
+TEST_F(PeakEwmaTest, Empty) { EXPECT_EQ(0, ewma_.value(at(0))); }
+
+// Slower responses replace the average.
+TEST_F(PeakEwmaTest, Peak) {
+  ewma_.observe(std::chrono::milliseconds(10), at(0));
+  EXPECT_DOUBLE_EQ(10, ewma_.value(at(0)));
+  ewma_.observe(std::chrono::milliseconds(50), at(0));
+  EXPECT_DOUBLE_EQ(50, ewma_.value(at(0)));
+}
+
+// Faster responses are averaged in with a weight that grows with the time since the last one.
+TEST_F(PeakEwmaTest, Average) {
+  ewma_.observe(std::chrono::milliseconds(100), at(0));
+  ewma_.observe(std::chrono::milliseconds(100), at(0));
+  ewma_.observe(std::chrono::milliseconds(0), at(0));
+  EXPECT_DOUBLE_EQ(100, ewma_.value(at(0)));
+
+  ewma_.observe(std::chrono::milliseconds(0), at(1000));
+  EXPECT_DOUBLE_EQ(100 * std::exp(-1), ewma_.value(at(1000)));
+}
+
+// Reading the average decays it towards 0.
+TEST_F(PeakEwmaTest, Decay) {
+  ewma_.observe(std::chrono::milliseconds(100), at(0));
+  EXPECT_DOUBLE_EQ(100 * std::exp(-0.5), ewma_.value(at(500)));
+  EXPECT_DOUBLE_EQ(100 * std::exp(-2), ewma_.value(at(2000)));
+  // Time going backwards, as seen from a worker racing with another one, does not grow it.
+  ewma_.observe(std::chrono::milliseconds(100), at(2000));
+  EXPECT_DOUBLE_EQ(100, ewma_.value(at(1000)));
+}
+
+} // namespace Upstream
+} // namespace Envoy
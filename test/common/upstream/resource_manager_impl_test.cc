@@ -39,6 +39,12 @@ TEST(ResourceManagerImplTest, RuntimeResourceManager) {
   EXPECT_EQ(3U, resource_manager.requests().max());
   EXPECT_TRUE(resource_manager.requests().canCreate());
 
+  EXPECT_CALL(runtime.snapshot_,
+              getInteger("circuit_breakers.runtime_resource_manager_test.default.retry_budget."
+                         "budget_percent",
+                         0U))
+      .Times(2)
+      .WillRepeatedly(Return(0U));
   EXPECT_CALL(runtime.snapshot_,
               getInteger("circuit_breakers.runtime_resource_manager_test.default.max_retries", 1U))
       .Times(2)
@@ -47,5 +53,68 @@ TEST(ResourceManagerImplTest, RuntimeResourceManager) {
   EXPECT_FALSE(resource_manager.retries().canCreate());
 }
 
+TEST(ResourceManagerImplTest, RetryBudget) {
+  NiceMock<Runtime::MockLoader> runtime;
+  ResourceManagerImpl resource_manager(runtime, "circuit_breakers.budget_test.default.", 1024,
+                                       1024, 1024, 1);
+  EXPECT_FALSE(resource_manager.retryBudgetEnabled());
+  EXPECT_EQ(1U, resource_manager.retries().max());
+
+  ON_CALL(runtime.snapshot_,
+          getInteger("circuit_breakers.budget_test.default.retry_budget.budget_percent", 0U))
+      .WillByDefault(Return(20U));
+  EXPECT_TRUE(resource_manager.retryBudgetEnabled());
+
+  // Without enough active requests the minimum concurrency applies.
+  EXPECT_EQ(3U, resource_manager.retries().max());
+  for (uint64_t i = 0; i < 10; i++) {
+    resource_manager.requests().inc();
+    resource_manager.pendingRequests().inc();
+  }
+  EXPECT_EQ(4U, resource_manager.retries().max());
+  for (uint64_t i = 0; i < 4; i++) {
+    EXPECT_TRUE(resource_manager.retries().canCreate());
+    resource_manager.retries().inc();
+  }
+  EXPECT_FALSE(resource_manager.retries().canCreate());
+
+  // The budget shrinks with the active requests.
+  for (uint64_t i = 0; i < 10; i++) {
+    resource_manager.requests().dec();
+    resource_manager.pendingRequests().dec();
+  }
+  ON_CALL(runtime.snapshot_,
+          getInteger("circuit_breakers.budget_test.default.retry_budget.min_retry_concurrency",
+                     3U))
+      .WillByDefault(Return(1U));
+  EXPECT_EQ(1U, resource_manager.retries().max());
+  for (uint64_t i = 0; i < 4; i++) {
+    resource_manager.retries().dec();
+  }
+}
+
+TEST(ResourceManagerImplTest, ShedForHighPriority) {
+  NiceMock<Runtime::MockLoader> runtime;
+  ResourceManagerImpl default_manager(runtime, "circuit_breakers.shed_test.default.", 1024, 1024,
+                                      1024, 3);
+  ResourceManagerImpl high_manager(runtime, "circuit_breakers.shed_test.high.", 1024, 1024, 1024,
+                                   3);
+  default_manager.shedFor(high_manager);
+
+  // Nothing is shed unless enabled by runtime.
+  high_manager.pendingRequests().inc();
+  EXPECT_TRUE(default_manager.pendingRequests().canCreate());
+
+  ON_CALL(runtime.snapshot_,
+          getInteger("circuit_breakers.shed_test.default.shed_for_high_priority", 0U))
+      .WillByDefault(Return(1U));
+  EXPECT_FALSE(default_manager.pendingRequests().canCreate());
+  EXPECT_TRUE(high_manager.pendingRequests().canCreate());
+
+  // Once the high priority requests are no longer pending, the default ones can be queued again.
+  high_manager.pendingRequests().dec();
+  EXPECT_TRUE(default_manager.pendingRequests().canCreate());
+}
+
 } // namespace Upstream
 } // namespace Envoy
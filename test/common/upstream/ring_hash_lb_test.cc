@@ -1,20 +1,29 @@
+#include <chrono>
 #include <cstdint>
+#include <limits>
+#include <map>
+#include <mutex>
 #include <string>
+#include <thread>
 #include <unordered_map>
+#include <vector>
 
 #include "envoy/router/router.h"
 
+#include "common/common/hash.h"
 #include "common/network/utility.h"
 #include "common/upstream/ring_hash_lb.h"
 #include "common/upstream/upstream_impl.h"
 
 #include "test/common/upstream/utility.h"
+#include "test/mocks/event/mocks.h"
 #include "test/mocks/runtime/mocks.h"
 #include "test/mocks/upstream/mocks.h"
 
 #include "gmock/gmock.h"
 #include "gtest/gtest.h"
 
+using testing::Invoke;
 using testing::NiceMock;
 using testing::Return;
 using testing::_;
@@ -278,6 +287,155 @@ TEST_P(RingHashLoadBalancerTest, UnevenHosts) {
   }
 }
 
+// A larger ring chooses the same hosts as a search of the sorted hashes.
+TEST_P(RingHashLoadBalancerTest, LargeRing) {
+  for (uint64_t i = 0; i < 50; i++) {
+    hostSet().hosts_.push_back(makeTestHost(info_, fmt::format("tcp://10.0.0.{}:6379", i)));
+  }
+  hostSet().healthy_hosts_ = hostSet().hosts_;
+  hostSet().runCallbacks({}, {});
+
+  config_.value(envoy::api::v2::Cluster::RingHashLbConfig());
+  config_.value().mutable_minimum_ring_size()->set_value(1000);
+  config_.value().mutable_deprecated_v1()->mutable_use_std_hash()->set_value(false);
+  init();
+
+  std::map<uint64_t, std::string> ring;
+  for (const auto& host : hostSet().hosts_) {
+    for (uint64_t i = 0; i < 20; i++) {
+      const std::string address = host->address()->asString();
+      ring.emplace(HashUtil::xxHash64(fmt::format("{}_{}", address, i)), address);
+    }
+  }
+  ASSERT_EQ(1000U, ring.size());
+
+  LoadBalancerPtr lb = lb_->factory()->create();
+  auto expect_host = [&](uint64_t hash) -> void {
+    auto it = ring.lower_bound(hash);
+    const std::string& expected = it == ring.end() ? ring.begin()->second : it->second;
+    TestLoadBalancerContext context(hash);
+    EXPECT_EQ(expected, lb->chooseHost(&context)->address()->asString()) << hash;
+  };
+  for (const auto& entry : ring) {
+    expect_host(entry.first - 1);
+    expect_host(entry.first);
+    expect_host(entry.first + 1);
+  }
+  for (uint64_t i = 0; i < 1000; i++) {
+    expect_host(HashUtil::xxHash64(fmt::format("{}", i)));
+  }
+  expect_host(0);
+  expect_host(std::numeric_limits<uint64_t>::max());
+}
+
+class RingHashAsyncRebuildTest : public RingHashLoadBalancerTest {
+public:
+  RingHashAsyncRebuildTest() {
+    ON_CALL(runtime_.snapshot_, featureEnabled("upstream.async_lb_rebuild", 100))
+        .WillByDefault(Return(true));
+    ON_CALL(dispatcher_, post(_)).WillByDefault(Invoke([this](std::function<void()> cb) -> void {
+      std::unique_lock<std::mutex> lock(posted_lock_);
+      posted_.push_back(cb);
+    }));
+
+    config_.value(envoy::api::v2::Cluster::RingHashLbConfig());
+    config_.value().mutable_minimum_ring_size()->set_value(3);
+    config_.value().mutable_deprecated_v1()->mutable_use_std_hash()->set_value(false);
+  }
+
+  void init() {
+    lb_.reset(
+        new RingHashLoadBalancer(priority_set_, stats_, runtime_, random_, config_, &dispatcher_));
+    lb_->initialize();
+  }
+
+  void setHosts(const std::vector<std::string>& urls) {
+    hostSet().hosts_.clear();
+    for (const std::string& url : urls) {
+      hostSet().hosts_.push_back(makeTestHost(info_, url));
+    }
+    hostSet().healthy_hosts_ = hostSet().hosts_;
+    hostSet().runCallbacks({}, {});
+  }
+
+  // Wait for the background thread to post the completed build, and return the posted callbacks.
+  std::vector<std::function<void()>> waitForPosted() {
+    std::vector<std::function<void()>> posted;
+    while (true) {
+      {
+        std::unique_lock<std::mutex> lock(posted_lock_);
+        if (!posted_.empty()) {
+          posted.swap(posted_);
+          return posted;
+        }
+      }
+      std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+  }
+
+  NiceMock<Event::MockDispatcher> dispatcher_;
+  std::mutex posted_lock_;
+  std::vector<std::function<void()>> posted_;
+};
+
+INSTANTIATE_TEST_CASE_P(RingHashPrimaryOrFailover, RingHashAsyncRebuildTest,
+                        ::testing::Values(true, false));
+
+// The ring is rebuilt in the background, and the existing worker load balancers keep using the
+// previous ring until the new one is published on the main thread.
+TEST_P(RingHashAsyncRebuildTest, OldRingServesUntilPublished) {
+  // See UnevenHosts for the rings.
+  setHosts({"tcp://127.0.0.1:80", "tcp://127.0.0.1:81"});
+  init();
+
+  LoadBalancerPtr lb = lb_->factory()->create();
+  TestLoadBalancerContext context(0);
+  const HostConstSharedPtr old_host = hostSet().hosts_[0];
+  EXPECT_EQ(old_host, lb->chooseHost(&context));
+
+  setHosts({"tcp://127.0.0.1:81", "tcp://127.0.0.1:82"});
+  std::vector<std::function<void()>> posted = waitForPosted();
+  EXPECT_EQ(old_host, lb->chooseHost(&context));
+  EXPECT_EQ(old_host, lb_->factory()->create()->chooseHost(&context));
+
+  for (const auto& cb : posted) {
+    cb();
+  }
+  EXPECT_EQ(hostSet().hosts_[0], lb->chooseHost(&context));
+  EXPECT_EQ(hostSet().hosts_[0], lb_->factory()->create()->chooseHost(&context));
+}
+
+// A build that completes after the load balancer is destroyed is dropped.
+TEST_P(RingHashAsyncRebuildTest, DestroyedBeforePublish) {
+  setHosts({"tcp://127.0.0.1:80", "tcp://127.0.0.1:81"});
+  init();
+  LoadBalancerFactorySharedPtr factory = lb_->factory();
+
+  setHosts({"tcp://127.0.0.1:81", "tcp://127.0.0.1:82"});
+  std::vector<std::function<void()>> posted = waitForPosted();
+  lb_.reset();
+
+  for (const auto& cb : posted) {
+    cb();
+  }
+  TestLoadBalancerContext context(0);
+  EXPECT_EQ("127.0.0.1:80", factory->create()->chooseHost(&context)->address()->asString());
+}
+
+// With the runtime feature off, the ring is rebuilt inline.
+TEST_P(RingHashAsyncRebuildTest, RuntimeDisabled) {
+  ON_CALL(runtime_.snapshot_, featureEnabled("upstream.async_lb_rebuild", 100))
+      .WillByDefault(Return(false));
+  EXPECT_CALL(dispatcher_, post(_)).Times(0);
+  setHosts({"tcp://127.0.0.1:80", "tcp://127.0.0.1:81"});
+  init();
+
+  LoadBalancerPtr lb = lb_->factory()->create();
+  setHosts({"tcp://127.0.0.1:81", "tcp://127.0.0.1:82"});
+  TestLoadBalancerContext context(0);
+  EXPECT_EQ(hostSet().hosts_[0], lb->chooseHost(&context));
+}
+
 /**
  * This test is for simulation only and should not be run as part of unit tests. In order to run the
  * simulation remove the DISABLED_ prefix from the TEST_P invocation. Run bazel with
@@ -480,6 +480,68 @@ TEST_P(SubsetLoadBalancerTest, BalancesSubsetAfterUpdate) {
   EXPECT_EQ(3U, stats_.lb_subsets_created_.value());
 }
 
+// The subset of a criteria that had none is found once the hosts change.
+TEST_P(SubsetLoadBalancerTest, ResolvesSubsetAfterUpdate) {
+  EXPECT_CALL(subset_info_, fallbackPolicy())
+      .WillRepeatedly(Return(envoy::api::v2::Cluster::LbSubsetConfig::NO_FALLBACK));
+
+  std::vector<std::set<std::string>> subset_keys = {{"version"}};
+  EXPECT_CALL(subset_info_, subsetKeys()).WillRepeatedly(ReturnRef(subset_keys));
+
+  init({{"tcp://127.0.0.1:80", {{"version", "1.0"}}}});
+
+  TestLoadBalancerContext context_11({{"version", "1.1"}});
+  EXPECT_EQ(nullptr, lb_->chooseHost(&context_11));
+
+  modifyHosts({makeHost("tcp://127.0.0.1:8000", {{"version", "1.1"}})}, {});
+
+  EXPECT_EQ(host_set_.hosts_[1], lb_->chooseHost(&context_11));
+  EXPECT_EQ(1U, stats_.lb_subsets_selected_.value());
+}
+
+// A criteria that is replaced by another at the same address gets the subset of the new one.
+TEST_F(SubsetLoadBalancerTest, ResolvesSubsetOfReplacedCriteria) {
+  EXPECT_CALL(subset_info_, fallbackPolicy())
+      .WillRepeatedly(Return(envoy::api::v2::Cluster::LbSubsetConfig::NO_FALLBACK));
+
+  std::vector<std::set<std::string>> subset_keys = {{"version"}};
+  EXPECT_CALL(subset_info_, subsetKeys()).WillRepeatedly(ReturnRef(subset_keys));
+
+  init({
+      {"tcp://127.0.0.1:80", {{"version", "1.0"}}},
+      {"tcp://127.0.0.1:81", {{"version", "1.1"}}},
+  });
+
+  class ReplaceableMetadataMatchCriteria : public Router::MetadataMatchCriteria {
+  public:
+    const std::vector<Router::MetadataMatchCriterionConstSharedPtr>&
+    metadataMatchCriteria() const override {
+      return criteria_->metadataMatchCriteria();
+    }
+
+    std::unique_ptr<TestMetadataMatchCriteria> criteria_;
+  };
+
+  class ReplaceableLoadBalancerContext : public LoadBalancerContext {
+  public:
+    // Upstream::LoadBalancerContext
+    Optional<uint64_t> computeHashKey() override { return {}; }
+    const Network::Connection* downstreamConnection() const override { return nullptr; }
+    const Router::MetadataMatchCriteria* metadataMatchCriteria() const override {
+      return &criteria_;
+    }
+
+    ReplaceableMetadataMatchCriteria criteria_;
+  };
+
+  ReplaceableLoadBalancerContext context;
+  context.criteria_.criteria_.reset(new TestMetadataMatchCriteria({{"version", "1.0"}}));
+  EXPECT_EQ(host_set_.hosts_[0], lb_->chooseHost(&context));
+
+  context.criteria_.criteria_.reset(new TestMetadataMatchCriteria({{"version", "1.1"}}));
+  EXPECT_EQ(host_set_.hosts_[1], lb_->chooseHost(&context));
+}
+
 // Test that adding backends to a failover group causes no problems.
 TEST_P(SubsetLoadBalancerTest, UpdateFailover) {
   EXPECT_CALL(subset_info_, fallbackPolicy())
@@ -723,6 +785,12 @@ TEST_P(SubsetLoadBalancerTest, LoadBalancerTypesRingHash) {
   doLbTypeTest(LoadBalancerType::RingHash);
 }
 
+TEST_P(SubsetLoadBalancerTest, LoadBalancerTypesMaglev) { doLbTypeTest(LoadBalancerType::Maglev); }
+
+TEST_P(SubsetLoadBalancerTest, LoadBalancerTypesPeakEwma) {
+  doLbTypeTest(LoadBalancerType::PeakEwma);
+}
+
 TEST_F(SubsetLoadBalancerTest, ZoneAwareFallback) {
   EXPECT_CALL(subset_info_, fallbackPolicy())
       .WillRepeatedly(Return(envoy::api::v2::Cluster::LbSubsetConfig::ANY_ENDPOINT));
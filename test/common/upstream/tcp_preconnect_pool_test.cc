@@ -0,0 +1,164 @@
+#include <chrono>
+#include <memory>
+#include <vector>
+
+#include "common/network/utility.h"
+#include "common/upstream/tcp_preconnect_pool.h"
+
+#include "test/mocks/event/mocks.h"
+#include "test/mocks/network/mocks.h"
+#include "test/mocks/upstream/mocks.h"
+
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+
+using testing::InSequence;
+using testing::NiceMock;
+using testing::Return;
+using testing::_;
+
+namespace Envoy {
+namespace Upstream {
+
+class TcpPreconnectPoolTest : public testing::Test {
+public:
+  TcpPreconnectPoolTest()
+      : cluster_(new NiceMock<MockClusterInfo>()), host_(new NiceMock<MockHost>()) {
+    cluster_->tcp_preconnect_per_host_ = 2;
+    cluster_->tcp_preconnect_max_age_ = std::chrono::milliseconds(5000);
+    ON_CALL(*host_, address()).WillByDefault(Return(address_));
+    pool_.reset(new TcpPreconnectPool(dispatcher_, cluster_));
+  }
+
+  struct Connection {
+    NiceMock<Network::MockClientConnection>* connection_;
+    Event::MockTimer* timer_;
+  };
+
+  // Expect the pool to open a connection to host_.
+  Connection expectConnect() {
+    Connection connection{new NiceMock<Network::MockClientConnection>(),
+                          new Event::MockTimer(&dispatcher_)};
+    EXPECT_CALL(*host_, createConnection_(_))
+        .WillOnce(Return(MockHost::MockCreateConnectionData{connection.connection_, host_}))
+        .RetiresOnSaturation();
+    EXPECT_CALL(*connection.connection_, readDisable(true));
+    EXPECT_CALL(*connection.connection_, connect());
+    EXPECT_CALL(*connection.timer_, enableTimer(std::chrono::milliseconds(1)));
+    return connection;
+  }
+
+  std::vector<Connection> addHost() {
+    // gmock matches the newest expectations first, so the first connection opened is the last one
+    // expected.
+    Connection second = expectConnect();
+    Connection first = expectConnect();
+    std::vector<Connection> connections{first, second};
+    pool_->addHosts({host_});
+    EXPECT_EQ(2U, pool_->idleConnections(host_));
+    EXPECT_EQ(2U, cluster_->stats_.upstream_cx_prefetch_.value());
+    return connections;
+  }
+
+  void connected(Connection& connection) {
+    EXPECT_CALL(*connection.timer_, enableTimer(std::chrono::milliseconds(5000)));
+    connection.connection_->raiseEvent(Network::ConnectionEvent::Connected);
+  }
+
+  NiceMock<Event::MockDispatcher> dispatcher_;
+  std::shared_ptr<NiceMock<MockClusterInfo>> cluster_;
+  std::shared_ptr<NiceMock<MockHost>> host_;
+  Network::Address::InstanceConstSharedPtr address_{
+      Network::Utility::resolveUrl("tcp://10.0.0.1:443")};
+  TcpPreconnectPoolPtr pool_;
+};
+
+TEST_F(TcpPreconnectPoolTest, ClaimAndRefill) {
+  std::vector<Connection> connections = addHost();
+
+  // Nothing is handed out before a connection is established.
+  EXPECT_EQ(nullptr, pool_->claim(host_).connection_);
+  EXPECT_EQ(2U, pool_->idleConnections(host_));
+
+  connected(connections[0]);
+  connected(connections[1]);
+
+  // The oldest connection is handed out read enabled and another is opened in its place.
+  Connection replacement = expectConnect();
+  EXPECT_CALL(*connections[0].connection_, removeConnectionCallbacks(_));
+  EXPECT_CALL(*connections[0].connection_, readDisable(false));
+  Host::CreateConnectionData data = pool_->claim(host_);
+  EXPECT_EQ(connections[0].connection_, data.connection_.get());
+  EXPECT_EQ(host_, data.host_description_);
+  EXPECT_TRUE(data.preconnected_);
+  EXPECT_EQ(1U, cluster_->stats_.upstream_cx_preconnect_claimed_.value());
+  EXPECT_EQ(2U, pool_->idleConnections(host_));
+  EXPECT_TRUE(connections[0].connection_->callbacks_.empty());
+
+  // A host without a pool gets nothing.
+  EXPECT_EQ(nullptr, pool_->claim(std::make_shared<NiceMock<MockHost>>()).connection_);
+
+  EXPECT_CALL(*connections[1].connection_, close(_));
+  EXPECT_CALL(*replacement.connection_, close(_));
+  pool_.reset();
+}
+
+TEST_F(TcpPreconnectPoolTest, MaxAge) {
+  std::vector<Connection> connections = addHost();
+  connected(connections[0]);
+
+  // A connection that reaches its maximum age is closed and replaced.
+  Connection replacement = expectConnect();
+  EXPECT_CALL(dispatcher_, deferredDelete_(_));
+  connections[0].timer_->callback_();
+  EXPECT_EQ(1U, cluster_->stats_.upstream_cx_preconnect_expired_.value());
+  EXPECT_EQ(2U, pool_->idleConnections(host_));
+}
+
+TEST_F(TcpPreconnectPoolTest, ConnectFailure) {
+  std::vector<Connection> connections = addHost();
+
+  // A connection that times out connecting or is refused is not replaced.
+  EXPECT_CALL(dispatcher_, deferredDelete_(_)).Times(2);
+  connections[0].timer_->callback_();
+  EXPECT_EQ(1U, cluster_->stats_.upstream_cx_connect_timeout_.value());
+  EXPECT_CALL(*connections[1].timer_, disableTimer());
+  connections[1].connection_->raiseEvent(Network::ConnectionEvent::RemoteClose);
+  EXPECT_EQ(0U, pool_->idleConnections(host_));
+
+  // The next claim tops the host back up.
+  expectConnect();
+  expectConnect();
+  EXPECT_EQ(nullptr, pool_->claim(host_).connection_);
+  EXPECT_EQ(2U, pool_->idleConnections(host_));
+}
+
+TEST_F(TcpPreconnectPoolTest, RemoteClose) {
+  std::vector<Connection> connections = addHost();
+  connected(connections[0]);
+
+  // An established connection that the host closes is replaced.
+  expectConnect();
+  EXPECT_CALL(dispatcher_, deferredDelete_(_));
+  connections[0].connection_->raiseEvent(Network::ConnectionEvent::RemoteClose);
+  EXPECT_EQ(2U, pool_->idleConnections(host_));
+}
+
+TEST_F(TcpPreconnectPoolTest, RemoveHost) {
+  std::vector<Connection> connections = addHost();
+  connected(connections[0]);
+
+  // Closing the connections of a removed host does not replace them.
+  {
+    InSequence s;
+    EXPECT_CALL(*connections[0].connection_, removeConnectionCallbacks(_));
+    EXPECT_CALL(*connections[0].connection_, close(Network::ConnectionCloseType::NoFlush));
+  }
+  EXPECT_CALL(*connections[1].connection_, close(Network::ConnectionCloseType::NoFlush));
+  EXPECT_CALL(*host_, createConnection_(_)).Times(0);
+  pool_->removeHosts({host_});
+  EXPECT_EQ(0U, pool_->idleConnections(host_));
+}
+
+} // namespace Upstream
+} // namespace Envoy
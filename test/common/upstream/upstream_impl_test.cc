@@ -23,6 +23,7 @@
 #include "test/mocks/upstream/mocks.h"
 #include "test/test_common/utility.h"
 
+#include "fmt/format.h"
 #include "gmock/gmock.h"
 #include "gtest/gtest.h"
 
@@ -317,6 +318,24 @@ TEST(HostImplTest, HostCluster) {
   EXPECT_EQ("", host->locality().zone());
 }
 
+TEST(HostImplTest, Stats) {
+  MockCluster cluster;
+  HostSharedPtr host = makeTestHost(cluster.info_, "tcp://10.0.0.1:1234", 1);
+  host->stats().rq_total_.inc();
+  host->stats().cx_active_.inc();
+
+  std::list<Stats::CounterSharedPtr> counters = host->counters();
+  EXPECT_EQ(6UL, counters.size());
+  for (const Stats::CounterSharedPtr& counter : counters) {
+    EXPECT_EQ(counter->name() == "rq_total" ? 1UL : 0UL, counter->value()) << counter->name();
+  }
+  std::list<Stats::GaugeSharedPtr> gauges = host->gauges();
+  EXPECT_EQ(2UL, gauges.size());
+  for (const Stats::GaugeSharedPtr& gauge : gauges) {
+    EXPECT_EQ(gauge->name() == "cx_active" ? 1UL : 0UL, gauge->value()) << gauge->name();
+  }
+}
+
 TEST(HostImplTest, Weight) {
   MockCluster cluster;
 
@@ -402,6 +421,130 @@ TEST(StaticClusterImplTest, RingHash) {
   EXPECT_TRUE(cluster.info()->addedViaApi());
 }
 
+TEST(StaticClusterImplTest, Maglev) {
+  Stats::IsolatedStoreImpl stats;
+  Ssl::MockContextManager ssl_context_manager;
+  NiceMock<Runtime::MockLoader> runtime;
+  const std::string json = R"EOF(
+  {
+    "name": "staticcluster",
+    "connect_timeout_ms": 250,
+    "type": "static",
+    "lb_type": "maglev",
+    "hosts": [{"url": "tcp://10.0.0.1:11001"}]
+  }
+  )EOF";
+
+  NiceMock<MockClusterManager> cm;
+  envoy::api::v2::Cluster cluster_config = parseClusterFromJson(json);
+  EXPECT_EQ(envoy::api::v2::Cluster::RING_HASH, cluster_config.lb_policy());
+  StaticClusterImpl cluster(cluster_config, runtime, stats, ssl_context_manager, cm, true);
+  EXPECT_EQ(LoadBalancerType::Maglev, cluster.info()->lbType());
+}
+
+TEST(StaticClusterImplTest, PeakEwma) {
+  Stats::IsolatedStoreImpl stats;
+  Ssl::MockContextManager ssl_context_manager;
+  NiceMock<Runtime::MockLoader> runtime;
+  const std::string json = R"EOF(
+  {
+    "name": "staticcluster",
+    "connect_timeout_ms": 250,
+    "type": "static",
+    "lb_type": "peak_ewma",
+    "hosts": [{"url": "tcp://10.0.0.1:11001"}]
+  }
+  )EOF";
+
+  NiceMock<MockClusterManager> cm;
+  envoy::api::v2::Cluster cluster_config = parseClusterFromJson(json);
+  EXPECT_EQ(envoy::api::v2::Cluster::LEAST_REQUEST, cluster_config.lb_policy());
+  StaticClusterImpl cluster(cluster_config, runtime, stats, ssl_context_manager, cm, true);
+  EXPECT_EQ(LoadBalancerType::PeakEwma, cluster.info()->lbType());
+}
+
+TEST(StaticClusterImplTest, NegativePrefetchRatio) {
+  Stats::IsolatedStoreImpl stats;
+  Ssl::MockContextManager ssl_context_manager;
+  NiceMock<Runtime::MockLoader> runtime;
+  const std::string yaml = R"EOF(
+    name: staticcluster
+    connect_timeout: 0.25s
+    type: STATIC
+    lb_policy: ROUND_ROBIN
+    hosts:
+    - socket_address:
+        address: 10.0.0.1
+        port_value: 11001
+    metadata:
+      filter_metadata:
+        envoy.lb:
+          prefetch_ratio: -1
+  )EOF";
+
+  NiceMock<MockClusterManager> cm;
+  EXPECT_THROW_WITH_MESSAGE(StaticClusterImpl(parseClusterFromV2Yaml(yaml), runtime, stats,
+                                              ssl_context_manager, cm, false),
+                            EnvoyException, "cluster: prefetch ratio must not be negative: -1");
+}
+
+TEST(StaticClusterImplTest, Http2ConnectionsPerHost) {
+  Stats::IsolatedStoreImpl stats;
+  Ssl::MockContextManager ssl_context_manager;
+  NiceMock<Runtime::MockLoader> runtime;
+  const std::string yaml = R"EOF(
+    name: staticcluster
+    connect_timeout: 0.25s
+    type: STATIC
+    lb_policy: ROUND_ROBIN
+    hosts:
+    - socket_address:
+        address: 10.0.0.1
+        port_value: 11001
+    metadata:
+      filter_metadata:
+        envoy.lb:
+          http2_connections_per_host: {}
+  )EOF";
+
+  NiceMock<MockClusterManager> cm;
+  {
+    StaticClusterImpl cluster(parseClusterFromV2Yaml(fmt::format(yaml, 4)), runtime, stats,
+                              ssl_context_manager, cm, false);
+    EXPECT_EQ(4U, cluster.info()->http2ConnectionsPerHost());
+  }
+  EXPECT_THROW_WITH_MESSAGE(StaticClusterImpl(parseClusterFromV2Yaml(fmt::format(yaml, 0.5)),
+                                              runtime, stats, ssl_context_manager, cm, false),
+                            EnvoyException,
+                            "cluster: HTTP/2 connections per host must be a positive integer: 0.5");
+}
+
+TEST(StaticClusterImplTest, IdleTimeout) {
+  Stats::IsolatedStoreImpl stats;
+  Ssl::MockContextManager ssl_context_manager;
+  NiceMock<Runtime::MockLoader> runtime;
+  const std::string yaml = R"EOF(
+    name: staticcluster
+    connect_timeout: 0.25s
+    type: STATIC
+    lb_policy: ROUND_ROBIN
+    hosts:
+    - socket_address:
+        address: 10.0.0.1
+        port_value: 11001
+    metadata:
+      filter_metadata:
+        envoy.lb:
+          idle_timeout_ms: 30000
+  )EOF";
+
+  NiceMock<MockClusterManager> cm;
+  StaticClusterImpl cluster(parseClusterFromV2Yaml(yaml), runtime, stats, ssl_context_manager, cm,
+                            false);
+  ASSERT_TRUE(cluster.info()->idleTimeout().valid());
+  EXPECT_EQ(std::chrono::milliseconds(30000), cluster.info()->idleTimeout().value());
+}
+
 TEST(StaticClusterImplTest, OutlierDetector) {
   Stats::IsolatedStoreImpl stats;
   Ssl::MockContextManager ssl_context_manager;
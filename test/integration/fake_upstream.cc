@@ -380,7 +380,22 @@ void FakeRawConnection::write(const std::string& data) {
   });
 }
 
+void FakeRawConnection::echo() {
+  connection_.dispatcher().post([this]() -> void {
+    std::unique_lock<std::mutex> lock(lock_);
+    echo_ = true;
+    Buffer::OwnedImpl received(data_);
+    data_.clear();
+    connection_.write(received);
+  });
+}
+
 Network::FilterStatus FakeRawConnection::ReadFilter::onData(Buffer::Instance& data) {
+  if (parent_.echo_) {
+    parent_.connection_.write(data);
+    return Network::FilterStatus::StopIteration;
+  }
+
   std::unique_lock<std::mutex> lock(parent_.lock_);
   ENVOY_LOG(debug, "got {} bytes", data.length());
   parent_.data_.append(TestUtility::bufferToString(data));
@@ -254,6 +254,9 @@ public:
 
   std::string waitForData(uint64_t num_bytes);
   void write(const std::string& data);
+  // Write the data received so far, and all data received from now on, back to the peer instead
+  // of keeping it for waitForData().
+  void echo();
 
 private:
   struct ReadFilter : public Network::ReadFilterBaseImpl {
@@ -266,6 +269,8 @@ private:
   };
 
   std::string data_;
+  // Only used on the connection's dispatcher thread.
+  bool echo_{};
 };
 
 typedef std::unique_ptr<FakeRawConnection> FakeRawConnectionPtr;
@@ -47,12 +47,33 @@ public:
   std::chrono::milliseconds fileFlushIntervalMsec() override {
     return std::chrono::milliseconds(50);
   }
+  Filesystem::OverflowPolicy fileWriteOverflowPolicy() override {
+    return Filesystem::OverflowPolicy::Spill;
+  }
   Mode mode() const override { return Mode::Serve; }
   const std::string& serviceClusterName() override { return service_cluster_name_; }
   const std::string& serviceNodeName() override { return service_node_name_; }
   const std::string& serviceZone() override { return service_zone_; }
   uint64_t maxStats() override { return 16384; }
   uint64_t maxObjNameLength() override { return 60; }
+  uint64_t bufferPoolMaxRetainedBytes() override { return 1024 * 1024; }
+  const std::vector<std::string>& shardedCounters() override { return sharded_counters_; }
+  uint64_t sslSessionCacheSize() override { return 0; }
+  std::chrono::seconds sslSessionCacheTimeout() override { return std::chrono::seconds(300); }
+  uint32_t sslPrivateKeyThreads() override { return 0; }
+  bool sslLazyCertificates() override { return false; }
+  bool workerLoopStats() override { return false; }
+  std::chrono::microseconds workerCallbackBudget() override {
+    return std::chrono::microseconds(0);
+  }
+  bool workerIoUring() override { return false; }
+  const std::vector<uint32_t>& workerCpuSet() override { return worker_cpu_set_; }
+  bool workerNumaLocalMemory() override { return false; }
+  bool dnsThread() override { return false; }
+  uint32_t dnsMaxConcurrentQueries() override { return 0; }
+  const std::string& rateLimitLocalConfigPath() override { return rate_limit_local_config_path_; }
+  std::chrono::seconds cpuProfileWindow() override { return std::chrono::seconds(0); }
+  const std::string& validatedConfigCachePath() override { return validated_config_cache_path_; }
 
 private:
   const std::string config_path_;
@@ -62,6 +83,10 @@ private:
   const std::string service_node_name_;
   const std::string service_zone_;
   const std::string log_path_;
+  const std::vector<std::string> sharded_counters_;
+  const std::vector<uint32_t> worker_cpu_set_;
+  const std::string rate_limit_local_config_path_;
+  const std::string validated_config_cache_path_;
 };
 
 class TestDrainManager : public DrainManager {
@@ -162,10 +187,24 @@ public:
     std::unique_lock<std::mutex> lock(lock_);
     return store_.gauges();
   }
+  std::list<ParentHistogramSharedPtr> histograms() const override {
+    std::unique_lock<std::mutex> lock(lock_);
+    return store_.histograms();
+  }
+  std::list<ScopeStatsInfo> scopes() const override {
+    std::unique_lock<std::mutex> lock(lock_);
+    return store_.scopes();
+  }
+  uint64_t numStatsCreated() const override {
+    std::unique_lock<std::mutex> lock(lock_);
+    return store_.numStatsCreated();
+  }
 
   // Stats::StoreRoot
   void addSink(Sink&) override {}
   void setTagExtractors(const std::vector<TagExtractorPtr>&) override {}
+  void setShardedCounters(const std::vector<std::string>&) override {}
+  void onStatsFlushed() override {}
   void initializeThreading(Event::Dispatcher&, ThreadLocal::Instance&) override {}
   void shutdownThreading() override {}
 
@@ -10,7 +10,7 @@ using testing::_;
 namespace Envoy {
 namespace AccessLog {
 
-MockFilter::MockFilter() {}
+MockFilter::MockFilter() { ON_CALL(*this, mayPass(_)).WillByDefault(Return(true)); }
 MockFilter::~MockFilter() {}
 
 MockAccessLogManager::MockAccessLogManager() {
@@ -19,7 +19,7 @@ MockAccessLogManager::MockAccessLogManager() {
 
 MockAccessLogManager::~MockAccessLogManager() {}
 
-MockInstance::MockInstance() {}
+MockInstance::MockInstance() { ON_CALL(*this, mayLog(_)).WillByDefault(Return(true)); }
 MockInstance::~MockInstance() {}
 
 } // namespace AccessLog
@@ -20,6 +20,7 @@ public:
   // AccessLog::Filter
   MOCK_METHOD2(evaluate,
                bool(const RequestInfo::RequestInfo& info, const Http::HeaderMap& request_headers));
+  MOCK_METHOD1(mayPass, bool(const Http::HeaderMap& request_headers));
 };
 
 class MockAccessLogManager : public AccessLogManager {
@@ -43,6 +44,7 @@ public:
   MOCK_METHOD3(log,
                void(const Http::HeaderMap* request_headers, const Http::HeaderMap* response_headers,
                     const RequestInfo::RequestInfo& request_info));
+  MOCK_METHOD1(mayLog, bool(const Http::HeaderMap& request_headers));
 };
 
 } // namespace AccessLog
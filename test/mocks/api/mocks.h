@@ -43,6 +43,8 @@ public:
 
   // Api::OsSysCalls
   ssize_t write(int fd, const void* buffer, size_t num_bytes) override;
+  // Gathers the buffers and passes them to write_() in a single call.
+  ssize_t writev(int fd, const iovec* iov, int iovcnt) override;
   int open(const std::string& full_path, int flags, int mode) override;
   MOCK_METHOD3(bind, int(int sockfd, const sockaddr* addr, socklen_t addrlen));
   MOCK_METHOD1(close, int(int));
@@ -14,6 +14,11 @@ public:
   MOCK_METHOD1_T(
       onConfigUpdate,
       void(const typename SubscriptionCallbacks<ResourceType>::ResourceVector& resources));
+  MOCK_CONST_METHOD0_T(supportsIncrementalUpdates, bool());
+  MOCK_METHOD2_T(onIncrementalConfigUpdate,
+                 void(const typename SubscriptionCallbacks<ResourceType>::ResourceVector&
+                          added_resources,
+                      const std::vector<std::string>& removed_resources));
   MOCK_METHOD1_T(onConfigUpdateFailed, void(const EnvoyException* e));
 };
 
@@ -56,6 +61,10 @@ public:
 
   MOCK_METHOD2(onConfigUpdate, void(const Protobuf::RepeatedPtrField<ProtobufWkt::Any>& resources,
                                     const std::string& version_info));
+  MOCK_METHOD3(onIncrementalConfigUpdate,
+               void(const Protobuf::RepeatedPtrField<ProtobufWkt::Any>& added_resources,
+                    const std::vector<std::string>& removed_resources,
+                    const std::string& version_info));
   MOCK_METHOD1(onConfigUpdateFailed, void(const EnvoyException* e));
 };
 
@@ -64,6 +64,9 @@ public:
 
   TimerPtr createTimer(TimerCb cb) override { return TimerPtr{createTimer_(cb)}; }
 
+  // Coarse timers are mocked like the other timers.
+  TimerPtr createCoarseTimer(TimerCb cb) override { return TimerPtr{createTimer_(cb)}; }
+
   void deferredDelete(DeferredDeletablePtr&& to_delete) override {
     deferredDelete_(to_delete);
     if (to_delete) {
@@ -103,6 +106,10 @@ public:
   MOCK_METHOD2(listenForSignal_, SignalEvent*(int signal_num, SignalCb cb));
   MOCK_METHOD1(post, void(std::function<void()> callback));
   MOCK_METHOD1(run, void(RunType type));
+  MOCK_METHOD2(initializeStats, void(Stats::Scope& scope, const std::string& prefix));
+  MOCK_METHOD1(setCallbackBudget, void(std::chrono::microseconds budget));
+  MOCK_METHOD0(enableIoUring, bool());
+  MOCK_CONST_METHOD0(pendingPosts, uint64_t());
   Buffer::WatermarkFactory& getWatermarkFactory() override { return buffer_factory_; }
 
   std::list<DeferredDeletablePtr> to_delete_;
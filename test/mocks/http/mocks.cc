@@ -69,11 +69,15 @@ MockClientConnection::~MockClientConnection() {}
 MockFilterChainFactory::MockFilterChainFactory() {}
 MockFilterChainFactory::~MockFilterChainFactory() {}
 
+MockHeaderOnlyResponder::MockHeaderOnlyResponder() {}
+MockHeaderOnlyResponder::~MockHeaderOnlyResponder() {}
+
 template <class T> static void initializeMockStreamFilterCallbacks(T& callbacks) {
   callbacks.route_.reset(new NiceMock<Router::MockRoute>());
   ON_CALL(callbacks, dispatcher()).WillByDefault(ReturnRef(callbacks.dispatcher_));
   ON_CALL(callbacks, requestInfo()).WillByDefault(ReturnRef(callbacks.request_info_));
   ON_CALL(callbacks, route()).WillByDefault(Return(callbacks.route_));
+  ON_CALL(callbacks, arena()).WillByDefault(ReturnRef(callbacks.arena_));
 }
 
 MockStreamDecoderFilterCallbacks::MockStreamDecoderFilterCallbacks() {
@@ -151,7 +155,9 @@ MockAsyncClientRequest::~MockAsyncClientRequest() { client_->onRequestDestroy();
 MockAsyncClientStream::MockAsyncClientStream() {}
 MockAsyncClientStream::~MockAsyncClientStream() {}
 
-MockFilterChainFactoryCallbacks::MockFilterChainFactoryCallbacks() {}
+MockFilterChainFactoryCallbacks::MockFilterChainFactoryCallbacks() {
+  ON_CALL(*this, arena()).WillByDefault(ReturnRef(arena_));
+}
 MockFilterChainFactoryCallbacks::~MockFilterChainFactoryCallbacks() {}
 
 } // namespace Http
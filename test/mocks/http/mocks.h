@@ -14,6 +14,7 @@
 #include "envoy/http/filter.h"
 #include "envoy/ssl/connection.h"
 
+#include "common/common/arena_impl.h"
 #include "common/http/conn_manager_impl.h"
 
 #include "test/mocks/common.h"
@@ -48,6 +49,7 @@ public:
   MOCK_METHOD0(filterFactory, FilterChainFactory&());
   MOCK_METHOD0(generateRequestId, bool());
   MOCK_METHOD0(idleTimeout, const Optional<std::chrono::milliseconds>&());
+  MOCK_METHOD0(maxPipelinedRequests, uint32_t());
   MOCK_METHOD0(routeConfigProvider, Router::RouteConfigProvider&());
   MOCK_METHOD0(serverName, const std::string&());
   MOCK_METHOD0(stats, ConnectionManagerStats&());
@@ -60,6 +62,7 @@ public:
   MOCK_METHOD0(userAgent, const Optional<std::string>&());
   MOCK_METHOD0(tracingConfig, const Http::TracingConnectionManagerConfig*());
   MOCK_METHOD0(listenerStats, ConnectionManagerListenerStats&());
+  MOCK_METHOD0(headerOnlyResponder, HeaderOnlyResponder*());
 };
 
 class MockConnectionCallbacks : public virtual ConnectionCallbacks {
@@ -194,11 +197,22 @@ public:
   MOCK_METHOD1(createFilterChain, void(FilterChainFactoryCallbacks& callbacks));
 };
 
+class MockHeaderOnlyResponder : public HeaderOnlyResponder {
+public:
+  MockHeaderOnlyResponder();
+  ~MockHeaderOnlyResponder();
+
+  // Http::HeaderOnlyResponder
+  MOCK_METHOD3(respond, bool(const HeaderMap& request_headers, HeaderMap& response_headers,
+                             RequestInfo::RequestInfo& request_info));
+};
+
 class MockStreamFilterCallbacksBase {
 public:
   Event::MockDispatcher dispatcher_;
   testing::NiceMock<RequestInfo::MockRequestInfo> request_info_;
   std::shared_ptr<Router::MockRoute> route_;
+  ArenaImpl arena_;
 };
 
 class MockStreamDecoderFilterCallbacks : public StreamDecoderFilterCallbacks,
@@ -217,6 +231,7 @@ public:
   MOCK_METHOD0(requestInfo, RequestInfo::RequestInfo&());
   MOCK_METHOD0(activeSpan, Tracing::Span&());
   MOCK_METHOD0(tracingConfig, Tracing::Config&());
+  MOCK_METHOD0(arena, Arena&());
   MOCK_METHOD0(onDecoderFilterAboveWriteBufferHighWatermark, void());
   MOCK_METHOD0(onDecoderFilterBelowWriteBufferLowWatermark, void());
   MOCK_METHOD1(addDownstreamWatermarkCallbacks, void(DownstreamWatermarkCallbacks&));
@@ -259,6 +274,7 @@ public:
   MOCK_METHOD0(requestInfo, RequestInfo::RequestInfo&());
   MOCK_METHOD0(activeSpan, Tracing::Span&());
   MOCK_METHOD0(tracingConfig, Tracing::Config&());
+  MOCK_METHOD0(arena, Arena&());
   MOCK_METHOD0(onEncoderFilterAboveWriteBufferHighWatermark, void());
   MOCK_METHOD0(onEncoderFilterBelowWriteBufferLowWatermark, void());
   MOCK_METHOD1(setEncoderBufferLimit, void(uint32_t));
@@ -404,6 +420,7 @@ public:
   MOCK_METHOD2(sendData, void(Buffer::Instance& data, bool end_stream));
   MOCK_METHOD1(sendTrailers, void(HeaderMap& trailers));
   MOCK_METHOD0(reset, void());
+  MOCK_CONST_METHOD0(isAboveWriteBufferHighWatermark, bool());
 };
 
 class MockFilterChainFactoryCallbacks : public Http::FilterChainFactoryCallbacks {
@@ -415,6 +432,10 @@ public:
   MOCK_METHOD1(addStreamEncoderFilter, void(Http::StreamEncoderFilterSharedPtr filter));
   MOCK_METHOD1(addStreamFilter, void(Http::StreamFilterSharedPtr filter));
   MOCK_METHOD1(addAccessLogHandler, void(AccessLog::InstanceSharedPtr handler));
+  MOCK_METHOD0(arena, Arena&());
+  MOCK_METHOD1(setFilterLatencyStats, void(const FilterLatencyStats* stats));
+
+  ArenaImpl arena_;
 };
 
 class MockDownstreamWatermarkCallbacks : public DownstreamWatermarkCallbacks {
@@ -446,6 +467,7 @@ public:
   MOCK_CONST_METHOD0(protocol, Http::Protocol());
   MOCK_METHOD1(addDrainedCallback, void(DrainedCb cb));
   MOCK_METHOD0(drainConnections, void());
+  MOCK_METHOD0(prefetch, void());
   MOCK_METHOD2(newStream, Cancellable*(Http::StreamDecoder& response_decoder,
                                        Http::ConnectionPool::Callbacks& callbacks));
 
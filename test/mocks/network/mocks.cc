@@ -67,6 +67,10 @@ template <class T> static void initializeMockConnection(T& connection) {
       .WillByDefault(Invoke([&connection](Network::ConnectionCallbacks& callbacks) -> void {
         connection.callbacks_.push_back(&callbacks);
       }));
+  ON_CALL(connection, removeConnectionCallbacks(_))
+      .WillByDefault(Invoke([&connection](Network::ConnectionCallbacks& callbacks) -> void {
+        connection.callbacks_.remove(&callbacks);
+      }));
   ON_CALL(connection, addBytesSentCallback(_))
       .WillByDefault(Invoke([&connection](Network::Connection::BytesSentCb cb) {
         connection.bytes_sent_callbacks_.emplace_back(cb);
@@ -78,6 +82,8 @@ template <class T> static void initializeMockConnection(T& connection) {
   ON_CALL(connection, localAddress()).WillByDefault(ReturnRef(connection.local_address_));
   ON_CALL(connection, id()).WillByDefault(Return(connection.next_id_));
   ON_CALL(connection, state()).WillByDefault(ReturnPointee(&connection.state_));
+  ON_CALL(connection, setMemoryAccount(_)).WillByDefault(SaveArg<0>(&connection.memory_account_));
+  ON_CALL(connection, memoryAccount()).WillByDefault(ReturnRef(connection.memory_account_));
 
   // The real implementation will move the buffer data into the socket.
   ON_CALL(connection, write(_)).WillByDefault(Invoke([](Buffer::Instance& buffer) -> void {
@@ -157,9 +163,17 @@ MockListener::~MockListener() { onDestroy(); }
 MockConnectionHandler::MockConnectionHandler() {}
 MockConnectionHandler::~MockConnectionHandler() {}
 
+MockBalancedConnectionHandler::MockBalancedConnectionHandler() {}
+MockBalancedConnectionHandler::~MockBalancedConnectionHandler() {}
+
 MockTransportSocket::MockTransportSocket() {}
 MockTransportSocket::~MockTransportSocket() {}
 
+MockTransportSocketCallbacks::MockTransportSocketCallbacks() {
+  ON_CALL(*this, connection()).WillByDefault(ReturnRef(connection_));
+}
+MockTransportSocketCallbacks::~MockTransportSocketCallbacks() {}
+
 MockTransportSocketFactory::MockTransportSocketFactory() {}
 MockTransportSocketFactory::~MockTransportSocketFactory() {}
 
@@ -45,6 +45,7 @@ public:
   Address::InstanceConstSharedPtr local_address_;
   bool read_enabled_{true};
   Connection::State state_{Connection::State::Open};
+  Buffer::MemoryAccountSharedPtr memory_account_;
 };
 
 class MockConnection : public Connection, public MockConnectionBase {
@@ -54,6 +55,7 @@ public:
 
   // Network::Connection
   MOCK_METHOD1(addConnectionCallbacks, void(ConnectionCallbacks& cb));
+  MOCK_METHOD1(removeConnectionCallbacks, void(ConnectionCallbacks& cb));
   MOCK_METHOD1(addBytesSentCallback, void(BytesSentCb cb));
   MOCK_METHOD1(addWriteFilter, void(WriteFilterSharedPtr filter));
   MOCK_METHOD1(addFilter, void(FilterSharedPtr filter));
@@ -76,8 +78,11 @@ public:
   MOCK_METHOD1(write, void(Buffer::Instance& data));
   MOCK_METHOD1(setBufferLimits, void(uint32_t limit));
   MOCK_CONST_METHOD0(bufferLimit, uint32_t());
+  MOCK_METHOD1(setMemoryAccount, void(const Buffer::MemoryAccountSharedPtr& account));
+  MOCK_CONST_METHOD0(memoryAccount, const Buffer::MemoryAccountSharedPtr&());
   MOCK_CONST_METHOD0(usingOriginalDst, bool());
   MOCK_CONST_METHOD0(aboveHighWatermark, bool());
+  MOCK_METHOD2(startSplice, bool(Connection& peer, SpliceCb cb));
 };
 
 /**
@@ -91,6 +96,7 @@ public:
 
   // Network::Connection
   MOCK_METHOD1(addConnectionCallbacks, void(ConnectionCallbacks& cb));
+  MOCK_METHOD1(removeConnectionCallbacks, void(ConnectionCallbacks& cb));
   MOCK_METHOD1(addBytesSentCallback, void(BytesSentCb cb));
   MOCK_METHOD1(addWriteFilter, void(WriteFilterSharedPtr filter));
   MOCK_METHOD1(addFilter, void(FilterSharedPtr filter));
@@ -113,11 +119,15 @@ public:
   MOCK_METHOD1(write, void(Buffer::Instance& data));
   MOCK_METHOD1(setBufferLimits, void(uint32_t limit));
   MOCK_CONST_METHOD0(bufferLimit, uint32_t());
+  MOCK_METHOD1(setMemoryAccount, void(const Buffer::MemoryAccountSharedPtr& account));
+  MOCK_CONST_METHOD0(memoryAccount, const Buffer::MemoryAccountSharedPtr&());
   MOCK_CONST_METHOD0(usingOriginalDst, bool());
   MOCK_CONST_METHOD0(aboveHighWatermark, bool());
+  MOCK_METHOD2(startSplice, bool(Connection& peer, SpliceCb cb));
 
   // Network::ClientConnection
   MOCK_METHOD0(connect, void());
+  MOCK_METHOD0(enableFastOpen, void());
 };
 
 class MockActiveDnsQuery : public ActiveDnsQuery {
@@ -137,6 +147,7 @@ public:
   // Network::DnsResolver
   MOCK_METHOD3(resolve, ActiveDnsQuery*(const std::string& dns_name,
                                         DnsLookupFamily dns_lookup_family, ResolveCb callback));
+  MOCK_METHOD2(initializeStats, void(Stats::Scope& scope, const std::string& prefix));
 
   testing::NiceMock<MockActiveDnsQuery> active_query_;
 };
@@ -255,6 +266,16 @@ public:
   MOCK_METHOD0(stopListeners, void());
 };
 
+class MockBalancedConnectionHandler : public BalancedConnectionHandler {
+public:
+  MockBalancedConnectionHandler();
+  ~MockBalancedConnectionHandler();
+
+  MOCK_METHOD0(numConnections, uint64_t());
+  MOCK_METHOD4(post, void(int fd, Address::InstanceConstSharedPtr remote_address,
+                          Address::InstanceConstSharedPtr local_address, bool using_original_dst));
+};
+
 class MockResolvedAddress : public Address::Instance {
 public:
   MockResolvedAddress(const std::string& logical, const std::string& physical)
@@ -293,6 +314,20 @@ public:
   MOCK_CONST_METHOD0(ssl, const Ssl::Connection*());
 };
 
+class MockTransportSocketCallbacks : public TransportSocketCallbacks {
+public:
+  MockTransportSocketCallbacks();
+  ~MockTransportSocketCallbacks();
+
+  MOCK_METHOD0(fd, int());
+  MOCK_METHOD0(connection, Network::Connection&());
+  MOCK_METHOD0(shouldDrainReadBuffer, bool());
+  MOCK_METHOD0(setReadBufferReady, void());
+  MOCK_METHOD1(raiseEvent, void(ConnectionEvent));
+
+  testing::NiceMock<MockConnection> connection_;
+};
+
 class MockTransportSocketFactory : public TransportSocketFactory {
 public:
   MockTransportSocketFactory();
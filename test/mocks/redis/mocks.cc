@@ -81,7 +81,13 @@ MockPoolRequest::~MockPoolRequest() {}
 MockPoolCallbacks::MockPoolCallbacks() {}
 MockPoolCallbacks::~MockPoolCallbacks() {}
 
-MockInstance::MockInstance() {}
+MockInstance::MockInstance() {
+  // By default every key is in a group of its own.
+  ON_CALL(*this, keyGroup(_)).WillByDefault(Invoke([](const std::string& hash_key) -> uint64_t {
+    return std::hash<std::string>()(hash_key);
+  }));
+}
+
 MockInstance::~MockInstance() {}
 
 } // namespace ConnPool
@@ -83,6 +83,7 @@ public:
 
   MOCK_METHOD3(makeRequest, PoolRequest*(const std::string& hash_key, const RespValue& request,
                                          PoolCallbacks& callbacks));
+  MOCK_METHOD1(keyGroup, uint64_t(const std::string& hash_key));
 };
 
 } // namespace ConnPool
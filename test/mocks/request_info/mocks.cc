@@ -19,6 +19,16 @@ MockRequestInfo::MockRequestInfo()
   ON_CALL(*this, startTime()).WillByDefault(ReturnPointee(&start_time_));
   ON_CALL(*this, requestReceivedDuration()).WillByDefault(ReturnRef(request_received_duration_));
   ON_CALL(*this, responseReceivedDuration()).WillByDefault(ReturnRef(response_received_duration_));
+  ON_CALL(*this, upstreamConnectStartDuration())
+      .WillByDefault(ReturnRef(upstream_connect_start_duration_));
+  ON_CALL(*this, upstreamConnectEndDuration())
+      .WillByDefault(ReturnRef(upstream_connect_end_duration_));
+  ON_CALL(*this, upstreamLastByteReceivedDuration())
+      .WillByDefault(ReturnRef(upstream_last_byte_received_duration_));
+  ON_CALL(*this, downstreamFirstByteSentDuration())
+      .WillByDefault(ReturnRef(downstream_first_byte_sent_duration_));
+  ON_CALL(*this, downstreamLastByteSentDuration())
+      .WillByDefault(ReturnRef(downstream_last_byte_sent_duration_));
   ON_CALL(*this, duration()).WillByDefault(ReturnPointee(&duration_));
   ON_CALL(*this, upstreamLocalAddress()).WillByDefault(ReturnRef(upstream_local_address_));
   ON_CALL(*this, downstreamLocalAddress()).WillByDefault(ReturnRef(downstream_local_address_));
@@ -22,6 +22,17 @@ public:
   MOCK_METHOD1(requestReceivedDuration, void(MonotonicTime time));
   MOCK_CONST_METHOD0(responseReceivedDuration, const Optional<std::chrono::microseconds>&());
   MOCK_METHOD1(responseReceivedDuration, void(MonotonicTime time));
+  MOCK_CONST_METHOD0(upstreamConnectStartDuration, const Optional<std::chrono::microseconds>&());
+  MOCK_METHOD1(upstreamConnectStartDuration, void(MonotonicTime time));
+  MOCK_CONST_METHOD0(upstreamConnectEndDuration, const Optional<std::chrono::microseconds>&());
+  MOCK_METHOD1(upstreamConnectEndDuration, void(MonotonicTime time));
+  MOCK_CONST_METHOD0(upstreamLastByteReceivedDuration,
+                     const Optional<std::chrono::microseconds>&());
+  MOCK_METHOD1(upstreamLastByteReceivedDuration, void(MonotonicTime time));
+  MOCK_CONST_METHOD0(downstreamFirstByteSentDuration, const Optional<std::chrono::microseconds>&());
+  MOCK_METHOD1(downstreamFirstByteSentDuration, void(MonotonicTime time));
+  MOCK_CONST_METHOD0(downstreamLastByteSentDuration, const Optional<std::chrono::microseconds>&());
+  MOCK_METHOD1(downstreamLastByteSentDuration, void(MonotonicTime time));
   MOCK_CONST_METHOD0(bytesReceived, uint64_t());
   MOCK_CONST_METHOD0(protocol, const Optional<Http::Protocol>&());
   MOCK_METHOD1(protocol, void(Http::Protocol protocol));
@@ -41,6 +52,11 @@ public:
   SystemTime start_time_;
   Optional<std::chrono::microseconds> request_received_duration_;
   Optional<std::chrono::microseconds> response_received_duration_;
+  Optional<std::chrono::microseconds> upstream_connect_start_duration_;
+  Optional<std::chrono::microseconds> upstream_connect_end_duration_;
+  Optional<std::chrono::microseconds> upstream_last_byte_received_duration_;
+  Optional<std::chrono::microseconds> downstream_first_byte_sent_duration_;
+  Optional<std::chrono::microseconds> downstream_last_byte_sent_duration_;
   std::chrono::microseconds duration_{};
   Network::Address::InstanceConstSharedPtr upstream_local_address_;
   Network::Address::InstanceConstSharedPtr downstream_local_address_;
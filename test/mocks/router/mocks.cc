@@ -17,6 +17,12 @@ namespace Router {
 MockRedirectEntry::MockRedirectEntry() {}
 MockRedirectEntry::~MockRedirectEntry() {}
 
+MockHedgePolicy::MockHedgePolicy() {
+  ON_CALL(*this, hedgeDelay()).WillByDefault(Return(std::chrono::milliseconds(0)));
+  ON_CALL(*this, tryHedge()).WillByDefault(Return(true));
+}
+MockHedgePolicy::~MockHedgePolicy() {}
+
 MockRetryState::MockRetryState() {}
 
 void MockRetryState::expectRetry() {
@@ -39,6 +45,9 @@ MockRateLimitPolicy::MockRateLimitPolicy() {
 
 MockRateLimitPolicy::~MockRateLimitPolicy() {}
 
+MockShadowStream::MockShadowStream() {}
+MockShadowStream::~MockShadowStream() {}
+
 MockShadowWriter::MockShadowWriter() {}
 MockShadowWriter::~MockShadowWriter() {}
 
@@ -41,6 +41,14 @@ class TestCorsPolicy : public CorsPolicy {
 public:
   // Router::CorsPolicy
   const std::list<std::string>& allowOrigins() const override { return allow_origin_; };
+  bool allowsOrigin(const Http::HeaderString& origin) const override {
+    for (const std::string& allowed : allow_origin_) {
+      if (allowed == "*" || origin == allowed.c_str()) {
+        return true;
+      }
+    }
+    return false;
+  }
   const std::string& allowMethods() const override { return allow_methods_; };
   const std::string& allowHeaders() const override { return allow_headers_; };
   const std::string& exposeHeaders() const override { return expose_headers_; };
@@ -63,10 +71,25 @@ public:
   std::chrono::milliseconds perTryTimeout() const override { return per_try_timeout_; }
   uint32_t numRetries() const override { return num_retries_; }
   uint32_t retryOn() const override { return retry_on_; }
+  const HedgePolicy* hedgePolicy() const override { return hedge_policy_; }
+  uint64_t maxReplayBytes() const override { return max_replay_bytes_; }
 
   std::chrono::milliseconds per_try_timeout_{0};
   uint32_t num_retries_{};
   uint32_t retry_on_{};
+  const HedgePolicy* hedge_policy_{};
+  uint64_t max_replay_bytes_{UINT64_MAX};
+};
+
+class MockHedgePolicy : public HedgePolicy {
+public:
+  MockHedgePolicy();
+  ~MockHedgePolicy();
+
+  // Router::HedgePolicy
+  MOCK_CONST_METHOD0(hedgeDelay, std::chrono::milliseconds());
+  MOCK_CONST_METHOD1(recordResponseTime, void(std::chrono::milliseconds time));
+  MOCK_CONST_METHOD0(tryHedge, bool());
 };
 
 class MockRetryState : public RetryState {
@@ -121,9 +144,21 @@ public:
   // Router::ShadowPolicy
   const std::string& cluster() const override { return cluster_; }
   const std::string& runtimeKey() const override { return runtime_key_; }
+  uint64_t maxBodyBytes() const override { return max_body_bytes_; }
 
   std::string cluster_;
   std::string runtime_key_;
+  uint64_t max_body_bytes_{1024 * 1024};
+};
+
+class MockShadowStream : public ShadowStream {
+public:
+  MockShadowStream();
+  ~MockShadowStream();
+
+  // Router::ShadowStream
+  MOCK_METHOD2(sendData, bool(Buffer::Instance& data, bool end_stream));
+  MOCK_METHOD1(sendTrailers, void(const Http::HeaderMap& trailers));
 };
 
 class MockShadowWriter : public ShadowWriter {
@@ -132,13 +167,15 @@ public:
   ~MockShadowWriter();
 
   // Router::ShadowWriter
-  void shadow(const std::string& cluster, Http::MessagePtr&& request,
-              std::chrono::milliseconds timeout) override {
-    shadow_(cluster, request, timeout);
+  ShadowStreamPtr start(const std::string& cluster, const Http::HeaderMap& headers,
+                        bool end_stream, std::chrono::milliseconds timeout,
+                        uint64_t max_body_bytes) override {
+    return ShadowStreamPtr{start_(cluster, headers, end_stream, timeout, max_body_bytes)};
   }
 
-  MOCK_METHOD3(shadow_, void(const std::string& cluster, Http::MessagePtr& request,
-                             std::chrono::milliseconds timeout));
+  MOCK_METHOD5(start_, ShadowStream*(const std::string& cluster, const Http::HeaderMap& headers,
+                                     bool end_stream, std::chrono::milliseconds timeout,
+                                     uint64_t max_body_bytes));
 };
 
 class TestVirtualCluster : public VirtualCluster {
@@ -192,6 +229,7 @@ public:
 
   // Router::Config
   MOCK_CONST_METHOD0(clusterName, const std::string&());
+  MOCK_CONST_METHOD0(clusterHandle, const Upstream::ClusterHandle*());
   MOCK_CONST_METHOD0(clusterNotFoundResponseCode, Http::Code());
   MOCK_CONST_METHOD2(finalizeRequestHeaders,
                      void(Http::HeaderMap& headers, const RequestInfo::RequestInfo& request_info));
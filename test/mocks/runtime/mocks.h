@@ -27,6 +27,10 @@ public:
   MockSnapshot();
   ~MockSnapshot();
 
+  // The lookups of registered keys are made by name.
+  using Snapshot::featureEnabled;
+  using Snapshot::getInteger;
+
   MOCK_CONST_METHOD2(featureEnabled, bool(const std::string& key, uint64_t default_value));
   MOCK_CONST_METHOD3(featureEnabled,
                      bool(const std::string& key, uint64_t default_value, uint64_t random_value));
@@ -35,6 +39,7 @@ public:
   MOCK_CONST_METHOD1(get, const std::string&(const std::string& key));
   MOCK_CONST_METHOD2(getInteger, uint64_t(const std::string& key, uint64_t default_value));
   MOCK_CONST_METHOD0(getAll, const std::unordered_map<std::string, const Snapshot::Entry>&());
+  MOCK_CONST_METHOD0(version, uint64_t());
 };
 
 class MockLoader : public Loader {
@@ -26,8 +26,28 @@ MockOptions::MockOptions(const std::string& config_path)
   ON_CALL(*this, serviceNodeName()).WillByDefault(ReturnRef(service_node_name_));
   ON_CALL(*this, serviceZone()).WillByDefault(ReturnRef(service_zone_name_));
   ON_CALL(*this, logPath()).WillByDefault(ReturnRef(log_path_));
+  ON_CALL(*this, fileWriteOverflowPolicy())
+      .WillByDefault(Return(Filesystem::OverflowPolicy::Spill));
   ON_CALL(*this, maxStats()).WillByDefault(Return(1000));
   ON_CALL(*this, maxObjNameLength()).WillByDefault(Return(150));
+  ON_CALL(*this, bufferPoolMaxRetainedBytes()).WillByDefault(Return(1024 * 1024));
+  ON_CALL(*this, shardedCounters()).WillByDefault(ReturnRef(sharded_counters_));
+  ON_CALL(*this, sslSessionCacheSize()).WillByDefault(Return(0));
+  ON_CALL(*this, sslSessionCacheTimeout()).WillByDefault(Return(std::chrono::seconds(300)));
+  ON_CALL(*this, sslPrivateKeyThreads()).WillByDefault(Return(0));
+  ON_CALL(*this, sslLazyCertificates()).WillByDefault(Return(false));
+  ON_CALL(*this, workerLoopStats()).WillByDefault(Return(false));
+  ON_CALL(*this, workerCallbackBudget()).WillByDefault(Return(std::chrono::microseconds(0)));
+  ON_CALL(*this, workerIoUring()).WillByDefault(Return(false));
+  ON_CALL(*this, workerCpuSet()).WillByDefault(ReturnRef(worker_cpu_set_));
+  ON_CALL(*this, workerNumaLocalMemory()).WillByDefault(Return(false));
+  ON_CALL(*this, dnsThread()).WillByDefault(Return(false));
+  ON_CALL(*this, dnsMaxConcurrentQueries()).WillByDefault(Return(0));
+  ON_CALL(*this, rateLimitLocalConfigPath())
+      .WillByDefault(ReturnRef(rate_limit_local_config_path_));
+  ON_CALL(*this, cpuProfileWindow()).WillByDefault(Return(std::chrono::seconds(0)));
+  ON_CALL(*this, validatedConfigCachePath())
+      .WillByDefault(ReturnRef(validated_config_cache_path_));
 }
 MockOptions::~MockOptions() {}
 
@@ -39,6 +59,9 @@ MockDrainManager::MockDrainManager() {
 }
 MockDrainManager::~MockDrainManager() {}
 
+MockOverloadManager::MockOverloadManager() {}
+MockOverloadManager::~MockOverloadManager() {}
+
 MockWatchDog::MockWatchDog() {}
 MockWatchDog::~MockWatchDog() {}
 
@@ -53,6 +76,7 @@ MockHotRestart::~MockHotRestart() {}
 MockListenerComponentFactory::MockListenerComponentFactory()
     : socket_(std::make_shared<NiceMock<Network::MockListenSocket>>()) {
   ON_CALL(*this, createListenSocket(_, _)).WillByDefault(Return(socket_));
+  ON_CALL(*this, createReusePortListenSocket(_, _)).WillByDefault(Return(socket_));
 }
 MockListenerComponentFactory::~MockListenerComponentFactory() {}
 
@@ -62,6 +86,7 @@ MockListenerManager::~MockListenerManager() {}
 MockListener::MockListener() {
   ON_CALL(*this, filterChainFactory()).WillByDefault(ReturnRef(filter_chain_factory_));
   ON_CALL(*this, socket()).WillByDefault(ReturnRef(socket_));
+  ON_CALL(*this, workerSocket(_)).WillByDefault(Return(&socket_));
   ON_CALL(*this, listenerScope()).WillByDefault(ReturnRef(scope_));
   ON_CALL(*this, name()).WillByDefault(ReturnRef(name_));
 }
@@ -102,6 +127,7 @@ MockInstance::MockInstance()
   ON_CALL(*this, random()).WillByDefault(ReturnRef(random_));
   ON_CALL(*this, localInfo()).WillByDefault(ReturnRef(local_info_));
   ON_CALL(*this, options()).WillByDefault(ReturnRef(options_));
+  ON_CALL(*this, overloadManager()).WillByDefault(ReturnRef(overload_manager_));
   ON_CALL(*this, drainManager()).WillByDefault(ReturnRef(drain_manager_));
   ON_CALL(*this, initManager()).WillByDefault(ReturnRef(init_manager_));
   ON_CALL(*this, listenerManager()).WillByDefault(ReturnRef(listener_manager_));
@@ -128,6 +154,7 @@ MockFactoryContext::MockFactoryContext() : singleton_manager_(new Singleton::Man
   ON_CALL(*this, httpTracer()).WillByDefault(ReturnRef(http_tracer_));
   ON_CALL(*this, initManager()).WillByDefault(ReturnRef(init_manager_));
   ON_CALL(*this, localInfo()).WillByDefault(ReturnRef(local_info_));
+  ON_CALL(*this, overloadManager()).WillByDefault(ReturnRef(overload_manager_));
   ON_CALL(*this, random()).WillByDefault(ReturnRef(random_));
   ON_CALL(*this, runtime()).WillByDefault(ReturnRef(runtime_loader_));
   ON_CALL(*this, scope()).WillByDefault(ReturnRef(scope_));
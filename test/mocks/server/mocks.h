@@ -11,6 +11,7 @@
 #include "envoy/server/filter_config.h"
 #include "envoy/server/instance.h"
 #include "envoy/server/options.h"
+#include "envoy/server/overload_manager.h"
 #include "envoy/server/transport_socket_config.h"
 #include "envoy/server/worker.h"
 #include "envoy/ssl/context_manager.h"
@@ -56,12 +57,29 @@ public:
   MOCK_METHOD0(parentShutdownTime, std::chrono::seconds());
   MOCK_METHOD0(restartEpoch, uint64_t());
   MOCK_METHOD0(fileFlushIntervalMsec, std::chrono::milliseconds());
+  MOCK_METHOD0(fileWriteOverflowPolicy, Filesystem::OverflowPolicy());
   MOCK_CONST_METHOD0(mode, Mode());
   MOCK_METHOD0(serviceClusterName, const std::string&());
   MOCK_METHOD0(serviceNodeName, const std::string&());
   MOCK_METHOD0(serviceZone, const std::string&());
   MOCK_METHOD0(maxStats, uint64_t());
   MOCK_METHOD0(maxObjNameLength, uint64_t());
+  MOCK_METHOD0(bufferPoolMaxRetainedBytes, uint64_t());
+  MOCK_METHOD0(shardedCounters, const std::vector<std::string>&());
+  MOCK_METHOD0(sslSessionCacheSize, uint64_t());
+  MOCK_METHOD0(sslSessionCacheTimeout, std::chrono::seconds());
+  MOCK_METHOD0(sslPrivateKeyThreads, uint32_t());
+  MOCK_METHOD0(sslLazyCertificates, bool());
+  MOCK_METHOD0(workerLoopStats, bool());
+  MOCK_METHOD0(workerCallbackBudget, std::chrono::microseconds());
+  MOCK_METHOD0(workerIoUring, bool());
+  MOCK_METHOD0(workerCpuSet, const std::vector<uint32_t>&());
+  MOCK_METHOD0(workerNumaLocalMemory, bool());
+  MOCK_METHOD0(dnsThread, bool());
+  MOCK_METHOD0(dnsMaxConcurrentQueries, uint32_t());
+  MOCK_METHOD0(rateLimitLocalConfigPath, const std::string&());
+  MOCK_METHOD0(cpuProfileWindow, std::chrono::seconds());
+  MOCK_METHOD0(validatedConfigCachePath, const std::string&());
 
   std::string config_path_;
   bool v2_config_only_{};
@@ -70,6 +88,10 @@ public:
   std::string service_node_name_;
   std::string service_zone_name_;
   std::string log_path_;
+  std::vector<std::string> sharded_counters_;
+  std::vector<uint32_t> worker_cpu_set_;
+  std::string rate_limit_local_config_path_;
+  std::string validated_config_cache_path_;
 };
 
 class MockAdmin : public Admin {
@@ -97,6 +119,16 @@ public:
   std::function<void()> drain_sequence_completion_;
 };
 
+class MockOverloadManager : public OverloadManager {
+public:
+  MockOverloadManager();
+  ~MockOverloadManager();
+
+  // Server::OverloadManager
+  MOCK_METHOD0(start, void());
+  MOCK_CONST_METHOD1(isActive, bool(OverloadAction action));
+};
+
 class MockWatchDog : public WatchDog {
 public:
   MockWatchDog();
@@ -128,13 +160,17 @@ public:
 
   // Server::HotRestart
   MOCK_METHOD0(drainParentListeners, void());
-  MOCK_METHOD1(duplicateParentListenSocket, int(const std::string& address));
+  MOCK_METHOD2(duplicateParentListenSocket,
+               int(const std::string& address, uint32_t worker_index));
   MOCK_METHOD1(getParentStats, void(GetParentStatsInfo& info));
   MOCK_METHOD2(initialize, void(Event::Dispatcher& dispatcher, Server::Instance& server));
   MOCK_METHOD1(shutdownParentAdmin, void(ShutdownParentAdminInfo& info));
   MOCK_METHOD0(terminateParent, void());
   MOCK_METHOD0(shutdown, void());
   MOCK_METHOD0(version, std::string());
+  MOCK_METHOD0(sessionCacheMemory, Ssl::SessionCacheMemory*());
+  MOCK_METHOD2(addStateExporter, void(const std::string& name, StateExporter exporter));
+  MOCK_METHOD1(getParentState, std::string(const std::string& name));
 };
 
 class MockListenerComponentFactory : public ListenerComponentFactory {
@@ -153,6 +189,9 @@ public:
   MOCK_METHOD2(createListenSocket,
                Network::ListenSocketSharedPtr(Network::Address::InstanceConstSharedPtr address,
                                               bool bind_to_port));
+  MOCK_METHOD2(createReusePortListenSocket,
+               Network::ListenSocketSharedPtr(Network::Address::InstanceConstSharedPtr address,
+                                              uint32_t worker_index));
   MOCK_METHOD1(createDrainManager_, DrainManager*(envoy::api::v2::Listener::DrainType drain_type));
   MOCK_METHOD0(nextListenerTag, uint64_t());
 
@@ -167,6 +206,7 @@ public:
   MOCK_METHOD2(addOrUpdateListener, bool(const envoy::api::v2::Listener& config, bool modifiable));
   MOCK_METHOD0(listeners, std::vector<std::reference_wrapper<Listener>>());
   MOCK_METHOD0(numConnections, uint64_t());
+  MOCK_METHOD0(workerLoads, std::vector<WorkerLoad>());
   MOCK_METHOD1(removeListener, bool(const std::string& listener_name));
   MOCK_METHOD1(startWorkers, void(GuardDog& guard_dog));
   MOCK_METHOD0(stopListeners, void());
@@ -180,11 +220,14 @@ public:
 
   MOCK_METHOD0(filterChainFactory, Network::FilterChainFactory&());
   MOCK_METHOD0(socket, Network::ListenSocket&());
+  MOCK_METHOD1(workerSocket, Network::ListenSocket*(uint32_t worker_index));
+  MOCK_METHOD0(connectionBalancer, Network::ConnectionBalancer*());
   MOCK_METHOD0(defaultSslContext, Ssl::ServerContext*());
   MOCK_METHOD0(useProxyProto, bool());
   MOCK_METHOD0(bindToPort, bool());
   MOCK_METHOD0(useOriginalDst, bool());
   MOCK_METHOD0(perConnectionBufferLimitBytes, uint32_t());
+  MOCK_METHOD0(acceptBatchSize, uint32_t());
   MOCK_METHOD0(listenerScope, Stats::Scope&());
   MOCK_METHOD0(listenerTag, uint64_t());
   MOCK_CONST_METHOD0(name, const std::string&());
@@ -201,7 +244,7 @@ public:
   ~MockWorkerFactory();
 
   // Server::WorkerFactory
-  WorkerPtr createWorker() override { return WorkerPtr{createWorker_()}; }
+  WorkerPtr createWorker(uint32_t) override { return WorkerPtr{createWorker_()}; }
 
   MOCK_METHOD0(createWorker_, Worker*());
 };
@@ -226,6 +269,7 @@ public:
   // Server::Worker
   MOCK_METHOD2(addListener, void(Listener& listener, AddListenerCompletion completion));
   MOCK_METHOD0(numConnections, uint64_t());
+  MOCK_METHOD0(load, WorkerLoad());
   MOCK_METHOD2(removeListener, void(Listener& listener, std::function<void()> completion));
   MOCK_METHOD1(start, void(GuardDog& guard_dog));
   MOCK_METHOD0(stop, void());
@@ -262,6 +306,7 @@ public:
   MOCK_METHOD0(initManager, Init::Manager&());
   MOCK_METHOD0(listenerManager, ListenerManager&());
   MOCK_METHOD0(options, Options&());
+  MOCK_METHOD0(overloadManager, OverloadManager&());
   MOCK_METHOD0(random, Runtime::RandomGenerator&());
   MOCK_METHOD0(rateLimitClient_, RateLimit::Client*());
   MOCK_METHOD0(runtime, Runtime::Loader&());
@@ -291,6 +336,7 @@ public:
   testing::NiceMock<AccessLog::MockAccessLogManager> access_log_manager_;
   testing::NiceMock<MockHotRestart> hot_restart_;
   testing::NiceMock<MockOptions> options_;
+  testing::NiceMock<MockOverloadManager> overload_manager_;
   testing::NiceMock<Runtime::MockRandomGenerator> random_;
   testing::NiceMock<LocalInfo::MockLocalInfo> local_info_;
   testing::NiceMock<Init::MockManager> init_manager_;
@@ -338,6 +384,7 @@ public:
   MOCK_METHOD0(httpTracer, Tracing::HttpTracer&());
   MOCK_METHOD0(initManager, Init::Manager&());
   MOCK_METHOD0(localInfo, const LocalInfo::LocalInfo&());
+  MOCK_METHOD0(overloadManager, OverloadManager&());
   MOCK_METHOD0(random, Envoy::Runtime::RandomGenerator&());
   MOCK_METHOD0(rateLimitClient_, RateLimit::Client*());
   MOCK_METHOD0(runtime, Envoy::Runtime::Loader&());
@@ -354,6 +401,7 @@ public:
   testing::NiceMock<Tracing::MockHttpTracer> http_tracer_;
   testing::NiceMock<Init::MockManager> init_manager_;
   testing::NiceMock<LocalInfo::MockLocalInfo> local_info_;
+  testing::NiceMock<MockOverloadManager> overload_manager_;
   testing::NiceMock<Envoy::Runtime::MockRandomGenerator> random_;
   testing::NiceMock<Envoy::Runtime::MockLoader> runtime_loader_;
   Stats::IsolatedStoreImpl scope_;
@@ -25,6 +25,9 @@ public:
   MOCK_METHOD0(shutdownGlobalThreading, void());
   MOCK_METHOD0(shutdownThread, void());
   MOCK_METHOD0(dispatcher, Event::Dispatcher&());
+  MOCK_METHOD0(beginBatch, void());
+  MOCK_METHOD0(flushBatch, void());
+  MOCK_METHOD0(endBatch, void());
 
   SlotPtr allocateSlot_() { return SlotPtr{new SlotImpl(*this, current_slot_++)}; }
   void runOnAllThreads_(Event::PostCb cb) { cb(); }
@@ -33,8 +33,18 @@ MockClusterInfo::MockClusterInfo()
   ON_CALL(*this, http2Settings()).WillByDefault(ReturnRef(http2_settings_));
   ON_CALL(*this, maxRequestsPerConnection())
       .WillByDefault(ReturnPointee(&max_requests_per_connection_));
+  ON_CALL(*this, idleTimeout()).WillByDefault(ReturnRef(idle_timeout_));
+  ON_CALL(*this, updateMergeWindow()).WillByDefault(ReturnRef(update_merge_window_));
+  ON_CALL(*this, prefetchRatio()).WillByDefault(ReturnPointee(&prefetch_ratio_));
+  ON_CALL(*this, http2ConnectionsPerHost())
+      .WillByDefault(ReturnPointee(&http2_connections_per_host_));
+  ON_CALL(*this, workerSubsets()).WillByDefault(ReturnPointee(&worker_subsets_));
+  ON_CALL(*this, healthCheckPartitions()).WillByDefault(ReturnPointee(&health_check_partitions_));
+  ON_CALL(*this, tcpPreconnectPerHost()).WillByDefault(ReturnPointee(&tcp_preconnect_per_host_));
+  ON_CALL(*this, tcpPreconnectMaxAge()).WillByDefault(ReturnPointee(&tcp_preconnect_max_age_));
   ON_CALL(*this, stats()).WillByDefault(ReturnRef(stats_));
   ON_CALL(*this, statsScope()).WillByDefault(ReturnRef(stats_store_));
+  ON_CALL(*this, codeStats()).WillByDefault(ReturnRef(code_stats_));
   ON_CALL(*this, transportSocketFactory()).WillByDefault(ReturnRef(*transport_socket_factory_));
   ON_CALL(*this, loadReportStats()).WillByDefault(ReturnRef(load_report_stats_));
   ON_CALL(*this, sourceAddress()).WillByDefault(ReturnRef(source_address_));
@@ -45,6 +55,7 @@ MockClusterInfo::MockClusterInfo()
   ON_CALL(*this, sourceAddress()).WillByDefault(ReturnRef(source_address_));
   ON_CALL(*this, lbSubsetInfo()).WillByDefault(ReturnRef(lb_subset_));
   ON_CALL(*this, lbRingHashConfig()).WillByDefault(ReturnRef(lb_ring_hash_config_));
+  ON_CALL(*this, metadata()).WillByDefault(ReturnRef(metadata_));
 }
 
 MockClusterInfo::~MockClusterInfo() {}
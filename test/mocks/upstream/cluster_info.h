@@ -8,6 +8,8 @@
 #include "envoy/upstream/cluster_manager.h"
 #include "envoy/upstream/upstream.h"
 
+#include "common/http/codes.h"
+
 #include "test/mocks/runtime/mocks.h"
 #include "test/mocks/stats/mocks.h"
 
@@ -43,19 +45,30 @@ public:
   MOCK_CONST_METHOD0(addedViaApi, bool());
   MOCK_CONST_METHOD0(connectTimeout, std::chrono::milliseconds());
   MOCK_CONST_METHOD0(perConnectionBufferLimitBytes, uint32_t());
+  MOCK_CONST_METHOD0(tcpFastOpen, bool());
   MOCK_CONST_METHOD0(features, uint64_t());
   MOCK_CONST_METHOD0(http2Settings, const Http::Http2Settings&());
+  MOCK_CONST_METHOD0(http1Settings, Http::Http1Settings());
   MOCK_CONST_METHOD0(lbType, LoadBalancerType());
   MOCK_CONST_METHOD0(type, envoy::api::v2::Cluster::DiscoveryType());
   MOCK_CONST_METHOD0(lbRingHashConfig,
                      const Optional<envoy::api::v2::Cluster::RingHashLbConfig>&());
   MOCK_CONST_METHOD0(maintenanceMode, bool());
   MOCK_CONST_METHOD0(maxRequestsPerConnection, uint64_t());
+  MOCK_CONST_METHOD0(idleTimeout, const Optional<std::chrono::milliseconds>&());
+  MOCK_CONST_METHOD0(updateMergeWindow, const Optional<std::chrono::milliseconds>&());
+  MOCK_CONST_METHOD0(prefetchRatio, double());
+  MOCK_CONST_METHOD0(http2ConnectionsPerHost, uint32_t());
+  MOCK_CONST_METHOD0(workerSubsets, uint32_t());
+  MOCK_CONST_METHOD0(healthCheckPartitions, uint32_t());
+  MOCK_CONST_METHOD0(tcpPreconnectPerHost, uint32_t());
+  MOCK_CONST_METHOD0(tcpPreconnectMaxAge, std::chrono::milliseconds());
   MOCK_CONST_METHOD0(name, const std::string&());
   MOCK_CONST_METHOD1(resourceManager, ResourceManager&(ResourcePriority priority));
   MOCK_CONST_METHOD0(transportSocketFactory, Network::TransportSocketFactory&());
   MOCK_CONST_METHOD0(stats, ClusterStats&());
   MOCK_CONST_METHOD0(statsScope, Stats::Scope&());
+  MOCK_CONST_METHOD0(codeStats, Http::CodeStats&());
   MOCK_CONST_METHOD0(loadReportStats, ClusterLoadReportStats&());
   MOCK_CONST_METHOD0(sourceAddress, const Network::Address::InstanceConstSharedPtr&());
   MOCK_CONST_METHOD0(lbSubsetInfo, const LoadBalancerSubsetInfo&());
@@ -64,8 +77,17 @@ public:
   std::string name_{"fake_cluster"};
   Http::Http2Settings http2_settings_{};
   uint64_t max_requests_per_connection_{};
+  Optional<std::chrono::milliseconds> idle_timeout_;
+  Optional<std::chrono::milliseconds> update_merge_window_;
+  double prefetch_ratio_{};
+  uint32_t http2_connections_per_host_{1};
+  uint32_t worker_subsets_{1};
+  uint32_t health_check_partitions_{1};
+  uint32_t tcp_preconnect_per_host_{};
+  std::chrono::milliseconds tcp_preconnect_max_age_{60000};
   NiceMock<Stats::MockIsolatedStatsStore> stats_store_;
   ClusterStats stats_;
+  Http::CodeStatsImpl code_stats_{stats_store_};
   Network::TransportSocketFactoryPtr transport_socket_factory_;
   NiceMock<Stats::MockIsolatedStatsStore> load_report_stats_store_;
   ClusterLoadReportStats load_report_stats_;
@@ -76,6 +98,7 @@ public:
   envoy::api::v2::Cluster::DiscoveryType type_{envoy::api::v2::Cluster::STRICT_DNS};
   NiceMock<MockLoadBalancerSubsetInfo> lb_subset_;
   Optional<envoy::api::v2::Cluster::RingHashLbConfig> lb_ring_hash_config_;
+  envoy::api::v2::Metadata metadata_;
 };
 
 } // namespace Upstream
@@ -30,6 +30,7 @@ public:
   MOCK_METHOD0(lastUnejectionTime, const Optional<MonotonicTime>&());
   MOCK_CONST_METHOD0(successRate, double());
   MOCK_METHOD1(successRate, void(double new_success_rate));
+  MOCK_CONST_METHOD0(latency, double());
 };
 
 class MockEventLogger : public EventLogger {
@@ -56,6 +57,7 @@ public:
   MOCK_METHOD1(addChangedStateCb, void(ChangeStateCb cb));
   MOCK_CONST_METHOD0(successRateAverage, double());
   MOCK_CONST_METHOD0(successRateEjectionThreshold, double());
+  MOCK_CONST_METHOD0(latencyEjectionThreshold, double());
 
   std::list<ChangeStateCb> callbacks_;
 };
@@ -84,6 +86,8 @@ public:
   MOCK_CONST_METHOD0(hostname, const std::string&());
   MOCK_CONST_METHOD0(stats, HostStats&());
   MOCK_CONST_METHOD0(locality, const envoy::api::v2::Locality&());
+  MOCK_CONST_METHOD1(putResponseTime, void(std::chrono::milliseconds time));
+  MOCK_CONST_METHOD0(responseTimeEstimate, double());
 
   std::string hostname_;
   Network::Address::InstanceConstSharedPtr address_;
@@ -99,6 +103,7 @@ public:
   struct MockCreateConnectionData {
     Network::ClientConnection* connection_{};
     HostDescriptionConstSharedPtr host_description_{};
+    bool preconnected_{};
   };
 
   MockHost();
@@ -106,7 +111,8 @@ public:
 
   CreateConnectionData createConnection(Event::Dispatcher& dispatcher) const override {
     MockCreateConnectionData data = createConnection_(dispatcher);
-    return {Network::ClientConnectionPtr{data.connection_}, data.host_description_};
+    return {Network::ClientConnectionPtr{data.connection_}, data.host_description_,
+            data.preconnected_};
   }
 
   void setHealthChecker(HealthCheckHostMonitorPtr&& health_checker) override {
@@ -139,6 +145,8 @@ public:
   MOCK_CONST_METHOD0(used, bool());
   MOCK_METHOD1(used, void(bool new_used));
   MOCK_CONST_METHOD0(locality, const envoy::api::v2::Locality&());
+  MOCK_CONST_METHOD1(putResponseTime, void(std::chrono::milliseconds time));
+  MOCK_CONST_METHOD0(responseTimeEstimate, double());
 
   testing::NiceMock<MockClusterInfo> cluster_;
   testing::NiceMock<Outlier::MockDetectorHostMonitor> outlier_detector_;
@@ -24,6 +24,21 @@ MockHostSet::MockHostSet(uint32_t priority) : priority_(priority) {
   ON_CALL(*this, healthyHosts()).WillByDefault(ReturnRef(healthy_hosts_));
   ON_CALL(*this, hostsPerLocality()).WillByDefault(ReturnRef(hosts_per_locality_));
   ON_CALL(*this, healthyHostsPerLocality()).WillByDefault(ReturnRef(healthy_hosts_per_locality_));
+  // The tests modify the member lists in place, so hand out snapshots of them.
+  ON_CALL(*this, hostsPtr()).WillByDefault(Invoke([this]() -> HostVectorConstSharedPtr {
+    return std::make_shared<const std::vector<HostSharedPtr>>(hosts_);
+  }));
+  ON_CALL(*this, healthyHostsPtr()).WillByDefault(Invoke([this]() -> HostVectorConstSharedPtr {
+    return std::make_shared<const std::vector<HostSharedPtr>>(healthy_hosts_);
+  }));
+  ON_CALL(*this, hostsPerLocalityPtr()).WillByDefault(Invoke([this]() -> HostListsConstSharedPtr {
+    return std::make_shared<const std::vector<std::vector<HostSharedPtr>>>(hosts_per_locality_);
+  }));
+  ON_CALL(*this, healthyHostsPerLocalityPtr())
+      .WillByDefault(Invoke([this]() -> HostListsConstSharedPtr {
+        return std::make_shared<const std::vector<std::vector<HostSharedPtr>>>(
+            healthy_hosts_per_locality_);
+      }));
 }
 
 MockPrioritySet::MockPrioritySet() {
@@ -81,6 +96,9 @@ MockThreadLocalCluster::MockThreadLocalCluster() {
 
 MockThreadLocalCluster::~MockThreadLocalCluster() {}
 
+MockClusterHandle::MockClusterHandle() {}
+MockClusterHandle::~MockClusterHandle() {}
+
 MockClusterManager::MockClusterManager() {
   ON_CALL(*this, httpConnPoolForCluster(_, _, _, _)).WillByDefault(Return(&conn_pool_));
   ON_CALL(*this, httpAsyncClientForCluster(_)).WillByDefault(ReturnRef(async_client_));
@@ -92,6 +110,14 @@ MockClusterManager::MockClusterManager() {
   // Matches are LIFO so "" will match first.
   ON_CALL(*this, get(_)).WillByDefault(Return(&thread_local_cluster_));
   ON_CALL(*this, get("")).WillByDefault(Return(nullptr));
+
+  // The thread local cluster hands out the connection pools of the cluster manager.
+  ON_CALL(thread_local_cluster_, httpConnPool(_, _, _))
+      .WillByDefault(Invoke([this](ResourcePriority priority, Http::Protocol protocol,
+                                   LoadBalancerContext* context) {
+        return httpConnPoolForCluster(thread_local_cluster_.info()->name(), priority, protocol,
+                                      context);
+      }));
 }
 
 MockClusterManager::~MockClusterManager() {}
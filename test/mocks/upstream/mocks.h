@@ -45,6 +45,12 @@ public:
   MOCK_CONST_METHOD0(healthyHosts, const std::vector<HostSharedPtr>&());
   MOCK_CONST_METHOD0(hostsPerLocality, const std::vector<std::vector<HostSharedPtr>>&());
   MOCK_CONST_METHOD0(healthyHostsPerLocality, const std::vector<std::vector<HostSharedPtr>>&());
+  MOCK_CONST_METHOD0(hostsPtr, std::shared_ptr<const std::vector<HostSharedPtr>>());
+  MOCK_CONST_METHOD0(healthyHostsPtr, std::shared_ptr<const std::vector<HostSharedPtr>>());
+  MOCK_CONST_METHOD0(hostsPerLocalityPtr,
+                     std::shared_ptr<const std::vector<std::vector<HostSharedPtr>>>());
+  MOCK_CONST_METHOD0(healthyHostsPerLocalityPtr,
+                     std::shared_ptr<const std::vector<std::vector<HostSharedPtr>>>());
   MOCK_METHOD6(
       updateHosts,
       void(
@@ -132,11 +138,23 @@ public:
   MOCK_METHOD0(prioritySet, const PrioritySet&());
   MOCK_METHOD0(info, ClusterInfoConstSharedPtr());
   MOCK_METHOD0(loadBalancer, LoadBalancer&());
+  MOCK_METHOD3(httpConnPool,
+               Http::ConnectionPool::Instance*(ResourcePriority priority, Http::Protocol protocol,
+                                               LoadBalancerContext* context));
 
   NiceMock<MockCluster> cluster_;
   NiceMock<MockLoadBalancer> lb_;
 };
 
+class MockClusterHandle : public ClusterHandle {
+public:
+  MockClusterHandle();
+  ~MockClusterHandle();
+
+  // Upstream::ClusterHandle
+  MOCK_CONST_METHOD0(get, ThreadLocalCluster*());
+};
+
 class MockClusterManager : public ClusterManager {
 public:
   MockClusterManager();
@@ -145,14 +163,21 @@ public:
   Host::CreateConnectionData tcpConnForCluster(const std::string& cluster,
                                                LoadBalancerContext* context) override {
     MockHost::MockCreateConnectionData data = tcpConnForCluster_(cluster, context);
-    return {Network::ClientConnectionPtr{data.connection_}, data.host_description_};
+    return {Network::ClientConnectionPtr{data.connection_}, data.host_description_,
+            data.preconnected_};
+  }
+
+  ClusterHandlePtr clusterHandle(const std::string& cluster) override {
+    return ClusterHandlePtr{clusterHandle_(cluster)};
   }
 
   // Upstream::ClusterManager
   MOCK_METHOD1(addOrUpdatePrimaryCluster, bool(const envoy::api::v2::Cluster& cluster));
+  MOCK_METHOD1(prepareClusters, void(const std::vector<const envoy::api::v2::Cluster*>& clusters));
   MOCK_METHOD1(setInitializedCb, void(std::function<void()>));
   MOCK_METHOD0(clusters, ClusterInfoMap());
   MOCK_METHOD1(get, ThreadLocalCluster*(const std::string& cluster));
+  MOCK_METHOD1(clusterHandle_, ClusterHandle*(const std::string& cluster));
   MOCK_METHOD4(httpConnPoolForCluster,
                Http::ConnectionPool::Instance*(const std::string& cluster,
                                                ResourcePriority priority, Http::Protocol protocol,
@@ -162,6 +187,8 @@ public:
                                                   LoadBalancerContext* context));
   MOCK_METHOD1(httpAsyncClientForCluster, Http::AsyncClient&(const std::string& cluster));
   MOCK_METHOD1(removePrimaryCluster, bool(const std::string& cluster));
+  MOCK_METHOD2(inheritUnhealthyHosts,
+               void(const std::string& cluster, const std::vector<std::string>& addresses));
   MOCK_METHOD0(shutdown, void());
   MOCK_CONST_METHOD0(sourceAddress, const Network::Address::InstanceConstSharedPtr&());
   MOCK_METHOD0(adsMux, Config::GrpcMux&());
@@ -183,6 +210,7 @@ public:
 
   MOCK_METHOD1(addHostCheckCompleteCb, void(HostStatusCb callback));
   MOCK_METHOD0(start, void());
+  MOCK_METHOD1(inheritUnhealthyHosts, void(const std::vector<std::string>& addresses));
 
   void runCallbacks(Upstream::HostSharedPtr host, bool changed_state) {
     for (const auto& callback : callbacks_) {
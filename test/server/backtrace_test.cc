@@ -12,9 +12,18 @@ TEST(Backward, Basic) {
   tracer.logTrace();
 }
 
+TEST(Backward, TraceString) {
+  BackwardsTrace tracer;
+  tracer.capture();
+  const std::string trace = tracer.traceString();
+  EXPECT_EQ(0U, trace.find("Backtrace obj<"));
+  EXPECT_NE(std::string::npos, trace.find("end backtrace thread"));
+}
+
 TEST(Backward, InvalidUsageTest) {
   // Ensure we do not crash if logging is attempted when there was no trace captured
   BackwardsTrace tracer;
   tracer.logTrace();
+  EXPECT_EQ("", tracer.traceString());
 }
 } // namespace Envoy
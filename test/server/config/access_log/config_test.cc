@@ -1,8 +1,10 @@
 #include "envoy/registry/registry.h"
 #include "envoy/server/access_log_config.h"
 
+#include "common/access_log/access_log_impl.h"
 #include "common/access_log/grpc_access_log_impl.h"
 #include "common/config/well_known_names.h"
+#include "common/protobuf/utility.h"
 
 #include "test/mocks/server/mocks.h"
 
@@ -36,6 +38,35 @@ TEST(AccessLogConfigTest, HttpGrpcAccessLogTest) {
   EXPECT_NE(nullptr, dynamic_cast<AccessLog::HttpGrpcAccessLog*>(instance.get()));
 }
 
+TEST(AccessLogConfigTest, StructuredFileAccessLogTest) {
+  auto factory = Registry::FactoryRegistry<AccessLogInstanceFactory>::getFactory(
+      Config::AccessLogNames::get().STRUCTURED_FILE);
+  ASSERT_NE(nullptr, factory);
+  NiceMock<Server::Configuration::MockFactoryContext> context;
+
+  for (const std::string& json : {
+           R"EOF({"path": "/dev/null"})EOF",
+           R"EOF({"path": "/dev/null", "fields": {"code": "%RESPONSE_CODE%"}})EOF",
+           R"EOF({"path": "/dev/null", "format": "binary"})EOF",
+       }) {
+    ProtobufTypes::MessagePtr message = factory->createEmptyConfigProto();
+    MessageUtil::loadFromJson(json, *message);
+    AccessLog::InstanceSharedPtr instance =
+        factory->createAccessLogInstance(*message, nullptr, context);
+    EXPECT_NE(nullptr, dynamic_cast<AccessLog::FileAccessLog*>(instance.get()));
+  }
+
+  for (const std::string& json : {
+           R"EOF({"path": "/dev/null", "format": "text"})EOF",
+           R"EOF({"path": "/dev/null", "format": "binary", "fields": {}})EOF",
+           R"EOF({"path": "/dev/null", "fields": {"code": "%RESPONSE_CODE"}})EOF",
+       }) {
+    ProtobufTypes::MessagePtr message = factory->createEmptyConfigProto();
+    MessageUtil::loadFromJson(json, *message);
+    EXPECT_THROW(factory->createAccessLogInstance(*message, nullptr, context), EnvoyException);
+  }
+}
+
 } // namespace Configuration
 } // namespace Server
 } // namespace Envoy
@@ -13,7 +13,11 @@
 #include "gmock/gmock.h"
 #include "gtest/gtest.h"
 
+using testing::_;
 using testing::ContainerEq;
+using testing::InSequence;
+using testing::Invoke;
+using testing::NotNull;
 using testing::Return;
 
 namespace Envoy {
@@ -110,6 +114,63 @@ TEST_F(HttpConnectionManagerConfigTest, MiscConfig) {
   EXPECT_EQ("foo", config.serverName());
 }
 
+TEST_F(HttpConnectionManagerConfigTest, FilterLatencyStats) {
+  const std::string json_string = R"EOF(
+  {
+    "codec_type": "http1",
+    "stat_prefix": "router",
+    "route_config":
+    {
+      "virtual_hosts": [
+        {
+          "name": "service",
+          "domains": [ "*" ],
+          "routes": [
+            {
+              "prefix": "/",
+              "cluster": "cluster"
+            }
+          ]
+        }
+      ]
+    },
+    "filters": [
+      { "name": "http_dynamo_filter", "config": {} }
+    ]
+  }
+  )EOF";
+
+  HttpConnectionManagerConfig config(parseHttpConnectionManagerFromJson(json_string), context_,
+                                     date_provider_, route_config_provider_manager_);
+
+  // Filters are not timed unless the runtime enables it for the stream.
+  {
+    NiceMock<Http::MockFilterChainFactoryCallbacks> callbacks;
+    EXPECT_CALL(context_.runtime_loader_.snapshot_,
+                featureEnabled("http_connection_manager.filter_latency_stats", 0))
+        .WillOnce(Return(false));
+    EXPECT_CALL(callbacks, setFilterLatencyStats(_)).Times(0);
+    EXPECT_CALL(callbacks, addStreamFilter(_));
+    config.createFilterChain(callbacks);
+  }
+
+  {
+    NiceMock<Http::MockFilterChainFactoryCallbacks> callbacks;
+    EXPECT_CALL(context_.runtime_loader_.snapshot_,
+                featureEnabled("http_connection_manager.filter_latency_stats", 0))
+        .WillOnce(Return(true));
+    InSequence s;
+    EXPECT_CALL(callbacks, setFilterLatencyStats(NotNull()))
+        .WillOnce(Invoke([](const Http::FilterLatencyStats* stats) -> void {
+          EXPECT_EQ("http.router.filter.envoy.http_dynamo_filter.decode_headers_us",
+                    stats->decode_headers_us_.name());
+        }));
+    EXPECT_CALL(callbacks, addStreamFilter(_));
+    EXPECT_CALL(callbacks, setFilterLatencyStats(nullptr));
+    config.createFilterChain(callbacks);
+  }
+}
+
 TEST_F(HttpConnectionManagerConfigTest, SingleDateProvider) {
   const std::string json_string = R"EOF(
   {
@@ -4,9 +4,11 @@
 
 #include "common/config/well_known_names.h"
 #include "common/protobuf/utility.h"
+#include "common/stats/grpc_metrics_service_impl.h"
 #include "common/stats/statsd.h"
 
 #include "server/config/stats/dog_statsd.h"
+#include "server/config/stats/metrics_service.h"
 #include "server/config/stats/statsd.h"
 
 #include "test/mocks/server/mocks.h"
@@ -115,6 +117,36 @@ TEST(DogStatsdConfigTest, ValidateFail) {
                ProtoValidationException);
 }
 
+TEST(MetricsServiceConfigTest, ValidGrpcCluster) {
+  const std::string name = Config::StatsSinkNames::get().METRICS_SERVICE;
+
+  envoy::metrics::MetricsServiceSinkConfig sink_config;
+  sink_config.set_grpc_cluster_name("fake_cluster");
+
+  StatsSinkFactory* factory = Registry::FactoryRegistry<StatsSinkFactory>::getFactory(name);
+  ASSERT_NE(factory, nullptr);
+
+  ProtobufTypes::MessagePtr message = factory->createEmptyConfigProto();
+  MessageUtil::jsonConvert(sink_config, *message);
+
+  NiceMock<MockInstance> server;
+  Stats::SinkPtr sink = factory->createStatsSink(*message, server);
+  EXPECT_NE(sink, nullptr);
+  EXPECT_NE(dynamic_cast<Stats::Metrics::MetricsServiceSink*>(sink.get()), nullptr);
+}
+
+TEST(MetricsServiceConfigTest, UnknownGrpcCluster) {
+  envoy::metrics::MetricsServiceSinkConfig sink_config;
+  sink_config.set_grpc_cluster_name("fake_cluster");
+
+  NiceMock<MockInstance> server;
+  EXPECT_CALL(server.cluster_manager_, get("fake_cluster")).WillOnce(Return(nullptr));
+  EXPECT_THROW_WITH_MESSAGE(
+      MetricsServiceSinkFactory().createStatsSink(sink_config, server), EnvoyException,
+      "unknown metrics service cluster 'fake_cluster' for envoy.metrics_service Stats::Sink "
+      "config");
+}
+
 } // namespace Configuration
 } // namespace Server
 } // namespace Envoy
@@ -147,6 +147,37 @@ TEST_F(ConnectionHandlerTest, CloseConnectionOnEmptyFilterChain) {
   EXPECT_CALL(*listener, onDestroy());
 }
 
+// A handler with a per handler stat prefix also counts the connections of the listener for itself.
+TEST_F(ConnectionHandlerTest, PerHandlerStats) {
+  handler_.reset(new ConnectionHandlerImpl(ENVOY_LOGGER(), dispatcher_, "worker_0."));
+
+  Network::MockListener* listener = new NiceMock<Network::MockListener>();
+  Network::ListenerCallbacks* listener_callbacks;
+  EXPECT_CALL(dispatcher_, createListener_(_, _, _, _, _))
+      .WillOnce(Invoke([&](Network::ConnectionHandler&, Network::ListenSocket&,
+                           Network::ListenerCallbacks& cb, Stats::Scope&,
+                           const Network::ListenerOptions&) -> Network::Listener* {
+        listener_callbacks = &cb;
+        return listener;
+      }));
+  handler_->addListener(factory_, socket_, stats_store_, 1,
+                        Network::ListenerOptions::listenerOptionsWithBindToPort());
+
+  Network::MockConnection* connection = new NiceMock<Network::MockConnection>();
+  EXPECT_CALL(factory_, createFilterChain(_)).WillOnce(Return(true));
+  listener_callbacks->onNewConnection(Network::ConnectionPtr{connection});
+  EXPECT_EQ(1UL, stats_store_.counter("downstream_cx_total").value());
+  EXPECT_EQ(1UL, stats_store_.counter("worker_0.downstream_cx_total").value());
+  EXPECT_EQ(1UL, stats_store_.gauge("worker_0.downstream_cx_active").value());
+
+  connection->raiseEvent(Network::ConnectionEvent::RemoteClose);
+  EXPECT_EQ(0UL, handler_->numConnections());
+  dispatcher_.clearDeferredDeleteList();
+  EXPECT_EQ(0UL, stats_store_.gauge("downstream_cx_active").value());
+  EXPECT_EQ(0UL, stats_store_.gauge("worker_0.downstream_cx_active").value());
+  EXPECT_EQ(1UL, stats_store_.counter("worker_0.downstream_cx_total").value());
+}
+
 TEST_F(ConnectionHandlerTest, FindListenerByAddress) {
   Network::Address::InstanceConstSharedPtr alt_address(
       new Network::Address::Ipv4Instance("127.0.0.1", 10001));
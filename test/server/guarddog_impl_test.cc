@@ -1,6 +1,8 @@
 #include <atomic>
 #include <chrono>
+#include <future>
 #include <memory>
+#include <thread>
 
 #include "envoy/common/time.h"
 
@@ -8,11 +10,14 @@
 #include "common/stats/stats_impl.h"
 
 #include "server/guarddog_impl.h"
+#include "server/watchdog_impl.h"
 
 #include "test/mocks/common.h"
+#include "test/mocks/event/mocks.h"
 #include "test/mocks/server/mocks.h"
 #include "test/mocks/stats/mocks.h"
 
+#include "fmt/format.h"
 #include "gmock/gmock.h"
 #include "gtest/gtest.h"
 
@@ -230,6 +235,35 @@ TEST_F(GuardDogMissTest, MissCountTest) {
   sometimes_pet_dog = nullptr;
 }
 
+#if defined(ENVOY_HANDLE_SIGNALS) && defined(__linux__)
+TEST_F(GuardDogMissTest, StallSampleTest) {
+  // A miss signals the stalled thread, which captures its own stack.
+  std::promise<void> unstall;
+  std::atomic<int32_t> stalled_thread_id{0};
+  Thread::Thread stalled_thread([&]() -> void {
+    stalled_thread_id = Thread::Thread::currentThreadId();
+    unstall.get_future().wait();
+  });
+  while (stalled_thread_id == 0) {
+    std::this_thread::yield();
+  }
+
+  GuardDogImpl gd(stats_store_, config_miss_, time_source_);
+  EXPECT_EQ("", gd.stallSamples());
+  auto unpet_dog = gd.createWatchDog(stalled_thread_id);
+  mock_time_ += 501;
+  gd.forceCheckForTest();
+  const std::string samples = gd.stallSamples();
+  EXPECT_EQ(0U, samples.find(fmt::format("thread {} stalled for 501ms:\nBacktrace obj<",
+                                        stalled_thread_id.load())));
+
+  gd.stopWatching(unpet_dog);
+  unpet_dog = nullptr;
+  unstall.set_value();
+  stalled_thread.join();
+}
+#endif
+
 TEST(GuardDogBasicTest, StartStopTest) {
   NiceMock<Stats::MockStore> stats;
   NiceMock<Configuration::MockMain> config(0, 0, 0, 0);
@@ -263,6 +297,32 @@ TEST(WatchDogBasicTest, ThreadIdTest) {
   gd.stopWatching(watched_dog);
 }
 
+TEST(WatchDogBasicTest, LoopStallTest) {
+  NiceMock<Event::MockDispatcher> dispatcher;
+  NiceMock<MockMonotonicTimeSource> time_source;
+  Stats::MockHistogram stall_histogram;
+  uint64_t mock_time = 0;
+  ON_CALL(time_source, currentTime()).WillByDefault(testing::Invoke([&mock_time]() {
+    return std::chrono::steady_clock::time_point(std::chrono::milliseconds(mock_time));
+  }));
+  WatchDogImpl watch_dog(0, time_source, std::chrono::milliseconds(100), stall_histogram);
+
+  Event::MockTimer* timer = new Event::MockTimer(&dispatcher);
+  EXPECT_CALL(*timer, enableTimer(std::chrono::milliseconds(100))).Times(3);
+  watch_dog.startWatchdog(dispatcher);
+
+  // The timer fires 30ms after it was due, then on time.
+  mock_time += 130;
+  EXPECT_CALL(stall_histogram, recordValue(30));
+  timer->callback_();
+  mock_time += 100;
+  EXPECT_CALL(stall_histogram, recordValue(0));
+  timer->callback_();
+  EXPECT_EQ(230, std::chrono::duration_cast<std::chrono::milliseconds>(
+                     watch_dog.lastTouchTime().time_since_epoch())
+                     .count());
+}
+
 // If this test fails it is because the std::chrono::steady_clock::duration type has become
 // nontrivial or we are compiling under a compiler and library combo that makes
 // std::chrono::steady_clock::duration require a lock to be atomicly modified.
@@ -1,3 +1,5 @@
+#include <mutex>
+
 #include "common/api/os_sys_calls_impl.h"
 #include "common/stats/stats_impl.h"
 
@@ -58,7 +60,15 @@ TEST_F(HotRestartImplTest, versionString) {
   EXPECT_EQ(hot_restart_->version(),
             Envoy::Server::SharedMemory::version(options_.maxStats(),
                                                  options_.maxObjNameLength() +
-                                                     Stats::RawStatData::maxStatSuffixLength()));
+                                                     Stats::RawStatData::maxStatSuffixLength(),
+                                                 options_.sslSessionCacheSize()));
+}
+
+TEST_F(HotRestartImplTest, noParentState) {
+  setup();
+  hot_restart_->addStateExporter("foo", []() -> std::string { return "bar"; });
+  // The first process has no parent to inherit state from.
+  EXPECT_EQ("", hot_restart_->getParentState("foo"));
 }
 
 TEST_F(HotRestartImplTest, crossAlloc) {
@@ -87,6 +97,56 @@ TEST_F(HotRestartImplTest, crossAlloc) {
   EXPECT_EQ(stat5, stat5_prime);
 }
 
+TEST_F(HotRestartImplTest, indexRebuiltOnAttach) {
+  setup();
+
+  Stats::RawStatData* stat1 = hot_restart_->alloc("stat1");
+  Stats::RawStatData* stat2 = hot_restart_->alloc("stat2");
+  hot_restart_->free(*stat2);
+
+  // Empty every bucket and next slot of the index, which ends the segment.
+  const size_t index_size = 2 * sizeof(uint32_t) * options_.maxStats();
+  memset(buffer_.data() + buffer_.size() - index_size, 0xff, index_size);
+
+  EXPECT_CALL(options_, restartEpoch()).WillRepeatedly(Return(1));
+  EXPECT_CALL(os_sys_calls_, shmOpen(_, _, _));
+  EXPECT_CALL(os_sys_calls_, mmap(_, _, _, _, _, _)).WillOnce(Return(buffer_.data()));
+  EXPECT_CALL(os_sys_calls_, bind(_, _, _));
+  HotRestartImpl hot_restart2(options_);
+  EXPECT_EQ(stat1, hot_restart2.alloc("stat1"));
+  EXPECT_EQ(2, stat1->ref_count_);
+  EXPECT_EQ(stat2, hot_restart2.alloc("stat2"));
+}
+
+TEST_F(HotRestartImplTest, sessionCacheMemory) {
+  setup();
+  EXPECT_EQ(nullptr, hot_restart_->sessionCacheMemory());
+}
+
+TEST_F(HotRestartImplTest, sessionCacheMemoryKeptOnAttach) {
+  EXPECT_CALL(options_, sslSessionCacheSize()).WillRepeatedly(Return(1000));
+  setup();
+
+  Ssl::SessionCacheMemory* memory = hot_restart_->sessionCacheMemory();
+  ASSERT_NE(nullptr, memory);
+  EXPECT_EQ(Ssl::SessionCacheImpl::NUM_SHARDS, memory->numShards());
+  EXPECT_EQ(Ssl::SessionCacheImpl::slotsPerShard(1000), memory->slotsPerShard());
+  // The shards follow each other at the end of the segment.
+  const size_t shard_size = Ssl::SessionCacheImpl::slotSize() * memory->slotsPerShard();
+  EXPECT_EQ(buffer_.data() + buffer_.size() - shard_size, memory->shard(memory->numShards() - 1));
+  EXPECT_EQ(memory->shard(0) + shard_size, memory->shard(1));
+  memory->shard(1)[0] = 1;
+
+  EXPECT_CALL(options_, restartEpoch()).WillRepeatedly(Return(1));
+  EXPECT_CALL(os_sys_calls_, shmOpen(_, _, _));
+  EXPECT_CALL(os_sys_calls_, mmap(_, _, _, _, _, _)).WillOnce(Return(buffer_.data()));
+  EXPECT_CALL(os_sys_calls_, bind(_, _, _));
+  HotRestartImpl hot_restart2(options_);
+  ASSERT_NE(nullptr, hot_restart2.sessionCacheMemory());
+  EXPECT_EQ(1, hot_restart2.sessionCacheMemory()->shard(1)[0]);
+  std::unique_lock<Thread::BasicLockable> lock(hot_restart2.sessionCacheMemory()->lock(1));
+}
+
 TEST_F(HotRestartImplTest, allocFail) {
   EXPECT_CALL(options_, maxStats()).WillRepeatedly(Return(2));
   setup();
@@ -99,6 +159,29 @@ TEST_F(HotRestartImplTest, allocFail) {
   EXPECT_EQ(s3, nullptr);
 }
 
+TEST_F(HotRestartImplTest, allocFreeReuse) {
+  EXPECT_CALL(options_, maxStats()).WillRepeatedly(Return(2));
+  setup();
+
+  Stats::RawStatData* s1 = hot_restart_->alloc("1");
+  Stats::RawStatData* s2 = hot_restart_->alloc("2");
+  EXPECT_EQ(s1, hot_restart_->alloc("1"));
+  EXPECT_EQ(2, s1->ref_count_);
+  EXPECT_EQ(nullptr, hot_restart_->alloc("3"));
+
+  // The slot is only freed once its last reference is, and the other stat is still found.
+  hot_restart_->free(*s1);
+  EXPECT_EQ(nullptr, hot_restart_->alloc("3"));
+  hot_restart_->free(*s1);
+  Stats::RawStatData* s3 = hot_restart_->alloc("3");
+  EXPECT_EQ(s1, s3);
+  EXPECT_STREQ("3", s3->name_);
+  EXPECT_EQ(s2, hot_restart_->alloc("2"));
+
+  hot_restart_->free(*s3);
+  EXPECT_NE(nullptr, hot_restart_->alloc("1"));
+}
+
 // Because the shared memory is managed manually, make sure it meets
 // basic requirements:
 //   - Objects are correctly aligned so that std::atomic works properly
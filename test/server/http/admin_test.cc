@@ -7,20 +7,25 @@
 #include "common/http/message_impl.h"
 #include "common/json/json_loader.h"
 #include "common/profiler/profiler.h"
+#include "common/stats/histogram_impl.h"
+#include "common/stats/stats_impl.h"
 
 #include "server/http/admin.h"
 
 #include "test/mocks/runtime/mocks.h"
 #include "test/mocks/server/mocks.h"
+#include "test/mocks/stats/mocks.h"
 #include "test/test_common/environment.h"
 #include "test/test_common/network_utility.h"
 #include "test/test_common/printers.h"
 #include "test/test_common/utility.h"
 
+#include "fmt/format.h"
 #include "gmock/gmock.h"
 #include "gtest/gtest.h"
 
 using testing::NiceMock;
+using testing::Return;
 using testing::_;
 
 namespace Envoy {
@@ -114,6 +119,32 @@ TEST_P(AdminInstanceTest, AdminBadProfiler) {
   EXPECT_FALSE(Profiler::Cpu::profilerEnabled());
 }
 
+TEST_P(AdminInstanceTest, AdminHeapProfiler) {
+  Buffer::OwnedImpl data;
+  Http::HeaderMapImpl header_map;
+#ifdef TCMALLOC
+  EXPECT_EQ(Http::Code::OK, admin_.runCallback("/heapprofiler", header_map, data));
+  EXPECT_NE(0U, data.length());
+#else
+  EXPECT_EQ(Http::Code::InternalServerError,
+            admin_.runCallback("/heapprofiler", header_map, data));
+#endif
+}
+
+TEST_P(AdminInstanceTest, AdminCpuProfilerWindows) {
+  Buffer::OwnedImpl data;
+  Http::HeaderMapImpl header_map;
+  // Continuous profiling is disabled by default, so there are no windows.
+  EXPECT_EQ(Http::Code::OK, admin_.runCallback("/cpuprofiler/windows", header_map, data));
+  EXPECT_EQ(0U, data.length());
+  EXPECT_EQ(Http::Code::NotFound,
+            admin_.runCallback("/cpuprofiler/windows?index=0", header_map, data));
+  EXPECT_EQ(Http::Code::BadRequest,
+            admin_.runCallback("/cpuprofiler/windows?index=a", header_map, data));
+  EXPECT_EQ(Http::Code::BadRequest,
+            admin_.runCallback("/cpuprofiler/windows?window=0", header_map, data));
+}
+
 TEST_P(AdminInstanceTest, WriteAddressToFile) {
   std::ifstream address_file(address_out_path_);
   std::string address_from_file;
@@ -271,6 +302,93 @@ TEST_P(AdminInstanceTest, RuntimeBadFormat) {
   EXPECT_EQ("usage: /runtime?format=json\n", TestUtility::bufferToString(response));
 }
 
+TEST_P(AdminInstanceTest, StatsFilters) {
+  server_.stats_store_.counter("foo.used").inc();
+  server_.stats_store_.counter("foo.unused");
+  server_.stats_store_.counter("bar.used").inc();
+  Http::HeaderMapImpl header_map;
+
+  Buffer::OwnedImpl response;
+  EXPECT_EQ(Http::Code::OK, admin_.runCallback("/stats?filter=used", header_map, response));
+  EXPECT_EQ("bar.used: 1\nfoo.unused: 0\nfoo.used: 1\n", TestUtility::bufferToString(response));
+
+  Buffer::OwnedImpl used_response;
+  EXPECT_EQ(Http::Code::OK,
+            admin_.runCallback("/stats?usedonly&filter=foo", header_map, used_response));
+  EXPECT_EQ("foo.used: 1\n", TestUtility::bufferToString(used_response));
+
+  Buffer::OwnedImpl bad_response;
+  EXPECT_EQ(Http::Code::BadRequest,
+            admin_.runCallback("/stats?filter=(", header_map, bad_response));
+  EXPECT_EQ(Http::Code::NotFound, admin_.runCallback("/stats?foo", header_map, bad_response));
+  EXPECT_EQ(Http::Code::BadRequest,
+            admin_.runCallback("/clusters?filter=(", header_map, bad_response));
+}
+
+TEST_P(AdminInstanceTest, StatsScopes) {
+  NiceMock<Stats::MockStore> store;
+  ON_CALL(store, scopes())
+      .WillByDefault(testing::Return(std::list<Stats::ScopeStatsInfo>{
+          {"", 2, 0, 20}, {"bar.", 5, 0, 40}, {"foo.", 5, 0, 50}, {"baz.", 1, 0, 10}}));
+  EXPECT_CALL(server_, stats()).WillRepeatedly(testing::ReturnRef(store));
+  Http::HeaderMapImpl header_map;
+
+  Buffer::OwnedImpl response;
+  EXPECT_EQ(Http::Code::OK, admin_.runCallback("/stats/scopes", header_map, response));
+  EXPECT_EQ("bar.: 5\nfoo.: 5\n(root): 2\nbaz.: 1\n", TestUtility::bufferToString(response));
+
+  Buffer::OwnedImpl limited_response;
+  EXPECT_EQ(Http::Code::OK,
+            admin_.runCallback("/stats/scopes?limit=1", header_map, limited_response));
+  EXPECT_EQ("bar.: 5\n", TestUtility::bufferToString(limited_response));
+
+  Buffer::OwnedImpl bad_response;
+  EXPECT_EQ(Http::Code::BadRequest,
+            admin_.runCallback("/stats/scopes?limit=foo", header_map, bad_response));
+  EXPECT_EQ("usage: /stats/scopes?limit=<number of scopes>\n",
+            TestUtility::bufferToString(bad_response));
+}
+
+TEST_P(AdminInstanceTest, RuntimeLookups) {
+  const Runtime::Key key("admin_test.runtime_lookups");
+  key.countLookup();
+  key.countLookup();
+  Http::HeaderMapImpl header_map;
+
+  Buffer::OwnedImpl response;
+  EXPECT_EQ(Http::Code::OK, admin_.runCallback("/runtime/lookups", header_map, response));
+  EXPECT_NE(std::string::npos,
+            TestUtility::bufferToString(response).find("admin_test.runtime_lookups: 2\n"));
+}
+
+TEST_P(AdminInstanceTest, Workers) {
+  WorkerLoad idle;
+  idle.connections_ = 1;
+  WorkerLoad busy;
+  busy.connections_ = 3;
+  busy.active_requests_ = 2;
+  busy.requests_total_ = 100;
+  busy.rx_bytes_ = 1000;
+  busy.tx_bytes_ = 2000;
+  busy.busy_tracked_ = true;
+  busy.busy_time_ = std::chrono::seconds(100);
+  busy.pending_posts_ = 4;
+  busy.started_ = std::chrono::steady_clock::now() - std::chrono::seconds(1000);
+  EXPECT_CALL(server_.listener_manager_, workerLoads())
+      .WillOnce(Return(std::vector<WorkerLoad>{idle, busy}));
+  Http::HeaderMapImpl header_map;
+
+  // The first request computes the rates since the workers started, and the worker that did not
+  // start has none.
+  Buffer::OwnedImpl response;
+  EXPECT_EQ(Http::Code::OK, admin_.runCallback("/workers", header_map, response));
+  EXPECT_EQ("worker_0: connections=1 active_requests=0 requests=0 rps=0.0 rx_bytes=0 tx_bytes=0 "
+            "pending_posts=0\n"
+            "worker_1: connections=3 active_requests=2 requests=100 rps=0.1 rx_bytes=1000 "
+            "tx_bytes=2000 busy_pct=10.0 pending_posts=4\n",
+            TestUtility::bufferToString(response));
+}
+
 TEST(PrometheusStatsFormatter, MetricName) {
   std::string raw = "vulture.eats-liver";
   std::string expected = "envoy_vulture_eats_liver";
@@ -289,5 +407,47 @@ TEST(PrometheusStatsFormatter, FormattedTags) {
   EXPECT_EQ(expected, actual);
 }
 
+TEST(PrometheusStatsFormatter, StatsAsPrometheus) {
+  Stats::HeapRawStatDataAllocator alloc;
+  Stats::IsolatedStoreImpl store;
+  std::list<Stats::CounterSharedPtr> counters;
+  counters.push_back(std::make_shared<Stats::CounterImpl>(
+      *alloc.alloc("cluster.a.upstream_rq"), alloc, "cluster.upstream_rq",
+      std::vector<Stats::Tag>{{"envoy.cluster_name", "a"}}));
+  counters.push_back(std::make_shared<Stats::CounterImpl>(
+      *alloc.alloc("cluster.b.upstream_rq"), alloc, "cluster.upstream_rq",
+      std::vector<Stats::Tag>{{"envoy.cluster_name", "b"}}));
+  counters.front()->add(2);
+  std::list<Stats::GaugeSharedPtr> gauges;
+  gauges.push_back(std::make_shared<Stats::GaugeImpl>(*alloc.alloc("server.live"), alloc,
+                                                      "server.live", std::vector<Stats::Tag>()));
+  gauges.front()->set(1);
+  std::list<Stats::ParentHistogramSharedPtr> histograms;
+  auto histogram = std::make_shared<Stats::ParentHistogramImpl>(
+      "cluster.a.upstream_rq_time", store, "cluster.upstream_rq_time",
+      std::vector<Stats::Tag>{{"envoy.cluster_name", "a"}});
+  histogram->recordValue(5);
+  histogram->merge();
+  histograms.push_back(histogram);
+
+  Buffer::OwnedImpl response;
+  PrometheusStatsFormatter::statsAsPrometheus(counters, gauges, histograms, response);
+  std::string expected = "# TYPE envoy_cluster_upstream_rq counter\n"
+                         "envoy_cluster_upstream_rq{envoy_cluster_name=\"a\"} 2\n"
+                         "envoy_cluster_upstream_rq{envoy_cluster_name=\"b\"} 0\n"
+                         "# TYPE envoy_server_live gauge\n"
+                         "envoy_server_live{} 1\n"
+                         "# TYPE envoy_cluster_upstream_rq_time summary\n";
+  for (const std::string quantile :
+       {"0", "0.25", "0.5", "0.75", "0.9", "0.95", "0.99", "0.999", "1"}) {
+    expected += fmt::format(
+        "envoy_cluster_upstream_rq_time{{envoy_cluster_name=\"a\",quantile=\"{}\"}} 5\n",
+        quantile);
+  }
+  expected += "envoy_cluster_upstream_rq_time_sum{envoy_cluster_name=\"a\"} 5\n"
+              "envoy_cluster_upstream_rq_time_count{envoy_cluster_name=\"a\"} 1\n";
+  EXPECT_EQ(expected, TestUtility::bufferToString(response));
+}
+
 } // namespace Server
 } // namespace Envoy
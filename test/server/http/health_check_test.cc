@@ -208,6 +208,53 @@ TEST_F(HealthCheckFilterCachingTest, NotHcRequest) {
             filter_->decodeHeaders(request_headers_no_hc_, true));
 }
 
+TEST_F(HealthCheckFilterCachingTest, Responder) {
+  HealthCheckResponder responder(context_, true, cache_manager_, "/healthcheck");
+  EXPECT_CALL(context_, healthCheckFailed()).WillRepeatedly(Return(false));
+
+  // Nothing is cached yet, so the request has to go through.
+  Http::TestHeaderMapImpl response_headers;
+  EXPECT_CALL(callbacks_.request_info_, healthCheck(_)).Times(0);
+  EXPECT_FALSE(responder.respond(request_headers_, response_headers, callbacks_.request_info_));
+  EXPECT_EQ(0UL, response_headers.size());
+
+  cache_manager_->setCachedResponseCode(Http::Code::ServiceUnavailable);
+  EXPECT_FALSE(
+      responder.respond(request_headers_no_hc_, response_headers, callbacks_.request_info_));
+
+  EXPECT_CALL(callbacks_.request_info_, healthCheck(true));
+  EXPECT_CALL(callbacks_.request_info_,
+              setResponseFlag(RequestInfo::ResponseFlag::FailedLocalHealthCheck));
+  EXPECT_TRUE(responder.respond(request_headers_, response_headers, callbacks_.request_info_));
+  EXPECT_EQ((Http::TestHeaderMapImpl{{":status", "503"},
+                                     {"x-envoy-upstream-healthchecked-cluster", "cluster_name"}}),
+            response_headers);
+}
+
+TEST_F(HealthCheckFilterNoPassThroughTest, ResponderFailed) {
+  HealthCheckResponder responder(context_, false, nullptr, "/healthcheck");
+  EXPECT_CALL(context_, healthCheckFailed()).WillOnce(Return(true));
+  EXPECT_CALL(callbacks_.request_info_, healthCheck(true));
+  EXPECT_CALL(callbacks_.request_info_,
+              setResponseFlag(RequestInfo::ResponseFlag::FailedLocalHealthCheck));
+
+  Http::TestHeaderMapImpl response_headers;
+  EXPECT_TRUE(responder.respond(request_headers_, response_headers, callbacks_.request_info_));
+  EXPECT_STREQ("503", response_headers.Status()->value().c_str());
+}
+
+TEST(HealthCheckFilterConfig, createsResponder) {
+  Server::Configuration::HealthCheckFilterConfig healthCheckFilterConfig;
+  Json::ObjectSharedPtr config =
+      Json::Factory::loadFromString("{\"pass_through_mode\":false, \"endpoint\":\"foo\"}");
+  NiceMock<Server::Configuration::MockFactoryContext> context;
+
+  Http::HeaderOnlyResponderSharedPtr responder;
+  healthCheckFilterConfig.createFilterFactoryWithResponder(*config, "dummy_stats_prefix", context,
+                                                          responder);
+  EXPECT_NE(nullptr, dynamic_cast<HealthCheckResponder*>(responder.get()));
+}
+
 TEST(HealthCheckFilterConfig, failsWhenNotPassThroughButTimeoutSetJson) {
   Server::Configuration::HealthCheckFilterConfig healthCheckFilterConfig;
   Json::ObjectSharedPtr config = Json::Factory::loadFromString(
@@ -46,8 +46,8 @@ public:
     EXPECT_CALL(*cluster.info_, type());
     interval_timer_ = new Event::MockTimer(&dispatcher_);
     EXPECT_CALL(init_, registerTarget(_));
-    lds_.reset(new LdsApi(lds_config, cluster_manager_, dispatcher_, random_, init_, local_info_,
-                          store_, listener_manager_));
+    lds_.reset(new LdsApi(lds_config, cluster_manager_, dispatcher_, tls_, random_, init_,
+                          local_info_, store_, listener_manager_));
 
     expectRequest();
     init_.initialize();
@@ -93,6 +93,7 @@ public:
   bool v2_rest_{};
   NiceMock<Upstream::MockClusterManager> cluster_manager_;
   Event::MockDispatcher dispatcher_;
+  NiceMock<ThreadLocal::MockInstance> tls_;
   NiceMock<Runtime::MockRandomGenerator> random_;
   Init::MockManager init_;
   NiceMock<LocalInfo::MockLocalInfo> local_info_;
@@ -133,8 +134,8 @@ TEST_F(LdsApiTest, UnknownCluster) {
   Config::Utility::translateLdsConfig(*config, lds_config);
   Upstream::ClusterManager::ClusterInfoMap cluster_map;
   EXPECT_CALL(cluster_manager_, clusters()).WillOnce(Return(cluster_map));
-  EXPECT_THROW_WITH_MESSAGE(LdsApi(lds_config, cluster_manager_, dispatcher_, random_, init_,
-                                   local_info_, store_, listener_manager_),
+  EXPECT_THROW_WITH_MESSAGE(LdsApi(lds_config, cluster_manager_, dispatcher_, tls_, random_,
+                                   init_, local_info_, store_, listener_manager_),
                             EnvoyException,
                             "envoy::api::v2::ConfigSource must have a statically defined non-EDS "
                             "cluster: 'foo_cluster' does not exist, was added via api, or is an "
@@ -161,8 +162,8 @@ TEST_F(LdsApiTest, BadLocalInfo) {
   EXPECT_CALL(*cluster.info_, addedViaApi());
   EXPECT_CALL(*cluster.info_, type());
   ON_CALL(local_info_, clusterName()).WillByDefault(Return(std::string()));
-  EXPECT_THROW_WITH_MESSAGE(LdsApi(lds_config, cluster_manager_, dispatcher_, random_, init_,
-                                   local_info_, store_, listener_manager_),
+  EXPECT_THROW_WITH_MESSAGE(LdsApi(lds_config, cluster_manager_, dispatcher_, tls_, random_,
+                                   init_, local_info_, store_, listener_manager_),
                             EnvoyException,
                             "lds: setting --service-cluster and --service-node is required");
 }
@@ -793,6 +793,212 @@ TEST_F(ListenerManagerImplTest, EarlyShutdown) {
   manager_->stopWorkers();
 }
 
+// A listener with reuse_port gets a socket per worker, all bound to the port of the first one.
+TEST_F(ListenerManagerImplTest, ReusePort) {
+  ON_CALL(server_.options_, concurrency()).WillByDefault(Return(2));
+  worker_ = new MockWorker();
+  MockWorker* worker2 = new MockWorker();
+  EXPECT_CALL(worker_factory_, createWorker_()).WillOnce(Return(worker_)).WillOnce(Return(worker2));
+  manager_.reset(new ListenerManagerImpl(server_, listener_factory_, worker_factory_));
+
+  InSequence s;
+
+  // Add foo listener.
+  const std::string listener_foo_yaml = R"EOF(
+    name: "foo"
+    address:
+      socket_address: { address: 127.0.0.1, port_value: 0 }
+    metadata: { filter_metadata: { envoy.listener: { reuse_port: true } } }
+    filter_chains:
+    - filters:
+  )EOF";
+
+  auto socket0 = std::make_shared<NiceMock<Network::MockListenSocket>>();
+  auto socket1 = std::make_shared<NiceMock<Network::MockListenSocket>>();
+  Network::Address::InstanceConstSharedPtr bound_address(
+      new Network::Address::Ipv4Instance("127.0.0.1", 10000));
+  ON_CALL(*socket0, localAddress()).WillByDefault(Return(bound_address));
+
+  ListenerHandle* listener_foo = expectListenerCreate(false);
+  EXPECT_CALL(listener_factory_, createReusePortListenSocket(_, 0)).WillOnce(Return(socket0));
+  EXPECT_CALL(listener_factory_, createReusePortListenSocket(bound_address, 1))
+      .WillOnce(Return(socket1));
+  EXPECT_TRUE(manager_->addOrUpdateListener(parseListenerFromV2Yaml(listener_foo_yaml), true));
+  checkStats(1, 0, 0, 0, 1, 0);
+
+  Listener& listener = manager_->listeners().front().get();
+  EXPECT_EQ(socket0.get(), &listener.socket());
+  EXPECT_EQ(socket0.get(), listener.workerSocket(0));
+  EXPECT_EQ(socket1.get(), listener.workerSocket(1));
+  EXPECT_EQ(nullptr, listener.workerSocket(2));
+
+  // Update foo listener, but without reuse_port. Should throw.
+  const std::string listener_foo_update_yaml = R"EOF(
+    name: "foo"
+    address:
+      socket_address: { address: 127.0.0.1, port_value: 0 }
+    filter_chains:
+    - filters:
+  )EOF";
+
+  ListenerHandle* listener_foo_update = expectListenerCreate(false);
+  EXPECT_CALL(*listener_foo_update, onDestroy());
+  EXPECT_THROW_WITH_MESSAGE(
+      manager_->addOrUpdateListener(parseListenerFromV2Yaml(listener_foo_update_yaml), true),
+      EnvoyException,
+      "error updating listener: 'foo' has a different reuse_port from existing listener");
+
+  EXPECT_CALL(*listener_foo, onDestroy());
+}
+
+// Only listeners with balance_connections balance their connections across the workers.
+TEST_F(ListenerManagerImplTest, BalanceConnections) {
+  InSequence s;
+
+  const std::string listener_foo_yaml = R"EOF(
+    name: "foo"
+    address:
+      socket_address: { address: 127.0.0.1, port_value: 1234 }
+    metadata: { filter_metadata: { envoy.listener: { balance_connections: true } } }
+    filter_chains:
+    - filters:
+  )EOF";
+
+  ListenerHandle* listener_foo = expectListenerCreate(false);
+  EXPECT_CALL(listener_factory_, createListenSocket(_, true));
+  EXPECT_TRUE(manager_->addOrUpdateListener(parseListenerFromV2Yaml(listener_foo_yaml), true));
+  EXPECT_NE(nullptr, manager_->listeners().back().get().connectionBalancer());
+
+  const std::string listener_bar_yaml = R"EOF(
+    name: "bar"
+    address:
+      socket_address: { address: 127.0.0.1, port_value: 1235 }
+    filter_chains:
+    - filters:
+  )EOF";
+
+  ListenerHandle* listener_bar = expectListenerCreate(false);
+  EXPECT_CALL(listener_factory_, createListenSocket(_, true));
+  EXPECT_TRUE(manager_->addOrUpdateListener(parseListenerFromV2Yaml(listener_bar_yaml), true));
+  EXPECT_EQ(nullptr, manager_->listeners().back().get().connectionBalancer());
+
+  EXPECT_CALL(*listener_foo, onDestroy());
+  EXPECT_CALL(*listener_bar, onDestroy());
+}
+
+TEST_F(ListenerManagerImplTest, AcceptBatchSize) {
+  InSequence s;
+
+  const std::string listener_foo_yaml = R"EOF(
+    name: "foo"
+    address:
+      socket_address: { address: 127.0.0.1, port_value: 1234 }
+    metadata: { filter_metadata: { envoy.listener: { accept_batch_size: 64 } } }
+    filter_chains:
+    - filters:
+  )EOF";
+
+  ListenerHandle* listener_foo = expectListenerCreate(false);
+  EXPECT_CALL(listener_factory_, createListenSocket(_, true));
+  EXPECT_TRUE(manager_->addOrUpdateListener(parseListenerFromV2Yaml(listener_foo_yaml), true));
+  EXPECT_EQ(64U, manager_->listeners().back().get().acceptBatchSize());
+
+  EXPECT_CALL(*listener_foo, onDestroy());
+}
+
+TEST_F(ListenerManagerImplTest, ReusePortWithoutBindToPort) {
+  const std::string listener_foo_yaml = R"EOF(
+    name: "foo"
+    address:
+      socket_address: { address: 127.0.0.1, port_value: 1234 }
+    metadata: { filter_metadata: { envoy.listener: { reuse_port: true } } }
+    filter_chains:
+    - filters:
+    deprecated_v1: { bind_to_port: false }
+  )EOF";
+
+  EXPECT_CALL(listener_factory_, createReusePortListenSocket(_, _)).Times(0);
+  EXPECT_THROW_WITH_MESSAGE(
+      manager_->addOrUpdateListener(parseListenerFromV2Yaml(listener_foo_yaml), true),
+      EnvoyException,
+      "error adding listener '127.0.0.1:1234': reuse_port requires the listener to bind to its "
+      "port");
+}
+
+// The listeners of a filter chain group with identical filter chains share their filter
+// factories, which are created once.
+TEST_F(ListenerManagerImplTest, FilterChainGroup) {
+  InSequence s;
+
+  const std::string listener_foo_yaml = R"EOF(
+    name: "foo"
+    address:
+      socket_address: { address: 127.0.0.1, port_value: 1234 }
+    metadata: { filter_metadata: { envoy.listener: { filter_chain_group: tenants } } }
+    filter_chains:
+    - filters:
+  )EOF";
+
+  ListenerHandle* listener_foo = expectListenerCreate(false);
+  EXPECT_CALL(listener_factory_, createListenSocket(_, true));
+  EXPECT_TRUE(manager_->addOrUpdateListener(parseListenerFromV2Yaml(listener_foo_yaml), true));
+
+  // The filter factories are created with the stats scope of the group.
+  listener_foo->context_->listenerScope().counter("foo").inc();
+  EXPECT_EQ(1UL, server_.stats_store_.counter("listener.tenants.foo").value());
+
+  const std::string listener_bar_yaml = R"EOF(
+    name: "bar"
+    address:
+      socket_address: { address: 127.0.0.1, port_value: 1235 }
+    metadata: { filter_metadata: { envoy.listener: { filter_chain_group: tenants } } }
+    filter_chains:
+    - filters:
+  )EOF";
+
+  EXPECT_CALL(listener_factory_, createDrainManager_(_)).WillOnce(Return(new MockDrainManager()));
+  EXPECT_CALL(listener_factory_, createFilterFactoryList(_, _)).Times(0);
+  EXPECT_CALL(listener_factory_, createListenSocket(_, true));
+  EXPECT_TRUE(manager_->addOrUpdateListener(parseListenerFromV2Yaml(listener_bar_yaml), true));
+
+  // Updating foo without changing its filter chains does not create them again.
+  const std::string listener_foo_update1_yaml = R"EOF(
+    name: "foo"
+    address:
+      socket_address: { address: 127.0.0.1, port_value: 1234 }
+    metadata: { filter_metadata: { envoy.listener: { filter_chain_group: tenants } } }
+    per_connection_buffer_limit_bytes: 8192
+    filter_chains:
+    - filters:
+  )EOF";
+
+  EXPECT_CALL(listener_factory_, createDrainManager_(_)).WillOnce(Return(new MockDrainManager()));
+  EXPECT_CALL(listener_factory_, createFilterFactoryList(_, _)).Times(0);
+  EXPECT_TRUE(
+      manager_->addOrUpdateListener(parseListenerFromV2Yaml(listener_foo_update1_yaml), true));
+  checkStats(2, 1, 0, 0, 2, 0);
+
+  // A listener of the group with different filter chains gets filter chains of its own.
+  const std::string listener_baz_yaml = R"EOF(
+    name: "baz"
+    address:
+      socket_address: { address: 127.0.0.1, port_value: 1236 }
+    metadata: { filter_metadata: { envoy.listener: { filter_chain_group: tenants } } }
+    filter_chains:
+    - filters:
+      use_proxy_proto: true
+  )EOF";
+
+  ListenerHandle* listener_baz = expectListenerCreate(false);
+  EXPECT_CALL(listener_factory_, createListenSocket(_, true));
+  EXPECT_TRUE(manager_->addOrUpdateListener(parseListenerFromV2Yaml(listener_baz_yaml), true));
+  EXPECT_TRUE(manager_->listeners().back().get().useProxyProto());
+
+  // The filter factories of foo and bar are destroyed with the last of them.
+  EXPECT_CALL(*listener_foo, onDestroy());
+  EXPECT_CALL(*listener_baz, onDestroy());
+}
+
 TEST_F(ListenerManagerImplWithRealFiltersTest, SniWithSingleFilterChain) {
   const std::string yaml = TestEnvironment::substitute(R"EOF(
     address:
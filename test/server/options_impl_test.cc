@@ -24,9 +24,9 @@ std::unique_ptr<OptionsImpl> createOptionsImpl(const std::string& args) {
   for (const std::string& s : words) {
     argv.push_back(s.c_str());
   }
-  return std::unique_ptr<OptionsImpl>(new OptionsImpl(argv.size(), const_cast<char**>(&argv[0]),
-                                                      [](uint64_t, uint64_t) { return "1"; },
-                                                      spdlog::level::warn));
+  return std::unique_ptr<OptionsImpl>(
+      new OptionsImpl(argv.size(), const_cast<char**>(&argv[0]),
+                      [](uint64_t, uint64_t, uint64_t) { return "1"; }, spdlog::level::warn));
 }
 
 TEST(OptionsImplTest, HotRestartVersion) {
@@ -60,8 +60,16 @@ TEST(OptionsImplTest, All) {
   std::unique_ptr<OptionsImpl> options = createOptionsImpl(
       "envoy --mode validate --concurrency 2 -c hello --admin-address-path path --restart-epoch 1 "
       "--local-address-ip-version v6 -l info --service-cluster cluster --service-node node "
-      "--service-zone zone --file-flush-interval-msec 9000 --drain-time-s 60 "
-      "--parent-shutdown-time-s 90 --log-path /foo/bar --v2-config-only");
+      "--service-zone zone --file-flush-interval-msec 9000 --file-write-overflow-policy drop "
+      "--drain-time-s 60 --parent-shutdown-time-s 90 --log-path /foo/bar --v2-config-only "
+      "--buffer-pool-max-retained-bytes 4096 --sharded-counters rq_total,cx_total "
+      "--ssl-session-cache-size 1000 --ssl-session-cache-timeout-s 60 "
+      "--ssl-private-key-threads 4 --ssl-lazy-certificates --worker-loop-stats "
+      "--worker-callback-budget-us 500 --worker-io-uring --worker-cpu-set 0-2,8 "
+      "--worker-numa-local-memory --dns-thread "
+      "--dns-max-concurrent-queries 64 "
+      "--rate-limit-local-config /etc/envoy/local_rate_limits.json --cpu-profile-window-s 60 "
+      "--validated-config-cache /var/cache/envoy/validated");
   EXPECT_EQ(Server::Mode::Validate, options->mode());
   EXPECT_EQ(2U, options->concurrency());
   EXPECT_EQ("hello", options->configPath());
@@ -75,8 +83,25 @@ TEST(OptionsImplTest, All) {
   EXPECT_EQ("node", options->serviceNodeName());
   EXPECT_EQ("zone", options->serviceZone());
   EXPECT_EQ(std::chrono::milliseconds(9000), options->fileFlushIntervalMsec());
+  EXPECT_EQ(Filesystem::OverflowPolicy::Drop, options->fileWriteOverflowPolicy());
   EXPECT_EQ(std::chrono::seconds(60), options->drainTime());
   EXPECT_EQ(std::chrono::seconds(90), options->parentShutdownTime());
+  EXPECT_EQ(4096U, options->bufferPoolMaxRetainedBytes());
+  EXPECT_EQ((std::vector<std::string>{"rq_total", "cx_total"}), options->shardedCounters());
+  EXPECT_EQ(1000U, options->sslSessionCacheSize());
+  EXPECT_EQ(std::chrono::seconds(60), options->sslSessionCacheTimeout());
+  EXPECT_EQ(4U, options->sslPrivateKeyThreads());
+  EXPECT_TRUE(options->sslLazyCertificates());
+  EXPECT_TRUE(options->workerLoopStats());
+  EXPECT_EQ(std::chrono::microseconds(500), options->workerCallbackBudget());
+  EXPECT_TRUE(options->workerIoUring());
+  EXPECT_EQ((std::vector<uint32_t>{0, 1, 2, 8}), options->workerCpuSet());
+  EXPECT_TRUE(options->workerNumaLocalMemory());
+  EXPECT_TRUE(options->dnsThread());
+  EXPECT_EQ(64U, options->dnsMaxConcurrentQueries());
+  EXPECT_EQ("/etc/envoy/local_rate_limits.json", options->rateLimitLocalConfigPath());
+  EXPECT_EQ(std::chrono::seconds(60), options->cpuProfileWindow());
+  EXPECT_EQ("/var/cache/envoy/validated", options->validatedConfigCachePath());
 }
 
 TEST(OptionsImplTest, DefaultParams) {
@@ -86,6 +111,22 @@ TEST(OptionsImplTest, DefaultParams) {
   EXPECT_EQ("", options->adminAddressPath());
   EXPECT_EQ(Network::Address::IpVersion::v4, options->localAddressIpVersion());
   EXPECT_EQ(Server::Mode::Serve, options->mode());
+  EXPECT_EQ(Filesystem::OverflowPolicy::Spill, options->fileWriteOverflowPolicy());
+  EXPECT_TRUE(options->shardedCounters().empty());
+  EXPECT_EQ(0U, options->sslSessionCacheSize());
+  EXPECT_EQ(std::chrono::seconds(300), options->sslSessionCacheTimeout());
+  EXPECT_EQ(0U, options->sslPrivateKeyThreads());
+  EXPECT_FALSE(options->sslLazyCertificates());
+  EXPECT_FALSE(options->workerLoopStats());
+  EXPECT_EQ(std::chrono::microseconds(0), options->workerCallbackBudget());
+  EXPECT_FALSE(options->workerIoUring());
+  EXPECT_TRUE(options->workerCpuSet().empty());
+  EXPECT_FALSE(options->workerNumaLocalMemory());
+  EXPECT_FALSE(options->dnsThread());
+  EXPECT_EQ(0U, options->dnsMaxConcurrentQueries());
+  EXPECT_EQ("", options->rateLimitLocalConfigPath());
+  EXPECT_EQ(std::chrono::seconds(0), options->cpuProfileWindow());
+  EXPECT_EQ("", options->validatedConfigCachePath());
 }
 
 TEST(OptionsImplTest, BadCliOption) {
@@ -97,6 +138,26 @@ TEST(OptionsImplTest, BadCliOption) {
   }
 }
 
+TEST(OptionsImplTest, BadFileWriteOverflowPolicyOption) {
+  try {
+    createOptionsImpl("envoy -c hello --file-write-overflow-policy foo");
+    FAIL();
+  } catch (const MalformedArgvException& e) {
+    EXPECT_THAT(e.what(), HasSubstr("error: unknown file write overflow policy 'foo'"));
+  }
+}
+
+TEST(OptionsImplTest, BadWorkerCpuSetOption) {
+  for (const std::string cpu_set : {"a", "3-1", "1-2-3", "1,,2", "-3", "0-1024"}) {
+    try {
+      createOptionsImpl("envoy -c hello --worker-cpu-set " + cpu_set);
+      FAIL();
+    } catch (const MalformedArgvException& e) {
+      EXPECT_THAT(e.what(), HasSubstr("error: invalid worker CPU set"));
+    }
+  }
+}
+
 TEST(OptionsImplTest, BadObjNameLenOption) {
   try {
     createOptionsImpl("envoy --max-obj-name-len 1");
@@ -0,0 +1,99 @@
+#include <chrono>
+#include <cstdint>
+
+#include "common/buffer/memory_account_impl.h"
+#include "common/stats/stats_impl.h"
+
+#include "server/overload_manager_impl.h"
+
+#include "test/mocks/event/mocks.h"
+#include "test/mocks/runtime/mocks.h"
+
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+
+using testing::NiceMock;
+using testing::Return;
+using testing::_;
+
+namespace Envoy {
+namespace Server {
+
+class OverloadManagerImplTest : public testing::Test {
+public:
+  OverloadManagerImplTest()
+      : overload_manager_(dispatcher_, stats_, runtime_),
+        account_(Buffer::MemoryAccountImpl::createChild(
+            Buffer::MemoryAccountImpl::processAccount())) {
+    // Make sure usage is non-zero even when the allocator does not report the heap size.
+    account_->charge(1024);
+  }
+
+  ~OverloadManagerImplTest() { account_->credit(1024); }
+
+  void setMaxHeapBytes(uint64_t max_heap_bytes) {
+    ON_CALL(runtime_.snapshot_, getInteger("overload.max_heap_bytes", 0))
+        .WillByDefault(Return(max_heap_bytes));
+  }
+
+  uint64_t gauge(const std::string& name) { return stats_.gauge("overload." + name).value(); }
+
+  NiceMock<Event::MockDispatcher> dispatcher_;
+  Stats::IsolatedStoreImpl stats_;
+  NiceMock<Runtime::MockLoader> runtime_;
+  OverloadManagerImpl overload_manager_;
+  Buffer::MemoryAccountSharedPtr account_;
+};
+
+TEST_F(OverloadManagerImplTest, DisabledByDefault) {
+  overload_manager_.refresh();
+  EXPECT_FALSE(overload_manager_.isActive(OverloadAction::DisableHttpKeepAlive));
+  EXPECT_FALSE(overload_manager_.isActive(OverloadAction::StopAcceptingConnections));
+  EXPECT_FALSE(overload_manager_.isActive(OverloadAction::StopAcceptingRequests));
+  EXPECT_LE(1024U, gauge("memory_usage_bytes"));
+}
+
+TEST_F(OverloadManagerImplTest, AllActions) {
+  setMaxHeapBytes(1);
+  overload_manager_.refresh();
+  EXPECT_TRUE(overload_manager_.isActive(OverloadAction::DisableHttpKeepAlive));
+  EXPECT_TRUE(overload_manager_.isActive(OverloadAction::StopAcceptingConnections));
+  EXPECT_TRUE(overload_manager_.isActive(OverloadAction::StopAcceptingRequests));
+  EXPECT_EQ(1U, gauge("disable_http_keepalive_active"));
+  EXPECT_EQ(1U, gauge("stop_accepting_connections_active"));
+  EXPECT_EQ(1U, gauge("stop_accepting_requests_active"));
+
+  // Actions clear once usage drops back below the limit.
+  setMaxHeapBytes(1ULL << 50);
+  overload_manager_.refresh();
+  EXPECT_FALSE(overload_manager_.isActive(OverloadAction::DisableHttpKeepAlive));
+  EXPECT_FALSE(overload_manager_.isActive(OverloadAction::StopAcceptingConnections));
+  EXPECT_FALSE(overload_manager_.isActive(OverloadAction::StopAcceptingRequests));
+  EXPECT_EQ(0U, gauge("disable_http_keepalive_active"));
+}
+
+TEST_F(OverloadManagerImplTest, PerActionThreshold) {
+  setMaxHeapBytes(1ULL << 50);
+  ON_CALL(runtime_.snapshot_, getInteger("overload.disable_http_keepalive_percent", 80))
+      .WillByDefault(Return(0));
+  overload_manager_.refresh();
+  EXPECT_TRUE(overload_manager_.isActive(OverloadAction::DisableHttpKeepAlive));
+  EXPECT_FALSE(overload_manager_.isActive(OverloadAction::StopAcceptingConnections));
+  EXPECT_FALSE(overload_manager_.isActive(OverloadAction::StopAcceptingRequests));
+}
+
+TEST_F(OverloadManagerImplTest, RefreshTimer) {
+  Event::MockTimer* timer = new Event::MockTimer(&dispatcher_);
+  EXPECT_CALL(*timer, enableTimer(std::chrono::milliseconds(0)));
+  overload_manager_.start();
+
+  setMaxHeapBytes(1);
+  ON_CALL(runtime_.snapshot_, getInteger("overload.refresh_interval_ms", 1000))
+      .WillByDefault(Return(250));
+  EXPECT_CALL(*timer, enableTimer(std::chrono::milliseconds(250)));
+  timer->callback_();
+  EXPECT_TRUE(overload_manager_.isActive(OverloadAction::StopAcceptingRequests));
+}
+
+} // namespace Server
+} // namespace Envoy
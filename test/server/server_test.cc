@@ -1,12 +1,16 @@
 #include "common/common/version.h"
+#include "common/filesystem/filesystem_impl.h"
 #include "common/network/address_impl.h"
+#include "common/stats/histogram_impl.h"
 #include "common/thread_local/thread_local_impl.h"
 
 #include "server/server.h"
 
+#include "test/common/upstream/utility.h"
 #include "test/integration/server.h"
 #include "test/mocks/server/mocks.h"
 #include "test/mocks/stats/mocks.h"
+#include "test/mocks/upstream/mocks.h"
 #include "test/test_common/environment.h"
 
 #include "gtest/gtest.h"
@@ -14,6 +18,7 @@
 using testing::HasSubstr;
 using testing::InSequence;
 using testing::Property;
+using testing::Return;
 using testing::SaveArg;
 using testing::StrictMock;
 using testing::_;
@@ -28,14 +33,128 @@ TEST(ServerInstanceUtil, flushHelper) {
   store.counter("hello").inc();
   store.gauge("world").set(5);
   std::unique_ptr<Stats::MockSink> sink(new StrictMock<Stats::MockSink>());
+  Stats::MockSink& sink_ref = *sink;
+  EXPECT_CALL(sink_ref, beginFlush());
+  EXPECT_CALL(sink_ref, flushCounter(Property(&Stats::Metric::name, "hello"), 1));
+  EXPECT_CALL(sink_ref, flushGauge(Property(&Stats::Metric::name, "world"), 5));
+  EXPECT_CALL(sink_ref, endFlush());
+
+  std::list<Stats::SinkPtr> sinks;
+  sinks.emplace_back(std::move(sink));
+  InstanceUtil::flushMetricsToSinks(sinks, store);
+
+  // The counter did not change since the last flush, so it is skipped.
+  EXPECT_CALL(sink_ref, beginFlush());
+  EXPECT_CALL(sink_ref, flushGauge(Property(&Stats::Metric::name, "world"), 5));
+  EXPECT_CALL(sink_ref, endFlush());
+  InstanceUtil::flushMetricsToSinks(sinks, store);
+}
+
+TEST(ServerInstanceUtil, flushHistograms) {
+  InSequence s;
+
+  Stats::IsolatedStoreImpl parent_store;
+  Stats::ParentHistogramImplSharedPtr used(new Stats::ParentHistogramImpl(
+      "used", parent_store, std::string("used"), std::vector<Stats::Tag>()));
+  Stats::ParentHistogramImplSharedPtr unused(new Stats::ParentHistogramImpl(
+      "unused", parent_store, std::string("unused"), std::vector<Stats::Tag>()));
+  used->recordValue(5);
+  NiceMock<Stats::MockStore> store;
+  ON_CALL(store, histograms())
+      .WillByDefault(Return(std::list<Stats::ParentHistogramSharedPtr>{used, unused}));
+  std::unique_ptr<Stats::MockSink> sink(new StrictMock<Stats::MockSink>());
   EXPECT_CALL(*sink, beginFlush());
-  EXPECT_CALL(*sink, flushCounter(Property(&Stats::Metric::name, "hello"), 1));
-  EXPECT_CALL(*sink, flushGauge(Property(&Stats::Metric::name, "world"), 5));
+  EXPECT_CALL(*sink, flushHistogram(Property(&Stats::Metric::name, "used")));
   EXPECT_CALL(*sink, endFlush());
 
   std::list<Stats::SinkPtr> sinks;
   sinks.emplace_back(std::move(sink));
-  InstanceUtil::flushCountersAndGaugesToSinks(sinks, store);
+  InstanceUtil::flushMetricsToSinks(sinks, store);
+  EXPECT_EQ(1UL, used->intervalStatistics().sampleCount());
+}
+
+TEST(ServerInstanceUtil, updateStatsStoreStats) {
+  NiceMock<Stats::MockStore> store;
+  ON_CALL(store, scopes())
+      .WillByDefault(Return(std::list<Stats::ScopeStatsInfo>{{"", 2, 1, 20}, {"foo.", 3, 0, 15}}));
+  ON_CALL(store, numStatsCreated()).WillByDefault(Return(7));
+
+  Stats::IsolatedStoreImpl stats_store;
+  StatsStoreStats stats{ALL_STATS_STORE_STATS(POOL_COUNTER_PREFIX(stats_store, "stats."),
+                                              POOL_GAUGE_PREFIX(stats_store, "stats."))};
+  uint64_t num_stats_created = 0;
+  InstanceUtil::updateStatsStoreStats(store, stats, num_stats_created);
+  EXPECT_EQ(2UL, stats.num_scopes_.value());
+  EXPECT_EQ(5UL, stats.num_stats_.value());
+  EXPECT_EQ(1UL, stats.num_overflow_stats_.value());
+  EXPECT_EQ(35UL, stats.name_bytes_.value());
+  EXPECT_EQ(7UL, stats.created_.value());
+  EXPECT_EQ(7UL, num_stats_created);
+
+  // Only the stats created since the last update are counted.
+  ON_CALL(store, numStatsCreated()).WillByDefault(Return(10));
+  InstanceUtil::updateStatsStoreStats(store, stats, num_stats_created);
+  EXPECT_EQ(10UL, stats.created_.value());
+}
+
+TEST(ServerInstanceUtil, updateObjectPoolStats) {
+  Stats::IsolatedStoreImpl stats_store;
+  ServerObjectPoolStats stats{
+      ALL_OBJECT_POOL_STATS(POOL_COUNTER_PREFIX(stats_store, "server.object_pool."),
+                            POOL_GAUGE_PREFIX(stats_store, "server.object_pool."))};
+  ObjectPoolStats last_pool_stats;
+  InstanceUtil::updateObjectPoolStats({2, 256, 5, 3}, stats, last_pool_stats);
+  EXPECT_EQ(2UL, stats.retained_objects_.value());
+  EXPECT_EQ(256UL, stats.retained_bytes_.value());
+  EXPECT_EQ(5UL, stats.reused_.value());
+  EXPECT_EQ(3UL, stats.allocated_.value());
+
+  // The counters only add the allocations made since the last update.
+  InstanceUtil::updateObjectPoolStats({1, 128, 9, 4}, stats, last_pool_stats);
+  EXPECT_EQ(1UL, stats.retained_objects_.value());
+  EXPECT_EQ(128UL, stats.retained_bytes_.value());
+  EXPECT_EQ(9UL, stats.reused_.value());
+  EXPECT_EQ(4UL, stats.allocated_.value());
+  EXPECT_EQ(4UL, last_pool_stats.allocated_);
+}
+
+TEST(ServerInstanceUtil, unhealthyHosts) {
+  NiceMock<Upstream::MockClusterManager> cm;
+  NiceMock<Upstream::MockCluster> cluster;
+  cluster.prioritySet().getMockHostSet(0)->hosts_ = {
+      Upstream::makeTestHost(cluster.info_, "tcp://10.0.0.1:80"),
+      Upstream::makeTestHost(cluster.info_, "tcp://10.0.0.2:80")};
+  cluster.prioritySet().getMockHostSet(0)->hosts_[1]->healthFlagSet(
+      Upstream::Host::HealthFlag::FAILED_ACTIVE_HC);
+  Upstream::ClusterManager::ClusterInfoMap clusters{{"foo", cluster}};
+  EXPECT_CALL(cm, clusters()).WillOnce(Return(clusters));
+
+  const std::string state = InstanceUtil::exportUnhealthyHosts(cm);
+  EXPECT_EQ("foo\t10.0.0.2:80\n", state);
+
+  // Lines that do not name a cluster are ignored.
+  EXPECT_CALL(cm, inheritUnhealthyHosts("foo", std::vector<std::string>{"10.0.0.2:80"}));
+  InstanceUtil::inheritUnhealthyHosts(cm, state + "garbage\n");
+  InstanceUtil::inheritUnhealthyHosts(cm, "");
+}
+
+TEST(ServerInstanceUtil, validatedConfigCache) {
+  const std::string cache_path =
+      TestEnvironment::writeStringToFileForTest("validated_config_cache", "");
+  const std::string config_path =
+      TestEnvironment::writeStringToFileForTest("validated_config.json", "{}");
+
+  EXPECT_FALSE(InstanceUtil::configValidated(cache_path, config_path));
+  InstanceUtil::recordValidatedConfig(cache_path, config_path);
+  EXPECT_TRUE(InstanceUtil::configValidated(cache_path, config_path));
+
+  // Recording the same content twice keeps a single entry.
+  InstanceUtil::recordValidatedConfig(cache_path, config_path);
+  EXPECT_EQ(InstanceUtil::configHash(config_path) + "\n", Filesystem::fileReadToEnd(cache_path));
+
+  // Any change to the config content invalidates it.
+  TestEnvironment::writeStringToFileForTest("validated_config.json", "{ }");
+  EXPECT_FALSE(InstanceUtil::configValidated(cache_path, config_path));
 }
 
 class RunHelperTest : public testing::Test {
@@ -12,6 +12,7 @@
 using testing::InSequence;
 using testing::InvokeWithoutArgs;
 using testing::NiceMock;
+using testing::Ref;
 using testing::Return;
 using testing::Throw;
 using testing::_;
@@ -33,7 +34,7 @@ public:
   NiceMock<MockGuardDog> guard_dog_;
   DefaultTestHooks hooks_;
   WorkerImpl worker_{tls_, hooks_, Event::DispatcherPtr{dispatcher_},
-                     Network::ConnectionHandlerPtr{handler_}};
+                     Network::ConnectionHandlerPtr{handler_}, 1, {}, false};
   Event::TimerPtr no_exit_timer_ = dispatcher_->createTimer([]() -> void {});
 };
 
@@ -126,5 +127,34 @@ TEST_F(WorkerImplTest, ListenerException) {
   worker_.stop();
 }
 
+// The worker listens on the socket the listener has for the index of the worker.
+TEST_F(WorkerImplTest, WorkerSocket) {
+  InSequence s;
+  ConditionalInitializer ci;
+
+  NiceMock<MockListener> listener;
+  NiceMock<Network::MockListenSocket> socket;
+  ON_CALL(listener, listenerTag()).WillByDefault(Return(1));
+  EXPECT_CALL(listener, workerSocket(1)).WillOnce(Return(&socket));
+  EXPECT_CALL(*handler_, addListener(_, Ref(socket), _, 1, _));
+  worker_.addListener(listener, [&ci](bool success) -> void {
+    EXPECT_TRUE(success);
+    ci.setReady();
+  });
+
+  worker_.start(guard_dog_);
+  ci.waitReady();
+  worker_.stop();
+}
+
+TEST(ProdWorkerFactoryTest, WorkerCpu) {
+  EXPECT_FALSE(ProdWorkerFactory::workerCpu({}, 0).valid());
+
+  const std::vector<uint32_t> cpu_set{2, 3, 8};
+  EXPECT_EQ(2U, ProdWorkerFactory::workerCpu(cpu_set, 0).value());
+  EXPECT_EQ(8U, ProdWorkerFactory::workerCpu(cpu_set, 2).value());
+  EXPECT_EQ(2U, ProdWorkerFactory::workerCpu(cpu_set, 3).value());
+}
+
 } // namespace Server
 } // namespace Envoy
@@ -88,7 +88,8 @@ std::vector<Network::Address::IpVersion> TestEnvironment::getIpVersionsForTest()
 
 Server::Options& TestEnvironment::getOptions() {
   static OptionsImpl* options =
-      new OptionsImpl(argc_, argv_, [](uint64_t, uint64_t) { return "1"; }, spdlog::level::err);
+      new OptionsImpl(argc_, argv_, [](uint64_t, uint64_t, uint64_t) { return "1"; },
+                      spdlog::level::err);
   return *options;
 }
 